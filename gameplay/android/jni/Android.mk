@@ -19,11 +19,13 @@ LOCAL_SRC_FILES := \
     AIAgent.cpp \
     AIController.cpp \
     AIMessage.cpp \
+    AINavMesh.cpp \
     AIState.cpp \
     AIStateMachine.cpp \
     Animation.cpp \
     AnimationClip.cpp \
     AnimationController.cpp \
+    AnimationPose.cpp \
     AnimationTarget.cpp \
     AnimationValue.cpp \
     AudioBuffer.cpp \
@@ -32,6 +34,7 @@ LOCAL_SRC_FILES := \
     AudioSource.cpp \
     BoundingBox.cpp \
     BoundingSphere.cpp \
+    BufferAllocator.cpp \
     Bundle.cpp \
     Button.cpp \
     Camera.cpp \
@@ -43,35 +46,53 @@ LOCAL_SRC_FILES := \
     DebugNew.cpp \
     DepthStencilTarget.cpp \
     Drawable.cpp \
+    DynamicResolution.cpp \
     Effect.cpp \
     FileSystem.cpp \
     FlowLayout.cpp \
     Font.cpp \
     Form.cpp \
+    FrameArena.cpp \
     FrameBuffer.cpp \
     Frustum.cpp \
     Game.cpp \
     Gamepad.cpp \
+    GlyphCache.cpp \
+    GraphicsDevice.cpp \
+    GraphicsDeviceGL.cpp \
     HeightField.cpp \
     Image.cpp \
     ImageControl.cpp \
+    Impostor.cpp \
+    InstancedModel.cpp \
+    InstancedSprite.cpp \
+    JobSystem.cpp \
     Joint.cpp \
     JoystickControl.cpp \
     Label.cpp \
     Layout.cpp \
     Light.cpp \
+    LightClusters.cpp \
+    ListView.cpp \
     Logger.cpp \
     Material.cpp \
     MaterialParameter.cpp \
     MathUtil.cpp \
     Matrix.cpp \
+    Matrix34.cpp \
+    MemoryPool.cpp \
+    MemoryStats.cpp \
     Mesh.cpp \
     MeshBatch.cpp \
+    MeshGeometry.cpp \
     MeshPart.cpp \
     MeshSkin.cpp \
+    MeshStreamer.cpp \
     Model.cpp \
     Node.cpp \
+    OcclusionBuffer.cpp \
     ParticleEmitter.cpp \
+    ParticleSystem.cpp \
     Pass.cpp \
     PhysicsCharacter.cpp \
     PhysicsCollisionObject.cpp \
@@ -87,35 +108,57 @@ LOCAL_SRC_FILES := \
     PhysicsSpringConstraint.cpp \
     PhysicsVehicle.cpp \
     PhysicsVehicleWheel.cpp \
+    PlanarReflection.cpp \
     Plane.cpp \
     Platform.cpp \
     PlatformAndroid.cpp \
+    PortalGraph.cpp \
+    PostProcessChain.cpp \
+    Profiler.cpp \
     Properties.cpp \
     Quaternion.cpp \
     RadioButton.cpp \
+    RadixSort.cpp \
     Ray.cpp \
     Rectangle.cpp \
     Ref.cpp \
+    RenderCommandList.cpp \
+    RenderQueue.cpp \
     RenderState.cpp \
+    RenderStats.cpp \
     RenderTarget.cpp \
+    RenderTargetPool.cpp \
+    ResourceCache.cpp \
     Scene.cpp \
     SceneLoader.cpp \
+    SceneReplicator.cpp \
+    SceneSnapshot.cpp \
     ScreenDisplayer.cpp \
     Script.cpp \
     ScriptController.cpp \
     ScriptTarget.cpp \
+    ScriptWorker.cpp \
+    ShadowMaps.cpp \
     Slider.cpp \
+    SpatialIndex.cpp \
     Sprite.cpp \
     SpriteBatch.cpp \
+    SpriteRenderer.cpp \
+    StaticBatch.cpp \
+    StringId.cpp \
     Technique.cpp \
     Terrain.cpp \
     TerrainPatch.cpp \
     Text.cpp \
     TextBox.cpp \
+    TextLayout.cpp \
     Texture.cpp \
+    TextureStreamer.cpp \
+    TextureUploader.cpp \
     Theme.cpp \
     ThemeStyle.cpp \
     TileSet.cpp \
+    TimerWheel.cpp \
     Transform.cpp \
     Vector2.cpp \
     Vector3.cpp \
@@ -123,6 +166,7 @@ LOCAL_SRC_FILES := \
     VertexAttributeBinding.cpp \
     VertexFormat.cpp \
     VerticalLayout.cpp \
+    WorldStreamer.cpp \
     lua/lua_AbsoluteLayout.cpp \
     lua/lua_AIAgent.cpp \
     lua/lua_AIAgentListener.cpp \
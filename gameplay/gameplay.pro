@@ -14,11 +14,13 @@ SOURCES += src/AbsoluteLayout.cpp \
     src/AIAgent.cpp \
     src/AIController.cpp \
     src/AIMessage.cpp \
+    src/AINavMesh.cpp \
     src/AIState.cpp \
     src/AIStateMachine.cpp \
     src/Animation.cpp \
     src/AnimationClip.cpp \
     src/AnimationController.cpp \
+    src/AnimationPose.cpp \
     src/AnimationTarget.cpp \
     src/AnimationValue.cpp \
     src/AudioBuffer.cpp \
@@ -28,6 +30,7 @@ SOURCES += src/AbsoluteLayout.cpp \
     src/BoundingBox.cpp \
     src/BoundingBox.inl \
     src/BoundingSphere.cpp \
+    src/BufferAllocator.cpp \
     src/BoundingSphere.inl \
     src/Bundle.cpp \
     src/Button.cpp \
@@ -39,41 +42,60 @@ SOURCES += src/AbsoluteLayout.cpp \
     src/Curve.cpp \
     src/DepthStencilTarget.cpp \
     src/Drawable.cpp \
+    src/DynamicResolution.cpp \
     src/Effect.cpp \
     src/FileSystem.cpp \
     src/FlowLayout.cpp \
     src/Font.cpp \
     src/Form.cpp \
+    src/FrameArena.cpp \
     src/FrameBuffer.cpp \
     src/Frustum.cpp \
     src/Game.cpp \
     src/Game.inl \
     src/Gamepad.cpp \
+    src/GlyphCache.cpp \
+    src/GraphicsDevice.cpp \
+    src/GraphicsDeviceGL.cpp \
     src/HeightField.cpp \
     src/Image.cpp \
     src/Image.inl \
     src/ImageControl.cpp \
+    src/Impostor.cpp \
+    src/InstancedModel.cpp \
+    src/InstancedSprite.cpp \
+    src/JobSystem.cpp \
     src/Joint.cpp \
     src/JoystickControl.cpp \
     src/Label.cpp \
     src/Layout.cpp \
     src/Light.cpp \
+    src/LightClusters.cpp \
+    src/ListView.cpp \
     src/Logger.cpp \
     src/Material.cpp \
     src/MaterialParameter.cpp \
     src/MathUtil.cpp \
     src/MathUtil.inl \
     src/MathUtilNeon.inl \
+    src/MathUtilSSE.inl \
     src/Matrix.cpp \
+    src/Matrix34.cpp \
+    src/MemoryPool.cpp \
+    src/MemoryStats.cpp \
     src/Matrix.inl \
     src/Mesh.cpp \
     src/MeshBatch.cpp \
+    src/MeshGeometry.cpp \
     src/MeshBatch.inl \
     src/MeshPart.cpp \
     src/MeshSkin.cpp \
+    src/MeshStreamer.cpp \
     src/Model.cpp \
     src/Node.cpp \
+    src/OcclusionBuffer.cpp \
     src/ParticleEmitter.cpp \
+    src/ParticleSystem.cpp \
     src/Pass.cpp \
     src/PhysicsCharacter.cpp \
     src/PhysicsCollisionObject.cpp \
@@ -94,38 +116,61 @@ SOURCES += src/AbsoluteLayout.cpp \
     src/PhysicsSpringConstraint.inl \
     src/PhysicsVehicle.cpp \
     src/PhysicsVehicleWheel.cpp \
+    src/PlanarReflection.cpp \
     src/Plane.cpp \
     src/Plane.inl \
     src/Platform.cpp \
+    src/PortalGraph.cpp \
+    src/PostProcessChain.cpp \
+    src/Profiler.cpp \
     src/Properties.cpp \
     src/Quaternion.cpp \
     src/Quaternion.inl \
     src/RadioButton.cpp \
+    src/RadixSort.cpp \
     src/Ray.cpp \
     src/Ray.inl \
     src/Rectangle.cpp \
     src/Ref.cpp \
+    src/RenderCommandList.cpp \
+    src/RenderQueue.cpp \
     src/RenderState.cpp \
+    src/RenderStats.cpp \
+    src/RenderStats.inl \
     src/RenderTarget.cpp \
+    src/RenderTargetPool.cpp \
+    src/ResourceCache.cpp \
     src/Scene.cpp \
     src/SceneLoader.cpp \
+    src/SceneReplicator.cpp \
+    src/SceneSnapshot.cpp \
     src/ScreenDisplayer.cpp \
     src/Script.cpp \
     src/ScriptController.cpp \
     src/ScriptController.inl \
     src/ScriptTarget.cpp \
+    src/ScriptWorker.cpp \
+    src/ShadowMaps.cpp \
     src/Slider.cpp \
+    src/SpatialIndex.cpp \
     src/Sprite.cpp \
     src/SpriteBatch.cpp \
+    src/SpriteRenderer.cpp \
+    src/StaticBatch.cpp \
+    src/StringId.cpp \
     src/Technique.cpp \
     src/Terrain.cpp \
     src/TerrainPatch.cpp \
     src/Text.cpp \
     src/TextBox.cpp \
+    src/TextLayout.cpp \
     src/Texture.cpp \
+    src/TextureStreamer.cpp \
+    src/TextureUploader.cpp \
     src/Theme.cpp \
     src/ThemeStyle.cpp \
     src/TileSet.cpp \
+    src/TimerWheel.cpp \
     src/Transform.cpp \
     src/Vector2.cpp \
     src/Vector2.inl \
@@ -136,6 +181,7 @@ SOURCES += src/AbsoluteLayout.cpp \
     src/VertexAttributeBinding.cpp \
     src/VertexFormat.cpp \
     src/VerticalLayout.cpp \
+    src/WorldStreamer.cpp \
     src/lua/lua_all_bindings.cpp \
     src/lua/lua_AbsoluteLayout.cpp \
     src/lua/lua_AIAgent.cpp \
@@ -275,11 +321,13 @@ HEADERS += src/AbsoluteLayout.h \
     src/AIAgent.h \
     src/AIController.h \
     src/AIMessage.h \
+    src/AINavMesh.h \
     src/AIState.h \
     src/AIStateMachine.h \
     src/Animation.h \
     src/AnimationClip.h \
     src/AnimationController.h \
+    src/AnimationPose.h \
     src/AnimationTarget.h \
     src/AnimationValue.h \
     src/AudioBuffer.h \
@@ -289,6 +337,7 @@ HEADERS += src/AbsoluteLayout.h \
     src/Base.h \
     src/BoundingBox.h \
     src/BoundingSphere.h \
+    src/BufferAllocator.h \
     src/Bundle.h \
     src/Button.h \
     src/Camera.h \
@@ -299,39 +348,58 @@ HEADERS += src/AbsoluteLayout.h \
     src/Curve.h \
     src/DepthStencilTarget.h \
     src/Drawable.h \
+    src/DynamicResolution.h \
     src/Effect.h \
     src/FileSystem.h \
     src/FlowLayout.h \
     src/Font.h \
     src/Form.h \
+    src/FrameArena.h \
     src/FrameBuffer.h \
     src/Frustum.h \
     src/Game.h \
     src/Gamepad.h \
     src/gameplay.h \
     src/Gesture.h \
+    src/GlyphCache.h \
+    src/GraphicsDevice.h \
+    src/GraphicsDeviceGL.h \
     src/HeightField.h \
     src/Image.h \
     src/ImageControl.h \
+    src/Impostor.h \
+    src/InstancedModel.h \
+    src/InstancedSprite.h \
+    src/JobSystem.h \
     src/Joint.h \
     src/JoystickControl.h \
     src/Keyboard.h \
     src/Label.h \
     src/Layout.h \
     src/Light.h \
+    src/LightClusters.h \
+    src/ListView.h \
     src/Logger.h \
+    src/LuaCompat.h \
     src/Material.h \
     src/MaterialParameter.h \
     src/MathUtil.h \
     src/Matrix.h \
+    src/Matrix34.h \
+    src/MemoryPool.h \
+    src/MemoryStats.h \
     src/Mesh.h \
     src/MeshBatch.h \
+    src/MeshGeometry.h \
     src/MeshPart.h \
     src/MeshSkin.h \
+    src/MeshStreamer.h \
     src/Model.h \
     src/Mouse.h \
     src/Node.h \
+    src/OcclusionBuffer.h \
     src/ParticleEmitter.h \
+    src/ParticleSystem.h \
     src/Pass.h \
     src/PhysicsCharacter.h \
     src/PhysicsCollisionObject.h \
@@ -347,36 +415,59 @@ HEADERS += src/AbsoluteLayout.h \
     src/PhysicsSpringConstraint.h \
     src/PhysicsVehicle.h \
     src/PhysicsVehicleWheel.h \
+    src/PlanarReflection.h \
     src/Plane.h \
     src/Platform.h \
+    src/PortalGraph.h \
+    src/PostProcessChain.h \
+    src/Profiler.h \
     src/Properties.h \
     src/Quaternion.h \
     src/RadioButton.h \
+    src/RadixSort.h \
     src/Ray.h \
     src/Rectangle.h \
     src/Ref.h \
+    src/RenderCommandList.h \
+    src/RenderQueue.h \
     src/RenderState.h \
+    src/RenderStats.h \
     src/RenderTarget.h \
+    src/RenderTargetPool.h \
+    src/ResourceCache.h \
     src/Scene.h \
     src/SceneLoader.h \
+    src/SceneReplicator.h \
+    src/SceneSnapshot.h \
     src/ScreenDisplayer.h \
     src/Script.h \
     src/ScriptController.h \
     src/ScriptTarget.h \
+    src/ScriptWorker.h \
+    src/ShadowMaps.h \
+    src/SimdMath.h \
     src/Slider.h \
+    src/SpatialIndex.h \
     src/Sprite.h \
     src/SpriteBatch.h \
+    src/SpriteRenderer.h \
+    src/StaticBatch.h \
     src/Stream.h \
+    src/StringId.h \
     src/Technique.h \
     src/Terrain.h \
     src/TerrainPatch.h \
     src/Text.h \
     src/TextBox.h \
+    src/TextLayout.h \
     src/Texture.h \
+    src/TextureStreamer.h \
+    src/TextureUploader.h \
     src/Theme.h \
     src/ThemeStyle.h \
     src/TileSet.h \
     src/TimeListener.h \
+    src/TimerWheel.h \
     src/Touch.h \
     src/Transform.h \
     src/Vector2.h \
@@ -385,6 +476,7 @@ HEADERS += src/AbsoluteLayout.h \
     src/VertexAttributeBinding.h \
     src/VertexFormat.h \
     src/VerticalLayout.h \
+    src/WorldStreamer.h \
     src/lua/lua_AbsoluteLayout.h \
     src/lua/lua_AIAgent.h \
     src/lua/lua_AIAgentListener.h \
@@ -530,6 +622,8 @@ INCLUDEPATH += $$PWD/../external-deps/include
 # linux
 linux: SOURCES += src/PlatformLinux.cpp
 linux: SOURCES += src/gameplay-main-linux.cpp
+linux: SOURCES += src/PlatformHeadless.cpp
+linux: SOURCES += src/gameplay-main-headless.cpp
 linux: QMAKE_CXXFLAGS += -lstdc++ -pthread -w
 linux: DEFINES += GP_USE_GAMEPAD
 linux: DEFINES += __linux__
@@ -7,17 +7,27 @@
 #ifndef POINT_LIGHT_COUNT
 #define POINT_LIGHT_COUNT 0
 #endif
-#if (DIRECTIONAL_LIGHT_COUNT > 0) || (POINT_LIGHT_COUNT > 0) || (SPOT_LIGHT_COUNT > 0)
+#if (DIRECTIONAL_LIGHT_COUNT > 0) || (POINT_LIGHT_COUNT > 0) || (SPOT_LIGHT_COUNT > 0) || defined(CLUSTERED_LIGHTING)
 #define LIGHTING
 #endif
+#if defined(LIGHTING) && (defined(DIRECTIONAL_LIGHT_SHADOWS) || defined(SPOT_LIGHT_SHADOWS) || defined(POINT_LIGHT_SHADOWS))
+#define SHADOWS
+#endif
 
 ///////////////////////////////////////////////////////////
 // Attributes
 attribute vec4 a_position;
 
+#if defined(INSTANCED)
+attribute mat4 a_instanceMatrix;
+#endif
+
 #if defined(SKINNING)
 attribute vec4 a_blendWeights;
 attribute vec4 a_blendIndices;
+#if defined(SKINNING_TEXTURE)
+attribute float a_instancePalette;
+#endif
 #endif
 
 #if defined(LIGHTMAP)
@@ -37,13 +47,20 @@ attribute vec3 a_color;
 uniform mat4 u_worldViewProjectionMatrix;
 
 #if defined(SKINNING)
+#if defined(SKINNING_TEXTURE)
+uniform sampler2D u_matrixPaletteTexture;
+uniform vec2 u_matrixPaletteTextureInverseSize;
+#elif defined(SKINNING_DUAL_QUATERNION)
+uniform vec4 u_dualQuaternionPalette[SKINNING_JOINT_COUNT * 2];
+#else
 uniform vec4 u_matrixPalette[SKINNING_JOINT_COUNT * 3];
 #endif
+#endif
 
 #if defined(LIGHTING)
 uniform mat4 u_inverseTransposeWorldViewMatrix;
 
-#if (POINT_LIGHT_COUNT > 0) || (SPOT_LIGHT_COUNT > 0) || defined(SPECULAR)
+#if (POINT_LIGHT_COUNT > 0) || (SPOT_LIGHT_COUNT > 0) || defined(SPECULAR) || defined(CLUSTERED_LIGHTING) || defined(SHADOWS)
 uniform mat4 u_worldViewMatrix;
 #endif
 
@@ -66,8 +83,11 @@ uniform vec3 u_cameraPosition;
 
 #endif
 
-#if defined(CLIP_PLANE)
+#if defined(CLIP_PLANE) || defined(SHADOWS)
 uniform mat4 u_worldMatrix;
+#endif
+
+#if defined(CLIP_PLANE)
 uniform vec4 u_clipPlane;
 #endif
 
@@ -85,6 +105,10 @@ varying vec3 v_color;
 
 varying vec3 v_normalVector;
 
+#if defined(CLUSTERED_LIGHTING)
+varying vec3 v_positionViewSpace;
+#endif
+
 #if (DIRECTIONAL_LIGHT_COUNT > 0) 
 varying vec3 v_lightDirection[DIRECTIONAL_LIGHT_COUNT];
 #endif
@@ -101,10 +125,16 @@ varying vec3 v_vertexToSpotLightDirection[SPOT_LIGHT_COUNT];
 varying vec3 v_cameraDirection;
 #endif
 
+#if defined(SHADOWS)
+varying vec4 v_shadowPosition;
+#endif
+
 #include "lighting.vert"
 
 #endif
 
+#include "quantization.vert"
+
 #if defined(SKINNING)
 #include "skinning.vert"
 #else
@@ -118,11 +148,19 @@ varying float v_clipDistance;
 void main()
 {
     vec4 position = getPosition();
+    #if defined(INSTANCED)
+    // Transform the vertex into the space of the instanced model's node.
+    position = a_instanceMatrix * position;
+    mat3 instanceMatrix = mat3(a_instanceMatrix[0].xyz, a_instanceMatrix[1].xyz, a_instanceMatrix[2].xyz);
+    #endif
     gl_Position = u_worldViewProjectionMatrix * position;
 
     #if defined (LIGHTING)
 
     vec3 normal = getNormal();
+    #if defined(INSTANCED)
+    normal = instanceMatrix * normal;
+    #endif
 
     // Transform normal to view space.
     mat3 inverseTransposeWorldViewMatrix = mat3(u_inverseTransposeWorldViewMatrix[0].xyz, u_inverseTransposeWorldViewMatrix[1].xyz, u_inverseTransposeWorldViewMatrix[2].xyz);
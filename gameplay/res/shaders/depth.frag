@@ -0,0 +1,11 @@
+#ifdef OPENGL_ES
+precision mediump float;
+#endif
+
+// Fragment shader of the depth variants of passes (see Pass::getDepthPass), which only write
+// depth. The vertex shader of the pass is used unchanged, so its varyings are left unread.
+
+void main()
+{
+    gl_FragColor = vec4(0.0);
+}
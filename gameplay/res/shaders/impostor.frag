@@ -0,0 +1,26 @@
+#ifdef OPENGL_ES
+#ifdef GL_FRAGMENT_PRECISION_HIGH
+precision highp float;
+#else
+precision mediump float;
+#endif
+#endif
+
+///////////////////////////////////////////////////////////
+// Uniforms
+uniform sampler2D u_texture;
+
+///////////////////////////////////////////////////////////
+// Varyings
+varying vec2 v_texCoord;
+
+
+void main()
+{
+    // The background of the views is transparent, and is cut out rather than blended so that
+    // the impostors do not have to be sorted.
+    vec4 color = texture2D(u_texture, v_texCoord);
+    if (color.a < 0.5)
+        discard;
+    gl_FragColor = color;
+}
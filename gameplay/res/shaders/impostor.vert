@@ -0,0 +1,26 @@
+///////////////////////////////////////////////////////////
+// Attributes
+attribute vec2 a_position;
+attribute vec4 a_instancePosition;
+attribute float a_instanceView;
+
+///////////////////////////////////////////////////////////
+// Uniforms
+uniform mat4 u_viewMatrix;
+uniform mat4 u_projectionMatrix;
+uniform float u_viewCount;
+
+///////////////////////////////////////////////////////////
+// Varyings
+varying vec2 v_texCoord;
+
+
+void main()
+{
+    // The quad faces the camera and covers the bounding sphere of the instance, like the
+    // orthographic view that its frame of the atlas was rendered with.
+    vec4 center = u_viewMatrix * vec4(a_instancePosition.xyz, 1);
+    center.xy += a_position * (2.0 * a_instancePosition.w);
+    gl_Position = u_projectionMatrix * center;
+    v_texCoord = vec2((a_instanceView + a_position.x + 0.5) / u_viewCount, a_position.y + 0.5);
+}
@@ -0,0 +1,122 @@
+// Lighting from the lights of a LightClusters object.
+//
+// The view frustum is split into a grid of clusters, and each cluster has a list of the point and
+// spot lights that reach it. Each pixel only loops over the lights of its own cluster, and the
+// directional lights, which reach every pixel.
+
+// These must match the constants of the LightClusters class.
+#ifndef CLUSTER_LIGHT_MAX
+#define CLUSTER_LIGHT_MAX 64
+#endif
+#ifndef CLUSTER_DIRECTIONAL_LIGHT_MAX
+#define CLUSTER_DIRECTIONAL_LIGHT_MAX 4
+#endif
+#ifndef CLUSTER_LIGHT_TEXTURE_WIDTH
+#define CLUSTER_LIGHT_TEXTURE_WIDTH 1024.0
+#endif
+#ifndef CLUSTER_INDEX_TEXTURE_SIZE
+#define CLUSTER_INDEX_TEXTURE_SIZE 256.0
+#endif
+
+vec3 computeLighting(vec3 normalVector, vec3 lightDirection, vec3 lightColor, float attenuation, vec3 vertexToEye)
+{
+    float diffuse = max(dot(normalVector, lightDirection), 0.0);
+    vec3 diffuseColor = lightColor * _baseColor.rgb * diffuse * attenuation;
+
+    #if defined(SPECULAR)
+
+    // Blinn-Phong shading
+    vec3 halfVector = normalize(lightDirection + vertexToEye);
+    float specularAngle = clamp(dot(normalVector, halfVector), 0.0, 1.0);
+    vec3 specularColor = vec3(pow(specularAngle, u_specularExponent)) * attenuation;
+
+    return diffuseColor + specularColor;
+
+    #else
+
+    return diffuseColor;
+
+    #endif
+}
+
+// Returns a row of the data of a light: 0 is the position and inverse range, 1 the color and
+// cosine of the outer spot angle, and 2 the direction and cosine of the inner spot angle.
+vec4 getClusterLight(float index, float row)
+{
+    return texture2D(u_clusterLightTexture, vec2((index + 0.5) / CLUSTER_LIGHT_TEXTURE_WIDTH, (row + 0.5) / 3.0));
+}
+
+// Decodes a 16-bit value stored in the red and green channels of a texel.
+float decodeClusterValue(vec4 texel)
+{
+    return floor(texel.r * 255.0 + 0.5) + floor(texel.g * 255.0 + 0.5) * 256.0;
+}
+
+vec3 getLitPixel()
+{
+    #if defined(BUMPED)
+
+    vec3 normalVector = texture2D(u_normalmapTexture, v_texCoord).rgb * 2.0 - 1.0;
+    normalVector = normalize(mat3(v_tangentVector, v_binormalVector, v_normalVector) * normalVector);
+
+    #else
+
+    vec3 normalVector = normalize(v_normalVector);
+
+    #endif
+
+    vec3 vertexToEye = normalize(-v_positionViewSpace);
+    vec3 combinedColor = _baseColor.rgb * u_ambientColor;
+
+    // Directional light contribution
+    for (int i = 0; i < CLUSTER_DIRECTIONAL_LIGHT_MAX; ++i)
+    {
+        if (float(i) >= u_clusterGrid.w)
+            break;
+        vec3 lightColor = getClusterLight(float(i), 1.0).rgb;
+        vec3 lightDirection = getClusterLight(float(i), 2.0).xyz;
+        float shadow = 1.0;
+        #if defined(DIRECTIONAL_LIGHT_SHADOWS)
+        if (i == 0)
+            shadow = getDirectionalLightShadow();
+        #endif
+        combinedColor += computeLighting(normalVector, -lightDirection, lightColor, shadow, vertexToEye);
+    }
+
+    // Find the cluster of the pixel, from its tile on the screen and its slice of the view depth.
+    vec2 tile = floor((gl_FragCoord.xy - u_clusterViewport.xy) * u_clusterViewport.zw * u_clusterGrid.xy);
+    tile = clamp(tile, vec2(0.0), u_clusterGrid.xy - 1.0);
+    float slice = floor(log(max(-v_positionViewSpace.z, u_clusterDepth.x) / u_clusterDepth.x) * u_clusterDepth.y);
+    slice = clamp(slice, 0.0, u_clusterGrid.z - 1.0);
+    vec4 cluster = texture2D(u_clusterTexture, vec2((tile.y * u_clusterGrid.x + tile.x + 0.5) / (u_clusterGrid.x * u_clusterGrid.y), (slice + 0.5) / u_clusterGrid.z));
+    float offset = decodeClusterValue(cluster);
+    float count = floor(cluster.b * 255.0 + 0.5);
+
+    // Point and spot light contribution. Point lights are stored with spot angles that never
+    // attenuate them.
+    for (int i = 0; i < CLUSTER_LIGHT_MAX; ++i)
+    {
+        if (float(i) >= count)
+            break;
+        float entry = offset + float(i);
+        vec2 indexCoord = vec2(mod(entry, CLUSTER_INDEX_TEXTURE_SIZE) + 0.5, floor(entry / CLUSTER_INDEX_TEXTURE_SIZE) + 0.5) / CLUSTER_INDEX_TEXTURE_SIZE;
+        float index = decodeClusterValue(texture2D(u_clusterIndexTexture, indexCoord));
+
+        vec4 lightPosition = getClusterLight(index, 0.0);
+        vec4 lightColor = getClusterLight(index, 1.0);
+        vec4 lightDirection = getClusterLight(index, 2.0);
+
+        // Compute range attenuation
+        vec3 vertexToLight = lightPosition.xyz - v_positionViewSpace;
+        vec3 ldir = vertexToLight * lightPosition.w;
+        float attenuation = clamp(1.0 - dot(ldir, ldir), 0.0, 1.0);
+        vec3 vertexToLightDirection = normalize(vertexToLight);
+
+        // Apply spot attenuation
+        float spotCurrentAngleCos = dot(lightDirection.xyz, -vertexToLightDirection);
+        attenuation *= smoothstep(lightColor.w, lightDirection.w, spotCurrentAngleCos);
+        combinedColor += computeLighting(normalVector, vertexToLightDirection, lightColor.rgb, attenuation, vertexToEye);
+    }
+
+    return combinedColor;
+}
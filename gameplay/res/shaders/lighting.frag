@@ -50,7 +50,12 @@ vec3 getLitPixel()
         #else
         vec3 lightDirection = normalize(u_directionalLightDirection[i] * 2.0);
         #endif 
-        combinedColor += computeLighting(normalVector, -lightDirection, u_directionalLightColor[i], 1.0);
+        float shadow = 1.0;
+        #if defined(DIRECTIONAL_LIGHT_SHADOWS)
+        if (i == 0)
+            shadow = getDirectionalLightShadow();
+        #endif
+        combinedColor += computeLighting(normalVector, -lightDirection, u_directionalLightColor[i], shadow);
     }
     #endif
 
@@ -60,6 +65,10 @@ vec3 getLitPixel()
     {
         vec3 ldir = v_vertexToPointLightDirection[i] * u_pointLightRangeInverse[i];
         float attenuation = clamp(1.0 - dot(ldir, ldir), 0.0, 1.0);
+        #if defined(POINT_LIGHT_SHADOWS)
+        if (attenuation > 0.0)
+            attenuation *= getPointLightShadow(u_pointLightShadow[i * 2], u_pointLightShadow[i * 2 + 1]);
+        #endif
         combinedColor += computeLighting(normalVector, normalize(v_vertexToPointLightDirection[i]), u_pointLightColor[i], attenuation);
     }
     #endif
@@ -84,6 +93,13 @@ vec3 getLitPixel()
 
 		// Apply spot attenuation
         attenuation *= smoothstep(u_spotLightOuterAngleCos[i], u_spotLightInnerAngleCos[i], spotCurrentAngleCos);
+        #if defined(SPOT_LIGHT_SHADOWS)
+        if (attenuation > 0.0)
+        {
+            vec4 shadowCoord = u_spotLightShadowMatrix[i] * vec4(v_shadowPosition.xyz, 1.0);
+            attenuation *= getShadow(shadowCoord.xyz / shadowCoord.w);
+        }
+        #endif
         combinedColor += computeLighting(normalVector, vertexToSpotLightDirection, u_spotLightColor[i], attenuation);
     }
     #endif
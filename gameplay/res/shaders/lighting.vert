@@ -2,9 +2,18 @@
 #if defined(BUMPED)
 void applyLight(vec4 position, mat3 tangentSpaceTransformMatrix)
 {
-    #if (defined(SPECULAR) || (POINT_LIGHT_COUNT > 0) || (SPOT_LIGHT_COUNT > 0))
+    #if (defined(SPECULAR) || (POINT_LIGHT_COUNT > 0) || (SPOT_LIGHT_COUNT > 0) || defined(CLUSTERED_LIGHTING) || defined(SHADOWS))
     vec4 positionWorldViewSpace = u_worldViewMatrix * position;
     #endif
+
+    #if defined(CLUSTERED_LIGHTING)
+    v_positionViewSpace = positionWorldViewSpace.xyz;
+    #endif
+
+    #if defined(SHADOWS)
+    // The shadow maps are looked up by world position, and the cascades by view depth.
+    v_shadowPosition = vec4((u_worldMatrix * position).xyz, -positionWorldViewSpace.z);
+    #endif
     
     #if (DIRECTIONAL_LIGHT_COUNT > 0)
     for (int i = 0; i < DIRECTIONAL_LIGHT_COUNT; ++i)
@@ -39,10 +48,19 @@ void applyLight(vec4 position, mat3 tangentSpaceTransformMatrix)
 #else
 void applyLight(vec4 position)
 {
-    #if defined(SPECULAR) || (POINT_LIGHT_COUNT > 0) || (SPOT_LIGHT_COUNT > 0)
+    #if defined(SPECULAR) || (POINT_LIGHT_COUNT > 0) || (SPOT_LIGHT_COUNT > 0) || defined(CLUSTERED_LIGHTING) || defined(SHADOWS)
 	vec4 positionWorldViewSpace = u_worldViewMatrix * position;
     #endif
 
+    #if defined(CLUSTERED_LIGHTING)
+    v_positionViewSpace = positionWorldViewSpace.xyz;
+    #endif
+
+    #if defined(SHADOWS)
+    // The shadow maps are looked up by world position, and the cascades by view depth.
+    v_shadowPosition = vec4((u_worldMatrix * position).xyz, -positionWorldViewSpace.z);
+    #endif
+
     #if (POINT_LIGHT_COUNT > 0)
     for (int i = 0; i < POINT_LIGHT_COUNT; ++i)
     {
@@ -0,0 +1,48 @@
+///////////////////////////////////////////////////////////
+// Attributes
+attribute vec3 a_position;
+attribute vec3 a_velocity;
+attribute vec3 a_acceleration;
+attribute float a_energy;
+attribute vec4 a_rotation;
+
+///////////////////////////////////////////////////////////
+// Uniforms
+uniform vec2 u_elapsedTime;
+
+///////////////////////////////////////////////////////////
+// Varyings
+varying vec3 v_position;
+varying vec3 v_velocity;
+varying vec3 v_acceleration;
+varying float v_energy;
+
+
+// Rotates a vector around a unit axis.
+vec3 rotate(vec3 v, vec3 axis, float angle)
+{
+    float c = cos(angle);
+    float s = sin(angle);
+    return v * c + cross(axis, v) * s + axis * dot(axis, v) * (1.0 - c);
+}
+
+void main()
+{
+    // The elapsed time is in milliseconds (x) and seconds (y).
+    vec3 velocity = a_velocity;
+    vec3 acceleration = a_acceleration;
+    if (a_rotation.w != 0.0 && dot(a_rotation.xyz, a_rotation.xyz) > 0.0)
+    {
+        vec3 axis = normalize(a_rotation.xyz);
+        float angle = a_rotation.w * u_elapsedTime.y;
+        velocity = rotate(velocity, axis, angle);
+        acceleration = rotate(acceleration, axis, angle);
+    }
+
+    velocity += acceleration * u_elapsedTime.y;
+    v_position = a_position + velocity * u_elapsedTime.y;
+    v_velocity = velocity;
+    v_acceleration = acceleration;
+    v_energy = a_energy - u_elapsedTime.x;
+    gl_Position = vec4(v_position, 1.0);
+}
@@ -0,0 +1,65 @@
+#ifndef FRAME_COUNT_MAX
+#define FRAME_COUNT_MAX 64
+#endif
+
+///////////////////////////////////////////////////////////
+// Attributes
+attribute vec2 a_position;
+attribute vec3 a_particlePosition;
+attribute float a_particleEnergy;
+attribute vec4 a_particleColorStart;
+attribute vec4 a_particleColorEnd;
+attribute vec4 a_particleLife;
+attribute vec2 a_particleAngle;
+
+///////////////////////////////////////////////////////////
+// Uniforms
+uniform mat4 u_viewProjectionMatrix;
+uniform vec3 u_cameraRight;
+uniform vec3 u_cameraUp;
+uniform vec4 u_frameCoords[FRAME_COUNT_MAX];
+uniform vec4 u_animation;
+
+///////////////////////////////////////////////////////////
+// Varyings
+varying vec2 v_texCoord;
+varying vec4 v_color;
+
+
+void main()
+{
+    // Dead particles are moved outside of the view volume.
+    if (a_particleEnergy <= 0.0)
+    {
+        gl_Position = vec4(0.0, 0.0, 2.0, 1.0);
+        v_texCoord = vec2(0.0);
+        v_color = vec4(0.0);
+        return;
+    }
+
+    // a_particleLife holds the start and end size, the inverse of the starting energy and the first frame.
+    float percent = 1.0 - a_particleEnergy * a_particleLife.z;
+    float age = (1.0 / a_particleLife.z - a_particleEnergy) * 0.001;
+    float size = mix(a_particleLife.x, a_particleLife.y, percent);
+    float angle = a_particleAngle.x + a_particleAngle.y * age;
+
+    // u_animation holds the frame count, the animation mode (0: none, 1: over the lifetime,
+    // 2: looped), the lifetime percentage of each frame and the duration of each frame.
+    float frame = a_particleLife.w;
+    if (u_animation.y == 1.0)
+        frame = min(max(frame, floor(percent / u_animation.z)), u_animation.x - 1.0);
+    else if (u_animation.y == 2.0)
+        frame = mod(frame + floor(age / u_animation.w), u_animation.x);
+    vec4 frameCoords = u_frameCoords[int(min(frame, float(FRAME_COUNT_MAX - 1)))];
+
+    // Camera-facing quad, rotated around its center.
+    vec2 corner = a_position - vec2(0.5);
+    float c = cos(angle);
+    float s = sin(angle);
+    vec2 offset = vec2(corner.x * c - corner.y * s, corner.x * s + corner.y * c) * size;
+    vec3 position = a_particlePosition + u_cameraRight * offset.x + u_cameraUp * offset.y;
+
+    gl_Position = u_viewProjectionMatrix * vec4(position, 1.0);
+    v_texCoord = vec2(mix(frameCoords.x, frameCoords.z, a_position.x), mix(frameCoords.y, frameCoords.w, a_position.y));
+    v_color = mix(a_particleColorStart, a_particleColorEnd, percent);
+}
@@ -0,0 +1,21 @@
+#include "postprocess.frag"
+
+// A separable gaussian blur of nine texels, in five bilinear taps. It is drawn twice, with a
+// horizontal and then a vertical u_direction of (1, 0) and (0, 1).
+
+///////////////////////////////////////////////////////////
+// Uniforms
+uniform vec2 u_direction;
+
+
+void main()
+{
+    vec2 offset1 = u_direction * u_texelSize * 1.3846153846;
+    vec2 offset2 = u_direction * u_texelSize * 3.2307692308;
+    vec4 color = texture2D(u_texture, v_texCoord) * 0.2270270270;
+    color += texture2D(u_texture, v_texCoord + offset1) * 0.3162162162;
+    color += texture2D(u_texture, v_texCoord - offset1) * 0.3162162162;
+    color += texture2D(u_texture, v_texCoord + offset2) * 0.0702702703;
+    color += texture2D(u_texture, v_texCoord - offset2) * 0.0702702703;
+    gl_FragColor = color;
+}
@@ -0,0 +1,19 @@
+#ifdef OPENGL_ES
+#ifdef GL_FRAGMENT_PRECISION_HIGH
+precision highp float;
+#else
+precision mediump float;
+#endif
+#endif
+
+// The declarations that every post-processing pass shares. The input of a pass is bound to
+// u_texture, and u_texelSize is the size of a texel of that input.
+
+///////////////////////////////////////////////////////////
+// Uniforms
+uniform sampler2D u_texture;
+uniform vec2 u_texelSize;
+
+///////////////////////////////////////////////////////////
+// Varyings
+varying vec2 v_texCoord;
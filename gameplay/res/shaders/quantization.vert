@@ -0,0 +1,30 @@
+#if defined(QUANTIZED_POSITION)
+uniform vec3 u_positionDecodeScale;
+uniform vec3 u_positionDecodeOffset;
+#endif
+
+// Positions quantized to normalized integers are scaled and offset back to the bounds of the mesh.
+vec4 decodePosition(vec4 position)
+{
+#if defined(QUANTIZED_POSITION)
+    return vec4(position.xyz * u_positionDecodeScale + u_positionDecodeOffset, 1.0);
+#else
+    return position;
+#endif
+}
+
+// Octahedral directions keep two components, which map the unit octahedron onto a square.
+vec3 decodeDirection(vec3 direction)
+{
+#if defined(OCTAHEDRAL_NORMAL)
+    vec3 v = vec3(direction.xy, 1.0 - abs(direction.x) - abs(direction.y));
+    if (v.z < 0.0)
+    {
+        vec2 signs = vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+        v.xy = (1.0 - abs(v.yx)) * signs;
+    }
+    return normalize(v);
+#else
+    return direction;
+#endif
+}
@@ -0,0 +1,20 @@
+#ifdef OPENGL_ES
+#ifdef GL_FRAGMENT_PRECISION_HIGH
+precision highp float;
+#else
+precision mediump float;
+#endif
+#endif
+
+// Fragment shader of the shadow variants of passes (see Pass::getShadowPass), which write the
+// depth of shadow casters into a ShadowMaps atlas. The depth is encoded in two channels, and is
+// written to both pairs of channels; the atlas masks out the pair the caster does not belong to
+// (red and green for static casters, blue and alpha for dynamic casters).
+
+void main()
+{
+    // A depth of exactly 1 would wrap around to 0.
+    vec2 depth = fract(vec2(1.0, 255.0) * min(gl_FragCoord.z, 0.99999));
+    depth.x -= depth.y / 255.0;
+    gl_FragColor = vec4(depth, depth);
+}
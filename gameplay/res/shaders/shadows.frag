@@ -0,0 +1,81 @@
+// Shadows from the shadow maps of a ShadowMaps object.
+//
+// Each texel of the atlas holds the depth of the static casters in its red and green channels, and
+// the depth of the dynamic casters in its blue and alpha channels. A point is lit where it is in
+// front of both.
+
+float decodeShadowDepth(vec2 depth)
+{
+    return dot(depth, vec2(1.0, 1.0 / 255.0));
+}
+
+float getShadowTap(vec2 coord, float depth)
+{
+    vec4 texel = texture2D(u_shadowTexture, coord);
+    return step(depth, decodeShadowDepth(texel.rg)) * step(depth, decodeShadowDepth(texel.ba));
+}
+
+// Returns how much of a light reaches a point, from the position of the point in the atlas (x and y)
+// and its depth (z). The four nearest texels are tested and blended, to soften the shadow edges.
+float getShadow(vec3 coord)
+{
+    float depth = coord.z - u_shadowParameters.y;
+    vec2 position = coord.xy * u_shadowParameters.z - 0.5;
+    vec2 weight = fract(position);
+    vec2 base = (floor(position) + 0.5) * u_shadowParameters.x;
+    float texelSize = u_shadowParameters.x;
+    float a = getShadowTap(base, depth);
+    float b = getShadowTap(base + vec2(texelSize, 0.0), depth);
+    float c = getShadowTap(base + vec2(0.0, texelSize), depth);
+    float d = getShadowTap(base + vec2(texelSize, texelSize), depth);
+    return mix(mix(a, b, weight.x), mix(c, d, weight.x), weight.y);
+}
+
+#if defined(DIRECTIONAL_LIGHT_SHADOWS)
+// Returns how much of the first directional light reaches the pixel, from the cascade that covers its view depth.
+float getDirectionalLightShadow()
+{
+    for (int i = 0; i < SHADOW_CASCADE_COUNT; ++i)
+    {
+        if (v_shadowPosition.w < u_shadowCascadeSplits[i])
+            return getShadow((u_shadowCascadeMatrix[i] * vec4(v_shadowPosition.xyz, 1.0)).xyz);
+    }
+    return 1.0;
+}
+#endif
+
+#if defined(POINT_LIGHT_SHADOWS)
+// Returns how much of a point light reaches the pixel, from the two vectors of its shadow cube:
+// the position of the light and the size of a face in the atlas, and the position of the block
+// of faces in the atlas and the terms that turn the distance along the axis of a face into depth.
+// The faces look along +X, -X, +Y, -Y, +Z and -Z, in a block of 3x2 faces.
+float getPointLightShadow(vec4 light, vec4 faces)
+{
+    vec3 direction = v_shadowPosition.xyz - light.xyz;
+    vec3 size = abs(direction);
+    float face;
+    float distance;
+    vec2 coord;
+    if (size.x >= size.y && size.x >= size.z)
+    {
+        face = direction.x > 0.0 ? 0.0 : 1.0;
+        distance = size.x;
+        coord = vec2(direction.x > 0.0 ? direction.z : -direction.z, direction.y);
+    }
+    else if (size.y >= size.z)
+    {
+        face = direction.y > 0.0 ? 2.0 : 3.0;
+        distance = size.y;
+        coord = vec2(direction.y > 0.0 ? direction.x : -direction.x, direction.z);
+    }
+    else
+    {
+        face = direction.z > 0.0 ? 4.0 : 5.0;
+        distance = size.z;
+        coord = vec2(direction.z > 0.0 ? -direction.x : direction.x, direction.y);
+    }
+    distance = max(distance, 0.0001);
+    vec2 cell = vec2(mod(face, 3.0), floor(face / 3.0));
+    return getShadow(vec3(faces.xy + (cell + coord / distance * 0.5 + 0.5) * light.w, faces.z - faces.w / distance));
+}
+#endif
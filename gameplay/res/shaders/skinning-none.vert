@@ -1,24 +1,24 @@
 vec4 getPosition()
 {
-    return a_position;    
+    return decodePosition(a_position);
 }
 
 #if defined(LIGHTING)
 
 vec3 getNormal()
 {
-    return a_normal;
+    return decodeDirection(a_normal);
 }
 
 #if defined(BUMPED)
 vec3 getTangent()
 {
-    return a_tangent;
+    return decodeDirection(a_tangent);
 }
 
 vec3 getBinormal()
 {
-    return a_binormal;
+    return decodeDirection(a_binormal);
 }
 #endif
 
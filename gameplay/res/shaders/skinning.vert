@@ -1,31 +1,112 @@
 
+#if defined(SKINNING_DUAL_QUATERNION) && !defined(SKINNING_TEXTURE)
+
+// Each joint is a unit dual quaternion of two rows: the rotation followed by the dual part.
+vec4 _skinnedReal;
+vec4 _skinnedDual;
+
+void blendDualQuaternion(float blendWeight, int index, vec4 pivot)
+{
+    vec4 real = u_dualQuaternionPalette[index];
+    // Blend along the shortest path from the first joint of the vertex.
+    if (dot(real, pivot) < 0.0)
+        blendWeight = -blendWeight;
+    _skinnedReal += blendWeight * real;
+    _skinnedDual += blendWeight * u_dualQuaternionPalette[index + 1];
+}
+
+vec3 rotateVector(vec3 vector)
+{
+    return vector + 2.0 * cross(_skinnedReal.xyz, cross(_skinnedReal.xyz, vector) + _skinnedReal.w * vector);
+}
+
+vec4 getPosition()
+{
+    int index = int(a_blendIndices[0]) * 2;
+    vec4 pivot = u_dualQuaternionPalette[index];
+    _skinnedReal = vec4(0.0);
+    _skinnedDual = vec4(0.0);
+    blendDualQuaternion(a_blendWeights[0], index, pivot);
+    blendDualQuaternion(a_blendWeights[1], int(a_blendIndices[1]) * 2, pivot);
+    blendDualQuaternion(a_blendWeights[2], int(a_blendIndices[2]) * 2, pivot);
+    blendDualQuaternion(a_blendWeights[3], int(a_blendIndices[3]) * 2, pivot);
+
+    float scale = 1.0 / length(_skinnedReal);
+    _skinnedReal *= scale;
+    _skinnedDual *= scale;
+
+    vec3 translation = 2.0 * (_skinnedReal.w * _skinnedDual.xyz - _skinnedDual.w * _skinnedReal.xyz + cross(_skinnedReal.xyz, _skinnedDual.xyz));
+    vec4 position = decodePosition(a_position);
+    return vec4(rotateVector(position.xyz) + translation * position.w, position.w);
+}
+
+#if defined(LIGHTING)
+
+// The blended rotation is computed by getPosition(), which must be called first.
+vec3 getNormal()
+{
+    return rotateVector(decodeDirection(a_normal));
+}
+
+#if defined(BUMPED)
+
+vec3 getTangent()
+{
+    return rotateVector(decodeDirection(a_tangent));
+}
+
+vec3 getBinormal()
+{
+    return rotateVector(decodeDirection(a_binormal));
+}
+
+#endif
+
+#endif
+
+#else
+
+#if defined(SKINNING_TEXTURE)
+// The palette of each instance is a row of the palette texture, with three texels for each joint.
+vec4 getPaletteRow(int index)
+{
+    return texture2DLod(u_matrixPaletteTexture, (vec2(float(index), a_instancePalette) + 0.5) * u_matrixPaletteTextureInverseSize, 0.0);
+}
+#else
+vec4 getPaletteRow(int index)
+{
+    return u_matrixPalette[index];
+}
+#endif
+
 vec4 _skinnedPosition;
 
-void skinPosition(float blendWeight, int matrixIndex)
+void skinPosition(vec4 position, float blendWeight, int matrixIndex)
 {
     vec4 tmp;
-    tmp.x = dot(a_position, u_matrixPalette[matrixIndex]);
-    tmp.y = dot(a_position, u_matrixPalette[matrixIndex + 1]);
-    tmp.z = dot(a_position, u_matrixPalette[matrixIndex + 2]);
-    tmp.w = a_position.w;
+    tmp.x = dot(position, getPaletteRow(matrixIndex));
+    tmp.y = dot(position, getPaletteRow(matrixIndex + 1));
+    tmp.z = dot(position, getPaletteRow(matrixIndex + 2));
+    tmp.w = position.w;
     _skinnedPosition += blendWeight * tmp;
 }
 
 vec4 getPosition()
 {
+    vec4 position = decodePosition(a_position);
     _skinnedPosition = vec4(0.0);
     float blendWeight = a_blendWeights[0];
     int matrixIndex = int (a_blendIndices[0]) * 3;
-    skinPosition(blendWeight, matrixIndex);
+    skinPosition(position, blendWeight, matrixIndex);
     blendWeight = a_blendWeights[1];
     matrixIndex = int(a_blendIndices[1]) * 3;
-    skinPosition(blendWeight, matrixIndex);
+    skinPosition(position, blendWeight, matrixIndex);
     blendWeight = a_blendWeights[2];
     matrixIndex = int(a_blendIndices[2]) * 3;
-    skinPosition(blendWeight, matrixIndex);
+    skinPosition(position, blendWeight, matrixIndex);
     blendWeight = a_blendWeights[3];
     matrixIndex = int(a_blendIndices[3]) * 3;
-    skinPosition(blendWeight, matrixIndex);
+    skinPosition(position, blendWeight, matrixIndex);
     return _skinnedPosition;    
 }
 
@@ -36,9 +117,9 @@ vec3 _skinnedNormal;
 void skinTangentSpaceVector(vec3 vector, float blendWeight, int matrixIndex)
 {
     vec3 tmp;
-    tmp.x = dot(vector, u_matrixPalette[matrixIndex].xyz);
-    tmp.y = dot(vector, u_matrixPalette[matrixIndex + 1].xyz);
-    tmp.z = dot(vector, u_matrixPalette[matrixIndex + 2].xyz);
+    tmp.x = dot(vector, getPaletteRow(matrixIndex).xyz);
+    tmp.y = dot(vector, getPaletteRow(matrixIndex + 1).xyz);
+    tmp.z = dot(vector, getPaletteRow(matrixIndex + 2).xyz);
     _skinnedNormal += blendWeight * tmp;
 }
 
@@ -63,22 +144,23 @@ vec3 getTangentSpaceVector(vec3 vector)
 
 vec3 getNormal()
 {
-    return getTangentSpaceVector(a_normal);
+    return getTangentSpaceVector(decodeDirection(a_normal));
 }
 
 #if defined(BUMPED)
 
 vec3 getTangent()
 {
-    return getTangentSpaceVector(a_tangent);
+    return getTangentSpaceVector(decodeDirection(a_tangent));
 }
 
 vec3 getBinormal()
 {
-    return getTangentSpaceVector(a_binormal);
+    return getTangentSpaceVector(decodeDirection(a_binormal));
 }
 
 #endif
 
 #endif
 
+#endif
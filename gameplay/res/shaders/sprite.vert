@@ -1,22 +1,52 @@
 ///////////////////////////////////////////////////////////
 // Attributes
 attribute vec3 a_position;
+#if defined(TEXTURE_ARRAY)
+attribute vec3 a_texCoord;
+#else
 attribute vec2 a_texCoord;
+#endif
+#if defined(INSTANCED)
+attribute vec4 a_instancePosition;
+attribute vec4 a_instanceScale;
+attribute vec4 a_instanceColor;
+#else
 attribute vec4 a_color;
+#endif
 
 ///////////////////////////////////////////////////////////
 // Uniforms
 uniform mat4 u_projectionMatrix;
+#if defined(INSTANCED)
+uniform vec4 u_frames[FRAME_COUNT];
+#endif
 
 ///////////////////////////////////////////////////////////
 // Varyings
+#if defined(TEXTURE_ARRAY)
+varying vec3 v_texCoord;
+#else
 varying vec2 v_texCoord;
+#endif
 varying vec4 v_color;
 
 
 void main()
 {
+    #if defined(INSTANCED)
+    // The corner of the quad is scaled and rotated around the anchor of the sprite, and the
+    // texture coordinates are taken from the frame of the instance.
+    vec2 corner = a_position.xy * a_instanceScale.xy;
+    float c = cos(a_instancePosition.w);
+    float s = sin(a_instancePosition.w);
+    vec2 offset = vec2(corner.x * c - corner.y * s, corner.x * s + corner.y * c);
+    gl_Position = u_projectionMatrix * vec4(a_instancePosition.xy + offset, a_instancePosition.z, 1);
+    vec4 frame = u_frames[int(a_instanceScale.z)];
+    v_texCoord = frame.xy + a_texCoord * frame.zw;
+    v_color = a_instanceColor;
+    #else
     gl_Position = u_projectionMatrix * vec4(a_position, 1);
     v_texCoord = a_texCoord;
     v_color = a_color;
+    #endif
 }
@@ -1,3 +1,7 @@
+#if defined(TEXTURE_ARRAY)
+#extension GL_EXT_texture_array : enable
+#endif
+
 #ifdef OPENGL_ES
 #ifdef GL_FRAGMENT_PRECISION_HIGH
 precision highp float;
@@ -18,6 +22,10 @@ precision mediump float;
 #if (DIRECTIONAL_LIGHT_COUNT > 0) || (POINT_LIGHT_COUNT > 0) || (SPOT_LIGHT_COUNT > 0)
 #define LIGHTING
 #endif
+// The layers of a patch are composited into a texture without lighting
+#if defined(COMPOSITE)
+#undef LIGHTING
+#endif
 
 ///////////////////////////////////////////////////////////
 // Uniforms
@@ -56,7 +64,14 @@ uniform float u_row;
 uniform float u_column;
 #endif
 
-#if (LAYER_COUNT > 0)
+#if defined(COMPOSITED)
+uniform sampler2D u_compositeMap;
+uniform vec4 u_compositeRect;
+#endif
+#if defined(TEXTURE_ARRAY)
+uniform sampler2DArray u_surfaceLayerArray;
+#endif
+#if (LAYER_COUNT > 0) && (SAMPLER_COUNT > 0)
 uniform sampler2D u_surfaceLayerMaps[SAMPLER_COUNT];
 #endif
 
@@ -98,10 +113,16 @@ varying vec2 v_texCoordLayer1;
 #if (LAYER_COUNT > 2)
 varying vec2 v_texCoordLayer2;
 #endif
+// With a texture array, the texture index of a layer is its layer in the array
+#if defined(TEXTURE_ARRAY)
+#define sampleLayer(index, texCoord) texture2DArray(u_surfaceLayerArray, vec3(mod(texCoord, vec2(1,1)), float(index)))
+#else
+#define sampleLayer(index, texCoord) texture2D(u_surfaceLayerMaps[index], mod(texCoord, vec2(1,1)))
+#endif
+
 #if (LAYER_COUNT > 1)
-void blendLayer(sampler2D textureMap, vec2 texCoord, float alphaBlend)
+void blendLayer(vec3 diffuse, float alphaBlend)
 {
-    vec3 diffuse = texture2D(textureMap,  mod(texCoord, vec2(1,1))).rgb;
     _baseColor.rgb = _baseColor.rgb * (1.0 - alphaBlend) + diffuse * alphaBlend;
 }
 #endif
@@ -113,9 +134,13 @@ void blendLayer(sampler2D textureMap, vec2 texCoord, float alphaBlend)
 
 void main()
 {
-    #if (LAYER_COUNT > 0)
+    #if defined(COMPOSITED)
+    // Sample the texture that the layers of the patch were composited into
+    _baseColor.rgb = texture2D(u_compositeMap, (v_texCoord0 - u_compositeRect.xy) / u_compositeRect.zw).rgb;
+    _baseColor.a = 1.0;
+    #elif (LAYER_COUNT > 0)
     // Sample base texture
-	_baseColor.rgb = texture2D(u_surfaceLayerMaps[TEXTURE_INDEX_0], mod(v_texCoordLayer0, vec2(1,1))).rgb;
+	_baseColor.rgb = sampleLayer(TEXTURE_INDEX_0, v_texCoordLayer0).rgb;
     _baseColor.a = 1.0;
     #else
     // If no layers are defined, simply use a white color
@@ -123,10 +148,10 @@ void main()
     #endif
 
     #if (LAYER_COUNT > 1)
-    blendLayer(u_surfaceLayerMaps[TEXTURE_INDEX_1], v_texCoordLayer1, texture2D(u_surfaceLayerMaps[BLEND_INDEX_1], v_texCoord0)[BLEND_CHANNEL_1]);
+    blendLayer(sampleLayer(TEXTURE_INDEX_1, v_texCoordLayer1).rgb, texture2D(u_surfaceLayerMaps[BLEND_INDEX_1], v_texCoord0)[BLEND_CHANNEL_1]);
     #endif
     #if (LAYER_COUNT > 2)
-    blendLayer(u_surfaceLayerMaps[TEXTURE_INDEX_2], v_texCoordLayer2, texture2D(u_surfaceLayerMaps[BLEND_INDEX_2], v_texCoord0)[BLEND_CHANNEL_2]);
+    blendLayer(sampleLayer(TEXTURE_INDEX_2, v_texCoordLayer2).rgb, texture2D(u_surfaceLayerMaps[BLEND_INDEX_2], v_texCoord0)[BLEND_CHANNEL_2]);
     #endif
 
     #if defined(DEBUG_PATCHES)
@@ -10,6 +10,10 @@
 #if (DIRECTIONAL_LIGHT_COUNT > 0) || (POINT_LIGHT_COUNT > 0) || (SPOT_LIGHT_COUNT > 0)
 #define LIGHTING
 #endif
+// The layers of a patch are composited into a texture without lighting
+#if defined(COMPOSITE)
+#undef LIGHTING
+#endif
 
 ///////////////////////////////////////////////////////////
 // Attributes
@@ -18,6 +22,9 @@ attribute vec4 a_position;
 attribute vec3 a_normal;
 #endif
 attribute vec2 a_texCoord0;
+#if defined(GEOMORPHING)
+attribute vec2 a_texCoord1;
+#endif
 
 ///////////////////////////////////////////////////////////
 // Uniforms
@@ -25,6 +32,15 @@ uniform mat4 u_worldViewProjectionMatrix;
 #if !defined(NORMAL_MAP) && defined(LIGHTING)
 uniform mat4 u_normalMatrix;
 #endif
+#if defined(COMPOSITE)
+uniform vec4 u_compositeRect;
+#endif
+#if defined(GEOMORPHING)
+uniform mat4 u_worldMatrix;
+uniform vec3 u_cameraPosition;
+uniform float u_level;
+uniform vec2 u_morphRange;
+#endif
 
 #if defined(LIGHTING)
 
@@ -85,8 +101,26 @@ varying vec2 v_texCoordLayer2;
 
 void main()
 {
+    #if defined(COMPOSITE)
+
+    // Cover the composited texture with the texture coordinates of the patch.
+    gl_Position = vec4(a_position.xy, 0.0, 1.0);
+    vec2 texCoord = u_compositeRect.xy + (a_position.xy * 0.5 + 0.5) * u_compositeRect.zw;
+
+    #else
+
+    vec4 position = a_position;
+
+    #if defined(GEOMORPHING)
+    // Move the vertices that the next level drops toward its surface as they approach the distance of that level.
+    // a_texCoord1 holds the height offset to that surface and the level that the vertex is dropped after.
+    float distance = length((u_worldMatrix * a_position).xyz - u_cameraPosition);
+    float morph = clamp((distance - u_morphRange.x) * u_morphRange.y, 0.0, 1.0);
+    position.y += a_texCoord1.x * morph * step(abs(a_texCoord1.y - u_level), 0.5);
+    #endif
+
     // Transform position to clip space.
-    gl_Position = u_worldViewProjectionMatrix * a_position;
+    gl_Position = u_worldViewProjectionMatrix * position;
 
     #if defined(LIGHTING)
 
@@ -94,21 +128,25 @@ void main()
     v_normalVector = normalize((u_normalMatrix * vec4(a_normal.x, a_normal.y, a_normal.z, 0)).xyz);
     #endif
 
-    applyLight(a_position);
+    applyLight(position);
+
+    #endif
+
+    vec2 texCoord = a_texCoord0;
 
     #endif
 
     // Pass base texture coord
-    v_texCoord0 = a_texCoord0;
+    v_texCoord0 = texCoord;
 
     // Pass repeated texture coordinates for each layer
     #if LAYER_COUNT > 0
-    v_texCoordLayer0 = a_texCoord0 * TEXTURE_REPEAT_0;
+    v_texCoordLayer0 = texCoord * TEXTURE_REPEAT_0;
     #endif
     #if LAYER_COUNT > 1
-    v_texCoordLayer1 = a_texCoord0 * TEXTURE_REPEAT_1;
+    v_texCoordLayer1 = texCoord * TEXTURE_REPEAT_1;
     #endif
     #if LAYER_COUNT > 2
-    v_texCoordLayer2 = a_texCoord0 * TEXTURE_REPEAT_2;
+    v_texCoordLayer2 = texCoord * TEXTURE_REPEAT_2;
     #endif
 }
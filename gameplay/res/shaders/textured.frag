@@ -15,9 +15,15 @@ precision mediump float;
 #ifndef POINT_LIGHT_COUNT
 #define POINT_LIGHT_COUNT 0
 #endif
-#if (DIRECTIONAL_LIGHT_COUNT > 0) || (POINT_LIGHT_COUNT > 0) || (SPOT_LIGHT_COUNT > 0)
+#if (DIRECTIONAL_LIGHT_COUNT > 0) || (POINT_LIGHT_COUNT > 0) || (SPOT_LIGHT_COUNT > 0) || defined(CLUSTERED_LIGHTING)
 #define LIGHTING
 #endif
+#if defined(LIGHTING) && (defined(DIRECTIONAL_LIGHT_SHADOWS) || defined(SPOT_LIGHT_SHADOWS) || defined(POINT_LIGHT_SHADOWS))
+#define SHADOWS
+#endif
+#if defined(DIRECTIONAL_LIGHT_SHADOWS) && !defined(SHADOW_CASCADE_COUNT)
+#define SHADOW_CASCADE_COUNT 4
+#endif
 
 ///////////////////////////////////////////////////////////
 // Uniforms
@@ -58,6 +64,30 @@ uniform vec3 u_spotLightDirection[SPOT_LIGHT_COUNT];
 #endif
 #endif
 
+#if defined(CLUSTERED_LIGHTING)
+uniform sampler2D u_clusterTexture;
+uniform sampler2D u_clusterIndexTexture;
+uniform sampler2D u_clusterLightTexture;
+uniform vec4 u_clusterGrid;
+uniform vec4 u_clusterDepth;
+uniform vec4 u_clusterViewport;
+#endif
+
+#if defined(SHADOWS)
+uniform sampler2D u_shadowTexture;
+uniform vec4 u_shadowParameters;
+#if defined(DIRECTIONAL_LIGHT_SHADOWS)
+uniform mat4 u_shadowCascadeMatrix[SHADOW_CASCADE_COUNT];
+uniform float u_shadowCascadeSplits[SHADOW_CASCADE_COUNT];
+#endif
+#if defined(SPOT_LIGHT_SHADOWS) && (SPOT_LIGHT_COUNT > 0)
+uniform mat4 u_spotLightShadowMatrix[SPOT_LIGHT_COUNT];
+#endif
+#if defined(POINT_LIGHT_SHADOWS) && (POINT_LIGHT_COUNT > 0)
+uniform vec4 u_pointLightShadow[POINT_LIGHT_COUNT * 2];
+#endif
+#endif
+
 #if defined(SPECULAR)
 uniform float u_specularExponent;
 #endif
@@ -86,10 +116,18 @@ varying vec2 v_texCoord1;
 
 #if defined(LIGHTING)
 
-#if !defined(BUMPED)
+#if !defined(BUMPED) || defined(CLUSTERED_LIGHTING)
 varying vec3 v_normalVector;
 #endif
 
+#if defined(CLUSTERED_LIGHTING)
+varying vec3 v_positionViewSpace;
+#if defined(BUMPED)
+varying vec3 v_tangentVector;
+varying vec3 v_binormalVector;
+#endif
+#endif
+
 #if defined(BUMPED) && (DIRECTIONAL_LIGHT_COUNT > 0)
 varying vec3 v_directionalLightDirection[DIRECTIONAL_LIGHT_COUNT];
 #endif
@@ -109,7 +147,16 @@ varying vec3 v_spotLightDirection[SPOT_LIGHT_COUNT];
 varying vec3 v_cameraDirection; 
 #endif
 
+#if defined(SHADOWS)
+varying vec4 v_shadowPosition;
+#include "shadows.frag"
+#endif
+
+#if defined(CLUSTERED_LIGHTING)
+#include "lighting-clustered.frag"
+#else
 #include "lighting.frag"
+#endif
 
 #endif
 
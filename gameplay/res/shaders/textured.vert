@@ -7,17 +7,27 @@
 #ifndef POINT_LIGHT_COUNT
 #define POINT_LIGHT_COUNT 0
 #endif
-#if (DIRECTIONAL_LIGHT_COUNT > 0) || (POINT_LIGHT_COUNT > 0) || (SPOT_LIGHT_COUNT > 0)
+#if (DIRECTIONAL_LIGHT_COUNT > 0) || (POINT_LIGHT_COUNT > 0) || (SPOT_LIGHT_COUNT > 0) || defined(CLUSTERED_LIGHTING)
 #define LIGHTING
 #endif
+#if defined(LIGHTING) && (defined(DIRECTIONAL_LIGHT_SHADOWS) || defined(SPOT_LIGHT_SHADOWS) || defined(POINT_LIGHT_SHADOWS))
+#define SHADOWS
+#endif
 
 ///////////////////////////////////////////////////////////
 // Atributes
 attribute vec4 a_position;
 
+#if defined(INSTANCED)
+attribute mat4 a_instanceMatrix;
+#endif
+
 #if defined(SKINNING)
 attribute vec4 a_blendWeights;
 attribute vec4 a_blendIndices;
+#if defined(SKINNING_TEXTURE)
+attribute float a_instancePalette;
+#endif
 #endif
 
 attribute vec2 a_texCoord;
@@ -40,13 +50,20 @@ attribute vec3 a_binormal;
 // Uniforms
 uniform mat4 u_worldViewProjectionMatrix;
 #if defined(SKINNING)
+#if defined(SKINNING_TEXTURE)
+uniform sampler2D u_matrixPaletteTexture;
+uniform vec2 u_matrixPaletteTextureInverseSize;
+#elif defined(SKINNING_DUAL_QUATERNION)
+uniform vec4 u_dualQuaternionPalette[SKINNING_JOINT_COUNT * 2];
+#else
 uniform vec4 u_matrixPalette[SKINNING_JOINT_COUNT * 3];
 #endif
+#endif
 
 #if defined(LIGHTING)
 uniform mat4 u_inverseTransposeWorldViewMatrix;
 
-#if defined(SPECULAR) || (POINT_LIGHT_COUNT > 0) || (SPOT_LIGHT_COUNT > 0)
+#if defined(SPECULAR) || (POINT_LIGHT_COUNT > 0) || (SPOT_LIGHT_COUNT > 0) || defined(CLUSTERED_LIGHTING) || defined(SHADOWS)
 uniform mat4 u_worldViewMatrix;
 #endif
 
@@ -79,8 +96,11 @@ uniform vec2 u_textureRepeat;
 uniform vec2 u_textureOffset;
 #endif
 
-#if defined(CLIP_PLANE)
+#if defined(CLIP_PLANE) || defined(SHADOWS)
 uniform mat4 u_worldMatrix;
+#endif
+
+#if defined(CLIP_PLANE)
 uniform vec4 u_clipPlane;
 #endif
 
@@ -94,10 +114,18 @@ varying vec2 v_texCoord1;
 
 #if defined(LIGHTING)
 
-#if !defined(BUMPED)
+#if !defined(BUMPED) || defined(CLUSTERED_LIGHTING)
 varying vec3 v_normalVector;
 #endif
 
+#if defined(CLUSTERED_LIGHTING)
+varying vec3 v_positionViewSpace;
+#if defined(BUMPED)
+varying vec3 v_tangentVector;
+varying vec3 v_binormalVector;
+#endif
+#endif
+
 #if defined(BUMPED) && (DIRECTIONAL_LIGHT_COUNT > 0)
 varying vec3 v_directionalLightDirection[DIRECTIONAL_LIGHT_COUNT];
 #endif
@@ -117,10 +145,16 @@ varying vec3 v_spotLightDirection[SPOT_LIGHT_COUNT];
 varying vec3 v_cameraDirection;
 #endif
 
+#if defined(SHADOWS)
+varying vec4 v_shadowPosition;
+#endif
+
 #include "lighting.vert"
 
 #endif
 
+#include "quantization.vert"
+
 #if defined(SKINNING)
 #include "skinning.vert"
 #else
@@ -134,10 +168,18 @@ varying float v_clipDistance;
 void main()
 {
     vec4 position = getPosition();
+    #if defined(INSTANCED)
+    // Transform the vertex into the space of the instanced model's node.
+    position = a_instanceMatrix * position;
+    mat3 instanceMatrix = mat3(a_instanceMatrix[0].xyz, a_instanceMatrix[1].xyz, a_instanceMatrix[2].xyz);
+    #endif
     gl_Position = u_worldViewProjectionMatrix * position;
 
     #if defined(LIGHTING)
     vec3 normal = getNormal();
+    #if defined(INSTANCED)
+    normal = instanceMatrix * normal;
+    #endif
     // Transform the normal, tangent and binormals to view space.
     mat3 inverseTransposeWorldViewMatrix = mat3(u_inverseTransposeWorldViewMatrix[0].xyz, u_inverseTransposeWorldViewMatrix[1].xyz, u_inverseTransposeWorldViewMatrix[2].xyz);
     vec3 normalVector = normalize(inverseTransposeWorldViewMatrix * normal);
@@ -146,10 +188,21 @@ void main()
     
     vec3 tangent = getTangent();
     vec3 binormal = getBinormal();
+    #if defined(INSTANCED)
+    tangent = instanceMatrix * tangent;
+    binormal = instanceMatrix * binormal;
+    #endif
     vec3 tangentVector  = normalize(inverseTransposeWorldViewMatrix * tangent);
     vec3 binormalVector = normalize(inverseTransposeWorldViewMatrix * binormal);
     mat3 tangentSpaceTransformMatrix = mat3(tangentVector.x, binormalVector.x, normalVector.x, tangentVector.y, binormalVector.y, normalVector.y, tangentVector.z, binormalVector.z, normalVector.z);
     applyLight(position, tangentSpaceTransformMatrix);
+
+    #if defined(CLUSTERED_LIGHTING)
+    // Clustered lights are in view space, so the normal map is transformed to view space instead.
+    v_tangentVector = tangentVector;
+    v_binormalVector = binormalVector;
+    v_normalVector = normalVector;
+    #endif
     
     #else
     
@@ -6,7 +6,8 @@ namespace gameplay
 {
 
 AIAgent::AIAgent()
-    : _stateMachine(NULL), _node(NULL), _enabled(true), _listener(NULL), _next(NULL)
+    : _stateMachine(NULL), _node(NULL), _enabled(true), _listener(NULL), _updateInterval(0.0f), _lastUpdateTime(0.0),
+      _concurrentTime(0.0f), _concurrent(false)
 {
     _stateMachine = new AIStateMachine(this);
 }
@@ -59,6 +60,26 @@ void AIAgent::setListener(Listener* listener)
     _listener = listener;
 }
 
+void AIAgent::setUpdateInterval(float interval)
+{
+    _updateInterval = std::max(0.0f, interval);
+}
+
+float AIAgent::getUpdateInterval() const
+{
+    return _updateInterval;
+}
+
+void AIAgent::setConcurrent(bool concurrent)
+{
+    _concurrent = concurrent;
+}
+
+bool AIAgent::isConcurrent() const
+{
+    return _concurrent;
+}
+
 void AIAgent::update(float elapsedTime)
 {
     _stateMachine->update(elapsedTime);
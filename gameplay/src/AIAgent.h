@@ -118,6 +118,48 @@ public:
      */
     void setListener(Listener* listener);
 
+    /**
+     * Sets the time between the updates of the state machine of this agent.
+     *
+     * Agents that do not need to think every frame can be updated less often, in which case
+     * their states are updated with the time since their last update. The update budget of the
+     * AIController may also delay updates beyond the interval.
+     *
+     * @param interval The time between updates, in milliseconds, or 0 to update every frame.
+     * @script{ignore}
+     */
+    void setUpdateInterval(float interval);
+
+    /**
+     * Returns the time between the updates of the state machine of this agent.
+     *
+     * @return The time between updates, in milliseconds, or 0 if the agent updates every frame.
+     * @script{ignore}
+     */
+    float getUpdateInterval() const;
+
+    /**
+     * Sets whether the states of this agent may be updated on worker threads.
+     *
+     * The state listeners of concurrent agents are called on the worker threads of the job system,
+     * in parallel with those of other concurrent agents, so they may only change their own agent
+     * and its node. The script events of their states are still fired on the main thread, after
+     * the listeners of all concurrent agents have been called. Messages that the listeners send are
+     * held until then as well, and sent in the order of the agents and of the messages.
+     *
+     * @param concurrent true if the states of the agent may be updated on worker threads.
+     * @script{ignore}
+     */
+    void setConcurrent(bool concurrent);
+
+    /**
+     * Determines whether the states of this agent may be updated on worker threads.
+     *
+     * @return true if the agent is concurrent, false otherwise.
+     * @script{ignore}
+     */
+    bool isConcurrent() const;
+
 private:
 
     /**
@@ -165,7 +207,11 @@ private:
     Node* _node;
     bool _enabled;
     Listener* _listener;
-    AIAgent* _next;
+    float _updateInterval;
+    double _lastUpdateTime;
+    float _concurrentTime;
+    bool _concurrent;
+    std::vector<std::pair<AIMessage*, float> > _outbox;
 
 };
 
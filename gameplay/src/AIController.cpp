@@ -2,11 +2,27 @@
 #include "AIController.h"
 #include "Game.h"
 
+// The number of concurrent agents whose listeners are updated by each job
+#define AI_CONCURRENT_BATCH_SIZE 16
+
+// The default number of path requests that are started in each frame
+#define AI_DEFAULT_PATH_BUDGET 32
+
+#ifdef _MSC_VER
+#define AI_THREAD_LOCAL __declspec(thread)
+#else
+#define AI_THREAD_LOCAL __thread
+#endif
+
 namespace gameplay
 {
 
+// The concurrent agent whose listener is being updated on this thread, whose messages are held in its outbox.
+static AI_THREAD_LOCAL AIAgent* __concurrentAgent = NULL;
+
 AIController::AIController()
-    : _paused(false), _firstMessage(NULL), _firstAgent(NULL)
+    : _paused(false), _messageSequence(0), _nextAgent(0), _updateBudget(0.0f), _updating(false), _removedAgents(false),
+      _pathJob(NULL), _pathBudget(AI_DEFAULT_PATH_BUDGET), _pathRequestId(0)
 {
 }
 
@@ -20,25 +36,29 @@ void AIController::initialize()
 
 void AIController::finalize()
 {
+    clearPaths();
+
     // Remove all agents
-    AIAgent* agent = _firstAgent;
-    while (agent)
+    for (size_t i = 0, count = _agents.size(); i < count; ++i)
     {
-        AIAgent* temp = agent;
-        agent = agent->_next;
-        SAFE_RELEASE(temp);
+        AIAgent* agent = _agents[i];
+        if (agent)
+        {
+            for (size_t j = 0, messageCount = agent->_outbox.size(); j < messageCount; ++j)
+                AIMessage::destroy(agent->_outbox[j].first);
+            agent->_outbox.clear();
+            SAFE_RELEASE(agent);
+        }
     }
-    _firstAgent = NULL;
+    _agents.clear();
+    _nextAgent = 0;
 
     // Remove all messages
-    AIMessage* message = _firstMessage;
-    while (message)
-    {
-        AIMessage* temp = message;
-        message = message->_next;
-        AIMessage::destroy(temp);
-    }
-    _firstMessage = NULL;
+    for (size_t i = 0, count = _pendingMessages.size(); i < count; ++i)
+        AIMessage::destroy(_pendingMessages[i].message);
+    _pendingMessages.clear();
+
+    AIMessage::releasePool();
 }
 
 void AIController::pause()
@@ -51,135 +71,358 @@ void AIController::resume()
     _paused = false;
 }
 
+void AIController::setUpdateBudget(float budget)
+{
+    _updateBudget = std::max(0.0f, budget);
+}
+
+float AIController::getUpdateBudget() const
+{
+    return _updateBudget;
+}
+
+bool AIController::PendingMessage::operator<(const PendingMessage& other) const
+{
+    // The heap keeps the message to deliver first at its top: the earliest, and of those the first sent.
+    if (message->_deliveryTime != other.message->_deliveryTime)
+        return message->_deliveryTime > other.message->_deliveryTime;
+    return sequence > other.sequence;
+}
+
 void AIController::sendMessage(AIMessage* message, float delay)
 {
+    GP_ASSERT(message);
+
+    // The messages of concurrent agents are sent once the listeners of all of them have been updated.
+    if (__concurrentAgent)
+    {
+        __concurrentAgent->_outbox.push_back(std::make_pair(message, delay));
+        return;
+    }
+
     if (delay <= 0)
     {
-        // Send instantly
-        if (message->getReceiver() == NULL || strlen(message->getReceiver()) == 0)
-        {
-            // Broadcast message to all agents
-            AIAgent* agent = _firstAgent;
-            while (agent)
-            {
-                if (agent->processMessage(message))
-                    break; // message consumed by this agent - stop bubbling
-                agent = agent->_next;
-            }
-        }
-        else
+        deliverMessage(message);
+    }
+    else
+    {
+        // Queue for later delivery
+        message->_deliveryTime = Game::getGameTime() + delay;
+        PendingMessage pending;
+        pending.message = message;
+        pending.sequence = _messageSequence++;
+        _pendingMessages.push_back(pending);
+        std::push_heap(_pendingMessages.begin(), _pendingMessages.end());
+    }
+}
+
+void AIController::deliverMessage(AIMessage* message)
+{
+    if (message->getReceiver() == NULL || strlen(message->getReceiver()) == 0)
+    {
+        // Broadcast message to all agents, most recently added first
+        for (size_t i = _agents.size(); i > 0; --i)
         {
-            // Single recipient
-            AIAgent* agent = findAgent(message->getReceiver());
-            if (agent)
-            {
-                agent->processMessage(message);
-            }
-            else
-            {
-                GP_WARN("Failed to locate AIAgent for message recipient: %s", message->getReceiver());
-            }
+            AIAgent* agent = _agents[i - 1];
+            if (agent && agent->processMessage(message))
+                break; // message consumed by this agent - stop bubbling
         }
-
-        // Delete the message, since it is finished being processed
-        AIMessage::destroy(message);
     }
     else
     {
-        // Queue for later delivery
-        if (_firstMessage)
-            message->_next = _firstMessage;
-        _firstMessage = message;
+        // Single recipient
+        AIAgent* agent = findAgent(message->getReceiver());
+        if (agent)
+        {
+            agent->processMessage(message);
+        }
+        else
+        {
+            GP_WARN("Failed to locate AIAgent for message recipient: %s", message->getReceiver());
+        }
     }
+
+    // Delete the message, since it is finished being processed
+    AIMessage::destroy(message);
 }
 
 void AIController::update(float elapsedTime)
 {
+    GP_PROFILE_SCOPE("AIController::update");
+
     if (_paused)
         return;
 
-    static Game* game = Game::getInstance();
+    const double gameTime = Game::getGameTime();
+
+    // Send the pending messages whose delivery time has come, in the order they are due.
+    while (!_pendingMessages.empty() && _pendingMessages.front().message->_deliveryTime <= gameTime)
+    {
+        std::pop_heap(_pendingMessages.begin(), _pendingMessages.end());
+        AIMessage* message = _pendingMessages.back().message;
+        _pendingMessages.pop_back();
+        message->_deliveryTime = 0;
+        deliverMessage(message);
+    }
+
+    updatePaths();
 
-    // Send all pending messages that have expired
-    AIMessage* prevMsg = NULL;
-    AIMessage* msg = _firstMessage;
-    while (msg)
+    // Update the agents that are due in turn, starting with the one that the last frame did not reach,
+    // until the budget is used. The concurrent agents are collected to update in parallel afterwards.
+    _updating = true;
+    _concurrentAgents.clear();
+    const double startTime = Game::getAbsoluteTime();
+    const unsigned int count = (unsigned int)_agents.size();
+    unsigned int first = _nextAgent < count ? _nextAgent : 0;
+    bool budgetUsed = false;
+    _nextAgent = first;
+    for (unsigned int i = 0; i < count; ++i)
     {
-        // If the message delivery time has expired, send it (this also deletes it)
-        if (msg->getDeliveryTime() >= game->getGameTime())
+        unsigned int index = (first + i) % count;
+        AIAgent* agent = _agents[index];
+        if (agent == NULL)
+            continue;
+        if (!agent->isEnabled())
         {
-            // Link the message out of our list
-            if (prevMsg)
-                prevMsg->_next = msg->_next;
-
-            AIMessage* temp = msg;
-            msg = msg->_next;
-            temp->_next = NULL;
-            sendMessage(temp);
+            // Halted agents continue with a regular update once they are enabled again.
+            agent->_lastUpdateTime = gameTime;
+            continue;
         }
-        else
+
+        float agentTime = (float)(gameTime - agent->_lastUpdateTime);
+        if (agentTime < agent->_updateInterval)
+            continue;
+
+        if (agent->_concurrent)
         {
-            prevMsg = msg;
-            msg = msg->_next;
+            agent->addRef();
+            agent->_concurrentTime = agentTime;
+            agent->_lastUpdateTime = gameTime;
+            _concurrentAgents.push_back(agent);
+        }
+        else if (!budgetUsed)
+        {
+            agent->_lastUpdateTime = gameTime;
+            agent->update(agentTime);
+            if (_updateBudget > 0.0f && Game::getAbsoluteTime() - startTime >= _updateBudget)
+            {
+                // Continue with the next agent in the next frame.
+                budgetUsed = true;
+                _nextAgent = (index + 1) % count;
+            }
         }
     }
 
-    // Update all enabled agents
-    AIAgent* agent = _firstAgent;
-    while (agent)
+    if (!_concurrentAgents.empty())
     {
-        if (agent->isEnabled())
-            agent->update(elapsedTime);
+        unsigned int concurrentCount = (unsigned int)_concurrentAgents.size();
+        Game::getInstance()->getJobSystem()->parallelFor(concurrentCount, AI_CONCURRENT_BATCH_SIZE,
+            &AIController::updateConcurrentAgents, &_concurrentAgents[0]);
 
-        agent = agent->_next;
+        // Fire the script events of the concurrent agents and send their messages, in the order of the agents.
+        // The agents are referenced until then, since the events and messages may remove them.
+        std::vector<std::pair<AIMessage*, float> > outbox;
+        for (unsigned int i = 0; i < concurrentCount; ++i)
+        {
+            AIAgent* agent = _concurrentAgents[i];
+            outbox.swap(agent->_outbox);
+            if (agent->_node)
+                agent->_stateMachine->fireUpdateEvent(agent->_concurrentTime);
+            for (size_t j = 0, messageCount = outbox.size(); j < messageCount; ++j)
+                sendMessage(outbox[j].first, outbox[j].second);
+            outbox.clear();
+            agent->release();
+        }
+        _concurrentAgents.clear();
     }
+
+    _updating = false;
+    if (_removedAgents)
+        compactAgents();
 }
 
-void AIController::addAgent(AIAgent* agent)
+void AIController::updateConcurrentAgents(void* cookie, unsigned int begin, unsigned int end)
+{
+    AIAgent** agents = (AIAgent**)cookie;
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        AIAgent* agent = agents[i];
+        __concurrentAgent = agent;
+        agent->_stateMachine->updateListener(agent->_concurrentTime);
+    }
+    __concurrentAgent = NULL;
+}
+
+unsigned int AIController::requestPath(AINavMesh* mesh, AIAgent* agent, const Vector3& start, const Vector3& end, unsigned int messageId)
 {
+    GP_ASSERT(mesh);
+    GP_ASSERT(agent);
+
+    PathRequest* request = new PathRequest();
+    request->id = ++_pathRequestId;
+    request->messageId = messageId;
+    request->mesh = mesh;
+    request->agent = agent;
+    request->start = start;
+    request->end = end;
+    request->found = false;
+    mesh->addRef();
     agent->addRef();
+    _pathRequests.push_back(request);
 
-    if (_firstAgent)
-        agent->_next = _firstAgent;
+    return request->id;
+}
 
-    _firstAgent = agent;
+void AIController::setPathBudget(unsigned int budget)
+{
+    _pathBudget = budget;
 }
 
-void AIController::removeAgent(AIAgent* agent)
+unsigned int AIController::getPathBudget() const
 {
-    // Search our linked list of agents and link this agent out.
-    AIAgent* prevAgent = NULL;
-    AIAgent* itr = _firstAgent;
-    while (itr)
+    return _pathBudget;
+}
+
+void AIController::updatePaths()
+{
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    if (_pathJob)
     {
-        if (itr == agent)
-        {
-            if (prevAgent)
-                prevAgent->_next = agent->_next;
-            else
-                _firstAgent = agent->_next;
+        if (!jobSystem->isFinished(_pathJob))
+            return;
+        jobSystem->wait(_pathJob);
+        _pathJob = NULL;
 
-            agent->_next = NULL;
-            agent->release();
-            break;
+        // Send the paths to the requesting agents that are still registered, in the order they were requested.
+        for (size_t i = 0, count = _pathBatch.size(); i < count; ++i)
+        {
+            PathRequest* request = _pathBatch[i];
+            if (std::find(_agents.begin(), _agents.end(), request->agent) != _agents.end())
+            {
+                unsigned int pointCount = (unsigned int)request->path.size();
+                AIMessage* message = AIMessage::create(request->messageId, "", request->agent->getId(), 2 + pointCount * 3);
+                message->setInt(0, (int)request->id);
+                message->setBoolean(1, request->found);
+                for (unsigned int j = 0; j < pointCount; ++j)
+                {
+                    const Vector3& point = request->path[j];
+                    message->setFloat(2 + j * 3, point.x);
+                    message->setFloat(3 + j * 3, point.y);
+                    message->setFloat(4 + j * 3, point.z);
+                }
+                sendMessage(message);
+            }
+            SAFE_RELEASE(request->agent);
+            SAFE_RELEASE(request->mesh);
+            SAFE_DELETE(request);
         }
+        _pathBatch.clear();
+    }
 
-        prevAgent = itr;
-        itr = itr->_next;
+    // Find the paths of the next requests on the job system, while the game continues.
+    if (_pathRequests.empty() || _pathBudget == 0)
+        return;
+    unsigned int count = std::min(_pathBudget, (unsigned int)_pathRequests.size());
+    _pathBatch.assign(_pathRequests.begin(), _pathRequests.begin() + count);
+    _pathRequests.erase(_pathRequests.begin(), _pathRequests.begin() + count);
+    _pathJob = jobSystem->create(&AIController::findPaths, this);
+    jobSystem->run(_pathJob);
+}
+
+void AIController::clearPaths()
+{
+    if (_pathJob)
+    {
+        Game::getInstance()->getJobSystem()->wait(_pathJob);
+        _pathJob = NULL;
     }
+    _pathRequests.insert(_pathRequests.end(), _pathBatch.begin(), _pathBatch.end());
+    _pathBatch.clear();
+    for (size_t i = 0, count = _pathRequests.size(); i < count; ++i)
+    {
+        PathRequest* request = _pathRequests[i];
+        SAFE_RELEASE(request->agent);
+        SAFE_RELEASE(request->mesh);
+        SAFE_DELETE(request);
+    }
+    _pathRequests.clear();
+}
+
+void AIController::findPaths(void* cookie)
+{
+    AIController* controller = (AIController*)cookie;
+    Game::getInstance()->getJobSystem()->parallelFor((unsigned int)controller->_pathBatch.size(), 1,
+        &AIController::findPaths, &controller->_pathBatch[0]);
+}
+
+void AIController::findPaths(void* cookie, unsigned int begin, unsigned int end)
+{
+    PathRequest** requests = (PathRequest**)cookie;
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        PathRequest* request = requests[i];
+        request->found = request->mesh->findPath(request->start, request->end, request->path);
+    }
+}
+
+void AIController::addAgent(AIAgent* agent)
+{
+    agent->addRef();
+    agent->_lastUpdateTime = Game::getGameTime();
+    _agents.push_back(agent);
+}
+
+void AIController::removeAgent(AIAgent* agent)
+{
+    std::vector<AIAgent*>::iterator itr = std::find(_agents.begin(), _agents.end(), agent);
+    if (itr == _agents.end())
+        return;
+
+    for (size_t i = 0, count = agent->_outbox.size(); i < count; ++i)
+        AIMessage::destroy(agent->_outbox[i].first);
+    agent->_outbox.clear();
+
+    // Agents that are removed while the agents are updated are only unlinked afterwards.
+    if (_updating)
+    {
+        *itr = NULL;
+        _removedAgents = true;
+    }
+    else
+    {
+        if ((unsigned int)(itr - _agents.begin()) < _nextAgent)
+            --_nextAgent;
+        _agents.erase(itr);
+    }
+    agent->release();
+}
+
+void AIController::compactAgents()
+{
+    unsigned int next = _nextAgent;
+    unsigned int count = 0;
+    for (unsigned int i = 0, size = (unsigned int)_agents.size(); i < size; ++i)
+    {
+        if (_agents[i])
+            _agents[count++] = _agents[i];
+        else if (i < _nextAgent)
+            --next;
+    }
+    _agents.resize(count);
+    _nextAgent = next;
+    _removedAgents = false;
 }
 
 AIAgent* AIController::findAgent(const char* id) const
 {
     GP_ASSERT(id);
 
-    AIAgent* agent = _firstAgent;
-    while (agent)
+    // Look from the most recently added agent, as broadcasts do.
+    for (size_t i = _agents.size(); i > 0; --i)
     {
-        if (strcmp(id, agent->getId()) == 0)
+        AIAgent* agent = _agents[i - 1];
+        if (agent && strcmp(id, agent->getId()) == 0)
             return agent;
-
-        agent = agent->_next;
     }
 
     return NULL;
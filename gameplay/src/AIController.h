@@ -3,6 +3,8 @@
 
 #include "AIAgent.h"
 #include "AIMessage.h"
+#include "AINavMesh.h"
+#include "JobSystem.h"
 
 namespace gameplay
 {
@@ -43,8 +45,109 @@ public:
      */
     AIAgent* findAgent(const char* id) const;
 
+    /**
+     * Sets the time that the state machines of the agents may be updated for in each frame.
+     *
+     * The agents that are due for an update are updated in turn, starting where the previous
+     * frame stopped, until the budget is used. The agents that are not reached are updated in
+     * a later frame, with the time since their last update. The listeners of concurrent agents
+     * are updated in parallel on the job system, and are not limited by the budget. The budget
+     * can also be set in the ai section of the game.config file:
+     *
+     * @code
+     * ai
+     * {
+     *     updateBudget = 2
+     * }
+     * @endcode
+     *
+     * @param budget The time in milliseconds, or 0 to update every agent that is due each frame.
+     * @script{ignore}
+     */
+    void setUpdateBudget(float budget);
+
+    /**
+     * Returns the time that the state machines of the agents may be updated for in each frame.
+     *
+     * @return The time in milliseconds, or 0 if every agent that is due is updated each frame.
+     * @script{ignore}
+     */
+    float getUpdateBudget() const;
+
+    /**
+     * Requests a path for an agent to be found on a navigation mesh.
+     *
+     * The paths are found on the job system, while the game continues, and each path is sent to
+     * the agent that requested it as a message with the specified message ID, once it is found.
+     * The first parameter of the message is the integer ID of the request, the second a boolean
+     * that is true if a path was found, followed by the float x, y and z coordinates of each
+     * corner of the path, from the start to the end point. Paths that are requested for an agent
+     * that is removed before they are found are discarded.
+     *
+     * @param mesh The navigation mesh to find the path on.
+     * @param agent The agent to send the path to.
+     * @param start The point to start from.
+     * @param end The point to reach.
+     * @param messageId The ID of the message that the path is sent in.
+     *
+     * @return The ID of the request.
+     * @script{ignore}
+     */
+    unsigned int requestPath(AINavMesh* mesh, AIAgent* agent, const Vector3& start, const Vector3& end, unsigned int messageId);
+
+    /**
+     * Sets the largest number of path requests that are started in each frame.
+     *
+     * The requests that are not started are kept for later frames, in the order they were made.
+     * The budget can also be set in the ai section of the game.config file:
+     * @code
+     * ai
+     * {
+     *     pathBudget = 32
+     * }
+     * @endcode
+     *
+     * @param budget The number of path requests.
+     * @script{ignore}
+     */
+    void setPathBudget(unsigned int budget);
+
+    /**
+     * Returns the largest number of path requests that are started in each frame.
+     *
+     * @return The number of path requests.
+     * @script{ignore}
+     */
+    unsigned int getPathBudget() const;
+
 private:
 
+    /**
+     * A path that an agent requested.
+     */
+    struct PathRequest
+    {
+        unsigned int id;
+        unsigned int messageId;
+        AINavMesh* mesh;
+        AIAgent* agent;
+        Vector3 start;
+        Vector3 end;
+        bool found;
+        std::vector<Vector3> path;
+    };
+
+    /**
+     * A message that is waiting for its delivery time.
+     */
+    struct PendingMessage
+    {
+        AIMessage* message;
+        unsigned int sequence;
+
+        bool operator<(const PendingMessage& other) const;
+    };
+
     /**
      * Constructor.
      */
@@ -96,9 +199,46 @@ private:
 
     void removeAgent(AIAgent* agent);
 
+    /**
+     * Delivers a message right away.
+     */
+    void deliverMessage(AIMessage* message);
+
+    /**
+     * Removes the agents that were removed during an update from the list of agents.
+     */
+    void compactAgents();
+
+    static void updateConcurrentAgents(void* cookie, unsigned int begin, unsigned int end);
+
+    /**
+     * Sends the paths that were found to the agents that requested them and starts finding more.
+     */
+    void updatePaths();
+
+    /**
+     * Waits for the paths that are being found and discards all of the requests.
+     */
+    void clearPaths();
+
+    static void findPaths(void* cookie);
+
+    static void findPaths(void* cookie, unsigned int begin, unsigned int end);
+
     bool _paused;
-    AIMessage* _firstMessage;
-    AIAgent* _firstAgent;
+    std::vector<AIAgent*> _agents;
+    std::vector<PendingMessage> _pendingMessages;
+    std::vector<AIAgent*> _concurrentAgents;
+    unsigned int _messageSequence;
+    unsigned int _nextAgent;
+    float _updateBudget;
+    bool _updating;
+    bool _removedAgents;
+    std::vector<PathRequest*> _pathRequests;
+    std::vector<PathRequest*> _pathBatch;
+    JobSystem::Job* _pathJob;
+    unsigned int _pathBudget;
+    unsigned int _pathRequestId;
 
 };
 
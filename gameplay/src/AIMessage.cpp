@@ -1,11 +1,19 @@
 #include "Base.h"
 #include "AIMessage.h"
 
+// The largest number of destroyed messages that are kept to be reused
+#define AI_MESSAGE_POOL_SIZE 256
+
 namespace gameplay
 {
 
+// Destroyed messages, kept with their parameters and strings to be reused by create.
+// Messages are created and destroyed on job threads by concurrent agents, hence the lock.
+static std::vector<AIMessage*> __messagePool;
+static std::mutex __messagePoolMutex;
+
 AIMessage::AIMessage()
-    : _id(0), _deliveryTime(0), _parameters(NULL), _parameterCount(0), _messageType(MESSAGE_TYPE_CUSTOM), _next(NULL)
+    : _id(0), _deliveryTime(0), _parameters(NULL), _parameterCount(0), _parameterCapacity(0), _messageType(MESSAGE_TYPE_CUSTOM)
 {
 }
 
@@ -16,19 +24,60 @@ AIMessage::~AIMessage()
 
 AIMessage* AIMessage::create(unsigned int id, const char* sender, const char* receiver, unsigned int parameterCount)
 {
-    AIMessage* message = new AIMessage();
+    AIMessage* message = NULL;
+    {
+        std::lock_guard<std::mutex> lock(__messagePoolMutex);
+        if (!__messagePool.empty())
+        {
+            message = __messagePool.back();
+            __messagePool.pop_back();
+        }
+    }
+    if (message == NULL)
+        message = new AIMessage();
+
     message->_id = id;
-    message->_sender = sender;
-    message->_receiver = receiver;
+    message->_sender = sender ? sender : "";
+    message->_receiver = receiver ? receiver : "";
+    message->_deliveryTime = 0;
+    message->_messageType = MESSAGE_TYPE_CUSTOM;
     message->_parameterCount = parameterCount;
-    if (parameterCount > 0)
+    if (parameterCount > message->_parameterCapacity)
+    {
+        SAFE_DELETE_ARRAY(message->_parameters);
         message->_parameters = new AIMessage::Parameter[parameterCount];
+        message->_parameterCapacity = parameterCount;
+    }
     return message;
 }
 
 void AIMessage::destroy(AIMessage* message)
 {
-    SAFE_DELETE(message);
+    if (message == NULL)
+        return;
+
+    // Release the strings of the parameters, so that a reused message starts with undefined ones.
+    for (unsigned int i = 0; i < message->_parameterCount; ++i)
+        message->_parameters[i].clear();
+    message->_parameterCount = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(__messagePoolMutex);
+        if (__messagePool.size() < AI_MESSAGE_POOL_SIZE)
+        {
+            __messagePool.push_back(message);
+            return;
+        }
+    }
+    delete message;
+}
+
+void AIMessage::releasePool()
+{
+    std::lock_guard<std::mutex> lock(__messagePoolMutex);
+    for (size_t i = 0, count = __messagePool.size(); i < count; ++i)
+        delete __messagePool[i];
+    __messagePool.clear();
 }
 
 unsigned int AIMessage::getId() const
@@ -267,14 +267,19 @@ private:
 
     void clearParameter(unsigned int index);
 
+    /**
+     * Deletes the destroyed messages that are kept to be reused.
+     */
+    static void releasePool();
+
     unsigned int _id;
     std::string _sender;
     std::string _receiver;
     double _deliveryTime;
     Parameter* _parameters;
     unsigned int _parameterCount;
+    unsigned int _parameterCapacity;
     MessageType _messageType;
-    AIMessage* _next;
 
 };
 
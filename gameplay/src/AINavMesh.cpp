@@ -0,0 +1,564 @@
+#include "Base.h"
+#include "AINavMesh.h"
+#include "MeshGeometry.h"
+
+// The largest number of corridors that are cached, after which the cache starts over
+#define AI_NAVMESH_CORRIDOR_CACHE_SIZE 1024
+
+// The largest number of cells along each side of the grid that triangles are looked up in
+#define AI_NAVMESH_MAX_GRID_SIZE 512
+
+namespace gameplay
+{
+
+struct AINavMesh::Search
+{
+    struct Node
+    {
+        float cost;
+        int parent;
+        unsigned int stamp;
+        bool closed;
+        Vector3 position;
+    };
+
+    Search() : stamp(0) { }
+
+    std::vector<Node> nodes;
+    std::vector<std::pair<float, int> > open;
+    unsigned int stamp;
+};
+
+// Returns twice the signed area of the triangle abc as seen from above, which is positive if c is left of ab.
+static float area2(const Vector3& a, const Vector3& b, const Vector3& c)
+{
+    return (b.x - a.x) * (c.z - a.z) - (b.z - a.z) * (c.x - a.x);
+}
+
+static bool samePoint(const Vector3& a, const Vector3& b)
+{
+    return a.distanceSquared(b) < MATH_EPSILON * MATH_EPSILON;
+}
+
+AINavMesh::AINavMesh()
+    : _cellSize(1.0f), _minX(0.0f), _minZ(0.0f), _columns(0), _rows(0)
+{
+}
+
+AINavMesh::~AINavMesh()
+{
+    for (size_t i = 0, count = _searches.size(); i < count; ++i)
+        SAFE_DELETE(_searches[i]);
+}
+
+AINavMesh* AINavMesh::create(const Vector3* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int triangleCount)
+{
+    if (vertices == NULL || indices == NULL || vertexCount == 0 || triangleCount == 0)
+    {
+        GP_ERROR("Failed to create navigation mesh; it has no triangles.");
+        return NULL;
+    }
+
+    AINavMesh* mesh = new AINavMesh();
+    mesh->_vertices.assign(vertices, vertices + vertexCount);
+    mesh->_triangles.resize(triangleCount);
+    for (unsigned int i = 0; i < triangleCount; ++i)
+    {
+        Triangle& triangle = mesh->_triangles[i];
+        for (unsigned int j = 0; j < 3; ++j)
+        {
+            unsigned int index = indices[i * 3 + j];
+            if (index >= vertexCount)
+            {
+                GP_ERROR("Failed to create navigation mesh; the vertex index '%u' of triangle '%u' is out of range.", index, i);
+                SAFE_DELETE(mesh);
+                return NULL;
+            }
+            triangle.vertices[j] = index;
+            triangle.neighbors[j] = -1;
+        }
+    }
+    mesh->build();
+
+    return mesh;
+}
+
+AINavMesh* AINavMesh::create(const MeshGeometry* geometry, const Matrix& transform)
+{
+    GP_ASSERT(geometry);
+
+    unsigned int vertexCount = geometry->getVertexCount();
+    const float* positions = geometry->getPositions();
+    std::vector<Vector3> vertices(vertexCount);
+    for (unsigned int i = 0; i < vertexCount; ++i)
+    {
+        vertices[i].set(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]);
+        transform.transformPoint(&vertices[i]);
+    }
+
+    std::vector<unsigned int> indices;
+    if (geometry->getPartCount() == 0)
+    {
+        if (geometry->getPrimitiveType() == Mesh::TRIANGLES)
+        {
+            indices.resize(vertexCount - vertexCount % 3);
+            for (unsigned int i = 0; i < indices.size(); ++i)
+                indices[i] = i;
+        }
+    }
+    for (unsigned int i = 0, partCount = geometry->getPartCount(); i < partCount; ++i)
+    {
+        if (geometry->getPartPrimitiveType(i) != Mesh::TRIANGLES)
+        {
+            GP_WARN("Skipping part '%u' of mesh '%s' for the navigation mesh; it is not a list of triangles.", i, geometry->getUrl());
+            continue;
+        }
+        unsigned int indexCount = geometry->getPartIndexCount(i) - geometry->getPartIndexCount(i) % 3;
+        const void* indexData = geometry->getPartIndexData(i);
+        for (unsigned int j = 0; j < indexCount; ++j)
+        {
+            switch (geometry->getPartIndexFormat(i))
+            {
+            case Mesh::INDEX8:
+                indices.push_back(((const unsigned char*)indexData)[j]);
+                break;
+            case Mesh::INDEX16:
+                indices.push_back(((const unsigned short*)indexData)[j]);
+                break;
+            default:
+                indices.push_back(((const unsigned int*)indexData)[j]);
+                break;
+            }
+        }
+    }
+
+    if (vertices.empty() || indices.empty())
+        return create(NULL, 0, NULL, 0);
+    return create(&vertices[0], vertexCount, &indices[0], (unsigned int)indices.size() / 3);
+}
+
+void AINavMesh::build()
+{
+    // Link the triangles that share an edge. Edges shared by more than two triangles are walls.
+    std::unordered_map<unsigned long long, int> edges;
+    for (size_t i = 0, count = _triangles.size(); i < count; ++i)
+    {
+        Triangle& triangle = _triangles[i];
+        for (unsigned int j = 0; j < 3; ++j)
+        {
+            unsigned int a = triangle.vertices[j];
+            unsigned int b = triangle.vertices[(j + 1) % 3];
+            unsigned long long key = ((unsigned long long)std::min(a, b) << 32) | std::max(a, b);
+            std::unordered_map<unsigned long long, int>::iterator itr = edges.find(key);
+            if (itr == edges.end())
+            {
+                edges[key] = (int)(i * 3 + j);
+            }
+            else if (itr->second >= 0)
+            {
+                Triangle& other = _triangles[itr->second / 3];
+                other.neighbors[itr->second % 3] = (int)i;
+                triangle.neighbors[j] = itr->second / 3;
+                itr->second = -1;
+            }
+            else
+            {
+                GP_WARN("Navigation mesh edge (%u, %u) is shared by more than two triangles.", a, b);
+            }
+        }
+    }
+
+    // Sort the triangles into the cells of a grid over the mesh, as seen from above.
+    float minX = _vertices[0].x, maxX = minX;
+    float minZ = _vertices[0].z, maxZ = minZ;
+    for (size_t i = 1, count = _vertices.size(); i < count; ++i)
+    {
+        minX = std::min(minX, _vertices[i].x);
+        maxX = std::max(maxX, _vertices[i].x);
+        minZ = std::min(minZ, _vertices[i].z);
+        maxZ = std::max(maxZ, _vertices[i].z);
+    }
+    float width = maxX - minX;
+    float depth = maxZ - minZ;
+    _cellSize = 2.0f * sqrt(std::max(width * depth, MATH_EPSILON) / _triangles.size());
+    _cellSize = std::max(_cellSize, std::max(width, depth) / AI_NAVMESH_MAX_GRID_SIZE);
+    _cellSize = std::max(_cellSize, MATH_EPSILON);
+    _minX = minX;
+    _minZ = minZ;
+    _columns = std::min((unsigned int)(width / _cellSize) + 1, (unsigned int)AI_NAVMESH_MAX_GRID_SIZE);
+    _rows = std::min((unsigned int)(depth / _cellSize) + 1, (unsigned int)AI_NAVMESH_MAX_GRID_SIZE);
+
+    std::vector<unsigned int> bounds(_triangles.size() * 4);
+    _cellStarts.assign(_columns * _rows + 1, 0);
+    for (size_t i = 0, count = _triangles.size(); i < count; ++i)
+    {
+        const Triangle& triangle = _triangles[i];
+        const Vector3& a = _vertices[triangle.vertices[0]];
+        const Vector3& b = _vertices[triangle.vertices[1]];
+        const Vector3& c = _vertices[triangle.vertices[2]];
+        unsigned int* cells = &bounds[i * 4];
+        cells[0] = std::min((unsigned int)((std::min(a.x, std::min(b.x, c.x)) - _minX) / _cellSize), _columns - 1);
+        cells[1] = std::min((unsigned int)((std::min(a.z, std::min(b.z, c.z)) - _minZ) / _cellSize), _rows - 1);
+        cells[2] = std::min((unsigned int)((std::max(a.x, std::max(b.x, c.x)) - _minX) / _cellSize), _columns - 1);
+        cells[3] = std::min((unsigned int)((std::max(a.z, std::max(b.z, c.z)) - _minZ) / _cellSize), _rows - 1);
+        for (unsigned int z = cells[1]; z <= cells[3]; ++z)
+            for (unsigned int x = cells[0]; x <= cells[2]; ++x)
+                ++_cellStarts[z * _columns + x + 1];
+    }
+    for (size_t i = 1, count = _cellStarts.size(); i < count; ++i)
+        _cellStarts[i] += _cellStarts[i - 1];
+
+    std::vector<unsigned int> fill(_cellStarts.begin(), _cellStarts.end() - 1);
+    _cellTriangles.resize(_cellStarts.back());
+    for (size_t i = 0, count = _triangles.size(); i < count; ++i)
+    {
+        const unsigned int* cells = &bounds[i * 4];
+        for (unsigned int z = cells[1]; z <= cells[3]; ++z)
+            for (unsigned int x = cells[0]; x <= cells[2]; ++x)
+                _cellTriangles[fill[z * _columns + x]++] = (int)i;
+    }
+}
+
+unsigned int AINavMesh::getVertexCount() const
+{
+    return (unsigned int)_vertices.size();
+}
+
+unsigned int AINavMesh::getTriangleCount() const
+{
+    return (unsigned int)_triangles.size();
+}
+
+Vector3 AINavMesh::getNearestPoint(int triangle, const Vector3& point, bool* inside) const
+{
+    const Triangle& t = _triangles[triangle];
+    const Vector3& a = _vertices[t.vertices[0]];
+    const Vector3& b = _vertices[t.vertices[1]];
+    const Vector3& c = _vertices[t.vertices[2]];
+
+    // Points above the triangle lie on it at the height of the triangle.
+    float area = area2(a, b, c);
+    if (fabs(area) > MATH_EPSILON)
+    {
+        float u = area2(b, c, point) / area;
+        float v = area2(c, a, point) / area;
+        float w = 1.0f - u - v;
+        if (u >= 0.0f && v >= 0.0f && w >= 0.0f)
+        {
+            *inside = true;
+            return Vector3(point.x, a.y * u + b.y * v + c.y * w, point.z);
+        }
+    }
+
+    // Other points are nearest to a point on one of the edges.
+    *inside = false;
+    Vector3 nearest;
+    float nearestDistance = std::numeric_limits<float>::max();
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        const Vector3& p = _vertices[t.vertices[i]];
+        const Vector3& q = _vertices[t.vertices[(i + 1) % 3]];
+        float dx = q.x - p.x;
+        float dz = q.z - p.z;
+        float length = dx * dx + dz * dz;
+        float s = length > 0.0f ? MATH_CLAMP(((point.x - p.x) * dx + (point.z - p.z) * dz) / length, 0.0f, 1.0f) : 0.0f;
+        Vector3 edgePoint(p.x + (q.x - p.x) * s, p.y + (q.y - p.y) * s, p.z + (q.z - p.z) * s);
+        float distance = (edgePoint.x - point.x) * (edgePoint.x - point.x) + (edgePoint.z - point.z) * (edgePoint.z - point.z);
+        if (distance < nearestDistance)
+        {
+            nearestDistance = distance;
+            nearest = edgePoint;
+        }
+    }
+    return nearest;
+}
+
+int AINavMesh::findTriangle(const Vector3& point, Vector3* nearest) const
+{
+    // Of the triangles that the point is above or below, take the one nearest in height.
+    int found = -1;
+    float foundDistance = std::numeric_limits<float>::max();
+    float x = (point.x - _minX) / _cellSize;
+    float z = (point.z - _minZ) / _cellSize;
+    if (x >= 0.0f && z >= 0.0f && x < _columns && z < _rows)
+    {
+        unsigned int cell = (unsigned int)z * _columns + (unsigned int)x;
+        for (unsigned int i = _cellStarts[cell], end = _cellStarts[cell + 1]; i < end; ++i)
+        {
+            bool inside;
+            Vector3 p = getNearestPoint(_cellTriangles[i], point, &inside);
+            float distance = fabs(p.y - point.y);
+            if (inside && distance < foundDistance)
+            {
+                found = _cellTriangles[i];
+                foundDistance = distance;
+                *nearest = p;
+            }
+        }
+    }
+    if (found >= 0)
+        return found;
+
+    // Points off the mesh are moved to the nearest edge.
+    for (size_t i = 0, count = _triangles.size(); i < count; ++i)
+    {
+        bool inside;
+        Vector3 p = getNearestPoint((int)i, point, &inside);
+        float distance = p.distanceSquared(point);
+        if (distance < foundDistance)
+        {
+            found = (int)i;
+            foundDistance = distance;
+            *nearest = p;
+        }
+    }
+    return found;
+}
+
+bool AINavMesh::findNearestPoint(const Vector3& point, Vector3* nearest) const
+{
+    GP_ASSERT(nearest);
+
+    if (_triangles.empty())
+        return false;
+    findTriangle(point, nearest);
+    return true;
+}
+
+bool AINavMesh::findPath(const Vector3& start, const Vector3& end, std::vector<Vector3>& path) const
+{
+    path.clear();
+    if (_triangles.empty())
+        return false;
+
+    Vector3 startPoint, endPoint;
+    int startTriangle = findTriangle(start, &startPoint);
+    int endTriangle = findTriangle(end, &endPoint);
+
+    std::vector<int> corridor;
+    if (startTriangle == endTriangle)
+    {
+        corridor.push_back(startTriangle);
+    }
+    else
+    {
+        // Corridors are cached by the triangles they join, unreachable ones as empty corridors.
+        unsigned long long key = ((unsigned long long)startTriangle << 32) | (unsigned int)endTriangle;
+        bool cached = false;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::unordered_map<unsigned long long, std::vector<int> >::const_iterator itr = _corridors.find(key);
+            if (itr != _corridors.end())
+            {
+                corridor = itr->second;
+                cached = true;
+            }
+        }
+        if (!cached)
+        {
+            findCorridor(startTriangle, startPoint, endTriangle, endPoint, corridor);
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_corridors.size() >= AI_NAVMESH_CORRIDOR_CACHE_SIZE)
+                _corridors.clear();
+            _corridors[key] = corridor;
+        }
+        if (corridor.empty())
+            return false;
+    }
+
+    findCorners(corridor, startPoint, endPoint, path);
+    return true;
+}
+
+bool AINavMesh::findCorridor(int startTriangle, const Vector3& start, int endTriangle, const Vector3& end, std::vector<int>& corridor) const
+{
+    Search* search = acquireSearch();
+    std::vector<Search::Node>& nodes = search->nodes;
+    std::vector<std::pair<float, int> >& open = search->open;
+    if (nodes.size() != _triangles.size())
+    {
+        nodes.resize(_triangles.size());
+        for (size_t i = 0, count = nodes.size(); i < count; ++i)
+            nodes[i].stamp = 0;
+        search->stamp = 0;
+    }
+    const unsigned int stamp = ++search->stamp;
+    open.clear();
+
+    // A* search from triangle to triangle, through the middle of the edges that join them.
+    Search::Node& first = nodes[startTriangle];
+    first.cost = 0.0f;
+    first.parent = -1;
+    first.stamp = stamp;
+    first.closed = false;
+    first.position = start;
+    open.push_back(std::make_pair(start.distance(end), startTriangle));
+
+    bool found = false;
+    while (!open.empty())
+    {
+        std::pop_heap(open.begin(), open.end(), std::greater<std::pair<float, int> >());
+        int current = open.back().second;
+        open.pop_back();
+
+        Search::Node& node = nodes[current];
+        if (node.closed)
+            continue;
+        node.closed = true;
+        if (current == endTriangle)
+        {
+            found = true;
+            break;
+        }
+
+        const Triangle& triangle = _triangles[current];
+        for (unsigned int i = 0; i < 3; ++i)
+        {
+            int neighbor = triangle.neighbors[i];
+            if (neighbor < 0)
+                continue;
+            Search::Node& next = nodes[neighbor];
+            if (next.stamp == stamp && next.closed)
+                continue;
+
+            Vector3 position = (_vertices[triangle.vertices[i]] + _vertices[triangle.vertices[(i + 1) % 3]]) * 0.5f;
+            float cost = node.cost + node.position.distance(position);
+            if (neighbor == endTriangle)
+                cost += position.distance(end);
+            if (next.stamp != stamp || cost < next.cost)
+            {
+                next.cost = cost;
+                next.parent = current;
+                next.stamp = stamp;
+                next.closed = false;
+                next.position = position;
+                float estimate = neighbor == endTriangle ? cost : cost + position.distance(end);
+                open.push_back(std::make_pair(estimate, neighbor));
+                std::push_heap(open.begin(), open.end(), std::greater<std::pair<float, int> >());
+            }
+        }
+    }
+
+    corridor.clear();
+    if (found)
+    {
+        for (int i = endTriangle; i >= 0; i = nodes[i].parent)
+            corridor.push_back(i);
+        std::reverse(corridor.begin(), corridor.end());
+    }
+    releaseSearch(search);
+
+    return found;
+}
+
+void AINavMesh::findCorners(const std::vector<int>& corridor, const Vector3& start, const Vector3& end, std::vector<Vector3>& path) const
+{
+    // The edges that the corridor crosses, with the left and right end as seen when walking through them.
+    std::vector<std::pair<Vector3, Vector3> > portals;
+    portals.reserve(corridor.size() + 1);
+    portals.push_back(std::make_pair(start, start));
+    for (size_t i = 1, count = corridor.size(); i < count; ++i)
+    {
+        const Triangle& triangle = _triangles[corridor[i - 1]];
+        for (unsigned int j = 0; j < 3; ++j)
+        {
+            if (triangle.neighbors[j] != corridor[i])
+                continue;
+            const Vector3& a = _vertices[triangle.vertices[0]];
+            const Vector3& b = _vertices[triangle.vertices[1]];
+            const Vector3& c = _vertices[triangle.vertices[2]];
+            const Vector3& p = _vertices[triangle.vertices[j]];
+            const Vector3& q = _vertices[triangle.vertices[(j + 1) % 3]];
+            Vector3 center = (a + b + c) * (1.0f / 3.0f);
+            if (area2(center, (p + q) * 0.5f, p) > 0.0f)
+                portals.push_back(std::make_pair(p, q));
+            else
+                portals.push_back(std::make_pair(q, p));
+            break;
+        }
+    }
+    portals.push_back(std::make_pair(end, end));
+
+    // Pull the path tight through the portals: the funnel from the last corner narrows with each portal,
+    // and a side of the funnel that crosses over the other side becomes the next corner.
+    path.push_back(start);
+    Vector3 apex = start;
+    Vector3 left = start;
+    Vector3 right = start;
+    unsigned int apexIndex = 0, leftIndex = 0, rightIndex = 0;
+    for (unsigned int i = 1, count = (unsigned int)portals.size(); i < count; ++i)
+    {
+        const Vector3& portalLeft = portals[i].first;
+        const Vector3& portalRight = portals[i].second;
+
+        if (area2(apex, right, portalRight) >= 0.0f)
+        {
+            if (samePoint(apex, right) || area2(apex, left, portalRight) < 0.0f)
+            {
+                right = portalRight;
+                rightIndex = i;
+            }
+            else
+            {
+                if (!samePoint(path.back(), left))
+                    path.push_back(left);
+                apex = left;
+                apexIndex = leftIndex;
+                right = apex;
+                rightIndex = apexIndex;
+                i = apexIndex;
+                continue;
+            }
+        }
+
+        if (area2(apex, left, portalLeft) <= 0.0f)
+        {
+            if (samePoint(apex, left) || area2(apex, right, portalLeft) > 0.0f)
+            {
+                left = portalLeft;
+                leftIndex = i;
+            }
+            else
+            {
+                if (!samePoint(path.back(), right))
+                    path.push_back(right);
+                apex = right;
+                apexIndex = rightIndex;
+                left = apex;
+                leftIndex = apexIndex;
+                i = apexIndex;
+                continue;
+            }
+        }
+    }
+    if (!samePoint(path.back(), end))
+        path.push_back(end);
+}
+
+void AINavMesh::clearCache()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _corridors.clear();
+}
+
+AINavMesh::Search* AINavMesh::acquireSearch() const
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_searches.empty())
+        {
+            Search* search = _searches.back();
+            _searches.pop_back();
+            return search;
+        }
+    }
+    return new Search();
+}
+
+void AINavMesh::releaseSearch(Search* search) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _searches.push_back(search);
+}
+
+}
@@ -0,0 +1,178 @@
+#ifndef AINAVMESH_H_
+#define AINAVMESH_H_
+
+#include "Ref.h"
+#include "Vector3.h"
+#include "Matrix.h"
+
+namespace gameplay
+{
+
+class MeshGeometry;
+
+/**
+ * Defines a navigation mesh, the walkable surface of a scene that AI agents find their paths on.
+ *
+ * A navigation mesh is made of triangles that share their vertices where they join. The paths
+ * are searched across the triangles, and are then pulled tight around the corners of the
+ * walkable surface, as seen from above (the Y axis is up).
+ *
+ * Paths are usually found by requesting them from the AIController, which searches them on the
+ * job system and sends the results to the agents that requested them. The corridors of triangles
+ * that paths run through are cached, so crowds of agents that move between the same areas only
+ * search them once.
+ *
+ * @script{ignore}
+ */
+class AINavMesh : public Ref
+{
+public:
+
+    /**
+     * Creates a navigation mesh from a list of triangles.
+     *
+     * @param vertices The positions of the vertices.
+     * @param vertexCount The number of vertices.
+     * @param indices The vertex indices of the triangles, three for each triangle.
+     * @param triangleCount The number of triangles.
+     *
+     * @return The new navigation mesh, or NULL if the triangles are invalid.
+     */
+    static AINavMesh* create(const Vector3* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int triangleCount);
+
+    /**
+     * Creates a navigation mesh from the triangles of the geometry of a mesh (see MeshGeometry::get).
+     *
+     * The parts of the geometry that are not made of triangle lists are skipped.
+     *
+     * @param geometry The geometry of the mesh.
+     * @param transform The transform from the space of the mesh to the space of the navigation mesh.
+     *
+     * @return The new navigation mesh, or NULL if the geometry has no triangles.
+     */
+    static AINavMesh* create(const MeshGeometry* geometry, const Matrix& transform = Matrix::identity());
+
+    /**
+     * Returns the number of vertices of this navigation mesh.
+     *
+     * @return The number of vertices.
+     */
+    unsigned int getVertexCount() const;
+
+    /**
+     * Returns the number of triangles of this navigation mesh.
+     *
+     * @return The number of triangles.
+     */
+    unsigned int getTriangleCount() const;
+
+    /**
+     * Finds the point on this navigation mesh that is nearest to a point.
+     *
+     * @param point The point.
+     * @param nearest Populated with the nearest point on the mesh.
+     *
+     * @return true if the mesh has a walkable triangle, false otherwise.
+     */
+    bool findNearestPoint(const Vector3& point, Vector3* nearest) const;
+
+    /**
+     * Finds the shortest path between two points on this navigation mesh.
+     *
+     * The points are moved onto the mesh first. This method may be called from any thread.
+     *
+     * @param start The point to start from.
+     * @param end The point to reach.
+     * @param path Populated with the corners of the path, from the start to the end point.
+     *
+     * @return true if a path was found, false if the end point cannot be reached.
+     */
+    bool findPath(const Vector3& start, const Vector3& end, std::vector<Vector3>& path) const;
+
+    /**
+     * Discards the cached corridors of the paths that were found.
+     */
+    void clearCache();
+
+private:
+
+    /**
+     * A triangle of the mesh, and the triangles across its edges.
+     */
+    struct Triangle
+    {
+        unsigned int vertices[3];
+        int neighbors[3];
+    };
+
+    /**
+     * The state of a path search, which is reused by later searches.
+     */
+    struct Search;
+
+    /**
+     * Constructor.
+     */
+    AINavMesh();
+
+    /**
+     * Destructor.
+     */
+    ~AINavMesh();
+
+    /**
+     * Hidden copy constructor.
+     */
+    AINavMesh(const AINavMesh& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    AINavMesh& operator=(const AINavMesh&);
+
+    /**
+     * Links the triangles that share edges and sorts them into the cells of the grid.
+     */
+    void build();
+
+    /**
+     * Returns the triangle under or nearest to a point, and the nearest point on it.
+     */
+    int findTriangle(const Vector3& point, Vector3* nearest) const;
+
+    /**
+     * Returns the point of a triangle that is nearest to a point, as seen from above.
+     */
+    Vector3 getNearestPoint(int triangle, const Vector3& point, bool* inside) const;
+
+    /**
+     * Searches the corridor of triangles from one triangle to another.
+     */
+    bool findCorridor(int startTriangle, const Vector3& start, int endTriangle, const Vector3& end, std::vector<int>& corridor) const;
+
+    /**
+     * Pulls the path through a corridor tight around its corners.
+     */
+    void findCorners(const std::vector<int>& corridor, const Vector3& start, const Vector3& end, std::vector<Vector3>& path) const;
+
+    Search* acquireSearch() const;
+
+    void releaseSearch(Search* search) const;
+
+    std::vector<Vector3> _vertices;
+    std::vector<Triangle> _triangles;
+    float _cellSize;
+    float _minX;
+    float _minZ;
+    unsigned int _columns;
+    unsigned int _rows;
+    std::vector<unsigned int> _cellStarts;
+    std::vector<int> _cellTriangles;
+    mutable std::mutex _mutex;
+    mutable std::vector<Search*> _searches;
+    mutable std::unordered_map<unsigned long long, std::vector<int> > _corridors;
+};
+
+}
+
+#endif
@@ -54,10 +54,19 @@ void AIState::exit(AIStateMachine* stateMachine)
 }
 
 void AIState::update(AIStateMachine* stateMachine, float elapsedTime)
+{
+    updateListener(stateMachine, elapsedTime);
+    fireUpdateEvent(stateMachine, elapsedTime);
+}
+
+void AIState::updateListener(AIStateMachine* stateMachine, float elapsedTime)
 {
     if (_listener)
         _listener->stateUpdate(stateMachine->getAgent(), this, elapsedTime);
+}
 
+void AIState::fireUpdateEvent(AIStateMachine* stateMachine, float elapsedTime)
+{
     Node* node = stateMachine->_agent->_node;
     if (node)
         node->fireScriptEvent<void>(GP_GET_SCRIPT_EVENT(Node, stateUpdate), dynamic_cast<void*>(node), this, elapsedTime);
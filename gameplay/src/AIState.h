@@ -123,6 +123,16 @@ private:
      */
     void update(AIStateMachine* stateMachine, float elapsedTime);
 
+    /**
+     * Calls the listener of this state to update it, which may be done on a worker thread.
+     */
+    void updateListener(AIStateMachine* stateMachine, float elapsedTime);
+
+    /**
+     * Fires the script event that updates this state.
+     */
+    void fireUpdateEvent(AIStateMachine* stateMachine, float elapsedTime);
+
     std::string _id;
     Listener* _listener;
 
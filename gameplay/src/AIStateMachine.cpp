@@ -140,4 +140,14 @@ void AIStateMachine::update(float elapsedTime)
     _currentState->update(this, elapsedTime);
 }
 
+void AIStateMachine::updateListener(float elapsedTime)
+{
+    _currentState->updateListener(this, elapsedTime);
+}
+
+void AIStateMachine::fireUpdateEvent(float elapsedTime)
+{
+    _currentState->fireUpdateEvent(this, elapsedTime);
+}
+
 }
@@ -30,6 +30,7 @@ class AIAgent;
 class AIStateMachine
 {
     friend class AIAgent;
+    friend class AIController;
     friend class AIState;
 
 public:
@@ -150,6 +151,16 @@ private:
      */
     void update(float elapsedTime);
 
+    /**
+     * Called by AIController to update the listener of the active state, which may be done on a worker thread.
+     */
+    void updateListener(float elapsedTime);
+
+    /**
+     * Called by AIController to fire the script event that updates the active state.
+     */
+    void fireUpdateEvent(float elapsedTime);
+
     AIAgent* _agent;
     AIState* _currentState;
     std::list<AIState*> _states;
@@ -297,14 +297,15 @@ void Animation::addClip(AnimationClip* clip)
 
 AnimationClip* Animation::findClip(const char* id) const
 {
-    if (_clips)
+    StringId stringId;
+    if (_clips && StringId::find(id, &stringId))
     {
         size_t clipCount = _clips->size();
         for (size_t i = 0; i < clipCount; i++)
         {
             AnimationClip* clip = _clips->at(i);
             GP_ASSERT(clip);
-            if (clip->_id.compare(id) == 0)
+            if (clip->_id == stringId)
             {
                 return clip;
             }
@@ -399,6 +400,17 @@ Animation::Channel* Animation::createChannel(AnimationTarget* target, int proper
     return channel;
 }
 
+Animation::Channel* Animation::createChannel(AnimationTarget* target, int propertyId, Curve* curve, unsigned long duration)
+{
+    GP_ASSERT(target);
+    GP_ASSERT(curve);
+    GP_ASSERT(curve->getComponentCount() == target->getAnimationPropertyComponentCount(propertyId));
+
+    Channel* channel = new Channel(this, target, propertyId, curve, duration);
+    addChannel(channel);
+    return channel;
+}
+
 void Animation::addChannel(Channel* channel)
 {
     GP_ASSERT(channel);
@@ -426,6 +438,21 @@ void Animation::removeChannel(Channel* channel)
     }
 }
 
+void Animation::setLodUpdateInterval(unsigned int interval, unsigned int maxInterval, unsigned int phase, unsigned int frame)
+{
+    if (_defaultClip)
+        _defaultClip->setLodUpdateInterval(interval, maxInterval, phase, frame);
+
+    if (_clips)
+    {
+        for (std::vector<AnimationClip*>::iterator itr = _clips->begin(); itr != _clips->end(); ++itr)
+        {
+            GP_ASSERT(*itr);
+            (*itr)->setLodUpdateInterval(interval, maxInterval, phase, frame);
+        }
+    }
+}
+
 void Animation::setTransformRotationOffset(Curve* curve, unsigned int propertyId)
 {
     GP_ASSERT(curve);
@@ -451,6 +478,9 @@ Animation* Animation::clone(Channel* channel, AnimationTarget* target)
 
     Animation* animation = new Animation(getId());
 
+    // The other channels are added as their targets are cloned, so the clone is sized for all of them at once.
+    animation->_channels.reserve(_channels.size());
+
     Animation::Channel* channelCopy = new Animation::Channel(*channel, animation, target);
     animation->addChannel(channelCopy);
     // Release the animation because a newly created animation has a ref count of 1 and the channels hold the ref to animation.
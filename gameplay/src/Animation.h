@@ -4,6 +4,7 @@
 #include "Ref.h"
 #include "Properties.h"
 #include "Curve.h"
+#include "StringId.h"
 
 namespace gameplay
 {
@@ -125,6 +126,7 @@ private:
         friend class AnimationClip;
         friend class Animation;
         friend class AnimationTarget;
+        friend class SceneSnapshot;
 
     private:
 
@@ -202,6 +204,11 @@ private:
      */
     Channel* createChannel(AnimationTarget* target, int propertyId, unsigned int keyCount, unsigned int* keyTimes, float* keyValues, float* keyInValue, float* keyOutValue, unsigned int type);
 
+    /**
+     * Creates a channel within this animation from an existing curve.
+     */
+    Channel* createChannel(AnimationTarget* target, int propertyId, Curve* curve, unsigned long duration);
+
     /**
      * Adds a channel to the animation.
      */
@@ -217,6 +224,13 @@ private:
      */
     void setTransformRotationOffset(Curve* curve, unsigned int propertyId);
 
+    /**
+     * Sets the update interval chosen by the level of detail of a skin on all clips of this animation.
+     *
+     * @see AnimationClip::setLodUpdateInterval
+     */
+    void setLodUpdateInterval(unsigned int interval, unsigned int maxInterval, unsigned int phase, unsigned int frame);
+
     /**
      * Clones this animation.
      *
@@ -228,7 +242,7 @@ private:
     Animation* clone(Channel* channel, AnimationTarget* target);
 
     AnimationController* _controller;       // The AnimationController that this Animation will run on.
-    std::string _id;                        // The Animation's ID.
+    StringId _id;                           // The Animation's ID.
     unsigned long _duration;                // the length of the animation (in milliseconds).
     std::vector<Channel*> _channels;        // The channels within this Animation.
     AnimationClip* _defaultClip;            // The Animation's default clip.
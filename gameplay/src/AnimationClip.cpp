@@ -2,10 +2,15 @@
 #include "AnimationClip.h"
 #include "Animation.h"
 #include "AnimationTarget.h"
+#include "AnimationPose.h"
 #include "Game.h"
+#include "Node.h"
 #include "Quaternion.h"
 #include "ScriptController.h"
 
+// The number of animation updates that an update interval chosen by a skin stays valid for
+#define ANIMATION_LOD_TIMEOUT 30
+
 namespace gameplay
 {
 
@@ -15,7 +20,7 @@ AnimationClip::AnimationClip(const char* id, Animation* animation, unsigned long
     : _id(id), _animation(animation), _startTime(startTime), _endTime(endTime), _duration(_endTime - _startTime), 
       _stateBits(0x00), _repeatCount(1.0f), _loopBlendTime(0), _activeDuration(_duration * _repeatCount), _speed(1.0f), _timeStarted(0), 
       _elapsedTime(0), _crossFadeToClip(NULL), _crossFadeOutElapsed(0), _crossFadeOutDuration(0), _blendWeight(1.0f),
-      _beginListeners(NULL), _endListeners(NULL), _listeners(NULL), _listenerItr(NULL)
+      _percentComplete(0.0f), _updateInterval(1), _lodInterval(1), _lodMaxInterval(0), _lodPhase(0), _lodFrame(0), _maskWeights(NULL), _beginListeners(NULL), _endListeners(NULL), _listeners(NULL), _listenerItr(NULL)
 {
     GP_REGISTER_SCRIPT_EVENTS();
 
@@ -41,6 +46,7 @@ AnimationClip::~AnimationClip()
     _values.clear();
 
     SAFE_RELEASE(_crossFadeToClip);
+    SAFE_DELETE(_maskWeights);
     SAFE_DELETE(_beginListeners);
     SAFE_DELETE(_endListeners);
 
@@ -170,6 +176,16 @@ float AnimationClip::getBlendWeight() const
     return _blendWeight;
 }
 
+void AnimationClip::setUpdateInterval(unsigned int interval)
+{
+    _updateInterval = interval > 0 ? interval : 1;
+}
+
+unsigned int AnimationClip::getUpdateInterval() const
+{
+    return _updateInterval;
+}
+
 void AnimationClip::setLoopBlendTime(float loopBlendTime)
 {
     if (loopBlendTime < 0.0f)
@@ -292,16 +308,16 @@ void AnimationClip::addListener(AnimationClip::Listener* listener, unsigned long
 
     if (!_listeners)
     {
-        _listeners = new std::list<ListenerEvent*>;
+        _listeners = new std::list<ListenerEvent*, PoolAllocator<ListenerEvent*> >;
         _listeners->push_front(listenerEvent);
 
-        _listenerItr = new std::list<ListenerEvent*>::iterator;
+        _listenerItr = new std::list<ListenerEvent*, PoolAllocator<ListenerEvent*> >::iterator;
         if (isClipStateBitSet(CLIP_IS_PLAYING_BIT))
             *_listenerItr = _listeners->begin();
     }
     else
     {
-        for (std::list<ListenerEvent*>::iterator itr = _listeners->begin(); itr != _listeners->end(); itr++)
+        for (std::list<ListenerEvent*, PoolAllocator<ListenerEvent*> >::iterator itr = _listeners->begin(); itr != _listeners->end(); itr++)
         {
             GP_ASSERT(*itr);
             if (eventTime < (*itr)->_eventTime)
@@ -332,7 +348,7 @@ void AnimationClip::removeListener(AnimationClip::Listener* listener, unsigned l
     if (_listeners)
     {
         GP_ASSERT(listener);
-        std::list<ListenerEvent*>::iterator iter = std::find_if(_listeners->begin(), _listeners->end(), [&](ListenerEvent* lst){ return lst->_eventTime == eventTime && lst->_listener == listener; });
+        std::list<ListenerEvent*, PoolAllocator<ListenerEvent*> >::iterator iter = std::find_if(_listeners->begin(), _listeners->end(), [&](ListenerEvent* lst){ return lst->_eventTime == eventTime && lst->_listener == listener; });
         if (iter != _listeners->end())
         {
             if (isClipStateBitSet(CLIP_IS_PLAYING_BIT))
@@ -399,6 +415,19 @@ void AnimationClip::removeEndListener(AnimationClip::Listener* listener)
 
 bool AnimationClip::update(float elapsedTime)
 {
+    bool finished = false;
+    if (!advance(elapsedTime, &finished))
+        return finished;
+
+    evaluate();
+    return apply();
+}
+
+bool AnimationClip::advance(float elapsedTime, bool* finished)
+{
+    GP_ASSERT(finished);
+    *finished = false;
+
     if (isClipStateBitSet(CLIP_IS_PAUSED_BIT))
     {
         return false;
@@ -410,7 +439,8 @@ bool AnimationClip::update(float elapsedTime)
         // after the last update call. Reset the flag, and return true so the AnimationClip is removed from the 
         // running clips on the AnimationController.
         onEnd();
-        return true;
+        *finished = true;
+        return false;
     }
 
     if (!isClipStateBitSet(CLIP_IS_STARTED_BIT))
@@ -498,10 +528,10 @@ bool AnimationClip::update(float elapsedTime)
     // Compute percentage complete for the current loop (prevent a divide by zero if _duration==0).
     // Note that we don't use (currentTime/(_duration+_loopBlendTime)). That's because we want a
     // % value that is outside the 0-1 range for loop smoothing/blending purposes.
-    float percentComplete = _duration == 0 ? 1 : currentTime / (float)_duration;
+    _percentComplete = _duration == 0 ? 1 : currentTime / (float)_duration;
 
     if (_loopBlendTime == 0.0f)
-        percentComplete = MATH_CLAMP(percentComplete, 0.0f, 1.0f);
+        _percentComplete = MATH_CLAMP(_percentComplete, 0.0f, 1.0f);
 
     // If we're cross fading, compute blend weights
     if (isClipStateBitSet(CLIP_IS_FADING_OUT_BIT))
@@ -550,33 +580,82 @@ bool AnimationClip::update(float elapsedTime)
             SAFE_RELEASE(_crossFadeToClip);
         }
     }
-    
-    // Evaluate this clip.
+
+    return true;
+}
+
+void AnimationClip::evaluate()
+{
+    GP_ASSERT(_animation);
+
     Animation::Channel* channel = NULL;
     AnimationValue* value = NULL;
-    AnimationTarget* target = NULL;
     size_t channelCount = _animation->_channels.size();
     float percentageStart = (float)_startTime / (float)_animation->_duration;
     float percentageEnd = (float)_endTime / (float)_animation->_duration;
     float percentageBlend = (float)_loopBlendTime / (float)_animation->_duration;
+    if (_cursors.size() != channelCount)
+        _cursors.resize(channelCount, 0);
     for (size_t i = 0; i < channelCount; i++)
     {
         channel = _animation->_channels[i];
         GP_ASSERT(channel);
-        target = channel->_target;
-        GP_ASSERT(target);
         value = _values[i];
         GP_ASSERT(value);
 
-        // Evaluate the point on Curve
+        // Evaluate the point on Curve, starting from the keyframe of the last update.
         GP_ASSERT(channel->getCurve());
-        channel->getCurve()->evaluate(percentComplete, percentageStart, percentageEnd, percentageBlend, value->_value);
+        channel->getCurve()->evaluate(_percentComplete, percentageStart, percentageEnd, percentageBlend, value->_value, &_cursors[i]);
+    }
+}
+
+bool AnimationClip::apply()
+{
+    GP_ASSERT(_animation);
+
+    Animation::Channel* channel = NULL;
+    AnimationTarget* target = NULL;
+    size_t channelCount = _animation->_channels.size();
+    for (size_t i = 0; i < channelCount; i++)
+    {
+        channel = _animation->_channels[i];
+        GP_ASSERT(channel);
+        target = channel->_target;
+        GP_ASSERT(target);
 
         // Set the animation value on the target property.
-        target->setAnimationPropertyValue(channel->_propertyId, value, _blendWeight);
+        target->setAnimationPropertyValue(channel->_propertyId, _values[i], getTargetWeight(target));
     }
 
-    // When ended. Probably should move to it's own method so we can call it when the clip is ended early.
+    return finishUpdate();
+}
+
+void AnimationClip::blend(AnimationPose* pose)
+{
+    GP_ASSERT(_animation);
+    GP_ASSERT(pose);
+
+    pose->beginClip();
+    Animation::Channel* channel = NULL;
+    AnimationTarget* target = NULL;
+    size_t channelCount = _animation->_channels.size();
+    for (size_t i = 0; i < channelCount; i++)
+    {
+        channel = _animation->_channels[i];
+        GP_ASSERT(channel);
+        target = channel->_target;
+        GP_ASSERT(target);
+
+        float blendWeight = getTargetWeight(target);
+        if (target->_targetType != AnimationTarget::TRANSFORM || !pose->addChannel(static_cast<Transform*>(target), channel->_propertyId, _values[i], blendWeight))
+            target->setAnimationPropertyValue(channel->_propertyId, _values[i], blendWeight);
+    }
+    pose->endClip();
+}
+
+bool AnimationClip::finishUpdate()
+{
+    // The clip ends after its end values have been applied.
     if (isClipStateBitSet(CLIP_IS_MARKED_FOR_REMOVAL_BIT) || !isClipStateBitSet(CLIP_IS_STARTED_BIT))
     {
         onEnd();
@@ -586,6 +665,73 @@ bool AnimationClip::update(float elapsedTime)
     return false;
 }
 
+bool AnimationClip::isUpdateDue(unsigned int frame) const
+{
+    // A clip that has ended is always applied so that it finishes on its end values.
+    if (!isClipStateBitSet(CLIP_IS_STARTED_BIT) || isClipStateBitSet(CLIP_IS_MARKED_FOR_REMOVAL_BIT))
+        return true;
+
+    unsigned int interval = _updateInterval;
+    if (_lodMaxInterval > 0)
+    {
+        // Skins that are no longer drawn stop choosing an interval, so fall back to the largest one.
+        unsigned int lodInterval = frame - _lodFrame <= ANIMATION_LOD_TIMEOUT ? _lodInterval : _lodMaxInterval;
+        interval = std::max(interval, lodInterval);
+    }
+    return interval <= 1 || (frame + _lodPhase) % interval == 0;
+}
+
+void AnimationClip::setLodUpdateInterval(unsigned int interval, unsigned int maxInterval, unsigned int phase, unsigned int frame)
+{
+    _lodInterval = interval > 0 ? interval : 1;
+    _lodMaxInterval = maxInterval;
+    _lodPhase = phase;
+    _lodFrame = frame;
+}
+
+void AnimationClip::setMaskWeight(Node* node, float weight, bool recursive)
+{
+    GP_ASSERT(node);
+    GP_ASSERT(weight >= 0.0f && weight <= 1.0f);
+
+    if (!_maskWeights)
+        _maskWeights = new std::map<const AnimationTarget*, float>;
+    (*_maskWeights)[node] = weight;
+
+    if (recursive)
+    {
+        for (Node* child = node->getFirstChild(); child != NULL; child = child->getNextSibling())
+            setMaskWeight(child, weight, true);
+    }
+}
+
+float AnimationClip::getMaskWeight(Node* node) const
+{
+    if (_maskWeights)
+    {
+        std::map<const AnimationTarget*, float>::const_iterator itr = _maskWeights->find(node);
+        if (itr != _maskWeights->end())
+            return itr->second;
+    }
+    return 1.0f;
+}
+
+void AnimationClip::clearMask()
+{
+    SAFE_DELETE(_maskWeights);
+}
+
+float AnimationClip::getTargetWeight(const AnimationTarget* target) const
+{
+    if (_maskWeights)
+    {
+        std::map<const AnimationTarget*, float>::const_iterator itr = _maskWeights->find(target);
+        if (itr != _maskWeights->end())
+            return _blendWeight * itr->second;
+    }
+    return _blendWeight;
+}
+
 void AnimationClip::onBegin()
 {
     addRef();
@@ -672,6 +818,7 @@ AnimationClip* AnimationClip::clone(Animation* animation) const
     newClip->setSpeed(getSpeed());
     newClip->setRepeatCount(getRepeatCount());
     newClip->setBlendWeight(getBlendWeight());
+    newClip->setUpdateInterval(getUpdateInterval());
     
     size_t size = _values.size();
     newClip->_values.resize(size, NULL);
@@ -4,6 +4,7 @@
 #include "AnimationValue.h"
 #include "Curve.h"
 #include "Animation.h"
+#include "MemoryPool.h"
 #include "ScriptTarget.h"
 
 namespace gameplay
@@ -11,6 +12,9 @@ namespace gameplay
 
 class Animation;
 class AnimationValue;
+class AnimationPose;
+class AnimationTarget;
+class Node;
 
 /**
  * Defines the runtime session of an Animation to be played.
@@ -19,6 +23,7 @@ class AnimationClip : public Ref, public ScriptTarget
 {
     friend class AnimationController;
     friend class Animation;
+    friend class SceneSnapshot;
 
     GP_SCRIPT_EVENTS_START();
     GP_SCRIPT_EVENT(clipBegin, "<AnimationClip>");
@@ -191,6 +196,62 @@ public:
      */
     float getBlendWeight() const;
 
+    /**
+     * Sets the number of animation updates between evaluations of the clip.
+     *
+     * The time of the clip and its listeners still advance on every update, but its
+     * channels are only evaluated and applied to their targets on every interval'th
+     * update. The default interval of 1 evaluates the clip on every update.
+     *
+     * A MeshSkin with an animation level of detail (see MeshSkin::setAnimationLod) can
+     * reduce the rate of the clips that animate its joints further.
+     *
+     * @param interval The number of updates between evaluations of the clip.
+     * @script{ignore}
+     */
+    void setUpdateInterval(unsigned int interval);
+
+    /**
+     * Gets the number of animation updates between evaluations of the clip.
+     *
+     * @return The number of updates between evaluations of the clip.
+     * @script{ignore}
+     */
+    unsigned int getUpdateInterval() const;
+
+    /**
+     * Sets the weight of the clip on a node that it animates, such as a joint, as a
+     * fraction of the blend weight of the clip.
+     *
+     * Masks let clips play on parts of a skeleton, such as an upper body clip blended
+     * over a walk. Nodes that are not in the mask of the clip have a weight of 1. The
+     * mask is not copied when the clip is cloned, since it refers to the nodes of the
+     * cloned animation.
+     *
+     * @param node The node.
+     * @param weight The weight of the clip on the node, between 0 and 1.
+     * @param recursive true to also set the weight on all the descendants of the node.
+     * @script{ignore}
+     */
+    void setMaskWeight(Node* node, float weight, bool recursive = false);
+
+    /**
+     * Gets the weight of the clip on a node, as a fraction of the blend weight of the clip.
+     *
+     * @param node The node.
+     *
+     * @return The weight of the clip on the node.
+     * @script{ignore}
+     */
+    float getMaskWeight(Node* node) const;
+
+    /**
+     * Removes all the nodes from the mask of the clip, so that it has its blend weight on all of them.
+     *
+     * @script{ignore}
+     */
+    void clearMask();
+
     /**
      * Sets the time (in milliseconds) to append to the clip's active duration
      * to use for blending the end points of the clip when looping.
@@ -352,6 +413,69 @@ private:
      */
     bool update(float elapsedTime);
 
+    /**
+     * Advances the time of the clip, fires its listeners and updates its blend weights.
+     *
+     * @param elapsedTime The elapsed time.
+     * @param finished Set to true if the clip has ended and should be removed from the controller.
+     *
+     * @return true if the channels of the clip must be evaluated and applied this update.
+     */
+    bool advance(float elapsedTime, bool* finished);
+
+    /**
+     * Evaluates the curves of the clip into its animation values.
+     *
+     * This does not modify anything other than the values of this clip, so it is safe to
+     * evaluate different clips on different threads.
+     */
+    void evaluate();
+
+    /**
+     * Sets the evaluated animation values on the targets of the clip.
+     *
+     * @return true if the clip has ended and should be removed from the controller.
+     */
+    bool apply();
+
+    /**
+     * Blends the evaluated animation values of the channels that animate transforms into a pose,
+     * and sets the values of the other channels on their targets.
+     *
+     * @param pose The pose of the current update.
+     */
+    void blend(AnimationPose* pose);
+
+    /**
+     * Ends the clip if it finished or was stopped in the current update.
+     *
+     * @return true if the clip has ended and should be removed from the controller.
+     */
+    bool finishUpdate();
+
+    /**
+     * Returns the weight of the clip on a target, including its mask.
+     */
+    float getTargetWeight(const AnimationTarget* target) const;
+
+    /**
+     * Determines if the channels of the clip are evaluated in the given update, according
+     * to its update interval and the level of detail of the skins it animates.
+     *
+     * @param frame The index of the animation update.
+     */
+    bool isUpdateDue(unsigned int frame) const;
+
+    /**
+     * Sets the update interval chosen by the level of detail of a MeshSkin animated by the clip.
+     *
+     * @param interval The update interval for the current size of the skin.
+     * @param maxInterval The update interval to fall back to if the skin stops setting it (when it is no longer drawn).
+     * @param phase The offset of the updates of the clip, which spreads the updates of many clips over frames.
+     * @param frame The index of the current animation update.
+     */
+    void setLodUpdateInterval(unsigned int interval, unsigned int maxInterval, unsigned int phase, unsigned int frame);
+
     /**
      * Handles when the AnimationClip begins.
      */
@@ -386,7 +510,7 @@ private:
      */
     AnimationClip* clone(Animation* animation) const;
 
-    std::string _id;                                    // AnimationClip ID.
+    StringId _id;                                       // AnimationClip ID.
     Animation* _animation;                              // The Animation this clip is created from.
     unsigned long _startTime;                           // Start time of the clip.
     unsigned long _endTime;                             // End time of the clip.
@@ -402,11 +526,19 @@ private:
     float _crossFadeOutElapsed;                         // The amount of time that has elapsed for the crossfade.
     unsigned long _crossFadeOutDuration;                // The duration of the cross fade.
     float _blendWeight;                                 // The clip's blendweight.
+    float _percentComplete;                             // The position within the current loop that the clip is evaluated at.
     std::vector<AnimationValue*> _values;               // AnimationValue holder.
+    std::vector<unsigned int> _cursors;                 // The keyframe index that each channel was last evaluated at.
+    unsigned int _updateInterval;                       // The number of updates between evaluations of the clip.
+    unsigned int _lodInterval;                          // The update interval chosen by the level of detail of an animated skin.
+    unsigned int _lodMaxInterval;                       // The update interval used once the skin stops choosing one.
+    unsigned int _lodPhase;                             // The offset of the updates of the clip.
+    unsigned int _lodFrame;                             // The animation update in which the level of detail was last chosen.
+    std::map<const AnimationTarget*, float>* _maskWeights; // The weights of the clip on the targets in its mask.
     std::vector<Listener*>* _beginListeners;            // Collection of begin listeners on the clip.
     std::vector<Listener*>* _endListeners;              // Collection of end listeners on the clip.
-    std::list<ListenerEvent*>* _listeners;              // Ordered collection of listeners on the clip.
-    std::list<ListenerEvent*>::iterator* _listenerItr;  // Iterator that points to the next listener event to be triggered.
+    std::list<ListenerEvent*, PoolAllocator<ListenerEvent*> >* _listeners; // Ordered collection of listeners on the clip.
+    std::list<ListenerEvent*, PoolAllocator<ListenerEvent*> >::iterator* _listenerItr; // Iterator that points to the next listener event to be triggered.
 };
 
 }
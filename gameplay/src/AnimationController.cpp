@@ -3,11 +3,14 @@
 #include "Game.h"
 #include "Curve.h"
 
+// Minimum number of animation channels in an update for their curves to be evaluated on multiple threads
+#define ANIMATION_PARALLEL_CHANNEL_COUNT 256
+
 namespace gameplay
 {
 
 AnimationController::AnimationController()
-    : _state(STOPPED)
+    : _state(STOPPED), _frame(0)
 {
 }
 
@@ -95,18 +98,27 @@ void AnimationController::unschedule(AnimationClip* clip)
 
 void AnimationController::update(float elapsedTime)
 {
+    GP_PROFILE_SCOPE("AnimationController::update");
+
+    // Skins blend their palettes over frames even while no clips are running.
+    ++_frame;
+
     if (_state != RUNNING)
         return;
     
     Transform::suspendTransformChanged();
 
-    // Loop through running clips and call update() on them.
+    // Loop through running clips and advance their time, which fires their listeners and
+    // updates their blend weights. The clips that need to be evaluated are collected.
+    size_t channelCount = 0;
+    _evaluatedClips.clear();
     std::list<AnimationClip*>::iterator clipIter = _runningClips.begin();
     while (clipIter != _runningClips.end())
     {
         AnimationClip* clip = (*clipIter);
         GP_ASSERT(clip);
         clip->addRef();
+        bool finished = false;
         if (clip->isClipStateBitSet(AnimationClip::CLIP_IS_RESTARTED_BIT))
         {   // If the CLIP_IS_RESTARTED_BIT is set, we should end the clip and 
             // move it from where it is in the running clips list to the back.
@@ -115,7 +127,18 @@ void AnimationController::update(float elapsedTime)
             _runningClips.push_back(clip);
             clipIter = _runningClips.erase(clipIter);
         }
-        else if (clip->update(elapsedTime))
+        else if (clip->advance(elapsedTime, &finished))
+        {
+            // Clips with a reduced update rate are only evaluated on the updates they are due.
+            if (clip->isUpdateDue(_frame))
+            {
+                clip->addRef();
+                _evaluatedClips.push_back(clip);
+                channelCount += clip->_values.size();
+            }
+            clipIter++;
+        }
+        else if (finished)
         {
             clip->release();
             clipIter = _runningClips.erase(clipIter);
@@ -127,10 +150,55 @@ void AnimationController::update(float elapsedTime)
         clip->release();
     }
 
+    // Evaluate the curves of all clips. Evaluating a clip only writes to its own values,
+    // so large updates are spread across the job system.
+    if (!_evaluatedClips.empty())
+    {
+        JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+        if (jobSystem && channelCount >= ANIMATION_PARALLEL_CHANNEL_COUNT)
+            jobSystem->parallelFor((unsigned int)_evaluatedClips.size(), 1, &AnimationController::evaluateClips, &_evaluatedClips[0]);
+        else
+            evaluateClips(&_evaluatedClips[0], 0, (unsigned int)_evaluatedClips.size());
+    }
+
+    // Blend the values into the pose in update order, so that blending gives the same result
+    // regardless of how the evaluation was split. Each animated transform is then set once,
+    // however many clips animate it.
+    for (size_t i = 0, count = _evaluatedClips.size(); i < count; ++i)
+    {
+        _evaluatedClips[i]->blend(&_pose);
+    }
+    _pose.write();
+
+    for (size_t i = 0, count = _evaluatedClips.size(); i < count; ++i)
+    {
+        AnimationClip* clip = _evaluatedClips[i];
+        if (clip->finishUpdate())
+        {
+            std::list<AnimationClip*>::iterator itr = std::find(_runningClips.begin(), _runningClips.end(), clip);
+            if (itr != _runningClips.end())
+            {
+                _runningClips.erase(itr);
+                clip->release();
+            }
+        }
+        clip->release();
+    }
+    _evaluatedClips.clear();
+
     Transform::resumeTransformChanged();
 
     if (_runningClips.empty())
         _state = IDLE;
 }
 
+void AnimationController::evaluateClips(void* cookie, unsigned int begin, unsigned int end)
+{
+    AnimationClip** clips = (AnimationClip**)cookie;
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        clips[i]->evaluate();
+    }
+}
+
 }
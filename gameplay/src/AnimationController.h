@@ -4,6 +4,7 @@
 #include "AnimationClip.h"
 #include "Animation.h"
 #include "AnimationTarget.h"
+#include "AnimationPose.h"
 #include "Properties.h"
 
 namespace gameplay
@@ -18,6 +19,7 @@ class AnimationController
     friend class Animation;
     friend class AnimationClip;
     friend class SceneLoader;
+    friend class MeshSkin;
 
 public:
 
@@ -96,8 +98,16 @@ private:
      */
     void update(float elapsedTime);
     
+    /**
+     * Evaluates a range of the clips that were advanced in the current update.
+     */
+    static void evaluateClips(void* cookie, unsigned int begin, unsigned int end);
+
     State _state;                                 // The current state of the AnimationController.
     std::list<AnimationClip*> _runningClips;      // A list of running AnimationClips.
+    std::vector<AnimationClip*> _evaluatedClips;  // The clips advanced in the current update, in update order.
+    AnimationPose _pose;                          // The transforms animated by the clips in the current update.
+    unsigned int _frame;                          // The index of the current update, which counts frames while the game is running.
 };
 
 }
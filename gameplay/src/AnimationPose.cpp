@@ -0,0 +1,279 @@
+#include "Base.h"
+#include "AnimationPose.h"
+#include "Transform.h"
+#include "AnimationValue.h"
+#include "SimdMath.h"
+
+// The first component of each part of a transform in the pose
+#define POSE_SCALE_X 0
+#define POSE_ROTATION_X 3
+#define POSE_TRANSLATION_X 7
+
+// The parts of a transform that are animated
+#define POSE_SCALE 1
+#define POSE_ROTATION 2
+#define POSE_TRANSLATION 4
+#define POSE_ALL (POSE_SCALE | POSE_ROTATION | POSE_TRANSLATION)
+
+namespace gameplay
+{
+
+// Blends a range of a component towards the values of a clip, four transforms at a time.
+// This is the same lerp as Curve::lerp, so the result does not depend on the instruction set.
+static void blendComponent(float* pose, const float* clip, const float* weights, unsigned int first, unsigned int end)
+{
+    unsigned int i = first;
+#ifdef GP_USE_SIMD
+    for (; i + 4 <= end; i += 4)
+    {
+        Float4 from = load4(pose + i);
+        store4(pose + i, add4(from, mul4(sub4(load4(clip + i), from), load4(weights + i))));
+    }
+#endif
+    for (; i < end; ++i)
+    {
+        pose[i] = pose[i] + (clip[i] - pose[i]) * weights[i];
+    }
+}
+
+AnimationPose::AnimationPose()
+    : _slotCount(0), _clipFirst(0), _clipEnd(0)
+{
+}
+
+AnimationPose::~AnimationPose()
+{
+}
+
+void AnimationPose::clear()
+{
+    _slots.clear();
+    _slotCount = 0;
+    _clipFirst = 0;
+    _clipEnd = 0;
+}
+
+void AnimationPose::beginClip()
+{
+    _clipFirst = _slotCount;
+    _clipEnd = 0;
+}
+
+bool AnimationPose::addChannel(Transform* transform, int propertyId, const AnimationValue* value, float blendWeight)
+{
+    GP_ASSERT(transform);
+    GP_ASSERT(value);
+    GP_ASSERT(blendWeight >= 0.0f && blendWeight <= 1.0f);
+
+    switch (propertyId)
+    {
+    case Transform::ANIMATE_SCALE_UNIT:
+    case Transform::ANIMATE_SCALE:
+    case Transform::ANIMATE_SCALE_X:
+    case Transform::ANIMATE_SCALE_Y:
+    case Transform::ANIMATE_SCALE_Z:
+    case Transform::ANIMATE_ROTATE:
+    case Transform::ANIMATE_TRANSLATE:
+    case Transform::ANIMATE_TRANSLATE_X:
+    case Transform::ANIMATE_TRANSLATE_Y:
+    case Transform::ANIMATE_TRANSLATE_Z:
+    case Transform::ANIMATE_ROTATE_TRANSLATE:
+    case Transform::ANIMATE_SCALE_ROTATE:
+    case Transform::ANIMATE_SCALE_TRANSLATE:
+    case Transform::ANIMATE_SCALE_ROTATE_TRANSLATE:
+        break;
+    default:
+        return false;
+    }
+
+    // A clip with no weight on the transform leaves it unchanged.
+    if (blendWeight <= 0.0f)
+        return true;
+
+    unsigned int slot = getSlot(transform);
+    switch (propertyId)
+    {
+    case Transform::ANIMATE_SCALE_UNIT:
+        // A unit scale is blended from the x scale of the transform, as Transform::setAnimationPropertyValue does.
+        _pose[POSE_SCALE_X + 1][slot] = _pose[POSE_SCALE_X][slot];
+        _pose[POSE_SCALE_X + 2][slot] = _pose[POSE_SCALE_X][slot];
+        for (unsigned int i = 0; i < 3; ++i)
+            setComponents(slot, POSE_SCALE_X + i, value, 0, 1, blendWeight);
+        break;
+    case Transform::ANIMATE_SCALE:
+        setComponents(slot, POSE_SCALE_X, value, 0, 3, blendWeight);
+        break;
+    case Transform::ANIMATE_SCALE_X:
+        setComponents(slot, POSE_SCALE_X, value, 0, 1, blendWeight);
+        break;
+    case Transform::ANIMATE_SCALE_Y:
+        setComponents(slot, POSE_SCALE_X + 1, value, 0, 1, blendWeight);
+        break;
+    case Transform::ANIMATE_SCALE_Z:
+        setComponents(slot, POSE_SCALE_X + 2, value, 0, 1, blendWeight);
+        break;
+    case Transform::ANIMATE_ROTATE:
+        setComponents(slot, POSE_ROTATION_X, value, 0, 4, blendWeight);
+        break;
+    case Transform::ANIMATE_TRANSLATE:
+        setComponents(slot, POSE_TRANSLATION_X, value, 0, 3, blendWeight);
+        break;
+    case Transform::ANIMATE_TRANSLATE_X:
+        setComponents(slot, POSE_TRANSLATION_X, value, 0, 1, blendWeight);
+        break;
+    case Transform::ANIMATE_TRANSLATE_Y:
+        setComponents(slot, POSE_TRANSLATION_X + 1, value, 0, 1, blendWeight);
+        break;
+    case Transform::ANIMATE_TRANSLATE_Z:
+        setComponents(slot, POSE_TRANSLATION_X + 2, value, 0, 1, blendWeight);
+        break;
+    case Transform::ANIMATE_ROTATE_TRANSLATE:
+        setComponents(slot, POSE_ROTATION_X, value, 0, 4, blendWeight);
+        setComponents(slot, POSE_TRANSLATION_X, value, 4, 3, blendWeight);
+        break;
+    case Transform::ANIMATE_SCALE_ROTATE:
+        setComponents(slot, POSE_SCALE_X, value, 0, 3, blendWeight);
+        setComponents(slot, POSE_ROTATION_X, value, 3, 4, blendWeight);
+        break;
+    case Transform::ANIMATE_SCALE_TRANSLATE:
+        setComponents(slot, POSE_SCALE_X, value, 0, 3, blendWeight);
+        setComponents(slot, POSE_TRANSLATION_X, value, 3, 3, blendWeight);
+        break;
+    case Transform::ANIMATE_SCALE_ROTATE_TRANSLATE:
+        setComponents(slot, POSE_SCALE_X, value, 0, 3, blendWeight);
+        setComponents(slot, POSE_ROTATION_X, value, 3, 4, blendWeight);
+        setComponents(slot, POSE_TRANSLATION_X, value, 7, 3, blendWeight);
+        break;
+    }
+    return true;
+}
+
+void AnimationPose::endClip()
+{
+    if (_clipFirst >= _clipEnd)
+        return;
+
+    for (unsigned int c = 0; c < COMPONENT_COUNT; ++c)
+    {
+        if (c < POSE_ROTATION_X || c >= POSE_TRANSLATION_X)
+            blendComponent(&_pose[c][0], &_clip[c][0], &_weights[c][0], _clipFirst, _clipEnd);
+    }
+
+    // Rotations are slerped, as they are by Transform, so that blended rotations stay normalized.
+    // The four components of a rotation share the weight of the first one.
+    for (unsigned int i = _clipFirst; i < _clipEnd; ++i)
+    {
+        float weight = _weights[POSE_ROTATION_X][i];
+        if (weight > 0.0f)
+        {
+            Quaternion from(_pose[POSE_ROTATION_X][i], _pose[POSE_ROTATION_X + 1][i], _pose[POSE_ROTATION_X + 2][i], _pose[POSE_ROTATION_X + 3][i]);
+            Quaternion to(_clip[POSE_ROTATION_X][i], _clip[POSE_ROTATION_X + 1][i], _clip[POSE_ROTATION_X + 2][i], _clip[POSE_ROTATION_X + 3][i]);
+            Quaternion::slerp(from, to, weight, &from);
+            _pose[POSE_ROTATION_X][i] = from.x;
+            _pose[POSE_ROTATION_X + 1][i] = from.y;
+            _pose[POSE_ROTATION_X + 2][i] = from.z;
+            _pose[POSE_ROTATION_X + 3][i] = from.w;
+        }
+    }
+
+    // Components that the next clip does not animate must have no weight.
+    for (unsigned int c = 0; c < COMPONENT_COUNT; ++c)
+    {
+        memset(&_weights[c][_clipFirst], 0, (_clipEnd - _clipFirst) * sizeof(float));
+    }
+    _clipFirst = _slotCount;
+    _clipEnd = 0;
+}
+
+void AnimationPose::write()
+{
+    for (unsigned int i = 0; i < _slotCount; ++i)
+    {
+        Transform* transform = _transforms[i];
+        GP_ASSERT(transform);
+        unsigned char written = _written[i];
+        if (written == POSE_ALL)
+        {
+            transform->set(Vector3(_pose[POSE_SCALE_X][i], _pose[POSE_SCALE_X + 1][i], _pose[POSE_SCALE_X + 2][i]),
+                           Quaternion(_pose[POSE_ROTATION_X][i], _pose[POSE_ROTATION_X + 1][i], _pose[POSE_ROTATION_X + 2][i], _pose[POSE_ROTATION_X + 3][i]),
+                           Vector3(_pose[POSE_TRANSLATION_X][i], _pose[POSE_TRANSLATION_X + 1][i], _pose[POSE_TRANSLATION_X + 2][i]));
+            continue;
+        }
+        if (written & POSE_SCALE)
+            transform->setScale(_pose[POSE_SCALE_X][i], _pose[POSE_SCALE_X + 1][i], _pose[POSE_SCALE_X + 2][i]);
+        if (written & POSE_ROTATION)
+            transform->setRotation(_pose[POSE_ROTATION_X][i], _pose[POSE_ROTATION_X + 1][i], _pose[POSE_ROTATION_X + 2][i], _pose[POSE_ROTATION_X + 3][i]);
+        if (written & POSE_TRANSLATION)
+            transform->setTranslation(_pose[POSE_TRANSLATION_X][i], _pose[POSE_TRANSLATION_X + 1][i], _pose[POSE_TRANSLATION_X + 2][i]);
+    }
+    clear();
+}
+
+unsigned int AnimationPose::getSlot(Transform* transform)
+{
+    unsigned int slot;
+    std::unordered_map<Transform*, unsigned int>::const_iterator itr = _slots.find(transform);
+    if (itr != _slots.end())
+    {
+        slot = itr->second;
+    }
+    else
+    {
+        // The arrays keep their size between updates, so slots are only allocated for the largest pose.
+        slot = _slotCount++;
+        _slots[transform] = slot;
+        if (slot == _transforms.size())
+        {
+            _transforms.push_back(transform);
+            _written.push_back(0);
+            for (unsigned int c = 0; c < COMPONENT_COUNT; ++c)
+            {
+                _pose[c].push_back(0.0f);
+                _clip[c].push_back(0.0f);
+                _weights[c].push_back(0.0f);
+            }
+        }
+        else
+        {
+            _transforms[slot] = transform;
+            _written[slot] = 0;
+        }
+
+        // Blending starts from the current values of the transform.
+        const Vector3& scale = transform->getScale();
+        const Quaternion& rotation = transform->getRotation();
+        const Vector3& translation = transform->getTranslation();
+        float values[COMPONENT_COUNT] = { scale.x, scale.y, scale.z, rotation.x, rotation.y, rotation.z, rotation.w, translation.x, translation.y, translation.z };
+        for (unsigned int c = 0; c < COMPONENT_COUNT; ++c)
+        {
+            _pose[c][slot] = values[c];
+            _clip[c][slot] = values[c];
+        }
+    }
+
+    if (slot < _clipFirst)
+        _clipFirst = slot;
+    if (slot + 1 > _clipEnd)
+        _clipEnd = slot + 1;
+    return slot;
+}
+
+void AnimationPose::setComponents(unsigned int slot, unsigned int component, const AnimationValue* value, unsigned int index, unsigned int count, float blendWeight)
+{
+    GP_ASSERT(component + count <= COMPONENT_COUNT);
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        _clip[component + i][slot] = value->getFloat(index + i);
+        _weights[component + i][slot] = blendWeight;
+    }
+
+    if (component < POSE_ROTATION_X)
+        _written[slot] |= POSE_SCALE;
+    else if (component < POSE_TRANSLATION_X)
+        _written[slot] |= POSE_ROTATION;
+    else
+        _written[slot] |= POSE_TRANSLATION;
+}
+
+}
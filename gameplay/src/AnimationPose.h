@@ -0,0 +1,103 @@
+#ifndef ANIMATIONPOSE_H_
+#define ANIMATIONPOSE_H_
+
+namespace gameplay
+{
+
+class AnimationValue;
+class Transform;
+
+/**
+ * Defines a buffer of the local poses of the transforms animated in an update of the AnimationController.
+ *
+ * The channels of the running clips that animate transforms, such as the joints of a skeleton, are
+ * blended into flat arrays of scale, rotation and translation components instead of being set on
+ * their transforms one clip at a time. The clips are blended in update order, each one over the
+ * result of the clips before it, which gives the same result as setting them on the transforms in
+ * turn. Each transform is then written once, at the end of the update.
+ */
+class AnimationPose
+{
+    friend class AnimationController;
+    friend class AnimationClip;
+
+private:
+
+    static const unsigned int COMPONENT_COUNT = 10;  // The number of components of a transform: scale (3), rotation (4) and translation (3).
+
+    /**
+     * Constructor.
+     */
+    AnimationPose();
+
+    /**
+     * Destructor.
+     */
+    ~AnimationPose();
+
+    /**
+     * Hidden copy constructor.
+     */
+    AnimationPose(const AnimationPose& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    AnimationPose& operator=(const AnimationPose&);
+
+    /**
+     * Removes all the transforms from the pose.
+     */
+    void clear();
+
+    /**
+     * Starts adding the channels of a clip.
+     */
+    void beginClip();
+
+    /**
+     * Adds the value of a channel of the current clip.
+     *
+     * @param transform The transform animated by the channel.
+     * @param propertyId The animated property of the transform.
+     * @param value The value evaluated for the channel.
+     * @param blendWeight The weight of the clip on the transform.
+     *
+     * @return true if the value was added, false if the property is not blended by the pose.
+     */
+    bool addChannel(Transform* transform, int propertyId, const AnimationValue* value, float blendWeight);
+
+    /**
+     * Blends the channels of the current clip over the pose.
+     */
+    void endClip();
+
+    /**
+     * Sets the blended pose on the transforms.
+     */
+    void write();
+
+    /**
+     * Returns the index of a transform in the pose, adding it with its current values if it is not in the pose yet.
+     */
+    unsigned int getSlot(Transform* transform);
+
+    /**
+     * Sets consecutive components of a transform in the current clip from consecutive floats of an animation value.
+     */
+    void setComponents(unsigned int slot, unsigned int component, const AnimationValue* value, unsigned int index, unsigned int count, float blendWeight);
+
+    std::unordered_map<Transform*, unsigned int> _slots;    // The index of each transform in the pose.
+    std::vector<Transform*> _transforms;                    // The transforms of the pose.
+    std::vector<unsigned char> _written;                    // The parts (scale, rotation and translation) of each transform that are animated.
+    std::vector<float> _pose[COMPONENT_COUNT];              // The blended value of each component of the transforms.
+    std::vector<float> _clip[COMPONENT_COUNT];              // The value of each component in the current clip.
+    std::vector<float> _weights[COMPONENT_COUNT];           // The weight of each component in the current clip, or 0 if it does not animate it.
+    unsigned int _slotCount;                                // The number of transforms in the pose.
+    unsigned int _clipFirst;                                // The first slot animated by the current clip.
+    unsigned int _clipEnd;                                  // One past the last slot animated by the current clip.
+};
+
+}
+
+#endif
@@ -324,13 +324,18 @@ Animation* AnimationTarget::getAnimation(const char* id) const
         if (id == NULL)
             return (*itr)->_animation;
 
+        // Animation IDs are interned, so an ID that was never interned matches no animation.
+        StringId stringId;
+        if (!StringId::find(id, &stringId))
+            return NULL;
+
         Animation::Channel* channel = NULL;
         for (; itr != _animationChannels->end(); itr++)
         {
             channel = (Animation::Channel*)(*itr);
             GP_ASSERT(channel);
             GP_ASSERT(channel->_animation);
-            if (channel->_animation->_id.compare(id) == 0)
+            if (channel->_animation->_id == stringId)
             {
                 return channel->_animation;
             }
@@ -402,6 +407,19 @@ int AnimationTarget::getPropertyId(TargetType type, const char* propertyIdStr)
     return -1;
 }
 
+void AnimationTarget::setLodUpdateInterval(unsigned int interval, unsigned int maxInterval, unsigned int phase, unsigned int frame)
+{
+    if (_animationChannels == NULL)
+        return;
+
+    for (std::vector<Animation::Channel*>::iterator itr = _animationChannels->begin(); itr != _animationChannels->end(); ++itr)
+    {
+        GP_ASSERT(*itr);
+        GP_ASSERT((*itr)->_animation);
+        (*itr)->_animation->setLodUpdateInterval(interval, maxInterval, phase, frame);
+    }
+}
+
 void AnimationTarget::addChannel(Animation::Channel* channel)
 {
     if (_animationChannels == NULL)
@@ -441,12 +459,16 @@ Animation::Channel* AnimationTarget::getChannel(const char* id) const
         if (id == NULL)
             return (*itr);
 
+        StringId stringId;
+        if (!StringId::find(id, &stringId))
+            return NULL;
+
         Animation::Channel* channel = NULL;
         for (; itr != _animationChannels->end(); itr++)
         {
             channel = (Animation::Channel*)(*itr);
             GP_ASSERT(channel);
-            if (channel->_animation->_id.compare(id) == 0)
+            if (channel->_animation->_id == stringId)
             {
                 return channel;
             }
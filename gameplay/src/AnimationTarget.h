@@ -19,6 +19,8 @@ class AnimationTarget
 {
     friend class Animation;
     friend class AnimationClip;
+    friend class MeshSkin;
+    friend class SceneSnapshot;
 
 public:
 
@@ -240,6 +242,13 @@ private:
      */
     void convertByValues(float* from, float* by, unsigned int componentCount);
 
+    /**
+     * Sets the update interval chosen by the level of detail of a skin on the clips that animate this target.
+     *
+     * @see AnimationClip::setLodUpdateInterval
+     */
+    void setLodUpdateInterval(unsigned int interval, unsigned int maxInterval, unsigned int phase, unsigned int frame);
+
     std::vector<Animation::Channel*>* _animationChannels;   // Collection of all animation channels that target the AnimationTarget
 
 };
@@ -1,12 +1,39 @@
 #include "Base.h"
 #include "AudioBuffer.h"
+#include "AudioController.h"
 #include "FileSystem.h"
+#include "Game.h"
+
+// The number of samples of each channel in a block of IMA4 compressed sound, which is what OpenAL expects by default
+#define AUDIO_IMA4_BLOCK_SAMPLES 65
+
+#ifndef AL_FORMAT_MONO_IMA4
+#define AL_FORMAT_MONO_IMA4 0x1300
+#define AL_FORMAT_STEREO_IMA4 0x1301
+#endif
 
 namespace gameplay
 {
 
 // Audio buffer cache
-static std::vector<AudioBuffer*> __buffers;
+static ResourceCache __bufferCache;
+
+// The buffers of sounds that are being decoded
+static std::vector<AudioBuffer*> __loadingBuffers;
+
+static const int __ima4StepTable[89] =
+{
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97,
+    107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871,
+    5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623,
+    27086, 29794, 32767
+};
+
+static const int __ima4IndexTable[16] =
+{
+    -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8
+};
 
 // Callbacks for loading an ogg file using Stream
 static size_t readStream(void* ptr, size_t size, size_t nmemb, void* datasource)
@@ -39,27 +66,41 @@ static long tellStream(void* datasource)
 }
 
 AudioBuffer::AudioBuffer(const char* path, ALuint* buffer, bool streamed)
-: _filePath(path), _streamed(streamed), _buffersNeededCount(0)
+: _filePath(path), _streamed(streamed), _buffersNeededCount(0), _duration(0.0f), _compressed(false), _loading(false),
+  _samples(NULL), _job(NULL), _memorySize(0)
 {
     memcpy(_alBufferQueue, buffer, sizeof(_alBufferQueue));
+
+    // Streamed sounds keep a queue of buffers that are refilled as they play.
+    if (_streamed)
+    {
+        _memorySize = STREAMING_BUFFER_QUEUE_SIZE * STREAMING_BUFFER_SIZE;
+        MemoryStats::add(MemoryStats::AUDIO, _memorySize);
+    }
 }
 
 AudioBuffer::~AudioBuffer()
 {
-    // Remove the buffer from the cache.
-    unsigned int bufferCount = (unsigned int)__buffers.size();
-
-    if (!_streamed)
+    if (_loading)
     {
-        unsigned int bufferCount = (unsigned int)__buffers.size();
-        for (unsigned int i = 0; i < bufferCount; i++)
+        // Finish decoding before the samples are deleted.
+        if (_job)
         {
-            if (this == __buffers[i])
-            {
-                __buffers.erase(__buffers.begin() + i);
-                break;
-            }
+            JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+            GP_ASSERT(jobSystem);
+            jobSystem->wait(_job);
+            _job = NULL;
         }
+        std::vector<AudioBuffer*>::iterator itr = std::find(__loadingBuffers.begin(), __loadingBuffers.end(), this);
+        if (itr != __loadingBuffers.end())
+            __loadingBuffers.erase(itr);
+        SAFE_DELETE(_samples);
+    }
+
+    if (!_streamed)
+    {
+        // Remove the buffer from the cache.
+        __bufferCache.remove(_filePath.c_str(), this);
     }
     else if (_streamStateOgg.get())
     {
@@ -74,25 +115,42 @@ AudioBuffer::~AudioBuffer()
             _alBufferQueue[i] = 0;
         }
     }
+    MemoryStats::remove(MemoryStats::AUDIO, _memorySize);
+}
+
+ResourceCache* AudioBuffer::getCache()
+{
+    return &__bufferCache;
 }
 
 AudioBuffer* AudioBuffer::create(const char* path, bool streamed)
 {
     GP_ASSERT(path);
 
+    // The audio device is opened when the first sound is loaded.
+    Game::getInstance()->getAudioController();
+
     AudioBuffer* buffer = NULL;
     if (!streamed)
     {
-        unsigned int bufferCount = (unsigned int)__buffers.size();
-        for (unsigned int i = 0; i < bufferCount; i++)
+        // Share the buffers that are cached or still decoding.
+        buffer = static_cast<AudioBuffer*>(__bufferCache.find(path));
+        for (size_t i = 0, count = __loadingBuffers.size(); buffer == NULL && i < count; ++i)
         {
-            buffer = __buffers[i];
-            GP_ASSERT(buffer);
-            if (buffer->_filePath.compare(path) == 0)
-            {
-                buffer->addRef();
-                return buffer;
-            }
+            if (__loadingBuffers[i]->_filePath.compare(path) == 0)
+                buffer = __loadingBuffers[i];
+        }
+        if (buffer)
+        {
+            buffer->addRef();
+            return buffer;
+        }
+
+        // Missing files are reported right away; files that fail to decode are reported by the worker.
+        if (!FileSystem::fileExists(path))
+        {
+            GP_ERROR("Failed to load audio file %s.", path);
+            return NULL;
         }
     }
     ALuint alBuffer[STREAMING_BUFFER_QUEUE_SIZE];
@@ -107,20 +165,56 @@ AudioBuffer* AudioBuffer::create(const char* path, bool streamed)
         if (AL_LAST_ERROR())
         {
             GP_ERROR("Failed to create OpenAL buffer; alGenBuffers error: %d", AL_LAST_ERROR());
-            AL_CHECK(alDeleteBuffers(1, &alBuffer[i]));
+            for (unsigned int j = 0; j < i; j++)
+                AL_CHECK(alDeleteBuffers(1, &alBuffer[j]));
             return NULL;
         }
     }
-    
-    std::unique_ptr<AudioStreamStateWav> streamStateWav;
-    std::unique_ptr<AudioStreamStateOgg> streamStateOgg;
+    buffer = new AudioBuffer(path, alBuffer, streamed);
+
+    if (streamed)
+    {
+        // Fill the first buffer of the queue right away; the streaming thread decodes the rest.
+        Samples samples;
+        if (!buffer->load(&samples))
+        {
+            SAFE_RELEASE(buffer);
+            return NULL;
+        }
+        buffer->upload(&samples);
+        return buffer;
+    }
 
-    // Load sound file.
+    // Sounds are decoded on a worker thread and uploaded at the start of the first audio update after that.
+    AudioController* audioController = Game::getInstance()->getAudioController();
+    buffer->_compressed = audioController && audioController->_soundCompression;
+    buffer->_loading = true;
+    buffer->_samples = new Samples();
+    __loadingBuffers.push_back(buffer);
+
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    if (jobSystem)
+    {
+        buffer->_job = jobSystem->create(&AudioBuffer::decodeAsync, buffer);
+        jobSystem->run(buffer->_job);
+    }
+    else
+    {
+        decodeAsync(buffer);
+    }
+    return buffer;
+}
+
+bool AudioBuffer::load(Samples* samples)
+{
+    GP_ASSERT(samples);
+
+    const char* path = _filePath.c_str();
     std::unique_ptr<Stream> stream(FileSystem::open(path));
     if (stream.get() == NULL || !stream->canRead())
     {
         GP_ERROR("Failed to load audio file %s.", path);
-        goto cleanup;
+        return false;
     }
     
     // Read the file header
@@ -128,61 +222,206 @@ AudioBuffer* AudioBuffer::create(const char* path, bool streamed)
     if (stream->read(header, 1, 12) != 12)
     {
         GP_ERROR("Invalid header for audio file %s.", path);
-        goto cleanup;
+        return false;
     }
     
     // Check the file format
+    std::unique_ptr<AudioStreamStateWav> streamStateWav;
+    std::unique_ptr<AudioStreamStateOgg> streamStateOgg;
     if (memcmp(header, "RIFF", 4) == 0)
     {
         // Fill at least one buffer with sound data.
         streamStateWav.reset(new AudioStreamStateWav());
-        if (!AudioBuffer::loadWav(stream.get(), alBuffer[0], streamed, streamStateWav.get()))
+        if (!AudioBuffer::loadWav(stream.get(), _streamed, streamStateWav.get(), samples))
         {
             GP_ERROR("Invalid wave file: %s", path);
-            goto cleanup;
+            return false;
         }
     }
     else if (memcmp(header, "OggS", 4) == 0)
     {
         // Fill at least one buffer with sound data.
         streamStateOgg.reset(new AudioStreamStateOgg());
-        if (!AudioBuffer::loadOgg(stream.get(), alBuffer[0], streamed, streamStateOgg.get()))
+        if (!AudioBuffer::loadOgg(stream.get(), _streamed, streamStateOgg.get(), samples))
         {
             GP_ERROR("Invalid ogg file: %s", path);
-            goto cleanup;
+            return false;
         }
     }
     else
     {
         GP_ERROR("Unsupported audio file: %s", path);
-        goto cleanup;
+        return false;
     }
 
-    buffer = new AudioBuffer(path, alBuffer, streamed);
+    // Only streamed sounds keep reading from the file.
+    if (_streamed)
+    {
+        _fileStream.reset(stream.release());
+        _streamStateWav.reset(streamStateWav.release());
+        _streamStateOgg.reset(streamStateOgg.release());
+        if (_streamStateWav.get())
+            _buffersNeededCount = (_streamStateWav->dataSize + STREAMING_BUFFER_SIZE - 1) / STREAMING_BUFFER_SIZE;
+        else if (_streamStateOgg.get())
+            _buffersNeededCount = (_streamStateOgg->dataSize + STREAMING_BUFFER_SIZE - 1) / STREAMING_BUFFER_SIZE;
+    }
+    return true;
+}
 
-    buffer->_fileStream.reset(stream.release());
-    buffer->_streamStateWav.reset(streamStateWav.release());
-    buffer->_streamStateOgg.reset(streamStateOgg.release());
-    if (buffer->_streamStateWav.get())
-        buffer->_buffersNeededCount = (buffer->_streamStateWav->dataSize + STREAMING_BUFFER_SIZE - 1) / STREAMING_BUFFER_SIZE;
-    else if (buffer->_streamStateOgg.get())
-        buffer->_buffersNeededCount = (buffer->_streamStateOgg->dataSize + STREAMING_BUFFER_SIZE - 1) / STREAMING_BUFFER_SIZE;
+size_t AudioBuffer::upload(Samples* samples)
+{
+    GP_ASSERT(samples);
 
-    if (!streamed)
-        __buffers.push_back(buffer);
+    unsigned int frameSize = samples->channels * samples->bits / 8;
+    if (frameSize == 0 || samples->frequency == 0)
+        return 0;
+    if (!_streamed)
+        _duration = (float)(samples->data.size() / frameSize) / (float)samples->frequency;
 
-    return buffer;
-    
-cleanup:
-    for (unsigned int i = 0; i < STREAMING_BUFFER_QUEUE_SIZE; i++)
+    size_t size;
+    if (samples->compressed.empty())
+    {
+        if (!samples->data.empty())
+            AL_CHECK( alBufferData(_alBufferQueue[0], samples->format, &samples->data[0], (ALsizei)samples->data.size(), samples->frequency) );
+        size = samples->data.size();
+    }
+    else
+    {
+        ALenum format = samples->channels == 1 ? AL_FORMAT_MONO_IMA4 : AL_FORMAT_STEREO_IMA4;
+        AL_CHECK( alBufferData(_alBufferQueue[0], format, &samples->compressed[0], (ALsizei)samples->compressed.size(), samples->frequency) );
+        size = samples->compressed.size();
+    }
+
+    // The first buffer of a streamed sound is part of its queue, which is already counted.
+    if (!_streamed)
+    {
+        MemoryStats::remove(MemoryStats::AUDIO, _memorySize);
+        _memorySize = size;
+        MemoryStats::add(MemoryStats::AUDIO, _memorySize);
+    }
+    return size;
+}
+
+void AudioBuffer::decodeAsync(void* cookie)
+{
+    AudioBuffer* buffer = (AudioBuffer*)cookie;
+    GP_ASSERT(buffer->_samples);
+
+    Samples* samples = buffer->_samples;
+    if (!buffer->load(samples))
+    {
+        samples->data.clear();
+        samples->channels = 0;
+        return;
+    }
+    if (buffer->_compressed && samples->bits == 16 && samples->channels <= 2)
+    {
+        encodeIma4(samples);
+        std::vector<char>().swap(samples->data);
+    }
+}
+
+void AudioBuffer::updateAsync()
+{
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    for (size_t i = 0; i < __loadingBuffers.size();)
     {
-        if (alBuffer[i])
-            AL_CHECK(alDeleteBuffers(1, &alBuffer[i]));
+        AudioBuffer* buffer = __loadingBuffers[i];
+        if (buffer->_job)
+        {
+            GP_ASSERT(jobSystem);
+            if (!jobSystem->isFinished(buffer->_job))
+            {
+                ++i;
+                continue;
+            }
+            jobSystem->release(buffer->_job);
+            buffer->_job = NULL;
+        }
+        __loadingBuffers.erase(__loadingBuffers.begin() + i);
+
+        // Buffers that failed to decode stay empty, so their sources finish right away.
+        size_t size = buffer->upload(buffer->_samples);
+        SAFE_DELETE(buffer->_samples);
+        buffer->_loading = false;
+        if (size > 0)
+            __bufferCache.add(buffer->_filePath.c_str(), buffer, size);
     }
-    return NULL;
 }
 
-bool AudioBuffer::loadWav(Stream* stream, ALuint buffer, bool streamed, AudioStreamStateWav* streamState)
+void AudioBuffer::encodeIma4(Samples* samples)
+{
+    GP_ASSERT(samples->bits == 16);
+
+    // Each block starts with the first sample and step index of every channel, followed by the other 64
+    // samples of each channel as 4 bit codes, interleaved in groups of 8. The last block is padded with silence.
+    const unsigned int channels = samples->channels;
+    const unsigned int frameCount = (unsigned int)(samples->data.size() / (2 * channels));
+    const unsigned int blockCount = (frameCount + AUDIO_IMA4_BLOCK_SAMPLES - 1) / AUDIO_IMA4_BLOCK_SAMPLES;
+    const unsigned int blockSize = 36 * channels;
+    const short* pcm = (const short*)(samples->data.empty() ? NULL : &samples->data[0]);
+    samples->compressed.assign(blockCount * blockSize, 0);
+
+    int index[2] = { 0, 0 };
+    for (unsigned int block = 0; block < blockCount; ++block)
+    {
+        unsigned char* dst = &samples->compressed[block * blockSize];
+        const unsigned int first = block * AUDIO_IMA4_BLOCK_SAMPLES;
+        for (unsigned int c = 0; c < channels; ++c)
+        {
+            int predictor = first < frameCount ? pcm[first * channels + c] : 0;
+            dst[c * 4] = (unsigned char)(predictor & 0xff);
+            dst[c * 4 + 1] = (unsigned char)((predictor >> 8) & 0xff);
+            dst[c * 4 + 2] = (unsigned char)index[c];
+
+            for (unsigned int i = 1; i < AUDIO_IMA4_BLOCK_SAMPLES; ++i)
+            {
+                unsigned int frame = first + i;
+                int sample = frame < frameCount ? pcm[frame * channels + c] : 0;
+
+                // Quantize the difference to the predicted sample exactly like the decoder reconstructs it.
+                int step = __ima4StepTable[index[c]];
+                int diff = sample - predictor;
+                int code = 0;
+                if (diff < 0)
+                {
+                    code = 8;
+                    diff = -diff;
+                }
+                int delta = step >> 3;
+                if (diff >= step)
+                {
+                    code |= 4;
+                    diff -= step;
+                    delta += step;
+                }
+                step >>= 1;
+                if (diff >= step)
+                {
+                    code |= 2;
+                    diff -= step;
+                    delta += step;
+                }
+                step >>= 1;
+                if (diff >= step)
+                {
+                    code |= 1;
+                    delta += step;
+                }
+                predictor += (code & 8) ? -delta : delta;
+                predictor = std::min(std::max(predictor, -32768), 32767);
+                index[c] = std::min(std::max(index[c] + __ima4IndexTable[code], 0), 88);
+
+                // The codes of a channel come in groups of 4 bytes, two codes per byte with the first in the low bits.
+                unsigned int n = i - 1;
+                unsigned char& byte = dst[channels * 4 + (n / 8) * channels * 4 + c * 4 + (n % 8) / 2];
+                byte |= (unsigned char)((n & 1) ? (code << 4) : code);
+            }
+        }
+    }
+}
+
+bool AudioBuffer::loadWav(Stream* stream, bool streamed, AudioStreamStateWav* streamState, Samples* samples)
 {
     GP_ASSERT(stream);
 
@@ -326,17 +565,17 @@ bool AudioBuffer::loadWav(Stream* stream, ALuint buffer, bool streamed, AudioStr
                     dataSize = STREAMING_BUFFER_SIZE;
             }
 
-            char* data = new char[dataSize];
-            if (stream->read(data, sizeof(char), dataSize) != dataSize)
+            samples->format = format;
+            samples->frequency = frequency;
+            samples->channels = channels;
+            samples->bits = bits;
+            samples->data.resize(dataSize);
+            if (dataSize > 0 && stream->read(&samples->data[0], sizeof(char), dataSize) != dataSize)
             {
                 GP_ERROR("Failed to load wave file; file is missing data.");
-                SAFE_DELETE_ARRAY(data);
                 return false;
             }
 
-            AL_CHECK( alBufferData(buffer, format, data, dataSize, frequency) );
-            SAFE_DELETE_ARRAY(data);
-
             // We've read the data, so return now.
             return true;
         }
@@ -381,7 +620,7 @@ bool AudioBuffer::loadWav(Stream* stream, ALuint buffer, bool streamed, AudioStr
     return false;
 }
 
-bool AudioBuffer::loadOgg(Stream* stream, ALuint buffer, bool streamed, AudioStreamStateOgg* streamState)
+bool AudioBuffer::loadOgg(Stream* stream, bool streamed, AudioStreamStateOgg* streamState, Samples* samples)
 {
     GP_ASSERT(stream);
 
@@ -428,7 +667,8 @@ bool AudioBuffer::loadOgg(Stream* stream, ALuint buffer, bool streamed, AudioStr
             data_size = STREAMING_BUFFER_SIZE;
     }
 
-    char* data = new char[data_size];
+    samples->data.resize(data_size);
+    char* data = data_size > 0 ? &samples->data[0] : NULL;
 
     while (size < data_size)
     {
@@ -439,7 +679,7 @@ bool AudioBuffer::loadOgg(Stream* stream, ALuint buffer, bool streamed, AudioStr
         }
         else if (result < 0)
         {
-            SAFE_DELETE_ARRAY(data);
+            ov_clear(&streamState->oggFile);
             GP_ERROR("Failed to read ogg file; file is missing data.");
             return false;
         }
@@ -451,14 +691,16 @@ bool AudioBuffer::loadOgg(Stream* stream, ALuint buffer, bool streamed, AudioStr
     
     if (size == 0)
     {
-        SAFE_DELETE_ARRAY(data);
+        ov_clear(&streamState->oggFile);
         GP_ERROR("Filed to read ogg file; unable to read any data.");
         return false;
     }
 
-    AL_CHECK(alBufferData(buffer, format, data, size, info->rate));
-
-    SAFE_DELETE_ARRAY(data);
+    samples->format = format;
+    samples->frequency = info->rate;
+    samples->channels = info->channels == 1 ? 1 : 2;
+    samples->bits = 16;
+    samples->data.resize(size);
 
     if (!streamed)
         ov_clear(&streamState->oggFile);
@@ -466,10 +708,10 @@ bool AudioBuffer::loadOgg(Stream* stream, ALuint buffer, bool streamed, AudioStr
     return true;
 }
 
-bool AudioBuffer::streamData(ALuint buffer, bool looped)
+bool AudioBuffer::streamData(ALuint buffer, bool looped, char* buffers)
 {
-    static char buffers[STREAMING_BUFFER_SIZE];
-    
+    GP_ASSERT(buffers);
+
     if (_streamStateWav.get())
     {
         ALsizei bytesRead = _fileStream->read(buffers, sizeof(char), STREAMING_BUFFER_SIZE);
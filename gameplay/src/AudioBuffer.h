@@ -3,6 +3,8 @@
 
 #include "Ref.h"
 #include "Stream.h"
+#include "ResourceCache.h"
+#include "JobSystem.h"
 
 namespace gameplay
 {
@@ -13,10 +15,35 @@ class AudioSource;
  * Defines the actual audio buffer data.
  *
  * Currently only supports supported formats: .ogg, .wav, .au and .raw files.
+ *
+ * Sounds that are not streamed are decoded on a worker thread of the job system and uploaded at the
+ * start of the first audio update after that; sources that are played before then start once the
+ * sound is loaded. Loaded sounds are shared through a resource cache, which can keep sounds that are
+ * no longer used up to a memory budget, so that sounds loaded again (such as the sound effects of a
+ * level that is entered again) are not decoded again. The budget can be set in the game.config
+ * file (in megabytes):
+ *
+ * @code
+ * resources
+ * {
+ *     audioBudget = 16
+ * }
+ * @endcode
  */
 class AudioBuffer : public Ref
 {
     friend class AudioSource;
+    friend class AudioController;
+
+public:
+
+    /**
+     * Returns the cache of the sounds that were loaded from files, which does not include streamed sounds.
+     *
+     * @return The sound cache.
+     * @script{ignore}
+     */
+    static ResourceCache* getCache();
 
 private:
     
@@ -61,14 +88,60 @@ private:
         OggVorbis_File oggFile;
     };
 
-    enum { STREAMING_BUFFER_QUEUE_SIZE = 3 };
+    enum { STREAMING_BUFFER_QUEUE_SIZE = 8 };
+    enum { STREAMING_BUFFER_QUEUE_DEFAULT = 3 };
     enum { STREAMING_BUFFER_SIZE = 48000 };
 
-    static bool loadWav(Stream* stream, ALuint buffer, bool streamed, AudioStreamStateWav* streamState);
+    /**
+     * The decoded samples of a sound, or the first part of a streamed sound.
+     */
+    struct Samples
+    {
+        ALenum format;
+        ALsizei frequency;
+        unsigned int channels;
+        unsigned int bits;
+        std::vector<char> data;
+        // The samples compressed to IMA4 blocks, if the sound is compressed.
+        std::vector<unsigned char> compressed;
+    };
+
+    static bool loadWav(Stream* stream, bool streamed, AudioStreamStateWav* streamState, Samples* samples);
     
-    static bool loadOgg(Stream* stream, ALuint buffer, bool streamed, AudioStreamStateOgg* streamState);
+    static bool loadOgg(Stream* stream, bool streamed, AudioStreamStateOgg* streamState, Samples* samples);
+
+    /**
+     * Reads the file of the buffer and decodes its samples, or the first part of them if it is streamed.
+     */
+    bool load(Samples* samples);
+
+    /**
+     * Uploads decoded samples to the first OpenAL buffer.
+     *
+     * @return The number of bytes uploaded.
+     */
+    size_t upload(Samples* samples);
+
+    /**
+     * Compresses 16 bit samples to the IMA4 ADPCM blocks of the AL_EXT_IMA4 extension, at about a quarter of their size.
+     */
+    static void encodeIma4(Samples* samples);
 
-    bool streamData(ALuint buffer, bool looped);
+    static void decodeAsync(void* cookie);
+
+    /**
+     * Uploads the sounds that have been decoded.
+     */
+    static void updateAsync();
+
+    /**
+     * Decodes the next part of the stream into a buffer.
+     *
+     * @param buffer The OpenAL buffer to fill.
+     * @param looped Whether to continue from the start of the stream when it ends.
+     * @param data The decode buffer of STREAMING_BUFFER_SIZE bytes.
+     */
+    bool streamData(ALuint buffer, bool looped, char* data);
 
     ALuint _alBufferQueue[STREAMING_BUFFER_QUEUE_SIZE];
     std::string _filePath;
@@ -77,6 +150,12 @@ private:
     std::unique_ptr<AudioStreamStateWav> _streamStateWav;
     std::unique_ptr<AudioStreamStateOgg> _streamStateOgg;
     int _buffersNeededCount;
+    float _duration;
+    bool _compressed;
+    bool _loading;
+    Samples* _samples;
+    JobSystem::Job* _job;
+    size_t _memorySize;
 };
 
 }
@@ -4,11 +4,32 @@
 #include "AudioBuffer.h"
 #include "AudioSource.h"
 
+// The number of sources that are mixed at once by default, besides the streamed ones
+#define DEFAULT_AUDIO_VOICE_BUDGET 32
+
 namespace gameplay
 {
 
+/**
+ * A playing source that competes for a voice.
+ */
+struct VoiceCandidate
+{
+    AudioSource* source;
+    int priority;
+    float loudness;
+
+    bool operator<(const VoiceCandidate& other) const
+    {
+        if (priority != other.priority)
+            return priority > other.priority;
+        return loudness > other.loudness;
+    }
+};
+
 AudioController::AudioController() 
-: _alcDevice(NULL), _alcContext(NULL), _pausingSource(NULL), _streamingThreadActive(true)
+: _alcDevice(NULL), _alcContext(NULL), _pausingSource(NULL), _voiceBudget(DEFAULT_AUDIO_VOICE_BUDGET), _voiceCount(0),
+  _soundCompression(false), _ima4Supported(false), _streamingThreadActive(true), _streamingCommandHead(0), _streamingCommandTail(0)
 {
 }
 
@@ -40,18 +61,31 @@ void AudioController::initialize()
     {
         GP_ERROR("Unable to make OpenAL context current. Error: %d\n", alcErr);
     }
+    _ima4Supported = alIsExtensionPresent("AL_EXT_IMA4") == AL_TRUE;
     _streamingMutex.reset(new std::mutex());
 }
 
 void AudioController::finalize()
 {
-    GP_ASSERT(_streamingSources.empty());
     if (_streamingThread.get())
     {
         _streamingThreadActive = false;
+        _streamingWake.notify_one();
         _streamingThread->join();
         _streamingThread.reset(NULL);
     }
+    popStreamingCommands();
+    GP_ASSERT(_streamingSources.empty());
+
+    // Release the sounds that the cache is keeping loaded while the context is still current.
+    AudioBuffer::getCache()->clear();
+
+    if (!_freeVoices.empty())
+    {
+        AL_CHECK( alDeleteSources((ALsizei)_freeVoices.size(), &_freeVoices[0]) );
+        _voiceCount -= (unsigned int)_freeVoices.size();
+        _freeVoices.clear();
+    }
 
     alcMakeContextCurrent(NULL);
     if (_alcContext)
@@ -102,6 +136,14 @@ void AudioController::resume()
 
 void AudioController::update(float elapsedTime)
 {
+    // Upload the sounds that have been decoded, so that the sources waiting for them can get voices.
+    AudioBuffer::updateAsync();
+
+    // The listener and the sources that moved this frame are set together, with the processing of the
+    // context suspended, so that the mixer applies the whole batch at once. Virtual sources have no
+    // voice to set, so only the positions that rank them are updated.
+    if (_alcContext)
+        alcSuspendContext(_alcContext);
     AudioListener* listener = AudioListener::getInstance();
     if (listener)
     {
@@ -110,24 +152,205 @@ void AudioController::update(float elapsedTime)
         AL_CHECK( alListenerfv(AL_VELOCITY, (ALfloat*)&listener->getVelocity()) );
         AL_CHECK( alListenerfv(AL_POSITION, (ALfloat*)&listener->getPosition()) );
     }
+    for (size_t i = 0, count = _movedSources.size(); i < count; ++i)
+    {
+        _movedSources[i]->updatePosition();
+    }
+    _movedSources.clear();
+    if (_alcContext)
+        alcProcessContext(_alcContext);
+
+    updateVoices(elapsedTime);
+}
+
+void AudioController::setVoiceBudget(unsigned int voices)
+{
+    _voiceBudget = voices;
+
+    // Free the voices that are over the budget; the next update takes them from the least important sources.
+    while (_voiceCount > _voiceBudget && !_freeVoices.empty())
+    {
+        AL_CHECK( alDeleteSources(1, &_freeVoices.back()) );
+        _freeVoices.pop_back();
+        --_voiceCount;
+    }
+}
+
+unsigned int AudioController::getVoiceBudget() const
+{
+    return _voiceBudget;
+}
+
+unsigned int AudioController::getVoiceCount() const
+{
+    return _voiceCount - (unsigned int)_freeVoices.size();
+}
+
+void AudioController::setSoundCompression(bool compressed)
+{
+    if (compressed && !_ima4Supported)
+    {
+        GP_WARN("Sounds are not compressed; the audio device does not support the AL_EXT_IMA4 extension.");
+        compressed = false;
+    }
+    _soundCompression = compressed;
+}
+
+bool AudioController::isSoundCompression() const
+{
+    return _soundCompression;
+}
+
+unsigned int AudioController::getVirtualCount() const
+{
+    unsigned int count = 0;
+    for (std::set<AudioSource*>::const_iterator itr = _playingSources.begin(); itr != _playingSources.end(); ++itr)
+    {
+        if ((*itr)->isVirtual())
+            ++count;
+    }
+    return count;
+}
+
+void AudioController::updateVoices(float elapsedTime)
+{
+    AudioListener* listener = AudioListener::getInstance();
+    Vector3 listenerPosition = listener ? listener->getPosition() : Vector3::zero();
+
+    // Finish the sources that played to their end, move the virtual ones forward and rank the others.
+    static std::vector<VoiceCandidate> candidates;
+    static std::vector<AudioSource*> finished;
+    candidates.clear();
+    finished.clear();
+    for (std::set<AudioSource*>::iterator itr = _playingSources.begin(); itr != _playingSources.end(); ++itr)
+    {
+        AudioSource* source = *itr;
+        GP_ASSERT(source);
+
+        // Streamed sources keep their own OpenAL source, and sources paused by the controller keep their place.
+        if (source->isStreamed() || source->_state != AudioSource::PLAYING)
+            continue;
+
+        if (source->_alSource ? source->getState() == AudioSource::STOPPED : !source->advance(elapsedTime))
+        {
+            finished.push_back(source);
+            continue;
+        }
+        if (source->_buffer->_loading)
+            continue;
+
+        // Sources that cannot be heard play virtually whatever their priority.
+        float distance = listenerPosition.distance(source->_position);
+        if (source->_gain <= 0.0f || (source->_maxDistance > 0.0f && distance > source->_maxDistance))
+        {
+            if (source->_alSource)
+                releaseVoice(source->unbindVoice());
+            continue;
+        }
+
+        // Sources of the same priority get voices by their loudness under the default inverse distance model.
+        VoiceCandidate candidate;
+        candidate.source = source;
+        candidate.priority = source->_priority;
+        candidate.loudness = source->_gain / std::max(distance, 1.0f);
+        candidates.push_back(candidate);
+    }
+
+    for (size_t i = 0, count = finished.size(); i < count; ++i)
+    {
+        AudioSource* source = finished[i];
+        if (source->_alSource)
+            releaseVoice(source->unbindVoice());
+        source->_state = AudioSource::STOPPED;
+        source->_offset = 0.0f;
+        removePlayingSource(source);
+    }
+
+    // The most important sources up to the budget get the voices. The others release theirs first,
+    // so that the voices are free for the sources that take them.
+    size_t audible = std::min(candidates.size(), (size_t)_voiceBudget);
+    if (audible < candidates.size())
+        std::nth_element(candidates.begin(), candidates.begin() + audible, candidates.end());
+    for (size_t i = audible, count = candidates.size(); i < count; ++i)
+    {
+        AudioSource* source = candidates[i].source;
+        if (source->_alSource)
+            releaseVoice(source->unbindVoice());
+    }
+    for (size_t i = 0; i < audible; ++i)
+    {
+        AudioSource* source = candidates[i].source;
+        if (source->_alSource == 0)
+        {
+            ALuint voice = acquireVoice();
+            if (voice == 0)
+                break;
+            source->bindVoice(voice);
+        }
+    }
+}
+
+ALuint AudioController::acquireVoice()
+{
+    if (!_freeVoices.empty())
+    {
+        ALuint voice = _freeVoices.back();
+        _freeVoices.pop_back();
+        return voice;
+    }
+    if (_voiceCount >= _voiceBudget)
+        return 0;
+
+    ALuint voice = 0;
+    AL_CHECK( alGenSources(1, &voice) );
+    if (AL_LAST_ERROR())
+    {
+        // The device has fewer sources than the budget, so keep to the ones it has.
+        GP_WARN("The audio device has only %u voices; the voice budget is lowered from %u.", _voiceCount, _voiceBudget);
+        _voiceBudget = _voiceCount;
+        return 0;
+    }
+    ++_voiceCount;
+    return voice;
+}
+
+void AudioController::releaseVoice(ALuint voice)
+{
+    GP_ASSERT(voice);
+    if (_voiceCount > _voiceBudget)
+    {
+        AL_CHECK( alDeleteSources(1, &voice) );
+        --_voiceCount;
+    }
+    else
+    {
+        _freeVoices.push_back(voice);
+    }
 }
 
 void AudioController::addPlayingSource(AudioSource* source)
 {
+    // Start mixing the source right away if a voice is free; otherwise it plays virtually until the next update.
+    if (!source->isStreamed() && source->_alSource == 0 && !source->_buffer->_loading)
+    {
+        ALuint voice = acquireVoice();
+        if (voice)
+            source->bindVoice(voice);
+    }
+
     if (_playingSources.find(source) == _playingSources.end())
     {
         _playingSources.insert(source);
 
         if (source->isStreamed())
         {
-            GP_ASSERT(_streamingSources.find(source) == _streamingSources.end());
-            bool startThread = _streamingSources.empty() && _streamingThread.get() == NULL;
-            _streamingMutex->lock();
-            _streamingSources.insert(source);
-            _streamingMutex->unlock();
+            pushStreamingCommand(source, source->_streamingBuffers);
 
-            if (startThread)
+            if (_streamingThread.get() == NULL)
+            {
+                _streamingData.resize(AudioBuffer::STREAMING_BUFFER_SIZE);
                 _streamingThread.reset(new std::thread(&streamingThreadProc, this));
+            }
         }
     }
 }
@@ -142,29 +365,95 @@ void AudioController::removePlayingSource(AudioSource* source)
             _playingSources.erase(iter);
  
             if (source->isStreamed())
-            {
-                GP_ASSERT(_streamingSources.find(source) != _streamingSources.end());
-                _streamingMutex->lock();
-                _streamingSources.erase(source);
-                _streamingMutex->unlock();
-            }
+                pushStreamingCommand(source, 0);
         }
     } 
 }
 
+unsigned int AudioController::pushStreamingCommand(AudioSource* source, unsigned int buffers)
+{
+    // Only the game thread moves the head and only the streaming thread moves the tail.
+    unsigned int head = _streamingCommandHead.load(std::memory_order_relaxed);
+    while (head - _streamingCommandTail.load(std::memory_order_acquire) >= STREAMING_COMMAND_QUEUE_SIZE)
+    {
+        _streamingWake.notify_one();
+        std::this_thread::yield();
+    }
+
+    StreamingSource& command = _streamingCommands[head % STREAMING_COMMAND_QUEUE_SIZE];
+    command.source = source;
+    command.buffers = buffers;
+    _streamingCommandHead.store(head + 1, std::memory_order_release);
+    _streamingWake.notify_one();
+    return head + 1;
+}
+
+void AudioController::waitStreamingCommand(unsigned int count)
+{
+    while ((int)(count - _streamingCommandTail.load(std::memory_order_acquire)) > 0)
+    {
+        if (_streamingThread.get() == NULL)
+        {
+            popStreamingCommands();
+            break;
+        }
+        _streamingWake.notify_one();
+        std::this_thread::yield();
+    }
+}
+
+void AudioController::popStreamingCommands()
+{
+    unsigned int tail = _streamingCommandTail.load(std::memory_order_relaxed);
+    unsigned int head = _streamingCommandHead.load(std::memory_order_acquire);
+    for (; tail != head; ++tail)
+    {
+        const StreamingSource& command = _streamingCommands[tail % STREAMING_COMMAND_QUEUE_SIZE];
+        std::vector<StreamingSource>::iterator itr = _streamingSources.begin();
+        while (itr != _streamingSources.end() && itr->source != command.source)
+            ++itr;
+
+        if (command.buffers == 0)
+        {
+            if (itr != _streamingSources.end())
+                _streamingSources.erase(itr);
+        }
+        else if (itr == _streamingSources.end())
+        {
+            _streamingSources.push_back(command);
+        }
+        else
+        {
+            itr->buffers = command.buffers;
+        }
+
+        // Once the tail passes a command that removes a source, the source is no longer streamed and can be deleted.
+        _streamingCommandTail.store(tail + 1, std::memory_order_release);
+    }
+}
+
 void AudioController::streamingThreadProc(void* arg)
 {
     AudioController* controller = (AudioController*)arg;
 
     while (controller->_streamingThreadActive)
     {
-        controller->_streamingMutex->lock();
+        controller->popStreamingCommands();
 
-        std::for_each(controller->_streamingSources.begin(), controller->_streamingSources.end(), std::mem_fn(&AudioSource::streamDataIfNeeded));
-        
-        controller->_streamingMutex->unlock();
-   
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        for (size_t i = 0, count = controller->_streamingSources.size(); i < count; ++i)
+        {
+            const StreamingSource& streamingSource = controller->_streamingSources[i];
+            streamingSource.source->streamDataIfNeeded(streamingSource.buffers, &controller->_streamingData[0]);
+        }
+
+        // Sleep until more data is needed, or until the game thread sends a command. The mutex is only
+        // locked by this thread; the game thread wakes it without waiting for it.
+        std::unique_lock<std::mutex> lock(*controller->_streamingMutex);
+        if (controller->_streamingThreadActive &&
+            controller->_streamingCommandHead.load(std::memory_order_acquire) == controller->_streamingCommandTail.load(std::memory_order_relaxed))
+        {
+            controller->_streamingWake.wait_for(lock, std::chrono::milliseconds(50));
+        }
     }
 }
 
@@ -9,11 +9,16 @@ class AudioSource;
 
 /**
  * Defines a class for controlling game audio.
+ *
+ * Streamed sources are decoded on a streaming thread. The game thread tells it which sources play
+ * through a queue of commands that neither thread locks, so that playing and stopping sources never
+ * waits for a source to be decoded.
  */
 class AudioController
 {
     friend class Game;
     friend class AudioSource;
+    friend class AudioBuffer;
 
 public:
     
@@ -22,6 +27,62 @@ public:
      */
     virtual ~AudioController();
 
+    /**
+     * Sets the largest number of sources that are mixed at once, besides the streamed sources.
+     *
+     * The playing sources that do not get a voice play virtually. The budget can also be set with
+     * the 'voices' property of the 'audio' namespace of the game config. The default is 32.
+     *
+     * @param voices The number of voices.
+     * @script{ignore}
+     */
+    void setVoiceBudget(unsigned int voices);
+
+    /**
+     * Returns the largest number of sources that are mixed at once, besides the streamed sources.
+     *
+     * @return The number of voices.
+     * @script{ignore}
+     */
+    unsigned int getVoiceBudget() const;
+
+    /**
+     * Returns the number of sources that are currently mixed with a voice.
+     *
+     * @return The number of voices in use.
+     * @script{ignore}
+     */
+    unsigned int getVoiceCount() const;
+
+    /**
+     * Returns the number of sources that are currently playing without a voice.
+     *
+     * @return The number of virtual sources.
+     * @script{ignore}
+     */
+    unsigned int getVirtualCount() const;
+
+    /**
+     * Sets whether the sounds that are loaded from then on, other than streamed ones, are compressed.
+     *
+     * Compressed sounds are stored as IMA4 ADPCM, which takes about a quarter of the memory of 16 bit
+     * samples at a small loss of quality. This suits short sounds that are played often, and can also
+     * be set with the 'compressSounds' property of the 'audio' namespace of the game config. Sounds
+     * are only compressed if the device supports the AL_EXT_IMA4 extension.
+     *
+     * @param compressed true to compress sounds, false to keep their samples as they are. The default is false.
+     * @script{ignore}
+     */
+    void setSoundCompression(bool compressed);
+
+    /**
+     * Determines whether the sounds that are loaded are compressed.
+     *
+     * @return true if sounds are compressed, false otherwise.
+     * @script{ignore}
+     */
+    bool isSoundCompression() const;
+
 private:
     
     /**
@@ -58,17 +119,71 @@ private:
     
     void removePlayingSource(AudioSource* source);
 
+    /**
+     * Gives the most important playing sources a voice and makes the others virtual.
+     */
+    void updateVoices(float elapsedTime);
+
+    /**
+     * Returns a free voice, creating one if the budget allows.
+     *
+     * @return The voice, or 0 if every voice is in use.
+     */
+    ALuint acquireVoice();
+
+    void releaseVoice(ALuint voice);
+
+    /**
+     * A streamed source that plays on the streaming thread, or a command to the streaming thread.
+     */
+    enum { STREAMING_COMMAND_QUEUE_SIZE = 256 };
+
+    struct StreamingSource
+    {
+        AudioSource* source;
+        // The number of buffers to keep queued, or 0 in a command that removes the source.
+        unsigned int buffers;
+    };
+
+    /**
+     * Sends a command to the streaming thread, waiting if the queue is full.
+     *
+     * @return The number of commands that the streaming thread has taken once it took this one.
+     */
+    unsigned int pushStreamingCommand(AudioSource* source, unsigned int buffers);
+
+    /**
+     * Waits until the streaming thread has taken a command.
+     */
+    void waitStreamingCommand(unsigned int count);
+
+    /**
+     * Applies the commands that were sent to the streaming thread.
+     */
+    void popStreamingCommands();
+
     static void streamingThreadProc(void* arg);
 
     ALCdevice* _alcDevice;
     ALCcontext* _alcContext;
     std::set<AudioSource*> _playingSources;
-    std::set<AudioSource*> _streamingSources;
+    std::vector<AudioSource*> _movedSources;
+    std::vector<StreamingSource> _streamingSources;
     AudioSource* _pausingSource;
+    unsigned int _voiceBudget;
+    unsigned int _voiceCount;
+    std::vector<ALuint> _freeVoices;
+    bool _soundCompression;
+    bool _ima4Supported;
 
-    bool _streamingThreadActive;
+    std::atomic<bool> _streamingThreadActive;
     std::unique_ptr<std::thread> _streamingThread;
     std::unique_ptr<std::mutex> _streamingMutex;
+    std::condition_variable _streamingWake;
+    StreamingSource _streamingCommands[STREAMING_COMMAND_QUEUE_SIZE];
+    std::atomic<unsigned int> _streamingCommandHead;
+    std::atomic<unsigned int> _streamingCommandTail;
+    std::vector<char> _streamingData;
 };
 
 }
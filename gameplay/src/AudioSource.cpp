@@ -10,37 +10,54 @@ namespace gameplay
 {
 
 AudioSource::AudioSource(AudioBuffer* buffer, ALuint source) 
-    : _alSource(source), _buffer(buffer), _looped(false), _gain(1.0f), _pitch(1.0f), _node(NULL)
+    : _alSource(source), _buffer(buffer), _looped(false), _gain(1.0f), _pitch(1.0f), _positionDirty(false), _node(NULL),
+      _state(INITIAL), _offset(0.0f), _priority(0), _maxDistance(0.0f),
+      _streamingBuffers(AudioBuffer::STREAMING_BUFFER_QUEUE_DEFAULT)
 {
     GP_ASSERT(buffer);
 
     if (isStreamed())
+    {
+        GP_ASSERT(_alSource);
         AL_CHECK(alSourceQueueBuffers(_alSource, 1, &buffer->_alBufferQueue[0]));
-    else
-        AL_CHECK(alSourcei(_alSource, AL_BUFFER, buffer->_alBufferQueue[0]));
-    
-    AL_CHECK(alSourcei(_alSource, AL_LOOPING, _looped && !isStreamed()));
-    
-    AL_CHECK( alSourcef(_alSource, AL_PITCH, _pitch) );
-    AL_CHECK( alSourcef(_alSource, AL_GAIN, _gain) );
-    AL_CHECK( alSourcefv(_alSource, AL_VELOCITY, (const ALfloat*)&_velocity) );
+        AL_CHECK(alSourcei(_alSource, AL_LOOPING, AL_FALSE));
+        AL_CHECK( alSourcef(_alSource, AL_PITCH, _pitch) );
+        AL_CHECK( alSourcef(_alSource, AL_GAIN, _gain) );
+        AL_CHECK( alSourcefv(_alSource, AL_VELOCITY, (const ALfloat*)&_velocity) );
+    }
 }
 
 AudioSource::~AudioSource()
 {
-    if (_alSource)
+    // Remove the source from the controller's set of currently playing sources
+    // regardless of the source's state. E.g. when the AudioController::pause is called
+    // all sources are paused but still remain in controller's set of currently 
+    // playing sources. When the source is deleted afterwards, it should be removed
+    // from controller's set regardless of its playing state.
+    AudioController* audioController = Game::getInstance()->getAudioController();
+    GP_ASSERT(audioController);
+    audioController->removePlayingSource(this);
+
+    if (_positionDirty)
     {
-        // Remove the source from the controller's set of currently playing sources
-        // regardless of the source's state. E.g. when the AudioController::pause is called
-        // all sources are paused but still remain in controller's set of currently 
-        // playing sources. When the source is deleted afterwards, it should be removed
-        // from controller's set regardless of its playing state.
-        AudioController* audioController = Game::getInstance()->getAudioController();
-        GP_ASSERT(audioController);
-        audioController->removePlayingSource(this);
+        std::vector<AudioSource*>::iterator itr = std::find(audioController->_movedSources.begin(), audioController->_movedSources.end(), this);
+        if (itr != audioController->_movedSources.end())
+            audioController->_movedSources.erase(itr);
+    }
 
-        AL_CHECK(alDeleteSources(1, &_alSource));
-        _alSource = 0;
+    if (_alSource)
+    {
+        if (isStreamed())
+        {
+            // Wait for the streaming thread to stop decoding into the source before it goes away.
+            audioController->waitStreamingCommand(audioController->_streamingCommandHead.load());
+            AL_CHECK(alDeleteSources(1, &_alSource));
+            _alSource = 0;
+        }
+        else
+        {
+            audioController->releaseVoice(unbindVoice());
+        }
     }
     SAFE_RELEASE(_buffer);
 }
@@ -68,15 +85,17 @@ AudioSource* AudioSource::create(const char* url, bool streamed)
     if (buffer == NULL)
         return NULL;
 
-    // Load the audio source.
+    // Streamed sources keep their own OpenAL source for their queue of buffers; the others are given voices as they play.
     ALuint alSource = 0;
-
-    AL_CHECK( alGenSources(1, &alSource) );
-    if (AL_LAST_ERROR())
+    if (streamed)
     {
-        SAFE_RELEASE(buffer);
-        GP_ERROR("Error generating audio source.");
-        return NULL;
+        AL_CHECK( alGenSources(1, &alSource) );
+        if (AL_LAST_ERROR())
+        {
+            SAFE_RELEASE(buffer);
+            GP_ERROR("Error generating audio source.");
+            return NULL;
+        }
     }
     
     return new AudioSource(buffer, alSource);
@@ -131,12 +150,37 @@ AudioSource* AudioSource::create(Properties* properties)
     {
         audio->setVelocity(v);
     }
+    if (properties->exists("priority"))
+    {
+        audio->setPriority(properties->getInt("priority"));
+    }
+    if (properties->exists("maxDistance"))
+    {
+        audio->setMaxDistance(properties->getFloat("maxDistance"));
+    }
+    if (properties->exists("streamingBuffers"))
+    {
+        audio->setStreamingBuffers((unsigned int)std::max(0, properties->getInt("streamingBuffers")));
+    }
 
     return audio;
 }
 
 AudioSource::State AudioSource::getState() const
 {
+    if (!isStreamed())
+    {
+        // A mixed source may have reached its end since the controller last updated its voices.
+        if (_state == PLAYING && _alSource)
+        {
+            ALint state;
+            AL_CHECK( alGetSourcei(_alSource, AL_SOURCE_STATE, &state) );
+            if (state == AL_STOPPED)
+                return STOPPED;
+        }
+        return _state;
+    }
+
     ALint state;
     AL_CHECK( alGetSourcei(_alSource, AL_SOURCE_STATE, &state) );
 
@@ -162,9 +206,23 @@ bool AudioSource::isStreamed() const
 
 void AudioSource::play()
 {
-    AL_CHECK( alSourcePlay(_alSource) );
+    if (isStreamed())
+    {
+        AL_CHECK( alSourcePlay(_alSource) );
+    }
+    else
+    {
+        // Like an OpenAL source, a source that is paused resumes and any other source starts from the beginning.
+        if (_state != PAUSED)
+        {
+            _offset = 0.0f;
+            if (_alSource)
+                AL_CHECK( alSourcePlay(_alSource) );
+        }
+        _state = PLAYING;
+    }
 
-    // Add the source to the controller's list of currently playing sources.
+    // Add the source to the controller's list of currently playing sources, which gives it a voice if one is free.
     AudioController* audioController = Game::getInstance()->getAudioController();
     GP_ASSERT(audioController);
     audioController->addPlayingSource(this);
@@ -172,12 +230,23 @@ void AudioSource::play()
 
 void AudioSource::pause()
 {
-    AL_CHECK( alSourcePause(_alSource) );
+    AudioController* audioController = Game::getInstance()->getAudioController();
+    GP_ASSERT(audioController);
+
+    if (isStreamed())
+    {
+        AL_CHECK( alSourcePause(_alSource) );
+    }
+    else if (getState() == PLAYING)
+    {
+        // Paused sources do not hold on to their voice.
+        if (_alSource)
+            audioController->releaseVoice(unbindVoice());
+        _state = PAUSED;
+    }
 
     // Remove the source from the controller's set of currently playing sources
     // if the source is being paused by the user and not the controller itself.
-    AudioController* audioController = Game::getInstance()->getAudioController();
-    GP_ASSERT(audioController);
     audioController->removePlayingSource(this);
 }
 
@@ -191,17 +260,41 @@ void AudioSource::resume()
 
 void AudioSource::stop()
 {
-    AL_CHECK( alSourceStop(_alSource) );
-
-    // Remove the source from the controller's set of currently playing sources.
     AudioController* audioController = Game::getInstance()->getAudioController();
     GP_ASSERT(audioController);
+
+    if (isStreamed())
+    {
+        AL_CHECK( alSourceStop(_alSource) );
+    }
+    else
+    {
+        if (_alSource)
+            audioController->releaseVoice(unbindVoice());
+        _state = STOPPED;
+        _offset = 0.0f;
+    }
+
+    // Remove the source from the controller's set of currently playing sources.
     audioController->removePlayingSource(this);
 }
 
 void AudioSource::rewind()
 {
-    AL_CHECK( alSourceRewind(_alSource) );
+    if (isStreamed())
+    {
+        AL_CHECK( alSourceRewind(_alSource) );
+        return;
+    }
+
+    // Like an OpenAL source, a rewound source goes back to its initial state.
+    AudioController* audioController = Game::getInstance()->getAudioController();
+    GP_ASSERT(audioController);
+    if (_alSource)
+        audioController->releaseVoice(unbindVoice());
+    _state = INITIAL;
+    _offset = 0.0f;
+    audioController->removePlayingSource(this);
 }
 
 bool AudioSource::isLooped() const
@@ -211,10 +304,13 @@ bool AudioSource::isLooped() const
 
 void AudioSource::setLooped(bool looped)
 {
-    AL_CHECK(alSourcei(_alSource, AL_LOOPING, (looped && !isStreamed()) ? AL_TRUE : AL_FALSE));
-    if (AL_LAST_ERROR())
+    if (_alSource)
     {
-        GP_ERROR("Failed to set audio source's looped attribute with error: %d", AL_LAST_ERROR());
+        AL_CHECK(alSourcei(_alSource, AL_LOOPING, (looped && !isStreamed()) ? AL_TRUE : AL_FALSE));
+        if (AL_LAST_ERROR())
+        {
+            GP_ERROR("Failed to set audio source's looped attribute with error: %d", AL_LAST_ERROR());
+        }
     }
     _looped = looped;
 }
@@ -226,7 +322,8 @@ float AudioSource::getGain() const
 
 void AudioSource::setGain(float gain)
 {
-    AL_CHECK( alSourcef(_alSource, AL_GAIN, gain) );
+    if (_alSource)
+        AL_CHECK( alSourcef(_alSource, AL_GAIN, gain) );
     _gain = gain;
 }
 
@@ -237,7 +334,8 @@ float AudioSource::getPitch() const
 
 void AudioSource::setPitch(float pitch)
 {
-    AL_CHECK( alSourcef(_alSource, AL_PITCH, pitch) );
+    if (_alSource)
+        AL_CHECK( alSourcef(_alSource, AL_PITCH, pitch) );
     _pitch = pitch;
 }
 
@@ -248,7 +346,8 @@ const Vector3& AudioSource::getVelocity() const
 
 void AudioSource::setVelocity(const Vector3& velocity)
 {
-    AL_CHECK( alSourcefv(_alSource, AL_VELOCITY, (ALfloat*)&velocity) );
+    if (_alSource)
+        AL_CHECK( alSourcefv(_alSource, AL_VELOCITY, (ALfloat*)&velocity) );
     _velocity = velocity;
 }
 
@@ -257,6 +356,41 @@ void AudioSource::setVelocity(float x, float y, float z)
     setVelocity(Vector3(x, y, z));
 }
 
+int AudioSource::getPriority() const
+{
+    return _priority;
+}
+
+void AudioSource::setPriority(int priority)
+{
+    _priority = priority;
+}
+
+float AudioSource::getMaxDistance() const
+{
+    return _maxDistance;
+}
+
+void AudioSource::setMaxDistance(float distance)
+{
+    _maxDistance = std::max(0.0f, distance);
+}
+
+bool AudioSource::isVirtual() const
+{
+    return !isStreamed() && _state == PLAYING && _alSource == 0;
+}
+
+unsigned int AudioSource::getStreamingBuffers() const
+{
+    return _streamingBuffers;
+}
+
+void AudioSource::setStreamingBuffers(unsigned int buffers)
+{
+    _streamingBuffers = std::min(std::max(buffers, 2u), (unsigned int)AudioBuffer::STREAMING_BUFFER_QUEUE_SIZE);
+}
+
 Node* AudioSource::getNode() const
 {
     return _node;
@@ -286,10 +420,25 @@ void AudioSource::setNode(Node* node)
 
 void AudioSource::transformChanged(Transform* transform, long cookie)
 {
-    if (_node)
+    // Nodes can move several times in a frame, so the position is only set once, by the next update of the controller.
+    if (_node && !_positionDirty)
     {
-        Vector3 translation = _node->getTranslationWorld();
-        AL_CHECK( alSourcefv(_alSource, AL_POSITION, (const ALfloat*)&translation.x) );
+        _positionDirty = true;
+        Game::getInstance()->getAudioController()->_movedSources.push_back(this);
+    }
+}
+
+void AudioSource::updatePosition()
+{
+    if (_positionDirty)
+    {
+        _positionDirty = false;
+        if (_node)
+        {
+            _position = _node->getTranslationWorld();
+            if (_alSource)
+                AL_CHECK( alSourcefv(_alSource, AL_POSITION, (const ALfloat*)&_position.x) );
+        }
     }
 }
 
@@ -298,11 +447,14 @@ AudioSource* AudioSource::clone(NodeCloneContext& context)
     GP_ASSERT(_buffer);
 
     ALuint alSource = 0;
-    AL_CHECK( alGenSources(1, &alSource) );
-    if (AL_LAST_ERROR())
+    if (isStreamed())
     {
-        GP_ERROR("Unable to cloning audio.");
-        return NULL;
+        AL_CHECK( alGenSources(1, &alSource) );
+        if (AL_LAST_ERROR())
+        {
+            GP_ERROR("Unable to cloning audio.");
+            return NULL;
+        }
     }
     AudioSource* audioClone = new AudioSource(_buffer, alSource);
 
@@ -311,6 +463,9 @@ AudioSource* AudioSource::clone(NodeCloneContext& context)
     audioClone->setGain(getGain());
     audioClone->setPitch(getPitch());
     audioClone->setVelocity(getVelocity());
+    audioClone->setPriority(getPriority());
+    audioClone->setMaxDistance(getMaxDistance());
+    audioClone->setStreamingBuffers(getStreamingBuffers());
     if (Node* node = getNode())
     {
         Node* clonedNode = context.findClonedNode(node);
@@ -322,7 +477,7 @@ AudioSource* AudioSource::clone(NodeCloneContext& context)
     return audioClone;
 }
 
-bool AudioSource::streamDataIfNeeded()
+bool AudioSource::streamDataIfNeeded(unsigned int buffers, char* data)
 {
     GP_ASSERT( isStreamed() );
     if( getState() != PLAYING )
@@ -331,12 +486,12 @@ bool AudioSource::streamDataIfNeeded()
     int queuedBuffers;
     alGetSourcei(_alSource, AL_BUFFERS_QUEUED, &queuedBuffers);
  
-    int buffersNeeded = std::min<int>(_buffer->_buffersNeededCount, AudioBuffer::STREAMING_BUFFER_QUEUE_SIZE);
+    int buffersNeeded = std::min<int>(_buffer->_buffersNeededCount, (int)buffers);
     if (queuedBuffers < buffersNeeded)
     {
         while (queuedBuffers < buffersNeeded)
         {
-            if (!_buffer->streamData(_buffer->_alBufferQueue[queuedBuffers], _looped))
+            if (!_buffer->streamData(_buffer->_alBufferQueue[queuedBuffers], _looped, data))
                 return false;
             
             AL_CHECK( alSourceQueueBuffers(_alSource, 1, &_buffer->_alBufferQueue[queuedBuffers]) );
@@ -352,7 +507,7 @@ bool AudioSource::streamDataIfNeeded()
         {
             ALuint bufferID;
             AL_CHECK( alSourceUnqueueBuffers(_alSource, 1, &bufferID) );
-            if (!_buffer->streamData(bufferID, _looped))
+            if (!_buffer->streamData(bufferID, _looped, data))
                 return false;
             
             AL_CHECK( alSourceQueueBuffers(_alSource, 1, &bufferID) );
@@ -361,4 +516,60 @@ bool AudioSource::streamDataIfNeeded()
     return true;
 }
 
+
+void AudioSource::bindVoice(ALuint voice)
+{
+    GP_ASSERT(voice);
+    GP_ASSERT(!isStreamed());
+    GP_ASSERT(_alSource == 0);
+    GP_ASSERT(!_buffer->_loading);
+
+    updatePosition();
+    _alSource = voice;
+    AL_CHECK( alSourcei(_alSource, AL_BUFFER, _buffer->_alBufferQueue[0]) );
+    AL_CHECK( alSourcei(_alSource, AL_LOOPING, _looped ? AL_TRUE : AL_FALSE) );
+    AL_CHECK( alSourcef(_alSource, AL_PITCH, _pitch) );
+    AL_CHECK( alSourcef(_alSource, AL_GAIN, _gain) );
+    AL_CHECK( alSourcefv(_alSource, AL_VELOCITY, (const ALfloat*)&_velocity) );
+    AL_CHECK( alSourcefv(_alSource, AL_POSITION, (const ALfloat*)&_position.x) );
+    AL_CHECK( alSourcef(_alSource, AL_SEC_OFFSET, _offset) );
+    AL_CHECK( alSourcePlay(_alSource) );
+}
+
+ALuint AudioSource::unbindVoice()
+{
+    GP_ASSERT(_alSource);
+
+    ALuint voice = _alSource;
+    ALint state;
+    AL_CHECK( alGetSourcei(voice, AL_SOURCE_STATE, &state) );
+    if (state == AL_PLAYING || state == AL_PAUSED)
+        AL_CHECK( alGetSourcef(voice, AL_SEC_OFFSET, &_offset) );
+    else if (state == AL_STOPPED)
+        _offset = _buffer->_duration;
+    AL_CHECK( alSourceStop(voice) );
+    AL_CHECK( alSourcei(voice, AL_BUFFER, 0) );
+    _alSource = 0;
+    return voice;
+}
+
+bool AudioSource::advance(float elapsedTime)
+{
+    // Sources start playing once their sound is loaded.
+    if (_buffer->_loading)
+        return true;
+
+    // OpenAL plays the buffer faster or slower with the pitch, in seconds.
+    const float duration = _buffer->_duration;
+    _offset += elapsedTime * 0.001f * _pitch;
+    if (_offset < duration)
+        return true;
+    if (_looped && duration > 0.0f)
+    {
+        _offset = fmodf(_offset, duration);
+        return true;
+    }
+    return false;
+}
+
 }
@@ -17,6 +17,14 @@ class NodeCloneContext;
  *
  * This can be attached to a Node for applying its 3D transformation.
  *
+ * Sources that are not streamed do not own an OpenAL source. While they play, the audio controller
+ * gives the most important of them one of a limited number of voices, and the others play virtually:
+ * they stay in the PLAYING state and keep track of their playback position without being mixed, so
+ * that they continue where they would be when they become audible again. Sources with a higher
+ * priority get voices first, and sources of the same priority get them by how loud they are at the
+ * position of the listener. Sources beyond their maximum distance from the listener are always virtual.
+ * Streamed sources, such as music, keep their own OpenAL source and always play.
+ *
  * @see http://gameplay3d.github.io/GamePlay/docs/file-formats.html#wiki-Audio
  */
 class AudioSource : public Ref, public Transform::Listener
@@ -162,6 +170,66 @@ public:
      */
     void setVelocity(float x, float y, float z);
 
+    /**
+     * Returns the priority of the audio source.
+     *
+     * @return The priority.
+     * @script{ignore}
+     */
+    int getPriority() const;
+
+    /**
+     * Sets the priority of the audio source, which decides which playing sources get a voice first.
+     *
+     * @param priority The priority, higher values being more important. The default is 0.
+     * @script{ignore}
+     */
+    void setPriority(int priority);
+
+    /**
+     * Returns the distance from the listener beyond which the audio source is not heard.
+     *
+     * @return The maximum distance, or 0 if the source is heard at any distance.
+     * @script{ignore}
+     */
+    float getMaxDistance() const;
+
+    /**
+     * Sets the distance from the listener beyond which the audio source is not heard, and plays virtually.
+     *
+     * @param distance The maximum distance, or 0 to hear the source at any distance. The default is 0.
+     * @script{ignore}
+     */
+    void setMaxDistance(float distance);
+
+    /**
+     * Determines whether the audio source is playing without a voice, only keeping track of its position.
+     *
+     * @return true if the source is playing virtually, false if it is mixed or not playing.
+     * @script{ignore}
+     */
+    bool isVirtual() const;
+
+    /**
+     * Returns the number of buffers that a streamed audio source decodes ahead of what it plays.
+     *
+     * @return The number of buffers.
+     * @script{ignore}
+     */
+    unsigned int getStreamingBuffers() const;
+
+    /**
+     * Sets the number of buffers that a streamed audio source decodes ahead of what it plays.
+     *
+     * Each buffer holds up to 48000 bytes of samples, which is a quarter of a second of 16 bit stereo
+     * audio at 48 kHz. More buffers survive longer stalls of the streaming thread, at the cost of memory.
+     * The number takes effect the next time that the source starts playing.
+     *
+     * @param buffers The number of buffers, from 2 to 8. The default is 3.
+     * @script{ignore}
+     */
+    void setStreamingBuffers(unsigned int buffers);
+
     /**
      * Gets the node that this source is attached to.
      * 
@@ -196,6 +264,11 @@ private:
      */
     void transformChanged(Transform* transform, long cookie);
 
+    /**
+     * Sets the position of the source from its node, if the node moved since the position was last set.
+     */
+    void updatePosition();
+
     /**
      * Clones the audio source and returns a new audio source.
      * 
@@ -204,7 +277,34 @@ private:
      */
     AudioSource* clone(NodeCloneContext& context);
 
-    bool streamDataIfNeeded();
+    /**
+     * Queues decoded buffers on a streamed source that is playing, up to a number of buffers.
+     *
+     * This runs on the streaming thread of the audio controller.
+     *
+     * @param buffers The number of buffers to keep queued.
+     * @param data The decode buffer of the streaming thread.
+     */
+    bool streamDataIfNeeded(unsigned int buffers, char* data);
+
+    /**
+     * Starts mixing the source with a voice, from its tracked playback position.
+     */
+    void bindVoice(ALuint voice);
+
+    /**
+     * Stops mixing the source, keeping its playback position.
+     *
+     * @return The voice that the source was mixed with.
+     */
+    ALuint unbindVoice();
+
+    /**
+     * Moves the playback position of a virtual source forward.
+     *
+     * @return false if the source reached its end.
+     */
+    bool advance(float elapsedTime);
 
     ALuint _alSource;
     AudioBuffer* _buffer;
@@ -212,7 +312,14 @@ private:
     float _gain;
     float _pitch;
     Vector3 _velocity;
+    Vector3 _position;
+    bool _positionDirty;
     Node* _node;
+    State _state;
+    float _offset;
+    int _priority;
+    float _maxDistance;
+    unsigned int _streamingBuffers;
 };
 
 }
@@ -22,6 +22,7 @@
 #include <set>
 #include <stack>
 #include <map>
+#include <unordered_map>
 #include <queue>
 #include <algorithm>
 #include <limits>
@@ -30,6 +31,8 @@
 #include <typeinfo>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <chrono>
 #include "Logger.h"
 
@@ -81,12 +84,24 @@ extern int strcmpnocase(const char* s1, const char* s2);
 #define GP_ASSERT(expression)
 #endif
 
+// Profiler markers are compiled into debug builds, and into other builds that define GP_USE_PROFILER.
+#if defined(_DEBUG) && !defined(GP_USE_PROFILER) && !defined(GP_NO_PROFILER)
+#define GP_USE_PROFILER
+#endif
+
 #if defined(WIN32) && defined(_MSC_VER)
 #define DEBUG_BREAK() __debugbreak()
 #else
 #define DEBUG_BREAK()
 #endif
 
+// Aligns a type to the specified number of bytes, for example: class GP_ALIGN(16) Matrix34 { ... };
+#ifdef _MSC_VER
+#define GP_ALIGN(bytes) __declspec(align(bytes))
+#else
+#define GP_ALIGN(bytes) __attribute__((aligned(bytes)))
+#endif
+
 // Error macro.
 #ifdef GP_ERRORS_AS_WARNINGS
 #define GP_ERROR GP_WARN
@@ -200,9 +215,14 @@ extern int strcmpnocase(const char* s1, const char* s2);
 // Image
 #include <png.h>
 
-// Scripting
+// Scripting (LuaJIT 2.1 replaces Lua 5.2 when GP_USE_LUAJIT is defined)
 using std::va_list;
-#include <lua/lua.hpp>
+#ifdef GP_USE_LUAJIT
+    #include <luajit/lua.hpp>
+    #include "LuaCompat.h"
+#else
+    #include <lua/lua.hpp>
+#endif
 
 #define WINDOW_VSYNC        1
 
@@ -215,18 +235,58 @@ using std::va_list;
     extern PFNGLDELETEVERTEXARRAYSOESPROC glDeleteVertexArrays;
     extern PFNGLGENVERTEXARRAYSOESPROC glGenVertexArrays;
     extern PFNGLISVERTEXARRAYOESPROC glIsVertexArray;
+    extern PFNGLGETPROGRAMBINARYOESPROC glGetProgramBinary;
+    extern PFNGLPROGRAMBINARYOESPROC glProgramBinary;
+    #define GL_PROGRAM_BINARY_LENGTH GL_PROGRAM_BINARY_LENGTH_OES
+    #define GL_NUM_PROGRAM_BINARY_FORMATS GL_NUM_PROGRAM_BINARY_FORMATS_OES
     #define GL_DEPTH24_STENCIL8 GL_DEPTH24_STENCIL8_OES
+    extern PFNGLGENQUERIESEXTPROC glGenQueries;
+    extern PFNGLDELETEQUERIESEXTPROC glDeleteQueries;
+    extern PFNGLQUERYCOUNTEREXTPROC glQueryCounter;
+    extern PFNGLGETQUERYOBJECTUI64VEXTPROC glGetQueryObjectui64v;
+    extern PFNGLGETINTEGER64VEXTPROC glGetInteger64v;
+    typedef GLint64EXT GLint64;
+    typedef GLuint64EXT GLuint64;
+    #define GL_TIMESTAMP GL_TIMESTAMP_EXT
+    #define GL_QUERY_RESULT GL_QUERY_RESULT_EXT
+    extern PFNGLRENDERBUFFERSTORAGEMULTISAMPLEEXTPROC glRenderbufferStorageMultisampleEXT;
+    extern PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC glFramebufferTexture2DMultisampleEXT;
+    extern PFNGLDISCARDFRAMEBUFFEREXTPROC glDiscardFramebufferEXT;
     #define glClearDepth glClearDepthf
     #define OPENGL_ES
+    #define GP_USE_PROGRAM_BINARY
+    #define GP_USE_GPU_TIMER
+    #define GP_USE_MULTISAMPLE_RENDER_TO_TEXTURE
+    #define GP_USE_FRAMEBUFFER_DISCARD
 #elif WIN32
         #define WIN32_LEAN_AND_MEAN
         #define GLEW_STATIC
         #include <GL/glew.h>
         #define GP_USE_VAO
+        #define GP_USE_INSTANCING
+        #define GP_USE_TRANSFORM_FEEDBACK
+        #define GP_USE_PROGRAM_BINARY
+        #define GP_USE_BUFFER_STREAMING
+        #define GP_USE_GPU_TIMER
+        #define GP_USE_MULTISAMPLE_BLIT
+        #define GP_USE_FRAMEBUFFER_INVALIDATE
+        #define GP_USE_TEXTURE_ARRAY
+        #define GP_USE_MULTI_DRAW_INDIRECT
+        #define GP_USE_SAMPLER_OBJECTS
 #elif __linux__
         #define GLEW_STATIC
         #include <GL/glew.h>
         #define GP_USE_VAO
+        #define GP_USE_INSTANCING
+        #define GP_USE_TRANSFORM_FEEDBACK
+        #define GP_USE_PROGRAM_BINARY
+        #define GP_USE_BUFFER_STREAMING
+        #define GP_USE_GPU_TIMER
+        #define GP_USE_MULTISAMPLE_BLIT
+        #define GP_USE_FRAMEBUFFER_INVALIDATE
+        #define GP_USE_TEXTURE_ARRAY
+        #define GP_USE_MULTI_DRAW_INDIRECT
+        #define GP_USE_SAMPLER_OBJECTS
 #elif __APPLE__
     #include "TargetConditionals.h"
     #if TARGET_OS_IPHONE || TARGET_IPHONE_SIMULATOR
@@ -240,6 +300,8 @@ using std::va_list;
         #define glClearDepth glClearDepthf
         #define OPENGL_ES
         #define GP_USE_VAO
+        #define GP_USE_MULTISAMPLE_APPLE
+        #define GP_USE_FRAMEBUFFER_DISCARD
     #elif TARGET_OS_MAC
         #include <OpenGL/gl.h>
         #include <OpenGL/glext.h>
@@ -253,6 +315,29 @@ using std::va_list;
     #endif
 #endif
 
+// Headless builds never create a graphics context, so none of the optional graphics features are used.
+#ifdef GP_HEADLESS
+    #undef GP_USE_VAO
+    #undef GP_USE_INSTANCING
+    #undef GP_USE_TRANSFORM_FEEDBACK
+    #undef GP_USE_PROGRAM_BINARY
+    #undef GP_USE_BUFFER_STREAMING
+    #undef GP_USE_GPU_TIMER
+    #undef GP_USE_MULTISAMPLE_BLIT
+    #undef GP_USE_FRAMEBUFFER_INVALIDATE
+    #undef GP_USE_TEXTURE_ARRAY
+    #undef GP_USE_MULTI_DRAW_INDIRECT
+    #undef GP_USE_SAMPLER_OBJECTS
+#endif
+
+// Texture arrays are part of OpenGL 3.0 and OpenGL ES 3.0.
+#ifndef GL_TEXTURE_2D_ARRAY
+#define GL_TEXTURE_2D_ARRAY 0x8C1A
+#endif
+#ifndef GL_SAMPLER_2D_ARRAY
+#define GL_SAMPLER_2D_ARRAY 0x8DC1
+#endif
+
 // Graphics (GLSL)
 #define VERTEX_ATTRIBUTE_POSITION_NAME              "a_position"
 #define VERTEX_ATTRIBUTE_NORMAL_NAME                "a_normal"
@@ -262,6 +347,8 @@ using std::va_list;
 #define VERTEX_ATTRIBUTE_BLENDWEIGHTS_NAME          "a_blendWeights"
 #define VERTEX_ATTRIBUTE_BLENDINDICES_NAME          "a_blendIndices"
 #define VERTEX_ATTRIBUTE_TEXCOORD_PREFIX_NAME       "a_texCoord"
+#define VERTEX_ATTRIBUTE_INSTANCE_MATRIX_NAME       "a_instanceMatrix"
+#define VERTEX_ATTRIBUTE_INSTANCE_PALETTE_NAME      "a_instancePalette"
 
 // Hardware buffer
 namespace gameplay
@@ -258,49 +258,6 @@ void BoundingBox::set(float minX, float minY, float minZ, float maxX, float maxY
     max.set(maxX, maxY, maxZ);
 }
 
-static void updateMinMax(Vector3* point, Vector3* min, Vector3* max)
-{
-    GP_ASSERT(point);
-    GP_ASSERT(min);
-    GP_ASSERT(max);
-
-    // Leftmost point.
-    if (point->x < min->x)
-    {
-        min->x = point->x;
-    }
-
-    // Rightmost point.
-    if (point->x > max->x)
-    {
-        max->x = point->x;
-    }
-
-    // Lowest point.
-    if (point->y < min->y)
-    {
-        min->y = point->y;
-    }
-
-    // Highest point.
-    if (point->y > max->y)
-    {
-        max->y = point->y;
-    }
-
-    // Farthest point.
-    if (point->z < min->z)
-    {
-        min->z = point->z;
-    }
-
-    // Nearest point.
-    if (point->z > max->z)
-    {
-        max->z = point->z;
-    }
-}
-
 void BoundingBox::set(const BoundingBox& box)
 {
     min = box.min;
@@ -325,25 +282,8 @@ void BoundingBox::set(const BoundingSphere& sphere)
 
 void BoundingBox::transform(const Matrix& matrix)
 {
-    // Calculate the corners.
-    Vector3 corners[8];
-    getCorners(corners);
-
-    // Transform the corners, recalculating the min and max points along the way.
-    matrix.transformPoint(&corners[0]);
-    Vector3 newMin = corners[0];
-    Vector3 newMax = corners[0];
-    for (int i = 1; i < 8; i++)
-    {
-        matrix.transformPoint(&corners[i]);
-        updateMinMax(&corners[i], &newMin, &newMax);
-    }
-    this->min.x = newMin.x;
-    this->min.y = newMin.y;
-    this->min.z = newMin.z;
-    this->max.x = newMax.x;
-    this->max.y = newMax.y;
-    this->max.z = newMax.z;
+    // The box around the transformed corners is found from the center and extents of the box.
+    matrix.transformBoundingBoxes(this, 1, this);
 }
 
 }
@@ -0,0 +1,175 @@
+#include "Base.h"
+#include "BufferAllocator.h"
+#include "RenderState.h"
+
+namespace gameplay
+{
+
+/**
+ * A buffer whose free ranges are kept in order of their offsets.
+ */
+struct BufferArena
+{
+    struct Block
+    {
+        unsigned int offset;
+        unsigned int size;
+    };
+
+    GLenum target;
+    GLuint buffer;
+    unsigned int size;
+    unsigned int allocated;
+    std::vector<Block> freeBlocks;
+};
+
+static std::vector<BufferArena*> __arenas;
+static unsigned int __arenaSize = 4 * 1024 * 1024;
+static bool __enabled = false;
+
+static bool allocateFromArena(BufferArena* arena, unsigned int size, unsigned int alignment, BufferAllocator::Allocation* allocation)
+{
+    // The first free range that fits is used, so that the start of the arena stays packed.
+    for (size_t i = 0, count = arena->freeBlocks.size(); i < count; ++i)
+    {
+        BufferArena::Block block = arena->freeBlocks[i];
+        unsigned int offset = (block.offset + alignment - 1) / alignment * alignment;
+        unsigned int padding = offset - block.offset;
+        if (padding + size > block.size)
+            continue;
+
+        // The padding and the rest of the range stay free.
+        arena->freeBlocks.erase(arena->freeBlocks.begin() + i);
+        unsigned int rest = block.size - padding - size;
+        if (rest > 0)
+        {
+            BufferArena::Block after = { offset + size, rest };
+            arena->freeBlocks.insert(arena->freeBlocks.begin() + i, after);
+        }
+        if (padding > 0)
+        {
+            BufferArena::Block before = { block.offset, padding };
+            arena->freeBlocks.insert(arena->freeBlocks.begin() + i, before);
+        }
+
+        arena->allocated += size;
+        allocation->buffer = arena->buffer;
+        allocation->offset = offset;
+        allocation->size = size;
+        return true;
+    }
+    return false;
+}
+
+bool BufferAllocator::allocate(GLenum target, unsigned int size, unsigned int alignment, Allocation* allocation)
+{
+    GP_ASSERT(allocation);
+    GP_ASSERT(alignment > 0);
+
+    // Large allocations would leave most of an arena to smaller ones, so they have buffers of their own.
+    if (size == 0 || size > __arenaSize / 4)
+        return false;
+
+    for (size_t i = 0, count = __arenas.size(); i < count; ++i)
+    {
+        if (__arenas[i]->target == target && allocateFromArena(__arenas[i], size, alignment, allocation))
+            return true;
+    }
+
+    BufferArena* arena = new BufferArena();
+    arena->target = target;
+    arena->size = __arenaSize;
+    arena->allocated = 0;
+    GL_ASSERT( glGenBuffers(1, &arena->buffer) );
+    RenderState::bindBuffer(target, arena->buffer);
+    GL_ASSERT( glBufferData(target, arena->size, NULL, GL_STATIC_DRAW) );
+    BufferArena::Block block = { 0, arena->size };
+    arena->freeBlocks.push_back(block);
+    __arenas.push_back(arena);
+
+    return allocateFromArena(arena, size, alignment, allocation);
+}
+
+void BufferAllocator::free(Allocation* allocation)
+{
+    GP_ASSERT(allocation);
+
+    for (size_t i = 0, count = __arenas.size(); i < count; ++i)
+    {
+        BufferArena* arena = __arenas[i];
+        if (arena->buffer != allocation->buffer)
+            continue;
+
+        GP_ASSERT(arena->allocated >= allocation->size);
+        arena->allocated -= allocation->size;
+        if (arena->allocated == 0)
+        {
+            RenderState::deleteBuffer(arena->buffer);
+            SAFE_DELETE(arena);
+            __arenas.erase(__arenas.begin() + i);
+        }
+        else
+        {
+            // Merge the range with the free ranges around it.
+            std::vector<BufferArena::Block>& blocks = arena->freeBlocks;
+            size_t j = 0;
+            while (j < blocks.size() && blocks[j].offset < allocation->offset)
+                ++j;
+            BufferArena::Block block = { allocation->offset, allocation->size };
+            if (j < blocks.size() && block.offset + block.size == blocks[j].offset)
+            {
+                block.size += blocks[j].size;
+                blocks.erase(blocks.begin() + j);
+            }
+            if (j > 0 && blocks[j - 1].offset + blocks[j - 1].size == block.offset)
+            {
+                blocks[j - 1].size += block.size;
+            }
+            else
+            {
+                blocks.insert(blocks.begin() + j, block);
+            }
+        }
+        *allocation = Allocation();
+        return;
+    }
+    GP_ERROR("Failed to free buffer range; buffer %u is not an arena.", allocation->buffer);
+}
+
+void BufferAllocator::setEnabled(bool enabled)
+{
+    __enabled = enabled;
+}
+
+bool BufferAllocator::isEnabled()
+{
+    return __enabled;
+}
+
+void BufferAllocator::setArenaSize(unsigned int size)
+{
+    GP_ASSERT(size > 0);
+    __arenaSize = size;
+}
+
+unsigned int BufferAllocator::getArenaSize()
+{
+    return __arenaSize;
+}
+
+unsigned int BufferAllocator::getArenaCount()
+{
+    return (unsigned int)__arenas.size();
+}
+
+size_t BufferAllocator::getAllocatedSize()
+{
+    size_t size = 0;
+    for (size_t i = 0, count = __arenas.size(); i < count; ++i)
+    {
+        size += __arenas[i]->allocated;
+    }
+    return size;
+}
+
+}
@@ -0,0 +1,127 @@
+#ifndef BUFFERALLOCATOR_H_
+#define BUFFERALLOCATOR_H_
+
+namespace gameplay
+{
+
+/**
+ * Defines a suballocator of GPU buffers, which hands out ranges of a few large buffers (arenas)
+ * instead of a buffer object for each allocation.
+ *
+ * When shared buffers are enabled, the vertices of static meshes and the indices of static mesh
+ * parts are allocated from the arenas, so a level with thousands of meshes only has a few buffer
+ * objects. The meshes and mesh parts then start at an offset of their buffer (see
+ * Mesh::getVertexOffset and MeshPart::getIndexOffset), which the vertex attribute bindings and
+ * draws of the engine take into account. Dynamic meshes and allocations that are larger than a
+ * quarter of an arena keep buffers of their own.
+ *
+ * Shared buffers can be enabled with the sharedMeshBuffers property of the graphics namespace
+ * in the game config. They only apply to the meshes that are created afterwards.
+ *
+ * @script{ignore}
+ */
+class BufferAllocator
+{
+public:
+
+    /**
+     * A range of a buffer.
+     */
+    struct Allocation
+    {
+        /**
+         * The buffer that holds the range.
+         */
+        GLuint buffer;
+
+        /**
+         * The offset of the range in the buffer, in bytes.
+         */
+        unsigned int offset;
+
+        /**
+         * The size of the range, in bytes.
+         */
+        unsigned int size;
+
+        /**
+         * Constructor.
+         */
+        Allocation() : buffer(0), offset(0), size(0) { }
+    };
+
+    /**
+     * Allocates a range of an arena.
+     *
+     * @param target The target of the buffer, which is GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER.
+     *      Each target has arenas of its own.
+     * @param size The size of the range, in bytes.
+     * @param alignment The number that the offset of the range is a multiple of.
+     * @param allocation Filled with the range.
+     *
+     * @return true if the range was allocated, false if it is too large to share an arena.
+     */
+    static bool allocate(GLenum target, unsigned int size, unsigned int alignment, Allocation* allocation);
+
+    /**
+     * Frees a range that was allocated from an arena. An arena is released once all of its
+     * ranges are freed.
+     *
+     * @param allocation The range, which is reset.
+     */
+    static void free(Allocation* allocation);
+
+    /**
+     * Sets whether the vertices and indices of the static meshes that are created from now on
+     * are allocated from the arenas.
+     *
+     * @param enabled true to allocate them from the arenas.
+     */
+    static void setEnabled(bool enabled);
+
+    /**
+     * Determines whether static meshes are allocated from the arenas.
+     *
+     * @return true if they are allocated from the arenas.
+     */
+    static bool isEnabled();
+
+    /**
+     * Sets the size of the arenas that are created from now on.
+     *
+     * @param size The size, in bytes. The default is 4 MB.
+     */
+    static void setArenaSize(unsigned int size);
+
+    /**
+     * Returns the size of the arenas that are created.
+     *
+     * @return The size, in bytes.
+     */
+    static unsigned int getArenaSize();
+
+    /**
+     * Returns the number of arenas, which is the number of buffer objects they use.
+     *
+     * @return The number of arenas.
+     */
+    static unsigned int getArenaCount();
+
+    /**
+     * Returns the number of bytes of the arenas that are allocated.
+     *
+     * @return The allocated size, in bytes.
+     */
+    static size_t getAllocatedSize();
+
+private:
+
+    /**
+     * Constructor. Hidden since the allocator only has static methods.
+     */
+    BufferAllocator();
+};
+
+}
+
+#endif
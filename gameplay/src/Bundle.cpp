@@ -1,7 +1,11 @@
 #include "Base.h"
 #include "Bundle.h"
 #include "FileSystem.h"
+#include "ResourceCache.h"
 #include "MeshPart.h"
+#include "MeshGeometry.h"
+#include "MeshStreamer.h"
+#include "Platform.h"
 #include "Scene.h"
 #include "Joint.h"
 
@@ -30,13 +34,41 @@
 #define BUNDLE_VERSION_MAJOR_FONT_FORMAT  1
 #define BUNDLE_VERSION_MINOR_FONT_FORMAT  5
 
+#define BUNDLE_VERSION_MAJOR_ANIMATION_FORMAT  1
+#define BUNDLE_VERSION_MINOR_ANIMATION_FORMAT  6
+
+#define BUNDLE_VERSION_MAJOR_MESH_LOD  1
+#define BUNDLE_VERSION_MINOR_MESH_LOD  7
+
+#define BUNDLE_VERSION_MAJOR_VERTEX_TYPE  1
+#define BUNDLE_VERSION_MINOR_VERTEX_TYPE  8
+
+#define BUNDLE_VERSION_MAJOR_MESH_CLUSTER  1
+#define BUNDLE_VERSION_MINOR_MESH_CLUSTER  9
+
+#define BUNDLE_VERSION_MAJOR_NODE_HIERARCHY  1
+#define BUNDLE_VERSION_MINOR_NODE_HIERARCHY  10
+
+#define BUNDLE_VERSION_MAJOR_JOINT_BOUNDS  1
+#define BUNDLE_VERSION_MINOR_JOINT_BOUNDS  11
+
+// Parent index of the nodes at the root of a scene hierarchy
+#define BUNDLE_HIERARCHY_ROOT  0xFFFFFFFF
+
+// Animation channel formats
+#define BUNDLE_ANIMATION_CHANNEL_KEYS              0
+#define BUNDLE_ANIMATION_CHANNEL_COMPRESSED_KEYS   1
+
+// Quaternion offset of compressed animation channels without a rotation
+#define BUNDLE_ANIMATION_NO_QUATERNION  0xFFFFFFFF
+
 namespace gameplay
 {
 
-static std::vector<Bundle*> __bundleCache;
+static ResourceCache __bundleCache;
 
 Bundle::Bundle(const char* path) :
-    _path(path), _referenceCount(0), _references(NULL), _stream(NULL), _trackedNodes(NULL)
+    _path(path), _referenceCount(0), _references(NULL), _stream(NULL), _trackedNodes(NULL), _sceneNodes(NULL), _animationTargets(NULL)
 {
 }
 
@@ -45,11 +77,7 @@ Bundle::~Bundle()
     clearLoadSession();
 
     // Remove this Bundle from the cache.
-    std::vector<Bundle*>::iterator itr = std::find(__bundleCache.begin(), __bundleCache.end(), this);
-    if (itr != __bundleCache.end())
-    {
-        __bundleCache.erase(itr);
-    }
+    __bundleCache.remove(_path.c_str(), this);
 
     SAFE_DELETE_ARRAY(_references);
 
@@ -173,20 +201,16 @@ Bundle* Bundle::create(const char* path)
     GP_ASSERT(path);
 
     // Search the cache for this bundle.
-    for (size_t i = 0, count = __bundleCache.size(); i < count; ++i)
+    Bundle* p = static_cast<Bundle*>(__bundleCache.find(path));
+    if (p)
     {
-        Bundle* p = __bundleCache[i];
-        GP_ASSERT(p);
-        if (p->_path == path)
-        {
-            // Found a match
-            p->addRef();
-            return p;
-        }
+        // Found a match
+        p->addRef();
+        return p;
     }
 
-    // Open the bundle.
-    Stream* stream = FileSystem::open(path);
+    // Open the bundle, mapped into memory where possible so that mesh data can be uploaded without copying it.
+    Stream* stream = FileSystem::open(path, FileSystem::READ | FileSystem::MAP);
     if (!stream)
     {
         GP_WARN("Failed to open file '%s'.", path);
@@ -250,25 +274,35 @@ Bundle* Bundle::create(const char* path)
     bundle->_references = refs;
     bundle->_stream = stream;
 
+    // Index the refs by id and by offset, since objects are looked up both ways for every object that is read.
+    // The first ref wins when ids or offsets are repeated, as with a search of the table.
+    bundle->_referenceIds.reserve(refCount);
+    bundle->_referenceOffsets.reserve(refCount);
+    for (unsigned int i = 0; i < refCount; ++i)
+    {
+        bundle->_referenceIds.insert(std::make_pair(refs[i].id, i));
+        bundle->_referenceOffsets.insert(std::make_pair(refs[i].offset, i));
+    }
+
+    // Add the bundle to the cache, counting the file that it keeps open.
+    __bundleCache.add(path, bundle, stream->length());
+
     return bundle;
 }
 
+ResourceCache* Bundle::getCache()
+{
+    return &__bundleCache;
+}
+
 Bundle::Reference* Bundle::find(const char* id) const
 {
     GP_ASSERT(id);
     GP_ASSERT(_references);
 
-    // Search the ref table for the given id (case-sensitive).
-    for (unsigned int i = 0; i < _referenceCount; ++i)
-    {
-        if (_references[i].id == id)
-        {
-            // Found a match
-            return &_references[i];
-        }
-    }
-
-    return NULL;
+    // Look up the ref table index for the given id (case-sensitive).
+    std::unordered_map<std::string, unsigned int>::const_iterator itr = _referenceIds.find(id);
+    return itr != _referenceIds.end() ? &_references[itr->second] : NULL;
 }
 
 void Bundle::clearLoadSession()
@@ -292,12 +326,11 @@ const char* Bundle::getIdFromOffset(unsigned int offset) const
     if (offset > 0)
     {
         GP_ASSERT(_references);
-        for (unsigned int i = 0; i < _referenceCount; ++i)
+        std::unordered_map<unsigned int, unsigned int>::const_iterator itr = _referenceOffsets.find(offset);
+        if (itr != _referenceOffsets.end())
         {
-            if (_references[i].offset == offset && _references[i].id.length() > 0)
-            {
-                return _references[i].id.c_str();
-            }
+            // Ids are never empty; refs with empty ids fail to load in create().
+            return _references[itr->second].id.c_str();
         }
     }
     return NULL;
@@ -415,11 +448,29 @@ Scene* Bundle::loadScene(const char* id)
 
     Scene* scene = Scene::create(getIdFromOffset());
 
+    // Read the flattened hierarchy of the scene.
+    std::vector<SceneHierarchyNode> hierarchy;
+    std::vector<Node*> sceneNodes;
+    if (getVersionMajor() >= BUNDLE_VERSION_MAJOR_NODE_HIERARCHY && getVersionMinor() >= BUNDLE_VERSION_MINOR_NODE_HIERARCHY)
+    {
+        if (!readSceneHierarchy(hierarchy))
+        {
+            GP_ERROR("Failed to read the hierarchy of scene '%s' in bundle '%s'.", scene->getId(), _path.c_str());
+            SAFE_RELEASE(scene);
+            return NULL;
+        }
+        // The hierarchy stores every node of the scene once, so the nodes do not need to be
+        // searched for while they are read.
+        sceneNodes.reserve(hierarchy.size());
+        _sceneNodes = &sceneNodes;
+    }
+
     // Read the number of children.
     unsigned int childrenCount;
     if (!read(&childrenCount))
     {
         GP_ERROR("Failed to read the scene's number of children.");
+        _sceneNodes = NULL;
         SAFE_RELEASE(scene);
         return NULL;
     }
@@ -436,6 +487,7 @@ Scene* Bundle::loadScene(const char* id)
             }
         }
     }
+    _sceneNodes = NULL;
     // Read active camera.
     std::string xref = readString(_stream);
     if (xref.length() > 1 && xref[0] == '#') // TODO: Handle full xrefs
@@ -489,6 +541,30 @@ Scene* Bundle::loadScene(const char* id)
 
     resolveJointReferences(scene, NULL);
 
+    // Set the world matrices and bounds of the static nodes, once the hierarchy has been built.
+    if (!hierarchy.empty())
+    {
+        bool matches = sceneNodes.size() == hierarchy.size();
+        for (size_t i = 0, count = hierarchy.size(); matches && i < count; ++i)
+        {
+            const SceneHierarchyNode& entry = hierarchy[i];
+            Node* parent = entry.parentIndex < 0 ? NULL : sceneNodes[entry.parentIndex];
+            matches = sceneNodes[i]->getParent() == parent;
+        }
+        if (!matches)
+        {
+            GP_WARN("The hierarchy of scene '%s' does not match its nodes in bundle '%s'.", scene->getId(), _path.c_str());
+        }
+        else
+        {
+            for (size_t i = 0, count = hierarchy.size(); i < count; ++i)
+            {
+                if (hierarchy[i].isStatic)
+                    sceneNodes[i]->setStaticBounds(hierarchy[i].world, hierarchy[i].bounds);
+            }
+        }
+    }
+
     return scene;
 }
 
@@ -690,6 +766,46 @@ bool Bundle::skipNode()
     return true;
 }
 
+bool Bundle::readSceneHierarchy(std::vector<SceneHierarchyNode>& hierarchy)
+{
+    unsigned int count;
+    if (!read(&count))
+    {
+        GP_ERROR("Failed to read the number of nodes in the scene hierarchy.");
+        return false;
+    }
+    hierarchy.resize(count);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        SceneHierarchyNode& entry = hierarchy[i];
+        unsigned int parentIndex;
+        unsigned char isStatic;
+        if (!read(&parentIndex) || !read(&isStatic))
+        {
+            GP_ERROR("Failed to read node %u of the scene hierarchy.", i);
+            return false;
+        }
+        if (parentIndex != BUNDLE_HIERARCHY_ROOT && parentIndex >= i)
+        {
+            GP_ERROR("Invalid parent index %u for node %u of the scene hierarchy.", parentIndex, i);
+            return false;
+        }
+        entry.parentIndex = parentIndex == BUNDLE_HIERARCHY_ROOT ? -1 : (int)parentIndex;
+        entry.isStatic = isStatic != 0;
+        if (entry.isStatic)
+        {
+            if (!readMatrix(entry.world.m) ||
+                _stream->read(&entry.bounds.center.x, sizeof(float), 3) != 3 ||
+                !read(&entry.bounds.radius))
+            {
+                GP_ERROR("Failed to read the world matrix and bounds of node %u of the scene hierarchy.", i);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 Node* Bundle::readNode(Scene* sceneContext, Node* nodeContext)
 {
     const char* id = getIdFromOffset();
@@ -737,6 +853,10 @@ Node* Bundle::readNode(Scene* sceneContext, Node* nodeContext)
         // Add the new node to the list of tracked nodes
         _trackedNodes->insert(std::make_pair(id, node));
     }
+    if (_sceneNodes)
+    {
+        _sceneNodes->push_back(node);
+    }
 
     // If no loading context is set, set this node as the loading context.
     if (sceneContext == NULL && nodeContext == NULL)
@@ -776,11 +896,11 @@ Node* Bundle::readNode(Scene* sceneContext, Node* nodeContext)
             id = getIdFromOffset();
             GP_ASSERT(id);
 
-            if (sceneContext)
+            if (sceneContext && !_sceneNodes)
             {
                 child = sceneContext->findNode(id, true);
             }
-            if (child == NULL && nodeContext)
+            if (child == NULL && nodeContext && !_sceneNodes)
             {
                 child = nodeContext->findNode(id, true);
             }
@@ -1097,6 +1217,35 @@ MeshSkin* Bundle::readMeshSkin()
         }
     }
 
+    // Read the joint bounds.
+    if (getVersionMajor() >= BUNDLE_VERSION_MAJOR_JOINT_BOUNDS && getVersionMinor() >= BUNDLE_VERSION_MINOR_JOINT_BOUNDS)
+    {
+        unsigned int jointBoundsCount;
+        if (!read(&jointBoundsCount))
+        {
+            GP_ERROR("Failed to load number of joint bounds in bundle '%s'.", _path.c_str());
+            SAFE_DELETE(meshSkin);
+            SAFE_DELETE(skinData);
+            return NULL;
+        }
+        std::vector<BoundingSphere> jointBounds(jointBoundsCount);
+        for (unsigned int i = 0; i < jointBoundsCount; i++)
+        {
+            BoundingSphere& sphere = jointBounds[i];
+            if (!read(&sphere.center.x) || !read(&sphere.center.y) || !read(&sphere.center.z) || !read(&sphere.radius))
+            {
+                GP_ERROR("Failed to load joint bounds (for joint with index %d) in bundle '%s'.", i, _path.c_str());
+                SAFE_DELETE(meshSkin);
+                SAFE_DELETE(skinData);
+                return NULL;
+            }
+        }
+        if (jointBoundsCount == jointCount)
+            meshSkin->setJointBounds(&jointBounds[0], jointBoundsCount);
+        else if (jointBoundsCount > 0)
+            GP_WARN("Ignoring %u joint bounds for a mesh skin of %u joints in bundle '%s'.", jointBoundsCount, jointCount, _path.c_str());
+    }
+
     // Store the MeshSkinData so we can go back and resolve all joint references later.
     _meshSkins.push_back(skinData);
 
@@ -1245,10 +1394,14 @@ void Bundle::readAnimations(Scene* scene)
         return;
     }
 
+    // The channels of all the animations are bound through one table of targets, so each target
+    // is only searched for in the scene once however many channels animate it.
+    _animationTargets = new std::map<std::string, AnimationTarget*>();
     for (unsigned int i = 0; i < animationCount; i++)
     {
         readAnimation(scene);
     }
+    SAFE_DELETE(_animationTargets);
 }
 
 Animation* Bundle::readAnimationChannel(Scene* scene, Animation* animation, const char* animationId)
@@ -1272,6 +1425,12 @@ Animation* Bundle::readAnimationChannel(Scene* scene, Animation* animation, cons
     }
 
     AnimationTarget* target = NULL;
+    if (_animationTargets)
+    {
+        std::map<std::string, AnimationTarget*>::const_iterator itr = _animationTargets->find(targetId);
+        if (itr != _animationTargets->end())
+            target = itr->second;
+    }
 
     // Search for a node that matches the target.
     if (!target)
@@ -1282,6 +1441,8 @@ Animation* Bundle::readAnimationChannel(Scene* scene, Animation* animation, cons
             GP_ERROR("Failed to find the animation target (with id '%s') for animation '%s'.", targetId.c_str(), animationId);
             return NULL;
         }
+        if (_animationTargets)
+            (*_animationTargets)[targetId] = target;
     }
 
     return readAnimationChannelData(animation, animationId, target, targetAttribute);
@@ -1291,6 +1452,26 @@ Animation* Bundle::readAnimationChannelData(Animation* animation, const char* id
 {
     GP_ASSERT(id);
 
+    // In bundle version 1.6 we introduced storing the key values of channels quantized
+    if (getVersionMajor() >= BUNDLE_VERSION_MAJOR_ANIMATION_FORMAT && getVersionMinor() >= BUNDLE_VERSION_MINOR_ANIMATION_FORMAT)
+    {
+        unsigned int format;
+        if (!read(&format))
+        {
+            GP_ERROR("Failed to read the channel format for animation '%s'.", id);
+            return NULL;
+        }
+        if (format == BUNDLE_ANIMATION_CHANNEL_COMPRESSED_KEYS)
+        {
+            return readCompressedAnimationChannelData(animation, id, target, targetAttribute);
+        }
+        else if (format != BUNDLE_ANIMATION_CHANNEL_KEYS)
+        {
+            GP_ERROR("Unsupported channel format (%u) for animation '%s'.", format, id);
+            return NULL;
+        }
+    }
+
     std::vector<unsigned int> keyTimes;
     std::vector<float> values;
     std::vector<float> tangentsIn;
@@ -1357,6 +1538,90 @@ Animation* Bundle::readAnimationChannelData(Animation* animation, const char* id
     return animation;
 }
 
+Animation* Bundle::readCompressedAnimationChannelData(Animation* animation, const char* id, AnimationTarget* target, unsigned int targetAttribute)
+{
+    GP_ASSERT(id);
+
+    std::vector<unsigned int> keyTimes;
+    std::vector<float> ranges;
+    std::vector<unsigned short> keyData;
+    unsigned int keyTimesCount;
+    unsigned int componentCount;
+    unsigned int quaternionOffset;
+    unsigned int rangesCount;
+    unsigned int keyDataCount;
+
+    // Read key times.
+    if (!readArray(&keyTimesCount, &keyTimes, sizeof(unsigned int)))
+    {
+        GP_ERROR("Failed to read key times for animation '%s'.", id);
+        return NULL;
+    }
+
+    // Read the layout of the key values.
+    if (!read(&componentCount) || !read(&quaternionOffset))
+    {
+        GP_ERROR("Failed to read the key value layout for animation '%s'.", id);
+        return NULL;
+    }
+
+    // Read the ranges of the quantized components.
+    if (!readArray(&rangesCount, &ranges))
+    {
+        GP_ERROR("Failed to read key value ranges for animation '%s'.", id);
+        return NULL;
+    }
+
+    // Read the quantized key values.
+    if (!readArray(&keyDataCount, &keyData))
+    {
+        GP_ERROR("Failed to read key values for animation '%s'.", id);
+        return NULL;
+    }
+
+    if (targetAttribute == 0)
+        return animation;
+
+    GP_ASSERT(target);
+    int offset = quaternionOffset == BUNDLE_ANIMATION_NO_QUATERNION ? -1 : (int)quaternionOffset;
+    if (keyTimesCount == 0 || componentCount == 0 || componentCount != target->getAnimationPropertyComponentCount(targetAttribute) ||
+        (offset >= 0 && (unsigned int)offset + 4 > componentCount) ||
+        rangesCount != (offset >= 0 ? componentCount - 4 : componentCount) * 2 ||
+        keyDataCount != keyTimesCount * Curve::getCompressedKeyStride(componentCount, offset))
+    {
+        GP_ERROR("Invalid compressed key values for animation '%s'.", id);
+        return NULL;
+    }
+
+    // Normalize the key times.
+    unsigned int lowest = keyTimes[0];
+    unsigned long duration = keyTimes[keyTimesCount - 1] - lowest;
+    std::vector<float> normalizedKeyTimes(keyTimesCount, 0.0f);
+    for (unsigned int i = 1; i < keyTimesCount; i++)
+    {
+        normalizedKeyTimes[i] = duration > 0 ? (float)(keyTimes[i] - lowest) / (float)duration : 0.0f;
+    }
+    if (keyTimesCount > 1)
+        normalizedKeyTimes[keyTimesCount - 1] = 1.0f;
+
+    Curve* curve = Curve::createCompressed(keyTimesCount, componentCount, offset, &normalizedKeyTimes[0], ranges.empty() ? NULL : &ranges[0], &keyData[0]);
+    if (animation == NULL)
+    {
+        animation = new Animation(id);
+        animation->createChannel(target, targetAttribute, curve, duration);
+
+        // Release the animation because a newly created animation has a ref count of 1 and the channels hold the ref to animation.
+        animation->release();
+    }
+    else
+    {
+        animation->createChannel(target, targetAttribute, curve, duration);
+    }
+    curve->release();
+
+    return animation;
+}
+
 Mesh* Bundle::loadMesh(const char* id)
 {
     return loadMesh(id, NULL);
@@ -1383,8 +1648,11 @@ Mesh* Bundle::loadMesh(const char* id, const char* nodeId)
         return NULL;
     }
 
-    // Read mesh data.
-    MeshData* meshData = readMeshData();
+    // Read mesh data, which is uploaded straight from the bundle file when it is mapped. Streamed
+    // meshes only locate their vertex and index data, which is read when they are first drawn.
+    MeshStreamer* streamer = Game::getInstance()->getMeshStreamer();
+    bool streamed = streamer && streamer->isEnabled() && !MeshGeometry::isRetained() && !Platform::isHeadless();
+    MeshData* meshData = readMeshData(true, streamed);
     if (meshData == NULL)
     {
         GP_ERROR("Failed to load mesh data for mesh '%s'.", id);
@@ -1392,7 +1660,7 @@ Mesh* Bundle::loadMesh(const char* id, const char* nodeId)
     }
 
     // Create mesh.
-    Mesh* mesh = Mesh::createMesh(meshData->vertexFormat, meshData->vertexCount, false);
+    Mesh* mesh = Mesh::createMesh(meshData->vertexFormat, meshData->vertexCount, false, streamed);
     if (mesh == NULL)
     {
         GP_ERROR("Failed to create mesh '%s'.", id);
@@ -1404,12 +1672,19 @@ Mesh* Bundle::loadMesh(const char* id, const char* nodeId)
     mesh->_url += "#";
     mesh->_url += id;
 
-    mesh->setVertexData((float*)meshData->vertexData, 0, meshData->vertexCount);
+    if (!streamed)
+        mesh->setVertexData((float*)meshData->vertexData, 0, meshData->vertexCount);
 
     mesh->_boundingBox.set(meshData->boundingBox);
     mesh->_boundingSphere.set(meshData->boundingSphere);
+    mesh->setPositionDecode(meshData->positionDecodeScale, meshData->positionDecodeOffset);
+
+    // Keep a copy of the geometry for physics and navigation, so that they don't read the bundle again.
+    if (MeshGeometry::isRetained())
+        mesh->_geometry = MeshGeometry::create(mesh->_url.c_str(), meshData);
 
     // Create mesh parts.
+    std::vector<MeshStreamer::Range> streamedParts;
     for (unsigned int i = 0; i < meshData->parts.size(); ++i)
     {
         MeshPartData* partData = meshData->parts[i];
@@ -1422,7 +1697,54 @@ Mesh* Bundle::loadMesh(const char* id, const char* nodeId)
             SAFE_DELETE(meshData);
             return NULL;
         }
-        part->setIndexData(partData->indexData, 0, partData->indexCount);
+        if (streamed)
+        {
+            MeshStreamer::Range range = { part, partData->indexDataOffset - meshData->vertexDataOffset };
+            streamedParts.push_back(range);
+        }
+        else
+        {
+            part->setIndexData(partData->indexData, 0, partData->indexCount);
+        }
+        if (!partData->clusters.empty())
+            part->setClusters(&partData->clusters[0], (unsigned int)partData->clusters.size());
+    }
+
+    // Create the levels of detail.
+    for (unsigned int i = 0; i < meshData->lodErrors.size(); ++i)
+    {
+        unsigned int lod = mesh->addLod(meshData->lodErrors[i]);
+        for (unsigned int j = 0; j < meshData->parts.size(); ++j)
+        {
+            MeshPartData* partData = meshData->lodParts[i * meshData->parts.size() + j];
+            GP_ASSERT(partData);
+
+            MeshPart* part = mesh->addLodPart(lod, j, partData->primitiveType, partData->indexFormat, partData->indexCount, false);
+            if (part == NULL)
+            {
+                GP_ERROR("Failed to create mesh part (with index %d) of level of detail %d for mesh '%s'.", j, lod, id);
+                SAFE_DELETE(meshData);
+                return NULL;
+            }
+            if (streamed)
+            {
+                MeshStreamer::Range range = { part, partData->indexDataOffset - meshData->vertexDataOffset };
+                streamedParts.push_back(range);
+            }
+            else
+            {
+                part->setIndexData(partData->indexData, 0, partData->indexCount);
+            }
+            if (!partData->clusters.empty())
+                part->setClusters(&partData->clusters[0], (unsigned int)partData->clusters.size());
+        }
+    }
+
+    // The data of a streamed mesh is read in one piece, from its vertices to the end of the mesh.
+    if (streamed)
+    {
+        unsigned int size = (unsigned int)_stream->position() - meshData->vertexDataOffset;
+        mesh->_streamEntry = streamer->add(mesh, _path.c_str(), meshData->vertexDataOffset, size, streamedParts);
     }
 
     SAFE_DELETE(meshData);
@@ -1437,8 +1759,10 @@ Mesh* Bundle::loadMesh(const char* id, const char* nodeId)
     return mesh;
 }
 
-Bundle::MeshData* Bundle::readMeshData()
+Bundle::MeshData* Bundle::readMeshData(bool mapped, bool deferred)
 {
+    const unsigned char* mappedData = mapped && !deferred ? (const unsigned char*)_stream->getMappedData() : NULL;
+
     // Read vertex format/elements.
     unsigned int vertexElementCount;
     if (_stream->read(&vertexElementCount, 4, 1) != 1)
@@ -1452,6 +1776,9 @@ Bundle::MeshData* Bundle::readMeshData()
         return NULL;
     }
 
+    // In bundle version 1.8 we introduced storing the types of vertex elements, which were all floats before.
+    bool vertexTypes = getVersionMajor() >= BUNDLE_VERSION_MAJOR_VERTEX_TYPE && getVersionMinor() >= BUNDLE_VERSION_MINOR_VERTEX_TYPE;
+
     VertexFormat::Element* vertexElements = new VertexFormat::Element[vertexElementCount];
     for (unsigned int i = 0; i < vertexElementCount; ++i)
     {
@@ -1471,9 +1798,29 @@ Bundle::MeshData* Bundle::readMeshData()
 
         vertexElements[i].usage = (VertexFormat::Usage)vUsage;
         vertexElements[i].size = vSize;
+
+        if (vertexTypes)
+        {
+            unsigned int vType, vNormalized;
+            if (_stream->read(&vType, 4, 1) != 1 || _stream->read(&vNormalized, 4, 1) != 1)
+            {
+                GP_ERROR("Failed to load vertex type.");
+                SAFE_DELETE_ARRAY(vertexElements);
+                return NULL;
+            }
+            if (vType > VertexFormat::INT_2_10_10_10_REV)
+            {
+                GP_ERROR("Failed to load mesh data; invalid vertex type (%d).", vType);
+                SAFE_DELETE_ARRAY(vertexElements);
+                return NULL;
+            }
+            vertexElements[i].type = (VertexFormat::Type)vType;
+            vertexElements[i].normalized = vNormalized != 0;
+        }
     }
 
     MeshData* meshData = new MeshData(VertexFormat(vertexElements, vertexElementCount));
+    meshData->mapped = mappedData != NULL;
     SAFE_DELETE_ARRAY(vertexElements);
 
     // Read vertex data.
@@ -1493,12 +1840,37 @@ Bundle::MeshData* Bundle::readMeshData()
 
     GP_ASSERT(meshData->vertexFormat.getVertexSize());
     meshData->vertexCount = vertexByteCount / meshData->vertexFormat.getVertexSize();
-    meshData->vertexData = new unsigned char[vertexByteCount];
-    if (_stream->read(meshData->vertexData, 1, vertexByteCount) != vertexByteCount)
+    meshData->vertexDataOffset = (unsigned int)_stream->position();
+    if (deferred)
     {
-        GP_ERROR("Failed to load vertex data.");
-        SAFE_DELETE(meshData);
-        return NULL;
+        // The vertex data is read when the mesh is streamed in.
+        if (_stream->seek(vertexByteCount, SEEK_CUR) == false)
+        {
+            GP_ERROR("Failed to skip vertex data.");
+            SAFE_DELETE(meshData);
+            return NULL;
+        }
+    }
+    else if (mappedData)
+    {
+        // Use the vertex data in place and skip over it.
+        meshData->vertexData = const_cast<unsigned char*>(mappedData + _stream->position());
+        if (_stream->seek(vertexByteCount, SEEK_CUR) == false)
+        {
+            GP_ERROR("Failed to load vertex data.");
+            SAFE_DELETE(meshData);
+            return NULL;
+        }
+    }
+    else
+    {
+        meshData->vertexData = new unsigned char[vertexByteCount];
+        if (_stream->read(meshData->vertexData, 1, vertexByteCount) != vertexByteCount)
+        {
+            GP_ERROR("Failed to load vertex data.");
+            SAFE_DELETE(meshData);
+            return NULL;
+        }
     }
 
     // Read mesh bounds (bounding box and bounding sphere).
@@ -1514,14 +1886,69 @@ Bundle::MeshData* Bundle::readMeshData()
         SAFE_DELETE(meshData);
         return NULL;
     }
+    if (vertexTypes)
+    {
+        if (_stream->read(&meshData->positionDecodeScale.x, 4, 3) != 3 || _stream->read(&meshData->positionDecodeOffset.x, 4, 3) != 3)
+        {
+            GP_ERROR("Failed to load mesh position decode scale and offset.");
+            SAFE_DELETE(meshData);
+            return NULL;
+        }
+    }
 
     // Read mesh parts.
+    if (!readMeshPartData(meshData->parts, mappedData, deferred))
+    {
+        SAFE_DELETE(meshData);
+        return NULL;
+    }
+
+    // In bundle version 1.7 we introduced storing levels of detail after the parts of meshes.
+    if (getVersionMajor() >= BUNDLE_VERSION_MAJOR_MESH_LOD && getVersionMinor() >= BUNDLE_VERSION_MINOR_MESH_LOD)
+    {
+        unsigned int lodCount;
+        if (_stream->read(&lodCount, 4, 1) != 1)
+        {
+            GP_ERROR("Failed to load mesh level of detail count.");
+            SAFE_DELETE(meshData);
+            return NULL;
+        }
+        for (unsigned int i = 0; i < lodCount; ++i)
+        {
+            float error;
+            if (_stream->read(&error, 4, 1) != 1)
+            {
+                GP_ERROR("Failed to load the error of mesh level of detail %d.", i + 1);
+                SAFE_DELETE(meshData);
+                return NULL;
+            }
+            meshData->lodErrors.push_back(error);
+
+            unsigned int partCount = meshData->lodParts.size();
+            if (!readMeshPartData(meshData->lodParts, mappedData, deferred))
+            {
+                SAFE_DELETE(meshData);
+                return NULL;
+            }
+            if (meshData->lodParts.size() - partCount != meshData->parts.size())
+            {
+                GP_ERROR("Invalid part count for mesh level of detail %d.", i + 1);
+                SAFE_DELETE(meshData);
+                return NULL;
+            }
+        }
+    }
+
+    return meshData;
+}
+
+bool Bundle::readMeshPartData(std::vector<MeshPartData*>& parts, const unsigned char* mappedData, bool deferred)
+{
     unsigned int meshPartCount;
     if (_stream->read(&meshPartCount, 4, 1) != 1)
     {
         GP_ERROR("Failed to load mesh part count.");
-        SAFE_DELETE(meshData);
-        return NULL;
+        return false;
     }
     for (unsigned int i = 0; i < meshPartCount; ++i)
     {
@@ -1530,24 +1957,21 @@ Bundle::MeshData* Bundle::readMeshData()
         if (_stream->read(&pType, 4, 1) != 1)
         {
             GP_ERROR("Failed to load primitive type for mesh part with index %d.", i);
-            SAFE_DELETE(meshData);
-            return NULL;
+            return false;
         }
         if (_stream->read(&iFormat, 4, 1) != 1)
         {
             GP_ERROR("Failed to load index format for mesh part with index %d.", i);
-            SAFE_DELETE(meshData);
-            return NULL;
+            return false;
         }
         if (_stream->read(&iByteCount, 4, 1) != 1)
         {
             GP_ERROR("Failed to load index byte count for mesh part with index %d.", i);
-            SAFE_DELETE(meshData);
-            return NULL;
+            return false;
         }
 
         MeshPartData* partData = new MeshPartData();
-        meshData->parts.push_back(partData);
+        parts.push_back(partData);
 
         partData->primitiveType = (Mesh::PrimitiveType)pType;
         partData->indexFormat = (Mesh::IndexFormat)iFormat;
@@ -1566,22 +1990,65 @@ Bundle::MeshData* Bundle::readMeshData()
             break;
         default:
             GP_ERROR("Unsupported index format for mesh part with index %d.", i);
-            return NULL;
+            return false;
         }
 
         GP_ASSERT(indexSize);
         partData->indexCount = iByteCount / indexSize;
+        partData->indexDataOffset = (unsigned int)_stream->position();
 
-        partData->indexData = new unsigned char[iByteCount];
-        if (_stream->read(partData->indexData, 1, iByteCount) != iByteCount)
+        if (deferred)
         {
-            GP_ERROR("Failed to read index data for mesh part with index %d.", i);
-            SAFE_DELETE(meshData);
-            return NULL;
+            if (_stream->seek(iByteCount, SEEK_CUR) == false)
+            {
+                GP_ERROR("Failed to skip index data for mesh part with index %d.", i);
+                return false;
+            }
+        }
+        else if (mappedData)
+        {
+            partData->indexData = const_cast<unsigned char*>(mappedData + _stream->position());
+            if (_stream->seek(iByteCount, SEEK_CUR) == false)
+            {
+                GP_ERROR("Failed to read index data for mesh part with index %d.", i);
+                return false;
+            }
+        }
+        else
+        {
+            partData->indexData = new unsigned char[iByteCount];
+            if (_stream->read(partData->indexData, 1, iByteCount) != iByteCount)
+            {
+                GP_ERROR("Failed to read index data for mesh part with index %d.", i);
+                return false;
+            }
+        }
+
+        // In bundle version 1.9 we introduced storing the clusters of the triangles of mesh parts.
+        if (getVersionMajor() >= BUNDLE_VERSION_MAJOR_MESH_CLUSTER && getVersionMinor() >= BUNDLE_VERSION_MINOR_MESH_CLUSTER)
+        {
+            unsigned int clusterCount;
+            if (_stream->read(&clusterCount, 4, 1) != 1)
+            {
+                GP_ERROR("Failed to load cluster count for mesh part with index %d.", i);
+                return false;
+            }
+            partData->clusters.resize(clusterCount);
+            for (unsigned int j = 0; j < clusterCount; ++j)
+            {
+                MeshPart::Cluster& cluster = partData->clusters[j];
+                if (_stream->read(&cluster.indexStart, 4, 1) != 1 || _stream->read(&cluster.indexCount, 4, 1) != 1 ||
+                    _stream->read(&cluster.center.x, 4, 3) != 3 || _stream->read(&cluster.radius, 4, 1) != 1 ||
+                    _stream->read(&cluster.coneAxis.x, 4, 3) != 3 || _stream->read(&cluster.coneCutoff, 4, 1) != 1)
+                {
+                    GP_ERROR("Failed to load cluster %d for mesh part with index %d.", j, i);
+                    return false;
+                }
+            }
         }
     }
 
-    return meshData;
+    return true;
 }
 
 Bundle::MeshData* Bundle::readMeshData(const char* url)
@@ -1871,7 +2338,7 @@ Bundle::Reference::~Reference()
 }
 
 Bundle::MeshPartData::MeshPartData() :
-		primitiveType(Mesh::TRIANGLES), indexFormat(Mesh::INDEX32), indexCount(0), indexData(NULL)
+		primitiveType(Mesh::TRIANGLES), indexFormat(Mesh::INDEX32), indexCount(0), indexData(NULL), indexDataOffset(0)
 {
 }
 
@@ -1881,18 +2348,29 @@ Bundle::MeshPartData::~MeshPartData()
 }
 
 Bundle::MeshData::MeshData(const VertexFormat& vertexFormat)
-    : vertexFormat(vertexFormat), vertexCount(0), vertexData(NULL), primitiveType(Mesh::TRIANGLES)
+    : vertexFormat(vertexFormat), vertexCount(0), vertexData(NULL), vertexDataOffset(0), positionDecodeScale(Vector3::one()), primitiveType(Mesh::TRIANGLES), mapped(false)
 {
 }
 
 Bundle::MeshData::~MeshData()
 {
+    // Mapped data belongs to the bundle file.
+    if (mapped)
+        vertexData = NULL;
     SAFE_DELETE_ARRAY(vertexData);
 
     for (unsigned int i = 0; i < parts.size(); ++i)
     {
+        if (mapped)
+            parts[i]->indexData = NULL;
         SAFE_DELETE(parts[i]);
     }
+    for (unsigned int i = 0; i < lodParts.size(); ++i)
+    {
+        if (mapped)
+            lodParts[i]->indexData = NULL;
+        SAFE_DELETE(lodParts[i]);
+    }
 }
 
 }
@@ -2,6 +2,7 @@
 #define BUNDLE_H_
 
 #include "Mesh.h"
+#include "MeshPart.h"
 #include "Font.h"
 #include "Node.h"
 #include "Game.h"
@@ -10,6 +11,8 @@
 namespace gameplay
 {
 
+class ResourceCache;
+
 /**
  * Defines a gameplay bundle file (.gpb) that contains a
  * collection of binary game assets that can be loaded.
@@ -18,6 +21,8 @@ class Bundle : public Ref
 {
     friend class PhysicsController;
     friend class SceneLoader;
+    friend class MeshGeometry;
+    friend class MeshStreamer;
 
 public:
 
@@ -36,6 +41,14 @@ public:
      */
     static Bundle* create(const char* path);
 
+    /**
+     * Returns the cache of the bundles that are loaded.
+     *
+     * @return The bundle cache.
+     * @script{ignore}
+     */
+    static ResourceCache* getCache();
+
     /**
      * Loads the scene with the specified ID from the bundle.
      * If id is NULL then the first scene found is loaded.
@@ -150,6 +163,9 @@ private:
         Mesh::IndexFormat indexFormat;
         unsigned int indexCount;
         unsigned char* indexData;
+        // The offset of the index data in the bundle file.
+        unsigned int indexDataOffset;
+        std::vector<MeshPart::Cluster> clusters;
     };
 
     struct MeshData
@@ -160,10 +176,31 @@ private:
         VertexFormat vertexFormat;
         unsigned int vertexCount;
         unsigned char* vertexData;
+        // The offset of the vertex data in the bundle file.
+        unsigned int vertexDataOffset;
         BoundingBox boundingBox;
         BoundingSphere boundingSphere;
+        // The scale and offset that decode quantized positions.
+        Vector3 positionDecodeScale;
+        Vector3 positionDecodeOffset;
         Mesh::PrimitiveType primitiveType;
         std::vector<MeshPartData*> parts;
+        // The errors of the levels of detail beyond the mesh itself, and the parts of all of
+        // the levels, as many for each level as the mesh has.
+        std::vector<float> lodErrors;
+        std::vector<MeshPartData*> lodParts;
+        // Whether the vertex and index data point into the mapped bundle file rather than being owned.
+        bool mapped;
+    };
+
+    struct SceneHierarchyNode
+    {
+        // The index of the parent node, or -1 for the nodes at the root of the scene.
+        int parentIndex;
+        bool isStatic;
+        // The world matrix and bounds of the node, set only for static nodes.
+        Matrix world;
+        BoundingSphere bounds;
     };
 
     Bundle(const char* path);
@@ -342,6 +379,17 @@ private:
      */
     Node* readNode(Scene* sceneContext, Node* nodeContext);
 
+    /**
+     * Reads the flattened hierarchy of a scene from the current file position.
+     *
+     * The nodes are stored in the order that they are read, each one with the index of its parent.
+     *
+     * @param hierarchy The hierarchy to read the nodes into.
+     *
+     * @return True if the hierarchy was read successfully; false otherwise.
+     */
+    bool readSceneHierarchy(std::vector<SceneHierarchyNode>& hierarchy);
+
     /**
      * Reads a camera from the current file position.
      *
@@ -365,8 +413,24 @@ private:
 
     /**
      * Reads mesh data from the current file position.
+     *
+     * @param mapped true to let the vertex and index data point into the bundle file when it is
+     *      mapped into memory instead of copying them. The data is then only valid while the bundle is open.
+     * @param deferred true to skip over the vertex and index data and only record their offsets,
+     *      for meshes whose data is streamed (see MeshStreamer).
      */
-    MeshData* readMeshData();
+    MeshData* readMeshData(bool mapped = false, bool deferred = false);
+
+    /**
+     * Reads a list of mesh parts from the current file position.
+     *
+     * @param parts The list to add the parts to.
+     * @param mappedData The mapped data of the bundle file, or NULL to copy the index data.
+     * @param deferred true to skip over the index data and only record its offset.
+     *
+     * @return true if the parts were read, false otherwise.
+     */
+    bool readMeshPartData(std::vector<MeshPartData*>& parts, const unsigned char* mappedData, bool deferred);
 
     /**
      * Reads mesh data for the specified URL.
@@ -428,6 +492,18 @@ private:
      */
     Animation* readAnimationChannelData(Animation* animation, const char* id, AnimationTarget* target, unsigned int targetAttribute);
 
+    /**
+     * Reads the data of an animation channel whose key values are stored quantized.
+     *
+     * @param animation The animation to the load channel into.
+     * @param id The ID of the animation that this channel is loaded into.
+     * @param target The animation target.
+     * @param targetAttribute The target attribute being animated.
+     *
+     * @return The animation that the channel was loaded into.
+     */
+    Animation* readCompressedAnimationChannelData(Animation* animation, const char* id, AnimationTarget* target, unsigned int targetAttribute);
+
     /**
      * Sets the transformation matrix.
      *
@@ -455,10 +531,14 @@ private:
     std::string _materialPath;
     unsigned int _referenceCount;
     Reference* _references;
+    std::unordered_map<std::string, unsigned int> _referenceIds;
+    std::unordered_map<unsigned int, unsigned int> _referenceOffsets;
     Stream* _stream;
 
     std::vector<MeshSkinData*> _meshSkins;
     std::map<std::string, Node*>* _trackedNodes;
+    std::vector<Node*>* _sceneNodes;
+    std::map<std::string, AnimationTarget*>* _animationTargets;
 };
 
 }
@@ -20,15 +20,18 @@
 namespace gameplay
 {
 
+// The versions of all cameras are unique, so that a version identifies both a camera and its state.
+static std::atomic<unsigned int> __cameraVersion(0);
+
 Camera::Camera(float fieldOfView, float aspectRatio, float nearPlane, float farPlane)
     : _type(PERSPECTIVE), _fieldOfView(fieldOfView), _aspectRatio(aspectRatio), _nearPlane(nearPlane), _farPlane(farPlane),
-    _bits(CAMERA_DIRTY_ALL), _node(NULL), _listeners(NULL)
+    _bits(CAMERA_DIRTY_ALL), _bindingVersion(0), _version(++__cameraVersion), _node(NULL), _listeners(NULL)
 {
 }
 
 Camera::Camera(float zoomX, float zoomY, float aspectRatio, float nearPlane, float farPlane)
     : _type(ORTHOGRAPHIC), _aspectRatio(aspectRatio), _nearPlane(nearPlane), _farPlane(farPlane),
-	_bits(CAMERA_DIRTY_ALL), _node(NULL), _listeners(NULL)
+	_bits(CAMERA_DIRTY_ALL), _bindingVersion(0), _version(++__cameraVersion), _node(NULL), _listeners(NULL)
 {
     // Orthographic camera.
     _zoom[0] = zoomX;
@@ -136,6 +139,7 @@ void Camera::setFieldOfView(float fieldOfView)
 
     _fieldOfView = fieldOfView;
     _bits |= CAMERA_DIRTY_PROJ | CAMERA_DIRTY_VIEW_PROJ | CAMERA_DIRTY_INV_VIEW_PROJ | CAMERA_DIRTY_BOUNDS;
+    _bindingVersion = 0;
     cameraChanged();
 }
 
@@ -152,6 +156,7 @@ void Camera::setZoomX(float zoomX)
 
     _zoom[0] = zoomX;
     _bits |= CAMERA_DIRTY_PROJ | CAMERA_DIRTY_VIEW_PROJ | CAMERA_DIRTY_INV_VIEW_PROJ | CAMERA_DIRTY_BOUNDS;
+    _bindingVersion = 0;
     cameraChanged();
 }
 
@@ -168,6 +173,7 @@ void Camera::setZoomY(float zoomY)
 
     _zoom[1] = zoomY;
     _bits |= CAMERA_DIRTY_PROJ | CAMERA_DIRTY_VIEW_PROJ | CAMERA_DIRTY_INV_VIEW_PROJ | CAMERA_DIRTY_BOUNDS;
+    _bindingVersion = 0;
     cameraChanged();
 }
 
@@ -180,6 +186,7 @@ void Camera::setAspectRatio(float aspectRatio)
 {
     _aspectRatio = aspectRatio;
     _bits |= CAMERA_DIRTY_PROJ | CAMERA_DIRTY_VIEW_PROJ | CAMERA_DIRTY_INV_VIEW_PROJ | CAMERA_DIRTY_BOUNDS;
+    _bindingVersion = 0;
     cameraChanged();
 }
 
@@ -192,6 +199,7 @@ void Camera::setNearPlane(float nearPlane)
 {
     _nearPlane = nearPlane;
     _bits |= CAMERA_DIRTY_PROJ | CAMERA_DIRTY_VIEW_PROJ | CAMERA_DIRTY_INV_VIEW_PROJ | CAMERA_DIRTY_BOUNDS;
+    _bindingVersion = 0;
     cameraChanged();
 }
 
@@ -204,6 +212,7 @@ void Camera::setFarPlane(float farPlane)
 {
     _farPlane = farPlane;
     _bits |= CAMERA_DIRTY_PROJ | CAMERA_DIRTY_VIEW_PROJ | CAMERA_DIRTY_INV_VIEW_PROJ | CAMERA_DIRTY_BOUNDS;
+    _bindingVersion = 0;
     cameraChanged();
 }
 
@@ -230,6 +239,7 @@ void Camera::setNode(Node* node)
         }
 
         _bits |= CAMERA_DIRTY_VIEW | CAMERA_DIRTY_VIEW_PROJ | CAMERA_DIRTY_INV_VIEW | CAMERA_DIRTY_INV_VIEW_PROJ | CAMERA_DIRTY_BOUNDS;
+        _bindingVersion = 0;
         cameraChanged();
     }
 }
@@ -291,6 +301,7 @@ void Camera::setProjectionMatrix(const Matrix& matrix)
     _projection = matrix;
     _bits |= CAMERA_CUSTOM_PROJECTION;
     _bits |= CAMERA_DIRTY_PROJ | CAMERA_DIRTY_VIEW_PROJ | CAMERA_DIRTY_INV_VIEW_PROJ | CAMERA_DIRTY_BOUNDS;
+    _bindingVersion = 0;
 
     cameraChanged();
 }
@@ -301,6 +312,7 @@ void Camera::resetProjectionMatrix()
     {
         _bits &= ~CAMERA_CUSTOM_PROJECTION;
         _bits |= CAMERA_DIRTY_PROJ | CAMERA_DIRTY_VIEW_PROJ | CAMERA_DIRTY_INV_VIEW_PROJ | CAMERA_DIRTY_BOUNDS;
+        _bindingVersion = 0;
 
         cameraChanged();
     }
@@ -453,12 +465,16 @@ Camera* Camera::clone(NodeCloneContext& context)
 void Camera::transformChanged(Transform* transform, long cookie)
 {
     _bits |= CAMERA_DIRTY_VIEW | CAMERA_DIRTY_INV_VIEW | CAMERA_DIRTY_INV_VIEW_PROJ | CAMERA_DIRTY_VIEW_PROJ | CAMERA_DIRTY_BOUNDS;
+    _bindingVersion = 0;
 
     cameraChanged();
 }
 
 void Camera::cameraChanged()
 {
+    // The matrices that nodes derived from the old view or projection are out of date.
+    _version = ++__cameraVersion;
+
     if (_listeners == NULL)
         return;
 
@@ -19,6 +19,7 @@ class NodeCloneContext;
 class Camera : public Ref, public Transform::Listener
 {
     friend class Node;
+    friend class RenderState;
 
 public:
 
@@ -373,6 +374,8 @@ private:
     mutable Matrix _inverseViewProjection;
     mutable Frustum _bounds;
     mutable int _bits;
+    mutable unsigned int _bindingVersion;
+    unsigned int _version;
     Node* _node;
     std::list<Camera::Listener*>* _listeners;
 };
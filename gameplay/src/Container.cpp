@@ -54,9 +54,9 @@ Container::Container()
       _scrollingStartTimeX(0), _scrollingStartTimeY(0), _scrollingLastTime(0),
       _scrollingVelocity(Vector2::zero()), _scrollingFriction(1.0f), _scrollWheelSpeed(400.0f),
       _scrollingRight(false), _scrollingDown(false),
-      _scrollingMouseVertically(false), _scrollingMouseHorizontally(false),
+      _scrollingMouseVertically(false), _scrollingMouseHorizontally(false), _totalWidth(0), _totalHeight(0),
       _scrollBarOpacityClip(NULL), _zIndexDefault(0),
-      _selectButtonDown(false), _lastFrameTime(0), _totalWidth(0), _totalHeight(0),
+      _selectButtonDown(false), _lastFrameTime(0),
       _initializedWithScroll(false), _scrollWheelRequiresFocus(false)
 {
 	clearContacts();
@@ -172,9 +172,6 @@ void Container::addControls(Properties* properties)
         // Get the next control.
         controlSpace = properties->getNextNamespace();
     }
-
-    // Sort controls by Z-Order.
-    sortControls();
 }
 
 const char* Container::getTypeName() const
@@ -233,7 +230,6 @@ unsigned int Container::addControl(Control* control)
 		control->setFocusIndex( maxFocusIndex + 1 );
 	}
 
-	_controls.push_back( control );
 	control->addRef();
 
 	// Remove the control from its current parent
@@ -242,12 +238,17 @@ unsigned int Container::addControl(Control* control)
 		control->_parent->removeControl( control );
 	}
 
+	// Insert the control after the controls of the same or a lower Z-Order, so that the controls stay sorted.
+	std::vector<Control*>::iterator it = _controls.end();
+	if (_layout->getType() == Layout::LAYOUT_ABSOLUTE)
+		it = std::upper_bound(_controls.begin(), _controls.end(), control, &sortControlsByZOrder);
+	it = _controls.insert(it, control);
+
 	control->_parent = this;
 
-	sortControls();
     setDirty(Control::DIRTY_BOUNDS);
 
-	return (unsigned int)( _controls.size() - 1 );
+	return (unsigned int)( it - _controls.begin() );
 }
 
 void Container::insertControl(Control* control, unsigned int index)
@@ -424,6 +425,8 @@ const Vector2& Container::getScrollPosition() const
 void Container::setScrollPosition(const Vector2& scrollPosition)
 {
     _scrollPosition = scrollPosition;
+    setDirty(DIRTY_POSITION);
+    setChildrenDirty(DIRTY_POSITION, true);
 }
 
 Animation* Container::getAnimation(const char* id) const
@@ -657,7 +660,9 @@ unsigned int Container::draw(Form* form, const Rectangle& clip)
     for (size_t i = 0, count = _controls.size(); i < count; ++i)
     {
         Control* control = _controls[i];
-        if (control && control->_absoluteClipBounds.intersects(_absoluteClipBounds))
+        // Skip the controls outside of the region that a cached form draws again.
+        if (control && control->_absoluteClipBounds.intersects(_absoluteClipBounds) &&
+            (!form || form->isRegionDrawn(control->_absoluteClipBounds)))
         {
             drawCalls += control->draw(form, _viewportClipBounds);
         }
@@ -983,7 +988,7 @@ void Container::startScrolling(float x, float y, bool resetTime)
     _scrollingVelocity.set(-x, y);
     _scrolling = true;
     _scrollBarOpacity = 1.0f;
-    setDirty(DIRTY_BOUNDS);
+    setDirty(DIRTY_POSITION);
 
     if (_scrollBarOpacityClip && _scrollBarOpacityClip->isPlaying())
     {
@@ -1001,7 +1006,7 @@ void Container::stopScrolling()
 {
     _scrollingVelocity.set(0, 0);
     _scrolling = false;
-    setDirty(DIRTY_BOUNDS);
+    setDirty(DIRTY_POSITION);
 
     if (_parent)
         _parent->stopScrolling();
@@ -1075,27 +1080,7 @@ void Container::updateScroll()
     const Theme::Padding& containerPadding = getPadding();
 
     // Calculate total width and height.
-    _totalWidth = _totalHeight = 0.0f;
-    std::vector<Control*> controls = getControls();
-    for (size_t i = 0, count = controls.size(); i < count; ++i)
-    {
-        Control* control = _controls[i];
-
-        const Rectangle& bounds = control->getBounds();
-        const Theme::Margin& margin = control->getMargin();
-
-        float newWidth = bounds.x + bounds.width + margin.right;
-        if (newWidth > _totalWidth)
-        {
-            _totalWidth = newWidth;
-        }
-
-        float newHeight = bounds.y + bounds.height + margin.bottom;
-        if (newHeight > _totalHeight)
-        {
-            _totalHeight = newHeight;
-        }
-    }
+    updateContentSize();
 
     float vWidth = getImageRegion("verticalScrollBar", state).width;
     float hHeight = getImageRegion("horizontalScrollBar", state).height;
@@ -1182,23 +1167,52 @@ void Container::updateScroll()
         _scrollBarOpacityClip->play();
     }
 
-    // When scroll position is updated, we need to recompute bounds since children
-    // absolute bounds offset will need to be updated.
+    // When scroll position is updated, we need to recompute the absolute bounds of
+    // our children, although their sizes and layout have not changed.
     if (dirty)
     {
-        setDirty(DIRTY_BOUNDS);
-        setChildrenDirty(DIRTY_BOUNDS, true);
+        setDirty(DIRTY_POSITION);
+        setChildrenDirty(DIRTY_POSITION, true);
     }
 }
 
-void Container::sortControls()
+void Container::updateContentSize()
 {
-    if (_layout->getType() == Layout::LAYOUT_ABSOLUTE)
+    _totalWidth = _totalHeight = 0.0f;
+    for (size_t i = 0, count = _controls.size(); i < count; ++i)
     {
-        std::sort(_controls.begin(), _controls.end(), &sortControlsByZOrder);
+        Control* control = _controls[i];
+
+        const Rectangle& bounds = control->getBounds();
+        const Theme::Margin& margin = control->getMargin();
+
+        float newWidth = bounds.x + bounds.width + margin.right;
+        if (newWidth > _totalWidth)
+        {
+            _totalWidth = newWidth;
+        }
+
+        float newHeight = bounds.y + bounds.height + margin.bottom;
+        if (newHeight > _totalHeight)
+        {
+            _totalHeight = newHeight;
+        }
     }
 }
 
+void Container::sortControl(Control* control)
+{
+    if (_layout->getType() != Layout::LAYOUT_ABSOLUTE)
+        return;
+
+    // The other controls are still sorted, so the control only needs to be moved to its place among them.
+    std::vector<Control*>::iterator it = std::find(_controls.begin(), _controls.end(), control);
+    GP_ASSERT(it != _controls.end());
+    it = _controls.erase(it);
+    it = std::upper_bound(_controls.begin(), _controls.end(), control, &sortControlsByZOrder);
+    _controls.insert(it, control);
+}
+
 bool Container::touchEventScroll(Touch::TouchEvent evt, int x, int y, unsigned int contactIndex)
 {
     switch (evt)
@@ -1221,7 +1235,7 @@ bool Container::touchEventScroll(Touch::TouchEvent evt, int x, int y, unsigned i
             }
             _scrollBarOpacity = 1.0f;
             if (dirty)
-                setDirty(DIRTY_BOUNDS);
+                setDirty(DIRTY_POSITION);
             return false;
         }
         break;
@@ -1284,8 +1298,8 @@ bool Container::touchEventScroll(Touch::TouchEvent evt, int x, int y, unsigned i
                 _scrollingStartTimeY = gameTime;
 
             _scrollingLastTime = gameTime;
-            setDirty(DIRTY_BOUNDS);
-            setChildrenDirty(DIRTY_BOUNDS, true);
+            setDirty(DIRTY_POSITION);
+            setChildrenDirty(DIRTY_POSITION, true);
             return false;
         }
         break;
@@ -1337,7 +1351,7 @@ bool Container::touchEventScroll(Touch::TouchEvent evt, int x, int y, unsigned i
             }
 
             _scrollingMouseVertically = _scrollingMouseHorizontally = false;
-            setDirty(DIRTY_BOUNDS);
+            setDirty(DIRTY_POSITION);
             return false;
         }
         break;
@@ -1418,8 +1432,8 @@ bool Container::mouseEventScroll(Mouse::MouseEvent evt, int x, int y, int wheelD
 
             if (dirty)
             {
-                setDirty(DIRTY_BOUNDS);
-                setChildrenDirty(DIRTY_BOUNDS, true);
+                setDirty(DIRTY_POSITION);
+                setChildrenDirty(DIRTY_POSITION, true);
             }
 
             return touchEventScroll(Touch::TOUCH_PRESS, x, y, 0);
@@ -1447,7 +1461,7 @@ bool Container::mouseEventScroll(Mouse::MouseEvent evt, int x, int y, int wheelD
                 _scrollBarOpacityClip = NULL;
             }
             _scrollBarOpacity = 1.0f;
-            setDirty(DIRTY_BOUNDS);
+            setDirty(DIRTY_POSITION);
             return false;
         }
     }
@@ -1556,6 +1570,7 @@ void Container::setAnimationPropertyValue(int propertyId, AnimationValue* value,
     {
     case ANIMATE_SCROLLBAR_OPACITY:
         _scrollBarOpacity = Curve::lerp(blendWeight, _opacity, value->getFloat(0));
+        setDirty(DIRTY_REDRAW);
         break;
     default:
         Control::setAnimationPropertyValue(propertyId, value, blendWeight);
@@ -398,11 +398,18 @@ protected:
     void updateScroll();
 
     /**
-     * Sorts controls by Z-Order (for absolute layouts only).
+     * Computes the total width and height of the content that is scrolled, from the bounds of the child controls.
+     */
+    virtual void updateContentSize();
+
+    /**
+     * Moves a control to its place in the Z-Order of the other controls (for absolute layouts only).
      * This method is used by controls to notify their parent container when
      * their Z-Index changes.
+     *
+     * @param control The child control whose Z-Index changed.
      */
-    void sortControls();
+    void sortControl(Control* control);
 
     /**
      * Applies touch events to scroll state.
@@ -565,6 +572,14 @@ protected:
      * Locked to scrolling horizontally by grabbing the scrollbar with the mouse.
      */
     bool _scrollingMouseHorizontally;
+    /**
+     * The total width of the content that is scrolled.
+     */
+    float _totalWidth;
+    /**
+     * The total height of the content that is scrolled.
+     */
+    float _totalHeight;
 
 private:
 
@@ -588,9 +603,6 @@ private:
     int _zIndexDefault;
     bool _selectButtonDown;
     double _lastFrameTime;
-
-    float _totalWidth;
-    float _totalHeight;
     bool _contactIndices[MAX_CONTACT_INDICES];
     bool _initializedWithScroll;
     bool _scrollWheelRequiresFocus;
@@ -21,9 +21,9 @@ Control::~Control()
 
     if (_listeners)
     {
-        for (std::map<Control::Listener::EventType, std::list<Control::Listener*>*>::const_iterator itr = _listeners->begin(); itr != _listeners->end(); ++itr)
+        for (std::map<Control::Listener::EventType, std::list<Control::Listener*, PoolAllocator<Control::Listener*> >*>::const_iterator itr = _listeners->begin(); itr != _listeners->end(); ++itr)
         {
-            std::list<Control::Listener*>* list = itr->second;
+            std::list<Control::Listener*, PoolAllocator<Control::Listener*> >* list = itr->second;
             SAFE_DELETE(list);
         }
         SAFE_DELETE(_listeners);
@@ -532,6 +532,7 @@ void Control::setOpacity(float opacity, unsigned char states)
         if (overlays[i])
             overlays[i]->setOpacity(opacity);
     }
+    setDirty(DIRTY_REDRAW);
 }
 
 float Control::getOpacity(State state) const
@@ -601,6 +602,7 @@ void Control::setSkinRegion(const Rectangle& region, unsigned char states)
         if( overlays[i] )
             overlays[i]->setSkinRegion(region, _style->_tw, _style->_th);
     }
+    setDirty(DIRTY_REDRAW);
 }
 
 const Rectangle& Control::getSkinRegion(State state) const
@@ -621,6 +623,7 @@ void Control::setSkinColor(const Vector4& color, unsigned char states)
         if( overlays[i] )
             overlays[i]->setSkinColor(color);
     }
+    setDirty(DIRTY_REDRAW);
 }
 
 const Vector4& Control::getSkinColor(State state) const
@@ -669,6 +672,7 @@ void Control::setImageRegion(const char* id, const Rectangle& region, unsigned c
         if( overlays[i] )
             overlays[i]->setImageRegion(id, region, _style->_tw, _style->_th);
     }
+    setDirty(DIRTY_REDRAW);
 }
 
 const Rectangle& Control::getImageRegion(const char* id, State state) const
@@ -689,6 +693,7 @@ void Control::setImageColor(const char* id, const Vector4& color, unsigned char
         if( overlays[i] )
             overlays[i]->setImageColor(id, color);
     }
+    setDirty(DIRTY_REDRAW);
 }
 
 const Vector4& Control::getImageColor(const char* id, State state) const
@@ -716,6 +721,7 @@ void Control::setCursorRegion(const Rectangle& region, unsigned char states)
         if( overlays[i] )
             overlays[i]->setCursorRegion(region, _style->_tw, _style->_th);
     }
+    setDirty(DIRTY_REDRAW);
 }
 
 const Rectangle& Control::getCursorRegion(State state) const
@@ -736,6 +742,7 @@ void Control::setCursorColor(const Vector4& color, unsigned char states)
         if( overlays[i] )
             overlays[i]->setCursorColor(color);
     }
+    setDirty(DIRTY_REDRAW);
 }
 
 const Vector4& Control::getCursorColor(State state)
@@ -809,6 +816,7 @@ void Control::setTextColor(const Vector4& color, unsigned char states)
         if( overlays[i] )
             overlays[i]->setTextColor(color);
     }
+    setDirty(DIRTY_REDRAW);
 }
 
 const Vector4& Control::getTextColor(State state) const
@@ -829,6 +837,7 @@ void Control::setTextAlignment(Font::Justify alignment, unsigned char states)
         if( overlays[i] )
             overlays[i]->setTextAlignment(alignment);
     }
+    setDirty(DIRTY_REDRAW);
 }
 
 Font::Justify Control::getTextAlignment(State state) const
@@ -849,6 +858,7 @@ void Control::setTextRightToLeft(bool rightToLeft, unsigned char states)
         if( overlays[i] )
             overlays[i]->setTextRightToLeft(rightToLeft);
     }
+    setDirty(DIRTY_REDRAW);
 }
 
 bool Control::getTextRightToLeft(State state) const
@@ -930,8 +940,9 @@ void Control::setZIndex(int zIndex)
 
         if (_parent)
         {
-			_parent->sortControls();
+			_parent->sortControl(this);
         }
+        setDirty(DIRTY_REDRAW);
     }
 }
 
@@ -980,13 +991,13 @@ void Control::removeListener(Control::Listener* listener)
     if (_listeners == NULL || listener == NULL)
         return;
 
-    for (std::map<Control::Listener::EventType, std::list<Control::Listener*>*>::iterator itr = _listeners->begin(); itr != _listeners->end();)
+    for (std::map<Control::Listener::EventType, std::list<Control::Listener*, PoolAllocator<Control::Listener*> >*>::iterator itr = _listeners->begin(); itr != _listeners->end();)
     {
         itr->second->remove(listener);
 
         if(itr->second->empty())
         {
-            std::list<Control::Listener*>* list = itr->second;
+            std::list<Control::Listener*, PoolAllocator<Control::Listener*> >* list = itr->second;
             _listeners->erase(itr++);
             SAFE_DELETE(list);
         }
@@ -1004,17 +1015,17 @@ void Control::addSpecificListener(Control::Listener* listener, Control::Listener
 
     if (!_listeners)
     {
-        _listeners = new std::map<Control::Listener::EventType, std::list<Control::Listener*>*>();
+        _listeners = new std::map<Control::Listener::EventType, std::list<Control::Listener*, PoolAllocator<Control::Listener*> >*>();
     }
 
-    std::map<Control::Listener::EventType, std::list<Control::Listener*>*>::const_iterator itr = _listeners->find(eventType);
+    std::map<Control::Listener::EventType, std::list<Control::Listener*, PoolAllocator<Control::Listener*> >*>::const_iterator itr = _listeners->find(eventType);
     if (itr == _listeners->end())
     {
-        _listeners->insert(std::make_pair(eventType, new std::list<Control::Listener*>()));
+        _listeners->insert(std::make_pair(eventType, new std::list<Control::Listener*, PoolAllocator<Control::Listener*> >()));
         itr = _listeners->find(eventType);
     }
 
-    std::list<Control::Listener*>* listenerList = itr->second;
+    std::list<Control::Listener*, PoolAllocator<Control::Listener*> >* listenerList = itr->second;
     listenerList->push_back(listener);
 }
 
@@ -1061,11 +1072,11 @@ void Control::notifyListeners(Control::Listener::EventType eventType)
 
     if (_listeners)
     {
-        std::map<Control::Listener::EventType, std::list<Control::Listener*>*>::const_iterator itr = _listeners->find(eventType);
+        std::map<Control::Listener::EventType, std::list<Control::Listener*, PoolAllocator<Control::Listener*> >*>::const_iterator itr = _listeners->find(eventType);
         if (itr != _listeners->end())
         {
-            std::list<Control::Listener*>* listenerList = itr->second;
-            for (std::list<Control::Listener*>::iterator listenerItr = listenerList->begin(); listenerItr != listenerList->end(); ++listenerItr)
+            std::list<Control::Listener*, PoolAllocator<Control::Listener*> >* listenerList = itr->second;
+            for (std::list<Control::Listener*, PoolAllocator<Control::Listener*> >::iterator listenerItr = listenerList->begin(); listenerItr != listenerList->end(); ++listenerItr)
             {
                 GP_ASSERT(*listenerItr);
                 (*listenerItr)->controlEvent(this, eventType);
@@ -1084,7 +1095,12 @@ void Control::controlEvent(Control::Listener::EventType evt)
 
 void Control::setDirty(int bits)
 {
-    _dirtyBits |= bits;
+    _dirtyBits |= bits & ~DIRTY_REDRAW;
+
+    // Let the form lay out its controls, or draw this control again if it caches its drawing.
+    Form* form = getTopLevelForm();
+    if (form)
+        form->controlDirty(this, bits);
 }
 
 bool Control::isDirty(int bit) const
@@ -1102,9 +1118,12 @@ void Control::update(float elapsedTime)
 
     // Since opacity is pre-multiplied, we compute it every frame so that we don't need to
     // dirty the entire hierarchy any time a state changes (which could affect opacity).
+    float opacity = _opacity;
     _opacity = getOpacity(state);
     if (_parent)
         _opacity *= _parent->_opacity;
+    if (_opacity != opacity)
+        setDirty(DIRTY_REDRAW);
 }
 
 void Control::updateState(State state)
@@ -1127,16 +1146,17 @@ bool Control::updateBoundsInternal(const Vector2& offset)
         _dirtyBits &= ~DIRTY_STATE;
     }
 
-    // Clear our dirty bounds bit
+    // Clear our dirty bounds bits
     bool dirtyBounds = (_dirtyBits & DIRTY_BOUNDS) != 0;
-    _dirtyBits &= ~DIRTY_BOUNDS;
+    bool dirtyPosition = (_dirtyBits & DIRTY_POSITION) != 0;
+    _dirtyBits &= ~(DIRTY_BOUNDS | DIRTY_POSITION);
 
     // If we are a container, always update child bounds first
     bool changed = false;
     if (isContainer())
         changed = static_cast<Container*>(this)->updateChildBounds();
 
-    if (dirtyBounds)
+    if (dirtyBounds || dirtyPosition)
     {
         // Store old bounds so we can determine if they change
         Rectangle oldAbsoluteBounds(_absoluteBounds);
@@ -1144,7 +1164,9 @@ bool Control::updateBoundsInternal(const Vector2& offset)
         Rectangle oldViewportBounds(_viewportBounds);
         Rectangle oldViewportClipBounds(_viewportClipBounds);
 
-        updateBounds();
+        // A control that only moved keeps its measured size and the layout of its children.
+        if (dirtyBounds)
+            updateBounds();
         updateAbsoluteBounds(offset);
 
         if (_absoluteBounds != oldAbsoluteBounds ||
@@ -1153,7 +1175,14 @@ bool Control::updateBoundsInternal(const Vector2& offset)
             _viewportClipBounds != oldViewportClipBounds)
         {
             if (isContainer())
-                static_cast<Container*>(this)->setChildrenDirty(DIRTY_BOUNDS, true);
+            {
+                // Children are only measured and laid out again when the area they are laid out in changed size.
+                bool resized = _absoluteBounds.width != oldAbsoluteBounds.width ||
+                               _absoluteBounds.height != oldAbsoluteBounds.height ||
+                               _viewportBounds.width != oldViewportBounds.width ||
+                               _viewportBounds.height != oldViewportBounds.height;
+                static_cast<Container*>(this)->setChildrenDirty(resized ? DIRTY_BOUNDS : DIRTY_POSITION, true);
+            }
             changed = true;
         }
     }
@@ -1307,86 +1336,44 @@ unsigned int Control::drawBorder(Form* form, const Rectangle& clip)
     SpriteBatch* batch = _style->getTheme()->getSpriteBatch();
     startBatch(form, batch);
 
-    // Get the border and background images for this control's current state.
-    const Theme::UVs& topLeft = _skin->getUVs(Theme::Skin::TOP_LEFT);
-    const Theme::UVs& top = _skin->getUVs(Theme::Skin::TOP);
-    const Theme::UVs& topRight = _skin->getUVs(Theme::Skin::TOP_RIGHT);
-    const Theme::UVs& left = _skin->getUVs(Theme::Skin::LEFT);
-    const Theme::UVs& center = _skin->getUVs(Theme::Skin::CENTER);
-    const Theme::UVs& right = _skin->getUVs(Theme::Skin::RIGHT);
-    const Theme::UVs& bottomLeft = _skin->getUVs(Theme::Skin::BOTTOM_LEFT);
-    const Theme::UVs& bottom = _skin->getUVs(Theme::Skin::BOTTOM);
-    const Theme::UVs& bottomRight = _skin->getUVs(Theme::Skin::BOTTOM_RIGHT);
-
-    // Calculate screen-space positions.
-    const Theme::Border& border = getBorder(getState());
-    const Theme::Padding& padding = getPadding();
     Vector4 skinColor = _skin->getColor();
     skinColor.w *= _opacity;
 
-    float midWidth = _absoluteBounds.width - border.left - border.right;
-    float midHeight = _absoluteBounds.height - border.top - border.bottom;
-    float midX = _absoluteBounds.x + border.left;
-    float midY = _absoluteBounds.y + border.top;
-    float rightX = _absoluteBounds.x + _absoluteBounds.width - border.right;
-    float bottomY = _absoluteBounds.y + _absoluteBounds.height - border.bottom;
-
-    // Draw themed border sprites.
-    if (!border.left && !border.right && !border.top && !border.bottom)
-    {
-        // No border, just draw the image.
-        batch->draw(_absoluteBounds.x, _absoluteBounds.y, _absoluteBounds.width, _absoluteBounds.height, center.u1, center.v1, center.u2, center.v2, skinColor, clip);
+    // The slices of the skin are placed over the bounds of the control and added to the batch as a
+    // single strip, with degenerate triangles between them.
+    SpriteBatch::SpriteVertex vertices[9 * 4];
+    unsigned short indices[9 * 6];
+    unsigned int vertexCount = 0;
+    unsigned int indexCount = 0;
+    for (unsigned int i = 0; i < _skin->_patchCount; ++i)
+    {
+        const Theme::Skin::Patch& patch = _skin->_patches[i];
+        float x = _absoluteBounds.x + patch.x1 + patch.fx1 * _absoluteBounds.width;
+        float y = _absoluteBounds.y + patch.y1 + patch.fy1 * _absoluteBounds.height;
+        float width = _absoluteBounds.x + patch.x2 + patch.fx2 * _absoluteBounds.width - x;
+        float height = _absoluteBounds.y + patch.y2 + patch.fy2 * _absoluteBounds.height - y;
+        float u1 = patch.uvs.u1;
+        float v1 = patch.uvs.v1;
+        float u2 = patch.uvs.u2;
+        float v2 = patch.uvs.v2;
         ++drawCalls;
-    }
-    else
-    {
-        if (border.left && border.top)
-        {
-            batch->draw(_absoluteBounds.x, _absoluteBounds.y, border.left, border.top, topLeft.u1, topLeft.v1, topLeft.u2, topLeft.v2, skinColor, clip);
-            ++drawCalls;
-        }
-        if (border.top)
-        {
-            batch->draw(_absoluteBounds.x + border.left, _absoluteBounds.y, midWidth, border.top, top.u1, top.v1, top.u2, top.v2, skinColor, clip);
-            ++drawCalls;
-        }
-        if (border.right && border.top)
-        {
-            batch->draw(rightX, _absoluteBounds.y, border.right, border.top, topRight.u1, topRight.v1, topRight.u2, topRight.v2, skinColor, clip);
-            ++drawCalls;
-        }
-        if (border.left)
-        {
-            batch->draw(_absoluteBounds.x, midY, border.left, midHeight, left.u1, left.v1, left.u2, left.v2, skinColor, clip);
-            ++drawCalls;
-        }
 
-        // Always draw the background.
-        batch->draw(_absoluteBounds.x + border.left, _absoluteBounds.y + border.top, _absoluteBounds.width - border.left - border.right, _absoluteBounds.height - border.top - border.bottom,
-            center.u1, center.v1, center.u2, center.v2, skinColor, clip);
-        ++drawCalls;
+        // Only add the slices that are at least partly within the clip region.
+        if (!batch->clipSprite(clip, x, y, width, height, u1, v1, u2, v2))
+            continue;
 
-        if (border.right)
-        {
-            batch->draw(rightX, midY, border.right, midHeight, right.u1, right.v1, right.u2, right.v2, skinColor, clip);
-            ++drawCalls;
-        }
-        if (border.bottom && border.left)
-        {
-            batch->draw(_absoluteBounds.x, bottomY, border.left, border.bottom, bottomLeft.u1, bottomLeft.v1, bottomLeft.u2, bottomLeft.v2, skinColor, clip);
-            ++drawCalls;
-        }
-        if (border.bottom)
-        {
-            batch->draw(midX, bottomY, midWidth, border.bottom, bottom.u1, bottom.v1, bottom.u2, bottom.v2, skinColor, clip);
-            ++drawCalls;
-        }
-        if (border.bottom && border.right)
+        batch->addSprite(x, y, width, height, u1, v1, u2, v2, skinColor, &vertices[vertexCount]);
+        if (vertexCount > 0)
         {
-            batch->draw(rightX, bottomY, border.right, border.bottom, bottomRight.u1, bottomRight.v1, bottomRight.u2, bottomRight.v2, skinColor, clip);
-            ++drawCalls;
+            indices[indexCount++] = vertexCount - 1;
+            indices[indexCount++] = vertexCount;
         }
+        for (unsigned int j = 0; j < 4; ++j)
+            indices[indexCount++] = vertexCount + j;
+        vertexCount += 4;
     }
+    if (vertexCount > 0)
+        batch->draw(vertices, vertexCount, indices, indexCount);
 
     finishBatch(form, batch);
 
@@ -1749,6 +1736,7 @@ void Control::setCursor(Theme::ThemeImage* cursor, unsigned char states)
         if( overlays[i] )
             overlays[i]->setCursor(cursor);
     }
+    setDirty(DIRTY_REDRAW);
 }
 
 void Control::setSkin(Theme::Skin* skin, unsigned char states)
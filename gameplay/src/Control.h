@@ -10,6 +10,7 @@
 #include "Keyboard.h"
 #include "Mouse.h"
 #include "ScriptTarget.h"
+#include "MemoryPool.h"
 #include "Gamepad.h"
 
 namespace gameplay
@@ -992,6 +993,20 @@ protected:
      */
     static const int DIRTY_STATE = 2;
 
+    /**
+     * Indicates that the control looks different, although its bounds and state did not change.
+     *
+     * This only matters to forms that cache their drawing, which draw the control again.
+     */
+    static const int DIRTY_REDRAW = 4;
+
+    /**
+     * Indicates that the control has moved along with its parent, such as when the parent is scrolled.
+     *
+     * Only the absolute bounds of the control are computed again, and not its size or the layout of its children.
+     */
+    static const int DIRTY_POSITION = 8;
+
     /**
      * Indicates that the x position of the control is a percentage.
      */
@@ -1311,7 +1326,8 @@ protected:
     /**
      * Sets dirty bits for the control.
      *
-     * Valid bits are any of the "DIRTY_xxx" constants from the Control class.
+     * Valid bits are any of the "DIRTY_xxx" constants from the Control class. The form of
+     * the control is notified, so that it lays out and draws its controls again.
      *
      * @param bits Dirty bits to set.
      */
@@ -1423,7 +1439,7 @@ protected:
     /**
      * Listeners map of EventType's to a list of Listeners.
      */
-    std::map<Control::Listener::EventType, std::list<Control::Listener*>*>* _listeners;
+    std::map<Control::Listener::EventType, std::list<Control::Listener*, PoolAllocator<Control::Listener*> >*>* _listeners;
     
     /**
      * The Control's Theme::Style.
@@ -5,6 +5,7 @@
 #include "CheckBox.h"
 #include "RadioButton.h"
 #include "Container.h"
+#include "ListView.h"
 #include "Slider.h"
 #include "TextBox.h"
 #include "JoystickControl.h"
@@ -83,6 +84,7 @@ void ControlFactory::registerStandardControls()
     registerCustomControl("CHECKBOX", &CheckBox::create);
     registerCustomControl("RADIOBUTTON", &RadioButton::create);
     registerCustomControl("CONTAINER", &Container::create);
+    registerCustomControl("LISTVIEW", &ListView::create);
     registerCustomControl("SLIDER", &Slider::create);
     registerCustomControl("TEXTBOX", &TextBox::create);
     registerCustomControl("JOYSTICK", &JoystickControl::create); // convenience alias
@@ -1,12 +1,15 @@
 // Purposely not including Base.h here, or any other gameplay dependencies, so it can be reused between gameplay and gameplay-encoder.
 #include "Curve.h"
 #include "Quaternion.h"
+#include "SimdMath.h"
+#include "MemoryStats.h"
 #include <cassert>
 #include <cstring>
 #include <cmath>
 #include <memory>
 
 using std::memcpy;
+using std::memset;
 using std::fabs;
 using std::sqrt;
 using std::cos;
@@ -26,6 +29,16 @@ using std::strcmp;
 #define MATH_PIOVER2 1.57079632679489661923f
 #endif
 
+#ifndef MATH_1_OVER_SQRT2
+#define MATH_1_OVER_SQRT2 0.70710678118654752440f
+#endif
+
+// The largest quantized value of a smallest three quaternion component (15 bits)
+#define QUATERNION_QUANTIZED_MAX 32767.0f
+
+// The maximum number of components of a compressed curve
+#define COMPRESSED_MAX_COMPONENTS 16
+
 #ifndef MATH_PIX2
 #define MATH_PIX2 6.28318530717958647693f
 #endif
@@ -83,13 +96,68 @@ static inline float lerpInl(float s, float from, float to)
 namespace gameplay
 {
 
+static inline void lerpComponents(float s, const float* from, const float* to, float* dst, unsigned int count)
+{
+    unsigned int i = 0;
+#ifdef GP_USE_SIMD
+    // Interpolate four components at a time.
+    Float4 s4 = splat4(s);
+    for (; i + 4 <= count; i += 4)
+    {
+        Float4 from4 = load4(from + i);
+        store4(dst + i, add4(from4, mul4(sub4(load4(to + i), from4), s4)));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        if (from[i] == to[i])
+            dst[i] = from[i];
+        else
+            dst[i] = lerpInl(s, from[i], to[i]);
+    }
+}
+
 Curve* Curve::create(unsigned int pointCount, unsigned int componentCount)
 {
-    return new Curve(pointCount, componentCount);
+    Curve* curve = new Curve(pointCount, componentCount);
+    MemoryStats::add(MemoryStats::ANIMATIONS, curve->getMemorySize());
+    return curve;
+}
+
+Curve* Curve::createCompressed(unsigned int pointCount, unsigned int componentCount, int quaternionOffset,
+                               const float* keyTimes, const float* keyRanges, const unsigned short* keyData)
+{
+    assert(pointCount > 0 && componentCount > 0 && componentCount <= COMPRESSED_MAX_COMPONENTS);
+    assert(quaternionOffset < 0 || (unsigned int)quaternionOffset + 4 <= componentCount);
+    assert(keyTimes && keyData);
+
+    unsigned int keyStride = getCompressedKeyStride(componentCount, quaternionOffset);
+    unsigned int rangeCount = quaternionOffset < 0 ? componentCount : componentCount - 4;
+
+    Curve* curve = new Curve(pointCount, componentCount, keyStride);
+    memcpy(curve->_keyTimes, keyTimes, sizeof(float) * pointCount);
+    if (rangeCount > 0)
+    {
+        assert(keyRanges);
+        curve->_keyRanges = new float[rangeCount * 2];
+        memcpy(curve->_keyRanges, keyRanges, sizeof(float) * rangeCount * 2);
+    }
+    memcpy(curve->_keyData, keyData, sizeof(unsigned short) * pointCount * keyStride);
+    if (quaternionOffset >= 0)
+        curve->setQuaternionOffset((unsigned int)quaternionOffset);
+    MemoryStats::add(MemoryStats::ANIMATIONS, curve->getMemorySize());
+    return curve;
+}
+
+unsigned int Curve::getCompressedKeyStride(unsigned int componentCount, int quaternionOffset)
+{
+    // A quaternion is stored as its three smallest components.
+    return quaternionOffset < 0 ? componentCount : componentCount - 1;
 }
 
 Curve::Curve(unsigned int pointCount, unsigned int componentCount)
-    : _pointCount(pointCount), _componentCount(componentCount), _componentSize(sizeof(float)*componentCount), _quaternionOffset(NULL), _points(NULL)
+    : _pointCount(pointCount), _componentCount(componentCount), _componentSize(sizeof(float)*componentCount), _quaternionOffset(NULL), _points(NULL),
+      _keyTimes(NULL), _keyRanges(NULL), _keyData(NULL), _keyStride(0)
 {
     _points = new Point[_pointCount];
     for (unsigned int i = 0; i < _pointCount; i++)
@@ -103,10 +171,34 @@ Curve::Curve(unsigned int pointCount, unsigned int componentCount)
     _points[_pointCount - 1].time = 1.0f;
 }
 
+Curve::Curve(unsigned int pointCount, unsigned int componentCount, unsigned int keyStride)
+    : _pointCount(pointCount), _componentCount(componentCount), _componentSize(sizeof(float)*componentCount), _quaternionOffset(NULL), _points(NULL),
+      _keyTimes(NULL), _keyRanges(NULL), _keyData(NULL), _keyStride(keyStride)
+{
+    _keyTimes = new float[_pointCount];
+    _keyData = new unsigned short[_pointCount * _keyStride];
+}
+
 Curve::~Curve()
 {
+    MemoryStats::remove(MemoryStats::ANIMATIONS, getMemorySize());
+
     SAFE_DELETE_ARRAY(_points);
     SAFE_DELETE_ARRAY(_quaternionOffset);
+    SAFE_DELETE_ARRAY(_keyTimes);
+    SAFE_DELETE_ARRAY(_keyRanges);
+    SAFE_DELETE_ARRAY(_keyData);
+}
+
+unsigned int Curve::getMemorySize() const
+{
+    if (_points)
+        return _pointCount * (sizeof(Point) + 3 * _componentSize);
+
+    unsigned int size = _pointCount * (sizeof(float) + _keyStride * sizeof(unsigned short));
+    if (_keyRanges)
+        size += (_quaternionOffset ? _componentCount - 4 : _componentCount) * 2 * sizeof(float);
+    return size;
 }
 
 Curve::Point::Point()
@@ -133,17 +225,23 @@ unsigned int Curve::getComponentCount() const
 
 float Curve::getStartTime() const
 {
+    if (_keyData)
+        return _keyTimes[0];
     return _points[0].time;
 }
 
 float Curve::getEndTime() const
 {
+    if (_keyData)
+        return _keyTimes[_pointCount-1];
     return _points[_pointCount-1].time;
 }
 
 float Curve::getPointTime(unsigned int index) const
 {
     assert(index < _pointCount);
+    if (_keyData)
+        return _keyTimes[index];
     return _points[index].time;
 }
 
@@ -151,12 +249,28 @@ float Curve::getPointTime(unsigned int index) const
 Curve::InterpolationType Curve::getPointInterpolation(unsigned int index) const
 {
     assert(index < _pointCount);
+    if (_keyData)
+        return LINEAR;
     return _points[index].type;;
 }
 
 void Curve::getPointValues(unsigned int index, float* value, float* inValue, float* outValue) const
 {
     assert(index < _pointCount);
+
+    if (_keyData)
+    {
+        // Compressed curves are linear, so their tangents are not stored.
+        float key[COMPRESSED_MAX_COMPONENTS];
+        decodeKey(index, key);
+        if (value)
+            memcpy(value, key, _componentSize);
+        if (inValue)
+            memset(inValue, 0, _componentSize);
+        if (outValue)
+            memset(outValue, 0, _componentSize);
+        return;
+    }
     
     if (value)
         memcpy(value, _points[index].value, _componentSize);
@@ -175,6 +289,7 @@ void Curve::setPoint(unsigned int index, float time, float* value, Interpolation
 
 void Curve::setPoint(unsigned int index, float time, float* value, InterpolationType type, float* inValue, float* outValue)
 {
+    assert(_keyData == NULL);
     assert(index < _pointCount && time >= 0.0f && time <= 1.0f && !(_pointCount > 1 && index == 0 && time != 0.0f) && !(_pointCount != 1 && index == _pointCount - 1 && time != 1.0f));
 
     _points[index].time = time;
@@ -192,6 +307,7 @@ void Curve::setPoint(unsigned int index, float time, float* value, Interpolation
 
 void Curve::setTangent(unsigned int index, InterpolationType type, float* inValue, float* outValue)
 {
+    assert(_keyData == NULL);
     assert(index < _pointCount);
 
     _points[index].type = type;
@@ -211,9 +327,20 @@ void Curve::evaluate(float time, float* dst) const
 }
 
 void Curve::evaluate(float time, float startTime, float endTime, float loopBlendTime, float* dst) const
+{
+    evaluate(time, startTime, endTime, loopBlendTime, dst, NULL);
+}
+
+void Curve::evaluate(float time, float startTime, float endTime, float loopBlendTime, float* dst, unsigned int* cursor) const
 {
     assert(dst && startTime >= 0.0f && startTime <= endTime && endTime <= 1.0f && loopBlendTime >= 0.0f);
 
+    if (_keyData)
+    {
+        evaluateCompressed(time, startTime, endTime, loopBlendTime, dst, cursor);
+        return;
+    }
+
     // If there's only one point on the curve, return its value.
     if (_pointCount == 1)
     {
@@ -284,7 +411,7 @@ void Curve::evaluate(float time, float startTime, float endTime, float loopBlend
     else
     {
         // Locate the points we are interpolating between using a binary search.
-        index = determineIndex(localTime, min, max);
+        index = determineIndex(localTime, min, max, cursor);
         from = &_points[index];
         to = &_points[index == max ? index : index+1];
 
@@ -1198,43 +1325,27 @@ void Curve::interpolateHermiteSmooth(float s, unsigned int index, Point* from, P
 
 void Curve::interpolateLinear(float s, Point* from, Point* to, float* dst) const
 {
-    float* fromValue = from->value;
-    float* toValue = to->value;
+    interpolateLinearValues(s, from->value, to->value, dst);
+}
 
+void Curve::interpolateLinearValues(float s, float* fromValue, float* toValue, float* dst) const
+{
     if (!_quaternionOffset)
     {
-        for (unsigned int i = 0; i < _componentCount; i++)
-        {
-            if (fromValue[i] == toValue[i])
-                dst[i] = fromValue[i];
-            else
-                dst[i] = lerpInl(s, fromValue[i], toValue[i]);
-        }
+        lerpComponents(s, fromValue, toValue, dst, _componentCount);
     }
     else
     {
         // Interpolate any values up to the quaternion offset as scalars.
         unsigned int quaternionOffset = *_quaternionOffset;
-        unsigned int i = 0;
-        for (i = 0; i < quaternionOffset; i++)
-        {
-            if (fromValue[i] == toValue[i])
-                dst[i] = fromValue[i];
-            else
-                dst[i] = lerpInl(s, fromValue[i], toValue[i]);
-        }
+        lerpComponents(s, fromValue, toValue, dst, quaternionOffset);
 
         // Handle quaternion component.
-        interpolateQuaternion(s, (fromValue + i), (toValue + i), (dst + i));
+        interpolateQuaternion(s, (fromValue + quaternionOffset), (toValue + quaternionOffset), (dst + quaternionOffset));
         
         // handle any remaining components as scalars
-        for (i += 4; i < _componentCount; i++)
-        {
-            if (fromValue[i] == toValue[i])
-                dst[i] = fromValue[i];
-            else
-                dst[i] = lerpInl(s, fromValue[i], toValue[i]);
-        }
+        unsigned int i = quaternionOffset + 4;
+        lerpComponents(s, fromValue + i, toValue + i, dst + i, _componentCount - i);
     }
 }
 
@@ -1267,6 +1378,187 @@ int Curve::determineIndex(float time, unsigned int min, unsigned int max) const
     return max;
 }
 
+int Curve::determineIndex(float time, unsigned int min, unsigned int max, unsigned int* cursor) const
+{
+    if (cursor == NULL)
+        return determineIndex(time, min, max);
+
+    // Playback usually stays within the segment of the last evaluation or moves to a neighbouring one.
+    unsigned int index = *cursor;
+    if (index >= min && index < max)
+    {
+        if (time >= _points[index].time)
+        {
+            if (time < _points[index + 1].time)
+                return index;
+            if (index + 2 <= max && time < _points[index + 2].time)
+            {
+                *cursor = index + 1;
+                return index + 1;
+            }
+        }
+        else if (index > min && time >= _points[index - 1].time)
+        {
+            *cursor = index - 1;
+            return index - 1;
+        }
+    }
+
+    *cursor = determineIndex(time, min, max);
+    return *cursor;
+}
+
+void Curve::decodeKey(unsigned int index, float* dst) const
+{
+    const unsigned short* key = _keyData + index * _keyStride;
+    const float* range = _keyRanges;
+    unsigned int quaternionOffset = _quaternionOffset ? *_quaternionOffset : _componentCount;
+
+    for (unsigned int i = 0; i < _componentCount; ++i)
+    {
+        if (i == quaternionOffset)
+        {
+            // The index of the largest component is stored in the low bits of the first two values.
+            unsigned int largest = (key[0] & 1) | ((key[1] & 1) << 1);
+            float* q = dst + i;
+            float sum = 0.0f;
+            for (unsigned int j = 0, k = 0; j < 4; ++j)
+            {
+                if (j == largest)
+                    continue;
+                q[j] = ((float)(key[k++] >> 1) / QUATERNION_QUANTIZED_MAX * 2.0f - 1.0f) * MATH_1_OVER_SQRT2;
+                sum += q[j] * q[j];
+            }
+            q[largest] = sum < 1.0f ? sqrt(1.0f - sum) : 0.0f;
+            key += 3;
+            i += 3;
+        }
+        else
+        {
+            dst[i] = range[0] + range[1] * (float)*key++;
+            range += 2;
+        }
+    }
+}
+
+unsigned int Curve::determineKeyIndex(float time, unsigned int min, unsigned int max, unsigned int* cursor) const
+{
+    if (cursor && *cursor >= min && *cursor < max)
+    {
+        unsigned int index = *cursor;
+        if (time >= _keyTimes[index])
+        {
+            if (time < _keyTimes[index + 1])
+                return index;
+            if (index + 2 <= max && time < _keyTimes[index + 2])
+            {
+                *cursor = index + 1;
+                return index + 1;
+            }
+        }
+        else if (index > min && time >= _keyTimes[index - 1])
+        {
+            *cursor = index - 1;
+            return index - 1;
+        }
+    }
+
+    // Find the last key at or before the time.
+    const float* first = _keyTimes + min + 1;
+    const float* last = _keyTimes + max + 1;
+    unsigned int index = min;
+    while (first < last)
+    {
+        const float* mid = first + (last - first) / 2;
+        if (*mid <= time)
+        {
+            index = (unsigned int)(mid - _keyTimes);
+            first = mid + 1;
+        }
+        else
+        {
+            last = mid;
+        }
+    }
+    if (cursor)
+        *cursor = index;
+    return index;
+}
+
+void Curve::evaluateCompressed(float time, float startTime, float endTime, float loopBlendTime, float* dst, unsigned int* cursor) const
+{
+    if (_pointCount == 1)
+    {
+        decodeKey(0, dst);
+        return;
+    }
+
+    unsigned int min = 0;
+    unsigned int max = _pointCount - 1;
+    float localTime = time;
+    if (startTime > 0.0f || endTime < 1.0f)
+    {
+        // Evaluating a sub section of the curve
+        min = determineKeyIndex(startTime, 0, max, NULL);
+        max = determineKeyIndex(endTime, min, max, NULL);
+
+        // Convert time to fall within the subregion
+        localTime = _keyTimes[min] + (_keyTimes[max] - _keyTimes[min]) * time;
+    }
+
+    if (loopBlendTime == 0.0f)
+    {
+        // If no loop blend time is specified, clamp time to end points
+        if (localTime < _keyTimes[min])
+            localTime = _keyTimes[min];
+        else if (localTime > _keyTimes[max])
+            localTime = _keyTimes[max];
+    }
+
+    // If an exact endpoint was specified, skip interpolation and return the value directly
+    if (localTime == _keyTimes[min])
+    {
+        decodeKey(min, dst);
+        return;
+    }
+    if (localTime == _keyTimes[max])
+    {
+        decodeKey(max, dst);
+        return;
+    }
+
+    unsigned int fromIndex;
+    unsigned int toIndex;
+    float t;
+    if (localTime > _keyTimes[max])
+    {
+        // Looping forward
+        fromIndex = max;
+        toIndex = min;
+        t = (localTime - _keyTimes[max]) / loopBlendTime;
+    }
+    else if (localTime < _keyTimes[min])
+    {
+        // Looping in reverse
+        fromIndex = min;
+        toIndex = max;
+        t = (_keyTimes[min] - localTime) / loopBlendTime;
+    }
+    else
+    {
+        // Locate the keys we are interpolating between.
+        fromIndex = determineKeyIndex(localTime, min, max, cursor);
+        toIndex = fromIndex == max ? fromIndex : fromIndex + 1;
+        t = (localTime - _keyTimes[fromIndex]) / (_keyTimes[toIndex] - _keyTimes[fromIndex]);
+    }
+
+    float from[COMPRESSED_MAX_COMPONENTS];
+    float to[COMPRESSED_MAX_COMPONENTS];
+    decodeKey(fromIndex, from);
+    decodeKey(toIndex, to);
+    interpolateLinearValues(t, from, to, dst);
+}
+
 int Curve::getInterpolationType(const char* curveId)
 {
     if (strcmp(curveId, "BEZIER") == 0)
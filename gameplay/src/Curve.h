@@ -16,6 +16,7 @@ class Curve : public Ref
     friend class AnimationClip;
     friend class AnimationController;
     friend class MeshSkin;
+    friend class Bundle;
 
 public:
 
@@ -414,6 +415,28 @@ public:
      */
     void evaluate(float time, float startTime, float endTime, float loopBlendTime, float* dst) const;
 
+    /**
+     * Evaluates the curve at the given position value, within the specified subregion,
+     * starting the search for the surrounding keyframes at a cursor.
+     *
+     * This is the same as the method above, except that the index of the keyframe that
+     * the curve was last evaluated from is kept in the cursor. When a curve is played back,
+     * each evaluation is usually in the same segment of the curve as the last one or in
+     * the next one, which are checked before searching all of the keyframes. Every user
+     * of the curve, such as each clip that plays it, should keep its own cursor, starting
+     * from zero.
+     *
+     * @param time The position within the subregion of the curve to evaluate the curve at.
+     * @param startTime Start time for the subregion (between 0.0 - 1.0).
+     * @param endTime End time for the subregion (between 0.0 - 1.0).
+     * @param loopBlendTime Time (in milliseconds) to blend between the end points of the curve
+     *      for looping purposes when time is outside the range 0-1.
+     * @param dst The evaluated value of the curve at the given time.
+     * @param cursor The cursor that holds the keyframe index of the last evaluation.
+     * @script{ignore}
+     */
+    void evaluate(float time, float startTime, float endTime, float loopBlendTime, float* dst, unsigned int* cursor) const;
+
     /**
      * Linear interpolation function.
      */
@@ -468,6 +491,20 @@ private:
      */
     Curve(unsigned int pointCount, unsigned int componentCount);
 
+    /**
+     * Constructor for compressed curves, which do not allocate points.
+     *
+     * @param pointCount The number of keys in the curve.
+     * @param componentCount The number of float component values per key value.
+     * @param keyStride The number of quantized values stored per key.
+     */
+    Curve(unsigned int pointCount, unsigned int componentCount, unsigned int keyStride);
+
+    /**
+     * Returns the memory that the keys of the curve use, in bytes.
+     */
+    unsigned int getMemorySize() const;
+
     /**
      * Constructor.
      */
@@ -513,6 +550,11 @@ private:
      */
     void interpolateLinear(float s, Point* from, Point* to, float* dst) const;
 
+    /**
+     * Linear interpolation function for key values.
+     */
+    void interpolateLinearValues(float s, float* from, float* to, float* dst) const;
+
     /**
      * Quaternion interpolation function.
      */
@@ -523,6 +565,57 @@ private:
      */
     int determineIndex(float time, unsigned int min, unsigned int max) const;
 
+    /**
+     * Determines the current keyframe to interpolate from, checking the keyframes around the cursor first.
+     */
+    int determineIndex(float time, unsigned int min, unsigned int max, unsigned int* cursor) const;
+
+    /**
+     * Creates a linear curve whose key values are stored quantized, as written by the encoder
+     * for compressed animation channels. Compressed curves decode their keys as they are
+     * evaluated and cannot be modified.
+     *
+     * Each key holds one 16-bit value for each component, which maps onto the range of that
+     * component, except for the quaternion (if there is one), which is stored in three
+     * 16-bit values as its three smallest components.
+     *
+     * @param pointCount The number of keys in the curve.
+     * @param componentCount The number of float component values per key value.
+     * @param quaternionOffset The offset of the quaternion within the key values, or -1 if there is none.
+     * @param keyTimes The normalized time of each key.
+     * @param keyRanges The minimum and step of each range quantized component.
+     * @param keyData The quantized key values.
+     *
+     * @return The new curve.
+     */
+    static Curve* createCompressed(unsigned int pointCount, unsigned int componentCount, int quaternionOffset,
+                                   const float* keyTimes, const float* keyRanges, const unsigned short* keyData);
+
+    /**
+     * Returns the number of quantized values stored per key of a compressed curve.
+     *
+     * @param componentCount The number of float component values per key value.
+     * @param quaternionOffset The offset of the quaternion within the key values, or -1 if there is none.
+     *
+     * @return The number of quantized values per key.
+     */
+    static unsigned int getCompressedKeyStride(unsigned int componentCount, int quaternionOffset);
+
+    /**
+     * Decodes the value of a key of a compressed curve.
+     */
+    void decodeKey(unsigned int index, float* dst) const;
+
+    /**
+     * Determines the key to interpolate from in a compressed curve.
+     */
+    unsigned int determineKeyIndex(float time, unsigned int min, unsigned int max, unsigned int* cursor) const;
+
+    /**
+     * Evaluates a compressed curve.
+     */
+    void evaluateCompressed(float time, float startTime, float endTime, float loopBlendTime, float* dst, unsigned int* cursor) const;
+
     /**
      * Sets the offset for the beginning of a Quaternion piece of data within the curve's value span at the specified
      * index. The next four components of data starting at the given index will be interpolated as a Quaternion.
@@ -546,6 +639,10 @@ private:
     unsigned int _componentSize;        // The component size (in bytes).
     unsigned int* _quaternionOffset;    // Offset for the rotation component.
     Point* _points;                     // The points on the curve.
+    float* _keyTimes;                   // The key times of a compressed curve.
+    float* _keyRanges;                  // The minimum and step of each range quantized component of a compressed curve.
+    unsigned short* _keyData;           // The quantized key values of a compressed curve.
+    unsigned int _keyStride;            // The number of quantized values per key of a compressed curve.
 };
 
 }
@@ -1,5 +1,7 @@
 #include "Base.h"
 #include "DepthStencilTarget.h"
+#include "FrameBuffer.h"
+#include "RenderState.h"
 
 #ifndef GL_DEPTH24_STENCIL8_OES
 #define GL_DEPTH24_STENCIL8_OES 0x88F0
@@ -13,8 +15,29 @@ namespace gameplay
 
 static std::vector<DepthStencilTarget*> __depthStencilTargets;
 
+/**
+ * Allocates the storage of the bound render buffer, with the specified number of samples.
+ */
+static void setRenderbufferStorage(GLenum internalFormat, unsigned int width, unsigned int height, unsigned int samples)
+{
+    if (samples > 1)
+    {
+#if defined(GP_USE_MULTISAMPLE_BLIT)
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, internalFormat, width, height);
+        return;
+#elif defined(GP_USE_MULTISAMPLE_APPLE)
+        glRenderbufferStorageMultisampleAPPLE(GL_RENDERBUFFER, samples, internalFormat, width, height);
+        return;
+#elif defined(GP_USE_MULTISAMPLE_RENDER_TO_TEXTURE)
+        glRenderbufferStorageMultisampleEXT(GL_RENDERBUFFER, samples, internalFormat, width, height);
+        return;
+#endif
+    }
+    glRenderbufferStorage(GL_RENDERBUFFER, internalFormat, width, height);
+}
+
 DepthStencilTarget::DepthStencilTarget(const char* id, Format format, unsigned int width, unsigned int height)
-    : _id(id ? id : ""), _format(format), _depthBuffer(0), _stencilBuffer(0), _width(width), _height(height), _packed(false)
+    : _id(id ? id : ""), _format(format), _depthBuffer(0), _stencilBuffer(0), _width(width), _height(height), _samples(1), _packed(false)
 {
 }
 
@@ -22,9 +45,9 @@ DepthStencilTarget::~DepthStencilTarget()
 {
     // Destroy GL resources.
     if (_depthBuffer)
-        GL_ASSERT( glDeleteRenderbuffers(1, &_depthBuffer) );
+        RenderState::deleteRenderBuffer(_depthBuffer);
     if (_stencilBuffer)
-        GL_ASSERT( glDeleteRenderbuffers(1, &_stencilBuffer) );
+        RenderState::deleteRenderBuffer(_stencilBuffer);
 
     // Remove from vector.
     std::vector<DepthStencilTarget*>::iterator it = std::find(__depthStencilTargets.begin(), __depthStencilTargets.end(), this);
@@ -36,15 +59,24 @@ DepthStencilTarget::~DepthStencilTarget()
 
 DepthStencilTarget* DepthStencilTarget::create(const char* id, Format format, unsigned int width, unsigned int height)
 {
+    return create(id, format, width, height, 1);
+}
+
+DepthStencilTarget* DepthStencilTarget::create(const char* id, Format format, unsigned int width, unsigned int height, unsigned int samples)
+{
+    // Multisampled targets are clamped the same way as the frame buffers they are set on.
+    samples = std::max(1u, std::min(samples, FrameBuffer::getMaxSamples()));
+
     // Create the depth stencil target.
     DepthStencilTarget* depthStencilTarget = new DepthStencilTarget(id, format, width, height);
+    depthStencilTarget->_samples = samples;
 
     // Create a render buffer for this new depth+stencil target
     GL_ASSERT( glGenRenderbuffers(1, &depthStencilTarget->_depthBuffer) );
     GL_ASSERT( glBindRenderbuffer(GL_RENDERBUFFER, depthStencilTarget->_depthBuffer) );
 
     // First try to add storage for the most common standard GL_DEPTH24_STENCIL8 
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    setRenderbufferStorage(GL_DEPTH24_STENCIL8, width, height, samples);
 
     // Fall back to less common GLES2 extension combination for seperate depth24 + stencil8 or depth16 + stencil8
     __gl_error_code = glGetError();
@@ -54,24 +86,24 @@ DepthStencilTarget* DepthStencilTarget::create(const char* id, Format format, un
 
         if (strstr(extString, "GL_OES_packed_depth_stencil") != 0)
         {
-            GL_ASSERT( glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8_OES, width, height) );
+            GL_ASSERT( setRenderbufferStorage(GL_DEPTH24_STENCIL8_OES, width, height, samples) );
             depthStencilTarget->_packed = true;
         }
         else
         {
             if (strstr(extString, "GL_OES_depth24") != 0)
             {
-                GL_ASSERT( glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height) );
+                GL_ASSERT( setRenderbufferStorage(GL_DEPTH_COMPONENT24, width, height, samples) );
             }
             else
             {
-                GL_ASSERT( glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, width, height) );
+                GL_ASSERT( setRenderbufferStorage(GL_DEPTH_COMPONENT16, width, height, samples) );
             }
             if (format == DepthStencilTarget::DEPTH_STENCIL)
             {
                 GL_ASSERT( glGenRenderbuffers(1, &depthStencilTarget->_stencilBuffer) );
                 GL_ASSERT( glBindRenderbuffer(GL_RENDERBUFFER, depthStencilTarget->_stencilBuffer) );
-                GL_ASSERT( glRenderbufferStorage(GL_RENDERBUFFER, GL_STENCIL_INDEX8, width, height) );
+                GL_ASSERT( setRenderbufferStorage(GL_STENCIL_INDEX8, width, height, samples) );
             }
         }
     }
@@ -125,6 +157,11 @@ unsigned int DepthStencilTarget::getHeight() const
     return _height;
 }
 
+unsigned int DepthStencilTarget::getSamples() const
+{
+    return _samples;
+}
+
 bool DepthStencilTarget::isPacked() const
 {
     return _packed;
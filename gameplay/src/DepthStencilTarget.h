@@ -45,6 +45,21 @@ public:
      */
     static DepthStencilTarget* create(const char* id, Format format, unsigned int width, unsigned int height);
 
+    /**
+     * Create a multisampled DepthStencilTarget, for a multisampled FrameBuffer, and add it to the
+     * list of available DepthStencilTargets.
+     *
+     * @param id The ID of the new DepthStencilTarget.  Uniqueness is recommended but not enforced.
+     * @param format The format of the new DepthStencilTarget.
+     * @param width Width of the new DepthStencilTarget.
+     * @param height Height of the new DepthStencilTarget.
+     * @param samples The number of samples of each pixel, which is clamped to FrameBuffer::getMaxSamples().
+     *
+     * @return A newly created DepthStencilTarget.
+     * @script{ignore}
+     */
+    static DepthStencilTarget* create(const char* id, Format format, unsigned int width, unsigned int height, unsigned int samples);
+
     /**
      * Get a named DepthStencilTarget from its ID.
      *
@@ -82,6 +97,14 @@ public:
      */
     unsigned int getHeight() const;
 
+    /**
+     * Returns the number of samples of each pixel of the DepthStencilTarget.
+     *
+     * @return The number of samples, which is 1 when the DepthStencilTarget is not multisampled.
+     * @script{ignore}
+     */
+    unsigned int getSamples() const;
+
     /**
      * Returns true if depth and stencil buffer are packed.
      *
@@ -112,6 +135,7 @@ private:
     RenderBufferHandle _stencilBuffer;
     unsigned int _width;
     unsigned int _height;
+    unsigned int _samples;
     bool _packed;
 };
 
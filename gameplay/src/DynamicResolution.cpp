@@ -0,0 +1,254 @@
+#include "Base.h"
+#include "DynamicResolution.h"
+#include "Game.h"
+#include "FrameBuffer.h"
+#include "SpriteBatch.h"
+#include "Profiler.h"
+#include "RenderCommandList.h"
+
+// The weight of each new GPU time in the smoothed GPU time
+#define DYNAMIC_RESOLUTION_SMOOTHING        0.2f
+
+// The share of the target time under which the scale is raised again, so that it does not oscillate around the target
+#define DYNAMIC_RESOLUTION_RAISE_THRESHOLD  0.85f
+
+// The steps that the scale is rounded to, so that the viewport only changes when the scale has really changed
+#define DYNAMIC_RESOLUTION_SCALE_STEP       (1.0f / 64.0f)
+
+namespace gameplay
+{
+
+DynamicResolution::DynamicResolution(float minScale, float maxScale, float targetTime)
+    : _minScale(1.0f), _maxScale(1.0f), _scale(1.0f), _targetTime(targetTime), _maxStep(0.05f), _gpuTime(0.0f),
+      _cooldown(0), _frameBuffer(NULL), _previousFrameBuffer(NULL), _batch(NULL), _active(false), _frame(0)
+{
+    GP_ASSERT(targetTime > 0.0f);
+
+    setScaleBounds(minScale, maxScale);
+    _scale = _maxScale;
+    memset(_queries, 0, sizeof(_queries));
+    memset(_issued, 0, sizeof(_issued));
+}
+
+DynamicResolution::~DynamicResolution()
+{
+#ifdef GP_USE_GPU_TIMER
+    if (_queries[0])
+    {
+        GL_ASSERT( glDeleteQueries(LATENCY * 2, _queries) );
+    }
+#endif
+    SAFE_DELETE(_batch);
+    SAFE_RELEASE(_frameBuffer);
+}
+
+void DynamicResolution::createTargets(unsigned int width, unsigned int height)
+{
+    if (_frameBuffer && _frameBuffer->getWidth() == width && _frameBuffer->getHeight() == height)
+        return;
+
+    // The targets follow the size of the viewport of the game, for example when the window is resized.
+    SAFE_DELETE(_batch);
+    SAFE_RELEASE(_frameBuffer);
+    _frameBuffer = FrameBuffer::create("DynamicResolution", width, height);
+    DepthStencilTarget* depthTarget = DepthStencilTarget::create("DynamicResolution", DepthStencilTarget::DEPTH_STENCIL, width, height);
+    _frameBuffer->setDepthStencilTarget(depthTarget);
+    SAFE_RELEASE(depthTarget);
+    _frameBuffer->setInvalidateOnUnbind(Game::CLEAR_DEPTH_STENCIL);
+
+    _batch = SpriteBatch::create(_frameBuffer->getRenderTarget()->getTexture(), NULL, 1);
+    _batch->getSampler()->setFilterMode(Texture::LINEAR, Texture::LINEAR);
+    _batch->getSampler()->setWrapMode(Texture::CLAMP, Texture::CLAMP);
+    _batch->getStateBlock()->setBlend(false);
+    _batch->getStateBlock()->setDepthTest(false);
+    _batch->getStateBlock()->setDepthWrite(false);
+
+#ifdef GP_USE_GPU_TIMER
+    if (!_queries[0] && Profiler::isGpuTimerSupported())
+    {
+        GL_ASSERT( glGenQueries(LATENCY * 2, _queries) );
+    }
+#endif
+}
+
+void DynamicResolution::begin()
+{
+    GP_ASSERT(!_active);
+
+    if (RenderCommandList::getRecording())
+    {
+        GP_WARN("Failed to begin dynamic resolution; the frame buffer can not be bound while a RenderCommandList is recording.");
+        return;
+    }
+
+    Game* game = Game::getInstance();
+    _previousViewport = game->getViewport();
+    unsigned int width = (unsigned int)_previousViewport.width;
+    unsigned int height = (unsigned int)_previousViewport.height;
+    if (width == 0 || height == 0)
+        return;
+    createTargets(width, height);
+
+#ifdef GP_USE_GPU_TIMER
+    if (_queries[0])
+    {
+        // The oldest frame is read back and its queries are reused for this frame.
+        _frame = (_frame + 1) % LATENCY;
+        if (_issued[_frame])
+        {
+            _issued[_frame] = false;
+            updateScale();
+        }
+        GL_ASSERT( glQueryCounter(_queries[_frame * 2], GL_TIMESTAMP) );
+    }
+#endif
+
+    _viewport.set(0, 0, std::max(1.0f, floorf(width * _scale + 0.5f)), std::max(1.0f, floorf(height * _scale + 0.5f)));
+    _previousFrameBuffer = _frameBuffer->bind();
+    game->setViewport(_viewport);
+    _active = true;
+}
+
+void DynamicResolution::end()
+{
+    if (!_active)
+        return;
+    _active = false;
+
+    Game* game = Game::getInstance();
+    _previousFrameBuffer->bind();
+    _previousFrameBuffer = NULL;
+    game->setViewport(_previousViewport);
+
+    // Upscale the scene into the viewport. Render target textures are upside down, so the top
+    // of the sprite samples the top of the scaled viewport.
+    float width = _previousViewport.width;
+    float height = _previousViewport.height;
+    Matrix projection;
+    Matrix::createOrthographicOffCenter(0, width, height, 0, 0, 1, &projection);
+    _batch->setProjectionMatrix(projection);
+    _batch->start();
+    _batch->draw(0, 0, 0, width, height, 0, _viewport.height / height, _viewport.width / width, 0, Vector4::one());
+    _batch->finish();
+
+#ifdef GP_USE_GPU_TIMER
+    if (_queries[0])
+    {
+        GL_ASSERT( glQueryCounter(_queries[_frame * 2 + 1], GL_TIMESTAMP) );
+        _issued[_frame] = true;
+    }
+#endif
+}
+
+void DynamicResolution::updateScale()
+{
+#ifdef GP_USE_GPU_TIMER
+    // The timestamps are meaningless when the GPU was interrupted, for example by a change of its clock.
+#ifdef OPENGL_ES
+    GLint disjoint = 0;
+    GL_ASSERT( glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint) );
+    if (disjoint)
+        return;
+#endif
+
+    // The frame was issued a few frames ago, so its results are normally available without waiting.
+    GLuint64 begin = 0;
+    GLuint64 end = 0;
+    GL_ASSERT( glGetQueryObjectui64v(_queries[_frame * 2], GL_QUERY_RESULT, &begin) );
+    GL_ASSERT( glGetQueryObjectui64v(_queries[_frame * 2 + 1], GL_QUERY_RESULT, &end) );
+    if (end <= begin)
+        return;
+    float time = (float)((end - begin) / 1000) / 1000.0f;
+    _gpuTime = _gpuTime > 0.0f ? _gpuTime + (time - _gpuTime) * DYNAMIC_RESOLUTION_SMOOTHING : time;
+
+    // The frames that are still in flight were rendered at the scale from before the last
+    // change, so they are not used to change it again.
+    if (_cooldown > 0)
+    {
+        --_cooldown;
+        return;
+    }
+    if (_gpuTime <= _targetTime && _gpuTime >= _targetTime * DYNAMIC_RESOLUTION_RAISE_THRESHOLD)
+        return;
+
+    // The GPU time is assumed to follow the area of the viewport, which is the square of the scale.
+    float scale = _scale * sqrt(_targetTime / _gpuTime);
+    scale = std::max(_scale - _maxStep, std::min(_scale + _maxStep, scale));
+    scale = floorf(scale / DYNAMIC_RESOLUTION_SCALE_STEP + 0.5f) * DYNAMIC_RESOLUTION_SCALE_STEP;
+    scale = std::max(_minScale, std::min(_maxScale, scale));
+    if (scale != _scale)
+    {
+        _scale = scale;
+        _cooldown = LATENCY;
+    }
+#endif
+}
+
+void DynamicResolution::setScaleBounds(float minScale, float maxScale)
+{
+    GP_ASSERT(minScale > 0.0f && minScale <= maxScale && maxScale <= 1.0f);
+
+    _minScale = minScale;
+    _maxScale = maxScale;
+    _scale = std::max(_minScale, std::min(_maxScale, _scale));
+}
+
+float DynamicResolution::getMinScale() const
+{
+    return _minScale;
+}
+
+float DynamicResolution::getMaxScale() const
+{
+    return _maxScale;
+}
+
+void DynamicResolution::setScale(float scale)
+{
+    _scale = std::max(_minScale, std::min(_maxScale, scale));
+    _cooldown = LATENCY;
+}
+
+float DynamicResolution::getScale() const
+{
+    return _scale;
+}
+
+void DynamicResolution::setTargetTime(float time)
+{
+    GP_ASSERT(time > 0.0f);
+    _targetTime = time;
+}
+
+float DynamicResolution::getTargetTime() const
+{
+    return _targetTime;
+}
+
+void DynamicResolution::setMaxStep(float step)
+{
+    GP_ASSERT(step > 0.0f);
+    _maxStep = step;
+}
+
+float DynamicResolution::getMaxStep() const
+{
+    return _maxStep;
+}
+
+float DynamicResolution::getGpuTime() const
+{
+    return _gpuTime;
+}
+
+const Rectangle& DynamicResolution::getViewport() const
+{
+    return _viewport;
+}
+
+FrameBuffer* DynamicResolution::getFrameBuffer() const
+{
+    return _frameBuffer;
+}
+
+}
@@ -0,0 +1,204 @@
+#ifndef DYNAMICRESOLUTION_H_
+#define DYNAMICRESOLUTION_H_
+
+#include "Rectangle.h"
+
+namespace gameplay
+{
+
+class FrameBuffer;
+class SpriteBatch;
+
+/**
+ * Defines a frame buffer that the 3D scene is rendered into at a resolution that follows the
+ * time the GPU takes to render it.
+ *
+ * The frame buffer is as large as the viewport of the game, and the scene is rendered into a
+ * viewport in its bottom left corner that is scaled down from the viewport of the game, between
+ * a minimum and a maximum scale. The time between begin() and end() is measured on the GPU with
+ * timestamp queries, which are read back a few frames later so that they never stall. When the
+ * scene takes longer than the target time the scale is lowered, and when it takes well under
+ * the target time the scale is raised again, in small steps. Since the cost of most scenes is
+ * mostly in their pixels, each step aims for the scale whose area would meet the target time.
+ *
+ * end() restores the frame buffer and viewport that were bound before begin(), and upscales the
+ * scene into the viewport with bilinear filtering, so that forms and text that are drawn after
+ * it keep the native resolution:
+ *
+ * @code
+ * void MyGame::render(float elapsedTime)
+ * {
+ *     _dynamicResolution.begin();
+ *     clear(CLEAR_COLOR_DEPTH, Vector4::zero(), 1.0f, 0);
+ *     _scene->visit(this, &MyGame::drawScene);
+ *     _dynamicResolution.end();
+ *
+ *     _form->draw();
+ * }
+ * @endcode
+ *
+ * The upscale pass writes every pixel of the viewport, but not the depth buffer. When the GPU
+ * has no timer queries (see Profiler::isGpuTimerSupported), the scale only changes with setScale().
+ *
+ * @script{ignore}
+ */
+class DynamicResolution
+{
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param minScale The smallest scale of the viewport of the scene, in (0, 1].
+     * @param maxScale The largest scale of the viewport of the scene, in [minScale, 1].
+     * @param targetTime The time the GPU should take to render the scene, in milliseconds.
+     *      The default leaves time for the rest of a frame at 60 frames per second.
+     */
+    DynamicResolution(float minScale = 0.5f, float maxScale = 1.0f, float targetTime = 12.0f);
+
+    /**
+     * Destructor.
+     */
+    ~DynamicResolution();
+
+    /**
+     * Binds the frame buffer and sets the scaled viewport, to render the scene into.
+     *
+     * The frame buffer is bound immediately, so this should not be called while a
+     * RenderCommandList is recording; the scene is then rendered at native resolution.
+     */
+    void begin();
+
+    /**
+     * Restores the frame buffer and viewport that were bound before begin(), and draws the
+     * scene into that viewport.
+     */
+    void end();
+
+    /**
+     * Sets the bounds of the scale of the viewport of the scene.
+     *
+     * @param minScale The smallest scale, in (0, 1].
+     * @param maxScale The largest scale, in [minScale, 1].
+     */
+    void setScaleBounds(float minScale, float maxScale);
+
+    /**
+     * Returns the smallest scale of the viewport of the scene.
+     *
+     * @return The minimum scale.
+     */
+    float getMinScale() const;
+
+    /**
+     * Returns the largest scale of the viewport of the scene.
+     *
+     * @return The maximum scale.
+     */
+    float getMaxScale() const;
+
+    /**
+     * Sets the current scale of the viewport of the scene, which is clamped to the scale bounds.
+     *
+     * @param scale The scale.
+     */
+    void setScale(float scale);
+
+    /**
+     * Returns the current scale of the viewport of the scene.
+     *
+     * @return The scale.
+     */
+    float getScale() const;
+
+    /**
+     * Sets the time the GPU should take to render the scene.
+     *
+     * @param time The target time, in milliseconds.
+     */
+    void setTargetTime(float time);
+
+    /**
+     * Returns the time the GPU should take to render the scene.
+     *
+     * @return The target time, in milliseconds.
+     */
+    float getTargetTime() const;
+
+    /**
+     * Sets the largest change of the scale in a single step.
+     *
+     * @param step The largest step. The default is 0.05.
+     */
+    void setMaxStep(float step);
+
+    /**
+     * Returns the largest change of the scale in a single step.
+     *
+     * @return The largest step.
+     */
+    float getMaxStep() const;
+
+    /**
+     * Returns the smoothed time the GPU took to render the scene, as measured a few frames ago.
+     *
+     * @return The GPU time, in milliseconds, or zero when it has not been measured.
+     */
+    float getGpuTime() const;
+
+    /**
+     * Returns the viewport that the scene is rendered into, in the frame buffer.
+     *
+     * @return The scaled viewport.
+     */
+    const Rectangle& getViewport() const;
+
+    /**
+     * Returns the frame buffer that the scene is rendered into.
+     *
+     * @return The frame buffer, or NULL until begin() is called.
+     */
+    FrameBuffer* getFrameBuffer() const;
+
+private:
+
+    /**
+     * The number of frames that the timer queries are kept for before they are read back.
+     */
+    static const unsigned int LATENCY = 4;
+
+    /**
+     * Hidden copy constructor.
+     */
+    DynamicResolution(const DynamicResolution& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    DynamicResolution& operator=(const DynamicResolution&);
+
+    void createTargets(unsigned int width, unsigned int height);
+
+    void updateScale();
+
+    float _minScale;
+    float _maxScale;
+    float _scale;
+    float _targetTime;
+    float _maxStep;
+    float _gpuTime;
+    unsigned int _cooldown;
+    Rectangle _viewport;
+    Rectangle _previousViewport;
+    FrameBuffer* _frameBuffer;
+    FrameBuffer* _previousFrameBuffer;
+    SpriteBatch* _batch;
+    bool _active;
+    unsigned int _queries[LATENCY * 2];
+    bool _issued[LATENCY];
+    unsigned int _frame;
+};
+
+}
+
+#endif
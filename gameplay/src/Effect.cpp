@@ -2,9 +2,20 @@
 #include "Effect.h"
 #include "FileSystem.h"
 #include "Game.h"
+#include "RenderState.h"
+#include "RenderCommandList.h"
+#include "Properties.h"
 
 #define OPENGL_ES_DEFINE  "OPENGL_ES"
 
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// Minimum time in milliseconds between blocking completions of asynchronous compiles
+// when the driver cannot report whether a program is done.
+#define ASYNC_COMPILE_INTERVAL 10.0
+
 namespace gameplay
 {
 
@@ -12,14 +23,80 @@ namespace gameplay
 static std::map<std::string, Effect*> __effectCache;
 static Effect* __currentEffect = NULL;
 
-Effect::Effect() : _program(0)
+static double __lastAsyncCompileTime = 0.0;
+
+// The effects that were compiled from shader manifests, and the ids of every permutation of
+// the manifests that were loaded.
+static std::vector<Effect*> __precompiledEffects;
+static std::set<std::string> __manifestIds;
+static bool __manifestLoaded = false;
+
+// The uniform names that have been given an id, in order of their ids.
+static std::map<std::string, unsigned int> __uniformIds;
+static std::vector<std::string> __uniformNames;
+
+// The source of a shader file with its includes expanded, and the modification times of the
+// file and of the files that it includes, which tell when the source has to be read again.
+struct ShaderSource
+{
+    std::string source;
+    std::vector<std::pair<std::string, time_t> > files;
+};
+
+// Cache of the expanded shader sources by path, shared by all permutations of the shaders.
+static std::map<std::string, ShaderSource> __shaderSourceCache;
+
+static const ShaderSource* getShaderSource(const char* path);
+
+// The defines that are added to every shader, built once from the game config.
+static std::string __globalDefines;
+static bool __globalDefinesLoaded = false;
+
+// Shaders and program of an effect that have been submitted to the driver but not yet checked.
+struct Effect::PendingProgram
+{
+    PendingProgram() : vertexShader(0), fragmentShader(0), program(0), startTime(0.0)
+    {
+    }
+
+    ~PendingProgram()
+    {
+        if (vertexShader)
+        {
+            GL_ASSERT( glDeleteShader(vertexShader) );
+        }
+        if (fragmentShader)
+        {
+            GL_ASSERT( glDeleteShader(fragmentShader) );
+        }
+        if (program)
+        {
+            GL_ASSERT( glDeleteProgram(program) );
+        }
+    }
+
+    std::string vshPath;
+    std::string vshSource;
+    std::string fshPath;
+    std::string fshSource;
+    std::string binaryPath;
+    GLuint vertexShader;
+    GLuint fragmentShader;
+    GLuint program;
+    double startTime;
+};
+
+Effect::Effect() : _program(0), _pending(NULL)
 {
 }
 
 Effect::~Effect()
 {
     // Remove this effect from the cache.
-    __effectCache.erase(_id);
+    removeFromCache();
+
+    // Discard a compile that is still in progress.
+    SAFE_DELETE(_pending);
 
     // Free uniforms.
     for (std::map<std::string, Uniform*>::iterator itr = _uniforms.begin(); itr != _uniforms.end(); ++itr)
@@ -32,16 +109,25 @@ Effect::~Effect()
         // If our program object is currently bound, unbind it before we're destroyed.
         if (__currentEffect == this)
         {
-            GL_ASSERT( glUseProgram(0) );
             __currentEffect = NULL;
         }
 
-        GL_ASSERT( glDeleteProgram(_program) );
+        RenderState::deleteProgram(_program);
         _program = 0;
     }
 }
 
 Effect* Effect::createFromFile(const char* vshPath, const char* fshPath, const char* defines)
+{
+    return createFromFile(vshPath, fshPath, defines, false);
+}
+
+Effect* Effect::createFromFileAsync(const char* vshPath, const char* fshPath, const char* defines)
+{
+    return createFromFile(vshPath, fshPath, defines, true);
+}
+
+Effect* Effect::createFromFile(const char* vshPath, const char* fshPath, const char* defines, bool async)
 {
     GP_ASSERT(vshPath);
     GP_ASSERT(fshPath);
@@ -59,30 +145,39 @@ Effect* Effect::createFromFile(const char* vshPath, const char* fshPath, const c
     if (itr != __effectCache.end())
     {
         // Found an exiting effect with this id, so increase its ref count and return it.
-        GP_ASSERT(itr->second);
-        itr->second->addRef();
-        return itr->second;
+        Effect* effect = itr->second;
+        GP_ASSERT(effect);
+
+        // A synchronous request for an effect that is still compiling has to wait for it.
+        if (!async && effect->_pending && !effect->finishProgram())
+        {
+            GP_ERROR("Failed to create effect from shaders '%s', '%s'.", vshPath, fshPath);
+            return NULL;
+        }
+        effect->addRef();
+        return effect;
     }
 
-    // Read source from file.
-    char* vshSource = FileSystem::readAll(vshPath);
+    // Read the sources with their includes expanded, which the permutations of the shaders share.
+    const ShaderSource* vshSource = getShaderSource(vshPath);
     if (vshSource == NULL)
     {
         GP_ERROR("Failed to read vertex shader from file '%s'.", vshPath);
         return NULL;
     }
-    char* fshSource = FileSystem::readAll(fshPath);
+    std::string vshFullSource = vshSource->source;
+    const ShaderSource* fshSource = getShaderSource(fshPath);
     if (fshSource == NULL)
     {
         GP_ERROR("Failed to read fragment shader from file '%s'.", fshPath);
-        SAFE_DELETE_ARRAY(vshSource);
         return NULL;
     }
-
-    Effect* effect = createFromSource(vshPath, vshSource, fshPath, fshSource, defines);
-    
-    SAFE_DELETE_ARRAY(vshSource);
-    SAFE_DELETE_ARRAY(fshSource);
+    std::string fshFullSource = fshSource->source;
+    if (!vshFullSource.empty())
+        vshFullSource += "\n";
+    if (!fshFullSource.empty())
+        fshFullSource += "\n";
+    Effect* effect = createFromExpandedSource(vshPath, vshFullSource.c_str(), fshPath, fshFullSource.c_str(), defines, async);
 
     if (effect == NULL)
     {
@@ -93,11 +188,97 @@ Effect* Effect::createFromFile(const char* vshPath, const char* fshPath, const c
         // Store this effect in the cache.
         effect->_id = uniqueId;
         __effectCache[uniqueId] = effect;
+
+        // Permutations that are compiled on first use cause hitches, so they are reported for the manifest.
+        if (__manifestLoaded && __manifestIds.find(uniqueId) == __manifestIds.end())
+        {
+            GP_WARN("Effect permutation is missing from the shader manifest:\n"
+                "permutation\n{\n    vertexShader = %s\n    fragmentShader = %s\n    defines = %s\n}",
+                vshPath, fshPath, defines ? defines : "");
+        }
     }
 
     return effect;
 }
 
+unsigned int Effect::precompile(const char* manifestPath, bool async)
+{
+    GP_ASSERT(manifestPath);
+
+    Properties* properties = Properties::create(manifestPath);
+    if (properties == NULL)
+    {
+        GP_WARN("Failed to load shader manifest '%s'.", manifestPath);
+        return 0;
+    }
+    __manifestLoaded = true;
+
+    Properties* manifest = strlen(properties->getNamespace()) > 0 ? properties : properties->getNextNamespace();
+    unsigned int count = 0;
+    Properties* ns;
+    while (manifest && (ns = manifest->getNextNamespace()) != NULL)
+    {
+        if (strcmp(ns->getNamespace(), "permutation") != 0)
+            continue;
+
+        const char* vshPath = ns->getString("vertexShader");
+        const char* fshPath = ns->getString("fragmentShader");
+        if (vshPath == NULL || fshPath == NULL)
+        {
+            GP_WARN("Shader permutation in manifest '%s' is missing a vertexShader or fragmentShader.", manifestPath);
+            continue;
+        }
+        const char* defines = ns->getString("defines");
+        if (defines && strlen(defines) == 0)
+            defines = NULL;
+
+        std::string uniqueId = vshPath;
+        uniqueId += ';';
+        uniqueId += fshPath;
+        uniqueId += ';';
+        if (defines)
+            uniqueId += defines;
+        __manifestIds.insert(uniqueId);
+
+        Effect* effect = createFromFile(vshPath, fshPath, defines, async);
+        if (effect == NULL)
+            continue;
+        if (std::find(__precompiledEffects.begin(), __precompiledEffects.end(), effect) == __precompiledEffects.end())
+            __precompiledEffects.push_back(effect);
+        else
+            SAFE_RELEASE(effect);
+        ++count;
+    }
+
+    SAFE_DELETE(properties);
+    return count;
+}
+
+bool Effect::isPrecompileDone()
+{
+    for (size_t i = 0, count = __precompiledEffects.size(); i < count; ++i)
+    {
+        if (__precompiledEffects[i]->_pending && !__precompiledEffects[i]->isReady())
+            return false;
+    }
+    return true;
+}
+
+void Effect::releasePrecompiled()
+{
+    for (size_t i = 0, count = __precompiledEffects.size(); i < count; ++i)
+    {
+        SAFE_RELEASE(__precompiledEffects[i]);
+    }
+    __precompiledEffects.clear();
+}
+
+void Effect::clearSourceCache()
+{
+    __shaderSourceCache.clear();
+    __globalDefinesLoaded = false;
+}
+
 Effect* Effect::createFromSource(const char* vshSource, const char* fshSource, const char* defines)
 {
     return createFromSource(NULL, vshSource, NULL, fshSource, defines);
@@ -105,21 +286,27 @@ Effect* Effect::createFromSource(const char* vshSource, const char* fshSource, c
 
 static void replaceDefines(const char* defines, std::string& out)
 {
-    Properties* graphicsConfig = Game::getInstance()->getConfig()->getNamespace("graphics", true);
-    const char* globalDefines = graphicsConfig ? graphicsConfig->getString("shaderDefines") : NULL;
-
-    // Build full semicolon delimited list of defines
+    // The defines of the platform and of the game config are the same for every shader.
+    if (!__globalDefinesLoaded)
+    {
+        Properties* graphicsConfig = Game::getInstance()->getConfig()->getNamespace("graphics", true);
+        const char* globalDefines = graphicsConfig ? graphicsConfig->getString("shaderDefines") : NULL;
 #ifdef OPENGL_ES
-    out = OPENGL_ES_DEFINE;
+        __globalDefines = OPENGL_ES_DEFINE;
 #else
-    out = "";
+        __globalDefines = "";
 #endif
-    if (globalDefines && strlen(globalDefines) > 0)
-    {
-        if (out.length() > 0)
-            out += ';';
-        out += globalDefines;
+        if (globalDefines && strlen(globalDefines) > 0)
+        {
+            if (__globalDefines.length() > 0)
+                __globalDefines += ';';
+            __globalDefines += globalDefines;
+        }
+        __globalDefinesLoaded = true;
     }
+
+    // Build full semicolon delimited list of defines
+    out = __globalDefines;
     if (defines && strlen(defines) > 0)
     {
         if (out.length() > 0)
@@ -140,7 +327,47 @@ static void replaceDefines(const char* defines, std::string& out)
     }
 }
 
-static void replaceIncludes(const char* filepath, const char* source, std::string& out)
+static void replaceIncludes(const char* filepath, const char* source, std::string& out, std::vector<std::pair<std::string, time_t> >* files);
+
+static const ShaderSource* getShaderSource(const char* path)
+{
+    GP_ASSERT(path);
+
+    // The cached source is used while none of the files that it was read from have changed.
+    std::map<std::string, ShaderSource>::iterator itr = __shaderSourceCache.find(path);
+    if (itr != __shaderSourceCache.end())
+    {
+        const std::vector<std::pair<std::string, time_t> >& files = itr->second.files;
+        size_t i = 0;
+        for (size_t count = files.size(); i < count; ++i)
+        {
+            time_t time;
+            if (!FileSystem::getModifiedTime(files[i].first.c_str(), &time) || time != files[i].second)
+                break;
+        }
+        if (i == files.size())
+            return &itr->second;
+        __shaderSourceCache.erase(itr);
+    }
+
+    time_t time = 0;
+    FileSystem::getModifiedTime(path, &time);
+    char* source = FileSystem::readAll(path);
+    if (source == NULL)
+        return NULL;
+
+    ShaderSource entry;
+    entry.files.push_back(std::make_pair(std::string(path), time));
+    replaceIncludes(path, source, entry.source, &entry.files);
+    SAFE_DELETE_ARRAY(source);
+
+    ShaderSource& cached = __shaderSourceCache[path];
+    cached.source.swap(entry.source);
+    cached.files.swap(entry.files);
+    return &cached;
+}
+
+static void replaceIncludes(const char* filepath, const char* source, std::string& out, std::vector<std::pair<std::string, time_t> >* files)
 {
     // Replace the #include "xxxx.xxx" with the sourced file contents of "filepath/xxxx.xxx"
     std::string str = source;
@@ -194,7 +421,9 @@ static void replaceIncludes(const char* filepath, const char* source, std::strin
             size_t len = endQuote - (startQuote);
             std::string includeStr = str.substr(startQuote, len);
             directoryPath.append(includeStr);
-            const char* includedSource = FileSystem::readAll(directoryPath.c_str());
+
+            // The included file is expanded once and shared by all of the shaders that include it.
+            const ShaderSource* includedSource = getShaderSource(directoryPath.c_str());
             if (includedSource == NULL)
             {
                 GP_ERROR("Compile failed for shader '%s' invalid filepath.", filepathStr.c_str());
@@ -202,9 +431,9 @@ static void replaceIncludes(const char* filepath, const char* source, std::strin
             }
             else
             {
-                // Valid file so lets attempt to see if we need to append anything to it too (recurse...)
-                replaceIncludes(directoryPath.c_str(), includedSource, out);
-                SAFE_DELETE_ARRAY(includedSource);
+                out.append(includedSource->source);
+                if (files)
+                    files->insert(files->end(), includedSource->files.begin(), includedSource->files.end());
             }
         }
         else
@@ -226,42 +455,306 @@ static void writeShaderToErrorFile(const char* filePath, const char* source)
     }
 }
 
-Effect* Effect::createFromSource(const char* vshPath, const char* vshSource, const char* fshPath, const char* fshSource, const char* defines)
+#ifdef GP_USE_PROGRAM_BINARY
+
+// Header of a cached program binary file
+#define PROGRAM_BINARY_MAGIC    0x42505047
+#define PROGRAM_BINARY_VERSION  1
+
+struct ProgramBinaryHeader
 {
-    GP_ASSERT(vshSource);
-    GP_ASSERT(fshSource);
+    unsigned int magic;
+    unsigned int version;
+    unsigned long long driverHash;
+    unsigned int format;
+    unsigned int length;
+};
+
+static unsigned long long hashString(unsigned long long hash, const char* str)
+{
+    // 64-bit FNV-1a
+    if (str)
+    {
+        for (const unsigned char* c = (const unsigned char*)str; *c; ++c)
+        {
+            hash ^= *c;
+            hash *= 0x100000001B3ULL;
+        }
+    }
+    return hash;
+}
+
+static unsigned long long getDriverHash()
+{
+    // Program binaries are only valid for the driver that produced them.
+    static unsigned long long driverHash = 0;
+    if (driverHash == 0)
+    {
+        driverHash = 0xCBF29CE484222325ULL;
+        driverHash = hashString(driverHash, (const char*)glGetString(GL_VENDOR));
+        driverHash = hashString(driverHash, (const char*)glGetString(GL_RENDERER));
+        driverHash = hashString(driverHash, (const char*)glGetString(GL_VERSION));
+    }
+    return driverHash;
+}
+
+static const char* getProgramBinaryCachePath()
+{
+    static int supported = -1;
+    if (supported == -1)
+    {
+        GLint formatCount = 0;
+        if (glGetProgramBinary && glProgramBinary)
+        {
+            GL_ASSERT( glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount) );
+        }
+        supported = formatCount > 0 ? 1 : 0;
+    }
+    if (!supported)
+        return NULL;
+
+    Properties* graphicsConfig = Game::getInstance()->getConfig()->getNamespace("graphics", true);
+    const char* path = graphicsConfig ? graphicsConfig->getString("programBinaryCache") : NULL;
+    return (path && strlen(path) > 0) ? path : NULL;
+}
+
+static void getProgramBinaryPath(const char* cachePath, const char* defines, const char* vshSource, const char* fshSource, std::string& out)
+{
+    unsigned long long hash = 0xCBF29CE484222325ULL;
+    hash = hashString(hash, defines);
+    hash = hashString(hash, "\n");
+    hash = hashString(hash, vshSource);
+    hash = hashString(hash, "\n");
+    hash = hashString(hash, fshSource);
+
+    char name[32];
+    sprintf(name, "%08x%08x.bin", (unsigned int)(hash >> 32), (unsigned int)hash);
+    out = cachePath;
+    if (out.length() > 0 && out[out.length() - 1] != '/')
+        out += '/';
+    out += name;
+}
+
+static GLuint loadProgramBinary(const char* path)
+{
+    if (!FileSystem::fileExists(path))
+        return 0;
+
+    std::unique_ptr<Stream> stream(FileSystem::open(path));
+    if (stream.get() == NULL || !stream->canRead())
+        return 0;
+
+    ProgramBinaryHeader header;
+    if (stream->read(&header, sizeof(header), 1) != 1 ||
+        header.magic != PROGRAM_BINARY_MAGIC || header.version != PROGRAM_BINARY_VERSION ||
+        header.driverHash != getDriverHash() || header.length == 0)
+    {
+        // Stale or foreign file; it is replaced once the program is recompiled.
+        return 0;
+    }
+
+    char* data = new char[header.length];
+    if (stream->read(data, 1, header.length) != header.length)
+    {
+        SAFE_DELETE_ARRAY(data);
+        return 0;
+    }
 
-    const unsigned int SHADER_SOURCE_LENGTH = 3;
-    const GLchar* shaderSource[SHADER_SOURCE_LENGTH];
-    char* infoLog = NULL;
-    GLuint vertexShader;
-    GLuint fragmentShader;
     GLuint program;
-    GLint length;
     GLint success;
+    GL_ASSERT( program = glCreateProgram() );
+    GL_ASSERT( glProgramBinary(program, (GLenum)header.format, data, (GLsizei)header.length) );
+    SAFE_DELETE_ARRAY(data);
 
-    // Replace all comma separated definitions with #define prefix and \n suffix
-    std::string definesStr = "";
-    replaceDefines(defines, definesStr);
-    
-    shaderSource[0] = definesStr.c_str();
+    // Drivers may reject binaries after an update, in which case the sources are compiled again.
+    GL_ASSERT( glGetProgramiv(program, GL_LINK_STATUS, &success) );
+    if (success != GL_TRUE)
+    {
+        GL_ASSERT( glDeleteProgram(program) );
+        return 0;
+    }
+    return program;
+}
+
+static void saveProgramBinary(const char* path, GLuint program)
+{
+    GLint length = 0;
+    GL_ASSERT( glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length) );
+    if (length <= 0)
+        return;
+
+    char* data = new char[length];
+    GLenum format = 0;
+    GLsizei written = 0;
+    GL_ASSERT( glGetProgramBinary(program, length, &written, &format, data) );
+    if (written > 0)
+    {
+        std::unique_ptr<Stream> stream(FileSystem::open(path, FileSystem::WRITE));
+        if (stream.get() != NULL && stream->canWrite())
+        {
+            ProgramBinaryHeader header;
+            header.magic = PROGRAM_BINARY_MAGIC;
+            header.version = PROGRAM_BINARY_VERSION;
+            header.driverHash = getDriverHash();
+            header.format = (unsigned int)format;
+            header.length = (unsigned int)written;
+            stream->write(&header, sizeof(header), 1);
+            stream->write(data, 1, written);
+        }
+        else
+        {
+            GP_WARN("Failed to write program binary cache file '%s'.", path);
+        }
+    }
+    SAFE_DELETE_ARRAY(data);
+}
+
+#endif
+
+static bool isParallelCompileSupported()
+{
+    static int supported = -1;
+    if (supported == -1)
+    {
+        const char* extString = (const char*)glGetString(GL_EXTENSIONS);
+        supported = (extString && (strstr(extString, "GL_KHR_parallel_shader_compile") || strstr(extString, "GL_ARB_parallel_shader_compile"))) ? 1 : 0;
+    }
+    return supported == 1;
+}
+
+static void compileShader(GLuint shader, const char* defines, const char* source)
+{
+    const unsigned int SHADER_SOURCE_LENGTH = 3;
+    const GLchar* shaderSource[SHADER_SOURCE_LENGTH];
+    shaderSource[0] = defines;
     shaderSource[1] = "\n";
+    shaderSource[2] = source;
+    GL_ASSERT( glShaderSource(shader, SHADER_SOURCE_LENGTH, shaderSource, NULL) );
+    GL_ASSERT( glCompileShader(shader) );
+}
+
+Effect* Effect::createFromSource(const char* vshPath, const char* vshSource, const char* fshPath, const char* fshSource, const char* defines, bool async)
+{
+    GP_ASSERT(vshSource);
+    GP_ASSERT(fshSource);
+
     std::string vshSourceStr = "";
     if (vshPath)
     {
         // Replace the #include "xxxxx.xxx" with the sources that come from file paths
-        replaceIncludes(vshPath, vshSource, vshSourceStr);
+        replaceIncludes(vshPath, vshSource, vshSourceStr, NULL);
         if (vshSource && strlen(vshSource) != 0)
             vshSourceStr += "\n";
     }
-    shaderSource[2] = vshPath ? vshSourceStr.c_str() :  vshSource;
-    GL_ASSERT( vertexShader = glCreateShader(GL_VERTEX_SHADER) );
-    GL_ASSERT( glShaderSource(vertexShader, SHADER_SOURCE_LENGTH, shaderSource, NULL) );
-    GL_ASSERT( glCompileShader(vertexShader) );
-    GL_ASSERT( glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success) );
+    std::string fshSourceStr;
+    if (fshPath)
+    {
+        // Replace the #include "xxxxx.xxx" with the sources that come from file paths
+        replaceIncludes(fshPath, fshSource, fshSourceStr, NULL);
+        if (fshSource && strlen(fshSource) != 0)
+            fshSourceStr += "\n";
+    }
+    const char* vshFullSource = vshPath ? vshSourceStr.c_str() : vshSource;
+    const char* fshFullSource = fshPath ? fshSourceStr.c_str() : fshSource;
+
+    return createFromExpandedSource(vshPath, vshFullSource, fshPath, fshFullSource, defines, async);
+}
+
+Effect* Effect::createFromExpandedSource(const char* vshPath, const char* vshFullSource, const char* fshPath, const char* fshFullSource,
+                                         const char* defines, bool async)
+{
+    GP_ASSERT(vshFullSource);
+    GP_ASSERT(fshFullSource);
+
+    // Replace all comma separated definitions with #define prefix and \n suffix
+    std::string definesStr = "";
+    replaceDefines(defines, definesStr);
+
+    GLuint program = 0;
+#ifdef GP_USE_PROGRAM_BINARY
+    // Try the program binary cached by an earlier run first.
+    std::string binaryPath;
+    const char* cachePath = getProgramBinaryCachePath();
+    if (cachePath)
+    {
+        getProgramBinaryPath(cachePath, definesStr.c_str(), vshFullSource, fshFullSource, binaryPath);
+        program = loadProgramBinary(binaryPath.c_str());
+    }
+#endif
+
+    // Create and return the new Effect.
+    Effect* effect = new Effect();
+    if (program)
+    {
+        effect->_program = program;
+        effect->loadVariables();
+        return effect;
+    }
+
+    // Submit the shaders and the program to the driver. Their status is not queried
+    // until finishProgram() so that drivers which compile in the background can do so.
+    PendingProgram* pending = new PendingProgram();
+    if (vshPath)
+        pending->vshPath = vshPath;
+    if (fshPath)
+        pending->fshPath = fshPath;
+    pending->vshSource = vshFullSource;
+    pending->fshSource = fshFullSource;
+    pending->startTime = Game::getAbsoluteTime();
+    effect->_pending = pending;
+
+    GL_ASSERT( pending->vertexShader = glCreateShader(GL_VERTEX_SHADER) );
+    compileShader(pending->vertexShader, definesStr.c_str(), vshFullSource);
+    GL_ASSERT( pending->fragmentShader = glCreateShader(GL_FRAGMENT_SHADER) );
+    compileShader(pending->fragmentShader, definesStr.c_str(), fshFullSource);
+
+    // Link program.
+    GL_ASSERT( pending->program = glCreateProgram() );
+#ifdef GP_USE_PROGRAM_BINARY
+    if (cachePath)
+    {
+        pending->binaryPath = binaryPath;
+#ifdef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+        if (glProgramParameteri)
+        {
+            // Let the driver know that the binary will be read back for the program cache.
+            GL_ASSERT( glProgramParameteri(pending->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE) );
+        }
+#endif
+    }
+#endif
+    GL_ASSERT( glAttachShader(pending->program, pending->vertexShader) );
+    GL_ASSERT( glAttachShader(pending->program, pending->fragmentShader) );
+    GL_ASSERT( glLinkProgram(pending->program) );
+
+    if (!async && !effect->finishProgram())
+    {
+        SAFE_DELETE(effect);
+        return NULL;
+    }
+
+    return effect;
+}
+
+bool Effect::finishProgram()
+{
+    GP_ASSERT(_pending);
+
+    PendingProgram* pending = _pending;
+    _pending = NULL;
+
+    const char* vshPath = pending->vshPath.empty() ? NULL : pending->vshPath.c_str();
+    const char* fshPath = pending->fshPath.empty() ? NULL : pending->fshPath.c_str();
+    const char* vshSource = pending->vshSource.c_str();
+    const char* fshSource = pending->fshSource.c_str();
+    char* infoLog = NULL;
+    GLint length;
+    GLint success;
+
+    GL_ASSERT( glGetShaderiv(pending->vertexShader, GL_COMPILE_STATUS, &success) );
     if (success != GL_TRUE)
     {
-        GL_ASSERT( glGetShaderiv(vertexShader, GL_INFO_LOG_LENGTH, &length) );
+        GL_ASSERT( glGetShaderiv(pending->vertexShader, GL_INFO_LOG_LENGTH, &length) );
         if (length == 0)
         {
             length = 4096;
@@ -269,40 +762,28 @@ Effect* Effect::createFromSource(const char* vshPath, const char* vshSource, con
         if (length > 0)
         {
             infoLog = new char[length];
-            GL_ASSERT( glGetShaderInfoLog(vertexShader, length, NULL, infoLog) );
+            GL_ASSERT( glGetShaderInfoLog(pending->vertexShader, length, NULL, infoLog) );
             infoLog[length-1] = '\0';
         }
 
         // Write out the expanded shader file.
         if (vshPath)
-            writeShaderToErrorFile(vshPath, shaderSource[2]);
+            writeShaderToErrorFile(vshPath, vshSource);
 
         GP_ERROR("Compile failed for vertex shader '%s' with error '%s'.", vshPath == NULL ? vshSource : vshPath, infoLog == NULL ? "" : infoLog);
         SAFE_DELETE_ARRAY(infoLog);
 
         // Clean up.
-        GL_ASSERT( glDeleteShader(vertexShader) );
+        SAFE_DELETE(pending);
+        removeFromCache();
 
-        return NULL;
+        return false;
     }
 
-    // Compile the fragment shader.
-    std::string fshSourceStr;
-    if (fshPath)
-    {
-        // Replace the #include "xxxxx.xxx" with the sources that come from file paths
-        replaceIncludes(fshPath, fshSource, fshSourceStr);
-        if (fshSource && strlen(fshSource) != 0)
-            fshSourceStr += "\n";
-    }
-    shaderSource[2] = fshPath ? fshSourceStr.c_str() : fshSource;
-    GL_ASSERT( fragmentShader = glCreateShader(GL_FRAGMENT_SHADER) );
-    GL_ASSERT( glShaderSource(fragmentShader, SHADER_SOURCE_LENGTH, shaderSource, NULL) );
-    GL_ASSERT( glCompileShader(fragmentShader) );
-    GL_ASSERT( glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success) );
+    GL_ASSERT( glGetShaderiv(pending->fragmentShader, GL_COMPILE_STATUS, &success) );
     if (success != GL_TRUE)
     {
-        GL_ASSERT( glGetShaderiv(fragmentShader, GL_INFO_LOG_LENGTH, &length) );
+        GL_ASSERT( glGetShaderiv(pending->fragmentShader, GL_INFO_LOG_LENGTH, &length) );
         if (length == 0)
         {
             length = 4096;
@@ -310,39 +791,36 @@ Effect* Effect::createFromSource(const char* vshPath, const char* vshSource, con
         if (length > 0)
         {
             infoLog = new char[length];
-            GL_ASSERT( glGetShaderInfoLog(fragmentShader, length, NULL, infoLog) );
+            GL_ASSERT( glGetShaderInfoLog(pending->fragmentShader, length, NULL, infoLog) );
             infoLog[length-1] = '\0';
         }
-        
+
         // Write out the expanded shader file.
         if (fshPath)
-            writeShaderToErrorFile(fshPath, shaderSource[2]);
+            writeShaderToErrorFile(fshPath, fshSource);
 
         GP_ERROR("Compile failed for fragment shader (%s): %s", fshPath == NULL ? fshSource : fshPath, infoLog == NULL ? "" : infoLog);
         SAFE_DELETE_ARRAY(infoLog);
 
         // Clean up.
-        GL_ASSERT( glDeleteShader(vertexShader) );
-        GL_ASSERT( glDeleteShader(fragmentShader) );
+        SAFE_DELETE(pending);
+        removeFromCache();
 
-        return NULL;
+        return false;
     }
 
-    // Link program.
-    GL_ASSERT( program = glCreateProgram() );
-    GL_ASSERT( glAttachShader(program, vertexShader) );
-    GL_ASSERT( glAttachShader(program, fragmentShader) );
-    GL_ASSERT( glLinkProgram(program) );
-    GL_ASSERT( glGetProgramiv(program, GL_LINK_STATUS, &success) );
+    GL_ASSERT( glGetProgramiv(pending->program, GL_LINK_STATUS, &success) );
 
     // Delete shaders after linking.
-    GL_ASSERT( glDeleteShader(vertexShader) );
-    GL_ASSERT( glDeleteShader(fragmentShader) );
+    GL_ASSERT( glDeleteShader(pending->vertexShader) );
+    GL_ASSERT( glDeleteShader(pending->fragmentShader) );
+    pending->vertexShader = 0;
+    pending->fragmentShader = 0;
 
     // Check link status.
     if (success != GL_TRUE)
     {
-        GL_ASSERT( glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length) );
+        GL_ASSERT( glGetProgramiv(pending->program, GL_INFO_LOG_LENGTH, &length) );
         if (length == 0)
         {
             length = 4096;
@@ -350,21 +828,35 @@ Effect* Effect::createFromSource(const char* vshPath, const char* vshSource, con
         if (length > 0)
         {
             infoLog = new char[length];
-            GL_ASSERT( glGetProgramInfoLog(program, length, NULL, infoLog) );
+            GL_ASSERT( glGetProgramInfoLog(pending->program, length, NULL, infoLog) );
             infoLog[length-1] = '\0';
         }
         GP_ERROR("Linking program failed (%s,%s): %s", vshPath == NULL ? "NULL" : vshPath, fshPath == NULL ? "NULL" : fshPath, infoLog == NULL ? "" : infoLog);
         SAFE_DELETE_ARRAY(infoLog);
 
         // Clean up.
-        GL_ASSERT( glDeleteProgram(program) );
+        SAFE_DELETE(pending);
+        removeFromCache();
 
-        return NULL;
+        return false;
     }
 
-    // Create and return the new Effect.
-    Effect* effect = new Effect();
-    effect->_program = program;
+    // The effect takes over the linked program.
+    _program = pending->program;
+    pending->program = 0;
+#ifdef GP_USE_PROGRAM_BINARY
+    if (!pending->binaryPath.empty())
+        saveProgramBinary(pending->binaryPath.c_str(), _program);
+#endif
+    SAFE_DELETE(pending);
+
+    loadVariables();
+    return true;
+}
+
+void Effect::loadVariables()
+{
+    GLint length;
 
     // Query and store vertex attribute meta-data from the program.
     // NOTE: Rather than using glBindAttribLocation to explicitly specify our own
@@ -374,10 +866,10 @@ Effect* Effect::createFromSource(const char* vshPath, const char* vshSource, con
     // and therefore using this function can create compatibility issues between
     // different hardware vendors.
     GLint activeAttributes;
-    GL_ASSERT( glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &activeAttributes) );
+    GL_ASSERT( glGetProgramiv(_program, GL_ACTIVE_ATTRIBUTES, &activeAttributes) );
     if (activeAttributes > 0)
     {
-        GL_ASSERT( glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &length) );
+        GL_ASSERT( glGetProgramiv(_program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &length) );
         if (length > 0)
         {
             GLchar* attribName = new GLchar[length + 1];
@@ -387,14 +879,14 @@ Effect* Effect::createFromSource(const char* vshPath, const char* vshSource, con
             for (int i = 0; i < activeAttributes; ++i)
             {
                 // Query attribute info.
-                GL_ASSERT( glGetActiveAttrib(program, i, length, NULL, &attribSize, &attribType, attribName) );
+                GL_ASSERT( glGetActiveAttrib(_program, i, length, NULL, &attribSize, &attribType, attribName) );
                 attribName[length] = '\0';
 
                 // Query the pre-assigned attribute location.
-                GL_ASSERT( attribLocation = glGetAttribLocation(program, attribName) );
+                GL_ASSERT( attribLocation = glGetAttribLocation(_program, attribName) );
 
                 // Assign the vertex attribute mapping for the effect.
-                effect->_vertexAttributes[attribName] = attribLocation;
+                _vertexAttributes[attribName] = attribLocation;
             }
             SAFE_DELETE_ARRAY(attribName);
         }
@@ -402,10 +894,10 @@ Effect* Effect::createFromSource(const char* vshPath, const char* vshSource, con
 
     // Query and store uniforms from the program.
     GLint activeUniforms;
-    GL_ASSERT( glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &activeUniforms) );
+    GL_ASSERT( glGetProgramiv(_program, GL_ACTIVE_UNIFORMS, &activeUniforms) );
     if (activeUniforms > 0)
     {
-        GL_ASSERT( glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &length) );
+        GL_ASSERT( glGetProgramiv(_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &length) );
         if (length > 0)
         {
             GLchar* uniformName = new GLchar[length + 1];
@@ -416,7 +908,7 @@ Effect* Effect::createFromSource(const char* vshPath, const char* vshSource, con
             for (int i = 0; i < activeUniforms; ++i)
             {
                 // Query uniform info.
-                GL_ASSERT( glGetActiveUniform(program, i, length, NULL, &uniformSize, &uniformType, uniformName) );
+                GL_ASSERT( glGetActiveUniform(_program, i, length, NULL, &uniformSize, &uniformType, uniformName) );
                 uniformName[length] = '\0';  // null terminate
                 if (length > 3)
                 {
@@ -432,14 +924,14 @@ Effect* Effect::createFromSource(const char* vshPath, const char* vshSource, con
                 }
 
                 // Query the pre-assigned uniform location.
-                GL_ASSERT( uniformLocation = glGetUniformLocation(program, uniformName) );
+                GL_ASSERT( uniformLocation = glGetUniformLocation(_program, uniformName) );
 
                 Uniform* uniform = new Uniform();
-                uniform->_effect = effect;
+                uniform->_effect = this;
                 uniform->_name = uniformName;
                 uniform->_location = uniformLocation;
                 uniform->_type = uniformType;
-                if (uniformType == GL_SAMPLER_2D || uniformType == GL_SAMPLER_CUBE)
+                if (uniformType == GL_SAMPLER_2D || uniformType == GL_SAMPLER_CUBE || uniformType == GL_SAMPLER_2D_ARRAY)
                 {
                     uniform->_index = samplerIndex;
                     samplerIndex += uniformSize;
@@ -449,13 +941,46 @@ Effect* Effect::createFromSource(const char* vshPath, const char* vshSource, con
                     uniform->_index = 0;
                 }
 
-                effect->_uniforms[uniformName] = uniform;
+                _uniforms[uniformName] = uniform;
             }
             SAFE_DELETE_ARRAY(uniformName);
         }
     }
+}
 
-    return effect;
+void Effect::removeFromCache()
+{
+    std::map<std::string, Effect*>::iterator itr = __effectCache.find(_id);
+    if (itr != __effectCache.end() && itr->second == this)
+    {
+        __effectCache.erase(itr);
+    }
+}
+
+bool Effect::isReady()
+{
+    if (_pending)
+    {
+        if (isParallelCompileSupported())
+        {
+            GLint complete = GL_FALSE;
+            GL_ASSERT( glGetProgramiv(_pending->program, GL_COMPLETION_STATUS_KHR, &complete) );
+            if (complete != GL_TRUE)
+                return false;
+        }
+        else
+        {
+            // Without completion queries, checking the result blocks until the driver is done.
+            // Give the driver a head start and finish one pending effect at a time so that
+            // a burst of new effects is spread over several frames.
+            double time = Game::getAbsoluteTime();
+            if (time - _pending->startTime < ASYNC_COMPILE_INTERVAL || time - __lastAsyncCompileTime < ASYNC_COMPILE_INTERVAL)
+                return false;
+            __lastAsyncCompileTime = time;
+        }
+        finishProgram();
+    }
+    return _program != 0;
 }
 
 const char* Effect::getId() const
@@ -478,6 +1003,10 @@ Uniform* Effect::getUniform(const char* name) const
 		return itr->second;
 	}
 
+    // Effects that are still compiling have no uniforms yet.
+    if (_program == 0)
+        return NULL;
+
     GLint uniformLocation;
     GL_ASSERT( uniformLocation = glGetUniformLocation(_program, name) );
     if (uniformLocation > -1)
@@ -522,6 +1051,47 @@ Uniform* Effect::getUniform(unsigned int index) const
     return NULL;
 }
 
+unsigned int Effect::getUniformId(const char* name)
+{
+    GP_ASSERT(name);
+
+    std::map<std::string, unsigned int>::const_iterator itr = __uniformIds.find(name);
+    if (itr != __uniformIds.end())
+        return itr->second;
+
+    unsigned int id = (unsigned int)__uniformNames.size();
+    __uniformIds[name] = id;
+    __uniformNames.push_back(name);
+    return id;
+}
+
+Uniform* Effect::getUniformById(unsigned int id) const
+{
+    if (id < _uniformSlots.size())
+        return _uniformSlots[id];
+
+    // Effects that are still compiling have no uniforms yet.
+    if (_program == 0)
+        return NULL;
+
+    // The table is extended to the names that were given an id since it was last built. Only
+    // names of array elements ("u_lightColor[1]") can be missing from the active uniforms and
+    // still be found, so the driver is not asked about the others.
+    GP_ASSERT(id < __uniformNames.size());
+    size_t first = _uniformSlots.size();
+    _uniformSlots.resize(__uniformNames.size(), NULL);
+    for (size_t i = first, count = _uniformSlots.size(); i < count; ++i)
+    {
+        const std::string& name = __uniformNames[i];
+        std::map<std::string, Uniform*>::const_iterator itr = _uniforms.find(name);
+        if (itr != _uniforms.end())
+            _uniformSlots[i] = itr->second;
+        else if (name.find('[') != std::string::npos)
+            _uniformSlots[i] = getUniform(name.c_str());
+    }
+    return _uniformSlots[id];
+}
+
 unsigned int Effect::getUniformCount() const
 {
     return (unsigned int)_uniforms.size();
@@ -530,110 +1100,214 @@ unsigned int Effect::getUniformCount() const
 void Effect::setValue(Uniform* uniform, float value)
 {
     GP_ASSERT(uniform);
-    GL_ASSERT( glUniform1f(uniform->_location, value) );
+    uniform->_version = 0;
+    if (RenderCommandList::_capture)
+        RenderCommandList::_capture->captureUniform(uniform, RenderCommandList::UNIFORM_FLOAT, &value, 1);
+    else
+    {
+        GL_ASSERT( glUniform1f(uniform->_location, value) );
+        RenderStats::countUniformUpload();
+    }
 }
 
 void Effect::setValue(Uniform* uniform, const float* values, unsigned int count)
 {
     GP_ASSERT(uniform);
+    uniform->_version = 0;
     GP_ASSERT(values);
-    GL_ASSERT( glUniform1fv(uniform->_location, count, values) );
+    if (RenderCommandList::_capture)
+        RenderCommandList::_capture->captureUniform(uniform, RenderCommandList::UNIFORM_FLOAT, values, count);
+    else
+    {
+        GL_ASSERT( glUniform1fv(uniform->_location, count, values) );
+        RenderStats::countUniformUpload();
+    }
 }
 
 void Effect::setValue(Uniform* uniform, int value)
 {
     GP_ASSERT(uniform);
-    GL_ASSERT( glUniform1i(uniform->_location, value) );
+    uniform->_version = 0;
+    if (RenderCommandList::_capture)
+        RenderCommandList::_capture->captureUniform(uniform, &value, 1);
+    else
+    {
+        GL_ASSERT( glUniform1i(uniform->_location, value) );
+        RenderStats::countUniformUpload();
+    }
 }
 
 void Effect::setValue(Uniform* uniform, const int* values, unsigned int count)
 {
     GP_ASSERT(uniform);
+    uniform->_version = 0;
     GP_ASSERT(values);
-    GL_ASSERT( glUniform1iv(uniform->_location, count, values) );
+    if (RenderCommandList::_capture)
+        RenderCommandList::_capture->captureUniform(uniform, values, count);
+    else
+    {
+        GL_ASSERT( glUniform1iv(uniform->_location, count, values) );
+        RenderStats::countUniformUpload();
+    }
 }
 
 void Effect::setValue(Uniform* uniform, const Matrix& value)
 {
     GP_ASSERT(uniform);
-    GL_ASSERT( glUniformMatrix4fv(uniform->_location, 1, GL_FALSE, value.m) );
+    uniform->_version = 0;
+    if (RenderCommandList::_capture)
+        RenderCommandList::_capture->captureUniform(uniform, RenderCommandList::UNIFORM_MATRIX, value.m, 1);
+    else
+    {
+        GL_ASSERT( glUniformMatrix4fv(uniform->_location, 1, GL_FALSE, value.m) );
+        RenderStats::countUniformUpload();
+    }
 }
 
 void Effect::setValue(Uniform* uniform, const Matrix* values, unsigned int count)
 {
     GP_ASSERT(uniform);
+    uniform->_version = 0;
     GP_ASSERT(values);
-    GL_ASSERT( glUniformMatrix4fv(uniform->_location, count, GL_FALSE, (GLfloat*)values) );
+    if (RenderCommandList::_capture)
+        RenderCommandList::_capture->captureUniform(uniform, RenderCommandList::UNIFORM_MATRIX, (const float*)values, count);
+    else
+    {
+        GL_ASSERT( glUniformMatrix4fv(uniform->_location, count, GL_FALSE, (GLfloat*)values) );
+        RenderStats::countUniformUpload();
+    }
 }
 
 void Effect::setValue(Uniform* uniform, const Vector2& value)
 {
     GP_ASSERT(uniform);
-    GL_ASSERT( glUniform2f(uniform->_location, value.x, value.y) );
+    uniform->_version = 0;
+    if (RenderCommandList::_capture)
+        RenderCommandList::_capture->captureUniform(uniform, RenderCommandList::UNIFORM_VECTOR2, &value.x, 1);
+    else
+    {
+        GL_ASSERT( glUniform2f(uniform->_location, value.x, value.y) );
+        RenderStats::countUniformUpload();
+    }
 }
 
 void Effect::setValue(Uniform* uniform, const Vector2* values, unsigned int count)
 {
     GP_ASSERT(uniform);
+    uniform->_version = 0;
     GP_ASSERT(values);
-    GL_ASSERT( glUniform2fv(uniform->_location, count, (GLfloat*)values) );
+    if (RenderCommandList::_capture)
+        RenderCommandList::_capture->captureUniform(uniform, RenderCommandList::UNIFORM_VECTOR2, (const float*)values, count);
+    else
+    {
+        GL_ASSERT( glUniform2fv(uniform->_location, count, (GLfloat*)values) );
+        RenderStats::countUniformUpload();
+    }
 }
 
 void Effect::setValue(Uniform* uniform, const Vector3& value)
 {
     GP_ASSERT(uniform);
-    GL_ASSERT( glUniform3f(uniform->_location, value.x, value.y, value.z) );
+    uniform->_version = 0;
+    if (RenderCommandList::_capture)
+        RenderCommandList::_capture->captureUniform(uniform, RenderCommandList::UNIFORM_VECTOR3, &value.x, 1);
+    else
+    {
+        GL_ASSERT( glUniform3f(uniform->_location, value.x, value.y, value.z) );
+        RenderStats::countUniformUpload();
+    }
 }
 
 void Effect::setValue(Uniform* uniform, const Vector3* values, unsigned int count)
 {
     GP_ASSERT(uniform);
+    uniform->_version = 0;
     GP_ASSERT(values);
-    GL_ASSERT( glUniform3fv(uniform->_location, count, (GLfloat*)values) );
+    if (RenderCommandList::_capture)
+        RenderCommandList::_capture->captureUniform(uniform, RenderCommandList::UNIFORM_VECTOR3, (const float*)values, count);
+    else
+    {
+        GL_ASSERT( glUniform3fv(uniform->_location, count, (GLfloat*)values) );
+        RenderStats::countUniformUpload();
+    }
 }
 
 void Effect::setValue(Uniform* uniform, const Vector4& value)
 {
     GP_ASSERT(uniform);
-    GL_ASSERT( glUniform4f(uniform->_location, value.x, value.y, value.z, value.w) );
+    uniform->_version = 0;
+    if (RenderCommandList::_capture)
+        RenderCommandList::_capture->captureUniform(uniform, RenderCommandList::UNIFORM_VECTOR4, &value.x, 1);
+    else
+    {
+        GL_ASSERT( glUniform4f(uniform->_location, value.x, value.y, value.z, value.w) );
+        RenderStats::countUniformUpload();
+    }
 }
 
 void Effect::setValue(Uniform* uniform, const Vector4* values, unsigned int count)
 {
     GP_ASSERT(uniform);
+    uniform->_version = 0;
     GP_ASSERT(values);
-    GL_ASSERT( glUniform4fv(uniform->_location, count, (GLfloat*)values) );
+    if (RenderCommandList::_capture)
+        RenderCommandList::_capture->captureUniform(uniform, RenderCommandList::UNIFORM_VECTOR4, (const float*)values, count);
+    else
+    {
+        GL_ASSERT( glUniform4fv(uniform->_location, count, (GLfloat*)values) );
+        RenderStats::countUniformUpload();
+    }
 }
 
 void Effect::setValue(Uniform* uniform, const Texture::Sampler* sampler)
 {
     GP_ASSERT(uniform);
-    GP_ASSERT(uniform->_type == GL_SAMPLER_2D || uniform->_type == GL_SAMPLER_CUBE);
+    GP_ASSERT(uniform->_type == GL_SAMPLER_2D || uniform->_type == GL_SAMPLER_CUBE || uniform->_type == GL_SAMPLER_2D_ARRAY);
     GP_ASSERT(sampler);
     GP_ASSERT((sampler->getTexture()->getType() == Texture::TEXTURE_2D && uniform->_type == GL_SAMPLER_2D) || 
-        (sampler->getTexture()->getType() == Texture::TEXTURE_CUBE && uniform->_type == GL_SAMPLER_CUBE));
+        (sampler->getTexture()->getType() == Texture::TEXTURE_CUBE && uniform->_type == GL_SAMPLER_CUBE) ||
+        (sampler->getTexture()->getType() == Texture::TEXTURE_2D_ARRAY && uniform->_type == GL_SAMPLER_2D_ARRAY));
+
+    if (RenderCommandList::_capture)
+    {
+        RenderCommandList::_capture->captureSamplers(uniform, &sampler, 1);
+        return;
+    }
 
-    GL_ASSERT( glActiveTexture(GL_TEXTURE0 + uniform->_index) );
+    RenderState::activeTexture(uniform->_index);
 
     // Bind the sampler - this binds the texture and applies sampler state
     const_cast<Texture::Sampler*>(sampler)->bind();
 
-    GL_ASSERT( glUniform1i(uniform->_location, uniform->_index) );
+    // The texture unit of a sampler uniform never changes, so it only has to be uploaded once.
+    if (uniform->_samplerUnits != 1)
+    {
+        GL_ASSERT( glUniform1i(uniform->_location, uniform->_index) );
+        RenderStats::countUniformUpload();
+        uniform->_samplerUnits = 1;
+    }
 }
 
 void Effect::setValue(Uniform* uniform, const Texture::Sampler** values, unsigned int count)
 {
     GP_ASSERT(uniform);
-    GP_ASSERT(uniform->_type == GL_SAMPLER_2D || uniform->_type == GL_SAMPLER_CUBE);
+    GP_ASSERT(uniform->_type == GL_SAMPLER_2D || uniform->_type == GL_SAMPLER_CUBE || uniform->_type == GL_SAMPLER_2D_ARRAY);
     GP_ASSERT(values);
 
+    if (RenderCommandList::_capture)
+    {
+        RenderCommandList::_capture->captureSamplers(uniform, values, count);
+        return;
+    }
+
     // Set samplers as active and load texture unit array
     GLint units[32];
     for (unsigned int i = 0; i < count; ++i)
     {
         GP_ASSERT((const_cast<Texture::Sampler*>(values[i])->getTexture()->getType() == Texture::TEXTURE_2D && uniform->_type == GL_SAMPLER_2D) || 
-            (const_cast<Texture::Sampler*>(values[i])->getTexture()->getType() == Texture::TEXTURE_CUBE && uniform->_type == GL_SAMPLER_CUBE));
-        GL_ASSERT( glActiveTexture(GL_TEXTURE0 + uniform->_index + i) );
+            (const_cast<Texture::Sampler*>(values[i])->getTexture()->getType() == Texture::TEXTURE_CUBE && uniform->_type == GL_SAMPLER_CUBE) ||
+            (const_cast<Texture::Sampler*>(values[i])->getTexture()->getType() == Texture::TEXTURE_2D_ARRAY && uniform->_type == GL_SAMPLER_2D_ARRAY));
+        RenderState::activeTexture(uniform->_index + i);
 
         // Bind the sampler - this binds the texture and applies sampler state
         const_cast<Texture::Sampler*>(values[i])->bind();
@@ -642,12 +1316,21 @@ void Effect::setValue(Uniform* uniform, const Texture::Sampler** values, unsigne
     }
 
     // Pass texture unit array to GL
-    GL_ASSERT( glUniform1iv(uniform->_location, count, units) );
+    if (uniform->_samplerUnits != count)
+    {
+        GL_ASSERT( glUniform1iv(uniform->_location, count, units) );
+        RenderStats::countUniformUpload();
+        uniform->_samplerUnits = count;
+    }
 }
 
 void Effect::bind()
 {
-   GL_ASSERT( glUseProgram(_program) );
+    // Effects that are bound before their asynchronous compile is done have to wait for it.
+    if (_pending)
+        finishProgram();
+
+    RenderState::useProgram(_program);
 
     __currentEffect = this;
 }
@@ -658,7 +1341,7 @@ Effect* Effect::getCurrentEffect()
 }
 
 Uniform::Uniform() :
-    _location(-1), _type(0), _index(0), _effect(NULL)
+    _location(-1), _type(0), _index(0), _effect(NULL), _version(0), _samplerUnits(0)
 {
 }
 
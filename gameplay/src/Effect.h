@@ -25,6 +25,8 @@ class Uniform;
  */
 class Effect: public Ref
 {
+    friend class PostProcessChain;
+
 public:
 
     /**
@@ -38,6 +40,29 @@ public:
      */
     static Effect* createFromFile(const char* vshPath, const char* fshPath, const char* defines = NULL);
 
+    /**
+     * Creates an effect using the specified vertex and fragment shader without waiting
+     * for the shaders to be compiled and linked.
+     *
+     * The returned effect has no vertex attributes or uniforms until isReady() returns
+     * true. Compile errors are reported when the effect becomes ready, in which case
+     * isReady() keeps returning false. Binding an effect that is not ready yet waits
+     * for the compile to finish.
+     *
+     * On drivers that support GL_KHR_parallel_shader_compile the shaders are compiled
+     * on driver threads. Otherwise the result is checked on a later call to isReady(),
+     * one effect at a time, so that creating many effects at once does not stall a
+     * single frame.
+     *
+     * @param vshPath The path to the vertex shader file.
+     * @param fshPath The path to the fragment shader file.
+     * @param defines A new-line delimited list of preprocessor defines. May be NULL.
+     *
+     * @return The created effect, which may still be compiling.
+     * @script{ignore}
+     */
+    static Effect* createFromFileAsync(const char* vshPath, const char* fshPath, const char* defines = NULL);
+
     /**
      * Creates an effect from the given vertex and fragment shader source code.
      *
@@ -49,12 +74,86 @@ public:
      */
     static Effect* createFromSource(const char* vshSource, const char* fshSource, const char* defines = NULL);
 
+    /**
+     * Compiles the shader permutations listed in a manifest, so that the materials that use them
+     * later do not compile them on first use.
+     *
+     * The manifest is a properties file with a "permutation" namespace for each effect, with the
+     * same vertexShader, fragmentShader and defines properties as a material pass:
+     *
+     * @code
+     * shaders
+     * {
+     *     permutation
+     *     {
+     *         vertexShader = res/shaders/textured.vert
+     *         fragmentShader = res/shaders/textured.frag
+     *         defines = SKINNING;SKINNING_JOINT_COUNT 30
+     *     }
+     * }
+     * @endcode
+     *
+     * This is meant to be called during a loading screen, and is called for the shaderManifest
+     * property of the graphics namespace of the game config and of scene files. The effects are
+     * kept until releasePrecompiled() is called, and are loaded from the program binary cache
+     * when they are in it. Once a manifest is loaded, every effect that is compiled from files
+     * without being listed in a manifest is logged with a warning, in the format of a
+     * permutation, so that it can be added to the manifest. The defines have to be listed in
+     * the order the materials use them.
+     *
+     * @param manifestPath The path to the manifest.
+     * @param async true to compile the effects without waiting for them, in parallel on drivers
+     *      that support GL_KHR_parallel_shader_compile (see isPrecompileDone()).
+     *
+     * @return The number of permutations of the manifest that were compiled or found in the cache.
+     * @script{ignore}
+     */
+    static unsigned int precompile(const char* manifestPath, bool async = false);
+
+    /**
+     * Determines if all the effects that precompile() started have finished compiling, for
+     * example to keep a loading screen up until they have.
+     *
+     * @return true if no precompiled effect is still compiling.
+     * @script{ignore}
+     */
+    static bool isPrecompileDone();
+
+    /**
+     * Releases the references that precompile() keeps to its effects. The effects that are not
+     * used by any material are destroyed.
+     *
+     * @script{ignore}
+     */
+    static void releasePrecompiled();
+
+    /**
+     * Clears the cache of shader sources.
+     *
+     * The sources of shader files are read once with their includes expanded, and shared by all
+     * of the permutations of the shaders that are created from the files afterwards. A cached
+     * source is read again when the file or one of the files that it includes is modified.
+     *
+     * @script{ignore}
+     */
+    static void clearSourceCache();
+
     /**
      * Returns the unique string identifier for the effect, which is a concatenation of
      * the shader paths it was loaded from.
      */
     const char* getId() const;
 
+    /**
+     * Determines if this effect has finished compiling and can be used for rendering.
+     *
+     * Effects that were not created with createFromFileAsync are always ready.
+     *
+     * @return true if the effect is ready, false if it is still compiling or failed to compile.
+     * @script{ignore}
+     */
+    bool isReady();
+
     /**
      * Returns the vertex attribute handle for the vertex attribute with the specified name.
      *
@@ -82,6 +181,33 @@ public:
      */
     Uniform* getUniform(unsigned int index) const;
 
+    /**
+     * Returns the id of a uniform name, which is the same for every effect.
+     *
+     * The ids are small consecutive numbers that are handed out the first time a name is asked
+     * for, so that parameters can look up their uniform with getUniformById() instead of
+     * comparing names.
+     *
+     * @param name The name of the uniform.
+     *
+     * @return The id of the name.
+     * @script{ignore}
+     */
+    static unsigned int getUniformId(const char* name);
+
+    /**
+     * Returns the uniform of this effect with the name of the specified id.
+     *
+     * The effect keeps a table of its uniforms indexed by id, so this is an array lookup once
+     * the table covers the id.
+     *
+     * @param id The id of the name of the uniform, from getUniformId().
+     *
+     * @return The uniform, or NULL if no such uniform exists.
+     * @script{ignore}
+     */
+    Uniform* getUniformById(unsigned int id) const;
+
     /**
      * Returns the number of active uniforms in this effect.
      * 
@@ -239,12 +365,27 @@ private:
      */
     Effect& operator=(const Effect&);
 
-    static Effect* createFromSource(const char* vshPath, const char* vshSource, const char* fshPath, const char* fshSource, const char* defines = NULL);
+    struct PendingProgram;
+
+    static Effect* createFromFile(const char* vshPath, const char* fshPath, const char* defines, bool async);
+
+    static Effect* createFromSource(const char* vshPath, const char* vshSource, const char* fshPath, const char* fshSource, const char* defines = NULL, bool async = false);
+
+    static Effect* createFromExpandedSource(const char* vshPath, const char* vshFullSource, const char* fshPath, const char* fshFullSource,
+                                            const char* defines, bool async);
+
+    bool finishProgram();
+
+    void loadVariables();
+
+    void removeFromCache();
 
     GLuint _program;
+    PendingProgram* _pending;
     std::string _id;
     std::map<std::string, VertexAttribute> _vertexAttributes;
     mutable std::map<std::string, Uniform*> _uniforms;
+    mutable std::vector<Uniform*> _uniformSlots;
     static Uniform _emptyUniform;
 };
 
@@ -254,6 +395,8 @@ private:
 class Uniform
 {
     friend class Effect;
+    friend class MaterialParameter;
+    friend class RenderCommandList;
 
 public:
 
@@ -305,6 +448,8 @@ private:
     GLenum _type;
     unsigned int _index;
     Effect* _effect;
+    unsigned int _version;
+    unsigned int _samplerUnits;
 };
 
 }
@@ -4,6 +4,8 @@
 #include "Stream.h"
 #include "Platform.h"
 
+#include <zlib.h>
+
 #include <sys/types.h>
 #include <sys/stat.h>
 
@@ -18,6 +20,9 @@
     #define __EXT_POSIX2
     #include <libgen.h>
     #include <dirent.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
     #define gp_stat stat
     #define gp_stat_struct struct stat
 #endif
@@ -90,6 +95,162 @@ static std::string __resourcePath("./");
 static std::string __assetPath("");
 static std::map<std::string, std::string> __aliases;
 
+// Pack archive format (written by the encoder, see FileSystem::mountArchive).
+#define ARCHIVE_MAGIC               "GPAK"
+#define ARCHIVE_VERSION             1
+#define ARCHIVE_COMPRESSION_NONE    0
+#define ARCHIVE_COMPRESSION_ZLIB    1
+
+/**
+ * The header at the start of a pack archive, followed by the entry table, the names and the file data.
+ */
+struct ArchiveHeader
+{
+    char magic[4];
+    unsigned int version;
+    unsigned int entryCount;
+    unsigned int namesLength;
+};
+
+/**
+ * An entry of the table of a pack archive, which is sorted by hash and then by name.
+ * Offsets are from the start of the archive.
+ */
+struct ArchiveEntry
+{
+    unsigned int hash;
+    unsigned int nameOffset;
+    unsigned int nameLength;
+    unsigned int compression;
+    unsigned int offset;
+    unsigned int size;
+    unsigned int originalSize;
+};
+
+/**
+ * A mounted pack archive.
+ */
+struct Archive
+{
+    std::string path;
+    Stream* stream;                     // The mapped archive, or NULL if it could not be mapped.
+    const char* data;                   // The contents of the mapped archive.
+    std::vector<ArchiveEntry> entries;
+    std::string names;
+};
+
+// Mounted archives, in the order they were mounted.
+static std::vector<Archive*> __archives;
+
+// Asset manifest format (written by the encoder, see FileSystem::loadManifest).
+#define MANIFEST_MAGIC              "GPMF"
+#define MANIFEST_VERSION            1
+
+/**
+ * The header at the start of an asset manifest, followed by the entry table and the names.
+ */
+struct ManifestHeader
+{
+    char magic[4];
+    unsigned int version;
+    unsigned int entryCount;
+    unsigned int namesLength;
+};
+
+/**
+ * An entry of the table of an asset manifest.
+ */
+struct ManifestFileEntry
+{
+    unsigned int nameOffset;
+    unsigned int nameLength;
+    unsigned int size;
+    unsigned int hash;
+};
+
+/**
+ * A file of the loaded asset manifest.
+ */
+struct ManifestFile
+{
+    size_t size;
+    unsigned int hash;
+    bool written;                       // The file was written since the manifest was loaded, so only its existence is known.
+};
+
+// The files of the loaded asset manifest, keyed as the files of the archives are, and the directories that hold them.
+static std::unordered_map<std::string, ManifestFile> __manifest;
+static std::set<std::string> __manifestDirectories;
+static bool __manifestLoaded = false;
+
+// Returns the directory of the key of a file, which is empty for the files at the root.
+static std::string getAssetDirectory(const std::string& key)
+{
+    size_t slash = key.rfind('/');
+    return slash == std::string::npos ? std::string() : key.substr(0, slash);
+}
+
+/**
+ * Gets the key of a relative path in the archives and in the manifest: the resolved path, with
+ * forward slashes and without leading "./".
+ *
+ * @param path The relative path.
+ * @param key The key of the path. (out param)
+ */
+static void getAssetKey(const char* path, std::string& key)
+{
+    key.assign(FileSystem::resolvePath(path));
+    std::replace(key.begin(), key.end(), '\\', '/');
+    size_t start = 0;
+    while (key.compare(start, 2, "./") == 0)
+        start += 2;
+    key.erase(0, start);
+}
+
+/**
+ * Finds the file of the loaded manifest for the given path.
+ *
+ * The manifest lists all the files of the directories that it lists, so it tells whether a file
+ * exists in those directories. Other directories, such as caches that are written at runtime,
+ * are looked for on disk.
+ *
+ * @param path The path of the file to find.
+ * @param file The file, or NULL if it is not in the manifest. (out param)
+ *
+ * @return True if the manifest lists the directory of the path, false otherwise.
+ */
+static bool findManifestFile(const char* path, const ManifestFile** file)
+{
+    *file = NULL;
+    if (!__manifestLoaded || FileSystem::isAbsolutePath(path))
+        return false;
+
+    std::string key;
+    getAssetKey(path, key);
+    if (__manifestDirectories.find(getAssetDirectory(key)) == __manifestDirectories.end())
+        return false;
+    std::unordered_map<std::string, ManifestFile>::const_iterator itr = __manifest.find(key);
+    if (itr != __manifest.end())
+        *file = &itr->second;
+    return true;
+}
+
+/**
+ * Adds a file that is written at runtime to the loaded manifest.
+ */
+static void addManifestFile(const char* path)
+{
+    if (!__manifestLoaded || FileSystem::isAbsolutePath(path))
+        return;
+
+    std::string key;
+    getAssetKey(path, key);
+    ManifestFile& file = __manifest[key];
+    file.size = 0;
+    file.hash = 0;
+    file.written = true;
+}
+
 /**
  * Gets the fully resolved path.
  * If the path is relative then it will be prefixed with the resource path.
@@ -145,6 +306,58 @@ private:
     bool _canWrite;
 };
 
+/**
+ * A read-only stream over a file that is mapped into memory, or over a block of memory
+ * such as a file in a pack archive.
+ *
+ * @script{ignore}
+ */
+class MappedStream : public Stream
+{
+public:
+    friend class FileSystem;
+
+    ~MappedStream();
+    virtual bool canRead();
+    virtual bool canWrite();
+    virtual bool canSeek();
+    virtual void close();
+    virtual size_t read(void* ptr, size_t size, size_t count);
+    virtual char* readLine(char* str, int num);
+    virtual size_t write(const void* ptr, size_t size, size_t count);
+    virtual bool eof();
+    virtual size_t length();
+    virtual long int position();
+    virtual bool seek(long int offset, int origin);
+    virtual bool rewind();
+    virtual const void* getMappedData();
+
+    static MappedStream* create(const char* filePath);
+
+#ifdef __ANDROID__
+    static MappedStream* createFromAsset(const char* filePath);
+#endif
+
+    static MappedStream* createFromMemory(const char* data, size_t length, char* buffer);
+
+private:
+    MappedStream();
+
+private:
+    const char* _data;
+    size_t _length;
+    size_t _position;
+    char* _buffer;      // Memory that the stream owns, if it is not a mapped file.
+    bool _view;         // Whether the stream reads memory that is owned elsewhere.
+#ifdef WIN32
+    HANDLE _file;
+    HANDLE _mapping;
+#endif
+#ifdef __ANDROID__
+    AAsset* _asset;
+#endif
+};
+
 #ifdef __ANDROID__
 
 /**
@@ -181,6 +394,106 @@ private:
 
 #endif
 
+/**
+ * Returns the FNV-1a hash of a path in a pack archive.
+ */
+static unsigned int hashArchivePath(const char* path, size_t length)
+{
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash ^= (unsigned char)path[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static bool compareArchiveEntry(const ArchiveEntry& entry, unsigned int hash)
+{
+    return entry.hash < hash;
+}
+
+/**
+ * Finds the most recently mounted archive entry for the given path.
+ *
+ * @param path The path of the file to find.
+ * @param archive The archive that holds the entry. (out param)
+ *
+ * @return The entry, or NULL if the file is not in any mounted archive.
+ */
+static const ArchiveEntry* findArchiveEntry(const char* path, Archive** archive)
+{
+    if (__archives.empty() || FileSystem::isAbsolutePath(path))
+        return NULL;
+
+    // Entries are keyed by paths relative to the packed directory, with forward slashes.
+    std::string name;
+    getAssetKey(path, name);
+
+    const char* key = name.c_str();
+    size_t length = name.length();
+    unsigned int hash = hashArchivePath(key, length);
+    for (size_t i = __archives.size(); i-- > 0;)
+    {
+        Archive* a = __archives[i];
+        std::vector<ArchiveEntry>::const_iterator itr = std::lower_bound(a->entries.begin(), a->entries.end(), hash, compareArchiveEntry);
+        for (; itr != a->entries.end() && itr->hash == hash; ++itr)
+        {
+            if (itr->nameLength == length && a->names.compare(itr->nameOffset, length, key) == 0)
+            {
+                *archive = a;
+                return &(*itr);
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Opens a stream over a file in a pack archive.
+ */
+static Stream* openArchiveEntry(Archive* archive, const ArchiveEntry* entry)
+{
+    GP_ASSERT(archive);
+    GP_ASSERT(entry);
+
+    // Files are read in place from mapped archives, and read into memory otherwise.
+    const char* stored = NULL;
+    char* storedBuffer = NULL;
+    if (archive->data)
+    {
+        stored = archive->data + entry->offset;
+    }
+    else
+    {
+        std::unique_ptr<Stream> stream(FileSystem::open(archive->path.c_str()));
+        storedBuffer = new char[entry->size];
+        if (stream.get() == NULL || !stream->seek(entry->offset, SEEK_SET) || stream->read(storedBuffer, 1, entry->size) != entry->size)
+        {
+            GP_ERROR("Failed to read '%s' from archive '%s'.", archive->names.substr(entry->nameOffset, entry->nameLength).c_str(), archive->path.c_str());
+            SAFE_DELETE_ARRAY(storedBuffer);
+            return NULL;
+        }
+        stored = storedBuffer;
+    }
+
+    if (entry->compression == ARCHIVE_COMPRESSION_NONE)
+        return MappedStream::createFromMemory(stored, entry->size, storedBuffer);
+
+    GP_ASSERT(entry->compression == ARCHIVE_COMPRESSION_ZLIB);
+    char* buffer = new char[entry->originalSize];
+    uLongf length = entry->originalSize;
+    int result = uncompress((Bytef*)buffer, &length, (const Bytef*)stored, entry->size);
+    SAFE_DELETE_ARRAY(storedBuffer);
+    if (result != Z_OK || length != entry->originalSize)
+    {
+        GP_ERROR("Failed to decompress '%s' from archive '%s' (%d).", archive->names.substr(entry->nameOffset, entry->nameLength).c_str(), archive->path.c_str(), result);
+        SAFE_DELETE_ARRAY(buffer);
+        return NULL;
+    }
+    return MappedStream::createFromMemory(buffer, entry->originalSize, buffer);
+}
+
 /////////////////////////////
 
 FileSystem::FileSystem()
@@ -340,10 +653,97 @@ bool FileSystem::listFiles(const char* dirPath, std::vector<std::string>& files)
 #endif
 }
 
+bool FileSystem::mountArchive(const char* path)
+{
+    GP_ASSERT(path);
+
+    for (size_t i = 0, count = __archives.size(); i < count; ++i)
+    {
+        if (__archives[i]->path == path)
+        {
+            GP_WARN("Archive '%s' is already mounted.", path);
+            return true;
+        }
+    }
+
+    Stream* stream = open(path, READ | MAP);
+    if (stream == NULL)
+    {
+        GP_ERROR("Failed to open archive '%s'.", path);
+        return false;
+    }
+
+    // Read and validate the tables of the archive.
+    ArchiveHeader header;
+    size_t length = stream->length();
+    Archive* archive = new Archive();
+    archive->path = path;
+    archive->stream = NULL;
+    archive->data = NULL;
+    bool valid = stream->read(&header, sizeof(header), 1) == 1 &&
+        memcmp(header.magic, ARCHIVE_MAGIC, 4) == 0 &&
+        header.version == ARCHIVE_VERSION &&
+        sizeof(header) + (size_t)header.entryCount * sizeof(ArchiveEntry) + header.namesLength <= length;
+    if (valid)
+    {
+        archive->entries.resize(header.entryCount);
+        archive->names.resize(header.namesLength);
+        valid = (header.entryCount == 0 || stream->read(&archive->entries[0], sizeof(ArchiveEntry), header.entryCount) == header.entryCount) &&
+            (header.namesLength == 0 || stream->read(&archive->names[0], 1, header.namesLength) == header.namesLength);
+    }
+    for (size_t i = 0, count = archive->entries.size(); i < count && valid; ++i)
+    {
+        const ArchiveEntry& entry = archive->entries[i];
+        valid = (size_t)entry.nameOffset + entry.nameLength <= header.namesLength &&
+            (size_t)entry.offset + entry.size <= length &&
+            (entry.compression == ARCHIVE_COMPRESSION_NONE || entry.compression == ARCHIVE_COMPRESSION_ZLIB) &&
+            (i == 0 || archive->entries[i - 1].hash <= entry.hash);
+    }
+    if (!valid)
+    {
+        GP_ERROR("Invalid archive '%s'.", path);
+        SAFE_DELETE(stream);
+        SAFE_DELETE(archive);
+        return false;
+    }
+
+    // Keep mapped archives open so that files can be read from them in place.
+    archive->data = (const char*)stream->getMappedData();
+    if (archive->data)
+        archive->stream = stream;
+    else
+        SAFE_DELETE(stream);
+
+    __archives.push_back(archive);
+    return true;
+}
+
+void FileSystem::unmountArchive(const char* path)
+{
+    for (size_t i = __archives.size(); i-- > 0;)
+    {
+        Archive* archive = __archives[i];
+        if (path == NULL || archive->path == path)
+        {
+            SAFE_DELETE(archive->stream);
+            SAFE_DELETE(archive);
+            __archives.erase(__archives.begin() + i);
+        }
+    }
+}
+
 bool FileSystem::fileExists(const char* filePath)
 {
     GP_ASSERT(filePath);
 
+    Archive* archive;
+    if (findArchiveEntry(filePath, &archive))
+        return true;
+
+    const ManifestFile* file;
+    if (findManifestFile(filePath, &file))
+        return file != NULL;
+
     std::string fullPath;
 
 #ifdef __ANDROID__
@@ -365,9 +765,21 @@ bool FileSystem::fileExists(const char* filePath)
 
 Stream* FileSystem::open(const char* path, size_t streamMode)
 {
+    // Files in mounted archives take precedence over files on disk.
+    if ((streamMode & WRITE) == 0)
+    {
+        Archive* archive;
+        const ArchiveEntry* entry = findArchiveEntry(path, &archive);
+        if (entry)
+            return openArchiveEntry(archive, entry);
+    }
+
     char modeStr[] = "rb";
     if ((streamMode & WRITE) != 0)
+    {
         modeStr[0] = 'w';
+        addManifestFile(path);
+    }
 #ifdef __ANDROID__
     std::string fullPath(__resourcePath);
     fullPath += resolvePath(path);
@@ -388,7 +800,11 @@ Stream* FileSystem::open(const char* path, size_t streamMode)
     else
     {
         // First try the SD card
-        Stream* stream = FileStream::create(fullPath.c_str(), modeStr);
+        Stream* stream = NULL;
+        if ((streamMode & MAP) != 0)
+            stream = MappedStream::create(fullPath.c_str());
+        if (!stream)
+            stream = FileStream::create(fullPath.c_str(), modeStr);
 
         if (!stream)
         {
@@ -396,7 +812,11 @@ Stream* FileSystem::open(const char* path, size_t streamMode)
             fullPath = __assetPath;
             fullPath += resolvePath(path);
 
-            stream = FileStreamAndroid::create(fullPath.c_str(), modeStr);
+            // Only assets that are stored uncompressed in the package can be mapped.
+            if ((streamMode & MAP) != 0)
+                stream = MappedStream::createFromAsset(fullPath.c_str());
+            if (!stream)
+                stream = FileStreamAndroid::create(fullPath.c_str(), modeStr);
         }
 
         return stream;
@@ -404,6 +824,12 @@ Stream* FileSystem::open(const char* path, size_t streamMode)
 #else
     std::string fullPath;
     getFullPath(path, fullPath);
+    if ((streamMode & (MAP | WRITE)) == MAP)
+    {
+        Stream* stream = MappedStream::create(fullPath.c_str());
+        if (stream)
+            return stream;
+    }
     FileStream* stream = FileStream::create(fullPath.c_str(), modeStr);
     return stream;
 #endif
@@ -420,9 +846,153 @@ FILE* FileSystem::openFile(const char* filePath, const char* mode)
     createFileFromAsset(filePath);
     
     FILE* fp = fopen(fullPath.c_str(), mode);
+    if (fp && (strchr(mode, 'w') || strchr(mode, 'a')))
+        addManifestFile(filePath);
     return fp;
 }
 
+bool FileSystem::loadManifest(const char* path)
+{
+    GP_ASSERT(path);
+
+    // The manifest is read before it is loaded, so that its own path is looked for on disk.
+    unloadManifest();
+    std::unique_ptr<Stream> stream(open(path));
+    if (stream.get() == NULL)
+    {
+        GP_WARN("Failed to open asset manifest '%s'.", path);
+        return false;
+    }
+
+    ManifestHeader header;
+    std::vector<ManifestFileEntry> entries;
+    std::string names;
+    bool valid = stream->read(&header, sizeof(header), 1) == 1 &&
+        memcmp(header.magic, MANIFEST_MAGIC, 4) == 0 &&
+        header.version == MANIFEST_VERSION &&
+        sizeof(header) + (size_t)header.entryCount * sizeof(ManifestFileEntry) + header.namesLength <= stream->length();
+    if (valid)
+    {
+        entries.resize(header.entryCount);
+        names.resize(header.namesLength);
+        valid = (header.entryCount == 0 || stream->read(&entries[0], sizeof(ManifestFileEntry), header.entryCount) == header.entryCount) &&
+            (header.namesLength == 0 || stream->read(&names[0], 1, header.namesLength) == header.namesLength);
+    }
+    for (size_t i = 0, count = entries.size(); i < count && valid; ++i)
+    {
+        valid = (size_t)entries[i].nameOffset + entries[i].nameLength <= header.namesLength;
+    }
+    if (!valid)
+    {
+        GP_WARN("Invalid asset manifest '%s'.", path);
+        return false;
+    }
+
+    __manifest.reserve(entries.size());
+    for (size_t i = 0, count = entries.size(); i < count; ++i)
+    {
+        const ManifestFileEntry& entry = entries[i];
+        std::string key(names, entry.nameOffset, entry.nameLength);
+        __manifestDirectories.insert(getAssetDirectory(key));
+        ManifestFile& file = __manifest[key];
+        file.size = entry.size;
+        file.hash = entry.hash;
+        file.written = false;
+    }
+    __manifestLoaded = true;
+    return true;
+}
+
+void FileSystem::unloadManifest()
+{
+    __manifest.clear();
+    __manifestDirectories.clear();
+    __manifestLoaded = false;
+}
+
+bool FileSystem::isManifestLoaded()
+{
+    return __manifestLoaded;
+}
+
+bool FileSystem::getFileSize(const char* filePath, size_t* size)
+{
+    GP_ASSERT(filePath);
+    GP_ASSERT(size);
+
+    Archive* archive;
+    const ArchiveEntry* entry = findArchiveEntry(filePath, &archive);
+    if (entry)
+    {
+        *size = entry->originalSize;
+        return true;
+    }
+
+    const ManifestFile* file;
+    if (findManifestFile(filePath, &file))
+    {
+        if (file == NULL)
+            return false;
+        if (!file->written)
+        {
+            *size = file->size;
+            return true;
+        }
+    }
+
+    std::unique_ptr<Stream> stream(open(filePath));
+    if (stream.get() == NULL)
+        return false;
+    *size = stream->length();
+    return true;
+}
+
+bool FileSystem::getFileHash(const char* filePath, unsigned int* hash)
+{
+    GP_ASSERT(filePath);
+    GP_ASSERT(hash);
+
+    const ManifestFile* file;
+    if (!findManifestFile(filePath, &file) || file == NULL || file->written)
+        return false;
+    *hash = file->hash;
+    return true;
+}
+
+bool FileSystem::getModifiedTime(const char* filePath, time_t* time)
+{
+    GP_ASSERT(filePath);
+    GP_ASSERT(time);
+
+    Archive* archive;
+    if (findArchiveEntry(filePath, &archive))
+    {
+        *time = 0;
+        return true;
+    }
+
+    std::string fullPath;
+
+#ifdef __ANDROID__
+    fullPath = __assetPath;
+    fullPath += resolvePath(filePath);
+
+    if (androidFileExists(fullPath.c_str()))
+    {
+        *time = 0;
+        return true;
+    }
+#endif
+
+    getFullPath(filePath, fullPath);
+
+    gp_stat_struct s;
+    if (stat(fullPath.c_str(), &s) != 0)
+        return false;
+    *time = s.st_mtime;
+    return true;
+}
+
 char* FileSystem::readAll(const char* filePath, int* fileSize)
 {
     GP_ASSERT(filePath);
@@ -717,6 +1287,245 @@ bool FileStream::rewind()
 
 ////////////////////////////////
 
+MappedStream::MappedStream()
+    : _data(NULL), _length(0), _position(0), _buffer(NULL), _view(false)
+#ifdef WIN32
+    , _file(INVALID_HANDLE_VALUE), _mapping(NULL)
+#endif
+#ifdef __ANDROID__
+    , _asset(NULL)
+#endif
+{
+}
+
+MappedStream::~MappedStream()
+{
+    close();
+}
+
+MappedStream* MappedStream::create(const char* filePath)
+{
+    // Empty files cannot be mapped, so they are left to regular file streams.
+#ifdef WIN32
+    HANDLE file = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return NULL;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    const void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (data == NULL)
+    {
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        return NULL;
+    }
+
+    MappedStream* stream = new MappedStream();
+    stream->_file = file;
+    stream->_mapping = mapping;
+    stream->_data = (const char*)data;
+    stream->_length = (size_t)size.QuadPart;
+    return stream;
+#else
+    int fd = ::open(filePath, O_RDONLY);
+    if (fd == -1)
+        return NULL;
+    gp_stat_struct s;
+    if (fstat(fd, &s) != 0 || s.st_size == 0 || !S_ISREG(s.st_mode))
+    {
+        ::close(fd);
+        return NULL;
+    }
+    void* data = mmap(NULL, (size_t)s.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after the file is closed.
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return NULL;
+
+    MappedStream* stream = new MappedStream();
+    stream->_data = (const char*)data;
+    stream->_length = (size_t)s.st_size;
+    return stream;
+#endif
+}
+
+#ifdef __ANDROID__
+
+MappedStream* MappedStream::createFromAsset(const char* filePath)
+{
+    AAsset* asset = AAssetManager_open(__assetManager, filePath, AASSET_MODE_BUFFER);
+    if (asset == NULL)
+        return NULL;
+
+    // Assets that are compressed in the package would have to be decompressed into a buffer first.
+    const void* data = AAsset_isAllocated(asset) ? NULL : AAsset_getBuffer(asset);
+    size_t length = (size_t)AAsset_getLength(asset);
+    if (data == NULL || length == 0)
+    {
+        AAsset_close(asset);
+        return NULL;
+    }
+
+    MappedStream* stream = new MappedStream();
+    stream->_asset = asset;
+    stream->_data = (const char*)data;
+    stream->_length = length;
+    return stream;
+}
+
+#endif
+
+MappedStream* MappedStream::createFromMemory(const char* data, size_t length, char* buffer)
+{
+    GP_ASSERT(data);
+
+    MappedStream* stream = new MappedStream();
+    stream->_data = data;
+    stream->_length = length;
+    stream->_buffer = buffer;
+    stream->_view = (buffer == NULL);
+    return stream;
+}
+
+bool MappedStream::canRead()
+{
+    return _data != NULL;
+}
+
+bool MappedStream::canWrite()
+{
+    return false;
+}
+
+bool MappedStream::canSeek()
+{
+    return _data != NULL;
+}
+
+void MappedStream::close()
+{
+    if (_data == NULL)
+        return;
+
+    if (_buffer || _view)
+    {
+        SAFE_DELETE_ARRAY(_buffer);
+        _view = false;
+    }
+#ifdef __ANDROID__
+    else if (_asset)
+    {
+        AAsset_close(_asset);
+        _asset = NULL;
+    }
+#endif
+    else
+    {
+#ifdef WIN32
+        UnmapViewOfFile(_data);
+        CloseHandle(_mapping);
+        CloseHandle(_file);
+        _mapping = NULL;
+        _file = INVALID_HANDLE_VALUE;
+#else
+        munmap((void*)_data, _length);
+#endif
+    }
+    _data = NULL;
+    _length = 0;
+    _position = 0;
+}
+
+size_t MappedStream::read(void* ptr, size_t size, size_t count)
+{
+    if (_data == NULL || size == 0)
+        return 0;
+
+    // Only whole elements are read, like fread.
+    count = std::min(count, (_length - _position) / size);
+    memcpy(ptr, _data + _position, size * count);
+    _position += size * count;
+    return count;
+}
+
+char* MappedStream::readLine(char* str, int num)
+{
+    if (_data == NULL || num <= 0 || _position >= _length)
+        return NULL;
+
+    // Read up to and including the next line break, like fgets.
+    size_t i = 0;
+    while (i + 1 < (size_t)num && _position < _length)
+    {
+        char c = _data[_position++];
+        str[i++] = c;
+        if (c == '\n')
+            break;
+    }
+    str[i] = '\0';
+    return str;
+}
+
+size_t MappedStream::write(const void* ptr, size_t size, size_t count)
+{
+    return 0;
+}
+
+bool MappedStream::eof()
+{
+    return _position >= _length;
+}
+
+size_t MappedStream::length()
+{
+    return _length;
+}
+
+long int MappedStream::position()
+{
+    if (_data == NULL)
+        return -1;
+    return (long int)_position;
+}
+
+bool MappedStream::seek(long int offset, int origin)
+{
+    if (_data == NULL)
+        return false;
+
+    long int base = 0;
+    if (origin == SEEK_CUR)
+        base = (long int)_position;
+    else if (origin == SEEK_END)
+        base = (long int)_length;
+    else if (origin != SEEK_SET)
+        return false;
+
+    long int position = base + offset;
+    if (position < 0 || (size_t)position > _length)
+        return false;
+    _position = (size_t)position;
+    return true;
+}
+
+bool MappedStream::rewind()
+{
+    return seek(0, SEEK_SET);
+}
+
+const void* MappedStream::getMappedData()
+{
+    return _data;
+}
+
+////////////////////////////////
+
 #ifdef __ANDROID__
 
 FileStreamAndroid::FileStreamAndroid(AAsset* asset)
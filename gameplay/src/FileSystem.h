@@ -24,7 +24,8 @@ public:
     enum StreamMode
     {
         READ = 1,
-        WRITE = 2
+        WRITE = 2,
+        MAP = 4
     };
 
     /**
@@ -137,6 +138,130 @@ public:
      */
     static bool listFiles(const char* dirPath, std::vector<std::string>& files);
 
+    /**
+     * Mounts a pack archive, so that the files in it can be opened as if they were in the resource path.
+     *
+     * Pack archives are created with the encoder ('gameplay-encoder -pack <directory> <archive>') and
+     * hold the files of a directory, keyed by their paths relative to that directory. Files that are
+     * opened for reading are looked up in the mounted archives first, most recently mounted first, and
+     * then on disk. Aliases are resolved before the lookup.
+     *
+     * The archive is mapped into memory where the platform supports it. Files that are stored
+     * uncompressed in a mapped archive are read in place (see Stream::getMappedData), while compressed
+     * files are decompressed into memory when they are opened.
+     *
+     * Archives can also be mounted at startup from the game.config file:
+     *
+     * @code
+     * archives
+     * {
+     *     base = res/base.gpk
+     * }
+     * @endcode
+     *
+     * @param path The path to the archive file, relative to the resource path.
+     *
+     * @return True if the archive was mounted, false if it could not be opened or is not a valid archive.
+     *
+     * @script{ignore}
+     */
+    static bool mountArchive(const char* path);
+
+    /**
+     * Unmounts a pack archive that was mounted with mountArchive.
+     *
+     * Streams that were opened from a mapped archive refer to its memory, so they must be
+     * closed before the archive is unmounted.
+     *
+     * @param path The path the archive was mounted with, or NULL to unmount all archives.
+     *
+     * @script{ignore}
+     */
+    static void unmountArchive(const char* path = NULL);
+
+    /**
+     * Loads a manifest of the asset files, written by the encoder with:
+     *
+     * @code
+     * gameplay-encoder -manifest . game.manifest
+     * @endcode
+     *
+     * While a manifest is loaded, fileExists and getFileSize answer from it for the relative paths
+     * of the directories that it lists, instead of looking for the files on disk. Other directories
+     * are still looked for on disk. Files that are written with open or openFile are added to it.
+     *
+     * The manifest can also be loaded at startup from the game.config file:
+     *
+     * @code
+     * manifest = game.manifest
+     * @endcode
+     *
+     * @param path The path to the manifest file, relative to the resource path.
+     *
+     * @return True if the manifest was loaded, false if it could not be opened or is not a valid manifest.
+     *
+     * @script{ignore}
+     */
+    static bool loadManifest(const char* path);
+
+    /**
+     * Unloads the manifest that was loaded with loadManifest.
+     *
+     * @script{ignore}
+     */
+    static void unloadManifest();
+
+    /**
+     * Returns whether an asset manifest is loaded.
+     *
+     * @return True if a manifest is loaded, false otherwise.
+     *
+     * @script{ignore}
+     */
+    static bool isManifestLoaded();
+
+    /**
+     * Gets the size of a file, from the mounted archives or the manifest when they hold it.
+     *
+     * @param filePath The path to the file.
+     * @param size The size of the file, in bytes. (out param)
+     *
+     * @return True if the size was found, false if the file does not exist.
+     *
+     * @script{ignore}
+     */
+    static bool getFileSize(const char* filePath, size_t* size);
+
+    /**
+     * Gets the hash of the contents of a file that is listed in the manifest.
+     *
+     * The hash can be compared to the hash of a file downloaded or cached earlier to tell
+     * whether it changed, without reading the file.
+     *
+     * @param filePath The path to the file.
+     * @param hash The FNV-1a hash of the contents of the file. (out param)
+     *
+     * @return True if the manifest lists the file, false otherwise or if it was written since the manifest was loaded.
+     *
+     * @script{ignore}
+     */
+    static bool getFileHash(const char* filePath, unsigned int* hash);
+
+    /**
+     * Gets the time at which a file was last modified.
+     *
+     * The files in mounted archives and in the assets of the Android package do not change
+     * while the game runs, so their time is always 0.
+     *
+     * @param filePath The path to the file.
+     * @param time The modification time of the file. (out param)
+     *
+     * @return True if the time was found, false if the file does not exist.
+     *
+     * @script{ignore}
+     */
+    static bool getModifiedTime(const char* filePath, time_t* time);
+
     /**
      * Checks if the file at the given path exists.
      * 
@@ -152,6 +277,13 @@ public:
      * If <code>path</code> is a file path, the file at the specified location is opened relative to the currently set
      * resource path.
      *
+     * When <code>streamMode</code> includes MAP, a file that is opened for reading is mapped into memory
+     * where the platform supports it, so that its contents can be used without being copied (see
+     * Stream::getMappedData). Files that cannot be mapped, such as compressed Android assets, are opened
+     * as regular streams instead.
+     *
+     * Files that are opened for reading are looked up in the mounted pack archives first (see mountArchive).
+     *
      * @param path The path to the resource to be opened, relative to the currently set resource path.
      * @param streamMode The stream mode used to open the file.
      * 
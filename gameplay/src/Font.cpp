@@ -5,6 +5,16 @@
 #include "FileSystem.h"
 #include "Bundle.h"
 #include "Material.h"
+#include "ResourceCache.h"
+#include "TextLayout.h"
+#include "GlyphCache.h"
+
+// The number of layouts that each font keeps for the text drawn without one
+#define FONT_LAYOUT_CACHE_SIZE 32
+
+// The size of fonts created from font files, and the number of other sizes that are added as text is drawn
+#define FONT_DYNAMIC_DEFAULT_SIZE 18
+#define FONT_DYNAMIC_MAX_SIZES 8
 
 // Default font shaders
 #define FONT_VSH "res/shaders/font.vert"
@@ -13,27 +23,68 @@
 namespace gameplay
 {
 
-static std::vector<Font*> __fontCache;
+static ResourceCache __fontCache;
 
 static Effect* __fontEffect = NULL;
 
+/**
+ * Returns the character that a UTF-8 sequence starts with, and the number of bytes of the sequence after the first.
+ *
+ * A byte that does not start a valid sequence is returned as it is.
+ */
+static int decodeCharacter(const char* text, size_t length, unsigned int* extraBytes)
+{
+    const unsigned char* bytes = (const unsigned char*)text;
+    int character = bytes[0];
+    unsigned int count = 0;
+    if (character >= 0xF0 && character < 0xF8)
+    {
+        count = 3;
+        character &= 0x07;
+    }
+    else if (character >= 0xE0 && character < 0xF0)
+    {
+        count = 2;
+        character &= 0x0F;
+    }
+    else if (character >= 0xC0 && character < 0xE0)
+    {
+        count = 1;
+        character &= 0x1F;
+    }
+
+    *extraBytes = 0;
+    if (count == 0 || count >= length)
+        return bytes[0];
+    for (unsigned int i = 1; i <= count; ++i)
+    {
+        if ((bytes[i] & 0xC0) != 0x80)
+            return bytes[0];
+        character = (character << 6) | (bytes[i] & 0x3F);
+    }
+    *extraBytes = count;
+    return character;
+}
+
 Font::Font() :
-    _format(BITMAP), _style(PLAIN), _size(0), _spacing(0.0f), _glyphs(NULL), _glyphCount(0), _texture(NULL), _batch(NULL), _cutoffParam(NULL)
+    _format(BITMAP), _style(PLAIN), _size(0), _spacing(0.0f), _glyphs(NULL), _glyphCount(0), _texture(NULL), _batch(NULL), _cutoffParam(NULL), _glyphCache(NULL), _layoutClock(0)
 {
 }
 
 Font::~Font()
 {
-    // Remove this Font from the font cache.
-    std::vector<Font*>::iterator itr = std::find(__fontCache.begin(), __fontCache.end(), this);
-    if (itr != __fontCache.end())
+    // Remove this Font from the font cache, where it is kept under the ID it was requested with.
+    __fontCache.remove(_path.c_str(), this);
+    __fontCache.remove(_path.c_str(), this, _id.c_str());
+
+    for (size_t i = 0, count = _layouts.size(); i < count; ++i)
     {
-        __fontCache.erase(itr);
+        SAFE_DELETE(_layouts[i].layout);
     }
-
     SAFE_DELETE(_batch);
     SAFE_DELETE_ARRAY(_glyphs);
     SAFE_RELEASE(_texture);
+    SAFE_RELEASE(_glyphCache);
 
     // Free child fonts
     for (size_t i = 0, count = _sizes.size(); i < count; ++i)
@@ -42,21 +93,52 @@ Font::~Font()
     }
 }
 
+ResourceCache* Font::getCache()
+{
+    return &__fontCache;
+}
+
 Font* Font::create(const char* path, const char* id)
 {
     GP_ASSERT(path);
 
     // Search the font cache for a font with the given path and ID.
-    for (size_t i = 0, count = __fontCache.size(); i < count; ++i)
+    Font* f = static_cast<Font*>(__fontCache.find(path, id));
+    if (f)
+    {
+        // Found a match.
+        f->addRef();
+        return f;
+    }
+
+    // Font files are not loaded from a bundle; their glyphs are rasterized as they are needed.
+    std::string ext = FileSystem::getExtension(path);
+    if (ext == ".TTF" || ext == ".OTF")
     {
-        Font* f = __fontCache[i];
-        GP_ASSERT(f);
-        if (f->_path == path && (id == NULL || f->_id == id))
+        GlyphCache::Rasterizer* rasterizer = GlyphCache::Rasterizer::create(path);
+        if (rasterizer == NULL)
+            return NULL;
+        GlyphCache* cache = GlyphCache::create(rasterizer, FONT_DYNAMIC_DEFAULT_SIZE);
+        SAFE_RELEASE(rasterizer);
+        if (cache == NULL)
+            return NULL;
+
+        std::string family(path);
+        size_t slash = family.find_last_of("/\\");
+        if (slash != std::string::npos)
+            family = family.substr(slash + 1);
+        family = family.substr(0, family.length() - ext.length());
+
+        Font* font = create(family.c_str(), cache);
+        SAFE_RELEASE(cache);
+        if (font)
         {
-            // Found a match.
-            f->addRef();
-            return f;
+            font->_path = path;
+            if (id)
+                font->_id = id;
+            __fontCache.add(path, font, (size_t)font->_texture->getWidth() * font->_texture->getHeight(), id);
         }
+        return font;
     }
 
     // Load the bundle.
@@ -89,8 +171,11 @@ Font* Font::create(const char* path, const char* id)
 
     if (font)
     {
-        // Add this font to the cache.
-        __fontCache.push_back(font);
+        // Add this font to the cache, counting the memory of its glyphs and its (single channel) glyph texture.
+        size_t size = sizeof(Glyph) * font->_glyphCount;
+        if (font->_texture)
+            size += (size_t)font->_texture->getWidth() * font->_texture->getHeight();
+        __fontCache.add(path, font, size, id);
     }
 
     SAFE_RELEASE(bundle);
@@ -159,6 +244,66 @@ Font* Font::create(const char* family, Style style, unsigned int size, Glyph* gl
     return font;
 }
 
+Font* Font::create(const char* family, GlyphCache* cache)
+{
+    GP_ASSERT(family);
+    GP_ASSERT(cache);
+
+    // The space is kept as the first glyph, like in the fonts of bundles, since its advance is used for spaces and tabs.
+    Glyph space;
+    const Glyph* glyph = cache->getGlyph(' ');
+    if (glyph)
+    {
+        space = *glyph;
+    }
+    else
+    {
+        memset(&space, 0, sizeof(space));
+        space.code = ' ';
+        space.advance = cache->getSize() / 4;
+    }
+
+    Font* font = create(family, PLAIN, cache->getSize(), &space, 1, cache->getTexture(), BITMAP);
+    if (font == NULL)
+        return NULL;
+
+    // The glyph texture has no mipmaps, since glyphs are rasterized into it while it is used.
+    font->_batch->getSampler()->setFilterMode(Texture::LINEAR, Texture::LINEAR);
+    font->_glyphCache = cache;
+    cache->addRef();
+
+    return font;
+}
+
+Font* Font::addDynamicSize(unsigned int size)
+{
+    GP_ASSERT(_glyphCache);
+
+    GlyphCache* cache = GlyphCache::create(_glyphCache->_rasterizer, size);
+    if (cache == NULL)
+        return NULL;
+
+    Font* font = create(_family.c_str(), cache);
+    SAFE_RELEASE(cache);
+    if (font)
+    {
+        font->_path = _path;
+        font->_id = _id;
+        font->_spacing = _spacing;
+        _sizes.push_back(font);
+    }
+    return font;
+}
+
+const Font::Glyph* Font::getGlyph(int character)
+{
+    if (_glyphCache)
+        return _glyphCache->getGlyph(character);
+
+    int index = character - 32; // HACK for ASCII
+    return (index >= 0 && index < (int)_glyphCount) ? &_glyphs[index] : NULL;
+}
+
 unsigned int Font::getSize(unsigned int index) const
 {
     GP_ASSERT(index <= _sizes.size());
@@ -179,7 +324,9 @@ Font::Format Font::getFormat()
 
 bool Font::isCharacterSupported(int character) const
 {
-    // TODO: Update this once we support unicode fonts
+    if (_glyphCache)
+        return _glyphCache->getGlyph(character) != NULL;
+
     int glyphIndex = character - 32; // HACK for ASCII
     return (glyphIndex >= 0 && glyphIndex < (int)_glyphCount);
 }
@@ -205,6 +352,10 @@ void Font::lazyStart()
     }
 
     _batch->start();
+
+    // The glyphs drawn by the batch must stay in the glyph cache until it is finished.
+    if (_glyphCache)
+        _glyphCache->startBatch();
 }
 
 void Font::finish()
@@ -212,17 +363,34 @@ void Font::finish()
     // Finish any font batches that have been started
     if (_batch->isStarted())
         _batch->finish();
+    if (_glyphCache)
+        _glyphCache->finishBatch();
 
     for (size_t i = 0, count = _sizes.size(); i < count; ++i)
     {
         SpriteBatch* batch = _sizes[i]->_batch;
         if (batch->isStarted())
             batch->finish();
+        if (_sizes[i]->_glyphCache)
+            _sizes[i]->_glyphCache->finishBatch();
     }
 }
 
 Font* Font::findClosestSize(int size)
 {
+    // Distance field glyphs scale without losing their edges, so text of every size is drawn
+    // with the glyphs of the largest size, which keeps all of it in one batch.
+    if (_format == DISTANCE_FIELD)
+    {
+        Font* largest = this;
+        for (size_t i = 0, count = _sizes.size(); i < count; ++i)
+        {
+            if (_sizes[i]->_size > largest->_size)
+                largest = _sizes[i];
+        }
+        return largest;
+    }
+
     if (size == (int)_size)
         return this;
 
@@ -239,6 +407,14 @@ Font* Font::findClosestSize(int size)
         }
     }
 
+    // Fonts whose glyphs are rasterized as needed add the size, rather than scaling the glyphs of another one.
+    if (diff != 0 && _glyphCache && size > 0 && _sizes.size() < FONT_DYNAMIC_MAX_SIZES)
+    {
+        Font* f = addDynamicSize((unsigned int)size);
+        if (f)
+            return f;
+    }
+
     return closest;
 }
 
@@ -331,14 +507,16 @@ void Font::drawText(const char* text, int x, int y, const Vector4& color, unsign
         GP_ASSERT(_batch);
         for (size_t i = startIndex; i < length; i += (size_t)iteration)
         {
-            char c = 0;
+            int c = 0;
             if (rightToLeft)
             {
-                c = cursor[i];
+                c = (unsigned char)cursor[i];
             }
             else
             {
-                c = text[i];
+                unsigned int extraBytes;
+                c = decodeCharacter(text + i, length - i, &extraBytes);
+                i += extraBytes;
             }
 
             // Draw this character.
@@ -356,10 +534,9 @@ void Font::drawText(const char* text, int x, int y, const Vector4& color, unsign
                 xPos += _glyphs[0].advance * 4;
                 break;
             default:
-                int index = c - 32; // HACK for ASCII
-                if (index >= 0 && index < (int)_glyphCount)
+                const Glyph* g = getGlyph(c);
+                if (g)
                 {
-                    Glyph& g = _glyphs[index];
 
                     if (getFormat() == DISTANCE_FIELD )
                     {
@@ -368,8 +545,8 @@ void Font::drawText(const char* text, int x, int y, const Vector4& color, unsign
                         // TODO: Fix me so that smaller font are much smoother
                         _cutoffParam->setVector2(Vector2(1.0, 1.0));
                     }
-                    _batch->draw(xPos + (int)(g.bearingX * scale), yPos, g.width * scale, size, g.uvs[0], g.uvs[1], g.uvs[2], g.uvs[3], color);
-                    xPos += floor(g.advance * scale + spacing);
+                    _batch->draw(xPos + (int)(g->bearingX * scale), yPos, g->width * scale, size, g->uvs[0], g->uvs[1], g->uvs[2], g->uvs[3], color);
+                    xPos += floor(g->advance * scale + spacing);
                     break;
                 }
                 break;
@@ -412,20 +589,137 @@ void Font::drawText(const char* text, const Rectangle& area, const Vector4& colo
         }
     }
 
+    TextLayout* layout = findLayout(text, area, size, justify, wrap, rightToLeft, clip);
+    prepareLayout(layout, text, area, color, size, justify, wrap, rightToLeft, clip);
+    drawLayout(layout);
+}
+
+void Font::drawText(TextLayout* layout, const char* text, const Rectangle& area, const Vector4& color, unsigned int size, Justify justify,
+                    bool wrap, bool rightToLeft, const Rectangle& clip)
+{
+    GP_ASSERT(layout);
+    GP_ASSERT(text);
+    GP_ASSERT(_size);
+
+    if (size == 0)
+    {
+        size = _size;
+    }
+    else
+    {
+        // Delegate to closest sized font
+        Font* f = findClosestSize(size);
+        if (f != this)
+        {
+            f->drawText(layout, text, area, color, size, justify, wrap, rightToLeft, clip);
+            return;
+        }
+    }
+
+    // The glyph quads of another font cannot be reused.
+    if (layout->_font != this)
+    {
+        layout->invalidate();
+        SAFE_RELEASE(layout->_font);
+        layout->_font = this;
+        addRef();
+    }
+    prepareLayout(layout, text, area, color, size, justify, wrap, rightToLeft, clip);
+    drawLayout(layout);
+}
+
+TextLayout* Font::findLayout(const char* text, const Rectangle& area, unsigned int size, Justify justify, bool wrap, bool rightToLeft, const Rectangle& clip)
+{
+    ++_layoutClock;
+    CachedLayout* oldest = NULL;
+    for (size_t i = 0, count = _layouts.size(); i < count; ++i)
+    {
+        CachedLayout& cached = _layouts[i];
+        if (cached.layout->matches(text, area, size, justify, wrap, rightToLeft, clip))
+        {
+            cached.lastUse = _layoutClock;
+            return cached.layout;
+        }
+        if (!oldest || cached.lastUse < oldest->lastUse)
+            oldest = &cached;
+    }
+
+    // Replace the layout that was used the longest time ago once the cache is full.
+    if (_layouts.size() >= FONT_LAYOUT_CACHE_SIZE)
+    {
+        GP_ASSERT(oldest);
+        oldest->lastUse = _layoutClock;
+        oldest->layout->invalidate();
+        return oldest->layout;
+    }
+    CachedLayout cached;
+    cached.layout = new TextLayout();
+    cached.lastUse = _layoutClock;
+    _layouts.push_back(cached);
+    return cached.layout;
+}
+
+void Font::prepareLayout(TextLayout* layout, const char* text, const Rectangle& area, const Vector4& color, unsigned int size, Justify justify,
+                         bool wrap, bool rightToLeft, const Rectangle& clip)
+{
+    GP_ASSERT(layout);
+
+    // The quads of glyphs that have been evicted from the glyph cache since the text was laid out are stale.
+    unsigned int generation = _glyphCache ? _glyphCache->getGeneration() : 0;
+    if (layout->_generation == generation && layout->matches(text, area, size, justify, wrap, rightToLeft, clip) &&
+        layout->update(area, clip, color))
+        return;
+
+    // Start the batch first, so that the glyphs that are looked up are not evicted before they are drawn.
+    if (_glyphCache)
+        lazyStart();
+
+    layout->reset(text, area, color, size, justify, wrap, rightToLeft, clip);
+    layoutText(layout, text, area, color, size, justify, wrap, rightToLeft, clip);
+    layout->buildIndices();
+    layout->_generation = _glyphCache ? _glyphCache->getGeneration() : 0;
+}
+
+void Font::drawLayout(TextLayout* layout)
+{
+    GP_ASSERT(layout);
+    GP_ASSERT(_batch);
+
     lazyStart();
+    if (getFormat() == DISTANCE_FIELD)
+    {
+        if (_cutoffParam == NULL)
+            _cutoffParam = _batch->getMaterial()->getParameter("u_cutoff");
+        // TODO: Fix me so that smaller font are much smoother
+        _cutoffParam->setVector2(Vector2(1.0, 1.0));
+    }
+    if (_glyphCache)
+    {
+        // Keep the glyphs of the quads in the glyph cache until the batch is finished.
+        for (size_t i = 0, count = layout->_vertices.size(); i < count; i += 4)
+            _glyphCache->touch(layout->_vertices[i].u, layout->_vertices[i].v);
+    }
+    layout->draw(_batch);
+}
+
+void Font::layoutText(TextLayout* layout, const char* text, const Rectangle& area, const Vector4& color, unsigned int size, Justify justify,
+                      bool wrap, bool rightToLeft, const Rectangle& clip)
+{
+    GP_ASSERT(layout);
 
+    const bool clipped = (clip != Rectangle(0, 0, 0, 0));
     float scale = (float)size / _size;
     int spacing = (int)(size * _spacing);
     int yPos = area.y;
     const float areaHeight = area.height - size;
-    std::vector<int> xPositions;
-    std::vector<unsigned int> lineLengths;
+    std::vector<int, FrameAllocator<int> > xPositions;
+    std::vector<unsigned int, FrameAllocator<unsigned int> > lineLengths;
 
     getMeasurementInfo(text, area, size, justify, wrap, rightToLeft, &xPositions, &yPos, &lineLengths);
 
     // Now we have the info we need in order to render.
     int xPos = area.x;
-    std::vector<int>::const_iterator xPositionsIt = xPositions.begin();
+    std::vector<int, FrameAllocator<int> >::const_iterator xPositionsIt = xPositions.begin();
     if (xPositionsIt != xPositions.end())
     {
         xPos = *xPositionsIt++;
@@ -436,7 +730,7 @@ void Font::drawText(const char* text, const Rectangle& area, const Vector4& colo
     unsigned int lineLength;
     unsigned int currentLineLength = 0;
     const char* lineStart;
-    std::vector<unsigned int>::const_iterator lineLengthsIt;
+    std::vector<unsigned int, FrameAllocator<unsigned int> >::const_iterator lineLengthsIt;
     if (rightToLeft)
     {
         lineStart = token;
@@ -507,14 +801,18 @@ void Font::drawText(const char* text, const Rectangle& area, const Vector4& colo
         GP_ASSERT(_batch);
         for (int i = startIndex; i < (int)tokenLength && i >= 0; i += iteration)
         {
-            char c = token[i];
-            int glyphIndex = c - 32; // HACK for ASCII
-
-            if (glyphIndex >= 0 && glyphIndex < (int)_glyphCount)
+            int c = (unsigned char)token[i];
+            if (iteration > 0)
             {
-                Glyph& g = _glyphs[glyphIndex];
+                unsigned int extraBytes;
+                c = decodeCharacter(token + i, tokenLength - i, &extraBytes);
+                i += extraBytes;
+            }
 
-                if (xPos + (int)(g.advance*scale) > area.x + area.width)
+            const Glyph* g = getGlyph(c);
+            if (g)
+            {
+                if (xPos + (int)(g->advance*scale) > area.x + area.width)
                 {
                     // Truncate this line and go on to the next one.
                     truncated = true;
@@ -522,27 +820,23 @@ void Font::drawText(const char* text, const Rectangle& area, const Vector4& colo
                 }
                 else if (xPos >= (int)area.x)
                 {
-                    // Draw this character.
+                    // Add the quad of this character.
                     if (draw)
                     {
-                        if (getFormat() == DISTANCE_FIELD)
+                        float x = (float)(xPos + (int)(g->bearingX * scale));
+                        float y = (float)yPos;
+                        float width = g->width * scale;
+                        float height = (float)size;
+                        float u1 = g->uvs[0], v1 = g->uvs[1], u2 = g->uvs[2], v2 = g->uvs[3];
+                        if (!clipped || _batch->clipSprite(clip, x, y, width, height, u1, v1, u2, v2))
                         {
-                            if (_cutoffParam == NULL)
-                                _cutoffParam = _batch->getMaterial()->getParameter("u_cutoff");
-                            // TODO: Fix me so that smaller font are much smoother
-                            _cutoffParam->setVector2(Vector2(1.0, 1.0));
-                        }
-                        if (clip != Rectangle(0, 0, 0, 0))
-                        {
-                            _batch->draw(xPos + (int)(g.bearingX * scale), yPos, g.width * scale, size, g.uvs[0], g.uvs[1], g.uvs[2], g.uvs[3], color, clip);
-                        }
-                        else
-                        {
-                            _batch->draw(xPos + (int)(g.bearingX * scale), yPos, g.width * scale, size, g.uvs[0], g.uvs[1], g.uvs[2], g.uvs[3], color);
+                            size_t first = layout->_vertices.size();
+                            layout->_vertices.resize(first + 4);
+                            _batch->addSprite(x, y, width, height, u1, v1, u2, v2, color, &layout->_vertices[first]);
                         }
                     }
                 }
-                xPos += (int)(g.advance)*scale + spacing;
+                xPos += (int)(g->advance)*scale + spacing;
             }
         }
 
@@ -707,8 +1001,8 @@ void Font::measureText(const char* text, const Rectangle& clip, unsigned int siz
     }
 
     const char* token = text;
-    std::vector<bool> emptyLines;
-    std::vector<Vector2> lines;
+    std::vector<bool, FrameAllocator<bool> > emptyLines;
+    std::vector<Vector2, FrameAllocator<Vector2> > lines;
 
     unsigned int lineWidth = 0;
     int yPos = clip.y + size;
@@ -1013,7 +1307,7 @@ void Font::measureText(const char* text, const Rectangle& clip, unsigned int siz
 }
 
 void Font::getMeasurementInfo(const char* text, const Rectangle& area, unsigned int size, Justify justify, bool wrap, bool rightToLeft,
-        std::vector<int>* xPositions, int* yPosition, std::vector<unsigned int>* lineLengths)
+        std::vector<int, FrameAllocator<int> >* xPositions, int* yPosition, std::vector<unsigned int, FrameAllocator<unsigned int> >* lineLengths)
 {
     GP_ASSERT(_size);
     GP_ASSERT(text);
@@ -1249,13 +1543,13 @@ int Font::getIndexOrLocation(const char* text, const Rectangle& area, unsigned i
     int spacing = (int)(size * _spacing);
     int yPos = area.y;
     const float areaHeight = area.height - size;
-    std::vector<int> xPositions;
-    std::vector<unsigned int> lineLengths;
+    std::vector<int, FrameAllocator<int> > xPositions;
+    std::vector<unsigned int, FrameAllocator<unsigned int> > lineLengths;
 
     getMeasurementInfo(text, area, size, justify, wrap, rightToLeft, &xPositions, &yPos, &lineLengths);
 
     int xPos = area.x;
-    std::vector<int>::const_iterator xPositionsIt = xPositions.begin();
+    std::vector<int, FrameAllocator<int> >::const_iterator xPositionsIt = xPositions.begin();
     if (xPositionsIt != xPositions.end())
     {
         xPos = *xPositionsIt++;
@@ -1267,7 +1561,7 @@ int Font::getIndexOrLocation(const char* text, const Rectangle& area, unsigned i
     unsigned int lineLength;
     unsigned int currentLineLength = 0;
     const char* lineStart;
-    std::vector<unsigned int>::const_iterator lineLengthsIt;
+    std::vector<unsigned int, FrameAllocator<unsigned int> >::const_iterator lineLengthsIt;
     if (rightToLeft)
     {
         lineStart = token;
@@ -1356,14 +1650,10 @@ int Font::getIndexOrLocation(const char* text, const Rectangle& area, unsigned i
         GP_ASSERT(_glyphs);
         for (int i = startIndex; i < (int)tokenLength && i >= 0; i += iteration)
         {
-            char c = token[i];
-            int glyphIndex = c - 32; // HACK for ASCII
-
-            if (glyphIndex >= 0 && glyphIndex < (int)_glyphCount)
+            const Glyph* g = getGlyph((unsigned char)token[i]);
+            if (g)
             {
-                Glyph& g = _glyphs[glyphIndex];
-
-                if (xPos + (int)(g.advance*scale) > area.x + area.width)
+                if (xPos + (int)(g->advance*scale) > area.x + area.width)
                 {
                     // Truncate this line and go on to the next one.
                     truncated = true;
@@ -1373,7 +1663,7 @@ int Font::getIndexOrLocation(const char* text, const Rectangle& area, unsigned i
                 // Check against inLocation.
                 if (destIndex == (int)charIndex ||
                     (destIndex == -1 &&
-                    inLocation.x >= xPos && inLocation.x < floor(xPos + g.width*scale + spacing) &&
+                    inLocation.x >= xPos && inLocation.x < floor(xPos + g->width*scale + spacing) &&
                     inLocation.y >= yPos && inLocation.y < yPos + size))
                 {
                     outLocation->x = xPos;
@@ -1381,7 +1671,7 @@ int Font::getIndexOrLocation(const char* text, const Rectangle& area, unsigned i
                     return charIndex;
                 }
 
-                xPos += floor(g.advance*scale + spacing);
+                xPos += floor(g->advance*scale + spacing);
                 charIndex++;
             }
         }
@@ -1480,7 +1770,9 @@ unsigned int Font::getTokenWidth(const char* token, unsigned int length, unsigne
     unsigned int tokenWidth = 0;
     for (unsigned int i = 0; i < length; ++i)
     {
-        char c = token[i];
+        unsigned int extraBytes;
+        int c = decodeCharacter(token + i, length - i, &extraBytes);
+        i += extraBytes;
         switch (c)
         {
         case ' ':
@@ -1490,11 +1782,10 @@ unsigned int Font::getTokenWidth(const char* token, unsigned int length, unsigne
             tokenWidth += _glyphs[0].advance * 4;
             break;
         default:
-            int glyphIndex = c - 32;
-            if (glyphIndex >= 0 && glyphIndex < (int)_glyphCount)
+            const Glyph* g = getGlyph(c);
+            if (g)
             {
-                Glyph& g = _glyphs[glyphIndex];
-                tokenWidth += floor(g.advance * scale + spacing);
+                tokenWidth += floor(g->advance * scale + spacing);
             }
             break;
         }
@@ -1528,7 +1819,7 @@ unsigned int Font::getReversedTokenLength(const char* token, const char* bufStar
 }
 
 int Font::handleDelimiters(const char** token, const unsigned int size, const int iteration, const int areaX, int* xPos, int* yPos, unsigned int* lineLength,
-                          std::vector<int>::const_iterator* xPositionsIt, std::vector<int>::const_iterator xPositionsEnd, unsigned int* charIndex,
+                          std::vector<int, FrameAllocator<int> >::const_iterator* xPositionsIt, std::vector<int, FrameAllocator<int> >::const_iterator xPositionsEnd, unsigned int* charIndex,
                           const Vector2* stopAtPosition, const int currentIndex, const int destIndex)
 {
     GP_ASSERT(token);
@@ -1611,7 +1902,7 @@ int Font::handleDelimiters(const char** token, const unsigned int size, const in
 }
 
 void Font::addLineInfo(const Rectangle& area, int lineWidth, int lineLength, Justify hAlign,
-                       std::vector<int>* xPositions, std::vector<unsigned int>* lineLengths, bool rightToLeft)
+                       std::vector<int, FrameAllocator<int> >* xPositions, std::vector<unsigned int, FrameAllocator<unsigned int> >* lineLengths, bool rightToLeft)
 {
     int hWhitespace = area.width - lineWidth;
     if (hAlign == ALIGN_HCENTER)
@@ -2,10 +2,15 @@
 #define FONT_H_
 
 #include "SpriteBatch.h"
+#include "FrameArena.h"
 
 namespace gameplay
 {
 
+class ResourceCache;
+class TextLayout;
+class GlyphCache;
+
 /**
  * Defines a font for text rendering.
  */
@@ -14,6 +19,7 @@ class Font : public Ref
     friend class Bundle;
     friend class Text;
     friend class TextBox;
+    friend class GlyphCache;
 
 public:
 
@@ -52,6 +58,10 @@ public:
 
     /**
      * Defines the format of the font.
+     *
+     * The glyphs of a distance field font are drawn at any size from the largest size in
+     * the font, where the shader keeps their edges sharp, so text of different sizes that
+     * uses the font is drawn with a single sprite batch.
      */
     enum Format
     {
@@ -69,7 +79,13 @@ public:
      * If a font for the given path has already been loaded, the existing font will be
      * returned with its reference count increased.
      *
-     * @param path The path to a bundle file containing a font resource.
+     * The path may also be a TrueType (.ttf) or OpenType (.otf) font file when the runtime
+     * is built with GP_USE_FREETYPE. The glyphs of such a font are rasterized as they are
+     * first drawn (see GlyphCache), and drawing text at a size that the font was not created
+     * with adds that size, so text is drawn without scaling glyphs. Text drawn with these
+     * fonts is decoded as UTF-8.
+     *
+     * @param path The path to a bundle file containing a font resource, or to a font file.
      * @param id An optional ID of the font resource within the bundle (NULL for the first/only resource).
      *
      * @return The specified Font or NULL if there was an error.
@@ -77,6 +93,14 @@ public:
      */
     static Font* create(const char* path, const char* id = NULL);
 
+    /**
+     * Returns the cache of the fonts that were created from bundles.
+     *
+     * @return The font cache.
+     * @script{ignore}
+     */
+    static ResourceCache* getCache();
+
     /**
      * Gets the font size (max height of glyphs) in pixels, at the specified index.
      *
@@ -157,6 +181,25 @@ public:
                   Justify justify = ALIGN_TOP_LEFT, bool wrap = true, bool rightToLeft = false,
                   const Rectangle& clip = Rectangle(0, 0, 0, 0));
 
+    /**
+     * Draws the specified text within a rectangular area, reusing the glyph quads of a layout for
+     * as long as the text and the way it is laid out do not change.
+     *
+     * @param layout The layout to keep the glyph quads of the text in.
+     * @param text The text to draw.
+     * @param area The viewport area to draw within.  Text will be clipped outside this rectangle.
+     * @param color The color of text.
+     * @param size The size to draw text (0 for default size).
+     * @param justify Justification of text within the viewport.
+     * @param wrap Wraps text to fit within the width of the viewport if true.
+     * @param rightToLeft Whether to draw text from right to left.
+     * @param clip A region to clip text within after applying justification to the viewport area.
+     * @script{ignore}
+     */
+    void drawText(TextLayout* layout, const char* text, const Rectangle& area, const Vector4& color, unsigned int size = 0,
+                  Justify justify = ALIGN_TOP_LEFT, bool wrap = true, bool rightToLeft = false,
+                  const Rectangle& clip = Rectangle(0, 0, 0, 0));
+
     /**
      * Finishes text batching for this font and renders all drawn text.
      */
@@ -312,8 +355,30 @@ private:
      */
     static Font* create(const char* family, Style style, unsigned int size, Glyph* glyphs, int glyphCount, Texture* texture, Font::Format format);
 
+    /**
+     * Creates a font whose glyphs are rasterized into a glyph cache as they are needed.
+     *
+     * @param family The font family name.
+     * @param cache The glyph cache of the font size, which the font keeps a reference to.
+     *
+     * @return The new Font or NULL if there was an error.
+     */
+    static Font* create(const char* family, GlyphCache* cache);
+
+    /**
+     * Adds a size to a font whose glyphs are rasterized as they are needed.
+     *
+     * @return The font of the size, or NULL if it could not be created.
+     */
+    Font* addDynamicSize(unsigned int size);
+
+    /**
+     * Returns the glyph of a character, or NULL if the font has no glyph for it.
+     */
+    const Glyph* getGlyph(int character);
+
     void getMeasurementInfo(const char* text, const Rectangle& area, unsigned int size, Justify justify, bool wrap, bool rightToLeft,
-                            std::vector<int>* xPositions, int* yPosition, std::vector<unsigned int>* lineLengths);
+                            std::vector<int, FrameAllocator<int> >* xPositions, int* yPosition, std::vector<unsigned int, FrameAllocator<unsigned int> >* lineLengths);
 
     int getIndexOrLocation(const char* text, const Rectangle& clip, unsigned int size, const Vector2& inLocation, Vector2* outLocation,
                            const int destIndex = -1, Justify justify = ALIGN_TOP_LEFT, bool wrap = true, bool rightToLeft = false);
@@ -323,16 +388,36 @@ private:
     unsigned int getReversedTokenLength(const char* token, const char* bufStart);
 
     int handleDelimiters(const char** token, const unsigned int size, const int iteration, const int areaX, int* xPos, int* yPos, unsigned int* lineLength,
-                         std::vector<int>::const_iterator* xPositionsIt, std::vector<int>::const_iterator xPositionsEnd, unsigned int* charIndex = NULL,
+                         std::vector<int, FrameAllocator<int> >::const_iterator* xPositionsIt, std::vector<int, FrameAllocator<int> >::const_iterator xPositionsEnd, unsigned int* charIndex = NULL,
                          const Vector2* stopAtPosition = NULL, const int currentIndex = -1, const int destIndex = -1);
 
     void addLineInfo(const Rectangle& area, int lineWidth, int lineLength, Justify hAlign,
-                     std::vector<int>* xPositions, std::vector<unsigned int>* lineLengths, bool rightToLeft);
+                     std::vector<int, FrameAllocator<int> >* xPositions, std::vector<unsigned int, FrameAllocator<unsigned int> >* lineLengths, bool rightToLeft);
 
     Font* findClosestSize(int size);
 
     void lazyStart();
 
+    /**
+     * A layout that the font keeps for text drawn without one.
+     */
+    struct CachedLayout
+    {
+        TextLayout* layout;
+        unsigned int lastUse;
+    };
+
+    TextLayout* findLayout(const char* text, const Rectangle& area, unsigned int size, Justify justify, bool wrap, bool rightToLeft,
+                           const Rectangle& clip);
+
+    void prepareLayout(TextLayout* layout, const char* text, const Rectangle& area, const Vector4& color, unsigned int size,
+                       Justify justify, bool wrap, bool rightToLeft, const Rectangle& clip);
+
+    void drawLayout(TextLayout* layout);
+
+    void layoutText(TextLayout* layout, const char* text, const Rectangle& area, const Vector4& color, unsigned int size,
+                    Justify justify, bool wrap, bool rightToLeft, const Rectangle& clip);
+
     Format _format;
     std::string _path;
     std::string _id;
@@ -347,6 +432,9 @@ private:
     SpriteBatch* _batch;
     Rectangle _viewport;
     MaterialParameter* _cutoffParam;
+    std::vector<CachedLayout> _layouts;
+    GlyphCache* _glyphCache;
+    unsigned int _layoutClock;
 };
 
 }
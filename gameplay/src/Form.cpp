@@ -9,6 +9,9 @@
 #include "Button.h"
 #include "CheckBox.h"
 #include "Scene.h"
+#include "Image.h"
+#include "Texture.h"
+#include "ResourceCache.h"
 
 // Scroll speed when using a joystick.
 static const float GAMEPAD_SCROLL_SPEED = 600.0f;
@@ -42,7 +45,29 @@ struct FormInit
 };
 static FormInit __init;
 
-Form::Form() : Drawable(), _batched(true)
+// Collects the paths of the PNG images of the image controls in a form, so that they can be decoded together.
+static void collectImages(Properties* properties, std::vector<std::string>* paths)
+{
+    Properties* controlSpace;
+    while ((controlSpace = properties->getNextNamespace()) != NULL)
+    {
+        std::string path;
+        const char* controlName = controlSpace->getNamespace();
+        if ((strcmpnocase(controlName, "image") == 0 || strcmpnocase(controlName, "imagecontrol") == 0) &&
+            controlSpace->getPath("path", &path) && !Texture::getCache()->find(path.c_str()) &&
+            std::find(paths->begin(), paths->end(), path) == paths->end())
+        {
+            const char* ext = strrchr(path.c_str(), '.');
+            if (ext && strcmpnocase(ext, ".png") == 0)
+                paths->push_back(path);
+        }
+        collectImages(controlSpace, paths);
+    }
+    properties->rewind();
+}
+
+Form::Form() : Drawable(), _batched(true), _layoutDirty(true), _cached(false), _frameBuffer(NULL), _frameBatch(NULL),
+    _redrawAll(true), _drawingRegion(false)
 {
 }
 
@@ -54,6 +79,9 @@ Form::~Form()
     {
         __forms.erase(it);
     }
+
+    SAFE_DELETE(_frameBatch);
+    SAFE_RELEASE(_frameBuffer);
 }
 
 Form* Form::create(const char* url)
@@ -102,10 +130,34 @@ Form* Form::create(const char* url)
     }
 
     form->_batched = formProperties->getBool("batchingEnabled", true);
+    form->_cached = formProperties->getBool("cachingEnabled", false);
+
+    // Decode the images of the form in parallel and create their textures up front, so that
+    // the image controls find them in the texture cache.
+    std::vector<std::string> paths;
+    collectImages(formProperties, &paths);
+    std::vector<Image*> images;
+    Image::createBatch(paths, &images);
+    std::vector<Texture*> textures;
+    for (size_t i = 0, count = images.size(); i < count; ++i)
+    {
+        if (images[i])
+        {
+            Texture* texture = Texture::createCached(paths[i].c_str(), images[i]);
+            if (texture)
+                textures.push_back(texture);
+            SAFE_RELEASE(images[i]);
+        }
+    }
 
     // Initialize the form and all of its child controls
     form->initialize("Form", style, formProperties);
 
+    for (size_t i = 0, count = textures.size(); i < count; ++i)
+    {
+        SAFE_RELEASE(textures[i]);
+    }
+
     // Release the theme: its lifetime is controlled by addRef() and release() calls in initialize (above) and ~Control.
     if (theme != Theme::getDefault())
     {
@@ -200,11 +252,54 @@ void Form::update(float elapsedTime)
 {
     Container::update(elapsedTime);
 
+    // The bounds only need updating when a control is dirty.
+    if (!_layoutDirty)
+        return;
+    _layoutDirty = false;
+
     // Do a two-pass bounds update:
     //  1. First pass updates leaf controls
     //  2. Second pass updates parent controls that depend on child sizes
     if (updateBoundsInternal(Vector2::zero()))
+    {
         updateBoundsInternal(Vector2::zero());
+
+        // Controls have moved, so all of a cached form is drawn again.
+        _redrawAll = true;
+    }
+}
+
+void Form::controlDirty(Control* control, int bits)
+{
+    GP_ASSERT(control);
+
+    if (bits & (DIRTY_BOUNDS | DIRTY_STATE | DIRTY_POSITION))
+        _layoutDirty = true;
+
+    // Draw the form again when the frames are rendered on demand.
+    Game::getInstance()->invalidate();
+
+    if (!_cached || _redrawAll)
+        return;
+
+    const Rectangle& bounds = control->_absoluteClipBounds;
+    if (control == this || bounds.isEmpty())
+    {
+        _redrawAll = true;
+    }
+    else if (_redrawRegion.isEmpty())
+    {
+        _redrawRegion = bounds;
+    }
+    else
+    {
+        Rectangle::combine(_redrawRegion, bounds, &_redrawRegion);
+    }
+}
+
+bool Form::isRegionDrawn(const Rectangle& bounds) const
+{
+    return !_drawingRegion || bounds.intersects(_redrawRegion);
 }
 
 void Form::startBatch(SpriteBatch* batch)
@@ -235,6 +330,7 @@ const Matrix& Form::getProjectionMatrix() const
 
 unsigned int Form::draw(bool wireframe)
 {
+    GP_PROFILE_GPU_SCOPE("Form::draw");
     if (!_visible || _absoluteClipBounds.width == 0 || _absoluteClipBounds.height == 0)
         return 0;
 
@@ -261,6 +357,24 @@ unsigned int Form::draw(bool wireframe)
         Matrix::createOrthographicOffCenter(0, viewport.width, viewport.height, 0, 0, 1, &_projectionMatrix);
     }
 
+    if (_cached)
+    {
+        // Draw the controls into the frame buffer where they changed, and then the frame buffer.
+        unsigned int drawCalls = drawCache();
+        if (_frameBatch)
+        {
+            const float width = _absoluteClipBounds.width;
+            const float height = _absoluteClipBounds.height;
+            Texture* texture = _frameBuffer->getRenderTarget()->getTexture();
+            _frameBatch->setProjectionMatrix(_projectionMatrix);
+            _frameBatch->start();
+            _frameBatch->draw(_absoluteClipBounds.x, _absoluteClipBounds.y, width, height,
+                              0.0f, height / texture->getHeight(), width / texture->getWidth(), 0.0f, Vector4::one());
+            _frameBatch->finish();
+            return drawCalls + 1;
+        }
+    }
+
     // Draw the form
     unsigned int drawCalls = Container::draw(this, _absoluteClipBounds);
 
@@ -276,6 +390,87 @@ unsigned int Form::draw(bool wireframe)
     return drawCalls;
 }
 
+unsigned int Form::drawCache()
+{
+    const unsigned int width = (unsigned int)ceil(_absoluteClipBounds.width);
+    const unsigned int height = (unsigned int)ceil(_absoluteClipBounds.height);
+
+    // Size the frame buffer to the next power of two of the form, so that it is only recreated when the form grows past it.
+    const unsigned int bufferWidth = nextPowerOfTwo(width);
+    const unsigned int bufferHeight = nextPowerOfTwo(height);
+    RenderTarget* target = _frameBuffer ? _frameBuffer->getRenderTarget() : NULL;
+    if (!target || target->getWidth() < width || target->getHeight() < height)
+    {
+        SAFE_DELETE(_frameBatch);
+        SAFE_RELEASE(_frameBuffer);
+        _frameBuffer = FrameBuffer::create(_id.c_str(), bufferWidth, bufferHeight);
+        if (!_frameBuffer || !_frameBuffer->getRenderTarget())
+        {
+            GP_WARN("Failed to create frame buffer for form '%s'; drawing it without caching.", _id.c_str());
+            SAFE_RELEASE(_frameBuffer);
+            _cached = false;
+            return 0;
+        }
+
+        // The colors in the frame buffer are already multiplied by their alpha when controls are blended into it.
+        _frameBatch = SpriteBatch::create(_frameBuffer->getRenderTarget()->getTexture());
+        _frameBatch->getSampler()->setWrapMode(Texture::CLAMP, Texture::CLAMP);
+        _frameBatch->getStateBlock()->setBlendSrc(RenderState::BLEND_ONE);
+        _frameBatch->getStateBlock()->setBlendDst(RenderState::BLEND_ONE_MINUS_SRC_ALPHA);
+        _redrawAll = true;
+    }
+
+    if (!_redrawAll && _redrawRegion.isEmpty())
+        return 0;
+
+    // Draw the controls with a projection that maps the bounds of the form onto the frame buffer.
+    Game* game = Game::getInstance();
+    FrameBuffer* previousFrameBuffer = _frameBuffer->bind();
+    Rectangle previousViewport = game->getViewport();
+    game->setViewport(Rectangle(width, height));
+    Matrix projectionMatrix(_projectionMatrix);
+    Matrix::createOrthographicOffCenter(_absoluteClipBounds.x, _absoluteClipBounds.x + width, _absoluteClipBounds.y + height,
+                                        _absoluteClipBounds.y, 0, 1, &_projectionMatrix);
+
+    // Clear the region that is drawn again, and keep the controls outside of it.
+    _drawingRegion = !_redrawAll;
+    if (_drawingRegion)
+    {
+        Rectangle region;
+        Rectangle::intersect(_redrawRegion, _absoluteClipBounds, &region);
+        int x = (int)floor(region.x - _absoluteClipBounds.x);
+        int y = (int)floor(region.y - _absoluteClipBounds.y);
+        int right = (int)ceil(region.right() - _absoluteClipBounds.x);
+        int bottom = (int)ceil(region.bottom() - _absoluteClipBounds.y);
+        GL_ASSERT( glEnable(GL_SCISSOR_TEST) );
+        GL_ASSERT( glScissor(x, (int)height - bottom, right - x, bottom - y) );
+    }
+    game->clear(Game::CLEAR_COLOR, Vector4::zero(), 1, 0);
+
+    unsigned int drawCalls = Container::draw(this, _absoluteClipBounds);
+    if (_batched)
+    {
+        unsigned int batchCount = _batches.size();
+        for (unsigned int i = 0; i < batchCount; ++i)
+            _batches[i]->finish();
+        _batches.clear();
+        drawCalls = batchCount;
+    }
+
+    if (_drawingRegion)
+    {
+        GL_ASSERT( glDisable(GL_SCISSOR_TEST) );
+        _drawingRegion = false;
+    }
+    _projectionMatrix = projectionMatrix;
+    game->setViewport(previousViewport);
+    previousFrameBuffer->bind();
+
+    _redrawAll = false;
+    _redrawRegion.set(0, 0, 0, 0);
+    return drawCalls;
+}
+
 Drawable* Form::clone(NodeCloneContext& context)
 {
     // TODO:
@@ -292,8 +487,30 @@ void Form::setBatchingEnabled(bool enabled)
     _batched = enabled;
 }
 
+bool Form::isCachingEnabled() const
+{
+    return _cached;
+}
+
+void Form::setCachingEnabled(bool enabled)
+{
+    if (enabled == _cached)
+        return;
+
+    _cached = enabled;
+    _redrawAll = true;
+    _redrawRegion.set(0, 0, 0, 0);
+    if (!enabled)
+    {
+        SAFE_DELETE(_frameBatch);
+        SAFE_RELEASE(_frameBuffer);
+    }
+}
+
 void Form::updateInternal(float elapsedTime)
 {
+    GP_PROFILE_SCOPE("Form::updateInternal");
+
     pollGamepads();
 
     for (size_t i = 0, size = __forms.size(); i < size; ++i)
@@ -382,8 +599,9 @@ Control* Form::findInputControl(Control* control, int x, int y, bool focus, unsi
     }
 
     // If the control has children, search for an input control inside it that also
-    // supports the above conditions.
-    if (control->isContainer())
+    // supports the above conditions. Children are clipped to their container, so
+    // none of them contain the point if the container does not.
+    if (control->isContainer() && control->_absoluteClipBounds.contains(x, y))
     {
         Container* container = static_cast<Container*>(control);
         for (unsigned int i = 0, childCount = container->getControlCount(); i < childCount; ++i)
@@ -641,29 +859,29 @@ bool Form::pointerEventInternal(bool mouse, int evt, int x, int y, int param)
             if (mouse)
             {
                 if (ctrl->mouseEvent((Mouse::MouseEvent)evt, localX, localY, param))
-                    return true;
+                    return inputConsumed(ctrl);
 
                 // Forward to touch event hanlder if unhandled by mouse handler
                 switch (evt)
                 {
                 case Mouse::MOUSE_PRESS_LEFT_BUTTON:
                     if (ctrl->touchEvent(Touch::TOUCH_PRESS, localX, localY, 0))
-                        return true;
+                        return inputConsumed(ctrl);
                     break;
                 case Mouse::MOUSE_RELEASE_LEFT_BUTTON:
                     if (ctrl->touchEvent(Touch::TOUCH_RELEASE, localX, localY, 0))
-                        return true;
+                        return inputConsumed(ctrl);
                     break;
                 case Mouse::MOUSE_MOVE:
                     if (ctrl->touchEvent(Touch::TOUCH_MOVE, localX, localY, 0))
-                        return true;
+                        return inputConsumed(ctrl);
                     break;
                 }
             }
             else
             {
                 if (ctrl->touchEvent((Touch::TouchEvent)evt, localX, localY, contactIndex))
-                    return true;
+                    return inputConsumed(ctrl);
             }
 
             // Handle container scrolling
@@ -710,6 +928,13 @@ bool Form::pointerEventInternal(bool mouse, int evt, int x, int y, int param)
     return false;
 }
 
+bool Form::inputConsumed(Control* control)
+{
+    // Handling the event may have changed how the control looks, without changing its state or bounds.
+    control->setDirty(DIRTY_REDRAW);
+    return true;
+}
+
 bool Form::touchEventInternal(Touch::TouchEvent evt, int x, int y, unsigned int contactIndex)
 {
     return pointerEventInternal(false, evt, x, y, (int)contactIndex);
@@ -762,7 +987,7 @@ bool Form::keyEventInternal(Keyboard::KeyEvent evt, int key)
         if (ctrl->isEnabled() && ctrl->isVisible())
         {
             if (ctrl->keyEvent(evt, key))
-                return true;
+                return inputConsumed(ctrl);
         }
 
         ctrl = ctrl->getParent();
@@ -943,7 +1168,7 @@ bool Form::gamepadButtonEventInternal(Gamepad* gamepad)
         if (ctrl->isEnabled() && ctrl->isVisible())
         {
             if (ctrl->gamepadButtonEvent(gamepad))
-                return true;
+                return inputConsumed(ctrl);
         }
 
         ctrl = ctrl->getParent();
@@ -960,7 +1185,7 @@ bool Form::gamepadTriggerEventInternal(Gamepad* gamepad, unsigned int index)
         if (ctrl->isEnabled() && ctrl->isVisible())
         {
             if (ctrl->gamepadTriggerEvent(gamepad, index))
-                return true;
+                return inputConsumed(ctrl);
         }
 
         ctrl = ctrl->getParent();
@@ -977,7 +1202,7 @@ bool Form::gamepadJoystickEventInternal(Gamepad* gamepad, unsigned int index)
         if (ctrl->isEnabled() && ctrl->isVisible())
         {
             if (ctrl->gamepadJoystickEvent(gamepad, index))
-                return true;
+                return inputConsumed(ctrl);
         }
 
         ctrl = ctrl->getParent();
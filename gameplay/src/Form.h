@@ -31,6 +31,7 @@ class Form : public Drawable, public Container
     friend class Gamepad;
     friend class Control;
     friend class Container;
+    friend class ListView;
 
 public:
 
@@ -140,6 +141,36 @@ public:
      */
     void setBatchingEnabled(bool enabled);
 
+    /**
+     * Determines whether this form caches its drawing between frames.
+     *
+     * @return True if the drawing of the form is cached, false otherwise.
+     * @script{ignore}
+     */
+    bool isCachingEnabled() const;
+
+    /**
+     * Turns caching the drawing of this form on or off.
+     *
+     * A form that caches its drawing draws its controls into a frame buffer of its own, and
+     * then only draws that frame buffer while none of its controls change. When controls
+     * change, only the region that they cover is drawn again, clipped with a scissor, unless
+     * the layout of the form has changed. This suits forms that are static most of the time,
+     * such as menus.
+     *
+     * Controls are drawn again when they are changed through the Control API, when their
+     * state changes or when they handle input. Changes made directly to a shared theme style
+     * are only drawn once a control that uses it changes.
+     *
+     * The frame buffer is composited with premultiplied alpha, so the edges of translucent
+     * controls over a transparent background may look slightly different than when the form
+     * is drawn directly. This can be turned on with 'cachingEnabled = true' in a .form file.
+     *
+     * @param enabled True to cache the drawing of the form, false to draw it every frame (default).
+     * @script{ignore}
+     */
+    void setCachingEnabled(bool enabled);
+
 private:
     
     /**
@@ -241,6 +272,24 @@ private:
      */
     void finishBatch(SpriteBatch* batch);
 
+    /**
+     * Called when dirty bits are set on a control of this form, to lay out or draw it again.
+     */
+    void controlDirty(Control* control, int bits);
+
+    /**
+     * Determines whether a control that covers the given bounds must be drawn, which is only
+     * false while a form that caches its drawing draws a region of it again.
+     */
+    bool isRegionDrawn(const Rectangle& bounds) const;
+
+    /**
+     * Draws the controls of a form that caches its drawing into its frame buffer, where needed.
+     *
+     * @return The number of draw calls issued to draw the controls.
+     */
+    unsigned int drawCache();
+
     /**
      * Unproject a point (from a mouse or touch event) into the scene and then project it onto the form.
      *
@@ -256,6 +305,13 @@ private:
 
     static bool pointerEventInternal(bool mouse, int evt, int x, int y, int param);
 
+    /**
+     * Marks a control that consumed an input event to be drawn again, since handling it may change how it looks.
+     *
+     * @return true.
+     */
+    static bool inputConsumed(Control* control);
+
     static Control* findInputControl(int* x, int* y, bool focus, unsigned int contactIndex);
 
     static Control* findInputControl(Control* control, int x, int y, bool focus, unsigned int contactIndex);
@@ -279,6 +335,13 @@ private:
     Matrix _projectionMatrix;           // Projection matrix to be set on SpriteBatch objects when rendering the form
     std::vector<SpriteBatch*> _batches;
     bool _batched;
+    bool _layoutDirty;                  // Whether a control needs its bounds or state updated
+    bool _cached;                       // Whether the drawing of the form is cached in _frameBuffer
+    FrameBuffer* _frameBuffer;          // Frame buffer that the controls are drawn into when cached
+    SpriteBatch* _frameBatch;           // Batch that draws the frame buffer of the form
+    bool _redrawAll;                    // Whether all of the cached form must be drawn again
+    Rectangle _redrawRegion;            // Region of the cached form that must be drawn again
+    bool _drawingRegion;                // Whether only the controls within _redrawRegion are being drawn
 };
 
 }
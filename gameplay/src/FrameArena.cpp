@@ -0,0 +1,126 @@
+#include "Base.h"
+#include "FrameArena.h"
+#include "MemoryStats.h"
+
+// The size of the header of each chunk, which keeps the memory after it aligned
+#define FRAMEARENA_CHUNK_HEADER 16
+
+#ifdef _MSC_VER
+#define FRAMEARENA_THREAD_LOCAL __declspec(thread)
+#else
+#define FRAMEARENA_THREAD_LOCAL __thread
+#endif
+
+namespace gameplay
+{
+
+// The arenas are kept for the lifetime of the process, like the threads of the job system.
+static FRAMEARENA_THREAD_LOCAL FrameArena* __frameArena = NULL;
+static std::atomic<unsigned int> __frame(0);
+
+static char* alignPointer(char* p, size_t alignment)
+{
+    return (char*)(((size_t)p + alignment - 1) & ~(alignment - 1));
+}
+
+FrameArena::FrameArena()
+    : _chunks(NULL), _current(NULL), _end(NULL), _used(0), _capacity(0), _frame(__frame.load(std::memory_order_relaxed))
+{
+}
+
+FrameArena::~FrameArena()
+{
+    while (_chunks)
+    {
+        Chunk* next = _chunks->next;
+        MemoryStats::remove(MemoryStats::POOLS, FRAMEARENA_CHUNK_HEADER + _chunks->size);
+        delete[] (char*)_chunks;
+        _chunks = next;
+    }
+}
+
+FrameArena* FrameArena::getCurrent()
+{
+    if (__frameArena == NULL)
+        __frameArena = new FrameArena();
+    return __frameArena;
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment)
+{
+    GP_ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    if (_frame != __frame.load(std::memory_order_relaxed))
+        reset();
+
+    char* p = alignPointer(_current, alignment);
+    if (_chunks == NULL || p + size > _end)
+    {
+        addChunk(size + alignment);
+        p = alignPointer(_current, alignment);
+    }
+    _current = p + size;
+    _used += size;
+    return p;
+}
+
+size_t FrameArena::getUsedSize() const
+{
+    return _frame == __frame.load(std::memory_order_relaxed) ? _used : 0;
+}
+
+size_t FrameArena::getCapacity() const
+{
+    return _capacity;
+}
+
+void FrameArena::reset()
+{
+    _frame = __frame.load(std::memory_order_relaxed);
+    _used = 0;
+    if (_chunks == NULL)
+        return;
+
+    if (_chunks->next)
+    {
+        // Replace the chunks with one that holds all of them, so that the next frames
+        // of the same size fit in it.
+        size_t capacity = _capacity;
+        while (_chunks)
+        {
+            Chunk* next = _chunks->next;
+            MemoryStats::remove(MemoryStats::POOLS, FRAMEARENA_CHUNK_HEADER + _chunks->size);
+            delete[] (char*)_chunks;
+            _chunks = next;
+        }
+        _capacity = 0;
+        addChunk(capacity);
+    }
+    else
+    {
+        _current = (char*)_chunks + FRAMEARENA_CHUNK_HEADER;
+        _end = _current + _chunks->size;
+    }
+}
+
+void FrameArena::addChunk(size_t size)
+{
+    if (size < FRAMEARENA_DEFAULT_CHUNK_SIZE)
+        size = FRAMEARENA_DEFAULT_CHUNK_SIZE;
+
+    Chunk* chunk = (Chunk*)new char[FRAMEARENA_CHUNK_HEADER + size];
+    chunk->next = _chunks;
+    chunk->size = size;
+    _chunks = chunk;
+    _current = (char*)chunk + FRAMEARENA_CHUNK_HEADER;
+    _end = _current + size;
+    _capacity += size;
+    MemoryStats::add(MemoryStats::POOLS, FRAMEARENA_CHUNK_HEADER + size);
+}
+
+void FrameArena::nextFrame()
+{
+    __frame.fetch_add(1, std::memory_order_relaxed);
+}
+
+}
@@ -0,0 +1,163 @@
+#ifndef FRAMEARENA_H_
+#define FRAMEARENA_H_
+
+// The default size of the chunks of memory of a frame arena, in bytes
+#define FRAMEARENA_DEFAULT_CHUNK_SIZE (64 * 1024)
+
+namespace gameplay
+{
+
+/**
+ * Defines a linear allocator for the transient memory of a frame.
+ *
+ * Each thread has its own arena, which allocates by advancing an offset into its memory
+ * and never frees single allocations. All of the memory that a thread allocated from its
+ * arena during a frame is reclaimed at once when it first allocates in the next frame, so
+ * the memory is only valid within the frame that it was allocated in. When an arena runs
+ * out of memory it allocates another chunk from the heap, and when it is reset it replaces
+ * its chunks with a single chunk that is large enough for the frame, so that an arena stops
+ * using the heap once it has seen its largest frame.
+ *
+ * Since the arenas don't need to lock, they can be used on the threads of the job system,
+ * but only for work that finishes in the frame that it started in.
+ *
+ * The arena of the calling thread is returned by Game::getFrameArena, and the standard
+ * containers can allocate from it with the FrameAllocator.
+ *
+ * @script{ignore}
+ */
+class FrameArena
+{
+    friend class Game;
+
+public:
+
+    /**
+     * Returns the arena of the calling thread, creating it if needed.
+     *
+     * @return The arena of the calling thread.
+     */
+    static FrameArena* getCurrent();
+
+    /**
+     * Allocates memory that is valid until the end of the frame.
+     *
+     * @param size The number of bytes to allocate.
+     * @param alignment The alignment of the memory, which must be a power of two.
+     *
+     * @return The allocated memory.
+     */
+    void* allocate(size_t size, size_t alignment = 16);
+
+    /**
+     * Returns the number of bytes allocated from this arena in the current frame.
+     *
+     * @return The number of bytes allocated.
+     */
+    size_t getUsedSize() const;
+
+    /**
+     * Returns the number of bytes that this arena has allocated from the heap.
+     *
+     * @return The size of the chunks of the arena.
+     */
+    size_t getCapacity() const;
+
+private:
+
+    struct Chunk
+    {
+        Chunk* next;
+        size_t size;
+    };
+
+    FrameArena();
+
+    ~FrameArena();
+
+    FrameArena(const FrameArena& copy);
+
+    FrameArena& operator=(const FrameArena&);
+
+    /**
+     * Reclaims the memory allocated in the previous frames.
+     */
+    void reset();
+
+    /**
+     * Allocates a chunk that can hold an allocation of the specified size.
+     */
+    void addChunk(size_t size);
+
+    /**
+     * Starts a frame, after which the arenas reclaim their memory. This is called by the Game.
+     */
+    static void nextFrame();
+
+    Chunk* _chunks;
+    char* _current;
+    char* _end;
+    size_t _used;
+    size_t _capacity;
+    unsigned int _frame;
+};
+
+/**
+ * Defines an allocator for the standard containers that allocates from the frame arena of
+ * the calling thread.
+ *
+ * A container with this allocator must only be used within a single frame, on the thread that
+ * created it. It is intended for the temporary containers of functions that run every frame, which
+ * would otherwise allocate from the heap each time. Since the memory is only reclaimed with the
+ * frame, containers that grow a lot are better reserved up front.
+ *
+ * @script{ignore}
+ */
+template <class T>
+class FrameAllocator
+{
+public:
+
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <class U>
+    struct rebind
+    {
+        typedef FrameAllocator<U> other;
+    };
+
+    FrameAllocator() { }
+
+    template <class U>
+    FrameAllocator(const FrameAllocator<U>&) { }
+
+    T* allocate(size_t count, const void* hint = 0)
+    {
+        return static_cast<T*>(FrameArena::getCurrent()->allocate(count * sizeof(T), sizeof(T) < 16 ? 8 : 16));
+    }
+
+    void deallocate(T* p, size_t count)
+    {
+    }
+
+    size_t max_size() const
+    {
+        return ((size_t)-1) / sizeof(T);
+    }
+
+    template <class U>
+    bool operator==(const FrameAllocator<U>&) const { return true; }
+
+    template <class U>
+    bool operator!=(const FrameAllocator<U>&) const { return false; }
+};
+
+}
+
+#endif
@@ -1,19 +1,255 @@
 #include "Base.h"
 #include "FrameBuffer.h"
 #include "Game.h"
+#include "RenderCommandList.h"
+#include "RenderState.h"
 
 #define FRAMEBUFFER_ID_DEFAULT "org.gameplay3d.framebuffer.default"
 
+#ifdef GP_USE_MULTISAMPLE_APPLE
+#define GL_READ_FRAMEBUFFER GL_READ_FRAMEBUFFER_APPLE
+#define GL_DRAW_FRAMEBUFFER GL_DRAW_FRAMEBUFFER_APPLE
+#define GL_MAX_SAMPLES GL_MAX_SAMPLES_APPLE
+#define GL_RGBA8 GL_RGBA8_OES
+#define glRenderbufferStorageMultisample glRenderbufferStorageMultisampleAPPLE
+#endif
+#ifdef GP_USE_MULTISAMPLE_RENDER_TO_TEXTURE
+#define GL_MAX_SAMPLES GL_MAX_SAMPLES_EXT
+#endif
+
+// Multisampled frame buffers draw into render buffers that are resolved into their texture
+#if defined(GP_USE_MULTISAMPLE_BLIT) || defined(GP_USE_MULTISAMPLE_APPLE)
+#define FRAMEBUFFER_MULTISAMPLE_RESOLVE
+#endif
+
 namespace gameplay
 {
 
+/**
+ * A screenshot that was requested and has not been delivered yet.
+ */
+struct ScreenshotReadback
+{
+    FrameBuffer::ScreenshotCallback callback;
+    void* cookie;
+    std::string path;
+    Image::Format format;
+    Image* image;
+    unsigned int width;
+    unsigned int height;
+    bool issued;
+#ifdef GP_USE_BUFFER_STREAMING
+    GLuint buffer;
+    GLsync fence;
+#endif
+};
+
+/**
+ * A screenshot that is saved on a worker thread.
+ */
+struct ScreenshotSave
+{
+    Image* image;
+    std::string path;
+};
+
+static std::vector<ScreenshotReadback*> __screenshots;
+
+static void saveScreenshot(void* cookie)
+{
+    ScreenshotSave* save = (ScreenshotSave*)cookie;
+    save->image->save(save->path.c_str());
+    SAFE_RELEASE(save->image);
+    SAFE_DELETE(save);
+}
+
+// Copies the pixels of the current frame buffer for a screenshot, either into a pixel buffer
+// object or right into its image.
+static void issueScreenshot(void* cookie)
+{
+    ScreenshotReadback* readback = (ScreenshotReadback*)cookie;
+    FrameBuffer* frameBuffer = FrameBuffer::getCurrent();
+    readback->width = frameBuffer->getWidth();
+    readback->height = frameBuffer->getHeight();
+    readback->issued = true;
+    if (readback->width == 0 || readback->height == 0)
+        return;
+
+    // The rows of an image are tightly packed.
+    GLenum format = readback->format == Image::RGB ? GL_RGB : GL_RGBA;
+    GL_ASSERT( glPixelStorei(GL_PACK_ALIGNMENT, 1) );
+    bool async = false;
+#ifdef GP_USE_BUFFER_STREAMING
+    if (FrameBuffer::isAsyncScreenshotSupported())
+    {
+        async = true;
+        unsigned int size = readback->width * readback->height * (readback->format == Image::RGB ? 3 : 4);
+        GL_ASSERT( glGenBuffers(1, &readback->buffer) );
+        GL_ASSERT( glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->buffer) );
+        GL_ASSERT( glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ) );
+        GL_ASSERT( glReadPixels(0, 0, readback->width, readback->height, format, GL_UNSIGNED_BYTE, 0) );
+        GL_ASSERT( glBindBuffer(GL_PIXEL_PACK_BUFFER, 0) );
+        GL_ASSERT( readback->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) );
+    }
+#endif
+    if (!async)
+    {
+        readback->image = Image::create(readback->width, readback->height, readback->format, NULL);
+        GL_ASSERT( glReadPixels(0, 0, readback->width, readback->height, format, GL_UNSIGNED_BYTE, readback->image->getData()) );
+    }
+    GL_ASSERT( glPixelStorei(GL_PACK_ALIGNMENT, 4) );
+}
+
+// Copies the pixels of a screenshot out of its pixel buffer object once the GPU has written them.
+static bool readScreenshot(ScreenshotReadback* readback)
+{
+#ifdef GP_USE_BUFFER_STREAMING
+    if (readback->fence)
+    {
+        GLenum result;
+        GL_ASSERT( result = glClientWaitSync(readback->fence, 0, 0) );
+        if (result == GL_TIMEOUT_EXPIRED)
+            return false;
+        GL_ASSERT( glDeleteSync(readback->fence) );
+        readback->fence = 0;
+
+        unsigned int size = readback->width * readback->height * (readback->format == Image::RGB ? 3 : 4);
+        readback->image = Image::create(readback->width, readback->height, readback->format, NULL);
+        GL_ASSERT( glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->buffer) );
+        const void* pixels;
+        GL_ASSERT( pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT) );
+        if (pixels)
+        {
+            memcpy(readback->image->getData(), pixels, size);
+            GL_ASSERT( glUnmapBuffer(GL_PIXEL_PACK_BUFFER) );
+        }
+        GL_ASSERT( glBindBuffer(GL_PIXEL_PACK_BUFFER, 0) );
+        GL_ASSERT( glDeleteBuffers(1, &readback->buffer) );
+        readback->buffer = 0;
+    }
+#endif
+    return true;
+}
+
+static void deliverScreenshot(ScreenshotReadback* readback)
+{
+    Image* image = readback->image;
+    readback->image = NULL;
+    if (image == NULL)
+    {
+        GP_WARN("Failed to read back screenshot; the frame buffer is empty.");
+        return;
+    }
+
+    if (readback->path.empty())
+    {
+        readback->callback(image, readback->cookie);
+        SAFE_RELEASE(image);
+        return;
+    }
+
+    // Encoding a PNG takes longer than a frame, so it is done on a worker thread, which owns the image.
+    ScreenshotSave* save = new ScreenshotSave();
+    save->image = image;
+    save->path = readback->path;
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    if (jobSystem)
+    {
+        JobSystem::Job* job = jobSystem->create(&saveScreenshot, save);
+        jobSystem->run(job);
+        jobSystem->release(job);
+    }
+    else
+    {
+        saveScreenshot(save);
+    }
+}
+
+static void deleteScreenshot(ScreenshotReadback* readback)
+{
+#ifdef GP_USE_BUFFER_STREAMING
+    if (readback->fence)
+    {
+        GL_ASSERT( glDeleteSync(readback->fence) );
+    }
+    if (readback->buffer)
+    {
+        GL_ASSERT( glDeleteBuffers(1, &readback->buffer) );
+    }
+#endif
+    SAFE_RELEASE(readback->image);
+    SAFE_DELETE(readback);
+}
+
+static void queueScreenshot(FrameBuffer::ScreenshotCallback callback, void* cookie, const char* path, Image::Format format)
+{
+    ScreenshotReadback* readback = new ScreenshotReadback();
+    readback->callback = callback;
+    readback->cookie = cookie;
+    if (path)
+        readback->path = path;
+    readback->format = format;
+    readback->image = NULL;
+    readback->width = 0;
+    readback->height = 0;
+    readback->issued = false;
+#ifdef GP_USE_BUFFER_STREAMING
+    readback->buffer = 0;
+    readback->fence = 0;
+#endif
+    __screenshots.push_back(readback);
+
+    // The pixels are only drawn when a recording list is replayed, so the copy is replayed after them.
+    RenderCommandList* commands = RenderCommandList::getRecording();
+    if (commands)
+        commands->call(&issueScreenshot, readback);
+    else
+        issueScreenshot(readback);
+}
+
+/**
+ * Invalidates attachments of the frame buffer that is bound to a target, if the driver can.
+ */
+static void invalidateAttachments(GLenum target, bool defaultFrameBuffer, unsigned int flags)
+{
+    GLenum attachments[3];
+    GLsizei count = 0;
+#if defined(GP_USE_FRAMEBUFFER_INVALIDATE)
+    if (!glInvalidateFramebuffer)
+        return;
+    if (flags & GL_COLOR_BUFFER_BIT)
+        attachments[count++] = defaultFrameBuffer ? GL_COLOR : GL_COLOR_ATTACHMENT0;
+    if (flags & GL_DEPTH_BUFFER_BIT)
+        attachments[count++] = defaultFrameBuffer ? GL_DEPTH : GL_DEPTH_ATTACHMENT;
+    if (flags & GL_STENCIL_BUFFER_BIT)
+        attachments[count++] = defaultFrameBuffer ? GL_STENCIL : GL_STENCIL_ATTACHMENT;
+    if (count > 0)
+        GL_ASSERT( glInvalidateFramebuffer(target, count, attachments) );
+#elif defined(GP_USE_FRAMEBUFFER_DISCARD)
+#ifdef __ANDROID__
+    if (!glDiscardFramebufferEXT)
+        return;
+#endif
+    if (flags & GL_COLOR_BUFFER_BIT)
+        attachments[count++] = defaultFrameBuffer ? GL_COLOR_EXT : GL_COLOR_ATTACHMENT0;
+    if (flags & GL_DEPTH_BUFFER_BIT)
+        attachments[count++] = defaultFrameBuffer ? GL_DEPTH_EXT : GL_DEPTH_ATTACHMENT;
+    if (flags & GL_STENCIL_BUFFER_BIT)
+        attachments[count++] = defaultFrameBuffer ? GL_STENCIL_EXT : GL_STENCIL_ATTACHMENT;
+    if (count > 0)
+        GL_ASSERT( glDiscardFramebufferEXT(target, count, attachments) );
+#endif
+}
+
 unsigned int FrameBuffer::_maxRenderTargets = 0;
+unsigned int FrameBuffer::_maxSamples = 1;
 std::vector<FrameBuffer*> FrameBuffer::_frameBuffers;
 FrameBuffer* FrameBuffer::_defaultFrameBuffer = NULL;
 FrameBuffer* FrameBuffer::_currentFrameBuffer = NULL;
 
 FrameBuffer::FrameBuffer(const char* id, unsigned int width, unsigned int height, FrameBufferHandle handle) 
-    : _id(id ? id : ""), _handle(handle), _renderTargets(NULL), _renderTargetCount(0), _depthStencilTarget(NULL)
+    : _id(id ? id : ""), _handle(handle), _renderTargets(NULL), _renderTargetCount(0), _depthStencilTarget(NULL),
+      _samples(1), _resolveHandle(0), _colorBuffer(0), _invalidateFlags(0), _resolveNeeded(false)
 {
 }
 
@@ -36,7 +272,11 @@ FrameBuffer::~FrameBuffer()
 
     // Release GL resource.
     if (_handle)
-        GL_ASSERT( glDeleteFramebuffers(1, &_handle) );
+        RenderState::deleteFrameBuffer(_handle);
+    if (_resolveHandle)
+        RenderState::deleteFrameBuffer(_resolveHandle);
+    if (_colorBuffer)
+        RenderState::deleteRenderBuffer(_colorBuffer);
 
     // Remove self from vector.
     std::vector<FrameBuffer*>::iterator it = std::find(_frameBuffers.begin(), _frameBuffers.end(), this);
@@ -64,10 +304,30 @@ void FrameBuffer::initialize()
 #else
         _maxRenderTargets = 1;
 #endif
+
+    // Query the max supported samples of multisampled frame buffers, which need the functions
+    // of an extension on some platforms.
+    _maxSamples = 1;
+    GLint samples = 1;
+#if defined(GP_USE_MULTISAMPLE_BLIT)
+    if (glRenderbufferStorageMultisample && glBlitFramebuffer)
+        GL_ASSERT( glGetIntegerv(GL_MAX_SAMPLES, &samples) );
+#elif defined(GP_USE_MULTISAMPLE_APPLE)
+    GL_ASSERT( glGetIntegerv(GL_MAX_SAMPLES, &samples) );
+#elif defined(GP_USE_MULTISAMPLE_RENDER_TO_TEXTURE)
+    if (glFramebufferTexture2DMultisampleEXT && glRenderbufferStorageMultisampleEXT)
+        GL_ASSERT( glGetIntegerv(GL_MAX_SAMPLES, &samples) );
+#endif
+    _maxSamples = (unsigned int)std::max(1, samples);
 }
 
 void FrameBuffer::finalize()
 {
+    for (size_t i = 0, count = __screenshots.size(); i < count; ++i)
+    {
+        deleteScreenshot(__screenshots[i]);
+    }
+    __screenshots.clear();
     SAFE_RELEASE(_defaultFrameBuffer);
 }
 
@@ -109,6 +369,40 @@ FrameBuffer* FrameBuffer::create(const char* id, unsigned int width, unsigned in
     return frameBuffer;
 }
 
+FrameBuffer* FrameBuffer::create(const char* id, unsigned int width, unsigned int height, unsigned int samples)
+{
+    samples = std::min(samples, _maxSamples);
+    if (samples <= 1)
+        return create(id, width, height);
+
+    FrameBuffer* frameBuffer = create(id, 0, 0);
+    frameBuffer->_samples = samples;
+#if defined(GP_USE_MULTISAMPLE_RENDER_TO_TEXTURE)
+    // The samples are resolved into the texture when the tiles are written to memory, and the
+    // depth and stencil samples are never written to memory.
+    frameBuffer->_invalidateFlags = GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT;
+#elif defined(FRAMEBUFFER_MULTISAMPLE_RESOLVE)
+    // The samples are drawn into render buffers of their own, and resolved into the texture
+    // through a second frame buffer, after which none of them are needed.
+    GL_ASSERT( glGenFramebuffers(1, &frameBuffer->_resolveHandle) );
+    frameBuffer->_invalidateFlags = GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT;
+#endif
+
+    if (width > 0 && height > 0)
+    {
+        RenderTarget* renderTarget = RenderTarget::create(id, width, height);
+        if (renderTarget == NULL)
+        {
+            GP_ERROR("Failed to create render target for frame buffer.");
+            SAFE_RELEASE(frameBuffer);
+            return NULL;
+        }
+        frameBuffer->setRenderTarget(renderTarget, 0);
+        SAFE_RELEASE(renderTarget);
+    }
+    return frameBuffer;
+}
+
 FrameBuffer* FrameBuffer::getFrameBuffer(const char* id)
 {
     GP_ASSERT(id);
@@ -153,6 +447,16 @@ unsigned int FrameBuffer::getMaxRenderTargets()
     return _maxRenderTargets;
 }
 
+unsigned int FrameBuffer::getMaxSamples()
+{
+    return _maxSamples;
+}
+
+unsigned int FrameBuffer::getSamples() const
+{
+    return _samples;
+}
+
 void FrameBuffer::setRenderTarget(RenderTarget* target, unsigned int index)
 {
     GP_ASSERT(!target || (target->getTexture() && target->getTexture()->getType() == Texture::TEXTURE_2D));
@@ -172,6 +476,47 @@ void FrameBuffer::setRenderTarget(RenderTarget* target, Texture::CubeFace face,
     setRenderTarget(target, index, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face);
 }
 
+void FrameBuffer::setMultisampleRenderTarget(RenderTarget* target, unsigned int index, GLenum textureTarget)
+{
+    if (index != 0 || textureTarget != GL_TEXTURE_2D)
+    {
+        GP_ERROR("Failed to set render target %u of multisampled frame buffer '%s'; only a single 2D render target is supported.", index, _id.c_str());
+        return;
+    }
+
+    GLuint texture = target->getTexture()->getHandle();
+#if defined(GP_USE_MULTISAMPLE_RENDER_TO_TEXTURE)
+    GL_ASSERT( glBindFramebuffer(GL_FRAMEBUFFER, _handle) );
+    GL_ASSERT( glFramebufferTexture2DMultisampleEXT(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0, _samples) );
+#elif defined(FRAMEBUFFER_MULTISAMPLE_RESOLVE)
+    GL_ASSERT( glBindFramebuffer(GL_FRAMEBUFFER, _resolveHandle) );
+    GL_ASSERT( glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0) );
+    GLenum resolveStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (resolveStatus != GL_FRAMEBUFFER_COMPLETE)
+    {
+        GP_ERROR("Framebuffer status incomplete: 0x%x", resolveStatus);
+    }
+
+    // The samples are drawn into a render buffer of the size of the texture.
+    if (!_colorBuffer)
+    {
+        GL_ASSERT( glGenRenderbuffers(1, &_colorBuffer) );
+    }
+    GL_ASSERT( glBindRenderbuffer(GL_RENDERBUFFER, _colorBuffer) );
+    GL_ASSERT( glRenderbufferStorageMultisample(GL_RENDERBUFFER, _samples, GL_RGBA8, target->getWidth(), target->getHeight()) );
+    GL_ASSERT( glBindFramebuffer(GL_FRAMEBUFFER, _handle) );
+    GL_ASSERT( glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _colorBuffer) );
+#endif
+    GLenum fboStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (fboStatus != GL_FRAMEBUFFER_COMPLETE)
+    {
+        GP_ERROR("Framebuffer status incomplete: 0x%x", fboStatus);
+    }
+
+    // Restore the FBO binding
+    GL_ASSERT( glBindFramebuffer(GL_FRAMEBUFFER, _currentFrameBuffer->_handle) );
+}
+
 void FrameBuffer::setRenderTarget(RenderTarget* target, unsigned int index, GLenum textureTarget)
 {
     GP_ASSERT(index < _maxRenderTargets);
@@ -193,6 +538,12 @@ void FrameBuffer::setRenderTarget(RenderTarget* target, unsigned int index, GLen
         // This FrameBuffer now references the RenderTarget.
         target->addRef();
 
+        if (_samples > 1)
+        {
+            setMultisampleRenderTarget(target, index, textureTarget);
+            return;
+        }
+
         // Now set this target as the color attachment corresponding to index.
         GL_ASSERT( glBindFramebuffer(GL_FRAMEBUFFER, _handle) );
         GLenum attachment = GL_COLOR_ATTACHMENT0 + index;
@@ -228,6 +579,12 @@ void FrameBuffer::setDepthStencilTarget(DepthStencilTarget* target)
     if (_depthStencilTarget == target)
         return;
 
+    if (target && target->getSamples() != _samples)
+    {
+        GP_ERROR("Failed to set depth stencil target '%s' on frame buffer '%s'; they have different numbers of samples.", target->getId(), _id.c_str());
+        return;
+    }
+
     // Release our existing depth stencil target.
     SAFE_RELEASE(_depthStencilTarget);
 
@@ -274,9 +631,63 @@ bool FrameBuffer::isDefault() const
     return (this == _defaultFrameBuffer);
 }
 
+void FrameBuffer::resolve()
+{
+    if (!_resolveNeeded)
+        return;
+    _resolveNeeded = false;
+
+#ifdef FRAMEBUFFER_MULTISAMPLE_RESOLVE
+    GL_ASSERT( glBindFramebuffer(GL_READ_FRAMEBUFFER, _handle) );
+    GL_ASSERT( glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _resolveHandle) );
+#ifdef GP_USE_MULTISAMPLE_APPLE
+    GL_ASSERT( glResolveMultisampleFramebufferAPPLE() );
+#else
+    GLint width = (GLint)getWidth();
+    GLint height = (GLint)getHeight();
+    GL_ASSERT( glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST) );
+#endif
+    GL_ASSERT( glBindFramebuffer(GL_FRAMEBUFFER, _currentFrameBuffer->_handle) );
+#endif
+}
+
+void FrameBuffer::invalidate(unsigned int flags)
+{
+    GP_ASSERT(_currentFrameBuffer == this);
+
+    // The attachments of the window have names of their own.
+    invalidateAttachments(GL_FRAMEBUFFER, _handle == 0, flags);
+}
+
+void FrameBuffer::setInvalidateOnUnbind(unsigned int flags)
+{
+    _invalidateFlags = flags;
+}
+
+unsigned int FrameBuffer::getInvalidateOnUnbind() const
+{
+    return _invalidateFlags;
+}
+
+void FrameBuffer::unbindCurrent()
+{
+    FrameBuffer* current = _currentFrameBuffer;
+    if (current == NULL)
+        return;
+
+    current->resolve();
+    if (current->_invalidateFlags)
+        current->invalidate(current->_invalidateFlags);
+}
+
 FrameBuffer* FrameBuffer::bind()
 {
+    if (_currentFrameBuffer != this)
+        unbindCurrent();
+    _resolveNeeded = _samples > 1;
     GL_ASSERT( glBindFramebuffer(GL_FRAMEBUFFER, _handle) );
+    GP_PROFILE_GPU_TARGET(_id.c_str());
+    RenderStats::countFrameBufferBind();
     FrameBuffer* previousFrameBuffer = _currentFrameBuffer;
     _currentFrameBuffer = this;
     return previousFrameBuffer;
@@ -303,9 +714,66 @@ Image* FrameBuffer::createScreenshot(Image::Format format)
     return screenshot;
 }
 
+void FrameBuffer::requestScreenshot(ScreenshotCallback callback, void* cookie, Image::Format format)
+{
+    GP_ASSERT(callback);
+    queueScreenshot(callback, cookie, NULL, format);
+}
+
+void FrameBuffer::requestScreenshot(const char* path, Image::Format format)
+{
+    GP_ASSERT(path);
+    queueScreenshot(NULL, NULL, path, format);
+}
+
+bool FrameBuffer::isAsyncScreenshotSupported()
+{
+#ifdef GP_USE_BUFFER_STREAMING
+    return glMapBufferRange && glUnmapBuffer && glFenceSync && glClientWaitSync && glDeleteSync;
+#else
+    return false;
+#endif
+}
+
+unsigned int FrameBuffer::getPendingScreenshotCount()
+{
+    return (unsigned int)__screenshots.size();
+}
+
+void FrameBuffer::updateScreenshots()
+{
+    if (__screenshots.empty())
+        return;
+
+    // The callbacks may request more screenshots, so the finished ones are delivered after the list is updated.
+    std::vector<ScreenshotReadback*> finished;
+    for (size_t i = 0; i < __screenshots.size();)
+    {
+        ScreenshotReadback* readback = __screenshots[i];
+        if (readback->issued && readScreenshot(readback))
+        {
+            finished.push_back(readback);
+            __screenshots.erase(__screenshots.begin() + i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    for (size_t i = 0, count = finished.size(); i < count; ++i)
+    {
+        deliverScreenshot(finished[i]);
+        deleteScreenshot(finished[i]);
+    }
+}
+
 FrameBuffer* FrameBuffer::bindDefault()
 {
+    if (_currentFrameBuffer != _defaultFrameBuffer)
+        unbindCurrent();
     GL_ASSERT( glBindFramebuffer(GL_FRAMEBUFFER, _defaultFrameBuffer->_handle) );
+    GP_PROFILE_GPU_TARGET(_defaultFrameBuffer->_id.c_str());
+    RenderStats::countFrameBufferBind();
     _currentFrameBuffer = _defaultFrameBuffer;
     return _defaultFrameBuffer;
 }
@@ -21,6 +21,15 @@ namespace gameplay
  * FrameBuffer::bind and restore it when you are finished drawing to your frame buffer.
  *
  * To bind the default frame buffer, call FrameBuffer::bindDefault.
+ *
+ * Multisampled frame buffers draw into multisampled buffers that are resolved into the texture
+ * of their render target when another frame buffer is bound, so that the texture can be sampled
+ * as with any other frame buffer. On tile-based GPUs that support rendering to textures with
+ * multisampling, the samples never leave the tiles and no resolve pass is needed.
+ *
+ * A frame buffer can also invalidate some of its attachments when another frame buffer is bound
+ * (see setInvalidateOnUnbind), which tells tile-based GPUs that they need not write them back to
+ * memory.
  */
 class FrameBuffer : public Ref
 {
@@ -61,6 +70,25 @@ public:
      */
     static FrameBuffer* create(const char* id, unsigned int width, unsigned int height);
 
+    /**
+     * Creates a new multisampled FrameBuffer with a single RenderTarget of the specified width
+     * and height, and adds the FrameBuffer to the list of available FrameBuffers.
+     *
+     * A DepthStencilTarget that is set on the FrameBuffer must have the same number of samples.
+     * The frame buffer invalidates its multisampled attachments once they are resolved, unless
+     * setInvalidateOnUnbind is changed.
+     *
+     * @param id The ID of the new FrameBuffer. Uniqueness is recommended but not enforced.
+     * @param width The width of the RenderTarget to be created and attached.
+     * @param height The height of the RenderTarget to be created and attached.
+     * @param samples The number of samples of each pixel, which is clamped to getMaxSamples().
+     *      A FrameBuffer that is not multisampled is created when it is 1 or less.
+     *
+     * @return A newly created FrameBuffer.
+     * @script{ignore}
+     */
+    static FrameBuffer* create(const char* id, unsigned int width, unsigned int height, unsigned int samples);
+
     /**
      * Get a named FrameBuffer from its ID.
      *
@@ -98,6 +126,65 @@ public:
      */
     static unsigned int getMaxRenderTargets();
 
+    /**
+     * Returns the largest number of samples of multisampled frame buffers on the current hardware.
+     *
+     * @return The number of samples, which is 1 when multisampled frame buffers are not supported.
+     * @script{ignore}
+     */
+    static unsigned int getMaxSamples();
+
+    /**
+     * Returns the number of samples of each pixel of this FrameBuffer.
+     *
+     * @return The number of samples, which is 1 when the FrameBuffer is not multisampled.
+     * @script{ignore}
+     */
+    unsigned int getSamples() const;
+
+    /**
+     * Resolves the samples of a multisampled FrameBuffer into the texture of its render target.
+     *
+     * This is done when another FrameBuffer is bound, so it only needs to be called to read the
+     * texture while this FrameBuffer is still bound. It does nothing for FrameBuffers that are
+     * not multisampled, or that have not been drawn into since they were last resolved.
+     *
+     * @script{ignore}
+     */
+    void resolve();
+
+    /**
+     * Tells the driver that the contents of some attachments of this FrameBuffer are no longer
+     * needed, so that tile-based GPUs discard them rather than write them to memory.
+     *
+     * The FrameBuffer must be bound. Invalidating the color of a FrameBuffer that is not
+     * multisampled discards the contents of its render target texture.
+     *
+     * @param flags The attachments to invalidate, as a combination of Game::ClearFlags.
+     * @script{ignore}
+     */
+    void invalidate(unsigned int flags);
+
+    /**
+     * Sets the attachments that this FrameBuffer invalidates when another FrameBuffer is bound,
+     * after resolving them if it is multisampled.
+     *
+     * This is typically the depth and stencil of passes whose depth is not used afterwards.
+     *
+     * @param flags The attachments to invalidate, as a combination of Game::ClearFlags, or 0 to
+     *      keep all of them, which is the default for FrameBuffers that are not multisampled.
+     * @script{ignore}
+     */
+    void setInvalidateOnUnbind(unsigned int flags);
+
+    /**
+     * Returns the attachments that this FrameBuffer invalidates when another FrameBuffer is bound.
+     *
+     * @return The attachments, as a combination of Game::ClearFlags.
+     * @script{ignore}
+     */
+    unsigned int getInvalidateOnUnbind() const;
+
     /**
      * Set a RenderTarget on this FrameBuffer's color attachment at the specified index.
      *
@@ -164,6 +251,9 @@ public:
     /**
      * Records a screenshot of what is stored on the current FrameBuffer.
      *
+     * This waits for the GPU to finish drawing, so requestScreenshot() should be used instead
+     * when the screenshot is not needed right away.
+     *
      * @param format The format the Image should be in.
      * @return A screenshot of the current framebuffer's content.
      */
@@ -178,6 +268,62 @@ public:
      */
     static void getScreenshot(Image* image);
 
+    /**
+     * Defines a function that receives a screenshot that was requested with requestScreenshot().
+     *
+     * The image is released after the function returns, so the function must call addRef()
+     * on it to keep it.
+     *
+     * @script{ignore}
+     */
+    typedef void (*ScreenshotCallback)(Image* image, void* cookie);
+
+    /**
+     * Requests a screenshot of what is stored on the current FrameBuffer, without waiting for
+     * the GPU to finish drawing it.
+     *
+     * The pixels are copied into a pixel buffer object that is read back once its fence has
+     * signalled, which is normally a few frames later, and the callback is called with the
+     * image at the start of that frame on the thread that runs the game. When asynchronous
+     * readback is not supported (see isAsyncScreenshotSupported()), the pixels are read right
+     * away and the callback is called at the start of the next frame.
+     *
+     * When a RenderCommandList is recording, the screenshot is taken when the list is replayed.
+     *
+     * @param callback The function that receives the screenshot.
+     * @param cookie The value to pass to the function.
+     * @param format The format the Image should be in.
+     * @script{ignore}
+     */
+    static void requestScreenshot(ScreenshotCallback callback, void* cookie, Image::Format format = Image::RGBA);
+
+    /**
+     * Requests a screenshot of what is stored on the current FrameBuffer and saves it to a .png
+     * file once it has been read back.
+     *
+     * The image is encoded and written on a worker thread of the job system.
+     *
+     * @param path The path to the image file.
+     * @param format The format the Image should be in.
+     * @script{ignore}
+     */
+    static void requestScreenshot(const char* path, Image::Format format = Image::RGBA);
+
+    /**
+     * Determines if screenshots can be read back without waiting for the GPU, which needs
+     * pixel buffer objects and fences.
+     *
+     * @return true if asynchronous readback is supported, false otherwise.
+     */
+    static bool isAsyncScreenshotSupported();
+
+    /**
+     * Returns the number of requested screenshots that have not been delivered yet.
+     *
+     * @return The number of pending screenshots.
+     */
+    static unsigned int getPendingScreenshotCount();
+
     /**
      * Binds the default FrameBuffer for rendering to the display.
      *
@@ -211,19 +357,34 @@ private:
 
     void setRenderTarget(RenderTarget* target, unsigned int index, GLenum textureTarget);
 
+    void setMultisampleRenderTarget(RenderTarget* target, unsigned int index, GLenum textureTarget);
+
     static void initialize();
 
     static void finalize();
 
+    static void updateScreenshots();
+
     static bool isPowerOfTwo(unsigned int value);
 
+    /**
+     * Resolves and invalidates the attachments of the bound FrameBuffer, before another is bound.
+     */
+    static void unbindCurrent();
+
     std::string _id;
     FrameBufferHandle _handle;
     RenderTarget** _renderTargets;
     unsigned int _renderTargetCount;
     DepthStencilTarget* _depthStencilTarget;
+    unsigned int _samples;
+    FrameBufferHandle _resolveHandle;
+    RenderBufferHandle _colorBuffer;
+    unsigned int _invalidateFlags;
+    bool _resolveNeeded;
 
     static unsigned int _maxRenderTargets;
+    static unsigned int _maxSamples;
     static std::vector<FrameBuffer*> _frameBuffers;
     static FrameBuffer* _defaultFrameBuffer;
     static FrameBuffer* _currentFrameBuffer;
@@ -2,6 +2,7 @@
 #include "Frustum.h"
 #include "BoundingSphere.h"
 #include "BoundingBox.h"
+#include "SimdMath.h"
 
 namespace gameplay
 {
@@ -120,6 +121,98 @@ bool Frustum::intersects(const BoundingBox& box) const
     return box.intersects(*this);
 }
 
+void Frustum::cullSpheres(const BoundingSphere* spheres, size_t count, unsigned char* visible) const
+{
+    GP_ASSERT(spheres || count == 0);
+    GP_ASSERT(visible || count == 0);
+
+    size_t i = 0;
+#ifdef GP_USE_SIMD
+    const Plane* planes[6] = { &_near, &_far, &_left, &_right, &_bottom, &_top };
+    for (; i + 4 <= count; i += 4)
+    {
+        // Transpose four spheres so that each register holds one component of all of them.
+        float cx[4], cy[4], cz[4], nr[4];
+        for (unsigned int j = 0; j < 4; ++j)
+        {
+            const BoundingSphere& sphere = spheres[i + j];
+            cx[j] = sphere.center.x;
+            cy[j] = sphere.center.y;
+            cz[j] = sphere.center.z;
+            nr[j] = -sphere.radius;
+        }
+        Float4 x = load4(cx);
+        Float4 y = load4(cy);
+        Float4 z = load4(cz);
+        Float4 negRadius = load4(nr);
+
+        // A sphere is outside if it is entirely behind any of the planes.
+        Mask4 inside = allTrue4();
+        for (unsigned int p = 0; p < 6; ++p)
+        {
+            const Vector3& n = planes[p]->getNormal();
+            Float4 distance = add4(add4(add4(mul4(splat4(n.x), x), mul4(splat4(n.y), y)), mul4(splat4(n.z), z)), splat4(planes[p]->getDistance()));
+            inside = and4(inside, greaterEqual4(distance, negRadius));
+        }
+        storeMask4(inside, visible + i);
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        visible[i] = spheres[i].intersects(*this) ? 1 : 0;
+    }
+}
+
+void Frustum::cullBoxes(const BoundingBox* boxes, size_t count, unsigned char* visible) const
+{
+    GP_ASSERT(boxes || count == 0);
+    GP_ASSERT(visible || count == 0);
+
+    size_t i = 0;
+#ifdef GP_USE_SIMD
+    const Plane* planes[6] = { &_near, &_far, &_left, &_right, &_bottom, &_top };
+    for (; i + 4 <= count; i += 4)
+    {
+        // Transpose the centers and extents of four boxes.
+        float cx[4], cy[4], cz[4], ex[4], ey[4], ez[4];
+        for (unsigned int j = 0; j < 4; ++j)
+        {
+            const BoundingBox& box = boxes[i + j];
+            cx[j] = (box.min.x + box.max.x) * 0.5f;
+            cy[j] = (box.min.y + box.max.y) * 0.5f;
+            cz[j] = (box.min.z + box.max.z) * 0.5f;
+            ex[j] = (box.max.x - box.min.x) * 0.5f;
+            ey[j] = (box.max.y - box.min.y) * 0.5f;
+            ez[j] = (box.max.z - box.min.z) * 0.5f;
+        }
+        Float4 x = load4(cx);
+        Float4 y = load4(cy);
+        Float4 z = load4(cz);
+        Float4 extentX = load4(ex);
+        Float4 extentY = load4(ey);
+        Float4 extentZ = load4(ez);
+
+        // A box is outside if it is entirely behind any of the planes, which is the case
+        // when the distance of its center is less than minus its projected radius.
+        Mask4 inside = allTrue4();
+        for (unsigned int p = 0; p < 6; ++p)
+        {
+            const Vector3& n = planes[p]->getNormal();
+            Float4 distance = add4(add4(add4(mul4(splat4(n.x), x), mul4(splat4(n.y), y)), mul4(splat4(n.z), z)), splat4(planes[p]->getDistance()));
+            Float4 negRadius = add4(add4(mul4(splat4(-fabsf(n.x)), extentX), mul4(splat4(-fabsf(n.y)), extentY)), mul4(splat4(-fabsf(n.z)), extentZ));
+            inside = and4(inside, greaterEqual4(distance, negRadius));
+        }
+        storeMask4(inside, visible + i);
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        visible[i] = boxes[i].intersects(*this) ? 1 : 0;
+    }
+}
+
 float Frustum::intersects(const Plane& plane) const
 {
     return plane.intersects(*this);
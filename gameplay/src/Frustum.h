@@ -171,6 +171,36 @@ public:
      */
     bool intersects(const BoundingBox& box) const;
 
+    /**
+     * Tests an array of bounding spheres against this frustum.
+     *
+     * The results are the same as calling intersects(const BoundingSphere&) for each
+     * sphere, but four spheres are tested at a time using SSE2 or NEON instructions
+     * where they are available.
+     *
+     * @param spheres The bounding spheres to test.
+     * @param count The number of bounding spheres.
+     * @param visible Array of count values that receives 1 for each sphere that
+     *      intersects this frustum and 0 for each sphere that does not.
+     * @script{ignore}
+     */
+    void cullSpheres(const BoundingSphere* spheres, size_t count, unsigned char* visible) const;
+
+    /**
+     * Tests an array of bounding boxes against this frustum.
+     *
+     * The results are the same as calling intersects(const BoundingBox&) for each
+     * box, but four boxes are tested at a time using SSE2 or NEON instructions
+     * where they are available.
+     *
+     * @param boxes The bounding boxes to test.
+     * @param count The number of bounding boxes.
+     * @param visible Array of count values that receives 1 for each box that
+     *      intersects this frustum and 0 for each box that does not.
+     * @script{ignore}
+     */
+    void cullBoxes(const BoundingBox* boxes, size_t count, unsigned char* visible) const;
+
     /**
      * Tests whether this frustum intersects the specified plane.
      *
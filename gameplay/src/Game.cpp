@@ -5,19 +5,52 @@
 #include "FileSystem.h"
 #include "FrameBuffer.h"
 #include "SceneLoader.h"
+#include "RenderCommandList.h"
 #include "ControlFactory.h"
 #include "Theme.h"
 #include "Form.h"
+#include "Bundle.h"
+#include "MeshGeometry.h"
+#include "ResourceCache.h"
+#include "AudioBuffer.h"
+#include "BufferAllocator.h"
+#include "TextureUploader.h"
+#include "ScriptWorker.h"
 
 /** @script{ignore} */
 GLenum __gl_error_code = GL_NO_ERROR;
 /** @script{ignore} */
 ALenum __al_error_code = AL_NO_ERROR;
 
+// The interval that gamepads are polled at while the frames are rendered on demand and nothing changes, in milliseconds
+#define GAME_IDLE_GAMEPAD_POLL_TIME 50.0
+
 namespace gameplay
 {
 
 static Game* __gameInstance = NULL;
+
+// The update thread of the render thread mode, which updates the animations, physics and AI
+// of a frame while the game thread replays the draws of the last frame.
+struct Game::UpdateThread
+{
+    UpdateThread() : elapsedTime(0.0f), pending(false), active(true)
+    {
+    }
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    float elapsedTime;
+    bool pending;
+    bool active;
+};
+
+static void flushSprites(void* renderer)
+{
+    static_cast<SpriteRenderer*>(renderer)->flush();
+}
 double Game::_pausedTimeLast = 0.0;
 double Game::_pausedTimeTotal = 0.0;
 
@@ -61,16 +94,17 @@ public:
 
 Game::Game()
     : _initialized(false), _state(UNINITIALIZED), _pausedCount(0),
-      _frameLastFPS(0), _frameCount(0), _frameRate(0), _width(0), _height(0),
+      _frameLastFPS(0), _frameCount(0), _frameRate(0), _fixedFrameTime(0.0f), _renderOnDemand(false), _frameActive(true),
+      _frameRendered(true), _invalidated(true), _width(0), _height(0),
       _clearDepth(1.0f), _clearStencil(0), _properties(NULL),
-      _animationController(NULL), _audioController(NULL),
-      _physicsController(NULL), _aiController(NULL), _audioListener(NULL),
-      _timeEvents(NULL), _scriptController(NULL), _scriptTarget(NULL)
+      _animationController(NULL), _audioController(NULL), _audioInitialized(false),
+      _physicsController(NULL), _physicsInitialized(false), _aiController(NULL), _jobSystem(NULL), _textureStreamer(NULL), _meshStreamer(NULL), _particleSystem(NULL), _spriteRenderer(NULL),
+      _updateThread(NULL), _commandList(NULL), _audioListener(NULL), _timeEvents(NULL), _scriptController(NULL), _scriptTarget(NULL)
 {
     GP_ASSERT(__gameInstance == NULL);
 
     __gameInstance = this;
-    _timeEvents = new std::priority_queue<TimeEvent, std::vector<TimeEvent>, std::less<TimeEvent> >();
+    _timeEvents = new TimerWheel();
 }
 
 Game::~Game()
@@ -135,6 +169,26 @@ bool Game::isVsync()
     return Platform::isVsync();
 }
 
+void Game::setAdaptiveVsync(bool enable)
+{
+    Platform::setAdaptiveVsync(enable);
+}
+
+bool Game::isAdaptiveVsync()
+{
+    return Platform::isAdaptiveVsync();
+}
+
+void Game::setTargetFrameRate(unsigned int frameRate)
+{
+    Platform::setTargetFrameRate(frameRate);
+}
+
+unsigned int Game::getTargetFrameRate()
+{
+    return Platform::getTargetFrameRate();
+}
+
 int Game::run()
 {
     if (_state != UNINITIALIZED)
@@ -161,24 +215,134 @@ bool Game::startup()
         return false;
 
     setViewport(Rectangle(0.0f, 0.0f, (float)_width, (float)_height));
-    RenderState::initialize();
-    FrameBuffer::initialize();
+
+    // Headless platforms have no graphics context, so the game is only updated and never rendered.
+    bool headless = Platform::isHeadless();
+    if (!headless)
+    {
+        RenderState::initialize();
+        FrameBuffer::initialize();
+    }
+
+    // Stream the primitives of mesh and sprite batches through mapped buffers when configured.
+    Properties* graphicsConfig = _properties ? _properties->getNamespace("graphics", true) : NULL;
+    if (graphicsConfig && graphicsConfig->getBool("batchStreaming"))
+        MeshBatch::setDefaultStreaming(true);
+
+    // Allocate the buffers of static meshes from shared arenas when configured.
+    if (graphicsConfig && graphicsConfig->getBool("sharedMeshBuffers"))
+        BufferAllocator::setEnabled(true);
+
+    // Start compiling the shader permutations of the manifest while the game initializes.
+    std::string shaderManifest;
+    if (!headless && graphicsConfig && graphicsConfig->getPath("shaderManifest", &shaderManifest))
+        Effect::precompile(shaderManifest.c_str(), true);
+
+    // Pace the frames to a target frame rate and use adaptive vsync when configured.
+    if (graphicsConfig && graphicsConfig->exists("frameRate"))
+        Platform::setTargetFrameRate((unsigned int)std::max(0, graphicsConfig->getInt("frameRate")));
+    if (graphicsConfig && graphicsConfig->getBool("adaptiveVsync"))
+        Platform::setAdaptiveVsync(true);
+    if (graphicsConfig && graphicsConfig->getBool("renderOnDemand"))
+        setRenderOnDemand(true);
+
+    // Replay the draws of each frame while the next frame is updated when configured.
+    if (!headless && graphicsConfig && graphicsConfig->getBool("renderThread"))
+    {
+        _commandList = new RenderCommandList();
+        _updateThread = new UpdateThread();
+        _updateThread->thread = std::thread(&updateThreadProc, this);
+    }
+
+    // Start capturing the markers of the profiler when configured.
+    Profiler::setThreadName("Game");
+    Properties* profilerConfig = _properties ? _properties->getNamespace("profiler", true) : NULL;
+    if (profilerConfig)
+    {
+        Profiler::setCaptureFile(profilerConfig->getString("file"));
+        Profiler::startCapture((unsigned int)std::max(0, profilerConfig->getInt("frames")));
+    }
+
+    // Set the budgets of the memory categories (in megabytes).
+    MemoryStats::initialize(_properties ? _properties->getNamespace("memory", true) : NULL);
+
+    // Start the worker threads first so that the other systems can use them.
+    unsigned int threadCount = 0;
+    Properties* jobsConfig = _properties ? _properties->getNamespace("jobs", true) : NULL;
+    if (jobsConfig && jobsConfig->exists("threads"))
+        threadCount = (unsigned int)std::max(1, jobsConfig->getInt("threads"));
+    _jobSystem = new JobSystem();
+    _jobSystem->initialize(threadCount);
+
+    // Keep released textures loaded up to the configured budget (in megabytes).
+    Properties* resourcesConfig = _properties ? _properties->getNamespace("resources", true) : NULL;
+    if (resourcesConfig && resourcesConfig->exists("textureBudget"))
+        Texture::getCache()->setBudget((size_t)std::max(0, resourcesConfig->getInt("textureBudget")) * 1024 * 1024);
+
+    // Skip the largest mipmap levels of textures on lower quality settings.
+    if (resourcesConfig && resourcesConfig->exists("textureMipmapSkip"))
+        Texture::setMipmapSkip((unsigned int)std::max(0, resourcesConfig->getInt("textureMipmapSkip")));
+
+    _textureStreamer = new TextureStreamer();
+    _meshStreamer = new MeshStreamer();
+    if (resourcesConfig)
+    {
+        _textureStreamer->setEnabled(resourcesConfig->getBool("textureStreaming"));
+        if (resourcesConfig->exists("textureStreamingBudget"))
+            _textureStreamer->setBudget((size_t)std::max(0, resourcesConfig->getInt("textureStreamingBudget")) * 1024 * 1024);
+        _meshStreamer->setEnabled(resourcesConfig->getBool("meshStreaming"));
+        if (resourcesConfig->exists("meshStreamingBudget"))
+            _meshStreamer->setBudget((size_t)std::max(0, resourcesConfig->getInt("meshStreamingBudget")) * 1024 * 1024);
+
+        // Upload texture data through pixel unpack buffers when configured.
+        if (resourcesConfig->exists("textureUploadBufferSize"))
+            TextureUploader::setBufferSize((unsigned int)std::max(1, resourcesConfig->getInt("textureUploadBufferSize")) * 1024 * 1024);
+        TextureUploader::setEnabled(resourcesConfig->getBool("asyncTextureUploads"));
+
+        // Keep the geometry of loaded meshes in memory for physics and navigation.
+        MeshGeometry::setRetained(resourcesConfig->getBool("retainMeshGeometry"));
+    }
+
+    _particleSystem = new ParticleSystem();
+    _spriteRenderer = new SpriteRenderer();
 
     _animationController = new AnimationController();
     _animationController->initialize();
 
+    // The audio device and the physics world are only created when the game first uses them.
     _audioController = new AudioController();
-    _audioController->initialize();
+
+    // Limit the number of sources that are mixed at once; the others play virtually.
+    Properties* audioConfig = _properties ? _properties->getNamespace("audio", true) : NULL;
+    if (audioConfig && audioConfig->exists("voices"))
+        _audioController->setVoiceBudget((unsigned int)std::max(0, audioConfig->getInt("voices")));
+    if (audioConfig && audioConfig->getBool("compressSounds"))
+        _audioController->setSoundCompression(true);
+    if (resourcesConfig && resourcesConfig->exists("audioBudget"))
+        AudioBuffer::getCache()->setBudget((size_t)std::max(0, resourcesConfig->getInt("audioBudget")) * 1024 * 1024);
 
     _physicsController = new PhysicsController();
-    _physicsController->initialize();
 
     _aiController = new AIController();
     _aiController->initialize();
+    Properties* aiConfig = _properties ? _properties->getNamespace("ai", true) : NULL;
+    if (aiConfig && aiConfig->exists("updateBudget"))
+        _aiController->setUpdateBudget(aiConfig->getFloat("updateBudget"));
+    if (aiConfig && aiConfig->exists("pathBudget"))
+        _aiController->setPathBudget((unsigned int)std::max(0, aiConfig->getInt("pathBudget")));
 
     _scriptController = new ScriptController();
     _scriptController->initialize();
 
+    // Collect the garbage of scripts at the end of every frame, within the configured time (in milliseconds).
+    Properties* scriptingConfig = _properties ? _properties->getNamespace("scripting", true) : NULL;
+    if (scriptingConfig && scriptingConfig->exists("garbageBudget"))
+        _scriptController->setGarbageBudget(scriptingConfig->getFloat("garbageBudget"));
+
+    // Sample the call stacks of scripts into the profiler captures, every number of Lua instructions.
+    if (scriptingConfig && scriptingConfig->getBool("profile"))
+        _scriptController->setProfiling(true, scriptingConfig->exists("profileInterval") ? (unsigned int)std::max(1, scriptingConfig->getInt("profileInterval")) : 1000);
+
     // Load any gamepads, ui or physical.
     loadGamepads();
 
@@ -239,6 +403,23 @@ void Game::shutdown()
 
         Platform::signalShutdown();
 
+        // Cancel the scenes and textures that are still loading in the background.
+        SceneLoader::finalizeAsync();
+        Texture::finalizeAsync();
+
+        // Stop the update thread and release the draws that have not been replayed.
+        if (_updateThread)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_updateThread->mutex);
+                _updateThread->active = false;
+            }
+            _updateThread->wake.notify_all();
+            _updateThread->thread.join();
+            SAFE_DELETE(_updateThread);
+            SAFE_DELETE(_commandList);
+        }
+
 		// Call user finalize
         finalize();
 
@@ -259,21 +440,49 @@ void Game::shutdown()
             SAFE_DELETE(gamepad);
         }
 
+        // Release the emitters that are still registered.
+        SAFE_DELETE(_particleSystem);
+        SAFE_DELETE(_spriteRenderer);
+
         _animationController->finalize();
         SAFE_DELETE(_animationController);
 
-        _audioController->finalize();
+        if (_audioInitialized)
+            _audioController->finalize();
         SAFE_DELETE(_audioController);
+        _audioInitialized = false;
 
-        _physicsController->finalize();
+        if (_physicsInitialized)
+            _physicsController->finalize();
         SAFE_DELETE(_physicsController);
+        _physicsInitialized = false;
         _aiController->finalize();
         SAFE_DELETE(_aiController);
+
+        // Finish reading texture levels and meshes before the worker threads are stopped.
+        _textureStreamer->finalize();
+        _meshStreamer->finalize();
+
+        _jobSystem->finalize();
+        SAFE_DELETE(_jobSystem);
+
+        // Save the configured capture once the worker threads have recorded their last markers.
+        Profiler::finalize();
         
         ControlFactory::finalize();
 
         Theme::finalize();
 
+        // Release the resources that the caches are keeping loaded.
+        Font::getCache()->clear();
+        Bundle::getCache()->clear();
+        Texture::getCache()->clear();
+        Effect::releasePrecompiled();
+        Effect::clearSourceCache();
+        SAFE_DELETE(_textureStreamer);
+        SAFE_DELETE(_meshStreamer);
+        TextureUploader::finalize();
+
         // Note: we do not clean up the script controller here
         // because users can call Game::exit() from a script.
 
@@ -284,6 +493,8 @@ void Game::shutdown()
 
         SAFE_DELETE(_properties);
 
+        FileSystem::unmountArchive();
+
 		_state = UNINITIALIZED;
     }
 }
@@ -299,8 +510,10 @@ void Game::pause()
         _state = PAUSED;
         _pausedTimeLast = Platform::getAbsoluteTime();
         _animationController->pause();
-        _audioController->pause();
-        _physicsController->pause();
+        if (_audioInitialized)
+            _audioController->pause();
+        if (_physicsInitialized)
+            _physicsController->pause();
         _aiController->pause();
     }
 
@@ -322,8 +535,10 @@ void Game::resume()
             _state = RUNNING;
             _pausedTimeTotal += Platform::getAbsoluteTime() - _pausedTimeLast;
             _animationController->resume();
-            _audioController->resume();
-            _physicsController->resume();
+            if (_audioInitialized)
+                _audioController->resume();
+            if (_physicsInitialized)
+                _physicsController->resume();
             _aiController->resume();
         }
     }
@@ -356,6 +571,19 @@ void Game::exit()
 
 void Game::frame()
 {
+    // Collect the markers and the render statistics of the last frame before this frame starts,
+    // and let the frame arenas reclaim the memory of the last frame.
+    Profiler::updateFrame();
+    RenderStats::endFrame();
+    FrameArena::nextFrame();
+    GP_PROFILE_SCOPE("Game::frame");
+
+    // Delete the GL objects that were released long enough ago that the GPU has drawn the frames that used them.
+    RenderState::deleteQueuedObjects();
+
+    // Deliver the screenshots whose pixels have been read back since the last frame.
+    FrameBuffer::updateScreenshots();
+
     if (!_initialized)
     {
         // Perform lazy first time initialization
@@ -372,7 +600,25 @@ void Game::frame()
 	double frameTime = getGameTime();
 
     // Fire time events to scheduled TimeListeners
-    fireTimeEvents(frameTime);
+    bool active = fireTimeEvents(frameTime) > 0;
+
+    // Continue the scenes that are loading in the background, and upload the textures that have been decoded.
+    SceneLoader::updateAsync();
+    Texture::updateAsync();
+
+    // Upload the texture levels that have been streamed in and request the ones that are needed next,
+    // and upload the meshes that have been streamed in and release the ones that are not drawn.
+    _textureStreamer->update();
+    _meshStreamer->update();
+
+    // In on demand mode, the frame is only rendered when something changed since the last one. The
+    // frame after a change is rendered as well, to draw the changes that were made while updating.
+    if (_invalidated.exchange(false))
+        active = true;
+    if (_animationController->getState() == AnimationController::RUNNING || _particleSystem->isActive())
+        active = true;
+    _frameRendered = !_renderOnDemand || active || _frameActive;
+    _frameActive = active;
 
     if (_state == Game::RUNNING)
     {
@@ -381,24 +627,44 @@ void Game::frame()
         GP_ASSERT(_physicsController);
         GP_ASSERT(_aiController);
 
-        // Update Time.
-        float elapsedTime = (frameTime - lastFrameTime);
+        // Update Time, evened out to the intervals of the paced frames.
+        float elapsedTime = (float)Platform::getPacedFrameTime(frameTime - lastFrameTime);
         lastFrameTime = frameTime;
+        if (_fixedFrameTime > 0.0f)
+            elapsedTime = _fixedFrameTime;
 
-        // Update the scheduled and running animations.
-        _animationController->update(elapsedTime);
+        // Route the messages that the script workers have posted to the agents.
+        ScriptWorker::update();
 
-        // Update the physics.
-        _physicsController->update(elapsedTime);
+        if (_updateThread)
+        {
+            // Replay the recorded draws of the last frame while the animations, physics and AI are updated.
+            startUpdate(elapsedTime);
+            if (_frameRendered)
+                _commandList->replay(false);
+            finishUpdate();
+        }
+        else
+        {
+            // Update the scheduled and running animations.
+            _animationController->update(elapsedTime);
 
-        // Update AI.
-        _aiController->update(elapsedTime);
+            // Update the physics.
+            if (_physicsInitialized)
+                _physicsController->update(elapsedTime);
+
+            // Update AI.
+            _aiController->update(elapsedTime);
+        }
 
         // Update gamepads.
         Gamepad::updateInternal(elapsedTime);
 
         // Application Update.
-        update(elapsedTime);
+        {
+            GP_PROFILE_SCOPE("Game::update");
+            update(elapsedTime);
+        }
 
         // Update forms.
         Form::updateInternal(elapsedTime);
@@ -407,24 +673,48 @@ void Game::frame()
         if (_scriptTarget)
             _scriptTarget->fireScriptEvent<void>(GP_GET_SCRIPT_EVENT(GameScriptTarget, update), elapsedTime);
 
+        // Update the registered particle emitters.
+        _particleSystem->update(elapsedTime);
+
         // Audio Rendering.
-        _audioController->update(elapsedTime);
+        if (_audioInitialized)
+            _audioController->update(elapsedTime);
 
-        // Graphics Rendering.
-        render(elapsedTime);
+        // Finish the jobs of this frame.
+        _jobSystem->finishFrame();
 
-        // Run script render.
-        if (_scriptTarget)
-            _scriptTarget->fireScriptEvent<void>(GP_GET_SCRIPT_EVENT(GameScriptTarget, render), elapsedTime);
+        // Graphics Rendering, unless the platform has no graphics context or nothing changed.
+        if (_frameRendered && !Platform::isHeadless())
+        {
+            GP_PROFILE_SCOPE("Game::render");
+            GP_PROFILE_GPU_SCOPE("Game::render");
+            beginRender();
+            render(elapsedTime);
+
+            // Run script render.
+            if (_scriptTarget)
+                _scriptTarget->fireScriptEvent<void>(GP_GET_SCRIPT_EVENT(GameScriptTarget, render), elapsedTime);
+
+            // Draw the 2D draws that are still collected.
+            endRender();
+
+            // The depth and stencil of the screen are not presented, so tiled GPUs do not have to store them.
+            if (FrameBuffer::getCurrent()->isDefault())
+                FrameBuffer::getCurrent()->invalidate(CLEAR_DEPTH_STENCIL);
+        }
 
         // Update FPS.
-        ++_frameCount;
+        if (_frameRendered)
+            ++_frameCount;
         if ((Game::getGameTime() - _frameLastFPS) >= 1000)
         {
             _frameRate = _frameCount;
             _frameCount = 0;
             _frameLastFPS = getGameTime();
         }
+
+        // Collect script garbage in the time left at the end of the frame.
+        _scriptController->collectGarbage();
     }
 	else if (_state == Game::PAUSED)
     {
@@ -441,12 +731,31 @@ void Game::frame()
         if (_scriptTarget)
             _scriptTarget->fireScriptEvent<void>(GP_GET_SCRIPT_EVENT(GameScriptTarget, update), 0);
 
-        // Graphics Rendering.
-        render(0);
+        // Finish the jobs of this frame.
+        _jobSystem->finishFrame();
 
-        // Script render.
-        if (_scriptTarget)
-            _scriptTarget->fireScriptEvent<void>(GP_GET_SCRIPT_EVENT(GameScriptTarget, render), 0);
+        // Graphics Rendering, unless the platform has no graphics context or nothing changed.
+        if (_frameRendered && !Platform::isHeadless())
+        {
+            GP_PROFILE_SCOPE("Game::render");
+            GP_PROFILE_GPU_SCOPE("Game::render");
+            beginRender();
+            render(0);
+
+            // Script render.
+            if (_scriptTarget)
+                _scriptTarget->fireScriptEvent<void>(GP_GET_SCRIPT_EVENT(GameScriptTarget, render), 0);
+
+            // Draw the 2D draws that are still collected.
+            endRender();
+
+            // The depth and stencil of the screen are not presented, so tiled GPUs do not have to store them.
+            if (FrameBuffer::getCurrent()->isDefault())
+                FrameBuffer::getCurrent()->invalidate(CLEAR_DEPTH_STENCIL);
+        }
+
+        // Collect script garbage in the time left at the end of the frame.
+        _scriptController->collectGarbage();
     }
 }
 
@@ -471,21 +780,52 @@ void Game::updateOnce()
 
     // Update the internal controllers.
     _animationController->update(elapsedTime);
-    _physicsController->update(elapsedTime);
+    if (_physicsInitialized)
+        _physicsController->update(elapsedTime);
     _aiController->update(elapsedTime);
-    _audioController->update(elapsedTime);
+    if (_audioInitialized)
+        _audioController->update(elapsedTime);
     if (_scriptTarget)
         _scriptTarget->fireScriptEvent<void>(GP_GET_SCRIPT_EVENT(GameScriptTarget, update), elapsedTime);
 }
 
+void Game::initializeAudio() const
+{
+    GP_ASSERT(_audioController);
+    _audioInitialized = true;
+    _audioController->initialize();
+}
+
+void Game::initializePhysics() const
+{
+    GP_ASSERT(_physicsController);
+    _physicsInitialized = true;
+    _physicsController->initialize();
+}
+
 void Game::setViewport(const Rectangle& viewport)
 {
     _viewport = viewport;
+    RenderCommandList* commands = RenderCommandList::getRecording();
+    if (commands)
+    {
+        commands->setViewport(viewport);
+        return;
+    }
+    if (Platform::isHeadless())
+        return;
     glViewport((GLuint)viewport.x, (GLuint)viewport.y, (GLuint)viewport.width, (GLuint)viewport.height);
 }
 
 void Game::clear(ClearFlags flags, const Vector4& clearColor, float clearDepth, int clearStencil)
 {
+    RenderCommandList* commands = RenderCommandList::getRecording();
+    if (commands)
+    {
+        commands->clear(flags, clearColor, clearDepth, clearStencil);
+        return;
+    }
+
     GLbitfield bits = 0;
     if (flags & CLEAR_COLOR)
     {
@@ -524,6 +864,11 @@ void Game::clear(ClearFlags flags, const Vector4& clearColor, float clearDepth,
         }
         bits |= GL_STENCIL_BUFFER_BIT;
     }
+
+    // Clearing the whole of an attachment replaces its contents, so tiled GPUs do not have to
+    // load them first. A scissored clear only replaces part of them.
+    if (!glIsEnabled(GL_SCISSOR_TEST))
+        FrameBuffer::getCurrent()->invalidate(bits);
     glClear(bits);
 }
 
@@ -709,11 +1054,16 @@ void Game::getArguments(int* argc, char*** argv) const
     Platform::getArguments(argc, argv);
 }
 
-void Game::schedule(float timeOffset, TimeListener* timeListener, void* cookie)
+unsigned int Game::schedule(float timeOffset, TimeListener* timeListener, void* cookie)
+{
+    GP_ASSERT(_timeEvents);
+    return _timeEvents->schedule(getGameTime() + timeOffset, timeListener, cookie);
+}
+
+bool Game::cancelSchedule(unsigned int handle)
 {
     GP_ASSERT(_timeEvents);
-    TimeEvent timeEvent(getGameTime() + timeOffset, timeListener, cookie);
-    _timeEvents->push(timeEvent);
+    return _timeEvents->cancel(handle);
 }
 
 void Game::schedule(float timeOffset, const char* function)
@@ -723,36 +1073,116 @@ void Game::schedule(float timeOffset, const char* function)
 
 void Game::clearSchedule()
 {
-    SAFE_DELETE(_timeEvents);
-    _timeEvents = new std::priority_queue<TimeEvent, std::vector<TimeEvent>, std::less<TimeEvent> >();
+    GP_ASSERT(_timeEvents);
+    _timeEvents->clear();
 }
 
-void Game::fireTimeEvents(double frameTime)
+void Game::startUpdate(float elapsedTime)
 {
-    while (_timeEvents->size() > 0)
+    GP_ASSERT(_updateThread);
+
     {
-        const TimeEvent* timeEvent = &_timeEvents->top();
-        if (timeEvent->time > frameTime)
-        {
+        std::lock_guard<std::mutex> lock(_updateThread->mutex);
+        GP_ASSERT(!_updateThread->pending);
+        _updateThread->elapsedTime = elapsedTime;
+        _updateThread->pending = true;
+    }
+    _updateThread->wake.notify_one();
+}
+
+void Game::finishUpdate()
+{
+    GP_ASSERT(_updateThread);
+
+    std::unique_lock<std::mutex> lock(_updateThread->mutex);
+    while (_updateThread->pending)
+        _updateThread->done.wait(lock);
+}
+
+void Game::updateThreadProc(Game* game)
+{
+    UpdateThread* thread = game->_updateThread;
+    GP_ASSERT(thread);
+    Profiler::setThreadName("Update");
+
+    std::unique_lock<std::mutex> lock(thread->mutex);
+    while (true)
+    {
+        while (thread->active && !thread->pending)
+            thread->wake.wait(lock);
+        if (!thread->active)
             break;
-        }
-        if (timeEvent->listener)
-        {
-            timeEvent->listener->timeEvent(frameTime - timeEvent->time, timeEvent->cookie);
-        }
-        _timeEvents->pop();
+
+        float elapsedTime = thread->elapsedTime;
+        lock.unlock();
+
+        // Update the scheduled and running animations.
+        game->_animationController->update(elapsedTime);
+
+        // Update the physics.
+        if (game->_physicsInitialized)
+            game->_physicsController->update(elapsedTime);
+
+        // Update AI.
+        game->_aiController->update(elapsedTime);
+
+        lock.lock();
+        thread->pending = false;
+        thread->done.notify_one();
+    }
+}
+
+void Game::beginRender()
+{
+    if (_commandList == NULL)
+        return;
+
+    // Draw the deferred commands of the last frame, now that the game state may be read again,
+    // and record the draws of this frame for the next one to replay.
+    _commandList->replay();
+    _commandList->reset();
+    _commandList->begin();
+}
+
+void Game::endRender()
+{
+    if (_commandList)
+    {
+        _commandList->call(&flushSprites, _spriteRenderer);
+        _commandList->end();
+    }
+    else
+    {
+        _spriteRenderer->flush();
     }
 }
 
-Game::TimeEvent::TimeEvent(double time, TimeListener* timeListener, void* cookie)
-    : time(time), listener(timeListener), cookie(cookie)
+unsigned int Game::fireTimeEvents(double frameTime)
 {
+    GP_ASSERT(_timeEvents);
+    return _timeEvents->fire(frameTime);
 }
 
-bool Game::TimeEvent::operator<(const TimeEvent& v) const
+void Game::invalidate()
 {
-    // The first element of std::priority_queue is the greatest.
-    return time > v.time;
+    _invalidated = true;
+    if (_renderOnDemand)
+        Platform::wakeUp();
+}
+
+double Game::getIdleTime() const
+{
+    GP_ASSERT(_timeEvents);
+
+    // Gamepads are polled by the platforms rather than waking them up, so they are polled at a
+    // steady interval while any are connected.
+    double idleTime = -1.0;
+    double nextTime = _timeEvents->getNextTime();
+    if (nextTime >= 0.0)
+        idleTime = std::max(0.0, nextTime - getGameTime());
+    if (Gamepad::getGamepadCount() > 0 && (idleTime < 0.0 || idleTime > GAME_IDLE_GAMEPAD_POLL_TIME))
+        idleTime = GAME_IDLE_GAMEPAD_POLL_TIME;
+    return idleTime;
 }
 
 Properties* Game::getConfig() const
@@ -778,6 +1208,23 @@ void Game::loadConfig()
             {
                 FileSystem::loadResourceAliases(aliases);
             }
+
+            // Mount pack archives.
+            Properties* archives = _properties->getNamespace("archives", true);
+            if (archives)
+            {
+                while (archives->getNextProperty() != NULL)
+                {
+                    FileSystem::mountArchive(archives->getString());
+                }
+            }
+
+            // Load the asset manifest.
+            const char* manifest = _properties->getString("manifest");
+            if (manifest)
+            {
+                FileSystem::loadManifest(manifest);
+            }
         }
         else
         {
@@ -10,15 +10,26 @@
 #include "AnimationController.h"
 #include "PhysicsController.h"
 #include "AIController.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "FrameArena.h"
+#include "MemoryStats.h"
+#include "TextureStreamer.h"
+#include "MeshStreamer.h"
+#include "ParticleSystem.h"
+#include "SpriteRenderer.h"
 #include "AudioListener.h"
 #include "Rectangle.h"
 #include "Vector4.h"
 #include "TimeListener.h"
+#include "TimerWheel.h"
 
 namespace gameplay
 {
 
 class ScriptController;
+class RenderCommandList;
 
 /**
  * Defines the base class your game will extend for game initialization, logic and platform delegates.
@@ -91,6 +102,46 @@ public:
      */
     static void setVsync(bool enable);
 
+    /**
+     * Gets whether vertical sync is adaptive when it is enabled.
+     *
+     * @return true if adaptive vsync is enabled; false if not.
+     * @script{ignore}
+     */
+    static bool isAdaptiveVsync();
+
+    /**
+     * Sets whether vertical sync is adaptive when it is enabled.
+     *
+     * With adaptive vsync, a frame that misses the vertical blank is presented at once
+     * instead of waiting for the next one. This can also be set with the adaptiveVsync
+     * property of the graphics namespace in the game config.
+     *
+     * @param enable true if adaptive vsync is enabled; false if not.
+     * @script{ignore}
+     */
+    static void setAdaptiveVsync(bool enable);
+
+    /**
+     * Gets the frame rate that the frames of the game are paced to.
+     *
+     * @return The frame rate in frames per second, or 0 if the frames are not paced.
+     * @script{ignore}
+     */
+    static unsigned int getTargetFrameRate();
+
+    /**
+     * Sets the frame rate that the frames of the game are paced to.
+     *
+     * Paced frames are presented at even intervals, and the games are updated by the exact
+     * interval while they keep up with it. This can also be set with the frameRate property
+     * of the graphics namespace in the game config.
+     *
+     * @param frameRate The frame rate in frames per second, or 0 to present the frames as soon as they are drawn.
+     * @script{ignore}
+     */
+    static void setTargetFrameRate(unsigned int frameRate);
+
     /**
      * Gets the total absolute running time (in milliseconds) since Game::run().
      * 
@@ -169,6 +220,93 @@ public:
      */
     inline unsigned int getFrameRate() const;
 
+    /**
+     * Gets the counters of the draw calls and state changes of the last frame.
+     *
+     * The counters can be checked against a budget with RenderStats::isWithin, or drawn
+     * on screen with RenderStats::draw.
+     *
+     * @return The render statistics of the last frame.
+     * @script{ignore}
+     */
+    inline const RenderStats& getRenderStats() const;
+
+    /**
+     * Gets the frame arena of the calling thread, for memory that is only used within the frame.
+     *
+     * The memory that a thread allocates from its arena is reclaimed after the frame ends,
+     * which is much cheaper than allocating temporary objects from the heap every frame.
+     *
+     * @return The frame arena of the calling thread.
+     * @script{ignore}
+     */
+    inline static FrameArena* getFrameArena();
+
+    /**
+     * Sets a fixed time that each frame is updated by, regardless of the time that has elapsed.
+     *
+     * This makes simulations and animations reproducible from run to run, for example for
+     * benchmarks and automated tests. The game time still advances in real time.
+     *
+     * @param elapsedTime The time to update each frame by, in milliseconds, or 0 to update
+     *      the frames by the time that has elapsed since the last frame.
+     * @script{ignore}
+     */
+    inline void setFixedFrameTime(float elapsedTime);
+
+    /**
+     * Gets the fixed time that each frame is updated by.
+     *
+     * @return The time to update each frame by, in milliseconds, or 0 if the frames are updated by
+     *      the time that has elapsed.
+     * @script{ignore}
+     */
+    inline float getFixedFrameTime() const;
+
+    /**
+     * Sets whether the frames of the game are only rendered when something changes.
+     *
+     * The frames are always updated, but in on demand mode they are only rendered and presented
+     * after input, while animations are running or particle emitters are active, in the frames
+     * where scheduled time events fire, after a form changes, and after invalidate() is called,
+     * as well as in the frame after each of these, to draw the changes made while updating.
+     * Between these frames the platform waits for the next input event or scheduled time event,
+     * so that an application whose screen is still, such as a tool or a menu, uses almost no CPU
+     * or GPU time. A game that changes its scene in update() by other means, for example with
+     * physics or with loaded content, must call invalidate() for each frame that it changes.
+     * This can also be set with the renderOnDemand property of the graphics namespace in the
+     * game config.
+     *
+     * @param enabled true to only render frames when something changes, false (the default) to
+     *      render every frame.
+     * @script{ignore}
+     */
+    inline void setRenderOnDemand(bool enabled);
+
+    /**
+     * Determines whether the frames of the game are only rendered when something changes.
+     *
+     * @return true if the frames are rendered on demand, false if every frame is rendered.
+     * @script{ignore}
+     */
+    inline bool isRenderOnDemand() const;
+
+    /**
+     * Requests that the next frame is rendered when the frames are rendered on demand.
+     *
+     * This can be called from any thread, and wakes up the platform if it is waiting for events.
+     * @script{ignore}
+     */
+    void invalidate();
+
+    /**
+     * Determines whether the last frame was rendered, so that the platform presents it.
+     *
+     * @return true if the last frame was rendered, false if it was skipped because nothing changed.
+     * @script{ignore}
+     */
+    inline bool isFrameRendered() const;
+
     /**
      * Gets the game window width.
      * 
@@ -233,6 +371,9 @@ public:
      * Gets the audio controller for managing control of audio
      * associated with the game.
      *
+     * The audio device is opened when the controller is first used, so games
+     * that play no sounds do not pay for it.
+     *
      * @return The audio controller for this game.
      */
     inline AudioController* getAudioController() const;
@@ -248,6 +389,9 @@ public:
     /**
      * Gets the physics controller for managing control of physics
      * associated with the game.
+     *
+     * The physics world is created when the controller is first used, so games
+     * without physics do not pay for it.
      * 
      * @return The physics controller for this game.
      */
@@ -261,6 +405,64 @@ public:
      */
     inline AIController* getAIController() const;
 
+    /**
+     * Gets the job system for running work on multiple threads.
+     *
+     * @return The job system for this game.
+     * @script{ignore}
+     */
+    inline JobSystem* getJobSystem() const;
+
+    /**
+     * Gets the texture streamer that loads the mipmap levels of textures as they are needed.
+     *
+     * @return The texture streamer for this game.
+     * @script{ignore}
+     */
+    inline TextureStreamer* getTextureStreamer() const;
+
+    /**
+     * Gets the mesh streamer that loads the vertex and index data of meshes as they are needed.
+     *
+     * @return The mesh streamer for this game.
+     * @script{ignore}
+     */
+    inline MeshStreamer* getMeshStreamer() const;
+
+    /**
+     * Gets the particle system that updates the particle emitters added to it.
+     *
+     * @return The particle system for this game.
+     * @script{ignore}
+     */
+    inline ParticleSystem* getParticleSystem() const;
+
+    /**
+     * Gets the sprite renderer that merges the draws of sprites, tile sets and text.
+     *
+     * @return The sprite renderer for this game.
+     * @script{ignore}
+     */
+    inline SpriteRenderer* getSpriteRenderer() const;
+
+    /**
+     * Determines if the render thread mode of the game is enabled.
+     *
+     * In render thread mode, the thread that runs the game and owns the graphics context
+     * replays the draws that were recorded by the last frame (see RenderCommandList) while
+     * the animations, physics and AI of the next frame are updated on an update thread. The
+     * draws of the frame are then recorded by render() for the next frame to replay. The
+     * mode is enabled with the renderThread property of the graphics section of the game
+     * configuration.
+     *
+     * The listeners that the animations, physics and AI call while they are updated must not
+     * use the graphics device in this mode. The frames are presented one frame later.
+     *
+     * @return true if the render thread mode is enabled, false otherwise.
+     * @script{ignore}
+     */
+    inline bool isRenderThreadEnabled() const;
+
     /**
      * Gets the script controller for managing control of Lua scripts
      * associated with the game.
@@ -588,9 +790,23 @@ public:
      * @param timeOffset The number of game milliseconds in the future to schedule the event to be fired.
      * @param timeListener The TimeListener that will receive the event.
      * @param cookie The cookie data that the time event will contain.
+     *
+     * @return The handle of the time event, which can be passed to cancelSchedule.
      * @script{ignore}
      */
-    void schedule(float timeOffset, TimeListener* timeListener, void* cookie = 0);
+    unsigned int schedule(float timeOffset, TimeListener* timeListener, void* cookie = 0);
+
+    /**
+     * Cancels a time event that was scheduled with a TimeListener, so that it is not fired.
+     *
+     * Cancelling an event takes constant time, however many events are scheduled.
+     *
+     * @param handle The handle returned by schedule.
+     *
+     * @return true if the event was cancelled, false if it was already fired or cancelled.
+     * @script{ignore}
+     */
+    bool cancelSchedule(unsigned int handle);
 
     /**
      * Schedules a time event to be sent to the given TimeListener a given number of game milliseconds from now.
@@ -684,18 +900,9 @@ private:
     };
 
     /**
-     * TimeEvent represents the event that is sent to TimeListeners as a result of calling Game::schedule().
+     * The update thread of the render thread mode.
      */
-    class TimeEvent
-    {
-    public:
-
-        TimeEvent(double time, TimeListener* timeListener, void* cookie);
-        bool operator<(const TimeEvent& v) const;
-        double time;
-        TimeListener* listener;
-        void* cookie;
-    };
+    struct UpdateThread;
 
     /**
      * Constructor.
@@ -718,8 +925,18 @@ private:
      * Fires the time events that were scheduled to be called.
      * 
      * @param frameTime The current game frame time. Used to determine which time events need to be fired.
+     *
+     * @return The number of time events that were fired.
+     */
+    unsigned int fireTimeEvents(double frameTime);
+
+    /**
+     * Returns how long the platform can wait for events before the next frame, when the last
+     * frame was not rendered.
+     *
+     * @return The time to wait, in milliseconds, or -1 to wait until the next event.
      */
-    void fireTimeEvents(double frameTime);
+    double getIdleTime() const;
 
     /**
      * Loads the game configuration.
@@ -731,6 +948,39 @@ private:
      */
     void loadGamepads();
 
+    /**
+     * Starts updating the animations, physics and AI of a frame on the update thread.
+     */
+    void startUpdate(float elapsedTime);
+
+    /**
+     * Waits for the update thread to finish the update that was started.
+     */
+    void finishUpdate();
+
+    /**
+     * Finishes the draws of the last frame and starts recording the draws of this frame
+     * in render thread mode.
+     */
+    void beginRender();
+
+    /**
+     * Stops recording the draws of this frame, in render thread mode.
+     */
+    void endRender();
+
+    static void updateThreadProc(Game* game);
+
+    /**
+     * Opens the audio device the first time that the audio controller is used.
+     */
+    void initializeAudio() const;
+
+    /**
+     * Creates the physics world the first time that the physics controller is used.
+     */
+    void initializePhysics() const;
+
     void keyEventInternal(Keyboard::KeyEvent evt, int key);
     void touchEventInternal(Touch::TouchEvent evt, int x, int y, unsigned int contactIndex);
     bool mouseEventInternal(Mouse::MouseEvent evt, int x, int y, int wheelDelta);
@@ -751,6 +1001,11 @@ private:
     double _frameLastFPS;                       // The last time the frame count was updated.
     unsigned int _frameCount;                   // The current frame count.
     unsigned int _frameRate;                    // The current frame rate.
+    float _fixedFrameTime;                      // The time that each frame is updated by, or 0 to use the elapsed time.
+    bool _renderOnDemand;                       // Whether frames are only rendered when something changes.
+    bool _frameActive;                          // Whether something changed in the last frame.
+    bool _frameRendered;                        // Whether the last frame was rendered.
+    std::atomic<bool> _invalidated;             // Whether the next frame must be rendered.
     unsigned int _width;                        // The game's display width.
     unsigned int _height;                       // The game's display height.
     Rectangle _viewport;                        // the games's current viewport.
@@ -760,10 +1015,19 @@ private:
     Properties* _properties;                    // Game configuration properties object.
     AnimationController* _animationController;  // Controls the scheduling and running of animations.
     AudioController* _audioController;          // Controls audio sources that are playing in the game.
+    mutable bool _audioInitialized;             // Whether the audio device has been opened.
     PhysicsController* _physicsController;      // Controls the simulation of a physics scene and entities.
+    mutable bool _physicsInitialized;           // Whether the physics world has been created.
     AIController* _aiController;                // Controls AI simulation.
+    JobSystem* _jobSystem;                      // Runs jobs on the worker threads.
+    TextureStreamer* _textureStreamer;          // Streams the mipmap levels of textures.
+    MeshStreamer* _meshStreamer;                // Streams the vertex and index data of meshes.
+    ParticleSystem* _particleSystem;            // Updates the registered particle emitters.
+    SpriteRenderer* _spriteRenderer;            // Merges the draws of 2D drawables.
+    UpdateThread* _updateThread;                // Updates the animations, physics and AI in render thread mode.
+    RenderCommandList* _commandList;            // The draws recorded by the last frame in render thread mode.
     AudioListener* _audioListener;              // The audio listener in 3D space.
-    std::priority_queue<TimeEvent, std::vector<TimeEvent>, std::less<TimeEvent> >* _timeEvents;     // Contains the scheduled time events.
+    TimerWheel* _timeEvents;                    // Contains the scheduled time events.
     ScriptController* _scriptController;            // Controls the scripting engine.
     ScriptTarget* _scriptTarget;                // Script target for the game
 
@@ -19,6 +19,42 @@ inline unsigned int Game::getFrameRate() const
     return _frameRate;
 }
 
+inline const RenderStats& Game::getRenderStats() const
+{
+    return RenderStats::getLastFrame();
+}
+
+inline FrameArena* Game::getFrameArena()
+{
+    return FrameArena::getCurrent();
+}
+
+inline void Game::setFixedFrameTime(float elapsedTime)
+{
+    _fixedFrameTime = elapsedTime;
+}
+
+inline float Game::getFixedFrameTime() const
+{
+    return _fixedFrameTime;
+}
+
+inline void Game::setRenderOnDemand(bool enabled)
+{
+    _renderOnDemand = enabled;
+    _invalidated = true;
+}
+
+inline bool Game::isRenderOnDemand() const
+{
+    return _renderOnDemand;
+}
+
+inline bool Game::isFrameRendered() const
+{
+    return _frameRendered;
+}
+
 inline unsigned int Game::getWidth() const
 {
     return _width;
@@ -46,11 +82,15 @@ inline AnimationController* Game::getAnimationController() const
 
 inline AudioController* Game::getAudioController() const
 {
+    if (_audioController && !_audioInitialized)
+        initializeAudio();
     return _audioController;
 }
 
 inline PhysicsController* Game::getPhysicsController() const
 {
+    if (_physicsController && !_physicsInitialized)
+        initializePhysics();
     return _physicsController;
 }
 
@@ -63,6 +103,36 @@ inline AIController* Game::getAIController() const
     return _aiController;
 }
 
+inline JobSystem* Game::getJobSystem() const
+{
+    return _jobSystem;
+}
+
+inline TextureStreamer* Game::getTextureStreamer() const
+{
+    return _textureStreamer;
+}
+
+inline MeshStreamer* Game::getMeshStreamer() const
+{
+    return _meshStreamer;
+}
+
+inline ParticleSystem* Game::getParticleSystem() const
+{
+    return _particleSystem;
+}
+
+inline SpriteRenderer* Game::getSpriteRenderer() const
+{
+    return _spriteRenderer;
+}
+
+inline bool Game::isRenderThreadEnabled() const
+{
+    return _updateThread != NULL;
+}
+
 template <class T>
 void Game::renderOnce(T* instance, void (T::*method)(void*), void* cookie)
 {
@@ -0,0 +1,343 @@
+#include "Base.h"
+#include "GlyphCache.h"
+#include "FileSystem.h"
+
+#ifdef GP_USE_FREETYPE
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#endif
+
+// The number of transparent pixels between the cells of a page, so that filtering does not bleed between glyphs
+#define GLYPH_CACHE_CELL_PADDING 1
+// The number of cells that a page is sized to hold, if it fits into the largest page
+#define GLYPH_CACHE_CELL_COUNT 512
+// The smallest and the largest width and height of a page
+#define GLYPH_CACHE_MIN_PAGE_SIZE 128
+#define GLYPH_CACHE_MAX_PAGE_SIZE 2048
+
+namespace gameplay
+{
+
+#ifdef GP_USE_FREETYPE
+
+/**
+ * Rasterizes the glyphs of a font file with FreeType.
+ */
+class FreeTypeRasterizer : public GlyphCache::Rasterizer
+{
+public:
+
+    static FreeTypeRasterizer* create(const char* path)
+    {
+        int dataSize = 0;
+        char* data = FileSystem::readAll(path, &dataSize);
+        if (data == NULL)
+        {
+            GP_WARN("Failed to read font file '%s'.", path);
+            return NULL;
+        }
+
+        FT_Library library;
+        FT_Error error = FT_Init_FreeType(&library);
+        if (error)
+        {
+            GP_WARN("Failed to initialize FreeType (error %d).", error);
+            SAFE_DELETE_ARRAY(data);
+            return NULL;
+        }
+
+        // FreeType reads the glyphs from the file data as they are loaded, so it is kept until the face is done.
+        FT_Face face;
+        error = FT_New_Memory_Face(library, (const FT_Byte*)data, dataSize, 0, &face);
+        if (error)
+        {
+            GP_WARN("Failed to load font file '%s' (error %d).", path, error);
+            FT_Done_FreeType(library);
+            SAFE_DELETE_ARRAY(data);
+            return NULL;
+        }
+
+        FreeTypeRasterizer* rasterizer = new FreeTypeRasterizer();
+        rasterizer->_library = library;
+        rasterizer->_face = face;
+        rasterizer->_data = data;
+        return rasterizer;
+    }
+
+    bool rasterize(int character, unsigned int size, unsigned char* cell, unsigned int cellWidth,
+                   unsigned int cellHeight, Metrics* metrics)
+    {
+        GP_ASSERT(cell);
+        GP_ASSERT(metrics);
+
+        if (size != _size)
+        {
+            if (FT_Set_Pixel_Sizes(_face, 0, size))
+                return false;
+            _size = size;
+        }
+
+        FT_UInt index = FT_Get_Char_Index(_face, (FT_ULong)character);
+        if (index == 0 || FT_Load_Glyph(_face, index, FT_LOAD_RENDER))
+            return false;
+
+        // Place the baseline so that the ascender and the descender of the font fit into the font size.
+        const FT_Size_Metrics& sizeMetrics = _face->size->metrics;
+        int ascender = (int)(sizeMetrics.ascender >> 6);
+        int lineHeight = ascender - (int)(sizeMetrics.descender >> 6);
+        int baseline = lineHeight > 0 ? ascender * (int)size / lineHeight : (int)size;
+
+        FT_GlyphSlot slot = _face->glyph;
+        const FT_Bitmap& bitmap = slot->bitmap;
+        unsigned int width = std::min((unsigned int)bitmap.width, cellWidth);
+        for (unsigned int row = 0; row < (unsigned int)bitmap.rows; ++row)
+        {
+            int y = baseline - slot->bitmap_top + (int)row;
+            if (y < 0 || y >= (int)cellHeight)
+                continue;
+            const unsigned char* src = bitmap.pitch >= 0 ? bitmap.buffer + row * bitmap.pitch :
+                                                           bitmap.buffer + (bitmap.rows - 1 - row) * -bitmap.pitch;
+            memcpy(cell + y * cellWidth, src, width);
+        }
+
+        metrics->width = width;
+        metrics->bearingX = slot->bitmap_left;
+        metrics->advance = (unsigned int)(slot->advance.x >> 6);
+        return true;
+    }
+
+protected:
+
+    FreeTypeRasterizer()
+        : _library(NULL), _face(NULL), _data(NULL), _size(0)
+    {
+    }
+
+    ~FreeTypeRasterizer()
+    {
+        FT_Done_Face(_face);
+        FT_Done_FreeType(_library);
+        SAFE_DELETE_ARRAY(_data);
+    }
+
+private:
+
+    FT_Library _library;
+    FT_Face _face;
+    char* _data;
+    unsigned int _size;
+};
+
+#endif
+
+GlyphCache::Rasterizer::Rasterizer()
+{
+}
+
+GlyphCache::Rasterizer::~Rasterizer()
+{
+}
+
+GlyphCache::Rasterizer* GlyphCache::Rasterizer::create(const char* path)
+{
+    GP_ASSERT(path);
+
+#ifdef GP_USE_FREETYPE
+    return FreeTypeRasterizer::create(path);
+#else
+    GP_WARN("Failed to load font file '%s'; rasterizing font files requires GP_USE_FREETYPE.", path);
+    return NULL;
+#endif
+}
+
+GlyphCache::GlyphCache()
+    : _rasterizer(NULL), _texture(NULL), _size(0), _cellWidth(0), _cellHeight(0), _columns(0), _rows(0),
+      _glyphCount(0), _clock(0), _batch(0), _batchStarted(false), _generation(0), _warned(false)
+{
+}
+
+GlyphCache::~GlyphCache()
+{
+    SAFE_RELEASE(_texture);
+    SAFE_RELEASE(_rasterizer);
+}
+
+GlyphCache* GlyphCache::create(Rasterizer* rasterizer, unsigned int size)
+{
+    GP_ASSERT(rasterizer);
+    GP_ASSERT(size);
+
+    // Leave room for glyphs that are wider than they are tall.
+    unsigned int cellWidth = size + size / 4;
+    unsigned int cellHeight = size;
+    unsigned int strideX = cellWidth + GLYPH_CACHE_CELL_PADDING;
+    unsigned int strideY = cellHeight + GLYPH_CACHE_CELL_PADDING;
+
+    unsigned int pageSize = GLYPH_CACHE_MIN_PAGE_SIZE;
+    while (pageSize < GLYPH_CACHE_MAX_PAGE_SIZE && (pageSize / strideX) * (pageSize / strideY) < GLYPH_CACHE_CELL_COUNT)
+        pageSize *= 2;
+    unsigned int columns = pageSize / strideX;
+    unsigned int rows = pageSize / strideY;
+    if (columns == 0 || rows == 0)
+    {
+        GP_WARN("Font size %u is too large for a glyph cache page.", size);
+        return NULL;
+    }
+
+    std::vector<unsigned char> blank(pageSize * pageSize, 0);
+    Texture* texture = Texture::create(Texture::ALPHA, pageSize, pageSize, &blank[0], false);
+    if (texture == NULL)
+    {
+        GP_WARN("Failed to create glyph cache texture of size %u.", pageSize);
+        return NULL;
+    }
+
+    GlyphCache* cache = new GlyphCache();
+    cache->_rasterizer = rasterizer;
+    rasterizer->addRef();
+    cache->_texture = texture;
+    cache->_size = size;
+    cache->_cellWidth = cellWidth;
+    cache->_cellHeight = cellHeight;
+    cache->_columns = columns;
+    cache->_rows = rows;
+    cache->_cellCharacters.resize(columns * rows, -1);
+    cache->_cellUses.resize(columns * rows, 0);
+    cache->_cellBatches.resize(columns * rows, 0);
+    cache->_pixels.resize(cellWidth * cellHeight);
+    return cache;
+}
+
+Texture* GlyphCache::getTexture() const
+{
+    return _texture;
+}
+
+unsigned int GlyphCache::getSize() const
+{
+    return _size;
+}
+
+unsigned int GlyphCache::getCellCount() const
+{
+    return _columns * _rows;
+}
+
+unsigned int GlyphCache::getGlyphCount() const
+{
+    return _glyphCount;
+}
+
+unsigned int GlyphCache::getGeneration() const
+{
+    return _generation;
+}
+
+const Font::Glyph* GlyphCache::getGlyph(int character)
+{
+    ++_clock;
+
+    std::map<int, Entry>::iterator itr = _entries.find(character);
+    if (itr != _entries.end())
+    {
+        if (itr->second.cell < 0)
+            return NULL;
+        useCell(itr->second.cell);
+        return &itr->second.glyph;
+    }
+
+    // Rasterize the glyph before making room for it, since the font may not have it.
+    Entry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.cell = -1;
+    entry.glyph.code = (unsigned int)character;
+    std::fill(_pixels.begin(), _pixels.end(), 0);
+    Rasterizer::Metrics metrics;
+    if (!_rasterizer->rasterize(character, _size, &_pixels[0], _cellWidth, _cellHeight, &metrics))
+    {
+        _entries[character] = entry;
+        return NULL;
+    }
+
+    int cell = allocateCell();
+    if (cell < 0)
+    {
+        if (!_warned)
+        {
+            GP_WARN("The glyph cache of font size %u is too small for the glyphs drawn at once; some are not drawn.", _size);
+            _warned = true;
+        }
+        return NULL;
+    }
+
+    unsigned int x = (cell % _columns) * (_cellWidth + GLYPH_CACHE_CELL_PADDING);
+    unsigned int y = (cell / _columns) * (_cellHeight + GLYPH_CACHE_CELL_PADDING);
+    _texture->setData(&_pixels[0], x, y, _cellWidth, _cellHeight);
+
+    const float pageWidth = (float)_texture->getWidth();
+    const float pageHeight = (float)_texture->getHeight();
+    entry.cell = cell;
+    entry.glyph.width = metrics.width;
+    entry.glyph.bearingX = metrics.bearingX;
+    entry.glyph.advance = metrics.advance;
+    entry.glyph.uvs[0] = x / pageWidth;
+    entry.glyph.uvs[1] = y / pageHeight;
+    entry.glyph.uvs[2] = (x + metrics.width) / pageWidth;
+    entry.glyph.uvs[3] = (y + _cellHeight) / pageHeight;
+
+    _cellCharacters[cell] = character;
+    useCell(cell);
+    return &(_entries[character] = entry).glyph;
+}
+
+void GlyphCache::touch(float u, float v)
+{
+    int column = (int)(u * _texture->getWidth()) / (int)(_cellWidth + GLYPH_CACHE_CELL_PADDING);
+    int row = (int)(v * _texture->getHeight()) / (int)(_cellHeight + GLYPH_CACHE_CELL_PADDING);
+    if (column >= 0 && column < (int)_columns && row >= 0 && row < (int)_rows)
+    {
+        int cell = row * (int)_columns + column;
+        if (cell < (int)_glyphCount)
+            useCell(cell);
+    }
+}
+
+void GlyphCache::startBatch()
+{
+    ++_batch;
+    _batchStarted = true;
+}
+
+void GlyphCache::finishBatch()
+{
+    _batchStarted = false;
+}
+
+int GlyphCache::allocateCell()
+{
+    // Cells are filled in order, and evicted cells are reused right away, so the free cells are always the last ones.
+    if (_glyphCount < _cellCharacters.size())
+        return (int)_glyphCount++;
+
+    int oldest = -1;
+    for (int i = 0, count = (int)_cellCharacters.size(); i < count; ++i)
+    {
+        if (!(_batchStarted && _cellBatches[i] == _batch) && (oldest < 0 || _cellUses[i] < _cellUses[oldest]))
+            oldest = i;
+    }
+    if (oldest >= 0)
+    {
+        _entries.erase(_cellCharacters[oldest]);
+        _cellCharacters[oldest] = -1;
+        ++_generation;
+    }
+    return oldest;
+}
+
+void GlyphCache::useCell(int cell)
+{
+    _cellUses[cell] = _clock;
+    _cellBatches[cell] = _batch;
+}
+
+}
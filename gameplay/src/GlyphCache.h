@@ -0,0 +1,232 @@
+#ifndef GLYPHCACHE_H_
+#define GLYPHCACHE_H_
+
+#include "Ref.h"
+#include "Font.h"
+#include "Texture.h"
+
+namespace gameplay
+{
+
+/**
+ * Defines an atlas of glyphs that are rasterized when they are first needed.
+ *
+ * The glyphs of a font for which no glyph texture was encoded, such as a font created from a
+ * TrueType file, are rasterized at one size into the cells of an alpha texture page, where each
+ * cell is as tall as the font size. When the page is full, the glyph that was used the longest
+ * time ago is evicted to make room, except for the glyphs that are drawn by the batch that the
+ * font has started, whose quads are still waiting to be drawn. Evicting a glyph changes the
+ * generation of the cache, which lets laid out text know that its quads must be rebuilt.
+ *
+ * @script{ignore}
+ */
+class GlyphCache : public Ref
+{
+    friend class Font;
+
+public:
+
+    /**
+     * Defines the rasterization of the glyphs of a font file.
+     */
+    class Rasterizer : public Ref
+    {
+    public:
+
+        /**
+         * The metrics of a rasterized glyph, in pixels.
+         */
+        struct Metrics
+        {
+            unsigned int width;
+            int bearingX;
+            unsigned int advance;
+        };
+
+        /**
+         * Creates a rasterizer for a font file.
+         *
+         * Rasterizing font files requires FreeType, which the runtime is only built with when
+         * GP_USE_FREETYPE is defined.
+         *
+         * @param path The path of a TrueType or OpenType font file.
+         *
+         * @return The new rasterizer, or NULL if the font could not be loaded.
+         */
+        static Rasterizer* create(const char* path);
+
+        /**
+         * Rasterizes a glyph into a cell of 8 bit alpha values.
+         *
+         * The glyph is placed on the baseline of the font size within the cell, starting at its left edge.
+         *
+         * @param character The unicode code point of the glyph.
+         * @param size The font size, in pixels.
+         * @param cell The cleared cell to rasterize into.
+         * @param cellWidth The width of the cell, in pixels.
+         * @param cellHeight The height of the cell, in pixels.
+         * @param metrics Set to the metrics of the glyph, with a width of at most the cell width.
+         *
+         * @return false if the font has no glyph for the character, true otherwise.
+         */
+        virtual bool rasterize(int character, unsigned int size, unsigned char* cell, unsigned int cellWidth,
+                               unsigned int cellHeight, Metrics* metrics) = 0;
+
+    protected:
+
+        /**
+         * Constructor.
+         */
+        Rasterizer();
+
+        /**
+         * Destructor.
+         */
+        virtual ~Rasterizer();
+
+    private:
+
+        /**
+         * Hidden copy constructor.
+         */
+        Rasterizer(const Rasterizer& copy);
+
+        /**
+         * Hidden copy assignment operator.
+         */
+        Rasterizer& operator=(const Rasterizer&);
+    };
+
+    /**
+     * Creates a glyph cache for one size of a font.
+     *
+     * @param rasterizer The rasterizer of the font file.
+     * @param size The font size, in pixels.
+     *
+     * @return The new glyph cache, or NULL if its texture could not be created.
+     */
+    static GlyphCache* create(Rasterizer* rasterizer, unsigned int size);
+
+    /**
+     * Returns the texture page that the glyphs are rasterized into.
+     *
+     * @return The texture page.
+     */
+    Texture* getTexture() const;
+
+    /**
+     * Returns the font size that the glyphs are rasterized at.
+     *
+     * @return The font size, in pixels.
+     */
+    unsigned int getSize() const;
+
+    /**
+     * Returns the number of glyphs that fit into the texture page.
+     *
+     * @return The number of cells of the page.
+     */
+    unsigned int getCellCount() const;
+
+    /**
+     * Returns the number of glyphs that are currently rasterized into the texture page.
+     *
+     * @return The number of used cells of the page.
+     */
+    unsigned int getGlyphCount() const;
+
+    /**
+     * Returns the generation of the cache, which changes every time that a glyph is evicted.
+     *
+     * @return The generation of the cache.
+     */
+    unsigned int getGeneration() const;
+
+private:
+
+    /**
+     * A glyph that has been looked up, and the cell it is rasterized into, or -1 if the font has no such glyph.
+     */
+    struct Entry
+    {
+        Font::Glyph glyph;
+        int cell;
+    };
+
+    /**
+     * Constructor.
+     */
+    GlyphCache();
+
+    /**
+     * Hidden copy constructor.
+     */
+    GlyphCache(const GlyphCache& copy);
+
+    /**
+     * Destructor.
+     */
+    ~GlyphCache();
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    GlyphCache& operator=(const GlyphCache&);
+
+    /**
+     * Returns a glyph, rasterizing it if it is not in the texture page.
+     *
+     * @return The glyph, or NULL if the font has no glyph for the character or every cell is used by the started batch.
+     */
+    const Font::Glyph* getGlyph(int character);
+
+    /**
+     * Marks the glyph of a quad that was laid out before as used by the started batch.
+     *
+     * @param u The horizontal texture coordinate of a corner of the quad.
+     * @param v The vertical texture coordinate of a corner of the quad.
+     */
+    void touch(float u, float v);
+
+    /**
+     * Starts protecting the glyphs that are used from eviction, until the batch is finished.
+     */
+    void startBatch();
+
+    /**
+     * Stops protecting the glyphs used by the batch, once their quads have been drawn.
+     */
+    void finishBatch();
+
+    /**
+     * Returns the cell that the next glyph is rasterized into, evicting a glyph if needed.
+     *
+     * @return The cell, or -1 if every cell is used by the started batch.
+     */
+    int allocateCell();
+
+    void useCell(int cell);
+
+    Rasterizer* _rasterizer;
+    Texture* _texture;
+    unsigned int _size;
+    unsigned int _cellWidth;
+    unsigned int _cellHeight;
+    unsigned int _columns;
+    unsigned int _rows;
+    std::map<int, Entry> _entries;
+    std::vector<int> _cellCharacters;
+    std::vector<unsigned int> _cellUses;
+    std::vector<unsigned int> _cellBatches;
+    std::vector<unsigned char> _pixels;
+    unsigned int _glyphCount;
+    unsigned int _clock;
+    unsigned int _batch;
+    bool _batchStarted;
+    unsigned int _generation;
+    bool _warned;
+};
+
+}
+
+#endif
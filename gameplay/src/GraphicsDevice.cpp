@@ -0,0 +1,52 @@
+#include "Base.h"
+#include "GraphicsDevice.h"
+#include "GraphicsDeviceGL.h"
+#include "RenderStats.h"
+
+namespace gameplay
+{
+
+static GraphicsDevice* __currentDevice = NULL;
+
+GraphicsDevice::GraphicsDevice()
+{
+}
+
+GraphicsDevice::~GraphicsDevice()
+{
+    if (__currentDevice == this)
+        __currentDevice = NULL;
+}
+
+GraphicsDevice* GraphicsDevice::getCurrent()
+{
+    // The device lives as long as the graphics context, which the process keeps until it exits.
+    if (__currentDevice == NULL)
+        __currentDevice = new GraphicsDeviceGL();
+    return __currentDevice;
+}
+
+bool GraphicsDevice::isSupported(Feature feature)
+{
+    return getCurrent()->supports(feature);
+}
+
+void GraphicsDevice::drawArrays(GLenum primitiveType, unsigned int first, unsigned int count, unsigned int instances)
+{
+    RenderStats::countDraw(primitiveType, count, instances);
+    getCurrent()->submitArrays(primitiveType, first, count, instances);
+}
+
+void GraphicsDevice::drawElements(GLenum primitiveType, unsigned int count, GLenum indexFormat, const void* indices, unsigned int instances)
+{
+    RenderStats::countDraw(primitiveType, count, instances);
+    getCurrent()->submitElements(primitiveType, count, indexFormat, indices, 0, instances);
+}
+
+void GraphicsDevice::drawElementsBaseVertex(GLenum primitiveType, unsigned int count, GLenum indexFormat, const void* indices, int baseVertex)
+{
+    RenderStats::countDraw(primitiveType, count);
+    getCurrent()->submitElements(primitiveType, count, indexFormat, indices, baseVertex, 1);
+}
+
+}
@@ -0,0 +1,149 @@
+#ifndef GRAPHICSDEVICE_H_
+#define GRAPHICSDEVICE_H_
+
+namespace gameplay
+{
+
+/**
+ * Defines the interface that the engine submits its draws to the graphics API through.
+ *
+ * The drawables of the engine (models, instanced models, mesh batches, sprites, tile sets,
+ * impostors, particle emitters and skins) issue their draws through the static methods of this
+ * class, which count them in the RenderStats and pass them to the device of the backend that
+ * the game runs on. The draws are described with the values of the Mesh enumerations, which are
+ * also the ones of OpenGL, so that a backend for another API translates them where it records
+ * its commands, rather than at each of the drawables.
+ *
+ * OpenGL is the only backend (see GraphicsDeviceGL), and the rest of the state of a draw (the
+ * vertex arrays, the buffers, the textures, the effects and the render state) is still bound
+ * through OpenGL by the classes that own it, so this is the first step of moving that state
+ * behind the device as well.
+ *
+ * The device must only be used from the thread that owns the graphics context.
+ *
+ * @script{ignore}
+ */
+class GraphicsDevice
+{
+public:
+
+    /**
+     * The graphics APIs that a device can be implemented with.
+     */
+    enum Backend
+    {
+        OPENGL
+    };
+
+    /**
+     * The optional features of a device.
+     */
+    enum Feature
+    {
+        /** Draws of several instances, with per-instance vertex attributes. */
+        INSTANCING,
+        /** Indexed draws that offset the indices by a base vertex. */
+        BASE_VERTEX
+    };
+
+    /**
+     * Destructor.
+     */
+    virtual ~GraphicsDevice();
+
+    /**
+     * Returns the device that the draws are submitted to, which is created the first time it is used.
+     *
+     * @return The current device.
+     */
+    static GraphicsDevice* getCurrent();
+
+    /**
+     * Returns the graphics API that the device is implemented with.
+     *
+     * @return The backend of the device.
+     */
+    virtual Backend getBackend() const = 0;
+
+    /**
+     * Determines whether the current device supports an optional feature.
+     *
+     * @param feature The feature.
+     *
+     * @return true if the feature is supported, false otherwise.
+     */
+    static bool isSupported(Feature feature);
+
+    /**
+     * Draws primitives from consecutive vertices of the bound vertex arrays.
+     *
+     * @param primitiveType The type of primitives to draw (a Mesh::PrimitiveType, or GL_LINE_LOOP).
+     * @param first The index of the first vertex.
+     * @param count The number of vertices.
+     * @param instances The number of instances to draw, which must be 1 if INSTANCING is not supported.
+     */
+    static void drawArrays(GLenum primitiveType, unsigned int first, unsigned int count, unsigned int instances = 1);
+
+    /**
+     * Draws primitives from the vertices referenced by indices.
+     *
+     * @param primitiveType The type of primitives to draw (a Mesh::PrimitiveType, or GL_LINE_LOOP).
+     * @param count The number of indices.
+     * @param indexFormat The format of the indices (a Mesh::IndexFormat).
+     * @param indices The offset of the first index in the bound index buffer, in bytes, or the
+     *      indices in memory if no index buffer is bound.
+     * @param instances The number of instances to draw, which must be 1 if INSTANCING is not supported.
+     */
+    static void drawElements(GLenum primitiveType, unsigned int count, GLenum indexFormat, const void* indices, unsigned int instances = 1);
+
+    /**
+     * Draws primitives from the vertices referenced by indices, which are offset by a base vertex.
+     *
+     * This can only be used if BASE_VERTEX is supported.
+     *
+     * @param primitiveType The type of primitives to draw (a Mesh::PrimitiveType).
+     * @param count The number of indices.
+     * @param indexFormat The format of the indices (a Mesh::IndexFormat).
+     * @param indices The offset of the first index in the bound index buffer, in bytes.
+     * @param baseVertex The number added to each index.
+     */
+    static void drawElementsBaseVertex(GLenum primitiveType, unsigned int count, GLenum indexFormat, const void* indices, int baseVertex);
+
+protected:
+
+    /**
+     * Constructor.
+     */
+    GraphicsDevice();
+
+    /**
+     * Determines whether the device supports an optional feature.
+     */
+    virtual bool supports(Feature feature) const = 0;
+
+    /**
+     * Submits a draw of consecutive vertices.
+     */
+    virtual void submitArrays(GLenum primitiveType, unsigned int first, unsigned int count, unsigned int instances) = 0;
+
+    /**
+     * Submits an indexed draw.
+     */
+    virtual void submitElements(GLenum primitiveType, unsigned int count, GLenum indexFormat, const void* indices, int baseVertex, unsigned int instances) = 0;
+
+private:
+
+    /**
+     * Hidden copy constructor.
+     */
+    GraphicsDevice(const GraphicsDevice& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    GraphicsDevice& operator=(const GraphicsDevice&);
+};
+
+}
+
+#endif
@@ -0,0 +1,62 @@
+#include "Base.h"
+#include "GraphicsDeviceGL.h"
+
+namespace gameplay
+{
+
+GraphicsDeviceGL::GraphicsDeviceGL()
+{
+}
+
+GraphicsDeviceGL::~GraphicsDeviceGL()
+{
+}
+
+GraphicsDevice::Backend GraphicsDeviceGL::getBackend() const
+{
+    return OPENGL;
+}
+
+bool GraphicsDeviceGL::supports(Feature feature) const
+{
+    switch (feature)
+    {
+    case INSTANCING:
+        return glDrawElementsInstanced && glDrawArraysInstanced && glVertexAttribDivisor;
+    case BASE_VERTEX:
+        return glDrawElementsBaseVertex != NULL;
+    default:
+        return false;
+    }
+}
+
+void GraphicsDeviceGL::submitArrays(GLenum primitiveType, unsigned int first, unsigned int count, unsigned int instances)
+{
+    if (instances == 1)
+    {
+        GL_ASSERT( glDrawArrays(primitiveType, (GLint)first, (GLsizei)count) );
+    }
+    else
+    {
+        GL_ASSERT( glDrawArraysInstanced(primitiveType, (GLint)first, (GLsizei)count, (GLsizei)instances) );
+    }
+}
+
+void GraphicsDeviceGL::submitElements(GLenum primitiveType, unsigned int count, GLenum indexFormat, const void* indices, int baseVertex, unsigned int instances)
+{
+    if (baseVertex != 0)
+    {
+        GP_ASSERT(instances == 1);
+        GL_ASSERT( glDrawElementsBaseVertex(primitiveType, (GLsizei)count, indexFormat, (GLvoid*)indices, baseVertex) );
+    }
+    else if (instances == 1)
+    {
+        GL_ASSERT( glDrawElements(primitiveType, (GLsizei)count, indexFormat, indices) );
+    }
+    else
+    {
+        GL_ASSERT( glDrawElementsInstanced(primitiveType, (GLsizei)count, indexFormat, indices, (GLsizei)instances) );
+    }
+}
+
+}
@@ -0,0 +1,60 @@
+#ifndef GRAPHICSDEVICEGL_H_
+#define GRAPHICSDEVICEGL_H_
+
+#include "GraphicsDevice.h"
+
+namespace gameplay
+{
+
+/**
+ * Defines the OpenGL and OpenGL ES backend of the graphics device.
+ *
+ * The draws are issued immediately on the current GL context. Instancing and base vertex draws
+ * are supported when the context provides their entry points.
+ *
+ * @script{ignore}
+ */
+class GraphicsDeviceGL : public GraphicsDevice
+{
+    friend class GraphicsDevice;
+
+public:
+
+    /**
+     * @see GraphicsDevice::getBackend
+     */
+    Backend getBackend() const;
+
+protected:
+
+    /**
+     * @see GraphicsDevice::supports
+     */
+    bool supports(Feature feature) const;
+
+    /**
+     * @see GraphicsDevice::submitArrays
+     */
+    void submitArrays(GLenum primitiveType, unsigned int first, unsigned int count, unsigned int instances);
+
+    /**
+     * @see GraphicsDevice::submitElements
+     */
+    void submitElements(GLenum primitiveType, unsigned int count, GLenum indexFormat, const void* indices, int baseVertex, unsigned int instances);
+
+private:
+
+    /**
+     * Constructor.
+     */
+    GraphicsDeviceGL();
+
+    /**
+     * Destructor.
+     */
+    ~GraphicsDeviceGL();
+};
+
+}
+
+#endif
@@ -2,6 +2,8 @@
 #include "HeightField.h"
 #include "Image.h"
 #include "FileSystem.h"
+#include "BoundingBox.h"
+#include "SimdMath.h"
 
 namespace gameplay
 {
@@ -164,42 +166,246 @@ float* HeightField::getArray() const
     return _array;
 }
 
-float HeightField::getHeight(float column, float row) const
+void HeightField::getCorners(float column, float row, float* h00, float* h10, float* h01, float* h11, float* xFactor, float* yFactor) const
 {
     // Clamp to heightfield boundaries
     column = column < 0 ? 0 : (column > (_cols-1) ? (_cols-1) : column);
     row = row < 0 ? 0 : (row > (_rows-1) ? (_rows-1) : row);
 
-    unsigned int x1 = column;
-    unsigned int y1 = row;
-    unsigned int x2 = x1 + 1;
-    unsigned int y2 = y1 + 1;
-    float tmp;
-    float xFactor = modf(column, &tmp);
-    float yFactor = modf(row, &tmp);
-    float xFactorI = 1.0f - xFactor;
-    float yFactorI = 1.0f - yFactor;
-
-    if (x2 >= _cols && y2 >= _rows)
+    // Points on the last column or row are placed at the far side of the cell before it, so that
+    // the surface has a slope there too.
+    unsigned int x1 = std::min((unsigned int)column, _cols > 1 ? _cols - 2 : 0);
+    unsigned int y1 = std::min((unsigned int)row, _rows > 1 ? _rows - 2 : 0);
+    unsigned int x2 = std::min(x1 + 1, _cols - 1);
+    unsigned int y2 = std::min(y1 + 1, _rows - 1);
+    *h00 = _array[x1 + y1 * _cols];
+    *h10 = _array[x2 + y1 * _cols];
+    *h01 = _array[x1 + y2 * _cols];
+    *h11 = _array[x2 + y2 * _cols];
+    *xFactor = x2 > x1 ? column - x1 : 0.0f;
+    *yFactor = y2 > y1 ? row - y1 : 0.0f;
+}
+
+float HeightField::getHeight(float column, float row) const
+{
+    float h00, h10, h01, h11, xFactor, yFactor;
+    getCorners(column, row, &h00, &h10, &h01, &h11, &xFactor, &yFactor);
+    float top = h00 + (h10 - h00) * xFactor;
+    float bottom = h01 + (h11 - h01) * xFactor;
+    return top + (bottom - top) * yFactor;
+}
+
+void HeightField::getHeights(const Vector2* points, unsigned int count, float* heights) const
+{
+    GP_ASSERT(count == 0 || (points && heights));
+
+    unsigned int i = 0;
+#ifdef GP_USE_SIMD
+    // The corners are looked up one point at a time, and interpolated four points at a time.
+    float h00[4], h10[4], h01[4], h11[4], xFactor[4], yFactor[4];
+    for (; i + 4 <= count; i += 4)
     {
-        return _array[x1 + y1 * _cols];
+        for (unsigned int j = 0; j < 4; ++j)
+            getCorners(points[i + j].x, points[i + j].y, &h00[j], &h10[j], &h01[j], &h11[j], &xFactor[j], &yFactor[j]);
+
+        Float4 x = load4(xFactor);
+        Float4 a = load4(h00);
+        Float4 c = load4(h01);
+        Float4 top = add4(a, mul4(sub4(load4(h10), a), x));
+        Float4 bottom = add4(c, mul4(sub4(load4(h11), c), x));
+        store4(heights + i, add4(top, mul4(sub4(bottom, top), load4(yFactor))));
     }
-    else if (x2 >= _cols)
+#endif
+    for (; i < count; ++i)
+        heights[i] = getHeight(points[i].x, points[i].y);
+}
+
+void HeightField::getNormals(const Vector2* points, unsigned int count, Vector3* normals, const Vector3& scale) const
+{
+    GP_ASSERT(count == 0 || (points && normals));
+    GP_ASSERT(scale.x != 0.0f && scale.z != 0.0f);
+
+    // The normal is (-dh/dx, 1, -dh/dz), with the slopes of the bilinear surface scaled to world units.
+    const float slopeX = scale.y / scale.x;
+    const float slopeZ = scale.y / scale.z;
+    unsigned int i = 0;
+#ifdef GP_USE_SIMD
+    float h00[4], h10[4], h01[4], h11[4], xFactor[4], yFactor[4];
+    float nx[4], nz[4], length[4];
+    for (; i + 4 <= count; i += 4)
     {
-        return _array[x1 + y1 * _cols] * yFactorI + _array[x1 + y2 * _cols] * yFactor;
+        for (unsigned int j = 0; j < 4; ++j)
+            getCorners(points[i + j].x, points[i + j].y, &h00[j], &h10[j], &h01[j], &h11[j], &xFactor[j], &yFactor[j]);
+
+        Float4 a = load4(h00);
+        Float4 b = load4(h10);
+        Float4 c = load4(h01);
+        Float4 d = load4(h11);
+        Float4 top = sub4(b, a);
+        Float4 left = sub4(c, a);
+        Float4 dx = add4(top, mul4(sub4(sub4(d, c), top), load4(yFactor)));
+        Float4 dz = add4(left, mul4(sub4(sub4(d, b), left), load4(xFactor)));
+        Float4 x = mul4(dx, splat4(-slopeX));
+        Float4 z = mul4(dz, splat4(-slopeZ));
+        Float4 r = rsqrt4(add4(add4(mul4(x, x), mul4(z, z)), splat4(1.0f)));
+        store4(nx, mul4(x, r));
+        store4(nz, mul4(z, r));
+        store4(length, r);
+        for (unsigned int j = 0; j < 4; ++j)
+            normals[i + j].set(nx[j], length[j], nz[j]);
     }
-    else if (y2 >= _rows)
+#endif
+    for (; i < count; ++i)
     {
-        return _array[x1 + y1 * _cols] * xFactorI + _array[x2 + y1 * _cols] * xFactor;
+        float a, b, c, d, xFactor, yFactor;
+        getCorners(points[i].x, points[i].y, &a, &b, &c, &d, &xFactor, &yFactor);
+        float dx = (b - a) + ((d - c) - (b - a)) * yFactor;
+        float dz = (c - a) + ((d - b) - (c - a)) * xFactor;
+        normals[i].set(-dx * slopeX, 1.0f, -dz * slopeZ);
+        normals[i].normalize();
     }
-    else
+}
+
+/**
+ * Returns the distance along a ray to a triangle, or a negative value if the ray misses it.
+ *
+ * @script{ignore}
+ */
+static float intersectTriangle(const Ray& ray, const Vector3& p0, const Vector3& p1, const Vector3& p2)
+{
+    const Vector3& origin = ray.getOrigin();
+    const Vector3& direction = ray.getDirection();
+    Vector3 edge1 = p1 - p0;
+    Vector3 edge2 = p2 - p0;
+    Vector3 p;
+    Vector3::cross(direction, edge2, &p);
+    float determinant = edge1.dot(p);
+    if (fabs(determinant) < MATH_EPSILON)
+        return -1.0f;
+
+    float inverse = 1.0f / determinant;
+    Vector3 t = origin - p0;
+    float u = t.dot(p) * inverse;
+    if (u < 0.0f || u > 1.0f)
+        return -1.0f;
+
+    Vector3 q;
+    Vector3::cross(t, edge1, &q);
+    float v = direction.dot(q) * inverse;
+    if (v < 0.0f || u + v > 1.0f)
+        return -1.0f;
+
+    return edge2.dot(q) * inverse;
+}
+
+float HeightField::intersects(const Ray& ray) const
+{
+    if (_cols < 2 || _rows < 2)
+        return Ray::INTERSECTS_NONE;
+
+    if (_bounds.empty())
+        buildBounds();
+
+    // Descend the pyramid from its top, skipping the blocks that the ray misses or only reaches
+    // beyond the nearest intersection found so far.
+    struct Block
+    {
+        unsigned int level;
+        unsigned int column;
+        unsigned int row;
+    };
+    Block stack[4 * 32 + 1];
+    unsigned int size = 0;
+    Block top = { (unsigned int)_bounds.size() - 1, 0, 0 };
+    stack[size++] = top;
+    float nearest = FLT_MAX;
+    while (size > 0)
+    {
+        Block block = stack[--size];
+        const BoundsLevel& level = _bounds[block.level];
+        unsigned int index = block.row * level.columns + block.column;
+        unsigned int x1 = block.column << block.level;
+        unsigned int z1 = block.row << block.level;
+        unsigned int x2 = std::min((block.column + 1) << block.level, _cols - 1);
+        unsigned int z2 = std::min((block.row + 1) << block.level, _rows - 1);
+        BoundingBox box((float)x1, level.minHeights[index], (float)z1, (float)x2, level.maxHeights[index], (float)z2);
+        float distance = box.intersects(ray);
+        if (distance == Ray::INTERSECTS_NONE || distance >= nearest)
+            continue;
+
+        if (block.level == 0)
+        {
+            // The cell is split along the diagonal from (x2, z1) to (x1, z2).
+            Vector3 p00((float)x1, _array[x1 + z1 * _cols], (float)z1);
+            Vector3 p10((float)x2, _array[x2 + z1 * _cols], (float)z1);
+            Vector3 p01((float)x1, _array[x1 + z2 * _cols], (float)z2);
+            Vector3 p11((float)x2, _array[x2 + z2 * _cols], (float)z2);
+            float t = intersectTriangle(ray, p00, p10, p01);
+            if (t >= 0.0f && t < nearest)
+                nearest = t;
+            t = intersectTriangle(ray, p10, p11, p01);
+            if (t >= 0.0f && t < nearest)
+                nearest = t;
+            continue;
+        }
+
+        const BoundsLevel& below = _bounds[block.level - 1];
+        for (unsigned int row = block.row * 2; row <= block.row * 2 + 1 && row < below.rows; ++row)
+        {
+            for (unsigned int column = block.column * 2; column <= block.column * 2 + 1 && column < below.columns; ++column)
+            {
+                Block child = { block.level - 1, column, row };
+                stack[size++] = child;
+            }
+        }
+    }
+    return nearest == FLT_MAX ? (float)Ray::INTERSECTS_NONE : nearest;
+}
+
+void HeightField::invalidate()
+{
+    _bounds.clear();
+}
+
+void HeightField::buildBounds() const
+{
+    // The first level bounds the cells between the heights, and each level above it blocks of 2x2 blocks below.
+    _bounds.clear();
+    _bounds.push_back(BoundsLevel());
+    BoundsLevel* level = &_bounds.back();
+    level->columns = _cols - 1;
+    level->rows = _rows - 1;
+    level->minHeights.resize(level->columns * level->rows);
+    level->maxHeights.resize(level->columns * level->rows);
+    for (unsigned int z = 0; z < level->rows; ++z)
+    {
+        for (unsigned int x = 0; x < level->columns; ++x)
+        {
+            const float* h = _array + z * _cols + x;
+            unsigned int index = z * level->columns + x;
+            level->minHeights[index] = std::min(std::min(h[0], h[1]), std::min(h[_cols], h[_cols + 1]));
+            level->maxHeights[index] = std::max(std::max(h[0], h[1]), std::max(h[_cols], h[_cols + 1]));
+        }
+    }
+
+    while (level->columns > 1 || level->rows > 1)
     {
-        float a = xFactorI * yFactorI;
-        float b = xFactorI * yFactor;
-        float c = xFactor * yFactor;
-        float d = xFactor * yFactorI;
-        return _array[x1 + y1 * _cols] * a + _array[x1 + y2 * _cols] * b +
-            _array[x2 + y2 * _cols] * c + _array[x2 + y1 * _cols] * d;
+        BoundsLevel next;
+        next.columns = (level->columns + 1) / 2;
+        next.rows = (level->rows + 1) / 2;
+        next.minHeights.resize(next.columns * next.rows, FLT_MAX);
+        next.maxHeights.resize(next.columns * next.rows, -FLT_MAX);
+        for (unsigned int z = 0; z < level->rows; ++z)
+        {
+            for (unsigned int x = 0; x < level->columns; ++x)
+            {
+                unsigned int index = (z / 2) * next.columns + x / 2;
+                next.minHeights[index] = std::min(next.minHeights[index], level->minHeights[z * level->columns + x]);
+                next.maxHeights[index] = std::max(next.maxHeights[index], level->maxHeights[z * level->columns + x]);
+            }
+        }
+        _bounds.push_back(next);
+        level = &_bounds.back();
     }
 }
 
@@ -2,6 +2,9 @@
 #define HEIGHTFIELD_H_
 
 #include "Ref.h"
+#include "Vector2.h"
+#include "Vector3.h"
+#include "Ray.h"
 
 namespace gameplay
 {
@@ -99,6 +102,56 @@ namespace gameplay
          */
         float getHeight(float column, float row) const;
 
+        /**
+         * Returns the heights at many points at once.
+         *
+         * The heights are interpolated in the same way as by getHeight, four points at a time
+         * where SIMD instructions are available.
+         *
+         * @param points The columns (x) and rows (y) of the points to query.
+         * @param count The number of points.
+         * @param heights Set to the height at each point.
+         * @script{ignore}
+         */
+        void getHeights(const Vector2* points, unsigned int count, float* heights) const;
+
+        /**
+         * Returns the normals of the interpolated surface at many points at once.
+         *
+         * The normals point up along the Y axis, with the columns along the X axis and the rows
+         * along the Z axis, as the heightfield is laid out by Terrain.
+         *
+         * @param points The columns (x) and rows (y) of the points to query.
+         * @param count The number of points.
+         * @param normals Set to the unit normal at each point.
+         * @param scale The distance between columns (x), the scale of the heights (y) and the distance between rows (z).
+         * @script{ignore}
+         */
+        void getNormals(const Vector2* points, unsigned int count, Vector3* normals, const Vector3& scale = Vector3::one()) const;
+
+        /**
+         * Tests whether a ray intersects the surface of this heightfield.
+         *
+         * The ray is specified in heightfield space, where X is the column, Y the height and Z the row,
+         * and the surface is split into the same triangles as a Terrain draws. The cells that the ray
+         * can hit are found with a pyramid of the minimum and maximum heights of blocks of cells, which
+         * is built by the first test.
+         *
+         * @param ray The ray, in heightfield space.
+         *
+         * @return The distance along the ray to the nearest intersection, or Ray::INTERSECTS_NONE
+         *      if the ray does not intersect the surface.
+         * @script{ignore}
+         */
+        float intersects(const Ray& ray) const;
+
+        /**
+         * Discards the pyramid that ray tests use, after the heights have been changed through getArray().
+         *
+         * @script{ignore}
+         */
+        void invalidate();
+
         /**
          * Returns the number of rows in the heightfield.
          *
@@ -130,9 +183,28 @@ namespace gameplay
          */
         static HeightField* create(const char* path, unsigned int width, unsigned int height, float heightMin, float heightMax);
 
+        /**
+         * The minimum and maximum heights of blocks of cells, for one level of the ray test pyramid.
+         */
+        struct BoundsLevel
+        {
+            unsigned int columns;
+            unsigned int rows;
+            std::vector<float> minHeights;
+            std::vector<float> maxHeights;
+        };
+
+        /**
+         * Looks up the heights at the corners of the cell around a point, and the position of the point within it.
+         */
+        void getCorners(float column, float row, float* h00, float* h10, float* h01, float* h11, float* xFactor, float* yFactor) const;
+
+        void buildBounds() const;
+
         float* _array;
         unsigned int _cols;
         unsigned int _rows;
+        mutable std::vector<BoundsLevel> _bounds;
     };
 
 }
@@ -1,6 +1,7 @@
 #include "Base.h"
 #include "FileSystem.h"
 #include "Image.h"
+#include "Game.h"
 
 namespace gameplay
 {
@@ -14,6 +15,40 @@ static void readStream(png_structp png, png_bytep data, png_size_t length)
     }
 }
 
+// Callback for writing a png image using Stream
+static void writeStream(png_structp png, png_bytep data, png_size_t length)
+{
+    Stream* stream = reinterpret_cast<Stream*>(png_get_io_ptr(png));
+    if (stream == NULL || stream->write(data, 1, length) != length)
+    {
+        png_error(png, "Error writing PNG.");
+    }
+}
+
+// Callback for flushing a png image that is written to a Stream
+static void flushStream(png_structp png)
+{
+}
+
+/**
+ * The paths and the images of a batch decode.
+ */
+struct ImageBatch
+{
+    const std::vector<std::string>* paths;
+    std::vector<Image*>* images;
+};
+
+// Decodes a range of the images of a batch.
+static void decodeBatch(void* cookie, unsigned int begin, unsigned int end)
+{
+    ImageBatch* batch = (ImageBatch*)cookie;
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        (*batch->images)[i] = Image::create((*batch->paths)[i].c_str());
+    }
+}
+
 Image* Image::create(const char* path)
 {
     GP_ASSERT(path);
@@ -107,6 +142,77 @@ Image* Image::create(const char* path)
     return image;
 }
 
+void Image::createBatch(const std::vector<std::string>& paths, std::vector<Image*>* images)
+{
+    GP_ASSERT(images);
+
+    images->assign(paths.size(), (Image*)NULL);
+    if (paths.empty())
+        return;
+
+    // Each image is decoded as a job of its own, since images can differ a lot in size.
+    ImageBatch batch;
+    batch.paths = &paths;
+    batch.images = images;
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    if (jobSystem)
+        jobSystem->parallelFor((unsigned int)paths.size(), 1, &decodeBatch, &batch);
+    else
+        decodeBatch(&batch, 0, (unsigned int)paths.size());
+}
+
+bool Image::save(const char* path) const
+{
+    GP_ASSERT(path);
+    GP_ASSERT(_data);
+
+    std::unique_ptr<Stream> stream(FileSystem::open(path, FileSystem::WRITE));
+    if (stream.get() == NULL || !stream->canWrite())
+    {
+        GP_WARN("Failed to open image file '%s' for writing.", path);
+        return false;
+    }
+
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    if (png == NULL)
+    {
+        GP_WARN("Failed to create PNG structure for writing PNG file '%s'.", path);
+        return false;
+    }
+
+    png_infop info = png_create_info_struct(png);
+    if (info == NULL)
+    {
+        GP_WARN("Failed to create PNG info structure for PNG file '%s'.", path);
+        png_destroy_write_struct(&png, NULL);
+        return false;
+    }
+
+    if (setjmp(png_jmpbuf(png)))
+    {
+        GP_WARN("Failed to write PNG file '%s'.", path);
+        png_destroy_write_struct(&png, &info);
+        return false;
+    }
+
+    png_set_write_fn(png, stream.get(), writeStream, flushStream);
+    png_set_IHDR(png, info, _width, _height, 8, _format == RGBA ? PNG_COLOR_TYPE_RGBA : PNG_COLOR_TYPE_RGB,
+                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+
+    // The rows of the image data are stored from the bottom up, like the ones that are read back from OpenGL.
+    size_t stride = _width * (_format == RGBA ? 4 : 3);
+    for (unsigned int i = 0; i < _height; ++i)
+    {
+        png_write_row(png, _data + stride * (_height - 1 - i));
+    }
+
+    png_write_end(png, NULL);
+    png_destroy_write_struct(&png, &info);
+
+    return true;
+}
+
 Image* Image::create(unsigned int width, unsigned int height, Image::Format format, unsigned char* data)
 {
     GP_ASSERT(width > 0 && height > 0);
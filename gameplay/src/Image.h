@@ -45,6 +45,32 @@ public:
      */
     static Image* create(unsigned int width, unsigned int height, Format format, unsigned char* data = NULL);
 
+    /**
+     * Creates images from the image files at the given paths, decoding them in parallel on
+     * the worker threads of the job system.
+     *
+     * The calling thread decodes images as well and returns once all of them are decoded.
+     * This can be called from a job.
+     *
+     * @param paths The paths to the image files.
+     * @param images Populated with the newly created images, in the same order as the paths.
+     *      The images that fail to load are NULL.
+     * @script{ignore}
+     */
+    static void createBatch(const std::vector<std::string>& paths, std::vector<Image*>* images);
+
+    /**
+     * Saves the image to a .png file.
+     *
+     * The image can be saved from any thread, for example from a job, as long as it is not
+     * changed meanwhile.
+     *
+     * @param path The path to the image file.
+     * @return true if the image was saved, false otherwise.
+     * @script{ignore}
+     */
+    bool save(const char* path) const;
+
     /**
      * Gets the image's raw pixel data.
      *
@@ -84,6 +84,7 @@ void ImageControl::setRegionSrc(float x, float y, float width, float height)
     _uvs.u2 = (x + width) * _tw;
     _uvs.v1 = 1.0f - (y * _th);
     _uvs.v2 = 1.0f - ((y + height) * _th);
+    setDirty(DIRTY_REDRAW);
 }
 
 void ImageControl::setRegionSrc(const Rectangle& region)
@@ -99,6 +100,7 @@ const Rectangle& ImageControl::getRegionSrc() const
 void ImageControl::setRegionDst(float x, float y, float width, float height)
 {
     _dstRegion.set(x, y, width, height);
+    setDirty(DIRTY_REDRAW);
 }
 
 void ImageControl::setRegionDst(const Rectangle& region)
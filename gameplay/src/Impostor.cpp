@@ -0,0 +1,339 @@
+#include "Base.h"
+#include "Impostor.h"
+#include "GraphicsDevice.h"
+#include "Game.h"
+#include "Scene.h"
+#include "Technique.h"
+#include "Pass.h"
+#include "FrameBuffer.h"
+#include "RenderCommandList.h"
+#include "InstancedModel.h"
+
+// Number of floats stored per instance (center and radius, view)
+#define INSTANCE_FLOAT_COUNT 5
+
+#define IMPOSTOR_VSH "res/shaders/impostor.vert"
+#define IMPOSTOR_FSH "res/shaders/impostor.frag"
+
+#define VERTEX_ATTRIBUTE_INSTANCE_POSITION_NAME "a_instancePosition"
+#define VERTEX_ATTRIBUTE_INSTANCE_VIEW_NAME     "a_instanceView"
+
+namespace gameplay
+{
+
+Impostor::Impostor()
+    : _model(NULL), _viewCount(0), _resolution(0), _sampler(NULL), _quad(NULL), _material(NULL),
+    _instanceBuffer(0), _instanceBufferCapacity(0), _renderFailed(false), _attributeWarningLogged(false)
+{
+    if (InstancedModel::isInstancingSupported())
+    {
+        GL_ASSERT( glGenBuffers(1, &_instanceBuffer) );
+    }
+}
+
+Impostor::~Impostor()
+{
+    SAFE_RELEASE(_material);
+    SAFE_RELEASE(_quad);
+    SAFE_RELEASE(_sampler);
+    SAFE_RELEASE(_model);
+
+    if (_instanceBuffer)
+    {
+        RenderState::deleteBuffer(_instanceBuffer);
+        _instanceBuffer = 0;
+    }
+}
+
+Impostor* Impostor::create(Model* model, unsigned int viewCount, unsigned int resolution)
+{
+    GP_ASSERT(model);
+    GP_ASSERT(viewCount > 0);
+    GP_ASSERT(resolution > 0);
+
+    Effect* effect = Effect::createFromFile(IMPOSTOR_VSH, IMPOSTOR_FSH);
+    if (!effect)
+    {
+        GP_WARN("Failed to create effect for impostor.");
+        return NULL;
+    }
+
+    // The quad of each instance is a triangle strip around its center.
+    VertexFormat::Element vertexElements[] =
+    {
+        VertexFormat::Element(VertexFormat::POSITION, 2)
+    };
+    Mesh* quad = Mesh::createMesh(VertexFormat(vertexElements, 1), 4, false);
+    if (!quad)
+    {
+        GP_WARN("Failed to create quad for impostor.");
+        SAFE_RELEASE(effect);
+        return NULL;
+    }
+    float vertices[] = { -0.5f, -0.5f, 0.5f, -0.5f, -0.5f, 0.5f, 0.5f, 0.5f };
+    quad->setVertexData(vertices, 0, 4);
+    quad->setPrimitiveType(Mesh::TRIANGLE_STRIP);
+
+    Impostor* impostor = new Impostor();
+    model->addRef();
+    impostor->_model = model;
+    impostor->_viewCount = viewCount;
+    impostor->_resolution = resolution;
+    impostor->_quad = quad;
+    impostor->_material = Material::create(effect);
+    impostor->_material->getStateBlock()->setDepthTest(true);
+    impostor->_material->getStateBlock()->setDepthWrite(true);
+    impostor->_material->getParameter("u_viewCount")->setValue((float)viewCount);
+
+    Pass* pass = impostor->_material->getTechnique()->getPassByIndex(0);
+    VertexAttributeBinding* b = VertexAttributeBinding::create(quad, effect);
+    pass->setVertexAttributeBinding(b);
+    SAFE_RELEASE(b);
+    SAFE_RELEASE(effect);
+    return impostor;
+}
+
+Model* Impostor::getModel() const
+{
+    return _model;
+}
+
+unsigned int Impostor::getViewCount() const
+{
+    return _viewCount;
+}
+
+unsigned int Impostor::getResolution() const
+{
+    return _resolution;
+}
+
+Texture* Impostor::getTexture() const
+{
+    return _sampler ? _sampler->getTexture() : NULL;
+}
+
+bool Impostor::render()
+{
+    if (_sampler)
+        return true;
+    if (_renderFailed || RenderCommandList::getRecording())
+        return false;
+
+    Mesh* mesh = _model->getMesh();
+    GP_ASSERT(mesh);
+    const BoundingSphere& bounds = mesh->getBoundingSphere();
+    if (bounds.radius <= 0.0f)
+    {
+        GP_WARN("Failed to render impostor; the mesh has no bounding sphere.");
+        _renderFailed = true;
+        return false;
+    }
+
+    unsigned int width = _resolution * _viewCount;
+    FrameBuffer* frameBuffer = FrameBuffer::create("Impostor", width, _resolution);
+    if (!frameBuffer)
+    {
+        GP_WARN("Failed to create frame buffer for impostor.");
+        _renderFailed = true;
+        return false;
+    }
+    DepthStencilTarget* depthTarget = DepthStencilTarget::create("Impostor", DepthStencilTarget::DEPTH, width, _resolution);
+    frameBuffer->setDepthStencilTarget(depthTarget);
+    frameBuffer->setInvalidateOnUnbind(Game::CLEAR_DEPTH);
+    SAFE_RELEASE(depthTarget);
+
+    // The model is rendered in a scene of its own, from an orthographic camera that fits its bounding
+    // sphere and that is moved around it for each view.
+    Scene* scene = Scene::create();
+    Camera* camera = Camera::createOrthographic(bounds.radius * 2.0f, bounds.radius * 2.0f, 1.0f, bounds.radius * 0.5f, bounds.radius * 3.5f);
+    Node* cameraNode = scene->addNode();
+    cameraNode->setCamera(camera);
+    scene->setActiveCamera(camera);
+    SAFE_RELEASE(camera);
+    Node* previousNode = _model->getNode();
+    _model->setNode(scene->addNode());
+    setIdentityInstance();
+
+    Game* game = Game::getInstance();
+    Rectangle viewport = game->getViewport();
+    FrameBuffer* previousFrameBuffer = frameBuffer->bind();
+    game->setViewport(Rectangle(0, 0, (float)width, (float)_resolution));
+    game->clear(Game::CLEAR_COLOR_DEPTH, Vector4::zero(), 1.0f, 0);
+    for (unsigned int i = 0; i < _viewCount; ++i)
+    {
+        // The default camera looks down the negative z axis, so rotating it by the angle of the view
+        // points it back at the center from its position on the ring.
+        float angle = MATH_PIX2 * i / _viewCount;
+        cameraNode->setRotation(Vector3::unitY(), angle);
+        cameraNode->setTranslation(bounds.center + Vector3(sin(angle), 0.0f, cos(angle)) * (bounds.radius * 2.0f));
+        game->setViewport(Rectangle((float)(i * _resolution), 0, (float)_resolution, (float)_resolution));
+        _model->draw();
+    }
+    previousFrameBuffer->bind();
+    game->setViewport(viewport);
+    _model->setNode(previousNode);
+    SAFE_RELEASE(scene);
+
+    // The frames are mipmapped, since impostors are only drawn far away.
+    Texture* texture = frameBuffer->getRenderTarget()->getTexture();
+    texture->generateMipmaps();
+    _sampler = Texture::Sampler::create(texture);
+    _sampler->setFilterMode(Texture::LINEAR_MIPMAP_LINEAR, Texture::LINEAR);
+    _sampler->setWrapMode(Texture::CLAMP, Texture::CLAMP);
+    _material->getParameter("u_texture")->setValue(_sampler);
+    SAFE_RELEASE(frameBuffer);
+    return true;
+}
+
+void Impostor::clearInstances(const Vector3& cameraPosition)
+{
+    _cameraPosition = cameraPosition;
+    _instanceData.clear();
+}
+
+void Impostor::addInstance(const Matrix& world)
+{
+    const BoundingSphere& bounds = _model->getMesh()->getBoundingSphere();
+    BoundingSphere sphere(bounds);
+    sphere.transform(world);
+
+    // The view is picked from the direction of the camera in the space of the instance.
+    unsigned int view = 0;
+    Matrix inverse;
+    if (world.invert(&inverse))
+    {
+        Vector3 eye;
+        inverse.transformPoint(_cameraPosition, &eye);
+        view = getView(eye - bounds.center);
+    }
+
+    _instanceData.push_back(sphere.center.x);
+    _instanceData.push_back(sphere.center.y);
+    _instanceData.push_back(sphere.center.z);
+    _instanceData.push_back(sphere.radius);
+    _instanceData.push_back((float)view);
+}
+
+unsigned int Impostor::getInstanceCount() const
+{
+    return (unsigned int)(_instanceData.size() / INSTANCE_FLOAT_COUNT);
+}
+
+unsigned int Impostor::getView(const Vector3& direction) const
+{
+    float angle = atan2(direction.x, direction.z);
+    if (angle < 0.0f)
+        angle += MATH_PIX2;
+    return (unsigned int)(angle * _viewCount / MATH_PIX2 + 0.5f) % _viewCount;
+}
+
+void Impostor::setIdentityInstance()
+{
+    // The materials of an instanced model read their instance matrix from a vertex attribute,
+    // which is a constant attribute since the model is drawn on its own.
+    const Matrix& identity = Matrix::identity();
+    unsigned int partCount = _model->getMeshPartCount();
+    for (unsigned int i = 0, count = std::max(partCount, 1u); i < count; ++i)
+    {
+        Material* material = _model->getDrawMaterial(partCount > 0 ? (int)i : -1);
+        if (!material)
+            continue;
+
+        Technique* technique = material->getTechnique();
+        for (unsigned int j = 0, passCount = technique->getPassCount(); j < passCount; ++j)
+        {
+            VertexAttribute attrib = technique->getPassByIndex(j)->getEffect()->getVertexAttribute(VERTEX_ATTRIBUTE_INSTANCE_MATRIX_NAME);
+            if (attrib == -1)
+                continue;
+            for (unsigned int c = 0; c < 4; ++c)
+            {
+                GL_ASSERT( glVertexAttrib4fv(attrib + c, identity.m + c * 4) );
+            }
+        }
+    }
+}
+
+unsigned int Impostor::draw(Camera* camera)
+{
+    GP_ASSERT(camera);
+
+    unsigned int instanceCount = getInstanceCount();
+    if (instanceCount == 0 || !_sampler)
+        return 0;
+
+    Pass* pass = _material->getTechnique()->getPassByIndex(0);
+    Effect* effect = pass->getEffect();
+    VertexAttribute attribs[2] =
+    {
+        effect->getVertexAttribute(VERTEX_ATTRIBUTE_INSTANCE_POSITION_NAME),
+        effect->getVertexAttribute(VERTEX_ATTRIBUTE_INSTANCE_VIEW_NAME)
+    };
+    const GLint sizes[2] = { 4, 1 };
+    if (attribs[0] == -1 || attribs[1] == -1)
+    {
+        if (!_attributeWarningLogged)
+        {
+            GP_WARN("Effect '%s' used by an impostor has no per-instance vertex attributes.", effect->getId());
+            _attributeWarningLogged = true;
+        }
+        return 0;
+    }
+
+    // The quads face the camera in view space, so they are projected separately from the view.
+    _material->getParameter("u_viewMatrix")->setValue(camera->getViewMatrix());
+    _material->getParameter("u_projectionMatrix")->setValue(camera->getProjectionMatrix());
+
+    unsigned int drawCalls = 0;
+    pass->bind();
+    RenderState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+#ifdef GP_USE_INSTANCING
+    if (_instanceBuffer)
+    {
+        RenderState::bindBuffer(GL_ARRAY_BUFFER, _instanceBuffer);
+        if (instanceCount > _instanceBufferCapacity)
+        {
+            _instanceBufferCapacity = instanceCount;
+            GL_ASSERT( glBufferData(GL_ARRAY_BUFFER, _instanceBufferCapacity * INSTANCE_FLOAT_COUNT * sizeof(float), NULL, GL_DYNAMIC_DRAW) );
+        }
+        GL_ASSERT( glBufferSubData(GL_ARRAY_BUFFER, 0, instanceCount * INSTANCE_FLOAT_COUNT * sizeof(float), &_instanceData[0]) );
+        RenderStats::countBufferUpload(instanceCount * INSTANCE_FLOAT_COUNT * sizeof(float));
+
+        // Each attribute of the instance advances once per instance.
+        for (unsigned int a = 0; a < 2; ++a)
+        {
+            GL_ASSERT( glVertexAttribPointer(attribs[a], sizes[a], GL_FLOAT, GL_FALSE, INSTANCE_FLOAT_COUNT * sizeof(float), (void*)(a * 4 * sizeof(float))) );
+            GL_ASSERT( glEnableVertexAttribArray(attribs[a]) );
+            GL_ASSERT( glVertexAttribDivisor(attribs[a], 1) );
+        }
+
+        GraphicsDevice::drawArrays(GL_TRIANGLE_STRIP, 0, 4, instanceCount);
+        ++drawCalls;
+
+        // Restore the attributes so that other draws using this binding are not instanced.
+        for (unsigned int a = 0; a < 2; ++a)
+        {
+            GL_ASSERT( glVertexAttribDivisor(attribs[a], 0) );
+            GL_ASSERT( glDisableVertexAttribArray(attribs[a]) );
+        }
+    }
+    else
+#endif
+    {
+        // Without instancing support, the values of each instance are passed as constant attributes.
+        for (unsigned int i = 0; i < instanceCount; ++i)
+        {
+            const float* data = &_instanceData[i * INSTANCE_FLOAT_COUNT];
+            GL_ASSERT( glVertexAttrib4fv(attribs[0], data) );
+            GL_ASSERT( glVertexAttrib1f(attribs[1], data[4]) );
+            GraphicsDevice::drawArrays(GL_TRIANGLE_STRIP, 0, 4);
+            ++drawCalls;
+        }
+    }
+
+    pass->unbind();
+    return drawCalls;
+}
+
+}
@@ -0,0 +1,166 @@
+#ifndef IMPOSTOR_H_
+#define IMPOSTOR_H_
+
+#include "Ref.h"
+#include "Model.h"
+#include "Texture.h"
+
+namespace gameplay
+{
+
+class Camera;
+
+/**
+ * Defines a set of snapshots of a Model, taken from around it, that are drawn as billboards in place
+ * of distant instances of the model.
+ *
+ * The model is rendered from a ring of views around its vertical (y) axis into a single atlas
+ * texture, one square frame per view, the first time that the impostor is used. Each view is an
+ * orthographic projection of the bounding sphere of the mesh, so that a frame covers exactly the
+ * quad that replaces the model. The instances that are drawn as impostors are then drawn together
+ * as camera facing quads with a single instanced draw call, each one showing the frame that was
+ * rendered from the direction nearest to the direction of the camera around it.
+ *
+ * Impostors are used by an InstancedModel for its instances that are further than a distance from
+ * the camera:
+ *
+ * @code
+ * Impostor* impostor = Impostor::create(trees->getModel(), 8, 128);
+ * trees->setImpostor(impostor, 150.0f);
+ * SAFE_RELEASE(impostor);
+ * @endcode
+ *
+ * The views are rendered with the materials of the model, against a transparent background, and the
+ * billboards discard the transparent texels of their frame. The model is expected to be lit by a
+ * directional light or by its ambient color alone, since it is rendered in a scene of its own. The
+ * resolution multiplied by the number of views should be a power of two, so that the atlas can be
+ * mipmapped on every platform.
+ *
+ * @script{ignore}
+ */
+class Impostor : public Ref
+{
+    friend class InstancedModel;
+
+public:
+
+    /**
+     * Creates a new impostor of a model. The atlas is rendered when the impostor is first used.
+     *
+     * @param model The model to render the views of.
+     * @param viewCount The number of views around the model.
+     * @param resolution The width and height of each view, in pixels.
+     *
+     * @return The new impostor, or NULL if its effect could not be loaded.
+     */
+    static Impostor* create(Model* model, unsigned int viewCount = 8, unsigned int resolution = 128);
+
+    /**
+     * Returns the model that the views are rendered from.
+     *
+     * @return The model of the impostor.
+     */
+    Model* getModel() const;
+
+    /**
+     * Returns the number of views around the model.
+     *
+     * @return The number of views.
+     */
+    unsigned int getViewCount() const;
+
+    /**
+     * Returns the width and height of each view, in pixels.
+     *
+     * @return The resolution of the views.
+     */
+    unsigned int getResolution() const;
+
+    /**
+     * Returns the atlas of the views, from left to right in the order of the angles that they were
+     * rendered from, or NULL if the atlas has not been rendered yet.
+     *
+     * @return The atlas of the views.
+     */
+    Texture* getTexture() const;
+
+    /**
+     * Renders the atlas, if it has not been rendered yet.
+     *
+     * This is called when the impostor is first used, and can also be called while loading to avoid
+     * rendering the atlas in the middle of a frame. The model must have its materials set. The atlas
+     * is not rendered while a RenderCommandList is recording.
+     *
+     * @return true if the atlas is rendered, false otherwise.
+     */
+    bool render();
+
+private:
+
+    /**
+     * Constructor.
+     */
+    Impostor();
+
+    /**
+     * Destructor. Hidden use release() instead.
+     */
+    ~Impostor();
+
+    /**
+     * Hidden copy constructor.
+     */
+    Impostor(const Impostor& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    Impostor& operator=(const Impostor&);
+
+    /**
+     * Removes the instances to draw, and sets the position of the camera that the next ones are seen from.
+     */
+    void clearInstances(const Vector3& cameraPosition);
+
+    /**
+     * Adds an instance to draw, transformed by a world matrix.
+     */
+    void addInstance(const Matrix& world);
+
+    /**
+     * Returns the number of instances to draw.
+     */
+    unsigned int getInstanceCount() const;
+
+    /**
+     * Returns the view nearest to a direction from the center of the model, in the space of the model.
+     */
+    unsigned int getView(const Vector3& direction) const;
+
+    /**
+     * Sets the instance matrix of the effects of the model to the identity while the views are rendered.
+     */
+    void setIdentityInstance();
+
+    /**
+     * Draws the instances as seen by a camera.
+     */
+    unsigned int draw(Camera* camera);
+
+    Model* _model;
+    unsigned int _viewCount;
+    unsigned int _resolution;
+    Texture::Sampler* _sampler;
+    Mesh* _quad;
+    Material* _material;
+    Vector3 _cameraPosition;
+    std::vector<float> _instanceData;
+    GLuint _instanceBuffer;
+    unsigned int _instanceBufferCapacity;
+    bool _renderFailed;
+    bool _attributeWarningLogged;
+};
+
+}
+
+#endif
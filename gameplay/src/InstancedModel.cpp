@@ -0,0 +1,536 @@
+#include "Base.h"
+#include "InstancedModel.h"
+#include "GraphicsDevice.h"
+#include "MeshPart.h"
+#include "Scene.h"
+#include "Technique.h"
+#include "Pass.h"
+#include "Node.h"
+#include "MeshSkin.h"
+#include "Impostor.h"
+#include "Game.h"
+
+// Number of floats stored per instance (one column-major 4x4 matrix)
+#define INSTANCE_FLOAT_COUNT 16
+
+// Number of texels of each joint in the palette texture (the rows of its matrix)
+#define INSTANCE_PALETTE_JOINT_TEXELS 3
+
+// The internal format of the palette texture
+#ifdef OPENGL_ES
+#define INSTANCE_PALETTE_FORMAT GL_RGBA
+#else
+#define INSTANCE_PALETTE_FORMAT GL_RGBA32F
+#endif
+
+namespace gameplay
+{
+
+InstancedModel::InstancedModel(Model* model)
+    : _model(model), _instanceBuffer(0), _instanceBufferCapacity(0), _visibleCount(0), _paletteSampler(NULL),
+    _paletteWidth(0), _paletteRowCount(0), _paletteIndexBuffer(0), _paletteIndexCapacity(0), _impostor(NULL),
+    _impostorDistance(0.0f), _impostorCount(0), _frustumCulling(true), _attributeWarningLogged(false)
+{
+    GP_ASSERT(_model);
+
+    if (isInstancingSupported())
+    {
+        GL_ASSERT( glGenBuffers(1, &_instanceBuffer) );
+    }
+}
+
+InstancedModel::~InstancedModel()
+{
+    clearInstances();
+    SAFE_RELEASE(_model);
+    SAFE_RELEASE(_paletteSampler);
+    SAFE_RELEASE(_impostor);
+
+    if (_instanceBuffer)
+    {
+        RenderState::deleteBuffer(_instanceBuffer);
+        _instanceBuffer = 0;
+    }
+    if (_paletteIndexBuffer)
+    {
+        RenderState::deleteBuffer(_paletteIndexBuffer);
+        _paletteIndexBuffer = 0;
+    }
+}
+
+InstancedModel* InstancedModel::create(Mesh* mesh)
+{
+    GP_ASSERT(mesh);
+
+    Model* model = Model::create(mesh);
+    if (!model)
+    {
+        GP_ERROR("Failed to create model for instanced model.");
+        return NULL;
+    }
+    return new InstancedModel(model);
+}
+
+Model* InstancedModel::getModel() const
+{
+    return _model;
+}
+
+Mesh* InstancedModel::getMesh() const
+{
+    return _model->getMesh();
+}
+
+unsigned int InstancedModel::addInstance(Node* node)
+{
+    GP_ASSERT(node);
+
+    node->addRef();
+    _instances.push_back(node);
+    return (unsigned int)(_instances.size() - 1);
+}
+
+bool InstancedModel::removeInstance(Node* node)
+{
+    std::vector<Node*>::iterator itr = std::find(_instances.begin(), _instances.end(), node);
+    if (itr == _instances.end())
+        return false;
+
+    _instances.erase(itr);
+    SAFE_RELEASE(node);
+    return true;
+}
+
+void InstancedModel::clearInstances()
+{
+    for (size_t i = 0, count = _instances.size(); i < count; ++i)
+    {
+        SAFE_RELEASE(_instances[i]);
+    }
+    _instances.clear();
+}
+
+Node* InstancedModel::getInstance(unsigned int index) const
+{
+    GP_ASSERT(index < _instances.size());
+    return _instances[index];
+}
+
+unsigned int InstancedModel::getInstanceCount() const
+{
+    return (unsigned int)_instances.size();
+}
+
+unsigned int InstancedModel::getVisibleInstanceCount() const
+{
+    return _visibleCount;
+}
+
+unsigned int InstancedModel::getImpostorInstanceCount() const
+{
+    return _impostorCount;
+}
+
+void InstancedModel::setFrustumCulling(bool enabled)
+{
+    _frustumCulling = enabled;
+}
+
+bool InstancedModel::isFrustumCulling() const
+{
+    return _frustumCulling;
+}
+
+void InstancedModel::setImpostor(Impostor* impostor, float distance)
+{
+    if (impostor != _impostor)
+    {
+        SAFE_RELEASE(_impostor);
+        _impostor = impostor;
+        if (_impostor)
+            _impostor->addRef();
+    }
+    _impostorDistance = distance;
+}
+
+Impostor* InstancedModel::getImpostor() const
+{
+    return _impostor;
+}
+
+float InstancedModel::getImpostorDistance() const
+{
+    return _impostorDistance;
+}
+
+bool InstancedModel::isInstancingSupported()
+{
+#ifdef GP_USE_INSTANCING
+    return GraphicsDevice::isSupported(GraphicsDevice::INSTANCING);
+#else
+    return false;
+#endif
+}
+
+void InstancedModel::setNode(Node* node)
+{
+    Drawable::setNode(node);
+
+    // The materials of the model are bound to the node of the instanced model.
+    _model->setNode(node);
+}
+
+Drawable* InstancedModel::clone(NodeCloneContext& context)
+{
+    Model* model = static_cast<Model*>(_model->clone(context));
+    if (!model)
+    {
+        GP_ERROR("Failed to clone instanced model.");
+        return NULL;
+    }
+
+    InstancedModel* instancedModel = new InstancedModel(model);
+    for (size_t i = 0, count = _instances.size(); i < count; ++i)
+    {
+        // Instances that were cloned along with this node follow their clones.
+        Node* node = context.findClonedNode(_instances[i]);
+        instancedModel->addInstance(node ? node : _instances[i]);
+    }
+    instancedModel->_frustumCulling = _frustumCulling;
+    instancedModel->setImpostor(_impostor, _impostorDistance);
+    return instancedModel;
+}
+
+unsigned int InstancedModel::updateInstances()
+{
+    _visibleCount = 0;
+    _impostorCount = 0;
+    if (!_node || _instances.empty())
+        return 0;
+
+    // Instance matrices are relative to the node of the instanced model.
+    Matrix inverseWorld;
+    if (!_node->getWorldMatrix().invert(&inverseWorld))
+        inverseWorld.setIdentity();
+
+    Camera* camera = NULL;
+    Scene* scene = _node->getScene();
+    if (_frustumCulling && scene)
+        camera = scene->getActiveCamera();
+
+    Mesh* mesh = _model->getMesh();
+    GP_ASSERT(mesh);
+    const BoundingSphere& meshBounds = mesh->getBoundingSphere();
+    if (meshBounds.radius <= 0.0f)
+        camera = NULL;
+
+    size_t count = _instances.size();
+    if (camera)
+    {
+        // Test all instance bounds against the frustum in one batch.
+        _instanceBounds.resize(count);
+        _instanceVisible.resize(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            GP_ASSERT(_instances[i]);
+            _instanceBounds[i].set(meshBounds);
+            _instanceBounds[i].transform(_instances[i]->getWorldMatrix());
+        }
+        camera->getFrustum().cullSpheres(&_instanceBounds[0], count, &_instanceVisible[0]);
+    }
+
+    // Skinned instances also write their matrix palettes, one row of the palette texture each.
+    unsigned int jointCount = getPaletteJointCount();
+    _paletteData.resize(count * jointCount * INSTANCE_PALETTE_JOINT_TEXELS * 4);
+
+    // Instances beyond the impostor distance from the active camera are given to the impostor.
+    Vector3 cameraPosition;
+    float impostorDistanceSquared = _impostorDistance * _impostorDistance;
+    bool impostors = false;
+    if (_impostor && jointCount == 0 && scene && scene->getActiveCamera() && scene->getActiveCamera()->getNode())
+    {
+        cameraPosition = scene->getActiveCamera()->getNode()->getTranslationWorld();
+        _impostor->clearInstances(cameraPosition);
+        impostors = true;
+    }
+
+    _instanceData.resize(count * INSTANCE_FLOAT_COUNT);
+    float* data = &_instanceData[0];
+    for (size_t i = 0; i < count; ++i)
+    {
+        Node* node = _instances[i];
+        GP_ASSERT(node);
+        if (!node->isEnabled() || (camera && !_instanceVisible[i]))
+            continue;
+
+        const Matrix& world = node->getWorldMatrix();
+        if (impostors)
+        {
+            Vector3 center;
+            world.transformPoint(meshBounds.center, &center);
+            if (center.distanceSquared(cameraPosition) > impostorDistanceSquared && _impostor->render())
+            {
+                _impostor->addInstance(world);
+                ++_impostorCount;
+                continue;
+            }
+        }
+
+        Matrix m;
+        Matrix::multiply(inverseWorld, world, &m);
+        memcpy(data + _visibleCount * INSTANCE_FLOAT_COUNT, m.m, sizeof(float) * INSTANCE_FLOAT_COUNT);
+        if (jointCount > 0)
+            writePalette(_visibleCount, node, jointCount);
+        ++_visibleCount;
+    }
+
+    if (jointCount > 0 && _visibleCount > 0)
+        updatePaletteTexture(jointCount);
+
+    if (_instanceBuffer && _visibleCount > 0)
+    {
+        RenderState::bindBuffer(GL_ARRAY_BUFFER, _instanceBuffer);
+        if (_visibleCount > _instanceBufferCapacity)
+        {
+            _instanceBufferCapacity = (unsigned int)_instances.size();
+            GL_ASSERT( glBufferData(GL_ARRAY_BUFFER, _instanceBufferCapacity * INSTANCE_FLOAT_COUNT * sizeof(float), NULL, GL_DYNAMIC_DRAW) );
+        }
+        GL_ASSERT( glBufferSubData(GL_ARRAY_BUFFER, 0, _visibleCount * INSTANCE_FLOAT_COUNT * sizeof(float), data) );
+        RenderStats::countBufferUpload(_visibleCount * INSTANCE_FLOAT_COUNT * sizeof(float));
+    }
+
+    return _visibleCount;
+}
+
+unsigned int InstancedModel::getPaletteJointCount() const
+{
+    // The palette texture is laid out for the skin of the first skinned instance.
+    for (size_t i = 0, count = _instances.size(); i < count; ++i)
+    {
+        Drawable* drawable = _instances[i]->getDrawable();
+        Model* model = drawable ? dynamic_cast<Model*>(drawable) : NULL;
+        if (model && model->getSkin())
+            return model->getSkin()->getJointCount();
+    }
+    return 0;
+}
+
+void InstancedModel::writePalette(unsigned int row, Node* node, unsigned int jointCount)
+{
+    unsigned int floatCount = jointCount * INSTANCE_PALETTE_JOINT_TEXELS * 4;
+    float* palette = &_paletteData[row * floatCount];
+
+    Drawable* drawable = node->getDrawable();
+    Model* model = drawable ? dynamic_cast<Model*>(drawable) : NULL;
+    MeshSkin* skin = model ? model->getSkin() : NULL;
+    if (skin && skin->getJointCount() == jointCount)
+    {
+        memcpy(palette, skin->getMatrixPalette(), floatCount * sizeof(float));
+        return;
+    }
+
+    // Instances without a matching skin are drawn in the bind pose.
+    memset(palette, 0, floatCount * sizeof(float));
+    for (unsigned int i = 0; i < jointCount; ++i)
+    {
+        float* joint = palette + i * INSTANCE_PALETTE_JOINT_TEXELS * 4;
+        joint[0] = 1.0f;
+        joint[5] = 1.0f;
+        joint[10] = 1.0f;
+    }
+}
+
+void InstancedModel::updatePaletteTexture(unsigned int jointCount)
+{
+    unsigned int width = jointCount * INSTANCE_PALETTE_JOINT_TEXELS;
+    if (!_paletteSampler || _paletteWidth != width || _paletteRowCount < _visibleCount)
+    {
+        // The texture has a row for every instance, so it is only recreated when instances are added.
+        SAFE_RELEASE(_paletteSampler);
+        _paletteWidth = width;
+        _paletteRowCount = (unsigned int)_instances.size();
+
+        GLuint handle;
+        GL_ASSERT( glGenTextures(1, &handle) );
+        RenderState::bindTexture(GL_TEXTURE_2D, handle);
+        GL_ASSERT( glTexImage2D(GL_TEXTURE_2D, 0, INSTANCE_PALETTE_FORMAT, _paletteWidth, _paletteRowCount, 0, GL_RGBA, GL_FLOAT, NULL) );
+        Texture* texture = Texture::create(handle, _paletteWidth, _paletteRowCount, Texture::RGBA);
+        _paletteSampler = Texture::Sampler::create(texture);
+        SAFE_RELEASE(texture);
+        _paletteSampler->setFilterMode(Texture::NEAREST, Texture::NEAREST);
+        _paletteSampler->setWrapMode(Texture::CLAMP, Texture::CLAMP);
+    }
+
+    RenderState::bindTexture(GL_TEXTURE_2D, _paletteSampler->getTexture()->getHandle());
+    GL_ASSERT( glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _paletteWidth, _visibleCount, GL_RGBA, GL_FLOAT, &_paletteData[0]) );
+    RenderStats::countBufferUpload(_paletteWidth * _visibleCount * 4 * sizeof(float));
+
+    // The palette row of each instance is its index in the draw, which advances once per instance.
+    if (_instanceBuffer && _paletteIndexCapacity < _visibleCount)
+    {
+        _paletteIndexCapacity = (unsigned int)_instances.size();
+        std::vector<float> rows(_paletteIndexCapacity);
+        for (unsigned int i = 0; i < _paletteIndexCapacity; ++i)
+            rows[i] = (float)i;
+
+        if (!_paletteIndexBuffer)
+            GL_ASSERT( glGenBuffers(1, &_paletteIndexBuffer) );
+        RenderState::bindBuffer(GL_ARRAY_BUFFER, _paletteIndexBuffer);
+        GL_ASSERT( glBufferData(GL_ARRAY_BUFFER, _paletteIndexCapacity * sizeof(float), &rows[0], GL_STATIC_DRAW) );
+    }
+}
+
+void InstancedModel::bindPalette(Effect* effect)
+{
+    GP_ASSERT(effect);
+    GP_ASSERT(_paletteSampler);
+
+    Uniform* uniform = effect->getUniform("u_matrixPaletteTexture");
+    if (uniform)
+        effect->setValue(uniform, _paletteSampler);
+    uniform = effect->getUniform("u_matrixPaletteTextureInverseSize");
+    if (uniform)
+        effect->setValue(uniform, Vector2(1.0f / _paletteWidth, 1.0f / _paletteRowCount));
+}
+
+unsigned int InstancedModel::draw(bool wireframe)
+{
+    unsigned int instanceCount = updateInstances();
+    unsigned int drawCalls = 0;
+    if (instanceCount > 0)
+    {
+        Mesh* mesh = _model->getMesh();
+        GP_ASSERT(mesh);
+
+        // Streamed meshes are not drawn until their data is loaded, which drawing them starts.
+        Game::getInstance()->getMeshStreamer()->prefetch(mesh);
+        unsigned int partCount = mesh->getPartCount();
+        if (!mesh->isResident())
+            partCount = 0;
+        else if (partCount == 0)
+        {
+            drawCalls += drawInstances(_model->getDrawMaterial(-1), NULL, instanceCount);
+        }
+        for (unsigned int i = 0; i < partCount; ++i)
+        {
+            drawCalls += drawInstances(_model->getDrawMaterial((int)i), mesh->getPart(i), instanceCount);
+        }
+    }
+
+    // The distant instances are drawn by the impostor, with the camera that they were picked for.
+    if (_impostorCount > 0)
+        drawCalls += _impostor->draw(_node->getScene()->getActiveCamera());
+    return drawCalls;
+}
+
+unsigned int InstancedModel::drawInstances(Material* material, MeshPart* part, unsigned int instanceCount)
+{
+    if (!material)
+        return 0;
+
+    Mesh* mesh = _model->getMesh();
+    Technique* technique = material->getTechnique();
+    GP_ASSERT(technique);
+
+    unsigned int drawCalls = 0;
+    for (unsigned int i = 0, passCount = technique->getPassCount(); i < passCount; ++i)
+    {
+        Pass* pass = technique->getPassByIndex(i);
+        GP_ASSERT(pass);
+
+        VertexAttribute attrib = pass->getEffect()->getVertexAttribute(VERTEX_ATTRIBUTE_INSTANCE_MATRIX_NAME);
+        if (attrib == -1)
+        {
+            if (!_attributeWarningLogged)
+            {
+                GP_WARN("Effect '%s' used by an instanced model has no '%s' vertex attribute.", pass->getEffect()->getId(), VERTEX_ATTRIBUTE_INSTANCE_MATRIX_NAME);
+                _attributeWarningLogged = true;
+            }
+            continue;
+        }
+
+        pass->bind();
+        RenderState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, part ? part->getIndexBuffer() : 0);
+
+        // Skinned crowds read the palette of each instance from the palette texture.
+        VertexAttribute paletteAttrib = -1;
+        if (_paletteSampler && !_paletteData.empty())
+        {
+            paletteAttrib = pass->getEffect()->getVertexAttribute(VERTEX_ATTRIBUTE_INSTANCE_PALETTE_NAME);
+            if (paletteAttrib != -1)
+                bindPalette(pass->getEffect());
+        }
+
+#ifdef GP_USE_INSTANCING
+        if (_instanceBuffer)
+        {
+            // Each matrix column is a separate vec4 attribute that advances once per instance.
+            RenderState::bindBuffer(GL_ARRAY_BUFFER, _instanceBuffer);
+            for (unsigned int c = 0; c < 4; ++c)
+            {
+                GL_ASSERT( glVertexAttribPointer(attrib + c, 4, GL_FLOAT, GL_FALSE, INSTANCE_FLOAT_COUNT * sizeof(float), (void*)(c * 4 * sizeof(float))) );
+                GL_ASSERT( glEnableVertexAttribArray(attrib + c) );
+                GL_ASSERT( glVertexAttribDivisor(attrib + c, 1) );
+            }
+            if (paletteAttrib != -1)
+            {
+                RenderState::bindBuffer(GL_ARRAY_BUFFER, _paletteIndexBuffer);
+                GL_ASSERT( glVertexAttribPointer(paletteAttrib, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0) );
+                GL_ASSERT( glEnableVertexAttribArray(paletteAttrib) );
+                GL_ASSERT( glVertexAttribDivisor(paletteAttrib, 1) );
+            }
+
+            if (part)
+            {
+                GraphicsDevice::drawElements(part->getPrimitiveType(), part->getIndexCount(), part->getIndexFormat(), (GLvoid*)(size_t)part->getIndexOffset(), instanceCount);
+            }
+            else
+            {
+                GraphicsDevice::drawArrays(mesh->getPrimitiveType(), 0, mesh->getVertexCount(), instanceCount);
+            }
+            ++drawCalls;
+
+            // Restore the attributes so that other draws using this binding are not instanced.
+            for (unsigned int c = 0; c < 4; ++c)
+            {
+                GL_ASSERT( glVertexAttribDivisor(attrib + c, 0) );
+                GL_ASSERT( glDisableVertexAttribArray(attrib + c) );
+            }
+            if (paletteAttrib != -1)
+            {
+                GL_ASSERT( glVertexAttribDivisor(paletteAttrib, 0) );
+                GL_ASSERT( glDisableVertexAttribArray(paletteAttrib) );
+            }
+        }
+        else
+#endif
+        {
+            // Without instancing support, the matrix is passed as a constant attribute for each instance.
+            for (unsigned int j = 0; j < instanceCount; ++j)
+            {
+                const float* m = &_instanceData[j * INSTANCE_FLOAT_COUNT];
+                for (unsigned int c = 0; c < 4; ++c)
+                {
+                    GL_ASSERT( glVertexAttrib4fv(attrib + c, m + c * 4) );
+                }
+                if (paletteAttrib != -1)
+                    GL_ASSERT( glVertexAttrib1f(paletteAttrib, (float)j) );
+
+                if (part)
+                {
+                    GraphicsDevice::drawElements(part->getPrimitiveType(), part->getIndexCount(), part->getIndexFormat(), (GLvoid*)(size_t)part->getIndexOffset());
+                }
+                else
+                {
+                    GraphicsDevice::drawArrays(mesh->getPrimitiveType(), 0, mesh->getVertexCount());
+                }
+                ++drawCalls;
+            }
+        }
+
+        pass->unbind();
+    }
+    return drawCalls;
+}
+
+}
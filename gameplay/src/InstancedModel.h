@@ -0,0 +1,269 @@
+#ifndef INSTANCEDMODEL_H_
+#define INSTANCEDMODEL_H_
+
+#include "Model.h"
+#include "Drawable.h"
+#include "Texture.h"
+
+namespace gameplay
+{
+
+class Impostor;
+
+/**
+ * Defines a drawable that renders one Mesh many times with a single draw call per mesh part.
+ *
+ * An instanced model draws its mesh once for every instance node that is added to it,
+ * with the transformation of each instance taken from its node. The world matrix of each
+ * instance node is collected into a per-instance vertex buffer every frame and the mesh is
+ * drawn using hardware instancing where it is supported. On platforms without instancing
+ * support, the instances are drawn one after another with the same materials.
+ *
+ * The instance matrices are relative to the node that the instanced model is attached to,
+ * so the material parameters of the instanced model (such as u_worldViewProjectionMatrix)
+ * are bound to that node. Instance nodes do not need to be part of the scene and should not
+ * have a drawable of their own.
+ *
+ * The materials of an instanced model must use an effect that reads the per-instance
+ * matrix from the "a_instanceMatrix" vertex attribute. The built-in colored and textured
+ * shaders do this when compiled with the INSTANCED define, for example:
+ *
+ * @code
+ * InstancedModel* trees = InstancedModel::create(treeMesh);
+ * trees->getModel()->setMaterial("res/common/tree.material");  // defines INSTANCED
+ * for (unsigned int i = 0; i < nodeCount; ++i)
+ *     trees->addInstance(treeNodes[i]);
+ * scene->addNode("trees")->setDrawable(trees);
+ * @endcode
+ *
+ * Skinned meshes can be instanced as crowds. When the node of an instance has a Model with
+ * a MeshSkin, the matrix palette of the skin is written to a row of a floating point palette
+ * texture each frame, so every instance is drawn in its own pose by the same draw call. The
+ * instance nodes are usually clones of an animated character that are not added to the scene,
+ * since their animations play without them being drawn. The materials must define INSTANCED,
+ * SKINNING and SKINNING_TEXTURE, which read the palette of each instance from the
+ * "u_matrixPaletteTexture" uniform at the row given by the "a_instancePalette" vertex attribute.
+ * The skins of a crowd must have the same number of joints, and instances without a skin are
+ * drawn in the bind pose.
+ *
+ * Distant instances can be drawn by an Impostor, as billboards showing snapshots of the mesh,
+ * instead of being drawn with the mesh. The instances that are further than the impostor distance
+ * from the active camera are all drawn by one more instanced draw call. Skinned crowds are always
+ * drawn with their meshes.
+ *
+ * @script{ignore}
+ */
+class InstancedModel : public Ref, public Drawable
+{
+    friend class Node;
+
+public:
+
+    /**
+     * Creates a new instanced model for the specified mesh.
+     *
+     * @param mesh The mesh to draw for each instance.
+     *
+     * @return The new instanced model.
+     */
+    static InstancedModel* create(Mesh* mesh);
+
+    /**
+     * Returns the model that holds the mesh and materials drawn for each instance.
+     *
+     * Materials for the instances are set on this model. The material parameters of
+     * the model are bound to the node of the instanced model.
+     *
+     * @return The model of this instanced model.
+     */
+    Model* getModel() const;
+
+    /**
+     * Returns the mesh drawn for each instance.
+     *
+     * @return The mesh drawn for each instance.
+     */
+    Mesh* getMesh() const;
+
+    /**
+     * Adds an instance that is transformed by the specified node.
+     *
+     * @param node The node that positions the new instance.
+     *
+     * @return The index of the new instance.
+     */
+    unsigned int addInstance(Node* node);
+
+    /**
+     * Removes the instance that is transformed by the specified node.
+     *
+     * @param node The node of the instance to remove.
+     *
+     * @return true if the instance was found and removed, false otherwise.
+     */
+    bool removeInstance(Node* node);
+
+    /**
+     * Removes all instances.
+     */
+    void clearInstances();
+
+    /**
+     * Returns the node of the instance at the specified index.
+     *
+     * @param index The index of the instance.
+     *
+     * @return The node of the instance.
+     */
+    Node* getInstance(unsigned int index) const;
+
+    /**
+     * Returns the number of instances.
+     *
+     * @return The number of instances.
+     */
+    unsigned int getInstanceCount() const;
+
+    /**
+     * Returns the number of instances that were drawn with the mesh by the last call to draw().
+     *
+     * Instances that are disabled or outside of the view frustum are not drawn, and instances that
+     * are drawn by the impostor are not counted.
+     *
+     * @return The number of instances that were drawn.
+     */
+    unsigned int getVisibleInstanceCount() const;
+
+    /**
+     * Returns the number of instances that were drawn by the impostor in the last call to draw().
+     *
+     * @return The number of instances that were drawn by the impostor.
+     */
+    unsigned int getImpostorInstanceCount() const;
+
+    /**
+     * Enables or disables culling of individual instances against the view frustum
+     * of the active camera.
+     *
+     * Frustum culling is enabled by default.
+     *
+     * @param enabled true to enable frustum culling, false to disable it.
+     */
+    void setFrustumCulling(bool enabled);
+
+    /**
+     * Determines if individual instances are culled against the view frustum.
+     *
+     * @return true if frustum culling is enabled, false otherwise.
+     */
+    bool isFrustumCulling() const;
+
+    /**
+     * Sets the impostor that draws the instances that are further than a distance from the camera.
+     *
+     * The atlas of the impostor is rendered when an instance is first far enough to be drawn by it.
+     * Until the atlas is rendered, all the instances are drawn with the mesh.
+     *
+     * @param impostor The impostor, or NULL to draw all the instances with the mesh.
+     * @param distance The distance from the active camera beyond which the instances are drawn by the impostor.
+     */
+    void setImpostor(Impostor* impostor, float distance);
+
+    /**
+     * Returns the impostor that draws the distant instances.
+     *
+     * @return The impostor, or NULL if all the instances are drawn with the mesh.
+     */
+    Impostor* getImpostor() const;
+
+    /**
+     * Returns the distance from the active camera beyond which the instances are drawn by the impostor.
+     *
+     * @return The impostor distance.
+     */
+    float getImpostorDistance() const;
+
+    /**
+     * Determines if the current platform supports hardware instancing.
+     *
+     * @return true if instances are drawn with hardware instancing, false otherwise.
+     */
+    static bool isInstancingSupported();
+
+    /**
+     * @see Drawable::draw
+     *
+     * Wireframe drawing is not supported for instanced models.
+     */
+    unsigned int draw(bool wireframe = false);
+
+protected:
+
+    /**
+     * @see Drawable::clone
+     */
+    Drawable* clone(NodeCloneContext& context);
+
+    /**
+     * @see Drawable::setNode
+     */
+    void setNode(Node* node);
+
+private:
+
+    /**
+     * Constructor.
+     */
+    InstancedModel(Model* model);
+
+    /**
+     * Destructor. Hidden use release() instead.
+     */
+    ~InstancedModel();
+
+    /**
+     * Hidden copy constructor.
+     */
+    InstancedModel(const InstancedModel& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    InstancedModel& operator=(const InstancedModel&);
+
+    unsigned int updateInstances();
+
+    unsigned int getPaletteJointCount() const;
+
+    void writePalette(unsigned int row, Node* node, unsigned int jointCount);
+
+    void updatePaletteTexture(unsigned int jointCount);
+
+    void bindPalette(Effect* effect);
+
+    unsigned int drawInstances(Material* material, MeshPart* part, unsigned int instanceCount);
+
+    Model* _model;
+    std::vector<Node*> _instances;
+    std::vector<float> _instanceData;
+    std::vector<BoundingSphere> _instanceBounds;
+    std::vector<unsigned char> _instanceVisible;
+    GLuint _instanceBuffer;
+    unsigned int _instanceBufferCapacity;
+    unsigned int _visibleCount;
+    std::vector<float> _paletteData;
+    Texture::Sampler* _paletteSampler;
+    unsigned int _paletteWidth;
+    unsigned int _paletteRowCount;
+    GLuint _paletteIndexBuffer;
+    unsigned int _paletteIndexCapacity;
+    Impostor* _impostor;
+    float _impostorDistance;
+    unsigned int _impostorCount;
+    bool _frustumCulling;
+    bool _attributeWarningLogged;
+};
+
+}
+
+#endif
@@ -0,0 +1,505 @@
+#include "Base.h"
+#include "InstancedSprite.h"
+#include "GraphicsDevice.h"
+#include "Game.h"
+#include "Scene.h"
+#include "Technique.h"
+#include "Pass.h"
+#include "SpriteRenderer.h"
+#include "InstancedModel.h"
+
+// Number of floats stored per instance (position and rotation, scale and frame, color)
+#define INSTANCE_FLOAT_COUNT 12
+
+// Maximum number of frames, which must match the FRAME_COUNT define of the effect
+#define INSTANCED_SPRITE_MAX_FRAMES 64
+#define INSTANCED_SPRITE_DEFINES "INSTANCED;FRAME_COUNT 64"
+
+#define INSTANCED_SPRITE_VSH "res/shaders/sprite.vert"
+#define INSTANCED_SPRITE_FSH "res/shaders/sprite.frag"
+
+#define VERTEX_ATTRIBUTE_INSTANCE_POSITION_NAME "a_instancePosition"
+#define VERTEX_ATTRIBUTE_INSTANCE_SCALE_NAME    "a_instanceScale"
+#define VERTEX_ATTRIBUTE_INSTANCE_COLOR_NAME    "a_instanceColor"
+
+namespace gameplay
+{
+
+static const float __defaultInstance[INSTANCE_FLOAT_COUNT] = { 0, 0, 0, 0, 1, 1, 0, 0, 1, 1, 1, 1 };
+
+InstancedSprite::InstancedSprite()
+    : Drawable(), _quad(NULL), _material(NULL), _width(0), _height(0), _anchor(0.5f, 0.5f),
+    _instanceBuffer(0), _instanceBufferCapacity(0), _dirtyFirst(0), _dirtyEnd(0), _attributeWarningLogged(false)
+{
+    if (InstancedModel::isInstancingSupported())
+    {
+        GL_ASSERT( glGenBuffers(1, &_instanceBuffer) );
+    }
+}
+
+InstancedSprite::~InstancedSprite()
+{
+    SAFE_RELEASE(_material);
+    SAFE_RELEASE(_quad);
+
+    if (_instanceBuffer)
+    {
+        RenderState::deleteBuffer(_instanceBuffer);
+        _instanceBuffer = 0;
+    }
+}
+
+InstancedSprite* InstancedSprite::create(const char* imagePath, float width, float height, const Rectangle& source,
+                                         unsigned int frameCount, unsigned int frameStride, unsigned int framePadding)
+{
+    GP_ASSERT(imagePath);
+    GP_ASSERT(frameCount > 0);
+
+    if (frameCount > INSTANCED_SPRITE_MAX_FRAMES)
+    {
+        GP_WARN("Instanced sprite '%s' has %u frames, only the first %u are used.", imagePath, frameCount, INSTANCED_SPRITE_MAX_FRAMES);
+        frameCount = INSTANCED_SPRITE_MAX_FRAMES;
+    }
+
+    Texture* texture = Texture::create(imagePath);
+    if (!texture)
+    {
+        GP_WARN("Failed to load image '%s' for instanced sprite.", imagePath);
+        return NULL;
+    }
+    Texture::Sampler* sampler = Texture::Sampler::create(texture);
+    SAFE_RELEASE(texture);
+
+    Effect* effect = Effect::createFromFile(INSTANCED_SPRITE_VSH, INSTANCED_SPRITE_FSH, INSTANCED_SPRITE_DEFINES);
+    if (!effect)
+    {
+        GP_WARN("Failed to create effect for instanced sprite.");
+        SAFE_RELEASE(sampler);
+        return NULL;
+    }
+
+    InstancedSprite* sprite = new InstancedSprite();
+    sprite->_width = width;
+    sprite->_height = height;
+
+    // Compute the frames across the image from the source region, like Sprite::computeFrames.
+    unsigned int imageWidth = sampler->getTexture()->getWidth();
+    unsigned int imageHeight = sampler->getTexture()->getHeight();
+    float strideWidth = frameStride > 0 ? frameStride * (source.width + framePadding) : (float)imageWidth;
+    float x = source.x;
+    float y = source.y;
+    sprite->_frames.resize(frameCount);
+    for (unsigned int i = 0; i < frameCount; ++i)
+    {
+        sprite->_frames[i].set(x, y, source.width, source.height);
+        x += source.width + (float)framePadding;
+        if (x - source.x >= strideWidth || x + source.width > imageWidth)
+        {
+            x = source.x;
+            y += source.height + (float)framePadding;
+            if (y + source.height > imageHeight)
+                y = source.y;
+        }
+    }
+
+    bool initialized = sprite->initialize(sampler, effect);
+    SAFE_RELEASE(sampler);
+    SAFE_RELEASE(effect);
+    if (!initialized)
+    {
+        SAFE_RELEASE(sprite);
+        return NULL;
+    }
+    return sprite;
+}
+
+bool InstancedSprite::initialize(Texture::Sampler* sampler, Effect* effect)
+{
+    GP_ASSERT(sampler);
+    GP_ASSERT(effect);
+
+    // The quad of the sprite is a triangle strip whose texture coordinates are its corners.
+    VertexFormat::Element vertexElements[] =
+    {
+        VertexFormat::Element(VertexFormat::POSITION, 3),
+        VertexFormat::Element(VertexFormat::TEXCOORD0, 2)
+    };
+    _quad = Mesh::createMesh(VertexFormat(vertexElements, 2), 4, true);
+    if (!_quad)
+    {
+        GP_WARN("Failed to create quad for instanced sprite.");
+        return false;
+    }
+    _quad->setPrimitiveType(Mesh::TRIANGLE_STRIP);
+    updateQuad();
+
+    _material = Material::create(effect);
+    _material->getStateBlock()->setBlend(true);
+    _material->getStateBlock()->setBlendSrc(RenderState::BLEND_SRC_ALPHA);
+    _material->getStateBlock()->setBlendDst(RenderState::BLEND_ONE_MINUS_SRC_ALPHA);
+    _material->getParameter("u_texture")->setValue(sampler);
+
+    Pass* pass = _material->getTechnique()->getPassByIndex(0);
+    VertexAttributeBinding* b = VertexAttributeBinding::create(_quad, effect);
+    pass->setVertexAttributeBinding(b);
+    SAFE_RELEASE(b);
+
+    updateFrames();
+    return true;
+}
+
+void InstancedSprite::updateQuad()
+{
+    GP_ASSERT(_quad);
+
+    float left = -_anchor.x * _width;
+    float bottom = -_anchor.y * _height;
+    float right = left + _width;
+    float top = bottom + _height;
+    const float vertices[] =
+    {
+        left, bottom, 0, 0, 0,
+        left, top, 0, 0, 1,
+        right, bottom, 0, 1, 0,
+        right, top, 0, 1, 1
+    };
+    _quad->setVertexData(vertices, 0, 4);
+}
+
+void InstancedSprite::updateFrames()
+{
+    GP_ASSERT(_material);
+
+    // The frames are sent as the offset and size of their region in texture coordinates, with
+    // the image flipped vertically as it is by sprite batches.
+    Texture::Sampler* sampler = _material->getParameter("u_texture")->getSampler();
+    GP_ASSERT(sampler);
+    Texture* texture = sampler->getTexture();
+    float widthRatio = 1.0f / (float)texture->getWidth();
+    float heightRatio = 1.0f / (float)texture->getHeight();
+
+    _frameCoords.resize(_frames.size());
+    for (size_t i = 0, count = _frames.size(); i < count; ++i)
+    {
+        const Rectangle& frame = _frames[i];
+        _frameCoords[i].set(frame.x * widthRatio, 1.0f - (frame.y + frame.height) * heightRatio,
+                            frame.width * widthRatio, frame.height * heightRatio);
+    }
+    _material->getParameter("u_frames")->setValue(&_frameCoords[0], (unsigned int)_frameCoords.size());
+}
+
+float InstancedSprite::getWidth() const
+{
+    return _width;
+}
+
+float InstancedSprite::getHeight() const
+{
+    return _height;
+}
+
+void InstancedSprite::setAnchor(const Vector2& anchor)
+{
+    _anchor = anchor;
+    updateQuad();
+}
+
+const Vector2& InstancedSprite::getAnchor() const
+{
+    return _anchor;
+}
+
+unsigned int InstancedSprite::getFrameCount() const
+{
+    return (unsigned int)_frames.size();
+}
+
+void InstancedSprite::setFrameSource(unsigned int frameIndex, const Rectangle& source)
+{
+    GP_ASSERT(frameIndex < _frames.size());
+
+    _frames[frameIndex] = source;
+    updateFrames();
+}
+
+const Rectangle& InstancedSprite::getFrameSource(unsigned int frameIndex) const
+{
+    GP_ASSERT(frameIndex < _frames.size());
+
+    return _frames[frameIndex];
+}
+
+void InstancedSprite::setInstanceCount(unsigned int count)
+{
+    unsigned int oldCount = getInstanceCount();
+    _instanceData.resize(count * INSTANCE_FLOAT_COUNT);
+    for (unsigned int i = oldCount; i < count; ++i)
+    {
+        memcpy(&_instanceData[i * INSTANCE_FLOAT_COUNT], __defaultInstance, sizeof(__defaultInstance));
+    }
+    if (count > oldCount)
+        getInstanceData(oldCount, count - oldCount);
+    if (_dirtyEnd > count)
+        _dirtyEnd = count;
+    if (_dirtyFirst > _dirtyEnd)
+        _dirtyFirst = _dirtyEnd;
+}
+
+unsigned int InstancedSprite::getInstanceCount() const
+{
+    return (unsigned int)(_instanceData.size() / INSTANCE_FLOAT_COUNT);
+}
+
+float* InstancedSprite::getInstanceData(unsigned int first, unsigned int count)
+{
+    GP_ASSERT(first + count <= getInstanceCount());
+
+    // Only the range of instances that changed since the last draw is sent.
+    if (_dirtyFirst == _dirtyEnd)
+    {
+        _dirtyFirst = first;
+        _dirtyEnd = first + count;
+    }
+    else
+    {
+        _dirtyFirst = std::min(_dirtyFirst, first);
+        _dirtyEnd = std::max(_dirtyEnd, first + count);
+    }
+    return &_instanceData[first * INSTANCE_FLOAT_COUNT];
+}
+
+void InstancedSprite::setPositions(unsigned int first, unsigned int count, const Vector3* positions)
+{
+    GP_ASSERT(positions || count == 0);
+    if (count == 0)
+        return;
+
+    float* data = getInstanceData(first, count);
+    for (unsigned int i = 0; i < count; ++i, data += INSTANCE_FLOAT_COUNT)
+    {
+        data[0] = positions[i].x;
+        data[1] = positions[i].y;
+        data[2] = positions[i].z;
+    }
+}
+
+void InstancedSprite::setScales(unsigned int first, unsigned int count, const Vector2* scales)
+{
+    GP_ASSERT(scales || count == 0);
+    if (count == 0)
+        return;
+
+    float* data = getInstanceData(first, count);
+    for (unsigned int i = 0; i < count; ++i, data += INSTANCE_FLOAT_COUNT)
+    {
+        data[4] = scales[i].x;
+        data[5] = scales[i].y;
+    }
+}
+
+void InstancedSprite::setRotations(unsigned int first, unsigned int count, const float* rotations)
+{
+    GP_ASSERT(rotations || count == 0);
+    if (count == 0)
+        return;
+
+    float* data = getInstanceData(first, count);
+    for (unsigned int i = 0; i < count; ++i, data += INSTANCE_FLOAT_COUNT)
+    {
+        data[3] = rotations[i];
+    }
+}
+
+void InstancedSprite::setColors(unsigned int first, unsigned int count, const Vector4* colors)
+{
+    GP_ASSERT(colors || count == 0);
+    if (count == 0)
+        return;
+
+    float* data = getInstanceData(first, count);
+    for (unsigned int i = 0; i < count; ++i, data += INSTANCE_FLOAT_COUNT)
+    {
+        data[8] = colors[i].x;
+        data[9] = colors[i].y;
+        data[10] = colors[i].z;
+        data[11] = colors[i].w;
+    }
+}
+
+void InstancedSprite::setFrames(unsigned int first, unsigned int count, const unsigned int* frames)
+{
+    GP_ASSERT(frames || count == 0);
+    if (count == 0)
+        return;
+
+    unsigned int frameCount = getFrameCount();
+    float* data = getInstanceData(first, count);
+    for (unsigned int i = 0; i < count; ++i, data += INSTANCE_FLOAT_COUNT)
+    {
+        data[6] = (float)(frames[i] % frameCount);
+    }
+}
+
+Drawable* InstancedSprite::clone(NodeCloneContext& context)
+{
+    Texture::Sampler* sampler = _material->getParameter("u_texture")->getSampler();
+    Effect* effect = _material->getTechnique()->getPassByIndex(0)->getEffect();
+    GP_ASSERT(sampler && effect);
+
+    InstancedSprite* sprite = new InstancedSprite();
+    sprite->_width = _width;
+    sprite->_height = _height;
+    sprite->_anchor = _anchor;
+    sprite->_frames = _frames;
+    if (!sprite->initialize(sampler, effect))
+    {
+        GP_ERROR("Failed to clone instanced sprite.");
+        SAFE_RELEASE(sprite);
+        return NULL;
+    }
+    sprite->_instanceData = _instanceData;
+    sprite->_dirtyEnd = sprite->getInstanceCount();
+    return sprite;
+}
+
+void InstancedSprite::updateInstances()
+{
+    if (!_instanceBuffer || _dirtyFirst == _dirtyEnd)
+        return;
+
+    // The whole buffer is sent again when it has to grow.
+    unsigned int count = getInstanceCount();
+    RenderState::bindBuffer(GL_ARRAY_BUFFER, _instanceBuffer);
+    if (count > _instanceBufferCapacity)
+    {
+        _instanceBufferCapacity = count;
+        GL_ASSERT( glBufferData(GL_ARRAY_BUFFER, _instanceBufferCapacity * INSTANCE_FLOAT_COUNT * sizeof(float), NULL, GL_DYNAMIC_DRAW) );
+        _dirtyFirst = 0;
+        _dirtyEnd = count;
+    }
+    unsigned int size = (_dirtyEnd - _dirtyFirst) * INSTANCE_FLOAT_COUNT * sizeof(float);
+    GL_ASSERT( glBufferSubData(GL_ARRAY_BUFFER, _dirtyFirst * INSTANCE_FLOAT_COUNT * sizeof(float), size,
+                               &_instanceData[_dirtyFirst * INSTANCE_FLOAT_COUNT]) );
+    RenderStats::countBufferUpload(size);
+    _dirtyFirst = _dirtyEnd = 0;
+}
+
+unsigned int InstancedSprite::draw(bool wireframe)
+{
+    unsigned int instanceCount = getInstanceCount();
+    if (instanceCount == 0)
+        return 0;
+
+    Effect* effect = _material->getTechnique()->getPassByIndex(0)->getEffect();
+    if (!effect->isReady())
+        return 0;
+
+    // Apply scene camera projection and translation offsets, like Sprite::draw
+    Vector3 position = Vector3::zero();
+    Matrix projectionMatrix;
+    bool hasProjection = false;
+    if (_node && _node->getScene())
+    {
+        Camera* activeCamera = _node->getScene()->getActiveCamera();
+        if (activeCamera && activeCamera->getNode())
+        {
+            projectionMatrix = _node->getProjectionMatrix();
+            hasProjection = true;
+
+            Node* cameraNode = activeCamera->getNode();
+            position.x -= cameraNode->getTranslationWorld().x;
+            position.y -= cameraNode->getTranslationWorld().y;
+        }
+
+        Vector3 translation = _node->getTranslationWorld();
+        position.x += translation.x;
+        position.y += translation.y;
+        position.z += translation.z;
+    }
+    if (!hasProjection)
+    {
+        const Rectangle& viewport = Game::getInstance()->getViewport();
+        Matrix::createOrthographicOffCenter(0, viewport.width, viewport.height, 0, 0, 1, &projectionMatrix);
+    }
+    Matrix translation;
+    Matrix::createTranslation(position, &translation);
+    Matrix viewProjection;
+    Matrix::multiply(projectionMatrix, translation, &viewProjection);
+    _material->getParameter("u_projectionMatrix")->setValue(viewProjection);
+
+    // The draws of sprites that were made before this one must be drawn first.
+    Game::getInstance()->getSpriteRenderer()->flush();
+
+    updateInstances();
+    return drawInstances(_material->getTechnique()->getPassByIndex(0));
+}
+
+unsigned int InstancedSprite::drawInstances(Pass* pass)
+{
+    GP_ASSERT(pass);
+
+    Effect* effect = pass->getEffect();
+    VertexAttribute attribs[3] =
+    {
+        effect->getVertexAttribute(VERTEX_ATTRIBUTE_INSTANCE_POSITION_NAME),
+        effect->getVertexAttribute(VERTEX_ATTRIBUTE_INSTANCE_SCALE_NAME),
+        effect->getVertexAttribute(VERTEX_ATTRIBUTE_INSTANCE_COLOR_NAME)
+    };
+    if (attribs[0] == -1 || attribs[1] == -1 || attribs[2] == -1)
+    {
+        if (!_attributeWarningLogged)
+        {
+            GP_WARN("Effect '%s' used by an instanced sprite has no per-instance vertex attributes.", effect->getId());
+            _attributeWarningLogged = true;
+        }
+        return 0;
+    }
+
+    unsigned int instanceCount = getInstanceCount();
+    unsigned int drawCalls = 0;
+    pass->bind();
+    RenderState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+#ifdef GP_USE_INSTANCING
+    if (_instanceBuffer)
+    {
+        // Each attribute is a vec4 of the instance that advances once per instance.
+        RenderState::bindBuffer(GL_ARRAY_BUFFER, _instanceBuffer);
+        for (unsigned int a = 0; a < 3; ++a)
+        {
+            GL_ASSERT( glVertexAttribPointer(attribs[a], 4, GL_FLOAT, GL_FALSE, INSTANCE_FLOAT_COUNT * sizeof(float), (void*)(a * 4 * sizeof(float))) );
+            GL_ASSERT( glEnableVertexAttribArray(attribs[a]) );
+            GL_ASSERT( glVertexAttribDivisor(attribs[a], 1) );
+        }
+
+        GraphicsDevice::drawArrays(GL_TRIANGLE_STRIP, 0, 4, instanceCount);
+        ++drawCalls;
+
+        // Restore the attributes so that other draws using this binding are not instanced.
+        for (unsigned int a = 0; a < 3; ++a)
+        {
+            GL_ASSERT( glVertexAttribDivisor(attribs[a], 0) );
+            GL_ASSERT( glDisableVertexAttribArray(attribs[a]) );
+        }
+    }
+    else
+#endif
+    {
+        // Without instancing support, the values of each instance are passed as constant attributes.
+        for (unsigned int i = 0; i < instanceCount; ++i)
+        {
+            const float* data = &_instanceData[i * INSTANCE_FLOAT_COUNT];
+            for (unsigned int a = 0; a < 3; ++a)
+            {
+                GL_ASSERT( glVertexAttrib4fv(attribs[a], data + a * 4) );
+            }
+            GraphicsDevice::drawArrays(GL_TRIANGLE_STRIP, 0, 4);
+            ++drawCalls;
+        }
+    }
+
+    pass->unbind();
+    return drawCalls;
+}
+
+}
@@ -0,0 +1,249 @@
+#ifndef INSTANCEDSPRITE_H_
+#define INSTANCEDSPRITE_H_
+
+#include "Ref.h"
+#include "Drawable.h"
+#include "Mesh.h"
+#include "Material.h"
+#include "Rectangle.h"
+#include "Vector2.h"
+#include "Vector4.h"
+
+namespace gameplay
+{
+
+/**
+ * Defines a drawable that renders many sprites of the same image with a single draw call.
+ *
+ * Each instance of an instanced sprite has its own position, scale, rotation, color and
+ * animation frame, which are kept in a per-instance vertex buffer. The quad of each instance
+ * is positioned and its frame is looked up in the vertex shader, so drawing the instances
+ * costs the same on the CPU however many there are. The instances are set in bulk from arrays,
+ * which only marks the range of the buffer that changed to be sent to the GPU when the sprite
+ * is next drawn:
+ *
+ * @code
+ * InstancedSprite* bullets = InstancedSprite::create("res/bullets.png", 16, 16, Rectangle(0, 0, 16, 16), 8);
+ * bullets->setInstanceCount(bulletCount);
+ * scene->addNode("bullets")->setDrawable(bullets);
+ *
+ * // Each frame, after moving the bullets:
+ * bullets->setPositions(0, bulletCount, positions);
+ * bullets->setFrames(0, bulletCount, frames);
+ * @endcode
+ *
+ * The positions of the instances are relative to the translation of the node of the sprite, and
+ * are projected by the active camera of the scene like the positions of Sprite drawables. The
+ * instances are drawn in order, with later instances drawn over earlier ones.
+ *
+ * An instanced sprite can have up to 64 frames. On platforms without hardware instancing the
+ * instances are drawn one after another.
+ *
+ * @script{ignore}
+ */
+class InstancedSprite : public Ref, public Drawable
+{
+    friend class Node;
+
+public:
+
+    /**
+     * Creates a new instanced sprite without any instances.
+     *
+     * The frames are taken from the image in rows of frames of the size of the source region,
+     * moving across the image from the source region and then wrapping at the frame stride or at
+     * the edge of the image.
+     *
+     * @param imagePath The path of the image of the sprite.
+     * @param width The width of the sprite.
+     * @param height The height of the sprite.
+     * @param source The region of the image of the first frame.
+     * @param frameCount The number of frames.
+     * @param frameStride The number of frames in each row, or 0 to fill the width of the image.
+     * @param framePadding The number of pixels between frames.
+     *
+     * @return The new instanced sprite, or NULL if the image or the effect could not be loaded.
+     */
+    static InstancedSprite* create(const char* imagePath, float width, float height, const Rectangle& source,
+                                   unsigned int frameCount = 1, unsigned int frameStride = 0, unsigned int framePadding = 1);
+
+    /**
+     * Returns the width of the sprite.
+     *
+     * @return The width of the sprite.
+     */
+    float getWidth() const;
+
+    /**
+     * Returns the height of the sprite.
+     *
+     * @return The height of the sprite.
+     */
+    float getHeight() const;
+
+    /**
+     * Sets the point of the sprite that instances are positioned and rotated by, as a
+     * fraction of its size. The anchor is (0.5, 0.5), the center of the sprite, by default.
+     *
+     * @param anchor The anchor of the sprite.
+     */
+    void setAnchor(const Vector2& anchor);
+
+    /**
+     * Returns the point of the sprite that instances are positioned and rotated by.
+     *
+     * @return The anchor of the sprite.
+     */
+    const Vector2& getAnchor() const;
+
+    /**
+     * Returns the number of frames of the sprite.
+     *
+     * @return The number of frames.
+     */
+    unsigned int getFrameCount() const;
+
+    /**
+     * Sets the region of the image of a frame.
+     *
+     * @param frameIndex The index of the frame.
+     * @param source The region of the image, in pixels.
+     */
+    void setFrameSource(unsigned int frameIndex, const Rectangle& source);
+
+    /**
+     * Returns the region of the image of a frame.
+     *
+     * @param frameIndex The index of the frame.
+     *
+     * @return The region of the image, in pixels.
+     */
+    const Rectangle& getFrameSource(unsigned int frameIndex) const;
+
+    /**
+     * Sets the number of instances. New instances are at the origin, with a scale of 1, no
+     * rotation, a white color and the first frame.
+     *
+     * @param count The number of instances.
+     */
+    void setInstanceCount(unsigned int count);
+
+    /**
+     * Returns the number of instances.
+     *
+     * @return The number of instances.
+     */
+    unsigned int getInstanceCount() const;
+
+    /**
+     * Sets the positions of a range of instances.
+     *
+     * @param first The index of the first instance.
+     * @param count The number of instances.
+     * @param positions The positions of the instances.
+     */
+    void setPositions(unsigned int first, unsigned int count, const Vector3* positions);
+
+    /**
+     * Sets the scales of a range of instances.
+     *
+     * @param first The index of the first instance.
+     * @param count The number of instances.
+     * @param scales The scales of the instances, relative to the size of the sprite.
+     */
+    void setScales(unsigned int first, unsigned int count, const Vector2* scales);
+
+    /**
+     * Sets the rotations of a range of instances.
+     *
+     * @param first The index of the first instance.
+     * @param count The number of instances.
+     * @param rotations The rotations of the instances around their anchor, in radians.
+     */
+    void setRotations(unsigned int first, unsigned int count, const float* rotations);
+
+    /**
+     * Sets the colors of a range of instances, which the image is multiplied by.
+     *
+     * @param first The index of the first instance.
+     * @param count The number of instances.
+     * @param colors The colors of the instances.
+     */
+    void setColors(unsigned int first, unsigned int count, const Vector4* colors);
+
+    /**
+     * Sets the frames of a range of instances. The frame indices wrap around the number of
+     * frames, so an animation can keep incrementing them.
+     *
+     * @param first The index of the first instance.
+     * @param count The number of instances.
+     * @param frames The frame indices of the instances.
+     */
+    void setFrames(unsigned int first, unsigned int count, const unsigned int* frames);
+
+    /**
+     * @see Drawable::draw
+     *
+     * Wireframe drawing is not supported for instanced sprites.
+     */
+    unsigned int draw(bool wireframe = false);
+
+protected:
+
+    /**
+     * @see Drawable::clone
+     */
+    Drawable* clone(NodeCloneContext& context);
+
+private:
+
+    /**
+     * Constructor.
+     */
+    InstancedSprite();
+
+    /**
+     * Destructor. Hidden use release() instead.
+     */
+    ~InstancedSprite();
+
+    /**
+     * Hidden copy constructor.
+     */
+    InstancedSprite(const InstancedSprite& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    InstancedSprite& operator=(const InstancedSprite&);
+
+    bool initialize(Texture::Sampler* sampler, Effect* effect);
+
+    void updateQuad();
+
+    void updateFrames();
+
+    float* getInstanceData(unsigned int first, unsigned int count);
+
+    void updateInstances();
+
+    unsigned int drawInstances(Pass* pass);
+
+    Mesh* _quad;
+    Material* _material;
+    float _width;
+    float _height;
+    Vector2 _anchor;
+    std::vector<Rectangle> _frames;
+    std::vector<Vector4> _frameCoords;
+    std::vector<float> _instanceData;
+    GLuint _instanceBuffer;
+    unsigned int _instanceBufferCapacity;
+    unsigned int _dirtyFirst;
+    unsigned int _dirtyEnd;
+    bool _attributeWarningLogged;
+};
+
+}
+
+#endif
@@ -0,0 +1,379 @@
+#include "Base.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+// Maximum number of threads the job system runs on
+#define JOB_MAX_THREADS 32
+
+namespace gameplay
+{
+
+class JobSystem::Job
+{
+public:
+
+    Job(JobFunction function, void* cookie, Job* parent)
+        : function(function), cookie(cookie), parent(parent), unfinished(1), pending(1), refs(2), finished(false)
+    {
+    }
+
+    JobFunction function;
+    void* cookie;
+    Job* parent;
+    // This job plus its children that have not finished.
+    std::atomic<int> unfinished;
+    // Dependencies that have not finished, plus one until the job is started.
+    std::atomic<int> pending;
+    // The handle of the caller plus one until the job has finished.
+    std::atomic<int> refs;
+    std::atomic<bool> finished;
+    // Jobs waiting for this one to finish, guarded by the dependency mutex.
+    std::vector<Job*> dependents;
+};
+
+struct JobSystem::Worker
+{
+    std::mutex mutex;
+    std::deque<Job*> jobs;
+    std::thread::id threadId;
+};
+
+// The range of a parallelFor() call that is shared by its jobs.
+struct ParallelFor
+{
+    JobSystem::RangeFunction function;
+    void* cookie;
+    unsigned int count;
+    unsigned int batchSize;
+    std::atomic<unsigned int> next;
+};
+
+JobSystem::JobSystem()
+    : _workers(NULL), _workerCount(0), _queuedCount(0), _quit(false), _frameJob(NULL)
+{
+}
+
+JobSystem::~JobSystem()
+{
+    finalize();
+}
+
+void JobSystem::initialize(unsigned int threadCount)
+{
+    GP_ASSERT(_workers == NULL);
+
+    if (threadCount == 0)
+        threadCount = std::thread::hardware_concurrency();
+    threadCount = std::max(1u, std::min(threadCount, (unsigned int)JOB_MAX_THREADS));
+
+    // The first worker belongs to the thread that runs the game.
+    _workerCount = threadCount;
+    _workers = new Worker[_workerCount];
+    _workers[0].threadId = std::this_thread::get_id();
+    _quit = false;
+    for (unsigned int i = 1; i < _workerCount; ++i)
+    {
+        _threads.push_back(std::thread(&JobSystem::threadProc, this, i));
+        _workers[i].threadId = _threads.back().get_id();
+    }
+
+    _frameJob = create(NULL, NULL);
+}
+
+void JobSystem::finalize()
+{
+    if (_workers == NULL)
+        return;
+
+    // Finish the work of the current frame before stopping the threads.
+    run(_frameJob);
+    wait(_frameJob);
+    _frameJob = NULL;
+
+    {
+        std::lock_guard<std::mutex> lock(_sleepMutex);
+        _quit = true;
+    }
+    _wake.notify_all();
+    for (size_t i = 0, count = _threads.size(); i < count; ++i)
+    {
+        _threads[i].join();
+    }
+    _threads.clear();
+
+    SAFE_DELETE_ARRAY(_workers);
+    _workerCount = 0;
+}
+
+JobSystem::Job* JobSystem::create(JobFunction function, void* cookie, Job* parent)
+{
+    Job* job = new Job(function, cookie, parent);
+    if (parent)
+    {
+        GP_ASSERT(!parent->finished);
+
+        // A child keeps its parent alive and unfinished until the child finishes.
+        ++parent->unfinished;
+        ++parent->refs;
+    }
+    return job;
+}
+
+void JobSystem::addDependency(Job* job, Job* dependency)
+{
+    GP_ASSERT(job);
+    GP_ASSERT(dependency);
+    GP_ASSERT(job != dependency);
+
+    std::lock_guard<std::mutex> lock(_dependencyMutex);
+    if (!dependency->finished)
+    {
+        ++job->pending;
+        dependency->dependents.push_back(job);
+    }
+}
+
+void JobSystem::run(Job* job)
+{
+    GP_ASSERT(job);
+
+    if (--job->pending == 0)
+        push(job);
+}
+
+void JobSystem::wait(Job* job)
+{
+    GP_ASSERT(job);
+
+    while (!job->finished)
+    {
+        if (!runQueuedJob())
+        {
+            // The remaining work is running on other threads.
+            std::this_thread::yield();
+        }
+    }
+    release(job);
+}
+
+void JobSystem::release(Job* job)
+{
+    GP_ASSERT(job);
+
+    if (--job->refs == 0)
+    {
+        GP_ASSERT(job->dependents.empty());
+        delete job;
+    }
+}
+
+bool JobSystem::isFinished(const Job* job) const
+{
+    GP_ASSERT(job);
+    return job->finished;
+}
+
+void JobSystem::parallelFor(unsigned int count, unsigned int batchSize, RangeFunction function, void* cookie)
+{
+    GP_ASSERT(function);
+
+    if (count == 0)
+        return;
+    if (batchSize == 0)
+        batchSize = 1;
+
+    unsigned int batchCount = (count + batchSize - 1) / batchSize;
+    if (batchCount == 1 || _workerCount <= 1)
+    {
+        function(cookie, 0, count);
+        return;
+    }
+
+    // Start one job per thread that takes batches of the range until it is used up,
+    // rather than one job per batch.
+    ParallelFor range;
+    range.function = function;
+    range.cookie = cookie;
+    range.count = count;
+    range.batchSize = batchSize;
+    range.next = 0;
+
+    Job* root = create(NULL, NULL);
+    for (unsigned int i = 1, jobCount = std::min(batchCount, _workerCount); i < jobCount; ++i)
+    {
+        Job* job = create(&JobSystem::parallelForProc, &range, root);
+        run(job);
+        release(job);
+    }
+    run(root);
+
+    // The calling thread takes part in the work as well.
+    parallelForProc(&range);
+    wait(root);
+}
+
+void JobSystem::parallelForProc(void* cookie)
+{
+    ParallelFor* range = (ParallelFor*)cookie;
+    unsigned int begin;
+    while ((begin = range->next.fetch_add(range->batchSize)) < range->count)
+    {
+        range->function(range->cookie, begin, std::min(begin + range->batchSize, range->count));
+    }
+}
+
+JobSystem::Job* JobSystem::getFrameJob() const
+{
+    return _frameJob;
+}
+
+unsigned int JobSystem::getThreadCount() const
+{
+    return _workerCount;
+}
+
+void JobSystem::finishFrame()
+{
+    GP_ASSERT(_frameJob);
+
+    run(_frameJob);
+    wait(_frameJob);
+    _frameJob = create(NULL, NULL);
+}
+
+void JobSystem::threadProc(unsigned int index)
+{
+    char name[32];
+    sprintf(name, "Worker %u", index);
+    Profiler::setThreadName(name);
+
+    while (true)
+    {
+        if (runQueuedJob())
+            continue;
+
+        std::unique_lock<std::mutex> lock(_sleepMutex);
+        while (!_quit && _queuedCount == 0)
+        {
+            _wake.wait(lock);
+        }
+        if (_quit)
+            return;
+    }
+}
+
+unsigned int JobSystem::getWorkerIndex() const
+{
+    // Threads that are not part of the pool share the queue of the game thread.
+    std::thread::id threadId = std::this_thread::get_id();
+    for (unsigned int i = 1; i < _workerCount; ++i)
+    {
+        if (_workers[i].threadId == threadId)
+            return i;
+    }
+    return 0;
+}
+
+void JobSystem::push(Job* job)
+{
+    if (_workerCount <= 1)
+    {
+        // There are no other threads to run the job on.
+        execute(job);
+        return;
+    }
+
+    // Count the job before queuing it so that the count never drops below the number of queued jobs.
+    {
+        std::lock_guard<std::mutex> lock(_sleepMutex);
+        ++_queuedCount;
+    }
+    Worker& worker = _workers[getWorkerIndex()];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.jobs.push_back(job);
+    }
+    _wake.notify_one();
+}
+
+JobSystem::Job* JobSystem::pop(unsigned int index)
+{
+    // Take the most recent job from our own queue, which is the most likely to be in the cache.
+    Worker& worker = _workers[index];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.jobs.empty())
+        {
+            Job* job = worker.jobs.back();
+            worker.jobs.pop_back();
+            return job;
+        }
+    }
+
+    // Steal the oldest job from another thread.
+    for (unsigned int i = 1; i < _workerCount; ++i)
+    {
+        Worker& victim = _workers[(index + i) % _workerCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty())
+        {
+            Job* job = victim.jobs.front();
+            victim.jobs.pop_front();
+            return job;
+        }
+    }
+    return NULL;
+}
+
+bool JobSystem::runQueuedJob()
+{
+    if (_workerCount <= 1 || _queuedCount == 0)
+        return false;
+
+    Job* job = pop(getWorkerIndex());
+    if (job == NULL)
+        return false;
+
+    --_queuedCount;
+    execute(job);
+    return true;
+}
+
+void JobSystem::execute(Job* job)
+{
+    if (job->function)
+    {
+        GP_PROFILE_SCOPE("JobSystem::runJob");
+        job->function(job->cookie);
+    }
+    finish(job);
+}
+
+void JobSystem::finish(Job* job)
+{
+    if (--job->unfinished > 0)
+        return;
+
+    // Start the jobs that were waiting for this one.
+    std::vector<Job*> dependents;
+    {
+        std::lock_guard<std::mutex> lock(_dependencyMutex);
+        job->finished = true;
+        dependents.swap(job->dependents);
+    }
+    for (size_t i = 0, count = dependents.size(); i < count; ++i)
+    {
+        if (--dependents[i]->pending == 0)
+            push(dependents[i]);
+    }
+
+    Job* parent = job->parent;
+    release(job);
+    if (parent)
+    {
+        finish(parent);
+        release(parent);
+    }
+}
+
+}
@@ -0,0 +1,220 @@
+#ifndef JOBSYSTEM_H_
+#define JOBSYSTEM_H_
+
+namespace gameplay
+{
+
+/**
+ * Defines a pool of worker threads that run jobs for the game and its controllers.
+ *
+ * A job is a function that is called with a user specified cookie on one of the worker
+ * threads. Each worker thread keeps its own queue of jobs; jobs created while running a
+ * job are queued on the same thread, and threads that run out of work take jobs from the
+ * queues of the other threads. Threads that wait for a job to finish run other queued jobs
+ * in the meantime, so nested waits do not tie up worker threads.
+ *
+ * Jobs can be ordered in two ways. A job can have a parent job, which is not considered
+ * finished until all of its children have finished. A job can also depend on other jobs,
+ * in which case it is not started until they have all finished.
+ *
+ * The job system is owned by the Game and is started along with it. The number of threads
+ * defaults to the number of hardware threads and can be set in the game.config file:
+ *
+ * @code
+ * jobs
+ * {
+ *     threads = 4
+ * }
+ * @endcode
+ *
+ * The thread count includes the thread that runs the game, so a thread count of 1 runs all
+ * jobs on the calling thread when they are started.
+ *
+ * Every frame has a frame job (see getFrameJob). Controllers and game code can add work for
+ * the current frame as children of the frame job, with dependencies between them as needed,
+ * and the Game waits for the frame job to finish before the frame is rendered.
+ *
+ * @script{ignore}
+ */
+class JobSystem
+{
+    friend class Game;
+
+public:
+
+    /**
+     * The function type of jobs.
+     *
+     * @param cookie The cookie that the job was created with.
+     */
+    typedef void (*JobFunction)(void* cookie);
+
+    /**
+     * The function type of the jobs that parallelFor() splits a range into.
+     *
+     * @param cookie The cookie passed to parallelFor().
+     * @param begin The first index of the batch.
+     * @param end One past the last index of the batch.
+     */
+    typedef void (*RangeFunction)(void* cookie, unsigned int begin, unsigned int end);
+
+    /**
+     * A handle to a job. The contents of jobs are internal to the job system.
+     */
+    class Job;
+
+    /**
+     * Creates a new job.
+     *
+     * The job is not started until run() is called on it. The returned handle must be
+     * passed to either wait() or release() when it is no longer needed.
+     *
+     * @param function The function of the job, or NULL for a job that only groups its children.
+     * @param cookie The cookie to pass to the function.
+     * @param parent The parent of the job, or NULL. The parent must not have finished yet.
+     *
+     * @return The new job.
+     */
+    Job* create(JobFunction function, void* cookie, Job* parent = NULL);
+
+    /**
+     * Makes a job wait for another job to finish before it starts.
+     *
+     * Dependencies must be added before the job is started with run().
+     *
+     * @param job The job that depends on the other job.
+     * @param dependency The job that must finish first.
+     */
+    void addDependency(Job* job, Job* dependency);
+
+    /**
+     * Starts a job, or schedules it to start once all of its dependencies have finished.
+     *
+     * @param job The job to start.
+     */
+    void run(Job* job);
+
+    /**
+     * Waits for a job and all of its children to finish and releases the job.
+     *
+     * The calling thread runs other queued jobs while it waits.
+     *
+     * @param job The job to wait for. The handle must not be used afterwards.
+     */
+    void wait(Job* job);
+
+    /**
+     * Releases a job handle without waiting for the job to finish.
+     *
+     * @param job The job to release. The handle must not be used afterwards.
+     */
+    void release(Job* job);
+
+    /**
+     * Determines if a job and all of its children have finished.
+     *
+     * @param job The job to check.
+     *
+     * @return true if the job has finished, false otherwise.
+     */
+    bool isFinished(const Job* job) const;
+
+    /**
+     * Calls a function for consecutive batches of the range [0, count) on all threads
+     * and returns once the whole range has been processed.
+     *
+     * @param count The number of indices to process.
+     * @param batchSize The maximum number of indices in each call to the function.
+     * @param function The function to call for each batch.
+     * @param cookie The cookie to pass to the function.
+     */
+    void parallelFor(unsigned int count, unsigned int batchSize, RangeFunction function, void* cookie);
+
+    /**
+     * Returns the job of the current frame.
+     *
+     * Jobs created as children of the frame job are finished before the frame is rendered.
+     *
+     * @return The job of the current frame.
+     */
+    Job* getFrameJob() const;
+
+    /**
+     * Returns the number of threads that run jobs, including the thread that runs the game.
+     *
+     * @return The number of threads that run jobs.
+     */
+    unsigned int getThreadCount() const;
+
+private:
+
+    struct Worker;
+
+    /**
+     * Constructor.
+     */
+    JobSystem();
+
+    /**
+     * Destructor.
+     */
+    ~JobSystem();
+
+    /**
+     * Hidden copy constructor.
+     */
+    JobSystem(const JobSystem& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    JobSystem& operator=(const JobSystem&);
+
+    /**
+     * Starts the worker threads.
+     *
+     * @param threadCount The number of threads to run jobs on, including the calling thread,
+     *      or 0 to use the number of hardware threads.
+     */
+    void initialize(unsigned int threadCount);
+
+    /**
+     * Finishes all remaining work and stops the worker threads.
+     */
+    void finalize();
+
+    /**
+     * Waits for the frame job to finish and starts the job of the next frame.
+     */
+    void finishFrame();
+
+    void threadProc(unsigned int index);
+
+    unsigned int getWorkerIndex() const;
+
+    void push(Job* job);
+
+    Job* pop(unsigned int index);
+
+    bool runQueuedJob();
+
+    void execute(Job* job);
+
+    void finish(Job* job);
+
+    static void parallelForProc(void* cookie);
+
+    Worker* _workers;
+    unsigned int _workerCount;
+    std::vector<std::thread> _threads;
+    std::mutex _dependencyMutex;
+    std::mutex _sleepMutex;
+    std::condition_variable _wake;
+    std::atomic<unsigned int> _queuedCount;
+    bool _quit;
+    Job* _frameJob;
+};
+
+}
+
+#endif
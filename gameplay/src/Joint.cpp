@@ -1,13 +1,16 @@
 #include "Base.h"
 #include "Joint.h"
+#include "Matrix34.h"
 #include "MeshSkin.h"
 #include "Model.h"
 
 namespace gameplay
 {
 
+GP_POOL_ALLOCATED_IMPLEMENT(Joint, 64)
+
 Joint::Joint(const char* id)
-    : Node(id), _jointMatrixDirty(true)
+    : Node(id), _jointMatrixDirty(true), _transformVersion(0)
 {
 }
 
@@ -60,6 +63,13 @@ void Joint::transformChanged()
 {
     Node::transformChanged();
     _jointMatrixDirty = true;
+    ++_transformVersion;
+
+    // The bounds of skinned models follow their joints.
+    for (SkinReference* ref = &_skin; ref && ref->skin; ref = ref->next)
+    {
+        ref->skin->jointMoved();
+    }
 }
 
 void Joint::updateJointMatrix(const Matrix& bindShape, Vector4* matrixPalette)
@@ -72,14 +82,13 @@ void Joint::updateJointMatrix(const Matrix& bindShape, Vector4* matrixPalette)
     {
         _jointMatrixDirty = false;
 
-        static Matrix t;
-        Matrix::multiply(Node::getWorldMatrix(), getInverseBindPose(), &t);
-        Matrix::multiply(t, bindShape, &t);
+        // The palette keeps the three rows of the affine joint matrix, so it is combined in that form.
+        Matrix34 t(Node::getWorldMatrix());
+        Matrix34::multiply(t, Matrix34(getInverseBindPose()), &t);
+        Matrix34::multiply(t, Matrix34(bindShape), &t);
 
         GP_ASSERT(matrixPalette);
-        matrixPalette[0].set(t.m[0], t.m[4], t.m[8], t.m[12]);
-        matrixPalette[1].set(t.m[1], t.m[5], t.m[9], t.m[13]);
-        matrixPalette[2].set(t.m[2], t.m[6], t.m[10], t.m[14]);
+        memcpy(&matrixPalette[0].x, t.m, sizeof(t.m));
     }
 }
 
@@ -92,6 +101,13 @@ void Joint::setInverseBindPose(const Matrix& m)
 {
     _bindPose = m;
     _jointMatrixDirty = true;
+    ++_transformVersion;
+
+    // The skins keep the bind pose combined with their bind shape.
+    for (SkinReference* ref = &_skin; ref && ref->skin; ref = ref->next)
+    {
+        ref->skin->_layoutDirty = true;
+    }
 }
 
 void Joint::addSkin(MeshSkin* skin)
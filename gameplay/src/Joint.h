@@ -41,6 +41,13 @@ public:
      */
     const Matrix& getInverseBindPose() const;
 
+    /**
+     * Allocates joints from a memory pool.
+     *
+     * @script{ignore}
+     */
+    GP_POOL_ALLOCATED();
+
 protected:
 
     /**
@@ -130,6 +137,11 @@ private:
      */
     bool _jointMatrixDirty;
 
+    /**
+     * Incremented whenever the transform of the Joint or of one of its parents changes.
+     */
+    unsigned int _transformVersion;
+
     /**
      * Linked list of mesh skins that are referenced by this joint.
      */
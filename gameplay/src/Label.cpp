@@ -4,7 +4,7 @@
 namespace gameplay
 {
 
-Label::Label() : _text(""), _font(NULL)
+Label::Label() : _text(""), _font(NULL), _measuredFont(NULL), _measuredFontSize(0), _measuredWidth(0), _measuredHeight(0)
 {
 }
 
@@ -37,6 +37,7 @@ void Label::initialize(const char* typeName, Theme::Style* style, Properties* pr
 		if (text)
 		{
 			_text = text;
+			_measuredFont = NULL;
 		}
 	}
 }
@@ -66,6 +67,7 @@ void Label::setText(const char* text)
     if ((text == NULL && _text.length() > 0) || strcmp(text, _text.c_str()) != 0)
     {
         _text = text ? text : "";
+        _measuredFont = NULL;
         if (_autoSize != AUTO_SIZE_NONE)
             setDirty(DIRTY_BOUNDS);
     }
@@ -101,15 +103,20 @@ void Label::updateBounds()
         // Measure bounds based only on normal state so that bounds updates are not always required on state changes.
         // This is a trade-off for functionality vs performance, but changing the size of UI controls on hover/focus/etc
         // is a pretty bad practice so we'll prioritize performance here.
-        unsigned int w, h;
-        _font->measureText(_text.c_str(), getFontSize(NORMAL), &w, &h);
+        unsigned int fontSize = getFontSize(NORMAL);
+        if (_measuredFont != _font || _measuredFontSize != fontSize)
+        {
+            _font->measureText(_text.c_str(), fontSize, &_measuredWidth, &_measuredHeight);
+            _measuredFont = _font;
+            _measuredFontSize = fontSize;
+        }
         if (_autoSize & AUTO_SIZE_WIDTH)
         {
-            setWidthInternal(w + getBorder(NORMAL).left + getBorder(NORMAL).right + getPadding().left + getPadding().right);
+            setWidthInternal(_measuredWidth + getBorder(NORMAL).left + getBorder(NORMAL).right + getPadding().left + getPadding().right);
         }
         if (_autoSize & AUTO_SIZE_HEIGHT)
         {
-            setHeightInternal(h + getBorder(NORMAL).top + getBorder(NORMAL).bottom + getPadding().top + getPadding().bottom);
+            setHeightInternal(_measuredHeight + getBorder(NORMAL).top + getBorder(NORMAL).bottom + getPadding().top + getPadding().bottom);
         }
     }
 }
@@ -131,7 +138,7 @@ unsigned int Label::drawText(Form* form, const Rectangle& clip)
 
         SpriteBatch* batch = _font->getSpriteBatch(fontSize);
         startBatch(form, batch);
-        _font->drawText(_text.c_str(), _textBounds, _textColor, fontSize, getTextAlignment(state), true, getTextRightToLeft(state), _viewportClipBounds);
+        _font->drawText(&_textLayout, _text.c_str(), _textBounds, _textColor, fontSize, getTextAlignment(state), true, getTextRightToLeft(state), _viewportClipBounds);
         finishBatch(form, batch);
 
         return 1;
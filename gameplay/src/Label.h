@@ -3,6 +3,7 @@
 
 #include "Control.h"
 #include "Theme.h"
+#include "TextLayout.h"
 
 namespace gameplay
 {
@@ -126,10 +127,24 @@ protected:
      */
     std::string _text;
 
+    /**
+     * The glyph quads of the displayed text, which are reused until the text or its bounds change.
+     */
+    TextLayout _textLayout;
+
     /**
      * The font being used to display the label.
      */
     Font* _font;
+
+    /**
+     * The font and font size that the text was last measured with for sizing the label, or NULL
+     * if the text changed since. The measured size is reused until either changes.
+     */
+    Font* _measuredFont;
+    unsigned int _measuredFontSize;
+    unsigned int _measuredWidth;
+    unsigned int _measuredHeight;
     
     /**
      * The text color being used to display the label.
@@ -6,19 +6,19 @@ namespace gameplay
 {
 
 Light::Light(Light::Type type, const Vector3& color) :
-    _type(type), _node(NULL)
+    _type(type), _node(NULL), _shadows(false), _shadowMapped(false)
 {
     _directional = new Directional(color);
 }
 
 Light::Light(Light::Type type, const Vector3& color, float range) :
-    _type(type), _node(NULL)
+    _type(type), _node(NULL), _shadows(false), _shadowMapped(false)
 {
     _point = new Point(color, range);
 }
 
 Light::Light(Light::Type type, const Vector3& color, float range, float innerAngle, float outerAngle) :
-    _type(type), _node(NULL)
+    _type(type), _node(NULL), _shadows(false), _shadowMapped(false)
 {
     _spot = new Spot(color, range, innerAngle, outerAngle);
 }
@@ -148,6 +148,9 @@ Light* Light::create(Properties* properties)
         break;
     }
 
+    if (properties->exists("shadows"))
+        light->setShadowsEnabled(properties->getBool("shadows"));
+
     return light;
 }
 
@@ -254,7 +257,10 @@ void Light::setRange(float range)
     }
 
     if (_node)
+    {
         _node->setBoundsDirty();
+        _node->lightChanged();
+    }
 }
 
 float Light::getRangeInverse() const
@@ -322,6 +328,16 @@ float Light::getOuterAngleCos()  const
     return _spot->outerAngleCos;
 }
 
+void Light::setShadowsEnabled(bool enabled)
+{
+    _shadows = enabled;
+}
+
+bool Light::isShadowsEnabled() const
+{
+    return _shadows;
+}
+
 Light* Light::clone(NodeCloneContext &context)
 {
     Light* lightClone = NULL;
@@ -341,6 +357,7 @@ Light* Light::clone(NodeCloneContext &context)
         return NULL;
     }
     GP_ASSERT(lightClone);
+    lightClone->_shadows = _shadows;
 
     if (Node* node = context.findClonedNode(getNode()))
     {
@@ -3,6 +3,8 @@
 
 #include "Ref.h"
 #include "Vector3.h"
+#include "Vector4.h"
+#include "Matrix.h"
 #include "Properties.h"
 
 namespace gameplay
@@ -20,6 +22,8 @@ class NodeCloneContext;
 class Light : public Ref
 {
     friend class Node;
+    friend class RenderState;
+    friend class ShadowMaps;
 
 public:
 
@@ -230,6 +234,25 @@ public:
      */
     float getOuterAngleCos() const;
 
+    /**
+     * Sets whether this light casts shadows.
+     *
+     * The shadows of lights are rendered by a ShadowMaps object. Lights do not cast shadows
+     * by default.
+     *
+     * @param enabled true if the light casts shadows, false otherwise.
+     * @script{ignore}
+     */
+    void setShadowsEnabled(bool enabled);
+
+    /**
+     * Determines whether this light casts shadows.
+     *
+     * @return true if the light casts shadows, false otherwise.
+     * @script{ignore}
+     */
+    bool isShadowsEnabled() const;
+
 private:
 
     /**
@@ -315,6 +338,10 @@ private:
         Spot* _spot;
     };
     Node* _node;
+    bool _shadows;
+    bool _shadowMapped;
+    Matrix _shadowMatrix;
+    Vector4 _shadowCube[2];
 };
 
 }
@@ -0,0 +1,343 @@
+#include "Base.h"
+#include "LightClusters.h"
+#include "Scene.h"
+#include "Game.h"
+
+// The width and height of the texture of the light indices of the clusters
+#define LIGHT_CLUSTERS_INDEX_TEXTURE_SIZE   256
+
+// The number of lights that each job computes the clusters of
+#define LIGHT_CLUSTERS_BATCH_SIZE           32
+
+// The number of rows of data for each light in the light texture
+#define LIGHT_CLUSTERS_LIGHT_ROWS           3
+
+// The internal format of the light texture
+#ifdef OPENGL_ES
+#define LIGHT_CLUSTERS_LIGHT_FORMAT         GL_RGBA
+#else
+#define LIGHT_CLUSTERS_LIGHT_FORMAT         GL_RGBA32F
+#endif
+
+namespace gameplay
+{
+
+LightClusters::LightClusters(unsigned int tileCountX, unsigned int tileCountY, unsigned int sliceCount)
+    : _tileCountX(std::max(tileCountX, 1u)), _tileCountY(std::max(tileCountY, 1u)), _sliceCount(std::max(sliceCount, 1u)),
+      _directionalCount(0), _lightCount(MAX_DIRECTIONAL_LIGHTS), _clusterSampler(NULL), _indexSampler(NULL), _lightSampler(NULL)
+{
+    // The cluster texture stores the light count of each cluster in a byte.
+    GP_ASSERT(MAX_CLUSTER_LIGHTS <= 255);
+
+    const unsigned int clusterCount = _tileCountX * _tileCountY * _sliceCount;
+    _grid.set((float)_tileCountX, (float)_tileCountY, (float)_sliceCount, 0.0f);
+    _lightData.resize(MAX_LIGHTS * LIGHT_CLUSTERS_LIGHT_ROWS * 4, 0.0f);
+    _clusterLights.resize(clusterCount * MAX_CLUSTER_LIGHTS);
+    _clusterCounts.resize(clusterCount, 0);
+    _clusterData.resize(clusterCount * 4, 0);
+    _indexData.resize(LIGHT_CLUSTERS_INDEX_TEXTURE_SIZE * LIGHT_CLUSTERS_INDEX_TEXTURE_SIZE * 4, 0);
+}
+
+LightClusters::~LightClusters()
+{
+    SAFE_RELEASE(_clusterSampler);
+    SAFE_RELEASE(_indexSampler);
+    SAFE_RELEASE(_lightSampler);
+}
+
+void LightClusters::createTextures()
+{
+    if (_clusterSampler)
+        return;
+
+    // Each cluster is a texel, with a row of tiles for each slice.
+    Texture* texture = Texture::create(Texture::RGBA, _tileCountX * _tileCountY, _sliceCount, &_clusterData[0]);
+    _clusterSampler = Texture::Sampler::create(texture);
+    SAFE_RELEASE(texture);
+
+    texture = Texture::create(Texture::RGBA, LIGHT_CLUSTERS_INDEX_TEXTURE_SIZE, LIGHT_CLUSTERS_INDEX_TEXTURE_SIZE, &_indexData[0]);
+    _indexSampler = Texture::Sampler::create(texture);
+    SAFE_RELEASE(texture);
+
+    // The lights need more precision than bytes, so they are stored in a floating point texture.
+    GLuint handle;
+    GL_ASSERT( glGenTextures(1, &handle) );
+    RenderState::bindTexture(GL_TEXTURE_2D, handle);
+    GL_ASSERT( glTexImage2D(GL_TEXTURE_2D, 0, LIGHT_CLUSTERS_LIGHT_FORMAT, MAX_LIGHTS, LIGHT_CLUSTERS_LIGHT_ROWS, 0, GL_RGBA, GL_FLOAT, &_lightData[0]) );
+    texture = Texture::create(handle, MAX_LIGHTS, LIGHT_CLUSTERS_LIGHT_ROWS, Texture::RGBA);
+    _lightSampler = Texture::Sampler::create(texture);
+    SAFE_RELEASE(texture);
+
+    Texture::Sampler* samplers[] = { _clusterSampler, _indexSampler, _lightSampler };
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        samplers[i]->setFilterMode(Texture::NEAREST, Texture::NEAREST);
+        samplers[i]->setWrapMode(Texture::CLAMP, Texture::CLAMP);
+    }
+}
+
+void LightClusters::update(Scene* scene, Camera* camera)
+{
+    GP_ASSERT(scene);
+
+    if (!camera)
+        camera = scene->getActiveCamera();
+    if (!camera)
+    {
+        GP_WARN("Failed to update light clusters; the scene has no active camera.");
+        return;
+    }
+    createTextures();
+
+    const Matrix& view = camera->getViewMatrix();
+    _projection = camera->getProjectionMatrix();
+    const float nearPlane = camera->getNearPlane();
+    const float farPlane = camera->getFarPlane();
+    _depth.set(nearPlane, _sliceCount / log(farPlane / nearPlane), farPlane, 0.0f);
+    const Rectangle& viewport = Game::getInstance()->getViewport();
+    _viewport.set(viewport.x, viewport.y, 1.0f / viewport.width, 1.0f / viewport.height);
+
+    // Gather the lights. The directional lights come first, followed by the point and spot lights.
+    _lightNodes.clear();
+    scene->getNodesWithComponent(Scene::LIGHT, _lightNodes);
+    _directionalCount = 0;
+    _lightCount = MAX_DIRECTIONAL_LIGHTS;
+    _lightSpheres.clear();
+    for (size_t i = 0, count = _lightNodes.size(); i < count; ++i)
+    {
+        Node* node = _lightNodes[i];
+        Light* light = node->getLight();
+        if (!light || !node->isEnabledInHierarchy())
+            continue;
+
+        if (light->getLightType() == Light::DIRECTIONAL)
+        {
+            if (_directionalCount < MAX_DIRECTIONAL_LIGHTS)
+                addLight(_directionalCount++, node, view);
+        }
+        else if (_lightCount < MAX_LIGHTS)
+        {
+            addLight(_lightCount, node, view);
+            const float* position = &_lightData[_lightCount * 4];
+            _lightSpheres.push_back(Vector4(position[0], position[1], position[2], light->getRange()));
+            ++_lightCount;
+        }
+    }
+    _grid.w = (float)_directionalCount;
+
+    // Find the clusters that each light reaches, and then the lights of each slice of clusters.
+    const unsigned int localCount = (unsigned int)_lightSpheres.size();
+    if (localCount > 0)
+    {
+        _lightRanges.resize(localCount);
+        JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+        jobSystem->parallelFor(localCount, LIGHT_CLUSTERS_BATCH_SIZE, &LightClusters::computeRanges, this);
+        jobSystem->parallelFor(_sliceCount, 1, &LightClusters::assignSlices, this);
+    }
+    else
+    {
+        std::fill(_clusterCounts.begin(), _clusterCounts.end(), (unsigned char)0);
+    }
+
+    // Pack the light lists of the clusters one after the other into the index texture.
+    const unsigned int capacity = LIGHT_CLUSTERS_INDEX_TEXTURE_SIZE * LIGHT_CLUSTERS_INDEX_TEXTURE_SIZE;
+    unsigned int offset = 0;
+    for (size_t i = 0, count = _clusterCounts.size(); i < count; ++i)
+    {
+        unsigned int lightCount = std::min((unsigned int)_clusterCounts[i], capacity - offset);
+        unsigned char* cluster = &_clusterData[i * 4];
+        cluster[0] = (unsigned char)(offset & 0xFF);
+        cluster[1] = (unsigned char)(offset >> 8);
+        cluster[2] = (unsigned char)lightCount;
+        const unsigned short* lights = &_clusterLights[i * MAX_CLUSTER_LIGHTS];
+        for (unsigned int j = 0; j < lightCount; ++j)
+        {
+            unsigned char* entry = &_indexData[(offset + j) * 4];
+            entry[0] = (unsigned char)(lights[j] & 0xFF);
+            entry[1] = (unsigned char)(lights[j] >> 8);
+        }
+        offset += lightCount;
+    }
+
+    // Upload the clusters, the used rows of the light indices and the used part of the lights.
+    _clusterSampler->getTexture()->setData(&_clusterData[0]);
+    if (offset > 0)
+    {
+        unsigned int rows = (offset + LIGHT_CLUSTERS_INDEX_TEXTURE_SIZE - 1) / LIGHT_CLUSTERS_INDEX_TEXTURE_SIZE;
+        _indexSampler->getTexture()->setData(&_indexData[0], 0, 0, LIGHT_CLUSTERS_INDEX_TEXTURE_SIZE, rows);
+    }
+    RenderState::bindTexture(GL_TEXTURE_2D, _lightSampler->getTexture()->getHandle());
+    GL_ASSERT( glPixelStorei(GL_UNPACK_ALIGNMENT, 1) );
+    for (unsigned int row = 0; row < LIGHT_CLUSTERS_LIGHT_ROWS; ++row)
+    {
+        GL_ASSERT( glTexSubImage2D(GL_TEXTURE_2D, 0, 0, row, _lightCount, 1, GL_RGBA, GL_FLOAT, &_lightData[row * MAX_LIGHTS * 4]) );
+    }
+}
+
+void LightClusters::addLight(unsigned int index, Node* node, const Matrix& view)
+{
+    Light* light = node->getLight();
+    GP_ASSERT(light);
+
+    float* position = &_lightData[index * 4];
+    float* color = &_lightData[(MAX_LIGHTS + index) * 4];
+    float* direction = &_lightData[(MAX_LIGHTS * 2 + index) * 4];
+
+    Vector3 v;
+    view.transformPoint(node->getTranslationWorld(), &v);
+    position[0] = v.x;
+    position[1] = v.y;
+    position[2] = v.z;
+    position[3] = light->getLightType() == Light::DIRECTIONAL ? 0.0f : light->getRangeInverse();
+
+    const Vector3& lightColor = light->getColor();
+    color[0] = lightColor.x;
+    color[1] = lightColor.y;
+    color[2] = lightColor.z;
+
+    view.transformVector(node->getForwardVectorWorld(), &v);
+    v.normalize();
+    if (light->getLightType() == Light::POINT)
+    {
+        // Spot angles that never attenuate the light.
+        v.set(0.0f, 0.0f, 0.0f);
+        color[3] = -2.0f;
+        direction[3] = -1.0f;
+    }
+    else if (light->getLightType() == Light::SPOT)
+    {
+        color[3] = light->getOuterAngleCos();
+        direction[3] = light->getInnerAngleCos();
+    }
+    direction[0] = v.x;
+    direction[1] = v.y;
+    direction[2] = v.z;
+}
+
+int LightClusters::getSlice(float depth) const
+{
+    int slice = (int)floor(log(depth / _depth.x) * _depth.y);
+    return std::min(std::max(slice, 0), (int)_sliceCount - 1);
+}
+
+void LightClusters::computeRanges(void* cookie, unsigned int begin, unsigned int end)
+{
+    LightClusters* clusters = (LightClusters*)cookie;
+    const float nearPlane = clusters->_depth.x;
+    const float farPlane = clusters->_depth.z;
+
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        const Vector4& sphere = clusters->_lightSpheres[i];
+        LightRange& range = clusters->_lightRanges[i];
+
+        // The view looks down the negative z axis.
+        const float minDepth = -sphere.z - sphere.w;
+        const float maxDepth = -sphere.z + sphere.w;
+        range.minSlice = 1;
+        range.maxSlice = 0;
+        if (maxDepth < nearPlane || minDepth > farPlane)
+            continue;
+
+        range.minX = 0;
+        range.maxX = (int)clusters->_tileCountX - 1;
+        range.minY = 0;
+        range.maxY = (int)clusters->_tileCountY - 1;
+        if (minDepth > nearPlane)
+        {
+            // Project the corners of the box around the sphere, which are all in front of the
+            // camera, to find the tiles that the sphere covers.
+            float minNdcX = FLT_MAX, maxNdcX = -FLT_MAX;
+            float minNdcY = FLT_MAX, maxNdcY = -FLT_MAX;
+            for (unsigned int corner = 0; corner < 8; ++corner)
+            {
+                Vector4 p(sphere.x + ((corner & 1) ? sphere.w : -sphere.w),
+                          sphere.y + ((corner & 2) ? sphere.w : -sphere.w),
+                          sphere.z + ((corner & 4) ? sphere.w : -sphere.w), 1.0f);
+                clusters->_projection.transformVector(p, &p);
+                minNdcX = std::min(minNdcX, p.x / p.w);
+                maxNdcX = std::max(maxNdcX, p.x / p.w);
+                minNdcY = std::min(minNdcY, p.y / p.w);
+                maxNdcY = std::max(maxNdcY, p.y / p.w);
+            }
+            if (maxNdcX < -1.0f || minNdcX > 1.0f || maxNdcY < -1.0f || minNdcY > 1.0f)
+                continue;
+
+            range.minX = std::max(range.minX, (int)floor((minNdcX * 0.5f + 0.5f) * clusters->_tileCountX));
+            range.maxX = std::min(range.maxX, (int)floor((maxNdcX * 0.5f + 0.5f) * clusters->_tileCountX));
+            range.minY = std::max(range.minY, (int)floor((minNdcY * 0.5f + 0.5f) * clusters->_tileCountY));
+            range.maxY = std::min(range.maxY, (int)floor((maxNdcY * 0.5f + 0.5f) * clusters->_tileCountY));
+        }
+        range.minSlice = clusters->getSlice(std::max(minDepth, nearPlane));
+        range.maxSlice = clusters->getSlice(std::min(maxDepth, farPlane));
+    }
+}
+
+void LightClusters::assignSlices(void* cookie, unsigned int begin, unsigned int end)
+{
+    LightClusters* clusters = (LightClusters*)cookie;
+    const unsigned int tileCountX = clusters->_tileCountX;
+    const unsigned int tilesPerSlice = tileCountX * clusters->_tileCountY;
+
+    // Each slice only writes its own clusters, so the slices can be filled in parallel.
+    for (unsigned int slice = begin; slice < end; ++slice)
+    {
+        unsigned char* counts = &clusters->_clusterCounts[slice * tilesPerSlice];
+        memset(counts, 0, tilesPerSlice);
+        for (size_t i = 0, count = clusters->_lightRanges.size(); i < count; ++i)
+        {
+            const LightRange& range = clusters->_lightRanges[i];
+            if ((int)slice < range.minSlice || (int)slice > range.maxSlice)
+                continue;
+
+            const unsigned short index = (unsigned short)(MAX_DIRECTIONAL_LIGHTS + i);
+            for (int y = range.minY; y <= range.maxY; ++y)
+            {
+                for (int x = range.minX; x <= range.maxX; ++x)
+                {
+                    unsigned int tile = y * tileCountX + x;
+                    if (counts[tile] < MAX_CLUSTER_LIGHTS)
+                    {
+                        clusters->_clusterLights[(slice * tilesPerSlice + tile) * MAX_CLUSTER_LIGHTS + counts[tile]] = index;
+                        ++counts[tile];
+                    }
+                }
+            }
+        }
+    }
+}
+
+void LightClusters::bind(RenderState* renderState)
+{
+    GP_ASSERT(renderState);
+
+    createTextures();
+    renderState->getParameter("u_clusterTexture")->setValue(_clusterSampler);
+    renderState->getParameter("u_clusterIndexTexture")->setValue(_indexSampler);
+    renderState->getParameter("u_clusterLightTexture")->setValue(_lightSampler);
+    renderState->getParameter("u_clusterGrid")->bindValue(this, &LightClusters::getGrid);
+    renderState->getParameter("u_clusterDepth")->bindValue(this, &LightClusters::getDepth);
+    renderState->getParameter("u_clusterViewport")->bindValue(this, &LightClusters::getViewport);
+}
+
+unsigned int LightClusters::getLightCount() const
+{
+    return _lightCount - MAX_DIRECTIONAL_LIGHTS + _directionalCount;
+}
+
+const Vector4& LightClusters::getGrid() const
+{
+    return _grid;
+}
+
+const Vector4& LightClusters::getDepth() const
+{
+    return _depth;
+}
+
+const Vector4& LightClusters::getViewport() const
+{
+    return _viewport;
+}
+
+}
@@ -0,0 +1,191 @@
+#ifndef LIGHTCLUSTERS_H_
+#define LIGHTCLUSTERS_H_
+
+#include "Texture.h"
+#include "Matrix.h"
+#include "Vector4.h"
+
+namespace gameplay
+{
+
+class Scene;
+class Camera;
+class Node;
+class RenderState;
+
+/**
+ * Defines a grid of view-space clusters that the lights of a scene are assigned to, for
+ * clustered forward lighting.
+ *
+ * The view frustum of a camera is split into tiles on the screen and into slices of the
+ * view depth, which are spaced exponentially between the near and far planes. Each frame,
+ * update() finds the point and spot lights of the scene that reach each cluster, and uploads
+ * the lights and the lists of the lights of each cluster into textures. Shaders built with
+ * the CLUSTERED_LIGHTING define then only loop over the lights of the cluster of each pixel,
+ * along with the directional lights, so a single effect works with any number of lights and
+ * lights only cost anything within their range. The lights are assigned to the clusters on
+ * the threads of the game's JobSystem.
+ *
+ * The built-in colored and textured shaders support clustered lighting, replacing the
+ * DIRECTIONAL_LIGHT_COUNT, POINT_LIGHT_COUNT and SPOT_LIGHT_COUNT defines. The uniforms of
+ * the clusters are set on a material (or a technique or pass) by bind(), which only needs to
+ * be called once:
+ *
+ * @code
+ * Material* material = Material::create("res/shaders/textured.vert", "res/shaders/textured.frag", "CLUSTERED_LIGHTING");
+ * _lightClusters.bind(material);
+ * ...
+ * // Once per frame, before the scene is drawn.
+ * _lightClusters.update(_scene);
+ * @endcode
+ *
+ * The lights are stored in a floating point texture, which requires the OES_texture_float
+ * extension on OpenGL ES 2. The shaders also need high precision floats in fragment shaders
+ * to address the light lists.
+ *
+ * @script{ignore}
+ */
+class LightClusters
+{
+public:
+
+    /**
+     * The maximum number of lights, including the directional lights.
+     */
+    static const unsigned int MAX_LIGHTS = 1024;
+
+    /**
+     * The maximum number of directional lights. Additional directional lights are ignored.
+     */
+    static const unsigned int MAX_DIRECTIONAL_LIGHTS = 4;
+
+    /**
+     * The maximum number of point and spot lights in each cluster.
+     */
+    static const unsigned int MAX_CLUSTER_LIGHTS = 64;
+
+    /**
+     * Constructor.
+     *
+     * @param tileCountX The number of tiles across the width of the viewport.
+     * @param tileCountY The number of tiles across the height of the viewport.
+     * @param sliceCount The number of slices of the view depth.
+     */
+    LightClusters(unsigned int tileCountX = 16, unsigned int tileCountY = 8, unsigned int sliceCount = 24);
+
+    /**
+     * Destructor.
+     */
+    ~LightClusters();
+
+    /**
+     * Assigns the lights of the specified scene to the clusters of the view frustum of a
+     * camera, and uploads them for the shaders.
+     *
+     * Lights of disabled nodes are skipped. The viewport of the game is used to find the
+     * tiles of pixels, so the clusters should be updated after the viewport is set.
+     *
+     * @param scene The scene to gather the lights of.
+     * @param camera The camera to build the clusters for, or NULL to use the active camera
+     *      of the scene.
+     */
+    void update(Scene* scene, Camera* camera = NULL);
+
+    /**
+     * Sets the uniforms of the clusters on a render state.
+     *
+     * The uniform values that change each frame are bound to this object, so the render
+     * state does not need to be bound again after each update.
+     *
+     * @param renderState The material, technique or pass to set the uniforms on.
+     */
+    void bind(RenderState* renderState);
+
+    /**
+     * Returns the number of lights that were assigned to the clusters by the last update,
+     * including the directional lights.
+     *
+     * @return The number of lights.
+     */
+    unsigned int getLightCount() const;
+
+    /**
+     * Returns the number of tiles across the viewport and slices of the view depth, followed
+     * by the number of directional lights (u_clusterGrid).
+     *
+     * @return The grid of the clusters.
+     */
+    const Vector4& getGrid() const;
+
+    /**
+     * Returns the near plane distance, the scale that turns the logarithm of the view depth
+     * over the near plane distance into a slice, and the far plane distance (u_clusterDepth).
+     *
+     * @return The depth slicing parameters.
+     */
+    const Vector4& getDepth() const;
+
+    /**
+     * Returns the position of the viewport followed by the inverse of its size (u_clusterViewport).
+     *
+     * @return The viewport parameters.
+     */
+    const Vector4& getViewport() const;
+
+private:
+
+    /**
+     * The range of clusters that a light reaches.
+     */
+    struct LightRange
+    {
+        int minX, maxX;
+        int minY, maxY;
+        int minSlice, maxSlice;
+    };
+
+    /**
+     * Hidden copy constructor.
+     */
+    LightClusters(const LightClusters& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    LightClusters& operator=(const LightClusters&);
+
+    void createTextures();
+
+    void addLight(unsigned int index, Node* node, const Matrix& view);
+
+    int getSlice(float depth) const;
+
+    static void computeRanges(void* cookie, unsigned int begin, unsigned int end);
+
+    static void assignSlices(void* cookie, unsigned int begin, unsigned int end);
+
+    unsigned int _tileCountX;
+    unsigned int _tileCountY;
+    unsigned int _sliceCount;
+    unsigned int _directionalCount;
+    unsigned int _lightCount;
+    Vector4 _grid;
+    Vector4 _depth;
+    Vector4 _viewport;
+    Matrix _projection;
+    std::vector<Node*> _lightNodes;
+    std::vector<Vector4> _lightSpheres;
+    std::vector<LightRange> _lightRanges;
+    std::vector<float> _lightData;
+    std::vector<unsigned short> _clusterLights;
+    std::vector<unsigned char> _clusterCounts;
+    std::vector<unsigned char> _clusterData;
+    std::vector<unsigned char> _indexData;
+    Texture::Sampler* _clusterSampler;
+    Texture::Sampler* _indexSampler;
+    Texture::Sampler* _lightSampler;
+};
+
+}
+
+#endif
@@ -0,0 +1,243 @@
+#include "Base.h"
+#include "ListView.h"
+#include "Form.h"
+
+// The default height of a row, in pixels
+#define LISTVIEW_DEFAULT_ITEM_HEIGHT 32.0f
+// The default number of rows that are kept bound above and below the visible rows
+#define LISTVIEW_DEFAULT_OVERSCAN 2
+
+namespace gameplay
+{
+
+ListView::ListView()
+    : _dataSource(NULL), _itemHeight(LISTVIEW_DEFAULT_ITEM_HEIGHT), _overscan(LISTVIEW_DEFAULT_OVERSCAN), _itemCount(0),
+      _firstItem(0), _lastItem(0), _reload(true)
+{
+}
+
+ListView::~ListView()
+{
+}
+
+ListView* ListView::create(const char* id, Theme::Style* style)
+{
+    ListView* list = new ListView();
+    list->_id = id ? id : "";
+    list->_layout = createLayout(Layout::LAYOUT_ABSOLUTE);
+    list->initialize("ListView", style, NULL);
+    return list;
+}
+
+Control* ListView::create(Theme::Style* style, Properties* properties)
+{
+    ListView* list = new ListView();
+    list->initialize("ListView", style, properties);
+    return list;
+}
+
+void ListView::initialize(const char* typeName, Theme::Style* style, Properties* properties)
+{
+    Container::initialize(typeName, style, properties);
+
+    if (properties)
+    {
+        if (properties->exists("itemHeight"))
+            _itemHeight = properties->getFloat("itemHeight");
+        if (properties->exists("overscan"))
+            _overscan = (unsigned int)std::max(properties->getInt("overscan"), 0);
+    }
+
+    // The rows are placed by the list, below each other.
+    if (_layout->getType() != Layout::LAYOUT_ABSOLUTE)
+    {
+        GP_WARN("List view '%s' does not support layouts; using an absolute layout.", _id.c_str());
+        setLayout(Layout::LAYOUT_ABSOLUTE);
+    }
+    setScroll(SCROLL_VERTICAL);
+}
+
+const char* ListView::getTypeName() const
+{
+    return "ListView";
+}
+
+void ListView::setDataSource(DataSource* dataSource)
+{
+    _dataSource = dataSource;
+    reloadData();
+}
+
+ListView::DataSource* ListView::getDataSource() const
+{
+    return _dataSource;
+}
+
+void ListView::reloadData()
+{
+    _itemCount = _dataSource ? _dataSource->getItemCount(this) : 0;
+    _reload = true;
+    setDirty(DIRTY_POSITION);
+}
+
+void ListView::setItemHeight(float height)
+{
+    GP_ASSERT(height > 0.0f);
+
+    if (height != _itemHeight)
+    {
+        _itemHeight = height;
+        _reload = true;
+        setDirty(DIRTY_POSITION);
+    }
+}
+
+float ListView::getItemHeight() const
+{
+    return _itemHeight;
+}
+
+void ListView::setOverscan(unsigned int rows)
+{
+    if (rows != _overscan)
+    {
+        _overscan = rows;
+        setDirty(DIRTY_POSITION);
+    }
+}
+
+unsigned int ListView::getOverscan() const
+{
+    return _overscan;
+}
+
+unsigned int ListView::getItemCount() const
+{
+    return _itemCount;
+}
+
+int ListView::getItemIndex(Control* control) const
+{
+    GP_ASSERT(control);
+
+    for (size_t i = 0, count = _items.size(); i < count; ++i)
+    {
+        if (_items[i] == control || control->isChild(_items[i]))
+            return _itemIndices[i];
+    }
+    return -1;
+}
+
+void ListView::scrollToItem(unsigned int index)
+{
+    GP_ASSERT(index < _itemCount);
+
+    float top = index * _itemHeight;
+    float bottom = top + _itemHeight;
+    Vector2 position(_scrollPosition);
+    if (top < -position.y)
+        position.y = -top;
+    else if (bottom > _viewportBounds.height - position.y)
+        position.y = _viewportBounds.height - bottom;
+    if (position != _scrollPosition)
+        setScrollPosition(position);
+}
+
+void ListView::updateAbsoluteBounds(const Vector2& offset)
+{
+    // The scroll position is updated along with the absolute bounds, and decides which rows are visible.
+    Container::updateAbsoluteBounds(offset);
+
+    updateItems();
+}
+
+void ListView::updateContentSize()
+{
+    // The rows span the list, and scroll by as many rows as there are items, but never less than the list is tall.
+    _totalWidth = _viewportBounds.width;
+    _totalHeight = std::max(_itemCount * _itemHeight, _viewportBounds.height);
+}
+
+void ListView::updateItems()
+{
+    // Find the rows that are visible, and the ones that are kept bound around them.
+    unsigned int first = 0;
+    unsigned int last = 0;
+    if (_itemCount > 0 && _itemHeight > 0.0f)
+    {
+        int top = (int)floor(-_scrollPosition.y / _itemHeight) - (int)_overscan;
+        int bottom = (int)ceil((_viewportBounds.height - _scrollPosition.y) / _itemHeight) + (int)_overscan;
+        first = (unsigned int)std::max(top, 0);
+        last = std::max((unsigned int)std::max(bottom, 0), first);
+        last = std::min(last, _itemCount);
+        first = std::min(first, last);
+    }
+    if (!_reload && first == _firstItem && last == _lastItem)
+        return;
+
+    // Keep the rows that are still bound to an item in range, and recycle the others.
+    std::vector<bool> bound(last - first, false);
+    std::vector<size_t> spare;
+    for (size_t i = 0, count = _items.size(); i < count; ++i)
+    {
+        int index = _itemIndices[i];
+        if (!_reload && index >= (int)first && index < (int)last)
+            bound[index - first] = true;
+        else
+            spare.push_back(i);
+    }
+
+    size_t nextSpare = 0;
+    for (unsigned int index = first; index < last; ++index)
+    {
+        if (bound[index - first])
+            continue;
+
+        size_t i;
+        if (nextSpare < spare.size())
+        {
+            i = spare[nextSpare++];
+        }
+        else
+        {
+            GP_ASSERT(_dataSource);
+            Control* control = _dataSource->createItem(this);
+            if (!control)
+            {
+                GP_WARN("Failed to create a row for list view '%s'.", _id.c_str());
+                break;
+            }
+            addControl(control);
+            control->release();
+            _items.push_back(control);
+            _itemIndices.push_back(-1);
+            i = _items.size() - 1;
+        }
+
+        // A row that showed another item must not keep its focus or its pressed state.
+        Control* control = _items[i];
+        if (_itemIndices[i] >= 0 && _itemIndices[i] != (int)index)
+            Form::controlDisabled(control);
+        _itemIndices[i] = (int)index;
+
+        control->setPosition(0, index * _itemHeight);
+        control->setWidth(1.0f, true);
+        control->setHeight(_itemHeight);
+        control->setVisible(true);
+        _dataSource->bindItem(this, control, index);
+    }
+
+    // Hide the rows that are left over, so that they are not laid out or drawn until they are needed again.
+    for (; nextSpare < spare.size(); ++nextSpare)
+    {
+        size_t i = spare[nextSpare];
+        _itemIndices[i] = -1;
+        _items[i]->setVisible(false);
+    }
+
+    _firstItem = first;
+    _lastItem = last;
+    _reload = false;
+}
+
+}
@@ -0,0 +1,226 @@
+#ifndef LISTVIEW_H_
+#define LISTVIEW_H_
+
+#include "Container.h"
+
+namespace gameplay
+{
+
+/**
+ * Defines a container that scrolls through a list of items, of which only the visible ones exist as controls.
+ *
+ * The items of the list are provided by a data source. The list creates the controls of the rows that
+ * are visible, and of a few rows above and below them, and binds them to their items through the data
+ * source. As the list is scrolled, the controls of the rows that scroll out of view are bound to the
+ * items that scroll into view, so lists of thousands of items are laid out, drawn and searched for
+ * input like short ones. All rows are as tall as the item height, and as wide as the list.
+ *
+ * The list always scrolls vertically and uses an absolute layout. Besides the properties of a container,
+ * the item height and the number of rows that are kept outside of the view can be set in a .form file:
+ 
+ @verbatim
+    listView inventory
+    {
+        itemHeight = 40
+        overscan = 2
+    }
+ @endverbatim
+ *
+ * @see http://gameplay3d.github.io/GamePlay/docs/file-formats.html#wiki-UI_Forms
+ * @script{ignore}
+ */
+class ListView : public Container
+{
+    friend class ControlFactory;
+
+public:
+
+    /**
+     * Defines the source of the items of a list.
+     */
+    class DataSource
+    {
+    public:
+
+        /**
+         * Destructor.
+         */
+        virtual ~DataSource() { }
+
+        /**
+         * Returns the number of items in the list.
+         *
+         * @param list The list.
+         *
+         * @return The number of items.
+         */
+        virtual unsigned int getItemCount(ListView* list) = 0;
+
+        /**
+         * Creates a control for a row of the list, which is bound to one item after another.
+         *
+         * @param list The list.
+         *
+         * @return The new control, which the list takes the reference of.
+         */
+        virtual Control* createItem(ListView* list) = 0;
+
+        /**
+         * Shows an item in a control that was created for the list.
+         *
+         * @param list The list.
+         * @param control The control of the row.
+         * @param index The index of the item.
+         */
+        virtual void bindItem(ListView* list, Control* control, unsigned int index) = 0;
+    };
+
+    /**
+     * Creates a new list.
+     *
+     * @param id The list ID.
+     * @param style The list style (optional).
+     *
+     * @return The new list.
+     */
+    static ListView* create(const char* id, Theme::Style* style = NULL);
+
+    /**
+     * @see Control::getTypeName
+     */
+    const char* getTypeName() const;
+
+    /**
+     * Sets the source of the items of this list, and binds the visible rows to them.
+     *
+     * @param dataSource The data source, which must outlive the list, or NULL to show no items.
+     */
+    void setDataSource(DataSource* dataSource);
+
+    /**
+     * Returns the source of the items of this list.
+     *
+     * @return The data source, or NULL.
+     */
+    DataSource* getDataSource() const;
+
+    /**
+     * Binds the visible rows to the items again, after the items or their number changed.
+     */
+    void reloadData();
+
+    /**
+     * Sets the height of every row of this list.
+     *
+     * @param height The height of a row, in pixels.
+     */
+    void setItemHeight(float height);
+
+    /**
+     * Returns the height of every row of this list.
+     *
+     * @return The height of a row, in pixels.
+     */
+    float getItemHeight() const;
+
+    /**
+     * Sets the number of rows above and below the visible rows that are kept bound to their items,
+     * so that scrolling a little does not bind rows every frame.
+     *
+     * @param rows The number of rows on each side of the visible rows.
+     */
+    void setOverscan(unsigned int rows);
+
+    /**
+     * Returns the number of rows above and below the visible rows that are kept bound to their items.
+     *
+     * @return The number of rows on each side of the visible rows.
+     */
+    unsigned int getOverscan() const;
+
+    /**
+     * Returns the number of items of this list, as of when the data was last loaded.
+     *
+     * @return The number of items.
+     */
+    unsigned int getItemCount() const;
+
+    /**
+     * Returns the index of the item that a control of this list is bound to.
+     *
+     * @param control A row of this list, or a control within one.
+     *
+     * @return The index of the item, or -1 if the control is not bound to an item of this list.
+     */
+    int getItemIndex(Control* control) const;
+
+    /**
+     * Scrolls this list so that an item is visible.
+     *
+     * @param index The index of the item.
+     */
+    void scrollToItem(unsigned int index);
+
+protected:
+
+    /**
+     * Constructor.
+     */
+    ListView();
+
+    /**
+     * Destructor.
+     */
+    ~ListView();
+
+    /**
+     * Creates a list with a given style and properties.
+     *
+     * @param style The style to apply to this list.
+     * @param properties A properties object containing a definition of the list (optional).
+     *
+     * @return The new list.
+     */
+    static Control* create(Theme::Style* style, Properties* properties = NULL);
+
+    /**
+     * @see Control::initialize
+     */
+    void initialize(const char* typeName, Theme::Style* style, Properties* properties);
+
+    /**
+     * @see Control::updateAbsoluteBounds
+     */
+    void updateAbsoluteBounds(const Vector2& offset);
+
+    /**
+     * @see Container::updateContentSize
+     */
+    void updateContentSize();
+
+private:
+
+    /**
+     * Hidden copy constructor.
+     */
+    ListView(const ListView& copy);
+
+    /**
+     * Binds the rows that are visible at the current scroll position, recycling the others.
+     */
+    void updateItems();
+
+    DataSource* _dataSource;
+    float _itemHeight;
+    unsigned int _overscan;
+    unsigned int _itemCount;
+    unsigned int _firstItem;
+    unsigned int _lastItem;
+    std::vector<Control*> _items;
+    std::vector<int> _itemIndices;
+    bool _reload;
+};
+
+}
+
+#endif
@@ -3,9 +3,221 @@
 #include "Game.h"
 #include "ScriptController.h"
 
+// The number of messages that the queue of the asynchronous logger holds (a power of two), and
+// the size of the slot of a message, with its NULL terminator.
+#define LOG_QUEUE_SIZE 256
+#define LOG_MESSAGE_SIZE 1024
+
+// How long the writer thread waits when it is not woken, in milliseconds.
+#define LOG_WRITER_WAIT_TIME 10
+
+// The time (in milliseconds) over which the rate limits count lines.
+#define LOG_RATE_WINDOW 1000
+
+// Plain arrays of thread local storage, which every supported compiler provides.
+#ifdef _MSC_VER
+#define LOG_THREAD_LOCAL __declspec(thread)
+#else
+#define LOG_THREAD_LOCAL __thread
+#endif
+
 namespace gameplay
 {
 
+/**
+ * A message in the queue of the asynchronous logger.
+ */
+struct LogSlot
+{
+    // The write position that the slot is free for, or one past the position of the message that it holds.
+    std::atomic<unsigned int> sequence;
+    // The message, or an empty string for a message that is written by the thread that logged it.
+    char text[LOG_MESSAGE_SIZE];
+};
+
+/**
+ * Writes the messages of the default output on a background thread.
+ *
+ * The threads that log reserve the slots of the queue in turn, by moving the write position, and
+ * the writer thread takes the messages in the same order from the read position. The sequence of
+ * each slot tells the threads whether the slot is free or holds a message.
+ */
+class AsyncLogWriter
+{
+public:
+
+    AsyncLogWriter()
+        : _slots(NULL), _writePosition(0), _readPosition(0), _dropped(0), _active(false)
+    {
+    }
+
+    ~AsyncLogWriter()
+    {
+        stop();
+    }
+
+    bool isRunning() const
+    {
+        return _thread.get() != NULL;
+    }
+
+    void start()
+    {
+        if (_thread.get())
+            return;
+
+        _slots = new LogSlot[LOG_QUEUE_SIZE];
+        for (unsigned int i = 0; i < LOG_QUEUE_SIZE; ++i)
+            _slots[i].sequence.store(i, std::memory_order_relaxed);
+        _writePosition.store(0, std::memory_order_relaxed);
+        _readPosition.store(0, std::memory_order_relaxed);
+        _active = true;
+        _thread.reset(new std::thread(&AsyncLogWriter::threadProc, this));
+    }
+
+    void stop()
+    {
+        if (_thread.get() == NULL)
+            return;
+
+        // The writer writes the messages that are left before it stops.
+        _active = false;
+        _wake.notify_one();
+        _thread->join();
+        _thread.reset(NULL);
+        SAFE_DELETE_ARRAY(_slots);
+    }
+
+    // Reserves the next slot of the queue, or returns NULL if the queue is full.
+    LogSlot* reserve(unsigned int* position)
+    {
+        unsigned int p = _writePosition.load(std::memory_order_relaxed);
+        for ( ; ; )
+        {
+            LogSlot* slot = &_slots[p & (LOG_QUEUE_SIZE - 1)];
+            int difference = (int)(slot->sequence.load(std::memory_order_acquire) - p);
+            if (difference == 0)
+            {
+                if (_writePosition.compare_exchange_weak(p, p + 1, std::memory_order_relaxed))
+                {
+                    *position = p;
+                    return slot;
+                }
+            }
+            else if (difference < 0)
+            {
+                // The writer has not taken the message that was written a whole queue ago.
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                return NULL;
+            }
+            else
+            {
+                p = _writePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Hands a reserved slot to the writer.
+    void publish(LogSlot* slot, unsigned int position)
+    {
+        slot->sequence.store(position + 1, std::memory_order_release);
+        _wake.notify_one();
+    }
+
+    // Waits until the writer has taken the messages that were reserved before.
+    void flush()
+    {
+        unsigned int position = _writePosition.load(std::memory_order_acquire);
+        while ((int)(position - _readPosition.load(std::memory_order_acquire)) > 0)
+        {
+            _wake.notify_one();
+            std::this_thread::yield();
+        }
+    }
+
+private:
+
+    static void threadProc(AsyncLogWriter* writer)
+    {
+        for ( ; ; )
+        {
+            unsigned int position = writer->_readPosition.load(std::memory_order_relaxed);
+            LogSlot& slot = writer->_slots[position & (LOG_QUEUE_SIZE - 1)];
+            if (slot.sequence.load(std::memory_order_acquire) == position + 1)
+            {
+                if (slot.text[0])
+                    gameplay::print("%s", slot.text);
+                slot.sequence.store(position + LOG_QUEUE_SIZE, std::memory_order_release);
+                writer->_readPosition.store(position + 1, std::memory_order_release);
+                continue;
+            }
+
+            unsigned int dropped = writer->_dropped.exchange(0, std::memory_order_relaxed);
+            if (dropped)
+                gameplay::print("%u log messages were dropped while the log queue was full.\n", dropped);
+
+            // The queue is empty, so the writer stops when asked to or waits for messages. Producers wake
+            // it without a lock, so a wake can be missed, and the wait is bounded.
+            if (!writer->_active)
+                break;
+            std::unique_lock<std::mutex> lock(writer->_mutex);
+            writer->_wake.wait_for(lock, std::chrono::milliseconds(LOG_WRITER_WAIT_TIME));
+        }
+    }
+
+    LogSlot* _slots;
+    std::atomic<unsigned int> _writePosition;
+    std::atomic<unsigned int> _readPosition;
+    std::atomic<unsigned int> _dropped;
+    std::atomic<bool> _active;
+    std::unique_ptr<std::thread> _thread;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+};
+
+/**
+ * The lines that are logged at a level in the current window of its rate limit.
+ */
+struct LogRate
+{
+    std::atomic<unsigned int> limit;
+    std::atomic<unsigned int> windowStart;
+    std::atomic<unsigned int> count;
+    std::atomic<unsigned int> dropped;
+};
+
+static AsyncLogWriter __asyncLogWriter;
+static LogRate __logRates[3];
+
+// Whether each thread is in the middle of a line at each level, and whether that line is dropped.
+static LOG_THREAD_LOCAL bool __logLineOpen[3];
+static LOG_THREAD_LOCAL bool __logLineDropped[3];
+
+static unsigned int getLogTime()
+{
+    return (unsigned int)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Returns whether a new line fits in the rate limit of a level, and logs the number of lines that
+// the limit dropped in the last window when a new window starts.
+static bool acceptLogLine(Logger::Level level)
+{
+    LogRate& rate = __logRates[level];
+    unsigned int now = getLogTime();
+    unsigned int start = rate.windowStart.load(std::memory_order_relaxed);
+    if (now - start >= LOG_RATE_WINDOW && rate.windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed))
+    {
+        rate.count.store(0, std::memory_order_relaxed);
+        unsigned int dropped = rate.dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped)
+            Logger::log(level, "%u log lines were dropped by the rate limit.\n", dropped);
+    }
+    if (rate.count.fetch_add(1, std::memory_order_relaxed) < rate.limit.load(std::memory_order_relaxed))
+        return true;
+    rate.dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
 Logger::State Logger::_state[3];
 
 Logger::State::State() : logFunctionC(NULL), logFunctionLua(NULL), enabled(true)
@@ -26,6 +238,43 @@ void Logger::log(Level level, const char* message, ...)
     if (!state.enabled)
         return;
 
+    // The parts of a line follow the rate limit of the first part of the line.
+    if (__logRates[level].limit.load(std::memory_order_relaxed) > 0)
+    {
+        if (!__logLineOpen[level])
+            __logLineDropped[level] = !acceptLogLine(level);
+        size_t length = strlen(message);
+        __logLineOpen[level] = length == 0 || message[length - 1] != '\n';
+        if (__logLineDropped[level])
+            return;
+    }
+
+    bool defaultOutput = !state.logFunctionC && !state.logFunctionLua;
+    if (defaultOutput && __asyncLogWriter.isRunning())
+    {
+        if (level != LEVEL_ERROR)
+        {
+            // The message is formatted straight into its slot of the queue.
+            unsigned int position;
+            LogSlot* slot = __asyncLogWriter.reserve(&position);
+            if (slot == NULL)
+                return;
+            va_list args;
+            va_start(args, message);
+            int needed = vsnprintf(slot->text, LOG_MESSAGE_SIZE, message, args);
+            va_end(args);
+            bool queued = needed >= 0 && needed < LOG_MESSAGE_SIZE;
+            if (!queued)
+                slot->text[0] = '\0';
+            __asyncLogWriter.publish(slot, position);
+            if (queued)
+                return;
+        }
+
+        // The message is written here, after the messages that were logged before it.
+        __asyncLogWriter.flush();
+    }
+
     // Declare a moderately sized buffer on the stack that should be
     // large enough to accommodate most log requests.
     int size = 1024;
@@ -98,4 +347,33 @@ void Logger::set(Level level, const char* logFunction)
     state.logFunctionC = NULL;
 }
 
+void Logger::setAsync(bool async)
+{
+    if (async)
+        __asyncLogWriter.start();
+    else
+        __asyncLogWriter.stop();
+}
+
+bool Logger::isAsync()
+{
+    return __asyncLogWriter.isRunning();
+}
+
+void Logger::flush()
+{
+    if (__asyncLogWriter.isRunning())
+        __asyncLogWriter.flush();
+}
+
+void Logger::setRateLimit(Level level, unsigned int linesPerSecond)
+{
+    __logRates[level].limit.store(linesPerSecond, std::memory_order_relaxed);
+}
+
+unsigned int Logger::getRateLimit(Level level)
+{
+    return __logRates[level].limit.load(std::memory_order_relaxed);
+}
+
 }
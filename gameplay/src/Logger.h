@@ -85,6 +85,64 @@ public:
      */
     static void set(Level level, const char* logFunction);
 
+    /**
+     * Sets whether messages are written to the default output by a background thread.
+     *
+     * When enabled, the messages that go to the default output are formatted into a queue by the
+     * threads that log them, and a writer thread writes them in order, so that logging does not wait
+     * for the output. The queue takes messages from any thread without a lock. While the queue is
+     * full, messages are dropped, and the writer logs how many were dropped.
+     *
+     * Errors are still written by the thread that logs them, once the messages before them have
+     * been written, since an error can end the program. Messages that are longer than a slot of
+     * the queue are written the same way. Messages handled by a C or Lua function are passed to it
+     * on the thread that logs them.
+     *
+     * Asynchronous logging must not be disabled while other threads are logging.
+     *
+     * @param async true to write messages on a background thread, false to write them as they are logged.
+     * @script{ignore}
+     */
+    static void setAsync(bool async);
+
+    /**
+     * Determines if messages are written to the default output by a background thread.
+     *
+     * @return true if messages are written asynchronously, false otherwise.
+     * @script{ignore}
+     */
+    static bool isAsync();
+
+    /**
+     * Waits until the messages that have been logged have been written.
+     *
+     * @script{ignore}
+     */
+    static void flush();
+
+    /**
+     * Sets the largest number of lines per second that are logged at the given level.
+     *
+     * Lines over the limit are dropped before they are formatted, and the number of dropped lines
+     * is logged when the next second starts. A line can be logged in parts, as GP_WARN does, which
+     * are kept or dropped together.
+     *
+     * @param level Log level.
+     * @param linesPerSecond The largest number of lines per second, or 0 for no limit.
+     * @script{ignore}
+     */
+    static void setRateLimit(Level level, unsigned int linesPerSecond);
+
+    /**
+     * Returns the largest number of lines per second that are logged at the given level.
+     *
+     * @param level Log level.
+     *
+     * @return The largest number of lines per second, or 0 if there is no limit.
+     * @script{ignore}
+     */
+    static unsigned int getRateLimit(Level level);
+
 private:
 
     struct State
@@ -0,0 +1,31 @@
+#ifndef LUACOMPAT_H_
+#define LUACOMPAT_H_
+
+/**
+ * Defines the parts of the Lua 5.2 API that the script controller and the generated bindings
+ * use in terms of the Lua 5.1 API of LuaJIT, so that the runtime can be built against either.
+ *
+ * This is only included when the runtime is built with GP_USE_LUAJIT.
+ */
+
+#ifndef LUA_OK
+#define LUA_OK 0
+#endif
+
+#ifndef LUA_TCDATA
+#define LUA_TCDATA 10
+#endif
+
+typedef unsigned int lua_Unsigned;
+
+#define lua_pushglobaltable(L) lua_pushvalue(L, LUA_GLOBALSINDEX)
+#define lua_pushunsigned(L, n) lua_pushnumber(L, (lua_Number)(n))
+#define luaL_checkunsigned(L, n) ((lua_Unsigned)luaL_checknumber(L, n))
+#define luaL_optunsigned(L, n, d) ((lua_Unsigned)luaL_optnumber(L, n, (lua_Number)(d)))
+
+inline void lua_len(lua_State* L, int index)
+{
+    lua_pushinteger(L, (lua_Integer)lua_objlen(L, index));
+}
+
+#endif
@@ -31,6 +31,16 @@ Material* Material::create(const char* url)
 }
 
 Material* Material::create(const char* url, PassCallback callback, void* cookie)
+{
+    return create(url, callback, cookie, false);
+}
+
+Material* Material::createAsync(const char* url, PassCallback callback, void* cookie)
+{
+    return create(url, callback, cookie, true);
+}
+
+Material* Material::create(const char* url, PassCallback callback, void* cookie, bool async)
 {
     // Load the material properties from file.
     Properties* properties = Properties::create(url);
@@ -40,7 +50,7 @@ Material* Material::create(const char* url, PassCallback callback, void* cookie)
         return NULL;
     }
 
-    Material* material = create((strlen(properties->getNamespace()) > 0) ? properties : properties->getNextNamespace(), callback, cookie);
+    Material* material = create((strlen(properties->getNamespace()) > 0) ? properties : properties->getNextNamespace(), callback, cookie, async);
     SAFE_DELETE(properties);
 
     return material;
@@ -51,7 +61,7 @@ Material* Material::create(Properties* materialProperties)
     return create(materialProperties, (PassCallback)NULL, NULL);
 }
 
-Material* Material::create(Properties* materialProperties, PassCallback callback, void* cookie)
+Material* Material::create(Properties* materialProperties, PassCallback callback, void* cookie, bool async)
 {
     // Check if the Properties is valid and has a valid namespace.
     if (!materialProperties || !(strcmp(materialProperties->getNamespace(), "material") == 0))
@@ -72,7 +82,7 @@ Material* Material::create(Properties* materialProperties, PassCallback callback
     {
         if (strcmp(techniqueProperties->getNamespace(), "technique") == 0)
         {
-            if (!loadTechnique(material, techniqueProperties, callback, cookie))
+            if (!loadTechnique(material, techniqueProperties, callback, cookie, async))
             {
                 GP_ERROR("Failed to load technique for material.");
                 SAFE_RELEASE(material);
@@ -153,11 +163,16 @@ Technique* Material::getTechniqueByIndex(unsigned int index) const
 Technique* Material::getTechnique(const char* id) const
 {
     GP_ASSERT(id);
+
+    // Technique IDs are interned, so an ID that was never interned matches no technique.
+    StringId stringId;
+    if (!StringId::find(id, &stringId))
+        return NULL;
     for (size_t i = 0, count = _techniques.size(); i < count; ++i)
     {
         Technique* t = _techniques[i];
         GP_ASSERT(t);
-        if (strcmp(t->getId(), id) == 0)
+        if (t->_id == stringId)
         {
             return t;
         }
@@ -209,7 +224,7 @@ Material* Material::clone(NodeCloneContext &context) const
     return material;
 }
 
-bool Material::loadTechnique(Material* material, Properties* techniqueProperties, PassCallback callback, void* cookie)
+bool Material::loadTechnique(Material* material, Properties* techniqueProperties, PassCallback callback, void* cookie, bool async)
 {
     GP_ASSERT(material);
     GP_ASSERT(techniqueProperties);
@@ -228,7 +243,7 @@ bool Material::loadTechnique(Material* material, Properties* techniqueProperties
         if (strcmp(passProperties->getNamespace(), "pass") == 0)
         {
             // Create and load passes.
-            if (!loadPass(technique, passProperties, callback, cookie))
+            if (!loadPass(technique, passProperties, callback, cookie, async))
             {
                 GP_ERROR("Failed to create pass for technique.");
                 SAFE_RELEASE(technique);
@@ -243,7 +258,7 @@ bool Material::loadTechnique(Material* material, Properties* techniqueProperties
     return true;
 }
 
-bool Material::loadPass(Technique* technique, Properties* passProperties, PassCallback callback, void* cookie)
+bool Material::loadPass(Technique* technique, Properties* passProperties, PassCallback callback, void* cookie, bool async)
 {
     GP_ASSERT(passProperties);
     GP_ASSERT(technique);
@@ -275,7 +290,7 @@ bool Material::loadPass(Technique* technique, Properties* passProperties, PassCa
     }
 
     // Initialize/compile the effect with the full set of defines
-    if (!pass->initialize(vertexShaderPath, fragmentShaderPath, allDefines.c_str()))
+    if (!pass->initialize(vertexShaderPath, fragmentShaderPath, allDefines.c_str(), async))
     {
         GP_WARN("Failed to create pass for technique.");
         SAFE_RELEASE(pass);
@@ -474,11 +489,28 @@ void Material::loadRenderState(RenderState* renderState, Properties* properties)
 
             // Set the sampler parameter.
             GP_ASSERT(renderState->getParameter(name));
-            Texture::Sampler* sampler = renderState->getParameter(name)->setValue(path.c_str(), mipmap);
-            if (sampler)
+            if (ns->exists("mipmapSkip"))
             {
-                sampler->setWrapMode(wrapS, wrapT, wrapR);
-                sampler->setFilterMode(minFilter, magFilter);
+                // The sampler loads its texture with its own number of mipmap levels to skip.
+                Texture* texture = Texture::create(path.c_str(), mipmap, ns->getInt("mipmapSkip"));
+                Texture::Sampler* sampler = texture ? Texture::Sampler::create(texture) : NULL;
+                SAFE_RELEASE(texture);
+                if (sampler)
+                {
+                    sampler->setWrapMode(wrapS, wrapT, wrapR);
+                    sampler->setFilterMode(minFilter, magFilter);
+                    renderState->getParameter(name)->setValue(sampler);
+                    SAFE_RELEASE(sampler);
+                }
+            }
+            else
+            {
+                Texture::Sampler* sampler = renderState->getParameter(name)->setValue(path.c_str(), mipmap);
+                if (sampler)
+                {
+                    sampler->setWrapMode(wrapS, wrapT, wrapR);
+                    sampler->setFilterMode(minFilter, magFilter);
+                }
             }
         }
         else if (strcmp(ns->getNamespace(), "renderState") == 0)
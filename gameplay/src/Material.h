@@ -27,6 +27,9 @@ class Material : public RenderState
     friend class RenderState;
     friend class Node;
     friend class Model;
+    friend class StaticBatch;
+    friend class Scene;
+    friend class SceneLoader;
 
 public:
 
@@ -66,6 +69,22 @@ public:
      */
     static Material* create(const char* url, PassCallback callback, void* cookie = NULL);
 
+    /**
+     * Creates a material from a Properties file without waiting for its shaders to compile.
+     *
+     * The effects of the passes are created with Effect::createFromFileAsync, so mid-game
+     * material loads do not stall the frame. A Model draws its fallback material (see
+     * Model::setFallbackMaterial) in place of a material whose effects are not ready yet.
+     *
+     * @param url The URL pointing to the Properties object defining the material.
+     * @param callback Optional function pointer to be called during Pass creation.
+     * @param cookie Optional custom parameter to be passed to the callback function.
+     *
+     * @return A new Material or NULL if there was an error.
+     * @script{ignore}
+     */
+    static Material* createAsync(const char* url, PassCallback callback = NULL, void* cookie = NULL);
+
     /**
      * Creates a material from the specified properties object.
      * 
@@ -178,17 +197,22 @@ private:
     /**
      * Creates a new material with optional pass callback function.
      */
-    static Material* create(Properties* materialProperties, PassCallback callback, void* cookie);
+    static Material* create(Properties* materialProperties, PassCallback callback, void* cookie, bool async = false);
+
+    /**
+     * Creates a new material from the specified file with optional pass callback function.
+     */
+    static Material* create(const char* url, PassCallback callback, void* cookie, bool async);
 
     /**
      * Loads a technique from the given properties object into the specified material.
      */
-    static bool loadTechnique(Material* material, Properties* techniqueProperties, PassCallback callback, void* cookie);
+    static bool loadTechnique(Material* material, Properties* techniqueProperties, PassCallback callback, void* cookie, bool async);
 
     /**
      * Load a pass from the given properties object into the specified technique.
      */
-    static bool loadPass(Technique* technique, Properties* passProperites, PassCallback callback, void* cookie);
+    static bool loadPass(Technique* technique, Properties* passProperites, PassCallback callback, void* cookie, bool async);
 
     /**
      * Loads render state from the specified properties object.
@@ -5,8 +5,13 @@
 namespace gameplay
 {
 
+// Source of unique value versions shared by all parameters, so that a uniform
+// can tell which parameter value it was last uploaded from.
+static unsigned int __parameterVersion = 0;
+
 MaterialParameter::MaterialParameter(const char* name) :
-_type(MaterialParameter::NONE), _count(1), _dynamic(false), _name(name ? name : ""), _uniform(NULL), _loggerDirtyBits(0)
+_type(MaterialParameter::NONE), _count(1), _dynamic(false), _name(name ? name : ""), _uniformId(Effect::getUniformId(_name.c_str())), _uniform(NULL), _loggerDirtyBits(0), _version(0),
+_sharedBinding(0), _sharedBindingNode(NULL)
 {
     clearValue();
 }
@@ -73,6 +78,45 @@ void MaterialParameter::clearValue()
 
     memset(&_value, 0, sizeof(_value));
     _type = MaterialParameter::NONE;
+    _sharedBinding = 0;
+    _sharedBindingNode = NULL;
+    markDirty();
+}
+
+void MaterialParameter::markDirty()
+{
+    _version = allocateVersions(1);
+}
+
+unsigned int MaterialParameter::allocateVersions(unsigned int count)
+{
+    // Version zero is reserved for uniforms with an unknown value.
+    if (__parameterVersion + count < __parameterVersion)
+        __parameterVersion = 0;
+    unsigned int first = __parameterVersion + 1;
+    __parameterVersion += count;
+    return first;
+}
+
+bool MaterialParameter::isValueOwned() const
+{
+    // Only values that are stored inside the parameter can be tracked for changes.
+    // Pointers to external arrays and method bindings may change at any time.
+    switch (_type)
+    {
+    case MaterialParameter::FLOAT:
+    case MaterialParameter::INT:
+        return true;
+    case MaterialParameter::FLOAT_ARRAY:
+    case MaterialParameter::INT_ARRAY:
+    case MaterialParameter::VECTOR2:
+    case MaterialParameter::VECTOR3:
+    case MaterialParameter::VECTOR4:
+    case MaterialParameter::MATRIX:
+        return _dynamic;
+    default:
+        return false;
+    }
 }
 
 const char* MaterialParameter::getName() const
@@ -207,6 +251,7 @@ void MaterialParameter::setValue(const Matrix& value)
     }
 
     memcpy(_value.floatPtrValue, value.m, sizeof(float) * 16);
+    markDirty();
 
     _dynamic = true;
     _count = 1;
@@ -446,19 +491,20 @@ void MaterialParameter::setSamplerArray(const Texture::Sampler** values, unsigne
     _type = MaterialParameter::SAMPLER_ARRAY;
 }
 
-void MaterialParameter::bind(Effect* effect)
+void MaterialParameter::bind(Effect* effect, bool warnMissing)
 {
     GP_ASSERT(effect);
 
     // If we had a Uniform cached that is not from the passed in effect,
     // we need to update our uniform to point to the new effect's uniform.
+    // The uniform is looked up by the id of its name, which is an array index.
     if (!_uniform || _uniform->getEffect() != effect)
     {
-        _uniform = effect->getUniform(_name.c_str());
+        _uniform = effect->getUniformById(_uniformId);
 
         if (!_uniform)
         {
-            if ((_loggerDirtyBits & UNIFORM_NOT_FOUND) == 0)
+            if (warnMissing && (_loggerDirtyBits & UNIFORM_NOT_FOUND) == 0)
             {
                 // This parameter was not found in the specified effect, so do nothing.
                 GP_WARN("Material parameter for uniform '%s' not found in effect: '%s'.", _name.c_str(), effect->getId());
@@ -468,6 +514,17 @@ void MaterialParameter::bind(Effect* effect)
         }
     }
 
+    // Skip the upload if the uniform already holds this value. Values owned by the
+    // parameter use its own version, while auto bindings to per-camera and per-scene
+    // values share a version with every parameter bound to the same camera or scene.
+    unsigned int version = 0;
+    if (isValueOwned())
+        version = _version;
+    else if (_sharedBinding && _type == MaterialParameter::METHOD)
+        version = RenderState::getSharedAutoBindingVersion(_sharedBindingNode, _sharedBinding);
+    if (version && _uniform->_version == version)
+        return;
+
     switch (_type)
     {
     case MaterialParameter::FLOAT:
@@ -514,6 +571,9 @@ void MaterialParameter::bind(Effect* effect)
             break;
         }
     }
+
+    if (version)
+        _uniform->_version = version;
 }
 
 void MaterialParameter::bindValue(Node* node, const char* binding)
@@ -700,6 +760,8 @@ void MaterialParameter::setAnimationPropertyValue(int propertyId, AnimationValue
     GP_ASSERT(value);
     GP_ASSERT(blendWeight >= 0.0f && blendWeight <= 1.0f);
 
+    markDirty();
+
     switch (propertyId)
     {
         case ANIMATE_UNIFORM:
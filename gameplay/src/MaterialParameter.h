@@ -430,7 +430,13 @@ private:
 
     void clearValue();
 
-    void bind(Effect* effect);
+    void markDirty();
+
+    static unsigned int allocateVersions(unsigned int count);
+
+    bool isValueOwned() const;
+
+    void bind(Effect* effect, bool warnMissing = true);
 
     void applyAnimationValue(AnimationValue* value, float blendWeight, int components);
 
@@ -479,8 +485,12 @@ private:
     unsigned int _count;
     bool _dynamic;
     std::string _name;
+    unsigned int _uniformId;
     Uniform* _uniform;
     char _loggerDirtyBits;
+    unsigned int _version;
+    int _sharedBinding;
+    Node* _sharedBindingNode;
 };
 
 template <class ClassType, class ParameterType>
@@ -1,5 +1,6 @@
 #include "Base.h"
 #include "MathUtil.h"
+#include "SimdMath.h"
 
 namespace gameplay
 {
@@ -25,4 +26,147 @@ void MathUtil::smooth(float* x, float target, float elapsedTime, float riseTime,
     }
 }
 
+#ifdef GP_USE_SIMD
+// Transforms four points, whose coordinates are in separate registers, by the splatted elements
+// of the first three rows of a matrix, with the translation already scaled by w.
+static inline void transform3x4(const Float4* m, Float4* x, Float4* y, Float4* z)
+{
+    Float4 rx = add4(add4(mul4(m[0], *x), mul4(m[3], *y)), add4(mul4(m[6], *z), m[9]));
+    Float4 ry = add4(add4(mul4(m[1], *x), mul4(m[4], *y)), add4(mul4(m[7], *z), m[10]));
+    Float4 rz = add4(add4(mul4(m[2], *x), mul4(m[5], *y)), add4(mul4(m[8], *z), m[11]));
+    *x = rx;
+    *y = ry;
+    *z = rz;
+}
+
+static inline void splatMatrix(const float* m, float w, Float4* dst)
+{
+    dst[0] = splat4(m[0]);
+    dst[1] = splat4(m[1]);
+    dst[2] = splat4(m[2]);
+    dst[3] = splat4(m[4]);
+    dst[4] = splat4(m[5]);
+    dst[5] = splat4(m[6]);
+    dst[6] = splat4(m[8]);
+    dst[7] = splat4(m[9]);
+    dst[8] = splat4(m[10]);
+    dst[9] = splat4(m[12] * w);
+    dst[10] = splat4(m[13] * w);
+    dst[11] = splat4(m[14] * w);
+}
+#endif
+
+void MathUtil::transformPoints(const float* m, const float* points, unsigned int count, float w, float* dst)
+{
+    GP_ASSERT(m && points && dst);
+
+    unsigned int i = 0;
+#ifdef GP_USE_SIMD
+    // Transform four points at a time. All twelve coordinates are loaded before the results are stored.
+    Float4 columns[12];
+    splatMatrix(m, w, columns);
+    for (; i + 4 <= count; i += 4)
+    {
+        Float4 x, y, z;
+        load3x4(points + i * 3, &x, &y, &z);
+        transform3x4(columns, &x, &y, &z);
+        store3x4(dst + i * 3, x, y, z);
+    }
+#endif
+    const float tx = m[12] * w;
+    const float ty = m[13] * w;
+    const float tz = m[14] * w;
+    for (; i < count; ++i)
+    {
+        const float* p = points + i * 3;
+        float x = p[0] * m[0] + p[1] * m[4] + p[2] * m[8] + tx;
+        float y = p[0] * m[1] + p[1] * m[5] + p[2] * m[9] + ty;
+        float z = p[0] * m[2] + p[1] * m[6] + p[2] * m[10] + tz;
+        dst[i * 3] = x;
+        dst[i * 3 + 1] = y;
+        dst[i * 3 + 2] = z;
+    }
+}
+
+void MathUtil::transformPoints(const float* m, float* x, float* y, float* z, unsigned int count)
+{
+    GP_ASSERT(m && x && y && z);
+
+    unsigned int i = 0;
+#ifdef GP_USE_SIMD
+    Float4 columns[12];
+    splatMatrix(m, 1.0f, columns);
+    for (; i + 4 <= count; i += 4)
+    {
+        Float4 px = load4(x + i);
+        Float4 py = load4(y + i);
+        Float4 pz = load4(z + i);
+        transform3x4(columns, &px, &py, &pz);
+        store4(x + i, px);
+        store4(y + i, py);
+        store4(z + i, pz);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        float px = x[i] * m[0] + y[i] * m[4] + z[i] * m[8] + m[12];
+        float py = x[i] * m[1] + y[i] * m[5] + z[i] * m[9] + m[13];
+        float pz = x[i] * m[2] + y[i] * m[6] + z[i] * m[10] + m[14];
+        x[i] = px;
+        y[i] = py;
+        z[i] = pz;
+    }
+}
+
+void MathUtil::transformBoxes(const float* m, const float* boxes, unsigned int count, float* dst)
+{
+    GP_ASSERT(m && boxes && dst);
+
+    // The center of each box is transformed as a point and its half extents by the absolute values of
+    // the rotation and scale, which gives the box around the transformed corners without transforming them.
+    unsigned int i = 0;
+#ifdef GP_USE_SIMD
+    // The columns of the matrix are combined four rows at a time; the fourth row is discarded.
+    Float4 c0 = load4(m);
+    Float4 c1 = load4(m + 4);
+    Float4 c2 = load4(m + 8);
+    Float4 c3 = load4(m + 12);
+    Float4 a0 = abs4(c0);
+    Float4 a1 = abs4(c1);
+    Float4 a2 = abs4(c2);
+    for (; i < count; ++i)
+    {
+        const float* b = boxes + i * 6;
+        Float4 center = add4(add4(mul4(c0, splat4((b[0] + b[3]) * 0.5f)), mul4(c1, splat4((b[1] + b[4]) * 0.5f))),
+                             add4(mul4(c2, splat4((b[2] + b[5]) * 0.5f)), c3));
+        Float4 extent = add4(add4(mul4(a0, splat4((b[3] - b[0]) * 0.5f)), mul4(a1, splat4((b[4] - b[1]) * 0.5f))),
+                             mul4(a2, splat4((b[5] - b[2]) * 0.5f)));
+        float minimum[4], maximum[4];
+        store4(minimum, sub4(center, extent));
+        store4(maximum, add4(center, extent));
+        float* d = dst + i * 6;
+        d[0] = minimum[0];
+        d[1] = minimum[1];
+        d[2] = minimum[2];
+        d[3] = maximum[0];
+        d[4] = maximum[1];
+        d[5] = maximum[2];
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        const float* b = boxes + i * 6;
+        float c[3] = { (b[0] + b[3]) * 0.5f, (b[1] + b[4]) * 0.5f, (b[2] + b[5]) * 0.5f };
+        float e[3] = { (b[3] - b[0]) * 0.5f, (b[4] - b[1]) * 0.5f, (b[5] - b[2]) * 0.5f };
+        float* d = dst + i * 6;
+        for (unsigned int j = 0; j < 3; ++j)
+        {
+            float center = c[0] * m[j] + c[1] * m[4 + j] + c[2] * m[8 + j] + m[12 + j];
+            float extent = e[0] * fabs(m[j]) + e[1] * fabs(m[4 + j]) + e[2] * fabs(m[8 + j]);
+            d[j] = center - extent;
+            d[3 + j] = center + extent;
+        }
+    }
+}
+
 }
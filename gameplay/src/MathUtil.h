@@ -1,6 +1,21 @@
 #ifndef MATHUTIL_H_
 #define MATHUTIL_H_
 
+// Use the SSE kernels when compiling for x86 processors with SSE2, unless NEON is used or GP_NO_SSE is defined.
+// SSE4.1 and AVX instructions are used as well when the compiler targets them.
+#if !defined(GP_USE_NEON) && !defined(GP_NO_SSE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+    #define GP_USE_SSE
+    #include <emmintrin.h>
+    #if defined(__SSE4_1__) || defined(__AVX__)
+        #define GP_USE_SSE4_1
+        #include <smmintrin.h>
+    #endif
+    #if defined(__AVX__)
+        #define GP_USE_AVX
+        #include <immintrin.h>
+    #endif
+#endif
+
 namespace gameplay
 {
 /**
@@ -11,7 +26,9 @@ namespace gameplay
 class MathUtil
 {
     friend class Matrix;
+    friend class Quaternion;
     friend class Vector3;
+    friend class Vector4;
 
 public:
 
@@ -66,6 +83,20 @@ private:
 
     inline static void crossVector3(const float* v1, const float* v2, float* dst);
 
+    inline static void multiplyQuaternion(const float* q1, const float* q2, float* dst);
+
+    inline static void blendQuaternion(const float* q1, const float* q2, float alpha, float beta, float* dst);
+
+    inline static void normalizeVector3(const float* v, float tolerance, float* dst);
+
+    inline static void normalizeVector4(const float* v, float tolerance, float* dst);
+
+    static void transformPoints(const float* m, const float* points, unsigned int count, float w, float* dst);
+
+    static void transformPoints(const float* m, float* x, float* y, float* z, unsigned int count);
+
+    static void transformBoxes(const float* m, const float* boxes, unsigned int count, float* dst);
+
     MathUtil();
 };
 
@@ -73,8 +104,10 @@ private:
 
 #define MATRIX_SIZE ( sizeof(float) * 16)
 
-#ifdef GP_USE_NEON
+#if defined(GP_USE_NEON)
 #include "MathUtilNeon.inl"
+#elif defined(GP_USE_SSE)
+#include "MathUtilSSE.inl"
 #else
 #include "MathUtil.inl"
 #endif
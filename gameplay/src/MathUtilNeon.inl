@@ -226,4 +226,85 @@ inline void MathUtil::crossVector3(const float* v1, const float* v2, float* dst)
     );
 }
 
+inline void MathUtil::multiplyQuaternion(const float* q1, const float* q2, float* dst)
+{
+    float x = q1[3] * q2[0] + q1[0] * q2[3] + q1[1] * q2[2] - q1[2] * q2[1];
+    float y = q1[3] * q2[1] - q1[0] * q2[2] + q1[1] * q2[3] + q1[2] * q2[0];
+    float z = q1[3] * q2[2] + q1[0] * q2[1] - q1[1] * q2[0] + q1[2] * q2[3];
+    float w = q1[3] * q2[3] - q1[0] * q2[0] - q1[1] * q2[1] - q1[2] * q2[2];
+
+    dst[0] = x;
+    dst[1] = y;
+    dst[2] = z;
+    dst[3] = w;
+}
+
+inline void MathUtil::blendQuaternion(const float* q1, const float* q2, float alpha, float beta, float* dst)
+{
+    float x = alpha * q1[0] + beta * q2[0];
+    float y = alpha * q1[1] + beta * q2[1];
+    float z = alpha * q1[2] + beta * q2[2];
+    float w = alpha * q1[3] + beta * q2[3];
+
+    // Correct the length for small constraint errors in the inputs.
+    float f = 1.5f - 0.5f * (x * x + y * y + z * z + w * w);
+    dst[0] = x * f;
+    dst[1] = y * f;
+    dst[2] = z * f;
+    dst[3] = w * f;
+}
+
+inline void MathUtil::normalizeVector3(const float* v, float tolerance, float* dst)
+{
+    float x = v[0];
+    float y = v[1];
+    float z = v[2];
+    float n = x * x + y * y + z * z;
+
+    // Vectors that are normalized already or too close to zero are left as they are.
+    if (n != 1.0f)
+    {
+        n = sqrt(n);
+        if (n >= tolerance)
+        {
+            n = 1.0f / n;
+            x *= n;
+            y *= n;
+            z *= n;
+        }
+    }
+
+    dst[0] = x;
+    dst[1] = y;
+    dst[2] = z;
+}
+
+inline void MathUtil::normalizeVector4(const float* v, float tolerance, float* dst)
+{
+    float x = v[0];
+    float y = v[1];
+    float z = v[2];
+    float w = v[3];
+    float n = x * x + y * y + z * z + w * w;
+
+    // Vectors that are normalized already or too close to zero are left as they are.
+    if (n != 1.0f)
+    {
+        n = sqrt(n);
+        if (n >= tolerance)
+        {
+            n = 1.0f / n;
+            x *= n;
+            y *= n;
+            z *= n;
+            w *= n;
+        }
+    }
+
+    dst[0] = x;
+    dst[1] = y;
+    dst[2] = z;
+    dst[3] = w;
+}
+
 }
@@ -0,0 +1,219 @@
+namespace gameplay
+{
+
+inline void MathUtil::addMatrix(const float* m, float scalar, float* dst)
+{
+    __m128 s = _mm_set1_ps(scalar);
+    _mm_storeu_ps(dst,      _mm_add_ps(_mm_loadu_ps(m),      s));
+    _mm_storeu_ps(dst + 4,  _mm_add_ps(_mm_loadu_ps(m + 4),  s));
+    _mm_storeu_ps(dst + 8,  _mm_add_ps(_mm_loadu_ps(m + 8),  s));
+    _mm_storeu_ps(dst + 12, _mm_add_ps(_mm_loadu_ps(m + 12), s));
+}
+
+inline void MathUtil::addMatrix(const float* m1, const float* m2, float* dst)
+{
+    _mm_storeu_ps(dst,      _mm_add_ps(_mm_loadu_ps(m1),      _mm_loadu_ps(m2)));
+    _mm_storeu_ps(dst + 4,  _mm_add_ps(_mm_loadu_ps(m1 + 4),  _mm_loadu_ps(m2 + 4)));
+    _mm_storeu_ps(dst + 8,  _mm_add_ps(_mm_loadu_ps(m1 + 8),  _mm_loadu_ps(m2 + 8)));
+    _mm_storeu_ps(dst + 12, _mm_add_ps(_mm_loadu_ps(m1 + 12), _mm_loadu_ps(m2 + 12)));
+}
+
+inline void MathUtil::subtractMatrix(const float* m1, const float* m2, float* dst)
+{
+    _mm_storeu_ps(dst,      _mm_sub_ps(_mm_loadu_ps(m1),      _mm_loadu_ps(m2)));
+    _mm_storeu_ps(dst + 4,  _mm_sub_ps(_mm_loadu_ps(m1 + 4),  _mm_loadu_ps(m2 + 4)));
+    _mm_storeu_ps(dst + 8,  _mm_sub_ps(_mm_loadu_ps(m1 + 8),  _mm_loadu_ps(m2 + 8)));
+    _mm_storeu_ps(dst + 12, _mm_sub_ps(_mm_loadu_ps(m1 + 12), _mm_loadu_ps(m2 + 12)));
+}
+
+inline void MathUtil::multiplyMatrix(const float* m, float scalar, float* dst)
+{
+    __m128 s = _mm_set1_ps(scalar);
+    _mm_storeu_ps(dst,      _mm_mul_ps(_mm_loadu_ps(m),      s));
+    _mm_storeu_ps(dst + 4,  _mm_mul_ps(_mm_loadu_ps(m + 4),  s));
+    _mm_storeu_ps(dst + 8,  _mm_mul_ps(_mm_loadu_ps(m + 8),  s));
+    _mm_storeu_ps(dst + 12, _mm_mul_ps(_mm_loadu_ps(m + 12), s));
+}
+
+inline void MathUtil::multiplyMatrix(const float* m1, const float* m2, float* dst)
+{
+    // Each column of the product is the sum of the columns of m1, scaled by the elements of the
+    // column of m2. Both matrices are loaded before the product is stored, so m1 or m2 may be dst.
+#if defined(GP_USE_AVX)
+    // Two columns of the product are computed at a time, one in each half of the registers.
+    __m256 c0 = _mm256_broadcast_ps((const __m128*)m1);
+    __m256 c1 = _mm256_broadcast_ps((const __m128*)(m1 + 4));
+    __m256 c2 = _mm256_broadcast_ps((const __m128*)(m1 + 8));
+    __m256 c3 = _mm256_broadcast_ps((const __m128*)(m1 + 12));
+    __m256 b01 = _mm256_loadu_ps(m2);
+    __m256 b23 = _mm256_loadu_ps(m2 + 8);
+
+    __m256 p01 = _mm256_mul_ps(c0, _mm256_permute_ps(b01, _MM_SHUFFLE(0, 0, 0, 0)));
+    p01 = _mm256_add_ps(p01, _mm256_mul_ps(c1, _mm256_permute_ps(b01, _MM_SHUFFLE(1, 1, 1, 1))));
+    p01 = _mm256_add_ps(p01, _mm256_mul_ps(c2, _mm256_permute_ps(b01, _MM_SHUFFLE(2, 2, 2, 2))));
+    p01 = _mm256_add_ps(p01, _mm256_mul_ps(c3, _mm256_permute_ps(b01, _MM_SHUFFLE(3, 3, 3, 3))));
+
+    __m256 p23 = _mm256_mul_ps(c0, _mm256_permute_ps(b23, _MM_SHUFFLE(0, 0, 0, 0)));
+    p23 = _mm256_add_ps(p23, _mm256_mul_ps(c1, _mm256_permute_ps(b23, _MM_SHUFFLE(1, 1, 1, 1))));
+    p23 = _mm256_add_ps(p23, _mm256_mul_ps(c2, _mm256_permute_ps(b23, _MM_SHUFFLE(2, 2, 2, 2))));
+    p23 = _mm256_add_ps(p23, _mm256_mul_ps(c3, _mm256_permute_ps(b23, _MM_SHUFFLE(3, 3, 3, 3))));
+
+    _mm256_storeu_ps(dst, p01);
+    _mm256_storeu_ps(dst + 8, p23);
+#else
+    __m128 c0 = _mm_loadu_ps(m1);
+    __m128 c1 = _mm_loadu_ps(m1 + 4);
+    __m128 c2 = _mm_loadu_ps(m1 + 8);
+    __m128 c3 = _mm_loadu_ps(m1 + 12);
+    __m128 product[4];
+
+    for (unsigned int i = 0; i < 4; ++i)
+    {
+        __m128 b = _mm_loadu_ps(m2 + i * 4);
+        __m128 p = _mm_mul_ps(c0, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)));
+        p = _mm_add_ps(p, _mm_mul_ps(c1, _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1))));
+        p = _mm_add_ps(p, _mm_mul_ps(c2, _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2))));
+        p = _mm_add_ps(p, _mm_mul_ps(c3, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3))));
+        product[i] = p;
+    }
+
+    _mm_storeu_ps(dst,      product[0]);
+    _mm_storeu_ps(dst + 4,  product[1]);
+    _mm_storeu_ps(dst + 8,  product[2]);
+    _mm_storeu_ps(dst + 12, product[3]);
+#endif
+}
+
+inline void MathUtil::negateMatrix(const float* m, float* dst)
+{
+    // Flip the sign bits, which negates zeros as well.
+    __m128 sign = _mm_set1_ps(-0.0f);
+    _mm_storeu_ps(dst,      _mm_xor_ps(_mm_loadu_ps(m),      sign));
+    _mm_storeu_ps(dst + 4,  _mm_xor_ps(_mm_loadu_ps(m + 4),  sign));
+    _mm_storeu_ps(dst + 8,  _mm_xor_ps(_mm_loadu_ps(m + 8),  sign));
+    _mm_storeu_ps(dst + 12, _mm_xor_ps(_mm_loadu_ps(m + 12), sign));
+}
+
+inline void MathUtil::transposeMatrix(const float* m, float* dst)
+{
+    __m128 c0 = _mm_loadu_ps(m);
+    __m128 c1 = _mm_loadu_ps(m + 4);
+    __m128 c2 = _mm_loadu_ps(m + 8);
+    __m128 c3 = _mm_loadu_ps(m + 12);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    _mm_storeu_ps(dst,      c0);
+    _mm_storeu_ps(dst + 4,  c1);
+    _mm_storeu_ps(dst + 8,  c2);
+    _mm_storeu_ps(dst + 12, c3);
+}
+
+inline void MathUtil::transformVector4(const float* m, float x, float y, float z, float w, float* dst)
+{
+    __m128 p = _mm_mul_ps(_mm_loadu_ps(m), _mm_set1_ps(x));
+    p = _mm_add_ps(p, _mm_mul_ps(_mm_loadu_ps(m + 4), _mm_set1_ps(y)));
+    p = _mm_add_ps(p, _mm_mul_ps(_mm_loadu_ps(m + 8), _mm_set1_ps(z)));
+    p = _mm_add_ps(p, _mm_mul_ps(_mm_loadu_ps(m + 12), _mm_set1_ps(w)));
+
+    // Only x, y and z are stored, since dst is a three element vector.
+    _mm_storel_pi((__m64*)dst, p);
+    _mm_store_ss(dst + 2, _mm_movehl_ps(p, p));
+}
+
+inline void MathUtil::transformVector4(const float* m, const float* v, float* dst)
+{
+    // v is loaded before dst is stored to, so v may be dst.
+    __m128 b = _mm_loadu_ps(v);
+    __m128 p = _mm_mul_ps(_mm_loadu_ps(m), _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)));
+    p = _mm_add_ps(p, _mm_mul_ps(_mm_loadu_ps(m + 4), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1))));
+    p = _mm_add_ps(p, _mm_mul_ps(_mm_loadu_ps(m + 8), _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2))));
+    p = _mm_add_ps(p, _mm_mul_ps(_mm_loadu_ps(m + 12), _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3))));
+    _mm_storeu_ps(dst, p);
+}
+
+inline void MathUtil::crossVector3(const float* v1, const float* v2, float* dst)
+{
+    // Three element vectors cannot be loaded whole without reading past them, and shuffling
+    // their elements into place costs more than the scalar code saves.
+    float x = (v1[1] * v2[2]) - (v1[2] * v2[1]);
+    float y = (v1[2] * v2[0]) - (v1[0] * v2[2]);
+    float z = (v1[0] * v2[1]) - (v1[1] * v2[0]);
+
+    dst[0] = x;
+    dst[1] = y;
+    dst[2] = z;
+}
+
+inline void MathUtil::multiplyQuaternion(const float* q1, const float* q2, float* dst)
+{
+    // The product is the second quaternion scaled by each element of the first, with its
+    // elements reordered and their signs flipped as the Hamilton product requires.
+    __m128 a = _mm_loadu_ps(q1);
+    __m128 b = _mm_loadu_ps(q2);
+
+    __m128 p = _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)), b);
+    __m128 t = _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 1, 2, 3)));
+    p = _mm_add_ps(p, _mm_xor_ps(t, _mm_set_ps(-0.0f, 0.0f, -0.0f, 0.0f)));
+    t = _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2)));
+    p = _mm_add_ps(p, _mm_xor_ps(t, _mm_set_ps(-0.0f, -0.0f, 0.0f, 0.0f)));
+    t = _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1)));
+    p = _mm_add_ps(p, _mm_xor_ps(t, _mm_set_ps(-0.0f, 0.0f, 0.0f, -0.0f)));
+
+    _mm_storeu_ps(dst, p);
+}
+
+// Returns the dot product of two vectors in every element.
+inline __m128 dot4(__m128 a, __m128 b)
+{
+#if defined(GP_USE_SSE4_1)
+    return _mm_dp_ps(a, b, 0xFF);
+#else
+    __m128 p = _mm_mul_ps(a, b);
+    p = _mm_add_ps(p, _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_add_ps(p, _mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 0, 3, 2)));
+#endif
+}
+
+inline void MathUtil::blendQuaternion(const float* q1, const float* q2, float alpha, float beta, float* dst)
+{
+    __m128 q = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(q1), _mm_set1_ps(alpha)), _mm_mul_ps(_mm_loadu_ps(q2), _mm_set1_ps(beta)));
+
+    // Correct the length for small constraint errors in the inputs.
+    __m128 f = _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_set1_ps(0.5f), dot4(q, q)));
+    _mm_storeu_ps(dst, _mm_mul_ps(q, f));
+}
+
+inline void MathUtil::normalizeVector3(const float* v, float tolerance, float* dst)
+{
+    // Load x and y, then z into the third element, leaving the fourth zero.
+    __m128 p = _mm_movelh_ps(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)v), _mm_load_ss(v + 2));
+    float n = _mm_cvtss_f32(dot4(p, p));
+
+    // Vectors that are normalized already or too close to zero are left as they are.
+    if (n != 1.0f)
+    {
+        n = sqrt(n);
+        if (n >= tolerance)
+            p = _mm_mul_ps(p, _mm_set1_ps(1.0f / n));
+    }
+
+    _mm_storel_pi((__m64*)dst, p);
+    _mm_store_ss(dst + 2, _mm_movehl_ps(p, p));
+}
+
+inline void MathUtil::normalizeVector4(const float* v, float tolerance, float* dst)
+{
+    __m128 p = _mm_loadu_ps(v);
+    float n = _mm_cvtss_f32(dot4(p, p));
+
+    // Vectors that are normalized already or too close to zero are left as they are.
+    if (n != 1.0f)
+    {
+        n = sqrt(n);
+        if (n >= tolerance)
+            p = _mm_mul_ps(p, _mm_set1_ps(1.0f / n));
+    }
+
+    _mm_storeu_ps(dst, p);
+}
+
+}
@@ -1,5 +1,6 @@
 #include "Base.h"
 #include "Matrix.h"
+#include "BoundingBox.h"
 #include "Plane.h"
 #include "Quaternion.h"
 #include "MathUtil.h"
@@ -289,6 +290,46 @@ void Matrix::createRotation(const Quaternion& q, Matrix* dst)
     dst->m[15] = 1.0f;
 }
 
+void Matrix::createTransform(const Vector3& translation, const Quaternion& q, const Vector3& scale, Matrix* dst)
+{
+    GP_ASSERT(dst);
+
+    // The columns of the rotation matrix (see createRotation) scaled by the scale on each axis.
+    float x2 = q.x + q.x;
+    float y2 = q.y + q.y;
+    float z2 = q.z + q.z;
+
+    float xx2 = q.x * x2;
+    float yy2 = q.y * y2;
+    float zz2 = q.z * z2;
+    float xy2 = q.x * y2;
+    float xz2 = q.x * z2;
+    float yz2 = q.y * z2;
+    float wx2 = q.w * x2;
+    float wy2 = q.w * y2;
+    float wz2 = q.w * z2;
+
+    dst->m[0] = (1.0f - yy2 - zz2) * scale.x;
+    dst->m[1] = (xy2 + wz2) * scale.x;
+    dst->m[2] = (xz2 - wy2) * scale.x;
+    dst->m[3] = 0.0f;
+
+    dst->m[4] = (xy2 - wz2) * scale.y;
+    dst->m[5] = (1.0f - xx2 - zz2) * scale.y;
+    dst->m[6] = (yz2 + wx2) * scale.y;
+    dst->m[7] = 0.0f;
+
+    dst->m[8] = (xz2 + wy2) * scale.z;
+    dst->m[9] = (yz2 - wx2) * scale.z;
+    dst->m[10] = (1.0f - xx2 - yy2) * scale.z;
+    dst->m[11] = 0.0f;
+
+    dst->m[12] = translation.x;
+    dst->m[13] = translation.y;
+    dst->m[14] = translation.z;
+    dst->m[15] = 1.0f;
+}
+
 void Matrix::createRotation(const Vector3& axis, float angle, Matrix* dst)
 {
     GP_ASSERT(dst);
@@ -642,6 +683,39 @@ bool Matrix::invert()
 
 bool Matrix::invert(Matrix* dst) const
 {
+    // Affine matrices, such as world and view matrices, are inverted by inverting their
+    // upper 3x3 part and transforming their translation by it.
+    if (m[3] == 0.0f && m[7] == 0.0f && m[11] == 0.0f && m[15] == 1.0f)
+    {
+        float c0 = m[5] * m[10] - m[9] * m[6];
+        float c1 = m[9] * m[2] - m[1] * m[10];
+        float c2 = m[1] * m[6] - m[5] * m[2];
+        float det = m[0] * c0 + m[4] * c1 + m[8] * c2;
+        if (fabs(det) <= MATH_TOLERANCE)
+            return false;
+
+        float invDet = 1.0f / det;
+        Matrix inverse;
+        inverse.m[0] = c0 * invDet;
+        inverse.m[1] = c1 * invDet;
+        inverse.m[2] = c2 * invDet;
+        inverse.m[3] = 0.0f;
+        inverse.m[4] = (m[8] * m[6] - m[4] * m[10]) * invDet;
+        inverse.m[5] = (m[0] * m[10] - m[8] * m[2]) * invDet;
+        inverse.m[6] = (m[4] * m[2] - m[0] * m[6]) * invDet;
+        inverse.m[7] = 0.0f;
+        inverse.m[8] = (m[4] * m[9] - m[8] * m[5]) * invDet;
+        inverse.m[9] = (m[8] * m[1] - m[0] * m[9]) * invDet;
+        inverse.m[10] = (m[0] * m[5] - m[4] * m[1]) * invDet;
+        inverse.m[11] = 0.0f;
+        inverse.m[12] = -(inverse.m[0] * m[12] + inverse.m[4] * m[13] + inverse.m[8] * m[14]);
+        inverse.m[13] = -(inverse.m[1] * m[12] + inverse.m[5] * m[13] + inverse.m[9] * m[14]);
+        inverse.m[14] = -(inverse.m[2] * m[12] + inverse.m[6] * m[13] + inverse.m[10] * m[14]);
+        inverse.m[15] = 1.0f;
+        dst->set(inverse);
+        return true;
+    }
+
     float a0 = m[0] * m[5] - m[1] * m[4];
     float a1 = m[0] * m[6] - m[2] * m[4];
     float a2 = m[0] * m[7] - m[3] * m[4];
@@ -723,6 +797,30 @@ void Matrix::multiply(const Matrix& m1, const Matrix& m2, Matrix* dst)
     MathUtil::multiplyMatrix(m1.m, m2.m, dst->m);
 }
 
+void Matrix::multiplyAffine(const Matrix& m1, const Matrix& m2, Matrix* dst)
+{
+    GP_ASSERT(dst);
+
+    // Each column of the product is m1 applied to the column of m2, whose fourth element is
+    // 0 for the first three columns and 1 for the translation.
+    const float* a = m1.m;
+    const float* b = m2.m;
+    float product[16];
+    for (unsigned int c = 0; c < 4; ++c)
+    {
+        const float* col = b + c * 4;
+        product[c * 4 + 0] = a[0] * col[0] + a[4] * col[1] + a[8] * col[2];
+        product[c * 4 + 1] = a[1] * col[0] + a[5] * col[1] + a[9] * col[2];
+        product[c * 4 + 2] = a[2] * col[0] + a[6] * col[1] + a[10] * col[2];
+        product[c * 4 + 3] = 0.0f;
+    }
+    product[12] += a[12];
+    product[13] += a[13];
+    product[14] += a[14];
+    product[15] = 1.0f;
+    memcpy(dst->m, product, MATRIX_SIZE);
+}
+
 void Matrix::negate()
 {
     negate(this);
@@ -923,6 +1021,59 @@ void Matrix::transformVector(const Vector4& vector, Vector4* dst) const
     MathUtil::transformVector4(m, (const float*) &vector, (float*)dst);
 }
 
+void Matrix::transformPoints(const Vector3* points, unsigned int count, Vector3* dst) const
+{
+    GP_ASSERT(points || count == 0);
+    GP_ASSERT(dst || count == 0);
+
+    if (count > 0)
+        MathUtil::transformPoints(m, (const float*)points, count, 1.0f, (float*)dst);
+}
+
+void Matrix::transformPoints(float* x, float* y, float* z, unsigned int count) const
+{
+    if (count > 0)
+        MathUtil::transformPoints(m, x, y, z, count);
+}
+
+void Matrix::transformVectors(const Vector3* vectors, unsigned int count, Vector3* dst) const
+{
+    GP_ASSERT(vectors || count == 0);
+    GP_ASSERT(dst || count == 0);
+
+    if (count > 0)
+        MathUtil::transformPoints(m, (const float*)vectors, count, 0.0f, (float*)dst);
+}
+
+void Matrix::transformNormals(const Vector3* normals, unsigned int count, Vector3* dst) const
+{
+    GP_ASSERT(normals || count == 0);
+    GP_ASSERT(dst || count == 0);
+
+    if (count == 0)
+        return;
+
+    // Matrices that cannot be inverted transform the normals as they are.
+    Matrix normalMatrix;
+    if (invert(&normalMatrix))
+        normalMatrix.transpose();
+    else
+        normalMatrix = *this;
+
+    MathUtil::transformPoints(normalMatrix.m, (const float*)normals, count, 0.0f, (float*)dst);
+    for (unsigned int i = 0; i < count; ++i)
+        MathUtil::normalizeVector3(&dst[i].x, MATH_TOLERANCE, &dst[i].x);
+}
+
+void Matrix::transformBoundingBoxes(const BoundingBox* boxes, unsigned int count, BoundingBox* dst) const
+{
+    GP_ASSERT(boxes || count == 0);
+    GP_ASSERT(dst || count == 0);
+
+    if (count > 0)
+        MathUtil::transformBoxes(m, (const float*)boxes, count, (float*)dst);
+}
+
 void Matrix::translate(float x, float y, float z)
 {
     translate(x, y, z, this);
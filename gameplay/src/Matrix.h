@@ -7,6 +7,7 @@
 namespace gameplay
 {
 
+class BoundingBox;
 class Plane;
 
 /**
@@ -284,6 +285,20 @@ public:
      */
     static void createRotation(const Quaternion& quat, Matrix* dst);
 
+    /**
+     * Creates a matrix that scales, then rotates and then translates, as the matrix of a
+     * Transform does.
+     *
+     * This gives the same result as multiplying a translation, a rotation and a scale matrix,
+     * but the elements are written directly.
+     *
+     * @param translation The translation.
+     * @param rotation The rotation, which must be normalized.
+     * @param scale The scale.
+     * @param dst A matrix to store the result in.
+     */
+    static void createTransform(const Vector3& translation, const Quaternion& rotation, const Vector3& scale, Matrix* dst);
+
     /**
      * Creates a rotation matrix from the specified axis and angle.
      *
@@ -515,6 +530,19 @@ public:
      */
     static void multiply(const Matrix& m1, const Matrix& m2, Matrix* dst);
 
+    /**
+     * Multiplies m1 by m2, which must both be affine transformations (their fourth row is
+     * (0, 0, 0, 1)), and stores the result in dst.
+     *
+     * The fourth row is not computed, which makes this faster than multiply() for the world
+     * matrices of nodes and other combinations of transforms.
+     *
+     * @param m1 The first matrix to multiply.
+     * @param m2 The second matrix to multiply.
+     * @param dst A matrix to store the result in, which may be m1 or m2.
+     */
+    static void multiplyAffine(const Matrix& m1, const Matrix& m2, Matrix* dst);
+
     /**
      * Negates this matrix.
      */
@@ -798,6 +826,62 @@ public:
      */
     void transformVector(const Vector4& vector, Vector4* dst) const;
 
+    /**
+     * Transforms an array of points by this matrix.
+     *
+     * @param points The points to transform.
+     * @param count The number of points.
+     * @param dst An array to store the transformed points in, which may be points.
+     * @script{ignore}
+     */
+    void transformPoints(const Vector3* points, unsigned int count, Vector3* dst) const;
+
+    /**
+     * Transforms an array of points by this matrix, whose coordinates are stored in separate arrays.
+     *
+     * The points are transformed four at a time, and the results are stored back into the arrays.
+     *
+     * @param x The x-coordinates of the points.
+     * @param y The y-coordinates of the points.
+     * @param z The z-coordinates of the points.
+     * @param count The number of points.
+     * @script{ignore}
+     */
+    void transformPoints(float* x, float* y, float* z, unsigned int count) const;
+
+    /**
+     * Transforms an array of vectors by this matrix by treating their fourth (w) coordinate as zero.
+     *
+     * @param vectors The vectors to transform.
+     * @param count The number of vectors.
+     * @param dst An array to store the transformed vectors in, which may be vectors.
+     * @script{ignore}
+     */
+    void transformVectors(const Vector3* vectors, unsigned int count, Vector3* dst) const;
+
+    /**
+     * Transforms an array of normals by the inverse transpose of this matrix and normalizes them,
+     * so that they stay perpendicular to surfaces that are transformed by this matrix.
+     *
+     * @param normals The normals to transform.
+     * @param count The number of normals.
+     * @param dst An array to store the transformed normals in, which may be normals.
+     * @script{ignore}
+     */
+    void transformNormals(const Vector3* normals, unsigned int count, Vector3* dst) const;
+
+    /**
+     * Transforms an array of bounding boxes by this matrix.
+     *
+     * Each result is the smallest axis-aligned box that contains the transformed box.
+     *
+     * @param boxes The boxes to transform.
+     * @param count The number of boxes.
+     * @param dst An array to store the transformed boxes in, which may be boxes.
+     * @script{ignore}
+     */
+    void transformBoundingBoxes(const BoundingBox* boxes, unsigned int count, BoundingBox* dst) const;
+
     /**
      * Post-multiplies this matrix by the matrix corresponding to the
      * specified translation.
@@ -0,0 +1,141 @@
+#include "Base.h"
+#include "Matrix34.h"
+#include "SimdMath.h"
+
+namespace gameplay
+{
+
+static void* allocateAligned(size_t size)
+{
+    void* memory = NULL;
+#ifdef _MSC_VER
+    memory = _aligned_malloc(size, 16);
+#else
+    if (posix_memalign(&memory, 16, size) != 0)
+        memory = NULL;
+#endif
+    if (memory == NULL)
+        GP_ERROR("Failed to allocate %u bytes of aligned memory.", (unsigned int)size);
+    return memory;
+}
+
+static void freeAligned(void* memory)
+{
+#ifdef _MSC_VER
+    _aligned_free(memory);
+#else
+    free(memory);
+#endif
+}
+
+Matrix34::Matrix34()
+{
+    *this = identity();
+}
+
+Matrix34::Matrix34(const Matrix& matrix)
+{
+    set(matrix);
+}
+
+const Matrix34& Matrix34::identity()
+{
+    static Matrix34 value(Matrix::identity());
+    return value;
+}
+
+void Matrix34::set(const Matrix& matrix)
+{
+    const float* s = matrix.m;
+    m[0] = s[0];  m[1] = s[4];  m[2]  = s[8];  m[3]  = s[12];
+    m[4] = s[1];  m[5] = s[5];  m[6]  = s[9];  m[7]  = s[13];
+    m[8] = s[2];  m[9] = s[6];  m[10] = s[10]; m[11] = s[14];
+}
+
+void Matrix34::get(Matrix* dst) const
+{
+    GP_ASSERT(dst);
+
+    float* d = dst->m;
+    d[0] = m[0];  d[4] = m[1];  d[8]  = m[2];  d[12] = m[3];
+    d[1] = m[4];  d[5] = m[5];  d[9]  = m[6];  d[13] = m[7];
+    d[2] = m[8];  d[6] = m[9];  d[10] = m[10]; d[14] = m[11];
+    d[3] = 0.0f;  d[7] = 0.0f;  d[11] = 0.0f;  d[15] = 1.0f;
+}
+
+void Matrix34::multiply(const Matrix34& m1, const Matrix34& m2, Matrix34* dst)
+{
+    GP_ASSERT(dst);
+
+    // Each row of the product is the sum of the rows of m2 scaled by the elements of the row of m1,
+    // plus the translation of m1, which is multiplied by the implicit fourth row of m2.
+#ifdef GP_USE_SIMD
+    const float unitW[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    Float4 w = load4(unitW);
+    Float4 b0 = loadAligned4(m2.m);
+    Float4 b1 = loadAligned4(m2.m + 4);
+    Float4 b2 = loadAligned4(m2.m + 8);
+    Float4 rows[3];
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        const float* a = m1.m + i * 4;
+        rows[i] = add4(add4(mul4(splat4(a[0]), b0), mul4(splat4(a[1]), b1)),
+                       add4(mul4(splat4(a[2]), b2), mul4(loadAligned4(a), w)));
+    }
+    storeAligned4(dst->m, rows[0]);
+    storeAligned4(dst->m + 4, rows[1]);
+    storeAligned4(dst->m + 8, rows[2]);
+#else
+    float product[12];
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        const float* a = m1.m + i * 4;
+        for (unsigned int j = 0; j < 4; ++j)
+            product[i * 4 + j] = a[0] * m2.m[j] + a[1] * m2.m[4 + j] + a[2] * m2.m[8 + j];
+        product[i * 4 + 3] += a[3];
+    }
+    memcpy(dst->m, product, sizeof(product));
+#endif
+}
+
+void Matrix34::transformPoint(const Vector3& point, Vector3* dst) const
+{
+    GP_ASSERT(dst);
+
+    float x = m[0] * point.x + m[1] * point.y + m[2] * point.z + m[3];
+    float y = m[4] * point.x + m[5] * point.y + m[6] * point.z + m[7];
+    float z = m[8] * point.x + m[9] * point.y + m[10] * point.z + m[11];
+    dst->set(x, y, z);
+}
+
+void Matrix34::transformVector(const Vector3& vector, Vector3* dst) const
+{
+    GP_ASSERT(dst);
+
+    float x = m[0] * vector.x + m[1] * vector.y + m[2] * vector.z;
+    float y = m[4] * vector.x + m[5] * vector.y + m[6] * vector.z;
+    float z = m[8] * vector.x + m[9] * vector.y + m[10] * vector.z;
+    dst->set(x, y, z);
+}
+
+void* Matrix34::operator new(size_t size)
+{
+    return allocateAligned(size);
+}
+
+void* Matrix34::operator new[](size_t size)
+{
+    return allocateAligned(size);
+}
+
+void Matrix34::operator delete(void* memory)
+{
+    freeAligned(memory);
+}
+
+void Matrix34::operator delete[](void* memory)
+{
+    freeAligned(memory);
+}
+
+}
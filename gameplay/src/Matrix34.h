@@ -0,0 +1,114 @@
+#ifndef MATRIX34_H_
+#define MATRIX34_H_
+
+#include "Matrix.h"
+
+namespace gameplay
+{
+
+/**
+ * Defines an affine transformation stored as the first three rows of a 4 x 4 matrix.
+ *
+ * The fourth row of an affine transformation is always (0, 0, 0, 1), so it is not stored,
+ * which makes this matrix a quarter smaller than Matrix. Its rows are 16-byte aligned, so
+ * they are loaded and stored with aligned SIMD instructions, and they have the layout of
+ * the joint rows of a MeshSkin matrix palette.
+ *
+ * This matrix is meant for engine code that keeps or combines many transformations, such as
+ * world matrices or skinning palettes; it converts to and from Matrix by transposing it.
+ * Arrays of matrices should be allocated with new[], which keeps them aligned, rather than
+ * in a std::vector.
+ *
+ * @script{ignore}
+ */
+class GP_ALIGN(16) Matrix34
+{
+public:
+
+    /**
+     * Stores the rows of this matrix, four elements each.
+     */
+    float m[12];
+
+    /**
+     * Constructs a matrix initialized to the identity matrix.
+     */
+    Matrix34();
+
+    /**
+     * Constructs a matrix from the first three rows of the specified matrix.
+     *
+     * @param matrix The matrix to convert, which should be an affine transformation.
+     */
+    explicit Matrix34(const Matrix& matrix);
+
+    /**
+     * Returns the identity matrix.
+     *
+     * @return The identity matrix.
+     */
+    static const Matrix34& identity();
+
+    /**
+     * Sets this matrix to the first three rows of the specified matrix.
+     *
+     * @param matrix The matrix to convert, which should be an affine transformation.
+     */
+    void set(const Matrix& matrix);
+
+    /**
+     * Stores this matrix in a 4 x 4 matrix, with a fourth row of (0, 0, 0, 1).
+     *
+     * @param dst A matrix to store the result in.
+     */
+    void get(Matrix* dst) const;
+
+    /**
+     * Multiplies two affine transformations, so that the result applies m2 and then m1.
+     *
+     * @param m1 The first matrix.
+     * @param m2 The second matrix.
+     * @param dst A matrix to store the result in, which may be m1 or m2.
+     */
+    static void multiply(const Matrix34& m1, const Matrix34& m2, Matrix34* dst);
+
+    /**
+     * Transforms the specified point by this matrix.
+     *
+     * @param point The point to transform.
+     * @param dst A vector to store the transformed point in.
+     */
+    void transformPoint(const Vector3& point, Vector3* dst) const;
+
+    /**
+     * Transforms the specified vector by this matrix, ignoring the translation.
+     *
+     * @param vector The vector to transform.
+     * @param dst A vector to store the transformed vector in.
+     */
+    void transformVector(const Vector3& vector, Vector3* dst) const;
+
+    /**
+     * Allocates memory that is aligned for matrices.
+     */
+    static void* operator new(size_t size);
+
+    /**
+     * Allocates memory that is aligned for arrays of matrices.
+     */
+    static void* operator new[](size_t size);
+
+    /**
+     * Frees memory allocated by operator new.
+     */
+    static void operator delete(void* memory);
+
+    /**
+     * Frees memory allocated by operator new[].
+     */
+    static void operator delete[](void* memory);
+};
+
+}
+
+#endif
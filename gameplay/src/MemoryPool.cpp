@@ -0,0 +1,128 @@
+#include "Base.h"
+#include "MemoryPool.h"
+#include "MemoryStats.h"
+
+// The alignment of the elements of the pools, which is enough for any of the engine's types
+#define MEMORYPOOL_ALIGNMENT 16
+
+namespace gameplay
+{
+
+// The heap is used through the global operators, so that the memory is tracked when
+// GP_USE_MEM_LEAK_DETECTION is defined.
+#ifdef GP_USE_MEM_LEAK_DETECTION
+#undef new
+#endif
+static void* allocateHeap(size_t size)
+{
+    return ::operator new(size);
+}
+
+static void freeHeap(void* p)
+{
+    ::operator delete(p);
+}
+#ifdef GP_USE_MEM_LEAK_DETECTION
+#define new DEBUG_NEW
+#endif
+
+MemoryPool::MemoryPool(size_t elementSize, unsigned int elementsPerSlab)
+    : _elementSize(0), _elementsPerSlab(elementsPerSlab > 0 ? elementsPerSlab : 1), _freeElements(NULL), _slabs(NULL),
+      _allocatedCount(0), _capacity(0)
+{
+    // Each element must be able to hold the link of the free list.
+    if (elementSize < sizeof(Element))
+        elementSize = sizeof(Element);
+    _elementSize = (elementSize + MEMORYPOOL_ALIGNMENT - 1) & ~(size_t)(MEMORYPOOL_ALIGNMENT - 1);
+}
+
+MemoryPool::~MemoryPool()
+{
+    // Keep the slabs if elements are in use, since they may still be freed when
+    // the objects that are destroyed after the pool release them.
+    if (_allocatedCount > 0)
+        return;
+
+    while (_slabs)
+    {
+        void* next = *(void**)_slabs;
+        freeHeap(_slabs);
+        _slabs = next;
+        MemoryStats::remove(MemoryStats::POOLS, MEMORYPOOL_ALIGNMENT + _elementSize * _elementsPerSlab);
+    }
+}
+
+void* MemoryPool::allocate(size_t size)
+{
+#ifdef GP_USE_MEM_LEAK_DETECTION
+    return allocateHeap(size);
+#else
+    if (size > _elementSize)
+        return allocateHeap(size);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_freeElements == NULL)
+    {
+        // Allocate a slab, with the link to the previous slab in its first aligned block.
+        char* slab = (char*)allocateHeap(MEMORYPOOL_ALIGNMENT + _elementSize * _elementsPerSlab);
+        *(void**)slab = _slabs;
+        _slabs = slab;
+        char* elements = slab + MEMORYPOOL_ALIGNMENT;
+        for (unsigned int i = _elementsPerSlab; i > 0; --i)
+        {
+            Element* element = (Element*)(elements + _elementSize * (i - 1));
+            element->next = _freeElements;
+            _freeElements = element;
+        }
+        _capacity += _elementsPerSlab;
+        MemoryStats::add(MemoryStats::POOLS, MEMORYPOOL_ALIGNMENT + _elementSize * _elementsPerSlab);
+    }
+
+    Element* element = _freeElements;
+    _freeElements = element->next;
+    ++_allocatedCount;
+    return element;
+#endif
+}
+
+void MemoryPool::deallocate(void* p, size_t size)
+{
+    if (p == NULL)
+        return;
+
+#ifdef GP_USE_MEM_LEAK_DETECTION
+    freeHeap(p);
+#else
+    if (size > _elementSize)
+    {
+        freeHeap(p);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    GP_ASSERT(_allocatedCount > 0);
+    Element* element = (Element*)p;
+    element->next = _freeElements;
+    _freeElements = element;
+    --_allocatedCount;
+#endif
+}
+
+size_t MemoryPool::getElementSize() const
+{
+    return _elementSize;
+}
+
+unsigned int MemoryPool::getAllocatedCount() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _allocatedCount;
+}
+
+unsigned int MemoryPool::getCapacity() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _capacity;
+}
+
+}
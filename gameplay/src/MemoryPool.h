@@ -0,0 +1,196 @@
+#ifndef MEMORYPOOL_H_
+#define MEMORYPOOL_H_
+
+// The default number of elements in each slab of a memory pool
+#define MEMORYPOOL_DEFAULT_SLAB_SIZE 64
+
+namespace gameplay
+{
+
+/**
+ * Defines a pool of equally sized memory blocks, for allocating many small objects of
+ * the same type without fragmenting the heap.
+ *
+ * The pool allocates its memory from the heap in slabs of many elements, and keeps the
+ * elements that are freed in a list to reuse them. The slabs are only returned to the heap
+ * when the pool is destroyed with no elements in use. Allocations that are larger than the
+ * elements of the pool are passed to the heap, so that the pool of a class can also be used
+ * by the classes that derive from it. A pool can be used from multiple threads.
+ *
+ * Classes are allocated from a pool by declaring their own new and delete operators with the
+ * GP_POOL_ALLOCATED and GP_POOL_ALLOCATED_IMPLEMENT macros, and the elements of the standard
+ * containers are allocated from a pool with the PoolAllocator.
+ *
+ * When GP_USE_MEM_LEAK_DETECTION is defined, the pools pass all of their allocations to the
+ * tracked heap and the classes don't declare their own operators, so that objects that are
+ * leaked are reported, with the place that they were allocated, like any other allocation.
+ *
+ * @script{ignore}
+ */
+class MemoryPool
+{
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param elementSize The size of the elements of the pool, in bytes.
+     * @param elementsPerSlab The number of elements to allocate from the heap at once.
+     */
+    MemoryPool(size_t elementSize, unsigned int elementsPerSlab = MEMORYPOOL_DEFAULT_SLAB_SIZE);
+
+    /**
+     * Destructor.
+     */
+    ~MemoryPool();
+
+    /**
+     * Allocates an element from the pool.
+     *
+     * @param size The number of bytes to allocate, which is allocated from the heap if it
+     *      is larger than the elements of the pool.
+     *
+     * @return The allocated memory.
+     */
+    void* allocate(size_t size);
+
+    /**
+     * Returns an element to the pool.
+     *
+     * @param p The memory to free, which may be NULL.
+     * @param size The number of bytes that were allocated.
+     */
+    void deallocate(void* p, size_t size);
+
+    /**
+     * Returns the size of the elements of the pool.
+     *
+     * @return The size of the elements, in bytes.
+     */
+    size_t getElementSize() const;
+
+    /**
+     * Returns the number of elements that are in use.
+     *
+     * @return The number of allocated elements.
+     */
+    unsigned int getAllocatedCount() const;
+
+    /**
+     * Returns the number of elements that the pool has allocated from the heap.
+     *
+     * @return The number of elements in the slabs of the pool.
+     */
+    unsigned int getCapacity() const;
+
+private:
+
+    struct Element
+    {
+        Element* next;
+    };
+
+    MemoryPool(const MemoryPool& copy);
+
+    MemoryPool& operator=(const MemoryPool&);
+
+    size_t _elementSize;
+    unsigned int _elementsPerSlab;
+    Element* _freeElements;
+    void* _slabs;
+    unsigned int _allocatedCount;
+    unsigned int _capacity;
+    mutable std::mutex _mutex;
+};
+
+/**
+ * Defines an allocator for the standard containers that allocates their elements from a
+ * memory pool, which is shared by all of the containers with elements of the same type.
+ *
+ * This is intended for the lists, sets and maps that the engine keeps of few, small elements,
+ * such as listeners, which allocate each of their elements separately.
+ *
+ * @script{ignore}
+ */
+template <class T>
+class PoolAllocator
+{
+public:
+
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <class U>
+    struct rebind
+    {
+        typedef PoolAllocator<U> other;
+    };
+
+    PoolAllocator() { }
+
+    template <class U>
+    PoolAllocator(const PoolAllocator<U>&) { }
+
+    T* allocate(size_t count, const void* hint = 0)
+    {
+        return static_cast<T*>(_pool.allocate(count * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t count)
+    {
+        _pool.deallocate(p, count * sizeof(T));
+    }
+
+    size_t max_size() const
+    {
+        return ((size_t)-1) / sizeof(T);
+    }
+
+    template <class U>
+    bool operator==(const PoolAllocator<U>&) const { return true; }
+
+    template <class U>
+    bool operator!=(const PoolAllocator<U>&) const { return false; }
+
+private:
+
+    static MemoryPool _pool;
+};
+
+template <class T>
+MemoryPool PoolAllocator<T>::_pool(sizeof(T));
+
+}
+
+#ifndef GP_USE_MEM_LEAK_DETECTION
+
+/**
+ * Declares the new and delete operators of a class, which allocate it from a memory pool.
+ * This must be used in the public section of the class, and the operators must be implemented
+ * with GP_POOL_ALLOCATED_IMPLEMENT.
+ */
+#define GP_POOL_ALLOCATED() \
+    static void* operator new(size_t size); \
+    static void operator delete(void* p, size_t size)
+
+/**
+ * Implements the new and delete operators of a class that are declared with GP_POOL_ALLOCATED.
+ */
+#define GP_POOL_ALLOCATED_IMPLEMENT(type, elementsPerSlab) \
+    static gameplay::MemoryPool __##type##Pool(sizeof(type), elementsPerSlab); \
+    void* type::operator new(size_t size) { return __##type##Pool.allocate(size); } \
+    void type::operator delete(void* p, size_t size) { __##type##Pool.deallocate(p, size); }
+
+#else
+
+#define GP_POOL_ALLOCATED()
+#define GP_POOL_ALLOCATED_IMPLEMENT(type, elementsPerSlab)
+
+#endif
+
+#endif
@@ -0,0 +1,133 @@
+#include "Base.h"
+#include "MemoryStats.h"
+#include "Font.h"
+#include "Properties.h"
+
+namespace gameplay
+{
+
+static const char* __categoryNames[MemoryStats::CATEGORY_COUNT] = { "textures", "meshes", "animations", "scripts", "audio", "pools" };
+static std::atomic<size_t> __usage[MemoryStats::CATEGORY_COUNT];
+static std::atomic<size_t> __peakUsage[MemoryStats::CATEGORY_COUNT];
+static std::atomic<size_t> __budgets[MemoryStats::CATEGORY_COUNT];
+static std::atomic<bool> __overBudget[MemoryStats::CATEGORY_COUNT];
+
+MemoryStats::MemoryStats()
+{
+}
+
+size_t MemoryStats::getUsage(Category category)
+{
+    GP_ASSERT(category < CATEGORY_COUNT);
+    return __usage[category].load(std::memory_order_relaxed);
+}
+
+size_t MemoryStats::getPeakUsage(Category category)
+{
+    GP_ASSERT(category < CATEGORY_COUNT);
+    return __peakUsage[category].load(std::memory_order_relaxed);
+}
+
+size_t MemoryStats::getTotalUsage()
+{
+    size_t total = 0;
+    for (unsigned int i = 0; i < CATEGORY_COUNT; ++i)
+        total += __usage[i].load(std::memory_order_relaxed);
+    return total;
+}
+
+void MemoryStats::setBudget(Category category, size_t bytes)
+{
+    GP_ASSERT(category < CATEGORY_COUNT);
+    __budgets[category].store(bytes, std::memory_order_relaxed);
+    __overBudget[category].store(false, std::memory_order_relaxed);
+}
+
+size_t MemoryStats::getBudget(Category category)
+{
+    GP_ASSERT(category < CATEGORY_COUNT);
+    return __budgets[category].load(std::memory_order_relaxed);
+}
+
+bool MemoryStats::isWithinBudget()
+{
+    for (unsigned int i = 0; i < CATEGORY_COUNT; ++i)
+    {
+        size_t budget = __budgets[i].load(std::memory_order_relaxed);
+        if (budget > 0 && __usage[i].load(std::memory_order_relaxed) > budget)
+            return false;
+    }
+    return true;
+}
+
+const char* MemoryStats::getCategoryName(Category category)
+{
+    GP_ASSERT(category < CATEGORY_COUNT);
+    return __categoryNames[category];
+}
+
+void MemoryStats::draw(Font* font, const Vector4& color, int x, int y, unsigned int size)
+{
+    GP_ASSERT(font);
+
+    int lineHeight = (int)(size ? size : font->getSize());
+    char line[96];
+    font->start();
+    for (unsigned int i = 0; i < CATEGORY_COUNT; ++i)
+    {
+        size_t usage = __usage[i].load(std::memory_order_relaxed);
+        size_t budget = __budgets[i].load(std::memory_order_relaxed);
+        if (budget > 0)
+            sprintf(line, "%s: %u KB of %u KB", __categoryNames[i], (unsigned int)(usage / 1024), (unsigned int)(budget / 1024));
+        else
+            sprintf(line, "%s: %u KB", __categoryNames[i], (unsigned int)(usage / 1024));
+        bool overBudget = budget > 0 && usage > budget;
+        font->drawText(line, x, y + lineHeight * (int)i, overBudget ? Vector4(1, 0, 0, 1) : color, size);
+    }
+    sprintf(line, "total: %u KB", (unsigned int)(getTotalUsage() / 1024));
+    font->drawText(line, x, y + lineHeight * (int)CATEGORY_COUNT, color, size);
+    font->finish();
+}
+
+void MemoryStats::add(Category category, size_t bytes)
+{
+    GP_ASSERT(category < CATEGORY_COUNT);
+
+    size_t usage = __usage[category].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    size_t peak = __peakUsage[category].load(std::memory_order_relaxed);
+    while (usage > peak && !__peakUsage[category].compare_exchange_weak(peak, usage, std::memory_order_relaxed))
+    {
+    }
+
+    // Warn once each time that the category goes over its budget.
+    size_t budget = __budgets[category].load(std::memory_order_relaxed);
+    if (budget > 0 && usage > budget && !__overBudget[category].exchange(true, std::memory_order_relaxed))
+    {
+        GP_WARN("The memory of %s (%u KB) exceeds its budget of %u KB.", __categoryNames[category],
+            (unsigned int)(usage / 1024), (unsigned int)(budget / 1024));
+    }
+}
+
+void MemoryStats::remove(Category category, size_t bytes)
+{
+    GP_ASSERT(category < CATEGORY_COUNT);
+
+    size_t usage = __usage[category].fetch_sub(bytes, std::memory_order_relaxed) - bytes;
+    size_t budget = __budgets[category].load(std::memory_order_relaxed);
+    if (budget > 0 && usage <= budget)
+        __overBudget[category].store(false, std::memory_order_relaxed);
+}
+
+void MemoryStats::initialize(Properties* config)
+{
+    if (config == NULL)
+        return;
+
+    for (unsigned int i = 0; i < CATEGORY_COUNT; ++i)
+    {
+        if (config->exists(__categoryNames[i]))
+            setBudget((Category)i, (size_t)std::max(0, config->getInt(__categoryNames[i])) * 1024 * 1024);
+    }
+}
+
+}
@@ -0,0 +1,156 @@
+#ifndef MEMORYSTATS_H_
+#define MEMORYSTATS_H_
+
+#include "Vector4.h"
+
+namespace gameplay
+{
+
+class Font;
+class Properties;
+
+/**
+ * Defines the accounting of the memory that the engine uses, by category.
+ *
+ * The memory of each category is counted where the engine allocates it: the video memory
+ * of textures is estimated from their size, format and mipmaps, the video memory of meshes
+ * is the size of their vertex and index buffers, and the memory of animation curves, of the
+ * Lua state, of audio buffers and of the memory pools and frame arenas is counted as it is
+ * allocated. The usage of each category, and its peak, can be queried at any time and drawn
+ * as an overlay (see draw).
+ *
+ * A budget can be set for each category, in code or in the game.config file (in megabytes):
+ *
+ * @code
+ * memory
+ * {
+ *     textures = 128
+ *     meshes = 32
+ * }
+ * @endcode
+ *
+ * A warning is logged when a category exceeds its budget, and again each time that it exceeds
+ * the budget after having been within it.
+ *
+ * @script{ignore}
+ */
+class MemoryStats
+{
+    friend class Game;
+
+public:
+
+    /**
+     * Defines the categories of memory.
+     */
+    enum Category
+    {
+        TEXTURES,
+        MESHES,
+        ANIMATIONS,
+        SCRIPTS,
+        AUDIO,
+        POOLS,
+        CATEGORY_COUNT
+    };
+
+    /**
+     * Returns the memory that a category uses.
+     *
+     * @param category The category.
+     *
+     * @return The number of bytes used.
+     */
+    static size_t getUsage(Category category);
+
+    /**
+     * Returns the largest amount of memory that a category has used.
+     *
+     * @param category The category.
+     *
+     * @return The peak number of bytes used.
+     */
+    static size_t getPeakUsage(Category category);
+
+    /**
+     * Returns the memory that all of the categories use.
+     *
+     * @return The number of bytes used.
+     */
+    static size_t getTotalUsage();
+
+    /**
+     * Sets the budget of a category.
+     *
+     * @param category The category.
+     * @param bytes The number of bytes that the category should stay within, or 0 for no budget.
+     */
+    static void setBudget(Category category, size_t bytes);
+
+    /**
+     * Returns the budget of a category.
+     *
+     * @param category The category.
+     *
+     * @return The budget in bytes, or 0 if the category has no budget.
+     */
+    static size_t getBudget(Category category);
+
+    /**
+     * Determines whether all of the categories are within their budgets.
+     *
+     * @return true if no category exceeds its budget, false otherwise.
+     */
+    static bool isWithinBudget();
+
+    /**
+     * Returns the name of a category, as used in the game.config file.
+     *
+     * @param category The category.
+     *
+     * @return The name of the category.
+     */
+    static const char* getCategoryName(Category category);
+
+    /**
+     * Draws the usage of each category, and its budget, as lines of text.
+     *
+     * Categories that exceed their budget are drawn in red.
+     *
+     * @param font The font to draw the text with.
+     * @param color The color of the text.
+     * @param x The viewport x position of the first line.
+     * @param y The viewport y position of the first line.
+     * @param size The size to draw the text (0 for the default size of the font).
+     */
+    static void draw(Font* font, const Vector4& color, int x, int y, unsigned int size = 0);
+
+    /**
+     * Counts memory that was allocated. This is called by the engine where it allocates memory.
+     *
+     * @param category The category of the memory.
+     * @param bytes The number of bytes allocated.
+     */
+    static void add(Category category, size_t bytes);
+
+    /**
+     * Counts memory that was freed. This is called by the engine where it frees memory.
+     *
+     * @param category The category of the memory.
+     * @param bytes The number of bytes freed.
+     */
+    static void remove(Category category, size_t bytes);
+
+private:
+
+    MemoryStats();
+
+    /**
+     * Sets the budgets of the categories from the memory namespace of the game.config file.
+     */
+    static void initialize(Properties* config);
+};
+
+}
+
+#endif
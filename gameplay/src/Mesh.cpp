@@ -1,21 +1,35 @@
 #include "Base.h"
 #include "Mesh.h"
+#include "RenderStats.h"
+#include "MemoryStats.h"
 #include "MeshPart.h"
+#include "MeshGeometry.h"
 #include "Effect.h"
 #include "Model.h"
 #include "Material.h"
+#include "BufferAllocator.h"
+#include "Platform.h"
+#include "Game.h"
 
 namespace gameplay
 {
 
 Mesh::Mesh(const VertexFormat& vertexFormat) 
-    : _vertexFormat(vertexFormat), _vertexCount(0), _vertexBuffer(0), _primitiveType(TRIANGLES), 
-      _partCount(0), _parts(NULL), _dynamic(false)
+    : _vertexFormat(vertexFormat), _vertexCount(0), _vertexBuffer(0), _vertexOffset(0), _sharedBuffer(false), _primitiveType(TRIANGLES), 
+      _partCount(0), _parts(NULL), _lodCount(0), _lodErrors(NULL), _lodParts(NULL), _dynamic(false),
+      _positionDecodeScale(Vector3::one()), _geometry(NULL), _streamed(false), _streamEntry(NULL)
 {
 }
 
 Mesh::~Mesh()
 {
+    if (_streamEntry)
+    {
+        MeshStreamer* streamer = Game::getInstance()->getMeshStreamer();
+        GP_ASSERT(streamer);
+        streamer->remove(_streamEntry);
+    }
+
     if (_parts)
     {
         for (unsigned int i = 0; i < _partCount; ++i)
@@ -24,25 +38,83 @@ Mesh::~Mesh()
         }
         SAFE_DELETE_ARRAY(_parts);
     }
+    if (_lodParts)
+    {
+        for (unsigned int i = 0; i < _lodCount * _partCount; ++i)
+        {
+            SAFE_DELETE(_lodParts[i]);
+        }
+        SAFE_DELETE_ARRAY(_lodParts);
+    }
+    SAFE_DELETE_ARRAY(_lodErrors);
+    SAFE_RELEASE(_geometry);
 
     if (_vertexBuffer)
     {
-        glDeleteBuffers(1, &_vertexBuffer);
+        if (_sharedBuffer)
+        {
+            BufferAllocator::Allocation allocation;
+            allocation.buffer = _vertexBuffer;
+            allocation.offset = _vertexOffset;
+            allocation.size = _vertexFormat.getVertexSize() * _vertexCount;
+            BufferAllocator::free(&allocation);
+        }
+        else
+        {
+            RenderState::deleteBuffer(_vertexBuffer);
+        }
         _vertexBuffer = 0;
+        if (!_streamed)
+            MemoryStats::remove(MemoryStats::MESHES, _vertexFormat.getVertexSize() * _vertexCount);
     }
 }
 
 Mesh* Mesh::createMesh(const VertexFormat& vertexFormat, unsigned int vertexCount, bool dynamic)
 {
-    GLuint vbo;
-    GL_ASSERT( glGenBuffers(1, &vbo) );
-    GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, vbo) );
-    GL_ASSERT( glBufferData(GL_ARRAY_BUFFER, vertexFormat.getVertexSize() * vertexCount, NULL, dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW) );
+    return createMesh(vertexFormat, vertexCount, dynamic, false);
+}
+
+Mesh* Mesh::createMesh(const VertexFormat& vertexFormat, unsigned int vertexCount, bool dynamic, bool streamed)
+{
+    // Headless platforms have no graphics context, so their meshes have no vertex buffer. The
+    // geometry that physics needs is read from the bundle instead.
+    if (Platform::isHeadless())
+    {
+        Mesh* mesh = new Mesh(vertexFormat);
+        mesh->_vertexCount = vertexCount;
+        mesh->_dynamic = dynamic;
+        return mesh;
+    }
+
+    // Static meshes share the arenas of the buffer allocator when it is enabled. Their first
+    // vertex is aligned to a whole number of vertices, and to 4 bytes for the attributes.
+    unsigned int vertexSize = vertexFormat.getVertexSize();
+    BufferAllocator::Allocation allocation;
+    bool shared = false;
+    if (!dynamic && !streamed && BufferAllocator::isEnabled())
+    {
+        unsigned int alignment = vertexSize % 4 == 0 ? vertexSize : (vertexSize % 2 == 0 ? vertexSize * 2 : vertexSize * 4);
+        shared = BufferAllocator::allocate(GL_ARRAY_BUFFER, vertexSize * vertexCount, alignment, &allocation);
+    }
+    if (!shared)
+    {
+        GL_ASSERT( glGenBuffers(1, &allocation.buffer) );
+        if (!streamed)
+        {
+            RenderState::bindBuffer(GL_ARRAY_BUFFER, allocation.buffer);
+            GL_ASSERT( glBufferData(GL_ARRAY_BUFFER, vertexSize * vertexCount, NULL, dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW) );
+        }
+    }
 
     Mesh* mesh = new Mesh(vertexFormat);
     mesh->_vertexCount = vertexCount;
-    mesh->_vertexBuffer = vbo;
+    mesh->_vertexBuffer = allocation.buffer;
+    mesh->_vertexOffset = allocation.offset;
+    mesh->_sharedBuffer = shared;
     mesh->_dynamic = dynamic;
+    mesh->_streamed = streamed;
+    if (!streamed)
+        MemoryStats::add(MemoryStats::MESHES, vertexFormat.getVertexSize() * vertexCount);
 
     return mesh;
 }
@@ -226,6 +298,18 @@ const char* Mesh::getUrl() const
     return _url.c_str();
 }
 
+MeshGeometry* Mesh::getGeometry() const
+{
+    return _geometry;
+}
+
+MeshGeometry* Mesh::loadGeometry()
+{
+    if (_geometry == NULL && !_url.empty())
+        _geometry = MeshGeometry::get(_url.c_str());
+    return _geometry;
+}
+
 const VertexFormat& Mesh::getVertexFormat() const
 {
     return _vertexFormat;
@@ -246,11 +330,21 @@ VertexBufferHandle Mesh::getVertexBuffer() const
     return _vertexBuffer;
 }
 
+unsigned int Mesh::getVertexOffset() const
+{
+    return _vertexOffset;
+}
+
 bool Mesh::isDynamic() const
 {
     return _dynamic;
 }
 
+bool Mesh::isResident() const
+{
+    return _streamEntry == NULL || _streamEntry->resident;
+}
+
 
 Mesh::PrimitiveType Mesh::getPrimitiveType() const
 {
@@ -264,11 +358,15 @@ void Mesh::setPrimitiveType(PrimitiveType type)
 
 void Mesh::setVertexData(const float* vertexData, unsigned int vertexStart, unsigned int vertexCount)
 {
-    GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer) );
+    if (!_vertexBuffer)
+        return;
+
+    RenderState::bindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
 
-    if (vertexStart == 0 && vertexCount == 0)
+    if (vertexStart == 0 && vertexCount == 0 && !_sharedBuffer)
     {
         GL_ASSERT( glBufferData(GL_ARRAY_BUFFER, _vertexFormat.getVertexSize() * _vertexCount, vertexData, _dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW) );
+        RenderStats::countBufferUpload(_vertexFormat.getVertexSize() * _vertexCount);
     }
     else
     {
@@ -277,12 +375,34 @@ void Mesh::setVertexData(const float* vertexData, unsigned int vertexStart, unsi
             vertexCount = _vertexCount - vertexStart;
         }
 
-        GL_ASSERT( glBufferSubData(GL_ARRAY_BUFFER, vertexStart * _vertexFormat.getVertexSize(), vertexCount * _vertexFormat.getVertexSize(), vertexData) );
+        GL_ASSERT( glBufferSubData(GL_ARRAY_BUFFER, _vertexOffset + vertexStart * _vertexFormat.getVertexSize(), vertexCount * _vertexFormat.getVertexSize(), vertexData) );
+        RenderStats::countBufferUpload(vertexCount * _vertexFormat.getVertexSize());
     }
 }
 
+bool Mesh::getVertexData(void* vertexData) const
+{
+#ifdef OPENGL_ES
+    GP_WARN("Reading back vertex data is not supported on OpenGL ES.");
+    return false;
+#else
+    if (!_vertexBuffer)
+        return false;
+
+    RenderState::bindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+    GL_ASSERT( glGetBufferSubData(GL_ARRAY_BUFFER, _vertexOffset, _vertexFormat.getVertexSize() * _vertexCount, vertexData) );
+    return true;
+#endif
+}
+
 MeshPart* Mesh::addPart(PrimitiveType primitiveType, IndexFormat indexFormat, unsigned int indexCount, bool dynamic)
 {
+    if (_lodCount > 0)
+    {
+        GP_WARN("Failed to add a part to a mesh that has levels of detail.");
+        return NULL;
+    }
+
     MeshPart* part = MeshPart::create(this, _partCount, primitiveType, indexFormat, indexCount, dynamic);
     if (part)
     {
@@ -315,6 +435,76 @@ MeshPart* Mesh::getPart(unsigned int index)
     return _parts[index];
 }
 
+unsigned int Mesh::addLod(float error)
+{
+    // Grow the arrays of the levels by one level. The parts of the levels are kept in one
+    // array, with the parts of each level after the parts of the previous level.
+    float* oldErrors = _lodErrors;
+    _lodErrors = new float[_lodCount + 1];
+    for (unsigned int i = 0; i < _lodCount; ++i)
+    {
+        _lodErrors[i] = oldErrors[i];
+    }
+    _lodErrors[_lodCount] = error;
+    SAFE_DELETE_ARRAY(oldErrors);
+
+    if (_partCount > 0)
+    {
+        MeshPart** oldParts = _lodParts;
+        _lodParts = new MeshPart*[(_lodCount + 1) * _partCount];
+        for (unsigned int i = 0; i < _lodCount * _partCount; ++i)
+        {
+            _lodParts[i] = oldParts[i];
+        }
+        for (unsigned int i = 0; i < _partCount; ++i)
+        {
+            _lodParts[_lodCount * _partCount + i] = NULL;
+        }
+        SAFE_DELETE_ARRAY(oldParts);
+    }
+
+    return ++_lodCount;
+}
+
+MeshPart* Mesh::addLodPart(unsigned int lod, unsigned int partIndex, PrimitiveType primitiveType, IndexFormat indexFormat, unsigned int indexCount, bool dynamic)
+{
+    GP_ASSERT(lod > 0 && lod <= _lodCount);
+    GP_ASSERT(partIndex < _partCount);
+    GP_ASSERT(_lodParts);
+
+    MeshPart* part = MeshPart::create(this, partIndex, primitiveType, indexFormat, indexCount, dynamic);
+    if (part)
+    {
+        MeshPart*& lodPart = _lodParts[(lod - 1) * _partCount + partIndex];
+        SAFE_DELETE(lodPart);
+        lodPart = part;
+    }
+    return part;
+}
+
+unsigned int Mesh::getLodCount() const
+{
+    return _lodCount + 1;
+}
+
+float Mesh::getLodError(unsigned int lod) const
+{
+    GP_ASSERT(lod <= _lodCount);
+    return lod > 0 ? _lodErrors[lod - 1] : 0.0f;
+}
+
+MeshPart* Mesh::getLodPart(unsigned int lod, unsigned int partIndex)
+{
+    GP_ASSERT(_parts && partIndex < _partCount);
+    if (lod > 0 && lod <= _lodCount && _lodParts)
+    {
+        MeshPart* part = _lodParts[(lod - 1) * _partCount + partIndex];
+        if (part)
+            return part;
+    }
+    return _parts[partIndex];
+}
+
 const BoundingBox& Mesh::getBoundingBox() const
 {
     return _boundingBox;
@@ -335,4 +525,20 @@ void Mesh::setBoundingSphere(const BoundingSphere& sphere)
     _boundingSphere = sphere;
 }
 
+const Vector3& Mesh::getPositionDecodeScale() const
+{
+    return _positionDecodeScale;
+}
+
+const Vector3& Mesh::getPositionDecodeOffset() const
+{
+    return _positionDecodeOffset;
+}
+
+void Mesh::setPositionDecode(const Vector3& scale, const Vector3& offset)
+{
+    _positionDecodeScale = scale;
+    _positionDecodeOffset = offset;
+}
+
 }
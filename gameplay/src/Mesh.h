@@ -6,11 +6,13 @@
 #include "Vector3.h"
 #include "BoundingBox.h"
 #include "BoundingSphere.h"
+#include "MeshStreamer.h"
 
 namespace gameplay
 {
 
 class MeshPart;
+class MeshGeometry;
 class Material;
 class Model;
 
@@ -22,6 +24,8 @@ class Mesh : public Ref
 {
     friend class Model;
     friend class Bundle;
+    friend class MeshPart;
+    friend class MeshStreamer;
 
 public:
 
@@ -142,6 +146,24 @@ public:
      */
     const char* getUrl() const;
 
+    /**
+     * Returns the geometry of the mesh in CPU memory, which is kept for the meshes that are loaded
+     * from a Bundle while geometries are retained (see MeshGeometry::setRetained).
+     *
+     * @return The geometry of the mesh, or NULL if it is not kept.
+     * @script{ignore}
+     */
+    MeshGeometry* getGeometry() const;
+
+    /**
+     * Returns the geometry of the mesh in CPU memory, reading it from the bundle that the mesh was
+     * loaded from (see MeshGeometry::get) and keeping it if the mesh does not have it yet.
+     *
+     * @return The geometry of the mesh, or NULL if the mesh was not loaded from a Bundle.
+     * @script{ignore}
+     */
+    MeshGeometry* loadGeometry();
+
     /**
      * Gets the vertex format for the mesh.
      *
@@ -170,6 +192,17 @@ public:
      */
     VertexBufferHandle getVertexBuffer() const;
 
+    /**
+     * Returns the offset of the first vertex of the mesh in its vertex buffer.
+     *
+     * The offset is 0 unless the mesh shares its vertex buffer with other meshes
+     * (see BufferAllocator).
+     *
+     * @return The offset, in bytes.
+     * @script{ignore}
+     */
+    unsigned int getVertexOffset() const;
+
     /**
      * Determines if the mesh is dynamic.
      *
@@ -177,6 +210,17 @@ public:
      */
     bool isDynamic() const;
 
+    /**
+     * Determines if the vertex and index data of the mesh is loaded.
+     *
+     * This is false for the meshes that are streamed from a Bundle (see MeshStreamer) while their
+     * data is not loaded, and true for all other meshes.
+     *
+     * @return true if the data of the mesh is loaded; false otherwise.
+     * @script{ignore}
+     */
+    bool isResident() const;
+
     /**
      * Returns the primitive type of the vertices in the mesh.
      *
@@ -209,6 +253,19 @@ public:
      */
     void setVertexData(const float* vertexData, unsigned int vertexStart = 0, unsigned int vertexCount = 0);
 
+    /**
+     * Reads the vertex data of the mesh back from its vertex buffer.
+     *
+     * Vertex buffers cannot be read back on OpenGL ES, where this fails.
+     *
+     * @param vertexData The buffer to read the vertex data into, which must hold
+     *        getVertexSize() * getVertexCount() bytes.
+     *
+     * @return true if the vertex data was read, false otherwise.
+     * @script{ignore}
+     */
+    bool getVertexData(void* vertexData) const;
+
     /**
      * Creates and adds a new part of primitive data defining how the vertices are connected.
      *
@@ -237,6 +294,69 @@ public:
      */
     MeshPart* getPart(unsigned int index);
 
+    /**
+     * Adds a level of detail to the mesh.
+     *
+     * A level of detail has a simplified version of each part of the mesh, which draws the
+     * same vertices with fewer primitives. Levels are added from the most to the least
+     * detailed, after all of the parts of the mesh were added, and the parts of each level are
+     * added with addLodPart. Level 0 is the mesh itself.
+     *
+     * @param error The largest distance between the surface of the level and the surface of the
+     *      mesh, relative to the radius of the bounding sphere of the mesh.
+     *
+     * @return The index of the new level.
+     * @script{ignore}
+     */
+    unsigned int addLod(float error);
+
+    /**
+     * Creates the simplified version of a part for a level of detail.
+     *
+     * Parts of the level that are not added draw the part of the mesh.
+     *
+     * @param lod The index of the level (1 or more).
+     * @param partIndex The index of the part of the mesh that the part simplifies.
+     * @param primitiveType The type of primitive data to connect the indices as.
+     * @param indexFormat The format of the indices.
+     * @param indexCount The number of indices to be contained in the part.
+     * @param dynamic true if the index data is dynamic; false otherwise.
+     *
+     * @return The new part.
+     * @script{ignore}
+     */
+    MeshPart* addLodPart(unsigned int lod, unsigned int partIndex, PrimitiveType primitiveType, Mesh::IndexFormat indexFormat, unsigned int indexCount, bool dynamic = false);
+
+    /**
+     * Gets the number of levels of detail of the mesh, including the mesh itself.
+     *
+     * @return The number of levels of detail (1 if the mesh has no simplified levels).
+     * @script{ignore}
+     */
+    unsigned int getLodCount() const;
+
+    /**
+     * Gets the error of a level of detail.
+     *
+     * @param lod The index of the level.
+     *
+     * @return The largest distance between the surface of the level and the surface of the
+     *      mesh, relative to the radius of the bounding sphere of the mesh (0 for level 0).
+     * @script{ignore}
+     */
+    float getLodError(unsigned int lod) const;
+
+    /**
+     * Gets the part that is drawn for a part of the mesh at a level of detail.
+     *
+     * @param lod The index of the level.
+     * @param partIndex The index of the part of the mesh.
+     *
+     * @return The simplified part, or the part of the mesh if the level doesn't simplify it.
+     * @script{ignore}
+     */
+    MeshPart* getLodPart(unsigned int lod, unsigned int partIndex);
+
     /**
      * Returns the bounding box for the points in this mesh.
      * 
@@ -295,6 +415,37 @@ public:
      */
     void setBoundingSphere(const BoundingSphere& sphere);
 
+    /**
+     * Returns the scale that decodes the quantized positions of this mesh.
+     *
+     * Meshes whose positions are normalized integers keep them relative to their bounds, and
+     * are decoded by shaders as the position times the scale plus the offset, with the
+     * QUANTIZED_POSITION define and the POSITION_DECODE_SCALE and POSITION_DECODE_OFFSET
+     * auto bindings. The scale is one for meshes whose positions are not quantized.
+     *
+     * @return The scale that decodes the positions of the mesh.
+     * @script{ignore}
+     */
+    const Vector3& getPositionDecodeScale() const;
+
+    /**
+     * Returns the offset that decodes the quantized positions of this mesh.
+     *
+     * @return The offset that decodes the positions of the mesh.
+     * @see getPositionDecodeScale()
+     * @script{ignore}
+     */
+    const Vector3& getPositionDecodeOffset() const;
+
+    /**
+     * Sets the scale and the offset that decode the quantized positions of this mesh.
+     *
+     * @param scale The scale that decodes the positions of the mesh.
+     * @param offset The offset that decodes the positions of the mesh.
+     * @script{ignore}
+     */
+    void setPositionDecode(const Vector3& scale, const Vector3& offset);
+
     /**
      * Destructor.
      */
@@ -317,16 +468,32 @@ private:
      */
     Mesh& operator=(const Mesh&);
 
+    /**
+     * Creates a mesh, whose buffers have no storage if it is streamed, since the mesh streamer
+     * allocates it when the data of the mesh is loaded.
+     */
+    static Mesh* createMesh(const VertexFormat& vertexFormat, unsigned int vertexCount, bool dynamic, bool streamed);
+
     std::string _url;
     const VertexFormat _vertexFormat;
     unsigned int _vertexCount;
     VertexBufferHandle _vertexBuffer;
+    unsigned int _vertexOffset;
+    bool _sharedBuffer;
     PrimitiveType _primitiveType;
     unsigned int _partCount;
     MeshPart** _parts;
+    unsigned int _lodCount;
+    float* _lodErrors;
+    MeshPart** _lodParts;
     bool _dynamic;
     BoundingBox _boundingBox;
     BoundingSphere _boundingSphere;
+    Vector3 _positionDecodeScale;
+    Vector3 _positionDecodeOffset;
+    MeshGeometry* _geometry;
+    bool _streamed;
+    MeshStreamer::Entry* _streamEntry;
 };
 
 }
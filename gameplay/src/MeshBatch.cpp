@@ -1,19 +1,66 @@
 #include "Base.h"
 #include "MeshBatch.h"
+#include "GraphicsDevice.h"
+#include "RenderStats.h"
 #include "Material.h"
 
+// The number of segments that the buffers of a streaming batch are split into
+#define MESH_BATCH_STREAM_SEGMENTS 3
+// How long to wait at a time for the GPU to finish drawing from a segment, in nanoseconds
+#define MESH_BATCH_STREAM_WAIT_TIMEOUT 1000000000
+// The number of vertices that 16-bit indices can refer to
+#define MESH_BATCH_MAX_INDEX16_VERTICES 65536
+
 namespace gameplay
 {
 
+static bool __defaultStreaming = false;
+
+static unsigned int getIndex(const void* indices, Mesh::IndexFormat indexFormat, unsigned int i)
+{
+    return indexFormat == Mesh::INDEX32 ? ((const unsigned int*)indices)[i] : ((const unsigned short*)indices)[i];
+}
+
+static void setIndex(unsigned char* indices, Mesh::IndexFormat indexFormat, unsigned int i, unsigned int value)
+{
+    if (indexFormat == Mesh::INDEX32)
+        ((unsigned int*)indices)[i] = value;
+    else
+        ((unsigned short*)indices)[i] = (unsigned short)value;
+}
+
+struct MeshBatch::Stream
+{
+    GLuint vertexBuffer;
+    GLuint indexBuffer;
+    // The persistent mappings of the whole buffers, or NULL when the buffers are mapped for each batch.
+    unsigned char* vertexMap;
+    unsigned char* indexMap;
+    // The mapped memory at the first vertex and index of the current batch.
+    unsigned char* vertices;
+    unsigned short* indices;
+    bool mapped;
+    // The segment being filled, and the first vertex and index of the current batch within it.
+    unsigned int segment;
+    unsigned int vertexOffset;
+    unsigned int indexOffset;
+#ifdef GP_USE_BUFFER_STREAMING
+    GLsync fences[MESH_BATCH_STREAM_SEGMENTS];
+#endif
+};
+
 MeshBatch::MeshBatch(const VertexFormat& vertexFormat, Mesh::PrimitiveType primitiveType, Material* material, bool indexed, unsigned int initialCapacity, unsigned int growSize)
     : _vertexFormat(vertexFormat), _primitiveType(primitiveType), _material(material), _indexed(indexed), _capacity(0), _growSize(growSize),
-    _vertexCapacity(0), _indexCapacity(0), _vertexCount(0), _indexCount(0), _vertices(NULL), _verticesPtr(NULL), _indices(NULL), _indicesPtr(NULL), _started(false)
+    _vertexCapacity(0), _indexCapacity(0), _vertexCount(0), _indexCount(0), _vertices(NULL), _verticesPtr(NULL), _indexFormat(Mesh::INDEX16), _indices(NULL), _indicesPtr(NULL), _lastIndex(0), _started(false), _stream(NULL)
 {
     resize(initialCapacity);
+    if (__defaultStreaming && isStreamingSupported())
+        setStreaming(true);
 }
 
 MeshBatch::~MeshBatch()
 {
+    releaseStream();
     SAFE_RELEASE(_material);
     SAFE_DELETE_ARRAY(_vertices);
     SAFE_DELETE_ARRAY(_indices);
@@ -43,23 +90,58 @@ MeshBatch* MeshBatch::create(const VertexFormat& vertexFormat, Mesh::PrimitiveTy
     return batch;
 }
 
-void MeshBatch::add(const void* vertices, size_t size, unsigned int vertexCount, const unsigned short* indices, unsigned int indexCount)
+void MeshBatch::add(const void* vertices, size_t size, unsigned int vertexCount, const void* indices, Mesh::IndexFormat indexFormat, unsigned int indexCount)
 {
     GP_ASSERT(vertices);
-    
+
+    // Need an extra 2 indices for connecting strips with degenerate triangles.
+    bool join = _primitiveType == Mesh::TRIANGLE_STRIP && _vertexCount > 0;
+
+    // The indices of a streaming batch stay 16-bit, and are relative to the first vertex of
+    // their range. A new range starts when the indices can't reach the new vertices.
+    unsigned int rangeVertex = 0;
+    bool newRange = false;
+    if (_stream && _indexed)
+    {
+        if (vertexCount > MESH_BATCH_MAX_INDEX16_VERTICES)
+        {
+            GP_WARN("Failed to add %u vertices to a streaming mesh batch; at most %u vertices can be added at a time.", vertexCount, MESH_BATCH_MAX_INDEX16_VERTICES);
+            return;
+        }
+        rangeVertex = _ranges.empty() ? 0 : _ranges.back().vertexStart;
+        if (_vertexCount - rangeVertex + vertexCount > MESH_BATCH_MAX_INDEX16_VERTICES)
+        {
+            rangeVertex = _vertexCount;
+            newRange = true;
+            join = false;
+        }
+    }
+
     unsigned int newVertexCount = _vertexCount + vertexCount;
-    unsigned int newIndexCount = _indexCount + indexCount;
-    if (_primitiveType == Mesh::TRIANGLE_STRIP && _vertexCount > 0)
-        newIndexCount += 2; // need an extra 2 indices for connecting strips with degenerate triangles
+    unsigned int newIndexCount = _indexCount + indexCount + (join ? 2 : 0);
     
-    // Do we need to grow the batch?
-    while (newVertexCount > _vertexCapacity || (_indexed && newIndexCount > _indexCapacity))
+    // Do we need to grow the batch? A streaming batch that does not start at the beginning of
+    // a segment moves to the next segment first, and only grows if it does not fit there either.
+    while (newVertexCount > _vertexCapacity - (_stream ? _stream->vertexOffset : 0) ||
+           (_indexed && newIndexCount > _indexCapacity - (_stream ? _stream->indexOffset : 0)))
     {
+        if (_stream && (_stream->vertexOffset > 0 || _stream->indexOffset > 0))
+        {
+            unmapStream();
+            nextStreamSegment();
+            mapStream();
+            continue;
+        }
         if (_growSize == 0)
             return; // growing disabled, just clip batch
         if (!resize(_capacity + _growSize))
             return; // failed to grow
     }
+    if (newRange)
+    {
+        Range range = { _indexCount, _vertexCount };
+        _ranges.push_back(range);
+    }
     
     // Copy vertex data.
     GP_ASSERT(_verticesPtr);
@@ -72,30 +154,34 @@ void MeshBatch::add(const void* vertices, size_t size, unsigned int vertexCount,
         GP_ASSERT(indices);
         GP_ASSERT(_indicesPtr);
 
-        if (_vertexCount == 0)
+        const unsigned int indexSize = getIndexSize();
+        const unsigned int offset = _vertexCount - rangeVertex;
+        if (offset == 0 && indexFormat == _indexFormat)
         {
-            // Simply copy values directly into the start of the index array.
-            memcpy(_indicesPtr, indices, indexCount * sizeof(unsigned short));
+            // Simply copy values directly into the index array.
+            memcpy(_indicesPtr, indices, indexCount * indexSize);
         }
         else
         {
-            if (_primitiveType == Mesh::TRIANGLE_STRIP)
+            if (join)
             {
                 // Create a degenerate triangle to connect separate triangle strips
                 // by duplicating the previous and next vertices.
-                _indicesPtr[0] = *(_indicesPtr-1);
-                _indicesPtr[1] = _vertexCount;
-                _indicesPtr += 2;
+                setIndex(_indicesPtr, _indexFormat, 0, _lastIndex);
+                setIndex(_indicesPtr, _indexFormat, 1, offset);
+                _indicesPtr += 2 * indexSize;
             }
-            
+
             // Loop through all indices and insert them, with their values offset by
-            // 'vertexCount' so that they are relative to the first newly inserted vertex.
+            // 'offset' so that they are relative to the first newly inserted vertex.
             for (unsigned int i = 0; i < indexCount; ++i)
             {
-                _indicesPtr[i] = indices[i] + _vertexCount;
+                setIndex(_indicesPtr, _indexFormat, i, getIndex(indices, indexFormat, i) + offset);
             }
         }
-        _indicesPtr += indexCount;
+        if (indexCount > 0)
+            _lastIndex = getIndex(indices, indexFormat, indexCount - 1) + offset;
+        _indicesPtr += indexCount * indexSize;
         _indexCount = newIndexCount;
     }
     
@@ -116,7 +202,8 @@ void MeshBatch::updateVertexAttributeBinding()
         {
             Pass* p = t->getPassByIndex(j);
             GP_ASSERT(p);
-            VertexAttributeBinding* b = VertexAttributeBinding::create(_vertexFormat, _vertices, p->getEffect());
+            VertexAttributeBinding* b = _stream ? VertexAttributeBinding::createFromBuffer(_vertexFormat, _stream->vertexBuffer, p->getEffect()) :
+                                                  VertexAttributeBinding::create(_vertexFormat, _vertices, p->getEffect());
             p->setVertexAttributeBinding(b);
             SAFE_RELEASE(b);
         }
@@ -146,7 +233,9 @@ bool MeshBatch::resize(unsigned int capacity)
 
     // Store old batch data.
     unsigned char* oldVertices = _vertices;
-    unsigned short* oldIndices = _indices;
+    unsigned char* oldIndices = _indices;
+    Mesh::IndexFormat oldIndexFormat = _indexFormat;
+    unsigned int oldIndexSize = getIndexSize();
 
     unsigned int vertexCapacity = 0;
     switch (_primitiveType)
@@ -175,10 +264,14 @@ bool MeshBatch::resize(unsigned int capacity)
     // (we only know how many indices will be stored). Assume the worst case
     // for now, which is the same number of vertices as indices.
     unsigned int indexCapacity = vertexCapacity;
-    if (_indexed && indexCapacity > USHRT_MAX)
+
+    if (_stream)
     {
-        GP_ERROR("Index capacity is greater than the maximum unsigned short value (%d > %d).", indexCapacity, USHRT_MAX);
-        return false;
+        if (!resizeStream(vertexCapacity, indexCapacity))
+            return false;
+        _capacity = capacity;
+        updateVertexAttributeBinding();
+        return true;
     }
 
     // Allocate new data and reset pointers.
@@ -189,13 +282,15 @@ bool MeshBatch::resize(unsigned int capacity)
         voffset = vBytes - 1;
     _verticesPtr = _vertices + voffset;
 
+    // Indices are widened to 32 bits once 16 bits can't refer to all the vertices of the batch.
+    _indexFormat = vertexCapacity > MESH_BATCH_MAX_INDEX16_VERTICES ? Mesh::INDEX32 : Mesh::INDEX16;
     if (_indexed)
     {
-        unsigned int ioffset = _indicesPtr - _indices;
-        _indices = new unsigned short[indexCapacity];
+        unsigned int ioffset = (_indicesPtr - _indices) / oldIndexSize;
+        _indices = new unsigned char[indexCapacity * getIndexSize()];
         if (ioffset >= indexCapacity)
             ioffset = indexCapacity - 1;
-        _indicesPtr = _indices + ioffset;
+        _indicesPtr = _indices + ioffset * getIndexSize();
     }
 
     // Copy old data back in
@@ -203,7 +298,18 @@ bool MeshBatch::resize(unsigned int capacity)
         memcpy(_vertices, oldVertices, std::min(_vertexCapacity, vertexCapacity) * _vertexFormat.getVertexSize());
     SAFE_DELETE_ARRAY(oldVertices);
     if (oldIndices)
-        memcpy(_indices, oldIndices, std::min(_indexCapacity, indexCapacity) * sizeof(unsigned short));
+    {
+        unsigned int count = std::min(_indexCapacity, indexCapacity);
+        if (_indexFormat == oldIndexFormat)
+        {
+            memcpy(_indices, oldIndices, count * oldIndexSize);
+        }
+        else
+        {
+            for (unsigned int i = 0; i < count; ++i)
+                setIndex(_indices, _indexFormat, i, getIndex(oldIndices, oldIndexFormat, i));
+        }
+    }
     SAFE_DELETE_ARRAY(oldIndices);
 
     // Assign new capacities
@@ -219,13 +325,40 @@ bool MeshBatch::resize(unsigned int capacity)
 
 void MeshBatch::add(const float* vertices, unsigned int vertexCount, const unsigned short* indices, unsigned int indexCount)
 {
-    add(vertices, sizeof(float), vertexCount, indices, indexCount);
+    add(vertices, sizeof(float), vertexCount, indices, Mesh::INDEX16, indexCount);
+}
+
+void MeshBatch::add(const float* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount)
+{
+    add(vertices, sizeof(float), vertexCount, indices, Mesh::INDEX32, indexCount);
+}
+
+unsigned int MeshBatch::getIndexSize() const
+{
+    return _indexFormat == Mesh::INDEX32 ? sizeof(unsigned int) : sizeof(unsigned short);
 }
 
 void MeshBatch::start()
 {
+    if (_stream)
+    {
+        // The new batch follows the previous one in the current segment.
+        unmapStream();
+        _stream->vertexOffset += _vertexCount;
+        _stream->indexOffset += _indexCount;
+        _vertexCount = 0;
+        _indexCount = 0;
+        _ranges.clear();
+        if (_stream->vertexOffset >= _vertexCapacity || (_indexed && _stream->indexOffset >= _indexCapacity))
+            nextStreamSegment();
+        mapStream();
+        _started = true;
+        return;
+    }
+
     _vertexCount = 0;
     _indexCount = 0;
+    _ranges.clear();
     _verticesPtr = _vertices;
     _indicesPtr = _indices;
     _started = true;
@@ -239,6 +372,8 @@ bool MeshBatch::isStarted() const
 void MeshBatch::finish()
 {
     _started = false;
+    if (_stream)
+        unmapStream();
 }
 
 void MeshBatch::draw()
@@ -246,13 +381,13 @@ void MeshBatch::draw()
     if (_vertexCount == 0 || (_indexed && _indexCount == 0))
         return; // nothing to draw
 
-    // Not using VBOs, so unbind the element array buffer.
-    // ARRAY_BUFFER will be unbound automatically during pass->bind().
-    GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0 ) );
-
     GP_ASSERT(_material);
     if (_indexed)
-        GP_ASSERT(_indices);
+        GP_ASSERT(_indices || _stream);
+    GP_ASSERT(!_stream || !_stream->mapped);
+
+    // The vertices and indices of the batch are sent to the GPU with each frame.
+    RenderStats::countBufferUpload(_vertexCount * _vertexFormat.getVertexSize() + (_indexed ? _indexCount * getIndexSize() : 0));
 
     // Bind the material.
     Technique* technique = _material->getTechnique();
@@ -264,18 +399,352 @@ void MeshBatch::draw()
         GP_ASSERT(pass);
         pass->bind();
 
+#ifdef GP_USE_BUFFER_STREAMING
+        if (_stream)
+        {
+            // The binding reads from the start of the vertex buffer, so the segment is selected by the first vertex.
+            unsigned int firstVertex = _stream->segment * _vertexCapacity + _stream->vertexOffset;
+            unsigned int firstIndex = _stream->segment * _indexCapacity + _stream->indexOffset;
+            RenderState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, _stream->indexBuffer);
+            if (_indexed)
+            {
+                // Each range of the batch is drawn from its own first vertex.
+                unsigned int indexStart = 0;
+                unsigned int vertexStart = 0;
+                for (size_t r = 0; r <= _ranges.size(); ++r)
+                {
+                    unsigned int indexEnd = r < _ranges.size() ? _ranges[r].indexStart : _indexCount;
+                    GraphicsDevice::drawElementsBaseVertex(_primitiveType, indexEnd - indexStart, GL_UNSIGNED_SHORT,
+                                                           (GLvoid*)((firstIndex + indexStart) * sizeof(unsigned short)), firstVertex + vertexStart);
+                    if (r < _ranges.size())
+                    {
+                        indexStart = _ranges[r].indexStart;
+                        vertexStart = _ranges[r].vertexStart;
+                    }
+                }
+            }
+            else
+            {
+                GraphicsDevice::drawArrays(_primitiveType, firstVertex, _vertexCount);
+            }
+            pass->unbind();
+            continue;
+        }
+#endif
+
+        // Not using VBOs, so unbind the element array buffer.
+        // ARRAY_BUFFER is unbound during pass->bind(). This must happen after binding
+        // the pass since the element array buffer binding belongs to the bound VAO.
+        RenderState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
         if (_indexed)
         {
-            GL_ASSERT( glDrawElements(_primitiveType, _indexCount, GL_UNSIGNED_SHORT, (GLvoid*)_indices) );
+            GraphicsDevice::drawElements(_primitiveType, _indexCount, _indexFormat, (GLvoid*)_indices);
         }
         else
         {
-            GL_ASSERT( glDrawArrays(_primitiveType, 0, _vertexCount) );
+            GraphicsDevice::drawArrays(_primitiveType, 0, _vertexCount);
         }
 
         pass->unbind();
     }
 }
-    
+
+bool MeshBatch::isStreamingSupported()
+{
+#ifdef GP_USE_BUFFER_STREAMING
+    return glMapBufferRange && glUnmapBuffer && glFenceSync && glClientWaitSync && glDeleteSync && glCopyBufferSubData &&
+           GraphicsDevice::isSupported(GraphicsDevice::BASE_VERTEX);
+#else
+    return false;
+#endif
+}
+
+void MeshBatch::setDefaultStreaming(bool streaming)
+{
+    __defaultStreaming = streaming;
+}
+
+bool MeshBatch::isStreaming() const
+{
+    return _stream != NULL;
+}
+
+bool MeshBatch::setStreaming(bool streaming)
+{
+    GP_ASSERT(!_started);
+
+    if (streaming == (_stream != NULL))
+        return streaming;
+    if (streaming && !isStreamingSupported())
+    {
+        GP_WARN("Streaming mesh batches are not supported by the graphics driver.");
+        return false;
+    }
+
+    // Release the storage of the current mode, and allocate it again in the new mode.
+    releaseStream();
+    SAFE_DELETE_ARRAY(_vertices);
+    SAFE_DELETE_ARRAY(_indices);
+    _verticesPtr = NULL;
+    _indicesPtr = NULL;
+    _vertexCount = 0;
+    _indexCount = 0;
+    _ranges.clear();
+    _indexFormat = Mesh::INDEX16;
+    if (streaming)
+    {
+        _stream = new Stream();
+        memset(_stream, 0, sizeof(Stream));
+    }
+
+    unsigned int capacity = _capacity;
+    _capacity = 0;
+    _vertexCapacity = 0;
+    _indexCapacity = 0;
+    if (!resize(capacity) && _stream)
+    {
+        GP_WARN("Failed to create the buffers of a streaming mesh batch.");
+        releaseStream();
+        resize(capacity);
+    }
+    return _stream != NULL;
+}
+
+bool MeshBatch::resizeStream(unsigned int vertexCapacity, unsigned int indexCapacity)
+{
+    GP_ASSERT(_stream);
+
+#ifdef GP_USE_BUFFER_STREAMING
+    const unsigned int vertexSize = _vertexFormat.getVertexSize();
+    const bool mapped = _stream->mapped;
+    unmapStream();
+
+    // Buffers are mapped persistently when the driver supports immutable buffer storage.
+    const bool persistent = glBufferStorage != NULL;
+    const GLbitfield persistentAccess = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLuint buffers[2] = { 0, 0 };
+    const GLsizeiptr sizes[2] =
+    {
+        (GLsizeiptr)(vertexCapacity * vertexSize * MESH_BATCH_STREAM_SEGMENTS),
+        (GLsizeiptr)(_indexed ? indexCapacity * sizeof(unsigned short) * MESH_BATCH_STREAM_SEGMENTS : 0)
+    };
+    for (unsigned int i = 0; i < 2; ++i)
+    {
+        if (sizes[i] == 0)
+            continue;
+        GL_ASSERT( glGenBuffers(1, &buffers[i]) );
+        if (buffers[i] == 0)
+        {
+            if (buffers[0])
+                RenderState::deleteBuffer(buffers[0]);
+            return false;
+        }
+        GL_ASSERT( glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[i]) );
+        if (persistent)
+        {
+            GL_ASSERT( glBufferStorage(GL_COPY_WRITE_BUFFER, sizes[i], NULL, persistentAccess) );
+        }
+        else
+        {
+            GL_ASSERT( glBufferData(GL_COPY_WRITE_BUFFER, sizes[i], NULL, GL_STREAM_DRAW) );
+        }
+    }
+
+    // Keep the primitives of the current batch, at the start of the new buffers.
+    const GLuint oldBuffers[2] = { _stream->vertexBuffer, _stream->indexBuffer };
+    const GLintptr oldOffsets[2] =
+    {
+        (GLintptr)((_stream->segment * _vertexCapacity + _stream->vertexOffset) * vertexSize),
+        (GLintptr)((_stream->segment * _indexCapacity + _stream->indexOffset) * sizeof(unsigned short))
+    };
+    _vertexCount = std::min(_vertexCount, vertexCapacity);
+    _indexCount = std::min(_indexCount, indexCapacity);
+    const GLsizeiptr usedSizes[2] = { (GLsizeiptr)(_vertexCount * vertexSize), (GLsizeiptr)(_indexCount * sizeof(unsigned short)) };
+    for (unsigned int i = 0; i < 2; ++i)
+    {
+        if (oldBuffers[i] == 0)
+            continue;
+        if (buffers[i] && usedSizes[i] > 0)
+        {
+            GL_ASSERT( glBindBuffer(GL_COPY_READ_BUFFER, oldBuffers[i]) );
+            GL_ASSERT( glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[i]) );
+            GL_ASSERT( glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, oldOffsets[i], 0, usedSizes[i]) );
+        }
+        RenderState::deleteBuffer(oldBuffers[i]);
+    }
+    for (unsigned int i = 0; i < MESH_BATCH_STREAM_SEGMENTS; ++i)
+    {
+        if (_stream->fences[i])
+        {
+            GL_ASSERT( glDeleteSync(_stream->fences[i]) );
+            _stream->fences[i] = 0;
+        }
+    }
+
+    _stream->vertexBuffer = buffers[0];
+    _stream->indexBuffer = buffers[1];
+    _stream->vertexMap = NULL;
+    _stream->indexMap = NULL;
+    if (persistent)
+    {
+        for (unsigned int i = 0; i < 2; ++i)
+        {
+            if (buffers[i] == 0)
+                continue;
+            GL_ASSERT( glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[i]) );
+            unsigned char* map;
+            GL_ASSERT( map = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, sizes[i], persistentAccess) );
+            if (i == 0)
+                _stream->vertexMap = map;
+            else
+                _stream->indexMap = map;
+        }
+    }
+    GL_ASSERT( glBindBuffer(GL_COPY_READ_BUFFER, 0) );
+    GL_ASSERT( glBindBuffer(GL_COPY_WRITE_BUFFER, 0) );
+
+    _stream->segment = 0;
+    _stream->vertexOffset = 0;
+    _stream->indexOffset = 0;
+    _vertexCapacity = vertexCapacity;
+    _indexCapacity = indexCapacity;
+    if (mapped)
+        mapStream();
+    return true;
+#else
+    return false;
+#endif
+}
+
+void MeshBatch::mapStream()
+{
+    GP_ASSERT(_stream);
+    GP_ASSERT(!_stream->mapped);
+
+#ifdef GP_USE_BUFFER_STREAMING
+    const unsigned int vertexSize = _vertexFormat.getVertexSize();
+    unsigned int firstVertex = _stream->segment * _vertexCapacity + _stream->vertexOffset;
+    unsigned int firstIndex = _stream->segment * _indexCapacity + _stream->indexOffset;
+    if (_stream->vertexMap)
+    {
+        _stream->vertices = _stream->vertexMap + firstVertex * vertexSize;
+        _stream->indices = _indexed ? (unsigned short*)_stream->indexMap + firstIndex : NULL;
+    }
+    else
+    {
+        // Map the rest of the segment without waiting for the GPU, which the fences make safe.
+        const GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+        GL_ASSERT( glBindBuffer(GL_COPY_WRITE_BUFFER, _stream->vertexBuffer) );
+        GL_ASSERT( _stream->vertices = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, firstVertex * vertexSize,
+                                                                         (_vertexCapacity - _stream->vertexOffset) * vertexSize, access) );
+        _stream->indices = NULL;
+        if (_indexed)
+        {
+            GL_ASSERT( glBindBuffer(GL_COPY_WRITE_BUFFER, _stream->indexBuffer) );
+            GL_ASSERT( _stream->indices = (unsigned short*)glMapBufferRange(GL_COPY_WRITE_BUFFER, firstIndex * sizeof(unsigned short),
+                                                                             (_indexCapacity - _stream->indexOffset) * sizeof(unsigned short), access) );
+        }
+        GL_ASSERT( glBindBuffer(GL_COPY_WRITE_BUFFER, 0) );
+    }
+    _stream->mapped = true;
+
+    // The batch continues after the primitives that it already has.
+    _verticesPtr = _stream->vertices + _vertexCount * vertexSize;
+    _indicesPtr = _stream->indices ? (unsigned char*)(_stream->indices + _indexCount) : NULL;
+#endif
+}
+
+void MeshBatch::unmapStream()
+{
+    GP_ASSERT(_stream);
+    if (!_stream->mapped)
+        return;
+
+#ifdef GP_USE_BUFFER_STREAMING
+    if (!_stream->vertexMap)
+    {
+        GL_ASSERT( glBindBuffer(GL_COPY_WRITE_BUFFER, _stream->vertexBuffer) );
+        GL_ASSERT( glUnmapBuffer(GL_COPY_WRITE_BUFFER) );
+        if (_indexed)
+        {
+            GL_ASSERT( glBindBuffer(GL_COPY_WRITE_BUFFER, _stream->indexBuffer) );
+            GL_ASSERT( glUnmapBuffer(GL_COPY_WRITE_BUFFER) );
+        }
+        GL_ASSERT( glBindBuffer(GL_COPY_WRITE_BUFFER, 0) );
+    }
+#endif
+    _stream->mapped = false;
+    _stream->vertices = NULL;
+    _stream->indices = NULL;
+}
+
+void MeshBatch::nextStreamSegment()
+{
+    GP_ASSERT(_stream);
+    GP_ASSERT(!_stream->mapped);
+
+#ifdef GP_USE_BUFFER_STREAMING
+    // Wait until the GPU no longer draws from the next segment.
+    unsigned int next = (_stream->segment + 1) % MESH_BATCH_STREAM_SEGMENTS;
+    if (_stream->fences[next])
+    {
+        GLenum result;
+        do
+        {
+            GL_ASSERT( result = glClientWaitSync(_stream->fences[next], GL_SYNC_FLUSH_COMMANDS_BIT, MESH_BATCH_STREAM_WAIT_TIMEOUT) );
+        } while (result == GL_TIMEOUT_EXPIRED);
+        GL_ASSERT( glDeleteSync(_stream->fences[next]) );
+        _stream->fences[next] = 0;
+    }
+
+    // Move the primitives that the current batch already has to the start of the next segment.
+    const unsigned int vertexSize = _vertexFormat.getVertexSize();
+    if (_vertexCount > 0)
+    {
+        GL_ASSERT( glBindBuffer(GL_COPY_READ_BUFFER, _stream->vertexBuffer) );
+        GL_ASSERT( glBindBuffer(GL_COPY_WRITE_BUFFER, _stream->vertexBuffer) );
+        GL_ASSERT( glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)(_stream->segment * _vertexCapacity + _stream->vertexOffset) * vertexSize,
+                                       (GLintptr)next * _vertexCapacity * vertexSize, (GLsizeiptr)_vertexCount * vertexSize) );
+    }
+    if (_indexed && _indexCount > 0)
+    {
+        GL_ASSERT( glBindBuffer(GL_COPY_READ_BUFFER, _stream->indexBuffer) );
+        GL_ASSERT( glBindBuffer(GL_COPY_WRITE_BUFFER, _stream->indexBuffer) );
+        GL_ASSERT( glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)(_stream->segment * _indexCapacity + _stream->indexOffset) * sizeof(unsigned short),
+                                       (GLintptr)next * _indexCapacity * sizeof(unsigned short), (GLsizeiptr)_indexCount * sizeof(unsigned short)) );
+    }
+    GL_ASSERT( glBindBuffer(GL_COPY_READ_BUFFER, 0) );
+    GL_ASSERT( glBindBuffer(GL_COPY_WRITE_BUFFER, 0) );
+
+    // The fence follows the copy, since the copy reads from the segment that is left.
+    GL_ASSERT( _stream->fences[_stream->segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) );
+    _stream->segment = next;
+    _stream->vertexOffset = 0;
+    _stream->indexOffset = 0;
+#endif
+}
+
+void MeshBatch::releaseStream()
+{
+    if (!_stream)
+        return;
+
+    unmapStream();
+#ifdef GP_USE_BUFFER_STREAMING
+    for (unsigned int i = 0; i < MESH_BATCH_STREAM_SEGMENTS; ++i)
+    {
+        if (_stream->fences[i])
+        {
+            GL_ASSERT( glDeleteSync(_stream->fences[i]) );
+        }
+    }
+#endif
+    if (_stream->vertexBuffer)
+        RenderState::deleteBuffer(_stream->vertexBuffer);
+    if (_stream->indexBuffer)
+        RenderState::deleteBuffer(_stream->indexBuffer);
+    SAFE_DELETE(_stream);
+}
 
 }
@@ -93,6 +93,24 @@ public:
     template <class T>
     void add(const T* vertices, unsigned int vertexCount, const unsigned short* indices = NULL, unsigned int indexCount = 0);
 
+    /**
+     * Adds a group of primitives with 32-bit indices to the batch.
+     *
+     * Batches keep 16-bit indices while their capacity has at most 65536 vertices. Beyond that,
+     * batches that keep their primitives in client-side arrays widen their indices to 32 bits,
+     * which requires 32-bit index support on OpenGL ES 2.0, and streaming batches are split into
+     * ranges of up to 65536 vertices that are drawn with a draw call each. A single group of
+     * primitives can't have more than 65536 vertices in a streaming batch.
+     *
+     * @param vertices Array of vertices.
+     * @param vertexCount Number of vertices.
+     * @param indices Array of indices into the vertex array.
+     * @param indexCount Number of indices.
+     * @script{ignore}
+     */
+    template <class T>
+    void add(const T* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount);
+
     /**
      * Adds a group of primitives to the batch.
      *
@@ -114,6 +132,18 @@ public:
      */
     void add(const float* vertices, unsigned int vertexCount, const unsigned short* indices = NULL, unsigned int indexCount = 0);
 
+    /**
+     * Adds a group of primitives with 32-bit indices to the batch.
+     *
+     * @param vertices Array of vertices.
+     * @param vertexCount Number of vertices.
+     * @param indices Array of indices into the vertex array.
+     * @param indexCount Number of indices.
+     * @see add(const T*, unsigned int, const unsigned int*, unsigned int)
+     * @script{ignore}
+     */
+    void add(const float* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount);
+
     /**
      * Starts batching.
      *
@@ -138,11 +168,76 @@ public:
 
     /**
      * Draws the primitives currently in batch.
+     *
+     * A streaming batch must be finished before it is drawn.
      */
     void draw();
 
+    /**
+     * Sets whether the primitives of the batch are written straight into mapped GPU buffers.
+     *
+     * A streaming batch keeps its vertices and indices in buffers that are split into three
+     * segments, which the batch fills in turn. add() then copies the primitives into mapped
+     * buffer memory instead of client-side arrays, and a fence keeps each segment from being
+     * written again before the GPU has finished drawing from it, so drawing neither copies
+     * the primitives again nor waits for the GPU. The buffers are mapped persistently when
+     * the driver supports it.
+     *
+     * The primitives currently in the batch are cleared. This method should not be called
+     * between start() and finish().
+     *
+     * @param streaming true to stream the primitives, false to keep them in client-side arrays.
+     *
+     * @return true if the batch streams its primitives from now on, false otherwise.
+     * @see isStreamingSupported
+     * @script{ignore}
+     */
+    bool setStreaming(bool streaming);
+
+    /**
+     * Determines whether the primitives of the batch are written straight into mapped GPU buffers.
+     *
+     * @return true if the batch streams its primitives, false otherwise.
+     * @script{ignore}
+     */
+    bool isStreaming() const;
+
+    /**
+     * Determines whether the graphics driver supports streaming batches, which requires mapped
+     * buffer ranges, fences and drawing with a base vertex.
+     *
+     * @return true if streaming is supported, false otherwise.
+     * @script{ignore}
+     */
+    static bool isStreamingSupported();
+
+    /**
+     * Sets whether the batches that are created from now on stream their primitives.
+     *
+     * This also applies to the batches that sprite batches and fonts create. It can be set in
+     * the 'graphics' section of the game.config file with 'batchStreaming = true'.
+     *
+     * @param streaming true to stream the primitives of new batches when supported.
+     * @script{ignore}
+     */
+    static void setDefaultStreaming(bool streaming);
+
 private:
 
+    /**
+     * The buffers of a streaming batch.
+     */
+    struct Stream;
+
+    /**
+     * A range of the indices of a streaming batch, which are relative to the first vertex of the range.
+     */
+    struct Range
+    {
+        unsigned int indexStart;
+        unsigned int vertexStart;
+    };
+
     /**
      * Constructor.
      */
@@ -158,12 +253,24 @@ private:
      */
     MeshBatch& operator=(const MeshBatch&);
 
-    void add(const void* vertices, size_t size, unsigned int vertexCount, const unsigned short* indices, unsigned int indexCount);
+    void add(const void* vertices, size_t size, unsigned int vertexCount, const void* indices, Mesh::IndexFormat indexFormat, unsigned int indexCount);
+
+    unsigned int getIndexSize() const;
 
     void updateVertexAttributeBinding();
 
     bool resize(unsigned int capacity);
 
+    bool resizeStream(unsigned int vertexCapacity, unsigned int indexCapacity);
+
+    void mapStream();
+
+    void unmapStream();
+
+    void nextStreamSegment();
+
+    void releaseStream();
+
     const VertexFormat _vertexFormat;
     Mesh::PrimitiveType _primitiveType;
     Material* _material;
@@ -176,9 +283,13 @@ private:
     unsigned int _indexCount;
     unsigned char* _vertices;
     unsigned char* _verticesPtr;
-    unsigned short* _indices;
-    unsigned short* _indicesPtr;
+    Mesh::IndexFormat _indexFormat;
+    unsigned char* _indices;
+    unsigned char* _indicesPtr;
+    unsigned int _lastIndex;
+    std::vector<Range> _ranges;
     bool _started;
+    Stream* _stream;
 
 };
 
@@ -12,7 +12,14 @@ template <class T>
 void MeshBatch::add(const T* vertices, unsigned int vertexCount, const unsigned short* indices, unsigned int indexCount)
 {
     GP_ASSERT(sizeof(T) == _vertexFormat.getVertexSize());
-    add(vertices, sizeof(T), vertexCount, indices, indexCount);
+    add(vertices, sizeof(T), vertexCount, indices, Mesh::INDEX16, indexCount);
+}
+
+template <class T>
+void MeshBatch::add(const T* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount)
+{
+    GP_ASSERT(sizeof(T) == _vertexFormat.getVertexSize());
+    add(vertices, sizeof(T), vertexCount, indices, Mesh::INDEX32, indexCount);
 }
 
 }
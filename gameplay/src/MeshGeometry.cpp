@@ -0,0 +1,455 @@
+#include "Base.h"
+#include "MeshGeometry.h"
+#include "MemoryStats.h"
+#include "SimdMath.h"
+
+// The largest depth of the bounding volume hierarchy of the triangles, which a median split
+// reaches for 2^30 triangles
+#define MESHGEOMETRY_BVH_MAX_DEPTH 64
+
+namespace gameplay
+{
+
+// The geometries in memory, by the URL of their mesh. They are not referenced by the map, and
+// remove themselves from it when they are destroyed.
+static std::map<std::string, MeshGeometry*> __geometries;
+static bool __retained = false;
+
+// Returns the size of an index in bytes, or 0 if the format is not supported.
+static unsigned int getIndexSize(Mesh::IndexFormat indexFormat)
+{
+    switch (indexFormat)
+    {
+    case Mesh::INDEX8:
+        return 1;
+    case Mesh::INDEX16:
+        return 2;
+    case Mesh::INDEX32:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+MeshGeometry::MeshGeometry()
+    : _vertexCount(0), _positions(NULL), _primitiveType(Mesh::TRIANGLES), _bvhBuilt(false)
+{
+}
+
+MeshGeometry::~MeshGeometry()
+{
+    std::map<std::string, MeshGeometry*>::iterator itr = __geometries.find(_url);
+    if (itr != __geometries.end() && itr->second == this)
+        __geometries.erase(itr);
+
+    MemoryStats::remove(MemoryStats::MESHES, getMemoryUsage());
+    SAFE_DELETE_ARRAY(_positions);
+    for (size_t i = 0, count = _parts.size(); i < count; ++i)
+        SAFE_DELETE_ARRAY(_parts[i].indexData);
+}
+
+MeshGeometry* MeshGeometry::get(const char* url)
+{
+    GP_ASSERT(url);
+
+    std::map<std::string, MeshGeometry*>::iterator itr = __geometries.find(url);
+    if (itr != __geometries.end())
+    {
+        itr->second->addRef();
+        return itr->second;
+    }
+
+    Bundle::MeshData* data = Bundle::readMeshData(url);
+    if (data == NULL)
+    {
+        GP_WARN("Failed to read the geometry of mesh '%s'.", url);
+        return NULL;
+    }
+    MeshGeometry* geometry = create(url, data);
+    SAFE_DELETE(data);
+    return geometry;
+}
+
+MeshGeometry* MeshGeometry::create(const char* url, const Bundle::MeshData* data)
+{
+    GP_ASSERT(url);
+    GP_ASSERT(data);
+
+    std::map<std::string, MeshGeometry*>::iterator itr = __geometries.find(url);
+    if (itr != __geometries.end())
+    {
+        itr->second->addRef();
+        return itr->second;
+    }
+
+    MeshGeometry* geometry = new MeshGeometry();
+    geometry->_url = url;
+    geometry->_vertexCount = data->vertexCount;
+    geometry->_primitiveType = data->primitiveType;
+    geometry->_boundingBox = data->boundingBox;
+
+    // Quantized positions are decoded the same way as shaders decode them.
+    geometry->_positions = new float[data->vertexCount * 3];
+    unsigned int vertexStride = data->vertexFormat.getVertexSize();
+    const VertexFormat::Element& position = data->vertexFormat.getElement(0);
+    for (unsigned int i = 0; i < data->vertexCount; ++i)
+    {
+        float values[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+        position.decode(&data->vertexData[i * vertexStride], values);
+        geometry->_positions[i * 3] = values[0] * data->positionDecodeScale.x + data->positionDecodeOffset.x;
+        geometry->_positions[i * 3 + 1] = values[1] * data->positionDecodeScale.y + data->positionDecodeOffset.y;
+        geometry->_positions[i * 3 + 2] = values[2] * data->positionDecodeScale.z + data->positionDecodeOffset.z;
+    }
+
+    for (size_t i = 0, count = data->parts.size(); i < count; ++i)
+    {
+        const Bundle::MeshPartData* partData = data->parts[i];
+        GP_ASSERT(partData);
+
+        Part part;
+        part.primitiveType = partData->primitiveType;
+        part.indexFormat = partData->indexFormat;
+        part.indexCount = partData->indexCount;
+        size_t size = (size_t)partData->indexCount * getIndexSize(partData->indexFormat);
+        part.indexData = new unsigned char[size];
+        memcpy(part.indexData, partData->indexData, size);
+        geometry->_parts.push_back(part);
+    }
+
+    MemoryStats::add(MemoryStats::MESHES, geometry->getMemoryUsage());
+    __geometries[geometry->_url] = geometry;
+    return geometry;
+}
+
+void MeshGeometry::setRetained(bool retained)
+{
+    __retained = retained;
+}
+
+bool MeshGeometry::isRetained()
+{
+    return __retained;
+}
+
+const char* MeshGeometry::getUrl() const
+{
+    return _url.c_str();
+}
+
+unsigned int MeshGeometry::getVertexCount() const
+{
+    return _vertexCount;
+}
+
+const float* MeshGeometry::getPositions() const
+{
+    return _positions;
+}
+
+Mesh::PrimitiveType MeshGeometry::getPrimitiveType() const
+{
+    return _primitiveType;
+}
+
+const BoundingBox& MeshGeometry::getBoundingBox() const
+{
+    return _boundingBox;
+}
+
+unsigned int MeshGeometry::getPartCount() const
+{
+    return (unsigned int)_parts.size();
+}
+
+Mesh::PrimitiveType MeshGeometry::getPartPrimitiveType(unsigned int part) const
+{
+    GP_ASSERT(part < _parts.size());
+    return _parts[part].primitiveType;
+}
+
+Mesh::IndexFormat MeshGeometry::getPartIndexFormat(unsigned int part) const
+{
+    GP_ASSERT(part < _parts.size());
+    return _parts[part].indexFormat;
+}
+
+unsigned int MeshGeometry::getPartIndexCount(unsigned int part) const
+{
+    GP_ASSERT(part < _parts.size());
+    return _parts[part].indexCount;
+}
+
+const void* MeshGeometry::getPartIndexData(unsigned int part) const
+{
+    GP_ASSERT(part < _parts.size());
+    return _parts[part].indexData;
+}
+
+size_t MeshGeometry::getMemoryUsage() const
+{
+    size_t size = sizeof(MeshGeometry) + (size_t)_vertexCount * 3 * sizeof(float);
+    for (size_t i = 0, count = _parts.size(); i < count; ++i)
+        size += (size_t)_parts[i].indexCount * getIndexSize(_parts[i].indexFormat);
+    size += _bvhNodes.size() * sizeof(BvhNode) + _bvhPackets.size() * sizeof(BvhPacket);
+    return size;
+}
+
+// Returns the index of a vertex of a part, in the index format of the part.
+static unsigned int getIndex(Mesh::IndexFormat indexFormat, const unsigned char* indexData, unsigned int i)
+{
+    switch (indexFormat)
+    {
+    case Mesh::INDEX8:
+        return indexData[i];
+    case Mesh::INDEX16:
+        return ((const unsigned short*)indexData)[i];
+    default:
+        return ((const unsigned int*)indexData)[i];
+    }
+}
+
+void MeshGeometry::buildBvh() const
+{
+    _bvhBuilt = true;
+
+    // The vertex indices of the triangles, in the order that they are numbered.
+    std::vector<unsigned int> indices;
+    if (_parts.empty() && _primitiveType == Mesh::TRIANGLES)
+    {
+        indices.resize(_vertexCount - _vertexCount % 3);
+        for (size_t i = 0; i < indices.size(); ++i)
+            indices[i] = (unsigned int)i;
+    }
+    for (size_t i = 0, count = _parts.size(); i < count; ++i)
+    {
+        const Part& part = _parts[i];
+        if (part.primitiveType != Mesh::TRIANGLES)
+            continue;
+        for (unsigned int j = 0, indexCount = part.indexCount - part.indexCount % 3; j < indexCount; ++j)
+        {
+            unsigned int index = getIndex(part.indexFormat, part.indexData, j);
+            indices.push_back(index < _vertexCount ? index : 0);
+        }
+    }
+    unsigned int triangleCount = (unsigned int)indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    std::vector<unsigned int> triangles(triangleCount);
+    std::vector<Vector3> centers(triangleCount);
+    for (unsigned int i = 0; i < triangleCount; ++i)
+    {
+        triangles[i] = i;
+        const float* a = &_positions[indices[i * 3] * 3];
+        const float* b = &_positions[indices[i * 3 + 1] * 3];
+        const float* c = &_positions[indices[i * 3 + 2] * 3];
+        centers[i].set((a[0] + b[0] + c[0]) / 3.0f, (a[1] + b[1] + c[1]) / 3.0f, (a[2] + b[2] + c[2]) / 3.0f);
+    }
+
+    _bvhNodes.reserve(triangleCount / 2 + 1);
+    _bvhPackets.reserve(triangleCount / 4 + 1);
+    buildBvhNode(triangles, centers, 0, triangleCount, indices);
+    MemoryStats::add(MemoryStats::MESHES, _bvhNodes.size() * sizeof(BvhNode) + _bvhPackets.size() * sizeof(BvhPacket));
+}
+
+int MeshGeometry::buildBvhNode(std::vector<unsigned int>& triangles, const std::vector<Vector3>& centers,
+                               size_t begin, size_t end, const std::vector<unsigned int>& indices) const
+{
+    GP_ASSERT(begin < end);
+
+    int index = (int)_bvhNodes.size();
+    _bvhNodes.push_back(BvhNode());
+
+    float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    Vector3 centerMin(FLT_MAX, FLT_MAX, FLT_MAX);
+    Vector3 centerMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (size_t i = begin; i < end; ++i)
+    {
+        for (unsigned int j = 0; j < 3; ++j)
+        {
+            const float* v = &_positions[indices[triangles[i] * 3 + j] * 3];
+            for (unsigned int k = 0; k < 3; ++k)
+            {
+                min[k] = std::min(min[k], v[k]);
+                max[k] = std::max(max[k], v[k]);
+            }
+        }
+        const Vector3& center = centers[triangles[i]];
+        centerMin.set(std::min(centerMin.x, center.x), std::min(centerMin.y, center.y), std::min(centerMin.z, center.z));
+        centerMax.set(std::max(centerMax.x, center.x), std::max(centerMax.y, center.y), std::max(centerMax.z, center.z));
+    }
+
+    int child = -1;
+    int packet = -1;
+    if (end - begin <= 4)
+    {
+        // Store the triangles of the leaf as a packet, with the unused slots left degenerate.
+        packet = (int)_bvhPackets.size();
+        _bvhPackets.push_back(BvhPacket());
+        BvhPacket& p = _bvhPackets.back();
+        memset(&p, 0, sizeof(BvhPacket));
+        for (size_t i = begin; i < end; ++i)
+        {
+            unsigned int lane = (unsigned int)(i - begin);
+            unsigned int triangle = triangles[i];
+            const float* a = &_positions[indices[triangle * 3] * 3];
+            const float* b = &_positions[indices[triangle * 3 + 1] * 3];
+            const float* c = &_positions[indices[triangle * 3 + 2] * 3];
+            for (unsigned int k = 0; k < 3; ++k)
+            {
+                p.v0[k][lane] = a[k];
+                p.e1[k][lane] = b[k] - a[k];
+                p.e2[k][lane] = c[k] - a[k];
+            }
+            p.triangles[lane] = triangle;
+        }
+    }
+    else
+    {
+        // Split the triangles at the median of their centers along the longest axis of the centers.
+        Vector3 extent = centerMax - centerMin;
+        int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+        size_t middle = (begin + end) / 2;
+        std::nth_element(triangles.begin() + begin, triangles.begin() + middle, triangles.begin() + end,
+            [&](unsigned int a, unsigned int b) { return (&centers[a].x)[axis] < (&centers[b].x)[axis]; });
+
+        // The first child follows its parent, and the parent refers to the second.
+        buildBvhNode(triangles, centers, begin, middle, indices);
+        child = buildBvhNode(triangles, centers, middle, end, indices);
+    }
+
+    BvhNode& node = _bvhNodes[index];
+    memcpy(node.min, min, sizeof(min));
+    memcpy(node.max, max, sizeof(max));
+    node.child = child;
+    node.packet = packet;
+    return index;
+}
+
+// Returns the distance at which a ray enters a box, or -1 if it misses the box within the distance.
+static float intersectBox(const float* min, const float* max, const Vector3& origin, const Vector3& inverseDirection, float maxDistance)
+{
+    float tx1 = (min[0] - origin.x) * inverseDirection.x;
+    float tx2 = (max[0] - origin.x) * inverseDirection.x;
+    float tmin = std::min(tx1, tx2);
+    float tmax = std::max(tx1, tx2);
+    float ty1 = (min[1] - origin.y) * inverseDirection.y;
+    float ty2 = (max[1] - origin.y) * inverseDirection.y;
+    tmin = std::max(tmin, std::min(ty1, ty2));
+    tmax = std::min(tmax, std::max(ty1, ty2));
+    float tz1 = (min[2] - origin.z) * inverseDirection.z;
+    float tz2 = (max[2] - origin.z) * inverseDirection.z;
+    tmin = std::max(tmin, std::min(tz1, tz2));
+    tmax = std::min(tmax, std::max(tz1, tz2));
+    if (tmax < std::max(tmin, 0.0f) || tmin > maxDistance)
+        return -1.0f;
+    return std::max(tmin, 0.0f);
+}
+
+bool MeshGeometry::intersects(const Vector3& origin, const Vector3& direction, float maxDistance, float* distance,
+                              unsigned int* triangle, Vector3* normal) const
+{
+    GP_ASSERT(distance);
+
+    if (!_bvhBuilt)
+        buildBvh();
+    if (_bvhNodes.empty())
+        return false;
+
+    Vector3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+    float best = maxDistance;
+    int bestPacket = -1;
+    unsigned int bestLane = 0;
+
+#ifdef GP_USE_SIMD
+    Float4 dx = splat4(direction.x), dy = splat4(direction.y), dz = splat4(direction.z);
+    Float4 ox = splat4(origin.x), oy = splat4(origin.y), oz = splat4(origin.z);
+#endif
+
+    int stack[MESHGEOMETRY_BVH_MAX_DEPTH];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0)
+    {
+        const BvhNode& node = _bvhNodes[stack[--stackSize]];
+        if (intersectBox(node.min, node.max, origin, inverseDirection, best) < 0.0f)
+            continue;
+
+        if (node.packet < 0)
+        {
+            GP_ASSERT(stackSize + 2 <= MESHGEOMETRY_BVH_MAX_DEPTH);
+            int first = (int)(&node - &_bvhNodes[0]) + 1;
+            stack[stackSize++] = node.child;
+            stack[stackSize++] = first;
+            continue;
+        }
+
+        // Test the ray against the four triangles of the packet (Moller-Trumbore), leaving the
+        // divisions and comparisons of the lanes that are not degenerate to scalar code.
+        const BvhPacket& p = _bvhPackets[node.packet];
+        float det[4], u[4], v[4], t[4];
+#ifdef GP_USE_SIMD
+        Float4 e1x = load4(p.e1[0]), e1y = load4(p.e1[1]), e1z = load4(p.e1[2]);
+        Float4 e2x = load4(p.e2[0]), e2y = load4(p.e2[1]), e2z = load4(p.e2[2]);
+        Float4 px = sub4(mul4(dy, e2z), mul4(dz, e2y));
+        Float4 py = sub4(mul4(dz, e2x), mul4(dx, e2z));
+        Float4 pz = sub4(mul4(dx, e2y), mul4(dy, e2x));
+        Float4 tx = sub4(ox, load4(p.v0[0])), ty = sub4(oy, load4(p.v0[1])), tz = sub4(oz, load4(p.v0[2]));
+        Float4 qx = sub4(mul4(ty, e1z), mul4(tz, e1y));
+        Float4 qy = sub4(mul4(tz, e1x), mul4(tx, e1z));
+        Float4 qz = sub4(mul4(tx, e1y), mul4(ty, e1x));
+        store4(det, add4(add4(mul4(e1x, px), mul4(e1y, py)), mul4(e1z, pz)));
+        store4(u, add4(add4(mul4(tx, px), mul4(ty, py)), mul4(tz, pz)));
+        store4(v, add4(add4(mul4(dx, qx), mul4(dy, qy)), mul4(dz, qz)));
+        store4(t, add4(add4(mul4(e2x, qx), mul4(e2y, qy)), mul4(e2z, qz)));
+#else
+        for (unsigned int lane = 0; lane < 4; ++lane)
+        {
+            float px = direction.y * p.e2[2][lane] - direction.z * p.e2[1][lane];
+            float py = direction.z * p.e2[0][lane] - direction.x * p.e2[2][lane];
+            float pz = direction.x * p.e2[1][lane] - direction.y * p.e2[0][lane];
+            float tx = origin.x - p.v0[0][lane], ty = origin.y - p.v0[1][lane], tz = origin.z - p.v0[2][lane];
+            float qx = ty * p.e1[2][lane] - tz * p.e1[1][lane];
+            float qy = tz * p.e1[0][lane] - tx * p.e1[2][lane];
+            float qz = tx * p.e1[1][lane] - ty * p.e1[0][lane];
+            det[lane] = p.e1[0][lane] * px + p.e1[1][lane] * py + p.e1[2][lane] * pz;
+            u[lane] = tx * px + ty * py + tz * pz;
+            v[lane] = direction.x * qx + direction.y * qy + direction.z * qz;
+            t[lane] = p.e2[0][lane] * qx + p.e2[1][lane] * qy + p.e2[2][lane] * qz;
+        }
+#endif
+        for (unsigned int lane = 0; lane < 4; ++lane)
+        {
+            if (fabs(det[lane]) <= MATH_FLOAT_SMALL)
+                continue;
+            float inverseDet = 1.0f / det[lane];
+            float hitU = u[lane] * inverseDet;
+            float hitV = v[lane] * inverseDet;
+            float hitT = t[lane] * inverseDet;
+            if (hitU >= 0.0f && hitV >= 0.0f && hitU + hitV <= 1.0f && hitT >= 0.0f && hitT < best)
+            {
+                best = hitT;
+                bestPacket = node.packet;
+                bestLane = lane;
+            }
+        }
+    }
+
+    if (bestPacket < 0)
+        return false;
+
+    const BvhPacket& p = _bvhPackets[bestPacket];
+    *distance = best;
+    if (triangle)
+        *triangle = p.triangles[bestLane];
+    if (normal)
+    {
+        Vector3 e1(p.e1[0][bestLane], p.e1[1][bestLane], p.e1[2][bestLane]);
+        Vector3 e2(p.e2[0][bestLane], p.e2[1][bestLane], p.e2[2][bestLane]);
+        Vector3::cross(e1, e2, normal);
+    }
+    return true;
+}
+
+}
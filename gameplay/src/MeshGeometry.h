@@ -0,0 +1,260 @@
+#ifndef MESHGEOMETRY_H_
+#define MESHGEOMETRY_H_
+
+#include "Ref.h"
+#include "Mesh.h"
+#include "Bundle.h"
+
+namespace gameplay
+{
+
+/**
+ * Defines a copy of the geometry of a mesh in CPU memory, for the systems that need to read it
+ * after the mesh has been uploaded, like physics shapes and navigation meshes.
+ *
+ * The geometry holds the positions of the vertices, decoded to floats in the space of the mesh,
+ * and the indices of the parts of the mesh. The geometries are shared: there is at most one for
+ * each mesh URL at a time, which is kept for as long as it is referenced.
+ *
+ * When geometries are retained (see setRetained), they are filled while the meshes are loaded
+ * from their bundles and each Mesh keeps a reference to its own (see Mesh::getGeometry), so that
+ * nothing reads the bundle again. Otherwise, the first call to get for a URL reads the mesh from
+ * its bundle once, and later calls share that geometry while it is referenced. Geometries can be
+ * retained from the resources section of the game.config file:
+ *
+ * @code
+ * resources
+ * {
+ *     retainMeshGeometry = true
+ * }
+ * @endcode
+ *
+ * @script{ignore}
+ */
+class MeshGeometry : public Ref
+{
+    friend class Bundle;
+
+public:
+
+    /**
+     * Returns the geometry of the mesh with the specified URL, reading it from its bundle if it
+     * is not in memory.
+     *
+     * @param url The URL of the mesh, formatted as 'bundle#id' (see Mesh::getUrl).
+     *
+     * @return The geometry, which the caller must release, or NULL if the mesh could not be read.
+     */
+    static MeshGeometry* get(const char* url);
+
+    /**
+     * Sets whether the meshes that are loaded from bundles afterwards keep their geometry.
+     *
+     * @param retained true to keep the geometry of the loaded meshes, false otherwise (the default).
+     */
+    static void setRetained(bool retained);
+
+    /**
+     * Determines whether the meshes that are loaded from bundles keep their geometry.
+     *
+     * @return true if the geometry is retained, false otherwise.
+     */
+    static bool isRetained();
+
+    /**
+     * Returns the URL of the mesh that the geometry is of.
+     *
+     * @return The URL of the mesh.
+     */
+    const char* getUrl() const;
+
+    /**
+     * Returns the number of vertices.
+     *
+     * @return The number of vertices.
+     */
+    unsigned int getVertexCount() const;
+
+    /**
+     * Returns the positions of the vertices, as three floats for each vertex.
+     *
+     * @return The positions.
+     */
+    const float* getPositions() const;
+
+    /**
+     * Returns the primitive type of the vertices when the mesh has no parts.
+     *
+     * @return The primitive type.
+     */
+    Mesh::PrimitiveType getPrimitiveType() const;
+
+    /**
+     * Returns the bounds of the vertices.
+     *
+     * @return The bounding box.
+     */
+    const BoundingBox& getBoundingBox() const;
+
+    /**
+     * Returns the number of parts.
+     *
+     * @return The number of parts, which is 0 if the vertices are not indexed.
+     */
+    unsigned int getPartCount() const;
+
+    /**
+     * Returns the primitive type of a part.
+     *
+     * @param part The index of the part.
+     *
+     * @return The primitive type of the part.
+     */
+    Mesh::PrimitiveType getPartPrimitiveType(unsigned int part) const;
+
+    /**
+     * Returns the format of the indices of a part.
+     *
+     * @param part The index of the part.
+     *
+     * @return The index format of the part.
+     */
+    Mesh::IndexFormat getPartIndexFormat(unsigned int part) const;
+
+    /**
+     * Returns the number of indices of a part.
+     *
+     * @param part The index of the part.
+     *
+     * @return The number of indices of the part.
+     */
+    unsigned int getPartIndexCount(unsigned int part) const;
+
+    /**
+     * Returns the indices of a part, in the index format of the part.
+     *
+     * @param part The index of the part.
+     *
+     * @return The indices of the part.
+     */
+    const void* getPartIndexData(unsigned int part) const;
+
+    /**
+     * Finds the nearest triangle of the geometry that a ray hits.
+     *
+     * The triangles of the parts that are triangle lists are tested, through a bounding volume
+     * hierarchy that is built the first time a ray is tested. Both sides of the triangles are hit.
+     *
+     * @param origin The origin of the ray, in the space of the mesh.
+     * @param direction The direction of the ray, in the space of the mesh, which does not need to
+     *      be normalized.
+     * @param maxDistance The largest distance to hit a triangle at, as a multiple of the direction.
+     * @param distance Populated with the distance of the hit, as a multiple of the direction.
+     * @param triangle If not NULL, populated with the index of the triangle that is hit, counting the
+     *      triangles of the parts in order.
+     * @param normal If not NULL, populated with the normal of the triangle that is hit, in the space of
+     *      the mesh, which is not normalized.
+     *
+     * @return true if a triangle is hit, false otherwise.
+     */
+    bool intersects(const Vector3& origin, const Vector3& direction, float maxDistance, float* distance,
+                    unsigned int* triangle = NULL, Vector3* normal = NULL) const;
+
+    /**
+     * Returns the memory that the geometry uses.
+     *
+     * @return The number of bytes used by the positions, the indices and the bounding volume hierarchy.
+     */
+    size_t getMemoryUsage() const;
+
+private:
+
+    /**
+     * The indices of a part.
+     */
+    struct Part
+    {
+        Mesh::PrimitiveType primitiveType;
+        Mesh::IndexFormat indexFormat;
+        unsigned int indexCount;
+        unsigned char* indexData;
+    };
+
+    /**
+     * A node of the bounding volume hierarchy of the triangles. Leaves have a packet of triangles.
+     */
+    struct BvhNode
+    {
+        float min[3];
+        float max[3];
+        int child;
+        int packet;
+    };
+
+    /**
+     * Four triangles of a leaf, with each coordinate of their first vertex and edges stored
+     * together so that a ray is tested against them at once. Unused slots are degenerate.
+     */
+    struct BvhPacket
+    {
+        float v0[3][4];
+        float e1[3][4];
+        float e2[3][4];
+        unsigned int triangles[4];
+    };
+
+    /**
+     * Constructor.
+     */
+    MeshGeometry();
+
+    /**
+     * Destructor.
+     */
+    ~MeshGeometry();
+
+    /**
+     * Hidden copy constructor.
+     */
+    MeshGeometry(const MeshGeometry& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    MeshGeometry& operator=(const MeshGeometry&);
+
+    /**
+     * Returns the shared geometry of a URL, creating it from the data of the mesh if there is none.
+     *
+     * @param url The URL of the mesh.
+     * @param data The data of the mesh, which may point into a mapped bundle file, since it is copied.
+     *
+     * @return The geometry, which the caller must release.
+     */
+    static MeshGeometry* create(const char* url, const Bundle::MeshData* data);
+
+    /**
+     * Builds the bounding volume hierarchy of the triangles.
+     */
+    void buildBvh() const;
+
+    /**
+     * Builds the node of the hierarchy for a range of the triangles and returns its index.
+     */
+    int buildBvhNode(std::vector<unsigned int>& triangles, const std::vector<Vector3>& centers,
+                     size_t begin, size_t end, const std::vector<unsigned int>& indices) const;
+
+    std::string _url;
+    unsigned int _vertexCount;
+    float* _positions;
+    Mesh::PrimitiveType _primitiveType;
+    BoundingBox _boundingBox;
+    std::vector<Part> _parts;
+    mutable bool _bvhBuilt;
+    mutable std::vector<BvhNode> _bvhNodes;
+    mutable std::vector<BvhPacket> _bvhPackets;
+};
+
+}
+
+#endif
@@ -1,11 +1,33 @@
 #include "Base.h"
 #include "MeshPart.h"
+#include "RenderStats.h"
+#include "RenderState.h"
+#include "MemoryStats.h"
+#include "BufferAllocator.h"
+#include "Platform.h"
 
 namespace gameplay
 {
 
+// Returns the size of an index in bytes, or 0 if the format is not supported.
+static unsigned int getIndexSize(Mesh::IndexFormat indexFormat)
+{
+    switch (indexFormat)
+    {
+    case Mesh::INDEX8:
+        return 1;
+    case Mesh::INDEX16:
+        return 2;
+    case Mesh::INDEX32:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
 MeshPart::MeshPart() :
-    _mesh(NULL), _meshIndex(0), _primitiveType(Mesh::TRIANGLES), _indexCount(0), _indexBuffer(0), _dynamic(false)
+    _mesh(NULL), _meshIndex(0), _primitiveType(Mesh::TRIANGLES), _indexCount(0), _indexBuffer(0), _indexOffset(0),
+    _sharedBuffer(false), _dynamic(false)
 {
 }
 
@@ -13,37 +35,51 @@ MeshPart::~MeshPart()
 {
     if (_indexBuffer)
     {
-        glDeleteBuffers(1, &_indexBuffer);
+        if (_sharedBuffer)
+        {
+            BufferAllocator::Allocation allocation;
+            allocation.buffer = _indexBuffer;
+            allocation.offset = _indexOffset;
+            allocation.size = getIndexSize(_indexFormat) * _indexCount;
+            BufferAllocator::free(&allocation);
+        }
+        else
+        {
+            RenderState::deleteBuffer(_indexBuffer);
+        }
+        if (!_mesh->_streamed)
+            MemoryStats::remove(MemoryStats::MESHES, getIndexSize(_indexFormat) * _indexCount);
     }
 }
 
 MeshPart* MeshPart::create(Mesh* mesh, unsigned int meshIndex, Mesh::PrimitiveType primitiveType,
     Mesh::IndexFormat indexFormat, unsigned int indexCount, bool dynamic)
 {
-    // Create a VBO for our index buffer.
-    GLuint vbo;
-    GL_ASSERT( glGenBuffers(1, &vbo) );
-    GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo) );
-
-    unsigned int indexSize = 0;
-    switch (indexFormat)
+    unsigned int indexSize = getIndexSize(indexFormat);
+    if (indexSize == 0)
     {
-    case Mesh::INDEX8:
-        indexSize = 1;
-        break;
-    case Mesh::INDEX16:
-        indexSize = 2;
-        break;
-    case Mesh::INDEX32:
-        indexSize = 4;
-        break;
-    default:
         GP_ERROR("Unsupported index format (%d).", indexFormat);
-        glDeleteBuffers(1, &vbo);
         return NULL;
     }
 
-    GL_ASSERT( glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize * indexCount, NULL, dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW) );
+    // Static parts share the arenas of the buffer allocator when it is enabled. Headless
+    // platforms have no graphics context, so their parts have no index buffer. The parts of
+    // streamed meshes get their storage when the data of the mesh is loaded.
+    BufferAllocator::Allocation allocation;
+    bool headless = Platform::isHeadless();
+    bool streamed = mesh->_streamed;
+    bool shared = !headless && !dynamic && !streamed && BufferAllocator::isEnabled() &&
+        BufferAllocator::allocate(GL_ELEMENT_ARRAY_BUFFER, indexSize * indexCount, 4, &allocation);
+    if (!shared && !headless)
+    {
+        // Create a VBO for our index buffer.
+        GL_ASSERT( glGenBuffers(1, &allocation.buffer) );
+        if (!streamed)
+        {
+            RenderState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, allocation.buffer);
+            GL_ASSERT( glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize * indexCount, NULL, dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW) );
+        }
+    }
 
     MeshPart* part = new MeshPart();
     part->_mesh = mesh;
@@ -51,8 +87,12 @@ MeshPart* MeshPart::create(Mesh* mesh, unsigned int meshIndex, Mesh::PrimitiveTy
     part->_primitiveType = primitiveType;
     part->_indexFormat = indexFormat;
     part->_indexCount = indexCount;
-    part->_indexBuffer = vbo;
+    part->_indexBuffer = allocation.buffer;
+    part->_indexOffset = allocation.offset;
+    part->_sharedBuffer = shared;
     part->_dynamic = dynamic;
+    if (part->_indexBuffer && !streamed)
+        MemoryStats::add(MemoryStats::MESHES, indexSize * indexCount);
 
     return part;
 }
@@ -82,6 +122,11 @@ IndexBufferHandle MeshPart::getIndexBuffer() const
     return _indexBuffer;
 }
 
+unsigned int MeshPart::getIndexOffset() const
+{
+    return _indexOffset;
+}
+
 bool MeshPart::isDynamic() const
 {
     return _dynamic;
@@ -89,28 +134,22 @@ bool MeshPart::isDynamic() const
 
 void MeshPart::setIndexData(const void* indexData, unsigned int indexStart, unsigned int indexCount)
 {
-    GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer) );
+    if (!_indexBuffer)
+        return;
+
+    RenderState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
 
-    unsigned int indexSize = 0;
-    switch (_indexFormat)
+    unsigned int indexSize = getIndexSize(_indexFormat);
+    if (indexSize == 0)
     {
-    case Mesh::INDEX8:
-        indexSize = 1;
-        break;
-    case Mesh::INDEX16:
-        indexSize = 2;
-        break;
-    case Mesh::INDEX32:
-        indexSize = 4;
-        break;
-    default:
         GP_ERROR("Unsupported index format (%d).", _indexFormat);
         return;
     }
 
-    if (indexStart == 0 && indexCount == 0)
+    if (indexStart == 0 && indexCount == 0 && !_sharedBuffer)
     {
         GL_ASSERT( glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize * _indexCount, indexData, _dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW) );
+        RenderStats::countBufferUpload(indexSize * _indexCount);
     }
     else
     {
@@ -119,7 +158,58 @@ void MeshPart::setIndexData(const void* indexData, unsigned int indexStart, unsi
             indexCount = _indexCount - indexStart;
         }
 
-        GL_ASSERT( glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexStart * indexSize, indexCount * indexSize, indexData) );
+        GL_ASSERT( glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, _indexOffset + indexStart * indexSize, indexCount * indexSize, indexData) );
+        RenderStats::countBufferUpload(indexCount * indexSize);
+    }
+}
+
+bool MeshPart::getIndexData(void* indexData) const
+{
+#ifdef OPENGL_ES
+    GP_WARN("Reading back index data is not supported on OpenGL ES.");
+    return false;
+#else
+    // The buffer is read through GL_ARRAY_BUFFER, since binding it to GL_ELEMENT_ARRAY_BUFFER
+    // would change the index buffer of the vertex array object that is bound.
+    if (!_indexBuffer)
+        return false;
+
+    RenderState::bindBuffer(GL_ARRAY_BUFFER, _indexBuffer);
+    GL_ASSERT( glGetBufferSubData(GL_ARRAY_BUFFER, _indexOffset, getIndexSize(_indexFormat) * _indexCount, indexData) );
+    return true;
+#endif
+}
+
+unsigned int MeshPart::getClusterCount() const
+{
+    return (unsigned int)_clusters.size();
+}
+
+const MeshPart::Cluster& MeshPart::getCluster(unsigned int index) const
+{
+    GP_ASSERT(index < _clusters.size());
+    return _clusters[index];
+}
+
+void MeshPart::setClusters(const Cluster* clusters, unsigned int clusterCount)
+{
+    if (clusterCount > 0 && _primitiveType != Mesh::TRIANGLES)
+    {
+        GP_WARN("Only mesh parts that are lists of triangles can have clusters.");
+        return;
+    }
+
+    _clusters.clear();
+    for (unsigned int i = 0; i < clusterCount; ++i)
+    {
+        const Cluster& cluster = clusters[i];
+        if (cluster.indexStart + cluster.indexCount > _indexCount)
+        {
+            GP_WARN("Cluster %u is beyond the indices of the mesh part.", i);
+            _clusters.clear();
+            return;
+        }
+        _clusters.push_back(cluster);
     }
 }
 
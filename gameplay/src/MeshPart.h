@@ -14,9 +14,53 @@ class MeshPart
 {
     friend class Mesh;
     friend class Model;
+    friend class MeshStreamer;
 
 public:
 
+    /**
+     * Defines a cluster of the triangles of a part, which can be culled on its own.
+     *
+     * The triangles of a cluster are a range of the indices of the part. The sphere bounds the
+     * vertices of the triangles, and the cone bounds their normals: all of the triangles face
+     * away from a point when the direction from the center to the point is further than the
+     * cutoff (the sine of the angle of the cone) from the axis, as tested by Model.
+     *
+     * @script{ignore}
+     */
+    struct Cluster
+    {
+        /**
+         * The first index of the cluster.
+         */
+        unsigned int indexStart;
+
+        /**
+         * The number of indices of the cluster.
+         */
+        unsigned int indexCount;
+
+        /**
+         * The center of the sphere that bounds the cluster, in the space of the mesh.
+         */
+        Vector3 center;
+
+        /**
+         * The radius of the sphere that bounds the cluster.
+         */
+        float radius;
+
+        /**
+         * The axis of the cone of the normals of the cluster, or zero if it has no cone.
+         */
+        Vector3 coneAxis;
+
+        /**
+         * The sine of the angle of the cone of the normals of the cluster.
+         */
+        float coneCutoff;
+    };
+
     /**
      * Destructor.
      */
@@ -57,6 +101,18 @@ public:
      */
     IndexBufferHandle getIndexBuffer() const;
 
+    /**
+     * Returns the offset of the first index of the part in its index buffer, which the
+     * offsets of its draws start from.
+     *
+     * The offset is 0 unless the part shares its index buffer with other parts
+     * (see BufferAllocator).
+     *
+     * @return The offset, in bytes.
+     * @script{ignore}
+     */
+    unsigned int getIndexOffset() const;
+
     /**
      * Determines if the indices are dynamic.
      *
@@ -74,6 +130,47 @@ public:
      */
     void setIndexData(const void* indexData, unsigned int indexStart, unsigned int indexCount);
 
+    /**
+     * Reads the index data of the part back from its index buffer.
+     *
+     * Index buffers cannot be read back on OpenGL ES, where this fails.
+     *
+     * @param indexData The buffer to read the index data into, which must hold
+     *        getIndexCount() indices of the index format of the part.
+     *
+     * @return true if the index data was read, false otherwise.
+     * @script{ignore}
+     */
+    bool getIndexData(void* indexData) const;
+
+    /**
+     * Returns the number of clusters of the triangles of the part, which is zero if the
+     * part is not split into clusters.
+     *
+     * @return The number of clusters.
+     * @script{ignore}
+     */
+    unsigned int getClusterCount() const;
+
+    /**
+     * Returns a cluster of the triangles of the part.
+     *
+     * @param index The index of the cluster.
+     *
+     * @return The cluster.
+     * @script{ignore}
+     */
+    const Cluster& getCluster(unsigned int index) const;
+
+    /**
+     * Sets the clusters of the triangles of the part, which must be lists of triangles.
+     *
+     * @param clusters The clusters, in the order of their indices.
+     * @param clusterCount The number of clusters, or zero to remove the clusters.
+     * @script{ignore}
+     */
+    void setClusters(const Cluster* clusters, unsigned int clusterCount);
+
 private:
 
     /**
@@ -104,7 +201,10 @@ private:
     Mesh::IndexFormat _indexFormat;
     unsigned int _indexCount;
     IndexBufferHandle _indexBuffer;
+    unsigned int _indexOffset;
+    bool _sharedBuffer;
     bool _dynamic;
+    std::vector<Cluster> _clusters;
 };
 
 }
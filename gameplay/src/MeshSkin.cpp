@@ -1,24 +1,51 @@
 #include "Base.h"
 #include "MeshSkin.h"
+#include "GraphicsDevice.h"
 #include "Joint.h"
 #include "Model.h"
+#include "Scene.h"
+#include "Game.h"
+#include "SimdMath.h"
+#include "Mesh.h"
+#include "FileSystem.h"
 
 // The number of rows in each palette matrix.
 #define PALETTE_ROWS 3
 
+// The number of rows in each palette dual quaternion.
+#define DUAL_QUATERNION_ROWS 2
+
+// The shader that skins the vertices of pre-skinned meshes
+#define PRESKINNING_SHADER "res/shaders/skinning.vert"
+
+// The number of frames after which a skin passes its update interval on to its clips again
+#define MESHSKIN_LOD_RENEW_FRAMES 8
+
 namespace gameplay
 {
 
+// Spreads the updates of skins with the same update interval over different frames.
+static unsigned int __skinPhase = 0;
+
 MeshSkin::MeshSkin()
-    : _rootJoint(NULL), _rootNode(NULL), _matrixPalette(NULL), _model(NULL)
+    : _rootJoint(NULL), _rootNode(NULL), _matrixPalette(NULL), _model(NULL),
+      _layoutDirty(true), _paletteSource(NULL), _paletteForced(true), _paletteVersion(0), _boundsDirty(false),
+      _lodScreenSize(0.0f), _lodMaxInterval(0), _lodPhase(__skinPhase++), _updateInterval(1), _lodFrame(0),
+      _paletteFrame(0), _blendStartFrame(0), _paletteValid(false), _blendVersion(0), _lodPalette(NULL), _blendPalette(NULL),
+      _dualQuaternionPalette(NULL), _dualQuaternionSource(NULL), _dualQuaternionVersion(0),
+      _skinnedMesh(NULL), _feedbackProgram(NULL), _skinnedDualQuaternion(false), _skinnedSource(NULL), _skinnedVersion(0)
 {
 }
 
 MeshSkin::~MeshSkin()
 {
     clearJoints();
+    releasePreSkinning();
 
     SAFE_DELETE_ARRAY(_matrixPalette);
+    SAFE_DELETE_ARRAY(_lodPalette);
+    SAFE_DELETE_ARRAY(_blendPalette);
+    SAFE_DELETE_ARRAY(_dualQuaternionPalette);
 }
 
 const Matrix& MeshSkin::getBindShape() const
@@ -29,6 +56,7 @@ const Matrix& MeshSkin::getBindShape() const
 void MeshSkin::setBindShape(const float* matrix)
 {
     _bindShape.set(matrix);
+    invalidateLayout();
 }
 
 unsigned int MeshSkin::getJointCount() const
@@ -62,6 +90,9 @@ MeshSkin* MeshSkin::clone(NodeCloneContext &context) const
 {
     MeshSkin* skin = new MeshSkin();
     skin->_bindShape = _bindShape;
+    skin->_jointBounds = _jointBounds;
+    skin->_lodScreenSize = _lodScreenSize;
+    skin->_lodMaxInterval = _lodMaxInterval;
     if (_rootNode && _rootJoint)
     {
         const unsigned int jointCount = getJointCount();
@@ -80,14 +111,19 @@ MeshSkin* MeshSkin::clone(NodeCloneContext &context) const
             skin->_rootNode = _rootNode->cloneRecursive(context);
         }
         
-        Node* node = NULL;
-        if (strcmp(skin->_rootNode->getId(), _rootJoint->getId()) == 0)
-        {
-            node = skin->_rootNode;
-        }
-        else
+        // The joints were cloned with the root node, so they are found through the context
+        // rather than by searching the cloned hierarchy for each of their IDs.
+        Node* node = context.findClonedNode(_rootJoint);
+        if (node == NULL)
         {
-            node = skin->_rootNode->findNode(_rootJoint->getId());
+            if (strcmp(skin->_rootNode->getId(), _rootJoint->getId()) == 0)
+            {
+                node = skin->_rootNode;
+            }
+            else
+            {
+                node = skin->_rootNode->findNode(_rootJoint->getId());
+            }
         }
         GP_ASSERT(node);
         skin->_rootJoint = static_cast<Joint*>(node);
@@ -96,7 +132,9 @@ MeshSkin* MeshSkin::clone(NodeCloneContext &context) const
             Joint* oldJoint = getJoint(i);
             GP_ASSERT(oldJoint);
             
-            Joint* newJoint = static_cast<Joint*>(skin->_rootNode->findNode(oldJoint->getId()));
+            Joint* newJoint = static_cast<Joint*>(context.findClonedNode(oldJoint));
+            if (!newJoint)
+                newJoint = static_cast<Joint*>(skin->_rootNode->findNode(oldJoint->getId()));
             if (!newJoint)
             {
                 if (strcmp(skin->_rootJoint->getId(), oldJoint->getId()) == 0)
@@ -134,12 +172,29 @@ void MeshSkin::setJointCount(unsigned int jointCount)
             _matrixPalette[i+2].set(0.0f, 0.0f, 1.0f, 0.0f);
         }
     }
+
+    SAFE_DELETE_ARRAY(_lodPalette);
+    SAFE_DELETE_ARRAY(_blendPalette);
+    if (_lodScreenSize > 0.0f)
+        createBlendPalettes();
+
+    SAFE_DELETE_ARRAY(_dualQuaternionPalette);
+    _dualQuaternionSource = NULL;
+
+    // The pre-skinning program is built for the number of joints.
+    if (_skinnedMesh)
+    {
+        bool dualQuaternion = _skinnedDualQuaternion;
+        setPreSkinning(false);
+        setPreSkinning(true, dualQuaternion);
+    }
 }
 
 void MeshSkin::setJoint(Joint* joint, unsigned int index)
 {
     GP_ASSERT(index < _joints.size());
 
+    invalidateLayout();
     if (_joints[index])
     {
         _joints[index]->removeSkin(this);
@@ -153,18 +208,23 @@ void MeshSkin::setJoint(Joint* joint, unsigned int index)
         joint->addRef();
         joint->addSkin(this);
     }
+    invalidateLayout();
 }
 
 Vector4* MeshSkin::getMatrixPalette() const
 {
     GP_ASSERT(_matrixPalette);
 
-    for (size_t i = 0, count = _joints.size(); i < count; i++)
+    // Skins with the same joints and bind shape use the palette of the first of them.
+    const MeshSkin* source = getPaletteSource();
+    if (_lodPalette)
     {
-        GP_ASSERT(_joints[i]);
-        _joints[i]->updateJointMatrix(getBindShape(), &_matrixPalette[i * PALETTE_ROWS]);
+        updateBlendedPalette(source);
+        return _lodPalette;
     }
-    return _matrixPalette;
+
+    source->updateJointPalette();
+    return source->_matrixPalette;
 }
 
 unsigned int MeshSkin::getMatrixPaletteSize() const
@@ -172,11 +232,805 @@ unsigned int MeshSkin::getMatrixPaletteSize() const
     return (unsigned int)_joints.size() * PALETTE_ROWS;
 }
 
+// Converts a palette matrix of three rows to a unit dual quaternion of two rows, dropping any scale.
+static void toDualQuaternion(const Vector4* rows, Vector4* dst)
+{
+    Matrix matrix(rows[0].x, rows[0].y, rows[0].z, rows[0].w,
+                  rows[1].x, rows[1].y, rows[1].z, rows[1].w,
+                  rows[2].x, rows[2].y, rows[2].z, rows[2].w,
+                  0.0f, 0.0f, 0.0f, 1.0f);
+    Quaternion q;
+    if (!matrix.getRotation(&q))
+        q.setIdentity();
+
+    // Keep the rotations in the same hemisphere so that neighboring joints blend along the shortest path.
+    if (q.w < 0.0f)
+        q.set(-q.x, -q.y, -q.z, -q.w);
+
+    // The dual part is half the translation times the rotation.
+    float tx = rows[0].w;
+    float ty = rows[1].w;
+    float tz = rows[2].w;
+    dst[0].set(q.x, q.y, q.z, q.w);
+    dst[1].set(0.5f * (q.w * tx + ty * q.z - tz * q.y),
+               0.5f * (q.w * ty + tz * q.x - tx * q.z),
+               0.5f * (q.w * tz + tx * q.y - ty * q.x),
+               -0.5f * (tx * q.x + ty * q.y + tz * q.z));
+}
+
+Vector4* MeshSkin::getDualQuaternionPalette() const
+{
+    const Vector4* rows = getMatrixPalette();
+    GP_ASSERT(rows);
+
+    const MeshSkin* owner;
+    unsigned int version = getPaletteVersion(&owner);
+    if (_dualQuaternionPalette && owner == _dualQuaternionSource && version == _dualQuaternionVersion)
+        return _dualQuaternionPalette;
+    _dualQuaternionSource = owner;
+    _dualQuaternionVersion = version;
+
+    unsigned int jointCount = (unsigned int)_joints.size();
+    if (_dualQuaternionPalette == NULL)
+        _dualQuaternionPalette = new Vector4[jointCount * DUAL_QUATERNION_ROWS];
+    for (unsigned int i = 0; i < jointCount; ++i)
+    {
+        toDualQuaternion(&rows[i * PALETTE_ROWS], &_dualQuaternionPalette[i * DUAL_QUATERNION_ROWS]);
+    }
+    return _dualQuaternionPalette;
+}
+
+unsigned int MeshSkin::getDualQuaternionPaletteSize() const
+{
+    return (unsigned int)_joints.size() * DUAL_QUATERNION_ROWS;
+}
+
+unsigned int MeshSkin::getPaletteVersion(const MeshSkin** owner) const
+{
+    GP_ASSERT(owner);
+
+    // The blended palette changes every frame while the skin is blending between updates;
+    // otherwise the palette changes along with the version of the skin that computes it.
+    if (_lodPalette)
+    {
+        *owner = this;
+        return _paletteFrame;
+    }
+    *owner = getPaletteSource();
+    return (*owner)->_paletteVersion;
+}
+
 Model* MeshSkin::getModel() const
 {
     return _model;
 }
 
+void MeshSkin::setAnimationLod(float screenSize, unsigned int maxUpdateInterval)
+{
+    _lodScreenSize = screenSize > 0.0f && maxUpdateInterval > 1 ? screenSize : 0.0f;
+    _lodMaxInterval = maxUpdateInterval;
+    _updateInterval = 1;
+
+    SAFE_DELETE_ARRAY(_lodPalette);
+    SAFE_DELETE_ARRAY(_blendPalette);
+    _dualQuaternionSource = NULL;
+    _skinnedSource = NULL;
+    if (_lodScreenSize > 0.0f)
+    {
+        createBlendPalettes();
+    }
+    else
+    {
+        // Return the animated joints to their own update rates.
+        for (size_t i = 0, count = _joints.size(); i < count; ++i)
+        {
+            if (_joints[i])
+                _joints[i]->setLodUpdateInterval(1, 0, 0, 0);
+        }
+    }
+}
+
+float MeshSkin::getAnimationLodScreenSize() const
+{
+    return _lodScreenSize;
+}
+
+unsigned int MeshSkin::getAnimationLodMaxInterval() const
+{
+    return _lodMaxInterval;
+}
+
+unsigned int MeshSkin::getUpdateInterval() const
+{
+    return _updateInterval;
+}
+
+void MeshSkin::createBlendPalettes()
+{
+    size_t size = _joints.size() * PALETTE_ROWS;
+    if (size == 0)
+        return;
+
+    _lodPalette = new Vector4[size];
+    _blendPalette = new Vector4[size];
+    _paletteValid = false;
+}
+
+void MeshSkin::invalidateLayout()
+{
+    _layoutDirty = true;
+
+    // Skins that share a palette have the same joints, so they are all referenced by the first joint.
+    if (!_joints.empty() && _joints[0])
+    {
+        for (Joint::SkinReference* ref = &_joints[0]->_skin; ref && ref->skin; ref = ref->next)
+        {
+            ref->skin->_layoutDirty = true;
+        }
+    }
+}
+
+void MeshSkin::updateLayout() const
+{
+    _layoutDirty = false;
+    _paletteSource = NULL;
+
+    size_t count = _joints.size();
+    if (count == 0)
+        return;
+
+    // Move the joint bounds into the space of their joints, so that posing them only takes the world matrices of the joints.
+    _localJointBounds.resize(_jointBounds.size() == count ? count : 0);
+    for (size_t i = 0, boundsCount = _localJointBounds.size(); i < boundsCount; ++i)
+    {
+        _localJointBounds[i] = _jointBounds[i];
+        if (_joints[i] && _jointBounds[i].radius > 0.0f)
+        {
+            Matrix bind;
+            Matrix::multiplyAffine(_joints[i]->getInverseBindPose(), _bindShape, &bind);
+            _localJointBounds[i].transform(bind);
+        }
+    }
+
+    // The first skin referenced by the first joint that has the same joints and bind shape
+    // computes the palette for all of them.
+    if (_joints[0])
+    {
+        for (const Joint::SkinReference* ref = &_joints[0]->_skin; ref && ref->skin; ref = ref->next)
+        {
+            const MeshSkin* skin = ref->skin;
+            if (skin == this)
+                break;
+            if (skin->_joints == _joints && memcmp(skin->_bindShape.m, _bindShape.m, sizeof(_bindShape.m)) == 0)
+            {
+                _paletteSource = skin;
+                return;
+            }
+        }
+    }
+
+    // Order the joints by depth so that each joint is updated after its parents.
+    std::vector<std::pair<unsigned int, unsigned int> > depths(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        GP_ASSERT(_joints[i]);
+        unsigned int depth = 0;
+        for (Node* node = _joints[i]->getParent(); node != NULL; node = node->getParent())
+        {
+            ++depth;
+        }
+        depths[i] = std::make_pair(depth, (unsigned int)i);
+    }
+    std::sort(depths.begin(), depths.end());
+
+    _jointOrder.resize(count);
+    _jointBinds.resize(count * 16);
+    for (size_t i = 0; i < count; ++i)
+    {
+        _jointOrder[i] = depths[i].second;
+
+        // Keep the rows of the inverse bind pose times the bind shape.
+        Matrix bind;
+        Matrix::multiplyAffine(_joints[i]->getInverseBindPose(), _bindShape, &bind);
+        float* rows = &_jointBinds[i * 16];
+        for (unsigned int r = 0; r < 4; ++r)
+        {
+            for (unsigned int c = 0; c < 4; ++c)
+            {
+                rows[r * 4 + c] = bind.m[c * 4 + r];
+            }
+        }
+    }
+    _jointVersions.assign(count, 0);
+    _paletteForced = true;
+}
+
+const MeshSkin* MeshSkin::getPaletteSource() const
+{
+    if (_layoutDirty)
+        updateLayout();
+    return _paletteSource ? _paletteSource : this;
+}
+
+bool MeshSkin::updateJointPalette() const
+{
+    if (_layoutDirty)
+        updateLayout();
+    GP_ASSERT(_paletteSource == NULL);
+
+    bool changed = false;
+    for (size_t i = 0, count = _jointOrder.size(); i < count; ++i)
+    {
+        unsigned int index = _jointOrder[i];
+        Joint* joint = _joints[index];
+        GP_ASSERT(joint);
+
+        // Joints are versioned when their transform or that of a parent changes.
+        if (!_paletteForced && joint->_transformVersion == _jointVersions[index])
+            continue;
+        _jointVersions[index] = joint->_transformVersion;
+        changed = true;
+
+        // The parents of the joint were updated before it, so this does not recurse.
+        static_cast<const Node*>(joint)->updateWorldMatrix();
+        const float* world = joint->Node::getWorldMatrix().m;
+
+        // Each row of the palette matrix is the sum of the bind rows scaled by a row of the world matrix.
+        const float* bind = &_jointBinds[index * 16];
+        Vector4* rows = &_matrixPalette[index * PALETTE_ROWS];
+        for (unsigned int r = 0; r < PALETTE_ROWS; ++r)
+        {
+#ifdef GP_USE_SIMD
+            Float4 row = mul4(splat4(world[r]), load4(bind));
+            row = add4(row, mul4(splat4(world[4 + r]), load4(bind + 4)));
+            row = add4(row, mul4(splat4(world[8 + r]), load4(bind + 8)));
+            row = add4(row, mul4(splat4(world[12 + r]), load4(bind + 12)));
+            store4(&rows[r].x, row);
+#else
+            rows[r].set(world[r] * bind[0] + world[4 + r] * bind[4] + world[8 + r] * bind[8] + world[12 + r] * bind[12],
+                        world[r] * bind[1] + world[4 + r] * bind[5] + world[8 + r] * bind[9] + world[12 + r] * bind[13],
+                        world[r] * bind[2] + world[4 + r] * bind[6] + world[8 + r] * bind[10] + world[12 + r] * bind[14],
+                        world[r] * bind[3] + world[4 + r] * bind[7] + world[8 + r] * bind[11] + world[12 + r] * bind[15]);
+#endif
+        }
+    }
+    _paletteForced = false;
+    if (changed)
+        ++_paletteVersion;
+    return changed;
+}
+
+void MeshSkin::setJointBounds(const BoundingSphere* bounds, unsigned int count)
+{
+    GP_ASSERT(count == 0 || bounds);
+
+    _jointBounds.assign(bounds, bounds + count);
+    invalidateLayout();
+    if (_model && _model->getNode())
+        _model->getNode()->setBoundsDirty();
+}
+
+bool MeshSkin::hasJointBounds() const
+{
+    return !_jointBounds.empty();
+}
+
+bool MeshSkin::computeBounds(BoundingSphere* bounds) const
+{
+    GP_ASSERT(bounds);
+
+    if (_layoutDirty)
+        updateLayout();
+    _boundsDirty = false;
+    if (_localJointBounds.empty())
+        return false;
+
+    // Gather the box of the posed joint bounds, which is cheaper than merging the spheres.
+    BoundingBox box;
+    bool empty = true;
+    for (size_t i = 0, count = _localJointBounds.size(); i < count; ++i)
+    {
+        const BoundingSphere& sphere = _localJointBounds[i];
+        if (sphere.radius <= 0.0f || _joints[i] == NULL)
+            continue;
+
+        const Matrix& world = _joints[i]->Node::getWorldMatrix();
+        Vector3 center;
+        world.transformPoint(sphere.center, &center);
+
+        // The radius grows with the largest scale of the joint.
+        const float* m = world.m;
+        float scale = std::max(m[0] * m[0] + m[1] * m[1] + m[2] * m[2],
+                      std::max(m[4] * m[4] + m[5] * m[5] + m[6] * m[6], m[8] * m[8] + m[9] * m[9] + m[10] * m[10]));
+        float radius = sphere.radius * sqrt(scale);
+
+        Vector3 min(center.x - radius, center.y - radius, center.z - radius);
+        Vector3 max(center.x + radius, center.y + radius, center.z + radius);
+        if (empty)
+        {
+            box.set(min, max);
+            empty = false;
+        }
+        else
+        {
+            box.merge(BoundingBox(min, max));
+        }
+    }
+    if (empty)
+        return false;
+
+    bounds->set(box);
+    return true;
+}
+
+void MeshSkin::jointMoved()
+{
+    if (!_boundsDirty && !_jointBounds.empty() && _model && _model->getNode())
+    {
+        _boundsDirty = true;
+        _model->getNode()->setBoundsDirty();
+    }
+}
+
+float MeshSkin::getProjectedSize() const
+{
+    Node* node = _model ? _model->getNode() : NULL;
+    Scene* scene = node ? node->getScene() : NULL;
+    Camera* camera = scene ? scene->getActiveCamera() : NULL;
+    if (camera == NULL || camera->getNode() == NULL)
+        return 1.0f;
+
+    const BoundingSphere& sphere = node->getBoundingSphere();
+    if (camera->getCameraType() == Camera::ORTHOGRAPHIC)
+        return camera->getZoomY() > 0.0f ? sphere.radius * 2.0f / camera->getZoomY() : 1.0f;
+
+    float distance = sphere.center.distance(camera->getNode()->getTranslationWorld());
+    if (distance <= sphere.radius)
+        return 1.0f;
+    return sphere.radius / (distance * tan(MATH_DEG_TO_RAD(camera->getFieldOfView()) * 0.5f));
+}
+
+void MeshSkin::updateAnimationLod(unsigned int frame) const
+{
+    // The interval grows with the inverse of the projected size of the model.
+    float size = getProjectedSize();
+    unsigned int interval = 1;
+    if (size <= 0.0f)
+        interval = _lodMaxInterval;
+    else if (size < _lodScreenSize)
+        interval = std::min(_lodMaxInterval, (unsigned int)ceil(_lodScreenSize / size));
+
+    // The clips fall back to the maximum interval unless the interval is passed on regularly,
+    // which only happens while the skin is drawn.
+    if (interval != _updateInterval || frame - _lodFrame >= MESHSKIN_LOD_RENEW_FRAMES)
+    {
+        _updateInterval = interval;
+        _lodFrame = frame;
+        for (size_t i = 0, count = _joints.size(); i < count; ++i)
+        {
+            if (_joints[i])
+                _joints[i]->setLodUpdateInterval(interval, _lodMaxInterval, _lodPhase, frame);
+        }
+    }
+}
+
+void MeshSkin::updateBlendedPalette(const MeshSkin* source) const
+{
+    GP_ASSERT(_lodPalette && _blendPalette);
+    GP_ASSERT(source);
+
+    // The palette is bound once per pass, but only needs to be updated once per frame.
+    unsigned int frame = Game::getInstance()->getAnimationController()->_frame;
+    if (_paletteValid && frame == _paletteFrame)
+        return;
+    _paletteFrame = frame;
+
+    updateAnimationLod(frame);
+
+    // Update the computed palette and find out whether the joints were animated since the last frame.
+    source->updateJointPalette();
+    const Vector4* target = source->_matrixPalette;
+    bool posed = source->_paletteVersion != _blendVersion;
+    _blendVersion = source->_paletteVersion;
+
+    size_t size = _joints.size() * PALETTE_ROWS;
+    if (!_paletteValid)
+    {
+        std::copy(target, target + size, _lodPalette);
+        _blendStartFrame = frame - _updateInterval;
+        _paletteValid = true;
+        return;
+    }
+
+    if (posed)
+    {
+        // Blend from the palette that is shown towards the new pose until the next update is due.
+        std::copy(_lodPalette, _lodPalette + size, _blendPalette);
+        _blendStartFrame = frame;
+    }
+
+    unsigned int blendFrames = frame - _blendStartFrame + 1;
+    if (blendFrames >= _updateInterval)
+    {
+        std::copy(target, target + size, _lodPalette);
+        return;
+    }
+
+    float t = (float)blendFrames / (float)_updateInterval;
+    for (size_t i = 0; i < size; ++i)
+    {
+        const Vector4& from = _blendPalette[i];
+        const Vector4& to = target[i];
+        _lodPalette[i].set(from.x + (to.x - from.x) * t, from.y + (to.y - from.y) * t,
+                           from.z + (to.z - from.z) * t, from.w + (to.w - from.w) * t);
+    }
+}
+
+// The program that skins the vertices of one vertex format and joint count, shared by the skins that use it.
+struct MeshSkin::FeedbackProgram
+{
+    std::string key;
+    GLuint program;
+    GLint paletteLocation;
+    std::vector<GLint> attributes;
+    unsigned int refCount;
+
+    static std::map<std::string, FeedbackProgram*> cache;
+};
+
+std::map<std::string, MeshSkin::FeedbackProgram*> MeshSkin::FeedbackProgram::cache;
+
+bool MeshSkin::isPreSkinningSupported()
+{
+#ifdef GP_USE_TRANSFORM_FEEDBACK
+    return glTransformFeedbackVaryings && glBeginTransformFeedback && glEndTransformFeedback && glBindBufferBase;
+#else
+    return false;
+#endif
+}
+
+#ifdef GP_USE_TRANSFORM_FEEDBACK
+
+static bool isSkinningInput(VertexFormat::Usage usage)
+{
+    return usage == VertexFormat::BLENDWEIGHTS || usage == VertexFormat::BLENDINDICES;
+}
+
+static const char* getVectorType(unsigned int size)
+{
+    switch (size)
+    {
+    case 1:
+        return "float";
+    case 2:
+        return "vec2";
+    case 3:
+        return "vec3";
+    default:
+        return "vec4";
+    }
+}
+
+// Returns an expression of the given size for a vec3 or vec4 expression.
+static std::string fitVector(const std::string& expression, unsigned int expressionSize, unsigned int size)
+{
+    static const char* swizzles[] = { "", ".x", ".xy", ".xyz" };
+    if (size < expressionSize)
+        return expression + swizzles[size];
+    if (size > expressionSize)
+        return std::string("vec4(") + expression + ", 0.0)";
+    return expression;
+}
+
+static GLuint linkFeedbackProgram(const std::string& source, const std::vector<std::string>& varyings)
+{
+    GLuint shader;
+    GL_ASSERT( shader = glCreateShader(GL_VERTEX_SHADER) );
+    const GLchar* sourcePtr = source.c_str();
+    GL_ASSERT( glShaderSource(shader, 1, &sourcePtr, NULL) );
+    GL_ASSERT( glCompileShader(shader) );
+
+    GLint success;
+    GLchar infoLog[1024];
+    GL_ASSERT( glGetShaderiv(shader, GL_COMPILE_STATUS, &success) );
+    if (success != GL_TRUE)
+    {
+        GL_ASSERT( glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog) );
+        GP_WARN("Compile failed for the pre-skinning shader with error '%s'.", infoLog);
+        GL_ASSERT( glDeleteShader(shader) );
+        return 0;
+    }
+
+    GLuint program;
+    GL_ASSERT( program = glCreateProgram() );
+    GL_ASSERT( glAttachShader(program, shader) );
+    std::vector<const GLchar*> names(varyings.size());
+    for (size_t i = 0, count = varyings.size(); i < count; ++i)
+    {
+        names[i] = varyings[i].c_str();
+    }
+    GL_ASSERT( glTransformFeedbackVaryings(program, (GLsizei)names.size(), &names[0], GL_INTERLEAVED_ATTRIBS) );
+    GL_ASSERT( glLinkProgram(program) );
+    GL_ASSERT( glDeleteShader(shader) );
+
+    GL_ASSERT( glGetProgramiv(program, GL_LINK_STATUS, &success) );
+    if (success != GL_TRUE)
+    {
+        GL_ASSERT( glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog) );
+        GP_WARN("Linking failed for the pre-skinning program with error '%s'.", infoLog);
+        GL_ASSERT( glDeleteProgram(program) );
+        return 0;
+    }
+    return program;
+}
+
+#endif
+
+bool MeshSkin::setPreSkinning(bool enabled, bool dualQuaternion)
+{
+    releasePreSkinning();
+
+    // The materials of the model are bound again to the vertices it is now drawn with.
+    if (_model)
+        _model->releaseAllMaterialBindings();
+
+    if (!enabled)
+        return false;
+
+    if (!isPreSkinningSupported())
+    {
+        GP_WARN("Pre-skinning is not supported by the graphics driver.");
+        return false;
+    }
+    if (_model == NULL || _model->getMesh() == NULL || _joints.empty())
+    {
+        GP_WARN("Pre-skinning requires a skin with joints that belongs to a model.");
+        return false;
+    }
+
+#ifdef GP_USE_TRANSFORM_FEEDBACK
+    Mesh* mesh = _model->getMesh();
+    const VertexFormat& format = mesh->getVertexFormat();
+    unsigned int jointCount = (unsigned int)_joints.size();
+
+    // The skinned vertices keep all elements of the mesh except the skinning inputs.
+    std::vector<VertexFormat::Element> elements;
+    char key[64];
+    sprintf(key, "%u:%d", jointCount, dualQuaternion ? 1 : 0);
+    std::string programKey = key;
+    bool weighted = false;
+    for (unsigned int i = 0, count = (unsigned int)format.getElementCount(); i < count; ++i)
+    {
+        const VertexFormat::Element& e = format.getElement(i);
+        if (e.type != VertexFormat::FLOAT)
+        {
+            // Transform feedback captures floats, and the shader does not decode quantized elements.
+            GP_WARN("Pre-skinning requires a mesh with float vertex elements.");
+            return false;
+        }
+        sprintf(key, ":%d.%u", (int)e.usage, e.size);
+        programKey += key;
+        if (e.usage == VertexFormat::BLENDWEIGHTS)
+            weighted = true;
+        if (!isSkinningInput(e.usage))
+            elements.push_back(e);
+    }
+    if (!weighted || elements.empty())
+    {
+        GP_WARN("Pre-skinning requires a mesh with blend weights.");
+        return false;
+    }
+
+    std::map<std::string, FeedbackProgram*>::iterator itr = FeedbackProgram::cache.find(programKey);
+    if (itr != FeedbackProgram::cache.end())
+    {
+        _feedbackProgram = itr->second;
+        ++_feedbackProgram->refCount;
+    }
+    else
+    {
+        char* skinningSource = FileSystem::readAll(PRESKINNING_SHADER);
+        if (skinningSource == NULL)
+        {
+            GP_WARN("Failed to read the pre-skinning shader '%s'.", PRESKINNING_SHADER);
+            return false;
+        }
+
+        // The skinning functions of the material shaders are reused, with the outputs captured by transform feedback.
+        std::string source;
+        sprintf(key, "#define SKINNING_JOINT_COUNT %u\n", jointCount);
+        source += key;
+        if (dualQuaternion)
+            source += "#define SKINNING_DUAL_QUATERNION\n"
+                      "uniform vec4 u_dualQuaternionPalette[SKINNING_JOINT_COUNT * 2];\n";
+        else
+            source += "uniform vec4 u_matrixPalette[SKINNING_JOINT_COUNT * 3];\n";
+        source += "#define LIGHTING\n"
+                  "#define BUMPED\n"
+                  "attribute vec4 a_position;\n"
+                  "attribute vec3 a_normal;\n"
+                  "attribute vec3 a_tangent;\n"
+                  "attribute vec3 a_binormal;\n"
+                  "attribute vec4 a_blendWeights;\n"
+                  "attribute vec4 a_blendIndices;\n";
+
+        std::string body;
+        std::vector<std::string> varyings;
+        for (unsigned int i = 0, count = (unsigned int)format.getElementCount(); i < count; ++i)
+        {
+            const VertexFormat::Element& e = format.getElement(i);
+            if (isSkinningInput(e.usage))
+                continue;
+
+            sprintf(key, "v_output%u", (unsigned int)varyings.size());
+            std::string varying = key;
+            varyings.push_back(varying);
+            source += std::string("varying ") + getVectorType(e.size) + " " + varying + ";\n";
+
+            std::string value;
+            switch (e.usage)
+            {
+            case VertexFormat::POSITION:
+                value = fitVector("position", 4, e.size);
+                break;
+            case VertexFormat::NORMAL:
+                value = fitVector("getNormal()", 3, e.size);
+                break;
+            case VertexFormat::TANGENT:
+                value = fitVector("getTangent()", 3, e.size);
+                break;
+            case VertexFormat::BINORMAL:
+                value = fitVector("getBinormal()", 3, e.size);
+                break;
+            default:
+                // Other elements are copied unchanged.
+                sprintf(key, "a_input%u", i);
+                value = key;
+                source += std::string("attribute ") + getVectorType(e.size) + " " + value + ";\n";
+                break;
+            }
+            body += "    " + varying + " = " + value + ";\n";
+        }
+        source += skinningSource;
+        source += "\nvoid main()\n{\n    vec4 position = getPosition();\n" + body + "}\n";
+        SAFE_DELETE_ARRAY(skinningSource);
+
+        GLuint program = linkFeedbackProgram(source, varyings);
+        if (program == 0)
+            return false;
+
+        _feedbackProgram = new FeedbackProgram();
+        _feedbackProgram->key = programKey;
+        _feedbackProgram->program = program;
+        _feedbackProgram->refCount = 1;
+        GL_ASSERT( _feedbackProgram->paletteLocation = glGetUniformLocation(program, dualQuaternion ? "u_dualQuaternionPalette" : "u_matrixPalette") );
+        for (unsigned int i = 0, count = (unsigned int)format.getElementCount(); i < count; ++i)
+        {
+            const char* name = NULL;
+            switch (format.getElement(i).usage)
+            {
+            case VertexFormat::POSITION:
+                name = VERTEX_ATTRIBUTE_POSITION_NAME;
+                break;
+            case VertexFormat::NORMAL:
+                name = VERTEX_ATTRIBUTE_NORMAL_NAME;
+                break;
+            case VertexFormat::TANGENT:
+                name = VERTEX_ATTRIBUTE_TANGENT_NAME;
+                break;
+            case VertexFormat::BINORMAL:
+                name = VERTEX_ATTRIBUTE_BINORMAL_NAME;
+                break;
+            case VertexFormat::BLENDWEIGHTS:
+                name = VERTEX_ATTRIBUTE_BLENDWEIGHTS_NAME;
+                break;
+            case VertexFormat::BLENDINDICES:
+                name = VERTEX_ATTRIBUTE_BLENDINDICES_NAME;
+                break;
+            default:
+                sprintf(key, "a_input%u", i);
+                name = key;
+                break;
+            }
+            GLint location;
+            GL_ASSERT( location = glGetAttribLocation(program, name) );
+            _feedbackProgram->attributes.push_back(location);
+        }
+        FeedbackProgram::cache[programKey] = _feedbackProgram;
+    }
+
+    _skinnedMesh = Mesh::createMesh(VertexFormat(&elements[0], (unsigned int)elements.size()), mesh->getVertexCount(), true);
+    _skinnedMesh->setPrimitiveType(mesh->getPrimitiveType());
+    _skinnedDualQuaternion = dualQuaternion;
+    _skinnedSource = NULL;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool MeshSkin::isPreSkinning() const
+{
+    return _skinnedMesh != NULL;
+}
+
+void MeshSkin::releasePreSkinning()
+{
+    SAFE_RELEASE(_skinnedMesh);
+    _skinnedSource = NULL;
+
+    if (_feedbackProgram && --_feedbackProgram->refCount == 0)
+    {
+        FeedbackProgram::cache.erase(_feedbackProgram->key);
+        GL_ASSERT( glDeleteProgram(_feedbackProgram->program) );
+        SAFE_DELETE(_feedbackProgram);
+    }
+    _feedbackProgram = NULL;
+}
+
+void MeshSkin::updatePreSkinnedMesh() const
+{
+#ifdef GP_USE_TRANSFORM_FEEDBACK
+    GP_ASSERT(_skinnedMesh && _feedbackProgram);
+    GP_ASSERT(_model && _model->getMesh());
+
+    // The vertices are only skinned again once the palette has changed, so every pass of every frame
+    // in between draws the same skinned vertices.
+    const Vector4* palette = _skinnedDualQuaternion ? getDualQuaternionPalette() : getMatrixPalette();
+    unsigned int paletteSize = _skinnedDualQuaternion ? getDualQuaternionPaletteSize() : getMatrixPaletteSize();
+    const MeshSkin* owner;
+    unsigned int version = getPaletteVersion(&owner);
+    if (owner == _skinnedSource && version == _skinnedVersion)
+        return;
+    _skinnedSource = owner;
+    _skinnedVersion = version;
+
+    Mesh* mesh = _model->getMesh();
+    const VertexFormat& format = mesh->getVertexFormat();
+
+    RenderState::useProgram(_feedbackProgram->program);
+    GL_ASSERT( glUniform4fv(_feedbackProgram->paletteLocation, (GLsizei)paletteSize, (const GLfloat*)palette) );
+
+#ifdef GP_USE_VAO
+    if (glGenVertexArrays)
+    {
+        RenderState::bindVertexArray(0);
+    }
+#endif
+    RenderState::bindBuffer(GL_ARRAY_BUFFER, mesh->getVertexBuffer());
+    size_t offset = mesh->getVertexOffset();
+    for (unsigned int i = 0, count = (unsigned int)format.getElementCount(); i < count; ++i)
+    {
+        const VertexFormat::Element& e = format.getElement(i);
+        GLint location = _feedbackProgram->attributes[i];
+        if (location != -1)
+        {
+            GL_ASSERT( glVertexAttribPointer(location, e.size, GL_FLOAT, GL_FALSE, format.getVertexSize(), (void*)offset) );
+            GL_ASSERT( glEnableVertexAttribArray(location) );
+        }
+        offset += e.size * sizeof(float);
+    }
+
+    // Each vertex is skinned once as a point, without rasterizing anything.
+    GL_ASSERT( glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, _skinnedMesh->getVertexBuffer()) );
+    GL_ASSERT( glEnable(GL_RASTERIZER_DISCARD) );
+    GL_ASSERT( glBeginTransformFeedback(GL_POINTS) );
+    GraphicsDevice::drawArrays(GL_POINTS, 0, mesh->getVertexCount());
+    GL_ASSERT( glEndTransformFeedback() );
+    GL_ASSERT( glDisable(GL_RASTERIZER_DISCARD) );
+    GL_ASSERT( glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0) );
+
+    for (unsigned int i = 0, count = (unsigned int)format.getElementCount(); i < count; ++i)
+    {
+        if (_feedbackProgram->attributes[i] != -1)
+        {
+            GL_ASSERT( glDisableVertexAttribArray(_feedbackProgram->attributes[i]) );
+        }
+    }
+    RenderState::bindBuffer(GL_ARRAY_BUFFER, 0);
+#endif
+}
+
 Joint* MeshSkin::getRootJoint() const
 {
     return _rootJoint;
@@ -265,11 +1119,18 @@ void MeshSkin::clearJoints()
 {
     setRootJoint(NULL);
 
+    // Other skins on the same joints must not keep sharing the palette of this skin.
+    invalidateLayout();
     for (size_t i = 0, count = _joints.size(); i < count; ++i)
     {
-        SAFE_RELEASE(_joints[i]);
+        if (_joints[i])
+        {
+            _joints[i]->removeSkin(this);
+            SAFE_RELEASE(_joints[i]);
+        }
     }
     _joints.clear();
+    _layoutDirty = true;
 }
 
 }
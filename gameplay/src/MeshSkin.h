@@ -11,6 +11,7 @@ class Bundle;
 class Model;
 class Node;
 class Joint;
+class Mesh;
 
 /**
  * Defines the skin for a mesh.
@@ -92,6 +93,9 @@ public:
 
     /**
      * Returns the pointer to the Vector4 array for the purpose of binding to a shader.
+     *
+     * Skins that have the same joints and bind shape (such as the skins of several meshes
+     * of a character that are cloned together) share one computed palette.
      * 
      * @return The pointer to the matrix palette.
      */
@@ -106,6 +110,130 @@ public:
      */
     unsigned int getMatrixPaletteSize() const;
 
+    /**
+     * Returns the pointer to the dual quaternion palette for the purpose of binding to a shader.
+     *
+     * Each joint is represented by a unit dual quaternion of 2 rows: the rotation quaternion
+     * followed by the dual part that holds the translation. This takes two thirds of the
+     * uniforms of the matrix palette, so more joints fit in a single draw call. The palette is
+     * converted from the matrix palette and cannot represent scale, which is dropped.
+     *
+     * Shaders skin with the dual quaternion palette when the SKINNING_DUAL_QUATERNION define
+     * is set, in which case it is bound to the u_dualQuaternionPalette uniform.
+     *
+     * @return The pointer to the dual quaternion palette.
+     * @script{ignore}
+     */
+    Vector4* getDualQuaternionPalette() const;
+
+    /**
+     * Returns the number of elements in the dual quaternion palette array.
+     * Each dual quaternion is represented by 2 rows of Vector4.
+     *
+     * @return The dual quaternion palette size.
+     * @script{ignore}
+     */
+    unsigned int getDualQuaternionPaletteSize() const;
+
+    /**
+     * Sets whether the vertices of the mesh are skinned before the model is drawn.
+     *
+     * With pre-skinning, the vertices are skinned once per frame with transform feedback into
+     * a separate vertex buffer, which every pass of the model then draws, including shadow passes.
+     * The skinned vertices have the format of the mesh without the blend weights and indices, so
+     * the materials of the model must not be compiled with the SKINNING define.
+     *
+     * The skin must belong to a model. Pre-skinning requires transform feedback, which is
+     * not available with OpenGL ES 2.0 (see isPreSkinningSupported).
+     *
+     * @param enabled true to enable pre-skinning, false to skin the vertices in the shaders of the materials.
+     * @param dualQuaternion true to skin with the dual quaternion palette, false to use the matrix palette.
+     *
+     * @return true if pre-skinning is enabled, false otherwise.
+     * @script{ignore}
+     */
+    bool setPreSkinning(bool enabled, bool dualQuaternion = false);
+
+    /**
+     * Determines if the vertices of the mesh are skinned before the model is drawn.
+     *
+     * @return true if pre-skinning is enabled, false otherwise.
+     * @script{ignore}
+     */
+    bool isPreSkinning() const;
+
+    /**
+     * Determines if pre-skinning is supported by the graphics driver.
+     *
+     * @return true if pre-skinning is supported, false otherwise.
+     * @script{ignore}
+     */
+    static bool isPreSkinningSupported();
+
+    /**
+     * Sets the animation level of detail of the skin.
+     *
+     * When the projected height of the model on screen (as a fraction of the viewport height,
+     * as seen from the active camera of its scene) is smaller than the given screen size, the
+     * clips that animate the joints of the skin are evaluated less often. The update interval
+     * grows with the inverse of the projected size, up to the given maximum. Models that are
+     * no longer drawn are updated at the maximum interval.
+     *
+     * Between updates, the matrix palette is blended from the pose that was shown before the
+     * update to the new pose, so that reduced rates do not look choppy.
+     *
+     * @param screenSize The projected size below which the update rate is reduced, or zero to update at full rate.
+     * @param maxUpdateInterval The largest number of frames between updates.
+     * @script{ignore}
+     */
+    void setAnimationLod(float screenSize, unsigned int maxUpdateInterval);
+
+    /**
+     * Gets the projected size below which the update rate of the skin is reduced.
+     *
+     * @return The screen size of the animation level of detail, or zero if it is disabled.
+     * @script{ignore}
+     */
+    float getAnimationLodScreenSize() const;
+
+    /**
+     * Gets the largest number of frames between updates of the skin.
+     *
+     * @return The maximum update interval of the animation level of detail.
+     * @script{ignore}
+     */
+    unsigned int getAnimationLodMaxInterval() const;
+
+    /**
+     * Gets the number of frames between updates that was last chosen for the skin.
+     *
+     * @return The current update interval of the skin.
+     * @script{ignore}
+     */
+    unsigned int getUpdateInterval() const;
+
+    /**
+     * Sets the bounds of the vertices that each joint of the skin influences, in the space of the mesh.
+     *
+     * While the skin has joint bounds, the bounding sphere of the node of its model follows the
+     * animated joints (see Node::getBoundingSphere) instead of using the bounds of the mesh, which
+     * must enclose every pose. The joint bounds are read from the bundle of the skin when they
+     * were encoded with it.
+     *
+     * @param bounds The bounding sphere of each joint, whose radius is 0 for the joints that influence no vertex.
+     * @param count The number of bounding spheres, which is the number of joints, or 0 to clear the joint bounds.
+     * @script{ignore}
+     */
+    void setJointBounds(const BoundingSphere* bounds, unsigned int count);
+
+    /**
+     * Determines whether the skin has the bounds of its joints (see setJointBounds).
+     *
+     * @return true if the skin has joint bounds, false otherwise.
+     * @script{ignore}
+     */
+    bool hasJointBounds() const;
+
     /**
      * Returns our parent Model.
      */
@@ -175,6 +303,77 @@ private:
      */
     void clearJoints();
 
+    /**
+     * Marks the joint layout of this skin, and of the skins that may share its palette, as changed.
+     */
+    void invalidateLayout();
+
+    /**
+     * Finds the skin whose palette this skin shares and orders the joints for the palette update.
+     */
+    void updateLayout() const;
+
+    /**
+     * Returns the skin that computes the palette of this skin, which may be this skin.
+     */
+    const MeshSkin* getPaletteSource() const;
+
+    /**
+     * Updates the palette rows of the joints that changed since the last update, parents first.
+     *
+     * @return true if the palette changed.
+     */
+    bool updateJointPalette() const;
+
+    /**
+     * Allocates the palettes used to blend between updates at a reduced rate.
+     */
+    void createBlendPalettes();
+
+    /**
+     * Returns the projected height of the model, as a fraction of the viewport height.
+     */
+    float getProjectedSize() const;
+
+    /**
+     * Chooses the update interval for the current projected size of the model and passes it on to the animated joints.
+     */
+    void updateAnimationLod(unsigned int frame) const;
+
+    /**
+     * Updates the matrix palette while the animation level of detail is enabled.
+     */
+    void updateBlendedPalette(const MeshSkin* source) const;
+
+    /**
+     * Returns the skin and version of the palette that getMatrixPalette last returned, which change whenever the palette does.
+     */
+    unsigned int getPaletteVersion(const MeshSkin** owner) const;
+
+    /**
+     * Skins the vertices of the mesh into the pre-skinned mesh, at most once per frame.
+     */
+    void updatePreSkinnedMesh() const;
+
+    /**
+     * Computes the bounds of the posed joint bounds, in the space that the world matrix of the
+     * node of the model transforms.
+     *
+     * @return false if the skin has no joint bounds.
+     */
+    bool computeBounds(BoundingSphere* bounds) const;
+
+    /**
+     * Called when a joint moves, to mark the bounds of the node of the model dirty once until
+     * they are computed again.
+     */
+    void jointMoved();
+
+    /**
+     * Releases the pre-skinned mesh and the program that skins it.
+     */
+    void releasePreSkinning();
+
     Matrix _bindShape;
     std::vector<Joint*> _joints;
     Joint* _rootJoint;
@@ -190,6 +389,52 @@ private:
     // The number of Vector4's is (_joints.size() * 3).
     Vector4* _matrixPalette;
     Model* _model;
+
+    // The layout of the palette update.
+    // The joints are updated in order of depth so that parents are resolved before their
+    // children, and the product of the inverse bind pose and bind shape of each joint is
+    // kept transposed so that each palette row is a sum of four scaled rows.
+    mutable bool _layoutDirty;
+    mutable const MeshSkin* _paletteSource;
+    mutable std::vector<unsigned int> _jointOrder;
+    mutable std::vector<float> _jointBinds;
+    mutable std::vector<unsigned int> _jointVersions;
+    mutable bool _paletteForced;
+    mutable unsigned int _paletteVersion;
+
+    // The bounds of the vertices of each joint, in the space of the mesh and, with the inverse
+    // bind pose and bind shape applied, in the space of the joint.
+    std::vector<BoundingSphere> _jointBounds;
+    mutable std::vector<BoundingSphere> _localJointBounds;
+    mutable bool _boundsDirty;
+
+    // The animation level of detail.
+    // While it is enabled, the palette that is bound is blended from the blend palette
+    // towards the computed palette over the update interval.
+    float _lodScreenSize;
+    unsigned int _lodMaxInterval;
+    unsigned int _lodPhase;
+    mutable unsigned int _updateInterval;
+    mutable unsigned int _lodFrame;
+    mutable unsigned int _paletteFrame;
+    mutable unsigned int _blendStartFrame;
+    mutable bool _paletteValid;
+    mutable unsigned int _blendVersion;
+    Vector4* _lodPalette;
+    Vector4* _blendPalette;
+
+    // The dual quaternion palette, converted from the matrix palette when it is bound.
+    mutable Vector4* _dualQuaternionPalette;
+    mutable const MeshSkin* _dualQuaternionSource;
+    mutable unsigned int _dualQuaternionVersion;
+
+    // Pre-skinning with transform feedback.
+    struct FeedbackProgram;
+    Mesh* _skinnedMesh;
+    FeedbackProgram* _feedbackProgram;
+    bool _skinnedDualQuaternion;
+    mutable const MeshSkin* _skinnedSource;
+    mutable unsigned int _skinnedVersion;
 };
 
 }
@@ -0,0 +1,350 @@
+#include "Base.h"
+#include "MeshStreamer.h"
+#include "Mesh.h"
+#include "MeshPart.h"
+#include "Game.h"
+#include "FileSystem.h"
+#include "MemoryStats.h"
+#include "RenderState.h"
+
+// Frames after which a mesh that has not been drawn releases its data
+#define MESH_STREAMING_UNUSED_FRAMES 300
+// Maximum number of meshes whose data is read at the same time
+#define MESH_STREAMING_MAX_REQUESTS 4
+
+namespace gameplay
+{
+
+struct MeshStreamer::Request
+{
+    // The entry that the data is read for, or NULL if the mesh was destroyed in the meantime.
+    Entry* entry;
+    std::string path;
+    unsigned int offset;
+    unsigned int size;
+    unsigned char* data;
+    bool failed;
+    JobSystem::Job* job;
+};
+
+MeshStreamer::MeshStreamer()
+    : _enabled(false), _budget(0), _memoryUsage(0), _residentCount(0), _frame(0)
+{
+}
+
+MeshStreamer::~MeshStreamer()
+{
+    finalize();
+}
+
+void MeshStreamer::setEnabled(bool enabled)
+{
+    _enabled = enabled;
+}
+
+bool MeshStreamer::isEnabled() const
+{
+    return _enabled;
+}
+
+void MeshStreamer::setBudget(size_t bytes)
+{
+    _budget = bytes;
+}
+
+size_t MeshStreamer::getBudget() const
+{
+    return _budget;
+}
+
+size_t MeshStreamer::getMemoryUsage() const
+{
+    return _memoryUsage;
+}
+
+unsigned int MeshStreamer::getMeshCount() const
+{
+    return (unsigned int)_entries.size();
+}
+
+unsigned int MeshStreamer::getResidentCount() const
+{
+    return _residentCount;
+}
+
+void MeshStreamer::finalize()
+{
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    for (size_t i = 0, count = _requests.size(); i < count; ++i)
+    {
+        Request* request = _requests[i];
+        GP_ASSERT(jobSystem);
+        jobSystem->wait(request->job);
+        SAFE_DELETE_ARRAY(request->data);
+        SAFE_DELETE(request);
+    }
+    _requests.clear();
+
+    // The remaining meshes keep the data that they have loaded.
+    for (size_t i = 0, count = _entries.size(); i < count; ++i)
+    {
+        Entry* entry = _entries[i];
+        if (entry->resident)
+            MemoryStats::remove(MemoryStats::MESHES, entry->memory);
+        entry->mesh->_streamEntry = NULL;
+        SAFE_DELETE(entry);
+    }
+    _entries.clear();
+    _sorted.clear();
+    _memoryUsage = 0;
+    _residentCount = 0;
+    _enabled = false;
+}
+
+MeshStreamer::Entry* MeshStreamer::add(Mesh* mesh, const char* path, unsigned int offset, unsigned int size, const std::vector<Range>& parts)
+{
+    GP_ASSERT(mesh);
+    GP_ASSERT(path);
+
+    Entry* entry = new Entry();
+    entry->mesh = mesh;
+    entry->path = path;
+    entry->offset = offset;
+    entry->size = size;
+    entry->parts = parts;
+    entry->memory = mesh->getVertexSize() * mesh->getVertexCount();
+    for (size_t i = 0, count = parts.size(); i < count; ++i)
+    {
+        MeshPart* part = parts[i].part;
+        GP_ASSERT(part);
+        Mesh::IndexFormat format = part->getIndexFormat();
+        entry->memory += part->getIndexCount() * (format == Mesh::INDEX8 ? 1 : (format == Mesh::INDEX16 ? 2 : 4));
+    }
+    entry->resident = false;
+    entry->failed = false;
+    entry->lastUsedFrame = _frame;
+    entry->request = NULL;
+    _entries.push_back(entry);
+    return entry;
+}
+
+void MeshStreamer::remove(Entry* entry)
+{
+    GP_ASSERT(entry);
+
+    // The data that is being read for the mesh is thrown away once it is read.
+    if (entry->request)
+        entry->request->entry = NULL;
+
+    std::vector<Entry*>::iterator itr = std::find(_entries.begin(), _entries.end(), entry);
+    if (itr != _entries.end())
+        _entries.erase(itr);
+
+    if (entry->resident)
+    {
+        _memoryUsage -= entry->memory;
+        --_residentCount;
+        MemoryStats::remove(MemoryStats::MESHES, entry->memory);
+    }
+    entry->mesh->_streamEntry = NULL;
+    SAFE_DELETE(entry);
+}
+
+bool MeshStreamer::use(Entry* entry)
+{
+    GP_ASSERT(entry);
+
+    entry->lastUsedFrame = _frame;
+    if (!entry->resident && !entry->failed && entry->request == NULL && _requests.size() < MESH_STREAMING_MAX_REQUESTS)
+        startRequest(entry);
+    return entry->resident;
+}
+
+void MeshStreamer::prefetch(Mesh* mesh)
+{
+    if (mesh && mesh->_streamEntry)
+        use(mesh->_streamEntry);
+}
+
+bool MeshStreamer::load(Mesh* mesh)
+{
+    if (mesh == NULL || mesh->_streamEntry == NULL)
+        return true;
+
+    Entry* entry = mesh->_streamEntry;
+    entry->lastUsedFrame = _frame;
+    if (entry->resident || entry->failed)
+        return entry->resident;
+
+    if (entry->request == NULL)
+        startRequest(entry);
+
+    // Finish the read on this thread, or help the workers until it is done.
+    Request* request = entry->request;
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    GP_ASSERT(jobSystem);
+    jobSystem->wait(request->job);
+    _requests.erase(std::find(_requests.begin(), _requests.end(), request));
+    finishRequest(entry);
+    SAFE_DELETE_ARRAY(request->data);
+    SAFE_DELETE(request);
+    return entry->resident;
+}
+
+void MeshStreamer::update()
+{
+    // Upload the meshes that have been read.
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    GP_ASSERT(jobSystem);
+    for (size_t i = 0; i < _requests.size();)
+    {
+        Request* request = _requests[i];
+        if (!jobSystem->isFinished(request->job))
+        {
+            ++i;
+            continue;
+        }
+
+        jobSystem->release(request->job);
+        if (request->entry)
+            finishRequest(request->entry);
+        SAFE_DELETE_ARRAY(request->data);
+        SAFE_DELETE(request);
+        _requests.erase(_requests.begin() + i);
+    }
+
+    // Release the meshes that have not been drawn for a while.
+    for (size_t i = 0, count = _entries.size(); i < count; ++i)
+    {
+        Entry* entry = _entries[i];
+        if (entry->resident && _frame - entry->lastUsedFrame > MESH_STREAMING_UNUSED_FRAMES)
+            evict(entry);
+    }
+
+    // Release the meshes that were drawn the least recently while there is too much memory in use,
+    // except for the ones that were drawn in this frame.
+    if (isOverBudget())
+    {
+        _sorted.clear();
+        for (size_t i = 0, count = _entries.size(); i < count; ++i)
+        {
+            if (_entries[i]->resident && _entries[i]->lastUsedFrame != _frame)
+                _sorted.push_back(_entries[i]);
+        }
+        std::sort(_sorted.begin(), _sorted.end(), compareLastUsedFrame);
+        for (size_t i = 0, count = _sorted.size(); i < count && isOverBudget(); ++i)
+        {
+            evict(_sorted[i]);
+        }
+    }
+
+    // Draws from now on count towards the next frame.
+    ++_frame;
+}
+
+bool MeshStreamer::isOverBudget() const
+{
+    if (_budget > 0 && _memoryUsage > _budget)
+        return true;
+    size_t budget = MemoryStats::getBudget(MemoryStats::MESHES);
+    return budget > 0 && MemoryStats::getUsage(MemoryStats::MESHES) > budget;
+}
+
+bool MeshStreamer::compareLastUsedFrame(const Entry* a, const Entry* b)
+{
+    return a->lastUsedFrame < b->lastUsedFrame;
+}
+
+void MeshStreamer::evict(Entry* entry)
+{
+    GP_ASSERT(entry);
+    GP_ASSERT(entry->resident);
+
+    // Release the storage of the buffers but keep the buffers themselves, which the vertex
+    // attribute bindings of the mesh refer to.
+    Mesh* mesh = entry->mesh;
+    RenderState::bindBuffer(GL_ARRAY_BUFFER, mesh->_vertexBuffer);
+    GL_ASSERT( glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STATIC_DRAW) );
+    for (size_t i = 0, count = entry->parts.size(); i < count; ++i)
+    {
+        RenderState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, entry->parts[i].part->_indexBuffer);
+        GL_ASSERT( glBufferData(GL_ELEMENT_ARRAY_BUFFER, 0, NULL, GL_STATIC_DRAW) );
+    }
+
+    entry->resident = false;
+    _memoryUsage -= entry->memory;
+    --_residentCount;
+    MemoryStats::remove(MemoryStats::MESHES, entry->memory);
+}
+
+void MeshStreamer::startRequest(Entry* entry)
+{
+    GP_ASSERT(entry);
+    GP_ASSERT(entry->request == NULL);
+
+    Request* request = new Request();
+    request->entry = entry;
+    request->path = entry->path;
+    request->offset = entry->offset;
+    request->size = entry->size;
+    request->data = NULL;
+    request->failed = false;
+
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    GP_ASSERT(jobSystem);
+    request->job = jobSystem->create(&MeshStreamer::readProc, request);
+    entry->request = request;
+    _requests.push_back(request);
+    jobSystem->run(request->job);
+}
+
+void MeshStreamer::readProc(void* cookie)
+{
+    Request* request = (Request*)cookie;
+
+    std::unique_ptr<Stream> stream(FileSystem::open(request->path.c_str()));
+    if (stream.get() == NULL || !stream->seek(request->offset, SEEK_SET))
+    {
+        request->failed = true;
+        return;
+    }
+
+    request->data = new unsigned char[request->size];
+    if (stream->read(request->data, 1, request->size) != request->size)
+    {
+        request->failed = true;
+        SAFE_DELETE_ARRAY(request->data);
+    }
+}
+
+void MeshStreamer::finishRequest(Entry* entry)
+{
+    GP_ASSERT(entry);
+    GP_ASSERT(entry->request);
+
+    Request* request = entry->request;
+    entry->request = NULL;
+    if (request->failed)
+    {
+        // The mesh is not drawn, and is not read again.
+        GP_WARN("Failed to stream the data of mesh '%s'.", entry->mesh->getUrl());
+        entry->failed = true;
+        return;
+    }
+
+    // The vertices are at the start of the data, and the indices of the parts follow them
+    // with the other data of the mesh that is read along in between.
+    Mesh* mesh = entry->mesh;
+    mesh->setVertexData((const float*)request->data, 0, 0);
+    for (size_t i = 0, count = entry->parts.size(); i < count; ++i)
+    {
+        entry->parts[i].part->setIndexData(request->data + entry->parts[i].offset, 0, 0);
+    }
+
+    entry->resident = true;
+    _memoryUsage += entry->memory;
+    ++_residentCount;
+    MemoryStats::add(MemoryStats::MESHES, entry->memory);
+}
+
+}
@@ -0,0 +1,221 @@
+#ifndef MESHSTREAMER_H_
+#define MESHSTREAMER_H_
+
+#include "JobSystem.h"
+
+namespace gameplay
+{
+
+class Mesh;
+class MeshPart;
+
+/**
+ * Defines the on demand loading of the vertex and index data of meshes from bundles.
+ *
+ * When mesh streaming is enabled, the meshes that are loaded from bundles only read their
+ * vertex format, bounds and parts up front, and keep the location of their vertex and index
+ * data in the bundle. The data is read on the worker threads of the job system the first time
+ * that the mesh is drawn, or when it is prefetched (see prefetch), and uploaded on the thread
+ * that runs the game. A mesh is not drawn until its data is loaded, so the nodes that start
+ * disabled or far away do not use memory for their meshes until they are drawn.
+ *
+ * Meshes that have not been drawn for a while release their data again, and are loaded again
+ * the next time they are drawn. When the loaded meshes use more memory than the budget, or
+ * than the budget of meshes in MemoryStats, the meshes that were drawn the least recently are
+ * released first.
+ *
+ * The mesh streamer is owned by the Game. Streaming is disabled by default and can be enabled
+ * in the game.config file, along with the budget (in megabytes):
+ *
+ * @code
+ * resources
+ * {
+ *     meshStreaming = true
+ *     meshStreamingBudget = 128
+ * }
+ * @endcode
+ *
+ * Meshes whose geometry is retained (see MeshGeometry::setRetained) are never streamed.
+ *
+ * @script{ignore}
+ */
+class MeshStreamer
+{
+    friend class Game;
+    friend class Bundle;
+    friend class Mesh;
+    friend class Model;
+
+public:
+
+    /**
+     * Enables or disables streaming for the meshes that are loaded from bundles afterwards.
+     *
+     * @param enabled true to stream meshes, false to load their data up front.
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     * Determines if meshes are streamed when they are loaded.
+     *
+     * @return true if mesh streaming is enabled, false otherwise.
+     */
+    bool isEnabled() const;
+
+    /**
+     * Sets the memory budget of the streamed meshes.
+     *
+     * @param bytes The number of bytes that the data of streamed meshes may use, or 0 for no limit.
+     */
+    void setBudget(size_t bytes);
+
+    /**
+     * Returns the memory budget of the streamed meshes.
+     *
+     * @return The memory budget in bytes, or 0 if there is no limit.
+     */
+    size_t getBudget() const;
+
+    /**
+     * Returns the memory that the loaded data of streamed meshes uses.
+     *
+     * @return The number of bytes used by streamed meshes.
+     */
+    size_t getMemoryUsage() const;
+
+    /**
+     * Returns the number of meshes that are streamed.
+     *
+     * @return The number of streamed meshes.
+     */
+    unsigned int getMeshCount() const;
+
+    /**
+     * Returns the number of streamed meshes whose data is loaded.
+     *
+     * @return The number of loaded meshes.
+     */
+    unsigned int getResidentCount() const;
+
+    /**
+     * Starts loading the data of a mesh that is about to be drawn, such as the meshes of the
+     * nodes near the camera or the nodes that are enabled, and keeps it loaded for this frame.
+     *
+     * @param mesh The mesh, which may be a mesh that is not streamed.
+     */
+    void prefetch(Mesh* mesh);
+
+    /**
+     * Loads the data of a mesh right away, for the code that reads the buffers of the mesh.
+     *
+     * @param mesh The mesh, which may be a mesh that is not streamed.
+     *
+     * @return true if the data of the mesh is loaded, false if it could not be read.
+     */
+    bool load(Mesh* mesh);
+
+private:
+
+    /**
+     * The location of the indices of a part in the data of a mesh.
+     */
+    struct Range
+    {
+        MeshPart* part;
+        unsigned int offset;
+    };
+
+    /**
+     * The data of a streamed mesh that is read on a worker thread.
+     */
+    struct Request;
+
+    /**
+     * The streaming state of a mesh.
+     */
+    struct Entry
+    {
+        Mesh* mesh;
+        std::string path;
+        // The data of the mesh spans from its vertices to the indices of its last part.
+        unsigned int offset;
+        unsigned int size;
+        std::vector<Range> parts;
+        // The memory of the vertex and index buffers when the mesh is loaded.
+        size_t memory;
+        bool resident;
+        bool failed;
+        unsigned int lastUsedFrame;
+        Request* request;
+    };
+
+    /**
+     * Constructor.
+     */
+    MeshStreamer();
+
+    /**
+     * Destructor.
+     */
+    ~MeshStreamer();
+
+    /**
+     * Hidden copy constructor.
+     */
+    MeshStreamer(const MeshStreamer& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    MeshStreamer& operator=(const MeshStreamer&);
+
+    /**
+     * Waits for the meshes that are being read and stops streaming.
+     */
+    void finalize();
+
+    /**
+     * Uploads the meshes that have been read and releases the meshes that are not drawn anymore.
+     */
+    void update();
+
+    /**
+     * Starts streaming a mesh whose vertices are at the specified offset of a bundle file and whose
+     * parts have been added to it. The buffers of the mesh have no storage until it is loaded.
+     */
+    Entry* add(Mesh* mesh, const char* path, unsigned int offset, unsigned int size, const std::vector<Range>& parts);
+
+    void remove(Entry* entry);
+
+    /**
+     * Marks a mesh as drawn in this frame and starts loading it if it is not loaded.
+     *
+     * @return true if the mesh can be drawn, false if its data is not loaded yet.
+     */
+    bool use(Entry* entry);
+
+    void evict(Entry* entry);
+
+    void startRequest(Entry* entry);
+
+    void finishRequest(Entry* entry);
+
+    bool isOverBudget() const;
+
+    static bool compareLastUsedFrame(const Entry* a, const Entry* b);
+
+    static void readProc(void* cookie);
+
+    std::vector<Entry*> _entries;
+    std::vector<Entry*> _sorted;
+    std::vector<Request*> _requests;
+    bool _enabled;
+    size_t _budget;
+    size_t _memoryUsage;
+    unsigned int _residentCount;
+    unsigned int _frame;
+};
+
+}
+
+#endif
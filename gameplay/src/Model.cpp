@@ -1,21 +1,52 @@
 #include "Base.h"
 #include "Model.h"
+#include "GraphicsDevice.h"
 #include "MeshPart.h"
 #include "Scene.h"
 #include "Technique.h"
 #include "Pass.h"
 #include "Node.h"
+#include "Game.h"
+#include "RenderCommandList.h"
 
 namespace gameplay
 {
 
+GP_POOL_ALLOCATED_IMPLEMENT(Model, 128)
+
+// How far within the threshold the error of a level of detail must be to switch to it from a more detailed level
+#define MODEL_LOD_HYSTERESIS 0.75f
+
+// Estimates the size in pixels of a node on screen, or returns 0 if it is not known.
+static float getScreenSize(Node* node)
+{
+    Scene* scene = node->getScene();
+    Camera* camera = scene ? scene->getActiveCamera() : NULL;
+    if (camera == NULL || camera->getNode() == NULL)
+        return 0.0f;
+
+    const BoundingSphere& sphere = node->getBoundingSphere();
+    float viewportHeight = Game::getInstance()->getViewport().height;
+    if (camera->getCameraType() == Camera::ORTHOGRAPHIC)
+        return camera->getZoomY() > 0.0f ? sphere.radius * 2.0f * viewportHeight / camera->getZoomY() : 0.0f;
+
+    // The camera is inside the bounds of the node.
+    float distance = sphere.center.distance(camera->getNode()->getTranslationWorld());
+    if (distance <= sphere.radius)
+        return 0.0f;
+
+    return sphere.radius * viewportHeight / (distance * tanf(MATH_DEG_TO_RAD(camera->getFieldOfView()) * 0.5f));
+}
+
 Model::Model() : Drawable(),
-    _mesh(NULL), _material(NULL), _partCount(0), _partMaterials(NULL), _skin(NULL)
+    _mesh(NULL), _material(NULL), _partCount(0), _partMaterials(NULL), _fallbackMaterial(NULL), _skin(NULL),
+    _lodThreshold(1.0f), _forcedLod(-1), _lod(0), _clusterCulling(true)
 {
 }
 
 Model::Model(Mesh* mesh) : Drawable(),
-    _mesh(mesh), _material(NULL), _partCount(0), _partMaterials(NULL), _skin(NULL)
+    _mesh(mesh), _material(NULL), _partCount(0), _partMaterials(NULL), _fallbackMaterial(NULL), _skin(NULL),
+    _lodThreshold(1.0f), _forcedLod(-1), _lod(0), _clusterCulling(true)
 {
     GP_ASSERT(mesh);
     _partCount = mesh->getPartCount();
@@ -32,6 +63,7 @@ Model::~Model()
         }
         SAFE_DELETE_ARRAY(_partMaterials);
     }
+    SAFE_RELEASE(_fallbackMaterial);
     SAFE_RELEASE(_mesh);
     SAFE_DELETE(_skin);
 }
@@ -127,16 +159,7 @@ void Model::setMaterial(Material* material, int partIndex)
     // Release existing material and binding.
     if (oldMaterial)
     {
-        for (unsigned int i = 0, tCount = oldMaterial->getTechniqueCount(); i < tCount; ++i)
-        {
-            Technique* t = oldMaterial->getTechniqueByIndex(i);
-            GP_ASSERT(t);
-            for (unsigned int j = 0, pCount = t->getPassCount(); j < pCount; ++j)
-            {
-                GP_ASSERT(t->getPassByIndex(j));
-                t->getPassByIndex(j)->setVertexAttributeBinding(NULL);
-            }
-        }
+        releaseMaterialBindings(oldMaterial);
         SAFE_RELEASE(oldMaterial);
     }
 
@@ -151,7 +174,11 @@ void Model::setMaterial(Material* material, int partIndex)
             {
                 Pass* p = t->getPassByIndex(j);
                 GP_ASSERT(p);
-                VertexAttributeBinding* b = VertexAttributeBinding::create(_mesh, p->getEffect());
+
+                // Passes whose effect is still compiling are bound once it is ready (see prepareMaterial).
+                if (!p->getEffect()->isReady())
+                    continue;
+                VertexAttributeBinding* b = VertexAttributeBinding::create(getVertexMesh(), p->getEffect());
                 p->setVertexAttributeBinding(b);
                 SAFE_RELEASE(b);
             }
@@ -164,6 +191,43 @@ void Model::setMaterial(Material* material, int partIndex)
     }
 }
 
+void Model::releaseMaterialBindings(Material* material)
+{
+    GP_ASSERT(material);
+
+    for (unsigned int i = 0, tCount = material->getTechniqueCount(); i < tCount; ++i)
+    {
+        Technique* t = material->getTechniqueByIndex(i);
+        GP_ASSERT(t);
+        for (unsigned int j = 0, pCount = t->getPassCount(); j < pCount; ++j)
+        {
+            GP_ASSERT(t->getPassByIndex(j));
+            t->getPassByIndex(j)->setVertexAttributeBinding(NULL);
+        }
+    }
+}
+
+void Model::releaseAllMaterialBindings()
+{
+    if (_material)
+        releaseMaterialBindings(_material);
+    if (_fallbackMaterial)
+        releaseMaterialBindings(_fallbackMaterial);
+    if (_partMaterials)
+    {
+        for (unsigned int i = 0; i < _partCount; ++i)
+        {
+            if (_partMaterials[i])
+                releaseMaterialBindings(_partMaterials[i]);
+        }
+    }
+}
+
+Mesh* Model::getVertexMesh() const
+{
+    return _skin && _skin->_skinnedMesh ? _skin->_skinnedMesh : _mesh;
+}
+
 Material* Model::setMaterial(const char* vshPath, const char* fshPath, const char* defines, int partIndex)
 {
     // Try to create a Material with the given parameters.
@@ -207,6 +271,212 @@ bool Model::hasMaterial(unsigned int partIndex) const
     return (partIndex < _partCount && _partMaterials && _partMaterials[partIndex]);
 }
 
+void Model::setFallbackMaterial(Material* material)
+{
+    if (_fallbackMaterial == material)
+        return;
+
+    if (_fallbackMaterial)
+    {
+        releaseMaterialBindings(_fallbackMaterial);
+        SAFE_RELEASE(_fallbackMaterial);
+    }
+
+    _fallbackMaterial = material;
+    if (_fallbackMaterial)
+    {
+        _fallbackMaterial->addRef();
+        setMaterialNodeBinding(_fallbackMaterial);
+    }
+}
+
+Material* Model::getFallbackMaterial() const
+{
+    return _fallbackMaterial;
+}
+
+Material* Model::getDrawMaterial(int partIndex)
+{
+    Material* material = getMaterial(partIndex);
+    if (material == NULL || prepareMaterial(material))
+        return material;
+
+    // The material is still compiling, so draw the fallback material in its place.
+    if (_fallbackMaterial && prepareMaterial(_fallbackMaterial))
+        return _fallbackMaterial;
+    return NULL;
+}
+
+bool Model::prepareMaterial(Material* material)
+{
+    GP_ASSERT(material);
+
+    Technique* technique = material->getTechnique();
+    GP_ASSERT(technique);
+    unsigned int passCount = technique->getPassCount();
+    for (unsigned int i = 0; i < passCount; ++i)
+    {
+        Pass* pass = technique->getPassByIndex(i);
+        GP_ASSERT(pass);
+        if (!pass->getEffect()->isReady())
+            return false;
+    }
+
+    // Hookup the bindings that were skipped while the effects were compiling.
+    for (unsigned int i = 0; i < passCount; ++i)
+    {
+        Pass* pass = technique->getPassByIndex(i);
+        if (pass->getVertexAttributeBinding() == NULL)
+        {
+            VertexAttributeBinding* b = VertexAttributeBinding::create(getVertexMesh(), pass->getEffect());
+            pass->setVertexAttributeBinding(b);
+            SAFE_RELEASE(b);
+        }
+    }
+    return true;
+}
+
+void Model::setLodThreshold(float pixels)
+{
+    _lodThreshold = pixels > 0.0f ? pixels : 0.0f;
+}
+
+float Model::getLodThreshold() const
+{
+    return _lodThreshold;
+}
+
+void Model::setLod(int lod)
+{
+    _forcedLod = lod;
+}
+
+unsigned int Model::getLod() const
+{
+    return _lod;
+}
+
+void Model::setClusterCulling(bool enabled)
+{
+    _clusterCulling = enabled;
+}
+
+bool Model::isClusterCulling() const
+{
+    return _clusterCulling;
+}
+
+bool Model::drawClusters(MeshPart* part)
+{
+    GP_ASSERT(part);
+
+    unsigned int clusterCount = part->getClusterCount();
+    if (!_clusterCulling || clusterCount == 0 || _skin || _node == NULL)
+        return false;
+    Scene* scene = _node->getScene();
+    Camera* camera = scene ? scene->getActiveCamera() : NULL;
+    if (camera == NULL || camera->getNode() == NULL)
+        return false;
+
+    // The cones are tested in the space of the mesh, where the clusters are, and the spheres
+    // are tested against the frustum in world space.
+    const Matrix& world = _node->getWorldMatrix();
+    Matrix inverse;
+    if (!world.invert(&inverse))
+        return false;
+    bool orthographic = camera->getCameraType() == Camera::ORTHOGRAPHIC;
+    Vector3 eye;
+    if (orthographic)
+    {
+        inverse.transformVector(camera->getNode()->getForwardVectorWorld(), &eye);
+        eye.normalize();
+    }
+    else
+    {
+        inverse.transformPoint(camera->getNode()->getTranslationWorld(), &eye);
+    }
+    Vector3 scale;
+    world.getScale(&scale);
+    float radiusScale = std::max(fabs(scale.x), std::max(fabs(scale.y), fabs(scale.z)));
+    const Frustum& frustum = camera->getFrustum();
+
+    unsigned int indexSize = part->getIndexFormat() == Mesh::INDEX32 ? 4 : (part->getIndexFormat() == Mesh::INDEX16 ? 2 : 1);
+    unsigned int rangeStart = 0;
+    unsigned int rangeCount = 0;
+    for (unsigned int i = 0; i <= clusterCount; ++i)
+    {
+        bool visible = false;
+        if (i < clusterCount)
+        {
+            const MeshPart::Cluster& cluster = part->getCluster(i);
+            if (orthographic)
+            {
+                visible = Vector3::dot(eye, cluster.coneAxis) < cluster.coneCutoff;
+            }
+            else
+            {
+                Vector3 direction = cluster.center - eye;
+                visible = Vector3::dot(direction, cluster.coneAxis) < cluster.coneCutoff * direction.length() + cluster.radius;
+            }
+            if (visible)
+            {
+                BoundingSphere sphere;
+                world.transformPoint(cluster.center, &sphere.center);
+                sphere.radius = cluster.radius * radiusScale;
+                visible = frustum.intersects(sphere);
+            }
+
+            // Clusters that follow each other are drawn together.
+            if (visible && rangeCount > 0 && rangeStart + rangeCount == cluster.indexStart)
+            {
+                rangeCount += cluster.indexCount;
+                continue;
+            }
+        }
+
+        if (rangeCount > 0)
+        {
+            GraphicsDevice::drawElements(part->getPrimitiveType(), rangeCount, part->getIndexFormat(), (GLvoid*)(size_t)(part->getIndexOffset() + rangeStart * indexSize));
+            rangeCount = 0;
+        }
+        if (visible)
+        {
+            const MeshPart::Cluster& cluster = part->getCluster(i);
+            rangeStart = cluster.indexStart;
+            rangeCount = cluster.indexCount;
+        }
+    }
+    return true;
+}
+
+void Model::selectLod(float screenSize)
+{
+    GP_ASSERT(_mesh);
+
+    unsigned int lodCount = _mesh->getLodCount();
+    if (_forcedLod >= 0)
+    {
+        _lod = std::min((unsigned int)_forcedLod, lodCount - 1);
+        return;
+    }
+
+    // Draw the mesh itself when the size on screen is not known, such as when the camera is inside the model.
+    if (screenSize <= 0.0f)
+    {
+        _lod = 0;
+        return;
+    }
+
+    // The errors of the levels are relative to the radius of the mesh, which is half of the size on screen.
+    float radius = screenSize * 0.5f;
+    if (_lod >= lodCount)
+        _lod = lodCount - 1;
+    while (_lod > 0 && _mesh->getLodError(_lod) * radius > _lodThreshold)
+        --_lod;
+    while (_lod + 1 < lodCount && _mesh->getLodError(_lod + 1) * radius <= _lodThreshold * MODEL_LOD_HYSTERESIS)
+        ++_lod;
+}
+
 MeshSkin* Model::getSkin() const
 {
     return _skin;
@@ -216,6 +486,10 @@ void Model::setSkin(MeshSkin* skin)
 {
     if (_skin != skin)
     {
+        // Materials bound to the pre-skinned vertices of the old skin are bound to the mesh again.
+        if (_skin && _skin->_skinnedMesh)
+            releaseAllMaterialBindings();
+
         // Free the old skin
         SAFE_DELETE(_skin);
 
@@ -237,6 +511,10 @@ void Model::setNode(Node* node)
         {
            setMaterialNodeBinding(_material);
         }
+        if (_fallbackMaterial)
+        {
+            setMaterialNodeBinding(_fallbackMaterial);
+        }
         if (_partMaterials)
         {
             for (unsigned int i = 0; i < _partCount; ++i)
@@ -259,7 +537,7 @@ static bool drawWireframe(Mesh* mesh)
             unsigned int vertexCount = mesh->getVertexCount();
             for (unsigned int i = 0; i < vertexCount; i += 3)
             {
-                GL_ASSERT( glDrawArrays(GL_LINE_LOOP, i, 3) );
+                GraphicsDevice::drawArrays(GL_LINE_LOOP, i, 3);
             }
         }
         return true;
@@ -269,7 +547,7 @@ static bool drawWireframe(Mesh* mesh)
             unsigned int vertexCount = mesh->getVertexCount();
             for (unsigned int i = 2; i < vertexCount; ++i)
             {
-                GL_ASSERT( glDrawArrays(GL_LINE_LOOP, i-2, 3) );
+                GraphicsDevice::drawArrays(GL_LINE_LOOP, i-2, 3);
             }
         }
         return true;
@@ -306,7 +584,7 @@ static bool drawWireframe(MeshPart* part)
         {
             for (size_t i = 0; i < indexCount; i += 3)
             {
-                GL_ASSERT( glDrawElements(GL_LINE_LOOP, 3, part->getIndexFormat(), ((const GLvoid*)(i*indexSize))) );
+                GraphicsDevice::drawElements(GL_LINE_LOOP, 3, part->getIndexFormat(), ((const GLvoid*)(part->getIndexOffset() + i*indexSize)));
             }
         }
         return true;
@@ -315,7 +593,7 @@ static bool drawWireframe(MeshPart* part)
         {
             for (size_t i = 2; i < indexCount; ++i)
             {
-                GL_ASSERT( glDrawElements(GL_LINE_LOOP, 3, part->getIndexFormat(), ((const GLvoid*)((i-2)*indexSize))) );
+                GraphicsDevice::drawElements(GL_LINE_LOOP, 3, part->getIndexFormat(), ((const GLvoid*)(part->getIndexOffset() + (i-2)*indexSize)));
             }
         }
         return true;
@@ -334,22 +612,15 @@ unsigned int Model::draw(bool wireframe)
     if (partCount == 0)
     {
         // No mesh parts (index buffers).
-        if (_material)
+        Material* material = getDrawMaterial(-1);
+        if (material)
         {
-            Technique* technique = _material->getTechnique();
+            Technique* technique = material->getTechnique();
             GP_ASSERT(technique);
             unsigned int passCount = technique->getPassCount();
             for (unsigned int i = 0; i < passCount; ++i)
             {
-                Pass* pass = technique->getPassByIndex(i);
-                GP_ASSERT(pass);
-                pass->bind();
-                GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0) );
-                if (!wireframe || !drawWireframe(_mesh))
-                {
-                    GL_ASSERT( glDrawArrays(_mesh->getPrimitiveType(), 0, _mesh->getVertexCount()) );
-                }
-                pass->unbind();
+                drawPart(-1, technique->getPassByIndex(i), wireframe);
             }
         }
     }
@@ -357,11 +628,8 @@ unsigned int Model::draw(bool wireframe)
     {
         for (unsigned int i = 0; i < partCount; ++i)
         {
-            MeshPart* part = _mesh->getPart(i);
-            GP_ASSERT(part);
-
             // Get the material for this mesh part.
-            Material* material = getMaterial(i);
+            Material* material = getDrawMaterial((int)i);
             if (material)
             {
                 Technique* technique = material->getTechnique();
@@ -369,15 +637,7 @@ unsigned int Model::draw(bool wireframe)
                 unsigned int passCount = technique->getPassCount();
                 for (unsigned int j = 0; j < passCount; ++j)
                 {
-                    Pass* pass = technique->getPassByIndex(j);
-                    GP_ASSERT(pass);
-                    pass->bind();
-                    GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, part->_indexBuffer) );
-                    if (!wireframe || !drawWireframe(part))
-                    {
-                        GL_ASSERT( glDrawElements(part->getPrimitiveType(), part->getIndexCount(), part->getIndexFormat(), 0) );
-                    }
-                    pass->unbind();
+                    drawPart((int)i, technique->getPassByIndex(j), wireframe);
                 }
             }
         }
@@ -385,6 +645,96 @@ unsigned int Model::draw(bool wireframe)
     return partCount;
 }
 
+unsigned int Model::drawMeshPart(unsigned int partIndex, bool wireframe)
+{
+    GP_ASSERT(_mesh);
+    GP_ASSERT(partIndex < _mesh->getPartCount());
+
+    Material* material = getDrawMaterial((int)partIndex);
+    if (!material)
+        return 0;
+
+    Technique* technique = material->getTechnique();
+    GP_ASSERT(technique);
+    unsigned int passCount = technique->getPassCount();
+    for (unsigned int i = 0; i < passCount; ++i)
+    {
+        drawPart((int)partIndex, technique->getPassByIndex(i), wireframe);
+    }
+    return 1;
+}
+
+void Model::drawPart(int partIndex, Pass* pass, bool wireframe)
+{
+    GP_ASSERT(_mesh);
+    GP_ASSERT(pass);
+
+    // Streamed meshes are not drawn until their data is loaded, which drawing them starts.
+    if (_mesh->_streamEntry && !Game::getInstance()->getMeshStreamer()->use(_mesh->_streamEntry))
+        return;
+
+    // Pre-skinned vertices are skinned once for all passes of the frame.
+    if (_skin && _skin->_skinnedMesh)
+        _skin->updatePreSkinnedMesh();
+
+    // The depth variants of passes are created after the material is set, so they are bound
+    // to the mesh the first time they are drawn.
+    if (pass->getVertexAttributeBinding() == NULL && pass->getEffect()->isReady())
+    {
+        VertexAttributeBinding* b = VertexAttributeBinding::create(getVertexMesh(), pass->getEffect());
+        pass->setVertexAttributeBinding(b);
+        SAFE_RELEASE(b);
+    }
+
+    // Streamed textures and the levels of detail of the mesh are selected by the size of the model on screen.
+    TextureStreamer* streamer = Game::getInstance()->getTextureStreamer();
+    bool streaming = _node && streamer && streamer->getTextureCount() > 0;
+    bool lods = partIndex >= 0 && _mesh->getLodCount() > 1;
+    float screenSize = _node && (streaming || (lods && _forcedLod < 0)) ? getScreenSize(_node) : 0.0f;
+    if (lods)
+        selectLod(screenSize);
+
+    // While draws are recorded, the values of the parameters are recorded and the part is drawn when they are replayed.
+    RenderCommandList* commands = RenderCommandList::getRecording();
+    if (commands)
+    {
+        commands->drawPart(this, partIndex, pass, wireframe, streaming ? screenSize : 0.0f);
+        return;
+    }
+
+    if (streaming)
+        TextureStreamer::setScreenSize(screenSize);
+    pass->bind();
+    if (streaming)
+        TextureStreamer::setScreenSize(0.0f);
+    drawMesh(partIndex, wireframe);
+    pass->unbind();
+}
+
+void Model::drawMesh(int partIndex, bool wireframe)
+{
+    GP_ASSERT(_mesh);
+
+    if (partIndex < 0)
+    {
+        RenderState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        if (!wireframe || !drawWireframe(_mesh))
+        {
+            GraphicsDevice::drawArrays(_mesh->getPrimitiveType(), 0, _mesh->getVertexCount());
+        }
+    }
+    else
+    {
+        MeshPart* part = _mesh->getLodPart(_lod, (unsigned int)partIndex);
+        GP_ASSERT(part);
+        RenderState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, part->_indexBuffer);
+        if (wireframe ? !drawWireframe(part) : !drawClusters(part))
+        {
+            GraphicsDevice::drawElements(part->getPrimitiveType(), part->getIndexCount(), part->getIndexFormat(), (GLvoid*)(size_t)part->getIndexOffset());
+        }
+    }
+}
+
 void Model::setMaterialNodeBinding(Material *material)
 {
     GP_ASSERT(material);
@@ -407,6 +757,8 @@ Drawable* Model::clone(NodeCloneContext& context)
     if (getSkin())
     {
         model->setSkin(getSkin()->clone(context));
+        if (getSkin()->isPreSkinning())
+            model->getSkin()->setPreSkinning(true, getSkin()->_skinnedDualQuaternion);
     }
     if (getMaterial())
     {
@@ -432,6 +784,15 @@ Drawable* Model::clone(NodeCloneContext& context)
             }
         }
     }
+    if (_fallbackMaterial)
+    {
+        Material* materialClone = _fallbackMaterial->clone(context);
+        model->setFallbackMaterial(materialClone);
+        materialClone->release();
+    }
+    model->_lodThreshold = _lodThreshold;
+    model->_forcedLod = _forcedLod;
+    model->_clusterCulling = _clusterCulling;
     return model;
 }
 
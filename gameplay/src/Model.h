@@ -5,6 +5,7 @@
 #include "MeshSkin.h"
 #include "Material.h"
 #include "Drawable.h"
+#include "MemoryPool.h"
 
 namespace gameplay
 {
@@ -25,6 +26,13 @@ class Model : public Ref, public Drawable
     friend class Scene;
     friend class Mesh;
     friend class Bundle;
+    friend class RenderQueue;
+    friend class RenderCommandList;
+    friend class InstancedModel;
+    friend class MeshSkin;
+    friend class ShadowMaps;
+    friend class Impostor;
+    friend class PlanarReflection;
 
 public:
 
@@ -34,6 +42,13 @@ public:
      */
     static Model* create(Mesh* mesh);
 
+    /**
+     * Allocates models from a memory pool.
+     *
+     * @script{ignore}
+     */
+    GP_POOL_ALLOCATED();
+
     /**
      * Returns the Mesh for this Model.
      *
@@ -123,6 +138,27 @@ public:
      */
     bool hasMaterial(unsigned int partIndex) const;
 
+    /**
+     * Sets the material that is drawn in place of materials whose effects are still compiling.
+     *
+     * Materials created with Material::createAsync are not ready to draw until their
+     * shaders have finished compiling. Until then, mesh parts using such a material are
+     * drawn with the fallback material, or are not drawn at all if there is no fallback
+     * material (or it is not ready either).
+     *
+     * @param material The fallback material, or NULL to skip drawing parts that are not ready.
+     * @script{ignore}
+     */
+    void setFallbackMaterial(Material* material);
+
+    /**
+     * Returns the material that is drawn in place of materials whose effects are still compiling.
+     *
+     * @return The fallback material, or NULL if one is not set.
+     * @script{ignore}
+     */
+    Material* getFallbackMaterial() const;
+
     /**
      * Returns the MeshSkin.
      *
@@ -130,6 +166,64 @@ public:
      */
     MeshSkin* getSkin() const;
 
+    /**
+     * Sets how large the error of a level of detail of the mesh may appear on screen.
+     *
+     * When the mesh has levels of detail, each part is drawn with the least detailed level
+     * whose error, projected with the active camera of the scene, is within the threshold.
+     * Levels only become less detailed once their error is well within the threshold,
+     * so that models near a switching distance don't switch back and forth.
+     *
+     * @param pixels The largest error allowed, in pixels (1 by default).
+     * @script{ignore}
+     */
+    void setLodThreshold(float pixels);
+
+    /**
+     * Returns how large the error of a level of detail of the mesh may appear on screen.
+     *
+     * @return The largest error allowed, in pixels.
+     * @script{ignore}
+     */
+    float getLodThreshold() const;
+
+    /**
+     * Sets the level of detail of the mesh to draw, instead of selecting it by screen size.
+     *
+     * @param lod The level of detail to draw, or -1 to select it by screen size.
+     * @script{ignore}
+     */
+    void setLod(int lod);
+
+    /**
+     * Returns the level of detail of the mesh that was drawn last.
+     *
+     * @return The level of detail, which is 0 for the mesh itself.
+     * @script{ignore}
+     */
+    unsigned int getLod() const;
+
+    /**
+     * Sets whether the clusters of the mesh parts are culled before they are drawn.
+     *
+     * When a part of the mesh is split into clusters, the clusters that are outside the
+     * frustum of the active camera of the scene, or whose triangles all face away from it,
+     * are not drawn, and the ranges of clusters that are left are drawn with a draw call each.
+     * Clusters are not culled for models with a skin, since skinning moves their vertices.
+     *
+     * @param enabled true to cull the clusters of mesh parts (the default), false to draw them all.
+     * @script{ignore}
+     */
+    void setClusterCulling(bool enabled);
+
+    /**
+     * Returns whether the clusters of the mesh parts are culled before they are drawn.
+     *
+     * @return true if the clusters of mesh parts are culled.
+     * @script{ignore}
+     */
+    bool isClusterCulling() const;
+
     /**
      * @see Drawable::draw
      *
@@ -141,6 +235,20 @@ public:
      */
     unsigned int draw(bool wireframe = false);
 
+    /**
+     * Draws one mesh part of this model with its material.
+     *
+     * This is used for meshes whose parts are alternatives to each other, such as the
+     * levels of detail of a terrain patch that share the vertices of their mesh.
+     *
+     * @param partIndex The index of the mesh part to draw.
+     * @param wireframe true to draw the part as wireframe.
+     *
+     * @return The number of draw calls, which is 1 if the part has a material and 0 otherwise.
+     * @script{ignore}
+     */
+    unsigned int drawMeshPart(unsigned int partIndex, bool wireframe = false);
+
 private:
 
     /**
@@ -185,13 +293,79 @@ private:
      */
     void setMaterialNodeBinding(Material *m);
 
+    /**
+     * Returns the material that the specified mesh part is currently drawn with.
+     *
+     * This is the material of the part if all effects of its current technique are
+     * ready, otherwise the fallback material if it is ready, otherwise NULL.
+     */
+    Material* getDrawMaterial(int partIndex);
+
+    /**
+     * Determines if the effects of the current technique of the material are ready and
+     * creates the vertex attribute bindings of passes that became ready since the material was set.
+     */
+    bool prepareMaterial(Material* material);
+
+    /**
+     * Clears the vertex attribute bindings that were set up for the specified material.
+     */
+    void releaseMaterialBindings(Material* material);
+
+    /**
+     * Clears the vertex attribute bindings of all materials of the model, which are set up
+     * again when the materials are next drawn.
+     */
+    void releaseAllMaterialBindings();
+
+    /**
+     * Returns the mesh whose vertices the materials are bound to, which is the
+     * pre-skinned mesh of the skin when pre-skinning is enabled.
+     */
+    Mesh* getVertexMesh() const;
+
+    /**
+     * Draws a single mesh part of this model with the specified pass.
+     *
+     * The pass is bound before and unbound after the draw call. This allows
+     * the parts of a model to be submitted individually (e.g. by a RenderQueue).
+     *
+     * @param partIndex The index of the mesh part to draw, or -1 to draw the
+     *      mesh vertices directly when the mesh has no parts.
+     * @param pass The pass to draw the part with.
+     * @param wireframe true to draw the part as wireframe.
+     */
+    void drawPart(int partIndex, Pass* pass, bool wireframe);
+
+    /**
+     * Issues the draw call of a single mesh part of this model, once its pass is bound.
+     */
+    void drawMesh(int partIndex, bool wireframe);
+
     void validatePartCount();
 
+    /**
+     * Selects the level of detail to draw from the size of the model on the screen.
+     */
+    void selectLod(float screenSize);
+
+    /**
+     * Draws the clusters of a mesh part that are not culled, once its index buffer is bound.
+     *
+     * @return false if the clusters of the part can't be culled, and it should be drawn as a whole.
+     */
+    bool drawClusters(MeshPart* part);
+
     Mesh* _mesh;
     Material* _material;
     unsigned int _partCount;
     Material** _partMaterials;
+    Material* _fallbackMaterial;
     MeshSkin* _skin;
+    float _lodThreshold;
+    int _forcedLod;
+    unsigned int _lod;
+    bool _clusterCulling;
 };
 
 }
@@ -13,6 +13,7 @@
 #include "Drawable.h"
 #include "Form.h"
 #include "Ref.h"
+#include "SpatialIndex.h"
 
 // Node dirty flags
 #define NODE_DIRTY_WORLD 1
@@ -20,23 +21,38 @@
 #define NODE_DIRTY_HIERARCHY 4
 #define NODE_DIRTY_ALL (NODE_DIRTY_WORLD | NODE_DIRTY_BOUNDS | NODE_DIRTY_HIERARCHY)
 
+// Node::DerivedMatrices valid bits
+#define NODE_DERIVED_WORLD_VIEW 1
+#define NODE_DERIVED_WORLD_VIEW_PROJECTION 2
+#define NODE_DERIVED_INVERSE_TRANSPOSE_WORLD_VIEW 4
+#define NODE_DERIVED_INVERSE_TRANSPOSE_WORLD 8
+#define NODE_DERIVED_CAMERA (NODE_DERIVED_WORLD_VIEW | NODE_DERIVED_WORLD_VIEW_PROJECTION | NODE_DERIVED_INVERSE_TRANSPOSE_WORLD_VIEW)
+
 namespace gameplay
 {
 
+GP_POOL_ALLOCATED_IMPLEMENT(Node, 256)
+
 Node::Node(const char* id)
     : _scene(NULL), _firstChild(NULL), _nextSibling(NULL), _prevSibling(NULL), _parent(NULL), _childCount(0), _enabled(true), _tags(NULL),
     _drawable(NULL), _camera(NULL), _light(NULL), _audioSource(NULL), _collisionObject(NULL), _agent(NULL), _userObject(NULL),
-      _dirtyBits(NODE_DIRTY_ALL)
+      _dirtyBits(NODE_DIRTY_ALL), _spatialIndex(NULL), _spatialProxy(-1), _lightSelection(NULL), _lightChangeQueued(false),
+      _derivedMatrices(NULL), _frozen(false)
 {
     GP_REGISTER_SCRIPT_EVENTS();
+
+    for (unsigned int i = 0; i < NODE_COMPONENT_COUNT; ++i)
+        _componentSlots[i] = -1;
     if (id)
     {
-        _id = id;
+        _id = StringId(id);
     }
 }
 
 Node::~Node()
 {
+    if (_spatialIndex)
+        _spatialIndex->remove(this);
     removeAllChildren();
     if (_drawable)
         _drawable->setNode(NULL);
@@ -50,6 +66,8 @@ Node::~Node()
     SAFE_DELETE(_collisionObject);
     SAFE_RELEASE(_userObject);
     SAFE_DELETE(_tags);
+    SAFE_DELETE(_lightSelection);
+    SAFE_DELETE(_derivedMatrices);
     setAgent(NULL);
 }
 
@@ -68,11 +86,28 @@ const char* Node::getId() const
     return _id.c_str();
 }
 
+const StringId& Node::getStringId() const
+{
+    return _id;
+}
+
 void Node::setId(const char* id)
 {
     if (id)
     {
-        _id = id;
+        // Keep the node index of our scene up to date, if there is one.
+        Scene* scene = getScene();
+        if (scene && scene->_nodeIndex)
+        {
+            scene->unindexNode(this, _id);
+            _id = StringId(id);
+            if (!_id.empty())
+                scene->_nodeIndex->insert(std::make_pair(_id, this));
+        }
+        else
+        {
+            _id = StringId(id);
+        }
     }
 }
 
@@ -122,6 +157,18 @@ void Node::addChild(Node* child)
     ++_childCount;
     setBoundsDirty();
 
+    // Index the new child in the spatial index of our scene, if there is one.
+    Scene* scene = getScene();
+    if (scene)
+    {
+        scene->_transformOrderDirty = true;
+        if (scene->_spatialIndex)
+        {
+            child->setSpatialIndex(scene->_spatialIndex);
+        }
+        scene->indexNodes(child);
+    }
+
     if (_dirtyBits & NODE_DIRTY_HIERARCHY)
     {
         hierarchyChanged();
@@ -153,6 +200,18 @@ void Node::removeAllChildren()
 
 void Node::remove()
 {
+    // Nodes that are no longer part of a scene are not indexed.
+    Scene* scene = getScene();
+    if (scene)
+    {
+        scene->_transformOrderDirty = true;
+        if (scene->_spatialIndex)
+        {
+            setSpatialIndex(NULL);
+        }
+        scene->unindexNodes(this);
+    }
+
     // Re-link our neighbours.
     if (_prevSibling)
     {
@@ -182,6 +241,23 @@ void Node::remove()
     }
 }
 
+void Node::componentsChanged()
+{
+    Scene* scene = getScene();
+    if (scene)
+        scene->updateComponents(this);
+}
+
+void Node::lightChanged()
+{
+    Scene* scene = getScene();
+    if (_light && scene && !_lightChangeQueued)
+    {
+        _lightChangeQueued = true;
+        scene->_changedLights.push_back(this);
+    }
+}
+
 Node* Node::getFirstChild() const
 {
     return _firstChild;
@@ -221,6 +297,30 @@ Node* Node::findNode(const char* id, bool recursive, bool exactMatch) const
 {
     GP_ASSERT(id);
 
+    // No node can have an ID that was never interned.
+    StringId stringId;
+    if (!exactMatch)
+        stringId = StringId(id);
+    else if (!StringId::find(id, &stringId))
+        return NULL;
+    return findNode(stringId, recursive, exactMatch);
+}
+
+Node* Node::findNode(const StringId& id, bool recursive, bool exactMatch) const
+{
+
+    // Look the node up in the node index of our scene, if there is one.
+    if (recursive)
+    {
+        Scene* scene = getScene();
+        if (scene && scene->_nodeIndex)
+        {
+            Node* match = scene->findIndexedNode(id, exactMatch, this);
+            if (match)
+                return match;
+        }
+    }
+
     // If the drawable is a model with a mesh skin, search the skin's hierarchy as well.
     Node* rootNode = NULL;
     Model* model = dynamic_cast<Model*>(_drawable);
@@ -228,7 +328,7 @@ Node* Node::findNode(const char* id, bool recursive, bool exactMatch) const
     {
         if (model->getSkin() != NULL && (rootNode = model->getSkin()->_rootNode) != NULL)
         {
-            if ((exactMatch && rootNode->_id == id) || (!exactMatch && rootNode->_id.find(id) == 0))
+            if ((exactMatch && rootNode->_id == id) || (!exactMatch && rootNode->_id.startsWith(id)))
                 return rootNode;
 
             Node* match = rootNode->findNode(id, true, exactMatch);
@@ -242,7 +342,7 @@ Node* Node::findNode(const char* id, bool recursive, bool exactMatch) const
     for (Node* child = getFirstChild(); child != NULL; child = child->getNextSibling())
     {
         // Does this child's ID match?
-        if ((exactMatch && child->_id == id) || (!exactMatch && child->_id.find(id) == 0))
+        if ((exactMatch && child->_id == id) || (!exactMatch && child->_id.startsWith(id)))
         {
             return child;
         }
@@ -266,6 +366,17 @@ unsigned int Node::findNodes(const char* id, std::vector<Node*>& nodes, bool rec
 {
     GP_ASSERT(id);
 
+    StringId stringId;
+    if (!exactMatch)
+        stringId = StringId(id);
+    else if (!StringId::find(id, &stringId))
+        return 0;
+    return findNodes(stringId, nodes, recursive, exactMatch);
+}
+
+unsigned int Node::findNodes(const StringId& id, std::vector<Node*>& nodes, bool recursive, bool exactMatch) const
+{
+
     // If the drawable is a model with a mesh skin, search the skin's hierarchy as well.
     unsigned int count = 0;
     Node* rootNode = NULL;
@@ -274,7 +385,7 @@ unsigned int Node::findNodes(const char* id, std::vector<Node*>& nodes, bool rec
     {
         if (model->getSkin() != NULL && (rootNode = model->getSkin()->_rootNode) != NULL)
         {
-            if ((exactMatch && rootNode->_id == id) || (!exactMatch && rootNode->_id.find(id) == 0))
+            if ((exactMatch && rootNode->_id == id) || (!exactMatch && rootNode->_id.startsWith(id)))
             {
                 nodes.push_back(rootNode);
                 ++count;
@@ -286,7 +397,7 @@ unsigned int Node::findNodes(const char* id, std::vector<Node*>& nodes, bool rec
     for (Node* child = getFirstChild(); child != NULL; child = child->getNextSibling())
     {
         // Does this child's ID match?
-        if ((exactMatch && child->_id == id) || (!exactMatch && child->_id.find(id) == 0))
+        if ((exactMatch && child->_id == id) || (!exactMatch && child->_id.startsWith(id)))
         {
             nodes.push_back(child);
             ++count;
@@ -332,7 +443,7 @@ const char* Node::getTag(const char* name) const
     if (!_tags)
         return NULL;
 
-    std::map<std::string, std::string>::const_iterator itr = _tags->find(name);
+    std::map<std::string, std::string, std::less<std::string>, PoolAllocator<std::pair<const std::string, std::string> > >::const_iterator itr = _tags->find(name);
     return (itr == _tags->end() ? NULL : itr->second.c_str());
 }
 
@@ -340,11 +451,16 @@ void Node::setTag(const char* name, const char* value)
 {
     GP_ASSERT(name);
 
+    // Keep the tagged nodes of our scene up to date, if we are in one.
+    Scene* scene = getScene();
+
     if (value == NULL)
     {
         // Removing tag
         if (_tags)
         {
+            if (scene && _tags->find(name) != _tags->end())
+                scene->removeTaggedNode(this, name);
             _tags->erase(name);
             if (_tags->size() == 0)
             {
@@ -357,8 +473,10 @@ void Node::setTag(const char* name, const char* value)
         // Setting tag
         if (_tags == NULL)
         {
-            _tags = new std::map<std::string, std::string>();
+            _tags = new std::map<std::string, std::string, std::less<std::string>, PoolAllocator<std::pair<const std::string, std::string> > >();
         }
+        if (scene && _tags->find(name) == _tags->end())
+            scene->addTaggedNode(this, name);
         (*_tags)[name] = value;
     }
 }
@@ -372,6 +490,11 @@ void Node::setEnabled(bool enabled)
             _collisionObject->setEnabled(enabled);
         }
         _enabled = enabled;
+
+        // The lights of disabled nodes are not selected, and this node may have lights below it.
+        Scene* scene = getScene();
+        if (scene && !scene->_componentNodes[Scene::LIGHT].empty())
+            scene->invalidateNodeLights();
     }
 }
 
@@ -411,16 +534,72 @@ void Node::update(float elapsedTime)
 
 bool Node::isStatic() const
 {
-    return (_collisionObject && _collisionObject->isStatic());
+    return _frozen || (_collisionObject && _collisionObject->isStatic());
+}
+
+void Node::freeze()
+{
+    if (_frozen)
+        return;
+
+    // Resolve the world matrix and bounds while the node may still follow its parent.
+    getWorldMatrix();
+    getBoundingSphere();
+    _frozen = true;
+
+    Scene* scene = getScene();
+    if (scene)
+        scene->_transformOrderDirty = true;
+    if (_spatialIndex)
+        _spatialIndex->freeze(this);
+}
+
+bool Node::isFrozen() const
+{
+    return _frozen;
+}
+
+void Node::thaw()
+{
+    if (!_frozen)
+        return;
+    _frozen = false;
+
+    Scene* scene = getScene();
+    if (scene)
+        scene->_transformOrderDirty = true;
+    if (_spatialIndex)
+        _spatialIndex->thaw(this);
 }
 
 const Matrix& Node::getWorldMatrix() const
+{
+    if (_dirtyBits & NODE_DIRTY_WORLD)
+    {
+        updateWorldMatrix();
+
+        if (!isStatic())
+        {
+            // Our world matrix was just updated, so call getWorldMatrix() on all child nodes
+            // to force their resolved world matrices to be updated.
+            for (Node* child = getFirstChild(); child != NULL; child = child->getNextSibling())
+            {
+                child->getWorldMatrix();
+            }
+        }
+    }
+    return _world;
+}
+
+void Node::updateWorldMatrix() const
 {
     if (_dirtyBits & NODE_DIRTY_WORLD)
     {
         // Clear our dirty flag immediately to prevent this block from being entered if our
         // parent calls our getWorldMatrix() method as a result of the following calculations.
         _dirtyBits &= ~NODE_DIRTY_WORLD;
+        if (_derivedMatrices)
+            _derivedMatrices->valid = 0;
 
         if (!isStatic())
         {
@@ -429,47 +608,74 @@ const Matrix& Node::getWorldMatrix() const
             Node* parent = getParent();
             if (parent && (!_collisionObject || _collisionObject->isKinematic()))
             {
-                Matrix::multiply(parent->getWorldMatrix(), getMatrix(), &_world);
+                Matrix::multiplyAffine(parent->getWorldMatrix(), getMatrix(), &_world);
             }
             else
             {
                 _world = getMatrix();
             }
-
-            // Our world matrix was just updated, so call getWorldMatrix() on all child nodes
-            // to force their resolved world matrices to be updated.
-            for (Node* child = getFirstChild(); child != NULL; child = child->getNextSibling())
-            {
-                child->getWorldMatrix();
-            }
         }
     }
-    return _world;
+}
+
+Node::DerivedMatrices* Node::getDerivedMatrices() const
+{
+    // Resolving the world matrix clears the matrices derived from the old one.
+    getWorldMatrix();
+    if (_derivedMatrices == NULL)
+    {
+        _derivedMatrices = new DerivedMatrices();
+        _derivedMatrices->cameraVersion = 0;
+        _derivedMatrices->valid = 0;
+    }
+
+    // The versions of cameras are unique, so a change of the active camera is seen as well.
+    Scene* scene = getScene();
+    Camera* camera = scene ? scene->getActiveCamera() : NULL;
+    unsigned int cameraVersion = camera ? camera->_version : 0;
+    if (_derivedMatrices->cameraVersion != cameraVersion)
+    {
+        _derivedMatrices->cameraVersion = cameraVersion;
+        _derivedMatrices->valid &= ~NODE_DERIVED_CAMERA;
+    }
+    return _derivedMatrices;
 }
 
 const Matrix& Node::getWorldViewMatrix() const
 {
-    static Matrix worldView;
-    Matrix::multiply(getViewMatrix(), getWorldMatrix(), &worldView);
-    return worldView;
+    DerivedMatrices* derived = getDerivedMatrices();
+    if ((derived->valid & NODE_DERIVED_WORLD_VIEW) == 0)
+    {
+        Matrix::multiplyAffine(getViewMatrix(), getWorldMatrix(), &derived->worldView);
+        derived->valid |= NODE_DERIVED_WORLD_VIEW;
+    }
+    return derived->worldView;
 }
 
 const Matrix& Node::getInverseTransposeWorldViewMatrix() const
 {
-    static Matrix invTransWorldView;
-    Matrix::multiply(getViewMatrix(), getWorldMatrix(), &invTransWorldView);
-    invTransWorldView.invert();
-    invTransWorldView.transpose();
-    return invTransWorldView;
+    DerivedMatrices* derived = getDerivedMatrices();
+    if ((derived->valid & NODE_DERIVED_INVERSE_TRANSPOSE_WORLD_VIEW) == 0)
+    {
+        derived->inverseTransposeWorldView = getWorldViewMatrix();
+        derived->inverseTransposeWorldView.invert();
+        derived->inverseTransposeWorldView.transpose();
+        derived->valid |= NODE_DERIVED_INVERSE_TRANSPOSE_WORLD_VIEW;
+    }
+    return derived->inverseTransposeWorldView;
 }
 
 const Matrix& Node::getInverseTransposeWorldMatrix() const
 {
-    static Matrix invTransWorld;
-    invTransWorld = getWorldMatrix();
-    invTransWorld.invert();
-    invTransWorld.transpose();
-    return invTransWorld;
+    DerivedMatrices* derived = getDerivedMatrices();
+    if ((derived->valid & NODE_DERIVED_INVERSE_TRANSPOSE_WORLD) == 0)
+    {
+        derived->inverseTransposeWorld = getWorldMatrix();
+        derived->inverseTransposeWorld.invert();
+        derived->inverseTransposeWorld.transpose();
+        derived->valid |= NODE_DERIVED_INVERSE_TRANSPOSE_WORLD;
+    }
+    return derived->inverseTransposeWorld;
 }
 
 const Matrix& Node::getViewMatrix() const
@@ -541,11 +747,13 @@ const Matrix& Node::getInverseViewProjectionMatrix() const
 
 const Matrix& Node::getWorldViewProjectionMatrix() const
 {
-    // Always re-calculate worldViewProjection matrix since it's extremely difficult
-    // to track whether the camera has changed (it may frequently change every frame).
-    static Matrix worldViewProj;
-    Matrix::multiply(getViewProjectionMatrix(), getWorldMatrix(), &worldViewProj);
-    return worldViewProj;
+    DerivedMatrices* derived = getDerivedMatrices();
+    if ((derived->valid & NODE_DERIVED_WORLD_VIEW_PROJECTION) == 0)
+    {
+        Matrix::multiply(getViewProjectionMatrix(), getWorldMatrix(), &derived->worldViewProjection);
+        derived->valid |= NODE_DERIVED_WORLD_VIEW_PROJECTION;
+    }
+    return derived->worldViewProjection;
 }
 
 Vector3 Node::getTranslationWorld() const
@@ -632,12 +840,22 @@ void Node::hierarchyChanged()
 {
     // When our hierarchy changes our world transform is affected, so we must dirty it.
     _dirtyBits |= NODE_DIRTY_HIERARCHY;
-    transformChanged();
+    if (Transform::isTransformChangedSuspended())
+    {
+        // Notify once when the changes are resumed, as for the other changes to the transform.
+        if (!isDirty(Transform::DIRTY_NOTIFY))
+            suspendTransformChange(this);
+    }
+    else
+    {
+        transformChanged();
+    }
 }
 
 void Node::transformChanged()
 {
     // Our local transform was changed, so mark our world matrices dirty.
+    thaw();
     _dirtyBits |= NODE_DIRTY_WORLD | NODE_DIRTY_BOUNDS;
 
     // Notify our children that their transform has also changed (since transforms are inherited).
@@ -657,14 +875,40 @@ void Node::transformChanged()
             n->transformChanged();
         }
     }
+    if (_spatialIndex)
+        _spatialIndex->update(this);
+    if (_lightSelection)
+        _lightSelection->version = 0;
+    if (_light)
+        lightChanged();
+
     Transform::transformChanged();
 }
 
+void Node::setStaticBounds(const Matrix& world, const BoundingSphere& bounds)
+{
+    _world = world;
+    _bounds = bounds;
+    _dirtyBits &= ~(NODE_DIRTY_WORLD | NODE_DIRTY_BOUNDS);
+    if (_derivedMatrices)
+        _derivedMatrices->valid = 0;
+
+    if (_spatialIndex)
+        _spatialIndex->update(this);
+    freeze();
+}
+
 void Node::setBoundsDirty()
 {
     // Mark ourself and our parent nodes as dirty
+    thaw();
     _dirtyBits |= NODE_DIRTY_BOUNDS;
 
+    if (_spatialIndex)
+        _spatialIndex->update(this);
+    if (_lightSelection)
+        _lightSelection->version = 0;
+
     // Mark our parent bounds as dirty as well
     if (_parent)
         _parent->setBoundsDirty();
@@ -753,6 +997,8 @@ void Node::setCamera(Camera* camera)
         _camera->addRef();
         _camera->setNode(this);
     }
+
+    componentsChanged();
 }
 
 Light* Node::getLight() const
@@ -779,7 +1025,9 @@ void Node::setLight(Light* light)
         _light->setNode(this);
     }
 
+    componentsChanged();
     setBoundsDirty();
+    lightChanged();
 }
 
 Drawable* Node::getDrawable() const
@@ -808,10 +1056,36 @@ void Node::setDrawable(Drawable* drawable)
                 ref->addRef();
             _drawable->setNode(this);
         }
+
+        // Re-index the node, since only nodes with a drawable are indexed and the
+        // type of drawable decides how the node is culled.
+        Scene* scene = getScene();
+        if (_spatialIndex)
+            _spatialIndex->remove(this);
+        if (_drawable && scene && scene->_spatialIndex)
+            scene->_spatialIndex->insert(this);
+        if (scene)
+            scene->updateComponents(this);
     }
     setBoundsDirty();
 }
 
+void Node::setSpatialIndex(SpatialIndex* index)
+{
+    if (_spatialIndex != index)
+    {
+        if (_spatialIndex)
+            _spatialIndex->remove(this);
+        if (index && _drawable)
+            index->insert(this);
+    }
+
+    for (Node* child = getFirstChild(); child != NULL; child = child->getNextSibling())
+    {
+        child->setSpatialIndex(index);
+    }
+}
+
 const BoundingSphere& Node::getBoundingSphere() const
 {
     if (_dirtyBits & NODE_DIRTY_BOUNDS)
@@ -830,7 +1104,22 @@ const BoundingSphere& Node::getBoundingSphere() const
             empty = false;
         }
         Model* model = dynamic_cast<Model*>(_drawable);
-        if (model && model->getMesh())
+        BoundingSphere skinBounds;
+        bool posedSkin = model && model->getSkin() && model->getSkin()->computeBounds(&skinBounds);
+        if (posedSkin)
+        {
+            // The bounds of the posed joints of the skin are already relative to the parent of its joints.
+            if (empty)
+            {
+                _bounds.set(skinBounds);
+                empty = false;
+            }
+            else
+            {
+                _bounds.merge(skinBounds);
+            }
+        }
+        else if (model && model->getMesh())
         {
             if (empty)
             {
@@ -873,7 +1162,7 @@ const BoundingSphere& Node::getBoundingSphere() const
         if (!empty)
         {
             bool applyWorldTransform = true;
-            if (model && model->getSkin())
+            if (model && model->getSkin() && !posedSkin)
             {
                 // Special case: If the root joint of our mesh skin is parented by any nodes, 
                 // multiply the world matrix of the root joint's parent by this node's
@@ -890,7 +1179,7 @@ const BoundingSphere& Node::getBoundingSphere() const
                     // TODO: Should we protect against the case where joints are nested directly
                     // in the node hierachy of the model (this is normally not the case)?
                     Matrix boundsMatrix;
-                    Matrix::multiply(getWorldMatrix(), jointParent->getWorldMatrix(), &boundsMatrix);
+                    Matrix::multiplyAffine(getWorldMatrix(), jointParent->getWorldMatrix(), &boundsMatrix);
                     _bounds.transform(boundsMatrix);
                     applyWorldTransform = false;
                 }
@@ -925,8 +1214,28 @@ const BoundingSphere& Node::getBoundingSphere() const
 
 Node* Node::clone() const
 {
+    // Each cloned node sets its transform and gains children, so notify the changes once at the end.
+    Transform::suspendTransformChanged();
     NodeCloneContext context;
-    return cloneRecursive(context);
+    Node* copy = cloneRecursive(context);
+    Transform::resumeTransformChanged();
+    return copy;
+}
+
+unsigned int Node::clone(unsigned int count, std::vector<Node*>& clones) const
+{
+    GP_PROFILE_SCOPE("Node::clone");
+
+    clones.reserve(clones.size() + count);
+    Transform::suspendTransformChanged();
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        // Each clone needs its own context, since the context maps the originals to their clones.
+        NodeCloneContext context;
+        clones.push_back(cloneRecursive(context));
+    }
+    Transform::resumeTransformChanged();
+    return count;
 }
 
 Node* Node::cloneSingleNode(NodeCloneContext &context) const
@@ -994,7 +1303,7 @@ void Node::cloneInto(Node* node, NodeCloneContext& context) const
     }
     if (_tags)
     {
-        node->_tags = new std::map<std::string, std::string>(_tags->begin(), _tags->end());
+        node->_tags = new std::map<std::string, std::string, std::less<std::string>, PoolAllocator<std::pair<const std::string, std::string> > >(_tags->begin(), _tags->end());
     }
 
     node->_world = _world;
@@ -1026,6 +1335,8 @@ void Node::setAudioSource(AudioSource* audio)
         _audioSource->addRef();
         _audioSource->setNode(this);
     }
+
+    componentsChanged();
 }
 
 PhysicsCollisionObject* Node::getCollisionObject() const
@@ -1082,6 +1393,7 @@ PhysicsCollisionObject* Node::setCollisionObject(PhysicsCollisionObject::Type ty
         break;  // Already deleted, Just don't add a new collision object back.
     }
 
+    componentsChanged();
     return _collisionObject;
 }
 
@@ -1104,6 +1416,7 @@ PhysicsCollisionObject* Node::setCollisionObject(const char* url)
 PhysicsCollisionObject* Node::setCollisionObject(Properties* properties)
 {
     SAFE_DELETE(_collisionObject);
+    componentsChanged();
 
     // Check if the properties is valid.
     if (!properties || !(strcmp(properties->getNamespace(), "collisionObject") == 0))
@@ -1155,6 +1468,7 @@ PhysicsCollisionObject* Node::setCollisionObject(Properties* properties)
         return NULL;
     }
 
+    componentsChanged();
     return _collisionObject;
 }
 
@@ -1217,7 +1531,7 @@ Animation* NodeCloneContext::findClonedAnimation(const Animation* animation)
 {
     GP_ASSERT(animation);
 
-    std::map<const Animation*, Animation*>::iterator it = _clonedAnimations.find(animation);
+    std::unordered_map<const Animation*, Animation*>::iterator it = _clonedAnimations.find(animation);
     return it != _clonedAnimations.end() ? it->second : NULL;
 }
 
@@ -1233,7 +1547,7 @@ Node* NodeCloneContext::findClonedNode(const Node* node)
 {
     GP_ASSERT(node);
 
-    std::map<const Node*, Node*>::iterator it = _clonedNodes.find(node);
+    std::unordered_map<const Node*, Node*>::iterator it = _clonedNodes.find(node);
     return it != _clonedNodes.end() ? it->second : NULL;
 }
 
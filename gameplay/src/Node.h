@@ -15,6 +15,10 @@
 #include "PhysicsCollisionObject.h"
 #include "BoundingBox.h"
 #include "AIAgent.h"
+#include "StringId.h"
+
+// The number of kinds of components that scenes keep dense arrays of (see Scene::Component)
+#define NODE_COMPONENT_COUNT 5
 
 namespace gameplay
 {
@@ -25,6 +29,7 @@ class Light;
 class AudioSource;
 class AIAgent;
 class Drawable;
+class SpatialIndex;
 
 /**
  * Defines a hierarchical structure of objects in 3D transformation spaces.
@@ -41,6 +46,8 @@ class Node : public Transform, public Ref
     friend class Bundle;
     friend class MeshSkin;
     friend class Light;
+    friend class SpatialIndex;
+    friend class SceneSnapshot;
 
     GP_SCRIPT_EVENTS_START();
     GP_SCRIPT_EVENT(update, "<Node>f");
@@ -69,6 +76,13 @@ public:
      */
     static Node* create(const char* id = NULL);
 
+    /**
+     * Allocates nodes from a memory pool.
+     *
+     * @script{ignore}
+     */
+    GP_POOL_ALLOCATED();
+
     /**
      * Extends ScriptTarget::getTypeName() to return the type name of this class.
      *
@@ -84,6 +98,14 @@ public:
      */
     const char* getId() const;
 
+    /**
+     * Gets the interned identifier for the node.
+     *
+     * @return The node identifier.
+     * @script{ignore}
+     */
+    const StringId& getStringId() const;
+
     /**
      * Sets the identifier for the node.
      *
@@ -162,6 +184,9 @@ public:
      * but does not check the ID against itself.
      * If recursive is true, it also traverses the Node's hierarchy with a breadth first search.
      *
+     * Node IDs are interned (see StringId), so an exact match compares the IDs without comparing
+     * their characters, and fails at once for an ID that no node was ever given.
+     *
      * @param id The ID of the child to find.
      * @param recursive True to search recursively all the node's children, false for only direct children.
      * @param exactMatch true if only nodes whose ID exactly matches the specified ID are returned,
@@ -171,6 +196,19 @@ public:
      */
     Node* findNode(const char* id, bool recursive = true, bool exactMatch = true) const;
 
+    /**
+     * Returns the first child node that matches the given interned ID.
+     *
+     * @param id The ID of the child to find.
+     * @param recursive True to search recursively all the node's children, false for only direct children.
+     * @param exactMatch true if only nodes whose ID exactly matches the specified ID are returned,
+     *        or false if nodes that start with the given ID are returned.
+     *
+     * @return The Node found or NULL if not found.
+     * @script{ignore}
+     */
+    Node* findNode(const StringId& id, bool recursive = true, bool exactMatch = true) const;
+
     /**
      * Returns all child nodes that match the given ID.
      *
@@ -185,6 +223,20 @@ public:
      */
     unsigned int findNodes(const char* id, std::vector<Node*>& nodes, bool recursive = true, bool exactMatch = true) const;
 
+    /**
+     * Returns all child nodes that match the given interned ID.
+     *
+     * @param id The ID of the node to find.
+     * @param nodes A vector of nodes to be populated with matches.
+     * @param recursive true if a recursive search should be performed, false otherwise.
+     * @param exactMatch true if only nodes whose ID exactly matches the specified ID are returned,
+     *        or false if nodes that start with the given ID are returned.
+     *
+     * @return The number of matches found.
+     * @script{ignore}
+     */
+    unsigned int findNodes(const StringId& id, std::vector<Node*>& nodes, bool recursive = true, bool exactMatch = true) const;
+
     /**
      * Gets the scene this node is currenlty within.
      *
@@ -261,7 +313,8 @@ public:
     /**
      * Returns whether the transformation of this node is static.
      *
-     * Nodes that have static rigid bodies attached to them are considered static.
+     * Nodes that have static rigid bodies attached to them, and nodes that are frozen, are
+     * considered static.
      *
      * @return True if the transformation of this Node is static, false otherwise.
      *
@@ -269,6 +322,30 @@ public:
      */
     bool isStatic() const;
 
+    /**
+     * Freezes the world matrix and bounds of this node.
+     *
+     * The world matrix and bounding sphere of the node are computed once, and the node is
+     * then skipped by Scene::updateTransforms and kept by the spatial index of its scene in
+     * a tree of static nodes that is never rebuilt. The nodes that are static when a scene
+     * finishes loading are frozen by Scene::freezeStatic.
+     *
+     * A frozen node is thawed again as soon as it, one of its parents or one of its children
+     * moves, or its bounds otherwise change, so freezing never makes a node stale.
+     *
+     * @script{ignore}
+     */
+    void freeze();
+
+    /**
+     * Returns whether the world matrix and bounds of this node are frozen (see freeze).
+     *
+     * @return True if this node is frozen, false otherwise.
+     *
+     * @script{ignore}
+     */
+    bool isFrozen() const;
+
     /**
      * Gets the world matrix corresponding to this node.
      *
@@ -345,6 +422,9 @@ public:
      * Gets the world * view * projection matrix corresponding to this node based
      * on the scene's active camera.
      *
+     * Like the other matrices derived from the world matrix, it is kept by the node
+     * until its world matrix or the view or projection of the active camera changes.
+     *
      * @return The world * view * projection matrix of this node.
      */
     const Matrix& getWorldViewProjectionMatrix() const;
@@ -607,6 +687,23 @@ public:
      */
     Node* clone() const;
 
+    /**
+     * Clones the node and all of its child nodes a number of times, such as to spawn many
+     * instances of a prepared template node.
+     *
+     * The meshes, animation curves and effects of the node are shared by all of the clones,
+     * and the transform changes of the clones are propagated once at the end, so this is
+     * faster than calling clone() for each copy.
+     *
+     * @param count The number of clones to create.
+     * @param clones The vector that the new nodes are appended to. The caller owns a
+     *      reference to each of them.
+     *
+     * @return The number of nodes appended to the vector.
+     * @script{ignore}
+     */
+    unsigned int clone(unsigned int count, std::vector<Node*>& clones) const;
+
 protected:
 
     /**
@@ -665,6 +762,36 @@ protected:
      */
     void setBoundsDirty();
 
+    /**
+     * Moves this node and its children from their current spatial index to the specified one.
+     *
+     * @param index The spatial index of the scene the node now belongs to, or NULL.
+     */
+    void setSpatialIndex(SpatialIndex* index);
+
+    /**
+     * Recomputes the world matrix of this node if it is dirty, without updating its children.
+     *
+     * The world matrix of the parent node is expected to be up to date already.
+     */
+    void updateWorldMatrix() const;
+
+    /**
+     * Sets the world matrix and bounding sphere of this node, which were computed when the
+     * node was encoded, so that they are not computed again until the node moves.
+     *
+     * The hierarchy of the node must not change afterwards before it moves.
+     *
+     * @param world The world matrix of the node.
+     * @param bounds The world-space bounding sphere of the node and its children.
+     */
+    void setStaticBounds(const Matrix& world, const BoundingSphere& bounds);
+
+    /**
+     * Thaws this node if it is frozen, before its world matrix or bounds change.
+     */
+    void thaw();
+
 private:
 
     /**
@@ -679,12 +806,61 @@ private:
 
     PhysicsCollisionObject* setCollisionObject(Properties* properties);
 
+    /**
+     * Updates the lists of nodes with components of our scene after a component was set.
+     */
+    void componentsChanged();
+
+    /**
+     * Tells our scene that the light of this node moved or changed, so that the lights
+     * selected for the nodes it reaches are selected again.
+     */
+    void lightChanged();
+
+    /**
+     * The lights that most influence a node, as selected by its scene (see Scene::getNodeLights).
+     */
+    struct LightSelection
+    {
+        /** The light version of the scene that the lights were selected at, or zero once they are out of date. */
+        unsigned int version;
+        /** The nodes of the selected lights for each Light::Type, in order of decreasing influence. */
+        std::vector<Node*> lights[3];
+    };
+
+    /**
+     * The matrices derived from the world matrix of a node and the active camera of its scene.
+     *
+     * They are cleared when the world matrix is recomputed, and the ones that depend on the
+     * camera when the version of the camera differs from the one they were computed for.
+     */
+    struct DerivedMatrices
+    {
+        /** The version of the active camera that the matrices were computed for, or zero for no camera. */
+        unsigned int cameraVersion;
+        /** The bits of the matrices that are up to date. */
+        unsigned int valid;
+        /** The world view matrix. */
+        Matrix worldView;
+        /** The world view projection matrix. */
+        Matrix worldViewProjection;
+        /** The inverse transpose world view matrix. */
+        Matrix inverseTransposeWorldView;
+        /** The inverse transpose world matrix. */
+        Matrix inverseTransposeWorld;
+    };
+
+    /**
+     * Returns the derived matrices of this node, with the ones that are out of date cleared.
+     */
+    DerivedMatrices* getDerivedMatrices() const;
+
 protected:
 
     /** The scene this node is attached to. */
     Scene* _scene;
     /** The nodes id. */
-    std::string _id;
+    StringId _id;
     /** The nodes first child. */
     Node* _firstChild;
     /** The nodes next sibiling. */
@@ -698,7 +874,7 @@ protected:
     /** If this node is enabled. Maybe different if parent is enabled/disabled. */
     bool _enabled; 
     /** Tags assigned to this node. */
-    std::map<std::string, std::string>* _tags;
+    std::map<std::string, std::string, std::less<std::string>, PoolAllocator<std::pair<const std::string, std::string> > >* _tags;
     /** The drawble component attached to this node. */
     Drawable* _drawable;
     /** The camera component attached to this node. */
@@ -719,6 +895,20 @@ protected:
     mutable BoundingSphere _bounds;
     /** The dirty bits used for optimization. */
     mutable int _dirtyBits;
+    /** The spatial index of the scene that holds this node, if the node has a drawable. */
+    SpatialIndex* _spatialIndex;
+    /** The entry of this node in the spatial index. */
+    int _spatialProxy;
+    /** The index of this node in each of the Scene::Component arrays of our scene, or -1 if it is not in the array. */
+    int _componentSlots[NODE_COMPONENT_COUNT];
+    /** The lights selected for this node by its scene, allocated the first time they are selected. */
+    LightSelection* _lightSelection;
+    /** If the light of this node is waiting in the list of changed lights of our scene. */
+    bool _lightChangeQueued;
+    /** The matrices derived from the world matrix, allocated the first time one of them is used. */
+    mutable DerivedMatrices* _derivedMatrices;
+    /** If the world matrix and bounds of this node are frozen. */
+    bool _frozen;
 };
 
 /**
@@ -785,8 +975,8 @@ private:
      */
     NodeCloneContext& operator=(const NodeCloneContext&);
 
-    std::map<const Animation*, Animation*> _clonedAnimations;
-    std::map<const Node*, Node*> _clonedNodes;
+    std::unordered_map<const Animation*, Animation*> _clonedAnimations;
+    std::unordered_map<const Node*, Node*> _clonedNodes;
 };
 
 }
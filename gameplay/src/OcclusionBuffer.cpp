@@ -0,0 +1,305 @@
+#include "Base.h"
+#include "OcclusionBuffer.h"
+#include "Scene.h"
+#include "SimdMath.h"
+
+// The smallest clip-space w of a vertex that is in front of the camera. Triangles and volumes
+// with a vertex closer to the camera plane than this are not projected.
+#define OCCLUSION_MIN_W         1e-4f
+
+// The smallest screen-space area (in pixels) of a triangle that is rasterized
+#define OCCLUSION_MIN_AREA      1e-4f
+
+namespace gameplay
+{
+
+OcclusionBuffer::OcclusionBuffer(unsigned int width, unsigned int height)
+    : _width(std::max(width, 1u)), _height(std::max(height, 1u)), _built(false)
+{
+    // Each level halves the size of the level before it, down to a single texel.
+    unsigned int offset = 0;
+    Level level;
+    level.width = _width;
+    level.height = _height;
+    while (true)
+    {
+        level.offset = offset;
+        _levels.push_back(level);
+        offset += level.width * level.height;
+        if (level.width == 1 && level.height == 1)
+            break;
+        level.width = (level.width + 1) / 2;
+        level.height = (level.height + 1) / 2;
+    }
+    _depth.resize(offset, 1.0f);
+}
+
+OcclusionBuffer::~OcclusionBuffer()
+{
+}
+
+void OcclusionBuffer::clear(Camera* camera)
+{
+    GP_ASSERT(camera);
+
+    _viewProjection = camera->getViewProjectionMatrix();
+    std::fill(_depth.begin(), _depth.end(), 1.0f);
+    _built = false;
+}
+
+void OcclusionBuffer::transformCorners(const BoundingBox& box, const Matrix& matrix, float* x, float* y, float* z, float* w)
+{
+    // Corner i takes the maximum of the box on the axes whose bits are set in i, x being bit 0.
+    float cx[8], cy[8], cz[8];
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        cx[i] = (i & 1) ? box.max.x : box.min.x;
+        cy[i] = (i & 2) ? box.max.y : box.min.y;
+        cz[i] = (i & 4) ? box.max.z : box.min.z;
+    }
+
+    const float* m = matrix.m;
+#ifdef GP_USE_SIMD
+    for (unsigned int i = 0; i < 8; i += 4)
+    {
+        Float4 px = load4(cx + i);
+        Float4 py = load4(cy + i);
+        Float4 pz = load4(cz + i);
+        store4(x + i, add4(add4(add4(mul4(splat4(m[0]), px), mul4(splat4(m[4]), py)), mul4(splat4(m[8]), pz)), splat4(m[12])));
+        store4(y + i, add4(add4(add4(mul4(splat4(m[1]), px), mul4(splat4(m[5]), py)), mul4(splat4(m[9]), pz)), splat4(m[13])));
+        store4(z + i, add4(add4(add4(mul4(splat4(m[2]), px), mul4(splat4(m[6]), py)), mul4(splat4(m[10]), pz)), splat4(m[14])));
+        store4(w + i, add4(add4(add4(mul4(splat4(m[3]), px), mul4(splat4(m[7]), py)), mul4(splat4(m[11]), pz)), splat4(m[15])));
+    }
+#else
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        x[i] = m[0] * cx[i] + m[4] * cy[i] + m[8] * cz[i] + m[12];
+        y[i] = m[1] * cx[i] + m[5] * cy[i] + m[9] * cz[i] + m[13];
+        z[i] = m[2] * cx[i] + m[6] * cy[i] + m[10] * cz[i] + m[14];
+        w[i] = m[3] * cx[i] + m[7] * cy[i] + m[11] * cz[i] + m[15];
+    }
+#endif
+}
+
+void OcclusionBuffer::addOccluder(const BoundingBox& box, const Matrix& world)
+{
+    if (box.isEmpty())
+        return;
+
+    Matrix matrix;
+    Matrix::multiply(_viewProjection, world, &matrix);
+    float x[8], y[8], z[8], w[8];
+    transformCorners(box, matrix, x, y, z, w);
+
+    Vector4 corners[8];
+    bool projected[8];
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        projected[i] = w[i] > OCCLUSION_MIN_W;
+        if (projected[i])
+        {
+            float invW = 1.0f / w[i];
+            corners[i].set((x[i] * invW * 0.5f + 0.5f) * _width, (y[i] * invW * 0.5f + 0.5f) * _height, z[i] * invW, 1.0f);
+        }
+    }
+
+    // The two triangles of each face, whose corners have one bit in common (see transformCorners).
+    static const unsigned char faces[6][4] =
+    {
+        { 0, 2, 4, 6 }, { 1, 3, 5, 7 }, { 0, 1, 4, 5 }, { 2, 3, 6, 7 }, { 0, 1, 2, 3 }, { 4, 5, 6, 7 }
+    };
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+        const unsigned char* f = faces[i];
+        if (projected[f[0]] && projected[f[1]] && projected[f[2]])
+            rasterizeTriangle(corners[f[0]], corners[f[1]], corners[f[2]]);
+        if (projected[f[1]] && projected[f[3]] && projected[f[2]])
+            rasterizeTriangle(corners[f[1]], corners[f[3]], corners[f[2]]);
+    }
+}
+
+void OcclusionBuffer::addOccluder(const Vector3* positions, const unsigned short* indices, unsigned int indexCount, const Matrix& world)
+{
+    GP_ASSERT(positions);
+    GP_ASSERT(indices);
+
+    Matrix matrix;
+    Matrix::multiply(_viewProjection, world, &matrix);
+    for (unsigned int i = 0; i + 2 < indexCount; i += 3)
+    {
+        Vector4 corners[3];
+        bool projected = true;
+        for (unsigned int j = 0; j < 3 && projected; ++j)
+        {
+            const Vector3& p = positions[indices[i + j]];
+            Vector4 clip;
+            matrix.transformVector(Vector4(p.x, p.y, p.z, 1.0f), &clip);
+            projected = clip.w > OCCLUSION_MIN_W;
+            if (projected)
+            {
+                float invW = 1.0f / clip.w;
+                corners[j].set((clip.x * invW * 0.5f + 0.5f) * _width, (clip.y * invW * 0.5f + 0.5f) * _height, clip.z * invW, 1.0f);
+            }
+        }
+        if (projected)
+            rasterizeTriangle(corners[0], corners[1], corners[2]);
+    }
+}
+
+unsigned int OcclusionBuffer::addOccluders(Scene* scene)
+{
+    GP_ASSERT(scene);
+
+    unsigned int count = 0;
+    for (unsigned int i = 0, nodeCount = scene->getComponentCount(Scene::DRAWABLE); i < nodeCount; ++i)
+    {
+        Node* node = scene->getComponentNode(Scene::DRAWABLE, i);
+        if (!node->hasTag("occluder") || !node->isEnabledInHierarchy())
+            continue;
+
+        Model* model = dynamic_cast<Model*>(node->getDrawable());
+        if (model && model->getMesh())
+        {
+            addOccluder(model->getMesh()->getBoundingBox(), node->getWorldMatrix());
+            ++count;
+        }
+    }
+    return count;
+}
+
+void OcclusionBuffer::rasterizeTriangle(const Vector4& a, const Vector4& b, const Vector4& c)
+{
+    float area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+    if (fabs(area) < OCCLUSION_MIN_AREA)
+        return;
+
+    // Clamp the bounds of the triangle to the buffer before converting them, since the corners
+    // of large occluders near the camera project far outside of it.
+    float minX = std::max(std::min(a.x, std::min(b.x, c.x)), 0.0f);
+    float maxX = std::min(std::max(a.x, std::max(b.x, c.x)), (float)_width - 1.0f);
+    float minY = std::max(std::min(a.y, std::min(b.y, c.y)), 0.0f);
+    float maxY = std::min(std::max(a.y, std::max(b.y, c.y)), (float)_height - 1.0f);
+    if (minX > maxX || minY > maxY)
+        return;
+
+    // The depth is an affine function of the screen position, whose gradients follow from the
+    // three corners. The barycentric coordinates are divided by the area, so that the inside of
+    // the triangle is positive for either winding.
+    float invArea = 1.0f / area;
+    float dzdx = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) * invArea;
+    float dzdy = ((c.z - a.z) * (b.x - a.x) - (b.z - a.z) * (c.x - a.x)) * invArea;
+    for (int y = (int)minY, y1 = (int)maxY; y <= y1; ++y)
+    {
+        float py = y + 0.5f;
+        float* row = &_depth[y * _width];
+        for (int x = (int)minX, x1 = (int)maxX; x <= x1; ++x)
+        {
+            float px = x + 0.5f;
+            float w0 = ((b.x - px) * (c.y - py) - (c.x - px) * (b.y - py)) * invArea;
+            float w1 = ((c.x - px) * (a.y - py) - (a.x - px) * (c.y - py)) * invArea;
+            if (w0 >= 0.0f && w1 >= 0.0f && w0 + w1 <= 1.0f)
+            {
+                float z = a.z + dzdx * (px - a.x) + dzdy * (py - a.y);
+                if (z < row[x])
+                    row[x] = z;
+            }
+        }
+    }
+}
+
+void OcclusionBuffer::build()
+{
+    for (size_t i = 1, count = _levels.size(); i < count; ++i)
+    {
+        const Level& src = _levels[i - 1];
+        const Level& dst = _levels[i];
+        const float* srcDepth = &_depth[src.offset];
+        float* dstDepth = &_depth[dst.offset];
+        for (unsigned int y = 0; y < dst.height; ++y)
+        {
+            unsigned int y0 = y * 2;
+            unsigned int y1 = std::min(y0 + 1, src.height - 1);
+            for (unsigned int x = 0; x < dst.width; ++x)
+            {
+                unsigned int x0 = x * 2;
+                unsigned int x1 = std::min(x0 + 1, src.width - 1);
+                dstDepth[y * dst.width + x] = std::max(std::max(srcDepth[y0 * src.width + x0], srcDepth[y0 * src.width + x1]),
+                                                       std::max(srcDepth[y1 * src.width + x0], srcDepth[y1 * src.width + x1]));
+            }
+        }
+    }
+    _built = true;
+}
+
+bool OcclusionBuffer::isVisible(const BoundingBox& box) const
+{
+    if (!_built || box.isEmpty())
+        return true;
+
+    float x[8], y[8], z[8], w[8];
+    transformCorners(box, _viewProjection, x, y, z, w);
+
+    float minX = FLT_MAX, maxX = -FLT_MAX;
+    float minY = FLT_MAX, maxY = -FLT_MAX;
+    float minZ = FLT_MAX;
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        // Volumes that reach behind the camera cover unbounded parts of the screen.
+        if (w[i] <= OCCLUSION_MIN_W)
+            return true;
+        float invW = 1.0f / w[i];
+        float sx = (x[i] * invW * 0.5f + 0.5f) * _width;
+        float sy = (y[i] * invW * 0.5f + 0.5f) * _height;
+        minX = std::min(minX, sx);
+        maxX = std::max(maxX, sx);
+        minY = std::min(minY, sy);
+        maxY = std::max(maxY, sy);
+        minZ = std::min(minZ, z[i] * invW);
+    }
+
+    // Volumes outside of the screen are left to frustum culling.
+    if (maxX < 0.0f || maxY < 0.0f || minX >= (float)_width || minY >= (float)_height)
+        return true;
+    unsigned int x0 = (unsigned int)std::max(minX, 0.0f);
+    unsigned int x1 = (unsigned int)std::min(maxX, (float)_width - 1.0f);
+    unsigned int y0 = (unsigned int)std::max(minY, 0.0f);
+    unsigned int y1 = (unsigned int)std::min(maxY, (float)_height - 1.0f);
+
+    // Test at the level where the rectangle of the volume spans at most two texels each way.
+    unsigned int level = 0;
+    while (level + 1 < _levels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+        ++level;
+
+    const Level& l = _levels[level];
+    const float* depth = &_depth[l.offset];
+    for (unsigned int ty = y0 >> level, ty1 = y1 >> level; ty <= ty1; ++ty)
+    {
+        for (unsigned int tx = x0 >> level, tx1 = x1 >> level; tx <= tx1; ++tx)
+        {
+            if (minZ <= depth[ty * l.width + tx])
+                return true;
+        }
+    }
+    return false;
+}
+
+bool OcclusionBuffer::isVisible(const BoundingSphere& sphere) const
+{
+    if (sphere.isEmpty())
+        return true;
+
+    Vector3 extent(sphere.radius, sphere.radius, sphere.radius);
+    return isVisible(BoundingBox(sphere.center - extent, sphere.center + extent));
+}
+
+unsigned int OcclusionBuffer::getWidth() const
+{
+    return _width;
+}
+
+unsigned int OcclusionBuffer::getHeight() const
+{
+    return _height;
+}
+
+}
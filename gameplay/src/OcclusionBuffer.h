@@ -0,0 +1,177 @@
+#ifndef OCCLUSIONBUFFER_H_
+#define OCCLUSIONBUFFER_H_
+
+#include "Matrix.h"
+#include "Vector4.h"
+#include "BoundingBox.h"
+#include "BoundingSphere.h"
+
+namespace gameplay
+{
+
+class Scene;
+class Camera;
+class Node;
+
+/**
+ * Defines a low resolution depth buffer that large occluders are rasterized into on the CPU,
+ * for culling the drawables that they hide.
+ *
+ * Each frame, the buffer is cleared for a camera, the occluders are rasterized into it and a
+ * hierarchy of the farthest depth of each block of pixels is built. The bounding volumes of
+ * drawables are then tested against the hierarchy, at the level where they cover a few pixels,
+ * so each test only reads a handful of values. A volume is hidden when it is entirely behind
+ * the farthest occluder depth over the pixels it covers.
+ *
+ * Occluders should be simple shapes that are entirely inside the geometry they stand for, so
+ * that they never hide something that is visible. Boxes that fill walls, buildings and terrain
+ * blocks work well. Nodes tagged "occluder" are added by addOccluders() with the bounding box of
+ * their mesh, so the tag should only be set on nodes whose geometry fills its bounding box.
+ *
+ * A RenderQueue skips the drawables that the buffer hides, so they are never submitted:
+ *
+ * @code
+ * _occlusion.clear(camera);
+ * _occlusion.addOccluders(_scene);
+ * _occlusion.build();
+ * _queue.setOcclusionBuffer(&_occlusion);
+ * _queue.clear();
+ * _queue.gather(_scene, camera);
+ * @endcode
+ *
+ * @script{ignore}
+ */
+class OcclusionBuffer
+{
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param width The width of the depth buffer, in pixels.
+     * @param height The height of the depth buffer, in pixels.
+     */
+    OcclusionBuffer(unsigned int width = 256, unsigned int height = 128);
+
+    /**
+     * Destructor.
+     */
+    ~OcclusionBuffer();
+
+    /**
+     * Clears the depth buffer, to rasterize occluders from the point of view of a camera.
+     *
+     * Until build() is called, every volume is visible.
+     *
+     * @param camera The camera that the scene is drawn from.
+     */
+    void clear(Camera* camera);
+
+    /**
+     * Rasterizes a box into the depth buffer.
+     *
+     * @param box The box, in the local space of the world matrix.
+     * @param world The matrix that transforms the box into world space.
+     */
+    void addOccluder(const BoundingBox& box, const Matrix& world);
+
+    /**
+     * Rasterizes a mesh of triangles into the depth buffer.
+     *
+     * @param positions The positions of the vertices of the mesh.
+     * @param indices The indices of the triangles of the mesh, three for each triangle.
+     * @param indexCount The number of indices.
+     * @param world The matrix that transforms the positions into world space.
+     */
+    void addOccluder(const Vector3* positions, const unsigned short* indices, unsigned int indexCount, const Matrix& world);
+
+    /**
+     * Rasterizes the bounding boxes of the meshes of the enabled nodes of a scene that are
+     * tagged "occluder".
+     *
+     * @param scene The scene to find the occluders of.
+     *
+     * @return The number of occluders that were rasterized.
+     */
+    unsigned int addOccluders(Scene* scene);
+
+    /**
+     * Builds the depth hierarchy from the rasterized occluders, after which volumes can be tested.
+     */
+    void build();
+
+    /**
+     * Determines if a box may be visible, or if it is hidden by the occluders.
+     *
+     * Boxes that are not in front of the camera are always visible.
+     *
+     * @param box The box, in world space.
+     *
+     * @return false if the box is hidden by the occluders, true otherwise.
+     */
+    bool isVisible(const BoundingBox& box) const;
+
+    /**
+     * Determines if a sphere may be visible, or if it is hidden by the occluders.
+     *
+     * @param sphere The sphere, in world space.
+     *
+     * @return false if the sphere is hidden by the occluders, true otherwise.
+     */
+    bool isVisible(const BoundingSphere& sphere) const;
+
+    /**
+     * Returns the width of the depth buffer.
+     *
+     * @return The width, in pixels.
+     */
+    unsigned int getWidth() const;
+
+    /**
+     * Returns the height of the depth buffer.
+     *
+     * @return The height, in pixels.
+     */
+    unsigned int getHeight() const;
+
+private:
+
+    /**
+     * A level of the depth hierarchy. Level 0 is the depth buffer, and each texel of the
+     * following levels holds the farthest depth of 2x2 texels of the level before it.
+     */
+    struct Level
+    {
+        unsigned int width;
+        unsigned int height;
+        unsigned int offset;
+    };
+
+    /**
+     * Hidden copy constructor.
+     */
+    OcclusionBuffer(const OcclusionBuffer& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    OcclusionBuffer& operator=(const OcclusionBuffer&);
+
+    /**
+     * Transforms the eight corners of a box into clip space.
+     */
+    static void transformCorners(const BoundingBox& box, const Matrix& matrix, float* x, float* y, float* z, float* w);
+
+    void rasterizeTriangle(const Vector4& a, const Vector4& b, const Vector4& c);
+
+    unsigned int _width;
+    unsigned int _height;
+    Matrix _viewProjection;
+    std::vector<Level> _levels;
+    std::vector<float> _depth;
+    bool _built;
+};
+
+}
+
+#endif
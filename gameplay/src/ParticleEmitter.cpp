@@ -1,21 +1,118 @@
 #include "Base.h"
 #include "ParticleEmitter.h"
+#include "GraphicsDevice.h"
 #include "Game.h"
 #include "Node.h"
 #include "Scene.h"
 #include "Quaternion.h"
 #include "Properties.h"
+#include "SimdMath.h"
+#include "FileSystem.h"
+#include "Material.h"
 
 #define PARTICLE_COUNT_MAX                       100
 #define PARTICLE_EMISSION_RATE                   10
 #define PARTICLE_EMISSION_RATE_TIME_INTERVAL     1000.0f / (float)PARTICLE_EMISSION_RATE
 #define PARTICLE_UPDATE_RATE_MAX                 8
+#define PARTICLE_FRAME_COUNT_MAX                 64
+#define PARTICLE_GPU_STATE_FLOAT_COUNT           10
+#define PARTICLE_GPU_ATTRIBUTE_FLOAT_COUNT       18
+
+#if defined(GP_USE_TRANSFORM_FEEDBACK) && defined(GP_USE_INSTANCING)
+#define PARTICLE_GPU_SIMULATION
+#endif
 
 namespace gameplay
 {
 
+// The buffers of an emitter whose particles are simulated on the GPU.
+//
+// The state buffers hold the position, velocity, acceleration and energy of each particle and
+// are written by the update program in turn. The attribute buffer holds the values that do not
+// change over the lifetime of a particle: the rotation axis and speed, the start and end color,
+// the start and end size, the inverse of the starting energy, the first sprite frame, and the
+// starting angle and spin speed.
+struct ParticleEmitter::GpuSimulation
+{
+    GLuint stateBuffers[2];
+    GLuint attributeBuffer;
+    unsigned int source;
+    // The time at which the particle in each slot dies, so that dead slots are found without reading the buffers back.
+    std::vector<double> deathTimes;
+    unsigned int cursor;
+    double time;
+    Material* material;
+    std::vector<unsigned int> slots;
+    std::vector<float> state;
+    std::vector<float> attributes;
+};
+
+#ifdef PARTICLE_GPU_SIMULATION
+
+// The program that moves the particles, shared by the emitters simulated on the GPU.
+static struct
+{
+    GLuint program;
+    GLint elapsedTimeLocation;
+    GLint positionAttribute;
+    GLint velocityAttribute;
+    GLint accelerationAttribute;
+    GLint energyAttribute;
+    GLint rotationAttribute;
+    GLuint cornerBuffer;
+    unsigned int refCount;
+} __particleUpdate = { 0, -1, -1, -1, -1, -1, -1, 0, 0 };
+
+static GLuint linkUpdateProgram(const char* path)
+{
+    char* source = FileSystem::readAll(path);
+    if (!source)
+    {
+        GP_WARN("Failed to read the particle update shader '%s'.", path);
+        return 0;
+    }
+
+    GLuint shader;
+    GL_ASSERT( shader = glCreateShader(GL_VERTEX_SHADER) );
+    const GLchar* sourcePtr = source;
+    GL_ASSERT( glShaderSource(shader, 1, &sourcePtr, NULL) );
+    GL_ASSERT( glCompileShader(shader) );
+    SAFE_DELETE_ARRAY(source);
+
+    GLint success;
+    GLchar infoLog[1024];
+    GL_ASSERT( glGetShaderiv(shader, GL_COMPILE_STATUS, &success) );
+    if (success != GL_TRUE)
+    {
+        GL_ASSERT( glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog) );
+        GP_WARN("Compile failed for the particle update shader with error '%s'.", infoLog);
+        GL_ASSERT( glDeleteShader(shader) );
+        return 0;
+    }
+
+    GLuint program;
+    GL_ASSERT( program = glCreateProgram() );
+    GL_ASSERT( glAttachShader(program, shader) );
+    static const GLchar* varyings[] = { "v_position", "v_velocity", "v_acceleration", "v_energy" };
+    GL_ASSERT( glTransformFeedbackVaryings(program, 4, varyings, GL_INTERLEAVED_ATTRIBS) );
+    GL_ASSERT( glLinkProgram(program) );
+    GL_ASSERT( glDeleteShader(shader) );
+
+    GL_ASSERT( glGetProgramiv(program, GL_LINK_STATUS, &success) );
+    if (success != GL_TRUE)
+    {
+        GL_ASSERT( glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog) );
+        GP_WARN("Linking failed for the particle update program with error '%s'.", infoLog);
+        GL_ASSERT( glDeleteProgram(program) );
+        return 0;
+    }
+    return program;
+}
+
+#endif
+
 ParticleEmitter::ParticleEmitter(unsigned int particleCountMax) : Drawable(),
-    _particleCountMax(particleCountMax), _particleCount(0), _particles(NULL),
+    _particleCountMax(0), _particleCount(0), _particleCapacity(0), _particleData(NULL), _particleFrames(NULL),
     _emissionRate(PARTICLE_EMISSION_RATE), _started(false), _ellipsoid(false),
     _sizeStartMin(1.0f), _sizeStartMax(1.0f), _sizeEndMin(1.0f), _sizeEndMax(1.0f),
     _energyMin(1000L), _energyMax(1000L),
@@ -29,16 +126,24 @@ ParticleEmitter::ParticleEmitter(unsigned int particleCountMax) : Drawable(),
     _spriteBatch(NULL), _spriteBlendMode(BLEND_ALPHA),  _spriteTextureWidth(0), _spriteTextureHeight(0), _spriteTextureWidthRatio(0), _spriteTextureHeightRatio(0), _spriteTextureCoords(NULL),
     _spriteAnimated(false),  _spriteLooped(false), _spriteFrameCount(1), _spriteFrameRandomOffset(0),_spriteFrameDuration(0L), _spriteFrameDurationSecs(0.0f), _spritePercentPerFrame(0.0f),
     _orbitPosition(false), _orbitVelocity(false), _orbitAcceleration(false),
-    _timePerEmission(PARTICLE_EMISSION_RATE_TIME_INTERVAL), _emitTime(0), _lastUpdated(0)
+    _timePerEmission(PARTICLE_EMISSION_RATE_TIME_INTERVAL), _emitTime(0), _lastUpdated(0), _updateTime(0), _gpu(NULL), _sorted(false)
 {
     GP_ASSERT(particleCountMax);
-    _particles = new Particle[particleCountMax];
+    allocateParticles(particleCountMax);
+
+    // Seed the random number generator of the emitter from the shared one.
+    for (unsigned int i = 0; i < 4; ++i)
+    {
+        _randomState[i] = ((unsigned int)rand() << 16) ^ (unsigned int)rand() ^ (i * 0x9E3779B9) ^ 1;
+    }
 }
 
 ParticleEmitter::~ParticleEmitter()
 {
+    releaseGpu();
     SAFE_DELETE(_spriteBatch);
-    SAFE_DELETE_ARRAY(_particles);
+    SAFE_DELETE_ARRAY(_particleData);
+    SAFE_DELETE_ARRAY(_particleFrames);
     SAFE_DELETE_ARRAY(_spriteTextureCoords);
 }
 
@@ -199,6 +304,9 @@ ParticleEmitter* ParticleEmitter::create(Properties* properties)
     emitter->setSpriteFrameDuration(spriteFrameDuration);
     emitter->setSpriteFrameCoords(spriteFrameCount, spriteWidth, spriteHeight);
     emitter->setOrbit(orbitPosition, orbitVelocity, orbitAcceleration);
+    emitter->setSorted(properties->getBool("sorted"));
+    if (properties->getBool("gpuSimulation"))
+        emitter->setGpuSimulation(true);
 
     return emitter;
 }
@@ -240,6 +348,9 @@ void ParticleEmitter::setTexture(Texture* texture, BlendMode blendMode)
     // By default assume only one frame which uses the entire texture.
     Rectangle texCoord((float)texture->getWidth(), (float)texture->getHeight());
     setSpriteFrameCoords(1, &texCoord);
+
+    if (_gpu)
+        bindGpuMaterial();
 }
 
 Texture* ParticleEmitter::getTexture() const
@@ -250,7 +361,63 @@ Texture* ParticleEmitter::getTexture() const
 
 void ParticleEmitter::setParticleCountMax(unsigned int max)
 {
-    _particleCountMax = max;
+    GP_ASSERT(max);
+    allocateParticles(max);
+
+    // The GPU buffers are created again for the new number of particles.
+    if (_gpu)
+        setGpuSimulation(true);
+}
+
+void ParticleEmitter::allocateParticles(unsigned int particleCountMax)
+{
+    // Round the arrays up to a multiple of four so that the particles can be updated four at a time.
+    unsigned int capacity = (particleCountMax + 3) & ~3u;
+    _particleCountMax = particleCountMax;
+    if (_particleCount > particleCountMax)
+        _particleCount = particleCountMax;
+    if (capacity == _particleCapacity)
+        return;
+
+    float* data = new float[capacity * PARTICLE_COMPONENT_COUNT];
+    unsigned int* frames = new unsigned int[capacity];
+    memset(data, 0, sizeof(float) * capacity * PARTICLE_COMPONENT_COUNT);
+    memset(frames, 0, sizeof(unsigned int) * capacity);
+    for (unsigned int i = 0; i < PARTICLE_COMPONENT_COUNT && _particleCount > 0; ++i)
+    {
+        memcpy(data + i * capacity, _particleData + i * _particleCapacity, sizeof(float) * _particleCount);
+    }
+    if (_particleCount > 0)
+        memcpy(frames, _particleFrames, sizeof(unsigned int) * _particleCount);
+
+    SAFE_DELETE_ARRAY(_particleData);
+    SAFE_DELETE_ARRAY(_particleFrames);
+    _particleData = data;
+    _particleFrames = frames;
+    _particleCapacity = capacity;
+}
+
+float* ParticleEmitter::getParticleComponent(unsigned int component) const
+{
+    GP_ASSERT(component < PARTICLE_COMPONENT_COUNT);
+    return _particleData + component * _particleCapacity;
+}
+
+void ParticleEmitter::removeParticle(unsigned int index)
+{
+    GP_ASSERT(index < _particleCount);
+
+    unsigned int last = _particleCount - 1;
+    if (index != last)
+    {
+        for (unsigned int i = 0; i < PARTICLE_COMPONENT_COUNT; ++i)
+        {
+            float* component = getParticleComponent(i);
+            component[index] = component[last];
+        }
+        _particleFrames[index] = _particleFrames[last];
+    }
+    --_particleCount;
 }
 
 unsigned int ParticleEmitter::getParticleCountMax() const
@@ -300,13 +467,30 @@ bool ParticleEmitter::isActive() const
 void ParticleEmitter::emitOnce(unsigned int particleCount)
 {
     GP_ASSERT(_node);
-    GP_ASSERT(_particles);
+    GP_ASSERT(_particleData);
 
     // Limit particleCount so as not to go over _particleCountMax.
     if (particleCount + _particleCount > _particleCountMax)
     {
         particleCount = _particleCountMax - _particleCount;
     }
+    if (particleCount == 0)
+        return;
+
+    if (_gpu)
+    {
+        emitGpu(particleCount);
+        return;
+    }
+
+    generateParticles(_particleCount, particleCount);
+    _particleCount += particleCount;
+}
+
+void ParticleEmitter::generateParticles(unsigned int first, unsigned int count)
+{
+    GP_ASSERT(_node);
+    GP_ASSERT(first + count <= _particleCapacity);
 
     Vector3 translation;
     Matrix world = _node->getWorldMatrix();
@@ -317,66 +501,95 @@ void ParticleEmitter::emitOnce(unsigned int particleCount)
     world.m[13] = 0.0f;
     world.m[14] = 0.0f;
 
-    // Emit the new particles.
-    for (unsigned int i = 0; i < particleCount; i++)
+    // Generate each component of the new particles in turn.
+    generateScalars(PARTICLE_COLOR_START_R, first, count, _colorStart.x - _colorStartVar.x, _colorStart.x + _colorStartVar.x);
+    generateScalars(PARTICLE_COLOR_START_G, first, count, _colorStart.y - _colorStartVar.y, _colorStart.y + _colorStartVar.y);
+    generateScalars(PARTICLE_COLOR_START_B, first, count, _colorStart.z - _colorStartVar.z, _colorStart.z + _colorStartVar.z);
+    generateScalars(PARTICLE_COLOR_START_A, first, count, _colorStart.w - _colorStartVar.w, _colorStart.w + _colorStartVar.w);
+    generateScalars(PARTICLE_COLOR_END_R, first, count, _colorEnd.x - _colorEndVar.x, _colorEnd.x + _colorEndVar.x);
+    generateScalars(PARTICLE_COLOR_END_G, first, count, _colorEnd.y - _colorEndVar.y, _colorEnd.y + _colorEndVar.y);
+    generateScalars(PARTICLE_COLOR_END_B, first, count, _colorEnd.z - _colorEndVar.z, _colorEnd.z + _colorEndVar.z);
+    generateScalars(PARTICLE_COLOR_END_A, first, count, _colorEnd.w - _colorEndVar.w, _colorEnd.w + _colorEndVar.w);
+    for (unsigned int i = 0; i < 4; ++i)
     {
-        Particle* p = &_particles[_particleCount];
-
-        generateColor(_colorStart, _colorStartVar, &p->_colorStart);
-        generateColor(_colorEnd, _colorEndVar, &p->_colorEnd);
-        p->_color.set(p->_colorStart);
-
-        p->_energy = p->_energyStart = generateScalar(_energyMin, _energyMax);
-        p->_size = p->_sizeStart = generateScalar(_sizeStartMin, _sizeStartMax);
-        p->_sizeEnd = generateScalar(_sizeEndMin, _sizeEndMax);
-        p->_rotationPerParticleSpeed = generateScalar(_rotationPerParticleSpeedMin, _rotationPerParticleSpeedMax);
-        p->_angle = generateScalar(0.0f, p->_rotationPerParticleSpeed);
-        p->_rotationSpeed = generateScalar(_rotationSpeedMin, _rotationSpeedMax);
-
-        // Only initial position can be generated within an ellipsoidal domain.
-        generateVector(_position, _positionVar, &p->_position, _ellipsoid);
-        generateVector(_velocity, _velocityVar, &p->_velocity, false);
-        generateVector(_acceleration, _accelerationVar, &p->_acceleration, false);
-        generateVector(_rotationAxis, _rotationAxisVar, &p->_rotationAxis, false);
-
-        // Initial position, velocity and acceleration can all be relative to the emitter's transform.
-        // Rotate specified properties by the node's rotation.
-        if (_orbitPosition)
-        {
-            world.transformPoint(p->_position, &p->_position);
-        }
-
-        if (_orbitVelocity)
-        {
-            world.transformPoint(p->_velocity, &p->_velocity);
-        }
-
-        if (_orbitAcceleration)
-        {
-            world.transformPoint(p->_acceleration, &p->_acceleration);
-        }
-
-        // The rotation axis always orbits the node.
-        if (p->_rotationSpeed != 0.0f && !p->_rotationAxis.isZero())
-        {
-            world.transformPoint(p->_rotationAxis, &p->_rotationAxis);
-        }
+        memcpy(getParticleComponent(PARTICLE_COLOR_R + i) + first, getParticleComponent(PARTICLE_COLOR_START_R + i) + first, sizeof(float) * count);
+    }
 
-        // Translate position relative to the node's world space.
-        p->_position.add(translation);
+    generateScalars(PARTICLE_ENERGY, first, count, _energyMin, _energyMax);
+    generateScalars(PARTICLE_SIZE_START, first, count, _sizeStartMin, _sizeStartMax);
+    generateScalars(PARTICLE_SIZE_END, first, count, _sizeEndMin, _sizeEndMax);
+    generateScalars(PARTICLE_ROTATION_PER_PARTICLE_SPEED, first, count, _rotationPerParticleSpeedMin, _rotationPerParticleSpeedMax);
+    generateScalars(PARTICLE_ANGLE, first, count, 0.0f, 1.0f);
+    generateScalars(PARTICLE_ROTATION_SPEED, first, count, _rotationSpeedMin, _rotationSpeedMax);
+
+    float* energy = getParticleComponent(PARTICLE_ENERGY);
+    float* energyStartInv = getParticleComponent(PARTICLE_ENERGY_START_INV);
+    float* size = getParticleComponent(PARTICLE_SIZE);
+    const float* sizeStart = getParticleComponent(PARTICLE_SIZE_START);
+    float* angle = getParticleComponent(PARTICLE_ANGLE);
+    const float* rotationPerParticleSpeed = getParticleComponent(PARTICLE_ROTATION_PER_PARTICLE_SPEED);
+    float* timeOnCurrentFrame = getParticleComponent(PARTICLE_TIME_ON_CURRENT_FRAME);
+    for (unsigned int i = first; i < first + count; ++i)
+    {
+        // Particles always live for at least a millisecond.
+        energy[i] = floorf(energy[i]);
+        if (energy[i] < 1.0f)
+            energy[i] = 1.0f;
+        energyStartInv[i] = 1.0f / energy[i];
+        size[i] = sizeStart[i];
+        angle[i] *= rotationPerParticleSpeed[i];
+        timeOnCurrentFrame[i] = 0.0f;
+    }
 
-        // Initial sprite frame.
-        if (_spriteFrameRandomOffset > 0)
-        {
-            p->_frame = rand() % _spriteFrameRandomOffset;
-        }
-        else
+    // Only initial position can be generated within an ellipsoidal domain.
+    if (_ellipsoid)
+    {
+        generateVectorsInEllipsoid(PARTICLE_POSITION_X, first, count, _position, _positionVar);
+    }
+    else
+    {
+        generateScalars(PARTICLE_POSITION_X, first, count, _position.x - _positionVar.x, _position.x + _positionVar.x);
+        generateScalars(PARTICLE_POSITION_Y, first, count, _position.y - _positionVar.y, _position.y + _positionVar.y);
+        generateScalars(PARTICLE_POSITION_Z, first, count, _position.z - _positionVar.z, _position.z + _positionVar.z);
+    }
+    generateScalars(PARTICLE_VELOCITY_X, first, count, _velocity.x - _velocityVar.x, _velocity.x + _velocityVar.x);
+    generateScalars(PARTICLE_VELOCITY_Y, first, count, _velocity.y - _velocityVar.y, _velocity.y + _velocityVar.y);
+    generateScalars(PARTICLE_VELOCITY_Z, first, count, _velocity.z - _velocityVar.z, _velocity.z + _velocityVar.z);
+    generateScalars(PARTICLE_ACCELERATION_X, first, count, _acceleration.x - _accelerationVar.x, _acceleration.x + _accelerationVar.x);
+    generateScalars(PARTICLE_ACCELERATION_Y, first, count, _acceleration.y - _accelerationVar.y, _acceleration.y + _accelerationVar.y);
+    generateScalars(PARTICLE_ACCELERATION_Z, first, count, _acceleration.z - _accelerationVar.z, _acceleration.z + _accelerationVar.z);
+    generateScalars(PARTICLE_ROTATION_AXIS_X, first, count, _rotationAxis.x - _rotationAxisVar.x, _rotationAxis.x + _rotationAxisVar.x);
+    generateScalars(PARTICLE_ROTATION_AXIS_Y, first, count, _rotationAxis.y - _rotationAxisVar.y, _rotationAxis.y + _rotationAxisVar.y);
+    generateScalars(PARTICLE_ROTATION_AXIS_Z, first, count, _rotationAxis.z - _rotationAxisVar.z, _rotationAxis.z + _rotationAxisVar.z);
+
+    // Initial position, velocity and acceleration can all be relative to the emitter's transform.
+    // Rotate specified properties by the node's rotation.
+    if (_orbitPosition)
+        transformVectors(PARTICLE_POSITION_X, first, count, world);
+    if (_orbitVelocity)
+        transformVectors(PARTICLE_VELOCITY_X, first, count, world);
+    if (_orbitAcceleration)
+        transformVectors(PARTICLE_ACCELERATION_X, first, count, world);
+
+    // The rotation axis always orbits the node.
+    if (_rotationSpeedMin != 0.0f || _rotationSpeedMax != 0.0f)
+        transformVectors(PARTICLE_ROTATION_AXIS_X, first, count, world);
+
+    // Translate position relative to the node's world space.
+    float* positions[3] = { getParticleComponent(PARTICLE_POSITION_X), getParticleComponent(PARTICLE_POSITION_Y), getParticleComponent(PARTICLE_POSITION_Z) };
+    const float offsets[3] = { translation.x, translation.y, translation.z };
+    for (unsigned int c = 0; c < 3; ++c)
+    {
+        for (unsigned int i = first; i < first + count; ++i)
         {
-            p->_frame = 0;
+            positions[c][i] += offsets[c];
         }
-        p->_timeOnCurrentFrame = 0.0f;
+    }
 
-        ++_particleCount;
+    // Initial sprite frame.
+    for (unsigned int i = first; i < first + count; ++i)
+    {
+        _particleFrames[i] = _spriteFrameRandomOffset > 0 ? (unsigned int)(generateRandom() * _spriteFrameRandomOffset) % _spriteFrameRandomOffset : 0;
     }
 }
 
@@ -744,82 +957,78 @@ bool ParticleEmitter::getOrbitAcceleration() const
     return _orbitAcceleration;
 }
 
-long ParticleEmitter::generateScalar(long min, long max)
-{
-    // Note: this is not a very good RNG, but it should be suitable for our purposes.
-    long r = 0;
-    for (unsigned int i = 0; i < sizeof(long)/sizeof(int); i++)
-    {
-        r = r << 8; // sizeof(int) * CHAR_BITS
-        r |= rand();
-    }
-
-    // Now we have a random long between 0 and MAX_LONG.  We need to clamp it between min and max.
-    r %= max - min;
-    r += min;
-
-    return r;
-}
-
-float ParticleEmitter::generateScalar(float min, float max)
-{
-    return min + (max - min) * MATH_RANDOM_0_1();
-}
-
-void ParticleEmitter::generateVectorInRect(const Vector3& base, const Vector3& variance, Vector3* dst)
+float ParticleEmitter::generateRandom()
 {
-    GP_ASSERT(dst);
-
-    // Scale each component of the variance vector by a random float
-    // between -1 and 1, then add this to the corresponding base component.
-    dst->x = base.x + variance.x * MATH_RANDOM_MINUS1_1();
-    dst->y = base.y + variance.y * MATH_RANDOM_MINUS1_1();
-    dst->z = base.z + variance.z * MATH_RANDOM_MINUS1_1();
+    // Step the first lane of the xorshift generator and use the upper 24 bits as the fraction.
+    unsigned int x = _randomState[0];
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    _randomState[0] = x;
+    return (float)(x >> 8) * (1.0f / 16777216.0f);
 }
 
-void ParticleEmitter::generateVectorInEllipsoid(const Vector3& center, const Vector3& scale, Vector3* dst)
+void ParticleEmitter::generateScalars(unsigned int component, unsigned int first, unsigned int count, float min, float max)
 {
-    GP_ASSERT(dst);
-
-    // Generate a point within a unit cube, then reject if the point is not in a unit sphere.
-    do
+    float* dst = getParticleComponent(component) + first;
+    if (min == max)
     {
-        dst->x = MATH_RANDOM_MINUS1_1();
-        dst->y = MATH_RANDOM_MINUS1_1();
-        dst->z = MATH_RANDOM_MINUS1_1();
-    } while (dst->length() > 1.0f);
-    
-    // Scale this point by the scaling vector.
-    dst->x *= scale.x;
-    dst->y *= scale.y;
-    dst->z *= scale.z;
+        for (unsigned int i = 0; i < count; ++i)
+            dst[i] = min;
+        return;
+    }
 
-    // Translate by the center point.
-    dst->add(center);
+    // Four independent xorshift generators are stepped together, so that the compiler can
+    // vectorize the loop, instead of calling rand() for every value.
+    const float scale = (max - min) * (1.0f / 16777216.0f);
+    unsigned int state[4] = { _randomState[0], _randomState[1], _randomState[2], _randomState[3] };
+    for (unsigned int i = 0; i < count; i += 4)
+    {
+        float values[4];
+        for (unsigned int j = 0; j < 4; ++j)
+        {
+            unsigned int x = state[j];
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            state[j] = x;
+            values[j] = min + (float)(x >> 8) * scale;
+        }
+        for (unsigned int j = 0; j < 4 && i + j < count; ++j)
+            dst[i + j] = values[j];
+    }
+    memcpy(_randomState, state, sizeof(state));
 }
 
-void ParticleEmitter::generateVector(const Vector3& base, const Vector3& variance, Vector3* dst, bool ellipsoid)
+void ParticleEmitter::generateVectorsInEllipsoid(unsigned int component, unsigned int first, unsigned int count, const Vector3& center, const Vector3& scale)
 {
-    if (ellipsoid)
+    float* x = getParticleComponent(component);
+    float* y = getParticleComponent(component + 1);
+    float* z = getParticleComponent(component + 2);
+    for (unsigned int i = first; i < first + count; ++i)
     {
-        generateVectorInEllipsoid(base, variance, dst);
-    }
-    else
-    {
-        generateVectorInRect(base, variance, dst);
+        // Generate a point within a unit cube, then reject if the point is not in a unit sphere.
+        Vector3 v;
+        do
+        {
+            v.x = generateRandom() * 2.0f - 1.0f;
+            v.y = generateRandom() * 2.0f - 1.0f;
+            v.z = generateRandom() * 2.0f - 1.0f;
+        } while (v.lengthSquared() > 1.0f);
+
+        // Scale this point by the scaling vector and translate it by the center point.
+        x[i] = center.x + v.x * scale.x;
+        y[i] = center.y + v.y * scale.y;
+        z[i] = center.z + v.z * scale.z;
     }
 }
 
-void ParticleEmitter::generateColor(const Vector4& base, const Vector4& variance, Vector4* dst)
+void ParticleEmitter::transformVectors(unsigned int component, unsigned int first, unsigned int count, const Matrix& matrix)
 {
-    GP_ASSERT(dst);
-
-    // Scale each component of the variance color by a random float
-    // between -1 and 1, then add this to the corresponding base component.
-    dst->x = base.x + variance.x * MATH_RANDOM_MINUS1_1();
-    dst->y = base.y + variance.y * MATH_RANDOM_MINUS1_1();
-    dst->z = base.z + variance.z * MATH_RANDOM_MINUS1_1();
-    dst->w = base.w + variance.w * MATH_RANDOM_MINUS1_1();
+    float* x = getParticleComponent(component);
+    float* y = getParticleComponent(component + 1);
+    float* z = getParticleComponent(component + 2);
+    matrix.transformPoints(x + first, y + first, z + first, count);
 }
 
 ParticleEmitter::BlendMode ParticleEmitter::getBlendModeFromString(const char* str)
@@ -864,13 +1073,12 @@ void ParticleEmitter::update(float elapsedTime)
     // Cap particle updates at a maximum rate. This saves processing
     // and also improves precision since updating with very small
     // time increments is more lossy.
-    static double runningTime = 0;
-    runningTime += elapsedTime;
-    if (runningTime < PARTICLE_UPDATE_RATE_MAX)
-        return;    
+    _updateTime += elapsedTime;
+    if (_updateTime < PARTICLE_UPDATE_RATE_MAX)
+        return;
 
-    float elapsedMs = runningTime;
-    runningTime = 0;
+    float elapsedMs = _updateTime;
+    _updateTime = 0;
 
     float elapsedSecs = elapsedMs * 0.001f;
 
@@ -893,101 +1101,222 @@ void ParticleEmitter::update(float elapsedTime)
         }
     }
 
+    if (_gpu)
+    {
+        updateGpu(elapsedMs, elapsedSecs);
+        return;
+    }
+
     // Now update all currently living particles.
-    GP_ASSERT(_particles);
-    for (unsigned int particlesIndex = 0; particlesIndex < _particleCount; ++particlesIndex)
+    GP_ASSERT(_particleData);
+    if (_particleCount == 0)
     {
-        Particle* p = &_particles[particlesIndex];
-        p->_energy -= elapsedMs;
+        _bounds.set(Vector3::zero(), Vector3::zero());
+        return;
+    }
 
-        if (p->_energy > 0L)
+    // Rotate the velocity and acceleration of the particles around their rotation axes.
+    if (_rotationSpeedMin != 0.0f || _rotationSpeedMax != 0.0f)
+    {
+        const float* rotationSpeed = getParticleComponent(PARTICLE_ROTATION_SPEED);
+        const float* axisX = getParticleComponent(PARTICLE_ROTATION_AXIS_X);
+        const float* axisY = getParticleComponent(PARTICLE_ROTATION_AXIS_Y);
+        const float* axisZ = getParticleComponent(PARTICLE_ROTATION_AXIS_Z);
+        float* velocity[3] = { getParticleComponent(PARTICLE_VELOCITY_X), getParticleComponent(PARTICLE_VELOCITY_Y), getParticleComponent(PARTICLE_VELOCITY_Z) };
+        float* acceleration[3] = { getParticleComponent(PARTICLE_ACCELERATION_X), getParticleComponent(PARTICLE_ACCELERATION_Y), getParticleComponent(PARTICLE_ACCELERATION_Z) };
+        for (unsigned int i = 0; i < _particleCount; ++i)
         {
-            if (p->_rotationSpeed != 0.0f && !p->_rotationAxis.isZero())
+            Vector3 axis(axisX[i], axisY[i], axisZ[i]);
+            if (rotationSpeed[i] != 0.0f && !axis.isZero())
             {
-                Matrix::createRotation(p->_rotationAxis, p->_rotationSpeed * elapsedSecs, &_rotation);
-
-                _rotation.transformPoint(p->_velocity, &p->_velocity);
-                _rotation.transformPoint(p->_acceleration, &p->_acceleration);
+                Matrix::createRotation(axis, rotationSpeed[i] * elapsedSecs, &_rotation);
+
+                Vector3 v(velocity[0][i], velocity[1][i], velocity[2][i]);
+                _rotation.transformPoint(&v);
+                velocity[0][i] = v.x;
+                velocity[1][i] = v.y;
+                velocity[2][i] = v.z;
+
+                Vector3 a(acceleration[0][i], acceleration[1][i], acceleration[2][i]);
+                _rotation.transformPoint(&a);
+                acceleration[0][i] = a.x;
+                acceleration[1][i] = a.y;
+                acceleration[2][i] = a.z;
             }
+        }
+    }
+
+    integrateParticles(elapsedMs, elapsedSecs);
+
+    if (_spriteAnimated)
+        animateParticles(elapsedSecs);
+
+    // Remove the dead particles. The particle furthest from the start of the arrays is moved
+    // down to take the place of each, which keeps the living particles packed at the start.
+    const float* energy = getParticleComponent(PARTICLE_ENERGY);
+    for (unsigned int i = 0; i < _particleCount;)
+    {
+        if (energy[i] > 0.0f)
+            ++i;
+        else
+            removeParticle(i);
+    }
+
+    // Bound the centers of the particles that are left, padded by the largest particle size.
+    if (_particleCount == 0)
+    {
+        _bounds.set(Vector3::zero(), Vector3::zero());
+        return;
+    }
+    float min[3];
+    float max[3];
+    for (unsigned int c = 0; c < 3; ++c)
+    {
+        const float* position = getParticleComponent(PARTICLE_POSITION_X + c);
+        min[c] = max[c] = position[0];
+        for (unsigned int i = 1; i < _particleCount; ++i)
+        {
+            min[c] = std::min(min[c], position[i]);
+            max[c] = std::max(max[c], position[i]);
+        }
+    }
+    float radius = std::max(std::max(_sizeStartMax, _sizeEndMax), 0.0f) * 0.5f;
+    _bounds.set(min[0] - radius, min[1] - radius, min[2] - radius, max[0] + radius, max[1] + radius, max[2] + radius);
+}
+
+const BoundingBox& ParticleEmitter::getBoundingBox() const
+{
+    return _bounds;
+}
+
+void ParticleEmitter::integrateParticles(float elapsedMs, float elapsedSecs)
+{
+    float* position[3] = { getParticleComponent(PARTICLE_POSITION_X), getParticleComponent(PARTICLE_POSITION_Y), getParticleComponent(PARTICLE_POSITION_Z) };
+    float* velocity[3] = { getParticleComponent(PARTICLE_VELOCITY_X), getParticleComponent(PARTICLE_VELOCITY_Y), getParticleComponent(PARTICLE_VELOCITY_Z) };
+    const float* acceleration[3] = { getParticleComponent(PARTICLE_ACCELERATION_X), getParticleComponent(PARTICLE_ACCELERATION_Y), getParticleComponent(PARTICLE_ACCELERATION_Z) };
+    float* angle = getParticleComponent(PARTICLE_ANGLE);
+    const float* rotationPerParticleSpeed = getParticleComponent(PARTICLE_ROTATION_PER_PARTICLE_SPEED);
+    float* energy = getParticleComponent(PARTICLE_ENERGY);
+    const float* energyStartInv = getParticleComponent(PARTICLE_ENERGY_START_INV);
+    float* size = getParticleComponent(PARTICLE_SIZE);
+    const float* sizeStart = getParticleComponent(PARTICLE_SIZE_START);
+    const float* sizeEnd = getParticleComponent(PARTICLE_SIZE_END);
+    const float* colorStart[4];
+    const float* colorEnd[4];
+    float* color[4];
+    for (unsigned int c = 0; c < 4; ++c)
+    {
+        colorStart[c] = getParticleComponent(PARTICLE_COLOR_START_R + c);
+        colorEnd[c] = getParticleComponent(PARTICLE_COLOR_END_R + c);
+        color[c] = getParticleComponent(PARTICLE_COLOR_R + c);
+    }
 
-            // Particle is still alive.
-            p->_velocity.x += p->_acceleration.x * elapsedSecs;
-            p->_velocity.y += p->_acceleration.y * elapsedSecs;
-            p->_velocity.z += p->_acceleration.z * elapsedSecs;
+    // The arrays are padded to a multiple of four, so the last group of particles
+    // can be updated together with the unused slots that follow it.
+    unsigned int i = 0;
+#ifdef GP_USE_SIMD
+    const unsigned int count = (_particleCount + 3) & ~3u;
+    const Float4 elapsedMs4 = splat4(elapsedMs);
+    const Float4 elapsedSecs4 = splat4(elapsedSecs);
+    const Float4 one4 = splat4(1.0f);
+    for (; i < count; i += 4)
+    {
+        Float4 energy4 = sub4(load4(energy + i), elapsedMs4);
+        store4(energy + i, energy4);
 
-            p->_position.x += p->_velocity.x * elapsedSecs;
-            p->_position.y += p->_velocity.y * elapsedSecs;
-            p->_position.z += p->_velocity.z * elapsedSecs;
+        // Simple Euler integration of velocity and position.
+        for (unsigned int c = 0; c < 3; ++c)
+        {
+            Float4 velocity4 = add4(load4(velocity[c] + i), mul4(load4(acceleration[c] + i), elapsedSecs4));
+            store4(velocity[c] + i, velocity4);
+            store4(position[c] + i, add4(load4(position[c] + i), mul4(velocity4, elapsedSecs4)));
+        }
+        store4(angle + i, add4(load4(angle + i), mul4(load4(rotationPerParticleSpeed + i), elapsedSecs4)));
 
-            p->_angle += p->_rotationPerParticleSpeed * elapsedSecs;
+        // Simple linear interpolation of color and size.
+        Float4 percent4 = sub4(one4, mul4(energy4, load4(energyStartInv + i)));
+        for (unsigned int c = 0; c < 4; ++c)
+        {
+            Float4 start4 = load4(colorStart[c] + i);
+            store4(color[c] + i, add4(start4, mul4(sub4(load4(colorEnd[c] + i), start4), percent4)));
+        }
+        Float4 sizeStart4 = load4(sizeStart + i);
+        store4(size + i, add4(sizeStart4, mul4(sub4(load4(sizeEnd + i), sizeStart4), percent4)));
+    }
+#endif
+    for (; i < _particleCount; ++i)
+    {
+        energy[i] -= elapsedMs;
 
-            // Simple linear interpolation of color and size.
-            float percent = 1.0f - ((float)p->_energy / (float)p->_energyStart);
+        for (unsigned int c = 0; c < 3; ++c)
+        {
+            velocity[c][i] += acceleration[c][i] * elapsedSecs;
+            position[c][i] += velocity[c][i] * elapsedSecs;
+        }
+        angle[i] += rotationPerParticleSpeed[i] * elapsedSecs;
 
-            p->_color.x = p->_colorStart.x + (p->_colorEnd.x - p->_colorStart.x) * percent;
-            p->_color.y = p->_colorStart.y + (p->_colorEnd.y - p->_colorStart.y) * percent;
-            p->_color.z = p->_colorStart.z + (p->_colorEnd.z - p->_colorStart.z) * percent;
-            p->_color.w = p->_colorStart.w + (p->_colorEnd.w - p->_colorStart.w) * percent;
+        float percent = 1.0f - energy[i] * energyStartInv[i];
+        for (unsigned int c = 0; c < 4; ++c)
+        {
+            color[c][i] = colorStart[c][i] + (colorEnd[c][i] - colorStart[c][i]) * percent;
+        }
+        size[i] = sizeStart[i] + (sizeEnd[i] - sizeStart[i]) * percent;
+    }
+}
 
-            p->_size = p->_sizeStart + (p->_sizeEnd - p->_sizeStart) * percent;
+void ParticleEmitter::animateParticles(float elapsedSecs)
+{
+    const float* energy = getParticleComponent(PARTICLE_ENERGY);
+    const float* energyStartInv = getParticleComponent(PARTICLE_ENERGY_START_INV);
+    float* timeOnCurrentFrame = getParticleComponent(PARTICLE_TIME_ON_CURRENT_FRAME);
+    for (unsigned int i = 0; i < _particleCount; ++i)
+    {
+        if (energy[i] <= 0.0f)
+            continue;
 
-            // Handle sprite animations.
-            if (_spriteAnimated)
+        if (!_spriteLooped)
+        {
+            // The last frame should finish exactly when the particle dies.
+            float percent = 1.0f - energy[i] * energyStartInv[i];
+            float percentSpent = _spritePercentPerFrame * _particleFrames[i];
+            timeOnCurrentFrame[i] = percent - percentSpent;
+            if (_particleFrames[i] < _spriteFrameCount - 1 &&
+                timeOnCurrentFrame[i] >= _spritePercentPerFrame)
             {
-                if (!_spriteLooped)
-                {
-                    // The last frame should finish exactly when the particle dies.
-                    float percentSpent = 0.0f;
-                    for (unsigned int i = 0; i < p->_frame; i++)
-                    {
-                        percentSpent += _spritePercentPerFrame;
-                    }
-                    p->_timeOnCurrentFrame = percent - percentSpent;
-                    if (p->_frame < _spriteFrameCount - 1 &&
-                        p->_timeOnCurrentFrame >= _spritePercentPerFrame)
-                    {
-                        ++p->_frame;
-                    }
-                }
-                else
-                {
-                    // _spriteFrameDurationSecs is an absolute time measured in seconds,
-                    // and the animation repeats indefinitely.
-                    p->_timeOnCurrentFrame += elapsedSecs;
-                    if (p->_timeOnCurrentFrame >= _spriteFrameDurationSecs)
-                    {
-                        p->_timeOnCurrentFrame -= _spriteFrameDurationSecs;
-                        ++p->_frame;
-                        if (p->_frame == _spriteFrameCount)
-                        {
-                            p->_frame = 0;
-                        }
-                    }
-                }
+                ++_particleFrames[i];
             }
         }
         else
         {
-            // Particle is dead.  Move the particle furthest from the start of the array
-            // down to take its place, and re-use the slot at the end of the list of living particles.
-            if (particlesIndex != _particleCount - 1)
+            // _spriteFrameDurationSecs is an absolute time measured in seconds,
+            // and the animation repeats indefinitely.
+            timeOnCurrentFrame[i] += elapsedSecs;
+            if (timeOnCurrentFrame[i] >= _spriteFrameDurationSecs)
             {
-                _particles[particlesIndex] = _particles[_particleCount - 1];
+                timeOnCurrentFrame[i] -= _spriteFrameDurationSecs;
+                ++_particleFrames[i];
+                if (_particleFrames[i] == _spriteFrameCount)
+                {
+                    _particleFrames[i] = 0;
+                }
             }
-            --_particleCount;
         }
     }
 }
 
 unsigned int ParticleEmitter::draw(bool wireframe)
 {
+    GP_PROFILE_GPU_SCOPE("ParticleEmitter::draw");
     if (!isActive())
         return 0;
 
+    if (_gpu)
+        return drawGpu();
+
     if (_particleCount > 0)
     {
         GP_ASSERT(_spriteBatch);
-        GP_ASSERT(_particles);
+        GP_ASSERT(_particleData);
         GP_ASSERT(_spriteTextureCoords);
 
         // Set our node's view projection matrix to this emitter's effect.
@@ -1011,13 +1340,32 @@ unsigned int ParticleEmitter::draw(bool wireframe)
         Vector3 up;
         cameraWorldMatrix.getUpVector(&up);
 
-        for (unsigned int i = 0; i < _particleCount; i++)
+        const float* position[3] = { getParticleComponent(PARTICLE_POSITION_X), getParticleComponent(PARTICLE_POSITION_Y), getParticleComponent(PARTICLE_POSITION_Z) };
+        const float* color[4] = { getParticleComponent(PARTICLE_COLOR_R), getParticleComponent(PARTICLE_COLOR_G), getParticleComponent(PARTICLE_COLOR_B), getParticleComponent(PARTICLE_COLOR_A) };
+        const float* size = getParticleComponent(PARTICLE_SIZE);
+        const float* angle = getParticleComponent(PARTICLE_ANGLE);
+
+        // Sorted particles are drawn from the furthest to the nearest along the view direction.
+        const unsigned int* order = NULL;
+        if (_sorted && _particleCount > 1)
         {
-            Particle* p = &_particles[i];
+            if (_sortKeys.size() < _particleCount)
+                _sortKeys.resize(_particleCountMax);
+            Vector3 forward;
+            cameraWorldMatrix.getForwardVector(&forward);
+            Vector3 eye;
+            cameraWorldMatrix.getTranslation(&eye);
+            RadixSort::computeDepthKeys(position[0], position[1], position[2], _particleCount, eye, forward, true, &_sortKeys[0]);
+            order = _sorter.sort(&_sortKeys[0], _particleCount);
+        }
 
-            _spriteBatch->draw(p->_position, right, up, p->_size, p->_size,
-                                _spriteTextureCoords[p->_frame * 4], _spriteTextureCoords[p->_frame * 4 + 1], _spriteTextureCoords[p->_frame * 4 + 2], _spriteTextureCoords[p->_frame * 4 + 3],
-                                p->_color, pivot, p->_angle);
+        for (unsigned int j = 0; j < _particleCount; j++)
+        {
+            unsigned int i = order ? order[j] : j;
+            const float* texCoords = &_spriteTextureCoords[_particleFrames[i] * 4];
+            _spriteBatch->draw(Vector3(position[0][i], position[1][i], position[2][i]), right, up, size[i], size[i],
+                                texCoords[0], texCoords[1], texCoords[2], texCoords[3],
+                                Vector4(color[0][i], color[1][i], color[2][i], color[3][i]), pivot, angle[i]);
         }
 
         // Render.
@@ -1064,8 +1412,416 @@ Drawable* ParticleEmitter::clone(NodeCloneContext& context)
     clone->_orbitPosition = _orbitPosition;
     clone->_orbitVelocity = _orbitVelocity;
     clone->_orbitAcceleration = _orbitAcceleration;
+    clone->_sorted = _sorted;
+    if (_gpu)
+        clone->setGpuSimulation(true);
 
     return clone;
 }
 
+void ParticleEmitter::setSorted(bool sorted)
+{
+    _sorted = sorted;
+}
+
+bool ParticleEmitter::isSorted() const
+{
+    return _sorted;
+}
+
+bool ParticleEmitter::isGpuSimulationSupported()
+{
+#ifdef PARTICLE_GPU_SIMULATION
+    return glTransformFeedbackVaryings && glBeginTransformFeedback && glEndTransformFeedback && glBindBufferBase &&
+           GraphicsDevice::isSupported(GraphicsDevice::INSTANCING);
+#else
+    return false;
+#endif
+}
+
+bool ParticleEmitter::setGpuSimulation(bool enabled)
+{
+    // The living particles are not moved between the CPU arrays and the GPU buffers.
+    releaseGpu();
+    _particleCount = 0;
+
+    if (!enabled)
+        return false;
+
+    if (!isGpuSimulationSupported())
+    {
+        GP_WARN("GPU particle simulation is not supported by the graphics driver.");
+        return false;
+    }
+    if (!createGpu())
+    {
+        GP_WARN("Failed to create the GPU particle simulation; particles are simulated on the CPU.");
+        return false;
+    }
+    return true;
+}
+
+bool ParticleEmitter::isGpuSimulation() const
+{
+    return _gpu != NULL;
+}
+
+bool ParticleEmitter::createGpu()
+{
+    GP_ASSERT(_gpu == NULL);
+
+#ifdef PARTICLE_GPU_SIMULATION
+    if (__particleUpdate.refCount == 0)
+    {
+        GLuint program = linkUpdateProgram("res/shaders/particle-update.vert");
+        if (program == 0)
+            return false;
+
+        __particleUpdate.program = program;
+        GL_ASSERT( __particleUpdate.elapsedTimeLocation = glGetUniformLocation(program, "u_elapsedTime") );
+        GL_ASSERT( __particleUpdate.positionAttribute = glGetAttribLocation(program, "a_position") );
+        GL_ASSERT( __particleUpdate.velocityAttribute = glGetAttribLocation(program, "a_velocity") );
+        GL_ASSERT( __particleUpdate.accelerationAttribute = glGetAttribLocation(program, "a_acceleration") );
+        GL_ASSERT( __particleUpdate.energyAttribute = glGetAttribLocation(program, "a_energy") );
+        GL_ASSERT( __particleUpdate.rotationAttribute = glGetAttribLocation(program, "a_rotation") );
+
+        // The corners of the billboard that every particle is drawn with.
+        static const float corners[] = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+        GL_ASSERT( glGenBuffers(1, &__particleUpdate.cornerBuffer) );
+        RenderState::bindBuffer(GL_ARRAY_BUFFER, __particleUpdate.cornerBuffer);
+        GL_ASSERT( glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW) );
+        RenderState::bindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    ++__particleUpdate.refCount;
+
+    _gpu = new GpuSimulation();
+    _gpu->attributeBuffer = 0;
+    _gpu->stateBuffers[0] = _gpu->stateBuffers[1] = 0;
+    _gpu->source = 0;
+    _gpu->cursor = 0;
+    _gpu->time = 0.0;
+    _gpu->deathTimes.assign(_particleCountMax, 0.0);
+    _gpu->material = Material::create("res/shaders/particle.vert", "res/shaders/sprite.frag");
+    if (!_gpu->material)
+    {
+        releaseGpu();
+        return false;
+    }
+
+    // Every slot starts out with a dead particle.
+    std::vector<float> data(_particleCountMax * PARTICLE_GPU_ATTRIBUTE_FLOAT_COUNT, 0.0f);
+    GL_ASSERT( glGenBuffers(2, _gpu->stateBuffers) );
+    for (unsigned int i = 0; i < 2; ++i)
+    {
+        RenderState::bindBuffer(GL_ARRAY_BUFFER, _gpu->stateBuffers[i]);
+        GL_ASSERT( glBufferData(GL_ARRAY_BUFFER, _particleCountMax * PARTICLE_GPU_STATE_FLOAT_COUNT * sizeof(float), &data[0], GL_DYNAMIC_DRAW) );
+    }
+    GL_ASSERT( glGenBuffers(1, &_gpu->attributeBuffer) );
+    RenderState::bindBuffer(GL_ARRAY_BUFFER, _gpu->attributeBuffer);
+    GL_ASSERT( glBufferData(GL_ARRAY_BUFFER, _particleCountMax * PARTICLE_GPU_ATTRIBUTE_FLOAT_COUNT * sizeof(float), &data[0], GL_DYNAMIC_DRAW) );
+    RenderState::bindBuffer(GL_ARRAY_BUFFER, 0);
+
+    bindGpuMaterial();
+    return true;
+#else
+    return false;
+#endif
+}
+
+void ParticleEmitter::bindGpuMaterial()
+{
+    GP_ASSERT(_gpu && _gpu->material);
+    GP_ASSERT(_spriteBatch);
+
+    // The particles are drawn with the texture and blending of the sprite batch.
+    _gpu->material->getParameter("u_texture")->setValue(_spriteBatch->getSampler());
+    _gpu->material->setStateBlock(_spriteBatch->getStateBlock());
+}
+
+void ParticleEmitter::releaseGpu()
+{
+    if (!_gpu)
+        return;
+
+#ifdef PARTICLE_GPU_SIMULATION
+    for (unsigned int i = 0; i < 2; ++i)
+    {
+        if (_gpu->stateBuffers[i])
+            RenderState::deleteBuffer(_gpu->stateBuffers[i]);
+    }
+    if (_gpu->attributeBuffer)
+        RenderState::deleteBuffer(_gpu->attributeBuffer);
+    SAFE_RELEASE(_gpu->material);
+
+    GP_ASSERT(__particleUpdate.refCount > 0);
+    if (--__particleUpdate.refCount == 0)
+    {
+        RenderState::deleteProgram(__particleUpdate.program);
+        RenderState::deleteBuffer(__particleUpdate.cornerBuffer);
+        __particleUpdate.program = 0;
+        __particleUpdate.cornerBuffer = 0;
+    }
+#endif
+    SAFE_DELETE(_gpu);
+}
+
+void ParticleEmitter::emitGpu(unsigned int particleCount)
+{
+    GP_ASSERT(_gpu);
+
+#ifdef PARTICLE_GPU_SIMULATION
+    // Find the slots of dead particles, starting after the last slot that was written.
+    const unsigned int capacity = (unsigned int)_gpu->deathTimes.size();
+    std::vector<unsigned int>& slots = _gpu->slots;
+    slots.clear();
+    for (unsigned int n = 0; n < capacity && slots.size() < particleCount; ++n)
+    {
+        unsigned int slot = (_gpu->cursor + n) % capacity;
+        if (_gpu->deathTimes[slot] <= _gpu->time)
+            slots.push_back(slot);
+    }
+    const unsigned int count = (unsigned int)slots.size();
+    if (count == 0)
+        return;
+    _gpu->cursor = (slots[count - 1] + 1) % capacity;
+
+    // The new particles are generated at the start of the particle arrays, which are otherwise unused.
+    generateParticles(0, count);
+
+    const float* position[3] = { getParticleComponent(PARTICLE_POSITION_X), getParticleComponent(PARTICLE_POSITION_Y), getParticleComponent(PARTICLE_POSITION_Z) };
+    const float* velocity[3] = { getParticleComponent(PARTICLE_VELOCITY_X), getParticleComponent(PARTICLE_VELOCITY_Y), getParticleComponent(PARTICLE_VELOCITY_Z) };
+    const float* acceleration[3] = { getParticleComponent(PARTICLE_ACCELERATION_X), getParticleComponent(PARTICLE_ACCELERATION_Y), getParticleComponent(PARTICLE_ACCELERATION_Z) };
+    const float* axis[3] = { getParticleComponent(PARTICLE_ROTATION_AXIS_X), getParticleComponent(PARTICLE_ROTATION_AXIS_Y), getParticleComponent(PARTICLE_ROTATION_AXIS_Z) };
+    const float* rotationSpeed = getParticleComponent(PARTICLE_ROTATION_SPEED);
+    const float* energy = getParticleComponent(PARTICLE_ENERGY);
+    const float* energyStartInv = getParticleComponent(PARTICLE_ENERGY_START_INV);
+    const float* sizeStart = getParticleComponent(PARTICLE_SIZE_START);
+    const float* sizeEnd = getParticleComponent(PARTICLE_SIZE_END);
+    const float* angle = getParticleComponent(PARTICLE_ANGLE);
+    const float* rotationPerParticleSpeed = getParticleComponent(PARTICLE_ROTATION_PER_PARTICLE_SPEED);
+    const float* colorStart[4];
+    const float* colorEnd[4];
+    for (unsigned int c = 0; c < 4; ++c)
+    {
+        colorStart[c] = getParticleComponent(PARTICLE_COLOR_START_R + c);
+        colorEnd[c] = getParticleComponent(PARTICLE_COLOR_END_R + c);
+    }
+
+    _gpu->state.resize(count * PARTICLE_GPU_STATE_FLOAT_COUNT);
+    _gpu->attributes.resize(count * PARTICLE_GPU_ATTRIBUTE_FLOAT_COUNT);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        float* state = &_gpu->state[i * PARTICLE_GPU_STATE_FLOAT_COUNT];
+        float* attributes = &_gpu->attributes[i * PARTICLE_GPU_ATTRIBUTE_FLOAT_COUNT];
+        for (unsigned int c = 0; c < 3; ++c)
+        {
+            state[c] = position[c][i];
+            state[3 + c] = velocity[c][i];
+            state[6 + c] = acceleration[c][i];
+            attributes[c] = axis[c][i];
+        }
+        state[9] = energy[i];
+        attributes[3] = (_rotationSpeedMin != 0.0f || _rotationSpeedMax != 0.0f) ? rotationSpeed[i] : 0.0f;
+        for (unsigned int c = 0; c < 4; ++c)
+        {
+            attributes[4 + c] = colorStart[c][i];
+            attributes[8 + c] = colorEnd[c][i];
+        }
+        attributes[12] = sizeStart[i];
+        attributes[13] = sizeEnd[i];
+        attributes[14] = energyStartInv[i];
+        attributes[15] = (float)_particleFrames[i];
+        attributes[16] = angle[i];
+        attributes[17] = rotationPerParticleSpeed[i];
+
+        _gpu->deathTimes[slots[i]] = _gpu->time + energy[i];
+    }
+
+    // Upload each run of consecutive slots at once.
+    for (unsigned int i = 0; i < count;)
+    {
+        unsigned int end = i + 1;
+        while (end < count && slots[end] == slots[end - 1] + 1)
+            ++end;
+
+        RenderState::bindBuffer(GL_ARRAY_BUFFER, _gpu->stateBuffers[_gpu->source]);
+        GL_ASSERT( glBufferSubData(GL_ARRAY_BUFFER, slots[i] * PARTICLE_GPU_STATE_FLOAT_COUNT * sizeof(float),
+                                   (end - i) * PARTICLE_GPU_STATE_FLOAT_COUNT * sizeof(float), &_gpu->state[i * PARTICLE_GPU_STATE_FLOAT_COUNT]) );
+        RenderState::bindBuffer(GL_ARRAY_BUFFER, _gpu->attributeBuffer);
+        GL_ASSERT( glBufferSubData(GL_ARRAY_BUFFER, slots[i] * PARTICLE_GPU_ATTRIBUTE_FLOAT_COUNT * sizeof(float),
+                                   (end - i) * PARTICLE_GPU_ATTRIBUTE_FLOAT_COUNT * sizeof(float), &_gpu->attributes[i * PARTICLE_GPU_ATTRIBUTE_FLOAT_COUNT]) );
+        RenderStats::countBufferUpload((end - i) * (PARTICLE_GPU_STATE_FLOAT_COUNT + PARTICLE_GPU_ATTRIBUTE_FLOAT_COUNT) * sizeof(float));
+        i = end;
+    }
+    RenderState::bindBuffer(GL_ARRAY_BUFFER, 0);
+
+    _particleCount += count;
+#endif
+}
+
+void ParticleEmitter::updateGpu(float elapsedMs, float elapsedSecs)
+{
+    GP_ASSERT(_gpu);
+
+#ifdef PARTICLE_GPU_SIMULATION
+    if (_particleCount > 0)
+    {
+        RenderState::useProgram(__particleUpdate.program);
+        GL_ASSERT( glUniform2f(__particleUpdate.elapsedTimeLocation, elapsedMs, elapsedSecs) );
+
+#ifdef GP_USE_VAO
+        if (glGenVertexArrays)
+        {
+            RenderState::bindVertexArray(0);
+        }
+#endif
+        const GLint stateAttributes[] = { __particleUpdate.positionAttribute, __particleUpdate.velocityAttribute, __particleUpdate.accelerationAttribute, __particleUpdate.energyAttribute };
+        const GLint stateSizes[] = { 3, 3, 3, 1 };
+        RenderState::bindBuffer(GL_ARRAY_BUFFER, _gpu->stateBuffers[_gpu->source]);
+        size_t offset = 0;
+        for (unsigned int i = 0; i < 4; ++i)
+        {
+            if (stateAttributes[i] != -1)
+            {
+                GL_ASSERT( glVertexAttribPointer(stateAttributes[i], stateSizes[i], GL_FLOAT, GL_FALSE, PARTICLE_GPU_STATE_FLOAT_COUNT * sizeof(float), (void*)offset) );
+                GL_ASSERT( glEnableVertexAttribArray(stateAttributes[i]) );
+            }
+            offset += stateSizes[i] * sizeof(float);
+        }
+        if (__particleUpdate.rotationAttribute != -1)
+        {
+            RenderState::bindBuffer(GL_ARRAY_BUFFER, _gpu->attributeBuffer);
+            GL_ASSERT( glVertexAttribPointer(__particleUpdate.rotationAttribute, 4, GL_FLOAT, GL_FALSE, PARTICLE_GPU_ATTRIBUTE_FLOAT_COUNT * sizeof(float), (void*)0) );
+            GL_ASSERT( glEnableVertexAttribArray(__particleUpdate.rotationAttribute) );
+        }
+
+        // Each particle is moved once as a point, from one state buffer into the other, without rasterizing anything.
+        GL_ASSERT( glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, _gpu->stateBuffers[1 - _gpu->source]) );
+        GL_ASSERT( glEnable(GL_RASTERIZER_DISCARD) );
+        GL_ASSERT( glBeginTransformFeedback(GL_POINTS) );
+        GraphicsDevice::drawArrays(GL_POINTS, 0, (GLsizei)_gpu->deathTimes.size());
+        GL_ASSERT( glEndTransformFeedback() );
+        GL_ASSERT( glDisable(GL_RASTERIZER_DISCARD) );
+        GL_ASSERT( glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0) );
+
+        for (unsigned int i = 0; i < 4; ++i)
+        {
+            if (stateAttributes[i] != -1)
+            {
+                GL_ASSERT( glDisableVertexAttribArray(stateAttributes[i]) );
+            }
+        }
+        if (__particleUpdate.rotationAttribute != -1)
+        {
+            GL_ASSERT( glDisableVertexAttribArray(__particleUpdate.rotationAttribute) );
+        }
+        RenderState::bindBuffer(GL_ARRAY_BUFFER, 0);
+        _gpu->source = 1 - _gpu->source;
+    }
+
+    // The particles die at the times that were recorded when they were emitted.
+    _gpu->time += elapsedMs;
+    _particleCount = 0;
+    for (size_t i = 0, count = _gpu->deathTimes.size(); i < count; ++i)
+    {
+        if (_gpu->deathTimes[i] > _gpu->time)
+            ++_particleCount;
+    }
+#endif
+}
+
+unsigned int ParticleEmitter::drawGpu()
+{
+    GP_ASSERT(_gpu && _gpu->material);
+
+#ifdef PARTICLE_GPU_SIMULATION
+    if (_particleCount == 0)
+        return 1;
+
+    GP_ASSERT(_node && _node->getScene() && _node->getScene()->getActiveCamera() && _node->getScene()->getActiveCamera()->getNode());
+    const Matrix& cameraWorldMatrix = _node->getScene()->getActiveCamera()->getNode()->getWorldMatrix();
+    Vector3 right;
+    cameraWorldMatrix.getRightVector(&right);
+    Vector3 up;
+    cameraWorldMatrix.getUpVector(&up);
+
+    // The sprite frame of each particle is selected in the vertex shader: x is the frame count, y the
+    // animation mode (0: none, 1: over the lifetime, 2: looped), z the lifetime percentage of each frame
+    // and w the duration of each frame in seconds.
+    float animation = 0.0f;
+    if (_spriteAnimated)
+        animation = _spriteLooped ? (_spriteFrameDurationSecs > 0.0f ? 2.0f : 0.0f) : 1.0f;
+    unsigned int frameCount = std::min(_spriteFrameCount, (unsigned int)PARTICLE_FRAME_COUNT_MAX);
+
+    Material* material = _gpu->material;
+    material->getParameter("u_viewProjectionMatrix")->setValue(_node->getViewProjectionMatrix());
+    material->getParameter("u_cameraRight")->setValue(right);
+    material->getParameter("u_cameraUp")->setValue(up);
+    material->getParameter("u_frameCoords")->setValue((const Vector4*)_spriteTextureCoords, frameCount);
+    material->getParameter("u_animation")->setValue(Vector4((float)frameCount, animation, _spritePercentPerFrame, _spriteFrameDurationSecs));
+
+    Pass* pass = material->getTechnique()->getPassByIndex(0);
+    GP_ASSERT(pass);
+    pass->bind();
+
+#ifdef GP_USE_VAO
+    if (glGenVertexArrays)
+    {
+        RenderState::bindVertexArray(0);
+    }
+#endif
+    Effect* effect = pass->getEffect();
+    const VertexAttribute corner = effect->getVertexAttribute("a_position");
+    const VertexAttribute instanceAttributes[] =
+    {
+        effect->getVertexAttribute("a_particlePosition"), effect->getVertexAttribute("a_particleEnergy"),
+        effect->getVertexAttribute("a_particleColorStart"), effect->getVertexAttribute("a_particleColorEnd"),
+        effect->getVertexAttribute("a_particleLife"), effect->getVertexAttribute("a_particleAngle")
+    };
+    const GLint sizes[] = { 3, 1, 4, 4, 4, 2 };
+    const unsigned int offsets[] = { 0, 9, 4, 8, 12, 16 };
+
+    if (corner != -1)
+    {
+        RenderState::bindBuffer(GL_ARRAY_BUFFER, __particleUpdate.cornerBuffer);
+        GL_ASSERT( glVertexAttribPointer(corner, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0) );
+        GL_ASSERT( glEnableVertexAttribArray(corner) );
+    }
+
+    // The first two attributes are read from the state buffer and the others from the attribute buffer,
+    // each advancing once per particle.
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+        if (instanceAttributes[i] == -1)
+            continue;
+        bool state = i < 2;
+        RenderState::bindBuffer(GL_ARRAY_BUFFER, state ? _gpu->stateBuffers[_gpu->source] : _gpu->attributeBuffer);
+        GLsizei stride = (state ? PARTICLE_GPU_STATE_FLOAT_COUNT : PARTICLE_GPU_ATTRIBUTE_FLOAT_COUNT) * sizeof(float);
+        GL_ASSERT( glVertexAttribPointer(instanceAttributes[i], sizes[i], GL_FLOAT, GL_FALSE, stride, (void*)(offsets[i] * sizeof(float))) );
+        GL_ASSERT( glEnableVertexAttribArray(instanceAttributes[i]) );
+        GL_ASSERT( glVertexAttribDivisor(instanceAttributes[i], 1) );
+    }
+
+    // Dead particles are drawn too, and moved out of view by the vertex shader.
+    GraphicsDevice::drawArrays(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)_gpu->deathTimes.size());
+
+    // Restore the attributes so that other draws are not instanced.
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+        if (instanceAttributes[i] != -1)
+        {
+            GL_ASSERT( glVertexAttribDivisor(instanceAttributes[i], 0) );
+            GL_ASSERT( glDisableVertexAttribArray(instanceAttributes[i]) );
+        }
+    }
+    if (corner != -1)
+    {
+        GL_ASSERT( glDisableVertexAttribArray(corner) );
+    }
+    RenderState::bindBuffer(GL_ARRAY_BUFFER, 0);
+    pass->unbind();
+#endif
+    return 1;
+}
+
 }
@@ -10,6 +10,8 @@
 #include "SpriteBatch.h"
 #include "Properties.h"
 #include "Drawable.h"
+#include "BoundingBox.h"
+#include "RadixSort.h"
 
 namespace gameplay
 {
@@ -137,6 +139,22 @@ class Node;
  * be set before rendering the particle system and then will be reset to their original
  * values.  Accepts the same symbolic constants as glBlendFunc().
  *
+ * <h2>GPU simulation:</h2>
+ *
+ * On drivers that support transform feedback and instancing, the particles can be
+ * simulated on the GPU instead (see setGpuSimulation(), or 'gpuSimulation = true' in the
+ * '.particle' file).  The CPU then only generates the initial state of new particles, and
+ * the particles are moved by a vertex shader and drawn as instanced billboards, so large
+ * systems cost little CPU time.  The properties above behave the same in both modes.
+ *
+ * <h2>Sorting:</h2>
+ *
+ * Particles are drawn in the order that they are stored in, which is fine for additive
+ * blending but not for alpha blending, where the particles in front must be drawn last.
+ * A sorted emitter (see setSorted(), or 'sorted = true' in the '.particle' file) draws its
+ * particles from the furthest to the nearest along the view direction of the camera.  The
+ * particles of the GPU simulation are not sorted.
+ *
  * @see http://gameplay3d.github.io/GamePlay/docs/file-formats.html#wiki-Particles
  */
 class ParticleEmitter : public Ref, public Drawable
@@ -700,6 +718,69 @@ public:
      */
     BlendMode getBlendMode() const;
 
+    /**
+     * Sets whether the particles of this emitter are simulated and drawn on the GPU.
+     *
+     * The particles that are alive when the mode changes are removed.  When GPU simulation
+     * is not supported by the graphics driver, the particles stay simulated on the CPU.
+     *
+     * @param enabled true to simulate the particles on the GPU, false to simulate them on the CPU.
+     *
+     * @return true if the particles are simulated on the GPU from now on, false otherwise.
+     * @see isGpuSimulationSupported
+     * @script{ignore}
+     */
+    bool setGpuSimulation(bool enabled);
+
+    /**
+     * Determines whether the particles of this emitter are simulated on the GPU.
+     *
+     * @return true if the particles are simulated on the GPU, false otherwise.
+     * @script{ignore}
+     */
+    bool isGpuSimulation() const;
+
+    /**
+     * Determines whether particles can be simulated on the GPU, which requires transform
+     * feedback and instanced drawing.
+     *
+     * @return true if GPU simulation is supported, false otherwise.
+     * @script{ignore}
+     */
+    static bool isGpuSimulationSupported();
+
+    /**
+     * Sets whether the particles of this emitter are drawn back to front, from the furthest
+     * to the nearest along the view direction of the camera.
+     *
+     * Sorting suits alpha blended particles, which only blend correctly when they are drawn
+     * over the particles behind them.  It has no effect on particles simulated on the GPU.
+     *
+     * @param sorted true to draw the particles back to front, false to draw them in the order
+     *      that they are stored in (the default).
+     * @script{ignore}
+     */
+    void setSorted(bool sorted);
+
+    /**
+     * Determines whether the particles of this emitter are drawn back to front.
+     *
+     * @return true if the particles are sorted, false otherwise.
+     * @script{ignore}
+     */
+    bool isSorted() const;
+
+    /**
+     * Returns the bounds of the particles that were alive after the last update, in world space.
+     *
+     * The bounds are empty when there are no particles, and when the particles are simulated
+     * on the GPU, since their positions are not known on the CPU.
+     *
+     * @return The bounding box of the particles.
+     * @script{ignore}
+     */
+    const BoundingBox& getBoundingBox() const;
+
     /**
      * Updates the particles currently being emitted.
      *
@@ -746,54 +827,109 @@ private:
      */
     ParticleEmitter& operator=(const ParticleEmitter&);
 
-    // Generates a scalar within the range defined by min and max.
-    float generateScalar(float min, float max);
+    /**
+     * Defines the components of the particles in the system.
+     *
+     * Each component is stored in an array of its own, so that the particles can be
+     * updated four at a time.
+     */
+    enum ParticleComponent
+    {
+        PARTICLE_POSITION_X,
+        PARTICLE_POSITION_Y,
+        PARTICLE_POSITION_Z,
+        PARTICLE_VELOCITY_X,
+        PARTICLE_VELOCITY_Y,
+        PARTICLE_VELOCITY_Z,
+        PARTICLE_ACCELERATION_X,
+        PARTICLE_ACCELERATION_Y,
+        PARTICLE_ACCELERATION_Z,
+        PARTICLE_COLOR_START_R,
+        PARTICLE_COLOR_START_G,
+        PARTICLE_COLOR_START_B,
+        PARTICLE_COLOR_START_A,
+        PARTICLE_COLOR_END_R,
+        PARTICLE_COLOR_END_G,
+        PARTICLE_COLOR_END_B,
+        PARTICLE_COLOR_END_A,
+        PARTICLE_COLOR_R,
+        PARTICLE_COLOR_G,
+        PARTICLE_COLOR_B,
+        PARTICLE_COLOR_A,
+        PARTICLE_ROTATION_PER_PARTICLE_SPEED,
+        PARTICLE_ROTATION_AXIS_X,
+        PARTICLE_ROTATION_AXIS_Y,
+        PARTICLE_ROTATION_AXIS_Z,
+        PARTICLE_ROTATION_SPEED,
+        PARTICLE_ANGLE,
+        PARTICLE_ENERGY,
+        PARTICLE_ENERGY_START_INV,
+        PARTICLE_SIZE_START,
+        PARTICLE_SIZE_END,
+        PARTICLE_SIZE,
+        PARTICLE_TIME_ON_CURRENT_FRAME,
+        PARTICLE_COMPONENT_COUNT
+    };
+
+    // Allocates the particle arrays for the specified number of particles, keeping the living particles.
+    void allocateParticles(unsigned int particleCountMax);
+
+    // Gets the array of a particle component.
+    float* getParticleComponent(unsigned int component) const;
+
+    // Moves the particle at the end of the living particles into the slot of a dead particle.
+    void removeParticle(unsigned int index);
 
-    long generateScalar(long min, long max);
+    // Generates a random number between 0 and 1.
+    float generateRandom();
 
-    // Generates a vector within the domain defined by a base vector and its variance.
-    void generateVectorInRect(const Vector3& base, const Vector3& variance, Vector3* dst);
+    // Generates a component of new particles, within the range defined by min and max.
+    void generateScalars(unsigned int component, unsigned int first, unsigned int count, float min, float max);
 
-    // Generates a vector within the ellipsoidal domain defined by a center point and scale vector.
-    void generateVectorInEllipsoid(const Vector3& center, const Vector3& scale, Vector3* dst);
+    // Generates three components of new particles, within the ellipsoidal domain defined by a center point and scale vector.
+    void generateVectorsInEllipsoid(unsigned int component, unsigned int first, unsigned int count, const Vector3& center, const Vector3& scale);
 
-    void generateVector(const Vector3& base, const Vector3& variance, Vector3* dst, bool ellipsoid);
+    // Transforms three components of new particles by a matrix.
+    void transformVectors(unsigned int component, unsigned int first, unsigned int count, const Matrix& matrix);
 
-    // Generates a color within the domain defined by a base vector and its variance.
-    void generateColor(const Vector4& base, const Vector4& variance, Vector4* dst);
+    // Integrates the motion and interpolates the color and size of all particles.
+    void integrateParticles(float elapsedMs, float elapsedSecs);
+
+    // Advances the sprite animations of all particles.
+    void animateParticles(float elapsedSecs);
+
+    // Generates the components of new particles at the specified indices of the particle arrays.
+    void generateParticles(unsigned int first, unsigned int count);
+
+    // Creates the buffers and material of the GPU simulation.
+    bool createGpu();
+
+    // Writes new particles into the slots of dead particles in the GPU buffers.
+    void emitGpu(unsigned int particleCount);
+
+    // Moves the particles in the GPU buffers with the update program.
+    void updateGpu(float elapsedMs, float elapsedSecs);
+
+    // Draws the particles in the GPU buffers as instanced billboards.
+    unsigned int drawGpu();
+
+    // Points the GPU material at the texture and render state of the sprite batch.
+    void bindGpuMaterial();
+
+    // Releases the buffers and material of the GPU simulation.
+    void releaseGpu();
 
     // Gets the blend mode from string.
     static ParticleEmitter::BlendMode getBlendModeFromString(const char* src);
 
-    /**
-     * Defines the data for a single particle in the system.
-     */
-    class Particle
-    {
-
-    public:
-        Vector3 _position;
-        Vector3 _velocity;
-        Vector3 _acceleration;
-        Vector4 _colorStart;
-        Vector4 _colorEnd;
-        Vector4 _color;
-        float _rotationPerParticleSpeed;
-        Vector3 _rotationAxis;
-        float _rotationSpeed;
-        float _angle;
-        long _energyStart;
-        long _energy;
-        float _sizeStart;
-        float _sizeEnd;
-        float _size;
-        unsigned int _frame;
-        float _timeOnCurrentFrame;
-    };
+    struct GpuSimulation;
 
     unsigned int _particleCountMax;
     unsigned int _particleCount;
-    Particle* _particles;
+    unsigned int _particleCapacity;
+    float* _particleData;
+    unsigned int* _particleFrames;
+    unsigned int _randomState[4];
     unsigned int _emissionRate;
     bool _started;
     bool _ellipsoid;
@@ -840,6 +976,12 @@ private:
     float _timePerEmission;
     float _emitTime;
     double _lastUpdated;
+    double _updateTime;
+    BoundingBox _bounds;
+    GpuSimulation* _gpu;
+    bool _sorted;
+    std::vector<unsigned int> _sortKeys;
+    RadixSort _sorter;
 };
 
 }
@@ -0,0 +1,178 @@
+#include "Base.h"
+#include "ParticleSystem.h"
+#include "ParticleEmitter.h"
+#include "Game.h"
+#include "Node.h"
+#include "Scene.h"
+
+// The number of frames between the updates of emitters that are not visible
+#define PARTICLE_CULLED_UPDATE_INTERVAL 4
+// The number of emitters below which they are updated without the job system
+#define PARTICLE_PARALLEL_EMITTER_COUNT 8
+// The number of emitters that each job updates
+#define PARTICLE_EMITTER_BATCH_SIZE 4
+
+namespace gameplay
+{
+
+ParticleSystem::ParticleSystem()
+    : _culledUpdateInterval(PARTICLE_CULLED_UPDATE_INTERVAL)
+{
+}
+
+ParticleSystem::~ParticleSystem()
+{
+    removeAllEmitters();
+}
+
+void ParticleSystem::addEmitter(ParticleEmitter* emitter)
+{
+    GP_ASSERT(emitter);
+
+    for (size_t i = 0, count = _entries.size(); i < count; ++i)
+    {
+        if (_entries[i].emitter == emitter)
+            return;
+    }
+
+    Entry entry;
+    entry.emitter = emitter;
+    entry.elapsedTime = 0.0f;
+    entry.skippedFrames = 0;
+    _entries.push_back(entry);
+    emitter->addRef();
+}
+
+void ParticleSystem::removeEmitter(ParticleEmitter* emitter)
+{
+    for (std::vector<Entry>::iterator itr = _entries.begin(); itr != _entries.end(); ++itr)
+    {
+        if (itr->emitter == emitter)
+        {
+            _entries.erase(itr);
+            SAFE_RELEASE(emitter);
+            return;
+        }
+    }
+}
+
+void ParticleSystem::removeAllEmitters()
+{
+    for (size_t i = 0, count = _entries.size(); i < count; ++i)
+    {
+        SAFE_RELEASE(_entries[i].emitter);
+    }
+    _entries.clear();
+}
+
+unsigned int ParticleSystem::getEmitterCount() const
+{
+    return (unsigned int)_entries.size();
+}
+
+bool ParticleSystem::isActive() const
+{
+    for (size_t i = 0, count = _entries.size(); i < count; ++i)
+    {
+        if (_entries[i].emitter->isActive())
+            return true;
+    }
+    return false;
+}
+
+ParticleEmitter* ParticleSystem::getEmitter(unsigned int index) const
+{
+    GP_ASSERT(index < _entries.size());
+    return _entries[index].emitter;
+}
+
+void ParticleSystem::setCulledUpdateInterval(unsigned int frames)
+{
+    _culledUpdateInterval = frames;
+}
+
+unsigned int ParticleSystem::getCulledUpdateInterval() const
+{
+    return _culledUpdateInterval;
+}
+
+bool ParticleSystem::isVisible(ParticleEmitter* emitter)
+{
+    const BoundingBox& bounds = emitter->getBoundingBox();
+    if (bounds.isEmpty())
+        return true;
+
+    Scene* scene = emitter->getNode()->getScene();
+    Camera* camera = scene ? scene->getActiveCamera() : NULL;
+    if (!camera)
+        return true;
+
+    return camera->getFrustum().intersects(bounds);
+}
+
+void ParticleSystem::update(float elapsedTime)
+{
+    GP_PROFILE_SCOPE("ParticleSystem::update");
+
+    // Select the emitters to update this frame. Emitters that are not visible save up the time
+    // that passes until they are updated.
+    _cpuUpdates.clear();
+    _gpuUpdates.clear();
+    for (size_t i = 0, count = _entries.size(); i < count; ++i)
+    {
+        Entry& entry = _entries[i];
+        ParticleEmitter* emitter = entry.emitter;
+        Node* node = emitter->getNode();
+        if (!node || !node->isEnabledInHierarchy() || !emitter->isActive())
+            continue;
+
+        entry.elapsedTime += elapsedTime;
+        if (!isVisible(emitter))
+        {
+            if (_culledUpdateInterval == 0)
+            {
+                entry.elapsedTime = 0.0f;
+                continue;
+            }
+            if (++entry.skippedFrames < _culledUpdateInterval)
+                continue;
+        }
+        entry.skippedFrames = 0;
+
+        // The world matrices are resolved here, so that the jobs only read them.
+        node->getWorldMatrix();
+
+        if (emitter->isGpuSimulation())
+            _gpuUpdates.push_back(&entry);
+        else
+            _cpuUpdates.push_back(&entry);
+    }
+
+    // The emitters simulated on the CPU only write to their own particles.
+    if (!_cpuUpdates.empty())
+    {
+        JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+        unsigned int count = (unsigned int)_cpuUpdates.size();
+        if (jobSystem && count >= PARTICLE_PARALLEL_EMITTER_COUNT)
+            jobSystem->parallelFor(count, PARTICLE_EMITTER_BATCH_SIZE, &ParticleSystem::updateEmitters, &_cpuUpdates[0]);
+        else
+            updateEmitters(&_cpuUpdates[0], 0, count);
+    }
+
+    // The emitters simulated on the GPU write to their buffers, which must happen on this thread.
+    if (!_gpuUpdates.empty())
+        updateEmitters(&_gpuUpdates[0], 0, (unsigned int)_gpuUpdates.size());
+}
+
+void ParticleSystem::updateEmitters(void* cookie, unsigned int begin, unsigned int end)
+{
+    Entry** entries = (Entry**)cookie;
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        Entry* entry = entries[i];
+        entry->emitter->update(entry->elapsedTime);
+        entry->elapsedTime = 0.0f;
+    }
+}
+
+}
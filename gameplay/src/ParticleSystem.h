@@ -0,0 +1,148 @@
+#ifndef PARTICLESYSTEM_H_
+#define PARTICLESYSTEM_H_
+
+namespace gameplay
+{
+
+class ParticleEmitter;
+
+/**
+ * Defines the update of many particle emitters at once.
+ *
+ * The particle system is owned by the Game and updates the emitters that are added to it
+ * once per frame, after Game::update() has run. The emitters that are simulated on the CPU
+ * are updated in parallel on the job system, and the emitters that are simulated on the GPU
+ * are then updated one after the other on the thread that runs the game, since updating them
+ * writes to their vertex buffers.
+ *
+ * Emitters whose particles are outside of the view of the active camera of their scene are
+ * only updated every few frames, with the time that has passed since their last update, or
+ * not at all (see setCulledUpdateInterval). The visibility of an emitter is based on the
+ * bounds of its particles after its last update, so an emitter without particles, and an
+ * emitter that is simulated on the GPU, is always considered visible.
+ *
+ * Emitters that are added to the particle system should not be updated by the game as well.
+ *
+ * @script{ignore}
+ */
+class ParticleSystem
+{
+    friend class Game;
+
+public:
+
+    /**
+     * Adds an emitter to be updated every frame.
+     *
+     * The reference count of the emitter is increased until it is removed again.
+     *
+     * @param emitter The emitter to add.
+     */
+    void addEmitter(ParticleEmitter* emitter);
+
+    /**
+     * Removes an emitter that was added to the particle system.
+     *
+     * @param emitter The emitter to remove.
+     */
+    void removeEmitter(ParticleEmitter* emitter);
+
+    /**
+     * Removes all emitters from the particle system.
+     */
+    void removeAllEmitters();
+
+    /**
+     * Returns the number of emitters that the particle system updates.
+     *
+     * @return The number of emitters.
+     */
+    unsigned int getEmitterCount() const;
+
+    /**
+     * Returns the emitter at the specified index.
+     *
+     * @param index The index of the emitter.
+     *
+     * @return The emitter at the specified index.
+     */
+    ParticleEmitter* getEmitter(unsigned int index) const;
+
+    /**
+     * Sets how often the emitters that are outside of the view of the camera are updated.
+     *
+     * @param frames The number of frames between the updates of an emitter that is not visible,
+     *      1 to update it every frame, or 0 to stop updating it until it is visible again.
+     */
+    void setCulledUpdateInterval(unsigned int frames);
+
+    /**
+     * Returns how often the emitters that are outside of the view of the camera are updated.
+     *
+     * @return The number of frames between the updates of an emitter that is not visible.
+     */
+    unsigned int getCulledUpdateInterval() const;
+
+private:
+
+    /**
+     * The update state of an emitter.
+     */
+    struct Entry
+    {
+        ParticleEmitter* emitter;
+        float elapsedTime;
+        unsigned int skippedFrames;
+    };
+
+    /**
+     * Constructor.
+     */
+    ParticleSystem();
+
+    /**
+     * Hidden copy constructor.
+     */
+    ParticleSystem(const ParticleSystem& copy);
+
+    /**
+     * Destructor.
+     */
+    ~ParticleSystem();
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    ParticleSystem& operator=(const ParticleSystem&);
+
+    /**
+     * Updates the emitters. Called once per frame by the Game.
+     *
+     * @param elapsedTime The time that has passed since the last frame, in milliseconds.
+     */
+    void update(float elapsedTime);
+
+    /**
+     * Determines whether any of the emitters is emitting or has live particles.
+     */
+    bool isActive() const;
+
+    /**
+     * Determines whether the particles of an emitter can be seen by the active camera of its scene.
+     */
+    static bool isVisible(ParticleEmitter* emitter);
+
+    /**
+     * Updates a range of the emitters that are simulated on the CPU.
+     */
+    static void updateEmitters(void* cookie, unsigned int begin, unsigned int end);
+
+    std::vector<Entry> _entries;
+    std::vector<Entry*> _cpuUpdates;
+    std::vector<Entry*> _gpuUpdates;
+    unsigned int _culledUpdateInterval;
+};
+
+}
+
+#endif
@@ -4,22 +4,32 @@
 #include "Material.h"
 #include "Node.h"
 
+// The fragment shader of the depth variants of passes
+#define PASS_DEPTH_FRAGMENT_SHADER "res/shaders/depth.frag"
+
+// The fragment shader of the shadow variants of passes
+#define PASS_SHADOW_FRAGMENT_SHADER "res/shaders/shadow.frag"
+
 namespace gameplay
 {
 
 Pass::Pass(const char* id, Technique* technique) :
-    _id(id ? id : ""), _technique(technique), _effect(NULL), _vaBinding(NULL)
+    _id(id), _technique(technique), _effect(NULL), _vaBinding(NULL), _depthPass(NULL), _depthEqualPass(NULL),
+    _shadowPass(NULL), _depthVariantsCreated(false), _isDepthPass(false)
 {
     RenderState::_parent = _technique;
 }
 
 Pass::~Pass()
 {
+    SAFE_RELEASE(_depthPass);
+    SAFE_RELEASE(_depthEqualPass);
+    SAFE_RELEASE(_shadowPass);
     SAFE_RELEASE(_effect);
     SAFE_RELEASE(_vaBinding);
 }
 
-bool Pass::initialize(const char* vshPath, const char* fshPath, const char* defines)
+bool Pass::initialize(const char* vshPath, const char* fshPath, const char* defines, bool async)
 {
     GP_ASSERT(vshPath);
     GP_ASSERT(fshPath);
@@ -28,7 +38,7 @@ bool Pass::initialize(const char* vshPath, const char* fshPath, const char* defi
     SAFE_RELEASE(_vaBinding);
 
     // Attempt to create/load the effect.
-    _effect = Effect::createFromFile(vshPath, fshPath, defines);
+    _effect = async ? Effect::createFromFileAsync(vshPath, fshPath, defines) : Effect::createFromFile(vshPath, fshPath, defines);
     if (_effect == NULL)
     {
         GP_WARN("Failed to create effect for pass. vertexShader = %s, fragmentShader = %s, defines = %s", vshPath, fshPath, defines ? defines : "");
@@ -90,6 +100,87 @@ void Pass::unbind()
     }
 }
 
+Pass* Pass::getDepthPass()
+{
+    if (!_depthVariantsCreated)
+        createDepthVariants();
+    return _depthPass && _depthPass->_effect->isReady() ? _depthPass : NULL;
+}
+
+Pass* Pass::getDepthEqualPass()
+{
+    return getDepthPass() ? _depthEqualPass : NULL;
+}
+
+Pass* Pass::getShadowPass()
+{
+    if (!_depthVariantsCreated)
+        createDepthVariants();
+    return _shadowPass && _shadowPass->_effect->isReady() ? _shadowPass : NULL;
+}
+
+bool Pass::isDepthPass() const
+{
+    return _isDepthPass;
+}
+
+void Pass::createDepthVariants()
+{
+    GP_ASSERT(_effect);
+
+    // The shaders and defines of the variants are only known once the effect is loaded.
+    if (!_effect->isReady())
+        return;
+    _depthVariantsCreated = true;
+
+    if (_isDepthPass || isBlendEnabled())
+        return;
+
+    // Effects loaded from files are identified by their vertex shader, fragment shader and defines,
+    // separated by semicolons (the defines are separated by semicolons as well).
+    const std::string id = _effect->getId();
+    size_t vshEnd = id.find(';');
+    size_t fshEnd = vshEnd == std::string::npos ? std::string::npos : id.find(';', vshEnd + 1);
+    if (fshEnd == std::string::npos)
+        return;
+    std::string vshPath = id.substr(0, vshEnd);
+    std::string defines = id.substr(fshEnd + 1);
+    if (defines.find("DISCARD") != std::string::npos)
+        return;
+
+    // Shadow casters are drawn whether or not the pass tests and writes depth.
+    _shadowPass = createDepthOnlyPass("_shadow", vshPath, PASS_SHADOW_FRAGMENT_SHADER, defines);
+    if (!isDepthTestEnabled() || !isDepthWriteEnabled())
+        return;
+
+    _depthPass = createDepthOnlyPass("_depth", vshPath, PASS_DEPTH_FRAGMENT_SHADER, defines);
+    if (_depthPass == NULL)
+        return;
+
+    Pass* equalPass = new Pass((std::string(_id.c_str()) + "_depthEqual").c_str(), _technique);
+    equalPass->_effect = _effect;
+    _effect->addRef();
+    equalPass->_parent = this;
+    equalPass->getStateBlock()->setDepthFunction(DEPTH_EQUAL);
+    equalPass->getStateBlock()->setDepthWrite(false);
+    _depthEqualPass = equalPass;
+}
+
+Pass* Pass::createDepthOnlyPass(const char* idSuffix, const std::string& vshPath, const char* fshPath, const std::string& defines)
+{
+    Pass* pass = new Pass((std::string(_id.c_str()) + idSuffix).c_str(), _technique);
+    if (!pass->initialize(vshPath.c_str(), fshPath, defines.empty() ? NULL : defines.c_str(), true))
+    {
+        SAFE_RELEASE(pass);
+        return NULL;
+    }
+    pass->_parent = this;
+    pass->_isDepthPass = true;
+    pass->getStateBlock()->setDepthTest(true);
+    pass->getStateBlock()->setDepthWrite(true);
+    return pass;
+}
+
 Pass* Pass::clone(Technique* technique, NodeCloneContext &context) const
 {
     GP_ASSERT(_effect);
@@ -3,6 +3,7 @@
 
 #include "RenderState.h"
 #include "VertexAttributeBinding.h"
+#include "StringId.h"
 
 namespace gameplay
 {
@@ -68,6 +69,61 @@ public:
      */
     void unbind();
 
+    /**
+     * Returns a variant of this pass that only writes depth, for a depth pre-pass (see
+     * RenderQueue::setDepthPrePass).
+     *
+     * The variant compiles the vertex shader of this pass with the same defines, so that it
+     * produces exactly the same depths, along with a fragment shader that does no shading.
+     * It inherits the parameters and render state of this pass, and always tests and
+     * writes depth.
+     *
+     * Passes that blend, that do not both test and write depth, or whose shaders discard
+     * pixels (with a define containing DISCARD) have no depth variant, and neither do passes
+     * whose effect was not loaded from shader files. The variant is created the first time
+     * it is requested, and its effect compiles asynchronously, so NULL is returned until it
+     * is ready.
+     *
+     * @return The depth variant of this pass, or NULL if there is none (yet).
+     * @script{ignore}
+     */
+    Pass* getDepthPass();
+
+    /**
+     * Returns a variant of this pass that shades the pixels filled in by its depth variant.
+     *
+     * The variant uses the effect, parameters and render state of this pass, except that it
+     * only passes the depth test where the depth is equal to the depth in the buffer, and
+     * does not write depth.
+     *
+     * @return The depth equal variant of this pass, or NULL if it has no depth variant (yet).
+     * @script{ignore}
+     */
+    Pass* getDepthEqualPass();
+
+    /**
+     * Returns a variant of this pass that draws shadow casters into a shadow map (see ShadowMaps).
+     *
+     * Like the depth variant, it compiles the vertex shader of this pass with the same defines,
+     * along with a fragment shader that writes the encoded depth of the caster, and it inherits
+     * the parameters and render state of this pass. Passes that blend or whose shaders discard
+     * pixels have no shadow variant, and neither do passes whose effect was not loaded from
+     * shader files. NULL is returned until the effect of the variant is ready.
+     *
+     * @return The shadow variant of this pass, or NULL if there is none (yet).
+     * @script{ignore}
+     */
+    Pass* getShadowPass();
+
+    /**
+     * Determines if this pass is the depth or shadow variant of another pass (see getDepthPass
+     * and getShadowPass).
+     *
+     * @return true if this pass only writes depth.
+     * @script{ignore}
+     */
+    bool isDepthPass() const;
+
 private:
 
     /**
@@ -87,8 +143,10 @@ private:
 
     /**
      * Creates a new pass for the given shaders.
+     *
+     * If async is true, the effect of the pass may still be compiling when this method returns.
      */
-    bool initialize(const char* vshPath, const char* fshPath, const char* defines);
+    bool initialize(const char* vshPath, const char* fshPath, const char* defines, bool async = false);
 
     /**
      * Hidden copy assignment operator.
@@ -105,10 +163,25 @@ private:
      */
     Pass* clone(Technique* technique, NodeCloneContext &context) const;
 
-    std::string _id;
+    /**
+     * Creates the depth, depth equal and shadow variants of this pass, if it can have them.
+     */
+    void createDepthVariants();
+
+    /**
+     * Creates a variant of this pass that only writes depth, with the specified fragment shader.
+     */
+    Pass* createDepthOnlyPass(const char* idSuffix, const std::string& vshPath, const char* fshPath, const std::string& defines);
+
+    StringId _id;
     Technique* _technique;
     Effect* _effect;
     VertexAttributeBinding* _vaBinding;
+    Pass* _depthPass;
+    Pass* _depthEqualPass;
+    Pass* _shadowPass;
+    bool _depthVariantsCreated;
+    bool _isDepthPass;
 };
 
 }
@@ -10,9 +10,26 @@
 #include "Game.h"
 #include "PhysicsController.h"
 
+// The number of characters of a batch that a thread moves at a time.
+#define CHARACTER_BATCH_SIZE 8
+
+// The maximum number of passes of collision recovery in each tick.
+#define CHARACTER_MAX_RECOVERY_PASSES 5
+
+// The penetration depth below which collision recovery stops before its last pass.
+#define CHARACTER_RECOVERY_TOLERANCE 0.001f
+
 namespace gameplay
 {
 
+// The characters that are moved together, and the tick that they are moved for.
+struct CharacterBatch
+{
+    PhysicsCharacter* const* characters;
+    btCollisionWorld* collisionWorld;
+    btScalar deltaTimeStep;
+};
+
 /**
  * @script{ignore}
  */
@@ -52,8 +69,8 @@ protected:
 PhysicsCharacter::PhysicsCharacter(Node* node, const PhysicsCollisionShape::Definition& shape, float mass, int group, int mask)
     : PhysicsGhostObject(node, shape, group, mask), _moveVelocity(0,0,0), _forwardVelocity(0.0f), _rightVelocity(0.0f),
     _verticalVelocity(0, 0, 0), _currentVelocity(0,0,0), _normalizedVelocity(0,0,0),
-    _colliding(false), _collisionNormal(0,0,0), _currentPosition(0,0,0), _stepHeight(0.1f),
-    _slopeAngle(0.0f), _cosSlopeAngle(1.0f), _physicsEnabled(true), _mass(mass), _actionInterface(NULL)
+    _colliding(false), _collisionNormal(0,0,0), _currentPosition(0,0,0), _startPosition(0,0,0), _stepHeight(0.1f),
+    _slopeAngle(0.0f), _cosSlopeAngle(1.0f), _physicsEnabled(true), _mass(mass)
 {
     setMaxSlopeAngle(45.0f);
 
@@ -61,19 +78,19 @@ PhysicsCharacter::PhysicsCharacter(Node* node, const PhysicsCollisionShape::Defi
     GP_ASSERT(_ghostObject);
     _ghostObject->setCollisionFlags(_ghostObject->getCollisionFlags() | btCollisionObject::CF_CHARACTER_OBJECT | btCollisionObject::CF_NO_CONTACT_RESPONSE);
 
-    // Register ourselves as an action on the physics world so we are called back during physics ticks.
-    GP_ASSERT(Game::getInstance()->getPhysicsController() && Game::getInstance()->getPhysicsController()->_world);
-    _actionInterface = new ActionInterface(this);
-    Game::getInstance()->getPhysicsController()->_world->addAction(_actionInterface);
+    // Register ourselves with the physics controller so we are updated during physics ticks.
+    GP_ASSERT(Game::getInstance()->getPhysicsController());
+    Game::getInstance()->getPhysicsController()->_characters.push_back(this);
 }
 
 PhysicsCharacter::~PhysicsCharacter()
 {
-    // Unregister ourselves as action from world.
-    GP_ASSERT(Game::getInstance()->getPhysicsController() && Game::getInstance()->getPhysicsController()->_world);
-    Game::getInstance()->getPhysicsController()->_world->removeAction(_actionInterface);
-    SAFE_DELETE(_actionInterface);
-
+    // Unregister ourselves from the physics controller.
+    GP_ASSERT(Game::getInstance()->getPhysicsController());
+    std::vector<PhysicsCharacter*>& characters = Game::getInstance()->getPhysicsController()->_characters;
+    std::vector<PhysicsCharacter*>::iterator itr = std::find(characters.begin(), characters.end(), this);
+    if (itr != characters.end())
+        characters.erase(itr);
 }
 
 PhysicsCharacter* PhysicsCharacter::create(Node* node, Properties* properties)
@@ -390,15 +407,8 @@ void PhysicsCharacter::stepForwardAndStrafe(btCollisionWorld* collisionWorld, fl
         if (callback.hasHit())
         {
             Vector3 normal(callback.m_hitNormalWorld.x(), callback.m_hitNormalWorld.y(), callback.m_hitNormalWorld.z());
-            PhysicsCollisionObject* o = Game::getInstance()->getPhysicsController()->getCollisionObject(callback.m_hitCollisionObject);
-            GP_ASSERT(o);
-            if (o->getType() == PhysicsCollisionObject::RIGID_BODY && o->isDynamic())
-            {
-                PhysicsRigidBody* rb = static_cast<PhysicsRigidBody*>(o);
-                GP_ASSERT(rb);
-                normal.normalize();
-                rb->applyImpulse(_mass * -normal * velocity.length());
-            }
+            normal.normalize();
+            addImpulse(callback.m_hitCollisionObject, _mass * -normal * velocity.length());
 
             updateTargetPositionFromCollision(targetPosition, callback.m_hitNormalWorld);
 
@@ -480,15 +490,7 @@ void PhysicsCharacter::stepDown(btCollisionWorld* collisionWorld, btScalar time)
             }
             else
             {
-                PhysicsCollisionObject* o = Game::getInstance()->getPhysicsController()->getCollisionObject(callback.m_hitCollisionObject);
-                GP_ASSERT(o);
-                if (o->getType() == PhysicsCollisionObject::RIGID_BODY && o->isDynamic())
-                {
-                    PhysicsRigidBody* rb = static_cast<PhysicsRigidBody*>(o);
-                    GP_ASSERT(rb);
-                    normal.normalize();
-                    rb->applyImpulse(_mass * -normal * sqrt(BV(normal).dot(_verticalVelocity)));
-                }
+                addImpulse(callback.m_hitCollisionObject, _mass * -normal * sqrt(BV(normal).dot(_verticalVelocity)));
 
                 updateTargetPositionFromCollision(targetPosition, BV(normal));
             }
@@ -565,7 +567,7 @@ void PhysicsCharacter::updateTargetPositionFromCollision(btVector3& targetPositi
     }
 }
 
-bool PhysicsCharacter::fixCollision(btCollisionWorld* world)
+bool PhysicsCharacter::fixCollision(btCollisionWorld* world, btScalar* maxPenetration)
 {
     GP_ASSERT(_node);
     GP_ASSERT(_ghostObject);
@@ -585,7 +587,7 @@ bool PhysicsCharacter::fixCollision(btCollisionWorld* world)
     btVector3 currentPosition = BV(startPosition);
 
     // Handle all collisions/overlapping pairs.
-    btScalar maxPenetration = btScalar(0.0);
+    *maxPenetration = btScalar(0.0);
     for (int i = 0, count = pairCache->getNumOverlappingPairs(); i < count; ++i)
     {
         _manifoldArray.resize(0);
@@ -621,10 +623,10 @@ bool PhysicsCharacter::fixCollision(btCollisionWorld* world)
                 if (dist < 0.0)
                 {
                     // A negative distance means the objects are overlapping.
-                    if (dist < maxPenetration)
+                    if (dist < *maxPenetration)
                     {
                         // Store collision normal for this point.
-                        maxPenetration = dist;
+                        *maxPenetration = dist;
                         _collisionNormal = pt.m_normalWorldOnB * directionSign;
                     }
 
@@ -644,25 +646,66 @@ bool PhysicsCharacter::fixCollision(btCollisionWorld* world)
     return collision;
 }
 
-PhysicsCharacter::ActionInterface::ActionInterface(PhysicsCharacter* character) : character(character)
+void PhysicsCharacter::addImpulse(const btCollisionObject* collisionObject, const Vector3& impulse)
 {
+    // The impulses are applied once all the characters have moved, since several characters
+    // can push the same rigid body from different threads.
+    PhysicsCollisionObject* o = Game::getInstance()->getPhysicsController()->getCollisionObject(collisionObject);
+    GP_ASSERT(o);
+    if (o->getType() == PhysicsCollisionObject::RIGID_BODY && o->isDynamic())
+        _impulses.push_back(std::make_pair(static_cast<PhysicsRigidBody*>(o), impulse));
 }
 
-void PhysicsCharacter::ActionInterface::updateAction(btCollisionWorld* collisionWorld, btScalar deltaTimeStep)
+void PhysicsCharacter::updateCharacters(PhysicsCharacter* const* characters, unsigned int count, btCollisionWorld* collisionWorld, btScalar deltaTimeStep)
 {
-    character->updateAction(collisionWorld, deltaTimeStep);
+    if (count == 0)
+        return;
+
+    // Collision recovery dispatches the contacts of the ghost objects, which changes the
+    // state of the dispatcher, so the characters recover one after another.
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        if (characters[i]->isEnabled())
+            characters[i]->recoverFromCollisions(collisionWorld);
+    }
+
+    CharacterBatch batch;
+    batch.characters = characters;
+    batch.collisionWorld = collisionWorld;
+    batch.deltaTimeStep = deltaTimeStep;
+#if BT_THREADSAFE
+    // The movement of each character reads the world matrix of its node, which is resolved
+    // here since nodes update their cached world matrices when they are read.
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        if (characters[i]->isEnabled())
+            characters[i]->_node->getWorldMatrix();
+    }
+    Game::getInstance()->getJobSystem()->parallelFor(count, CHARACTER_BATCH_SIZE, &PhysicsCharacter::moveCharacters, &batch);
+#else
+    moveCharacters(&batch, 0, count);
+#endif
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        if (characters[i]->isEnabled())
+            characters[i]->finishMove();
+    }
 }
 
-void PhysicsCharacter::ActionInterface::debugDraw(btIDebugDraw* debugDrawer)
+void PhysicsCharacter::moveCharacters(void* cookie, unsigned int begin, unsigned int end)
 {
-    // Not used yet.
+    CharacterBatch* batch = (CharacterBatch*)cookie;
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        PhysicsCharacter* character = batch->characters[i];
+        if (character->isEnabled())
+            character->move(batch->collisionWorld, batch->deltaTimeStep);
+    }
 }
 
-void PhysicsCharacter::updateAction(btCollisionWorld* collisionWorld, btScalar deltaTimeStep)
+void PhysicsCharacter::recoverFromCollisions(btCollisionWorld* collisionWorld)
 {
-    if (!isEnabled())
-        return;
-
     GP_ASSERT(_ghostObject);
     GP_ASSERT(_node);
 
@@ -674,23 +717,26 @@ void PhysicsCharacter::updateAction(btCollisionWorld* collisionWorld, btScalar d
     // dynamic objects (i.e. objects that moved and now intersect the character).
     if (_physicsEnabled)
     {
+        // Each pass moves the character part of the way out of what it penetrates, so the
+        // passes stop once it is nearly out rather than always running to the limit.
         _colliding = false;
-        int stepCount = 0;
-        while (fixCollision(collisionWorld))
+        btScalar maxPenetration;
+        for (unsigned int pass = 0; pass < CHARACTER_MAX_RECOVERY_PASSES && fixCollision(collisionWorld, &maxPenetration); ++pass)
         {
             _colliding = true;
-
-            if (++stepCount > 4)
-            {
-                // Most likely we are wedged between a number of different collision objects.
+            if (maxPenetration > -CHARACTER_RECOVERY_TOLERANCE)
                 break;
-            }
         }
     }
+}
+
+void PhysicsCharacter::move(btCollisionWorld* collisionWorld, btScalar deltaTimeStep)
+{
+    GP_ASSERT(_ghostObject);
 
     // Update current and target world positions.
-    btVector3 startPosition = _ghostObject->getWorldTransform().getOrigin();
-    _currentPosition = startPosition;
+    _startPosition = _ghostObject->getWorldTransform().getOrigin();
+    _currentPosition = _startPosition;
 
     // Process movement in the up direction.
     if (_physicsEnabled)
@@ -702,9 +748,20 @@ void PhysicsCharacter::updateAction(btCollisionWorld* collisionWorld, btScalar d
     // Process movement in the down direction.
     if (_physicsEnabled)
         stepDown(collisionWorld, deltaTimeStep);
+}
+
+void PhysicsCharacter::finishMove()
+{
+    GP_ASSERT(_node);
+
+    for (size_t i = 0, count = _impulses.size(); i < count; ++i)
+    {
+        _impulses[i].first->applyImpulse(_impulses[i].second);
+    }
+    _impulses.clear();
 
     // Set new position.
-    btVector3 newPosition = _currentPosition - startPosition;
+    btVector3 newPosition = _currentPosition - _startPosition;
     Vector3 translation = Vector3(newPosition.x(), newPosition.y(), newPosition.z());
     if (translation !=  Vector3::zero())
         _node->translate(translation);
@@ -8,6 +8,8 @@
 namespace gameplay
 {
 
+class PhysicsRigidBody;
+
 /**
  * Defines a physics controller class for a game character.
  *
@@ -19,11 +21,19 @@ namespace gameplay
  * character than would be possible if trying to move a character by applying
  * physical simulation with forces.
  *
+ * All the characters of the physics world are updated together during each physics tick.
+ * The characters first recover from the collisions that they are in, one after another.
+ * They are then moved by sweeping their collision shapes against the world, which only reads
+ * the world and is split between the threads of the job system when Bullet is built with
+ * thread support (BT_THREADSAFE). Finally they are translated to their new positions, and
+ * push the dynamic rigid bodies that they ran into.
+ *
  * @see http://gameplay3d.github.io/GamePlay/docs/file-formats.html#wiki-Collision_Objects
  */
 class PhysicsCharacter : public PhysicsGhostObject
 {
     friend class Node;
+    friend class PhysicsController;
 
 public:
 
@@ -237,26 +247,27 @@ private:
 
     void updateTargetPositionFromCollision(btVector3& targetPosition, const btVector3& collisionNormal);
 
-    bool fixCollision(btCollisionWorld* world);
+    bool fixCollision(btCollisionWorld* world, btScalar* maxPenetration);
 
     /**
-     * Hides the callback interfaces within the PhysicsCharacter.
-     * @script{ignore}
+     * Updates the characters of the physics world during a physics tick.
+     *
+     * @param characters The characters to update.
+     * @param count The number of characters.
+     * @param collisionWorld The physics world.
+     * @param deltaTimeStep The time of the tick, in seconds.
      */
-    class ActionInterface : public btActionInterface
-    {
-    public:
+    static void updateCharacters(PhysicsCharacter* const* characters, unsigned int count, btCollisionWorld* collisionWorld, btScalar deltaTimeStep);
+
+    static void moveCharacters(void* cookie, unsigned int begin, unsigned int end);
 
-        ActionInterface(PhysicsCharacter* character);
+    void recoverFromCollisions(btCollisionWorld* collisionWorld);
 
-        void updateAction(btCollisionWorld* collisionWorld, btScalar deltaTimeStep);
+    void move(btCollisionWorld* collisionWorld, btScalar deltaTimeStep);
 
-        void debugDraw(btIDebugDraw* debugDrawer);
-        
-        PhysicsCharacter* character;
-    };
+    void finishMove();
 
-    void updateAction(btCollisionWorld* collisionWorld, btScalar deltaTimeStep);
+    void addImpulse(const btCollisionObject* collisionObject, const Vector3& impulse);
 
     btVector3 _moveVelocity;
     float _forwardVelocity;
@@ -267,13 +278,14 @@ private:
     bool _colliding;
     btVector3 _collisionNormal;
     btVector3 _currentPosition;
+    btVector3 _startPosition;
+    std::vector<std::pair<PhysicsRigidBody*, Vector3> > _impulses;
     btManifoldArray _manifoldArray;
     float _stepHeight;
     float _slopeAngle;
     float _cosSlopeAngle;
     bool _physicsEnabled;
     float _mass;
-    ActionInterface* _actionInterface;
 };
 
 }
@@ -211,7 +211,7 @@ bool PhysicsCollisionObject::CollisionPair::operator < (const CollisionPair& col
 }
 
 PhysicsCollisionObject::PhysicsMotionState::PhysicsMotionState(Node* node, PhysicsCollisionObject* collisionObject, const Vector3* centerOfMassOffset) :
-    _node(node), _collisionObject(collisionObject), _centerOfMassOffset(btTransform::getIdentity())
+    _node(node), _collisionObject(collisionObject), _centerOfMassOffset(btTransform::getIdentity()), _moved(false), _settled(true)
 {
     if (centerOfMassOffset)
     {
@@ -242,14 +242,59 @@ void PhysicsCollisionObject::PhysicsMotionState::setWorldTransform(const btTrans
     GP_ASSERT(_node);
 
     _worldTransform = transform * _centerOfMassOffset;
-        
-    const btQuaternion& rot = _worldTransform.getRotation();
-    const btVector3& pos = _worldTransform.getOrigin();
+    _moved = true;
+
+    // While the controller interpolates, the node is placed once all steps of the frame are done.
+    PhysicsController* controller = Game::getInstance()->getPhysicsController();
+    if (controller && controller->isInterpolating())
+        return;
+
+    applyTransform(_worldTransform);
+}
+
+void PhysicsCollisionObject::PhysicsMotionState::applyTransform(const btTransform& transform)
+{
+    GP_ASSERT(_node);
+
+    const btQuaternion& rot = transform.getRotation();
+    const btVector3& pos = transform.getOrigin();
 
     _node->setRotation(rot.x(), rot.y(), rot.z(), rot.w());
     _node->setTranslation(pos.x(), pos.y(), pos.z());
 }
 
+void PhysicsCollisionObject::PhysicsMotionState::beginStep()
+{
+    GP_ASSERT(_collisionObject);
+
+    // Bullet extrapolates the transforms it passes to motion states, so the body's own transform is used instead.
+    _previousTransform = _collisionObject->getCollisionObject()->getWorldTransform() * _centerOfMassOffset;
+    _moved = false;
+}
+
+void PhysicsCollisionObject::PhysicsMotionState::interpolate(float alpha)
+{
+    GP_ASSERT(_collisionObject);
+
+    const btTransform current = _collisionObject->getCollisionObject()->getWorldTransform() * _centerOfMassOffset;
+    if (!_moved)
+    {
+        // The body did not move in the last step, so the node only has to catch up with it once.
+        if (!_settled)
+        {
+            applyTransform(current);
+            _settled = true;
+        }
+        return;
+    }
+
+    btTransform transform;
+    transform.setOrigin(_previousTransform.getOrigin().lerp(current.getOrigin(), alpha));
+    transform.setRotation(_previousTransform.getRotation().slerp(current.getRotation(), alpha));
+    applyTransform(transform);
+    _settled = false;
+}
+
 void PhysicsCollisionObject::PhysicsMotionState::updateTransformFromNode() const
 {
     GP_ASSERT(_node);
@@ -274,6 +319,7 @@ void PhysicsCollisionObject::PhysicsMotionState::updateTransformFromNode() const
     {
         _worldTransform = btTransform(BQ(rotation), btVector3(m.m[12], m.m[13], m.m[14]));
     }
+    _previousTransform = _worldTransform;
 }
 
 void PhysicsCollisionObject::PhysicsMotionState::setCenterOfMassOffset(const Vector3& centerOfMassOffset)
@@ -29,6 +29,7 @@ class PhysicsCollisionObject
     friend class PhysicsConstraint;
     friend class PhysicsRigidBody;
     friend class PhysicsGhostObject;
+    friend class SceneSnapshot;
 
 public:
 
@@ -385,13 +386,30 @@ private:
          * Sets the center of mass offset for the associated collision shape.
          */
         void setCenterOfMassOffset(const Vector3& centerOfMassOffset);
+
+        /**
+         * Keeps the current transform of the rigid body as the start of the interpolation before a fixed step.
+         */
+        void beginStep();
+
+        /**
+         * Sets the transform of the node between the transforms of the rigid body before and after the last fixed step.
+         *
+         * @param alpha The fraction of the way from the transform before the step to the transform after it.
+         */
+        void interpolate(float alpha);
         
     private:
+
+        void applyTransform(const btTransform& transform);
         
         Node* _node;
         PhysicsCollisionObject* _collisionObject;
         btTransform _centerOfMassOffset;
         mutable btTransform _worldTransform;
+        mutable btTransform _previousTransform;
+        bool _moved;
+        bool _settled;
     };
 
     /** 
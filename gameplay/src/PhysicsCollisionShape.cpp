@@ -2,6 +2,7 @@
 #include "PhysicsCollisionShape.h"
 #include "Node.h"
 #include "Image.h"
+#include "MeshGeometry.h"
 #include "Properties.h"
 #include "FileSystem.h"
 #include "HeightField.h"
@@ -11,7 +12,7 @@ namespace gameplay
 {
 
 PhysicsCollisionShape::PhysicsCollisionShape(Type type, btCollisionShape* shape, btStridingMeshInterface* meshInterface)
-    : _type(type), _shape(shape), _meshInterface(meshInterface)
+    : _type(type), _shape(shape), _meshInterface(meshInterface), _memoryUsage(0)
 {
     memset(&_shapeData, 0, sizeof(_shapeData));
 }
@@ -20,17 +21,25 @@ PhysicsCollisionShape::~PhysicsCollisionShape()
 {
     if (_shape)
     {
+        // A BVH loaded from the BVH cache is not owned by the shape and lives in a separate buffer.
+        btOptimizedBvh* bvh = NULL;
+        void* bvhData = NULL;
+
         // Cleanup shape-specific cached data.
         switch (_type)
         {
         case SHAPE_MESH:
             if (_shapeData.meshData)
             {
+                bvhData = _shapeData.meshData->bvhData;
+                if (bvhData)
+                    bvh = static_cast<btBvhTriangleMeshShape*>(_shape)->getOptimizedBvh();
                 SAFE_DELETE_ARRAY(_shapeData.meshData->vertexData);
                 for (unsigned int i = 0; i < _shapeData.meshData->indexData.size(); i++)
                 {
                     SAFE_DELETE_ARRAY(_shapeData.meshData->indexData[i]);
                 }
+                SAFE_RELEASE(_shapeData.meshData->geometry);
                 SAFE_DELETE(_shapeData.meshData);
             }
 
@@ -49,7 +58,44 @@ PhysicsCollisionShape::~PhysicsCollisionShape()
 
         // Free the bullet shape.
         SAFE_DELETE(_shape);
+
+        if (bvhData)
+        {
+            bvh->~btOptimizedBvh();
+            btAlignedFree(bvhData);
+        }
+    }
+}
+
+PhysicsCollisionShape::CacheKey::CacheKey()
+    : type(SHAPE_NONE), dynamic(false), unique(NULL)
+{
+    size[0] = size[1] = size[2] = 0.0f;
+}
+
+bool PhysicsCollisionShape::CacheKey::operator==(const CacheKey& key) const
+{
+    return type == key.type && size[0] == key.size[0] && size[1] == key.size[1] && size[2] == key.size[2] &&
+        dynamic == key.dynamic && unique == key.unique && url == key.url;
+}
+
+size_t PhysicsCollisionShape::CacheKeyHash::operator()(const CacheKey& key) const
+{
+    // FNV-1a over the fields of the key.
+    size_t hash = 2166136261u;
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        // Adding zero turns -0 into 0, which compare as equal.
+        float value = key.size[i] + 0.0f;
+        unsigned int bits;
+        memcpy(&bits, &value, sizeof(bits));
+        hash = (hash ^ bits) * 16777619u;
     }
+    for (size_t i = 0, length = key.url.length(); i < length; ++i)
+        hash = (hash ^ (unsigned char)key.url[i]) * 16777619u;
+    hash = (hash ^ (size_t)key.type) * 16777619u;
+    hash = (hash ^ (size_t)key.dynamic) * 16777619u;
+    return hash ^ ((size_t)key.unique >> 3);
 }
 
 PhysicsCollisionShape::Type PhysicsCollisionShape::getType() const
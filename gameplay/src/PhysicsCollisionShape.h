@@ -9,6 +9,7 @@ namespace gameplay
 {
     class Node;
     class Properties;
+    class MeshGeometry;
 
 /**
  * Defines the physics collision shape class that all supported shapes derive from.
@@ -239,8 +240,14 @@ private:
 
     struct MeshData
     {
+        // The scaled positions, or NULL if the shape uses the positions of the geometry.
         float* vertexData;
+        // The indices generated for meshes without parts. The parts use the indices of the geometry.
         std::vector<unsigned char*> indexData;
+        // The buffer that a BVH loaded from the BVH cache lives in (NULL if the BVH was built).
+        void* bvhData;
+        // The geometry of the mesh, which the shape keeps a reference to.
+        MeshGeometry* geometry;
     };
 
     struct HeightfieldData
@@ -252,6 +259,35 @@ private:
         float maxHeight;
     };
 
+    /**
+     * Identifies a shape in the shape cache of the physics controller.
+     */
+    struct CacheKey
+    {
+        CacheKey();
+
+        bool operator==(const CacheKey& key) const;
+
+        // Shape type
+        Type type;
+        // Scaled dimensions for primitive shapes, or the scale for mesh shapes
+        float size[3];
+        // Whether a mesh shape is a convex hull for dynamic objects
+        bool dynamic;
+        // The URL of the mesh for mesh shapes
+        std::string url;
+        // An address that makes the key unique, for shapes that are never shared
+        const void* unique;
+    };
+
+    /**
+     * Hashes shape cache keys.
+     */
+    struct CacheKeyHash
+    {
+        size_t operator()(const CacheKey& key) const;
+    };
+
     /**
      * Constructor.
      */
@@ -285,6 +321,12 @@ private:
         HeightfieldData* heightfieldData;
     } _shapeData;
 
+    // The key of the shape in the shape cache
+    CacheKey _cacheKey;
+
+    // Approximate memory used by the shape and its data, in bytes
+    size_t _memoryUsage;
+
 };
 
 }
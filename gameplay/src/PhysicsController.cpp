@@ -2,16 +2,25 @@
 #include "PhysicsController.h"
 #include "PhysicsRigidBody.h"
 #include "PhysicsCharacter.h"
+#include "PhysicsVehicle.h"
 #include "Game.h"
 #include "MeshPart.h"
 #include "Bundle.h"
+#include "MeshGeometry.h"
 #include "Terrain.h"
+#include "FileSystem.h"
 
 #ifdef GP_USE_MEM_LEAK_DETECTION
 #undef new
 #endif
 #include "BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h"
 #include "BulletCollision/CollisionShapes/btShapeHull.h"
+#if BT_THREADSAFE
+#include "BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h"
+#include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h"
+#include "BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h"
+#include "LinearMath/btThreads.h"
+#endif
 #ifdef GP_USE_MEM_LEAK_DETECTION
 #define new DEBUG_NEW
 #endif
@@ -19,19 +28,199 @@
 // The initial capacity of the Bullet debug drawer's vertex batch.
 #define INITIAL_CAPACITY 280
 
+// The number of queries of a batch that a thread takes at a time.
+#define QUERY_BATCH_SIZE 16
+
+// The initial number of hash buckets of the collision status cache (must be a power of two).
+#define COLLISION_BUCKET_COUNT 64
+
+// The factor of the radius of a simulation region that bodies in it have to go past to leave it.
+#define REGION_HYSTERESIS 1.1f
+
+// The identifiers and version of the files of the mesh BVH and hull caches.
+#define BVH_CACHE_IDENTIFIER "GPBV"
+#define HULL_CACHE_IDENTIFIER "GPHL"
+#define BVH_CACHE_VERSION 1
+
 namespace gameplay
 {
 
-const int PhysicsController::DIRTY         = 0x01;
+// Hashes an unordered pair of collision objects for the collision status cache.
+static inline unsigned int hashCollisionPair(const PhysicsCollisionObject* objectA, const PhysicsCollisionObject* objectB)
+{
+    unsigned long long a = (unsigned long long)(size_t)objectA;
+    unsigned long long b = (unsigned long long)(size_t)objectB;
+    unsigned long long v = ((a ^ b) >> 3) * 0x9E3779B97F4A7C15ULL + ((a & b) >> 3);
+    return (unsigned int)(v >> 32);
+}
+
+// The header of a file of the mesh BVH or hull cache, which is followed by the serialized BVH
+// of a static mesh or by the hull vertices of a dynamic mesh. Hulls have no triangle count.
+struct BvhCacheHeader
+{
+    char identifier[4];
+    unsigned int version;
+    int bulletVersion;
+    unsigned int scalarSize;
+    float scale[3];
+    unsigned int vertexCount;
+    unsigned int triangleCount;
+    unsigned int size;
+};
+
+// Updates all the characters of the world together, as a single action of the world.
+class PhysicsController::CharacterAction : public btActionInterface
+{
+public:
+
+    CharacterAction(PhysicsController* controller)
+        : _controller(controller)
+    {
+    }
+
+    void updateAction(btCollisionWorld* collisionWorld, btScalar deltaTimeStep)
+    {
+        std::vector<PhysicsCharacter*>& characters = _controller->_characters;
+        if (!characters.empty())
+            PhysicsCharacter::updateCharacters(&characters[0], (unsigned int)characters.size(), collisionWorld, deltaTimeStep);
+    }
+
+    void debugDraw(btIDebugDraw* debugDrawer)
+    {
+        // Not used yet.
+    }
+
+private:
+
+    PhysicsController* _controller;
+};
+
+// Updates all the vehicles of the world together, as a single action of the world.
+class PhysicsController::VehicleAction : public btActionInterface
+{
+public:
+
+    VehicleAction(PhysicsController* controller)
+        : _controller(controller)
+    {
+    }
+
+    void updateAction(btCollisionWorld* collisionWorld, btScalar deltaTimeStep)
+    {
+        std::vector<PhysicsVehicle*>& vehicles = _controller->_vehicles;
+        if (!vehicles.empty())
+            PhysicsVehicle::updateVehicles(&vehicles[0], (unsigned int)vehicles.size(), collisionWorld, deltaTimeStep);
+    }
+
+    void debugDraw(btIDebugDraw* debugDrawer)
+    {
+        // Not used yet.
+    }
+
+private:
+
+    PhysicsController* _controller;
+};
+
+#if BT_THREADSAFE
+
+// Runs the parallel loops of the multithreaded Bullet world on the job system of the game.
+class PhysicsController::TaskScheduler : public btITaskScheduler
+{
+public:
+
+    TaskScheduler(JobSystem* jobSystem)
+        : btITaskScheduler("GamePlay"), _jobSystem(jobSystem)
+    {
+    }
+
+    int getMaxNumThreads() const
+    {
+        return (int)_jobSystem->getThreadCount();
+    }
+
+    int getNumThreads() const
+    {
+        return (int)_jobSystem->getThreadCount();
+    }
+
+    void setNumThreads(int numThreads)
+    {
+        // The number of threads is set for the whole job system in game.config.
+    }
+
+    void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body)
+    {
+        Range range;
+        range.forBody = &body;
+        range.sumBody = NULL;
+        range.begin = iBegin;
+        range.sum = 0.0f;
+        _jobSystem->parallelFor((unsigned int)(iEnd - iBegin), (unsigned int)grainSize, &TaskScheduler::rangeProc, &range);
+    }
+
+    btScalar parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body)
+    {
+        Range range;
+        range.forBody = NULL;
+        range.sumBody = &body;
+        range.begin = iBegin;
+        range.sum = 0.0f;
+        _jobSystem->parallelFor((unsigned int)(iEnd - iBegin), (unsigned int)grainSize, &TaskScheduler::rangeProc, &range);
+        return range.sum;
+    }
+
+private:
+
+    struct Range
+    {
+        const btIParallelForBody* forBody;
+        const btIParallelSumBody* sumBody;
+        int begin;
+        std::mutex mutex;
+        btScalar sum;
+    };
+
+    static void rangeProc(void* cookie, unsigned int begin, unsigned int end)
+    {
+        Range* range = (Range*)cookie;
+        if (range->forBody)
+        {
+            range->forBody->forLoop(range->begin + (int)begin, range->begin + (int)end);
+        }
+        else
+        {
+            btScalar sum = range->sumBody->sumLoop(range->begin + (int)begin, range->begin + (int)end);
+            std::lock_guard<std::mutex> lock(range->mutex);
+            range->sum += sum;
+        }
+    }
+
+    JobSystem* _jobSystem;
+};
+
+#else
+
+class PhysicsController::TaskScheduler
+{
+};
+
+#endif
+
+const int PhysicsController::FREE          = 0x01;
 const int PhysicsController::COLLISION     = 0x02;
 const int PhysicsController::REGISTERED    = 0x04;
 const int PhysicsController::REMOVE        = 0x08;
 
 PhysicsController::PhysicsController()
   : _isUpdating(false), _collisionConfiguration(NULL), _dispatcher(NULL),
-    _overlappingPairCache(NULL), _solver(NULL), _world(NULL), _ghostPairCallback(NULL),
+    _overlappingPairCache(NULL), _solver(NULL), _solverPool(NULL), _world(NULL), _ghostPairCallback(NULL),
     _debugDrawer(NULL), _status(PhysicsController::Listener::DEACTIVATED), _listeners(NULL),
-    _gravity(btScalar(0.0), btScalar(-9.8), btScalar(0.0)), _collisionCallback(NULL)
+    _gravity(btScalar(0.0), btScalar(-9.8), btScalar(0.0)), _freeCollisionInfo(-1), _collisionInfoCount(0), _collisionGeneration(0),
+    _collisionCallback(NULL), _shapeReuseCount(0), _meshBvhCache(false),
+    _fixedTimeStep(0.0f), _maxSubSteps(4), _interpolation(true), _stepTime(0.0f), _multithreaded(false), _taskScheduler(NULL),
+    _characterAction(NULL), _vehicleAction(NULL), _regionActiveRadius(0.0f), _regionReducedRadius(0.0f), _regionReducedInterval(4),
+    _regionBodyCount(0), _regionTick(0), _regionPhase(0)
 {
     GP_REGISTER_SCRIPT_EVENTS();
 
@@ -160,6 +349,38 @@ void PhysicsController::setGravity(const Vector3& gravity)
         _world->setGravity(BV(_gravity));
 }
 
+void PhysicsController::setFixedTimeStep(float timeStep, unsigned int maxSubSteps)
+{
+    _fixedTimeStep = std::max(timeStep, 0.0f);
+    _maxSubSteps = std::max(maxSubSteps, 1u);
+    _stepTime = 0.0f;
+}
+
+float PhysicsController::getFixedTimeStep() const
+{
+    return _fixedTimeStep;
+}
+
+unsigned int PhysicsController::getMaxSubSteps() const
+{
+    return _maxSubSteps;
+}
+
+void PhysicsController::setInterpolationEnabled(bool enabled)
+{
+    _interpolation = enabled;
+}
+
+bool PhysicsController::isInterpolationEnabled() const
+{
+    return _interpolation;
+}
+
+bool PhysicsController::isInterpolating() const
+{
+    return _interpolation && _fixedTimeStep > 0.0f;
+}
+
 void PhysicsController::drawDebug(const Matrix& viewProjection)
 {
     GP_ASSERT(_debugDrawer);
@@ -360,6 +581,98 @@ bool PhysicsController::sweepTest(PhysicsCollisionObject* object, const Vector3&
     return false;
 }
 
+// The arguments of a batch of ray or sweep tests.
+struct QueryBatch
+{
+    PhysicsController* controller;
+    const Ray* rays;
+    const float* distances;
+    PhysicsCollisionObject* const* objects;
+    const Vector3* endPositions;
+    PhysicsController::HitResult* results;
+    PhysicsController::HitFilter* filter;
+    std::atomic<unsigned int> hitCount;
+};
+
+unsigned int PhysicsController::rayTest(const Ray* rays, const float* distances, unsigned int count, PhysicsController::HitResult* results, PhysicsController::HitFilter* filter)
+{
+    GP_ASSERT(rays && distances && results);
+
+    QueryBatch batch;
+    batch.controller = this;
+    batch.rays = rays;
+    batch.distances = distances;
+    batch.objects = NULL;
+    batch.endPositions = NULL;
+    batch.results = results;
+    batch.filter = filter;
+    batch.hitCount = 0;
+#if BT_THREADSAFE
+    Game::getInstance()->getJobSystem()->parallelFor(count, QUERY_BATCH_SIZE, &PhysicsController::rayTestProc, &batch);
+#else
+    rayTestProc(&batch, 0, count);
+#endif
+    return batch.hitCount;
+}
+
+unsigned int PhysicsController::sweepTest(PhysicsCollisionObject* const* objects, const Vector3* endPositions, unsigned int count, PhysicsController::HitResult* results, PhysicsController::HitFilter* filter)
+{
+    GP_ASSERT(objects && endPositions && results);
+
+    QueryBatch batch;
+    batch.controller = this;
+    batch.rays = NULL;
+    batch.distances = NULL;
+    batch.objects = objects;
+    batch.endPositions = endPositions;
+    batch.results = results;
+    batch.filter = filter;
+    batch.hitCount = 0;
+#if BT_THREADSAFE
+    // The start of each sweep is the world transform of the node, which is resolved here
+    // since nodes update their cached world matrices when they are read.
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        if (objects[i] && objects[i]->getNode())
+            objects[i]->getNode()->getWorldMatrix();
+    }
+    Game::getInstance()->getJobSystem()->parallelFor(count, QUERY_BATCH_SIZE, &PhysicsController::sweepTestProc, &batch);
+#else
+    sweepTestProc(&batch, 0, count);
+#endif
+    return batch.hitCount;
+}
+
+void PhysicsController::rayTestProc(void* cookie, unsigned int begin, unsigned int end)
+{
+    QueryBatch* batch = (QueryBatch*)cookie;
+    unsigned int hitCount = 0;
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        HitResult& result = batch->results[i];
+        if (batch->controller->rayTest(batch->rays[i], batch->distances[i], &result, batch->filter))
+            ++hitCount;
+        else
+            result.object = NULL;
+    }
+    batch->hitCount += hitCount;
+}
+
+void PhysicsController::sweepTestProc(void* cookie, unsigned int begin, unsigned int end)
+{
+    QueryBatch* batch = (QueryBatch*)cookie;
+    unsigned int hitCount = 0;
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        HitResult& result = batch->results[i];
+        if (batch->controller->sweepTest(batch->objects[i], batch->endPositions[i], &result, batch->filter))
+            ++hitCount;
+        else
+            result.object = NULL;
+    }
+    batch->hitCount += hitCount;
+}
+
 btScalar PhysicsController::CollisionCallback::addSingleResult(btManifoldPoint& cp, const btCollisionObjectWrapper* a, int partIdA, int indexA, 
     const btCollisionObjectWrapper* b, int partIdB, int indexB)
 {
@@ -373,75 +686,152 @@ btScalar PhysicsController::CollisionCallback::addSingleResult(btManifoldPoint&
     // we notify the listeners only if the pair was not colliding
     // during the previous frame. Otherwise, it's a new pair, so add a
     // new entry to the cache with the appropriate listeners and notify them.
-    PhysicsCollisionObject::CollisionPair pair(objectA, objectB);
+    int index = _pc->findCollisionInfo(objectA, objectB);
+    if (index < 0)
+    {
+        // Add a new collision pair for these objects with the listeners of either object.
+        index = _pc->getCollisionInfo(objectA, objectB);
+        int p1 = _pc->findCollisionInfo(objectA, NULL);
+        int p2 = _pc->findCollisionInfo(objectB, NULL);
+        CollisionInfo& collisionInfo = _pc->_collisionInfos[index];
+        if (p1 >= 0)
+        {
+            const CollisionInfo& ci = _pc->_collisionInfos[p1];
+            collisionInfo._listeners.insert(collisionInfo._listeners.end(), ci._listeners.begin(), ci._listeners.end());
+        }
+        if (p2 >= 0)
+        {
+            const CollisionInfo& ci = _pc->_collisionInfos[p2];
+            collisionInfo._listeners.insert(collisionInfo._listeners.end(), ci._listeners.begin(), ci._listeners.end());
+        }
+    }
+
+    // Queue the collision event, which is sent once all collision tests of the update are done.
+    CollisionInfo& collisionInfo = _pc->_collisionInfos[index];
+    if ((collisionInfo._status & COLLISION) == 0 && !collisionInfo._listeners.empty())
+    {
+        CollisionEvent event;
+        event._info = index;
+        event._contactPointA.set(cp.getPositionWorldOnA().x(), cp.getPositionWorldOnA().y(), cp.getPositionWorldOnA().z());
+        event._contactPointB.set(cp.getPositionWorldOnB().x(), cp.getPositionWorldOnB().y(), cp.getPositionWorldOnB().z());
+        _pc->_collisionEvents.push_back(event);
+    }
+
+    // Update the collision status cache (the generation of the update keeps this
+    // collision pair's status from being reset to 'no collision' when the controller's update completes).
+    collisionInfo._generation = _pc->_collisionGeneration;
+    collisionInfo._status |= COLLISION;
+    return 0.0f;
+}
+
+int PhysicsController::findCollisionInfo(PhysicsCollisionObject* objectA, PhysicsCollisionObject* objectB) const
+{
+    if (_collisionBuckets.empty())
+        return -1;
+
+    // Pairs are unordered, so the objects are tested in both orders.
+    int index = _collisionBuckets[hashCollisionPair(objectA, objectB) & (_collisionBuckets.size() - 1)];
+    while (index >= 0)
+    {
+        const CollisionInfo& info = _collisionInfos[index];
+        if ((info._pair.objectA == objectA && info._pair.objectB == objectB) || (info._pair.objectA == objectB && info._pair.objectB == objectA))
+            return index;
+        index = info._next;
+    }
+    return -1;
+}
+
+int PhysicsController::getCollisionInfo(PhysicsCollisionObject* objectA, PhysicsCollisionObject* objectB)
+{
+    int index = findCollisionInfo(objectA, objectB);
+    if (index >= 0)
+        return index;
 
-    CollisionInfo* collisionInfo;
-    if (_pc->_collisionStatus.count(pair) > 0)
+    // Keep the chains short by growing the buckets along with the cache.
+    if (_collisionInfoCount >= _collisionBuckets.size())
+        rehashCollisionInfos(std::max((unsigned int)_collisionBuckets.size() * 2, (unsigned int)COLLISION_BUCKET_COUNT));
+
+    if (_freeCollisionInfo >= 0)
     {
-        collisionInfo = &_pc->_collisionStatus[pair];
+        index = _freeCollisionInfo;
+        _freeCollisionInfo = _collisionInfos[index]._next;
     }
     else
     {
-        // Add a new collision pair for these objects.
-        collisionInfo = &_pc->_collisionStatus[pair];
+        index = (int)_collisionInfos.size();
+        _collisionInfos.push_back(CollisionInfo());
+    }
+    ++_collisionInfoCount;
+
+    CollisionInfo& info = _collisionInfos[index];
+    info._pair.objectA = objectA;
+    info._pair.objectB = objectB;
+    info._status = 0;
+    info._generation = 0;
+
+    int& bucket = _collisionBuckets[hashCollisionPair(objectA, objectB) & (_collisionBuckets.size() - 1)];
+    info._next = bucket;
+    bucket = index;
+    return index;
+}
 
-        // Add the appropriate listeners.
-        PhysicsCollisionObject::CollisionPair p1(pair.objectA, NULL);
-        if (_pc->_collisionStatus.count(p1) > 0)
-        {
-            const CollisionInfo& ci = _pc->_collisionStatus[p1];
-            std::vector<PhysicsCollisionObject::CollisionListener*>::const_iterator iter = ci._listeners.begin();
-            for (; iter != ci._listeners.end(); iter++)
-            {
-                GP_ASSERT(*iter);
-                collisionInfo->_listeners.push_back(*iter);
-            }
-        }
-        PhysicsCollisionObject::CollisionPair p2(pair.objectB, NULL);
-        if (_pc->_collisionStatus.count(p2) > 0)
-        {
-            const CollisionInfo& ci = _pc->_collisionStatus[p2];
-            std::vector<PhysicsCollisionObject::CollisionListener*>::const_iterator iter = ci._listeners.begin();
-            for (; iter != ci._listeners.end(); iter++)
-            {
-                GP_ASSERT(*iter);
-                collisionInfo->_listeners.push_back(*iter);
-            }
-        }
+void PhysicsController::freeCollisionInfo(int index)
+{
+    CollisionInfo& info = _collisionInfos[index];
+    GP_ASSERT((info._status & FREE) == 0);
+
+    // Unlink the entry from its bucket.
+    int* link = &_collisionBuckets[hashCollisionPair(info._pair.objectA, info._pair.objectB) & (_collisionBuckets.size() - 1)];
+    while (*link != index)
+    {
+        GP_ASSERT(*link >= 0);
+        link = &_collisionInfos[*link]._next;
     }
+    *link = info._next;
+
+    // The listener vector is cleared rather than released so that its storage is reused.
+    info._pair.objectA = NULL;
+    info._pair.objectB = NULL;
+    info._listeners.clear();
+    info._status = FREE;
+    info._next = _freeCollisionInfo;
+    _freeCollisionInfo = index;
+    --_collisionInfoCount;
+}
 
-    // Fire collision event.
-    if ((collisionInfo->_status & COLLISION) == 0)
+void PhysicsController::rehashCollisionInfos(unsigned int bucketCount)
+{
+    GP_ASSERT((bucketCount & (bucketCount - 1)) == 0);
+
+    _collisionBuckets.assign(bucketCount, -1);
+    for (size_t i = 0, count = _collisionInfos.size(); i < count; ++i)
     {
-        std::vector<PhysicsCollisionObject::CollisionListener*>::const_iterator iter = collisionInfo->_listeners.begin();
-        for (; iter != collisionInfo->_listeners.end(); iter++)
+        CollisionInfo& info = _collisionInfos[i];
+        if ((info._status & FREE) == 0)
         {
-            GP_ASSERT(*iter);
-            if ((collisionInfo->_status & REMOVE) == 0)
-            {
-                (*iter)->collisionEvent(PhysicsCollisionObject::CollisionListener::COLLIDING, pair, Vector3(cp.getPositionWorldOnA().x(), cp.getPositionWorldOnA().y(), cp.getPositionWorldOnA().z()),
-                    Vector3(cp.getPositionWorldOnB().x(), cp.getPositionWorldOnB().y(), cp.getPositionWorldOnB().z()));
-            }
+            int& bucket = _collisionBuckets[hashCollisionPair(info._pair.objectA, info._pair.objectB) & (bucketCount - 1)];
+            info._next = bucket;
+            bucket = (int)i;
         }
     }
-
-    // Update the collision status cache (we remove the dirty bit
-    // set in the controller's update so that this particular collision pair's
-    // status is not reset to 'no collision' when the controller's update completes).
-    collisionInfo->_status &= ~DIRTY;
-    collisionInfo->_status |= COLLISION;
-    return 0.0f;
 }
 
 void PhysicsController::initialize()
 {
     _collisionConfiguration = bullet_new<btDefaultCollisionConfiguration>();
-    _dispatcher = bullet_new<btCollisionDispatcher>(_collisionConfiguration);
     _overlappingPairCache = bullet_new<btDbvtBroadphase>();
-    _solver = bullet_new<btSequentialImpulseConstraintSolver>();
 
     // Create the world.
-    _world = bullet_new<btDiscreteDynamicsWorld>(_dispatcher, _overlappingPairCache, _solver, _collisionConfiguration);
+    Properties* config = Game::getInstance()->getConfig();
+    config = config ? config->getNamespace("physics", true) : NULL;
+    if (config && config->getBool("multithreaded") && !initializeMultithreaded())
+        GP_WARN("Bullet was built without thread support; the physics simulation runs on a single thread.");
+    if (_world == NULL)
+    {
+        _dispatcher = bullet_new<btCollisionDispatcher>(_collisionConfiguration);
+        _solver = bullet_new<btSequentialImpulseConstraintSolver>();
+        _world = bullet_new<btDiscreteDynamicsWorld>(_dispatcher, _overlappingPairCache, _solver, _collisionConfiguration);
+    }
     _world->setGravity(BV(_gravity));
 
     // Register ghost pair callback so bullet detects collisions with ghost objects (used for character collisions).
@@ -450,20 +840,316 @@ void PhysicsController::initialize()
     _world->getPairCache()->setInternalGhostPairCallback(_ghostPairCallback);
     _world->getDispatchInfo().m_allowedCcdPenetration = 0.0001f;
 
+    // Register the action that updates the characters during physics ticks.
+    _characterAction = new CharacterAction(this);
+    _world->addAction(_characterAction);
+
+    // Register the action that updates the vehicles during physics ticks.
+    _vehicleAction = new VehicleAction(this);
+    _world->addAction(_vehicleAction);
+
+    // The bodies of the reduced simulation region are scheduled around each tick.
+    _world->setInternalTickCallback(&PhysicsController::preTickCallback, this, true);
+    _world->setInternalTickCallback(&PhysicsController::postTickCallback, this, false);
+
+    if (config)
+    {
+        if (config->exists("fixedTimeStep"))
+            setFixedTimeStep(config->getFloat("fixedTimeStep"), config->exists("maxSubSteps") ? (unsigned int)std::max(1, config->getInt("maxSubSteps")) : 4);
+        if (config->exists("interpolation"))
+            setInterpolationEnabled(config->getBool("interpolation"));
+        _meshBvhCache = config->getBool("meshBvhCache");
+    }
+
     // Set up debug drawing.
     _debugDrawer = new DebugDrawer();
     _world->setDebugDrawer(_debugDrawer);
 }
 
+bool PhysicsController::initializeMultithreaded()
+{
+#if BT_THREADSAFE
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    GP_ASSERT(jobSystem);
+
+    // Bullet runs its parallel loops on the job system, with a constraint solver for each thread.
+    _taskScheduler = new TaskScheduler(jobSystem);
+    btSetTaskScheduler(_taskScheduler);
+    _dispatcher = bullet_new<btCollisionDispatcherMt>(_collisionConfiguration);
+    _solverPool = bullet_new<btConstraintSolverPoolMt>((int)jobSystem->getThreadCount());
+    _solver = bullet_new<btSequentialImpulseConstraintSolverMt>();
+    _world = bullet_new<btDiscreteDynamicsWorldMt>(_dispatcher, _overlappingPairCache, static_cast<btConstraintSolverPoolMt*>(_solverPool), _solver, _collisionConfiguration);
+    _multithreaded = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool PhysicsController::isMultithreaded() const
+{
+    return _multithreaded;
+}
+
+void PhysicsController::setSimulationRegions(float activeRadius, float reducedRadius, unsigned int reducedInterval)
+{
+    _regionActiveRadius = std::max(activeRadius, 0.0f);
+    _regionReducedRadius = std::max(reducedRadius, _regionActiveRadius);
+    _regionReducedInterval = std::max(reducedInterval, 1u);
+}
+
+float PhysicsController::getSimulationActiveRadius() const
+{
+    return _regionActiveRadius;
+}
+
+float PhysicsController::getSimulationReducedRadius() const
+{
+    return _regionReducedRadius;
+}
+
+unsigned int PhysicsController::getSimulationReducedInterval() const
+{
+    return _regionReducedInterval;
+}
+
+void PhysicsController::addSimulationAnchor(Node* node)
+{
+    GP_ASSERT(node);
+
+    node->addRef();
+    _regionAnchors.push_back(node);
+}
+
+bool PhysicsController::removeSimulationAnchor(Node* node)
+{
+    std::vector<Node*>::iterator itr = std::find(_regionAnchors.begin(), _regionAnchors.end(), node);
+    if (itr == _regionAnchors.end())
+        return false;
+
+    _regionAnchors.erase(itr);
+    SAFE_RELEASE(node);
+    return true;
+}
+
+unsigned int PhysicsController::getFrozenBodyCount() const
+{
+    unsigned int count = (unsigned int)_frozenBodies.size();
+    for (int i = 0, objectCount = _world ? _world->getNumCollisionObjects() : 0; i < objectCount; ++i)
+    {
+        btRigidBody* body = btRigidBody::upcast(_world->getCollisionObjectArray()[i]);
+        PhysicsCollisionObject* object = body ? getCollisionObject(body) : NULL;
+        if (object && object->getType() == PhysicsCollisionObject::RIGID_BODY && static_cast<PhysicsRigidBody*>(object)->_simulationRegion == REGION_FROZEN)
+            ++count;
+    }
+    return count;
+}
+
+void PhysicsController::updateRegions()
+{
+    bool enabled = _regionActiveRadius > 0.0f && !_regionAnchors.empty();
+    if (!enabled && _regionBodyCount == 0)
+        return;
+
+    _regionAnchorPositions.resize(_regionAnchors.size());
+    for (size_t i = 0, count = _regionAnchors.size(); i < count; ++i)
+    {
+        _regionAnchorPositions[i] = BV(_regionAnchors[i]->getTranslationWorld());
+    }
+
+    // Bodies that were removed from the world are added back once they come close enough again.
+    for (size_t i = _frozenBodies.size(); i-- > 0;)
+    {
+        PhysicsRigidBody* body = _frozenBodies[i];
+        SimulationRegion region = enabled ? getRegion(body) : REGION_ACTIVE;
+        if (region != REGION_FROZEN)
+            setRegion(body, region);
+    }
+
+    // The objects are visited from the end, since frozen bodies are removed from the array.
+    _reducedBodies.clear();
+    btCollisionObjectArray& objects = _world->getCollisionObjectArray();
+    for (int i = objects.size() - 1; i >= 0; --i)
+    {
+        btRigidBody* b = btRigidBody::upcast(objects[i]);
+        if (!b || b->isStaticOrKinematicObject())
+            continue;
+        PhysicsCollisionObject* object = getCollisionObject(b);
+        if (!object || object->getType() != PhysicsCollisionObject::RIGID_BODY)
+            continue;
+
+        // The chassis of a vehicle is driven by the vehicle, so it is always simulated.
+        PhysicsRigidBody* body = static_cast<PhysicsRigidBody*>(object);
+        if (body->getNode() && body->getNode()->getCollisionObject() != body)
+            continue;
+        setRegion(body, enabled ? getRegion(body) : REGION_ACTIVE);
+        if (body->_simulationRegion == REGION_REDUCED)
+            _reducedBodies.push_back(body);
+    }
+}
+
+PhysicsController::SimulationRegion PhysicsController::getRegion(PhysicsRigidBody* body) const
+{
+    GP_ASSERT(body && body->_body);
+
+    const btVector3& origin = body->_body->getWorldTransform().getOrigin();
+    btScalar distance2 = BT_LARGE_FLOAT;
+    for (size_t i = 0, count = _regionAnchorPositions.size(); i < count; ++i)
+    {
+        distance2 = std::min(distance2, origin.distance2(_regionAnchorPositions[i]));
+    }
+
+    // Bodies stay in a nearer region until they are a little past its edge, so that the bodies
+    // on the edge of a region do not move in and out of it every frame.
+    float activeRadius = _regionActiveRadius * (body->_simulationRegion == REGION_ACTIVE ? REGION_HYSTERESIS : 1.0f);
+    float reducedRadius = _regionReducedRadius * (body->_simulationRegion != REGION_FROZEN ? REGION_HYSTERESIS : 1.0f);
+    if (distance2 <= activeRadius * activeRadius)
+        return REGION_ACTIVE;
+    if (distance2 <= reducedRadius * reducedRadius)
+        return REGION_REDUCED;
+    return REGION_FROZEN;
+}
+
+void PhysicsController::setRegion(PhysicsRigidBody* body, SimulationRegion region)
+{
+    GP_ASSERT(body && body->_body);
+
+    if (body->_simulationRegion == region)
+        return;
+
+    btRigidBody* b = body->_body;
+    if (body->_regionRemoved)
+    {
+        _world->addRigidBody(b, (short)body->_group, (short)body->_mask);
+        _frozenBodies.erase(std::find(_frozenBodies.begin(), _frozenBodies.end(), body));
+        body->_regionRemoved = false;
+    }
+    if (body->_simulationRegion == REGION_ACTIVE)
+    {
+        // The activation state that the body leaves the active region in is restored when it comes back.
+        body->_regionActivationState = b->getActivationState();
+        body->_regionPhase = _regionPhase++;
+        ++_regionBodyCount;
+    }
+
+    switch (region)
+    {
+    case REGION_ACTIVE:
+    case REGION_REDUCED:
+        if (body->_regionActivationState == ACTIVE_TAG || body->_regionActivationState == WANTS_DEACTIVATION)
+            b->activate(true);
+        else
+            b->forceActivationState(body->_regionActivationState);
+        if (region == REGION_ACTIVE)
+            --_regionBodyCount;
+        break;
+
+    case REGION_FROZEN:
+        // The constraints of a body need it to stay in the world.
+        if (!body->_constraints || body->_constraints->empty())
+        {
+            _world->removeRigidBody(b);
+            _frozenBodies.push_back(body);
+            body->_regionRemoved = true;
+        }
+        else
+        {
+            b->forceActivationState(DISABLE_SIMULATION);
+        }
+        break;
+    }
+    body->_simulationRegion = (unsigned char)region;
+}
+
+void PhysicsController::preTickCallback(btDynamicsWorld* world, btScalar timeStep)
+{
+    PhysicsController* controller = static_cast<PhysicsController*>(world->getWorldUserInfo());
+    GP_ASSERT(controller);
+    if (controller->_reducedBodies.empty())
+        return;
+
+    // Each body of the reduced region is stepped once every interval ticks, with its velocities
+    // and gravity scaled so that it moves as if it was stepped with a step that is interval times
+    // longer, and its simulation is disabled in the other ticks.
+    unsigned int interval = controller->_regionReducedInterval;
+    btScalar scale = (btScalar)interval;
+    ++controller->_regionTick;
+    controller->_scaledBodies.clear();
+    for (size_t i = 0, count = controller->_reducedBodies.size(); i < count; ++i)
+    {
+        PhysicsRigidBody* body = controller->_reducedBodies[i];
+        btRigidBody* b = body->_body;
+
+        // Sleeping bodies, and bodies whose simulation was disabled before they left the active region, are left as they are.
+        if (b->getActivationState() == ISLAND_SLEEPING || body->_regionActivationState == DISABLE_SIMULATION)
+            continue;
+
+        if ((controller->_regionTick + body->_regionPhase) % interval != 0)
+        {
+            b->forceActivationState(DISABLE_SIMULATION);
+            continue;
+        }
+
+        ScaledBody scaled;
+        scaled.body = b;
+        scaled.gravity = b->getGravity();
+        b->forceActivationState(ACTIVE_TAG);
+        b->setLinearVelocity(b->getLinearVelocity() * scale);
+        b->setAngularVelocity(b->getAngularVelocity() * scale);
+        b->setGravity(scaled.gravity * (scale * scale));
+        controller->_scaledBodies.push_back(scaled);
+    }
+}
+
+void PhysicsController::postTickCallback(btDynamicsWorld* world, btScalar timeStep)
+{
+    PhysicsController* controller = static_cast<PhysicsController*>(world->getWorldUserInfo());
+    GP_ASSERT(controller);
+    if (controller->_scaledBodies.empty())
+        return;
+
+    btScalar inverseScale = btScalar(1.0) / (btScalar)controller->_regionReducedInterval;
+    for (size_t i = 0, count = controller->_scaledBodies.size(); i < count; ++i)
+    {
+        ScaledBody& scaled = controller->_scaledBodies[i];
+        scaled.body->setLinearVelocity(scaled.body->getLinearVelocity() * inverseScale);
+        scaled.body->setAngularVelocity(scaled.body->getAngularVelocity() * inverseScale);
+        scaled.body->setGravity(scaled.gravity);
+    }
+    controller->_scaledBodies.clear();
+}
+
 void PhysicsController::finalize()
 {
     // Clean up the world and its various components.
+    if (_world && _characterAction)
+        _world->removeAction(_characterAction);
+    SAFE_DELETE(_characterAction);
+    if (_world && _vehicleAction)
+        _world->removeAction(_vehicleAction);
+    SAFE_DELETE(_vehicleAction);
     SAFE_DELETE(_world);
     SAFE_DELETE(_ghostPairCallback);
     SAFE_DELETE(_solver);
+    SAFE_DELETE(_solverPool);
     SAFE_DELETE(_overlappingPairCache);
     SAFE_DELETE(_dispatcher);
     SAFE_DELETE(_collisionConfiguration);
+#if BT_THREADSAFE
+    if (_taskScheduler)
+        btSetTaskScheduler(NULL);
+#endif
+    SAFE_DELETE(_taskScheduler);
+    _multithreaded = false;
+
+    for (size_t i = 0, count = _regionAnchors.size(); i < count; ++i)
+    {
+        SAFE_RELEASE(_regionAnchors[i]);
+    }
+    _regionAnchors.clear();
+    _reducedBodies.clear();
+    _frozenBodies.clear();
+    _regionBodyCount = 0;
 }
 
 void PhysicsController::pause()
@@ -478,15 +1164,25 @@ void PhysicsController::resume()
 
 void PhysicsController::update(float elapsedTime)
 {
+    GP_PROFILE_SCOPE("PhysicsController::update");
     GP_ASSERT(_world);
     _isUpdating = true;
 
-    // Update the physics simulation, with a maximum
-    // of 10 simulation steps being performed in a given frame.
-    //
+    // Move the rigid bodies between the simulation regions before they are stepped.
+    updateRegions();
+
     // Note that stepSimulation takes elapsed time in seconds
     // so we divide by 1000 to convert from milliseconds.
-    _world->stepSimulation(elapsedTime * 0.001f, 10);
+    if (_fixedTimeStep > 0.0f)
+    {
+        stepFixed(elapsedTime * 0.001f);
+    }
+    else
+    {
+        // Update the physics simulation, with a maximum
+        // of 10 simulation steps being performed in a given frame.
+        _world->stepSimulation(elapsedTime * 0.001f, 10);
+    }
 
     // If we have status listeners, then check if our status has changed.
     if (_listeners || hasScriptListener(GP_GET_SCRIPT_EVENT(PhysicsController, statusEvent)))
@@ -538,88 +1234,139 @@ void PhysicsController::update(float elapsedTime)
         }
     }
 
-    // All statuses are set with the DIRTY bit before collision processing occurs.
-    // During collision processing, if a collision occurs, the status is 
-    // set to COLLISION and the DIRTY bit is cleared. Then, after collision processing 
-    // is finished, if a given status is still dirty, the COLLISION bit is cleared.
+    // Each update has a new generation. During collision processing, if a collision occurs,
+    // the status is set to COLLISION and the entry is stamped with the generation. Then, after
+    // collision processing is finished, the COLLISION bit is cleared from the entries that were not stamped.
     //
     // If an entry was marked for removal in the last frame, fire NOT_COLLIDING if appropriate and remove it now.
-
-    // Dirty the collision status cache entries.
-    std::map<PhysicsCollisionObject::CollisionPair, CollisionInfo>::iterator iter = _collisionStatus.begin();
-    for (; iter != _collisionStatus.end();)
+    for (size_t i = 0; i < _removedCollisionInfos.size(); i++)
     {
-        if ((iter->second._status & REMOVE) != 0)
+        int index = _removedCollisionInfos[i];
+        if ((_collisionInfos[index]._status & COLLISION) != 0 && _collisionInfos[index]._pair.objectB)
         {
-            if ((iter->second._status & COLLISION) != 0 && iter->first.objectB)
+            PhysicsCollisionObject::CollisionPair cp(_collisionInfos[index]._pair.objectA, NULL);
+            for (size_t j = 0; j < _collisionInfos[index]._listeners.size(); j++)
             {
-                size_t size = iter->second._listeners.size();
-                for (size_t i = 0; i < size; i++)
-                {
-                    PhysicsCollisionObject::CollisionPair cp(iter->first.objectA, NULL);
-                    iter->second._listeners[i]->collisionEvent(PhysicsCollisionObject::CollisionListener::NOT_COLLIDING, cp);
-                }
+                _collisionInfos[index]._listeners[j]->collisionEvent(PhysicsCollisionObject::CollisionListener::NOT_COLLIDING, cp);
             }
-
-            std::map<PhysicsCollisionObject::CollisionPair, CollisionInfo>::iterator eraseIter = iter;
-            iter++;
-            _collisionStatus.erase(eraseIter);
-        }
-        else
-        {
-            iter->second._status |= DIRTY;
-            iter++;
         }
+        freeCollisionInfo(index);
     }
+    _removedCollisionInfos.clear();
+    ++_collisionGeneration;
 
     // Go through the collision status cache and perform all registered collision tests.
-    iter = _collisionStatus.begin();
-    for (; iter != _collisionStatus.end(); iter++)
+    // (Entries that are added by the tests are never registered, so they are skipped.)
+    for (size_t i = 0; i < _collisionInfos.size(); i++)
     {
         // If this collision pair was one that was registered for listening, then perform the collision test.
         // (In the case where we register for all collisions with a rigid body, there will be a lot
         // of collision pairs in the status cache that we did not explicitly register for.)
-        if ((iter->second._status & REGISTERED) != 0 && (iter->second._status & REMOVE) == 0)
+        const CollisionInfo& info = _collisionInfos[i];
+        if ((info._status & REGISTERED) != 0 && (info._status & REMOVE) == 0)
         {
-            if (iter->first.objectB)
-                _world->contactPairTest(iter->first.objectA->getCollisionObject(), iter->first.objectB->getCollisionObject(), *_collisionCallback);
+            // The tests may add entries to the cache, so the entry is not used after them.
+            btCollisionObject* collisionObjectA = info._pair.objectA->getCollisionObject();
+            if (info._pair.objectB)
+                _world->contactPairTest(collisionObjectA, info._pair.objectB->getCollisionObject(), *_collisionCallback);
             else
-                _world->contactTest(iter->first.objectA->getCollisionObject(), *_collisionCallback);
+                _world->contactTest(collisionObjectA, *_collisionCallback);
         }
     }
 
+    // Send the collision events found by the tests. Listeners may change the cache, so the entries are looked up each time.
+    for (size_t i = 0; i < _collisionEvents.size(); i++)
+    {
+        const CollisionEvent& event = _collisionEvents[i];
+        for (size_t j = 0; j < _collisionInfos[event._info]._listeners.size(); j++)
+        {
+            const CollisionInfo& info = _collisionInfos[event._info];
+            if ((info._status & REMOVE) == 0)
+            {
+                GP_ASSERT(info._listeners[j]);
+                info._listeners[j]->collisionEvent(PhysicsCollisionObject::CollisionListener::COLLIDING, info._pair, event._contactPointA, event._contactPointB);
+            }
+        }
+    }
+    _collisionEvents.clear();
+
     // Update all the collision status cache entries.
-    iter = _collisionStatus.begin();
-    for ( ; iter != _collisionStatus.end(); iter++)
+    for (size_t i = 0; i < _collisionInfos.size(); i++)
     {
-        if ((iter->second._status & DIRTY) != 0)
+        if ((_collisionInfos[i]._status & COLLISION) != 0 && _collisionInfos[i]._generation != _collisionGeneration)
         {
-            if ((iter->second._status & COLLISION) != 0 && iter->first.objectB)
+            if (_collisionInfos[i]._pair.objectB)
             {
-                size_t size = iter->second._listeners.size();
-                for (size_t i = 0; i < size; i++)
+                PhysicsCollisionObject::CollisionPair pair = _collisionInfos[i]._pair;
+                for (size_t j = 0; j < _collisionInfos[i]._listeners.size(); j++)
                 {
-                    iter->second._listeners[i]->collisionEvent(PhysicsCollisionObject::CollisionListener::NOT_COLLIDING, iter->first);
+                    _collisionInfos[i]._listeners[j]->collisionEvent(PhysicsCollisionObject::CollisionListener::NOT_COLLIDING, pair);
                 }
             }
 
-            iter->second._status &= ~COLLISION;
+            _collisionInfos[i]._status &= ~COLLISION;
         }
     }
 
     _isUpdating = false;
 }
 
+void PhysicsController::stepFixed(float elapsedTime)
+{
+    GP_ASSERT(_world);
+    GP_ASSERT(_fixedTimeStep > 0.0f);
+
+    _stepTime += elapsedTime;
+    unsigned int steps = (unsigned int)(_stepTime / _fixedTimeStep);
+    if (steps > _maxSubSteps)
+    {
+        // Drop the time that does not fit in the budget of this frame.
+        steps = _maxSubSteps;
+        _stepTime = fmod(_stepTime, _fixedTimeStep) + _fixedTimeStep * steps;
+    }
+    _stepTime = std::max(_stepTime - _fixedTimeStep * steps, 0.0f);
+
+    bool interpolate = isInterpolating();
+    // Bodies are interpolated through their motion states, which Bullet only updates for active dynamic bodies.
+    btCollisionObjectArray& objects = _world->getCollisionObjectArray();
+    for (unsigned int i = 0; i < steps; ++i)
+    {
+        if (interpolate)
+        {
+            // Keep the transforms from before the step to interpolate from.
+            for (int j = 0, count = _world->getNumCollisionObjects(); j < count; ++j)
+            {
+                btRigidBody* body = btRigidBody::upcast(objects[j]);
+                if (body && body->getMotionState() && !body->isStaticOrKinematicObject())
+                    static_cast<PhysicsCollisionObject::PhysicsMotionState*>(body->getMotionState())->beginStep();
+            }
+        }
+
+        // A single step of exactly the fixed length, which Bullet does not extrapolate.
+        _world->stepSimulation(_fixedTimeStep, 1, _fixedTimeStep);
+    }
+
+    if (interpolate)
+    {
+        float alpha = std::min(_stepTime / _fixedTimeStep, 1.0f);
+        for (int j = 0, count = _world->getNumCollisionObjects(); j < count; ++j)
+        {
+            btRigidBody* body = btRigidBody::upcast(objects[j]);
+            if (body && body->getMotionState() && !body->isStaticOrKinematicObject())
+                static_cast<PhysicsCollisionObject::PhysicsMotionState*>(body->getMotionState())->interpolate(alpha);
+        }
+    }
+}
+
 void PhysicsController::addCollisionListener(PhysicsCollisionObject::CollisionListener* listener, PhysicsCollisionObject* objectA, PhysicsCollisionObject* objectB)
 {
     GP_ASSERT(listener);
     
     // One of the collision objects in the pair must be non-null.
     GP_ASSERT(objectA || objectB);
-    PhysicsCollisionObject::CollisionPair pair(objectA, objectB);
 
     // Add the listener and ensure the status includes that this collision pair is registered.
-    CollisionInfo& info = _collisionStatus[pair];
+    CollisionInfo& info = _collisionInfos[getCollisionInfo(objectA, objectB)];
     info._listeners.push_back(listener);
     info._status |= PhysicsController::REGISTERED;
 }
@@ -628,12 +1375,13 @@ void PhysicsController::removeCollisionListener(PhysicsCollisionObject::Collisio
 {
     // One of the collision objects in the pair must be non-null.
     GP_ASSERT(objectA || objectB);
-    PhysicsCollisionObject::CollisionPair pair(objectA, objectB);
 
     // Mark the collision pair for these objects for removal.
-    if (_collisionStatus.count(pair) > 0)
+    int index = findCollisionInfo(objectA, objectB);
+    if (index >= 0 && (_collisionInfos[index]._status & REMOVE) == 0)
     {
-        _collisionStatus[pair]._status |= REMOVE;
+        _collisionInfos[index]._status |= REMOVE;
+        _removedCollisionInfos.push_back(index);
     }
 }
 
@@ -675,6 +1423,30 @@ void PhysicsController::removeCollisionObject(PhysicsCollisionObject* object, bo
     GP_ASSERT(_world);
     GP_ASSERT(!_isUpdating);
 
+    // Bodies outside of the active simulation region are taken out of it, with their activation
+    // state restored, in case they are added back later.
+    if (object->getType() == PhysicsCollisionObject::RIGID_BODY)
+    {
+        PhysicsRigidBody* body = static_cast<PhysicsRigidBody*>(object);
+        if (body->_simulationRegion != REGION_ACTIVE)
+        {
+            std::vector<PhysicsRigidBody*>::iterator itr = std::find(_reducedBodies.begin(), _reducedBodies.end(), body);
+            if (itr != _reducedBodies.end())
+                _reducedBodies.erase(itr);
+            if (body->_regionRemoved)
+            {
+                _frozenBodies.erase(std::find(_frozenBodies.begin(), _frozenBodies.end(), body));
+                body->_regionRemoved = false;
+            }
+            else if (body->_body)
+            {
+                body->_body->forceActivationState(body->_regionActivationState);
+            }
+            body->_simulationRegion = REGION_ACTIVE;
+            --_regionBodyCount;
+        }
+    }
+
     // Remove the collision object from the world.
     if (object->getCollisionObject())
     {
@@ -698,11 +1470,14 @@ void PhysicsController::removeCollisionObject(PhysicsCollisionObject* object, bo
     // Find all references to the object in the collision status cache and mark them for removal.
     if (removeListeners)
     {
-        std::map<PhysicsCollisionObject::CollisionPair, CollisionInfo>::iterator iter = _collisionStatus.begin();
-        for (; iter != _collisionStatus.end(); iter++)
+        for (size_t i = 0, count = _collisionInfos.size(); i < count; i++)
         {
-            if (iter->first.objectA == object || iter->first.objectB == object)
-                iter->second._status |= REMOVE;
+            CollisionInfo& info = _collisionInfos[i];
+            if ((info._status & (FREE | REMOVE)) == 0 && (info._pair.objectA == object || info._pair.objectB == object))
+            {
+                info._status |= REMOVE;
+                _removedCollisionInfos.push_back((int)i);
+            }
         }
     }
 }
@@ -896,6 +1671,8 @@ PhysicsCollisionShape* PhysicsController::createShape(Node* node, const PhysicsC
                 // Build the heightfield from an attached terrain's height array
                 if (dynamic_cast<Terrain*>(node->getDrawable()) == NULL)
                     GP_ERROR("Empty heightfield collision shapes can only be used on nodes that have an attached Terrain.");
+                else if (dynamic_cast<Terrain*>(node->getDrawable())->_heightfield == NULL)
+                    GP_ERROR("Heightfield collision shapes cannot be created from paged terrains, whose heights are not all in memory.");
                 else
                     collisionShape = createHeightfield(node, dynamic_cast<Terrain*>(node->getDrawable())->_heightfield, centerOfMassOffset);
             }
@@ -921,27 +1698,19 @@ PhysicsCollisionShape* PhysicsController::createBox(const Vector3& extents, cons
 {
     btVector3 halfExtents(scale.x * 0.5 * extents.x, scale.y * 0.5 * extents.y, scale.z * 0.5 * extents.z);
 
-    PhysicsCollisionShape* shape;
-
     // Return the box shape from the cache if it already exists.
-    for (unsigned int i = 0; i < _shapes.size(); ++i)
-    {
-        shape = _shapes[i];
-        GP_ASSERT(shape);
-        if (shape->getType() == PhysicsCollisionShape::SHAPE_BOX)
-        {
-            btBoxShape* box = static_cast<btBoxShape*>(shape->_shape);
-            if (box && box->getHalfExtentsWithMargin() == halfExtents)
-            {
-                shape->addRef();
-                return shape;
-            }
-        }
-    }
+    PhysicsCollisionShape::CacheKey key;
+    key.type = PhysicsCollisionShape::SHAPE_BOX;
+    key.size[0] = halfExtents.x();
+    key.size[1] = halfExtents.y();
+    key.size[2] = halfExtents.z();
+    PhysicsCollisionShape* shape = findShape(key);
+    if (shape)
+        return shape;
 
     // Create the box shape and add it to the cache.
     shape = new PhysicsCollisionShape(PhysicsCollisionShape::SHAPE_BOX, bullet_new<btBoxShape>(halfExtents));
-    _shapes.push_back(shape);
+    addShape(shape, key, sizeof(btBoxShape));
 
     return shape;
 }
@@ -958,27 +1727,17 @@ PhysicsCollisionShape* PhysicsController::createSphere(float radius, const Vecto
 
     float scaledRadius = radius * uniformScale;
 
-    PhysicsCollisionShape* shape;
-
     // Return the sphere shape from the cache if it already exists.
-    for (unsigned int i = 0; i < _shapes.size(); ++i)
-    {
-        shape = _shapes[i];
-        GP_ASSERT(shape);
-        if (shape->getType() == PhysicsCollisionShape::SHAPE_SPHERE)
-        {
-            btSphereShape* sphere = static_cast<btSphereShape*>(shape->_shape);
-            if (sphere && sphere->getRadius() == scaledRadius)
-            {
-                shape->addRef();
-                return shape;
-            }
-        }
-    }
+    PhysicsCollisionShape::CacheKey key;
+    key.type = PhysicsCollisionShape::SHAPE_SPHERE;
+    key.size[0] = scaledRadius;
+    PhysicsCollisionShape* shape = findShape(key);
+    if (shape)
+        return shape;
 
     // Create the sphere shape and add it to the cache.
     shape = new PhysicsCollisionShape(PhysicsCollisionShape::SHAPE_SPHERE, bullet_new<btSphereShape>(scaledRadius));
-    _shapes.push_back(shape);
+    addShape(shape, key, sizeof(btSphereShape));
 
     return shape;
 }
@@ -991,27 +1750,18 @@ PhysicsCollisionShape* PhysicsController::createCapsule(float radius, float heig
     float scaledRadius = radius * girthScale;
     float scaledHeight = height * scale.y - radius * 2;
 
-    PhysicsCollisionShape* shape;
-
     // Return the capsule shape from the cache if it already exists.
-    for (unsigned int i = 0; i < _shapes.size(); i++)
-    {
-        shape = _shapes[i];
-        GP_ASSERT(shape);
-        if (shape->getType() == PhysicsCollisionShape::SHAPE_CAPSULE)
-        {
-            btCapsuleShape* capsule = static_cast<btCapsuleShape*>(shape->_shape);
-            if (capsule && capsule->getRadius() == scaledRadius && capsule->getHalfHeight() == 0.5f * scaledHeight)
-            {
-                shape->addRef();
-                return shape;
-            }
-        }
-    }
+    PhysicsCollisionShape::CacheKey key;
+    key.type = PhysicsCollisionShape::SHAPE_CAPSULE;
+    key.size[0] = scaledRadius;
+    key.size[1] = scaledHeight;
+    PhysicsCollisionShape* shape = findShape(key);
+    if (shape)
+        return shape;
 
     // Create the capsule shape and add it to the cache.
     shape = new PhysicsCollisionShape(PhysicsCollisionShape::SHAPE_CAPSULE, bullet_new<btCapsuleShape>(scaledRadius, scaledHeight));
-    _shapes.push_back(shape);
+    addShape(shape, key, sizeof(btCapsuleShape));
 
     return shape;
 }
@@ -1069,7 +1819,12 @@ PhysicsCollisionShape* PhysicsController::createHeightfield(Node* node, HeightFi
     PhysicsCollisionShape* shape = new PhysicsCollisionShape(PhysicsCollisionShape::SHAPE_HEIGHTFIELD, terrainShape);
     shape->_shapeData.heightfieldData = heightfieldData;
 
-    _shapes.push_back(shape);
+    // Heightfield shapes hold the scale and inverse world matrix of their node, so they are never shared.
+    // The height array belongs to the heightfield and is not counted.
+    PhysicsCollisionShape::CacheKey key;
+    key.type = PhysicsCollisionShape::SHAPE_HEIGHTFIELD;
+    key.unique = shape;
+    addShape(shape, key, sizeof(btHeightfieldTerrainShape) + sizeof(PhysicsCollisionShape::HeightfieldData));
 
     return shape;
 }
@@ -1115,9 +1870,27 @@ PhysicsCollisionShape* PhysicsController::createMesh(Mesh* mesh, const Vector3&
         }
     }
 
-    // Read mesh data from URL
-    Bundle::MeshData* data = Bundle::readMeshData(mesh->getUrl());
-    if (data == NULL)
+    // Return the mesh shape from the cache if it already exists. Shapes are matched by the URL that
+    // their data is read from rather than by the mesh, so that copies of a mesh share a shape.
+    PhysicsCollisionShape::CacheKey key;
+    key.type = PhysicsCollisionShape::SHAPE_MESH;
+    key.size[0] = scale.x;
+    key.size[1] = scale.y;
+    key.size[2] = scale.z;
+    key.dynamic = dynamic;
+    key.url = mesh->getUrl();
+    PhysicsCollisionShape* shape = findShape(key);
+    if (shape)
+        return shape;
+
+    // Share the geometry that the mesh kept when it was loaded, or read it from the bundle once
+    // for all of the shapes and systems that need it.
+    MeshGeometry* geometry = mesh->getGeometry();
+    if (geometry)
+        geometry->addRef();
+    else
+        geometry = MeshGeometry::get(mesh->getUrl());
+    if (geometry == NULL)
     {
         GP_ERROR("Failed to load mesh data from url '%s'.", mesh->getUrl());
         return NULL;
@@ -1126,21 +1899,24 @@ PhysicsCollisionShape* PhysicsController::createMesh(Mesh* mesh, const Vector3&
     // Create mesh data to be populated and store in returned collision shape.
     PhysicsCollisionShape::MeshData* shapeMeshData = new PhysicsCollisionShape::MeshData();
     shapeMeshData->vertexData = NULL;
-
-    // Copy the scaled vertex position data to the rigid body's local buffer.
-    Matrix m;
-    Matrix::createScale(scale, &m);
-    unsigned int vertexCount = data->vertexCount;
-    shapeMeshData->vertexData = new float[vertexCount * 3];
-    Vector3 v;
-    int vertexStride = data->vertexFormat.getVertexSize();
-    for (unsigned int i = 0; i < data->vertexCount; i++)
+    shapeMeshData->bvhData = NULL;
+    shapeMeshData->geometry = geometry;
+
+    // The positions of the geometry are used as they are, unless the shape is scaled.
+    unsigned int vertexCount = geometry->getVertexCount();
+    const float* vertexData = geometry->getPositions();
+    size_t memoryUsage = sizeof(PhysicsCollisionShape::MeshData);
+    if (scale != Vector3::one())
     {
-        v.set(*((float*)&data->vertexData[i * vertexStride + 0 * sizeof(float)]),
-                *((float*)&data->vertexData[i * vertexStride + 1 * sizeof(float)]),
-                *((float*)&data->vertexData[i * vertexStride + 2 * sizeof(float)]));
-        v *= m;
-        memcpy(&(shapeMeshData->vertexData[i * 3]), &v, sizeof(float) * 3);
+        shapeMeshData->vertexData = new float[vertexCount * 3];
+        for (unsigned int i = 0; i < vertexCount * 3; i += 3)
+        {
+            shapeMeshData->vertexData[i] = vertexData[i] * scale.x;
+            shapeMeshData->vertexData[i + 1] = vertexData[i + 1] * scale.y;
+            shapeMeshData->vertexData[i + 2] = vertexData[i + 2] * scale.z;
+        }
+        vertexData = shapeMeshData->vertexData;
+        memoryUsage += vertexCount * 3 * sizeof(float);
     }
 
     btCollisionShape* collisionShape = NULL;
@@ -1148,34 +1924,56 @@ PhysicsCollisionShape* PhysicsController::createMesh(Mesh* mesh, const Vector3&
 
     if (dynamic)
     {
-        // For dynamic meshes, use a btConvexHullShape approximation
-        btConvexHullShape* originalConvexShape = bullet_new<btConvexHullShape>(shapeMeshData->vertexData, data->vertexCount, sizeof(float)*3);
+        // For dynamic meshes, use a btConvexHullShape approximation.
+        // Use the hull from the hull cache if there is one for this mesh, otherwise build it (and add it to the cache).
+        std::string hullPath;
+        std::vector<btScalar> hullVertices;
+        if (_meshBvhCache)
+        {
+            hullPath = getMeshHullPath(mesh->getUrl());
+            loadMeshHull(hullPath.c_str(), scale, vertexCount, &hullVertices);
+        }
+
+        if (hullVertices.empty())
+        {
+            btConvexHullShape* originalConvexShape = bullet_new<btConvexHullShape>(vertexData, vertexCount, sizeof(float)*3);
+
+            // Create a hull approximation for better performance
+            btShapeHull* hull = bullet_new<btShapeHull>(originalConvexShape);
+            hull->buildHull(originalConvexShape->getMargin());
+            hullVertices.resize(hull->numVertices() * 3);
+            for (int i = 0; i < hull->numVertices(); ++i)
+            {
+                const btVector3& vertex = hull->getVertexPointer()[i];
+                hullVertices[i * 3] = vertex.x();
+                hullVertices[i * 3 + 1] = vertex.y();
+                hullVertices[i * 3 + 2] = vertex.z();
+            }
+            if (_meshBvhCache)
+                saveMeshHull(hullPath.c_str(), scale, vertexCount, hullVertices);
 
-        // Create a hull approximation for better performance
-	    btShapeHull* hull = bullet_new<btShapeHull>(originalConvexShape);
-	    hull->buildHull(originalConvexShape->getMargin());
-	    collisionShape = bullet_new<btConvexHullShape>((btScalar*)hull->getVertexPointer(), hull->numVertices());
+            SAFE_DELETE(hull);
+            SAFE_DELETE(originalConvexShape);
+        }
 
-        SAFE_DELETE(hull);
-        SAFE_DELETE(originalConvexShape);
+        int hullVertexCount = (int)hullVertices.size() / 3;
+        collisionShape = bullet_new<btConvexHullShape>(&hullVertices[0], hullVertexCount, sizeof(btScalar)*3);
+        memoryUsage += sizeof(btConvexHullShape) + hullVertexCount * sizeof(btVector3);
     }
     else
     {
         // For static meshes, use btBvhTriangleMeshShape
         meshInterface = bullet_new<btTriangleIndexVertexArray>();
+        unsigned int triangleCount = 0;
 
-        size_t partCount = data->parts.size();
+        unsigned int partCount = geometry->getPartCount();
         if (partCount > 0)
         {
             PHY_ScalarType indexType = PHY_UCHAR;
             int indexStride = 0;
-            Bundle::MeshPartData* meshPart = NULL;
-            for (size_t i = 0; i < partCount; i++)
+            for (unsigned int i = 0; i < partCount; i++)
             {
-                meshPart = data->parts[i];
-                GP_ASSERT(meshPart);
-
-                switch (meshPart->indexFormat)
+                switch (geometry->getPartIndexFormat(i))
                 {
                 case Mesh::INDEX8:
                     indexType = PHY_UCHAR;
@@ -1190,27 +1988,26 @@ PhysicsCollisionShape* PhysicsController::createMesh(Mesh* mesh, const Vector3&
                     indexStride = 4;
                     break;
                 default:
-                    GP_ERROR("Unsupported index format (%d).", meshPart->indexFormat);
+                    GP_ERROR("Unsupported index format (%d).", geometry->getPartIndexFormat(i));
                     SAFE_DELETE(meshInterface);
                     SAFE_DELETE_ARRAY(shapeMeshData->vertexData);
                     SAFE_DELETE(shapeMeshData);
-                    SAFE_DELETE(data);
+                    SAFE_RELEASE(geometry);
                     return NULL;
                 }
 
-                // Move the index data into the rigid body's local buffer.
-                // Set it to NULL in the MeshPartData so it is not released when the data is freed.
-                shapeMeshData->indexData.push_back(meshPart->indexData);
-                meshPart->indexData = NULL;
+                // The indices are shared with the geometry, which the shape keeps a reference to.
+                unsigned int indexCount = geometry->getPartIndexCount(i);
+                triangleCount += indexCount / 3;
 
                 // Create a btIndexedMesh object for the current mesh part.
                 btIndexedMesh indexedMesh;
                 indexedMesh.m_indexType = indexType;
-                indexedMesh.m_numTriangles = meshPart->indexCount / 3; // assume TRIANGLES primitive type
-                indexedMesh.m_numVertices = meshPart->indexCount;
-                indexedMesh.m_triangleIndexBase = (const unsigned char*)shapeMeshData->indexData[i];
+                indexedMesh.m_numTriangles = indexCount / 3; // assume TRIANGLES primitive type
+                indexedMesh.m_numVertices = indexCount;
+                indexedMesh.m_triangleIndexBase = (const unsigned char*)geometry->getPartIndexData(i);
                 indexedMesh.m_triangleIndexStride = indexStride*3;
-                indexedMesh.m_vertexBase = (const unsigned char*)shapeMeshData->vertexData;
+                indexedMesh.m_vertexBase = (const unsigned char*)vertexData;
                 indexedMesh.m_vertexStride = sizeof(float)*3;
                 indexedMesh.m_vertexType = PHY_FLOAT;
 
@@ -1221,21 +2018,23 @@ PhysicsCollisionShape* PhysicsController::createMesh(Mesh* mesh, const Vector3&
         else
         {
             // Generate index data for the mesh locally in the rigid body.
-            unsigned int* indexData = new unsigned int[data->vertexCount];
-            for (unsigned int i = 0; i < data->vertexCount; i++)
+            unsigned int* indexData = new unsigned int[vertexCount];
+            for (unsigned int i = 0; i < vertexCount; i++)
             {
                 indexData[i] = i;
             }
             shapeMeshData->indexData.push_back((unsigned char*)indexData);
+            memoryUsage += vertexCount * sizeof(unsigned int);
+            triangleCount = vertexCount / 3;
 
             // Create a single btIndexedMesh object for the mesh interface.
             btIndexedMesh indexedMesh;
             indexedMesh.m_indexType = PHY_INTEGER;
-            indexedMesh.m_numTriangles = data->vertexCount / 3; // assume TRIANGLES primitive type
-            indexedMesh.m_numVertices = data->vertexCount;
+            indexedMesh.m_numTriangles = vertexCount / 3; // assume TRIANGLES primitive type
+            indexedMesh.m_numVertices = vertexCount;
             indexedMesh.m_triangleIndexBase = shapeMeshData->indexData[0];
             indexedMesh.m_triangleIndexStride = sizeof(unsigned int);
-            indexedMesh.m_vertexBase = (const unsigned char*)shapeMeshData->vertexData;
+            indexedMesh.m_vertexBase = (const unsigned char*)vertexData;
             indexedMesh.m_vertexStride = sizeof(float)*3;
             indexedMesh.m_vertexType = PHY_FLOAT;
 
@@ -1243,18 +2042,37 @@ PhysicsCollisionShape* PhysicsController::createMesh(Mesh* mesh, const Vector3&
             meshInterface->addIndexedMesh(indexedMesh, indexedMesh.m_indexType);
         }
 
-        // Create our collision shape object and store shapeMeshData in it.
-        collisionShape = bullet_new<btBvhTriangleMeshShape>(meshInterface, true);
+        // Use the BVH from the BVH cache if there is one for this mesh, otherwise build it (and add it to the cache).
+        std::string bvhPath;
+        btOptimizedBvh* bvh = NULL;
+        if (_meshBvhCache)
+        {
+            bvhPath = getMeshBvhPath(mesh->getUrl());
+            bvh = loadMeshBvh(bvhPath.c_str(), scale, vertexCount, triangleCount, &shapeMeshData->bvhData);
+        }
+
+        btBvhTriangleMeshShape* meshShape;
+        if (bvh)
+        {
+            meshShape = bullet_new<btBvhTriangleMeshShape>(meshInterface, true, false);
+            meshShape->setOptimizedBvh(bvh);
+        }
+        else
+        {
+            meshShape = bullet_new<btBvhTriangleMeshShape>(meshInterface, true);
+            GP_ASSERT(meshShape->getOptimizedBvh());
+            if (_meshBvhCache)
+                saveMeshBvh(bvhPath.c_str(), scale, vertexCount, triangleCount, meshShape->getOptimizedBvh());
+        }
+        memoryUsage += sizeof(btBvhTriangleMeshShape) + sizeof(btTriangleIndexVertexArray) + meshShape->getOptimizedBvh()->calculateSerializeBufferSize();
+        collisionShape = meshShape;
     }
 
     // Create our collision shape object and store shapeMeshData in it.
-    PhysicsCollisionShape* shape = new PhysicsCollisionShape(PhysicsCollisionShape::SHAPE_MESH, collisionShape, meshInterface);
+    // The memory of the shared geometry is counted with the meshes rather than with the shape.
+    shape = new PhysicsCollisionShape(PhysicsCollisionShape::SHAPE_MESH, collisionShape, meshInterface);
     shape->_shapeData.meshData = shapeMeshData;
-
-    _shapes.push_back(shape);
-
-    // Free the temporary mesh data now that it's stored in physics system.
-    SAFE_DELETE(data);
+    addShape(shape, key, memoryUsage);
 
     return shape;
 }
@@ -1266,8 +2084,8 @@ void PhysicsController::destroyShape(PhysicsCollisionShape* shape)
         if (shape->getRefCount() == 1)
         {
             // Remove shape from shape cache.
-            std::vector<PhysicsCollisionShape*>::iterator shapeItr = std::find(_shapes.begin(), _shapes.end(), shape);
-            if (shapeItr != _shapes.end())
+            std::unordered_map<PhysicsCollisionShape::CacheKey, PhysicsCollisionShape*, PhysicsCollisionShape::CacheKeyHash>::iterator shapeItr = _shapes.find(shape->_cacheKey);
+            if (shapeItr != _shapes.end() && shapeItr->second == shape)
                 _shapes.erase(shapeItr);
         }
 
@@ -1276,6 +2094,177 @@ void PhysicsController::destroyShape(PhysicsCollisionShape* shape)
     }
 }
 
+PhysicsCollisionShape* PhysicsController::findShape(const PhysicsCollisionShape::CacheKey& key)
+{
+    std::unordered_map<PhysicsCollisionShape::CacheKey, PhysicsCollisionShape*, PhysicsCollisionShape::CacheKeyHash>::iterator itr = _shapes.find(key);
+    if (itr == _shapes.end())
+        return NULL;
+
+    PhysicsCollisionShape* shape = itr->second;
+    GP_ASSERT(shape);
+    shape->addRef();
+    ++_shapeReuseCount;
+    return shape;
+}
+
+void PhysicsController::addShape(PhysicsCollisionShape* shape, const PhysicsCollisionShape::CacheKey& key, size_t memoryUsage)
+{
+    GP_ASSERT(shape);
+    GP_ASSERT(_shapes.find(key) == _shapes.end());
+
+    shape->_cacheKey = key;
+    shape->_memoryUsage = memoryUsage;
+    _shapes[key] = shape;
+}
+
+std::string PhysicsController::getMeshBvhPath(const char* url)
+{
+    // The BVH of the mesh 'id' in 'res/level.gpb' is cached in 'res/level.gpb.id.bvh'.
+    std::string path(url);
+    std::replace(path.begin(), path.end(), '#', '.');
+    path += ".bvh";
+    return path;
+}
+
+btOptimizedBvh* PhysicsController::loadMeshBvh(const char* path, const Vector3& scale, unsigned int vertexCount, unsigned int triangleCount, void** data)
+{
+    GP_ASSERT(data);
+
+    Stream* stream = FileSystem::open(path);
+    if (stream == NULL)
+        return NULL;
+
+    // Files that were written for different mesh data or a different build of Bullet are ignored.
+    btOptimizedBvh* bvh = NULL;
+    BvhCacheHeader header;
+    if (stream->read(&header, sizeof(header), 1) == 1 &&
+        memcmp(header.identifier, BVH_CACHE_IDENTIFIER, sizeof(header.identifier)) == 0 &&
+        header.version == BVH_CACHE_VERSION && header.bulletVersion == btGetVersion() && header.scalarSize == sizeof(btScalar) &&
+        header.scale[0] == scale.x && header.scale[1] == scale.y && header.scale[2] == scale.z &&
+        header.vertexCount == vertexCount && header.triangleCount == triangleCount && header.size > 0)
+    {
+        // The BVH is used in place, so the buffer is kept for the lifetime of the shape.
+        *data = btAlignedAlloc(header.size, 16);
+        if (stream->read(*data, 1, header.size) == header.size)
+            bvh = btOptimizedBvh::deSerializeInPlace(*data, header.size, false);
+        if (bvh == NULL)
+        {
+            GP_WARN("Failed to load mesh BVH from '%s'.", path);
+            btAlignedFree(*data);
+            *data = NULL;
+        }
+    }
+    SAFE_DELETE(stream);
+
+    return bvh;
+}
+
+void PhysicsController::saveMeshBvh(const char* path, const Vector3& scale, unsigned int vertexCount, unsigned int triangleCount, const btOptimizedBvh* bvh)
+{
+    GP_ASSERT(bvh);
+
+    BvhCacheHeader header;
+    memcpy(header.identifier, BVH_CACHE_IDENTIFIER, sizeof(header.identifier));
+    header.version = BVH_CACHE_VERSION;
+    header.bulletVersion = btGetVersion();
+    header.scalarSize = sizeof(btScalar);
+    header.scale[0] = scale.x;
+    header.scale[1] = scale.y;
+    header.scale[2] = scale.z;
+    header.vertexCount = vertexCount;
+    header.triangleCount = triangleCount;
+    header.size = bvh->calculateSerializeBufferSize();
+
+    void* buffer = btAlignedAlloc(header.size, 16);
+    if (bvh->serializeInPlace(buffer, header.size, false))
+    {
+        Stream* stream = FileSystem::open(path, FileSystem::WRITE);
+        if (stream == NULL || stream->write(&header, sizeof(header), 1) != 1 || stream->write(buffer, 1, header.size) != header.size)
+            GP_WARN("Failed to write mesh BVH to '%s'.", path);
+        SAFE_DELETE(stream);
+    }
+    btAlignedFree(buffer);
+}
+
+std::string PhysicsController::getMeshHullPath(const char* url)
+{
+    // The hull of the mesh 'id' in 'res/level.gpb' is cached in 'res/level.gpb.id.hull'.
+    std::string path(url);
+    std::replace(path.begin(), path.end(), '#', '.');
+    path += ".hull";
+    return path;
+}
+
+bool PhysicsController::loadMeshHull(const char* path, const Vector3& scale, unsigned int vertexCount, std::vector<btScalar>* vertices)
+{
+    GP_ASSERT(vertices);
+
+    Stream* stream = FileSystem::open(path);
+    if (stream == NULL)
+        return false;
+
+    // Files that were written for different mesh data or a different build of Bullet are ignored.
+    BvhCacheHeader header;
+    if (stream->read(&header, sizeof(header), 1) == 1 &&
+        memcmp(header.identifier, HULL_CACHE_IDENTIFIER, sizeof(header.identifier)) == 0 &&
+        header.version == BVH_CACHE_VERSION && header.bulletVersion == btGetVersion() && header.scalarSize == sizeof(btScalar) &&
+        header.scale[0] == scale.x && header.scale[1] == scale.y && header.scale[2] == scale.z &&
+        header.vertexCount == vertexCount && header.triangleCount == 0 && header.size > 0 && header.size % (sizeof(btScalar) * 3) == 0)
+    {
+        vertices->resize(header.size / sizeof(btScalar));
+        if (stream->read(&(*vertices)[0], 1, header.size) != header.size)
+        {
+            GP_WARN("Failed to load mesh hull from '%s'.", path);
+            vertices->clear();
+        }
+    }
+    SAFE_DELETE(stream);
+
+    return !vertices->empty();
+}
+
+void PhysicsController::saveMeshHull(const char* path, const Vector3& scale, unsigned int vertexCount, const std::vector<btScalar>& vertices)
+{
+    GP_ASSERT(!vertices.empty());
+
+    BvhCacheHeader header;
+    memcpy(header.identifier, HULL_CACHE_IDENTIFIER, sizeof(header.identifier));
+    header.version = BVH_CACHE_VERSION;
+    header.bulletVersion = btGetVersion();
+    header.scalarSize = sizeof(btScalar);
+    header.scale[0] = scale.x;
+    header.scale[1] = scale.y;
+    header.scale[2] = scale.z;
+    header.vertexCount = vertexCount;
+    header.triangleCount = 0;
+    header.size = (unsigned int)(vertices.size() * sizeof(btScalar));
+
+    Stream* stream = FileSystem::open(path, FileSystem::WRITE);
+    if (stream == NULL || stream->write(&header, sizeof(header), 1) != 1 || stream->write(&vertices[0], 1, header.size) != header.size)
+        GP_WARN("Failed to write mesh hull to '%s'.", path);
+    SAFE_DELETE(stream);
+}
+
+void PhysicsController::getShapeStatistics(ShapeStatistics* statistics) const
+{
+    GP_ASSERT(statistics);
+
+    statistics->shapeCount = (unsigned int)_shapes.size();
+    statistics->meshShapeCount = 0;
+    statistics->referenceCount = 0;
+    statistics->reuseCount = _shapeReuseCount;
+    statistics->memoryUsage = 0;
+    std::unordered_map<PhysicsCollisionShape::CacheKey, PhysicsCollisionShape*, PhysicsCollisionShape::CacheKeyHash>::const_iterator itr = _shapes.begin();
+    for (; itr != _shapes.end(); ++itr)
+    {
+        const PhysicsCollisionShape* shape = itr->second;
+        if (shape->getType() == PhysicsCollisionShape::SHAPE_MESH)
+            ++statistics->meshShapeCount;
+        statistics->referenceCount += shape->getRefCount();
+        statistics->memoryUsage += shape->_memoryUsage;
+    }
+}
+
 void PhysicsController::addConstraint(PhysicsRigidBody* a, PhysicsRigidBody* b, PhysicsConstraint* constraint)
 {
     GP_ASSERT(a);
@@ -100,6 +100,39 @@ public:
         Vector3 normal;
     };
 
+    /**
+     * Statistics about the collision shapes of the physics controller (see getShapeStatistics).
+     *
+     * @script{ignore}
+     */
+    struct ShapeStatistics
+    {
+        /**
+         * The number of distinct collision shapes.
+         */
+        unsigned int shapeCount;
+
+        /**
+         * The number of mesh shapes among them.
+         */
+        unsigned int meshShapeCount;
+
+        /**
+         * The number of references to the shapes, which is the number of collision objects using them.
+         */
+        unsigned int referenceCount;
+
+        /**
+         * The number of times a shape was shared with a new collision object instead of being created.
+         */
+        unsigned int reuseCount;
+
+        /**
+         * The approximate memory used by the shapes and their data, in bytes.
+         */
+        size_t memoryUsage;
+    };
+
     /**
      * Class that can be overridden to provide custom hit test filters for ray
      * and sweep tests.
@@ -301,6 +334,193 @@ public:
      */
     void setGravity(const Vector3& gravity);
 
+    /**
+     * Sets the fixed time step of the simulation.
+     *
+     * With a fixed time step, the simulation advances in steps of exactly the given length, as many
+     * as fit in the time that has passed, up to the maximum number of steps per frame. Time beyond
+     * that budget is dropped, so slow frames slow the simulation down instead of making the next
+     * frames slower still. The simulation takes the same steps at any frame rate, which makes it
+     * behave the same across devices.
+     *
+     * The fixed time step can also be set in the physics section of the game.config file:
+     *
+     * @code
+     * physics
+     * {
+     *     fixedTimeStep = 0.0166667
+     *     maxSubSteps = 4
+     *     interpolation = true
+     * }
+     * @endcode
+     *
+     * By default there is no fixed time step and Bullet divides the elapsed time of each frame into
+     * up to 10 steps of 1/60 of a second, extrapolating the transforms of the rigid bodies to the end
+     * of the frame.
+     *
+     * @param timeStep The length of each step in seconds, or zero to disable fixed steps.
+     * @param maxSubSteps The maximum number of steps per frame.
+     * @script{ignore}
+     */
+    void setFixedTimeStep(float timeStep, unsigned int maxSubSteps = 4);
+
+    /**
+     * Gets the fixed time step of the simulation.
+     *
+     * @return The length of each step in seconds, or zero if fixed steps are disabled.
+     * @script{ignore}
+     */
+    float getFixedTimeStep() const;
+
+    /**
+     * Gets the maximum number of fixed steps per frame.
+     *
+     * @return The maximum number of steps per frame.
+     * @script{ignore}
+     */
+    unsigned int getMaxSubSteps() const;
+
+    /**
+     * Sets whether the transforms of rigid bodies are interpolated between fixed steps.
+     *
+     * With interpolation, the nodes of dynamic rigid bodies are placed between their transforms
+     * after the last two steps, according to how much of the next step the remaining time of the
+     * frame covers. This keeps motion smooth when the frame rate does not match the step rate,
+     * at the cost of showing the bodies up to one step behind the simulation.
+     *
+     * Interpolation only applies while a fixed time step is set, and is enabled by default.
+     *
+     * @param enabled true to interpolate the transforms of rigid bodies, false otherwise.
+     * @script{ignore}
+     */
+    void setInterpolationEnabled(bool enabled);
+
+    /**
+     * Determines if the transforms of rigid bodies are interpolated between fixed steps.
+     *
+     * @return true if the transforms are interpolated, false otherwise.
+     * @script{ignore}
+     */
+    bool isInterpolationEnabled() const;
+
+    /**
+     * Determines if the simulation runs on the threads of the job system.
+     *
+     * The multithreaded world splits collision detection, island solving and integration
+     * of the simulation between the threads of the job system (see Game::getJobSystem).
+     * It requires a build of Bullet with BT_THREADSAFE defined, and is enabled in the
+     * physics section of the game.config file:
+     *
+     * @code
+     * physics
+     * {
+     *     multithreaded = true
+     * }
+     * @endcode
+     *
+     * @return true if the simulation is multithreaded, false otherwise.
+     * @script{ignore}
+     */
+    bool isMultithreaded() const;
+
+    /**
+     * Sets the simulation regions around the simulation anchors.
+     *
+     * Dynamic rigid bodies that are within the active radius of an anchor are simulated every
+     * step. Bodies further away but within the reduced radius are simulated every reducedInterval
+     * steps, as if with a step that is that many times longer, and bodies beyond the reduced radius
+     * are frozen. Frozen bodies are removed from the world, and so from the broadphase, unless they
+     * have constraints, in which case their simulation is disabled. Bodies keep their velocities
+     * and their sleeping state while they are out of the active region, and carry on from them when
+     * they come back into it.
+     *
+     * The regions are used once anchors are added with addSimulationAnchor, and are disabled by
+     * default. Static and kinematic bodies, vehicles, ghost objects and characters are always simulated.
+     *
+     * @param activeRadius The radius around each anchor within which bodies are simulated every
+     *      step, or 0 to simulate all the bodies every step.
+     * @param reducedRadius The radius around each anchor within which bodies are simulated at a
+     *      reduced rate. It is at least the active radius.
+     * @param reducedInterval The number of steps between the steps of bodies in the reduced region.
+     * @script{ignore}
+     */
+    void setSimulationRegions(float activeRadius, float reducedRadius, unsigned int reducedInterval = 4);
+
+    /**
+     * Returns the radius around each anchor within which bodies are simulated every step.
+     *
+     * @return The active radius, or 0 if the simulation regions are disabled.
+     * @script{ignore}
+     */
+    float getSimulationActiveRadius() const;
+
+    /**
+     * Returns the radius around each anchor within which bodies are simulated at a reduced rate.
+     *
+     * @return The reduced radius.
+     * @script{ignore}
+     */
+    float getSimulationReducedRadius() const;
+
+    /**
+     * Returns the number of steps between the steps of bodies in the reduced region.
+     *
+     * @return The reduced interval.
+     * @script{ignore}
+     */
+    unsigned int getSimulationReducedInterval() const;
+
+    /**
+     * Adds a node around which bodies are simulated, such as the node of the active camera or of
+     * the player. The regions around all the anchors are merged.
+     *
+     * @param node The node to add as an anchor.
+     * @script{ignore}
+     */
+    void addSimulationAnchor(Node* node);
+
+    /**
+     * Removes a node around which bodies are simulated.
+     *
+     * @param node The anchor to remove.
+     *
+     * @return true if the node was an anchor, false otherwise.
+     * @script{ignore}
+     */
+    bool removeSimulationAnchor(Node* node);
+
+    /**
+     * Returns the number of rigid bodies that are frozen because they are beyond the simulation regions.
+     *
+     * @return The number of frozen bodies.
+     * @script{ignore}
+     */
+    unsigned int getFrozenBodyCount() const;
+
+    /**
+     * Gets statistics about the collision shapes that are in use.
+     *
+     * Collision objects with the same shape definition share a single collision shape. Primitive
+     * shapes are shared when their scaled dimensions match, and mesh shapes when they are created
+     * from the same mesh data with the same scale. The statistics show how much sharing happens.
+     *
+     * The BVHs of static mesh shapes and the convex hulls of dynamic mesh shapes can also be cached
+     * in files next to the bundles that the meshes are loaded from, so that they are not rebuilt
+     * every time a level is loaded. The cache is enabled in the physics section of the game.config
+     * file, and is written as meshes without cached BVHs or hulls are loaded:
+     *
+     * @code
+     * physics
+     * {
+     *     meshBvhCache = true
+     * }
+     * @endcode
+     *
+     * @param statistics Populated with the statistics of the collision shapes.
+     * @script{ignore}
+     */
+    void getShapeStatistics(ShapeStatistics* statistics) const;
+
     /**
      * Draws debugging information (rigid body outlines, etc.) using the given view projection matrix.
      * 
@@ -341,6 +561,45 @@ public:
      */
     bool sweepTest(PhysicsCollisionObject* object, const Vector3& endPosition, PhysicsController::HitResult* result = NULL, PhysicsController::HitFilter* filter = NULL);
 
+    /**
+     * Performs ray tests for a batch of rays on the physics world.
+     *
+     * The rays are tested as with rayTest, but split between the threads of the job system
+     * when Bullet is built with thread support (BT_THREADSAFE), since the broadphase of a
+     * single threaded build cannot be queried from several threads. The filter, if any, must
+     * therefore be safe to call from several threads at once.
+     *
+     * The tests do not allocate any memory; each result is written to the given array, with
+     * a NULL object for the rays that did not hit anything.
+     *
+     * @param rays The rays to test.
+     * @param distances How far along each ray to test for intersections.
+     * @param count The number of rays to test.
+     * @param results The array of count hit results to store the result of each test in.
+     * @param filter Optional filter pointer used to control which objects are tested.
+     *
+     * @return The number of rays that collided with a physics object.
+     * @script{ignore}
+     */
+    unsigned int rayTest(const Ray* rays, const float* distances, unsigned int count, PhysicsController::HitResult* results, PhysicsController::HitFilter* filter = NULL);
+
+    /**
+     * Performs sweep tests for a batch of collision objects on the physics world.
+     *
+     * The objects are swept as with sweepTest, and split between threads in the same way
+     * as the rays of a batch ray test (see rayTest).
+     *
+     * @param objects The collision objects to test.
+     * @param endPositions The end position of the sweep test of each object, in world space.
+     * @param count The number of sweep tests.
+     * @param results The array of count hit results to store the result of each test in.
+     * @param filter Optional filter pointer used to control which objects are tested.
+     *
+     * @return The number of objects that intersect other physics objects.
+     * @script{ignore}
+     */
+    unsigned int sweepTest(PhysicsCollisionObject* const* objects, const Vector3* endPositions, unsigned int count, PhysicsController::HitResult* results, PhysicsController::HitFilter* filter = NULL);
+
 private:
 
     /**
@@ -367,18 +626,32 @@ private:
     };
 
     // Internal constants for the collision status cache.
-    static const int DIRTY;
+    static const int FREE;
     static const int COLLISION;
     static const int REGISTERED;
     static const int REMOVE;
 
     // Represents the collision listeners and status for a given collision pair (used by the collision status cache).
+    // Entries are pooled, so their listener vectors keep their storage when they are reused.
     struct CollisionInfo
     {
-        CollisionInfo() : _status(0) { }
+        CollisionInfo() : _pair(NULL, NULL), _status(FREE), _generation(0), _next(-1) { }
 
+        PhysicsCollisionObject::CollisionPair _pair;
         std::vector<PhysicsCollisionObject::CollisionListener*> _listeners;
         int _status;
+        // The update in which the pair was last found to be in contact.
+        unsigned int _generation;
+        // The next entry in the same hash bucket, or in the free list.
+        int _next;
+    };
+
+    // A collision event found during an update, which is sent to the listeners once all collision tests are done.
+    struct CollisionEvent
+    {
+        int _info;
+        Vector3 _contactPointA;
+        Vector3 _contactPointB;
     };
 
     /**
@@ -416,6 +689,71 @@ private:
      */
     void update(float elapsedTime);
 
+    class TaskScheduler;
+
+    class CharacterAction;
+
+    class VehicleAction;
+
+    /**
+     * The regions of the simulation that a rigid body can be in.
+     */
+    enum SimulationRegion
+    {
+        REGION_ACTIVE,
+        REGION_REDUCED,
+        REGION_FROZEN
+    };
+
+    // A body of the reduced region that is stepped in the current tick, and its gravity outside of it.
+    struct ScaledBody
+    {
+        btRigidBody* body;
+        btVector3 gravity;
+    };
+
+    // Moves the rigid bodies between the simulation regions, from the positions of the anchors.
+    void updateRegions();
+
+    // Returns the simulation region that a rigid body is in.
+    SimulationRegion getRegion(PhysicsRigidBody* body) const;
+
+    // Moves a rigid body to a simulation region.
+    void setRegion(PhysicsRigidBody* body, SimulationRegion region);
+
+    // Steps the bodies of the reduced region whose turn it is, and disables the others, before each tick.
+    static void preTickCallback(btDynamicsWorld* world, btScalar timeStep);
+
+    // Restores the velocities and the gravity of the bodies that were stepped in the reduced region after each tick.
+    static void postTickCallback(btDynamicsWorld* world, btScalar timeStep);
+
+    // Advances the simulation in fixed steps and interpolates the transforms of the rigid bodies.
+    void stepFixed(float elapsedTime);
+
+    // Determines if the nodes of rigid bodies are placed by interpolation rather than by each step.
+    bool isInterpolating() const;
+
+    // Runs the ray tests of a batch for a range of the rays.
+    static void rayTestProc(void* cookie, unsigned int begin, unsigned int end);
+
+    // Runs the sweep tests of a batch for a range of the objects.
+    static void sweepTestProc(void* cookie, unsigned int begin, unsigned int end);
+
+    // Returns the index of the collision status cache entry of a pair, or -1 if there is none.
+    int findCollisionInfo(PhysicsCollisionObject* objectA, PhysicsCollisionObject* objectB) const;
+
+    // Returns the index of the collision status cache entry of a pair, adding an entry if there is none.
+    int getCollisionInfo(PhysicsCollisionObject* objectA, PhysicsCollisionObject* objectB);
+
+    // Returns an entry of the collision status cache to the pool.
+    void freeCollisionInfo(int index);
+
+    // Rebuilds the hash buckets of the collision status cache with the given number of buckets.
+    void rehashCollisionInfos(unsigned int bucketCount);
+
+    // Creates the multithreaded world, or returns false if Bullet was built without thread support.
+    bool initializeMultithreaded();
+
     // Adds the given collision listener for the two given collision objects.
     void addCollisionListener(PhysicsCollisionObject::CollisionListener* listener, PhysicsCollisionObject* objectA, PhysicsCollisionObject* objectB);
 
@@ -453,6 +791,30 @@ private:
     // Destroys a collision shape created through PhysicsController
     void destroyShape(PhysicsCollisionShape* shape);
 
+    // Returns the cached shape for a key with an added reference, or NULL if there is none.
+    PhysicsCollisionShape* findShape(const PhysicsCollisionShape::CacheKey& key);
+
+    // Adds a new shape to the shape cache.
+    void addShape(PhysicsCollisionShape* shape, const PhysicsCollisionShape::CacheKey& key, size_t memoryUsage);
+
+    // Returns the path of the BVH cache file for the mesh with the given URL.
+    static std::string getMeshBvhPath(const char* url);
+
+    // Loads a BVH from the BVH cache into a new buffer, or returns NULL if the cached BVH is missing or does not match the mesh data.
+    static btOptimizedBvh* loadMeshBvh(const char* path, const Vector3& scale, unsigned int vertexCount, unsigned int triangleCount, void** data);
+
+    // Writes a BVH to the BVH cache.
+    static void saveMeshBvh(const char* path, const Vector3& scale, unsigned int vertexCount, unsigned int triangleCount, const btOptimizedBvh* bvh);
+
+    // Returns the path of the hull cache file for the mesh with the given URL.
+    static std::string getMeshHullPath(const char* url);
+
+    // Loads the vertices of a hull from the hull cache, or returns false if the cached hull is missing or does not match the mesh data.
+    static bool loadMeshHull(const char* path, const Vector3& scale, unsigned int vertexCount, std::vector<btScalar>* vertices);
+
+    // Writes the vertices of a hull to the hull cache.
+    static void saveMeshHull(const char* path, const Vector3& scale, unsigned int vertexCount, const std::vector<btScalar>& vertices);
+
     // Legacy method for grayscale heightmaps: r + g + b, normalized.
     static float normalizedHeightGrayscale(float r, float g, float b);
 
@@ -547,16 +909,46 @@ private:
     btDefaultCollisionConfiguration* _collisionConfiguration;
     btCollisionDispatcher* _dispatcher;
     btBroadphaseInterface* _overlappingPairCache;
-    btSequentialImpulseConstraintSolver* _solver;
+    btConstraintSolver* _solver;
+    btConstraintSolver* _solverPool;
     btDynamicsWorld* _world;
     btGhostPairCallback* _ghostPairCallback;
-    std::vector<PhysicsCollisionShape*> _shapes;
+    std::unordered_map<PhysicsCollisionShape::CacheKey, PhysicsCollisionShape*, PhysicsCollisionShape::CacheKeyHash> _shapes;
     DebugDrawer* _debugDrawer;
     Listener::EventType _status;
     std::vector<Listener*>* _listeners;
     Vector3 _gravity;
-    std::map<PhysicsCollisionObject::CollisionPair, CollisionInfo> _collisionStatus;
+    std::vector<CollisionInfo> _collisionInfos;
+    std::vector<int> _collisionBuckets;
+    std::vector<int> _removedCollisionInfos;
+    std::vector<CollisionEvent> _collisionEvents;
+    int _freeCollisionInfo;
+    unsigned int _collisionInfoCount;
+    unsigned int _collisionGeneration;
     CollisionCallback* _collisionCallback;
+    unsigned int _shapeReuseCount;
+    bool _meshBvhCache;
+    float _fixedTimeStep;
+    unsigned int _maxSubSteps;
+    bool _interpolation;
+    float _stepTime;
+    bool _multithreaded;
+    TaskScheduler* _taskScheduler;
+    std::vector<PhysicsCharacter*> _characters;
+    CharacterAction* _characterAction;
+    std::vector<PhysicsVehicle*> _vehicles;
+    VehicleAction* _vehicleAction;
+    float _regionActiveRadius;
+    float _regionReducedRadius;
+    unsigned int _regionReducedInterval;
+    std::vector<Node*> _regionAnchors;
+    std::vector<btVector3> _regionAnchorPositions;
+    std::vector<PhysicsRigidBody*> _reducedBodies;
+    std::vector<PhysicsRigidBody*> _frozenBodies;
+    std::vector<ScaledBody> _scaledBodies;
+    unsigned int _regionBodyCount;
+    unsigned int _regionTick;
+    unsigned int _regionPhase;
 };
 
 }
@@ -34,6 +34,7 @@ class PhysicsRigidBody : public PhysicsCollisionObject, public Transform::Listen
     friend class PhysicsHingeConstraint;
     friend class PhysicsSocketConstraint;
     friend class PhysicsSpringConstraint;
+    friend class SceneSnapshot;
 
 public:
 
@@ -442,6 +443,10 @@ private:
     float _mass;
     std::vector<PhysicsConstraint*>* _constraints;
     bool _inDestructor;
+    unsigned char _simulationRegion;
+    bool _regionRemoved;
+    int _regionActivationState;
+    unsigned int _regionPhase;
 
 };
 
@@ -8,6 +8,9 @@
 #define AIR_DENSITY (1.2f)
 #define KPH_TO_MPS (1.0f / 3.6f)
 
+// The number of vehicles of a batch that a thread casts the wheel rays of at a time.
+#define VEHICLE_BATCH_SIZE 2
+
 namespace gameplay
 {
 
@@ -49,11 +52,62 @@ class VehicleNotMeRaycaster : public btVehicleRaycaster
 public:
 
     VehicleNotMeRaycaster(btDynamicsWorld* world, btCollisionObject* me)
-        : _dynamicsWorld(world), _me(me)
+        : _dynamicsWorld(world), _me(me), _nextRay(0)
     {
     }
 
     void* castRay(const btVector3& from, const btVector3& to, btVehicleRaycasterResult& result)
+    {
+        // Rays that were cast ahead of the update of the vehicle return their stored results, in the
+        // order that they were added. Any other ray is cast now.
+        if (_nextRay < _rays.size() && _rays[_nextRay].from == from && _rays[_nextRay].to == to)
+        {
+            const WheelRay& ray = _rays[_nextRay++];
+            if (ray.body)
+                result = ray.result;
+            return ray.body;
+        }
+        return castRayNow(from, to, result);
+    }
+
+    // Removes the rays cast ahead of the update of the vehicle.
+    void clearRays()
+    {
+        _rays.clear();
+        _nextRay = 0;
+    }
+
+    // Adds a ray to cast ahead of the update of the vehicle.
+    void addRay(const btVector3& from, const btVector3& to)
+    {
+        WheelRay ray;
+        ray.from = from;
+        ray.to = to;
+        ray.body = NULL;
+        _rays.push_back(ray);
+    }
+
+    // Casts the rays added since the last update of the vehicle.
+    void castRays()
+    {
+        for (size_t i = 0, count = _rays.size(); i < count; ++i)
+        {
+            WheelRay& ray = _rays[i];
+            ray.body = castRayNow(ray.from, ray.to, ray.result);
+        }
+    }
+
+private:
+
+    struct WheelRay
+    {
+        btVector3 from;
+        btVector3 to;
+        btVehicleRaycasterResult result;
+        void* body;
+    };
+
+    void* castRayNow(const btVector3& from, const btVector3& to, btVehicleRaycasterResult& result)
     {
         ClosestNotMeRayResultCallback rayCallback(from, to, _me);
         _dynamicsWorld->rayTest(from, to, rayCallback);
@@ -73,10 +127,16 @@ public:
         return 0;
     }
 
-private:
-
     btDynamicsWorld* _dynamicsWorld;
     btCollisionObject* _me;
+    std::vector<WheelRay> _rays;
+    size_t _nextRay;
+};
+
+// The vehicles that cast their wheel rays together.
+struct VehicleBatch
+{
+    PhysicsVehicle* const* vehicles;
 };
 
 PhysicsVehicle::PhysicsVehicle(Node* node, const PhysicsCollisionShape::Definition& shape, const PhysicsRigidBody::Parameters& parameters)
@@ -186,15 +246,24 @@ void PhysicsVehicle::initialize()
     _vehicleRaycaster = new VehicleNotMeRaycaster(dynamicsWorld, body);
     _vehicle = bullet_new<btRaycastVehicle>(_vehicleTuning, body, _vehicleRaycaster);
     body->setActivationState(DISABLE_DEACTIVATION);
-    dynamicsWorld->addVehicle(_vehicle);
     _vehicle->setCoordinateSystem(0, 1, 2);
+
+    // Register ourselves with the physics controller so we are updated during physics ticks.
+    Game::getInstance()->getPhysicsController()->_vehicles.push_back(this);
 }
 
 PhysicsVehicle::~PhysicsVehicle()
 {
+    // Unregister ourselves from the physics controller.
+    GP_ASSERT(Game::getInstance()->getPhysicsController());
+    std::vector<PhysicsVehicle*>& vehicles = Game::getInstance()->getPhysicsController()->_vehicles;
+    std::vector<PhysicsVehicle*>::iterator itr = std::find(vehicles.begin(), vehicles.end(), this);
+    if (itr != vehicles.end())
+        vehicles.erase(itr);
+
     // Note that the destructor for PhysicsRigidBody calls removeCollisionObject and so
     // that is where the rigid body gets removed from the dynamics world. The vehicle
-    // itself is just an action interface in the dynamics world.
+    // itself is updated by the vehicle action of the physics controller.
     SAFE_DELETE(_vehicle);
     SAFE_DELETE(_vehicleRaycaster);
     SAFE_DELETE(_rigidBody);
@@ -354,6 +423,69 @@ void PhysicsVehicle::applyDownforce()
     _rigidBody->applyForce(Vector3(0, -_downforce * q, 0));
 }
 
+void PhysicsVehicle::updateVehicles(PhysicsVehicle* const* vehicles, unsigned int count, btCollisionWorld* collisionWorld, btScalar deltaTimeStep)
+{
+    if (count == 0)
+        return;
+
+    // The rays depend only on the transforms of the chassis, which do not change while the
+    // vehicles update, so all of them can be cast before the first vehicle updates.
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        if (vehicles[i]->_rigidBody->isEnabled())
+            vehicles[i]->prepareWheelRays();
+    }
+
+    VehicleBatch batch;
+    batch.vehicles = vehicles;
+#if BT_THREADSAFE
+    Game::getInstance()->getJobSystem()->parallelFor(count, VEHICLE_BATCH_SIZE, &PhysicsVehicle::castWheelRays, &batch);
+#else
+    castWheelRays(&batch, 0, count);
+#endif
+
+    // The suspension and friction of a vehicle apply impulses to the bodies under its wheels,
+    // which other vehicles can be touching, so the vehicles update one after another.
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        PhysicsVehicle* vehicle = vehicles[i];
+        if (vehicle->_rigidBody->isEnabled())
+        {
+            vehicle->_vehicle->updateAction(collisionWorld, deltaTimeStep);
+            static_cast<VehicleNotMeRaycaster*>(vehicle->_vehicleRaycaster)->clearRays();
+        }
+    }
+}
+
+void PhysicsVehicle::castWheelRays(void* cookie, unsigned int begin, unsigned int end)
+{
+    VehicleBatch* batch = (VehicleBatch*)cookie;
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        PhysicsVehicle* vehicle = batch->vehicles[i];
+        if (vehicle->_rigidBody->isEnabled())
+            static_cast<VehicleNotMeRaycaster*>(vehicle->_vehicleRaycaster)->castRays();
+    }
+}
+
+void PhysicsVehicle::prepareWheelRays()
+{
+    GP_ASSERT(_vehicle);
+    GP_ASSERT(_vehicleRaycaster);
+
+    // Each ray is computed the same way as btRaycastVehicle::rayCast computes it, so that the
+    // vehicle finds the stored result of each of its rays when it updates.
+    VehicleNotMeRaycaster* raycaster = static_cast<VehicleNotMeRaycaster*>(_vehicleRaycaster);
+    raycaster->clearRays();
+    for (int i = 0; i < _vehicle->getNumWheels(); ++i)
+    {
+        btWheelInfo& wheel = _vehicle->getWheelInfo(i);
+        _vehicle->updateWheelTransformsWS(wheel, false);
+        btVector3 rayVector = wheel.m_raycastInfo.m_wheelDirectionWS * (wheel.getSuspensionRestLength() + wheel.m_wheelsRadius);
+        raycaster->addRay(wheel.m_raycastInfo.m_hardPointWS, wheel.m_raycastInfo.m_hardPointWS + rayVector);
+    }
+}
+
 float PhysicsVehicle::getSteeringGain() const
 {
     return _steeringGain;
@@ -22,6 +22,7 @@ class PhysicsVehicle : public PhysicsCollisionObject
 {
     friend class Node;
     friend class PhysicsVehicleWheel;
+    friend class PhysicsController;
 
 public:
 
@@ -367,6 +368,27 @@ private:
      */
     void applyDownforce();
 
+    /**
+     * Updates the vehicles of the physics world during a physics tick.
+     *
+     * The rays of the wheels of all the vehicles are cast first, split between the threads of the
+     * job system when Bullet is built with BT_THREADSAFE. The vehicles then update their suspension
+     * and friction one after another, from the results of the rays.
+     *
+     * @param vehicles The vehicles to update.
+     * @param count The number of vehicles.
+     * @param collisionWorld The physics world.
+     * @param deltaTimeStep The time of the tick, in seconds.
+     */
+    static void updateVehicles(PhysicsVehicle* const* vehicles, unsigned int count, btCollisionWorld* collisionWorld, btScalar deltaTimeStep);
+
+    static void castWheelRays(void* cookie, unsigned int begin, unsigned int end);
+
+    /**
+     * Computes the rays that the wheels cast in the next update of the vehicle.
+     */
+    void prepareWheelRays();
+
     float _steeringGain;
     float _brakingForce;
     float _drivingForce;
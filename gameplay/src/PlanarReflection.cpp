@@ -0,0 +1,398 @@
+#include "Base.h"
+#include "PlanarReflection.h"
+#include "Scene.h"
+#include "Game.h"
+#include "FrameBuffer.h"
+#include "Terrain.h"
+#include "InstancedModel.h"
+#include "StaticBatch.h"
+#include "Technique.h"
+#include "Pass.h"
+#include "RenderCommandList.h"
+
+namespace gameplay
+{
+
+/**
+ * Returns the rotation of a camera that looks along the specified direction.
+ */
+static void getLookRotation(const Vector3& forward, const Vector3& up, Quaternion* rotation)
+{
+    Matrix view;
+    Matrix::createLookAt(Vector3::zero(), forward, up, &view);
+    view.transpose();
+    Quaternion::createFromRotationMatrix(view, rotation);
+}
+
+/**
+ * Reflects a direction in a plane.
+ */
+static Vector3 reflectVector(const Plane& plane, const Vector3& vector)
+{
+    const Vector3& normal = plane.getNormal();
+    return vector - normal * (2.0f * vector.dot(normal));
+}
+
+/**
+ * Mixes the identity and the bounds of a reflected node into a hash of the reflection.
+ */
+static unsigned int hashNode(unsigned int hash, Node* node)
+{
+    const BoundingSphere& sphere = node->getBoundingSphere();
+    const float values[] = { sphere.center.x, sphere.center.y, sphere.center.z, sphere.radius };
+    size_t address = (size_t)node;
+
+    // FNV-1a over the address of the node and the bits of its bounds.
+    const unsigned char* bytes = (const unsigned char*)&address;
+    for (size_t i = 0; i < sizeof(address); ++i)
+        hash = (hash ^ bytes[i]) * 16777619u;
+    bytes = (const unsigned char*)values;
+    for (size_t i = 0; i < sizeof(values); ++i)
+        hash = (hash ^ bytes[i]) * 16777619u;
+    return hash;
+}
+
+PlanarReflection::PlanarReflection(unsigned int width, unsigned int height)
+    : _width(std::max(width, 1u)), _height(std::max(height, 1u)), _plane(Vector3::unitY(), 0.0f), _updateInterval(1), _updates(0),
+      _static(false), _distance(0.0f), _minimumSize(2.0f), _lodBias(2.0f), _clearColor(0.0f, 0.0f, 0.0f, 1.0f), _valid(false),
+      _hash(0), _reflectedNodes(0), _renders(0), _frameBuffer(NULL), _sampler(NULL), _camera(NULL), _cameraNode(NULL)
+{
+}
+
+PlanarReflection::~PlanarReflection()
+{
+    SAFE_RELEASE(_sampler);
+    SAFE_RELEASE(_frameBuffer);
+    SAFE_RELEASE(_camera);
+    SAFE_RELEASE(_cameraNode);
+}
+
+void PlanarReflection::createTargets()
+{
+    if (_frameBuffer)
+        return;
+
+    _frameBuffer = FrameBuffer::create("PlanarReflection", _width, _height);
+    DepthStencilTarget* depthTarget = DepthStencilTarget::create("PlanarReflection", DepthStencilTarget::DEPTH, _width, _height);
+    _frameBuffer->setDepthStencilTarget(depthTarget);
+    SAFE_RELEASE(depthTarget);
+
+    _sampler = Texture::Sampler::create(_frameBuffer->getRenderTarget()->getTexture());
+    _sampler->setFilterMode(Texture::LINEAR, Texture::LINEAR);
+    _sampler->setWrapMode(Texture::CLAMP, Texture::CLAMP);
+
+    // The reflection is rendered from a camera that follows the reflection of the camera of the scene.
+    _camera = Camera::createPerspective(45.0f, 1.0f, 1.0f, 100.0f);
+    _cameraNode = Node::create("PlanarReflection");
+    _cameraNode->setCamera(_camera);
+}
+
+bool PlanarReflection::update(Scene* scene, Camera* camera)
+{
+    GP_ASSERT(scene);
+
+    if (!camera)
+        camera = scene->getActiveCamera();
+    if (!camera || !camera->getNode())
+    {
+        GP_WARN("Failed to update planar reflection; the scene has no active camera.");
+        return false;
+    }
+    if (RenderCommandList::getRecording())
+    {
+        GP_WARN("Failed to update planar reflection; it can not be rendered while a RenderCommandList is recording.");
+        return false;
+    }
+
+    // The previous reflection is kept until the update interval has passed.
+    if (_valid && ++_updates < _updateInterval)
+        return false;
+    _updates = 0;
+
+    createTargets();
+    Vector3 eye = _eye;
+    Quaternion rotation = _rotation;
+    Matrix projection = _projection;
+    updateCamera(camera);
+    bool moved = !_valid || eye != _eye || memcmp(&rotation, &_rotation, sizeof(Quaternion)) != 0 ||
+        memcmp(projection.m, _projection.m, sizeof(projection.m)) != 0;
+
+    // Gather the reflected nodes with the frustum of the reflected camera, before its near plane
+    // is moved to the reflecting plane.
+    _nodes.clear();
+    scene->queryVisible(_camera->getFrustum(), _nodes);
+    unsigned int hash = 2166136261u;
+    size_t reflected = 0;
+    for (size_t i = 0, count = _nodes.size(); i < count; ++i)
+    {
+        Node* node = _nodes[i];
+        if (isReflected(node))
+        {
+            _nodes[reflected++] = node;
+            hash = hashNode(hash, node);
+        }
+    }
+    _nodes.resize(reflected);
+
+    if (_static && !moved && hash == _hash)
+        return false;
+    _hash = hash;
+
+    render(scene);
+    _valid = true;
+    ++_renders;
+    return true;
+}
+
+void PlanarReflection::updateCamera(Camera* camera)
+{
+    // Reflect from the side of the plane that the camera is on.
+    Node* node = camera->getNode();
+    Vector3 eye = node->getTranslationWorld();
+    Plane plane = _plane;
+    if (plane.distance(eye) < 0.0f)
+        plane.set(-plane.getNormal(), -plane.getDistance());
+
+    Vector3 forward = reflectVector(plane, node->getForwardVectorWorld());
+    Vector3 up = reflectVector(plane, node->getUpVectorWorld());
+    forward.normalize();
+    up.normalize();
+    _eye = eye - plane.getNormal() * (2.0f * plane.distance(eye));
+    getLookRotation(forward, up, &_rotation);
+
+    float farPlane = camera->getFarPlane();
+    if (_distance > 0.0f)
+        farPlane = std::min(_distance, farPlane);
+    farPlane = std::max(farPlane, camera->getNearPlane() * 2.0f);
+    if (camera->getCameraType() == Camera::PERSPECTIVE)
+        Matrix::createPerspective(camera->getFieldOfView(), camera->getAspectRatio(), camera->getNearPlane(), farPlane, &_projection);
+    else
+        Matrix::createOrthographic(camera->getZoomX(), camera->getZoomY(), camera->getNearPlane(), farPlane, &_projection);
+
+    _cameraNode->set(Vector3::one(), _rotation, _eye);
+    _camera->setProjectionMatrix(_projection);
+}
+
+bool PlanarReflection::isReflected(Node* node) const
+{
+    if (!node->isEnabledInHierarchy() || node->hasTag("transparent"))
+        return false;
+    const char* tag = node->getTag("reflection");
+    if (tag && strcmp(tag, "none") == 0)
+        return false;
+
+    // Nodes that are entirely behind the plane are not reflected.
+    const BoundingSphere& sphere = node->getBoundingSphere();
+    float side = _plane.distance(_eye) < 0.0f ? 1.0f : -1.0f;
+    if (side * _plane.distance(sphere.center) < -sphere.radius)
+        return false;
+
+    Drawable* drawable = node->getDrawable();
+    Model* model = dynamic_cast<Model*>(drawable);
+    if (model == NULL)
+        return dynamic_cast<Terrain*>(drawable) || dynamic_cast<InstancedModel*>(drawable) || dynamic_cast<StaticBatch*>(drawable);
+
+    // Models whose first pass blends are transparent.
+    Mesh* mesh = model->getMesh();
+    GP_ASSERT(mesh);
+    Material* material = model->getDrawMaterial(mesh->getPartCount() == 0 ? -1 : 0);
+    if (material == NULL)
+        return false;
+    Technique* technique = material->getTechnique();
+    GP_ASSERT(technique);
+    if (technique->getPassCount() == 0 || technique->getPassByIndex(0)->isBlendEnabled())
+        return false;
+
+    // Models that would cover only a few texels are not reflected. The vertical scale of the
+    // projection is 1 / tan(fov / 2) for a perspective camera and 2 / height for an orthographic one.
+    float size = sphere.radius * _height * _projection.m[5];
+    if (_projection.m[15] == 0.0f)
+    {
+        float distance = sphere.center.distance(_eye);
+        if (distance <= sphere.radius)
+            return true;
+        size /= distance;
+    }
+    return size >= _minimumSize;
+}
+
+void PlanarReflection::render(Scene* scene)
+{
+    // Move the near plane of the projection to the reflecting plane (an oblique near plane), so
+    // that what is behind the plane is clipped. The plane is turned into the view space of the
+    // reflected camera, where the reflected side must be in front of it.
+    const Matrix& view = _camera->getViewMatrix();
+    Plane plane = _plane;
+    if (plane.distance(_eye) > 0.0f)
+        plane.set(-plane.getNormal(), -plane.getDistance());
+    Vector3 normal;
+    Vector3 point;
+    view.transformVector(plane.getNormal(), &normal);
+    view.transformPoint(-plane.getNormal() * plane.getDistance(), &point);
+    normal.normalize();
+    Vector4 clipPlane(normal.x, normal.y, normal.z, -normal.dot(point));
+
+    Matrix projection = _projection;
+    Matrix inverse;
+    if (projection.invert(&inverse))
+    {
+        Vector4 corner;
+        inverse.transformVector(Vector4(clipPlane.x > 0.0f ? 1.0f : (clipPlane.x < 0.0f ? -1.0f : 0.0f),
+                                        clipPlane.y > 0.0f ? 1.0f : (clipPlane.y < 0.0f ? -1.0f : 0.0f), 1.0f, 1.0f), &corner);
+        float dot = clipPlane.dot(corner);
+        if (dot != 0.0f)
+        {
+            Vector4 c = clipPlane * (2.0f / dot);
+            projection.m[2] = c.x - projection.m[3];
+            projection.m[6] = c.y - projection.m[7];
+            projection.m[10] = c.z - projection.m[11];
+            projection.m[14] = c.w - projection.m[15];
+        }
+    }
+    _camera->setProjectionMatrix(projection);
+    _viewProjection = _camera->getViewProjectionMatrix();
+
+    // Render the reflection with the reflected camera as the active camera of the scene, so that
+    // the drawables are transformed into its view.
+    Game* game = Game::getInstance();
+    Rectangle viewport = game->getViewport();
+    FrameBuffer* previousFrameBuffer = _frameBuffer->bind();
+    Camera* activeCamera = scene->_activeCamera;
+    scene->_activeCamera = _camera;
+    game->setViewport(Rectangle((float)_width, (float)_height));
+    game->clear(Game::CLEAR_COLOR_DEPTH, _clearColor, 1.0f, 0);
+
+    // The models select their levels of detail with the LOD bias while they are drawn.
+    _queue.clear();
+    _queue.setCamera(_camera);
+    _lodThresholds.clear();
+    for (size_t i = 0, count = _nodes.size(); i < count; ++i)
+    {
+        Node* node = _nodes[i];
+        Model* model = dynamic_cast<Model*>(node->getDrawable());
+        if (model)
+        {
+            _lodThresholds.push_back(std::make_pair(model, model->getLodThreshold()));
+            model->setLodThreshold(model->getLodThreshold() * _lodBias);
+        }
+        _queue.add(node, node->hasTag("layer") ? (unsigned int)atoi(node->getTag("layer")) : 0);
+    }
+    _queue.sort();
+    _queue.draw();
+    for (size_t i = 0, count = _lodThresholds.size(); i < count; ++i)
+    {
+        _lodThresholds[i].first->setLodThreshold(_lodThresholds[i].second);
+    }
+    _reflectedNodes = (unsigned int)_nodes.size();
+
+    scene->_activeCamera = activeCamera;
+    previousFrameBuffer->bind();
+    game->setViewport(viewport);
+}
+
+void PlanarReflection::bind(RenderState* renderState)
+{
+    GP_ASSERT(renderState);
+
+    createTargets();
+    renderState->getParameter("u_reflectionTexture")->setValue(_sampler);
+    renderState->getParameter("u_reflectionViewProjectionMatrix")->bindValue(this, &PlanarReflection::getViewProjectionMatrix);
+}
+
+void PlanarReflection::invalidate()
+{
+    _valid = false;
+}
+
+void PlanarReflection::setPlane(const Plane& plane)
+{
+    _plane = plane;
+    _valid = false;
+}
+
+const Plane& PlanarReflection::getPlane() const
+{
+    return _plane;
+}
+
+void PlanarReflection::setUpdateInterval(unsigned int interval)
+{
+    _updateInterval = std::max(interval, 1u);
+}
+
+unsigned int PlanarReflection::getUpdateInterval() const
+{
+    return _updateInterval;
+}
+
+void PlanarReflection::setStatic(bool isStatic)
+{
+    _static = isStatic;
+}
+
+bool PlanarReflection::isStatic() const
+{
+    return _static;
+}
+
+void PlanarReflection::setDistance(float distance)
+{
+    _distance = distance > 0.0f ? distance : 0.0f;
+}
+
+float PlanarReflection::getDistance() const
+{
+    return _distance;
+}
+
+void PlanarReflection::setMinimumSize(float texels)
+{
+    _minimumSize = texels > 0.0f ? texels : 0.0f;
+}
+
+float PlanarReflection::getMinimumSize() const
+{
+    return _minimumSize;
+}
+
+void PlanarReflection::setLodBias(float bias)
+{
+    _lodBias = bias > 0.0f ? bias : 0.0f;
+}
+
+float PlanarReflection::getLodBias() const
+{
+    return _lodBias;
+}
+
+void PlanarReflection::setClearColor(const Vector4& color)
+{
+    _clearColor = color;
+}
+
+const Vector4& PlanarReflection::getClearColor() const
+{
+    return _clearColor;
+}
+
+Texture::Sampler* PlanarReflection::getSampler() const
+{
+    return _sampler;
+}
+
+const Matrix& PlanarReflection::getViewProjectionMatrix() const
+{
+    return _viewProjection;
+}
+
+unsigned int PlanarReflection::getReflectedNodeCount() const
+{
+    return _reflectedNodes;
+}
+
+unsigned int PlanarReflection::getRenderCount() const
+{
+    return _renders;
+}
+
+}
@@ -0,0 +1,285 @@
+#ifndef PLANARREFLECTION_H_
+#define PLANARREFLECTION_H_
+
+#include "Texture.h"
+#include "Matrix.h"
+#include "Plane.h"
+#include "Quaternion.h"
+#include "RenderQueue.h"
+
+namespace gameplay
+{
+
+class Scene;
+class Camera;
+class Node;
+class Model;
+class RenderState;
+class FrameBuffer;
+
+/**
+ * Defines the reflection of a scene in a plane, such as the surface of water, rendered into a texture.
+ *
+ * The scene is rendered from the reflection of the camera in the plane, with a projection whose
+ * near plane is the reflecting plane, so that the geometry behind the plane is clipped without a
+ * clip plane in the shaders. The reflection is usually seen distorted and at a glancing angle, so
+ * it is rendered at a lower cost than the view of the camera:
+ *
+ * - At the resolution of the reflection texture, which also selects less detailed levels of the
+ *   meshes, further lowered by a LOD bias (see setLodBias).
+ * - Every few frames (see setUpdateInterval), in which case the texture and its matrix are kept
+ *   together until the next update, so that the reflection stays in place.
+ * - Up to a distance from the camera (see setDistance).
+ * - Without the models that would be smaller than a few texels of the texture (see setMinimumSize).
+ * - Without the transparent drawables: the nodes tagged "transparent", the models whose first pass
+ *   blends, and the sprites, text, particles and forms.
+ *
+ * Nodes that are tagged "reflection" with a value of "none", such as the reflecting surface itself,
+ * are not reflected. A static reflection (see setStatic) is only rendered again when the reflected
+ * camera or the bounds of the reflected nodes change, which suits scenes whose reflected parts do
+ * not animate.
+ *
+ * The texture is sampled with projective texture coordinates, from the position of a point
+ * transformed by the view projection matrix of the reflection:
+ *
+ * @code
+ * _reflection = new PlanarReflection(512, 512);
+ * _reflection->setPlane(Plane(Vector3::unitY(), -waterHeight));
+ * _reflection->setUpdateInterval(2);
+ * _reflection->bind(waterMaterial);
+ * waterNode->setTag("reflection", "none");
+ * ...
+ * // Once per frame, before the scene is drawn.
+ * _reflection->update(_scene);
+ * @endcode
+ *
+ * @script{ignore}
+ */
+class PlanarReflection
+{
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param width The width of the reflection texture, in pixels.
+     * @param height The height of the reflection texture, in pixels.
+     */
+    PlanarReflection(unsigned int width = 512, unsigned int height = 512);
+
+    /**
+     * Destructor.
+     */
+    ~PlanarReflection();
+
+    /**
+     * Renders the reflection of the specified scene, as seen by a camera, if it is due.
+     *
+     * The reflection is rendered immediately, so this should not be called while a
+     * RenderCommandList is recording. The frame buffer and viewport are restored afterwards.
+     *
+     * @param scene The scene to reflect.
+     * @param camera The camera that the scene is drawn from, or NULL to use the active camera
+     *      of the scene.
+     *
+     * @return true if the reflection was rendered, false if the previous one was kept.
+     */
+    bool update(Scene* scene, Camera* camera = NULL);
+
+    /**
+     * Sets the uniforms of the reflection on a render state: the reflection texture
+     * (u_reflectionTexture) and the view projection matrix of the reflection
+     * (u_reflectionViewProjectionMatrix).
+     *
+     * @param renderState The material, technique or pass to set the uniforms on.
+     */
+    void bind(RenderState* renderState);
+
+    /**
+     * Makes the next update render the reflection, even if it is static or not due.
+     */
+    void invalidate();
+
+    /**
+     * Sets the reflecting plane, in world space.
+     *
+     * The camera should be on the side of the plane that its normal points to. The
+     * default is the plane y = 0, facing up.
+     *
+     * @param plane The reflecting plane.
+     */
+    void setPlane(const Plane& plane);
+
+    /**
+     * Returns the reflecting plane, in world space.
+     *
+     * @return The reflecting plane.
+     */
+    const Plane& getPlane() const;
+
+    /**
+     * Sets the number of updates between the renders of the reflection.
+     *
+     * @param interval The number of updates, 1 (the default) to render it at each update.
+     */
+    void setUpdateInterval(unsigned int interval);
+
+    /**
+     * Returns the number of updates between the renders of the reflection.
+     *
+     * @return The update interval.
+     */
+    unsigned int getUpdateInterval() const;
+
+    /**
+     * Sets whether the reflection is static, so that it is only rendered again when the reflected
+     * camera moves or the bounds of the reflected nodes change.
+     *
+     * @param isStatic true to keep the reflection while nothing changes, false (the default) to
+     *      render it at each update interval.
+     */
+    void setStatic(bool isStatic);
+
+    /**
+     * Determines whether the reflection is static.
+     *
+     * @return true if the reflection is static, false otherwise.
+     */
+    bool isStatic() const;
+
+    /**
+     * Sets the distance from the camera up to which the scene is reflected.
+     *
+     * @param distance The distance, which is clamped to the far plane of the camera, or 0 (the
+     *      default) for the far plane of the camera.
+     */
+    void setDistance(float distance);
+
+    /**
+     * Returns the distance from the camera up to which the scene is reflected.
+     *
+     * @return The reflection distance, or 0 for the far plane of the camera.
+     */
+    float getDistance() const;
+
+    /**
+     * Sets the size below which models are not reflected.
+     *
+     * @param texels The diameter of the models on the reflection texture, in texels (2 by default).
+     */
+    void setMinimumSize(float texels);
+
+    /**
+     * Returns the size below which models are not reflected, in texels of the reflection texture.
+     *
+     * @return The minimum size.
+     */
+    float getMinimumSize() const;
+
+    /**
+     * Sets the factor that the level of detail thresholds of the models (see Model::setLodThreshold)
+     * are multiplied by while the reflection is rendered.
+     *
+     * @param bias The LOD bias, greater than 1 to use less detailed levels (2 by default).
+     */
+    void setLodBias(float bias);
+
+    /**
+     * Returns the factor that the level of detail thresholds of the models are multiplied by.
+     *
+     * @return The LOD bias.
+     */
+    float getLodBias() const;
+
+    /**
+     * Sets the color that the reflection texture is cleared to, where nothing is reflected.
+     *
+     * @param color The clear color.
+     */
+    void setClearColor(const Vector4& color);
+
+    /**
+     * Returns the color that the reflection texture is cleared to.
+     *
+     * @return The clear color.
+     */
+    const Vector4& getClearColor() const;
+
+    /**
+     * Returns the sampler of the reflection texture.
+     *
+     * @return The reflection sampler.
+     */
+    Texture::Sampler* getSampler() const;
+
+    /**
+     * Returns the view projection matrix that the current reflection texture was rendered with.
+     *
+     * @return The view projection matrix of the reflection.
+     */
+    const Matrix& getViewProjectionMatrix() const;
+
+    /**
+     * Returns the number of nodes that were drawn into the reflection when it was last rendered.
+     *
+     * @return The number of reflected nodes.
+     */
+    unsigned int getReflectedNodeCount() const;
+
+    /**
+     * Returns the number of times that the reflection has been rendered.
+     *
+     * @return The number of renders.
+     */
+    unsigned int getRenderCount() const;
+
+private:
+
+    /**
+     * Hidden copy constructor.
+     */
+    PlanarReflection(const PlanarReflection& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    PlanarReflection& operator=(const PlanarReflection&);
+
+    void createTargets();
+
+    void updateCamera(Camera* camera);
+
+    bool isReflected(Node* node) const;
+
+    void render(Scene* scene);
+
+    unsigned int _width;
+    unsigned int _height;
+    Plane _plane;
+    unsigned int _updateInterval;
+    unsigned int _updates;
+    bool _static;
+    float _distance;
+    float _minimumSize;
+    float _lodBias;
+    Vector4 _clearColor;
+    bool _valid;
+    Vector3 _eye;
+    Quaternion _rotation;
+    Matrix _projection;
+    unsigned int _hash;
+    Matrix _viewProjection;
+    unsigned int _reflectedNodes;
+    unsigned int _renders;
+    std::vector<Node*> _nodes;
+    std::vector<std::pair<Model*, float> > _lodThresholds;
+    RenderQueue _queue;
+    FrameBuffer* _frameBuffer;
+    Texture::Sampler* _sampler;
+    Camera* _camera;
+    Node* _cameraNode;
+};
+
+}
+
+#endif
@@ -5,11 +5,100 @@
 #include "ScriptController.h"
 #include "Form.h"
 
+// Time in milliseconds before a paced frame is due that the platform stops sleeping and yields instead,
+// since a sleep can last longer than it was asked to.
+#define FRAME_PACING_SPIN_TIME 1.5
+
 namespace gameplay
 {
 
+static unsigned int __targetFrameRate = 0;
+static double __frameDueTime = 0.0;
+static double __frameTimeDebt = 0.0;
+static double __inputEventTime = -1.0;
+
+bool Platform::isHeadless()
+{
+#ifdef GP_HEADLESS
+    return true;
+#else
+    return false;
+#endif
+}
+
+unsigned int Platform::getTargetFrameRate()
+{
+    return __targetFrameRate;
+}
+
+void Platform::setTargetFrameRate(unsigned int frameRate)
+{
+    __targetFrameRate = frameRate;
+    __frameDueTime = 0.0;
+    __frameTimeDebt = 0.0;
+}
+
+double Platform::paceFrame()
+{
+    if (__targetFrameRate == 0)
+        return 0.0;
+
+    double interval = 1000.0 / __targetFrameRate;
+    double now = getAbsoluteTime();
+    __frameDueTime += interval;
+    if (now > __frameDueTime + interval || now < __frameDueTime - 2.0 * interval)
+    {
+        // The frame is too late to catch up with the intervals, so they start over from it.
+        __frameDueTime = now;
+        return now;
+    }
+
+    // With vsync, the swap waits for the vertical blank before the frame is due.
+    double wakeTime = isVsync() ? __frameDueTime - interval * 0.5 : __frameDueTime;
+
+    // Sleep through most of the wait and yield for the rest of it.
+    double remaining;
+    while ((remaining = wakeTime - getAbsoluteTime()) > 0.0)
+    {
+        if (remaining > FRAME_PACING_SPIN_TIME)
+            sleep((long)(remaining - FRAME_PACING_SPIN_TIME));
+        else
+            std::this_thread::yield();
+    }
+    return __frameDueTime;
+}
+
+double Platform::getPacedFrameTime(double elapsedTime)
+{
+    if (__targetFrameRate == 0)
+        return elapsedTime;
+
+    // Frames near the interval report it exactly and keep their difference for later.
+    double interval = 1000.0 / __targetFrameRate;
+    double time = elapsedTime + __frameTimeDebt;
+    if (fabs(elapsedTime - interval) < interval * 0.25 && fabs(time - interval) < interval * 0.5)
+    {
+        __frameTimeDebt = time - interval;
+        return interval;
+    }
+    __frameTimeDebt = 0.0;
+    return time;
+}
+
+double Platform::getInputEventTime()
+{
+    return __inputEventTime >= 0.0 ? __inputEventTime : getAbsoluteTime();
+}
+
+void Platform::setInputEventTime(double time)
+{
+    __inputEventTime = time;
+}
+
+// Each event invalidates the frame, so that games that render on demand draw what it changes.
 void Platform::touchEventInternal(Touch::TouchEvent evt, int x, int y, unsigned int contactIndex, bool actuallyMouse)
 {
+    Game::getInstance()->invalidate();
     if (actuallyMouse || !Form::touchEventInternal(evt, x, y, contactIndex))
     {
         Game::getInstance()->touchEventInternal(evt, x, y, contactIndex);
@@ -18,6 +107,7 @@ void Platform::touchEventInternal(Touch::TouchEvent evt, int x, int y, unsigned
 
 void Platform::keyEventInternal(Keyboard::KeyEvent evt, int key)
 {
+    Game::getInstance()->invalidate();
     if (!Form::keyEventInternal(evt, key))
     {
         Game::getInstance()->keyEventInternal(evt, key);
@@ -26,6 +116,7 @@ void Platform::keyEventInternal(Keyboard::KeyEvent evt, int key)
 
 bool Platform::mouseEventInternal(Mouse::MouseEvent evt, int x, int y, int wheelDelta)
 {
+    Game::getInstance()->invalidate();
     if (Form::mouseEventInternal(evt, x, y, wheelDelta))
         return true;
 
@@ -34,52 +125,62 @@ bool Platform::mouseEventInternal(Mouse::MouseEvent evt, int x, int y, int wheel
 
 void Platform::gestureSwipeEventInternal(int x, int y, int direction)
 {
+    Game::getInstance()->invalidate();
     Game::getInstance()->gestureSwipeEventInternal(x, y, direction);
 }
 
 void Platform::gesturePinchEventInternal(int x, int y, float scale)
 {
+    Game::getInstance()->invalidate();
     Game::getInstance()->gesturePinchEventInternal(x, y, scale);
 }
 
 void Platform::gestureTapEventInternal(int x, int y)
 {
+    Game::getInstance()->invalidate();
     Game::getInstance()->gestureTapEventInternal(x, y);
 }
 
 void Platform::gestureLongTapEventInternal(int x, int y, float duration)
 {
+    Game::getInstance()->invalidate();
     Game::getInstance()->gestureLongTapEventInternal(x, y, duration);
 }
 
 void Platform::gestureDragEventInternal(int x, int y)
 {
+    Game::getInstance()->invalidate();
     Game::getInstance()->gestureDragEventInternal(x, y);
 }
 
 void Platform::gestureDropEventInternal(int x, int y)
 {
+    Game::getInstance()->invalidate();
     Game::getInstance()->gestureDropEventInternal(x, y);
 }
 
 void Platform::resizeEventInternal(unsigned int width, unsigned int height)
 {
+    Game::getInstance()->invalidate();
     Game::getInstance()->resizeEventInternal(width, height);
     Form::resizeEventInternal(width, height);
 }
 
 void Platform::gamepadEventConnectedInternal(GamepadHandle handle,  unsigned int buttonCount, unsigned int joystickCount, unsigned int triggerCount, const char* name)
 {
+    Game::getInstance()->invalidate();
     Gamepad::add(handle, buttonCount, joystickCount, triggerCount, name);
 }
 
 void Platform::gamepadEventDisconnectedInternal(GamepadHandle handle)
 {
+    Game::getInstance()->invalidate();
     Gamepad::remove(handle);
 }
 
 void Platform::gamepadButtonPressedEventInternal(GamepadHandle handle, Gamepad::ButtonMapping mapping)
 {
+    Game::getInstance()->invalidate();
     Gamepad* gamepad = Gamepad::getGamepad(handle);
     unsigned int newButtons = gamepad->_buttons | (1 << mapping);
     gamepad->setButtons(newButtons);
@@ -88,6 +189,7 @@ void Platform::gamepadButtonPressedEventInternal(GamepadHandle handle, Gamepad::
 
 void Platform::gamepadButtonReleasedEventInternal(GamepadHandle handle, Gamepad::ButtonMapping mapping)
 {
+    Game::getInstance()->invalidate();
     Gamepad* gamepad = Gamepad::getGamepad(handle);
     unsigned int newButtons = gamepad->_buttons & ~(1 << mapping);
     gamepad->setButtons(newButtons);
@@ -96,6 +198,7 @@ void Platform::gamepadButtonReleasedEventInternal(GamepadHandle handle, Gamepad:
 
 void Platform::gamepadTriggerChangedEventInternal(GamepadHandle handle, unsigned int index, float value)
 {
+    Game::getInstance()->invalidate();
     Gamepad* gamepad = Gamepad::getGamepad(handle);
     gamepad->setTriggerValue(index, value);
     Form::gamepadTriggerEventInternal(gamepad, index);
@@ -103,6 +206,7 @@ void Platform::gamepadTriggerChangedEventInternal(GamepadHandle handle, unsigned
 
 void Platform::gamepadJoystickChangedEventInternal(GamepadHandle handle, unsigned int index, float x, float y)
 {
+    Game::getInstance()->invalidate();
     Gamepad* gamepad = Gamepad::getGamepad(handle);
     gamepad->setJoystickValue(index, x, y);
     Form::gamepadJoystickEventInternal(gamepad, index);
@@ -61,6 +61,18 @@ public:
      */
     static void swapBuffers();
 
+    /**
+     * Determines if the platform runs the game without a window or graphics context, as
+     * dedicated servers and automated tests do.
+     *
+     * Headless platforms are built with GP_HEADLESS defined. The game is then updated with
+     * a fixed time step and never rendered, and drawables that need the graphics context
+     * are not loaded from scenes.
+     *
+     * @return true if the platform has no graphics context, false otherwise.
+     */
+    static bool isHeadless();
+
 private:
 
     /**
@@ -106,6 +118,19 @@ private:
      */
     static void setAbsoluteTime(double time);
 
+    /**
+     * Gets the time at which the input event that is being delivered happened.
+     *
+     * The events of a frame are delivered in the order that they happened, before the frame is
+     * updated. Platforms that report the times of their input events convert them to the time of
+     * getAbsoluteTime, so that an event can be placed within the frame. Other platforms, and events
+     * that are not input events, get the time at which they are delivered.
+     *
+     * @return The time of the event (in milliseconds).
+     * @script{ignore}
+     */
+    static double getInputEventTime();
+
     /**
      * Gets whether vertical sync is enabled for the game display.
      *
@@ -120,6 +145,64 @@ private:
      */
     static void setVsync(bool enable);
 
+    /**
+     * Gets whether vertical sync is adaptive when it is enabled.
+     *
+     * @return true if adaptive vsync is enabled; false if not.
+     */
+    static bool isAdaptiveVsync();
+
+    /**
+     * Sets whether vertical sync is adaptive when it is enabled.
+     *
+     * With adaptive vsync, a frame that misses the vertical blank is presented at once, with
+     * tearing, instead of waiting for the next vertical blank. Displays that do not support it
+     * use regular vsync.
+     *
+     * @param enable true if adaptive vsync is enabled; false if not.
+     */
+    static void setAdaptiveVsync(bool enable);
+
+    /**
+     * Gets the frame rate that the frames are paced to.
+     *
+     * @return The frame rate in frames per second, or 0 if the frames are not paced.
+     */
+    static unsigned int getTargetFrameRate();
+
+    /**
+     * Sets the frame rate that the frames are paced to.
+     *
+     * @param frameRate The frame rate in frames per second, or 0 to present the frames as soon as they are drawn.
+     */
+    static void setTargetFrameRate(unsigned int frameRate);
+
+    /**
+     * Waits until the frame that has been drawn is due, when the frames are paced.
+     *
+     * This is called by the platforms before they swap the buffers of a frame. The frames are
+     * due at even intervals, so a frame that is drawn early waits for its interval. A frame that
+     * is more than an interval late starts the intervals over, rather than rushing the frames
+     * after it. When vsync is enabled, the wait ends half an interval before the frame is due,
+     * and the swap waits for the vertical blank.
+     *
+     * @return The time at which the frame is due (see getAbsoluteTime), or 0 if the frames are not paced.
+     */
+    static double paceFrame();
+
+    /**
+     * Returns the time that a frame should be updated by, for the elapsed time that was measured.
+     *
+     * While the frames are paced and are drawn close to the target frame rate, the elapsed times
+     * are reported as the exact interval of the frame rate, and the differences are added to a
+     * later frame, so that the reported times add up to the measured ones.
+     *
+     * @param elapsedTime The elapsed time since the last frame, in milliseconds.
+     *
+     * @return The elapsed time to update the frame by, in milliseconds.
+     */
+    static double getPacedFrameTime(double elapsedTime);
+
     /**
      * Sleeps synchronously for the given amount of time (in milliseconds).
      *
@@ -127,6 +210,12 @@ private:
      */
     static void sleep(long ms);
 
+    /**
+     * Wakes up the message loop of the platform if it is waiting for events, so that it runs
+     * the next frame. This can be called from any thread.
+     */
+    static void wakeUp();
+
     /**
      * Set if multi-sampling is enabled on the platform.
      *
@@ -295,6 +384,15 @@ private:
 
 public:
 
+    /**
+     * Internal method used only from static code in various platform implementation.
+     *
+     * Sets the time of the input events that are delivered next, or -1 to use the time at which they are delivered.
+     *
+     * @script{ignore}
+     */
+    static void setInputEventTime(double time);
+
     /**
      * Internal method used only from static code in various platform implementation.
      *
@@ -28,6 +28,9 @@ static struct timespec __timespec;
 static double __timeStart;
 static double __timeAbsolute;
 static bool __vsync = WINDOW_VSYNC;
+static bool __adaptiveVsync = false;
+// Sets the time at which the compositor presents the next frame (EGL_ANDROID_presentation_time).
+static EGLBoolean (*__eglPresentationTime)(EGLDisplay display, EGLSurface surface, long long time) = NULL;
 static ASensorManager* __sensorManager;
 static ASensorEventQueue* __sensorEventQueue;
 static ASensorEvent __sensorEvent;
@@ -51,6 +54,16 @@ PFNGLBINDVERTEXARRAYOESPROC glBindVertexArray = NULL;
 PFNGLDELETEVERTEXARRAYSOESPROC glDeleteVertexArrays = NULL;
 PFNGLGENVERTEXARRAYSOESPROC glGenVertexArrays = NULL;
 PFNGLISVERTEXARRAYOESPROC glIsVertexArray = NULL;
+PFNGLGETPROGRAMBINARYOESPROC glGetProgramBinary = NULL;
+PFNGLPROGRAMBINARYOESPROC glProgramBinary = NULL;
+PFNGLGENQUERIESEXTPROC glGenQueries = NULL;
+PFNGLDELETEQUERIESEXTPROC glDeleteQueries = NULL;
+PFNGLQUERYCOUNTEREXTPROC glQueryCounter = NULL;
+PFNGLGETQUERYOBJECTUI64VEXTPROC glGetQueryObjectui64v = NULL;
+PFNGLGETINTEGER64VEXTPROC glGetInteger64v = NULL;
+PFNGLRENDERBUFFERSTORAGEMULTISAMPLEEXTPROC glRenderbufferStorageMultisampleEXT = NULL;
+PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC glFramebufferTexture2DMultisampleEXT = NULL;
+PFNGLDISCARDFRAMEBUFFEREXTPROC glDiscardFramebufferEXT = NULL;
 
 #define GESTURE_TAP_DURATION_MAX			200
 #define GESTURE_LONG_TAP_DURATION_MIN   	GESTURE_TAP_DURATION_MAX
@@ -318,6 +331,10 @@ static bool initEGL()
     
     // Set vsync.
     eglSwapInterval(__eglDisplay, WINDOW_VSYNC ? 1 : 0);
+
+    // Paced frames tell the compositor when to present them, so that they are shown at even intervals.
+    if (strstr(eglQueryString(__eglDisplay, EGL_EXTENSIONS), "EGL_ANDROID_presentation_time"))
+        __eglPresentationTime = (EGLBoolean (*)(EGLDisplay, EGLSurface, long long))eglGetProcAddress("eglPresentationTimeANDROID");
     
     // Initialize OpenGL ES extensions.
     __glExtensions = (const char*)glGetString(GL_EXTENSIONS);
@@ -330,6 +347,32 @@ static bool initEGL()
         glGenVertexArrays = (PFNGLGENVERTEXARRAYSOESPROC)eglGetProcAddress("glGenVertexArraysOES");
         glIsVertexArray = (PFNGLISVERTEXARRAYOESPROC)eglGetProcAddress("glIsVertexArrayOES");
     }
+
+    if (strstr(__glExtensions, "GL_OES_get_program_binary"))
+    {
+        glGetProgramBinary = (PFNGLGETPROGRAMBINARYOESPROC)eglGetProcAddress("glGetProgramBinaryOES");
+        glProgramBinary = (PFNGLPROGRAMBINARYOESPROC)eglGetProcAddress("glProgramBinaryOES");
+    }
+
+    if (strstr(__glExtensions, "GL_EXT_disjoint_timer_query"))
+    {
+        glGenQueries = (PFNGLGENQUERIESEXTPROC)eglGetProcAddress("glGenQueriesEXT");
+        glDeleteQueries = (PFNGLDELETEQUERIESEXTPROC)eglGetProcAddress("glDeleteQueriesEXT");
+        glQueryCounter = (PFNGLQUERYCOUNTEREXTPROC)eglGetProcAddress("glQueryCounterEXT");
+        glGetQueryObjectui64v = (PFNGLGETQUERYOBJECTUI64VEXTPROC)eglGetProcAddress("glGetQueryObjectui64vEXT");
+        glGetInteger64v = (PFNGLGETINTEGER64VEXTPROC)eglGetProcAddress("glGetInteger64vEXT");
+    }
+
+    if (strstr(__glExtensions, "GL_EXT_multisampled_render_to_texture"))
+    {
+        glRenderbufferStorageMultisampleEXT = (PFNGLRENDERBUFFERSTORAGEMULTISAMPLEEXTPROC)eglGetProcAddress("glRenderbufferStorageMultisampleEXT");
+        glFramebufferTexture2DMultisampleEXT = (PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC)eglGetProcAddress("glFramebufferTexture2DMultisampleEXT");
+    }
+
+    if (strstr(__glExtensions, "GL_EXT_discard_framebuffer"))
+    {
+        glDiscardFramebufferEXT = (PFNGLDISCARDFRAMEBUFFEREXTPROC)eglGetProcAddress("glDiscardFramebufferEXT");
+    }
     
     return true;
     
@@ -1323,6 +1366,8 @@ int Platform::enterMessagePump()
     __timeStart = timespec2millis(&__timespec);
     __timeAbsolute = 0L;
     
+    // The time to wait for events when the game renders on demand and skipped the last frame.
+    int idleTimeout = 0;
     while (true)
     {
         // Read all pending events.
@@ -1330,8 +1375,10 @@ int Platform::enterMessagePump()
         int events;
         struct android_poll_source* source;
         
-        while ((ident=ALooper_pollAll(!__suspended ? 0 : -1, NULL, &events, (void**)&source)) >= 0) 
+        while ((ident=ALooper_pollAll(!__suspended ? idleTimeout : -1, NULL, &events, (void**)&source)) >= 0) 
         {
+            idleTimeout = 0;
+
             // Process this event.
             if (source != NULL)
                 source->process(__state, source);
@@ -1362,9 +1409,27 @@ int Platform::enterMessagePump()
         
         // Idle time (no events left to process) is spent rendering.
         // We skip rendering when the app is paused.
+        idleTimeout = 0;
         if (__initialized && !__suspended)
         {
             _game->frame();
+            if (!_game->isFrameRendered())
+            {
+                double idleTime = _game->getIdleTime();
+                idleTimeout = idleTime >= 0.0 ? (int)ceil(idleTime) : -1;
+                gameplay::displayKeyboard(__state, __displayKeyboard);
+                continue;
+            }
+
+            // Wait until the frame is due and have the compositor present it at that time.
+            double dueTime = Platform::paceFrame();
+            if (dueTime > 0.0 && __eglPresentationTime)
+            {
+                struct timespec now;
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                long long delay = (long long)((dueTime - Platform::getAbsoluteTime()) * 1000000.0);
+                __eglPresentationTime(__eglDisplay, __eglSurface, (long long)now.tv_sec * 1000000000LL + now.tv_nsec + std::max(0LL, delay));
+            }
 
             // Post the new frame to the display.
             // Note that there are a couple cases where eglSwapBuffers could fail
@@ -1451,6 +1516,17 @@ void Platform::setVsync(bool enable)
     __vsync = enable;
 }
 
+bool Platform::isAdaptiveVsync()
+{
+    return __adaptiveVsync;
+}
+
+void Platform::setAdaptiveVsync(bool enable)
+{
+    // EGL cannot swap late frames without waiting for the vertical blank, so this uses regular vsync.
+    __adaptiveVsync = enable;
+}
+
 
 void Platform::swapBuffers()
 {
@@ -1463,6 +1539,12 @@ void Platform::sleep(long ms)
     usleep(ms * 1000);
 }
 
+void Platform::wakeUp()
+{
+    if (__state && __state->looper)
+        ALooper_wake(__state->looper);
+}
+
 void Platform::setMultiSampling(bool enabled)
 {
     if (enabled == __multiSampling)
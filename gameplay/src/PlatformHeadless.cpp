@@ -0,0 +1,330 @@
+#ifdef GP_HEADLESS
+
+#include "Base.h"
+#include "Platform.h"
+#include "FileSystem.h"
+#include "Game.h"
+
+// The default rate that a headless game is updated at, in frames per second
+#define HEADLESS_FRAME_RATE 60
+
+using namespace std;
+
+int __headlessArgc = 0;
+char** __headlessArgv = 0;
+
+static unsigned int __displaySize[2] = { 1280, 720 };
+static unsigned int __frameRate = HEADLESS_FRAME_RATE;
+static unsigned int __frameLimit = 0;
+static bool __realTime = false;
+static double __timeAbsolute = 0.0;
+static std::chrono::steady_clock::time_point __timeStart;
+static bool __vsync = false;
+static bool __adaptiveVsync = false;
+static bool __multiSampling = false;
+static bool __multiTouch = false;
+static bool __mouseCaptured = false;
+static bool __cursorVisible = false;
+
+namespace gameplay
+{
+
+extern void print(const char* format, ...)
+{
+    GP_ASSERT(format);
+    va_list argptr;
+    va_start(argptr, format);
+    vfprintf(stderr, format, argptr);
+    va_end(argptr);
+}
+
+extern int strcmpnocase(const char* s1, const char* s2)
+{
+    while (*s1 && tolower((unsigned char)*s1) == tolower((unsigned char)*s2))
+    {
+        ++s1;
+        ++s2;
+    }
+    return tolower((unsigned char)*s1) - tolower((unsigned char)*s2);
+}
+
+Platform::Platform(Game* game) : _game(game)
+{
+}
+
+Platform::~Platform()
+{
+}
+
+Platform* Platform::create(Game* game)
+{
+    GP_ASSERT(game);
+
+    FileSystem::setResourcePath("./");
+    Platform* platform = new Platform(game);
+
+    if (game->getConfig())
+    {
+        // The display size is only used for the viewport that the game reports, so scripts and
+        // UI layout see the same size as on a windowed platform.
+        Properties* config = game->getConfig()->getNamespace("window", true);
+        if (config)
+        {
+            int width = config->getInt("width");
+            int height = config->getInt("height");
+            if (width > 0) __displaySize[0] = width;
+            if (height > 0) __displaySize[1] = height;
+        }
+
+        config = game->getConfig()->getNamespace("headless", true);
+        if (config)
+        {
+            int frameRate = config->getInt("frameRate");
+            if (frameRate > 0)
+                __frameRate = frameRate;
+            int frames = config->getInt("frames");
+            if (frames > 0)
+                __frameLimit = frames;
+            __realTime = config->getBool("realTime");
+        }
+    }
+
+    return platform;
+}
+
+int Platform::enterMessagePump()
+{
+    GP_ASSERT(_game);
+
+    __timeStart = std::chrono::steady_clock::now();
+    __timeAbsolute = 0.0;
+
+    // Every frame is updated by the same time step. Unless the frames are paced to real time,
+    // the clock only advances by that step, so a run gives the same results however fast the
+    // machine is.
+    double interval = 1000.0 / __frameRate;
+    _game->setFixedFrameTime((float)interval);
+    if (__realTime)
+        setTargetFrameRate(__frameRate);
+
+    _game->run();
+
+    unsigned int frameCount = 0;
+    while (_game->getState() != Game::UNINITIALIZED)
+    {
+        _game->frame();
+
+        // The game may have exited during the frame.
+        if (_game->getState() == Game::UNINITIALIZED)
+            break;
+
+        if (__frameLimit > 0 && ++frameCount >= __frameLimit)
+        {
+            _game->exit();
+            break;
+        }
+
+        if (__realTime)
+            paceFrame();
+        else
+            __timeAbsolute += interval;
+    }
+    return 0;
+}
+
+void Platform::signalShutdown()
+{
+}
+
+bool Platform::canExit()
+{
+    return true;
+}
+
+unsigned int Platform::getDisplayWidth()
+{
+    return __displaySize[0];
+}
+
+unsigned int Platform::getDisplayHeight()
+{
+    return __displaySize[1];
+}
+
+double Platform::getAbsoluteTime()
+{
+    if (__realTime)
+    {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - __timeStart;
+        __timeAbsolute = elapsed.count();
+    }
+    return __timeAbsolute;
+}
+
+void Platform::setAbsoluteTime(double time)
+{
+    __timeAbsolute = time;
+}
+
+bool Platform::isVsync()
+{
+    return __vsync;
+}
+
+void Platform::setVsync(bool enable)
+{
+    __vsync = enable;
+}
+
+bool Platform::isAdaptiveVsync()
+{
+    return __adaptiveVsync;
+}
+
+void Platform::setAdaptiveVsync(bool enable)
+{
+    __adaptiveVsync = enable;
+}
+
+void Platform::swapBuffers()
+{
+}
+
+void Platform::sleep(long ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void Platform::wakeUp()
+{
+    // The headless loop runs the frames without waiting for events.
+}
+
+void Platform::setMultiSampling(bool enabled)
+{
+    __multiSampling = enabled;
+}
+
+bool Platform::isMultiSampling()
+{
+    return __multiSampling;
+}
+
+void Platform::setMultiTouch(bool enabled)
+{
+    __multiTouch = enabled;
+}
+
+bool Platform::isMultiTouch()
+{
+    return __multiTouch;
+}
+
+bool Platform::hasAccelerometer()
+{
+    return false;
+}
+
+void Platform::getAccelerometerValues(float* pitch, float* roll)
+{
+    GP_ASSERT(pitch);
+    GP_ASSERT(roll);
+
+    *pitch = 0;
+    *roll = 0;
+}
+
+void Platform::getSensorValues(float* accelX, float* accelY, float* accelZ, float* gyroX, float* gyroY, float* gyroZ)
+{
+    if (accelX)
+        *accelX = 0;
+    if (accelY)
+        *accelY = 0;
+    if (accelZ)
+        *accelZ = 0;
+    if (gyroX)
+        *gyroX = 0;
+    if (gyroY)
+        *gyroY = 0;
+    if (gyroZ)
+        *gyroZ = 0;
+}
+
+void Platform::getArguments(int* argc, char*** argv)
+{
+    if (argc)
+        *argc = __headlessArgc;
+    if (argv)
+        *argv = __headlessArgv;
+}
+
+bool Platform::hasMouse()
+{
+    return false;
+}
+
+void Platform::setMouseCaptured(bool captured)
+{
+    __mouseCaptured = captured;
+}
+
+bool Platform::isMouseCaptured()
+{
+    return __mouseCaptured;
+}
+
+void Platform::setCursorVisible(bool visible)
+{
+    __cursorVisible = visible;
+}
+
+bool Platform::isCursorVisible()
+{
+    return __cursorVisible;
+}
+
+void Platform::displayKeyboard(bool display)
+{
+    // not supported
+}
+
+void Platform::shutdownInternal()
+{
+    Game::getInstance()->shutdown();
+}
+
+bool Platform::isGestureSupported(Gesture::GestureEvent evt)
+{
+    return false;
+}
+
+void Platform::registerGesture(Gesture::GestureEvent evt)
+{
+}
+
+void Platform::unregisterGesture(Gesture::GestureEvent evt)
+{
+}
+
+bool Platform::isGestureRegistered(Gesture::GestureEvent evt)
+{
+    return false;
+}
+
+void Platform::pollGamepadState(Gamepad* gamepad)
+{
+}
+
+bool Platform::launchURL(const char* url)
+{
+    return false;
+}
+
+std::string Platform::displayFileDialog(size_t mode, const char* title, const char* filterDescription, const char* filterExtensions, const char* initialDirectory)
+{
+    return "";
+}
+
+}
+
+#endif
@@ -1,4 +1,4 @@
-#ifdef __linux__
+#if defined(__linux__) && !defined(GP_HEADLESS)
 
 #include "Base.h"
 #include "Platform.h"
@@ -11,8 +11,9 @@
 #include <X11/Xlib.h>
 #include <X11/keysym.h>
 #include <sys/time.h>
+#include <sys/select.h>
 #include <GL/glxew.h>
-#include <poll.h>
+#include <sys/inotify.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -26,6 +27,10 @@
 #define TOUCH_COUNT_MAX     4
 #define MAX_GAMEPADS 4
 
+// The largest change (in milliseconds) of the offset between the clock of the X server and ours
+// that is taken as events being read late; larger changes mean that the clock wrapped or was reset.
+#define EVENT_CLOCK_RESYNC_TIME 1000.0
+
 using namespace std;
 
 int __argc = 0;
@@ -82,6 +87,8 @@ struct timespec __timespec;
 static double __timeStart;
 static double __timeAbsolute;
 static bool __vsync = WINDOW_VSYNC;
+static bool __adaptiveVsync = false;
+static bool __swapControlTear = false;
 static bool __mouseCaptured = false;
 static float __mouseCapturePointX = 0;
 static float __mouseCapturePointY = 0;
@@ -93,6 +100,20 @@ static int __windowSize[2];
 static GLXContext __context;
 static Atom __atomWmDeleteWindow;
 static list<ConnectedGamepadDevInfo> __connectedGamepads;
+static int __inputDeviceWatch = -1;
+static int __wakeUpPipe[2] = { -1, -1 };
+static bool __eventClockSynced = false;
+static double __eventClockOffset = 0.0;
+
+// Applies the swap interval for the vsync settings; adaptive vsync uses a negative interval.
+static void updateSwapInterval()
+{
+    int interval = __vsync ? (__adaptiveVsync && __swapControlTear ? -1 : 1) : 0;
+    if (glXSwapIntervalEXT)
+        glXSwapIntervalEXT(__display, __window, interval);
+    else if(glXSwapIntervalMESA)
+        glXSwapIntervalMESA(__vsync ? 1 : 0);
+}
 
 // Gets the gameplay::Keyboard::Key enumeration constant that corresponds to the given X11 key symbol.
 static gameplay::Keyboard::Key getKey(KeySym sym)
@@ -730,11 +751,10 @@ Platform* Platform::create(Game* game)
     glGetIntegerv(GL_MINOR_VERSION, versionGL + 1);
     printf("GL version: %d.%d\n", versionGL[0], versionGL[1]);
 
-    // TODO: Get this workings
-    if (glXSwapIntervalEXT)
-        glXSwapIntervalEXT(__display, __window, __vsync ? 1 : 0);
-    else if(glXSwapIntervalMESA)
-        glXSwapIntervalMESA(__vsync ? 1 : 0);
+    // Adaptive vsync needs the swap control tear extension.
+    const char* glxExtensions = glXQueryExtensionsString(__display, DefaultScreen(__display));
+    __swapControlTear = glxExtensions && strstr(glxExtensions, "GLX_EXT_swap_control_tear") != NULL;
+    updateSwapInterval();
 
     return platform;
 }
@@ -760,6 +780,21 @@ double timespec2millis(struct timespec *a)
     return (1000.0 * a->tv_sec) + (0.000001 * a->tv_nsec);
 }
 
+// Converts the time of an X event, in milliseconds of the clock of the X server, to the time of
+// getAbsoluteTime. An event cannot be read before it happens, so the smallest difference between
+// the time that an event is read and its own time is the offset between the clocks.
+static double getEventTime(Time time)
+{
+    double now = gameplay::Platform::getAbsoluteTime();
+    double offset = now - (double)time;
+    if (!__eventClockSynced || offset < __eventClockOffset || offset - __eventClockOffset > EVENT_CLOCK_RESYNC_TIME)
+    {
+        __eventClockOffset = offset;
+        __eventClockSynced = true;
+    }
+    return (double)time + __eventClockOffset;
+}
+
 void updateWindowSize()
 {
     GP_ASSERT(__display);
@@ -1112,9 +1147,63 @@ void enumGamepads()
     }
 }
 
+// Waits until an X event arrives, a joystick device is plugged in, the game is invalidated from
+// another thread, or the timeout passes, when the frames are rendered on demand and the last frame
+// was not rendered.
+static void waitForEvents(double timeout)
+{
+    XFlush(__display);
+    if (XPending(__display))
+        return;
+
+    fd_set fds;
+    FD_ZERO(&fds);
+    int displayFd = ConnectionNumber(__display);
+    int maxFd = displayFd;
+    FD_SET(displayFd, &fds);
+    if (__wakeUpPipe[0] >= 0)
+    {
+        FD_SET(__wakeUpPipe[0], &fds);
+        maxFd = std::max(maxFd, __wakeUpPipe[0]);
+    }
+    if (__inputDeviceWatch >= 0)
+    {
+        FD_SET(__inputDeviceWatch, &fds);
+        maxFd = std::max(maxFd, __inputDeviceWatch);
+    }
+
+    struct timeval tv;
+    if (timeout >= 0.0)
+    {
+        tv.tv_sec = (time_t)(timeout / 1000.0);
+        tv.tv_usec = (suseconds_t)((timeout - tv.tv_sec * 1000.0) * 1000.0);
+    }
+    select(maxFd + 1, &fds, NULL, NULL, timeout >= 0.0 ? &tv : NULL);
+
+    if (__wakeUpPipe[0] >= 0)
+    {
+        char buffer[64];
+        while (read(__wakeUpPipe[0], buffer, sizeof(buffer)) > 0)
+            ;
+    }
+}
+
 void gamepadHandlingLoop()
 {
-    enumGamepads();
+    // The joystick devices are enumerated again only when a device node in /dev/input is created or
+    // changes permissions, which udev does once the node can be opened.
+    if (__inputDeviceWatch < 0)
+    {
+        enumGamepads();
+        return;
+    }
+
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+    while (read(__inputDeviceWatch, buffer, sizeof(buffer)) > 0)
+        changed = true;
+    if (changed)
+        enumGamepads();
 }
 
 int Platform::enterMessagePump()
@@ -1135,22 +1224,55 @@ int Platform::enterMessagePump()
     // Run the game.
     _game->run();
 
-    // Setup select for message handling (to allow non-blocking)
-    int x11_fd = ConnectionNumber(__display);
-
-    pollfd xpolls[1];
-    xpolls[0].fd = x11_fd;
-    xpolls[0].events = POLLIN|POLLPRI;
+    // Watch for joysticks that are plugged in, rather than looking for them on every frame.
+    // Without inotify, the devices are looked for on every frame.
+    enumGamepads();
+    __inputDeviceWatch = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (__inputDeviceWatch >= 0 && inotify_add_watch(__inputDeviceWatch, "/dev/input", IN_CREATE | IN_ATTRIB) < 0)
+    {
+        close(__inputDeviceWatch);
+        __inputDeviceWatch = -1;
+    }
+    if (pipe(__wakeUpPipe) == 0)
+    {
+        fcntl(__wakeUpPipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(__wakeUpPipe[1], F_SETFL, O_NONBLOCK);
+    }
+    else
+    {
+        __wakeUpPipe[0] = __wakeUpPipe[1] = -1;
+    }
 
-    // Message loop.
+    // Message loop. The loop does not wait for events while frames are rendered; they are paced by
+    // the swap of the buffers, which waits for the vertical blank with vsync, and by the target frame
+    // rate. When the game renders on demand and skips a frame, the loop waits for the next event.
     while (true)
     {
-        poll( xpolls, 1, 16 );
         // handle all pending events in one block
         while (XPending(__display))
         {
             XNextEvent(__display, &evt);
 
+            // Input events are delivered with the time at which the X server received them.
+            Time eventTime = 0;
+            switch (evt.type)
+            {
+                case KeyPress:
+                case KeyRelease:
+                    eventTime = evt.xkey.time;
+                    break;
+                case ButtonPress:
+                case ButtonRelease:
+                    eventTime = evt.xbutton.time;
+                    break;
+                case MotionNotify:
+                    eventTime = evt.xmotion.time;
+                    break;
+                default:
+                    break;
+            }
+            gameplay::Platform::setInputEventTime(eventTime ? getEventTime(eventTime) : -1.0);
+
             switch (evt.type)
             {
                 case ClientMessage:
@@ -1166,6 +1288,7 @@ int Platform::enterMessagePump()
                 case Expose:
                     {
                         updateWindowSize();
+                        _game->invalidate();
                     }
                     break;
 
@@ -1320,6 +1443,7 @@ int Platform::enterMessagePump()
                     break;
             }
         }
+        gameplay::Platform::setInputEventTime(-1.0);
 
         gamepadHandlingLoop();
 
@@ -1330,11 +1454,29 @@ int Platform::enterMessagePump()
                 break;
 
             _game->frame();
+
+            if (!_game->isFrameRendered())
+            {
+                waitForEvents(_game->getIdleTime());
+                continue;
+            }
         }
 
+        Platform::paceFrame();
         glXSwapBuffers(__display, __window);
     }
 
+    if (__inputDeviceWatch >= 0)
+    {
+        close(__inputDeviceWatch);
+        __inputDeviceWatch = -1;
+    }
+    if (__wakeUpPipe[0] >= 0)
+    {
+        close(__wakeUpPipe[0]);
+        close(__wakeUpPipe[1]);
+        __wakeUpPipe[0] = __wakeUpPipe[1] = -1;
+    }
     cleanupX11();
 
     return 0;
@@ -1382,11 +1524,18 @@ bool Platform::isVsync()
 void Platform::setVsync(bool enable)
 {
     __vsync = enable;
+    updateSwapInterval();
+}
 
-    if (glXSwapIntervalEXT)
-        glXSwapIntervalEXT(__display, __window, __vsync ? 1 : 0);
-    else if(glXSwapIntervalMESA)
-        glXSwapIntervalMESA(__vsync ? 1 : 0);
+bool Platform::isAdaptiveVsync()
+{
+    return __adaptiveVsync;
+}
+
+void Platform::setAdaptiveVsync(bool enable)
+{
+    __adaptiveVsync = enable;
+    updateSwapInterval();
 }
 
 void Platform::swapBuffers()
@@ -1399,6 +1548,17 @@ void Platform::sleep(long ms)
     usleep(ms * 1000);
 }
 
+void Platform::wakeUp()
+{
+    if (__wakeUpPipe[1] >= 0)
+    {
+        // A write to a full pipe fails, but then the loop wakes up already.
+        char c = 0;
+        ssize_t result = write(__wakeUpPipe[1], &c, 1);
+        (void)result;
+    }
+}
+
 void Platform::setMultiSampling(bool enabled)
 {
     if (enabled == __multiSampling)
@@ -40,6 +40,7 @@ static int __height = 720;
 static double __timeStart;
 static double __timeAbsolute;
 static bool __vsync = WINDOW_VSYNC;
+static bool __adaptiveVsync = false;
 static bool __hasMouse = false;
 static bool __leftMouseDown = false;
 static bool __rightMouseDown = false;
@@ -806,7 +807,9 @@ double getMachTimeInMilliseconds()
         
         _game->frame();
     }
-    CGLFlushDrawable((CGLContextObj)[[self openGLContext] CGLContextObj]);
+    // A game that renders on demand keeps the last frame on the screen when it skips a frame.
+    if (_game == NULL || _game->isFrameRendered())
+        CGLFlushDrawable((CGLContextObj)[[self openGLContext] CGLContextObj]);
     CGLUnlockContext((CGLContextObj)[[self openGLContext] CGLContextObj]);  
 
     [gameLock unlock];
@@ -1797,6 +1800,17 @@ void Platform::setVsync(bool enable)
     [[__view openGLContext] setValues:&swapInt forParameter:NSOpenGLCPSwapInterval];
 }
 
+bool Platform::isAdaptiveVsync()
+{
+    return __adaptiveVsync;
+}
+
+void Platform::setAdaptiveVsync(bool enable)
+{
+    // The display link drives the frames, so late frames always wait for the next refresh.
+    __adaptiveVsync = enable;
+}
+
 void Platform::swapBuffers()
 {
     if (__view)
@@ -1808,6 +1822,11 @@ void Platform::sleep(long ms)
     usleep(ms * 1000);
 }
 
+void Platform::wakeUp()
+{
+    // The frames are driven by the display link, which does not wait for events.
+}
+
 void Platform::setMultiSampling(bool enabled)
 {
     if (enabled == __multiSampling)
@@ -1,4 +1,4 @@
-#ifdef WIN32
+#if defined(WIN32) && !defined(GP_HEADLESS)
 
 #include "Base.h"
 #include "Platform.h"
@@ -28,6 +28,7 @@ static double __timeTicksPerMillis;
 static double __timeStart;
 static double __timeAbsolute;
 static bool __vsync = WINDOW_VSYNC;
+static bool __adaptiveVsync = false;
 static HINSTANCE __hinstance = 0;
 static HWND __hwnd = 0;
 static HDC __hdc = 0;
@@ -46,6 +47,17 @@ static const unsigned int XINPUT_TRIGGER_COUNT = 2;
 static XINPUT_STATE __xInputState;
 static bool __connectedXInput[4];
 
+// Applies the swap interval for the vsync settings; adaptive vsync uses a negative interval.
+static bool updateSwapInterval()
+{
+    if (!wglSwapIntervalEXT)
+        return false;
+
+    bool tear = __adaptiveVsync && wglewIsSupported("WGL_EXT_swap_control_tear") == GL_TRUE;
+    wglSwapIntervalEXT(__vsync ? (tear ? -1 : 1) : 0);
+    return true;
+}
+
 static float normalizeXInputJoystickAxis(int axisValue, int deadZone)
 {
     int absAxisValue = abs(axisValue);
@@ -478,6 +490,11 @@ LRESULT CALLBACK __WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         // Window was resized.
         gameplay::Platform::resizeEventInternal((unsigned int)(short)LOWORD(lParam), (unsigned int)(short)HIWORD(lParam));
         break;
+
+    case WM_PAINT:
+        // Window was uncovered, so it is drawn again when the game renders on demand.
+        game->invalidate();
+        break;
     }
     
     return DefWindowProc(hwnd, msg, wParam, lParam); 
@@ -760,9 +777,7 @@ bool initializeGL(WindowCreationParams* params)
     }
 
     // Vertical sync.
-    if (wglSwapIntervalEXT) 
-        wglSwapIntervalEXT(__vsync ? 1 : 0);
-    else 
+    if (!updateSwapInterval())
         __vsync = false;
 
     // Some old graphics cards support EXT_framebuffer_object instead of ARB_framebuffer_object.
@@ -1020,7 +1035,18 @@ int Platform::enterMessagePump()
             }
 #endif
             _game->frame();
-            SwapBuffers(__hdc);
+            if (_game->isFrameRendered())
+            {
+                Platform::paceFrame();
+                SwapBuffers(__hdc);
+            }
+            else
+            {
+                // Wait for the next message, the next time event, or the next gamepad poll when
+                // the game renders on demand and nothing changed.
+                double idleTime = _game->getIdleTime();
+                MsgWaitForMultipleObjects(0, NULL, FALSE, idleTime >= 0.0 ? (DWORD)ceil(idleTime) : INFINITE, QS_ALLINPUT);
+            }
         }
 
         // If we are done, then exit.
@@ -1078,12 +1104,21 @@ void Platform::setVsync(bool enable)
 {
     __vsync = enable;
 
-    if (wglSwapIntervalEXT) 
-        wglSwapIntervalEXT(__vsync ? 1 : 0);
-    else 
+    if (!updateSwapInterval())
         __vsync = false;
 }
 
+bool Platform::isAdaptiveVsync()
+{
+    return __adaptiveVsync;
+}
+
+void Platform::setAdaptiveVsync(bool enable)
+{
+    __adaptiveVsync = enable;
+    updateSwapInterval();
+}
+
 void Platform::swapBuffers()
 {
     if (__hdc)
@@ -1095,6 +1130,12 @@ void Platform::sleep(long ms)
     Sleep(ms);
 }
 
+void Platform::wakeUp()
+{
+    if (__hwnd)
+        PostMessage(__hwnd, WM_NULL, 0, 0);
+}
+
 void Platform::setMultiSampling(bool enabled)
 {
     if (enabled == __multiSampling)
@@ -76,6 +76,7 @@ static TouchPoint __touchPoints[TOUCH_POINTS_MAX];
 static double __timeStart;
 static double __timeAbsolute;
 static bool __vsync = WINDOW_VSYNC;
+static bool __adaptiveVsync = false;
 static float __pitch;
 static float __roll;
 
@@ -501,8 +502,9 @@ int getUnicode(int key);
         if (game)
             game->frame();
         
-        // Present the contents of the color buffer
-        [self swapBuffers];
+        // Present the contents of the color buffer, unless the game renders on demand and skipped the frame
+        if (game == NULL || game->isFrameRendered())
+            [self swapBuffers];
     }
 }
 
@@ -1562,6 +1564,17 @@ void Platform::setVsync(bool enable)
     __vsync = enable;
 }
 
+bool Platform::isAdaptiveVsync()
+{
+    return __adaptiveVsync;
+}
+
+void Platform::setAdaptiveVsync(bool enable)
+{
+    // The display link drives the frames, so late frames always wait for the next refresh.
+    __adaptiveVsync = enable;
+}
+
 void Platform::swapBuffers()
 {
     if (__view)
@@ -1572,6 +1585,11 @@ void Platform::sleep(long ms)
     usleep(ms * 1000);
 }
 
+void Platform::wakeUp()
+{
+    // The frames are driven by the display link, which does not wait for events.
+}
+
 bool Platform::hasAccelerometer()
 {
     return true;
@@ -0,0 +1,457 @@
+#include "Base.h"
+#include "PortalGraph.h"
+#include "Scene.h"
+#include "Properties.h"
+
+// The largest number of portals that are walked through from the zone of the camera
+#define PORTAL_MAX_DEPTH 16
+
+namespace gameplay
+{
+
+static bool containsPoint(const BoundingBox& box, const Vector3& point)
+{
+    return point.x >= box.min.x && point.y >= box.min.y && point.z >= box.min.z &&
+           point.x <= box.max.x && point.y <= box.max.y && point.z <= box.max.z;
+}
+
+static bool containsSphere(const BoundingBox& box, const BoundingSphere& sphere)
+{
+    return sphere.center.x - sphere.radius >= box.min.x && sphere.center.y - sphere.radius >= box.min.y &&
+           sphere.center.z - sphere.radius >= box.min.z && sphere.center.x + sphere.radius <= box.max.x &&
+           sphere.center.y + sphere.radius <= box.max.y && sphere.center.z + sphere.radius <= box.max.z;
+}
+
+static float getVolume(const BoundingBox& box)
+{
+    return (box.max.x - box.min.x) * (box.max.y - box.min.y) * (box.max.z - box.min.z);
+}
+
+PortalGraph::PortalGraph()
+    : _culling(false)
+{
+}
+
+PortalGraph::~PortalGraph()
+{
+    for (std::map<Node*, unsigned int>::iterator itr = _nodeZones.begin(); itr != _nodeZones.end(); ++itr)
+    {
+        itr->first->release();
+    }
+}
+
+PortalGraph* PortalGraph::create()
+{
+    return new PortalGraph();
+}
+
+PortalGraph* PortalGraph::create(Properties* properties)
+{
+    GP_ASSERT(properties);
+
+    PortalGraph* graph = new PortalGraph();
+
+    // Add the zones first, so that portals can refer to zones that are described after them.
+    Properties* ns;
+    properties->rewind();
+    while ((ns = properties->getNextNamespace()) != NULL)
+    {
+        if (strcmp(ns->getNamespace(), "zone") != 0)
+            continue;
+
+        Vector3 min, max;
+        if (strlen(ns->getId()) == 0 || !ns->getVector3("min", &min) || !ns->getVector3("max", &max))
+        {
+            GP_WARN("Zone '%s' needs an ID, a min and a max.", ns->getId());
+            continue;
+        }
+        graph->addZone(ns->getId(), BoundingBox(min, max));
+    }
+
+    properties->rewind();
+    while ((ns = properties->getNextNamespace()) != NULL)
+    {
+        if (strcmp(ns->getNamespace(), "zone") == 0)
+            continue;
+        if (strcmp(ns->getNamespace(), "portal") != 0)
+        {
+            GP_WARN("Unsupported child namespace (of 'zones'): %s", ns->getNamespace());
+            continue;
+        }
+
+        // The zones are given as two identifiers separated by a comma.
+        std::string zones = ns->getString("zones", "");
+        size_t comma = zones.find(',');
+        int zone1 = -1, zone2 = -1;
+        if (comma != std::string::npos)
+        {
+            std::string id1 = zones.substr(0, comma);
+            std::string id2 = zones.substr(comma + 1);
+            id1.erase(0, id1.find_first_not_of(" \t"));
+            id1.erase(id1.find_last_not_of(" \t") + 1);
+            id2.erase(0, id2.find_first_not_of(" \t"));
+            id2.erase(id2.find_last_not_of(" \t") + 1);
+            zone1 = graph->findZone(id1.c_str());
+            zone2 = graph->findZone(id2.c_str());
+        }
+
+        Vector3 min, max;
+        if (zone1 < 0 || zone2 < 0 || !ns->getVector3("min", &min) || !ns->getVector3("max", &max))
+        {
+            GP_WARN("Portal '%s' needs two existing zones, a min and a max.", ns->getId());
+            continue;
+        }
+        unsigned int portal = graph->addPortal((unsigned int)zone1, (unsigned int)zone2, BoundingBox(min, max));
+        if (ns->exists("open"))
+            graph->setPortalOpen(portal, ns->getBool("open"));
+    }
+
+    return graph;
+}
+
+unsigned int PortalGraph::addZone(const char* id, const BoundingBox& bounds)
+{
+    Zone zone;
+    zone.id = id ? id : "";
+    zone.bounds = bounds;
+    zone.visible = true;
+    zone.onPath = false;
+    zone.rect[0] = zone.rect[1] = -1.0f;
+    zone.rect[2] = zone.rect[3] = 1.0f;
+    _zones.push_back(zone);
+    return (unsigned int)_zones.size() - 1;
+}
+
+unsigned int PortalGraph::addPortal(unsigned int zone1, unsigned int zone2, const BoundingBox& bounds)
+{
+    GP_ASSERT(zone1 < _zones.size() && zone2 < _zones.size());
+
+    Portal portal;
+    portal.zones[0] = zone1;
+    portal.zones[1] = zone2;
+    portal.bounds = bounds;
+    portal.open = true;
+    _portals.push_back(portal);
+
+    unsigned int index = (unsigned int)_portals.size() - 1;
+    _zones[zone1].portals.push_back(index);
+    if (zone2 != zone1)
+        _zones[zone2].portals.push_back(index);
+    return index;
+}
+
+unsigned int PortalGraph::getZoneCount() const
+{
+    return (unsigned int)_zones.size();
+}
+
+const char* PortalGraph::getZoneId(unsigned int zone) const
+{
+    GP_ASSERT(zone < _zones.size());
+    return _zones[zone].id.c_str();
+}
+
+const BoundingBox& PortalGraph::getZoneBounds(unsigned int zone) const
+{
+    GP_ASSERT(zone < _zones.size());
+    return _zones[zone].bounds;
+}
+
+int PortalGraph::findZone(const char* id) const
+{
+    GP_ASSERT(id);
+    for (size_t i = 0, count = _zones.size(); i < count; ++i)
+    {
+        if (_zones[i].id == id)
+            return (int)i;
+    }
+    return -1;
+}
+
+int PortalGraph::findZone(const Vector3& point) const
+{
+    int zone = -1;
+    float volume = 0.0f;
+    for (size_t i = 0, count = _zones.size(); i < count; ++i)
+    {
+        if (containsPoint(_zones[i].bounds, point) && (zone < 0 || getVolume(_zones[i].bounds) < volume))
+        {
+            zone = (int)i;
+            volume = getVolume(_zones[i].bounds);
+        }
+    }
+    return zone;
+}
+
+unsigned int PortalGraph::getPortalCount() const
+{
+    return (unsigned int)_portals.size();
+}
+
+void PortalGraph::setPortalOpen(unsigned int portal, bool open)
+{
+    GP_ASSERT(portal < _portals.size());
+    _portals[portal].open = open;
+}
+
+bool PortalGraph::isPortalOpen(unsigned int portal) const
+{
+    GP_ASSERT(portal < _portals.size());
+    return _portals[portal].open;
+}
+
+void PortalGraph::assign(Node* node, int zone)
+{
+    GP_ASSERT(node);
+    GP_ASSERT(zone < (int)_zones.size());
+
+    std::map<Node*, unsigned int>::iterator itr = _nodeZones.find(node);
+    if (zone < 0)
+    {
+        if (itr != _nodeZones.end())
+        {
+            _nodeZones.erase(itr);
+            node->release();
+        }
+    }
+    else if (itr != _nodeZones.end())
+    {
+        itr->second = (unsigned int)zone;
+    }
+    else
+    {
+        node->addRef();
+        _nodeZones[node] = (unsigned int)zone;
+    }
+}
+
+int PortalGraph::getZone(Node* node) const
+{
+    std::map<Node*, unsigned int>::const_iterator itr = _nodeZones.find(node);
+    return itr == _nodeZones.end() ? -1 : (int)itr->second;
+}
+
+unsigned int PortalGraph::assignTagged(Scene* scene)
+{
+    GP_ASSERT(scene);
+
+    unsigned int count = 0;
+    for (Node* node = scene->getFirstNode(); node != NULL; node = node->getNextSibling())
+    {
+        assignNodes(node, false, &count);
+    }
+    return count;
+}
+
+unsigned int PortalGraph::assignByBounds(Scene* scene)
+{
+    GP_ASSERT(scene);
+
+    unsigned int count = 0;
+    for (Node* node = scene->getFirstNode(); node != NULL; node = node->getNextSibling())
+    {
+        assignNodes(node, true, &count);
+    }
+    return count;
+}
+
+void PortalGraph::assignNodes(Node* node, bool byBounds, unsigned int* count)
+{
+    if (!byBounds && node->hasTag("zone"))
+    {
+        int zone = findZone(node->getTag("zone"));
+        if (zone < 0)
+        {
+            GP_WARN("Node '%s' is tagged with the unknown zone '%s'.", node->getId(), node->getTag("zone"));
+        }
+        else
+        {
+            assign(node, zone);
+            ++(*count);
+        }
+    }
+    else if (byBounds && node->getDrawable() && getZone(node) < 0)
+    {
+        const BoundingSphere& sphere = node->getBoundingSphere();
+        int zone = -1;
+        for (size_t i = 0, zoneCount = _zones.size(); i < zoneCount; ++i)
+        {
+            if (containsSphere(_zones[i].bounds, sphere))
+            {
+                // Nodes that are inside of several zones could be seen from either, so they stay unassigned.
+                if (zone >= 0)
+                {
+                    zone = -1;
+                    break;
+                }
+                zone = (int)i;
+            }
+        }
+        if (zone >= 0)
+        {
+            assign(node, zone);
+            ++(*count);
+        }
+    }
+
+    for (Node* child = node->getFirstChild(); child != NULL; child = child->getNextSibling())
+    {
+        assignNodes(child, byBounds, count);
+    }
+}
+
+unsigned int PortalGraph::update(Camera* camera)
+{
+    for (size_t i = 0, count = _zones.size(); i < count; ++i)
+    {
+        _zones[i].visible = false;
+        _zones[i].onPath = false;
+    }
+
+    int zone = -1;
+    if (camera && camera->getNode())
+        zone = findZone(camera->getNode()->getTranslationWorld());
+    _culling = zone >= 0;
+    if (!_culling)
+    {
+        // Without a zone to start from, every zone may be visible.
+        for (size_t i = 0, count = _zones.size(); i < count; ++i)
+        {
+            _zones[i].visible = true;
+        }
+        return (unsigned int)_zones.size();
+    }
+
+    _viewProjection = camera->getViewProjectionMatrix();
+    float screen[4] = { -1.0f, -1.0f, 1.0f, 1.0f };
+    visit((unsigned int)zone, screen, camera->getFrustum(), 0);
+
+    // Each zone is tested against the region of the screen of all of the paths that reach it.
+    unsigned int visibleCount = 0;
+    for (size_t i = 0, count = _zones.size(); i < count; ++i)
+    {
+        Zone& z = _zones[i];
+        if (z.visible)
+        {
+            createFrustum(z.rect, &z.frustum);
+            ++visibleCount;
+        }
+    }
+    return visibleCount;
+}
+
+void PortalGraph::visit(unsigned int index, const float* rect, const Frustum& frustum, unsigned int depth)
+{
+    Zone& zone = _zones[index];
+    if (zone.visible)
+    {
+        zone.rect[0] = std::min(zone.rect[0], rect[0]);
+        zone.rect[1] = std::min(zone.rect[1], rect[1]);
+        zone.rect[2] = std::max(zone.rect[2], rect[2]);
+        zone.rect[3] = std::max(zone.rect[3], rect[3]);
+    }
+    else
+    {
+        zone.visible = true;
+        memcpy(zone.rect, rect, sizeof(zone.rect));
+    }
+
+    if (depth >= PORTAL_MAX_DEPTH)
+        return;
+
+    // Walk through the open portals that are in view, with the region of the screen narrowed to each of them.
+    zone.onPath = true;
+    for (size_t i = 0, count = zone.portals.size(); i < count; ++i)
+    {
+        const Portal& portal = _portals[_zones[index].portals[i]];
+        unsigned int next = portal.zones[0] == index ? portal.zones[1] : portal.zones[0];
+        if (!portal.open || _zones[next].onPath || !portal.bounds.intersects(frustum))
+            continue;
+
+        float portalRect[4];
+        if (!projectPortal(portal.bounds, portalRect))
+        {
+            // The portal reaches behind the camera, so it may cover the whole region.
+            memcpy(portalRect, rect, sizeof(portalRect));
+        }
+        portalRect[0] = std::max(portalRect[0], rect[0]);
+        portalRect[1] = std::max(portalRect[1], rect[1]);
+        portalRect[2] = std::min(portalRect[2], rect[2]);
+        portalRect[3] = std::min(portalRect[3], rect[3]);
+        if (portalRect[0] >= portalRect[2] || portalRect[1] >= portalRect[3])
+            continue;
+
+        Frustum narrowed;
+        createFrustum(portalRect, &narrowed);
+        visit(next, portalRect, narrowed, depth + 1);
+    }
+    _zones[index].onPath = false;
+}
+
+bool PortalGraph::projectPortal(const BoundingBox& bounds, float* rect) const
+{
+    Vector3 corners[8];
+    bounds.getCorners(corners);
+
+    rect[0] = rect[1] = FLT_MAX;
+    rect[2] = rect[3] = -FLT_MAX;
+    for (unsigned int i = 0; i < 8; ++i)
+    {
+        Vector4 clip;
+        _viewProjection.transformVector(Vector4(corners[i].x, corners[i].y, corners[i].z, 1.0f), &clip);
+        if (clip.w <= MATH_EPSILON)
+            return false;
+
+        float x = clip.x / clip.w;
+        float y = clip.y / clip.w;
+        rect[0] = std::min(rect[0], x);
+        rect[1] = std::min(rect[1], y);
+        rect[2] = std::max(rect[2], x);
+        rect[3] = std::max(rect[3], y);
+    }
+    return true;
+}
+
+void PortalGraph::createFrustum(const float* rect, Frustum* frustum) const
+{
+    GP_ASSERT(rect && frustum);
+
+    // Scale the clip space of the camera so that the region of the screen fills it.
+    float width = std::max(rect[2] - rect[0], MATH_EPSILON);
+    float height = std::max(rect[3] - rect[1], MATH_EPSILON);
+    Matrix region;
+    region.m[0] = 2.0f / width;
+    region.m[5] = 2.0f / height;
+    region.m[12] = -(rect[0] + rect[2]) / width;
+    region.m[13] = -(rect[1] + rect[3]) / height;
+
+    Matrix matrix;
+    Matrix::multiply(region, _viewProjection, &matrix);
+    frustum->set(matrix);
+}
+
+bool PortalGraph::isZoneVisible(unsigned int zone) const
+{
+    GP_ASSERT(zone < _zones.size());
+    return _zones[zone].visible;
+}
+
+bool PortalGraph::isVisible(Node* node) const
+{
+    if (!_culling || _nodeZones.empty())
+        return true;
+
+    // Children without a zone of their own are in the zone of their parents.
+    for (Node* n = node; n != NULL; n = n->getParent())
+    {
+        std::map<Node*, unsigned int>::const_iterator itr = _nodeZones.find(n);
+        if (itr != _nodeZones.end())
+        {
+            const Zone& zone = _zones[itr->second];
+            return zone.visible && node->getBoundingSphere().intersects(zone.frustum);
+        }
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,300 @@
+#ifndef PORTALGRAPH_H_
+#define PORTALGRAPH_H_
+
+#include "Ref.h"
+#include "BoundingBox.h"
+#include "Frustum.h"
+
+namespace gameplay
+{
+
+class Scene;
+class Camera;
+class Node;
+class Properties;
+
+/**
+ * Defines the zones of an indoor scene and the portals that connect them, for culling the
+ * zones that the camera cannot see.
+ *
+ * A zone is a box that stands for a room or a corridor, and a portal is a box around an
+ * opening, like a doorway or a window, between two zones. Nodes are assigned to the zones
+ * that they are in. Each frame, update() walks the portals from the zone of the camera, and
+ * narrows the region of the screen that each zone can be seen through to the projection of
+ * the portals on the way to it. The nodes of the zones that are not reached, or that are
+ * outside of the region of the screen of their zone, are hidden. Nodes that are not assigned
+ * to a zone are never hidden, and nothing is hidden while the camera is not in a zone.
+ *
+ * The zones of a scene can be described in its '.scene' file, where the nodes that have a
+ * "zone" tag are assigned to the zone that it names, and, if assignByBounds is set, the nodes
+ * whose bounds are entirely inside a single zone are assigned to it as well, which suits the
+ * nodes of bundles:
+ *
+ * @code
+ * scene
+ * {
+ *     zones
+ *     {
+ *         assignByBounds = true
+ *
+ *         zone hall
+ *         {
+ *             min = -10, 0, -10
+ *             max = 10, 5, 10
+ *         }
+ *         zone corridor
+ *         {
+ *             min = 10, 0, -2
+ *             max = 30, 3, 2
+ *         }
+ *         portal hallDoor
+ *         {
+ *             zones = hall, corridor
+ *             min = 9.9, 0, -1
+ *             max = 10.1, 2.5, 1
+ *         }
+ *     }
+ * }
+ * @endcode
+ *
+ * A RenderQueue skips the hidden nodes of the portal graph of its scene (see Scene::setPortalGraph)
+ * when it gathers the drawables of a single camera, so only the potentially visible zones are submitted.
+ *
+ * @script{ignore}
+ */
+class PortalGraph : public Ref
+{
+public:
+
+    /**
+     * Creates an empty portal graph.
+     *
+     * @return The new portal graph.
+     */
+    static PortalGraph* create();
+
+    /**
+     * Creates a portal graph from the zones namespace of a '.scene' file.
+     *
+     * @param properties The zones namespace.
+     *
+     * @return The new portal graph.
+     */
+    static PortalGraph* create(Properties* properties);
+
+    /**
+     * Adds a zone.
+     *
+     * @param id The identifier of the zone.
+     * @param bounds The bounds of the zone, in world space.
+     *
+     * @return The index of the zone.
+     */
+    unsigned int addZone(const char* id, const BoundingBox& bounds);
+
+    /**
+     * Adds a portal between two zones.
+     *
+     * @param zone1 The index of the first zone.
+     * @param zone2 The index of the second zone.
+     * @param bounds The bounds of the opening, in world space.
+     *
+     * @return The index of the portal.
+     */
+    unsigned int addPortal(unsigned int zone1, unsigned int zone2, const BoundingBox& bounds);
+
+    /**
+     * Returns the number of zones.
+     *
+     * @return The number of zones.
+     */
+    unsigned int getZoneCount() const;
+
+    /**
+     * Returns the identifier of a zone.
+     *
+     * @param zone The index of the zone.
+     *
+     * @return The identifier of the zone.
+     */
+    const char* getZoneId(unsigned int zone) const;
+
+    /**
+     * Returns the bounds of a zone.
+     *
+     * @param zone The index of the zone.
+     *
+     * @return The bounds of the zone.
+     */
+    const BoundingBox& getZoneBounds(unsigned int zone) const;
+
+    /**
+     * Finds a zone by its identifier.
+     *
+     * @param id The identifier of the zone.
+     *
+     * @return The index of the zone, or -1 if there is no zone with the identifier.
+     */
+    int findZone(const char* id) const;
+
+    /**
+     * Finds the zone that contains a point, which is the smallest one if several zones do.
+     *
+     * @param point The point, in world space.
+     *
+     * @return The index of the zone, or -1 if the point is not in a zone.
+     */
+    int findZone(const Vector3& point) const;
+
+    /**
+     * Returns the number of portals.
+     *
+     * @return The number of portals.
+     */
+    unsigned int getPortalCount() const;
+
+    /**
+     * Opens or closes a portal, such as the portal of a door. Closed portals cannot be seen through.
+     *
+     * @param portal The index of the portal.
+     * @param open true to open the portal (the default), false to close it.
+     */
+    void setPortalOpen(unsigned int portal, bool open);
+
+    /**
+     * Determines whether a portal is open.
+     *
+     * @param portal The index of the portal.
+     *
+     * @return true if the portal is open, false otherwise.
+     */
+    bool isPortalOpen(unsigned int portal) const;
+
+    /**
+     * Assigns a node to a zone, which the graph keeps a reference to the node for.
+     *
+     * @param node The node.
+     * @param zone The index of the zone, or -1 to remove the node from its zone.
+     */
+    void assign(Node* node, int zone);
+
+    /**
+     * Returns the zone that a node is assigned to.
+     *
+     * @param node The node.
+     *
+     * @return The index of the zone, or -1 if the node is not assigned to a zone.
+     */
+    int getZone(Node* node) const;
+
+    /**
+     * Assigns the nodes of a scene that have a "zone" tag to the zone that the tag names.
+     *
+     * @param scene The scene.
+     *
+     * @return The number of nodes that were assigned.
+     */
+    unsigned int assignTagged(Scene* scene);
+
+    /**
+     * Assigns the nodes of a scene that have a drawable and are not assigned yet to the zone
+     * that their bounds are entirely inside of, if there is a single one.
+     *
+     * @param scene The scene.
+     *
+     * @return The number of nodes that were assigned.
+     */
+    unsigned int assignByBounds(Scene* scene);
+
+    /**
+     * Finds the zones that a camera can see, through the portals from the zone that it is in.
+     *
+     * @param camera The camera.
+     *
+     * @return The number of visible zones, or the number of zones if the camera is not in a zone.
+     */
+    unsigned int update(Camera* camera);
+
+    /**
+     * Determines whether a zone was visible at the last update.
+     *
+     * @param zone The index of the zone.
+     *
+     * @return true if the zone is visible, false otherwise.
+     */
+    bool isZoneVisible(unsigned int zone) const;
+
+    /**
+     * Determines whether a node may be visible after the last update.
+     *
+     * @param node The node.
+     *
+     * @return false if the node is in a zone that is not visible, or outside of the region of the
+     *      screen that its zone is seen through, true otherwise.
+     */
+    bool isVisible(Node* node) const;
+
+private:
+
+    /**
+     * A zone of the graph.
+     */
+    struct Zone
+    {
+        std::string id;
+        BoundingBox bounds;
+        std::vector<unsigned int> portals;
+        bool visible;
+        bool onPath;
+        float rect[4];
+        Frustum frustum;
+    };
+
+    /**
+     * A portal between two zones.
+     */
+    struct Portal
+    {
+        unsigned int zones[2];
+        BoundingBox bounds;
+        bool open;
+    };
+
+    /**
+     * Constructor.
+     */
+    PortalGraph();
+
+    /**
+     * Destructor.
+     */
+    ~PortalGraph();
+
+    /**
+     * Hidden copy constructor.
+     */
+    PortalGraph(const PortalGraph& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    PortalGraph& operator=(const PortalGraph&);
+
+    void visit(unsigned int zone, const float* rect, const Frustum& frustum, unsigned int depth);
+
+    bool projectPortal(const BoundingBox& bounds, float* rect) const;
+
+    void createFrustum(const float* rect, Frustum* frustum) const;
+
+    void assignNodes(Node* node, bool byBounds, unsigned int* count);
+
+    std::vector<Zone> _zones;
+    std::vector<Portal> _portals;
+    std::map<Node*, unsigned int> _nodeZones;
+    Matrix _viewProjection;
+    bool _culling;
+};
+
+}
+
+#endif
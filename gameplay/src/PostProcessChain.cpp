@@ -0,0 +1,512 @@
+#include "Base.h"
+#include "PostProcessChain.h"
+#include "RenderTargetPool.h"
+#include "FrameBuffer.h"
+#include "Material.h"
+#include "Model.h"
+#include "Game.h"
+#include "FileSystem.h"
+#include "RenderCommandList.h"
+
+#define POSTPROCESS_VERTEX_SHADER   "res/shaders/postprocess.vert"
+#define POSTPROCESS_FRAGMENT_HEADER "res/shaders/postprocess.frag"
+#define POSTPROCESS_SCENE           "scene"
+
+namespace gameplay
+{
+
+/**
+ * Splits a semicolon separated list of names.
+ */
+static void splitNames(const char* names, std::vector<std::string>& out)
+{
+    std::string str = names;
+    size_t start = 0;
+    while (start <= str.length())
+    {
+        size_t end = str.find(';', start);
+        if (end == std::string::npos)
+            end = str.length();
+        std::string name = str.substr(start, end - start);
+        if (!name.empty())
+            out.push_back(name);
+        start = end + 1;
+    }
+}
+
+PostProcessChain::PostProcessChain(RenderTargetPool* pool)
+    : _pool(pool), _ownsPool(pool == NULL), _built(false), _active(false), _quad(NULL), _previousFrameBuffer(NULL)
+{
+    if (_pool == NULL)
+        _pool = new RenderTargetPool();
+}
+
+PostProcessChain::~PostProcessChain()
+{
+    for (size_t i = 0, count = _steps.size(); i < count; ++i)
+    {
+        SAFE_RELEASE(_steps[i].model);
+        SAFE_RELEASE(_steps[i].material);
+    }
+    for (size_t i = 0, count = _targets.size(); i < count; ++i)
+    {
+        if (_targets[i].frameBuffer)
+            _pool->release(_targets[i].frameBuffer);
+        SAFE_RELEASE(_targets[i].sampler);
+    }
+    SAFE_RELEASE(_quad);
+    if (_ownsPool)
+    {
+        SAFE_DELETE(_pool);
+    }
+}
+
+void PostProcessChain::addPass(const char* output, const char* fshPath, const char* inputs, unsigned int divisor, const char* defines)
+{
+    addPass(output, fshPath, NULL, inputs, divisor, defines, false);
+}
+
+void PostProcessChain::addPixelPass(const char* output, const char* functionPath, const char* function, const char* inputs, unsigned int divisor)
+{
+    GP_ASSERT(function);
+    addPass(output, functionPath, function, inputs, divisor, NULL, true);
+}
+
+void PostProcessChain::addPass(const char* output, const char* path, const char* function, const char* inputs, unsigned int divisor, const char* defines, bool pixel)
+{
+    GP_ASSERT(output);
+    GP_ASSERT(path);
+
+    if (_built)
+    {
+        GP_WARN("Failed to add post-processing pass '%s'; the passes of the chain have already been built.", output);
+        return;
+    }
+
+    PassDesc pass;
+    pass.output = output;
+    pass.path = path;
+    pass.function = function ? function : "";
+    pass.defines = defines ? defines : "";
+    if (inputs)
+        splitNames(inputs, pass.inputs);
+    if (pass.inputs.empty())
+        pass.inputs.push_back(_passes.empty() ? POSTPROCESS_SCENE : _passes.back().output);
+    pass.divisor = std::max(1u, divisor);
+    pass.pixel = pixel;
+    _passes.push_back(pass);
+}
+
+int PostProcessChain::findTarget(const std::string& name) const
+{
+    for (int i = (int)_targets.size() - 1; i >= 0; --i)
+    {
+        if (_targets[i].name == name)
+            return i;
+    }
+    return -1;
+}
+
+int PostProcessChain::getInput(const std::string& name, unsigned int divisor, std::vector<Step>& steps)
+{
+    int index = findTarget(name);
+    if (index < 0)
+        return -1;
+
+    // Halve the input until it is no more than twice the size of the pass, sharing the
+    // halved targets between the passes that read the input at the same size. A single
+    // bilinear tap at the center of each texel of a halved target averages 2x2 texels.
+    while (_targets[index].divisor * 2 <= divisor)
+    {
+        unsigned int halved = _targets[index].divisor * 2;
+        char suffix[16];
+        sprintf(suffix, "@%u", halved);
+        std::string halvedName = name + suffix;
+        int halvedIndex = findTarget(halvedName);
+        if (halvedIndex < 0)
+        {
+            Step step;
+            step.output = halvedName;
+            step.divisor = halved;
+            step.source = index;
+            step.inputs.push_back(index);
+            step.uniforms.push_back("u_texture");
+            step.target = (int)_targets.size();
+            step.material = NULL;
+            step.model = NULL;
+            step.texelSize = false;
+            steps.push_back(step);
+
+            Target target;
+            target.name = halvedName;
+            target.divisor = halved;
+            target.lastUse = (int)steps.size() - 1;
+            target.frameBuffer = NULL;
+            target.sampler = NULL;
+            _targets.push_back(target);
+            halvedIndex = step.target;
+        }
+        index = halvedIndex;
+    }
+    return index;
+}
+
+void PostProcessChain::build()
+{
+    if (_built)
+        return;
+    _built = true;
+
+    // Gather the passes into steps, merging each pixel pass into the pixel passes before it when
+    // it is the only reader of their output and draws at the same size.
+    std::map<std::string, unsigned int> uses;
+    for (size_t i = 0, count = _passes.size(); i < count; ++i)
+    {
+        for (size_t j = 0, inputCount = _passes[i].inputs.size(); j < inputCount; ++j)
+            ++uses[_passes[i].inputs[j]];
+    }
+    std::vector<Step> steps;
+    for (size_t i = 0, count = _passes.size(); i < count; ++i)
+    {
+        const PassDesc& pass = _passes[i];
+        unsigned int divisor = pass.divisor;
+        if (i + 1 == count && divisor != 1)
+        {
+            GP_WARN("Post-processing pass '%s' is the last pass of the chain, so it is drawn at full resolution.", pass.output.c_str());
+            divisor = 1;
+        }
+
+        if (pass.pixel && !steps.empty())
+        {
+            Step& previous = steps.back();
+            if (previous.path.empty() && previous.output == pass.inputs[0] && previous.divisor == divisor && uses[pass.inputs[0]] == 1)
+            {
+                previous.output = pass.output;
+                previous.functions.push_back(&pass);
+                for (size_t j = 1, inputCount = pass.inputs.size(); j < inputCount; ++j)
+                {
+                    if (std::find(previous.inputNames.begin(), previous.inputNames.end(), pass.inputs[j]) == previous.inputNames.end())
+                        previous.inputNames.push_back(pass.inputs[j]);
+                }
+                continue;
+            }
+        }
+
+        Step step;
+        step.output = pass.output;
+        step.divisor = divisor;
+        step.inputNames = pass.inputs;
+        if (pass.pixel)
+        {
+            step.functions.push_back(&pass);
+        }
+        else
+        {
+            step.path = pass.path;
+            step.defines = pass.defines;
+        }
+        step.source = -1;
+        step.target = -1;
+        step.material = NULL;
+        step.model = NULL;
+        step.texelSize = false;
+        steps.push_back(step);
+    }
+    if (steps.empty())
+    {
+        // Without passes, the scene is copied as it is.
+        Step step;
+        step.output = "";
+        step.divisor = 1;
+        step.inputNames.push_back(POSTPROCESS_SCENE);
+        step.source = -1;
+        step.target = -1;
+        step.material = NULL;
+        step.model = NULL;
+        step.texelSize = false;
+        steps.push_back(step);
+    }
+
+    // Resolve the inputs of the steps to targets, adding the steps that halve them, and give
+    // every step but the last a target of its own.
+    Target scene;
+    scene.name = POSTPROCESS_SCENE;
+    scene.divisor = 1;
+    scene.lastUse = -1;
+    scene.frameBuffer = NULL;
+    scene.sampler = NULL;
+    _targets.push_back(scene);
+    for (size_t i = 0, count = steps.size(); i < count; ++i)
+    {
+        Step step = steps[i];
+        bool resolved = true;
+        for (size_t j = 0, inputCount = step.inputNames.size(); j < inputCount && resolved; ++j)
+        {
+            const std::string& name = step.inputNames[j];
+            int input = getInput(name, step.divisor, _steps);
+            if (input < 0)
+            {
+                GP_ERROR("Failed to find input '%s' of post-processing pass '%s'.", name.c_str(), step.output.c_str());
+                resolved = false;
+                break;
+            }
+            if (j == 0)
+            {
+                step.source = input;
+                step.inputs.push_back(input);
+                step.uniforms.push_back("u_texture");
+            }
+            step.inputs.push_back(input);
+            step.uniforms.push_back("u_" + name);
+        }
+        if (!resolved)
+        {
+            step.inputs.clear();
+            step.uniforms.clear();
+        }
+
+        if (i + 1 < count)
+        {
+            Target target;
+            target.name = step.output;
+            target.divisor = step.divisor;
+            target.lastUse = (int)_steps.size();
+            target.frameBuffer = NULL;
+            target.sampler = NULL;
+            step.target = (int)_targets.size();
+            _targets.push_back(target);
+        }
+        _steps.push_back(step);
+    }
+
+    // Each target is released after the last step that reads it.
+    for (size_t i = 0, count = _steps.size(); i < count; ++i)
+    {
+        for (size_t j = 0, inputCount = _steps[i].inputs.size(); j < inputCount; ++j)
+        {
+            Target& target = _targets[_steps[i].inputs[j]];
+            target.lastUse = std::max(target.lastUse, (int)i);
+        }
+    }
+
+    _quad = Mesh::createQuadFullscreen();
+    for (size_t i = 0, count = _steps.size(); i < count; ++i)
+    {
+        if (!_steps[i].inputs.empty())
+            createMaterial(_steps[i]);
+    }
+}
+
+bool PostProcessChain::createMaterial(Step& step)
+{
+    Material* material = NULL;
+    if (!step.path.empty())
+    {
+        material = Material::create(POSTPROCESS_VERTEX_SHADER, step.path.c_str(), step.defines.empty() ? NULL : step.defines.c_str());
+    }
+    else
+    {
+        // The functions of the merged pixel passes are applied in turn to the color of the input.
+        std::string source = "#include \"" POSTPROCESS_FRAGMENT_HEADER "\"\n";
+        std::set<std::string> included;
+        for (size_t i = 0, count = step.functions.size(); i < count; ++i)
+        {
+            if (included.insert(step.functions[i]->path).second)
+                source += "#include \"" + step.functions[i]->path + "\"\n";
+        }
+        source += "\nvoid main()\n{\n    vec4 color = texture2D(u_texture, v_texCoord);\n";
+        for (size_t i = 0, count = step.functions.size(); i < count; ++i)
+            source += "    color = " + step.functions[i]->function + "(color, v_texCoord);\n";
+        source += "    gl_FragColor = color;\n}\n";
+
+        char* vshSource = FileSystem::readAll(POSTPROCESS_VERTEX_SHADER);
+        if (vshSource == NULL)
+        {
+            GP_ERROR("Failed to read vertex shader from file '%s'.", POSTPROCESS_VERTEX_SHADER);
+            return false;
+        }
+        // The paths of the included files are relative to the root of the resources, so the
+        // fragment shader has an empty path.
+        Effect* effect = Effect::createFromSource(POSTPROCESS_VERTEX_SHADER, vshSource, "", source.c_str());
+        SAFE_DELETE_ARRAY(vshSource);
+        if (effect)
+        {
+            material = Material::create(effect);
+            SAFE_RELEASE(effect);
+        }
+    }
+    if (material == NULL)
+    {
+        GP_ERROR("Failed to create material for post-processing pass '%s'.", step.output.c_str());
+        return false;
+    }
+
+    RenderState::StateBlock* stateBlock = material->getStateBlock();
+    stateBlock->setDepthTest(false);
+    stateBlock->setDepthWrite(false);
+    stateBlock->setCullFace(false);
+    stateBlock->setBlend(false);
+
+    // Only the inputs that the shader samples are bound.
+    Effect* effect = material->getTechnique()->getPassByIndex(0)->getEffect();
+    for (size_t i = 0; i < step.uniforms.size();)
+    {
+        if (effect->getUniform(step.uniforms[i].c_str()) == NULL)
+        {
+            step.uniforms.erase(step.uniforms.begin() + i);
+            step.inputs.erase(step.inputs.begin() + i);
+            continue;
+        }
+        ++i;
+    }
+    step.texelSize = effect->getUniform("u_texelSize") != NULL;
+
+    step.material = material;
+    step.model = Model::create(_quad);
+    step.model->setMaterial(material);
+    return true;
+}
+
+Material* PostProcessChain::getMaterial(const char* output)
+{
+    GP_ASSERT(output);
+
+    build();
+    for (size_t i = 0, count = _steps.size(); i < count; ++i)
+    {
+        const Step& step = _steps[i];
+        if (step.path.empty())
+        {
+            for (size_t j = 0, functionCount = step.functions.size(); j < functionCount; ++j)
+            {
+                if (step.functions[j]->output == output)
+                    return step.material;
+            }
+        }
+        else if (step.output == output)
+        {
+            return step.material;
+        }
+    }
+    return NULL;
+}
+
+unsigned int PostProcessChain::getPassCount()
+{
+    build();
+    return (unsigned int)_steps.size();
+}
+
+void PostProcessChain::begin()
+{
+    GP_ASSERT(!_active);
+
+    if (RenderCommandList::getRecording())
+    {
+        GP_WARN("Failed to begin post-processing; the frame buffer can not be bound while a RenderCommandList is recording.");
+        return;
+    }
+
+    Game* game = Game::getInstance();
+    _viewport = game->getViewport();
+    unsigned int width = (unsigned int)_viewport.width;
+    unsigned int height = (unsigned int)_viewport.height;
+    if (width == 0 || height == 0)
+        return;
+
+    build();
+    Target& scene = _targets[0];
+    scene.frameBuffer = _pool->acquire(width, height, Texture::RGBA, true, DepthStencilTarget::DEPTH_STENCIL);
+    if (scene.frameBuffer == NULL)
+        return;
+    Texture* texture = scene.frameBuffer->getRenderTarget()->getTexture();
+    if (scene.sampler == NULL || scene.sampler->getTexture() != texture)
+    {
+        SAFE_RELEASE(scene.sampler);
+        scene.sampler = Texture::Sampler::create(texture);
+        scene.sampler->setFilterMode(Texture::LINEAR, Texture::LINEAR);
+        scene.sampler->setWrapMode(Texture::CLAMP, Texture::CLAMP);
+    }
+    _previousFrameBuffer = scene.frameBuffer->bind();
+    game->setViewport(Rectangle(width, height));
+    _active = true;
+}
+
+void PostProcessChain::end()
+{
+    if (!_active)
+        return;
+    _active = false;
+
+    unsigned int width = (unsigned int)_viewport.width;
+    unsigned int height = (unsigned int)_viewport.height;
+    for (size_t i = 0, count = _steps.size(); i < count; ++i)
+    {
+        drawStep(_steps[i], width, height);
+        releaseTargets((int)i);
+    }
+    releaseTargets((int)_steps.size());
+    _previousFrameBuffer = NULL;
+}
+
+void PostProcessChain::drawStep(Step& step, unsigned int width, unsigned int height)
+{
+    Game* game = Game::getInstance();
+    if (step.target >= 0)
+    {
+        Target& target = _targets[step.target];
+        unsigned int targetWidth = std::max(1u, width / target.divisor);
+        unsigned int targetHeight = std::max(1u, height / target.divisor);
+        target.frameBuffer = _pool->acquire(targetWidth, targetHeight);
+        if (target.frameBuffer == NULL)
+            return;
+
+        // The pool hands out the same targets each frame, so the samplers are normally kept.
+        Texture* texture = target.frameBuffer->getRenderTarget()->getTexture();
+        if (target.sampler == NULL || target.sampler->getTexture() != texture)
+        {
+            SAFE_RELEASE(target.sampler);
+            target.sampler = Texture::Sampler::create(texture);
+            target.sampler->setFilterMode(Texture::LINEAR, Texture::LINEAR);
+            target.sampler->setWrapMode(Texture::CLAMP, Texture::CLAMP);
+        }
+        target.frameBuffer->bind();
+        game->setViewport(Rectangle(targetWidth, targetHeight));
+    }
+    else
+    {
+        _previousFrameBuffer->bind();
+        game->setViewport(_viewport);
+    }
+    if (step.material == NULL)
+        return;
+
+    for (size_t i = 0, count = step.inputs.size(); i < count; ++i)
+    {
+        const Target& input = _targets[step.inputs[i]];
+        if (input.frameBuffer)
+            step.material->getParameter(step.uniforms[i].c_str())->setValue(input.sampler);
+    }
+    if (step.texelSize)
+    {
+        const FrameBuffer* input = _targets[step.source].frameBuffer;
+        if (input)
+            step.material->getParameter("u_texelSize")->setValue(Vector2(1.0f / input->getWidth(), 1.0f / input->getHeight()));
+    }
+    step.model->draw();
+}
+
+void PostProcessChain::releaseTargets(int stepIndex)
+{
+    for (size_t i = 0, count = _targets.size(); i < count; ++i)
+    {
+        Target& target = _targets[i];
+        if (target.frameBuffer && target.lastUse <= stepIndex)
+        {
+            _pool->release(target.frameBuffer);
+            target.frameBuffer = NULL;
+        }
+    }
+}
+
+}
@@ -0,0 +1,230 @@
+#ifndef POSTPROCESSCHAIN_H_
+#define POSTPROCESSCHAIN_H_
+
+#include "Rectangle.h"
+#include "Texture.h"
+
+namespace gameplay
+{
+
+class FrameBuffer;
+class Material;
+class Mesh;
+class Model;
+class RenderTargetPool;
+
+/**
+ * Defines a chain of full-screen passes that are applied to the scene once it has been drawn,
+ * such as bloom, blurs and color grading.
+ *
+ * Each pass draws a fragment shader over a target, which is named after the pass and sampled by
+ * the passes that list it as one of their inputs. The scene is the input named "scene", and the
+ * last pass draws into the frame buffer and viewport that were bound before begin(). Passes can
+ * draw at a fraction of the resolution of the viewport. When a pass reads an input with a higher
+ * resolution than its own, the input is first halved until it matches, once for all the passes
+ * that read it at that resolution, so that blurs at a quarter of the resolution are cheap and
+ * do not alias.
+ *
+ * There are two kinds of passes:
+ *
+ * - A pass added with addPass() has a fragment shader of its own. Its first input is bound to
+ *   u_texture and every input named "name" is bound to u_name, and u_texelSize is the size of a
+ *   texel of its first input. The shader can include "res/shaders/postprocess.frag" for these
+ *   declarations, as res/shaders/postprocess-blur.frag does.
+ * - A pass added with addPixelPass() only changes the color of each pixel of its first input,
+ *   with a function file that defines "vec4 function(vec4 color, vec2 texCoord)". The function
+ *   can use the declarations of postprocess.frag, and its other inputs are bound as for
+ *   addPass(). Pixel passes that follow each other are merged into a single shader when the
+ *   output of each is only read by the next and they have the same resolution, so a chain of
+ *   color adjustments costs a single pass. Each function file is only included once, so the
+ *   functions of a file can be used by several passes, and the uniforms of different files
+ *   should have different names.
+ *
+ * The targets are acquired from a RenderTargetPool for the passes that draw into them and
+ * released after the last pass that reads them, so targets of the same size are shared between
+ * passes whose outputs do not overlap:
+ *
+ * @code
+ * _chain.addPass("bright", "res/shaders/bright.frag", "scene", 2);
+ * _chain.addPass("blurX", "res/shaders/postprocess-blur.frag", "bright", 4);
+ * _chain.addPass("bloom", "res/shaders/postprocess-blur.frag", "blurX", 4);
+ * _chain.addPixelPass("combine", "res/shaders/bloom.frag", "addBloom", "scene;bloom");
+ * _chain.addPixelPass("final", "res/shaders/grading.frag", "applyGrading");
+ * _chain.getMaterial("blurX")->getParameter("u_direction")->setValue(Vector2(1, 0));
+ * _chain.getMaterial("bloom")->getParameter("u_direction")->setValue(Vector2(0, 1));
+ * ...
+ * _chain.begin();
+ * clear(CLEAR_COLOR_DEPTH, Vector4::zero(), 1.0f, 0);
+ * _scene->visit(this, &MyGame::drawScene);
+ * _chain.end();
+ * @endcode
+ *
+ * @script{ignore}
+ */
+class PostProcessChain
+{
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param pool The pool to acquire the targets from, or NULL for the chain to have a pool
+     *      of its own. A pool can be shared with other passes of the frame.
+     */
+    PostProcessChain(RenderTargetPool* pool = NULL);
+
+    /**
+     * Destructor.
+     */
+    ~PostProcessChain();
+
+    /**
+     * Adds a pass with a fragment shader of its own.
+     *
+     * @param output The name of the target that the pass draws into.
+     * @param fshPath The path to the fragment shader of the pass.
+     * @param inputs A semicolon separated list of the names of the targets that the pass reads,
+     *      or NULL to read the output of the previous pass (or the scene for the first pass).
+     * @param divisor The number that the width and height of the viewport are divided by, for
+     *      the size of the target of the pass. The last pass is always drawn at full resolution.
+     * @param defines A semicolon separated list of the defines of the shader. May be NULL.
+     */
+    void addPass(const char* output, const char* fshPath, const char* inputs = NULL, unsigned int divisor = 1, const char* defines = NULL);
+
+    /**
+     * Adds a pass that only changes the color of each pixel of its first input, which may be
+     * merged into a single shader with the pixel passes around it.
+     *
+     * @param output The name of the target that the pass draws into.
+     * @param functionPath The path to the file that defines the function of the pass.
+     * @param function The name of the function, which takes the color of the pixel and its
+     *      texture coordinates, and returns the new color.
+     * @param inputs A semicolon separated list of the names of the targets that the pass reads,
+     *      or NULL to read the output of the previous pass (or the scene for the first pass).
+     * @param divisor The number that the width and height of the viewport are divided by, for
+     *      the size of the target of the pass.
+     */
+    void addPixelPass(const char* output, const char* functionPath, const char* function, const char* inputs = NULL, unsigned int divisor = 1);
+
+    /**
+     * Returns the material that draws a pass, to set the values of its uniforms.
+     *
+     * Merged pixel passes share the material of the first of them. The passes are built when
+     * this is first called, so passes should not be added afterwards.
+     *
+     * @param output The name of the target of the pass.
+     *
+     * @return The material, or NULL if there is no such pass or it failed to build.
+     */
+    Material* getMaterial(const char* output);
+
+    /**
+     * Acquires the target of the scene at the size of the viewport, with a depth and stencil
+     * target, and binds it to draw the scene into.
+     *
+     * The frame buffer is bound immediately, so this should not be called while a
+     * RenderCommandList is recording.
+     */
+    void begin();
+
+    /**
+     * Draws the passes, the last of them into the frame buffer and viewport that were bound
+     * before begin().
+     */
+    void end();
+
+    /**
+     * Returns the number of passes that end() draws, once the pixel passes are merged and the
+     * downsampling passes added.
+     *
+     * @return The number of passes.
+     */
+    unsigned int getPassCount();
+
+private:
+
+    /**
+     * A pass that was added to the chain.
+     */
+    struct PassDesc
+    {
+        std::string output;
+        std::string path;
+        std::string function;
+        std::string defines;
+        std::vector<std::string> inputs;
+        unsigned int divisor;
+        bool pixel;
+    };
+
+    /**
+     * A target that the passes draw into and read, while it is acquired.
+     */
+    struct Target
+    {
+        std::string name;
+        unsigned int divisor;
+        int lastUse;
+        FrameBuffer* frameBuffer;
+        Texture::Sampler* sampler;
+    };
+
+    /**
+     * A pass that end() draws, which may be several merged pixel passes.
+     */
+    struct Step
+    {
+        std::string output;
+        unsigned int divisor;
+        std::vector<std::string> inputNames;
+        std::vector<int> inputs;
+        std::vector<std::string> uniforms;
+        std::vector<const PassDesc*> functions;
+        std::string defines;
+        std::string path;
+        int source;
+        int target;
+        Material* material;
+        Model* model;
+        bool texelSize;
+    };
+
+    /**
+     * Hidden copy constructor.
+     */
+    PostProcessChain(const PostProcessChain& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    PostProcessChain& operator=(const PostProcessChain&);
+
+    void addPass(const char* output, const char* path, const char* function, const char* inputs, unsigned int divisor, const char* defines, bool pixel);
+
+    void build();
+
+    int findTarget(const std::string& name) const;
+
+    int getInput(const std::string& name, unsigned int divisor, std::vector<Step>& steps);
+
+    bool createMaterial(Step& step);
+
+    void drawStep(Step& step, unsigned int width, unsigned int height);
+
+    void releaseTargets(int stepIndex);
+
+    RenderTargetPool* _pool;
+    bool _ownsPool;
+    bool _built;
+    bool _active;
+    std::vector<PassDesc> _passes;
+    std::vector<Step> _steps;
+    std::vector<Target> _targets;
+    Mesh* _quad;
+    Rectangle _viewport;
+    FrameBuffer* _previousFrameBuffer;
+};
+
+}
+
+#endif
@@ -0,0 +1,688 @@
+#include "Base.h"
+#include "Profiler.h"
+#include "FileSystem.h"
+#include "Stream.h"
+
+// The number of markers that the ring buffer of each thread holds
+#define PROFILER_BUFFER_SIZE 8192
+
+// The number of frames that the GPU markers are kept for before their queries are read back
+#define PROFILER_GPU_LATENCY 4
+
+#ifdef _MSC_VER
+#define PROFILER_THREAD_LOCAL __declspec(thread)
+#else
+#define PROFILER_THREAD_LOCAL __thread
+#endif
+
+namespace gameplay
+{
+
+/**
+ * A recorded marker, with its times in microseconds.
+ */
+struct ProfilerEvent
+{
+    const char* name;
+    long long start;
+    long long end;
+    unsigned int depth;
+    unsigned int thread;
+};
+
+/**
+ * The markers recorded by a thread. The thread is the only writer of its ring buffer and the
+ * game thread the only reader, so the buffer needs no lock.
+ */
+struct ProfilerThread
+{
+    ProfilerEvent events[PROFILER_BUFFER_SIZE];
+    std::atomic<unsigned int> write;
+    std::atomic<unsigned int> read;
+    unsigned int depth;
+    unsigned int index;
+    char name[32];
+};
+
+// The buffers are kept for the lifetime of the process, since markers may still be running when the game shuts down.
+static PROFILER_THREAD_LOCAL ProfilerThread* __profilerThread = NULL;
+static std::mutex __threadsMutex;
+static std::vector<ProfilerThread*> __threads;
+static std::atomic<bool> __capturing(false);
+static std::atomic<unsigned int> __dropped(0);
+static std::vector<ProfilerEvent> __capture;
+static unsigned int __captureFrames = 0;
+static unsigned int __capturedFrames = 0;
+static bool __frameStarted = false;
+static std::string __captureFile;
+static std::atomic<unsigned int> __captureId(0);
+static std::mutex __sampleNamesMutex;
+static std::set<std::string> __sampleNames;
+
+#ifdef GP_USE_GPU_TIMER
+/**
+ * A GPU marker whose timestamp queries have not been read back yet.
+ */
+struct ProfilerGpuEvent
+{
+    const char* name;
+    unsigned int depth;
+    unsigned int thread;
+    GLuint begin;
+    GLuint end;
+};
+
+/**
+ * The GPU markers of a frame, with the offset from GPU to CPU time when the frame started.
+ */
+struct ProfilerGpuFrame
+{
+    std::vector<ProfilerGpuEvent> events;
+    long long offset;
+};
+
+static ProfilerGpuFrame __gpuFrames[PROFILER_GPU_LATENCY];
+static unsigned int __gpuFrame = 0;
+static unsigned int __gpuDepth = 0;
+static int __gpuTargetEvent = -1;
+static std::vector<GLuint> __gpuQueries;
+static ProfilerThread* __gpuThread = NULL;
+static ProfilerThread* __gpuTargetThread = NULL;
+static std::set<std::string> __gpuTargetNames;
+#endif
+
+static long long getTime()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static ProfilerThread* getThread()
+{
+    ProfilerThread* thread = __profilerThread;
+    if (thread == NULL)
+    {
+        thread = new ProfilerThread();
+        thread->write = 0;
+        thread->read = 0;
+        thread->depth = 0;
+
+        std::lock_guard<std::mutex> lock(__threadsMutex);
+        thread->index = (unsigned int)__threads.size();
+        sprintf(thread->name, "Thread %u", thread->index);
+        __threads.push_back(thread);
+        __profilerThread = thread;
+    }
+    return thread;
+}
+
+static ProfilerThread* createTrack(const char* name)
+{
+    // Tracks are listed with the threads, but no thread records into their buffers.
+    ProfilerThread* track = new ProfilerThread();
+    track->write = 0;
+    track->read = 0;
+    track->depth = 0;
+
+    std::lock_guard<std::mutex> lock(__threadsMutex);
+    track->index = (unsigned int)__threads.size();
+    strncpy(track->name, name, sizeof(track->name) - 1);
+    track->name[sizeof(track->name) - 1] = '\0';
+    __threads.push_back(track);
+    return track;
+}
+
+static void recordEvent(ProfilerThread* thread, const char* name, long long start, long long end, unsigned int depth)
+{
+    unsigned int write = thread->write.load(std::memory_order_relaxed);
+    if (write - thread->read.load(std::memory_order_acquire) >= PROFILER_BUFFER_SIZE)
+    {
+        __dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    ProfilerEvent& event = thread->events[write % PROFILER_BUFFER_SIZE];
+    event.name = name;
+    event.start = start;
+    event.end = end;
+    event.depth = depth;
+    event.thread = thread->index;
+    thread->write.store(write + 1, std::memory_order_release);
+}
+
+#ifdef GP_USE_GPU_TIMER
+
+static int beginGpuEvent(const char* name, ProfilerThread* track, unsigned int depth)
+{
+    ProfilerGpuEvent event;
+    event.name = name;
+    event.depth = depth;
+    event.thread = track->index;
+    GLuint queries[2];
+    for (unsigned int i = 0; i < 2; ++i)
+    {
+        if (__gpuQueries.empty())
+        {
+            GL_ASSERT( glGenQueries(1, &queries[i]) );
+        }
+        else
+        {
+            queries[i] = __gpuQueries.back();
+            __gpuQueries.pop_back();
+        }
+    }
+    event.begin = queries[0];
+    event.end = queries[1];
+    GL_ASSERT( glQueryCounter(event.begin, GL_TIMESTAMP) );
+
+    std::vector<ProfilerGpuEvent>& events = __gpuFrames[__gpuFrame].events;
+    events.push_back(event);
+    return (int)events.size() - 1;
+}
+
+static void endGpuEvent(int index)
+{
+    GL_ASSERT( glQueryCounter(__gpuFrames[__gpuFrame].events[index].end, GL_TIMESTAMP) );
+}
+
+static void resolveGpuFrame(ProfilerGpuFrame& frame)
+{
+    if (frame.events.empty())
+        return;
+
+    // The timestamps are meaningless when the GPU was interrupted, for example by a change of its clock.
+    bool valid = true;
+#ifdef OPENGL_ES
+    GLint disjoint = 0;
+    GL_ASSERT( glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint) );
+    valid = disjoint == 0;
+#endif
+
+    for (size_t i = 0, count = frame.events.size(); i < count; ++i)
+    {
+        const ProfilerGpuEvent& gpuEvent = frame.events[i];
+        if (valid)
+        {
+            // The frame was issued a few frames ago, so its results are normally available without waiting.
+            GLuint64 begin = 0;
+            GLuint64 end = 0;
+            GL_ASSERT( glGetQueryObjectui64v(gpuEvent.begin, GL_QUERY_RESULT, &begin) );
+            GL_ASSERT( glGetQueryObjectui64v(gpuEvent.end, GL_QUERY_RESULT, &end) );
+
+            ProfilerEvent event;
+            event.name = gpuEvent.name;
+            event.start = (long long)(begin / 1000) + frame.offset;
+            event.end = (long long)(end / 1000) + frame.offset;
+            event.depth = gpuEvent.depth;
+            event.thread = gpuEvent.thread;
+            __capture.push_back(event);
+        }
+        __gpuQueries.push_back(gpuEvent.begin);
+        __gpuQueries.push_back(gpuEvent.end);
+    }
+    frame.events.clear();
+}
+
+static void updateGpuFrames()
+{
+    if (__gpuTargetEvent >= 0)
+    {
+        endGpuEvent(__gpuTargetEvent);
+        __gpuTargetEvent = -1;
+    }
+
+    // The oldest frame is read back and reused for the frame that starts now.
+    __gpuFrame = (__gpuFrame + 1) % PROFILER_GPU_LATENCY;
+    ProfilerGpuFrame& frame = __gpuFrames[__gpuFrame];
+    resolveGpuFrame(frame);
+
+    // Align the GPU clock to the CPU clock for the markers of this frame.
+    frame.offset = 0;
+    if (__capturing && Profiler::isGpuTimerSupported())
+    {
+#ifdef __ANDROID__
+        if (glGetInteger64v)
+#endif
+        {
+            GLint64 gpuTime = 0;
+            GL_ASSERT( glGetInteger64v(GL_TIMESTAMP, &gpuTime) );
+            frame.offset = getTime() - (long long)(gpuTime / 1000);
+        }
+    }
+}
+
+#endif
+
+static void collectEvents(bool keep)
+{
+    std::lock_guard<std::mutex> lock(__threadsMutex);
+    for (size_t i = 0, count = __threads.size(); i < count; ++i)
+    {
+        ProfilerThread* thread = __threads[i];
+        unsigned int read = thread->read.load(std::memory_order_relaxed);
+        unsigned int write = thread->write.load(std::memory_order_acquire);
+        if (keep)
+        {
+            for (; read != write; ++read)
+                __capture.push_back(thread->events[read % PROFILER_BUFFER_SIZE]);
+        }
+        thread->read.store(write, std::memory_order_release);
+    }
+}
+
+Profiler::Scope::Scope(const char* name)
+    : _name(NULL), _start(0)
+{
+    if (__capturing.load(std::memory_order_relaxed))
+    {
+        _name = name;
+        ++getThread()->depth;
+        _start = getTime();
+    }
+}
+
+Profiler::Scope::~Scope()
+{
+    if (_name == NULL)
+        return;
+
+    long long end = getTime();
+    ProfilerThread* thread = __profilerThread;
+    GP_ASSERT(thread && thread->depth > 0);
+    unsigned int depth = --thread->depth;
+    recordEvent(thread, _name, _start, end, depth);
+}
+
+Profiler::GpuScope::GpuScope(const char* name)
+    : _event(-1)
+{
+#ifdef GP_USE_GPU_TIMER
+    if (__capturing.load(std::memory_order_relaxed) && isGpuTimerSupported())
+    {
+        if (__gpuThread == NULL)
+            __gpuThread = createTrack("GPU");
+        _event = beginGpuEvent(name, __gpuThread, __gpuDepth++);
+    }
+#endif
+}
+
+Profiler::GpuScope::~GpuScope()
+{
+#ifdef GP_USE_GPU_TIMER
+    if (_event >= 0)
+    {
+        GP_ASSERT(__gpuDepth > 0);
+        --__gpuDepth;
+        endGpuEvent(_event);
+    }
+#endif
+}
+
+Profiler::Sampler::Sampler(const char* track)
+    : _trackName(track ? track : "Samples"), _track(NULL), _capture(0)
+{
+}
+
+Profiler::Sampler::~Sampler()
+{
+    end();
+}
+
+void Profiler::Sampler::sample(const char* const* frames, unsigned int count)
+{
+    GP_ASSERT(frames || count == 0);
+
+    // The markers that were open when the last capture stopped are not part of the running one.
+    unsigned int capture = __captureId.load(std::memory_order_relaxed);
+    if (!__capturing.load(std::memory_order_relaxed) || capture != _capture)
+    {
+        _open.clear();
+        _capture = capture;
+        if (!__capturing.load(std::memory_order_relaxed))
+            return;
+    }
+    if (_track == NULL)
+        _track = createTrack(_trackName.c_str());
+
+    long long time = getTime();
+
+    // Keep the markers of the outer frames that the last sample shares with this one.
+    size_t depth = 0;
+    while (depth < _open.size() && depth < count && strcmp(_open[depth].first, frames[depth]) == 0)
+        ++depth;
+    close(depth, time);
+
+    if (depth < count)
+    {
+        std::lock_guard<std::mutex> lock(__sampleNamesMutex);
+        for (size_t i = depth; i < count; ++i)
+            _open.push_back(std::make_pair(__sampleNames.insert(frames[i]).first->c_str(), time));
+    }
+}
+
+void Profiler::Sampler::end()
+{
+    if (_open.empty())
+        return;
+
+    if (__capturing.load(std::memory_order_relaxed) && _capture == __captureId.load(std::memory_order_relaxed))
+        close(0, getTime());
+    _open.clear();
+}
+
+void Profiler::Sampler::close(size_t depth, long long time)
+{
+    GP_ASSERT(depth == _open.size() || _track);
+
+    while (_open.size() > depth)
+    {
+        const std::pair<const char*, long long>& frame = _open.back();
+        recordEvent(_track, frame.first, frame.second, time, (unsigned int)_open.size() - 1);
+        _open.pop_back();
+    }
+}
+
+bool Profiler::isGpuTimerSupported()
+{
+#ifdef GP_USE_GPU_TIMER
+    static int supported = -1;
+    if (supported == -1)
+    {
+        const char* extString = (const char*)glGetString(GL_EXTENSIONS);
+        supported = (extString && (strstr(extString, "GL_ARB_timer_query") || strstr(extString, "GL_EXT_disjoint_timer_query"))) ? 1 : 0;
+    }
+    return supported == 1;
+#else
+    return false;
+#endif
+}
+
+void Profiler::markGpuTarget(const char* name)
+{
+#ifdef GP_USE_GPU_TIMER
+    GP_ASSERT(name);
+
+    if (__gpuTargetEvent >= 0)
+    {
+        endGpuEvent(__gpuTargetEvent);
+        __gpuTargetEvent = -1;
+    }
+    if (__capturing.load(std::memory_order_relaxed) && isGpuTimerSupported())
+    {
+        if (__gpuTargetThread == NULL)
+            __gpuTargetThread = createTrack("GPU render targets");
+        const char* targetName = __gpuTargetNames.insert(*name ? name : "Default").first->c_str();
+        __gpuTargetEvent = beginGpuEvent(targetName, __gpuTargetThread, 0);
+    }
+#endif
+}
+
+void Profiler::setThreadName(const char* name)
+{
+    GP_ASSERT(name);
+
+    ProfilerThread* thread = getThread();
+    std::lock_guard<std::mutex> lock(__threadsMutex);
+    strncpy(thread->name, name, sizeof(thread->name) - 1);
+    thread->name[sizeof(thread->name) - 1] = '\0';
+}
+
+void Profiler::startCapture(unsigned int frames)
+{
+    if (__capturing)
+        return;
+
+    // Discard the markers that were still running when the last capture stopped.
+    collectEvents(false);
+    ++__captureId;
+    __captureFrames = frames;
+    __frameStarted = false;
+    __capturing = true;
+}
+
+void Profiler::stopCapture()
+{
+    if (!__capturing)
+        return;
+
+    __capturing = false;
+    collectEvents(true);
+
+#ifdef GP_USE_GPU_TIMER
+    // Wait for the GPU markers that are still in flight, so that the capture is complete.
+    if (__gpuTargetEvent >= 0)
+    {
+        endGpuEvent(__gpuTargetEvent);
+        __gpuTargetEvent = -1;
+    }
+    for (unsigned int i = 1; i <= PROFILER_GPU_LATENCY; ++i)
+        resolveGpuFrame(__gpuFrames[(__gpuFrame + i) % PROFILER_GPU_LATENCY]);
+#endif
+}
+
+bool Profiler::isCapturing()
+{
+    return __capturing;
+}
+
+unsigned int Profiler::getCapturedCount()
+{
+    return (unsigned int)__capture.size();
+}
+
+unsigned int Profiler::getDroppedCount()
+{
+    return __dropped;
+}
+
+unsigned int Profiler::getCapturedFrameCount()
+{
+    return __capturedFrames;
+}
+
+double Profiler::getCapturedTime(const char* name, bool gpu, unsigned int* count)
+{
+    GP_ASSERT(name);
+
+    // The GPU markers are recorded on their own tracks.
+    int gpuTracks[2] = { -1, -1 };
+#ifdef GP_USE_GPU_TIMER
+    if (__gpuThread)
+        gpuTracks[0] = (int)__gpuThread->index;
+    if (__gpuTargetThread)
+        gpuTracks[1] = (int)__gpuTargetThread->index;
+#endif
+
+    long long time = 0;
+    unsigned int markers = 0;
+    for (size_t i = 0, size = __capture.size(); i < size; ++i)
+    {
+        const ProfilerEvent& event = __capture[i];
+        bool gpuEvent = (int)event.thread == gpuTracks[0] || (int)event.thread == gpuTracks[1];
+        if (gpuEvent == gpu && (event.name == name || strcmp(event.name, name) == 0))
+        {
+            time += event.end - event.start;
+            ++markers;
+        }
+    }
+    if (count)
+        *count = markers;
+    return time / 1000.0;
+}
+
+void Profiler::clearCapture()
+{
+    __capture.clear();
+    __capturedFrames = 0;
+    __dropped = 0;
+}
+
+void Profiler::updateFrame()
+{
+#ifdef GP_USE_GPU_TIMER
+    updateGpuFrames();
+#endif
+
+    if (!__capturing)
+        return;
+
+    collectEvents(true);
+    if (!__frameStarted)
+    {
+        // The frame that starts now is the first frame of the capture.
+        __frameStarted = true;
+        return;
+    }
+
+    ++__capturedFrames;
+    if (__captureFrames > 0 && --__captureFrames == 0)
+    {
+        stopCapture();
+        if (!__captureFile.empty())
+        {
+            saveChromeTrace(__captureFile.c_str());
+            __captureFile.clear();
+        }
+    }
+}
+
+void Profiler::setCaptureFile(const char* path)
+{
+    __captureFile = path ? path : "";
+}
+
+void Profiler::finalize()
+{
+    stopCapture();
+    if (!__captureFile.empty())
+    {
+        saveChromeTrace(__captureFile.c_str());
+        __captureFile.clear();
+    }
+    clearCapture();
+
+#ifdef GP_USE_GPU_TIMER
+    if (!__gpuQueries.empty())
+    {
+        GL_ASSERT( glDeleteQueries((GLsizei)__gpuQueries.size(), &__gpuQueries[0]) );
+        __gpuQueries.clear();
+    }
+#endif
+}
+
+bool Profiler::saveChromeTrace(const char* path)
+{
+    GP_ASSERT(path);
+
+    std::unique_ptr<Stream> stream(FileSystem::open(path, FileSystem::WRITE));
+    if (stream.get() == NULL)
+    {
+        GP_WARN("Failed to open file '%s' to save a profile.", path);
+        return false;
+    }
+
+    // Chrome traces take their times in microseconds, which start at the first captured marker.
+    long long origin = 0;
+    for (size_t i = 0, count = __capture.size(); i < count; ++i)
+    {
+        if (i == 0 || __capture[i].start < origin)
+            origin = __capture[i].start;
+    }
+
+    std::string text = "{\"traceEvents\":[";
+    char line[256];
+    {
+        std::lock_guard<std::mutex> lock(__threadsMutex);
+        for (size_t i = 0, count = __threads.size(); i < count; ++i)
+        {
+            sprintf(line, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                i > 0 ? "," : "", __threads[i]->index, __threads[i]->name);
+            text += line;
+        }
+    }
+    for (size_t i = 0, count = __capture.size(); i < count; ++i)
+    {
+        const ProfilerEvent& event = __capture[i];
+        snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%lld,\"dur\":%lld}",
+            event.name, event.thread, event.start - origin, event.end - event.start);
+        text += line;
+    }
+    text += "\n]}\n";
+
+    if (stream->write(text.c_str(), 1, text.size()) != text.size())
+    {
+        GP_WARN("Failed to write the profile to file '%s'.", path);
+        return false;
+    }
+    return true;
+}
+
+static bool compareEvents(const ProfilerEvent& a, const ProfilerEvent& b)
+{
+    if (a.thread != b.thread)
+        return a.thread < b.thread;
+    if (a.start != b.start)
+        return a.start < b.start;
+    return a.depth < b.depth;
+}
+
+void Profiler::printSummary()
+{
+    struct Summary
+    {
+        const char* name;
+        unsigned int depth;
+        long long time;
+        unsigned int calls;
+    };
+
+    if (__capture.empty())
+    {
+        print("No markers have been captured.\n");
+        return;
+    }
+
+    std::vector<ProfilerEvent> events(__capture);
+    std::sort(events.begin(), events.end(), compareEvents);
+
+    // Markers are grouped by the path of the markers that enclose them. The separator sorts
+    // before any printable character, so the children of a marker follow it in the map.
+    std::map<std::string, Summary> summaries;
+    std::vector<std::string> paths;
+    unsigned int frames = std::max(1u, __capturedFrames);
+    for (size_t i = 0, count = events.size(); i <= count; ++i)
+    {
+        if (i == count || (i > 0 && events[i].thread != events[i - 1].thread))
+        {
+            std::string threadName;
+            {
+                std::lock_guard<std::mutex> lock(__threadsMutex);
+                threadName = __threads[events[i - 1].thread]->name;
+            }
+            print("%s:\n", threadName.c_str());
+            for (std::map<std::string, Summary>::const_iterator itr = summaries.begin(); itr != summaries.end(); ++itr)
+            {
+                const Summary& summary = itr->second;
+                print("%*s%s: %.3f ms in %u calls, %.3f ms per frame\n", (int)(summary.depth + 1) * 2, "", summary.name,
+                    summary.time / 1000.0, summary.calls, summary.time / 1000.0 / frames);
+            }
+            summaries.clear();
+            if (i == count)
+                break;
+        }
+
+        const ProfilerEvent& event = events[i];
+        paths.resize(event.depth + 1);
+        paths[event.depth] = event.depth > 0 ? paths[event.depth - 1] + '\1' + event.name : event.name;
+
+        std::map<std::string, Summary>::iterator itr = summaries.find(paths[event.depth]);
+        if (itr == summaries.end())
+        {
+            Summary summary = { event.name, event.depth, 0, 0 };
+            itr = summaries.insert(std::make_pair(paths[event.depth], summary)).first;
+        }
+        itr->second.time += event.end - event.start;
+        ++itr->second.calls;
+    }
+}
+
+}
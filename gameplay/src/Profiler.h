@@ -0,0 +1,311 @@
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+namespace gameplay
+{
+
+struct ProfilerThread;
+
+/**
+ * Defines a hierarchical CPU profiler that records the time spent in scoped markers.
+ *
+ * A marker is placed with the GP_PROFILE_SCOPE macro, which times the enclosing scope:
+ *
+ * @code
+ * void MyController::update(float elapsedTime)
+ * {
+ *     GP_PROFILE_SCOPE("MyController::update");
+ *     ...
+ * }
+ * @endcode
+ *
+ * The markers are only compiled in when GP_USE_PROFILER is defined, which it is by default
+ * in debug builds. In other builds the macro expands to nothing and has no cost.
+ *
+ * Markers are only recorded while a capture is running. Each thread records its markers into
+ * its own ring buffer without locking, and the Game moves them into the capture at the start
+ * of each frame. Markers that are nested on the same thread form a hierarchy, which can be
+ * printed as a summary (see printSummary) or saved in the Chrome trace event format (see
+ * saveChromeTrace). Chrome traces can be viewed in chrome://tracing or Perfetto, and can be
+ * converted for Tracy with its import-chrome tool.
+ *
+ * A capture can be started when the game starts from the game.config file:
+ *
+ * @code
+ * profiler
+ * {
+ *     frames = 600
+ *     file = profile.json
+ * }
+ * @endcode
+ *
+ * This captures the specified number of frames and saves them as a Chrome trace to the file,
+ * when it is set, once they have been captured or when the game exits.
+ *
+ * The time that the GPU spends on the graphics commands issued in a scope is measured with the
+ * GP_PROFILE_GPU_SCOPE macro, and the time spent drawing into each frame buffer is measured when
+ * frame buffers are bound. These markers use GL timestamp queries (ARB_timer_query, or
+ * EXT_disjoint_timer_query on OpenGL ES) and are read back a few frames later, so that reading them
+ * does not stall the GPU. They are shown on their own tracks, aligned to the timeline of the CPU
+ * markers. GPU markers must only be placed on the thread that owns the graphics context.
+ *
+ * Call stacks that are sampled rather than instrumented, like the ones of Lua scripts (see
+ * ScriptController::setProfiling), are recorded with a Sampler on a track of their own, where the
+ * frames that consecutive samples share are merged into markers.
+ *
+ * @script{ignore}
+ */
+class Profiler
+{
+    friend class Game;
+
+public:
+
+    /**
+     * Records the time spent from its construction to its destruction as a marker.
+     *
+     * Use the GP_PROFILE_SCOPE macro rather than this class, so that the marker compiles out
+     * when the profiler is not used.
+     */
+    class Scope
+    {
+    public:
+
+        /**
+         * Starts a marker.
+         *
+         * @param name The name of the marker, which must stay valid until the capture is released,
+         *      so it should be a string literal.
+         */
+        explicit Scope(const char* name);
+
+        /**
+         * Ends the marker.
+         */
+        ~Scope();
+
+    private:
+
+        Scope(const Scope& copy);
+
+        Scope& operator=(const Scope&);
+
+        const char* _name;
+        long long _start;
+    };
+
+    /**
+     * Records the time that the GPU spends on the graphics commands issued from its construction
+     * to its destruction as a GPU marker.
+     *
+     * Use the GP_PROFILE_GPU_SCOPE macro rather than this class, so that the marker compiles out
+     * when the profiler is not used.
+     */
+    class GpuScope
+    {
+    public:
+
+        /**
+         * Starts a GPU marker.
+         *
+         * @param name The name of the marker, which should be a string literal.
+         */
+        explicit GpuScope(const char* name);
+
+        /**
+         * Ends the GPU marker.
+         */
+        ~GpuScope();
+
+    private:
+
+        GpuScope(const GpuScope& copy);
+
+        GpuScope& operator=(const GpuScope&);
+
+        int _event;
+    };
+
+    /**
+     * Records sampled call stacks as markers on a track of the capture.
+     *
+     * Each frame of a stack is shown as a marker that starts at the first sample it is in and ends
+     * at the first sample it is no longer in, nested by its depth in the stack. A sampler must only
+     * be used from one thread at a time, and only records while a capture is running.
+     */
+    class Sampler
+    {
+    public:
+
+        /**
+         * Constructor.
+         *
+         * @param track The name of the track that the markers are shown on, which is created when
+         *      the first sample is recorded.
+         */
+        explicit Sampler(const char* track);
+
+        /**
+         * Destructor. Ends the markers of the last sample.
+         */
+        ~Sampler();
+
+        /**
+         * Records a sampled call stack at the current time.
+         *
+         * @param frames The names of the frames of the stack, from the outermost to the innermost,
+         *      which are copied.
+         * @param count The number of frames.
+         */
+        void sample(const char* const* frames, unsigned int count);
+
+        /**
+         * Ends the markers of the last sample, when the sampled code stops running.
+         */
+        void end();
+
+    private:
+
+        Sampler(const Sampler& copy);
+
+        Sampler& operator=(const Sampler&);
+
+        void close(size_t depth, long long time);
+
+        std::string _trackName;
+        ProfilerThread* _track;
+        unsigned int _capture;
+        std::vector<std::pair<const char*, long long> > _open;
+    };
+
+    /**
+     * Returns whether the GPU markers can be timed on this device.
+     *
+     * @return true if GL timestamp queries are supported, false otherwise.
+     */
+    static bool isGpuTimerSupported();
+
+    /**
+     * Ends the marker of the render target that is being drawn into and starts a marker for the
+     * specified one. This is done by the frame buffers when they are bound.
+     *
+     * @param name The name of the render target, which is copied.
+     */
+    static void markGpuTarget(const char* name);
+
+    /**
+     * Sets the name that the calling thread is shown with in the captures.
+     *
+     * @param name The name of the thread.
+     */
+    static void setThreadName(const char* name);
+
+    /**
+     * Starts capturing the markers, adding them to the markers captured so far.
+     *
+     * @param frames The number of frames to capture, or 0 to capture until stopCapture is called.
+     */
+    static void startCapture(unsigned int frames = 0);
+
+    /**
+     * Stops capturing the markers.
+     *
+     * The markers that the threads have recorded up to this point are added to the capture.
+     */
+    static void stopCapture();
+
+    /**
+     * Returns whether the markers are being captured.
+     *
+     * @return true if a capture is running, false otherwise.
+     */
+    static bool isCapturing();
+
+    /**
+     * Returns the number of markers in the capture.
+     *
+     * @return The number of captured markers.
+     */
+    static unsigned int getCapturedCount();
+
+    /**
+     * Returns the number of markers that were dropped because the ring buffer of their thread was full.
+     *
+     * @return The number of dropped markers.
+     */
+    static unsigned int getDroppedCount();
+
+    /**
+     * Returns the number of frames that have been captured.
+     *
+     * @return The number of captured frames.
+     */
+    static unsigned int getCapturedFrameCount();
+
+    /**
+     * Returns the total time of the captured markers with the specified name.
+     *
+     * @param name The name of the markers.
+     * @param gpu true to total the GPU markers with the name, false to total the CPU markers.
+     * @param count If not NULL, is set to the number of markers with the name.
+     *
+     * @return The total time of the markers, in milliseconds.
+     */
+    static double getCapturedTime(const char* name, bool gpu = false, unsigned int* count = NULL);
+
+    /**
+     * Releases the markers that have been captured.
+     */
+    static void clearCapture();
+
+    /**
+     * Saves the captured markers in the Chrome trace event format.
+     *
+     * @param path The path of the file to write.
+     *
+     * @return true if the file was written, false otherwise.
+     */
+    static bool saveChromeTrace(const char* path);
+
+    /**
+     * Prints the hierarchy of the captured markers of each thread, with the total time, the number
+     * of calls and the average time per captured frame of each marker.
+     */
+    static void printSummary();
+
+private:
+
+    /**
+     * Adds the markers that the threads have recorded to the capture, and counts the captured frames.
+     */
+    static void updateFrame();
+
+    /**
+     * Sets the file that the capture is saved to when it stops or when the game exits.
+     *
+     * @param path The path of the file, or NULL to not save the capture.
+     */
+    static void setCaptureFile(const char* path);
+
+    /**
+     * Saves the capture that was configured in the game.config file and releases the captured markers
+     * and the GPU queries.
+     */
+    static void finalize();
+};
+
+}
+
+#ifdef GP_USE_PROFILER
+#define GP_PROFILE_CONCAT_(a, b) a##b
+#define GP_PROFILE_CONCAT(a, b) GP_PROFILE_CONCAT_(a, b)
+#define GP_PROFILE_SCOPE(name) gameplay::Profiler::Scope GP_PROFILE_CONCAT(__profileScope, __LINE__)(name)
+#define GP_PROFILE_GPU_SCOPE(name) gameplay::Profiler::GpuScope GP_PROFILE_CONCAT(__profileGpuScope, __LINE__)(name)
+#define GP_PROFILE_GPU_TARGET(name) gameplay::Profiler::markGpuTarget(name)
+#else
+#define GP_PROFILE_SCOPE(name)
+#define GP_PROFILE_GPU_SCOPE(name)
+#define GP_PROFILE_GPU_TARGET(name)
+#endif
+
+#endif
@@ -3,6 +3,14 @@
 #include "FileSystem.h"
 #include "Quaternion.h"
 
+// Precompiled properties files start with a byte that never appears in text files.
+#define PROPERTIES_BINARY_MAGIC     "\x7FGPP"
+#define PROPERTIES_BINARY_VERSION   1
+
+// Number of values in the record of a namespace before its properties, variables and child namespaces:
+// name, id, parent id, property count, variable count and namespace count.
+#define PROPERTIES_BINARY_NAMESPACE_SIZE 6
+
 namespace gameplay
 {
 
@@ -26,12 +34,13 @@ void calculateNamespacePath(const std::string& urlString, std::string& fileStrin
 Properties* getPropertiesFromNamespacePath(Properties* properties, const std::vector<std::string>& namespacePath);
 
 Properties::Properties()
-    : _variables(NULL), _dirPath(NULL), _parent(NULL)
+    : _namespaceHash(hashName("")), _idHash(hashName("")), _variables(NULL), _dirPath(NULL), _parent(NULL)
 {
 }
 
 Properties::Properties(const Properties& copy)
-    : _namespace(copy._namespace), _id(copy._id), _parentID(copy._parentID), _properties(copy._properties), _variables(NULL), _dirPath(NULL), _parent(copy._parent)
+    : _namespace(copy._namespace), _id(copy._id), _parentID(copy._parentID), _namespaceHash(copy._namespaceHash), _idHash(copy._idHash),
+      _properties(copy._properties), _variables(NULL), _dirPath(NULL), _parent(copy._parent)
 {
     setDirectoryPath(copy._dirPath);
     _namespaces = std::vector<Properties*>();
@@ -45,7 +54,7 @@ Properties::Properties(const Properties& copy)
 }
 
 Properties::Properties(Stream* stream)
-    : _variables(NULL), _dirPath(NULL), _parent(NULL)
+    : _namespaceHash(hashName("")), _idHash(hashName("")), _variables(NULL), _dirPath(NULL), _parent(NULL)
 {
     readProperties(stream);
     rewind();
@@ -62,6 +71,7 @@ Properties::Properties(Stream* stream, const char* name, const char* id, const c
     {
         _parentID = parentID;
     }
+    hashNames();
     readProperties(stream);
     rewind();
 }
@@ -87,7 +97,23 @@ Properties* Properties::create(const char* url)
         return NULL;
     }
 
-    Properties* properties = new Properties(stream.get());
+    // Load precompiled files directly, and parse text files otherwise.
+    Properties* properties;
+    char magic[4];
+    if (stream->read(magic, 1, 4) == 4 && memcmp(magic, PROPERTIES_BINARY_MAGIC, 4) == 0)
+    {
+        properties = createFromBinary(stream.get());
+        if (properties == NULL)
+        {
+            GP_WARN("Failed to load precompiled properties file '%s'.", fileString.c_str());
+            return NULL;
+        }
+    }
+    else
+    {
+        stream->rewind();
+        properties = new Properties(stream.get());
+    }
     properties->resolveInheritance();
     stream->close();
 
@@ -112,6 +138,187 @@ Properties* Properties::create(const char* url)
     return p;
 }
 
+bool Properties::compile(const char* filePath, const char* outputPath)
+{
+    GP_ASSERT(filePath);
+    GP_ASSERT(outputPath);
+
+    std::unique_ptr<Stream> stream(FileSystem::open(filePath));
+    if (stream.get() == NULL)
+    {
+        GP_ERROR("Failed to open file '%s'.", filePath);
+        return false;
+    }
+    char magic[4];
+    if (stream->read(magic, 1, 4) == 4 && memcmp(magic, PROPERTIES_BINARY_MAGIC, 4) == 0)
+    {
+        GP_ERROR("Properties file '%s' is already precompiled.", filePath);
+        return false;
+    }
+    stream->rewind();
+
+    // Keep the namespaces as they are written, without resolving inheritance.
+    Properties properties(stream.get());
+    stream->close();
+
+    std::vector<unsigned int> records;
+    std::unordered_map<std::string, unsigned int> strings;
+    std::string stringData;
+    properties.writeBinary(records, strings, stringData);
+
+    std::unique_ptr<Stream> output(FileSystem::open(outputPath, FileSystem::WRITE));
+    if (output.get() == NULL)
+    {
+        GP_ERROR("Failed to create file '%s'.", outputPath);
+        return false;
+    }
+    unsigned int header[4] = { PROPERTIES_BINARY_VERSION, (unsigned int)strings.size(), (unsigned int)stringData.size(), (unsigned int)records.size() };
+    if (output->write(PROPERTIES_BINARY_MAGIC, 1, 4) != 4 ||
+        output->write(header, sizeof(unsigned int), 4) != 4 ||
+        output->write(stringData.c_str(), 1, stringData.size()) != stringData.size() ||
+        (!records.empty() && output->write(&records[0], sizeof(unsigned int), records.size()) != records.size()))
+    {
+        GP_ERROR("Failed to write file '%s'.", outputPath);
+        return false;
+    }
+    return true;
+}
+
+// Returns the index of a string in the string table of a precompiled file, adding it to the table if needed.
+static unsigned int internString(const std::string& str, std::unordered_map<std::string, unsigned int>& strings, std::string& stringData)
+{
+    std::unordered_map<std::string, unsigned int>::const_iterator itr = strings.find(str);
+    if (itr != strings.end())
+        return itr->second;
+
+    unsigned int index = (unsigned int)strings.size();
+    strings.insert(std::make_pair(str, index));
+    stringData.append(str.c_str(), str.length() + 1);
+    return index;
+}
+
+void Properties::writeBinary(std::vector<unsigned int>& records, std::unordered_map<std::string, unsigned int>& strings, std::string& stringData) const
+{
+    records.push_back(internString(_namespace, strings, stringData));
+    records.push_back(internString(_id, strings, stringData));
+    records.push_back(internString(_parentID, strings, stringData));
+    records.push_back((unsigned int)_properties.size());
+    records.push_back(_variables ? (unsigned int)_variables->size() : 0);
+    records.push_back((unsigned int)_namespaces.size());
+
+    for (std::list<Property>::const_iterator itr = _properties.begin(); itr != _properties.end(); ++itr)
+    {
+        records.push_back(internString(itr->name, strings, stringData));
+        records.push_back(internString(itr->value, strings, stringData));
+    }
+    if (_variables)
+    {
+        for (size_t i = 0, count = _variables->size(); i < count; ++i)
+        {
+            records.push_back(internString((*_variables)[i].name, strings, stringData));
+            records.push_back(internString((*_variables)[i].value, strings, stringData));
+        }
+    }
+    for (size_t i = 0, count = _namespaces.size(); i < count; ++i)
+    {
+        GP_ASSERT(_namespaces[i]);
+        _namespaces[i]->writeBinary(records, strings, stringData);
+    }
+}
+
+Properties* Properties::createFromBinary(Stream* stream)
+{
+    GP_ASSERT(stream);
+
+    // Read the tables that follow the magic number.
+    unsigned int header[4];
+    if (stream->read(header, sizeof(unsigned int), 4) != 4 || header[0] != PROPERTIES_BINARY_VERSION)
+        return NULL;
+    unsigned int stringCount = header[1];
+    std::vector<char> stringData(header[2]);
+    std::vector<unsigned int> records(header[3]);
+    if ((!stringData.empty() && stream->read(&stringData[0], 1, stringData.size()) != stringData.size()) ||
+        (!records.empty() && stream->read(&records[0], sizeof(unsigned int), records.size()) != records.size()))
+    {
+        return NULL;
+    }
+
+    // Find the strings, which are stored one after the other with their terminators.
+    std::vector<const char*> strings;
+    strings.reserve(stringCount);
+    for (size_t offset = 0, length = stringData.size(); offset < length && strings.size() < stringCount;)
+    {
+        const char* str = &stringData[offset];
+        const char* terminator = (const char*)memchr(str, '\0', length - offset);
+        if (terminator == NULL)
+            return NULL;
+        strings.push_back(str);
+        offset += (terminator - str) + 1;
+    }
+    if (strings.size() != stringCount || records.empty())
+        return NULL;
+
+    Properties* properties = new Properties();
+    const unsigned int* record = &records[0];
+    if (!properties->readBinary(record, record + records.size(), strings))
+    {
+        SAFE_DELETE(properties);
+        return NULL;
+    }
+    return properties;
+}
+
+bool Properties::readBinary(const unsigned int*& records, const unsigned int* end, const std::vector<const char*>& strings)
+{
+    if (end - records < PROPERTIES_BINARY_NAMESPACE_SIZE)
+        return false;
+
+    unsigned int stringCount = (unsigned int)strings.size();
+    if (records[0] >= stringCount || records[1] >= stringCount || records[2] >= stringCount)
+        return false;
+    _namespace = strings[records[0]];
+    _id = strings[records[1]];
+    _parentID = strings[records[2]];
+    hashNames();
+    unsigned int propertyCount = records[3];
+    unsigned int variableCount = records[4];
+    unsigned int namespaceCount = records[5];
+    records += PROPERTIES_BINARY_NAMESPACE_SIZE;
+
+    if ((size_t)(end - records) < ((size_t)propertyCount + variableCount) * 2)
+        return false;
+    for (unsigned int i = 0; i < propertyCount; ++i, records += 2)
+    {
+        if (records[0] >= stringCount || records[1] >= stringCount)
+            return false;
+        _properties.push_back(Property(strings[records[0]], strings[records[1]]));
+    }
+    if (variableCount > 0)
+    {
+        _variables = new std::vector<Property>();
+        _variables->reserve(variableCount);
+        for (unsigned int i = 0; i < variableCount; ++i, records += 2)
+        {
+            if (records[0] >= stringCount || records[1] >= stringCount)
+                return false;
+            _variables->push_back(Property(strings[records[0]], strings[records[1]]));
+        }
+    }
+
+    _namespaces.reserve(namespaceCount);
+    for (unsigned int i = 0; i < namespaceCount; ++i)
+    {
+        Properties* space = new Properties();
+        space->_parent = this;
+        _namespaces.push_back(space);
+        if (!space->readBinary(records, end, strings))
+            return false;
+    }
+
+    rewind();
+    return true;
+}
+
 static bool isVariable(const char* str, char* outName, size_t outSize)
 {
     size_t len = strlen(str);
@@ -601,16 +808,22 @@ Properties* Properties::getNamespace(const char* id, bool searchNames, bool recu
 {
     GP_ASSERT(id);
 
+    return findNamespace(id, hashName(id), searchNames, recurse);
+}
+
+Properties* Properties::findNamespace(const char* id, unsigned int hash, bool searchNames, bool recurse) const
+{
     for (std::vector<Properties*>::const_iterator it = _namespaces.begin(); it < _namespaces.end(); ++it)
     {
         Properties* p = *it;
-        if (strcmp(searchNames ? p->_namespace.c_str() : p->_id.c_str(), id) == 0)
+        if ((searchNames ? p->_namespaceHash : p->_idHash) == hash &&
+            strcmp(searchNames ? p->_namespace.c_str() : p->_id.c_str(), id) == 0)
             return p;
         
         if (recurse)
         {
             // Search recursively.
-            p = p->getNamespace(id, searchNames, true);
+            p = p->findNamespace(id, hash, searchNames, true);
             if (p)
                 return p;
         }
@@ -629,18 +842,43 @@ const char* Properties::getId() const
     return _id.c_str();
 }
 
-bool Properties::exists(const char* name) const
+unsigned int Properties::hashName(const char* str)
+{
+    GP_ASSERT(str);
+
+    // FNV-1a
+    unsigned int hash = 2166136261u;
+    for (; *str; ++str)
+    {
+        hash ^= (unsigned char)*str;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+const Properties::Property* Properties::findProperty(const char* name) const
 {
     if (name == NULL)
-        return false;
+        return NULL;
 
+    unsigned int hash = hashName(name);
     for (std::list<Property>::const_iterator itr = _properties.begin(); itr != _properties.end(); ++itr)
     {
-        if (itr->name == name)
-            return true;
+        if (itr->hash == hash && itr->name == name)
+            return &(*itr);
     }
+    return NULL;
+}
 
-    return false;
+void Properties::hashNames()
+{
+    _namespaceHash = hashName(_namespace.c_str());
+    _idHash = hashName(_id.c_str());
+}
+
+bool Properties::exists(const char* name) const
+{
+    return findProperty(name) != NULL;
 }
 
 static const bool isStringNumeric(const char* str)
@@ -724,14 +962,9 @@ const char* Properties::getString(const char* name, const char* defaultValue) co
             return getVariable(variable, defaultValue);
         }
 
-        for (std::list<Property>::const_iterator itr = _properties.begin(); itr != _properties.end(); ++itr)
-        {
-            if (itr->name == name)
-            {
-                value = itr->value.c_str();
-                break;
-            }
-        }
+        const Property* prop = findProperty(name);
+        if (prop)
+            value = prop->value.c_str();
     }
     else
     {
@@ -758,14 +991,12 @@ bool Properties::setString(const char* name, const char* value)
 {
     if (name)
     {
-        for (std::list<Property>::iterator itr = _properties.begin(); itr != _properties.end(); ++itr)
+        // Update the first property that matches this name
+        Property* prop = const_cast<Property*>(findProperty(name));
+        if (prop)
         {
-            if (itr->name == name)
-            {
-                // Update the first property that matches this name
-                itr->value = value ? value : "";
-                return true;
-            }
+            prop->value = value ? value : "";
+            return true;
         }
 
         // There is no property with this name, so add one
@@ -1010,6 +1241,8 @@ Properties* Properties::clone()
     p->_namespace = _namespace;
     p->_id = _id;
     p->_parentID = _parentID;
+    p->_namespaceHash = _namespaceHash;
+    p->_idHash = _idHash;
     p->_properties = _properties;
     p->_propertiesItr = p->_properties.end();
     p->setDirectoryPath(_dirPath);
@@ -148,6 +148,9 @@ public:
      * the format "<file-path>.<extension>#<namespace-id>/<namespace-id>/.../<namespace-id>"
      * (and "#<namespace-id>/<namespace-id>/.../<namespace-id>" is optional).
      * 
+     * The file can either be a text properties file or a binary file that was
+     * precompiled from one with compile(), which is detected from its contents.
+     *
      * @param url The URL to create the properties from.
      * 
      * @return The created Properties or NULL if there was an error.
@@ -155,6 +158,23 @@ public:
      */
     static Properties* create(const char* url);
 
+    /**
+     * Precompiles a text properties file (such as a .material, .scene, .form or .physics file)
+     * into a binary file that create() loads without parsing any text.
+     *
+     * The binary file holds the namespaces, properties and variables as they are written in the
+     * text file, with each distinct string stored once. Inheritance and variables are resolved
+     * when the binary file is loaded, exactly as for the text file, so the binary file can be
+     * put in place of the text file (for example in a pack archive) without any other changes.
+     *
+     * @param filePath The path of the text properties file.
+     * @param outputPath The path to write the binary file to, which may be the same as filePath.
+     *
+     * @return True if the file was compiled, false if it could not be read or written.
+     * @script{ignore}
+     */
+    static bool compile(const char* filePath, const char* outputPath);
+
     /**
      * Destructor.
      */
@@ -510,14 +530,38 @@ private:
     
     /**
      * Internal structure containing a single property.
+     *
+     * The hash of the name is computed once, so that lookups only compare
+     * the names of properties whose hash matches.
      */
     struct Property
     {
         std::string name;
         std::string value;
-        Property(const char* name, const char* value) : name(name), value(value) { }
+        unsigned int hash;
+        Property(const char* name, const char* value) : name(name), value(value), hash(hashName(name)) { }
     };
 
+    /**
+     * Returns the hash of a property or namespace name.
+     */
+    static unsigned int hashName(const char* str);
+
+    /**
+     * Finds the first property with the specified name.
+     */
+    const Property* findProperty(const char* name) const;
+
+    /**
+     * Finds a namespace by name or ID, given the hash of the name or ID (see getNamespace).
+     */
+    Properties* findNamespace(const char* id, unsigned int hash, bool searchNames, bool recurse) const;
+
+    /**
+     * Updates the hashes of the namespace name and ID after either has changed.
+     */
+    void hashNames();
+
     /**
      * Constructor.
      */
@@ -538,6 +582,12 @@ private:
 
     void readProperties(Stream* stream);
 
+    void writeBinary(std::vector<unsigned int>& records, std::unordered_map<std::string, unsigned int>& strings, std::string& stringData) const;
+
+    bool readBinary(const unsigned int*& records, const unsigned int* end, const std::vector<const char*>& strings);
+
+    static Properties* createFromBinary(Stream* stream);
+
     void skipWhiteSpace(Stream* stream);
 
     char* trimWhiteSpace(char* str);
@@ -557,6 +607,8 @@ private:
     std::string _namespace;
     std::string _id;
     std::string _parentID;
+    unsigned int _namespaceHash;
+    unsigned int _idHash;
     std::list<Property> _properties;
     std::list<Property>::iterator _propertiesItr;
     std::vector<Properties*> _namespaces;
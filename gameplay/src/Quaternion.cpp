@@ -1,5 +1,6 @@
 #include "Base.h"
 #include "Quaternion.h"
+#include "MathUtil.h"
 
 namespace gameplay
 {
@@ -137,15 +138,7 @@ void Quaternion::multiply(const Quaternion& q1, const Quaternion& q2, Quaternion
 {
     GP_ASSERT(dst);
 
-    float x = q1.w * q2.x + q1.x * q2.w + q1.y * q2.z - q1.z * q2.y;
-    float y = q1.w * q2.y - q1.x * q2.z + q1.y * q2.w + q1.z * q2.x;
-    float z = q1.w * q2.z + q1.x * q2.y - q1.y * q2.x + q1.z * q2.w;
-    float w = q1.w * q2.w - q1.x * q2.x - q1.y * q2.y - q1.z * q2.z;
-
-    dst->x = x;
-    dst->y = y;
-    dst->z = z;
-    dst->w = w;
+    MathUtil::multiplyQuaternion(&q1.x, &q2.x, &dst->x);
 }
 
 void Quaternion::normalize()
@@ -157,30 +150,7 @@ void Quaternion::normalize(Quaternion* dst) const
 {
     GP_ASSERT(dst);
 
-    if (this != dst)
-    {
-        dst->x = x;
-        dst->y = y;
-        dst->z = z;
-        dst->w = w;
-    }
-
-    float n = x * x + y * y + z * z + w * w;
-
-    // Already normalized.
-    if (n == 1.0f)
-        return;
-
-    n = sqrt(n);
-    // Too close to zero.
-    if (n < 0.000001f)
-        return;
-
-    n = 1.0f / n;
-    dst->x *= n;
-    dst->y *= n;
-    dst->z *= n;
-    dst->w *= n;
+    MathUtil::normalizeVector4(&x, 0.000001f, &dst->x);
 }
 
 void Quaternion::set(float x, float y, float z, float w)
@@ -364,22 +334,16 @@ void Quaternion::slerp(float q1x, float q1y, float q1z, float q1w, float q2x, fl
     alpha *= f1 + f2a;
     beta = f1 + f2b;
 
-    // Apply final coefficients to a and b as usual.
-    float w = alpha * q1w + beta * q2w;
-    float x = alpha * q1x + beta * q2x;
-    float y = alpha * q1y + beta * q2y;
-    float z = alpha * q1z + beta * q2z;
-
-    // This final adjustment to the quaternion's length corrects for
-    // any small constraint error in the inputs q1 and q2 But as you
-    // can see, it comes at the cost of 9 additional multiplication
-    // operations. If this error-correcting feature is not required,
-    // the following code may be removed.
-    f1 = 1.5f - 0.5f * (w * w + x * x + y * y + z * z);
-    *dstw = w * f1;
-    *dstx = x * f1;
-    *dsty = y * f1;
-    *dstz = z * f1;
+    // Apply final coefficients to a and b as usual, and correct the length
+    // of the result for any small constraint error in the inputs q1 and q2.
+    const float q1[4] = { q1x, q1y, q1z, q1w };
+    const float q2[4] = { q2x, q2y, q2z, q2w };
+    float q[4];
+    MathUtil::blendQuaternion(q1, q2, alpha, beta, q);
+    *dstx = q[0];
+    *dsty = q[1];
+    *dstz = q[2];
+    *dstw = q[3];
 }
 
 void Quaternion::slerpForSquad(const Quaternion& q1, const Quaternion& q2, float t, Quaternion* dst)
@@ -0,0 +1,146 @@
+#include "Base.h"
+#include "RadixSort.h"
+#include "Vector3.h"
+#include "SimdMath.h"
+
+// Number of bits of the keys that each pass sorts by
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define RADIX_MASK (RADIX_SIZE - 1)
+
+namespace gameplay
+{
+
+RadixSort::RadixSort()
+{
+}
+
+RadixSort::~RadixSort()
+{
+}
+
+const unsigned int* RadixSort::sort(const unsigned int* keys, unsigned int count)
+{
+    return sortKeys(keys, count);
+}
+
+const unsigned int* RadixSort::sort(const unsigned long long* keys, unsigned int count)
+{
+    return sortKeys(keys, count);
+}
+
+template <typename T>
+const unsigned int* RadixSort::sortKeys(const T* keys, unsigned int count)
+{
+    if (count == 0)
+        return NULL;
+    GP_ASSERT(keys);
+
+    if (_indices.size() < count)
+    {
+        _indices.resize(count);
+        _scratch.resize(count);
+    }
+
+    // Count the keys in the buckets of all of the passes at once.
+    const unsigned int passCount = sizeof(T) * 8 / RADIX_BITS;
+    unsigned int counts[sizeof(T) * 8 / RADIX_BITS][RADIX_SIZE];
+    memset(counts, 0, sizeof(counts));
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        T key = keys[i];
+        for (unsigned int pass = 0; pass < passCount; ++pass)
+        {
+            ++counts[pass][(key >> (pass * RADIX_BITS)) & RADIX_MASK];
+        }
+    }
+
+    // Each pass moves the indices into the buckets of its byte of the keys, from the least
+    // significant byte to the most significant one, while keeping the order of the previous pass.
+    unsigned int* src = &_indices[0];
+    unsigned int* dst = &_scratch[0];
+    bool sorted = false;
+    for (unsigned int pass = 0; pass < passCount; ++pass)
+    {
+        const unsigned int shift = pass * RADIX_BITS;
+        unsigned int* offsets = counts[pass];
+
+        // The byte is the same in all of the keys, so the pass would not change the order.
+        if (offsets[(keys[0] >> shift) & RADIX_MASK] == count)
+            continue;
+
+        unsigned int offset = 0;
+        for (unsigned int i = 0; i < RADIX_SIZE; ++i)
+        {
+            unsigned int bucketCount = offsets[i];
+            offsets[i] = offset;
+            offset += bucketCount;
+        }
+
+        if (!sorted)
+        {
+            for (unsigned int i = 0; i < count; ++i)
+            {
+                dst[offsets[(keys[i] >> shift) & RADIX_MASK]++] = i;
+            }
+            sorted = true;
+        }
+        else
+        {
+            for (unsigned int i = 0; i < count; ++i)
+            {
+                unsigned int index = src[i];
+                dst[offsets[(keys[index] >> shift) & RADIX_MASK]++] = index;
+            }
+        }
+        std::swap(src, dst);
+    }
+
+    // All of the keys are equal.
+    if (!sorted)
+    {
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            src[i] = i;
+        }
+    }
+    return src;
+}
+
+unsigned int RadixSort::getFloatKey(float value)
+{
+    // Flipping the sign bit of positive floats and all of the bits of negative floats makes
+    // their bits order them as unsigned integers.
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits ^ ((unsigned int)((int)bits >> 31) | 0x80000000);
+}
+
+void RadixSort::computeDepthKeys(const float* x, const float* y, const float* z, unsigned int count,
+                                 const Vector3& origin, const Vector3& direction, bool backToFront, unsigned int* keys)
+{
+    GP_ASSERT(count == 0 || (x && y && z && keys));
+
+    // Reversing the direction makes the furthest points the nearest ones.
+    Vector3 d = backToFront ? -direction : direction;
+    float o = origin.dot(d);
+
+    unsigned int i = 0;
+#ifdef GP_USE_SIMD
+    const Float4 dx = splat4(d.x);
+    const Float4 dy = splat4(d.y);
+    const Float4 dz = splat4(d.z);
+    const Float4 o4 = splat4(o);
+    for (const unsigned int groupCount = count & ~3u; i < groupCount; i += 4)
+    {
+        Float4 depth = add4(add4(mul4(load4(x + i), dx), mul4(load4(y + i), dy)), mul4(load4(z + i), dz));
+        storeSortKey4(keys + i, sub4(depth, o4));
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        keys[i] = getFloatKey(x[i] * d.x + y[i] * d.y + z[i] * d.z - o);
+    }
+}
+
+}
@@ -0,0 +1,114 @@
+#ifndef RADIXSORT_H_
+#define RADIXSORT_H_
+
+namespace gameplay
+{
+
+class Vector3;
+
+/**
+ * Defines a radix sort of integer keys, which orders the indices of the keys instead of
+ * moving the keys themselves, so the keys can be sorted for an array of any other data.
+ *
+ * The sort is stable and takes one pass over the keys for each byte of the keys, except
+ * for the bytes that are the same in all of the keys, which are skipped. A RadixSort keeps
+ * its buffers from one sort to the next, so once it has sorted the largest number of keys
+ * that it will see, sorting does not allocate any memory.
+ *
+ * Floats are sorted through their keys (see getFloatKey), and the depths of points along a
+ * direction, such as the depths of particles along the view direction of a camera, can be
+ * turned into keys four at a time with computeDepthKeys:
+ *
+ * @code
+ * RadixSort::computeDepthKeys(x, y, z, count, cameraPosition, cameraForward, true, keys);
+ * const unsigned int* order = _sorter.sort(keys, count);
+ * for (unsigned int i = 0; i < count; ++i)
+ *     drawParticle(order[i]); // From the furthest particle to the nearest one.
+ * @endcode
+ *
+ * @script{ignore}
+ */
+class RadixSort
+{
+public:
+
+    /**
+     * Constructor.
+     */
+    RadixSort();
+
+    /**
+     * Destructor.
+     */
+    ~RadixSort();
+
+    /**
+     * Sorts 32 bit keys.
+     *
+     * @param keys The keys to sort.
+     * @param count The number of keys.
+     *
+     * @return The indices of the keys from the smallest key to the largest one, which are
+     *      valid until the next sort.
+     */
+    const unsigned int* sort(const unsigned int* keys, unsigned int count);
+
+    /**
+     * Sorts 64 bit keys.
+     *
+     * @param keys The keys to sort.
+     * @param count The number of keys.
+     *
+     * @return The indices of the keys from the smallest key to the largest one, which are
+     *      valid until the next sort.
+     */
+    const unsigned int* sort(const unsigned long long* keys, unsigned int count);
+
+    /**
+     * Returns the key of a float, which sorts in the same order as the float among the keys
+     * of other floats.
+     *
+     * @param value The float.
+     *
+     * @return The key of the float.
+     */
+    static unsigned int getFloatKey(float value);
+
+    /**
+     * Computes the keys of the depths of points along a direction from an origin.
+     *
+     * @param x The x coordinates of the points.
+     * @param y The y coordinates of the points.
+     * @param z The z coordinates of the points.
+     * @param count The number of points.
+     * @param origin The origin that the depths are measured from, such as the position of a camera.
+     * @param direction The direction that the depths are measured along, such as the forward vector of a camera.
+     * @param backToFront true for the keys of the furthest points to be the smallest ones,
+     *      false for the keys of the nearest points to be the smallest ones.
+     * @param keys The array that receives the keys of the points.
+     */
+    static void computeDepthKeys(const float* x, const float* y, const float* z, unsigned int count,
+                                 const Vector3& origin, const Vector3& direction, bool backToFront, unsigned int* keys);
+
+private:
+
+    /**
+     * Hidden copy constructor.
+     */
+    RadixSort(const RadixSort& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    RadixSort& operator=(const RadixSort&);
+
+    template <typename T>
+    const unsigned int* sortKeys(const T* keys, unsigned int count);
+
+    std::vector<unsigned int> _indices;
+    std::vector<unsigned int> _scratch;
+};
+
+}
+
+#endif
@@ -26,18 +26,33 @@ Ref::Ref(const Ref& copy) :
 #endif
 }
 
+Ref& Ref::operator=(const Ref& copy)
+{
+    return *this;
+}
+
 Ref::~Ref()
 {
 }
 
 void Ref::addRef()
 {
+#ifdef GP_USE_ATOMIC_REF_COUNT
+    // A new reference is always taken from an existing one, so it needs no ordering.
+    _refCount.fetch_add(1, std::memory_order_relaxed);
+#else
     ++_refCount;
+#endif
 }
 
 void Ref::release()
 {
+#ifdef GP_USE_ATOMIC_REF_COUNT
+    // The writes of other threads to the object must be visible to the thread that deletes it.
+    if (_refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+#else
     if ((--_refCount) <= 0)
+#endif
     {
 #ifdef GP_USE_MEM_LEAK_DETECTION
         untrackRef(this, __record);
@@ -48,7 +63,11 @@ void Ref::release()
 
 unsigned int Ref::getRefCount() const
 {
+#ifdef GP_USE_ATOMIC_REF_COUNT
+    return _refCount.load(std::memory_order_relaxed);
+#else
     return _refCount;
+#endif
 }
 
 #ifdef GP_USE_MEM_LEAK_DETECTION
@@ -63,9 +82,18 @@ struct RefAllocationRecord
 RefAllocationRecord* __refAllocations = 0;
 int __refAllocationCount = 0;
 
+#ifdef GP_USE_ATOMIC_REF_COUNT
+// Ref objects may then be released on any thread, so the records are guarded.
+static std::mutex __refAllocationMutex;
+#define GP_LOCK_REF_ALLOCATIONS() std::lock_guard<std::mutex> lock(__refAllocationMutex)
+#else
+#define GP_LOCK_REF_ALLOCATIONS()
+#endif
+
 void Ref::printLeaks()
 {
     // Dump Ref object memory leaks
+    GP_LOCK_REF_ALLOCATIONS();
     if (__refAllocationCount == 0)
     {
         print("[memory] All Ref objects successfully cleaned up (no leaks detected).\n");
@@ -88,6 +116,7 @@ void* trackRef(Ref* ref)
     GP_ASSERT(ref);
 
     // Create memory allocation record.
+    GP_LOCK_REF_ALLOCATIONS();
     RefAllocationRecord* rec = (RefAllocationRecord*)malloc(sizeof(RefAllocationRecord));
     rec->ref = ref;
     rec->next = __refAllocations;
@@ -117,6 +146,7 @@ void untrackRef(Ref* ref, void* record)
     }
 
     // Link this item out.
+    GP_LOCK_REF_ALLOCATIONS();
     if (__refAllocations == rec)
         __refAllocations = rec->next;
     if (rec->prev)
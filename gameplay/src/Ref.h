@@ -13,6 +13,14 @@ namespace gameplay
  * reference counting eliminates the need for programmers to manually
  * keep track of object ownership and having to worry about when to
  * safely delete such objects.
+ *
+ * By default the reference count is not thread-safe, so Ref objects must only be
+ * referenced and released on one thread at a time. When GP_USE_ATOMIC_REF_COUNT is
+ * defined, for the library and the game alike, the reference count is atomic, so that
+ * Ref objects such as textures, meshes, materials, curves and bundles can be shared with
+ * the threads of the job system and of asynchronous loading, which then hold references
+ * of their own. This only makes references thread-safe: the objects themselves must
+ * still only be modified by one thread at a time.
  */
 class Ref
 {
@@ -57,6 +65,15 @@ protected:
      */
     Ref(const Ref& copy);
 
+    /**
+     * Copy assignment operator, which keeps the reference count of this object.
+     *
+     * @param copy The Ref object to copy.
+     *
+     * @return This object.
+     */
+    Ref& operator=(const Ref& copy);
+
     /**
      * Destructor.
      */
@@ -64,7 +81,11 @@ protected:
 
 private:
 
+#ifdef GP_USE_ATOMIC_REF_COUNT
+    std::atomic<unsigned int> _refCount;
+#else
     unsigned int _refCount;
+#endif
 
     // Memory leak diagnostic data (only included when GP_USE_MEM_LEAK_DETECTION is defined)
 #ifdef GP_USE_MEM_LEAK_DETECTION
@@ -0,0 +1,306 @@
+#include "Base.h"
+#include "RenderCommandList.h"
+#include "Model.h"
+#include "Pass.h"
+#include "Effect.h"
+#include "VertexAttributeBinding.h"
+#include "TextureStreamer.h"
+
+namespace gameplay
+{
+
+RenderCommandList* RenderCommandList::_recording = NULL;
+RenderCommandList* RenderCommandList::_capture = NULL;
+
+RenderCommandList::RenderCommandList()
+    : _cursor(0)
+{
+}
+
+RenderCommandList::~RenderCommandList()
+{
+    GP_ASSERT(_recording != this);
+    reset();
+}
+
+RenderCommandList* RenderCommandList::getRecording()
+{
+    return _recording;
+}
+
+void RenderCommandList::begin()
+{
+    GP_ASSERT(_recording == NULL);
+    _recording = this;
+}
+
+void RenderCommandList::end()
+{
+    GP_ASSERT(_recording == this);
+    _recording = NULL;
+}
+
+RenderCommandList::Command& RenderCommandList::addCommand(CommandType type)
+{
+    _commands.push_back(Command());
+    Command& command = _commands.back();
+    command.type = type;
+    return command;
+}
+
+void RenderCommandList::clear(Game::ClearFlags flags, const Vector4& clearColor, float clearDepth, int clearStencil)
+{
+    Command& command = addCommand(CLEAR);
+    command.value = (int)flags;
+    command.values[0] = clearColor.x;
+    command.values[1] = clearColor.y;
+    command.values[2] = clearColor.z;
+    command.values[3] = clearColor.w;
+    command.values[4] = clearDepth;
+    command.stencil = clearStencil;
+}
+
+void RenderCommandList::setViewport(const Rectangle& viewport)
+{
+    Command& command = addCommand(VIEWPORT);
+    command.values[0] = viewport.x;
+    command.values[1] = viewport.y;
+    command.values[2] = viewport.width;
+    command.values[3] = viewport.height;
+}
+
+void RenderCommandList::drawPart(Model* model, int partIndex, Pass* pass, bool wireframe, float screenSize)
+{
+    GP_ASSERT(model);
+    GP_ASSERT(pass);
+    GP_ASSERT(pass->getEffect());
+
+    // Keep the model and pass alive until the command has been replayed.
+    model->addRef();
+    pass->addRef();
+
+    unsigned int uniformStart = (unsigned int)_uniforms.size();
+
+    // Bind the parameters of the pass with the uniform uploads captured into this list,
+    // which also evaluates the auto bindings to the nodes and cameras of this frame.
+    GP_ASSERT(_capture == NULL);
+    _capture = this;
+    pass->bindParameters(pass->getEffect(), !pass->isDepthPass());
+    _capture = NULL;
+
+    Command& command = addCommand(DRAW_PART);
+    command.value = partIndex;
+    command.wireframe = wireframe;
+    command.model = model;
+    command.pass = pass;
+    command.values[0] = screenSize;
+    command.uniformStart = uniformStart;
+    command.uniformEnd = (unsigned int)_uniforms.size();
+}
+
+void RenderCommandList::draw(Drawable* drawable, bool wireframe)
+{
+    GP_ASSERT(drawable);
+
+    Command& command = addCommand(DRAW);
+    command.wireframe = wireframe;
+    command.drawable = drawable;
+    command.ref = dynamic_cast<Ref*>(drawable);
+    if (command.ref)
+        command.ref->addRef();
+}
+
+void RenderCommandList::call(void (*function)(void*), void* cookie)
+{
+    GP_ASSERT(function);
+
+    Command& command = addCommand(CALL);
+    command.function = function;
+    command.cookie = cookie;
+}
+
+unsigned int RenderCommandList::replay(bool deferred)
+{
+    GP_ASSERT(_recording != this);
+
+    unsigned int drawCalls = 0;
+    for (size_t count = _commands.size(); _cursor < count; ++_cursor)
+    {
+        const Command& command = _commands[_cursor];
+        if (!deferred && (command.type == DRAW || command.type == CALL))
+            break;
+
+        switch (command.type)
+        {
+        case CLEAR:
+            Game::getInstance()->clear((Game::ClearFlags)command.value,
+                Vector4(command.values[0], command.values[1], command.values[2], command.values[3]),
+                command.values[4], command.stencil);
+            break;
+        case VIEWPORT:
+            GL_ASSERT( glViewport((GLint)command.values[0], (GLint)command.values[1], (GLsizei)command.values[2], (GLsizei)command.values[3]) );
+            break;
+        case DRAW_PART:
+            {
+                Pass* pass = command.pass;
+                pass->getEffect()->bind();
+                pass->bindState();
+
+                // Streamed textures select their level of detail as their samplers are bound.
+                if (command.values[0] > 0.0f)
+                    TextureStreamer::setScreenSize(command.values[0]);
+                bindUniforms(command);
+                if (command.values[0] > 0.0f)
+                    TextureStreamer::setScreenSize(0.0f);
+
+                VertexAttributeBinding* binding = pass->getVertexAttributeBinding();
+                if (binding)
+                    binding->bind();
+                command.model->drawMesh(command.value, command.wireframe);
+                pass->unbind();
+                ++drawCalls;
+            }
+            break;
+        case DRAW:
+            drawCalls += command.drawable->draw(command.wireframe);
+            break;
+        case CALL:
+            command.function(command.cookie);
+            break;
+        }
+    }
+    return drawCalls;
+}
+
+void RenderCommandList::bindUniforms(const Command& command)
+{
+    for (unsigned int i = command.uniformStart; i < command.uniformEnd; ++i)
+    {
+        const UniformValue& value = _uniforms[i];
+        if (value.type != UNIFORM_SAMPLER || value.units)
+            RenderStats::countUniformUpload();
+        GLint location = value.uniform->_location;
+        GLsizei count = (GLsizei)value.count;
+        switch (value.type)
+        {
+        case UNIFORM_FLOAT:
+            GL_ASSERT( glUniform1fv(location, count, &_floats[value.offset]) );
+            break;
+        case UNIFORM_VECTOR2:
+            GL_ASSERT( glUniform2fv(location, count, &_floats[value.offset]) );
+            break;
+        case UNIFORM_VECTOR3:
+            GL_ASSERT( glUniform3fv(location, count, &_floats[value.offset]) );
+            break;
+        case UNIFORM_VECTOR4:
+            GL_ASSERT( glUniform4fv(location, count, &_floats[value.offset]) );
+            break;
+        case UNIFORM_MATRIX:
+            GL_ASSERT( glUniformMatrix4fv(location, count, GL_FALSE, &_floats[value.offset]) );
+            break;
+        case UNIFORM_INT:
+            GL_ASSERT( glUniform1iv(location, count, &_ints[value.offset]) );
+            break;
+        case UNIFORM_SAMPLER:
+            {
+                GLint units[32];
+                GP_ASSERT(value.count <= 32);
+                for (unsigned int j = 0; j < value.count; ++j)
+                {
+                    units[j] = value.uniform->_index + j;
+                    RenderState::activeTexture(units[j]);
+                    _samplers[value.offset + j]->bind();
+                }
+                if (value.units)
+                    GL_ASSERT( glUniform1iv(location, count, units) );
+            }
+            break;
+        }
+    }
+}
+
+void RenderCommandList::captureUniform(Uniform* uniform, UniformType type, const float* values, unsigned int count)
+{
+    GP_ASSERT(uniform);
+    GP_ASSERT(values);
+
+    static const unsigned int sizes[] = { 1, 2, 3, 4, 16 };
+    GP_ASSERT(type <= UNIFORM_MATRIX);
+
+    UniformValue value;
+    value.uniform = uniform;
+    value.type = type;
+    value.count = count;
+    value.offset = (unsigned int)_floats.size();
+    value.units = false;
+    _floats.insert(_floats.end(), values, values + count * sizes[type]);
+    _uniforms.push_back(value);
+}
+
+void RenderCommandList::captureUniform(Uniform* uniform, const int* values, unsigned int count)
+{
+    GP_ASSERT(uniform);
+    GP_ASSERT(values);
+
+    UniformValue value;
+    value.uniform = uniform;
+    value.type = UNIFORM_INT;
+    value.count = count;
+    value.offset = (unsigned int)_ints.size();
+    value.units = false;
+    _ints.insert(_ints.end(), values, values + count);
+    _uniforms.push_back(value);
+}
+
+void RenderCommandList::captureSamplers(Uniform* uniform, const Texture::Sampler* const* samplers, unsigned int count)
+{
+    GP_ASSERT(uniform);
+    GP_ASSERT(samplers);
+
+    UniformValue value;
+    value.uniform = uniform;
+    value.type = UNIFORM_SAMPLER;
+    value.count = count;
+    value.offset = (unsigned int)_samplers.size();
+
+    // The texture units of a sampler uniform never change, so they are only uploaded once.
+    value.units = uniform->_samplerUnits != count;
+    uniform->_samplerUnits = count;
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        GP_ASSERT(samplers[i]);
+        Texture::Sampler* sampler = const_cast<Texture::Sampler*>(samplers[i]);
+        sampler->addRef();
+        _samplers.push_back(sampler);
+    }
+    _uniforms.push_back(value);
+}
+
+void RenderCommandList::reset()
+{
+    for (size_t i = 0, count = _commands.size(); i < count; ++i)
+    {
+        Command& command = _commands[i];
+        SAFE_RELEASE(command.model);
+        SAFE_RELEASE(command.pass);
+        SAFE_RELEASE(command.ref);
+    }
+    for (size_t i = 0, count = _samplers.size(); i < count; ++i)
+    {
+        SAFE_RELEASE(_samplers[i]);
+    }
+    _commands.clear();
+    _uniforms.clear();
+    _floats.clear();
+    _ints.clear();
+    _samplers.clear();
+    _cursor = 0;
+}
+
+unsigned int RenderCommandList::getCommandCount() const
+{
+    return (unsigned int)_commands.size();
+}
+
+}
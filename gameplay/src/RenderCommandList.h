@@ -0,0 +1,229 @@
+#ifndef RENDERCOMMANDLIST_H_
+#define RENDERCOMMANDLIST_H_
+
+#include "Game.h"
+#include "Texture.h"
+
+namespace gameplay
+{
+
+class Uniform;
+class Model;
+class Pass;
+class Drawable;
+
+/**
+ * Defines a list of draw commands that are recorded in one frame and replayed in the next.
+ *
+ * While a command list is recording, the mesh parts that models draw (directly or through a
+ * RenderQueue) are recorded with their pass and the values that their material parameters,
+ * including the auto bindings, have at that time. Clearing the buffers and setting the
+ * viewport through the Game are recorded as well. These commands can be replayed while the
+ * nodes, cameras and skins that they were recorded from are updated for the next frame.
+ *
+ * Drawables that bind their own state, such as terrains, sprites, text, forms and particle
+ * emitters, are recorded as deferred draws when they are drawn by a RenderQueue. Deferred
+ * commands are only replayed when the state of the game may be read, since they draw their
+ * drawables as they are at that time. Other drawing that is done while recording is not
+ * recorded, and is drawn immediately.
+ *
+ * The Game records its frames into a command list when its render thread mode is enabled
+ * (see Game::isRenderThreadEnabled), and replays the commands of the last frame while the
+ * animations, physics and AI of the next frame are updated.
+ *
+ * @script{ignore}
+ */
+class RenderCommandList
+{
+    friend class Effect;
+
+public:
+
+    /**
+     * Constructor.
+     */
+    RenderCommandList();
+
+    /**
+     * Destructor.
+     */
+    ~RenderCommandList();
+
+    /**
+     * Returns the command list that is recording, if any.
+     *
+     * @return The command list that is recording, or NULL if draws are not being recorded.
+     */
+    static RenderCommandList* getRecording();
+
+    /**
+     * Starts recording the draws into this command list.
+     *
+     * Only one command list can record at a time.
+     */
+    void begin();
+
+    /**
+     * Stops recording the draws into this command list.
+     */
+    void end();
+
+    /**
+     * Records a clear of the specified buffers.
+     *
+     * @param flags The flags indicating which buffers will be cleared.
+     * @param clearColor The color value to clear to when the flags includes the color buffer.
+     * @param clearDepth The depth value to clear to when the flags includes the depth buffer.
+     * @param clearStencil The stencil value to clear to when the flags includes the stencil buffer.
+     */
+    void clear(Game::ClearFlags flags, const Vector4& clearColor, float clearDepth, int clearStencil);
+
+    /**
+     * Records a change of the viewport.
+     *
+     * @param viewport The viewport.
+     */
+    void setViewport(const Rectangle& viewport);
+
+    /**
+     * Records the draw of a mesh part of a model with the specified pass.
+     *
+     * The values of the material parameters of the pass are recorded along with it.
+     *
+     * @param model The model to draw.
+     * @param partIndex The index of the mesh part to draw, or -1 to draw the mesh vertices.
+     * @param pass The pass to draw the part with.
+     * @param wireframe true to draw the part as wireframe.
+     * @param screenSize The size of the model on screen in pixels, which selects the level of
+     *      detail of its streamed textures, or 0 if it is not known.
+     */
+    void drawPart(Model* model, int partIndex, Pass* pass, bool wireframe, float screenSize);
+
+    /**
+     * Records a deferred draw of the specified drawable.
+     *
+     * @param drawable The drawable to draw.
+     * @param wireframe true to request that wireframe geometry is drawn.
+     */
+    void draw(Drawable* drawable, bool wireframe);
+
+    /**
+     * Records a deferred call to a function that draws.
+     *
+     * @param function The function to call.
+     * @param cookie The value to pass to the function.
+     */
+    void call(void (*function)(void*), void* cookie);
+
+    /**
+     * Replays the commands that have not been replayed yet.
+     *
+     * @param deferred true to replay all of the remaining commands, false to stop at the
+     *      first deferred command.
+     *
+     * @return The number of graphics draw calls issued.
+     */
+    unsigned int replay(bool deferred = true);
+
+    /**
+     * Removes all commands from this command list, so that it can be recorded again.
+     *
+     * The storage for the commands is kept, so that the list can be recorded each frame
+     * without reallocating.
+     */
+    void reset();
+
+    /**
+     * Returns the number of commands in this command list.
+     *
+     * @return The number of commands.
+     */
+    unsigned int getCommandCount() const;
+
+private:
+
+    enum CommandType
+    {
+        CLEAR,
+        VIEWPORT,
+        DRAW_PART,
+        DRAW,
+        CALL
+    };
+
+    enum UniformType
+    {
+        UNIFORM_FLOAT,
+        UNIFORM_VECTOR2,
+        UNIFORM_VECTOR3,
+        UNIFORM_VECTOR4,
+        UNIFORM_MATRIX,
+        UNIFORM_INT,
+        UNIFORM_SAMPLER
+    };
+
+    /**
+     * A recorded command.
+     */
+    struct Command
+    {
+        CommandType type;
+        int value;
+        int stencil;
+        bool wireframe;
+        Model* model;
+        Pass* pass;
+        Drawable* drawable;
+        Ref* ref;
+        void (*function)(void*);
+        void* cookie;
+        float values[6];
+        unsigned int uniformStart;
+        unsigned int uniformEnd;
+    };
+
+    /**
+     * A recorded value of a uniform, whose elements are stored in the value arrays of the list.
+     */
+    struct UniformValue
+    {
+        Uniform* uniform;
+        UniformType type;
+        unsigned int count;
+        unsigned int offset;
+        bool units;
+    };
+
+    /**
+     * Hidden copy constructor.
+     */
+    RenderCommandList(const RenderCommandList& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    RenderCommandList& operator=(const RenderCommandList&);
+
+    Command& addCommand(CommandType type);
+
+    void captureUniform(Uniform* uniform, UniformType type, const float* values, unsigned int count);
+
+    void captureUniform(Uniform* uniform, const int* values, unsigned int count);
+
+    void captureSamplers(Uniform* uniform, const Texture::Sampler* const* samplers, unsigned int count);
+
+    void bindUniforms(const Command& command);
+
+    std::vector<Command> _commands;
+    std::vector<UniformValue> _uniforms;
+    std::vector<float> _floats;
+    std::vector<int> _ints;
+    std::vector<Texture::Sampler*> _samplers;
+    size_t _cursor;
+    static RenderCommandList* _recording;
+    static RenderCommandList* _capture;
+};
+
+}
+
+#endif
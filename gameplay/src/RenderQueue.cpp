@@ -0,0 +1,453 @@
+#include "Base.h"
+#include "RenderQueue.h"
+#include "Scene.h"
+#include "Terrain.h"
+#include "InstancedModel.h"
+#include "StaticBatch.h"
+#include "Technique.h"
+#include "Pass.h"
+#include "RenderCommandList.h"
+#include "OcclusionBuffer.h"
+#include "PortalGraph.h"
+#include "Game.h"
+
+// Sort key layout (most to least significant bits)
+#define RQ_LAYER_SHIFT          60
+#define RQ_TRANSPARENT_SHIFT    59
+#define RQ_ID_BITS              12
+#define RQ_ID_MASK              0xFFF
+#define RQ_DEPTH_BITS           16
+#define RQ_DEPTH_MASK           0xFFFF
+
+namespace gameplay
+{
+
+// Reduces a pointer to a small identifier used to group items in the sort key.
+// Collisions only affect how well items are grouped, never correctness.
+static inline unsigned long long sortId(const void* ptr)
+{
+    unsigned long long v = (unsigned long long)(size_t)ptr;
+    v = (v >> 4) * 0x9E3779B97F4A7C15ULL;
+    return (v >> (64 - RQ_ID_BITS)) & RQ_ID_MASK;
+}
+
+static inline unsigned long long opaqueKey(unsigned int layer, const void* effect, const void* material, const void* binding, unsigned int depth)
+{
+    return ((unsigned long long)layer << RQ_LAYER_SHIFT) |
+           (sortId(effect) << 47) |
+           (sortId(material) << 35) |
+           (sortId(binding) << 23) |
+           ((unsigned long long)(depth & RQ_DEPTH_MASK) << 7);
+}
+
+static inline unsigned long long transparentKey(unsigned int layer, const void* effect, const void* material, const void* binding, unsigned int depth)
+{
+    // Back-to-front: larger depths must sort first.
+    return ((unsigned long long)layer << RQ_LAYER_SHIFT) |
+           (1ULL << RQ_TRANSPARENT_SHIFT) |
+           ((unsigned long long)(RQ_DEPTH_MASK - (depth & RQ_DEPTH_MASK)) << 43) |
+           (sortId(effect) << 31) |
+           (sortId(material) << 19) |
+           (sortId(binding) << 7);
+}
+
+RenderQueue::RenderQueue()
+    : _scene(NULL), _camera(NULL), _frustumCulling(true), _occlusionBuffer(NULL), _portalGraph(NULL), _depthPrePass(false), _gathered(0)
+{
+}
+
+RenderQueue::~RenderQueue()
+{
+}
+
+void RenderQueue::clear()
+{
+    _items.clear();
+}
+
+unsigned int RenderQueue::gather(Scene* scene, Camera* camera)
+{
+    GP_ASSERT(scene);
+
+    _scene = scene;
+    _camera = camera ? camera : scene->getActiveCamera();
+    _views.clear();
+    _gathered = 0;
+
+    // Find the zones of the scene that the camera sees through their portals.
+    _portalGraph = _frustumCulling && _camera ? scene->getPortalGraph() : NULL;
+    if (_portalGraph)
+        _portalGraph->update(_camera);
+    if (_frustumCulling && _camera && scene->isSpatialIndexEnabled())
+    {
+        // Let the spatial index of the scene find the visible nodes.
+        _visibleNodes.clear();
+        scene->queryVisible(_camera->getFrustum(), _visibleNodes);
+        for (size_t i = 0, count = _visibleNodes.size(); i < count; ++i)
+        {
+            Node* node = _visibleNodes[i];
+            if (!isOccluded(node))
+                _gathered += add(node, getLayer(node));
+        }
+    }
+    else
+    {
+        scene->visit(this, &RenderQueue::gatherNode);
+    }
+    return _gathered;
+}
+
+unsigned int RenderQueue::gather(Scene* scene, Camera* const* cameras, unsigned int cameraCount)
+{
+    GP_ASSERT(scene);
+    GP_ASSERT(cameras && cameraCount > 0);
+
+    if (cameraCount == 1)
+        return gather(scene, cameras[0]);
+
+    _scene = scene;
+    _camera = cameras[0];
+    _views.assign(cameras, cameras + cameraCount);
+    _gathered = 0;
+    _portalGraph = NULL;
+    if (_frustumCulling && scene->isSpatialIndexEnabled())
+    {
+        // Query the spatial index with each frustum, adding the nodes that several cameras see once.
+        _visibleSet.clear();
+        for (unsigned int i = 0; i < cameraCount; ++i)
+        {
+            GP_ASSERT(cameras[i]);
+            _visibleNodes.clear();
+            scene->queryVisible(cameras[i]->getFrustum(), _visibleNodes);
+            for (size_t j = 0, count = _visibleNodes.size(); j < count; ++j)
+            {
+                Node* node = _visibleNodes[j];
+                if (_visibleSet.insert(node).second)
+                    _gathered += add(node, getLayer(node));
+            }
+        }
+    }
+    else
+    {
+        scene->visit(this, &RenderQueue::gatherNode);
+    }
+    return _gathered;
+}
+
+bool RenderQueue::gatherNode(Node* node)
+{
+    GP_ASSERT(node);
+
+    // Skip disabled nodes along with their children.
+    if (!node->isEnabled())
+        return false;
+
+    Drawable* drawable = node->getDrawable();
+    if (drawable)
+    {
+        if (_frustumCulling && _camera && (dynamic_cast<Model*>(drawable) || dynamic_cast<Terrain*>(drawable)))
+        {
+            if (!isInView(node))
+                return true;
+        }
+        if (isOccluded(node))
+            return true;
+
+        _gathered += add(node, getLayer(node));
+    }
+    return true;
+}
+
+bool RenderQueue::isInView(Node* node) const
+{
+    const BoundingSphere& sphere = node->getBoundingSphere();
+    if (_views.empty())
+        return sphere.intersects(_camera->getFrustum());
+
+    for (size_t i = 0, count = _views.size(); i < count; ++i)
+    {
+        if (sphere.intersects(_views[i]->getFrustum()))
+            return true;
+    }
+    return false;
+}
+
+bool RenderQueue::isOccluded(Node* node) const
+{
+    if (_portalGraph && !_portalGraph->isVisible(node))
+        return true;
+
+    if (_occlusionBuffer == NULL || !_views.empty())
+        return false;
+
+    // Only models and terrains have bounds to test.
+    Drawable* drawable = node->getDrawable();
+    if (!(dynamic_cast<Model*>(drawable) || dynamic_cast<Terrain*>(drawable)))
+        return false;
+    return !_occlusionBuffer->isVisible(node->getBoundingSphere());
+}
+
+unsigned int RenderQueue::getLayer(Node* node) const
+{
+    return node->hasTag("layer") ? (unsigned int)atoi(node->getTag("layer")) : 0;
+}
+
+unsigned int RenderQueue::add(Node* node, unsigned int layer)
+{
+    GP_ASSERT(node);
+
+    Drawable* drawable = node->getDrawable();
+    if (drawable == NULL)
+        return 0;
+
+    if (layer >= MAX_LAYERS)
+    {
+        GP_WARN("Render layer %u for node '%s' is out of range; clamping to %u.", layer, node->getId(), MAX_LAYERS - 1);
+        layer = MAX_LAYERS - 1;
+    }
+
+    bool transparent = node->hasTag("transparent");
+
+    Model* model = dynamic_cast<Model*>(drawable);
+    if (model)
+        return addModel(model, node, layer, transparent);
+
+    // Other drawables bind their own state internally, so they are only sorted by layer and depth.
+    // Terrains, instanced models and static batches are treated as opaque, while sprites, text, particles
+    // and forms are blended.
+    unsigned int depth = computeDepth(node);
+    if (!transparent && (dynamic_cast<Terrain*>(drawable) || dynamic_cast<InstancedModel*>(drawable) ||
+        dynamic_cast<StaticBatch*>(drawable)))
+        addItem(opaqueKey(layer, NULL, drawable, NULL, depth), drawable, NULL, NULL, -1, depth);
+    else
+        addItem(transparentKey(layer, NULL, drawable, NULL, depth), drawable, NULL, NULL, -1, depth);
+    return 1;
+}
+
+unsigned int RenderQueue::addModel(Model* model, Node* node, unsigned int layer, bool transparent)
+{
+    GP_ASSERT(model);
+
+    Mesh* mesh = model->getMesh();
+    GP_ASSERT(mesh);
+
+    unsigned int depth = computeDepth(node);
+    unsigned int count = 0;
+    unsigned int partCount = mesh->getPartCount();
+    for (unsigned int i = 0, n = (partCount == 0 ? 1 : partCount); i < n; ++i)
+    {
+        // Parts whose material is still compiling are queued with the fallback material of the model.
+        Material* material = model->getDrawMaterial(partCount == 0 ? -1 : (int)i);
+        if (material == NULL)
+            continue;
+
+        Technique* technique = material->getTechnique();
+        GP_ASSERT(technique);
+        for (unsigned int j = 0, passCount = technique->getPassCount(); j < passCount; ++j)
+        {
+            Pass* pass = technique->getPassByIndex(j);
+            GP_ASSERT(pass);
+
+            unsigned long long key;
+            if (transparent || pass->isBlendEnabled())
+                key = transparentKey(layer, pass->getEffect(), material, pass->getVertexAttributeBinding(), depth);
+            else
+                key = opaqueKey(layer, pass->getEffect(), material, pass->getVertexAttributeBinding(), depth);
+
+            addItem(key, model, model, pass, partCount == 0 ? -1 : (int)i, depth);
+            ++count;
+        }
+    }
+    return count;
+}
+
+void RenderQueue::addItem(unsigned long long key, Drawable* drawable, Model* model, Pass* pass, int partIndex, unsigned int depth)
+{
+    Item item;
+    item.key = key;
+    item.drawable = drawable;
+    item.model = model;
+    item.pass = pass;
+    item.partIndex = partIndex;
+    item.depth = depth;
+    _items.push_back(item);
+}
+
+unsigned int RenderQueue::computeDepth(Node* node) const
+{
+    if (_camera == NULL || _camera->getNode() == NULL)
+        return 0;
+
+    float farPlane = _camera->getFarPlane();
+    if (farPlane <= 0.0f)
+        return 0;
+
+    float distance = node->getBoundingSphere().center.distance(_camera->getNode()->getTranslationWorld());
+    float d = MATH_CLAMP(distance / farPlane, 0.0f, 1.0f);
+    return (unsigned int)(d * RQ_DEPTH_MASK);
+}
+
+void RenderQueue::sort()
+{
+    unsigned int count = (unsigned int)_items.size();
+    if (count < 2)
+        return;
+
+    _sortKeys.resize(count);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        _sortKeys[i] = _items[i].key;
+    }
+    const unsigned int* order = _sorter.sort(&_sortKeys[0], count);
+
+    _sortedItems.resize(count);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        _sortedItems[i] = _items[order[i]];
+    }
+    _items.swap(_sortedItems);
+}
+
+unsigned int RenderQueue::draw(bool wireframe)
+{
+    GP_PROFILE_GPU_SCOPE("RenderQueue::draw");
+
+    // Drawables that bind their own state are deferred while draws are recorded.
+    RenderCommandList* commands = RenderCommandList::getRecording();
+    bool prePass = _depthPrePass && !wireframe;
+    unsigned int drawCalls = prePass ? drawDepthPrePass() : 0;
+    for (size_t i = 0, count = _items.size(); i < count; ++i)
+    {
+        Item& item = _items[i];
+        if (item.model)
+        {
+            // Parts that were drawn by the depth pre-pass only shade the pixels they filled.
+            Pass* pass = prePass && getDepthPass(item) ? item.pass->getDepthEqualPass() : item.pass;
+            item.model->drawPart(item.partIndex, pass, wireframe);
+            ++drawCalls;
+        }
+        else if (commands)
+        {
+            GP_ASSERT(item.drawable);
+            commands->draw(item.drawable, wireframe);
+        }
+        else
+        {
+            GP_ASSERT(item.drawable);
+            drawCalls += item.drawable->draw(wireframe);
+        }
+    }
+    return drawCalls;
+}
+
+unsigned int RenderQueue::draw(Camera* const* cameras, const Rectangle* viewports, unsigned int viewCount, bool wireframe)
+{
+    GP_ASSERT(cameras && viewports);
+
+    if (RenderCommandList::getRecording())
+    {
+        GP_WARN("Views of a render queue cannot be drawn while a command list is recording.");
+        return 0;
+    }
+    if (_scene == NULL)
+        return 0;
+
+    // Each view is drawn as seen by its camera, in the same way as ShadowMaps draws the views of lights.
+    Game* game = Game::getInstance();
+    Rectangle viewport = game->getViewport();
+    Camera* activeCamera = _scene->_activeCamera;
+    unsigned int drawCalls = 0;
+    for (unsigned int i = 0; i < viewCount; ++i)
+    {
+        GP_ASSERT(cameras[i]);
+        game->setViewport(viewports[i]);
+        _scene->_activeCamera = cameras[i];
+        drawCalls += draw(wireframe);
+    }
+    _scene->_activeCamera = activeCamera;
+    game->setViewport(viewport);
+    return drawCalls;
+}
+
+unsigned int RenderQueue::drawDepthPrePass()
+{
+    // Draw the opaque parts layer by layer, front to back.
+    _prePassKeys.clear();
+    _prePassItems.clear();
+    for (size_t i = 0, count = _items.size(); i < count; ++i)
+    {
+        const Item& item = _items[i];
+        if (getDepthPass(item))
+        {
+            unsigned int layer = (unsigned int)(item.key >> RQ_LAYER_SHIFT);
+            _prePassKeys.push_back((layer << RQ_DEPTH_BITS) | item.depth);
+            _prePassItems.push_back((unsigned int)i);
+        }
+    }
+    if (_prePassItems.empty())
+        return 0;
+    const unsigned int* order = _sorter.sort(&_prePassKeys[0], (unsigned int)_prePassKeys.size());
+
+    // The color of the pixels is left alone, although it does not matter while draws are
+    // recorded, since the shading passes draw over every pixel that the pre-pass fills.
+    bool recording = RenderCommandList::getRecording() != NULL;
+    if (!recording)
+        GL_ASSERT( glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE) );
+    for (size_t i = 0, count = _prePassItems.size(); i < count; ++i)
+    {
+        const Item& item = _items[_prePassItems[order[i]]];
+        item.model->drawPart(item.partIndex, item.pass->getDepthPass(), false);
+    }
+    if (!recording)
+        GL_ASSERT( glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE) );
+    return (unsigned int)_prePassItems.size();
+}
+
+Pass* RenderQueue::getDepthPass(const Item& item)
+{
+    if (item.model == NULL || (item.key & (1ULL << RQ_TRANSPARENT_SHIFT)))
+        return NULL;
+    return item.pass->getDepthPass();
+}
+
+unsigned int RenderQueue::getItemCount() const
+{
+    return (unsigned int)_items.size();
+}
+
+void RenderQueue::setCamera(Camera* camera)
+{
+    _camera = camera;
+}
+
+void RenderQueue::setFrustumCulling(bool enabled)
+{
+    _frustumCulling = enabled;
+}
+
+bool RenderQueue::isFrustumCulling() const
+{
+    return _frustumCulling;
+}
+
+void RenderQueue::setOcclusionBuffer(OcclusionBuffer* buffer)
+{
+    _occlusionBuffer = buffer;
+}
+
+OcclusionBuffer* RenderQueue::getOcclusionBuffer() const
+{
+    return _occlusionBuffer;
+}
+
+void RenderQueue::setDepthPrePass(bool enabled)
+{
+    _depthPrePass = enabled;
+}
+
+bool RenderQueue::isDepthPrePass() const
+{
+    return _depthPrePass;
+}
+
+}
@@ -0,0 +1,313 @@
+#ifndef RENDERQUEUE_H_
+#define RENDERQUEUE_H_
+
+#include "RadixSort.h"
+
+namespace gameplay
+{
+
+class Scene;
+class Camera;
+class Node;
+class Drawable;
+class Model;
+class Pass;
+class OcclusionBuffer;
+class PortalGraph;
+class Rectangle;
+
+/**
+ * Defines a queue of drawables that are sorted to minimize render state changes.
+ *
+ * A render queue collects the visible drawables of a scene and builds a 64-bit
+ * sort key for each draw item. Models are split into one item per mesh part and
+ * pass, so parts that share an effect, material or vertex attribute binding are
+ * drawn back to back. The key is made up of (from most to least significant):
+ *
+ * - The render layer of the item (0-15, lower layers are drawn first).
+ * - Whether the item is opaque or transparent (opaque items are drawn first).
+ * - For opaque items: effect, material, vertex binding and then front-to-back depth.
+ * - For transparent items: back-to-front depth, then effect, material and vertex binding.
+ *
+ * With a depth pre-pass (see setDepthPrePass), the opaque model parts are first
+ * drawn front to back with depth-only variants of their passes, so that their
+ * shading passes then only shade the visible pixels.
+ *
+ * The render layer of a node can be set using the "layer" tag on the node (e.g.
+ * node->setTag("layer", "2")). Nodes tagged with "transparent" are always drawn
+ * in the transparent bucket, regardless of their material blend state.
+ *
+ * Typical usage is to gather, sort and draw the queue once per frame:
+ *
+ * @code
+ * _queue.clear();
+ * _queue.gather(_scene);
+ * _queue.sort();
+ * _queue.draw();
+ * @endcode
+ *
+ * Several views of the same scene, such as the eyes of a stereo camera rig or the players of a
+ * split screen, can share a queue. Their drawables are then gathered and sorted once, and drawn
+ * for each view in turn:
+ *
+ * @code
+ * Camera* eyes[2] = { _leftEye, _rightEye };
+ * Rectangle viewports[2] = { Rectangle(0, 0, w / 2, h), Rectangle(w / 2, 0, w / 2, h) };
+ * _queue.clear();
+ * _queue.gather(_scene, eyes, 2);
+ * _queue.sort();
+ * _queue.draw(eyes, viewports, 2);
+ * @endcode
+ *
+ * @script{ignore}
+ */
+class RenderQueue
+{
+public:
+
+    /**
+     * The maximum number of render layers supported by the sort key.
+     */
+    static const unsigned int MAX_LAYERS = 16;
+
+    /**
+     * Constructor.
+     */
+    RenderQueue();
+
+    /**
+     * Destructor.
+     */
+    ~RenderQueue();
+
+    /**
+     * Removes all draw items from the queue.
+     *
+     * The storage for the items is kept so that the queue can be refilled each
+     * frame without reallocating.
+     */
+    void clear();
+
+    /**
+     * Gathers the visible drawables of the specified scene into the queue.
+     *
+     * Disabled nodes (and their children) are skipped. If a camera is available
+     * and frustum culling is enabled, models and terrains outside of the camera
+     * frustum are also skipped. Culling uses the spatial index of the scene when
+     * it is enabled (see Scene::setSpatialIndexEnabled). Models and terrains that
+     * the occlusion buffer of the queue hides are skipped as well, and so are the
+     * nodes of the zones of the portal graph of the scene that the camera cannot see
+     * (see Scene::setPortalGraph).
+     *
+     * @param scene The scene to gather drawables from.
+     * @param camera The camera used for culling and depth sorting, or NULL to use
+     *      the active camera of the scene.
+     *
+     * @return The number of draw items added to the queue.
+     */
+    unsigned int gather(Scene* scene, Camera* camera = NULL);
+
+    /**
+     * Gathers the drawables of the specified scene that are visible to any of several cameras.
+     *
+     * The scene is traversed once, and each drawable is added once, if it is within the frustum of
+     * at least one of the cameras. Items are depth sorted for the first camera, which should be the
+     * one in the middle of the views, or one of them when they are close together, as the eyes of a
+     * stereo rig are. The occlusion buffer of the queue and the portal graph of the scene are not tested,
+     * since they are built for a single camera.
+     *
+     * @param scene The scene to gather drawables from.
+     * @param cameras The cameras of the views.
+     * @param cameraCount The number of cameras.
+     *
+     * @return The number of draw items added to the queue.
+     */
+    unsigned int gather(Scene* scene, Camera* const* cameras, unsigned int cameraCount);
+
+    /**
+     * Adds the drawable of the specified node to the queue.
+     *
+     * No culling is performed by this method.
+     *
+     * @param node The node whose drawable should be added.
+     * @param layer The render layer to add the drawable to (0 to MAX_LAYERS - 1).
+     *
+     * @return The number of draw items added to the queue.
+     */
+    unsigned int add(Node* node, unsigned int layer = 0);
+
+    /**
+     * Sorts the items in the queue by their sort keys.
+     *
+     * Items with identical keys keep the order in which they were added. The keys are radix
+     * sorted (see RadixSort), so sorting takes a few passes over the items, and the transparent
+     * items, whose keys start with their depth, are ordered back to front by the same passes.
+     */
+    void sort();
+
+    /**
+     * Draws all items in the queue in their current order.
+     *
+     * While a RenderCommandList is recording, the items are recorded into it instead.
+     * If the depth pre-pass is enabled, the opaque model parts are first drawn with
+     * the depth variants of their passes, unless wireframe is set.
+     *
+     * @param wireframe true to request that wireframe geometry is drawn.
+     *
+     * @return The number of graphics draw calls issued.
+     */
+    unsigned int draw(bool wireframe = false);
+
+    /**
+     * Draws all items in the queue once for each of several views.
+     *
+     * For each view, the viewport of the game is set and the camera is made the active
+     * camera of the scene that the queue was gathered from, so that the materials of the
+     * items bind its matrices. The viewport and active camera are restored afterwards.
+     * The views are drawn immediately, so this must not be called while a
+     * RenderCommandList is recording.
+     *
+     * @param cameras The cameras of the views.
+     * @param viewports The viewports of the views, one per camera.
+     * @param viewCount The number of views.
+     * @param wireframe true to request that wireframe geometry is drawn.
+     *
+     * @return The number of graphics draw calls issued.
+     */
+    unsigned int draw(Camera* const* cameras, const Rectangle* viewports, unsigned int viewCount, bool wireframe = false);
+
+    /**
+     * Returns the number of draw items in the queue.
+     *
+     * @return The number of draw items.
+     */
+    unsigned int getItemCount() const;
+
+    /**
+     * Sets the camera used for depth sorting items that are added to the queue.
+     *
+     * The camera is also set by gather().
+     *
+     * @param camera The camera to sort by, or NULL to disable depth sorting.
+     */
+    void setCamera(Camera* camera);
+
+    /**
+     * Enables or disables view frustum culling during gather().
+     *
+     * Frustum culling is enabled by default.
+     *
+     * @param enabled true to enable frustum culling, false to disable it.
+     */
+    void setFrustumCulling(bool enabled);
+
+    /**
+     * Determines if view frustum culling is enabled during gather().
+     *
+     * @return true if frustum culling is enabled, false otherwise.
+     */
+    bool isFrustumCulling() const;
+
+    /**
+     * Sets the occlusion buffer that gather() tests models and terrains against, so that
+     * the ones hidden by its occluders are not added to the queue.
+     *
+     * The buffer must be built for the camera of the queue before the drawables are gathered.
+     *
+     * @param buffer The occlusion buffer, or NULL to disable occlusion culling.
+     */
+    void setOcclusionBuffer(OcclusionBuffer* buffer);
+
+    /**
+     * Returns the occlusion buffer that gather() tests drawables against.
+     *
+     * @return The occlusion buffer, or NULL if occlusion culling is disabled.
+     */
+    OcclusionBuffer* getOcclusionBuffer() const;
+
+    /**
+     * Enables or disables the depth pre-pass of draw().
+     *
+     * The opaque model parts whose passes have a depth variant (see Pass::getDepthPass)
+     * are first drawn front to back with the depth variants, which fill the depth buffer
+     * without shading. They are then drawn in the order of the queue with the depth equal
+     * variants of their passes (see Pass::getDepthEqualPass), so that each pixel is shaded
+     * once, by the surface that is visible. This pays off when shading is expensive, such
+     * as with many lights, and there is a lot of overdraw. The depth pre-pass is disabled
+     * by default.
+     *
+     * @param enabled true to enable the depth pre-pass, false to disable it.
+     */
+    void setDepthPrePass(bool enabled);
+
+    /**
+     * Determines if the depth pre-pass of draw() is enabled.
+     *
+     * @return true if the depth pre-pass is enabled, false otherwise.
+     */
+    bool isDepthPrePass() const;
+
+private:
+
+    /**
+     * A single draw item in the queue.
+     */
+    struct Item
+    {
+        unsigned long long key;
+        Drawable* drawable;
+        Model* model;
+        Pass* pass;
+        int partIndex;
+        unsigned int depth;
+    };
+
+    /**
+     * Hidden copy constructor.
+     */
+    RenderQueue(const RenderQueue& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    RenderQueue& operator=(const RenderQueue&);
+
+    bool gatherNode(Node* node);
+
+    bool isInView(Node* node) const;
+
+    bool isOccluded(Node* node) const;
+
+    unsigned int getLayer(Node* node) const;
+
+    unsigned int addModel(Model* model, Node* node, unsigned int layer, bool transparent);
+
+    void addItem(unsigned long long key, Drawable* drawable, Model* model, Pass* pass, int partIndex, unsigned int depth);
+
+    unsigned int drawDepthPrePass();
+
+    static Pass* getDepthPass(const Item& item);
+
+    unsigned int computeDepth(Node* node) const;
+
+    std::vector<Item> _items;
+    std::vector<Node*> _visibleNodes;
+    std::set<Node*> _visibleSet;
+    Scene* _scene;
+    Camera* _camera;
+    std::vector<Camera*> _views;
+    bool _frustumCulling;
+    OcclusionBuffer* _occlusionBuffer;
+    PortalGraph* _portalGraph;
+    bool _depthPrePass;
+    std::vector<unsigned long long> _sortKeys;
+    std::vector<Item> _sortedItems;
+    std::vector<unsigned int> _prePassKeys;
+    std::vector<unsigned int> _prePassItems;
+    RadixSort _sorter;
+    unsigned int _gathered;
+};
+
+}
+
+#endif
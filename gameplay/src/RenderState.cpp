@@ -22,12 +22,76 @@
 
 #define RS_ALL_ONES 0xFFFFFFFF
 
+// Auto bindings whose value is shared by every node that sees the same camera or scene.
+// The per-camera kinds are offsets into a block of versions allocated for the camera.
+#define RS_SHARED_VIEW_MATRIX 1
+#define RS_SHARED_PROJECTION_MATRIX 2
+#define RS_SHARED_VIEW_PROJECTION_MATRIX 3
+#define RS_SHARED_CAMERA_WORLD_POSITION 4
+#define RS_SHARED_CAMERA_VIEW_POSITION 5
+#define RS_SHARED_CAMERA_COUNT 5
+#define RS_SHARED_AMBIENT_COLOR 6
+
+// Shadow copy of GL object bindings
+#define RS_UNKNOWN_BINDING ((GLuint)-1)
+#define RS_MAX_TEXTURE_UNITS 32
+
+// The number of frames that deleted GL objects are kept for, which covers the frames that the GPU may still be drawing
+#define RS_DELETE_LATENCY 3
+
+// The kinds of GL objects that are deleted
+#define RS_DELETE_PROGRAM 0
+#define RS_DELETE_BUFFER 1
+#define RS_DELETE_VERTEX_ARRAY 2
+#define RS_DELETE_TEXTURE 3
+#define RS_DELETE_FRAME_BUFFER 4
+#define RS_DELETE_RENDER_BUFFER 5
+
 namespace gameplay
 {
 
 RenderState::StateBlock* RenderState::StateBlock::_defaultState = NULL;
 std::vector<RenderState::AutoBindingResolver*> RenderState::_customAutoBindingResolvers;
 
+static GLuint __currentProgram = RS_UNKNOWN_BINDING;
+static GLuint __currentArrayBuffer = RS_UNKNOWN_BINDING;
+static GLuint __currentElementArrayBuffer = RS_UNKNOWN_BINDING;
+static GLuint __currentVertexArray = RS_UNKNOWN_BINDING;
+static unsigned int __currentTextureUnit = RS_MAX_TEXTURE_UNITS;
+static GLuint __currentTexture2D[RS_MAX_TEXTURE_UNITS];
+static GLuint __currentTextureCube[RS_MAX_TEXTURE_UNITS];
+static GLuint __currentTexture2DArray[RS_MAX_TEXTURE_UNITS];
+static GLuint __currentSampler[RS_MAX_TEXTURE_UNITS];
+
+// Sampler objects, keyed by their filter and wrap modes.
+static std::map<std::vector<GLenum>, GLuint> __samplerObjects;
+
+/**
+ * A GL object that is deleted once the frames that were queued since it was deleted have been drawn.
+ */
+struct QueuedDelete
+{
+    unsigned int type;
+    GLuint object;
+    unsigned int frame;
+};
+
+// The GL objects to delete, in the order that they were queued, which any thread may add to.
+static std::vector<QueuedDelete> __deleteQueue;
+static std::vector<QueuedDelete> __deleteBatch;
+static std::mutex __deleteMutex;
+static unsigned int __deleteFrame = 0;
+
+static void queueDelete(unsigned int type, GLuint object)
+{
+    // Deleting the object zero is ignored by GL.
+    if (object == 0)
+        return;
+    std::lock_guard<std::mutex> lock(__deleteMutex);
+    QueuedDelete queued = { type, object, __deleteFrame };
+    __deleteQueue.push_back(queued);
+}
+
 RenderState::RenderState()
     : _nodeBinding(NULL), _state(NULL), _parent(NULL)
 {
@@ -50,11 +114,267 @@ void RenderState::initialize()
     {
         StateBlock::_defaultState = StateBlock::create();
     }
+    resetStateCache();
 }
 
 void RenderState::finalize()
 {
     SAFE_RELEASE(StateBlock::_defaultState);
+
+    // The GPU has finished drawing once the game shuts down.
+    deleteQueuedObjects(true);
+
+#ifdef GP_USE_SAMPLER_OBJECTS
+    for (std::map<std::vector<GLenum>, GLuint>::iterator itr = __samplerObjects.begin(); itr != __samplerObjects.end(); ++itr)
+    {
+        GL_ASSERT( glDeleteSamplers(1, &itr->second) );
+    }
+#endif
+    __samplerObjects.clear();
+}
+
+void RenderState::useProgram(GLuint program)
+{
+    if (__currentProgram != program)
+    {
+        GL_ASSERT( glUseProgram(program) );
+        RenderStats::countProgramBind();
+        __currentProgram = program;
+    }
+}
+
+void RenderState::bindBuffer(GLenum target, GLuint buffer)
+{
+    GLuint* current;
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER:
+        current = &__currentArrayBuffer;
+        break;
+    case GL_ELEMENT_ARRAY_BUFFER:
+        current = &__currentElementArrayBuffer;
+        break;
+    default:
+        GL_ASSERT( glBindBuffer(target, buffer) );
+        return;
+    }
+
+    if (*current != buffer)
+    {
+        GL_ASSERT( glBindBuffer(target, buffer) );
+        *current = buffer;
+    }
+}
+
+void RenderState::bindVertexArray(GLuint array)
+{
+    if (__currentVertexArray != array)
+    {
+        GL_ASSERT( glBindVertexArray(array) );
+        __currentVertexArray = array;
+
+        // The element array buffer binding is part of the vertex array object state.
+        __currentElementArrayBuffer = RS_UNKNOWN_BINDING;
+    }
+}
+
+void RenderState::activeTexture(unsigned int unit)
+{
+    if (__currentTextureUnit != unit || unit >= RS_MAX_TEXTURE_UNITS)
+    {
+        GL_ASSERT( glActiveTexture(GL_TEXTURE0 + unit) );
+        __currentTextureUnit = unit;
+    }
+}
+
+void RenderState::bindTexture(GLenum target, GLuint texture)
+{
+    GLuint* current = NULL;
+    if (__currentTextureUnit < RS_MAX_TEXTURE_UNITS)
+    {
+        if (target == GL_TEXTURE_2D)
+            current = &__currentTexture2D[__currentTextureUnit];
+        else if (target == GL_TEXTURE_CUBE_MAP)
+            current = &__currentTextureCube[__currentTextureUnit];
+        else if (target == GL_TEXTURE_2D_ARRAY)
+            current = &__currentTexture2DArray[__currentTextureUnit];
+    }
+
+    if (current == NULL || *current != texture)
+    {
+        GL_ASSERT( glBindTexture(target, texture) );
+        RenderStats::countTextureBind();
+        if (current)
+            *current = texture;
+    }
+}
+
+GLuint RenderState::getSamplerObject(GLenum minFilter, GLenum magFilter, GLenum wrapS, GLenum wrapT, GLenum wrapR)
+{
+#ifdef GP_USE_SAMPLER_OBJECTS
+    // Sampler objects are part of OpenGL 3.3, so check for them at runtime.
+    if (glGenSamplers == NULL)
+        return 0;
+
+    std::vector<GLenum> key(5);
+    key[0] = minFilter;
+    key[1] = magFilter;
+    key[2] = wrapS;
+    key[3] = wrapT;
+    key[4] = wrapR;
+
+    std::map<std::vector<GLenum>, GLuint>::const_iterator itr = __samplerObjects.find(key);
+    if (itr != __samplerObjects.end())
+        return itr->second;
+
+    GLuint sampler = 0;
+    GL_ASSERT( glGenSamplers(1, &sampler) );
+    GL_ASSERT( glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, minFilter) );
+    GL_ASSERT( glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, magFilter) );
+    GL_ASSERT( glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, wrapS) );
+    GL_ASSERT( glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, wrapT) );
+    GL_ASSERT( glSamplerParameteri(sampler, GL_TEXTURE_WRAP_R, wrapR) );
+    __samplerObjects[key] = sampler;
+    return sampler;
+#else
+    return 0;
+#endif
+}
+
+bool RenderState::bindSampler(GLuint sampler)
+{
+#ifdef GP_USE_SAMPLER_OBJECTS
+    // The unit that sampler objects are bound to is given explicitly, so it must be known.
+    if (glBindSampler == NULL || __currentTextureUnit >= RS_MAX_TEXTURE_UNITS)
+        return false;
+
+    if (__currentSampler[__currentTextureUnit] != sampler)
+    {
+        GL_ASSERT( glBindSampler(__currentTextureUnit, sampler) );
+        __currentSampler[__currentTextureUnit] = sampler;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void RenderState::deleteProgram(GLuint program)
+{
+    queueDelete(RS_DELETE_PROGRAM, program);
+}
+
+void RenderState::deleteBuffer(GLuint buffer)
+{
+    queueDelete(RS_DELETE_BUFFER, buffer);
+}
+
+void RenderState::deleteVertexArray(GLuint array)
+{
+    queueDelete(RS_DELETE_VERTEX_ARRAY, array);
+}
+
+void RenderState::deleteTexture(GLuint texture)
+{
+    queueDelete(RS_DELETE_TEXTURE, texture);
+}
+
+void RenderState::deleteFrameBuffer(GLuint frameBuffer)
+{
+    queueDelete(RS_DELETE_FRAME_BUFFER, frameBuffer);
+}
+
+void RenderState::deleteRenderBuffer(GLuint renderBuffer)
+{
+    queueDelete(RS_DELETE_RENDER_BUFFER, renderBuffer);
+}
+
+void RenderState::deleteQueuedObjects(bool all)
+{
+    // The objects are deleted outside of the lock, so that threads that queue more don't wait for GL.
+    {
+        std::lock_guard<std::mutex> lock(__deleteMutex);
+        ++__deleteFrame;
+        size_t count = 0;
+        while (count < __deleteQueue.size() && (all || __deleteQueue[count].frame + RS_DELETE_LATENCY <= __deleteFrame))
+            ++count;
+        __deleteBatch.assign(__deleteQueue.begin(), __deleteQueue.begin() + count);
+        __deleteQueue.erase(__deleteQueue.begin(), __deleteQueue.begin() + count);
+    }
+
+    for (size_t i = 0, count = __deleteBatch.size(); i < count; ++i)
+    {
+        GLuint object = __deleteBatch[i].object;
+        switch (__deleteBatch[i].type)
+        {
+        case RS_DELETE_PROGRAM:
+            if (__currentProgram == object)
+            {
+                // Deleting the current program only flags it for deletion, so unbind it first.
+                GL_ASSERT( glUseProgram(0) );
+                __currentProgram = 0;
+            }
+            GL_ASSERT( glDeleteProgram(object) );
+            break;
+
+        case RS_DELETE_BUFFER:
+            GL_ASSERT( glDeleteBuffers(1, &object) );
+
+            // Deleted buffers revert to binding zero.
+            if (__currentArrayBuffer == object)
+                __currentArrayBuffer = 0;
+            if (__currentElementArrayBuffer == object)
+                __currentElementArrayBuffer = RS_UNKNOWN_BINDING;
+            break;
+
+        case RS_DELETE_VERTEX_ARRAY:
+            GL_ASSERT( glDeleteVertexArrays(1, &object) );
+            if (__currentVertexArray == object)
+            {
+                __currentVertexArray = 0;
+                __currentElementArrayBuffer = RS_UNKNOWN_BINDING;
+            }
+            break;
+
+        case RS_DELETE_TEXTURE:
+            GL_ASSERT( glDeleteTextures(1, &object) );
+            for (unsigned int j = 0; j < RS_MAX_TEXTURE_UNITS; ++j)
+            {
+                if (__currentTexture2D[j] == object)
+                    __currentTexture2D[j] = 0;
+                if (__currentTextureCube[j] == object)
+                    __currentTextureCube[j] = 0;
+                if (__currentTexture2DArray[j] == object)
+                    __currentTexture2DArray[j] = 0;
+            }
+            break;
+
+        case RS_DELETE_FRAME_BUFFER:
+            GL_ASSERT( glDeleteFramebuffers(1, &object) );
+            break;
+
+        case RS_DELETE_RENDER_BUFFER:
+            GL_ASSERT( glDeleteRenderbuffers(1, &object) );
+            break;
+        }
+    }
+    __deleteBatch.clear();
+}
+
+void RenderState::resetStateCache()
+{
+    __currentProgram = RS_UNKNOWN_BINDING;
+    __currentArrayBuffer = RS_UNKNOWN_BINDING;
+    __currentElementArrayBuffer = RS_UNKNOWN_BINDING;
+    __currentVertexArray = RS_UNKNOWN_BINDING;
+    __currentTextureUnit = RS_MAX_TEXTURE_UNITS;
+    for (unsigned int i = 0; i < RS_MAX_TEXTURE_UNITS; ++i)
+    {
+        __currentTexture2D[i] = RS_UNKNOWN_BINDING;
+        __currentTextureCube[i] = RS_UNKNOWN_BINDING;
+        __currentTexture2DArray[i] = RS_UNKNOWN_BINDING;
+        __currentSampler[i] = RS_UNKNOWN_BINDING;
+    }
 }
 
 MaterialParameter* RenderState::getParameter(const char* name) const
@@ -151,9 +471,57 @@ const char* autoBindingToString(RenderState::AutoBinding autoBinding)
     case RenderState::MATRIX_PALETTE:
         return "MATRIX_PALETTE";
 
+    case RenderState::DUAL_QUATERNION_PALETTE:
+        return "DUAL_QUATERNION_PALETTE";
+
     case RenderState::SCENE_AMBIENT_COLOR:
         return "SCENE_AMBIENT_COLOR";
 
+    case RenderState::POSITION_DECODE_SCALE:
+        return "POSITION_DECODE_SCALE";
+
+    case RenderState::POSITION_DECODE_OFFSET:
+        return "POSITION_DECODE_OFFSET";
+
+    case RenderState::POINT_LIGHT_COLOR:
+        return "POINT_LIGHT_COLOR";
+
+    case RenderState::POINT_LIGHT_POSITION:
+        return "POINT_LIGHT_POSITION";
+
+    case RenderState::POINT_LIGHT_RANGE_INVERSE:
+        return "POINT_LIGHT_RANGE_INVERSE";
+
+    case RenderState::SPOT_LIGHT_COLOR:
+        return "SPOT_LIGHT_COLOR";
+
+    case RenderState::SPOT_LIGHT_POSITION:
+        return "SPOT_LIGHT_POSITION";
+
+    case RenderState::SPOT_LIGHT_DIRECTION:
+        return "SPOT_LIGHT_DIRECTION";
+
+    case RenderState::SPOT_LIGHT_RANGE_INVERSE:
+        return "SPOT_LIGHT_RANGE_INVERSE";
+
+    case RenderState::SPOT_LIGHT_INNER_ANGLE_COS:
+        return "SPOT_LIGHT_INNER_ANGLE_COS";
+
+    case RenderState::SPOT_LIGHT_OUTER_ANGLE_COS:
+        return "SPOT_LIGHT_OUTER_ANGLE_COS";
+
+    case RenderState::DIRECTIONAL_LIGHT_COLOR:
+        return "DIRECTIONAL_LIGHT_COLOR";
+
+    case RenderState::DIRECTIONAL_LIGHT_DIRECTION:
+        return "DIRECTIONAL_LIGHT_DIRECTION";
+
+    case RenderState::SPOT_LIGHT_SHADOW_MATRIX:
+        return "SPOT_LIGHT_SHADOW_MATRIX";
+
+    case RenderState::POINT_LIGHT_SHADOW:
+        return "POINT_LIGHT_SHADOW";
+
     default:
         return "";
     }
@@ -265,10 +633,12 @@ void RenderState::applyAutoBinding(const char* uniformName, const char* autoBind
         else if (strcmp(autoBinding, "VIEW_MATRIX") == 0)
         {
             param->bindValue(this, &RenderState::autoBindingGetViewMatrix);
+            param->_sharedBinding = RS_SHARED_VIEW_MATRIX;
         }
         else if (strcmp(autoBinding, "PROJECTION_MATRIX") == 0)
         {
             param->bindValue(this, &RenderState::autoBindingGetProjectionMatrix);
+            param->_sharedBinding = RS_SHARED_PROJECTION_MATRIX;
         }
         else if (strcmp(autoBinding, "WORLD_VIEW_MATRIX") == 0)
         {
@@ -277,6 +647,7 @@ void RenderState::applyAutoBinding(const char* uniformName, const char* autoBind
         else if (strcmp(autoBinding, "VIEW_PROJECTION_MATRIX") == 0)
         {
             param->bindValue(this, &RenderState::autoBindingGetViewProjectionMatrix);
+            param->_sharedBinding = RS_SHARED_VIEW_PROJECTION_MATRIX;
         }
         else if (strcmp(autoBinding, "WORLD_VIEW_PROJECTION_MATRIX") == 0)
         {
@@ -293,18 +664,85 @@ void RenderState::applyAutoBinding(const char* uniformName, const char* autoBind
         else if (strcmp(autoBinding, "CAMERA_WORLD_POSITION") == 0)
         {
             param->bindValue(this, &RenderState::autoBindingGetCameraWorldPosition);
+            param->_sharedBinding = RS_SHARED_CAMERA_WORLD_POSITION;
         }
         else if (strcmp(autoBinding, "CAMERA_VIEW_POSITION") == 0)
         {
             param->bindValue(this, &RenderState::autoBindingGetCameraViewPosition);
+            param->_sharedBinding = RS_SHARED_CAMERA_VIEW_POSITION;
         }
         else if (strcmp(autoBinding, "MATRIX_PALETTE") == 0)
         {
             param->bindValue(this, &RenderState::autoBindingGetMatrixPalette, &RenderState::autoBindingGetMatrixPaletteSize);
         }
+        else if (strcmp(autoBinding, "DUAL_QUATERNION_PALETTE") == 0)
+        {
+            param->bindValue(this, &RenderState::autoBindingGetDualQuaternionPalette, &RenderState::autoBindingGetDualQuaternionPaletteSize);
+        }
         else if (strcmp(autoBinding, "SCENE_AMBIENT_COLOR") == 0)
         {
             param->bindValue(this, &RenderState::autoBindingGetAmbientColor);
+            param->_sharedBinding = RS_SHARED_AMBIENT_COLOR;
+        }
+        else if (strcmp(autoBinding, "POSITION_DECODE_SCALE") == 0)
+        {
+            param->bindValue(this, &RenderState::autoBindingGetPositionDecodeScale);
+        }
+        else if (strcmp(autoBinding, "POSITION_DECODE_OFFSET") == 0)
+        {
+            param->bindValue(this, &RenderState::autoBindingGetPositionDecodeOffset);
+        }
+        else if (strcmp(autoBinding, "POINT_LIGHT_COLOR") == 0)
+        {
+            param->bindValue(this, &RenderState::autoBindingGetPointLightColor, &RenderState::autoBindingGetNodeLightCount);
+        }
+        else if (strcmp(autoBinding, "POINT_LIGHT_POSITION") == 0)
+        {
+            param->bindValue(this, &RenderState::autoBindingGetPointLightPosition, &RenderState::autoBindingGetNodeLightCount);
+        }
+        else if (strcmp(autoBinding, "POINT_LIGHT_RANGE_INVERSE") == 0)
+        {
+            param->bindValue(this, &RenderState::autoBindingGetPointLightRangeInverse, &RenderState::autoBindingGetNodeLightCount);
+        }
+        else if (strcmp(autoBinding, "SPOT_LIGHT_COLOR") == 0)
+        {
+            param->bindValue(this, &RenderState::autoBindingGetSpotLightColor, &RenderState::autoBindingGetNodeLightCount);
+        }
+        else if (strcmp(autoBinding, "SPOT_LIGHT_POSITION") == 0)
+        {
+            param->bindValue(this, &RenderState::autoBindingGetSpotLightPosition, &RenderState::autoBindingGetNodeLightCount);
+        }
+        else if (strcmp(autoBinding, "SPOT_LIGHT_DIRECTION") == 0)
+        {
+            param->bindValue(this, &RenderState::autoBindingGetSpotLightDirection, &RenderState::autoBindingGetNodeLightCount);
+        }
+        else if (strcmp(autoBinding, "SPOT_LIGHT_RANGE_INVERSE") == 0)
+        {
+            param->bindValue(this, &RenderState::autoBindingGetSpotLightRangeInverse, &RenderState::autoBindingGetNodeLightCount);
+        }
+        else if (strcmp(autoBinding, "SPOT_LIGHT_INNER_ANGLE_COS") == 0)
+        {
+            param->bindValue(this, &RenderState::autoBindingGetSpotLightInnerAngleCos, &RenderState::autoBindingGetNodeLightCount);
+        }
+        else if (strcmp(autoBinding, "SPOT_LIGHT_OUTER_ANGLE_COS") == 0)
+        {
+            param->bindValue(this, &RenderState::autoBindingGetSpotLightOuterAngleCos, &RenderState::autoBindingGetNodeLightCount);
+        }
+        else if (strcmp(autoBinding, "DIRECTIONAL_LIGHT_COLOR") == 0)
+        {
+            param->bindValue(this, &RenderState::autoBindingGetDirectionalLightColor, &RenderState::autoBindingGetNodeLightCount);
+        }
+        else if (strcmp(autoBinding, "DIRECTIONAL_LIGHT_DIRECTION") == 0)
+        {
+            param->bindValue(this, &RenderState::autoBindingGetDirectionalLightDirection, &RenderState::autoBindingGetNodeLightCount);
+        }
+        else if (strcmp(autoBinding, "SPOT_LIGHT_SHADOW_MATRIX") == 0)
+        {
+            param->bindValue(this, &RenderState::autoBindingGetSpotLightShadowMatrix, &RenderState::autoBindingGetNodeLightCount);
+        }
+        else if (strcmp(autoBinding, "POINT_LIGHT_SHADOW") == 0)
+        {
+            param->bindValue(this, &RenderState::autoBindingGetPointLightShadow, &RenderState::autoBindingGetPointLightShadowCount);
         }
         else
         {
@@ -318,6 +756,7 @@ void RenderState::applyAutoBinding(const char* uniformName, const char* autoBind
         // Mark parameter as an auto binding
         if (param->_type == MaterialParameter::METHOD && param->_value.method)
             param->_value.method->_autoBinding = true;
+        param->_sharedBindingNode = _nodeBinding;
     }
 }
 
@@ -395,16 +834,265 @@ unsigned int RenderState::autoBindingGetMatrixPaletteSize() const
     return 0;
 }
 
+const Vector4* RenderState::autoBindingGetDualQuaternionPalette() const
+{
+    Model* model = dynamic_cast<Model*>(_nodeBinding->getDrawable());
+    if (model)
+    {
+        MeshSkin* skin = model->getSkin();
+        if (skin)
+            return skin->getDualQuaternionPalette();
+    }
+    return NULL;
+}
+
+unsigned int RenderState::autoBindingGetDualQuaternionPaletteSize() const
+{
+    Model* model = dynamic_cast<Model*>(_nodeBinding->getDrawable());
+    if (model)
+    {
+        MeshSkin* skin = model->getSkin();
+        if (skin)
+            return skin->getDualQuaternionPaletteSize();
+    }
+    return 0;
+}
+
 const Vector3& RenderState::autoBindingGetAmbientColor() const
 {
     Scene* scene = _nodeBinding ? _nodeBinding->getScene() : NULL;
     return scene ? scene->getAmbientColor() : Vector3::zero();
 }
 
+const Vector3& RenderState::autoBindingGetPositionDecodeScale() const
+{
+    Model* model = _nodeBinding ? dynamic_cast<Model*>(_nodeBinding->getDrawable()) : NULL;
+    return model && model->getMesh() ? model->getMesh()->getPositionDecodeScale() : Vector3::one();
+}
+
+const Vector3& RenderState::autoBindingGetPositionDecodeOffset() const
+{
+    Model* model = _nodeBinding ? dynamic_cast<Model*>(_nodeBinding->getDrawable()) : NULL;
+    return model && model->getMesh() ? model->getMesh()->getPositionDecodeOffset() : Vector3::zero();
+}
+
+/**
+ * The properties of the lights selected for a node that the light auto-bindings bind.
+ */
+enum LightProperty
+{
+    LIGHT_COLOR,
+    LIGHT_POSITION,
+    LIGHT_DIRECTION,
+    LIGHT_RANGE_INVERSE,
+    LIGHT_INNER_ANGLE_COS,
+    LIGHT_OUTER_ANGLE_COS
+};
+
+/**
+ * Returns a vector property of the lights of the specified type selected for a node, in an array
+ * of Scene::MAX_NODE_LIGHTS values. The values past the selected lights add no light, so the
+ * shaders can use any number of lights up to the maximum (values past the end of a uniform array
+ * are ignored by GL).
+ */
+static const Vector3* getNodeLightVectors(Node* node, Light::Type type, LightProperty property)
+{
+    static Vector3 values[Scene::MAX_NODE_LIGHTS];
+
+    Scene* scene = node ? node->getScene() : NULL;
+    const std::vector<Node*>* lights = scene ? &scene->getNodeLights(node, type) : NULL;
+    size_t count = lights ? lights->size() : 0;
+    for (unsigned int i = 0; i < Scene::MAX_NODE_LIGHTS; ++i)
+    {
+        Node* lightNode = i < count ? (*lights)[i] : NULL;
+        switch (property)
+        {
+        case LIGHT_COLOR:
+            values[i] = lightNode ? lightNode->getLight()->getColor() : Vector3::zero();
+            break;
+        case LIGHT_POSITION:
+            values[i] = lightNode ? lightNode->getTranslationView() : Vector3::zero();
+            break;
+        case LIGHT_DIRECTION:
+            values[i] = lightNode ? lightNode->getForwardVectorView() : Vector3(0.0f, 0.0f, -1.0f);
+            break;
+        default:
+            GP_ERROR("Invalid vector light property (%d).", property);
+            break;
+        }
+    }
+    return values;
+}
+
+/**
+ * Returns a float property of the lights of the specified type selected for a node, like
+ * getNodeLightVectors.
+ */
+static const float* getNodeLightFloats(Node* node, Light::Type type, LightProperty property)
+{
+    static float values[Scene::MAX_NODE_LIGHTS];
+
+    Scene* scene = node ? node->getScene() : NULL;
+    const std::vector<Node*>* lights = scene ? &scene->getNodeLights(node, type) : NULL;
+    size_t count = lights ? lights->size() : 0;
+    for (unsigned int i = 0; i < Scene::MAX_NODE_LIGHTS; ++i)
+    {
+        Light* light = i < count ? (*lights)[i]->getLight() : NULL;
+        switch (property)
+        {
+        case LIGHT_RANGE_INVERSE:
+            values[i] = light ? light->getRangeInverse() : 0.0f;
+            break;
+        case LIGHT_INNER_ANGLE_COS:
+            values[i] = light ? light->getInnerAngleCos() : 1.0f;
+            break;
+        case LIGHT_OUTER_ANGLE_COS:
+            values[i] = light ? light->getOuterAngleCos() : 0.0f;
+            break;
+        default:
+            GP_ERROR("Invalid float light property (%d).", property);
+            break;
+        }
+    }
+    return values;
+}
+
+const Vector3* RenderState::autoBindingGetPointLightColor() const
+{
+    return getNodeLightVectors(_nodeBinding, Light::POINT, LIGHT_COLOR);
+}
+
+const Vector3* RenderState::autoBindingGetPointLightPosition() const
+{
+    return getNodeLightVectors(_nodeBinding, Light::POINT, LIGHT_POSITION);
+}
+
+const float* RenderState::autoBindingGetPointLightRangeInverse() const
+{
+    return getNodeLightFloats(_nodeBinding, Light::POINT, LIGHT_RANGE_INVERSE);
+}
+
+const Vector3* RenderState::autoBindingGetSpotLightColor() const
+{
+    return getNodeLightVectors(_nodeBinding, Light::SPOT, LIGHT_COLOR);
+}
+
+const Vector3* RenderState::autoBindingGetSpotLightPosition() const
+{
+    return getNodeLightVectors(_nodeBinding, Light::SPOT, LIGHT_POSITION);
+}
+
+const Vector3* RenderState::autoBindingGetSpotLightDirection() const
+{
+    return getNodeLightVectors(_nodeBinding, Light::SPOT, LIGHT_DIRECTION);
+}
+
+const float* RenderState::autoBindingGetSpotLightRangeInverse() const
+{
+    return getNodeLightFloats(_nodeBinding, Light::SPOT, LIGHT_RANGE_INVERSE);
+}
+
+const float* RenderState::autoBindingGetSpotLightInnerAngleCos() const
+{
+    return getNodeLightFloats(_nodeBinding, Light::SPOT, LIGHT_INNER_ANGLE_COS);
+}
+
+const float* RenderState::autoBindingGetSpotLightOuterAngleCos() const
+{
+    return getNodeLightFloats(_nodeBinding, Light::SPOT, LIGHT_OUTER_ANGLE_COS);
+}
+
+const Vector3* RenderState::autoBindingGetDirectionalLightColor() const
+{
+    return getNodeLightVectors(_nodeBinding, Light::DIRECTIONAL, LIGHT_COLOR);
+}
+
+const Vector3* RenderState::autoBindingGetDirectionalLightDirection() const
+{
+    return getNodeLightVectors(_nodeBinding, Light::DIRECTIONAL, LIGHT_DIRECTION);
+}
+
+const Matrix* RenderState::autoBindingGetSpotLightShadowMatrix() const
+{
+    static Matrix values[Scene::MAX_NODE_LIGHTS];
+
+    // Lights without a shadow map get a matrix that maps every point to the front of the
+    // shadow map, so that they are never shadowed.
+    Scene* scene = _nodeBinding ? _nodeBinding->getScene() : NULL;
+    const std::vector<Node*>* lights = scene ? &scene->getNodeLights(_nodeBinding, Light::SPOT) : NULL;
+    size_t count = lights ? lights->size() : 0;
+    for (unsigned int i = 0; i < Scene::MAX_NODE_LIGHTS; ++i)
+    {
+        Light* light = i < count ? (*lights)[i]->getLight() : NULL;
+        if (light && light->_shadowMapped)
+            values[i] = light->_shadowMatrix;
+        else
+            values[i].set(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+    }
+    return values;
+}
+
+const Vector4* RenderState::autoBindingGetPointLightShadow() const
+{
+    static Vector4 values[Scene::MAX_NODE_LIGHTS * 2];
+
+    // Zero parameters map every point to the front of the shadow map (see autoBindingGetSpotLightShadowMatrix).
+    Scene* scene = _nodeBinding ? _nodeBinding->getScene() : NULL;
+    const std::vector<Node*>* lights = scene ? &scene->getNodeLights(_nodeBinding, Light::POINT) : NULL;
+    size_t count = lights ? lights->size() : 0;
+    for (unsigned int i = 0; i < Scene::MAX_NODE_LIGHTS; ++i)
+    {
+        Light* light = i < count ? (*lights)[i]->getLight() : NULL;
+        values[i * 2] = light && light->_shadowMapped ? light->_shadowCube[0] : Vector4::zero();
+        values[i * 2 + 1] = light && light->_shadowMapped ? light->_shadowCube[1] : Vector4::zero();
+    }
+    return values;
+}
+
+unsigned int RenderState::autoBindingGetNodeLightCount() const
+{
+    return Scene::MAX_NODE_LIGHTS;
+}
+
+unsigned int RenderState::autoBindingGetPointLightShadowCount() const
+{
+    return Scene::MAX_NODE_LIGHTS * 2;
+}
+
+unsigned int RenderState::getSharedAutoBindingVersion(const Node* node, int sharedBinding)
+{
+    Scene* scene = node ? node->getScene() : NULL;
+    if (scene == NULL)
+        return 0;
+
+    if (sharedBinding == RS_SHARED_AMBIENT_COLOR)
+    {
+        if (scene->_ambientColorVersion == 0)
+            scene->_ambientColorVersion = MaterialParameter::allocateVersions(1);
+        return scene->_ambientColorVersion;
+    }
+
+    GP_ASSERT(sharedBinding >= RS_SHARED_VIEW_MATRIX && sharedBinding <= RS_SHARED_CAMERA_COUNT);
+    Camera* camera = scene->getActiveCamera();
+    if (camera == NULL)
+        return 0;
+
+    // A new block of versions is allocated the first time a camera is used after it changed.
+    if (camera->_bindingVersion == 0)
+        camera->_bindingVersion = MaterialParameter::allocateVersions(RS_SHARED_CAMERA_COUNT);
+    return camera->_bindingVersion + (sharedBinding - RS_SHARED_VIEW_MATRIX);
+}
+
 void RenderState::bind(Pass* pass)
 {
     GP_ASSERT(pass);
 
+    bindState();
+    bindParameters(pass->getEffect(), !pass->isDepthPass());
+}
+
+void RenderState::bindState()
+{
     // Get the combined modified state bits for our RenderState hierarchy.
     long stateOverrideBits = _state ? _state->_bits : 0;
     RenderState* rs = _parent;
@@ -420,22 +1108,67 @@ void RenderState::bind(Pass* pass)
     // Restore renderer state to its default, except for explicitly specified states
     StateBlock::restore(stateOverrideBits);
 
-    // Apply parameter bindings and renderer state for the entire hierarchy, top-down.
+    // Apply renderer state for the entire hierarchy, top-down.
     rs = NULL;
-    Effect* effect = pass->getEffect();
+    while ((rs = getTopmost(rs)))
+    {
+        if (rs->_state)
+        {
+            rs->_state->bindNoRestore();
+        }
+    }
+}
+
+void RenderState::bindParameters(Effect* effect, bool warnMissing)
+{
+    GP_ASSERT(effect);
+
+    // Apply parameter bindings for the entire hierarchy, top-down.
+    RenderState* rs = NULL;
     while ((rs = getTopmost(rs)))
     {
         for (size_t i = 0, count = rs->_parameters.size(); i < count; ++i)
         {
             GP_ASSERT(rs->_parameters[i]);
-            rs->_parameters[i]->bind(effect);
+            rs->_parameters[i]->bind(effect, warnMissing);
+        }
+    }
+}
+
+bool RenderState::isBlendEnabled() const
+{
+    for (const RenderState* rs = this; rs != NULL; rs = rs->_parent)
+    {
+        if (rs->_state && (rs->_state->_bits & RS_BLEND))
+        {
+            return rs->_state->_blendEnabled;
         }
+    }
+    return false;
+}
 
-        if (rs->_state)
+bool RenderState::isDepthTestEnabled() const
+{
+    for (const RenderState* rs = this; rs != NULL; rs = rs->_parent)
+    {
+        if (rs->_state && (rs->_state->_bits & RS_DEPTH_TEST))
         {
-            rs->_state->bindNoRestore();
+            return rs->_state->_depthTestEnabled;
+        }
+    }
+    return false;
+}
+
+bool RenderState::isDepthWriteEnabled() const
+{
+    for (const RenderState* rs = this; rs != NULL; rs = rs->_parent)
+    {
+        if (rs->_state && (rs->_state->_bits & RS_DEPTH_WRITE))
+        {
+            return rs->_state->_depthWriteEnabled;
         }
     }
+    return true;
 }
 
 RenderState* RenderState::getTopmost(RenderState* below)
@@ -8,6 +8,7 @@
 namespace gameplay
 {
 
+class Effect;
 class MaterialParameter;
 class Node;
 class NodeCloneContext;
@@ -23,6 +24,10 @@ class RenderState : public Ref
     friend class Technique;
     friend class Pass;
     friend class Model;
+    friend class RenderQueue;
+    friend class RenderCommandList;
+    friend class MaterialParameter;
+    friend class PlanarReflection;
 
 public:
 
@@ -156,10 +161,90 @@ public:
          */
         MATRIX_PALETTE,
 
+        /**
+         * Binds the dual quaternion palette of MeshSkin attached to a node's model.
+         */
+        DUAL_QUATERNION_PALETTE,
+
         /**
          * Binds the current scene's ambient color (Vector3).
          */
-        SCENE_AMBIENT_COLOR
+        SCENE_AMBIENT_COLOR,
+
+        /**
+         * Binds the scale (Vector3) that decodes the quantized positions of the mesh of a node's model.
+         */
+        POSITION_DECODE_SCALE,
+
+        /**
+         * Binds the offset (Vector3) that decodes the quantized positions of the mesh of a node's model.
+         */
+        POSITION_DECODE_OFFSET,
+
+        /**
+         * Binds the colors (Vector3 array) of the point lights that most influence a node (see Scene::getNodeLights).
+         */
+        POINT_LIGHT_COLOR,
+
+        /**
+         * Binds the view-space positions (Vector3 array) of the point lights that most influence a node.
+         */
+        POINT_LIGHT_POSITION,
+
+        /**
+         * Binds the inverse ranges (float array) of the point lights that most influence a node.
+         */
+        POINT_LIGHT_RANGE_INVERSE,
+
+        /**
+         * Binds the colors (Vector3 array) of the spot lights that most influence a node (see Scene::getNodeLights).
+         */
+        SPOT_LIGHT_COLOR,
+
+        /**
+         * Binds the view-space positions (Vector3 array) of the spot lights that most influence a node.
+         */
+        SPOT_LIGHT_POSITION,
+
+        /**
+         * Binds the view-space directions (Vector3 array) of the spot lights that most influence a node.
+         */
+        SPOT_LIGHT_DIRECTION,
+
+        /**
+         * Binds the inverse ranges (float array) of the spot lights that most influence a node.
+         */
+        SPOT_LIGHT_RANGE_INVERSE,
+
+        /**
+         * Binds the cosines of the inner angles (float array) of the spot lights that most influence a node.
+         */
+        SPOT_LIGHT_INNER_ANGLE_COS,
+
+        /**
+         * Binds the cosines of the outer angles (float array) of the spot lights that most influence a node.
+         */
+        SPOT_LIGHT_OUTER_ANGLE_COS,
+
+        /**
+         * Binds the colors (Vector3 array) of the directional lights that most influence a node (see Scene::getNodeLights).
+         */
+        DIRECTIONAL_LIGHT_COLOR,
+
+        /**
+         * Binds the view-space directions (Vector3 array) of the directional lights that most influence a node.
+         */
+        DIRECTIONAL_LIGHT_DIRECTION,
+
+        /**
+         * Binds the shadow matrices (Matrix array) of the spot lights that most influence a node (see ShadowMaps).
+         */
+        SPOT_LIGHT_SHADOW_MATRIX,
+
+        /**
+         * Binds the shadow cube parameters (Vector4 array, two for each light) of the point lights that most influence a node (see ShadowMaps).
+         */
+        POINT_LIGHT_SHADOW
     };
 
     /**
@@ -571,6 +656,143 @@ public:
      */
     virtual void setNodeBinding(Node* node);
 
+    /**
+     * Makes the specified program current, unless it is already current.
+     *
+     * All GL program, buffer, vertex array and texture bindings made by the engine
+     * go through a shadow copy of the GL state so that calls that would not change
+     * the state are skipped.
+     *
+     * @param program The GL program object to use.
+     * @script{ignore}
+     */
+    static void useProgram(GLuint program);
+
+    /**
+     * Binds a buffer object to the specified target, unless it is already bound.
+     *
+     * @param target The buffer target (GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER).
+     * @param buffer The buffer object to bind.
+     * @script{ignore}
+     */
+    static void bindBuffer(GLenum target, GLuint buffer);
+
+    /**
+     * Binds a vertex array object, unless it is already bound.
+     *
+     * @param array The vertex array object to bind (0 for client side arrays).
+     * @script{ignore}
+     */
+    static void bindVertexArray(GLuint array);
+
+    /**
+     * Selects the active texture unit, unless it is already active.
+     *
+     * @param unit The zero-based texture unit index.
+     * @script{ignore}
+     */
+    static void activeTexture(unsigned int unit);
+
+    /**
+     * Binds a texture to the active texture unit, unless it is already bound.
+     *
+     * @param target The texture target (GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP).
+     * @param texture The texture object to bind.
+     * @script{ignore}
+     */
+    static void bindTexture(GLenum target, GLuint texture);
+
+    /**
+     * Returns the sampler object with the specified filtering and wrapping.
+     *
+     * Sampler objects are created the first time that their state is requested and are
+     * shared by every Texture::Sampler with the same state until the game shuts down.
+     *
+     * @param minFilter The minification filter.
+     * @param magFilter The magnification filter.
+     * @param wrapS The wrap mode of the s coordinate.
+     * @param wrapT The wrap mode of the t coordinate.
+     * @param wrapR The wrap mode of the r coordinate.
+     *
+     * @return The sampler object, or 0 if sampler objects are not supported.
+     * @script{ignore}
+     */
+    static GLuint getSamplerObject(GLenum minFilter, GLenum magFilter, GLenum wrapS, GLenum wrapT, GLenum wrapR);
+
+    /**
+     * Binds a sampler object to the active texture unit, unless it is already bound.
+     *
+     * @param sampler The sampler object to bind (0 to use the parameters of the texture).
+     *
+     * @return true if the sampler was bound, false if sampler objects are not supported or
+     *      the active texture unit was not selected with activeTexture().
+     * @script{ignore}
+     */
+    static bool bindSampler(GLuint sampler);
+
+    /**
+     * Deletes a program object and removes it from the state cache.
+     *
+     * GL objects are not deleted right away, since draws that are still in flight on the GPU may
+     * use them, which would make the driver wait for them. They are queued and deleted a few frames
+     * later, at the start of a frame, after the previous frame has been presented. The delete
+     * functions may therefore be called from any thread, such as when the last reference to a
+     * resource is released by a worker thread.
+     *
+     * @param program The program object to delete.
+     * @script{ignore}
+     */
+    static void deleteProgram(GLuint program);
+
+    /**
+     * Deletes a buffer object and removes it from the state cache, a few frames later.
+     *
+     * @param buffer The buffer object to delete.
+     * @script{ignore}
+     */
+    static void deleteBuffer(GLuint buffer);
+
+    /**
+     * Deletes a vertex array object and removes it from the state cache, a few frames later.
+     *
+     * @param array The vertex array object to delete.
+     * @script{ignore}
+     */
+    static void deleteVertexArray(GLuint array);
+
+    /**
+     * Deletes a texture object and removes it from the state cache, a few frames later.
+     *
+     * @param texture The texture object to delete.
+     * @script{ignore}
+     */
+    static void deleteTexture(GLuint texture);
+
+    /**
+     * Deletes a frame buffer object, a few frames later.
+     *
+     * @param frameBuffer The frame buffer object to delete.
+     * @script{ignore}
+     */
+    static void deleteFrameBuffer(GLuint frameBuffer);
+
+    /**
+     * Deletes a render buffer object, a few frames later.
+     *
+     * @param renderBuffer The render buffer object to delete.
+     * @script{ignore}
+     */
+    static void deleteRenderBuffer(GLuint renderBuffer);
+
+    /**
+     * Discards the cached program, buffer, vertex array, texture and sampler bindings.
+     *
+     * This must be called after GL state has been changed by code that does not
+     * go through RenderState (i.e. third party libraries issuing raw GL calls), so
+     * the next bindings are sent to GL again.
+     */
+    static void resetStateCache();
+
 protected:
 
     /**
@@ -593,6 +815,14 @@ protected:
      */
     static void finalize();
 
+    /**
+     * Deletes the queued GL objects that were queued long enough ago that the GPU no longer uses
+     * them, or all of them. This is called at the start of each frame.
+     *
+     * @param all true to delete all of the queued objects, regardless of when they were queued.
+     */
+    static void deleteQueuedObjects(bool all = false);
+
     /**
      * Applies the specified custom auto-binding.
      *
@@ -607,6 +837,20 @@ protected:
      */
     void bind(Pass* pass);
 
+    /**
+     * Binds the renderer state of this RenderState and any of its parents, top-down.
+     */
+    void bindState();
+
+    /**
+     * Binds the material parameters of this RenderState and any of its parents, top-down,
+     * to the given effect.
+     *
+     * Depth variants of passes share the parameters of their passes, many of which are only
+     * used by the fragment shaders of the passes, so they bind with warnMissing set to false.
+     */
+    void bindParameters(Effect* effect, bool warnMissing = true);
+
     /**
      * Returns the topmost RenderState in the hierarchy below the given RenderState.
      */
@@ -632,6 +876,24 @@ private:
      */
     RenderState& operator=(const RenderState&);
 
+    /**
+     * Determines if blending will be enabled when this RenderState is bound.
+     *
+     * The state blocks of this RenderState and its parents are searched bottom-up,
+     * since the lowest explicitly set blend state is the one that takes effect.
+     */
+    bool isBlendEnabled() const;
+
+    /**
+     * Determines if depth testing will be enabled when this RenderState is bound, like isBlendEnabled.
+     */
+    bool isDepthTestEnabled() const;
+
+    /**
+     * Determines if depth writing will be enabled when this RenderState is bound, like isBlendEnabled.
+     */
+    bool isDepthWriteEnabled() const;
+
     // Internal auto binding handler methods.
     const Matrix& autoBindingGetWorldMatrix() const;
     const Matrix& autoBindingGetViewMatrix() const;
@@ -645,9 +907,41 @@ private:
     Vector3 autoBindingGetCameraViewPosition() const;
     const Vector4* autoBindingGetMatrixPalette() const;
     unsigned int autoBindingGetMatrixPaletteSize() const;
+    const Vector4* autoBindingGetDualQuaternionPalette() const;
+    unsigned int autoBindingGetDualQuaternionPaletteSize() const;
     const Vector3& autoBindingGetAmbientColor() const;
+    const Vector3& autoBindingGetPositionDecodeScale() const;
+    const Vector3& autoBindingGetPositionDecodeOffset() const;
     const Vector3& autoBindingGetLightColor() const;
     const Vector3& autoBindingGetLightDirection() const;
+    const Vector3* autoBindingGetPointLightColor() const;
+    const Vector3* autoBindingGetPointLightPosition() const;
+    const float* autoBindingGetPointLightRangeInverse() const;
+    const Vector3* autoBindingGetSpotLightColor() const;
+    const Vector3* autoBindingGetSpotLightPosition() const;
+    const Vector3* autoBindingGetSpotLightDirection() const;
+    const float* autoBindingGetSpotLightRangeInverse() const;
+    const float* autoBindingGetSpotLightInnerAngleCos() const;
+    const float* autoBindingGetSpotLightOuterAngleCos() const;
+    const Vector3* autoBindingGetDirectionalLightColor() const;
+    const Vector3* autoBindingGetDirectionalLightDirection() const;
+    const Matrix* autoBindingGetSpotLightShadowMatrix() const;
+    const Vector4* autoBindingGetPointLightShadow() const;
+    unsigned int autoBindingGetNodeLightCount() const;
+    unsigned int autoBindingGetPointLightShadowCount() const;
+
+    /**
+     * Returns the version of a per-camera or per-scene auto binding value for the given node.
+     *
+     * Every draw that resolves the binding to the same camera or scene shares the version,
+     * so the value is only uploaded to an effect again after the camera or scene changes.
+     *
+     * @param node The node the auto binding was resolved for.
+     * @param sharedBinding The kind of shared auto binding.
+     *
+     * @return The version of the value, or zero if it cannot be determined.
+     */
+    static unsigned int getSharedAutoBindingVersion(const Node* node, int sharedBinding);
 
 protected:
 
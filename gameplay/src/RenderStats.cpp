@@ -0,0 +1,99 @@
+#include "Base.h"
+#include "RenderStats.h"
+#include "Font.h"
+
+namespace gameplay
+{
+
+RenderStats RenderStats::_currentFrame;
+RenderStats RenderStats::_lastFrame;
+
+RenderStats::RenderStats()
+{
+    reset();
+}
+
+void RenderStats::reset()
+{
+    drawCalls = 0;
+    primitives = 0;
+    programBinds = 0;
+    textureBinds = 0;
+    uniformUploads = 0;
+    bufferUploads = 0;
+    bufferUploadBytes = 0;
+    frameBufferBinds = 0;
+}
+
+static bool isWithinLimit(unsigned int value, unsigned int limit)
+{
+    return limit == 0 || value <= limit;
+}
+
+bool RenderStats::isWithin(const RenderStats& budget) const
+{
+    return isWithinLimit(drawCalls, budget.drawCalls) &&
+           isWithinLimit(primitives, budget.primitives) &&
+           isWithinLimit(programBinds, budget.programBinds) &&
+           isWithinLimit(textureBinds, budget.textureBinds) &&
+           isWithinLimit(uniformUploads, budget.uniformUploads) &&
+           isWithinLimit(bufferUploads, budget.bufferUploads) &&
+           isWithinLimit(bufferUploadBytes, budget.bufferUploadBytes) &&
+           isWithinLimit(frameBufferBinds, budget.frameBufferBinds);
+}
+
+void RenderStats::draw(Font* font, const Vector4& color, int x, int y, unsigned int size) const
+{
+    GP_ASSERT(font);
+
+    char lines[7][64];
+    sprintf(lines[0], "Draw calls: %u", drawCalls);
+    sprintf(lines[1], "Primitives: %u", primitives);
+    sprintf(lines[2], "Program binds: %u", programBinds);
+    sprintf(lines[3], "Texture binds: %u", textureBinds);
+    sprintf(lines[4], "Uniform uploads: %u", uniformUploads);
+    sprintf(lines[5], "Buffer uploads: %u (%u KB)", bufferUploads, bufferUploadBytes / 1024);
+    sprintf(lines[6], "Frame buffer binds: %u", frameBufferBinds);
+
+    int lineHeight = (int)(size ? size : font->getSize());
+    font->start();
+    for (unsigned int i = 0; i < 7; ++i)
+    {
+        font->drawText(lines[i], x, y + lineHeight * (int)i, color, size);
+    }
+    font->finish();
+}
+
+void RenderStats::countDraw(GLenum primitiveType, unsigned int count, unsigned int instances)
+{
+    unsigned int primitiveCount;
+    switch (primitiveType)
+    {
+    case GL_TRIANGLES:
+        primitiveCount = count / 3;
+        break;
+    case GL_TRIANGLE_STRIP:
+    case GL_TRIANGLE_FAN:
+        primitiveCount = count > 2 ? count - 2 : 0;
+        break;
+    case GL_LINES:
+        primitiveCount = count / 2;
+        break;
+    case GL_LINE_STRIP:
+        primitiveCount = count > 1 ? count - 1 : 0;
+        break;
+    default:
+        primitiveCount = count;
+        break;
+    }
+    ++_currentFrame.drawCalls;
+    _currentFrame.primitives += primitiveCount * instances;
+}
+
+void RenderStats::endFrame()
+{
+    _lastFrame = _currentFrame;
+    _currentFrame.reset();
+}
+
+}
@@ -0,0 +1,166 @@
+#ifndef RENDERSTATS_H_
+#define RENDERSTATS_H_
+
+#include "Vector4.h"
+
+namespace gameplay
+{
+
+class Font;
+
+/**
+ * Defines counters of the graphics work and the state changes that the engine submits in a frame.
+ *
+ * The counters are updated where the engine issues the GL calls: the draws that are submitted
+ * through the GraphicsDevice, the program and texture binds that pass the RenderState cache,
+ * the uniform uploads of the effects and the uploads of vertex and index data. The counters of the last complete frame are returned by Game::getRenderStats.
+ *
+ * A set of counters can also be used as a budget (see isWithin), and drawn as an overlay (see draw).
+ *
+ * @script{ignore}
+ */
+class RenderStats
+{
+    friend class Game;
+
+public:
+
+    /**
+     * The number of draw calls.
+     */
+    unsigned int drawCalls;
+
+    /**
+     * The number of points, lines and triangles drawn, including all instances.
+     */
+    unsigned int primitives;
+
+    /**
+     * The number of times that a different shader program was made current.
+     */
+    unsigned int programBinds;
+
+    /**
+     * The number of times that a different texture was bound to a texture unit.
+     */
+    unsigned int textureBinds;
+
+    /**
+     * The number of uniform uploads.
+     */
+    unsigned int uniformUploads;
+
+    /**
+     * The number of uploads of vertex, index and instance data.
+     */
+    unsigned int bufferUploads;
+
+    /**
+     * The number of bytes of vertex, index and instance data uploaded.
+     */
+    unsigned int bufferUploadBytes;
+
+    /**
+     * The number of frame buffer binds.
+     */
+    unsigned int frameBufferBinds;
+
+    /**
+     * Constructs a set of counters that are all zero.
+     */
+    RenderStats();
+
+    /**
+     * Sets all counters to zero.
+     */
+    void reset();
+
+    /**
+     * Determines whether these counters are within the specified budget.
+     *
+     * @param budget The maximum value of each counter, where 0 means no limit.
+     *
+     * @return true if no counter exceeds its limit, false otherwise.
+     */
+    bool isWithin(const RenderStats& budget) const;
+
+    /**
+     * Draws these counters as lines of text.
+     *
+     * This should be called after the scene has been drawn, since drawing the text adds to the
+     * counters of the frame.
+     *
+     * @param font The font to draw the text with.
+     * @param color The color of the text.
+     * @param x The viewport x position of the first line.
+     * @param y The viewport y position of the first line.
+     * @param size The size to draw the text (0 for the default size of the font).
+     */
+    void draw(Font* font, const Vector4& color, int x, int y, unsigned int size = 0) const;
+
+    /**
+     * Returns the counters of the frame that is being drawn.
+     *
+     * @return The counters of the current frame.
+     */
+    static const RenderStats& getCurrentFrame();
+
+    /**
+     * Returns the counters of the last complete frame.
+     *
+     * @return The counters of the last frame.
+     */
+    static const RenderStats& getLastFrame();
+
+    /**
+     * Counts a draw call. This is called by the GraphicsDevice for each draw.
+     *
+     * @param primitiveType The type of primitives drawn.
+     * @param count The number of vertices or indices drawn.
+     * @param instances The number of instances drawn.
+     */
+    static void countDraw(GLenum primitiveType, unsigned int count, unsigned int instances = 1);
+
+    /**
+     * Counts a program bind. This is called by the RenderState cache.
+     */
+    static void countProgramBind();
+
+    /**
+     * Counts a texture bind. This is called by the RenderState cache.
+     */
+    static void countTextureBind();
+
+    /**
+     * Counts a uniform upload. This is called by the effects.
+     */
+    static void countUniformUpload();
+
+    /**
+     * Counts an upload of buffer data. This is called by the engine where it uploads buffer data.
+     *
+     * @param bytes The number of bytes uploaded.
+     */
+    static void countBufferUpload(size_t bytes);
+
+    /**
+     * Counts a frame buffer bind. This is called by the frame buffers.
+     */
+    static void countFrameBufferBind();
+
+private:
+
+    /**
+     * Makes the counters of the current frame the counters of the last frame, and resets them.
+     */
+    static void endFrame();
+
+    static RenderStats _currentFrame;
+    static RenderStats _lastFrame;
+};
+
+}
+
+#include "RenderStats.inl"
+
+#endif
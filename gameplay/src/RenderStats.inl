@@ -0,0 +1,42 @@
+#include "RenderStats.h"
+
+namespace gameplay
+{
+
+inline const RenderStats& RenderStats::getCurrentFrame()
+{
+    return _currentFrame;
+}
+
+inline const RenderStats& RenderStats::getLastFrame()
+{
+    return _lastFrame;
+}
+
+inline void RenderStats::countProgramBind()
+{
+    ++_currentFrame.programBinds;
+}
+
+inline void RenderStats::countTextureBind()
+{
+    ++_currentFrame.textureBinds;
+}
+
+inline void RenderStats::countUniformUpload()
+{
+    ++_currentFrame.uniformUploads;
+}
+
+inline void RenderStats::countBufferUpload(size_t bytes)
+{
+    ++_currentFrame.bufferUploads;
+    _currentFrame.bufferUploadBytes += (unsigned int)bytes;
+}
+
+inline void RenderStats::countFrameBufferBind()
+{
+    ++_currentFrame.frameBufferBinds;
+}
+
+}
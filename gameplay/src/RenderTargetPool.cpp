@@ -0,0 +1,187 @@
+#include "Base.h"
+#include "RenderTargetPool.h"
+#include "FrameBuffer.h"
+#include "Game.h"
+
+namespace gameplay
+{
+
+RenderTargetPool::RenderTargetPool(unsigned int maxIdleFrames)
+    : _maxIdleFrames(maxIdleFrames), _frame(0), _nextId(0)
+{
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+    for (size_t i = 0, count = _targets.size(); i < count; ++i)
+    {
+        SAFE_RELEASE(_targets[i].frameBuffer);
+    }
+}
+
+FrameBuffer* RenderTargetPool::acquire(unsigned int width, unsigned int height, Texture::Format format, bool depth, DepthStencilTarget::Format depthFormat)
+{
+    GP_ASSERT(width > 0 && height > 0);
+
+    // Reuse the free target that was used last, since it is the most likely to still be resident.
+    Target* free = NULL;
+    for (size_t i = 0, count = _targets.size(); i < count; ++i)
+    {
+        Target& target = _targets[i];
+        if (!target.acquired && target.width == width && target.height == height && target.format == format &&
+            target.depth == depth && (!depth || target.depthFormat == depthFormat) &&
+            (!free || target.lastFrame > free->lastFrame))
+        {
+            free = &target;
+        }
+    }
+    if (free)
+    {
+        free->acquired = true;
+        free->lastFrame = _frame;
+        return free->frameBuffer;
+    }
+
+    // The targets have ids of their own, so that they can be told apart in captures of GPU markers.
+    char id[48];
+    sprintf(id, "RenderTargetPool.%u", _nextId++);
+    Texture* texture = Texture::create(format, width, height, NULL, false);
+    if (texture == NULL)
+    {
+        GP_ERROR("Failed to create texture for pooled render target '%s'.", id);
+        return NULL;
+    }
+    RenderTarget* renderTarget = RenderTarget::create(id, texture);
+    SAFE_RELEASE(texture);
+
+    FrameBuffer* frameBuffer = FrameBuffer::create(id);
+    frameBuffer->setRenderTarget(renderTarget);
+    SAFE_RELEASE(renderTarget);
+    if (depth)
+    {
+        DepthStencilTarget* depthTarget = DepthStencilTarget::create(id, depthFormat, width, height);
+        if (depthTarget == NULL)
+        {
+            GP_ERROR("Failed to create depth target for pooled render target '%s'.", id);
+            SAFE_RELEASE(frameBuffer);
+            return NULL;
+        }
+        frameBuffer->setDepthStencilTarget(depthTarget);
+        SAFE_RELEASE(depthTarget);
+
+        // The depth of a transient target is never read once the pass is done with it.
+        frameBuffer->setInvalidateOnUnbind(Game::CLEAR_DEPTH_STENCIL);
+    }
+
+    Target target;
+    target.frameBuffer = frameBuffer;
+    target.width = width;
+    target.height = height;
+    target.format = format;
+    target.depth = depth;
+    target.depthFormat = depthFormat;
+    target.acquired = true;
+    target.lastFrame = _frame;
+    _targets.push_back(target);
+    return frameBuffer;
+}
+
+void RenderTargetPool::release(FrameBuffer* frameBuffer)
+{
+    if (frameBuffer == NULL)
+        return;
+
+    for (size_t i = 0, count = _targets.size(); i < count; ++i)
+    {
+        Target& target = _targets[i];
+        if (target.frameBuffer == frameBuffer)
+        {
+            GP_ASSERT(target.acquired);
+            target.acquired = false;
+            target.lastFrame = _frame;
+            return;
+        }
+    }
+    GP_ERROR("Failed to release frame buffer '%s'; it was not acquired from this render target pool.", frameBuffer->getId());
+}
+
+void RenderTargetPool::endFrame()
+{
+    for (size_t i = 0; i < _targets.size();)
+    {
+        Target& target = _targets[i];
+        if (target.acquired)
+        {
+            GP_WARN("Pooled render target '%s' is still acquired at the end of the frame.", target.frameBuffer->getId());
+        }
+        else if (_frame - target.lastFrame >= _maxIdleFrames)
+        {
+            SAFE_RELEASE(target.frameBuffer);
+            _targets.erase(_targets.begin() + i);
+            continue;
+        }
+        ++i;
+    }
+    ++_frame;
+}
+
+void RenderTargetPool::clear()
+{
+    for (size_t i = 0; i < _targets.size();)
+    {
+        if (!_targets[i].acquired)
+        {
+            SAFE_RELEASE(_targets[i].frameBuffer);
+            _targets.erase(_targets.begin() + i);
+            continue;
+        }
+        ++i;
+    }
+}
+
+unsigned int RenderTargetPool::getTargetCount() const
+{
+    return (unsigned int)_targets.size();
+}
+
+unsigned int RenderTargetPool::getAcquiredCount() const
+{
+    unsigned int count = 0;
+    for (size_t i = 0, size = _targets.size(); i < size; ++i)
+    {
+        if (_targets[i].acquired)
+            ++count;
+    }
+    return count;
+}
+
+size_t RenderTargetPool::getMemorySize() const
+{
+    size_t size = 0;
+    for (size_t i = 0, count = _targets.size(); i < count; ++i)
+    {
+        size += getMemorySize(_targets[i]);
+    }
+    return size;
+}
+
+size_t RenderTargetPool::getMemorySize(const Target& target)
+{
+    size_t bytesPerPixel;
+    switch (target.format)
+    {
+    case Texture::RGB:
+        // Most drivers pad three channel targets to four.
+    case Texture::RGBA:
+        bytesPerPixel = 4;
+        break;
+    default:
+        bytesPerPixel = 1;
+        break;
+    }
+    if (target.depth)
+        bytesPerPixel += 4;
+    return (size_t)target.width * target.height * bytesPerPixel;
+}
+
+}
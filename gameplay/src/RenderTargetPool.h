@@ -0,0 +1,153 @@
+#ifndef RENDERTARGETPOOL_H_
+#define RENDERTARGETPOOL_H_
+
+#include "Texture.h"
+#include "DepthStencilTarget.h"
+
+namespace gameplay
+{
+
+class FrameBuffer;
+
+/**
+ * Defines a pool of transient frame buffers, for the intermediate targets of passes that
+ * only need them for part of a frame, such as post-processing chains.
+ *
+ * A frame buffer is acquired with the size and formats it needs and released as soon as its
+ * contents are no longer needed, usually once the next pass has read it. A released frame buffer
+ * is handed out again to the next pass that asks for the same size and formats, in the same frame
+ * or a later one, so that targets whose lifetimes do not overlap share the same memory:
+ *
+ * @code
+ * FrameBuffer* bright = _pool.acquire(width / 2, height / 2);
+ * ... // Draw the bright parts of the scene into it.
+ * FrameBuffer* blur = _pool.acquire(width / 2, height / 2);
+ * ... // Blur them horizontally into it.
+ * _pool.release(bright);
+ * FrameBuffer* blur2 = _pool.acquire(width / 2, height / 2); // The bright target again.
+ * ... // Blur them vertically into it.
+ * _pool.release(blur);
+ * ...
+ * _pool.endFrame();
+ * @endcode
+ *
+ * The frame buffers that have not been acquired for a few frames are released by endFrame(),
+ * so the targets of a previous resolution go away on their own once the resolution changes.
+ * The contents of an acquired frame buffer are undefined until it is drawn into.
+ *
+ * @script{ignore}
+ */
+class RenderTargetPool
+{
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param maxIdleFrames The number of frames a released frame buffer is kept for before it
+     *      is destroyed, if it is not acquired again.
+     */
+    RenderTargetPool(unsigned int maxIdleFrames = 2);
+
+    /**
+     * Destructor. Every frame buffer of the pool is destroyed, so none of them should still be in use.
+     */
+    ~RenderTargetPool();
+
+    /**
+     * Acquires a frame buffer with a color target and, optionally, a depth target.
+     *
+     * The frame buffer belongs to the pool, and should be given back with release() rather than
+     * released directly.
+     *
+     * @param width The width of the targets.
+     * @param height The height of the targets.
+     * @param format The format of the color target.
+     * @param depth Whether the frame buffer has a depth target.
+     * @param depthFormat The format of the depth target, if it has one.
+     *
+     * @return The frame buffer, or NULL if it could not be created.
+     */
+    FrameBuffer* acquire(unsigned int width, unsigned int height, Texture::Format format = Texture::RGBA,
+                         bool depth = false, DepthStencilTarget::Format depthFormat = DepthStencilTarget::DEPTH);
+
+    /**
+     * Gives a frame buffer back to the pool, after which it may be acquired again by any pass.
+     *
+     * @param frameBuffer The frame buffer, which must have been acquired from this pool.
+     */
+    void release(FrameBuffer* frameBuffer);
+
+    /**
+     * Ends the frame of the pool, destroying the frame buffers that have not been acquired for
+     * more than the number of idle frames of the pool.
+     *
+     * Frame buffers are meant to be released in the frame they were acquired in, so a warning
+     * is logged for those that are still acquired.
+     */
+    void endFrame();
+
+    /**
+     * Destroys the frame buffers of the pool that are not acquired.
+     */
+    void clear();
+
+    /**
+     * Returns the number of frame buffers of the pool, acquired or not.
+     *
+     * @return The number of frame buffers.
+     */
+    unsigned int getTargetCount() const;
+
+    /**
+     * Returns the number of frame buffers of the pool that are acquired.
+     *
+     * @return The number of acquired frame buffers.
+     */
+    unsigned int getAcquiredCount() const;
+
+    /**
+     * Returns an estimate of the memory that the targets of the pool use on the GPU.
+     *
+     * @return The size, in bytes.
+     */
+    size_t getMemorySize() const;
+
+private:
+
+    /**
+     * A frame buffer of the pool, with the size and formats it was created with.
+     */
+    struct Target
+    {
+        FrameBuffer* frameBuffer;
+        unsigned int width;
+        unsigned int height;
+        Texture::Format format;
+        bool depth;
+        DepthStencilTarget::Format depthFormat;
+        bool acquired;
+        unsigned int lastFrame;
+    };
+
+    /**
+     * Hidden copy constructor.
+     */
+    RenderTargetPool(const RenderTargetPool& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    RenderTargetPool& operator=(const RenderTargetPool&);
+
+    static size_t getMemorySize(const Target& target);
+
+    std::vector<Target> _targets;
+    unsigned int _maxIdleFrames;
+    unsigned int _frame;
+    unsigned int _nextId;
+};
+
+}
+
+#endif
@@ -0,0 +1,200 @@
+#include "Base.h"
+#include "ResourceCache.h"
+#include "FileSystem.h"
+
+namespace gameplay
+{
+
+ResourceCache::ResourceCache()
+    : _head(NULL), _tail(NULL), _budget(0), _memoryUsage(0)
+{
+}
+
+ResourceCache::~ResourceCache()
+{
+}
+
+std::string ResourceCache::resolveKey(const char* path, const char* id)
+{
+    GP_ASSERT(path);
+
+    std::string key(FileSystem::resolvePath(path));
+    std::replace(key.begin(), key.end(), '\\', '/');
+    if (id)
+    {
+        key += '#';
+        key += id;
+    }
+    return key;
+}
+
+Ref* ResourceCache::find(const char* path, const char* id)
+{
+    std::unordered_map<std::string, Entry>::iterator itr = _entries.find(resolveKey(path, id));
+    if (itr == _entries.end())
+        return NULL;
+
+    Entry* entry = &itr->second;
+    if (entry != _head)
+    {
+        unlink(entry);
+        link(entry);
+    }
+
+    // Keep resources that are found again while there is a budget.
+    if (_budget > 0 && !entry->retained)
+    {
+        entry->resource->addRef();
+        entry->retained = true;
+    }
+    return entry->resource;
+}
+
+void ResourceCache::add(const char* path, Ref* resource, size_t size, const char* id)
+{
+    GP_ASSERT(resource);
+
+    std::pair<std::unordered_map<std::string, Entry>::iterator, bool> result = _entries.insert(std::make_pair(resolveKey(path, id), Entry()));
+    Entry* entry = &result.first->second;
+    if (!result.second)
+    {
+        // Replace the resource that was cached with the same path.
+        GP_WARN("Replacing the cached resource for path '%s'.", path);
+        Ref* previous = entry->retained ? entry->resource : NULL;
+        unlink(entry);
+        _memoryUsage -= entry->size;
+        entry->resource = resource;
+        SAFE_RELEASE(previous);
+    }
+
+    entry->resource = resource;
+    entry->size = size;
+    entry->retained = _budget > 0;
+    entry->path = &result.first->first;
+    link(entry);
+    _memoryUsage += size;
+
+    if (entry->retained)
+    {
+        resource->addRef();
+        trim();
+    }
+}
+
+void ResourceCache::remove(const char* path, const Ref* resource, const char* id)
+{
+    std::unordered_map<std::string, Entry>::iterator itr = _entries.find(resolveKey(path, id));
+    if (itr != _entries.end() && itr->second.resource == resource)
+    {
+        erase(&itr->second);
+    }
+}
+
+void ResourceCache::resize(const char* path, const Ref* resource, size_t size, const char* id)
+{
+    std::unordered_map<std::string, Entry>::iterator itr = _entries.find(resolveKey(path, id));
+    if (itr != _entries.end() && itr->second.resource == resource)
+    {
+        _memoryUsage = _memoryUsage - itr->second.size + size;
+        itr->second.size = size;
+    }
+}
+
+void ResourceCache::setBudget(size_t bytes)
+{
+    _budget = bytes;
+    if (_budget == 0)
+        clear();
+    else
+        trim();
+}
+
+size_t ResourceCache::getBudget() const
+{
+    return _budget;
+}
+
+size_t ResourceCache::getMemoryUsage() const
+{
+    return _memoryUsage;
+}
+
+unsigned int ResourceCache::getCount() const
+{
+    return (unsigned int)_entries.size();
+}
+
+void ResourceCache::trim()
+{
+    Entry* entry = _tail;
+    while (entry && _memoryUsage > _budget)
+    {
+        if (entry->retained && entry->resource->getRefCount() == 1)
+        {
+            // Remove the entry before releasing the resource, which removes itself from the cache when it is destroyed.
+            // Destroying the resource may release other cached resources, so start again from the end of the list.
+            Ref* resource = entry->resource;
+            erase(entry);
+            resource->release();
+            entry = _tail;
+        }
+        else
+        {
+            entry = entry->prev;
+        }
+    }
+}
+
+void ResourceCache::clear()
+{
+    // Collect the retained resources first, since releasing them removes their entries.
+    std::vector<Ref*> resources;
+    for (Entry* entry = _head; entry; entry = entry->next)
+    {
+        if (entry->retained)
+        {
+            entry->retained = false;
+            resources.push_back(entry->resource);
+        }
+    }
+    for (size_t i = 0, count = resources.size(); i < count; ++i)
+    {
+        resources[i]->release();
+    }
+}
+
+void ResourceCache::link(Entry* entry)
+{
+    entry->prev = NULL;
+    entry->next = _head;
+    if (_head)
+        _head->prev = entry;
+    else
+        _tail = entry;
+    _head = entry;
+}
+
+void ResourceCache::unlink(Entry* entry)
+{
+    if (entry->prev)
+        entry->prev->next = entry->next;
+    else
+        _head = entry->next;
+    if (entry->next)
+        entry->next->prev = entry->prev;
+    else
+        _tail = entry->prev;
+    entry->prev = entry->next = NULL;
+}
+
+void ResourceCache::erase(Entry* entry)
+{
+    unlink(entry);
+    _memoryUsage -= entry->size;
+
+    // Copy the key, since it is destroyed along with the entry.
+    std::string path(*entry->path);
+    _entries.erase(path);
+}
+
+}
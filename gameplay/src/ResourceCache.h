@@ -0,0 +1,165 @@
+#ifndef RESOURCECACHE_H_
+#define RESOURCECACHE_H_
+
+#include "Ref.h"
+
+namespace gameplay
+{
+
+/**
+ * Defines a cache of shared resources that are looked up by the path they were loaded from.
+ *
+ * Textures, fonts and bundles each keep a resource cache so that loading the same path twice
+ * returns the same object. Paths are resolved through the file system aliases before they are
+ * hashed, so different aliases of the same file share a cache entry. Resources can also be cached
+ * by path and ID, for files that contain more than one resource.
+ *
+ * By default the cache does not own its resources: a resource is removed from the cache when it
+ * is destroyed. When a memory budget is set, the cache also keeps a reference to each resource
+ * so that resources which are released and then loaded again (such as when switching between
+ * levels) do not have to be reloaded. Resources that are only referenced by the cache are then
+ * evicted, least recently used first, whenever the memory of all the cached resources exceeds
+ * the budget. Resources that are still in use are never evicted.
+ *
+ * Resource caches are only used from the thread that runs the game.
+ *
+ * @script{ignore}
+ */
+class ResourceCache
+{
+public:
+
+    /**
+     * Constructor.
+     */
+    ResourceCache();
+
+    /**
+     * Destructor.
+     */
+    ~ResourceCache();
+
+    /**
+     * Finds the resource that was loaded from the specified path and marks it as recently used.
+     *
+     * @param path The path of the resource.
+     * @param id The ID of the resource within the file, or NULL.
+     *
+     * @return The cached resource, or NULL if there is none. The reference count is not changed.
+     */
+    Ref* find(const char* path, const char* id = NULL);
+
+    /**
+     * Adds a resource to the cache.
+     *
+     * @param path The path that the resource was loaded from.
+     * @param resource The resource to add.
+     * @param size The approximate number of bytes of memory used by the resource.
+     * @param id The ID of the resource within the file, or NULL.
+     */
+    void add(const char* path, Ref* resource, size_t size, const char* id = NULL);
+
+    /**
+     * Removes a resource from the cache. This is called by resources when they are destroyed.
+     *
+     * @param path The path that the resource was added with.
+     * @param resource The resource to remove. Nothing is removed if a different resource is cached for the path.
+     * @param id The ID that the resource was added with, or NULL.
+     */
+    void remove(const char* path, const Ref* resource, const char* id = NULL);
+
+    /**
+     * Updates the memory that a cached resource uses, such as when a texture is loaded again at a
+     * different size. Resources are not evicted until the cache is next trimmed.
+     *
+     * @param path The path that the resource was added with.
+     * @param resource The cached resource. Nothing is changed if a different resource is cached for the path.
+     * @param size The approximate number of bytes of memory used by the resource.
+     * @param id The ID that the resource was added with, or NULL.
+     */
+    void resize(const char* path, const Ref* resource, size_t size, const char* id = NULL);
+
+    /**
+     * Sets the memory budget of the cache.
+     *
+     * @param bytes The number of bytes that cached resources may use before unused ones are evicted,
+     *      or 0 to only cache resources while they are in use.
+     */
+    void setBudget(size_t bytes);
+
+    /**
+     * Returns the memory budget of the cache.
+     *
+     * @return The memory budget in bytes, or 0 if there is none.
+     */
+    size_t getBudget() const;
+
+    /**
+     * Returns the memory used by all the resources in the cache.
+     *
+     * @return The approximate number of bytes used by cached resources.
+     */
+    size_t getMemoryUsage() const;
+
+    /**
+     * Returns the number of resources in the cache.
+     *
+     * @return The number of cached resources.
+     */
+    unsigned int getCount() const;
+
+    /**
+     * Evicts unused resources, least recently used first, until the cache is within its budget.
+     */
+    void trim();
+
+    /**
+     * Releases the references that the cache holds on its resources.
+     *
+     * Resources that are still in use stay in the cache until they are destroyed.
+     */
+    void clear();
+
+private:
+
+    /**
+     * A cached resource, linked into the list of resources ordered from most to least recently used.
+     */
+    struct Entry
+    {
+        Ref* resource;
+        size_t size;
+        bool retained;
+        const std::string* path;
+        Entry* prev;
+        Entry* next;
+    };
+
+    /**
+     * Hidden copy constructor.
+     */
+    ResourceCache(const ResourceCache& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    ResourceCache& operator=(const ResourceCache&);
+
+    static std::string resolveKey(const char* path, const char* id);
+
+    void link(Entry* entry);
+
+    void unlink(Entry* entry);
+
+    void erase(Entry* entry);
+
+    std::unordered_map<std::string, Entry> _entries;
+    Entry* _head;
+    Entry* _tail;
+    size_t _budget;
+    size_t _memoryUsage;
+};
+
+}
+
+#endif
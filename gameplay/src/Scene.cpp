@@ -6,13 +6,32 @@
 #include "Joint.h"
 #include "Terrain.h"
 #include "Bundle.h"
+#include "SpatialIndex.h"
+#include "MeshGeometry.h"
+#include "PortalGraph.h"
+#include "Game.h"
 
 namespace gameplay
 {
 
+// Minimum number of nodes in one level of a scene hierarchy for the level to be split across worker threads
+#define TRANSFORM_PARALLEL_NODE_COUNT 1024
+
+// Number of nodes that a worker thread updates at a time
+#define TRANSFORM_BATCH_SIZE 256
+
+// Largest number of vertices in a static batch, so that its indices fit in 16 bits
+#define STATIC_BATCH_VERTEX_MAX 65536
+
+// Marks the vertices of a source mesh that are not used by the part being baked
+#define STATIC_BATCH_NO_VERTEX 0xFFFFFFFF
+
 // Global list of active scenes
 static std::vector<Scene*> __sceneList;
 
+// The time that asynchronous scene loads may spend on the main thread each frame, in milliseconds.
+static float __asyncLoadBudget = 4.0f;
+
 static inline char lowercase(char c)
 {
     if (c >= 'A' && c <='Z')
@@ -23,7 +42,7 @@ static inline char lowercase(char c)
 }
 
 // Returns true if 'str' ends with 'suffix'; false otherwise.
-static bool endsWith(const char* str, const char* suffix, bool ignoreCase)
+bool endsWith(const char* str, const char* suffix, bool ignoreCase)
 {
     if (str == NULL || suffix == NULL)
         return false;
@@ -59,9 +78,13 @@ static bool endsWith(const char* str, const char* suffix, bool ignoreCase)
 }
 
 
+// The nodes keep their slot in each component array of their scene.
+typedef char ComponentCountCheck[Scene::COMPONENT_COUNT == NODE_COMPONENT_COUNT ? 1 : -1];
+
 Scene::Scene()
-    : _id(""), _activeCamera(NULL), _firstNode(NULL), _lastNode(NULL), _nodeCount(0), _bindAudioListenerToCamera(true), 
-      _nextItr(NULL), _nextReset(true)
+    : _id(), _activeCamera(NULL), _firstNode(NULL), _lastNode(NULL), _nodeCount(0), _ambientColorVersion(0), _bindAudioListenerToCamera(true), 
+      _nextItr(NULL), _nextReset(true), _spatialIndex(NULL), _portalGraph(NULL), _nodeIndex(NULL), _lightVersion(1),
+      _transformOrderDirty(true)
 {
     __sceneList.push_back(this);
 }
@@ -80,8 +103,12 @@ Scene::~Scene()
         SAFE_RELEASE(_activeCamera);
     }
 
-    // Remove all nodes from the scene
+    // Remove all nodes from the scene, without keeping the node index up to date.
+    SAFE_RELEASE(_portalGraph);
+    SAFE_DELETE(_nodeIndex);
     removeAllNodes();
+    _taggedNodes.clear();
+    SAFE_DELETE(_spatialIndex);
 
     // Remove the scene from global list
     std::vector<Scene*>::iterator itr = std::find(__sceneList.begin(), __sceneList.end(), this);
@@ -112,14 +139,57 @@ Scene* Scene::load(const char* filePath)
     return SceneLoader::load(filePath);
 }
 
+Scene::AsyncLoad* Scene::loadAsync(const char* filePath)
+{
+    return SceneLoader::loadAsync(filePath);
+}
+
+void Scene::setAsyncLoadBudget(float milliseconds)
+{
+    __asyncLoadBudget = std::max(milliseconds, 0.0f);
+}
+
+float Scene::getAsyncLoadBudget()
+{
+    return __asyncLoadBudget;
+}
+
+Scene::AsyncLoad::AsyncLoad()
+    : _scene(NULL), _progress(0.0f), _finished(false)
+{
+}
+
+Scene::AsyncLoad::~AsyncLoad()
+{
+    SAFE_RELEASE(_scene);
+}
+
+bool Scene::AsyncLoad::isFinished() const
+{
+    return _finished;
+}
+
+float Scene::AsyncLoad::getProgress() const
+{
+    return _progress;
+}
+
+Scene* Scene::AsyncLoad::getScene() const
+{
+    return _scene;
+}
+
 Scene* Scene::getScene(const char* id)
 {
     if (id == NULL)
         return __sceneList.size() ? __sceneList[0] : NULL;
 
+    StringId stringId;
+    if (!StringId::find(id, &stringId))
+        return NULL;
     for (size_t i = 0, count = __sceneList.size(); i < count; ++i)
     {
-        if (__sceneList[i]->_id == id)
+        if (__sceneList[i]->_id == stringId)
             return __sceneList[i];
     }
 
@@ -134,18 +204,37 @@ const char* Scene::getId() const
 
 void Scene::setId(const char* id)
 {
-    _id = id ? id : "";
+    _id = StringId(id);
 }
 
 Node* Scene::findNode(const char* id, bool recursive, bool exactMatch) const
 {
     GP_ASSERT(id);
 
+    // No node can have an ID that was never interned.
+    StringId stringId;
+    if (!exactMatch)
+        stringId = StringId(id);
+    else if (!StringId::find(id, &stringId))
+        return NULL;
+    return findNode(stringId, recursive, exactMatch);
+}
+
+Node* Scene::findNode(const StringId& id, bool recursive, bool exactMatch) const
+{
+
+    if (recursive && _nodeIndex)
+    {
+        Node* match = findIndexedNode(id, exactMatch, NULL);
+        if (match)
+            return match;
+    }
+
     // Search immediate children first.
     for (Node* child = getFirstNode(); child != NULL; child = child->getNextSibling())
     {
         // Does this child's ID match?
-        if ((exactMatch && child->_id == id) || (!exactMatch && child->_id.find(id) == 0))
+        if ((exactMatch && child->_id == id) || (!exactMatch && child->_id.startsWith(id)))
         {
             return child;
         }
@@ -170,13 +259,24 @@ unsigned int Scene::findNodes(const char* id, std::vector<Node*>& nodes, bool re
 {
     GP_ASSERT(id);
 
+    StringId stringId;
+    if (!exactMatch)
+        stringId = StringId(id);
+    else if (!StringId::find(id, &stringId))
+        return 0;
+    return findNodes(stringId, nodes, recursive, exactMatch);
+}
+
+unsigned int Scene::findNodes(const StringId& id, std::vector<Node*>& nodes, bool recursive, bool exactMatch) const
+{
+
     unsigned int count = 0;
 
     // Search immediate children first.
     for (Node* child = getFirstNode(); child != NULL; child = child->getNextSibling())
     {
         // Does this child's ID match?
-        if ((exactMatch && child->_id == id) || (!exactMatch && child->_id.find(id) == 0))
+        if ((exactMatch && child->_id == id) || (!exactMatch && child->_id.startsWith(id)))
         {
             nodes.push_back(child);
             ++count;
@@ -269,6 +369,14 @@ void Scene::addNode(Node* node)
     }
 
     node->_scene = this;
+    _transformOrderDirty = true;
+
+    indexNodes(node);
+
+    if (_spatialIndex)
+    {
+        node->setSpatialIndex(_spatialIndex);
+    }
 
     ++_nodeCount;
 
@@ -383,6 +491,7 @@ const Vector3& Scene::getAmbientColor() const
 void Scene::setAmbientColor(float red, float green, float blue)
 {
     _ambientColor.set(red, green, blue);
+    _ambientColorVersion = 0;
 }
 
 void Scene::update(float elapsedTime)
@@ -394,6 +503,1001 @@ void Scene::update(float elapsedTime)
     }
 }
 
+void Scene::updateTransforms()
+{
+    if (_transformOrderDirty)
+        buildTransformOrder();
+
+    // Each level only depends on the world matrices of the level above it.
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    for (size_t i = 0, levelCount = _transformLevels.size() - 1; i < levelCount; ++i)
+    {
+        Node** nodes = &_transformNodes[_transformLevels[i]];
+        unsigned int count = (unsigned int)(_transformLevels[i + 1] - _transformLevels[i]);
+        if (count >= TRANSFORM_PARALLEL_NODE_COUNT && jobSystem)
+            jobSystem->parallelFor(count, TRANSFORM_BATCH_SIZE, &Scene::updateWorldMatrices, nodes);
+        else
+            updateWorldMatrices(nodes, 0, count);
+    }
+}
+
+unsigned int Scene::freezeStatic()
+{
+    unsigned int count = 0;
+    for (Node* node = _firstNode; node != NULL; node = node->_nextSibling)
+    {
+        count += freezeStaticNode(node);
+    }
+    return count;
+}
+
+unsigned int Scene::freezeStaticNode(Node* node)
+{
+    unsigned int count = 0;
+    if (!node->isFrozen() && node->isStatic())
+    {
+        node->freeze();
+        ++count;
+    }
+    for (Node* child = node->_firstChild; child != NULL; child = child->_nextSibling)
+    {
+        count += freezeStaticNode(child);
+    }
+    return count;
+}
+
+void Scene::buildTransformOrder()
+{
+    _transformNodes.clear();
+    _transformLevels.clear();
+
+    // Lay out the hierarchy breadth first so that each level is stored contiguously.
+    for (Node* node = _firstNode; node != NULL; node = node->_nextSibling)
+    {
+        _transformNodes.push_back(node);
+    }
+    size_t begin = 0;
+    while (begin < _transformNodes.size())
+    {
+        _transformLevels.push_back(begin);
+        size_t end = _transformNodes.size();
+        for (size_t i = begin; i < end; ++i)
+        {
+            for (Node* child = _transformNodes[i]->_firstChild; child != NULL; child = child->_nextSibling)
+            {
+                _transformNodes.push_back(child);
+            }
+        }
+        begin = end;
+    }
+    _transformLevels.push_back(_transformNodes.size());
+
+    // Leave out the frozen nodes, whose children are still laid out with their own level.
+    size_t write = 0;
+    for (size_t i = 0, levelCount = _transformLevels.size() - 1; i < levelCount; ++i)
+    {
+        size_t levelBegin = _transformLevels[i];
+        size_t levelEnd = _transformLevels[i + 1];
+        _transformLevels[i] = write;
+        for (size_t j = levelBegin; j < levelEnd; ++j)
+        {
+            if (!_transformNodes[j]->_frozen)
+                _transformNodes[write++] = _transformNodes[j];
+        }
+    }
+    _transformLevels.back() = write;
+    _transformNodes.resize(write);
+
+    _transformOrderDirty = false;
+}
+
+void Scene::updateWorldMatrices(void* cookie, unsigned int begin, unsigned int end)
+{
+    Node** nodes = (Node**)cookie;
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        nodes[i]->updateWorldMatrix();
+    }
+}
+
+void Scene::setSpatialIndexEnabled(bool enabled)
+{
+    if (enabled == (_spatialIndex != NULL))
+        return;
+
+    SpatialIndex* index = enabled ? new SpatialIndex() : NULL;
+    for (Node* node = _firstNode; node != NULL; node = node->_nextSibling)
+    {
+        node->setSpatialIndex(index);
+    }
+    SAFE_DELETE(_spatialIndex);
+    _spatialIndex = index;
+}
+
+void Scene::setPortalGraph(PortalGraph* graph)
+{
+    if (graph == _portalGraph)
+        return;
+    if (graph)
+        graph->addRef();
+    SAFE_RELEASE(_portalGraph);
+    _portalGraph = graph;
+}
+
+PortalGraph* Scene::getPortalGraph() const
+{
+    return _portalGraph;
+}
+
+bool Scene::isSpatialIndexEnabled() const
+{
+    return _spatialIndex != NULL;
+}
+
+void Scene::setNodeIndexEnabled(bool enabled)
+{
+    if (enabled == (_nodeIndex != NULL))
+        return;
+
+    if (enabled)
+    {
+        _nodeIndex = new std::multimap<StringId, Node*>();
+        for (Node* node = _firstNode; node != NULL; node = node->_nextSibling)
+        {
+            indexNodes(node);
+        }
+    }
+    else
+    {
+        SAFE_DELETE(_nodeIndex);
+    }
+}
+
+bool Scene::isNodeIndexEnabled() const
+{
+    return _nodeIndex != NULL;
+}
+
+void Scene::indexNodes(Node* node)
+{
+    GP_ASSERT(node);
+
+    // Nodes without an ID are never found through the index, so they are not indexed.
+    if (_nodeIndex && !node->_id.empty())
+        _nodeIndex->insert(std::make_pair(node->_id, node));
+    if (node->_tags)
+    {
+        for (std::map<std::string, std::string, std::less<std::string>, PoolAllocator<std::pair<const std::string, std::string> > >::const_iterator itr = node->_tags->begin(); itr != node->_tags->end(); ++itr)
+        {
+            addTaggedNode(node, itr->first);
+        }
+    }
+    for (unsigned int i = 0; i < COMPONENT_COUNT; ++i)
+        node->_componentSlots[i] = -1;
+    updateComponents(node);
+    for (Node* child = node->_firstChild; child != NULL; child = child->_nextSibling)
+    {
+        indexNodes(child);
+    }
+}
+
+void Scene::unindexNodes(Node* node)
+{
+    GP_ASSERT(node);
+
+    if (_nodeIndex)
+        unindexNode(node, node->_id);
+    if (node->_tags)
+    {
+        for (std::map<std::string, std::string, std::less<std::string>, PoolAllocator<std::pair<const std::string, std::string> > >::const_iterator itr = node->_tags->begin(); itr != node->_tags->end(); ++itr)
+        {
+            removeTaggedNode(node, itr->first);
+        }
+    }
+    for (unsigned int i = 0; i < COMPONENT_COUNT; ++i)
+    {
+        if (node->_componentSlots[i] >= 0)
+            removeComponentNode((Component)i, node);
+    }
+    for (Node* child = node->_firstChild; child != NULL; child = child->_nextSibling)
+    {
+        unindexNodes(child);
+    }
+}
+
+void Scene::unindexNode(Node* node, const StringId& id)
+{
+    GP_ASSERT(_nodeIndex);
+
+    if (id.empty())
+        return;
+
+    std::pair<std::multimap<StringId, Node*>::iterator, std::multimap<StringId, Node*>::iterator> range = _nodeIndex->equal_range(id);
+    for (std::multimap<StringId, Node*>::iterator itr = range.first; itr != range.second; ++itr)
+    {
+        if (itr->second == node)
+        {
+            _nodeIndex->erase(itr);
+            break;
+        }
+    }
+}
+
+void Scene::updateComponents(Node* node)
+{
+    GP_ASSERT(node);
+
+    bool components[COMPONENT_COUNT];
+    components[DRAWABLE] = node->_drawable != NULL;
+    components[CAMERA] = node->_camera != NULL;
+    components[LIGHT] = node->_light != NULL;
+    components[AUDIO_SOURCE] = node->_audioSource != NULL;
+    components[COLLISION_OBJECT] = node->_collisionObject != NULL;
+    for (unsigned int i = 0; i < COMPONENT_COUNT; ++i)
+    {
+        if (components[i] && node->_componentSlots[i] < 0)
+        {
+            node->_componentSlots[i] = (int)_componentNodes[i].size();
+            _componentNodes[i].push_back(node);
+            if (i == LIGHT)
+            {
+                // The light has not been selected for any node yet, which updateChangedLights
+                // handles by selecting the lights of every node again.
+                _lightBounds.push_back(BoundingSphere(Vector3::zero(), -1.0f));
+                node->lightChanged();
+            }
+        }
+        else if (!components[i] && node->_componentSlots[i] >= 0)
+        {
+            removeComponentNode((Component)i, node);
+        }
+    }
+}
+
+void Scene::removeComponentNode(Component component, Node* node)
+{
+    // Move the last node of the array into the slot of the node, so the array stays dense.
+    std::vector<Node*>& nodes = _componentNodes[component];
+    int slot = node->_componentSlots[component];
+    GP_ASSERT(slot >= 0 && slot < (int)nodes.size() && nodes[slot] == node);
+    Node* last = nodes.back();
+    nodes[slot] = last;
+    last->_componentSlots[component] = slot;
+    nodes.pop_back();
+    node->_componentSlots[component] = -1;
+
+    if (component == LIGHT)
+    {
+        _lightBounds[slot] = _lightBounds.back();
+        _lightBounds.pop_back();
+        if (node->_lightChangeQueued)
+        {
+            eraseNode(_changedLights, node);
+            node->_lightChangeQueued = false;
+        }
+        invalidateNodeLights();
+    }
+}
+
+void Scene::addTaggedNode(Node* node, const std::string& name)
+{
+    _taggedNodes[name].push_back(node);
+}
+
+void Scene::removeTaggedNode(Node* node, const std::string& name)
+{
+    std::map<std::string, std::vector<Node*> >::iterator itr = _taggedNodes.find(name);
+    if (itr != _taggedNodes.end())
+    {
+        eraseNode(itr->second, node);
+        if (itr->second.empty())
+            _taggedNodes.erase(itr);
+    }
+}
+
+void Scene::eraseNode(std::vector<Node*>& nodes, Node* node)
+{
+    // Nodes are mostly removed in the reverse order that they were added, so search from the end.
+    for (size_t i = nodes.size(); i > 0; --i)
+    {
+        if (nodes[i - 1] == node)
+        {
+            nodes.erase(nodes.begin() + (i - 1));
+            break;
+        }
+    }
+}
+
+unsigned int Scene::getNodesWithTag(const char* name, std::vector<Node*>& nodes) const
+{
+    GP_ASSERT(name);
+
+    std::map<std::string, std::vector<Node*> >::const_iterator itr = _taggedNodes.find(name);
+    if (itr == _taggedNodes.end())
+        return 0;
+    nodes.insert(nodes.end(), itr->second.begin(), itr->second.end());
+    return (unsigned int)itr->second.size();
+}
+
+unsigned int Scene::getNodesWithComponent(Component component, std::vector<Node*>& nodes) const
+{
+    GP_ASSERT(component < COMPONENT_COUNT);
+
+    nodes.insert(nodes.end(), _componentNodes[component].begin(), _componentNodes[component].end());
+    return (unsigned int)_componentNodes[component].size();
+}
+
+unsigned int Scene::getComponentCount(Component component) const
+{
+    GP_ASSERT(component < COMPONENT_COUNT);
+    return (unsigned int)_componentNodes[component].size();
+}
+
+Node* Scene::getComponentNode(Component component, unsigned int index) const
+{
+    GP_ASSERT(component < COMPONENT_COUNT);
+    GP_ASSERT(index < _componentNodes[component].size());
+    return _componentNodes[component][index];
+}
+
+const std::vector<Node*>& Scene::getNodeLights(Node* node, Light::Type type)
+{
+    GP_ASSERT(node && node->getScene() == this);
+    GP_ASSERT(type >= Light::DIRECTIONAL && type <= Light::SPOT);
+
+    if (!_changedLights.empty())
+        updateChangedLights();
+
+    Node::LightSelection* selection = node->_lightSelection;
+    if (selection == NULL)
+    {
+        selection = node->_lightSelection = new Node::LightSelection();
+        selection->version = 0;
+    }
+    if (selection->version != _lightVersion)
+    {
+        selectNodeLights(node, selection);
+        selection->version = _lightVersion;
+    }
+    return selection->lights[type - Light::DIRECTIONAL];
+}
+
+void Scene::invalidateNodeLights()
+{
+    // Zero marks the selections that are out of date, so it is never a current version.
+    if (++_lightVersion == 0)
+        _lightVersion = 1;
+}
+
+void Scene::updateChangedLights()
+{
+    bool invalidateAll = false;
+    for (size_t i = 0, count = _changedLights.size(); i < count; ++i)
+    {
+        Node* lightNode = _changedLights[i];
+        lightNode->_lightChangeQueued = false;
+        int slot = lightNode->_componentSlots[LIGHT];
+        GP_ASSERT(slot >= 0 && slot < (int)_lightBounds.size());
+
+        // Nodes the light could be selected for were reached by it either before or after the
+        // change, so only those nodes are affected. Lights without previous bounds and
+        // directional lights reach every node.
+        BoundingSphere& previous = _lightBounds[slot];
+        BoundingSphere current(Vector3::zero(), -1.0f);
+        bool bounded = getLightBounds(lightNode, &current);
+        if (_spatialIndex && bounded && previous.radius >= 0.0f)
+        {
+            _spatialIndex->query(previous, _lightQueryNodes);
+            _spatialIndex->query(current, _lightQueryNodes);
+        }
+        else
+        {
+            invalidateAll = true;
+        }
+        previous = current;
+    }
+    _changedLights.clear();
+
+    if (invalidateAll)
+    {
+        invalidateNodeLights();
+    }
+    else
+    {
+        for (size_t i = 0, count = _lightQueryNodes.size(); i < count; ++i)
+        {
+            if (_lightQueryNodes[i]->_lightSelection)
+                _lightQueryNodes[i]->_lightSelection->version = 0;
+        }
+    }
+    _lightQueryNodes.clear();
+}
+
+void Scene::selectNodeLights(Node* node, Node::LightSelection* selection) const
+{
+    float influences[3][MAX_NODE_LIGHTS];
+    for (unsigned int i = 0; i < 3; ++i)
+        selection->lights[i].clear();
+
+    const BoundingSphere& bounds = node->getBoundingSphere();
+    const std::vector<Node*>& lightNodes = _componentNodes[LIGHT];
+    for (size_t i = 0, count = lightNodes.size(); i < count; ++i)
+    {
+        Node* lightNode = lightNodes[i];
+        if (!lightNode->isEnabledInHierarchy())
+            continue;
+
+        Light* light = lightNode->getLight();
+        GP_ASSERT(light);
+        const Vector3& color = light->getColor();
+        float influence = 0.2126f * color.x + 0.7152f * color.y + 0.0722f * color.z;
+
+        BoundingSphere reach;
+        if (getLightBounds(lightNode, &reach))
+        {
+            // Attenuate the light as the shaders do, at the point of the node's bounds closest to the light.
+            float distance = reach.center.distance(bounds.center) - bounds.radius;
+            if (distance >= reach.radius)
+                continue;
+            if (distance > 0.0f)
+            {
+                float d = distance / reach.radius;
+                influence *= 1.0f - d * d;
+            }
+        }
+        if (influence <= 0.0f)
+            continue;
+
+        // Insert the light in order of decreasing influence, dropping the least influential
+        // light once the selection is full.
+        unsigned int index = light->getLightType() - Light::DIRECTIONAL;
+        std::vector<Node*>& selected = selection->lights[index];
+        float* selectedInfluences = influences[index];
+        unsigned int position = (unsigned int)selected.size();
+        while (position > 0 && selectedInfluences[position - 1] < influence)
+            --position;
+        if (position >= MAX_NODE_LIGHTS)
+            continue;
+        if (selected.size() < MAX_NODE_LIGHTS)
+            selected.push_back(NULL);
+        for (unsigned int j = (unsigned int)selected.size() - 1; j > position; --j)
+        {
+            selected[j] = selected[j - 1];
+            selectedInfluences[j] = selectedInfluences[j - 1];
+        }
+        selected[position] = lightNode;
+        selectedInfluences[position] = influence;
+    }
+}
+
+bool Scene::getLightBounds(const Node* node, BoundingSphere* bounds)
+{
+    GP_ASSERT(node && node->getLight());
+    GP_ASSERT(bounds);
+
+    Light* light = node->getLight();
+    if (light->getLightType() == Light::DIRECTIONAL)
+        return false;
+
+    // Spot lights are bounded by the sphere of their range, like point lights.
+    bounds->set(node->getTranslationWorld(), light->getRange());
+    return true;
+}
+
+Node* Scene::findIndexedNode(const StringId& id, bool exactMatch, const Node* ancestor) const
+{
+    GP_ASSERT(_nodeIndex);
+
+    // Beyond a few matches it is cheaper to search the hierarchy than to check each match.
+    static const unsigned int maxMatches = 8;
+
+    // Only a single match is returned, since the search decides which of several matches is first.
+    Node* match = NULL;
+    unsigned int matchCount = 0;
+    for (std::multimap<StringId, Node*>::const_iterator itr = _nodeIndex->lower_bound(id); itr != _nodeIndex->end(); ++itr)
+    {
+        if (exactMatch ? itr->first != id : !itr->first.startsWith(id))
+            break;
+        if (++matchCount > maxMatches)
+            return NULL;
+
+        Node* node = itr->second;
+        if (ancestor)
+        {
+            // Only nodes below the ancestor match.
+            Node* parent = node->_parent;
+            while (parent && parent != ancestor)
+                parent = parent->_parent;
+            if (parent == NULL)
+                continue;
+        }
+        if (match)
+            return NULL;
+        match = node;
+    }
+    return match;
+}
+
+unsigned int Scene::queryVisible(const Frustum& frustum, std::vector<Node*>& nodes)
+{
+    if (_spatialIndex)
+        return _spatialIndex->query(frustum, nodes);
+
+    size_t start = nodes.size();
+    for (Node* node = _firstNode; node != NULL; node = node->_nextSibling)
+    {
+        queryVisibleNode(node, frustum, nodes);
+    }
+    return (unsigned int)(nodes.size() - start);
+}
+
+bool Scene::raycast(const Ray& ray, RaycastHit* hit, float maxDistance)
+{
+    GP_ASSERT(hit);
+
+    float limit = maxDistance > 0.0f ? maxDistance : FLT_MAX;
+    hit->node = NULL;
+    hit->distance = limit;
+    hit->triangle = -1;
+
+    // Find the models whose bounds the ray hits.
+    _raycastNodes.clear();
+    if (_spatialIndex)
+        _spatialIndex->query(ray, limit, _raycastNodes);
+    else
+        _raycastNodes = _componentNodes[DRAWABLE];
+
+    _raycastCandidates.clear();
+    for (size_t i = 0, count = _raycastNodes.size(); i < count; ++i)
+    {
+        Node* node = _raycastNodes[i];
+        if (!dynamic_cast<Model*>(node->getDrawable()) || !node->isEnabledInHierarchy())
+            continue;
+
+        const BoundingSphere& sphere = node->getBoundingSphere();
+        float distance = ray.intersects(sphere);
+        if (distance < 0.0f)
+            continue;
+        if (sphere.center.distanceSquared(ray.getOrigin()) <= sphere.radius * sphere.radius)
+            distance = 0.0f;
+        if (distance <= limit)
+            _raycastCandidates.push_back(std::make_pair(distance, node));
+    }
+
+    // Test the triangles of the models nearest first, until the bounds of the next model are farther than the hit.
+    std::sort(_raycastCandidates.begin(), _raycastCandidates.end());
+    for (size_t i = 0, count = _raycastCandidates.size(); i < count; ++i)
+    {
+        if (_raycastCandidates[i].first > hit->distance)
+            break;
+        raycastModel(_raycastCandidates[i].second, ray, hit);
+    }
+
+    return hit->node != NULL;
+}
+
+unsigned int Scene::raycast(const Ray* rays, unsigned int count, RaycastHit* hits, float maxDistance)
+{
+    GP_ASSERT(count == 0 || (rays && hits));
+
+    unsigned int hitCount = 0;
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        if (raycast(rays[i], &hits[i], maxDistance))
+            ++hitCount;
+    }
+    return hitCount;
+}
+
+bool Scene::raycastModel(Node* node, const Ray& ray, RaycastHit* hit)
+{
+    Model* model = static_cast<Model*>(node->getDrawable());
+    Mesh* mesh = model->getMesh();
+    MeshGeometry* geometry = mesh ? mesh->loadGeometry() : NULL;
+
+    const Matrix& world = node->getWorldMatrix();
+    Matrix inverse;
+    if (geometry == NULL || !world.invert(&inverse))
+    {
+        // Without the triangles of the mesh, hit the model at its bounds.
+        const BoundingSphere& sphere = node->getBoundingSphere();
+        float distance = ray.intersects(sphere);
+        if (sphere.center.distanceSquared(ray.getOrigin()) <= sphere.radius * sphere.radius)
+            distance = 0.0f;
+        if (distance < 0.0f || distance >= hit->distance)
+            return false;
+
+        hit->node = node;
+        hit->distance = distance;
+        hit->point = ray.getOrigin() + ray.getDirection() * distance;
+        hit->normal = hit->point - sphere.center;
+        if (hit->normal.isZero())
+            hit->normal = -ray.getDirection();
+        else
+            hit->normal.normalize();
+        hit->triangle = -1;
+        return true;
+    }
+
+    // The direction is not normalized in the space of the mesh, so that the distances of the
+    // hits along it stay the distances in world space.
+    Vector3 origin, direction;
+    inverse.transformPoint(ray.getOrigin(), &origin);
+    inverse.transformVector(ray.getDirection(), &direction);
+
+    float distance;
+    unsigned int triangle;
+    Vector3 normal;
+    if (!geometry->intersects(origin, direction, hit->distance, &distance, &triangle, &normal))
+        return false;
+
+    // Normals are transformed by the inverse transpose of the world matrix.
+    Matrix inverseTranspose;
+    inverse.transpose(&inverseTranspose);
+    inverseTranspose.transformVector(&normal);
+    normal.normalize();
+    if (normal.dot(ray.getDirection()) > 0.0f)
+        normal.negate();
+
+    hit->node = node;
+    hit->distance = distance;
+    hit->point = ray.getOrigin() + ray.getDirection() * distance;
+    hit->normal = normal;
+    hit->triangle = (int)triangle;
+    return true;
+}
+
+void Scene::queryVisibleNode(Node* node, const Frustum& frustum, std::vector<Node*>& nodes)
+{
+    // Skip disabled nodes along with their children.
+    if (!node->isEnabled())
+        return;
+
+    Drawable* drawable = node->getDrawable();
+    if (drawable)
+    {
+        if (!(dynamic_cast<Model*>(drawable) || dynamic_cast<Terrain*>(drawable)) || node->getBoundingSphere().intersects(frustum))
+            nodes.push_back(node);
+    }
+
+    for (Node* child = node->getFirstChild(); child != NULL; child = child->getNextSibling())
+    {
+        queryVisibleNode(child, frustum, nodes);
+    }
+}
+
+/**
+ * A mesh part of a model that is baked into a static batch, or the whole mesh of a model
+ * without parts, with a part index of -1.
+ */
+struct StaticBatchSource
+{
+    Node* node;
+    Mesh* mesh;
+    int partIndex;
+};
+
+/**
+ * Identifies the static batch that a source is baked into.
+ */
+struct StaticBatchKey
+{
+    Material* material;
+    unsigned int format;
+    int cell[3];
+
+    bool operator<(const StaticBatchKey& key) const
+    {
+        if (material != key.material)
+            return material < key.material;
+        if (format != key.format)
+            return format < key.format;
+        for (unsigned int i = 0; i < 3; ++i)
+        {
+            if (cell[i] != key.cell[i])
+                return cell[i] < key.cell[i];
+        }
+        return false;
+    }
+};
+
+// Returns the byte offset of an element in a vertex format, or -1 if it has none.
+static int getElementOffset(const VertexFormat& format, VertexFormat::Usage usage)
+{
+    unsigned int offset = 0;
+    for (unsigned int i = 0, count = format.getElementCount(); i < count; ++i)
+    {
+        const VertexFormat::Element& e = format.getElement(i);
+        if (e.usage == usage)
+            return (int)offset;
+        offset += e.getByteSize();
+    }
+    return -1;
+}
+
+// Returns true if the vertices of a vertex format can be transformed into world space.
+static bool isStaticBatchFormat(const VertexFormat& format)
+{
+    bool hasPosition = false;
+    for (unsigned int i = 0, count = format.getElementCount(); i < count; ++i)
+    {
+        const VertexFormat::Element& e = format.getElement(i);
+        switch (e.usage)
+        {
+        case VertexFormat::POSITION:
+            hasPosition = true;
+            // Fall through.
+        case VertexFormat::NORMAL:
+        case VertexFormat::TANGENT:
+        case VertexFormat::BINORMAL:
+            if (e.type != VertexFormat::FLOAT || e.size != 3)
+                return false;
+            break;
+        default:
+            break;
+        }
+    }
+    return hasPosition;
+}
+
+// Reads the indices of a part of a mesh, or returns the vertices in order when the part index is -1.
+static bool readStaticBatchIndices(Mesh* mesh, int partIndex, std::vector<unsigned int>& indices)
+{
+    if (partIndex < 0)
+    {
+        indices.resize(mesh->getVertexCount() - mesh->getVertexCount() % 3);
+        for (unsigned int i = 0, count = (unsigned int)indices.size(); i < count; ++i)
+            indices[i] = i;
+        return true;
+    }
+
+    MeshPart* part = mesh->getPart(partIndex);
+    unsigned int indexCount = part->getIndexCount() - part->getIndexCount() % 3;
+    std::vector<unsigned int> data(part->getIndexCount());
+    indices.resize(indexCount);
+    if (indices.empty())
+        return true;
+    if (!part->getIndexData(&data[0]))
+        return false;
+    for (unsigned int i = 0; i < indexCount; ++i)
+    {
+        switch (part->getIndexFormat())
+        {
+        case Mesh::INDEX8:
+            indices[i] = ((unsigned char*)&data[0])[i];
+            break;
+        case Mesh::INDEX16:
+            indices[i] = ((unsigned short*)&data[0])[i];
+            break;
+        default:
+            indices[i] = data[i];
+            break;
+        }
+    }
+    return true;
+}
+
+void Scene::createStaticBatch(const VertexFormat& format, Material* material, const std::vector<unsigned char>& vertices,
+                             const std::vector<unsigned short>& indices, const BoundingBox& box, unsigned int batchIndex)
+{
+    Mesh* mesh = Mesh::createMesh(format, (unsigned int)(vertices.size() / format.getVertexSize()), false);
+    mesh->setVertexData((const float*)&vertices[0]);
+    MeshPart* part = mesh->addPart(Mesh::TRIANGLES, Mesh::INDEX16, (unsigned int)indices.size(), false);
+    part->setIndexData(&indices[0], 0, (unsigned int)indices.size());
+    BoundingSphere sphere;
+    sphere.set(box);
+    mesh->setBoundingBox(box);
+    mesh->setBoundingSphere(sphere);
+
+    Model* model = Model::create(mesh);
+    SAFE_RELEASE(mesh);
+
+    // Each batch has its own copy of the material, since the passes of a material bind
+    // their vertex attributes to a single mesh.
+    NodeCloneContext context;
+    Material* materialClone = material->clone(context);
+    model->setMaterial(materialClone);
+    SAFE_RELEASE(materialClone);
+
+    char id[32];
+    sprintf(id, "staticBatch%u", batchIndex);
+    Node* node = addNode(id);
+    node->setDrawable(model);
+    SAFE_RELEASE(model);
+}
+
+unsigned int Scene::bakeStaticBatches(const std::vector<Node*>& nodes, float cellSize)
+{
+#ifdef OPENGL_ES
+    GP_WARN("Static batches cannot be baked on OpenGL ES, where mesh data cannot be read back.");
+    return 0;
+#else
+    // Group the parts of the models that can be baked.
+    std::vector<const VertexFormat*> formats;
+    std::map<StaticBatchKey, std::vector<StaticBatchSource> > groups;
+    std::vector<Node*> bakedNodes;
+    for (size_t i = 0, count = nodes.size(); i < count; ++i)
+    {
+        Node* node = nodes[i];
+        Model* model = node ? dynamic_cast<Model*>(node->getDrawable()) : NULL;
+        if (!model || node->getScene() != this || model->getSkin())
+            continue;
+        Mesh* mesh = model->getMesh();
+        if (mesh->getLodCount() > 0 || mesh->getVertexCount() > STATIC_BATCH_VERTEX_MAX || !isStaticBatchFormat(mesh->getVertexFormat()))
+            continue;
+
+        // The model is removed from the node, so every part of it must be baked.
+        unsigned int partCount = mesh->getPartCount();
+        bool bakeable = partCount > 0 || (mesh->getPrimitiveType() == Mesh::TRIANGLES && model->getMaterial() != NULL);
+        for (unsigned int j = 0; j < partCount && bakeable; ++j)
+        {
+            bakeable = mesh->getPart(j)->getPrimitiveType() == Mesh::TRIANGLES && model->getMaterial(j) != NULL;
+        }
+        if (!bakeable)
+            continue;
+
+        StaticBatchKey key;
+        key.format = 0;
+        while (key.format < formats.size() && *formats[key.format] != mesh->getVertexFormat())
+            ++key.format;
+        if (key.format == formats.size())
+            formats.push_back(&mesh->getVertexFormat());
+        const Vector3& center = node->getBoundingSphere().center;
+        key.cell[0] = cellSize > 0.0f ? (int)floor(center.x / cellSize) : 0;
+        key.cell[1] = cellSize > 0.0f ? (int)floor(center.y / cellSize) : 0;
+        key.cell[2] = cellSize > 0.0f ? (int)floor(center.z / cellSize) : 0;
+
+        StaticBatchSource source;
+        source.node = node;
+        source.mesh = mesh;
+        if (partCount == 0)
+        {
+            key.material = model->getMaterial();
+            source.partIndex = -1;
+            groups[key].push_back(source);
+        }
+        for (unsigned int j = 0; j < partCount; ++j)
+        {
+            key.material = model->getMaterial(j);
+            source.partIndex = (int)j;
+            groups[key].push_back(source);
+        }
+        bakedNodes.push_back(node);
+    }
+
+    // Bake each group into as few batches as fit its vertices.
+    unsigned int batchCount = 0;
+    std::map<Mesh*, std::vector<unsigned char> > vertexData;
+    std::vector<unsigned int> sourceIndices;
+    std::vector<unsigned int> remap;
+    for (std::map<StaticBatchKey, std::vector<StaticBatchSource> >::const_iterator itr = groups.begin(); itr != groups.end(); ++itr)
+    {
+        const VertexFormat& format = *formats[itr->first.format];
+        const unsigned int vertexSize = format.getVertexSize();
+        const int positionOffset = getElementOffset(format, VertexFormat::POSITION);
+        const int normalOffset = getElementOffset(format, VertexFormat::NORMAL);
+        const int tangentOffset = getElementOffset(format, VertexFormat::TANGENT);
+        const int binormalOffset = getElementOffset(format, VertexFormat::BINORMAL);
+
+        std::vector<unsigned char> vertices;
+        std::vector<unsigned short> indices;
+        Vector3 min, max;
+        bool hasBounds = false;
+        for (size_t i = 0, count = itr->second.size(); i < count; ++i)
+        {
+            const StaticBatchSource& source = itr->second[i];
+            const unsigned int meshVertexCount = source.mesh->getVertexCount();
+            std::vector<unsigned char>& data = vertexData[source.mesh];
+            if (data.empty() && meshVertexCount > 0)
+            {
+                // The buffers of streamed meshes are read back, so their data is loaded first.
+                Game::getInstance()->getMeshStreamer()->load(source.mesh);
+                data.resize(meshVertexCount * vertexSize);
+                source.mesh->getVertexData(&data[0]);
+            }
+            readStaticBatchIndices(source.mesh, source.partIndex, sourceIndices);
+
+            // Number the vertices that the part uses in the order that it first uses them.
+            remap.assign(meshVertexCount, STATIC_BATCH_NO_VERTEX);
+            unsigned int sourceVertexCount = 0;
+            for (size_t j = 0; j < sourceIndices.size(); ++j)
+            {
+                if (sourceIndices[j] < meshVertexCount && remap[sourceIndices[j]] == STATIC_BATCH_NO_VERTEX)
+                    remap[sourceIndices[j]] = sourceVertexCount++;
+            }
+            if (sourceVertexCount == 0)
+                continue;
+
+            unsigned int base = (unsigned int)(vertices.size() / vertexSize);
+            if (base + sourceVertexCount > STATIC_BATCH_VERTEX_MAX)
+            {
+                createStaticBatch(format, itr->first.material, vertices, indices, BoundingBox(min, max), batchCount++);
+                vertices.clear();
+                indices.clear();
+                hasBounds = false;
+                base = 0;
+            }
+
+            // Transform the vertices into world space, with normals transformed by the inverse
+            // transpose of the world matrix so that they stay perpendicular to the surface.
+            const Matrix& world = source.node->getWorldMatrix();
+            Matrix normalMatrix;
+            world.invert(&normalMatrix);
+            normalMatrix.transpose();
+            vertices.resize((base + sourceVertexCount) * vertexSize);
+            for (unsigned int v = 0; v < meshVertexCount; ++v)
+            {
+                if (remap[v] == STATIC_BATCH_NO_VERTEX)
+                    continue;
+                unsigned char* vertex = &vertices[(base + remap[v]) * vertexSize];
+                memcpy(vertex, &data[v * vertexSize], vertexSize);
+
+                Vector3 value;
+                memcpy(&value.x, vertex + positionOffset, sizeof(float) * 3);
+                world.transformPoint(&value);
+                memcpy(vertex + positionOffset, &value.x, sizeof(float) * 3);
+                if (!hasBounds)
+                {
+                    min = max = value;
+                    hasBounds = true;
+                }
+                else
+                {
+                    min.set(std::min(min.x, value.x), std::min(min.y, value.y), std::min(min.z, value.z));
+                    max.set(std::max(max.x, value.x), std::max(max.y, value.y), std::max(max.z, value.z));
+                }
+
+                if (normalOffset >= 0)
+                {
+                    memcpy(&value.x, vertex + normalOffset, sizeof(float) * 3);
+                    normalMatrix.transformVector(&value);
+                    value.normalize();
+                    memcpy(vertex + normalOffset, &value.x, sizeof(float) * 3);
+                }
+                if (tangentOffset >= 0)
+                {
+                    memcpy(&value.x, vertex + tangentOffset, sizeof(float) * 3);
+                    world.transformVector(&value);
+                    value.normalize();
+                    memcpy(vertex + tangentOffset, &value.x, sizeof(float) * 3);
+                }
+                if (binormalOffset >= 0)
+                {
+                    memcpy(&value.x, vertex + binormalOffset, sizeof(float) * 3);
+                    world.transformVector(&value);
+                    value.normalize();
+                    memcpy(vertex + binormalOffset, &value.x, sizeof(float) * 3);
+                }
+            }
+
+            // Mirroring transforms reverse the winding of the triangles, which is restored.
+            const bool mirrored = world.determinant() < 0.0f;
+            for (size_t j = 0; j + 2 < sourceIndices.size(); j += 3)
+            {
+                if (sourceIndices[j] >= meshVertexCount || sourceIndices[j + 1] >= meshVertexCount || sourceIndices[j + 2] >= meshVertexCount)
+                    continue;
+                indices.push_back((unsigned short)(base + remap[sourceIndices[j]]));
+                indices.push_back((unsigned short)(base + remap[sourceIndices[mirrored ? j + 2 : j + 1]]));
+                indices.push_back((unsigned short)(base + remap[sourceIndices[mirrored ? j + 1 : j + 2]]));
+            }
+        }
+        if (!indices.empty())
+        {
+            createStaticBatch(format, itr->first.material, vertices, indices, BoundingBox(min, max), batchCount++);
+        }
+    }
+
+    // Remove the baked models, which releases the source meshes and materials that no other
+    // models use.
+    for (size_t i = 0, count = bakedNodes.size(); i < count; ++i)
+    {
+        bakedNodes[i]->setDrawable(NULL);
+    }
+
+    return batchCount;
+#endif
+}
+
 void Scene::reset()
 {
     _nextItr = NULL;
@@ -10,6 +10,9 @@
 namespace gameplay
 {
 
+class SceneLoader;
+class PortalGraph;
+
 /**
  * Defines the root container for a hierarchy of Node objects.
  *
@@ -17,8 +20,125 @@ namespace gameplay
  */
 class Scene : public Ref
 {
+    friend class RenderState;
+    friend class Node;
+    friend class ShadowMaps;
+    friend class RenderQueue;
+    friend class PlanarReflection;
+
 public:
 
+    /**
+     * Defines the components of nodes that the scene keeps track of (see getNodesWithComponent).
+     *
+     * @script{ignore}
+     */
+    enum Component
+    {
+        DRAWABLE,
+        CAMERA,
+        LIGHT,
+        AUDIO_SOURCE,
+        COLLISION_OBJECT,
+        COMPONENT_COUNT
+    };
+
+    /**
+     * Defines a handle to a scene that is being loaded asynchronously (see Scene::loadAsync).
+     *
+     * @script{ignore}
+     */
+    class AsyncLoad : public Ref
+    {
+        friend class SceneLoader;
+
+    public:
+
+        /**
+         * Determines if the load has finished, either with a loaded scene or with an error.
+         *
+         * @return true if the load has finished, false if it is still in progress.
+         */
+        bool isFinished() const;
+
+        /**
+         * Returns the approximate progress of the load.
+         *
+         * @return The progress of the load, from 0 when it starts to 1 when it has finished.
+         */
+        float getProgress() const;
+
+        /**
+         * Returns the loaded scene.
+         *
+         * The handle keeps a reference to the scene until it is released, so the scene
+         * must be given a reference of its own to outlive the handle.
+         *
+         * @return The loaded scene, or NULL if the load has not finished or has failed.
+         */
+        Scene* getScene() const;
+
+    private:
+
+        /**
+         * Constructor.
+         */
+        AsyncLoad();
+
+        /**
+         * Destructor.
+         */
+        ~AsyncLoad();
+
+        /**
+         * Hidden copy constructor.
+         */
+        AsyncLoad(const AsyncLoad& copy);
+
+        /**
+         * Hidden copy assignment operator.
+         */
+        AsyncLoad& operator=(const AsyncLoad&);
+
+        Scene* _scene;
+        float _progress;
+        bool _finished;
+    };
+
+    /**
+     * Defines the result of a ray cast against the models of the scene (see Scene::raycast).
+     *
+     * @script{ignore}
+     */
+    struct RaycastHit
+    {
+        /**
+         * The node of the model that is hit, or NULL if nothing is hit.
+         */
+        Node* node;
+
+        /**
+         * The distance along the ray to the hit.
+         */
+        float distance;
+
+        /**
+         * The point that is hit, in world space.
+         */
+        Vector3 point;
+
+        /**
+         * The normal of the triangle that is hit, in world space, which faces the ray.
+         */
+        Vector3 normal;
+
+        /**
+         * The index of the triangle that is hit in the geometry of the mesh (see MeshGeometry::intersects),
+         * or -1 if the bounds of the model are hit because its triangles could not be tested.
+         */
+        int triangle;
+    };
+
     /**
      * Creates a new empty scene.
      *
@@ -32,6 +152,11 @@ public:
     /**
      * Loads a scene from the given '.scene' or '.gpb' file.
      *
+     * The properties files that the scene references (materials, particles, audio, animations)
+     * are gathered first and then parsed in parallel on the job system, each file once, and so
+     * are the images of the textures that they use. Only the texture uploads and the creation
+     * of the scene objects are left for the calling thread.
+     *
      * @param filePath The path to the '.scene' or '.gpb' file to load from.
      * @return The loaded scene or <code>NULL</code> if the scene
      *      could not be loaded from the given file.
@@ -39,6 +164,43 @@ public:
      */
     static Scene* load(const char* filePath);
 
+    /**
+     * Starts loading a scene from the given '.scene' or '.gpb' file without blocking the game.
+     *
+     * The scene file and the properties files that it references are read and parsed on the
+     * worker threads of the job system, along with the images of the textures of its materials.
+     * The rest of the load creates GL resources and scene objects, so it runs on the main thread
+     * at the start of each frame, for no longer than the budget set with setAsyncLoadBudget.
+     * Materials are created with their shaders compiling asynchronously (see Material::createAsync).
+     *
+     * The main bundle of a scene and each individual node property are loaded as single pieces
+     * of work, so a large bundle can still take longer than the budget in the frame that loads it.
+     *
+     * @param filePath The path to the '.scene' or '.gpb' file to load from.
+     *
+     * @return A handle to the load, which must be released when it is no longer needed.
+     * @script{ignore}
+     */
+    static AsyncLoad* loadAsync(const char* filePath);
+
+    /**
+     * Sets the time that asynchronous scene loads may spend on the main thread each frame.
+     *
+     * The budget is shared by all of the loads that are in progress, and defaults to 4 milliseconds.
+     *
+     * @param milliseconds The time budget for each frame, in milliseconds.
+     * @script{ignore}
+     */
+    static void setAsyncLoadBudget(float milliseconds);
+
+    /**
+     * Returns the time that asynchronous scene loads may spend on the main thread each frame.
+     *
+     * @return The time budget for each frame, in milliseconds.
+     * @script{ignore}
+     */
+    static float getAsyncLoadBudget();
+
     /**
      * Gets a currently active scene.
      *
@@ -90,6 +252,132 @@ public:
      */
     unsigned int findNodes(const char* id, std::vector<Node*>& nodes, bool recursive = true, bool exactMatch = true) const;
 
+    /**
+     * Returns the first node in the scene that matches the given interned ID.
+     *
+     * @param id The ID of the node to find.
+     * @param recursive true if a recursive search should be performed, false otherwise.
+     * @param exactMatch true if only nodes whose ID exactly matches the specified ID are returned,
+     *      or false if nodes that start with the given ID are returned.
+     *
+     * @return The first node found that matches the given ID.
+     * @script{ignore}
+     */
+    Node* findNode(const StringId& id, bool recursive = true, bool exactMatch = true) const;
+
+    /**
+     * Returns all nodes in the scene that match the given interned ID.
+     *
+     * @param id The ID of the node to find.
+     * @param nodes Vector of nodes to be populated with matches.
+     * @param recursive true if a recursive search should be performed, false otherwise.
+     * @param exactMatch true if only nodes whose ID exactly matches the specified ID are returned,
+     *      or false if nodes that start with the given ID are returned.
+     *
+     * @return The number of matches found.
+     * @script{ignore}
+     */
+    unsigned int findNodes(const StringId& id, std::vector<Node*>& nodes, bool recursive = true, bool exactMatch = true) const;
+
+    /**
+     * Returns all nodes in the scene that have the specified tag.
+     *
+     * The scene keeps the nodes of each tag as they are added, removed and tagged, so
+     * this does not search the scene. The nodes in the joint hierarchies of mesh skins
+     * are not part of the scene, so they are not returned.
+     *
+     * @param name The name of the tag.
+     * @param nodes The vector that the nodes are appended to, in the order that they were tagged.
+     *
+     * @return The number of nodes appended to the vector.
+     * @script{ignore}
+     */
+    unsigned int getNodesWithTag(const char* name, std::vector<Node*>& nodes) const;
+
+    /**
+     * Returns all nodes in the scene that have the specified component.
+     *
+     * The scene keeps the nodes with each component as they are added, removed and have
+     * their components set, so this does not search the scene. The nodes in the joint
+     * hierarchies of mesh skins are not part of the scene, so they are not returned.
+     *
+     * @param component The component.
+     * @param nodes The vector that the nodes are appended to, in no particular order.
+     *
+     * @return The number of nodes appended to the vector.
+     * @script{ignore}
+     */
+    unsigned int getNodesWithComponent(Component component, std::vector<Node*>& nodes) const;
+
+    /**
+     * Returns the number of nodes in the scene that have the specified component.
+     *
+     * The nodes with each component are kept in a dense array, which can be iterated with
+     * getComponentNode without copying it. Adding and removing nodes or components reorders
+     * the array, so it must not change while it is iterated.
+     *
+     * @param component The component.
+     *
+     * @return The number of nodes with the component.
+     * @script{ignore}
+     */
+    unsigned int getComponentCount(Component component) const;
+
+    /**
+     * Returns a node of the dense array of nodes with the specified component.
+     *
+     * @param component The component.
+     * @param index The index of the node, which must be less than getComponentCount.
+     *
+     * @return The node.
+     * @script{ignore}
+     */
+    Node* getComponentNode(Component component, unsigned int index) const;
+
+    /**
+     * The maximum number of lights of each type that are selected for a node (see getNodeLights).
+     */
+    static const unsigned int MAX_NODE_LIGHTS = 8;
+
+    /**
+     * Returns the lights of the specified type that most influence the specified node.
+     *
+     * The lights of enabled nodes are ranked by the luminance of their color, and point and
+     * spot lights are also attenuated by the distance from the light to the bounding sphere
+     * of the node, relative to their range, so lights that do not reach the node are never
+     * selected. Up to MAX_NODE_LIGHTS lights are returned, most influential first.
+     *
+     * The selection is cached on the node until the node moves or its bounds change, or until
+     * a light moves, changes range or is added or removed. When the spatial index is enabled,
+     * a moving point or spot light only invalidates the selections of the nodes with a drawable
+     * that it reached before and after the move, so the lights of other nodes should not be
+     * selected while it is enabled. Changing the color of a light does not select the lights again.
+     *
+     * The POINT_LIGHT_*, SPOT_LIGHT_* and DIRECTIONAL_LIGHT_* material auto-bindings bind these
+     * lights to the uniform arrays of the built-in shaders.
+     *
+     * @param node The node, which must be in this scene.
+     * @param type The type of the lights.
+     *
+     * @return The nodes of the selected lights.
+     * @script{ignore}
+     */
+    const std::vector<Node*>& getNodeLights(Node* node, Light::Type type);
+
+    /**
+     * Returns all nodes in the scene that have a drawable of the specified type, such as
+     * Model or Terrain.
+     *
+     * Only the nodes with a drawable are checked (see getNodesWithComponent).
+     *
+     * @param nodes The vector that the nodes are appended to.
+     *
+     * @return The number of nodes appended to the vector.
+     * @script{ignore}
+     */
+    template <class T>
+    unsigned int getNodesWithDrawable(std::vector<Node*>& nodes) const;
+
     /**
      * Creates and adds a new node to the scene.
      *
@@ -188,6 +476,185 @@ public:
      */
     void update(float elapsedTime);
 
+    /**
+     * Updates the world matrices of all nodes in the scene whose transforms have changed.
+     *
+     * World matrices are otherwise computed on demand by Node::getWorldMatrix, which
+     * spreads the cost of transform updates over whichever code happens to query them
+     * first. Calling this method once per frame, after the nodes have been moved and
+     * before the scene is culled and drawn, updates all changed world matrices in a
+     * single pass so that later code only reads them.
+     *
+     * The nodes are updated one level of the hierarchy at a time, from a flat list that
+     * is rebuilt only when nodes are added to or removed from the scene, or are frozen or
+     * thawed. Frozen nodes (see Node::freeze) are left out of the list. Levels with many
+     * nodes are split across the threads of the game's JobSystem.
+     *
+     * @script{ignore}
+     */
+    void updateTransforms();
+
+    /**
+     * Freezes the nodes of the scene whose transformation is static (see Node::isStatic).
+     *
+     * This is called when a scene finishes loading, so that its static scenery costs nothing
+     * per frame until it moves. It can be called again after static nodes are added.
+     *
+     * @return The number of nodes that were frozen.
+     *
+     * @script{ignore}
+     */
+    unsigned int freezeStatic();
+
+    /**
+     * Enables or disables the spatial index of the scene.
+     *
+     * While the spatial index is enabled, the scene keeps a bounding volume hierarchy
+     * over the world bounds of all nodes with a drawable. The hierarchy is updated as
+     * nodes are added, removed and transformed, and is used by queryVisible() to find
+     * the visible nodes without testing every node in the scene.
+     *
+     * The spatial index is disabled by default. It is worth enabling for large scenes
+     * where only a small part of the scene is visible at a time.
+     *
+     * @param enabled true to enable the spatial index, false to disable it.
+     * @script{ignore}
+     */
+    void setSpatialIndexEnabled(bool enabled);
+
+    /**
+     * Determines if the spatial index of the scene is enabled.
+     *
+     * @return true if the spatial index is enabled, false otherwise.
+     * @script{ignore}
+     */
+    bool isSpatialIndexEnabled() const;
+
+    /**
+     * Sets the zones and portals of the scene, which cull the zones that the camera cannot see
+     * when the drawables of the scene are gathered by a RenderQueue.
+     *
+     * The portal graph is loaded from the zones namespace of the '.scene' file of the scene,
+     * when it has one (see PortalGraph).
+     *
+     * @param graph The portal graph, which the scene keeps a reference to, or NULL to remove it.
+     *
+     * @script{ignore}
+     */
+    void setPortalGraph(PortalGraph* graph);
+
+    /**
+     * Returns the zones and portals of the scene.
+     *
+     * @return The portal graph, or NULL if the scene has none.
+     *
+     * @script{ignore}
+     */
+    PortalGraph* getPortalGraph() const;
+
+    /**
+     * Enables or disables the node index of the scene.
+     *
+     * While the node index is enabled, the scene keeps the nodes of its hierarchy sorted by
+     * their IDs, and updates the index as nodes are added, removed and renamed. findNode() on
+     * the scene, and recursive findNode() on its nodes, then look the ID up in the index instead
+     * of searching the hierarchy, when the index has a single node that matches.
+     *
+     * The nodes in the joint hierarchies of mesh skins are not part of the scene, so they are
+     * not indexed, and IDs that the index has no node or several nodes for are found by searching
+     * the hierarchy, as when the index is disabled.
+     *
+     * The node index is disabled by default, and is enabled while a scene is loaded from a
+     * .scene file.
+     *
+     * @param enabled true to enable the node index, false to disable it.
+     * @script{ignore}
+     */
+    void setNodeIndexEnabled(bool enabled);
+
+    /**
+     * Determines if the node index of the scene is enabled.
+     *
+     * @return true if the node index is enabled, false otherwise.
+     * @script{ignore}
+     */
+    bool isNodeIndexEnabled() const;
+
+    /**
+     * Finds the enabled nodes with a drawable that may be visible in the specified frustum.
+     *
+     * Nodes with models and terrains are tested against the frustum using their bounding
+     * spheres. Nodes with other drawables (which have no meaningful bounds) are always
+     * returned. If the spatial index is enabled, the query only visits the parts of the
+     * scene that intersect the frustum; otherwise every node in the scene is tested.
+     *
+     * @param frustum The frustum to test against, such as the one returned by Camera::getFrustum.
+     * @param nodes The vector that the visible nodes are appended to.
+     *
+     * @return The number of nodes appended to the vector.
+     * @script{ignore}
+     */
+    unsigned int queryVisible(const Frustum& frustum, std::vector<Node*>& nodes);
+
+    /**
+     * Finds the nearest triangle of the enabled models of the scene that a ray hits.
+     *
+     * The models whose bounds the ray hits are found through the spatial index when it is
+     * enabled, and otherwise by testing the bounds of every model. Their triangles are then
+     * tested, nearest model first, through the bounding volume hierarchy of the geometry of
+     * their meshes (see Mesh::loadGeometry), which is read and built the first time that a
+     * model is tested. Models with a skin are tested in their bind pose, and models whose mesh
+     * was not loaded from a bundle are hit at their bounds.
+     *
+     * @param ray The ray, in world space.
+     * @param hit Populated with the nearest hit.
+     * @param maxDistance The largest distance along the ray to hit a model at, or 0 for no limit.
+     *
+     * @return true if the ray hits a model, false otherwise.
+     * @script{ignore}
+     */
+    bool raycast(const Ray& ray, RaycastHit* hit, float maxDistance = 0.0f);
+
+    /**
+     * Casts several rays against the models of the scene, such as the rays of the samples of a
+     * selection, the same way as raycast(const Ray&, RaycastHit*, float).
+     *
+     * @param rays The rays, in world space.
+     * @param count The number of rays.
+     * @param hits Populated with the nearest hit of each ray, whose node is NULL if the ray hits nothing.
+     * @param maxDistance The largest distance along the rays to hit a model at, or 0 for no limit.
+     *
+     * @return The number of rays that hit a model.
+     * @script{ignore}
+     */
+    unsigned int raycast(const Ray* rays, unsigned int count, RaycastHit* hits, float maxDistance = 0.0f);
+
+    /**
+     * Merges the models of static nodes into a few combined models, so that static scenery is
+     * drawn with a handful of draw calls instead of one for each node.
+     *
+     * The mesh parts of the models are grouped by their material and by the cell of a grid that
+     * the center of each node is in. Each group is baked into the world space of the scene, in
+     * models of up to 65536 vertices that are added to new nodes at the root of the scene, and
+     * the models are then removed from the nodes, which are kept. Since the combined models are
+     * bounded by their cell, they are still culled, and the cell size trades the number of draw
+     * calls against how tightly the scenery is culled.
+     *
+     * Only models are baked whose parts share Material objects with the models they are baked
+     * with, and that are lists of triangles, without a skin or levels of detail, and with float
+     * positions, normals, tangents and binormals. The vertex and index data of meshes is read
+     * back from their buffers, which is not supported on OpenGL ES, so there nothing is baked.
+     * The nodes must not be moved or animated once they are baked.
+     *
+     * @param nodes The nodes of the scene to bake.
+     * @param cellSize The size of the cells of the grid, or zero to bake each material into
+     *        as few models as possible.
+     *
+     * @return The number of nodes that were added for the combined models.
+     * @script{ignore}
+     */
+    unsigned int bakeStaticBatches(const std::vector<Node*>& nodes, float cellSize);
+
     /**
      * Visits each node in the scene and calls the specified method pointer.
      *
@@ -299,15 +766,124 @@ private:
 
     bool isNodeVisible(Node* node);
 
-    std::string _id;
+    void queryVisibleNode(Node* node, const Frustum& frustum, std::vector<Node*>& nodes);
+
+    /**
+     * Freezes the static nodes of the hierarchy of a node.
+     */
+    unsigned int freezeStaticNode(Node* node);
+
+    /**
+     * Tests a ray against the triangles of the model of a node, updating the hit if it is nearer.
+     */
+    bool raycastModel(Node* node, const Ray& ray, RaycastHit* hit);
+
+    void buildTransformOrder();
+
+    static void updateWorldMatrices(void* cookie, unsigned int begin, unsigned int end);
+
+    /**
+     * Creates the model of a static batch on a new node at the root of the scene.
+     */
+    void createStaticBatch(const VertexFormat& format, Material* material, const std::vector<unsigned char>& vertices,
+                           const std::vector<unsigned short>& indices, const BoundingBox& box, unsigned int batchIndex);
+
+    /**
+     * Adds the specified node, and the nodes below it, to the node index and to the
+     * lists of tagged nodes and of nodes with components.
+     */
+    void indexNodes(Node* node);
+
+    /**
+     * Removes the specified node, and the nodes below it, from the node index and from
+     * the lists of tagged nodes and of nodes with components.
+     */
+    void unindexNodes(Node* node);
+
+    /**
+     * Adds or removes the specified node from the lists of nodes with components, so that
+     * they match the components of the node.
+     */
+    void updateComponents(Node* node);
+
+    /**
+     * Makes the lights selected for every node out of date (see getNodeLights).
+     */
+    void invalidateNodeLights();
+
+    /**
+     * Invalidates the lights selected for the nodes reached by the lights that moved or changed
+     * since the last selection.
+     */
+    void updateChangedLights();
+
+    /**
+     * Selects the lights that most influence the specified node.
+     */
+    void selectNodeLights(Node* node, Node::LightSelection* selection) const;
+
+    /**
+     * Gets the world-space sphere that the light of the specified node reaches.
+     *
+     * @return false if the light is a directional light, which reaches everything.
+     */
+    static bool getLightBounds(const Node* node, BoundingSphere* bounds);
+
+    /**
+     * Adds the specified node to the list of nodes with the specified tag.
+     */
+    void addTaggedNode(Node* node, const std::string& name);
+
+    /**
+     * Removes the specified node from the list of nodes with the specified tag.
+     */
+    void removeTaggedNode(Node* node, const std::string& name);
+
+    /**
+     * Removes the specified node from the array of nodes with the specified component.
+     */
+    void removeComponentNode(Component component, Node* node);
+
+    /**
+     * Removes the specified node from a list of nodes.
+     */
+    static void eraseNode(std::vector<Node*>& nodes, Node* node);
+
+    /**
+     * Removes the specified node from the node index, where it is indexed with the specified ID.
+     */
+    void unindexNode(Node* node, const StringId& id);
+
+    /**
+     * Returns the node of the node index that matches the specified ID below the specified
+     * ancestor (or anywhere in the scene if it is NULL), or NULL if the index has no single match.
+     */
+    Node* findIndexedNode(const StringId& id, bool exactMatch, const Node* ancestor) const;
+
+    StringId _id;
     Camera* _activeCamera;
     Node* _firstNode;
     Node* _lastNode;
     unsigned int _nodeCount;
     Vector3 _ambientColor;
+    mutable unsigned int _ambientColorVersion;
     bool _bindAudioListenerToCamera;
     Node* _nextItr;
     bool _nextReset;
+    SpatialIndex* _spatialIndex;
+    PortalGraph* _portalGraph;
+    std::multimap<StringId, Node*>* _nodeIndex;
+    std::map<std::string, std::vector<Node*> > _taggedNodes;
+    std::vector<Node*> _componentNodes[COMPONENT_COUNT];
+    unsigned int _lightVersion;
+    std::vector<BoundingSphere> _lightBounds;
+    std::vector<Node*> _changedLights;
+    std::vector<Node*> _lightQueryNodes;
+    std::vector<Node*> _raycastNodes;
+    std::vector<std::pair<float, Node*> > _raycastCandidates;
+    std::vector<Node*> _transformNodes;
+    std::vector<size_t> _transformLevels;
+    bool _transformOrderDirty;
 };
 
 template <class T>
@@ -328,6 +904,22 @@ void Scene::visit(T* instance, bool (T::*visitMethod)(Node*,C), C cookie)
     }
 }
 
+template <class T>
+unsigned int Scene::getNodesWithDrawable(std::vector<Node*>& nodes) const
+{
+    unsigned int count = 0;
+    const std::vector<Node*>& drawableNodes = _componentNodes[DRAWABLE];
+    for (size_t i = 0, drawableCount = drawableNodes.size(); i < drawableCount; ++i)
+    {
+        if (dynamic_cast<T*>(drawableNodes[i]->getDrawable()))
+        {
+            nodes.push_back(drawableNodes[i]);
+            ++count;
+        }
+    }
+    return count;
+}
+
 inline void Scene::visit(const char* visitMethod)
 {
     for (Node* node = getFirstNode(); node != NULL; node = node->getNextSibling())
@@ -9,6 +9,7 @@
 #include "Text.h"
 #include "TileSet.h"
 #include "Light.h"
+#include "PortalGraph.h"
 
 namespace gameplay
 {
@@ -17,67 +18,323 @@ namespace gameplay
 extern void calculateNamespacePath(const std::string& urlString, std::string& fileString, std::vector<std::string>& namespacePath);
 extern Properties* getPropertiesFromNamespacePath(Properties* properties, const std::vector<std::string>& namespacePath);
 
-SceneLoader::SceneLoader() : _scene(NULL)
+// Utility function (shared with Scene).
+extern bool endsWith(const char* str, const char* suffix, bool ignoreCase);
+
+// The referenced files of a scene that are parsed in parallel.
+struct PropertiesBatch
+{
+    const std::vector<std::string>* paths;
+    std::vector<Properties*>* properties;
+};
+
+static void parseBatch(void* cookie, unsigned int begin, unsigned int end)
 {
+    PropertiesBatch* batch = (PropertiesBatch*)cookie;
+    GP_ASSERT(batch);
+
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        (*batch->properties)[i] = Properties::create((*batch->paths)[i].c_str());
+    }
+}
+
+// Asynchronous loads that have not finished yet, in the order they were started.
+static std::vector<SceneLoader*> __asyncLoaders;
+
+SceneLoader::SceneLoader(bool async)
+    : _scene(NULL), _sceneFile(NULL), _sceneProperties(NULL), _step(STEP_TEXTURES), _stepIndex(0),
+      _async(async), _parsed(false), _job(NULL), _asyncLoad(NULL)
+{
+}
+
+SceneLoader::~SceneLoader()
+{
+    // Clean up all loaded properties objects.
+    std::map<std::string, Properties*>::iterator iter = _propertiesFromFile.begin();
+    for (; iter != _propertiesFromFile.end(); ++iter)
+    {
+        SAFE_DELETE(iter->second);
+    }
+
+    // Clean up the .scene file's properties object.
+    SAFE_DELETE(_sceneFile);
+
+    // Release the images and textures that were loaded ahead of the materials.
+    for (size_t i = 0, count = _images.size(); i < count; ++i)
+    {
+        SAFE_RELEASE(_images[i].second);
+    }
+    for (size_t i = 0, count = _textures.size(); i < count; ++i)
+    {
+        SAFE_RELEASE(_textures[i]);
+    }
 }
 
 Scene* SceneLoader::load(const char* url)
 {
     SceneLoader loader;
-    return loader.loadInternal(url);
+    if (!loader.parse(url))
+        return NULL;
+    while (loader.runStep())
+    {
+    }
+    return loader._scene;
+}
+
+Scene::AsyncLoad* SceneLoader::loadAsync(const char* url)
+{
+    SceneLoader* loader = new SceneLoader(true);
+    loader->_url = url ? url : "";
+    loader->_asyncLoad = new Scene::AsyncLoad();
+
+    // The handle is shared by the caller and the loader until the load finishes.
+    loader->_asyncLoad->addRef();
+    __asyncLoaders.push_back(loader);
+
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    GP_ASSERT(jobSystem);
+    loader->_job = jobSystem->create(&SceneLoader::parseProc, loader);
+    jobSystem->run(loader->_job);
+
+    return loader->_asyncLoad;
+}
+
+void SceneLoader::parseProc(void* cookie)
+{
+    SceneLoader* loader = (SceneLoader*)cookie;
+    GP_ASSERT(loader);
+    loader->_parsed = loader->parse(loader->_url.c_str());
 }
 
-Scene* SceneLoader::loadInternal(const char* url)
+void SceneLoader::updateAsync()
+{
+    if (__asyncLoaders.empty())
+        return;
+
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    GP_ASSERT(jobSystem);
+
+    double start = Game::getAbsoluteTime();
+    double budget = Scene::getAsyncLoadBudget();
+    for (size_t i = 0; i < __asyncLoaders.size();)
+    {
+        SceneLoader* loader = __asyncLoaders[i];
+        GP_ASSERT(loader && loader->_asyncLoad);
+
+        // Wait for the files to be parsed, without blocking the frame.
+        if (loader->_job)
+        {
+            if (!jobSystem->isFinished(loader->_job))
+            {
+                ++i;
+                continue;
+            }
+            jobSystem->release(loader->_job);
+            loader->_job = NULL;
+            if (!loader->_parsed)
+            {
+                GP_WARN("Failed to load scene '%s' asynchronously.", loader->_url.c_str());
+                loader->_step = STEP_DONE;
+            }
+        }
+
+        // Run units of work until the load is done or the budget of the frame has been used up.
+        // At least one unit runs each frame so that loads always make progress.
+        bool running = loader->_step != STEP_DONE;
+        do
+        {
+            running = running && loader->runStep();
+        }
+        while (running && Game::getAbsoluteTime() - start < budget);
+
+        Scene::AsyncLoad* asyncLoad = loader->_asyncLoad;
+        if (running)
+        {
+            asyncLoad->_progress = loader->getProgress();
+            break;
+        }
+
+        // Hand the scene over to the handle.
+        asyncLoad->_scene = loader->_scene;
+        asyncLoad->_progress = 1.0f;
+        asyncLoad->_finished = true;
+        SAFE_RELEASE(asyncLoad);
+        SAFE_DELETE(loader);
+        __asyncLoaders.erase(__asyncLoaders.begin() + i);
+
+        if (Game::getAbsoluteTime() - start >= budget)
+            break;
+    }
+}
+
+void SceneLoader::finalizeAsync()
+{
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    GP_ASSERT(jobSystem);
+
+    for (size_t i = 0, count = __asyncLoaders.size(); i < count; ++i)
+    {
+        SceneLoader* loader = __asyncLoaders[i];
+        GP_ASSERT(loader && loader->_asyncLoad);
+
+        // The parse job still refers to the loader, so it has to finish first.
+        if (loader->_job)
+            jobSystem->wait(loader->_job);
+
+        // Loads that have not finished are cancelled.
+        SAFE_RELEASE(loader->_scene);
+        loader->_asyncLoad->_finished = true;
+        SAFE_RELEASE(loader->_asyncLoad);
+        SAFE_DELETE(loader);
+    }
+    __asyncLoaders.clear();
+}
+
+bool SceneLoader::parse(const char* url)
 {
     // Get the file part of the url that we are loading the scene from.
     std::string urlStr = url ? url : "";
     std::string id;
     splitURL(urlStr, &_path, &id);
 
+    // A bundle is loaded as the main scene data, without any scene properties.
+    if (endsWith(_path.c_str(), ".gpb", true))
+    {
+        _gpbPath = _path;
+        return true;
+    }
+
     // Load the scene properties from file.
-    Properties* properties = Properties::create(url);
-    if (properties == NULL)
+    _sceneFile = Properties::create(url);
+    if (_sceneFile == NULL)
     {
         GP_ERROR("Failed to load scene file '%s'.", url);
-        return NULL;
+        return false;
     }
 
     // Check if the properties object is valid and has a valid namespace.
-    Properties* sceneProperties = (strlen(properties->getNamespace()) > 0) ? properties : properties->getNextNamespace();
-    if (!sceneProperties || !(strcmp(sceneProperties->getNamespace(), "scene") == 0))
+    _sceneProperties = (strlen(_sceneFile->getNamespace()) > 0) ? _sceneFile : _sceneFile->getNextNamespace();
+    if (!_sceneProperties || !(strcmp(_sceneProperties->getNamespace(), "scene") == 0))
     {
         GP_ERROR("Failed to load scene from properties object: must be non-null object and have namespace equal to 'scene'.");
-        SAFE_DELETE(properties);
-        return NULL;
+        _sceneProperties = NULL;
+        return false;
     }
 
     // Get the path to the main GPB.
     std::string path;
-    if (sceneProperties->getPath("path", &path))
+    if (_sceneProperties->getPath("path", &path))
     {
         _gpbPath = path;
     }
 
     // Build the node URL/property and animation reference tables and load the referenced files/store the inline properties objects.
-    buildReferenceTables(sceneProperties);
+    buildReferenceTables(_sceneProperties);
     loadReferencedFiles();
 
-    // Load the main scene data from GPB and apply the global scene properties.
-    if (!_gpbPath.empty())
+    // Decode the images of the textures here as well, so that only the texture uploads
+    // are left for the main thread. Headless platforms have no textures.
+    if (!Platform::isHeadless())
     {
-        // Load scene from bundle
-        _scene = loadMainSceneData(sceneProperties);
-        if (!_scene)
+        std::vector<std::string> paths;
+        collectImages(_sceneFile, &paths);
+        std::map<std::string, Properties*>::iterator iter = _propertiesFromFile.begin();
+        for (; iter != _propertiesFromFile.end(); ++iter)
+        {
+            collectImages(iter->second, &paths);
+        }
+
+        // The images are decoded in parallel, on the other worker threads as well as this one.
+        std::vector<Image*> images;
+        Image::createBatch(paths, &images);
+        for (size_t i = 0, count = paths.size(); i < count; ++i)
         {
-            GP_WARN("Failed to load main scene from bundle.");
-            SAFE_DELETE(properties);
-            return NULL;
+            if (images[i])
+                _images.push_back(std::make_pair(paths[i], images[i]));
         }
     }
-    else
+
+    return true;
+}
+
+void SceneLoader::collectImages(Properties* properties, std::vector<std::string>* paths)
+{
+    GP_ASSERT(properties);
+    GP_ASSERT(paths);
+
+    Properties* ns;
+    while ((ns = properties->getNextNamespace()) != NULL)
+    {
+        // The samplers of materials, and the sprites of particle emitters, sprites and tile sets,
+        // all find their textures in the texture cache by path.
+        if (strcmp(ns->getNamespace(), "sampler") == 0 || strcmp(ns->getNamespace(), "sprite") == 0 ||
+            strcmp(ns->getNamespace(), "tileset") == 0)
+        {
+            // Only PNG files are decoded into images; compressed textures are read directly by the GPU.
+            std::string path;
+            if (ns->getPath("path", &path) && endsWith(path.c_str(), ".png", true) &&
+                std::find(paths->begin(), paths->end(), path) == paths->end())
+            {
+                paths->push_back(path);
+            }
+        }
+        collectImages(ns, paths);
+    }
+    properties->rewind();
+}
+
+bool SceneLoader::runStep()
+{
+    switch (_step)
+    {
+    case STEP_TEXTURES:
+        if (_stepIndex < _images.size())
+        {
+            // Create the texture now, so that the materials find it in the texture cache.
+            std::pair<std::string, Image*>& image = _images[_stepIndex++];
+            Texture* texture = Texture::createCached(image.first.c_str(), image.second);
+            if (texture)
+                _textures.push_back(texture);
+            SAFE_RELEASE(image.second);
+            return true;
+        }
+        break;
+
+    case STEP_MAIN_SCENE:
     {
-        // Create a new empty scene
-        _scene = Scene::create(sceneProperties->getId());
+        // Start compiling the shader permutations of the scene, which then overlap with the rest of the load.
+        std::string shaderManifest;
+        if (_sceneProperties && !Platform::isHeadless() && _sceneProperties->getPath("shaderManifest", &shaderManifest))
+            Effect::precompile(shaderManifest.c_str(), true);
+
+        // Load the main scene data from GPB and apply the global scene properties.
+        if (!_gpbPath.empty())
+        {
+            // Load scene from bundle
+            _scene = loadMainSceneData();
+            if (!_scene)
+            {
+                GP_WARN("Failed to load main scene from bundle.");
+                _step = STEP_DONE;
+                return false;
+            }
+        }
+        else
+        {
+            // Create a new empty scene
+            _scene = Scene::create(_sceneProperties->getId());
+        }
+        if (_sceneProperties == NULL)
+        {
+            // A bundle has no scene properties to apply.
+            _step = STEP_DONE;
+            return false;
+        }
+
+        // The scene properties look the nodes up by their IDs many times, so index them while loading.
+        _scene->setNodeIndexEnabled(true);
+        break;
     }
 
     // First apply the node url properties. Following that,
@@ -85,74 +342,150 @@ Scene* SceneLoader::loadInternal(const char* url)
     // We apply physics properties after all other node properties
     // so that the transform (SRT) properties get applied before
     // processing physics collision objects.
-    applyNodeUrls();
-    applyNodeProperties(sceneProperties, 
-        SceneNodeProperty::AUDIO | 
-        SceneNodeProperty::MATERIAL | 
-        SceneNodeProperty::PARTICLE |
-        SceneNodeProperty::TERRAIN |
-        SceneNodeProperty::LIGHT |
-        SceneNodeProperty::CAMERA |
-        SceneNodeProperty::ROTATE |
-        SceneNodeProperty::SCALE |
-        SceneNodeProperty::TRANSLATE |
-        SceneNodeProperty::SCRIPT |
-        SceneNodeProperty::SPRITE |
-        SceneNodeProperty::TILESET |
-        SceneNodeProperty::TEXT);
-    applyNodeProperties(sceneProperties, SceneNodeProperty::COLLISION_OBJECT);
-
-    // Apply node tags
-    for (size_t i = 0, sncount = _sceneNodes.size(); i < sncount; ++i)
-    {
-        applyTags(_sceneNodes[i]);
-    }
+    case STEP_NODE_URLS:
+        if (_stepIndex < _sceneNodes.size())
+        {
+            applyNodeUrls(_sceneNodes[_stepIndex++], NULL);
+            return true;
+        }
+        break;
+
+    case STEP_NODE_PROPERTIES:
+        if (_stepIndex < _sceneNodes.size())
+        {
+            applyNodeProperties(_sceneNodes[_stepIndex++], _sceneProperties,
+                SceneNodeProperty::AUDIO | 
+                SceneNodeProperty::MATERIAL | 
+                SceneNodeProperty::PARTICLE |
+                SceneNodeProperty::TERRAIN |
+                SceneNodeProperty::LIGHT |
+                SceneNodeProperty::CAMERA |
+                SceneNodeProperty::ROTATE |
+                SceneNodeProperty::SCALE |
+                SceneNodeProperty::TRANSLATE |
+                SceneNodeProperty::SCRIPT |
+                SceneNodeProperty::SPRITE |
+                SceneNodeProperty::TILESET |
+                SceneNodeProperty::TEXT);
+            return true;
+        }
+        break;
+
+    case STEP_COLLISION_OBJECTS:
+        if (_stepIndex < _sceneNodes.size())
+        {
+            applyNodeProperties(_sceneNodes[_stepIndex++], _sceneProperties, SceneNodeProperty::COLLISION_OBJECT);
+            return true;
+        }
+        break;
 
-    // Set active camera
-    const char* activeCamera = sceneProperties->getString("activeCamera");
-    if (activeCamera)
+    case STEP_FINISH:
     {
-        Node* camera = _scene->findNode(activeCamera);
-        if (camera && camera->getCamera())
-            _scene->setActiveCamera(camera->getCamera());
-    }
+        // Apply node tags
+        for (size_t i = 0, sncount = _sceneNodes.size(); i < sncount; ++i)
+        {
+            applyTags(_sceneNodes[i]);
+        }
 
-    // Set ambient and light properties
-    Vector3 vec3;
-    if (sceneProperties->getVector3("ambientColor", &vec3))
-        _scene->setAmbientColor(vec3.x, vec3.y, vec3.z);
+        // Set active camera
+        const char* activeCamera = _sceneProperties->getString("activeCamera");
+        if (activeCamera)
+        {
+            Node* camera = _scene->findNode(activeCamera);
+            if (camera && camera->getCamera())
+                _scene->setActiveCamera(camera->getCamera());
+        }
 
-    // Create animations for scene
-    createAnimations();
+        // Set ambient and light properties
+        Vector3 vec3;
+        if (_sceneProperties->getVector3("ambientColor", &vec3))
+            _scene->setAmbientColor(vec3.x, vec3.y, vec3.z);
 
-    // Find the physics properties object.
-    Properties* physics = NULL;
-    sceneProperties->rewind();
-    while (true)
-    {
-        Properties* ns = sceneProperties->getNextNamespace();
-        if (ns == NULL || strcmp(ns->getNamespace(), "physics") == 0)
+        // Create animations for scene
+        createAnimations();
+
+        // Find the physics properties object.
+        Properties* physics = NULL;
+        _sceneProperties->rewind();
+        while (true)
         {
-            physics = ns;
-            break;
+            Properties* ns = _sceneProperties->getNextNamespace();
+            if (ns == NULL || strcmp(ns->getNamespace(), "physics") == 0)
+            {
+                physics = ns;
+                break;
+            }
         }
-    }
 
-    // Load physics properties and constraints.
-    if (physics)
-        loadPhysics(physics);
+        // Load physics properties and constraints.
+        if (physics)
+            loadPhysics(physics);
 
-    // Clean up all loaded properties objects.
-    std::map<std::string, Properties*>::iterator iter = _propertiesFromFile.begin();
-    for (; iter != _propertiesFromFile.end(); ++iter)
-    {
-        SAFE_DELETE(iter->second);
+        // Load the zones and portals, and assign the nodes to their zones.
+        Properties* zones;
+        _sceneProperties->rewind();
+        while ((zones = _sceneProperties->getNextNamespace()) != NULL && strcmp(zones->getNamespace(), "zones") != 0)
+        {
+        }
+        if (zones)
+        {
+            PortalGraph* graph = PortalGraph::create(zones);
+            graph->assignTagged(_scene);
+            if (zones->getBool("assignByBounds"))
+                graph->assignByBounds(_scene);
+            _scene->setPortalGraph(graph);
+            SAFE_RELEASE(graph);
+        }
+
+        // Freeze the static scenery now that its transforms and collision objects are set up.
+        _scene->freezeStatic();
+
+        _scene->setNodeIndexEnabled(false);
+        break;
     }
 
-    // Clean up the .scene file's properties object.
-    SAFE_DELETE(properties);
+    case STEP_DONE:
+        return false;
+    }
+
+    // Move on to the next stage.
+    _step = (Step)(_step + 1);
+    _stepIndex = 0;
+    return _step != STEP_DONE;
+}
 
-    return _scene;
+float SceneLoader::getProgress() const
+{
+    if (_step == STEP_DONE)
+        return 1.0f;
+
+    // Parsing the files counts for the first tenth of the load, and each unit of work
+    // on the main thread for an equal share of the rest.
+    size_t imageCount = _images.size();
+    size_t nodeCount = _sceneNodes.size();
+    size_t done = _stepIndex;
+    switch (_step)
+    {
+    case STEP_MAIN_SCENE:
+        done += imageCount;
+        break;
+    case STEP_NODE_URLS:
+        done += imageCount + 1;
+        break;
+    case STEP_NODE_PROPERTIES:
+        done += imageCount + 1 + nodeCount;
+        break;
+    case STEP_COLLISION_OBJECTS:
+        done += imageCount + 1 + nodeCount * 2;
+        break;
+    case STEP_FINISH:
+        done += imageCount + 1 + nodeCount * 3;
+        break;
+    default:
+        break;
+    }
+    size_t total = imageCount + 1 + nodeCount * 3 + 1;
+    return 0.1f + 0.9f * (float)done / (float)total;
 }
 
 void SceneLoader::applyTags(SceneNode& sceneNode)
@@ -247,6 +580,19 @@ void SceneLoader::applyNodeProperties(SceneNode& sceneNode, const Properties* sc
 
 void SceneLoader::applyNodeProperty(SceneNode& sceneNode, Node* node, const Properties* sceneProperties, const SceneNodeProperty& snp)
 {
+    // Headless platforms have no graphics context, so the materials and the drawables that
+    // need one are not loaded. Models keep their meshes for the collision objects.
+    if (Platform::isHeadless() &&
+        (snp._type == SceneNodeProperty::MATERIAL ||
+         snp._type == SceneNodeProperty::PARTICLE ||
+         snp._type == SceneNodeProperty::TERRAIN ||
+         snp._type == SceneNodeProperty::SPRITE ||
+         snp._type == SceneNodeProperty::TILESET ||
+         snp._type == SceneNodeProperty::TEXT))
+    {
+        return;
+    }
+
     if (snp._type == SceneNodeProperty::AUDIO ||
         snp._type == SceneNodeProperty::MATERIAL ||
         snp._type == SceneNodeProperty::PARTICLE ||
@@ -284,7 +630,7 @@ void SceneLoader::applyNodeProperty(SceneNode& sceneNode, Node* node, const Prop
             Model* model = dynamic_cast<Model*>(node->getDrawable());
             if (model)
             {
-                Material* material = Material::create(p);
+                Material* material = Material::create(p, NULL, NULL, _async);
                 model->setMaterial(material, snp._index);
                 SAFE_RELEASE(material);
             }
@@ -673,6 +1019,10 @@ void SceneLoader::buildReferenceTables(Properties* sceneProperties)
             // Note: we don't load physics until the whole scene file has been 
             // loaded so that all node references (i.e. for constraints) can be resolved.
         }
+        else if (strcmp(ns->getNamespace(), "zones") == 0)
+        {
+            // Note: the zones are loaded once the nodes have their tags.
+        }
         else
         {
             // TODO: Should we ignore these items? They could be used for generic properties file inheritance.
@@ -989,10 +1339,8 @@ PhysicsConstraint* SceneLoader::loadHingeConstraint(const Properties* constraint
     return physicsConstraint;
 }
 
-Scene* SceneLoader::loadMainSceneData(const Properties* sceneProperties)
+Scene* SceneLoader::loadMainSceneData()
 {
-    GP_ASSERT(sceneProperties);
-
     // Load the main scene from the specified path.
     Bundle* bundle = Bundle::create(_gpbPath.c_str());
     if (!bundle)
@@ -1124,7 +1472,8 @@ void SceneLoader::loadPhysics(Properties* physics)
 
 void SceneLoader::loadReferencedFiles()
 {
-    // Load all referenced properties files.
+    // Gather the referenced properties files that are not loaded yet, once each.
+    std::vector<std::string> paths;
     std::map<std::string, Properties*>::iterator iter = _properties.begin();
     for (; iter != _properties.end(); ++iter)
     {
@@ -1133,28 +1482,50 @@ void SceneLoader::loadReferencedFiles()
             std::string fileString;
             std::vector<std::string> namespacePath;
             calculateNamespacePath(iter->first, fileString, namespacePath);
+            if (_propertiesFromFile.count(fileString) == 0 && std::find(paths.begin(), paths.end(), fileString) == paths.end())
+                paths.push_back(fileString);
+        }
+    }
 
-            // Check if the referenced properties file has already been loaded.
-            Properties* properties = NULL;
-            std::map<std::string, Properties*>::iterator pffIter = _propertiesFromFile.find(fileString);
-            if (pffIter != _propertiesFromFile.end() && pffIter->second)
-            {
-                properties = pffIter->second;
-            }
-            else
-            {
-                properties = Properties::create(fileString.c_str());
-                if (properties == NULL)
-                {
-                    GP_WARN("Failed to load referenced properties file '%s'.", fileString.c_str());
-                    continue;
-                }
+    // The files are read and parsed in parallel, on the other worker threads as well as this one.
+    std::vector<Properties*> files(paths.size(), (Properties*)NULL);
+    if (!paths.empty())
+    {
+        PropertiesBatch batch;
+        batch.paths = &paths;
+        batch.properties = &files;
+        JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+        if (jobSystem)
+            jobSystem->parallelFor((unsigned int)paths.size(), 1, &parseBatch, &batch);
+        else
+            parseBatch(&batch, 0, (unsigned int)paths.size());
+    }
+    for (size_t i = 0, count = paths.size(); i < count; ++i)
+    {
+        if (files[i] == NULL)
+        {
+            GP_WARN("Failed to load referenced properties file '%s'.", paths[i].c_str());
+            continue;
+        }
 
-                // Add the properties object to the cache.
-                _propertiesFromFile.insert(std::make_pair(fileString, properties));
-            }
+        // Add the properties object to the cache.
+        _propertiesFromFile.insert(std::make_pair(paths[i], files[i]));
+    }
+
+    // Resolve the referenced namespaces within the files.
+    for (iter = _properties.begin(); iter != _properties.end(); ++iter)
+    {
+        if (iter->second == NULL)
+        {
+            std::string fileString;
+            std::vector<std::string> namespacePath;
+            calculateNamespacePath(iter->first, fileString, namespacePath);
+
+            std::map<std::string, Properties*>::iterator pffIter = _propertiesFromFile.find(fileString);
+            if (pffIter == _propertiesFromFile.end() || pffIter->second == NULL)
+                continue;
 
-            Properties* p = getPropertiesFromNamespacePath(properties, namespacePath);
+            Properties* p = getPropertiesFromNamespacePath(pffIter->second, namespacePath);
             if (!p)
             {
                 GP_WARN("Failed to load referenced properties from url '%s'.", iter->first.c_str());
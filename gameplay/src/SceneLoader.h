@@ -2,10 +2,13 @@
 #define SCENELOADER_H_
 
 #include "Base.h"
+#include "Image.h"
 #include "Mesh.h"
 #include "PhysicsRigidBody.h"
 #include "Properties.h"
 #include "Scene.h"
+#include "Texture.h"
+#include "JobSystem.h"
 
 namespace gameplay
 {
@@ -18,6 +21,7 @@ namespace gameplay
 class SceneLoader
 {
     friend class Scene;
+    friend class Game;
 
 private:
 
@@ -29,6 +33,29 @@ private:
      * @param url The URL pointing to the Properties object defining the scene.
      */
     static Scene* load(const char* url);
+
+    /**
+     * Starts loading a scene from the specified URL in the background (see Scene::loadAsync).
+     *
+     * @param url The URL pointing to the Properties object defining the scene, or a '.gpb' file.
+     *
+     * @return A handle to the load.
+     */
+    static Scene::AsyncLoad* loadAsync(const char* url);
+
+    /**
+     * Runs the main thread work of the asynchronous loads until the frame budget is used up.
+     *
+     * Called by the Game at the start of each frame.
+     */
+    static void updateAsync();
+
+    /**
+     * Waits for the files of the asynchronous loads to be parsed and cancels the loads.
+     *
+     * Called by the Game when it shuts down.
+     */
+    static void finalizeAsync();
     
     /**
      * Helper structures and functions for SceneLoader::load(const char*).
@@ -85,9 +112,33 @@ private:
         std::map<std::string, std::string> _tags;
     };
 
-    SceneLoader();
+    /**
+     * The stages of a load, which run in order on the main thread after the files have been parsed.
+     */
+    enum Step
+    {
+        STEP_TEXTURES,
+        STEP_MAIN_SCENE,
+        STEP_NODE_URLS,
+        STEP_NODE_PROPERTIES,
+        STEP_COLLISION_OBJECTS,
+        STEP_FINISH,
+        STEP_DONE
+    };
+
+    SceneLoader(bool async = false);
+
+    ~SceneLoader();
+
+    bool parse(const char* url);
+
+    bool runStep();
+
+    float getProgress() const;
+
+    void collectImages(Properties* properties, std::vector<std::string>* paths);
 
-    Scene* loadInternal(const char* url);
+    static void parseProc(void* cookie);
 
     void applyTags(SceneNode& sceneNode);
 
@@ -117,7 +168,7 @@ private:
 
     PhysicsConstraint* loadHingeConstraint(const Properties* constraint, PhysicsRigidBody* rbA, PhysicsRigidBody* rbB);
 
-    Scene* loadMainSceneData(const Properties* sceneProperties);
+    Scene* loadMainSceneData();
 
     void loadPhysics(Properties* physics);
 
@@ -133,7 +184,18 @@ private:
     std::vector<SceneNode> _sceneNodes;                     // Holds all the nodes+properties declared in the .scene file.
     std::string _gpbPath;                                   // The path of the main GPB for the scene being loaded.
     std::string _path;                                      // The path of the scene file being loaded.
+    std::string _url;                                       // The URL of the scene being loaded.
     Scene* _scene;                                          // The scene being loaded
+    Properties* _sceneFile;                                 // The properties object of the .scene file.
+    Properties* _sceneProperties;                           // The 'scene' namespace of the .scene file.
+    std::vector<std::pair<std::string, Image*> > _images;   // Holds the images decoded ahead of time for textures.
+    std::vector<Texture*> _textures;                        // Holds the textures created from the images until the materials are loaded.
+    Step _step;                                             // The stage of the load that runs next.
+    size_t _stepIndex;                                      // The unit of work within the current stage that runs next.
+    bool _async;                                            // Whether the scene is loaded in the background.
+    bool _parsed;                                           // Whether the files were parsed successfully (set by the parse job).
+    JobSystem::Job* _job;                                   // The job that parses the files of an asynchronous load.
+    Scene::AsyncLoad* _asyncLoad;                           // The handle of an asynchronous load.
 };
 
 /**
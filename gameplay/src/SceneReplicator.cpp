@@ -0,0 +1,547 @@
+#include "Base.h"
+#include "SceneReplicator.h"
+#include "AnimationValue.h"
+
+// The number of bits of each of the three smallest components of a quantized rotation
+#define ROTATION_BITS 10
+
+// The range of the three smallest components of a unit quaternion
+#define ROTATION_RANGE 0.70710678f
+
+namespace gameplay
+{
+
+static void writeVarint(std::vector<unsigned char>* packet, unsigned int value)
+{
+    while (value >= 0x80)
+    {
+        packet->push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    packet->push_back((unsigned char)value);
+}
+
+static bool readVarint(const unsigned char*& data, const unsigned char* end, unsigned int* value)
+{
+    unsigned int result = 0;
+    for (unsigned int shift = 0; shift < 35; shift += 7)
+    {
+        if (data == end)
+            return false;
+        unsigned char byte = *data++;
+        result |= (unsigned int)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Signed values are zigzag encoded, so that small negative values are as short as small positive ones.
+static void writeInt(std::vector<unsigned char>* packet, int value)
+{
+    writeVarint(packet, ((unsigned int)value << 1) ^ (unsigned int)(value >> 31));
+}
+
+static bool readInt(const unsigned char*& data, const unsigned char* end, int* value)
+{
+    unsigned int encoded;
+    if (!readVarint(data, end, &encoded))
+        return false;
+    *value = (int)(encoded >> 1) ^ -(int)(encoded & 1);
+    return true;
+}
+
+static int quantize(float value, float precision)
+{
+    return (int)floorf(value / precision + 0.5f);
+}
+
+// Rotations are quantized to the index of their largest component and the three others, which
+// are enough to rebuild it since the quaternion has a length of 1.
+static unsigned int quantizeRotation(const Quaternion& rotation)
+{
+    float q[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+    float length = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    if (length < MATH_EPSILON)
+    {
+        q[0] = q[1] = q[2] = 0.0f;
+        q[3] = length = 1.0f;
+    }
+
+    unsigned int largest = 0;
+    for (unsigned int i = 1; i < 4; ++i)
+    {
+        if (fabs(q[i]) > fabs(q[largest]))
+            largest = i;
+    }
+
+    // q and -q are the same rotation, so the largest component is made positive and is not sent.
+    float scale = (q[largest] < 0.0f ? -1.0f : 1.0f) / length;
+    const unsigned int max = (1 << ROTATION_BITS) - 1;
+    unsigned int bits = largest;
+    unsigned int shift = 2;
+    for (unsigned int i = 0; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+        float value = (q[i] * scale + ROTATION_RANGE) / (2.0f * ROTATION_RANGE);
+        unsigned int component = (unsigned int)std::max(0.0f, floorf(value * max + 0.5f));
+        bits |= std::min(component, max) << shift;
+        shift += ROTATION_BITS;
+    }
+    return bits;
+}
+
+static Quaternion dequantizeRotation(unsigned int bits)
+{
+    const unsigned int max = (1 << ROTATION_BITS) - 1;
+    unsigned int largest = bits & 3;
+    unsigned int shift = 2;
+    float q[4];
+    float sum = 0.0f;
+    for (unsigned int i = 0; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+        q[i] = ((bits >> shift) & max) / (float)max * (2.0f * ROTATION_RANGE) - ROTATION_RANGE;
+        sum += q[i] * q[i];
+        shift += ROTATION_BITS;
+    }
+    q[largest] = sqrt(std::max(0.0f, 1.0f - sum));
+    return Quaternion(q[0], q[1], q[2], q[3]);
+}
+
+static void writeRotation(std::vector<unsigned char>* packet, unsigned int bits)
+{
+    for (unsigned int i = 0; i < 4; ++i)
+        packet->push_back((unsigned char)(bits >> (i * 8)));
+}
+
+static bool readRotation(const unsigned char*& data, const unsigned char* end, unsigned int* bits)
+{
+    if (end - data < 4)
+        return false;
+    *bits = data[0] | (data[1] << 8) | (data[2] << 16) | ((unsigned int)data[3] << 24);
+    data += 4;
+    return true;
+}
+
+SceneReplicator::SceneReplicator(float precision)
+    : _precision(precision), _interpolationTime(100.0f), _sequence(0), _receivedSequence(0)
+{
+}
+
+SceneReplicator::~SceneReplicator()
+{
+    for (size_t i = 0, count = _entries.size(); i < count; ++i)
+    {
+        Entry* entry = _entries[i];
+        if (entry->node)
+        {
+            entry->node->removeListener(this);
+            SAFE_RELEASE(entry->node);
+        }
+        SAFE_DELETE(entry);
+    }
+}
+
+SceneReplicator* SceneReplicator::create(float precision)
+{
+    GP_ASSERT(precision > 0.0f);
+    return new SceneReplicator(precision);
+}
+
+unsigned int SceneReplicator::addNode(Node* node, unsigned int parts)
+{
+    GP_ASSERT(node);
+    GP_ASSERT(parts != 0 && (parts & ~TRANSFORM) == 0);
+
+    Entry* entry = new Entry();
+    entry->node = node;
+    entry->target = NULL;
+    entry->propertyId = 0;
+    entry->parts = parts;
+    entry->precision = _precision;
+    entry->interpolating = false;
+    entry->time = 0.0f;
+    entry->toTranslation = entry->fromTranslation = node->getTranslation();
+    entry->toRotation = entry->fromRotation = node->getRotation();
+    entry->toScale = entry->fromScale = node->getScale();
+
+    // The entry is sent whole with the next snapshot.
+    captureNode(entry);
+    entry->changed[0] = entry->changed[1] = entry->changed[2] = _sequence + 1;
+
+    node->addRef();
+    node->addListener(this, (long)_entries.size());
+    _entries.push_back(entry);
+    return (unsigned int)_entries.size() - 1;
+}
+
+unsigned int SceneReplicator::addProperty(AnimationTarget* target, int propertyId, float precision)
+{
+    GP_ASSERT(target);
+    GP_ASSERT(precision > 0.0f);
+
+    unsigned int componentCount = target->getAnimationPropertyComponentCount(propertyId);
+    GP_ASSERT(componentCount > 0);
+
+    Entry* entry = new Entry();
+    entry->node = NULL;
+    entry->target = target;
+    entry->propertyId = propertyId;
+    entry->parts = 0;
+    entry->precision = precision;
+    entry->dirty = false;
+    entry->interpolating = false;
+    entry->time = 0.0f;
+    entry->values.resize(componentCount, 0);
+
+    captureProperty(entry);
+    entry->changed[0] = entry->changed[1] = entry->changed[2] = _sequence + 1;
+    entry->fromValues.resize(componentCount);
+    for (unsigned int i = 0; i < componentCount; ++i)
+        entry->fromValues[i] = entry->values[i] * precision;
+    entry->toValues = entry->fromValues;
+
+    _entries.push_back(entry);
+    return (unsigned int)_entries.size() - 1;
+}
+
+unsigned int SceneReplicator::getEntryCount() const
+{
+    return (unsigned int)_entries.size();
+}
+
+void SceneReplicator::transformChanged(Transform* transform, long cookie)
+{
+    GP_ASSERT(cookie >= 0 && (size_t)cookie < _entries.size());
+    _entries[cookie]->dirty = true;
+}
+
+void SceneReplicator::captureNode(Entry* entry)
+{
+    Node* node = entry->node;
+    GP_ASSERT(node);
+    entry->dirty = false;
+
+    if (entry->parts & TRANSLATION)
+    {
+        const Vector3& translation = node->getTranslation();
+        int values[3] = { quantize(translation.x, _precision), quantize(translation.y, _precision), quantize(translation.z, _precision) };
+        if (memcmp(values, entry->translation, sizeof(values)) != 0)
+        {
+            memcpy(entry->translation, values, sizeof(values));
+            entry->changed[0] = _sequence;
+        }
+    }
+    if (entry->parts & ROTATION)
+    {
+        unsigned int rotation = quantizeRotation(node->getRotation());
+        if (rotation != entry->rotation)
+        {
+            entry->rotation = rotation;
+            entry->changed[1] = _sequence;
+        }
+    }
+    if (entry->parts & SCALE)
+    {
+        const Vector3& scale = node->getScale();
+        int values[3] = { quantize(scale.x, _precision), quantize(scale.y, _precision), quantize(scale.z, _precision) };
+        if (memcmp(values, entry->scale, sizeof(values)) != 0)
+        {
+            memcpy(entry->scale, values, sizeof(values));
+            entry->changed[2] = _sequence;
+        }
+    }
+}
+
+void SceneReplicator::captureProperty(Entry* entry)
+{
+    GP_ASSERT(entry->target);
+
+    unsigned int componentCount = (unsigned int)entry->values.size();
+    AnimationValue value(componentCount);
+    entry->target->getAnimationPropertyValue(entry->propertyId, &value);
+    for (unsigned int i = 0; i < componentCount; ++i)
+    {
+        int quantized = quantize(value.getFloat(i), entry->precision);
+        if (quantized != entry->values[i])
+        {
+            entry->values[i] = quantized;
+            entry->changed[0] = _sequence;
+        }
+    }
+}
+
+unsigned int SceneReplicator::capture()
+{
+    ++_sequence;
+
+    // Transforms are only read again when they have changed. Properties have no notifications,
+    // so they are compared each time.
+    for (size_t i = 0, count = _entries.size(); i < count; ++i)
+    {
+        Entry* entry = _entries[i];
+        if (entry->node)
+        {
+            if (entry->dirty)
+                captureNode(entry);
+        }
+        else
+        {
+            captureProperty(entry);
+        }
+    }
+    return _sequence;
+}
+
+unsigned int SceneReplicator::getSequence() const
+{
+    return _sequence;
+}
+
+unsigned int SceneReplicator::writeDelta(unsigned int baseline, std::vector<unsigned char>* packet) const
+{
+    GP_ASSERT(packet);
+
+    if (baseline > _sequence)
+    {
+        GP_WARN("Baseline %u of the replicated scene state has not been captured yet; writing the whole state.", baseline);
+        baseline = 0;
+    }
+
+    packet->clear();
+    writeVarint(packet, _sequence);
+    writeVarint(packet, baseline);
+
+    // Each entry starts with the distance from the previous one, and 0 ends the packet.
+    unsigned int entryCount = 0;
+    unsigned int next = 0;
+    for (size_t i = 0, count = _entries.size(); i < count; ++i)
+    {
+        const Entry* entry = _entries[i];
+        if (entry->node)
+        {
+            unsigned int parts = 0;
+            if ((entry->parts & TRANSLATION) && entry->changed[0] > baseline && entry->changed[0] <= _sequence)
+                parts |= TRANSLATION;
+            if ((entry->parts & ROTATION) && entry->changed[1] > baseline && entry->changed[1] <= _sequence)
+                parts |= ROTATION;
+            if ((entry->parts & SCALE) && entry->changed[2] > baseline && entry->changed[2] <= _sequence)
+                parts |= SCALE;
+            if (parts == 0)
+                continue;
+
+            writeVarint(packet, (unsigned int)i - next + 1);
+            packet->push_back((unsigned char)parts);
+            if (parts & TRANSLATION)
+            {
+                for (unsigned int j = 0; j < 3; ++j)
+                    writeInt(packet, entry->translation[j]);
+            }
+            if (parts & ROTATION)
+                writeRotation(packet, entry->rotation);
+            if (parts & SCALE)
+            {
+                for (unsigned int j = 0; j < 3; ++j)
+                    writeInt(packet, entry->scale[j]);
+            }
+        }
+        else
+        {
+            if (entry->changed[0] <= baseline || entry->changed[0] > _sequence)
+                continue;
+
+            writeVarint(packet, (unsigned int)i - next + 1);
+            for (size_t j = 0, componentCount = entry->values.size(); j < componentCount; ++j)
+                writeInt(packet, entry->values[j]);
+        }
+        next = (unsigned int)i + 1;
+        ++entryCount;
+    }
+    writeVarint(packet, 0);
+
+    return entryCount;
+}
+
+void SceneReplicator::startInterpolation(Entry* entry)
+{
+    // The entry continues from where its last interpolation has got to.
+    float t = entry->interpolating && _interpolationTime > 0.0f ? std::min(1.0f, entry->time / _interpolationTime) : 1.0f;
+    if (entry->node)
+    {
+        entry->fromTranslation = entry->fromTranslation + (entry->toTranslation - entry->fromTranslation) * t;
+        Quaternion::slerp(entry->fromRotation, entry->toRotation, t, &entry->fromRotation);
+        entry->fromScale = entry->fromScale + (entry->toScale - entry->fromScale) * t;
+    }
+    else
+    {
+        for (size_t i = 0, count = entry->fromValues.size(); i < count; ++i)
+            entry->fromValues[i] += (entry->toValues[i] - entry->fromValues[i]) * t;
+    }
+    entry->time = 0.0f;
+    entry->interpolating = true;
+}
+
+void SceneReplicator::applyEntry(Entry* entry, float t)
+{
+    if (entry->node)
+    {
+        Node* node = entry->node;
+        if (entry->parts & TRANSLATION)
+            node->setTranslation(entry->fromTranslation + (entry->toTranslation - entry->fromTranslation) * t);
+        if (entry->parts & ROTATION)
+        {
+            Quaternion rotation;
+            Quaternion::slerp(entry->fromRotation, entry->toRotation, t, &rotation);
+            node->setRotation(rotation);
+        }
+        if (entry->parts & SCALE)
+            node->setScale(entry->fromScale + (entry->toScale - entry->fromScale) * t);
+    }
+    else
+    {
+        unsigned int componentCount = (unsigned int)entry->fromValues.size();
+        AnimationValue value(componentCount);
+        for (unsigned int i = 0; i < componentCount; ++i)
+            value.setFloat(i, entry->fromValues[i] + (entry->toValues[i] - entry->fromValues[i]) * t);
+        entry->target->setAnimationPropertyValue(entry->propertyId, &value);
+    }
+}
+
+unsigned int SceneReplicator::readDelta(const unsigned char* data, size_t size)
+{
+    GP_ASSERT(data || size == 0);
+
+    const unsigned char* end = data + size;
+    unsigned int sequence;
+    unsigned int baseline;
+    if (!readVarint(data, end, &sequence) || !readVarint(data, end, &baseline) || sequence == 0)
+    {
+        GP_WARN("Failed to read replicated scene state; the packet is malformed.");
+        return 0;
+    }
+
+    // Packets that arrive out of order are older than the state that is already known.
+    if (sequence <= _receivedSequence)
+        return 0;
+    if (baseline > _receivedSequence)
+    {
+        GP_WARN("Failed to read replicated scene state; baseline %u has not been received.", baseline);
+        return 0;
+    }
+
+    // The whole state is set right away, since there is nothing to interpolate from.
+    bool snap = baseline == 0 || _interpolationTime <= 0.0f;
+
+    unsigned int next = 0;
+    while (true)
+    {
+        unsigned int distance;
+        if (!readVarint(data, end, &distance))
+            break;
+        if (distance == 0)
+        {
+            _receivedSequence = sequence;
+            return sequence;
+        }
+
+        unsigned int index = next + distance - 1;
+        if (index >= _entries.size())
+            break;
+        next = index + 1;
+
+        Entry* entry = _entries[index];
+        startInterpolation(entry);
+        bool valid = true;
+        if (entry->node)
+        {
+            if (data == end)
+                break;
+            unsigned int parts = *data++;
+            if ((parts & ~entry->parts) != 0)
+                break;
+
+            int values[3];
+            unsigned int rotation;
+            if (parts & TRANSLATION)
+            {
+                valid = readInt(data, end, &values[0]) && readInt(data, end, &values[1]) && readInt(data, end, &values[2]);
+                if (valid)
+                    entry->toTranslation.set(values[0] * _precision, values[1] * _precision, values[2] * _precision);
+            }
+            if (valid && (parts & ROTATION))
+            {
+                valid = readRotation(data, end, &rotation);
+                if (valid)
+                    entry->toRotation = dequantizeRotation(rotation);
+            }
+            if (valid && (parts & SCALE))
+            {
+                valid = readInt(data, end, &values[0]) && readInt(data, end, &values[1]) && readInt(data, end, &values[2]);
+                if (valid)
+                    entry->toScale.set(values[0] * _precision, values[1] * _precision, values[2] * _precision);
+            }
+        }
+        else
+        {
+            for (size_t i = 0, count = entry->toValues.size(); valid && i < count; ++i)
+            {
+                int value;
+                valid = readInt(data, end, &value);
+                if (valid)
+                    entry->toValues[i] = value * entry->precision;
+            }
+        }
+        if (!valid)
+            break;
+
+        if (snap)
+        {
+            entry->interpolating = false;
+            entry->fromTranslation = entry->toTranslation;
+            entry->fromRotation = entry->toRotation;
+            entry->fromScale = entry->toScale;
+            entry->fromValues = entry->toValues;
+            applyEntry(entry, 1.0f);
+        }
+    }
+
+    // The entries that were read before the error keep their new values, and the packet is not
+    // acknowledged, so the server sends them again.
+    GP_WARN("Failed to read replicated scene state; the packet is malformed.");
+    return 0;
+}
+
+void SceneReplicator::update(float elapsedTime)
+{
+    for (size_t i = 0, count = _entries.size(); i < count; ++i)
+    {
+        Entry* entry = _entries[i];
+        if (!entry->interpolating)
+            continue;
+
+        entry->time += elapsedTime;
+        float t = _interpolationTime > 0.0f ? std::min(1.0f, entry->time / _interpolationTime) : 1.0f;
+        applyEntry(entry, t);
+        if (t >= 1.0f)
+            entry->interpolating = false;
+    }
+}
+
+void SceneReplicator::setInterpolationTime(float time)
+{
+    GP_ASSERT(time >= 0.0f);
+    _interpolationTime = time;
+}
+
+float SceneReplicator::getInterpolationTime() const
+{
+    return _interpolationTime;
+}
+
+}
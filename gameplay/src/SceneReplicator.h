@@ -0,0 +1,240 @@
+#ifndef SCENEREPLICATOR_H_
+#define SCENEREPLICATOR_H_
+
+#include "Ref.h"
+#include "Node.h"
+#include "AnimationTarget.h"
+
+namespace gameplay
+{
+
+/**
+ * Defines a replicator of the state of a scene, which sends the transforms of nodes and the
+ * values of animation target properties from a server to its clients in compact delta packets.
+ *
+ * The server and each client create a replicator and add the same nodes and properties to it, in
+ * the same order, for example by finding the nodes of the level by their ids. The entries are
+ * then identified by their index in the packets, so the ids themselves are never sent.
+ *
+ * The server captures a snapshot of the state each network tick with capture(). Only the nodes
+ * whose transforms have changed since the last capture are read again, and each part of an entry
+ * keeps the sequence number of the snapshot that last changed it. A packet for a client is written
+ * with writeDelta() against the last snapshot that the client has acknowledged (its baseline), and
+ * only holds the parts that have changed since then, so the size of the packets and the time that
+ * is spent on them follow what actually changes rather than the size of the scene. The values
+ * are quantized: translations and scales to the precision of the replicator, rotations to 32 bits
+ * and properties to the precision that they were added with.
+ *
+ * A client passes each packet that it receives to readDelta(), acknowledges the sequence number
+ * that it returns to the server, and calls update() each frame to interpolate the entries towards
+ * their new values:
+ *
+ * @code
+ * // Server, for each client at each tick:
+ * unsigned int sequence = replicator->capture();
+ * replicator->writeDelta(client->acknowledged, &packet);
+ *
+ * // Client:
+ * unsigned int sequence = replicator->readDelta(&packet[0], packet.size());
+ * if (sequence)
+ *     sendAcknowledgement(sequence);
+ * replicator->update(elapsedTime);
+ * @endcode
+ *
+ * The baseline 0 stands for a client that has not received anything yet, which receives the
+ * whole state.
+ *
+ * @script{ignore}
+ */
+class SceneReplicator : public Ref, private Transform::Listener
+{
+public:
+
+    /**
+     * The parts of the transform of a node that are replicated.
+     */
+    enum TransformParts
+    {
+        TRANSLATION = 1,
+        ROTATION = 2,
+        SCALE = 4,
+        TRANSFORM = TRANSLATION | ROTATION | SCALE
+    };
+
+    /**
+     * Creates a new, empty replicator.
+     *
+     * @param precision The precision that translations and scales are quantized to. It must be
+     *      the same on the server and its clients.
+     *
+     * @return The new replicator.
+     */
+    static SceneReplicator* create(float precision = 0.001f);
+
+    /**
+     * Adds a node whose transform is replicated.
+     *
+     * @param node The node.
+     * @param parts The parts of the transform that are replicated (see TransformParts).
+     *
+     * @return The index of the entry.
+     */
+    unsigned int addNode(Node* node, unsigned int parts = TRANSFORM);
+
+    /**
+     * Adds a property of an animation target that is replicated, such as the color of a light
+     * or a material parameter.
+     *
+     * @param target The animation target.
+     * @param propertyId The property of the target.
+     * @param precision The precision that the values of the property are quantized to.
+     *
+     * @return The index of the entry.
+     */
+    unsigned int addProperty(AnimationTarget* target, int propertyId, float precision = 0.001f);
+
+    /**
+     * Returns the number of entries of the replicator.
+     *
+     * @return The number of nodes and properties that are replicated.
+     */
+    unsigned int getEntryCount() const;
+
+    /**
+     * Captures a snapshot of the entries on the server.
+     *
+     * @return The sequence number of the snapshot.
+     */
+    unsigned int capture();
+
+    /**
+     * Returns the sequence number of the last snapshot that was captured.
+     *
+     * @return The sequence number, or 0 if no snapshot was captured.
+     */
+    unsigned int getSequence() const;
+
+    /**
+     * Writes a packet with the parts of the entries that have changed since a baseline.
+     *
+     * @param baseline The sequence number of the last snapshot that the client has acknowledged,
+     *      or 0 to write the whole state.
+     * @param packet The packet, which is replaced.
+     *
+     * @return The number of entries in the packet.
+     */
+    unsigned int writeDelta(unsigned int baseline, std::vector<unsigned char>* packet) const;
+
+    /**
+     * Reads a packet on a client. The entries that it holds are interpolated towards their new
+     * values by update(), or set to them right away for a packet with the whole state.
+     *
+     * Packets that are older than the last packet that was read are ignored, since they arrived
+     * out of order.
+     *
+     * @param data The packet.
+     * @param size The size of the packet, in bytes.
+     *
+     * @return The sequence number of the packet, which is acknowledged to the server, or 0 if the
+     *      packet was ignored or malformed.
+     */
+    unsigned int readDelta(const unsigned char* data, size_t size);
+
+    /**
+     * Interpolates the entries on a client towards the values of the last packets.
+     *
+     * @param elapsedTime The time since the last update, in milliseconds.
+     */
+    void update(float elapsedTime);
+
+    /**
+     * Sets the time that the entries take to reach the values of a packet on clients, which is
+     * normally the interval between the packets of the server.
+     *
+     * @param time The interpolation time, in milliseconds. 0 sets the values right away.
+     */
+    void setInterpolationTime(float time);
+
+    /**
+     * Returns the time that the entries take to reach the values of a packet on clients.
+     *
+     * @return The interpolation time, in milliseconds.
+     */
+    float getInterpolationTime() const;
+
+private:
+
+    /**
+     * A node or property that is replicated.
+     *
+     * The quantized values and the sequences that changed them are used on the server, and
+     * the values that are interpolated between on clients.
+     */
+    struct Entry
+    {
+        Node* node;
+        AnimationTarget* target;
+        int propertyId;
+        unsigned int parts;
+        float precision;
+        bool dirty;
+        bool interpolating;
+        int translation[3];
+        unsigned int rotation;
+        int scale[3];
+        std::vector<int> values;
+        unsigned int changed[3];
+        float time;
+        Vector3 fromTranslation;
+        Vector3 toTranslation;
+        Quaternion fromRotation;
+        Quaternion toRotation;
+        Vector3 fromScale;
+        Vector3 toScale;
+        std::vector<float> fromValues;
+        std::vector<float> toValues;
+    };
+
+    /**
+     * Constructor.
+     */
+    SceneReplicator(float precision);
+
+    /**
+     * Destructor.
+     */
+    ~SceneReplicator();
+
+    /**
+     * Hidden copy constructor.
+     */
+    SceneReplicator(const SceneReplicator& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    SceneReplicator& operator=(const SceneReplicator&);
+
+    /**
+     * @see Transform::Listener::transformChanged
+     */
+    void transformChanged(Transform* transform, long cookie);
+
+    void captureNode(Entry* entry);
+
+    void captureProperty(Entry* entry);
+
+    void startInterpolation(Entry* entry);
+
+    void applyEntry(Entry* entry, float t);
+
+    float _precision;
+    float _interpolationTime;
+    unsigned int _sequence;
+    unsigned int _receivedSequence;
+    std::vector<Entry*> _entries;
+};
+
+}
+
+#endif
@@ -0,0 +1,440 @@
+#include "Base.h"
+#include "SceneSnapshot.h"
+#include "Game.h"
+#include "FileSystem.h"
+#include "Animation.h"
+#include "AnimationClip.h"
+#include "PhysicsRigidBody.h"
+#include "AIAgent.h"
+#include "AIStateMachine.h"
+#include "AIState.h"
+
+// The identifier and version at the start of a snapshot file
+#define SNAPSHOT_MAGIC      "GPSS"
+#define SNAPSHOT_VERSION    1
+
+// The longest string that is read from a snapshot, so that a corrupt file fails instead of allocating
+#define SNAPSHOT_MAX_STRING 65536
+
+namespace gameplay
+{
+
+struct SnapshotSave
+{
+    SceneSnapshot* snapshot;
+    std::string path;
+};
+
+static bool writeValue(Stream* stream, const void* value, size_t size)
+{
+    return stream->write(value, size, 1) == 1;
+}
+
+static bool writeString(Stream* stream, const std::string& value)
+{
+    unsigned int length = (unsigned int)value.size();
+    return writeValue(stream, &length, sizeof(length)) && (length == 0 || stream->write(value.c_str(), 1, length) == length);
+}
+
+static bool readValue(Stream* stream, void* value, size_t size)
+{
+    return stream->read(value, size, 1) == 1;
+}
+
+static bool readString(Stream* stream, std::string* value)
+{
+    unsigned int length;
+    if (!readValue(stream, &length, sizeof(length)) || length > SNAPSHOT_MAX_STRING)
+        return false;
+    value->resize(length);
+    return length == 0 || stream->read(&(*value)[0], 1, length) == length;
+}
+
+SceneSnapshot::SceneSnapshot() : _saving(0)
+{
+}
+
+SceneSnapshot::~SceneSnapshot()
+{
+}
+
+SceneSnapshot* SceneSnapshot::capture(Scene* scene)
+{
+    GP_ASSERT(scene);
+
+    SceneSnapshot* snapshot = new SceneSnapshot();
+    for (Node* node = scene->getFirstNode(); node; node = node->getNextSibling())
+    {
+        snapshot->captureNode(node, node->getId());
+    }
+    return snapshot;
+}
+
+void SceneSnapshot::captureNode(Node* node, const std::string& path)
+{
+    _nodes.push_back(NodeState());
+    NodeState& state = _nodes.back();
+    state.path = path;
+    state.translation = node->getTranslation();
+    state.rotation = node->getRotation();
+    state.scale = node->getScale();
+    state.enabled = node->isEnabled();
+
+    if (node->_tags)
+    {
+        for (std::map<std::string, std::string, std::less<std::string>, PoolAllocator<std::pair<const std::string, std::string> > >::const_iterator itr = node->_tags->begin(); itr != node->_tags->end(); ++itr)
+            state.tags.push_back(std::make_pair(itr->first, itr->second));
+    }
+
+    // The clips of each animation that targets the node, which several channels can share.
+    if (node->_animationChannels)
+    {
+        std::vector<Animation*> animations;
+        for (size_t i = 0, count = node->_animationChannels->size(); i < count; ++i)
+        {
+            Animation* animation = (*node->_animationChannels)[i]->_animation;
+            if (std::find(animations.begin(), animations.end(), animation) != animations.end())
+                continue;
+            animations.push_back(animation);
+
+            for (unsigned int j = 0, clipCount = animation->getClipCount(); j < clipCount; ++j)
+            {
+                AnimationClip* clip = animation->getClip(j);
+                if (!clip->isPlaying())
+                    continue;
+
+                ClipState clipState;
+                clipState.animation = animation->getId();
+                clipState.clip = clip->getId();
+                clipState.speed = clip->getSpeed();
+                clipState.repeatCount = clip->getRepeatCount();
+                clipState.elapsedTime = clip->getElapsedTime();
+                clipState.paused = clip->isClipStateBitSet(AnimationClip::CLIP_IS_PAUSED_BIT);
+                state.clips.push_back(clipState);
+            }
+        }
+    }
+
+    PhysicsCollisionObject* collisionObject = node->getCollisionObject();
+    state.rigidBody = collisionObject && collisionObject->getType() == PhysicsCollisionObject::RIGID_BODY;
+    if (state.rigidBody)
+    {
+        PhysicsRigidBody* rigidBody = static_cast<PhysicsRigidBody*>(collisionObject);
+        state.linearVelocity = rigidBody->getLinearVelocity();
+        state.angularVelocity = rigidBody->getAngularVelocity();
+    }
+
+    AIAgent* agent = node->getAgent();
+    AIState* aiState = agent ? agent->getStateMachine()->getActiveState() : NULL;
+    if (aiState)
+        state.aiState = aiState->getId();
+
+    // The children are stored after their parent, which their paths start with.
+    for (Node* child = node->getFirstChild(); child; child = child->getNextSibling())
+    {
+        captureNode(child, path + "/" + child->getId());
+    }
+}
+
+SceneSnapshot* SceneSnapshot::create(Stream* stream)
+{
+    GP_ASSERT(stream);
+
+    char magic[4];
+    unsigned int version;
+    unsigned int nodeCount;
+    if (!readValue(stream, magic, sizeof(magic)) || memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0 ||
+        !readValue(stream, &version, sizeof(version)) || version != SNAPSHOT_VERSION ||
+        !readValue(stream, &nodeCount, sizeof(nodeCount)))
+    {
+        GP_WARN("Failed to read scene snapshot; the stream does not hold a snapshot of version %d.", SNAPSHOT_VERSION);
+        return NULL;
+    }
+
+    SceneSnapshot* snapshot = new SceneSnapshot();
+    snapshot->_nodes.reserve(std::min(nodeCount, (unsigned int)SNAPSHOT_MAX_STRING));
+    bool valid = true;
+    for (unsigned int i = 0; valid && i < nodeCount; ++i)
+    {
+        snapshot->_nodes.push_back(NodeState());
+        NodeState& state = snapshot->_nodes.back();
+
+        unsigned char flags = 0;
+        unsigned int tagCount = 0;
+        unsigned int clipCount = 0;
+        valid = readString(stream, &state.path) &&
+            readValue(stream, &state.translation, sizeof(state.translation)) &&
+            readValue(stream, &state.rotation, sizeof(state.rotation)) &&
+            readValue(stream, &state.scale, sizeof(state.scale)) &&
+            readValue(stream, &flags, sizeof(flags)) &&
+            readValue(stream, &tagCount, sizeof(tagCount)) && tagCount <= SNAPSHOT_MAX_STRING;
+        state.enabled = (flags & 1) != 0;
+        state.rigidBody = (flags & 2) != 0;
+
+        for (unsigned int j = 0; valid && j < tagCount; ++j)
+        {
+            state.tags.push_back(std::pair<std::string, std::string>());
+            valid = readString(stream, &state.tags.back().first) && readString(stream, &state.tags.back().second);
+        }
+
+        valid = valid && readValue(stream, &clipCount, sizeof(clipCount)) && clipCount <= SNAPSHOT_MAX_STRING;
+        for (unsigned int j = 0; valid && j < clipCount; ++j)
+        {
+            state.clips.push_back(ClipState());
+            ClipState& clip = state.clips.back();
+            unsigned char paused = 0;
+            valid = readString(stream, &clip.animation) && readString(stream, &clip.clip) &&
+                readValue(stream, &clip.speed, sizeof(clip.speed)) &&
+                readValue(stream, &clip.repeatCount, sizeof(clip.repeatCount)) &&
+                readValue(stream, &clip.elapsedTime, sizeof(clip.elapsedTime)) &&
+                readValue(stream, &paused, sizeof(paused));
+            clip.paused = paused != 0;
+        }
+
+        if (valid && state.rigidBody)
+        {
+            valid = readValue(stream, &state.linearVelocity, sizeof(state.linearVelocity)) &&
+                readValue(stream, &state.angularVelocity, sizeof(state.angularVelocity));
+        }
+        valid = valid && readString(stream, &state.aiState);
+    }
+
+    if (!valid)
+    {
+        GP_WARN("Failed to read scene snapshot; the stream ends before node %u.", (unsigned int)snapshot->_nodes.size() - 1);
+        SAFE_RELEASE(snapshot);
+    }
+    return snapshot;
+}
+
+SceneSnapshot* SceneSnapshot::create(const char* path)
+{
+    GP_ASSERT(path);
+
+    std::unique_ptr<Stream> stream(FileSystem::open(path));
+    if (stream.get() == NULL)
+    {
+        GP_WARN("Failed to open scene snapshot '%s'.", path);
+        return NULL;
+    }
+    return create(stream.get());
+}
+
+bool SceneSnapshot::write(Stream* stream) const
+{
+    GP_ASSERT(stream);
+
+    unsigned int version = SNAPSHOT_VERSION;
+    unsigned int nodeCount = (unsigned int)_nodes.size();
+    bool valid = writeValue(stream, SNAPSHOT_MAGIC, 4) && writeValue(stream, &version, sizeof(version)) &&
+        writeValue(stream, &nodeCount, sizeof(nodeCount));
+    for (size_t i = 0, count = _nodes.size(); valid && i < count; ++i)
+    {
+        const NodeState& state = _nodes[i];
+        unsigned char flags = (state.enabled ? 1 : 0) | (state.rigidBody ? 2 : 0);
+        unsigned int tagCount = (unsigned int)state.tags.size();
+        unsigned int clipCount = (unsigned int)state.clips.size();
+        valid = writeString(stream, state.path) &&
+            writeValue(stream, &state.translation, sizeof(state.translation)) &&
+            writeValue(stream, &state.rotation, sizeof(state.rotation)) &&
+            writeValue(stream, &state.scale, sizeof(state.scale)) &&
+            writeValue(stream, &flags, sizeof(flags)) &&
+            writeValue(stream, &tagCount, sizeof(tagCount));
+        for (unsigned int j = 0; valid && j < tagCount; ++j)
+        {
+            valid = writeString(stream, state.tags[j].first) && writeString(stream, state.tags[j].second);
+        }
+
+        valid = valid && writeValue(stream, &clipCount, sizeof(clipCount));
+        for (unsigned int j = 0; valid && j < clipCount; ++j)
+        {
+            const ClipState& clip = state.clips[j];
+            unsigned char paused = clip.paused ? 1 : 0;
+            valid = writeString(stream, clip.animation) && writeString(stream, clip.clip) &&
+                writeValue(stream, &clip.speed, sizeof(clip.speed)) &&
+                writeValue(stream, &clip.repeatCount, sizeof(clip.repeatCount)) &&
+                writeValue(stream, &clip.elapsedTime, sizeof(clip.elapsedTime)) &&
+                writeValue(stream, &paused, sizeof(paused));
+        }
+
+        if (valid && state.rigidBody)
+        {
+            valid = writeValue(stream, &state.linearVelocity, sizeof(state.linearVelocity)) &&
+                writeValue(stream, &state.angularVelocity, sizeof(state.angularVelocity));
+        }
+        valid = valid && writeString(stream, state.aiState);
+    }
+
+    if (!valid)
+        GP_WARN("Failed to write scene snapshot.");
+    return valid;
+}
+
+bool SceneSnapshot::save(const char* path) const
+{
+    GP_ASSERT(path);
+
+    std::unique_ptr<Stream> stream(FileSystem::open(path, FileSystem::WRITE));
+    if (stream.get() == NULL)
+    {
+        GP_WARN("Failed to open scene snapshot '%s' for writing.", path);
+        return false;
+    }
+    return write(stream.get());
+}
+
+void SceneSnapshot::saveProc(void* cookie)
+{
+    SnapshotSave* save = (SnapshotSave*)cookie;
+    save->snapshot->save(save->path.c_str());
+    --save->snapshot->_saving;
+    SAFE_RELEASE(save->snapshot);
+    SAFE_DELETE(save);
+}
+
+void SceneSnapshot::saveAsync(const char* path)
+{
+    GP_ASSERT(path);
+
+    SnapshotSave* save = new SnapshotSave();
+    save->snapshot = this;
+    save->path = path;
+    addRef();
+    ++_saving;
+
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    if (jobSystem)
+    {
+        JobSystem::Job* job = jobSystem->create(&saveProc, save);
+        jobSystem->run(job);
+        jobSystem->release(job);
+    }
+    else
+    {
+        saveProc(save);
+    }
+}
+
+bool SceneSnapshot::isSaving() const
+{
+    return _saving > 0;
+}
+
+static void collectNodes(Node* node, const std::string& path, std::unordered_map<std::string, Node*>* nodes)
+{
+    nodes->insert(std::make_pair(path, node));
+    for (Node* child = node->getFirstChild(); child; child = child->getNextSibling())
+    {
+        collectNodes(child, path + "/" + child->getId(), nodes);
+    }
+}
+
+unsigned int SceneSnapshot::apply(Scene* scene) const
+{
+    GP_ASSERT(scene);
+
+    // Nodes with the same path keep the first of them, like findNode().
+    std::unordered_map<std::string, Node*> nodes;
+    for (Node* node = scene->getFirstNode(); node; node = node->getNextSibling())
+    {
+        collectNodes(node, node->getId(), &nodes);
+    }
+
+    unsigned int applied = 0;
+    for (size_t i = 0, count = _nodes.size(); i < count; ++i)
+    {
+        std::unordered_map<std::string, Node*>::const_iterator itr = nodes.find(_nodes[i].path);
+        if (itr == nodes.end())
+            continue;
+        applyNode(_nodes[i], itr->second);
+        ++applied;
+    }
+    return applied;
+}
+
+void SceneSnapshot::applyNode(const NodeState& state, Node* node)
+{
+    node->set(state.scale, state.rotation, state.translation);
+    node->setEnabled(state.enabled);
+
+    // The tags are removed through setTag() so that the tagged nodes of the scene are kept up to date.
+    if (node->_tags)
+    {
+        std::vector<std::string> names;
+        for (std::map<std::string, std::string, std::less<std::string>, PoolAllocator<std::pair<const std::string, std::string> > >::const_iterator itr = node->_tags->begin(); itr != node->_tags->end(); ++itr)
+            names.push_back(itr->first);
+        for (size_t i = 0, count = names.size(); i < count; ++i)
+            node->setTag(names[i].c_str(), NULL);
+    }
+    for (size_t i = 0, count = state.tags.size(); i < count; ++i)
+    {
+        node->setTag(state.tags[i].first.c_str(), state.tags[i].second.c_str());
+    }
+
+    // The clips that were not playing when the snapshot was captured are stopped.
+    if (node->_animationChannels)
+    {
+        for (size_t i = 0, count = node->_animationChannels->size(); i < count; ++i)
+        {
+            Animation* animation = (*node->_animationChannels)[i]->_animation;
+            for (unsigned int j = 0, clipCount = animation->getClipCount(); j < clipCount; ++j)
+            {
+                AnimationClip* clip = animation->getClip(j);
+                bool playing = false;
+                for (size_t k = 0, stateCount = state.clips.size(); k < stateCount && !playing; ++k)
+                    playing = state.clips[k].animation == animation->getId() && state.clips[k].clip == clip->getId();
+                if (!playing && clip->isPlaying())
+                    clip->stop();
+            }
+        }
+    }
+    for (size_t i = 0, count = state.clips.size(); i < count; ++i)
+    {
+        const ClipState& clipState = state.clips[i];
+        Animation* animation = node->getAnimation(clipState.animation.c_str());
+        AnimationClip* clip = animation ? animation->getClip(clipState.clip.c_str()) : NULL;
+        if (!clip)
+            continue;
+
+        // The clip computes its elapsed time from its start time when it begins, so the start
+        // time is moved back by the time that had elapsed.
+        clip->setSpeed(clipState.speed);
+        clip->setRepeatCount(clipState.repeatCount);
+        clip->play();
+        if (clipState.speed > 0.0f)
+            clip->_timeStarted = Game::getGameTime() - clipState.elapsedTime / clipState.speed;
+        else if (clipState.speed < 0.0f)
+            clip->_timeStarted = Game::getGameTime() - (clipState.elapsedTime - clip->_activeDuration) / clipState.speed;
+        if (clipState.paused)
+            clip->pause();
+    }
+
+    // The rigid body is moved to the transform of the node, since dynamic bodies are otherwise
+    // only moved by the simulation.
+    PhysicsCollisionObject* collisionObject = node->getCollisionObject();
+    if (state.rigidBody && collisionObject && collisionObject->getType() == PhysicsCollisionObject::RIGID_BODY)
+    {
+        PhysicsRigidBody* rigidBody = static_cast<PhysicsRigidBody*>(collisionObject);
+        rigidBody->_motionState->updateTransformFromNode();
+        btTransform transform;
+        rigidBody->_motionState->getWorldTransform(transform);
+        rigidBody->_body->setCenterOfMassTransform(transform);
+        rigidBody->setLinearVelocity(state.linearVelocity);
+        rigidBody->setAngularVelocity(state.angularVelocity);
+    }
+
+    AIAgent* agent = node->getAgent();
+    if (agent && !state.aiState.empty())
+    {
+        AIState* active = agent->getStateMachine()->getActiveState();
+        if (!active || state.aiState != active->getId())
+            agent->getStateMachine()->setState(state.aiState.c_str());
+    }
+}
+
+unsigned int SceneSnapshot::getNodeCount() const
+{
+    return (unsigned int)_nodes.size();
+}
+
+}
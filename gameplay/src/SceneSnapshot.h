@@ -0,0 +1,184 @@
+#ifndef SCENESNAPSHOT_H_
+#define SCENESNAPSHOT_H_
+
+#include "Ref.h"
+#include "Scene.h"
+#include "Stream.h"
+
+namespace gameplay
+{
+
+/**
+ * Defines a binary snapshot of the running state of a scene, for save games and autosaves.
+ *
+ * A snapshot holds, for each node of the scene, its transform, whether it is enabled, its tags,
+ * the state of the animation clips that are playing on it, the velocities of its rigid body and
+ * the active state of the state machine of its AI agent. It does not hold the assets of the scene,
+ * so it is applied to a scene that has been loaded from the same files, and it is read without
+ * parsing any text. The nodes are matched by the path of ids from the root of the scene to them,
+ * such as "level/door1/handle".
+ *
+ * Capturing a snapshot only copies these values, so it is cheap enough to be done in a frame. The
+ * snapshot is not changed afterwards, which lets saveAsync() write it on a worker thread while
+ * the game goes on:
+ *
+ * @code
+ * SceneSnapshot* snapshot = SceneSnapshot::capture(scene);
+ * snapshot->saveAsync("autosave.sav");
+ * SAFE_RELEASE(snapshot);
+ *
+ * // Later, after loading the scene again.
+ * SceneSnapshot* snapshot = SceneSnapshot::create("autosave.sav");
+ * if (snapshot)
+ *     snapshot->apply(scene);
+ * @endcode
+ *
+ * @script{ignore}
+ */
+class SceneSnapshot : public Ref
+{
+public:
+
+    /**
+     * Captures the state of the nodes of a scene.
+     *
+     * @param scene The scene.
+     *
+     * @return The new snapshot.
+     */
+    static SceneSnapshot* capture(Scene* scene);
+
+    /**
+     * Reads a snapshot that was written with write().
+     *
+     * @param stream The stream to read from.
+     *
+     * @return The new snapshot, or NULL if the stream does not hold a valid snapshot.
+     */
+    static SceneSnapshot* create(Stream* stream);
+
+    /**
+     * Reads a snapshot from a file that was written with save().
+     *
+     * @param path The path of the file.
+     *
+     * @return The new snapshot, or NULL if the file does not hold a valid snapshot.
+     */
+    static SceneSnapshot* create(const char* path);
+
+    /**
+     * Writes the snapshot to a stream.
+     *
+     * @param stream The stream to write to.
+     *
+     * @return true if the snapshot was written, false otherwise.
+     */
+    bool write(Stream* stream) const;
+
+    /**
+     * Writes the snapshot to a file.
+     *
+     * @param path The path of the file.
+     *
+     * @return true if the snapshot was written, false otherwise.
+     */
+    bool save(const char* path) const;
+
+    /**
+     * Writes the snapshot to a file on a worker thread of the job system. The snapshot is kept
+     * alive until it has been written, so it can be released right away.
+     *
+     * @param path The path of the file.
+     */
+    void saveAsync(const char* path);
+
+    /**
+     * Determines if the snapshot is being written by saveAsync().
+     *
+     * @return true if a write has not finished yet, false otherwise.
+     */
+    bool isSaving() const;
+
+    /**
+     * Applies the snapshot to the nodes of a scene with the same paths. Nodes of the snapshot
+     * that are not in the scene are skipped.
+     *
+     * @param scene The scene.
+     *
+     * @return The number of nodes that the snapshot was applied to.
+     */
+    unsigned int apply(Scene* scene) const;
+
+    /**
+     * Returns the number of nodes in the snapshot.
+     *
+     * @return The number of nodes.
+     */
+    unsigned int getNodeCount() const;
+
+private:
+
+    /**
+     * The playback state of an animation clip.
+     */
+    struct ClipState
+    {
+        std::string animation;
+        std::string clip;
+        float speed;
+        float repeatCount;
+        float elapsedTime;
+        bool paused;
+    };
+
+    /**
+     * The state of a node.
+     */
+    struct NodeState
+    {
+        std::string path;
+        Vector3 translation;
+        Quaternion rotation;
+        Vector3 scale;
+        bool enabled;
+        std::vector<std::pair<std::string, std::string> > tags;
+        std::vector<ClipState> clips;
+        bool rigidBody;
+        Vector3 linearVelocity;
+        Vector3 angularVelocity;
+        std::string aiState;
+    };
+
+    /**
+     * Constructor.
+     */
+    SceneSnapshot();
+
+    /**
+     * Destructor.
+     */
+    ~SceneSnapshot();
+
+    /**
+     * Hidden copy constructor.
+     */
+    SceneSnapshot(const SceneSnapshot& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    SceneSnapshot& operator=(const SceneSnapshot&);
+
+    void captureNode(Node* node, const std::string& path);
+
+    static void applyNode(const NodeState& state, Node* node);
+
+    static void saveProc(void* cookie);
+
+    std::vector<NodeState> _nodes;
+    std::atomic<unsigned int> _saving;
+};
+
+}
+
+#endif
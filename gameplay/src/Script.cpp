@@ -39,4 +39,63 @@ bool Script::reload()
     return Game::getInstance()->getScriptController()->loadScript(this);
 }
 
+ScriptFunctionHandle::ScriptFunctionHandle() : _script(NULL), _env(0), _ref(LUA_NOREF)
+{
+}
+
+ScriptFunctionHandle::ScriptFunctionHandle(const ScriptFunctionHandle& copy) : _script(NULL), _env(0), _ref(LUA_NOREF)
+{
+    *this = copy;
+}
+
+ScriptFunctionHandle::~ScriptFunctionHandle()
+{
+    reset();
+}
+
+ScriptFunctionHandle& ScriptFunctionHandle::operator=(const ScriptFunctionHandle& copy)
+{
+    if (this != &copy)
+    {
+        reset();
+        _function = copy._function;
+        _args = copy._args;
+        _arguments = copy._arguments;
+        _script = copy._script;
+        _env = copy._env;
+
+        // Each handle holds its own reference to the function.
+        Game* game = Game::getInstance();
+        lua_State* lua = game && game->getScriptController() ? game->getScriptController()->_lua : NULL;
+        if (copy._ref != LUA_NOREF && lua)
+        {
+            lua_rawgeti(lua, LUA_REGISTRYINDEX, copy._ref);
+            _ref = luaL_ref(lua, LUA_REGISTRYINDEX);
+        }
+    }
+    return *this;
+}
+
+bool ScriptFunctionHandle::isValid() const
+{
+    return _ref != LUA_NOREF;
+}
+
+const char* ScriptFunctionHandle::getFunction() const
+{
+    return _function.c_str();
+}
+
+void ScriptFunctionHandle::reset()
+{
+    if (_ref != LUA_NOREF)
+    {
+        Game* game = Game::getInstance();
+        lua_State* lua = game && game->getScriptController() ? game->getScriptController()->_lua : NULL;
+        if (lua)
+            luaL_unref(lua, LUA_REGISTRYINDEX, _ref);
+        _ref = LUA_NOREF;
+    }
+}
+
 }
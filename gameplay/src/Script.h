@@ -114,6 +114,83 @@ private:
 
 };
 
+/**
+ * Defines a handle to a Lua function that is looked up once and then called repeatedly.
+ *
+ * Calling a function by name looks it up through its tables and parses its argument signature
+ * every time. A handle keeps a reference to the function and the parsed signature instead, so
+ * callbacks that run every frame only push their arguments and call it. A handle calls the
+ * function that it found even if the name is assigned another value later, except that the
+ * functions of a script are looked up again after the script is reloaded. Functions that do not
+ * exist yet when the handle is resolved are looked up again when it is called.
+ *
+ * @see ScriptController::resolveFunction
+ * @script{ignore}
+ */
+class ScriptFunctionHandle
+{
+    friend class ScriptController;
+
+public:
+
+    /**
+     * Constructor.
+     */
+    ScriptFunctionHandle();
+
+    /**
+     * Copy constructor.
+     */
+    ScriptFunctionHandle(const ScriptFunctionHandle& copy);
+
+    /**
+     * Destructor.
+     */
+    ~ScriptFunctionHandle();
+
+    /**
+     * Copy assignment operator.
+     */
+    ScriptFunctionHandle& operator=(const ScriptFunctionHandle& copy);
+
+    /**
+     * Determines whether the handle refers to a function.
+     *
+     * @return true if the function was found, false otherwise.
+     */
+    bool isValid() const;
+
+    /**
+     * Returns the name of the function.
+     *
+     * @return The name of the function.
+     */
+    const char* getFunction() const;
+
+private:
+
+    /**
+     * An argument of the function, as one of 'i', 'u', 'b', 'd', 's', 'p' or 'o' for objects.
+     */
+    struct Argument
+    {
+        char type;
+        std::string className;
+    };
+
+    /**
+     * Releases the reference to the function.
+     */
+    void reset();
+
+    std::string _function;
+    std::string _args;
+    std::vector<Argument> _arguments;
+    Script* _script;
+    int _env;
+    int _ref;
+};
+
 }
 
 #endif
@@ -1,6 +1,8 @@
 #include "Base.h"
 #include "FileSystem.h"
 #include "ScriptController.h"
+#include "MemoryStats.h"
+#include "Profiler.h"
 
 #ifndef NO_LUA_BINDINGS
 #include "lua/lua_all_bindings.h"
@@ -53,11 +55,36 @@
 #define POP_NESTED_VARIABLE() \
     lua_settop(_lua, top)
 
+// The value pool hands out blocks in multiples of 16 bytes up to 64 bytes (a matrix), carved from chunks of 256 blocks
+#define SCRIPT_VALUE_POOL_GRANULARITY 16
+#define SCRIPT_VALUE_POOL_CLASSES 4
+#define SCRIPT_VALUE_POOL_CHUNK_SIZE 256
+
+// The amount of allocation, in kilobytes, that each incremental garbage collection step stands for
+#define SCRIPT_GC_STEP_SIZE 16
+// The collector runs past its budget once the memory in use grows this many times the memory left after a cycle
+#define SCRIPT_GC_OVERDUE_FACTOR 4
+#define SCRIPT_GC_OVERDUE_MIN_MEMORY (4 * 1024 * 1024)
+
+// The number of frames of the sampled stacks of scripts that are recorded as markers
+#define SCRIPT_PROFILE_MAX_DEPTH 32
+
 namespace gameplay
 {
 
 extern void splitURL(const std::string& url, std::string* file, std::string* id);
 
+static void* __valueFreeLists[SCRIPT_VALUE_POOL_CLASSES] = { NULL };
+static std::vector<char*> __valueChunks;
+
+static void releaseValuePool()
+{
+    for (size_t i = 0, count = __valueChunks.size(); i < count; ++i)
+        SAFE_DELETE_ARRAY(__valueChunks[i]);
+    __valueChunks.clear();
+    memset(__valueFreeLists, 0, sizeof(__valueFreeLists));
+}
+
 /**
  * Pushes onto the stack, the value of the variable 'name' or the nested table value if 'name' is a '.' separated 
  * list of tables of the form "A.B.C.D", where A, B and C are tables and D is a variable name in the table C.
@@ -258,14 +285,19 @@ bool ScriptController::loadScript(Script* script)
             lua_setfield(_lua, -2, "_THIS"); // [chunk, env]
 
             // Set the first upvalue (_ENV) for our chunk to the new environment table
+            // (LuaJIT follows Lua 5.1, where chunks have no _ENV and their environment is set instead)
+#ifdef GP_USE_LUAJIT
+            if (lua_setfenv(_lua, -2) == 0) // [chunk]
+#else
             if (lua_setupvalue(_lua, -2, 1) == NULL) // [chunk]
+#endif
             {
                 GP_WARN("Error setting environment table for script: %s.", script->_path.c_str());
             }
         }
 
         // Execute the script
-        ret = lua_pcall(_lua, 0, 0, 0);
+        ret = protectedCall(0, 0);
     }
 
     if (ret != LUA_OK)
@@ -649,7 +681,10 @@ void ScriptController::print(const char* str1, const char* str2)
     gameplay::print("%s%s", str1, str2);
 }
 
-ScriptController::ScriptController() : _lua(NULL)
+ScriptController::ScriptController()
+    : _lua(NULL), _typeMaskWords(0), _typeMasksDirty(false), _garbageBudget(0.0f), _garbageBaseline(0),
+      _garbageFrameTime(0.0f), _garbageMaxFrameTime(0.0f), _garbageFrameSteps(0), _garbageCycles(0),
+      _profiling(false), _profileInterval(1000), _callDepth(0), _sampler("Lua")
 {
 }
 
@@ -686,6 +721,114 @@ static const char* lua_dofile_function =
     "    end\n"
     "end\n";
 
+#ifdef GP_USE_LUAJIT
+// Defines the math types as FFI structs with the layout of the gameplay types, so that scripts can do their math in
+// compiled code; the chunk is passed the function that returns the address of the value of a bound object.
+static const char* lua_ffi_math_types =
+    "local pointer = ...\n"
+    "local ffi = require(\"ffi\")\n"
+    "local sqrt = math.sqrt\n"
+    "ffi.cdef[[\n"
+    "typedef struct { float x, y; } gameplay_Vector2;\n"
+    "typedef struct { float x, y, z; } gameplay_Vector3;\n"
+    "typedef struct { float x, y, z, w; } gameplay_Vector4;\n"
+    "typedef struct { float x, y, z, w; } gameplay_Quaternion;\n"
+    "typedef struct { float m[16]; } gameplay_Matrix;\n"
+    "]]\n"
+    "local V2, V3, V4, Q, M\n"
+    "V2 = ffi.metatype(\"gameplay_Vector2\", {\n"
+    "    __add = function(a, b) return V2(a.x + b.x, a.y + b.y) end,\n"
+    "    __sub = function(a, b) return V2(a.x - b.x, a.y - b.y) end,\n"
+    "    __mul = function(a, s) return V2(a.x * s, a.y * s) end,\n"
+    "    __unm = function(a) return V2(-a.x, -a.y) end,\n"
+    "    __index = {\n"
+    "        dot = function(a, b) return a.x * b.x + a.y * b.y end,\n"
+    "        length = function(a) return sqrt(a.x * a.x + a.y * a.y) end,\n"
+    "        normalize = function(a) local l = a:length() if l > 0 then a.x = a.x / l a.y = a.y / l end return a end,\n"
+    "        toObject = function(a) return Vector2.new(a.x, a.y) end,\n"
+    "    }\n"
+    "})\n"
+    "V3 = ffi.metatype(\"gameplay_Vector3\", {\n"
+    "    __add = function(a, b) return V3(a.x + b.x, a.y + b.y, a.z + b.z) end,\n"
+    "    __sub = function(a, b) return V3(a.x - b.x, a.y - b.y, a.z - b.z) end,\n"
+    "    __mul = function(a, s) return V3(a.x * s, a.y * s, a.z * s) end,\n"
+    "    __unm = function(a) return V3(-a.x, -a.y, -a.z) end,\n"
+    "    __index = {\n"
+    "        dot = function(a, b) return a.x * b.x + a.y * b.y + a.z * b.z end,\n"
+    "        cross = function(a, b) return V3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x) end,\n"
+    "        length = function(a) return sqrt(a.x * a.x + a.y * a.y + a.z * a.z) end,\n"
+    "        distance = function(a, b) return (a - b):length() end,\n"
+    "        normalize = function(a) local l = a:length() if l > 0 then a.x = a.x / l a.y = a.y / l a.z = a.z / l end return a end,\n"
+    "        toObject = function(a) return Vector3.new(a.x, a.y, a.z) end,\n"
+    "    }\n"
+    "})\n"
+    "V4 = ffi.metatype(\"gameplay_Vector4\", {\n"
+    "    __add = function(a, b) return V4(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w) end,\n"
+    "    __sub = function(a, b) return V4(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w) end,\n"
+    "    __mul = function(a, s) return V4(a.x * s, a.y * s, a.z * s, a.w * s) end,\n"
+    "    __unm = function(a) return V4(-a.x, -a.y, -a.z, -a.w) end,\n"
+    "    __index = {\n"
+    "        dot = function(a, b) return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w end,\n"
+    "        length = function(a) return sqrt(a:dot(a)) end,\n"
+    "        toObject = function(a) return Vector4.new(a.x, a.y, a.z, a.w) end,\n"
+    "    }\n"
+    "})\n"
+    "Q = ffi.metatype(\"gameplay_Quaternion\", {\n"
+    "    __mul = function(a, b)\n"
+    "        return Q(a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,\n"
+    "                 a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,\n"
+    "                 a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,\n"
+    "                 a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z)\n"
+    "    end,\n"
+    "    __index = {\n"
+    "        rotate = function(q, v)\n"
+    "            local u = V3(q.x, q.y, q.z)\n"
+    "            local t = u:cross(v) * 2\n"
+    "            return v + t * q.w + u:cross(t)\n"
+    "        end,\n"
+    "        toObject = function(q) return Quaternion.new(q.x, q.y, q.z, q.w) end,\n"
+    "    }\n"
+    "})\n"
+    "M = ffi.metatype(\"gameplay_Matrix\", {\n"
+    "    __mul = function(a, b)\n"
+    "        local r = M()\n"
+    "        for c = 0, 3 do\n"
+    "            for i = 0, 3 do\n"
+    "                r.m[c * 4 + i] = a.m[i] * b.m[c * 4] + a.m[4 + i] * b.m[c * 4 + 1] + a.m[8 + i] * b.m[c * 4 + 2] + a.m[12 + i] * b.m[c * 4 + 3]\n"
+    "            end\n"
+    "        end\n"
+    "        return r\n"
+    "    end,\n"
+    "    __index = {\n"
+    "        transformPoint = function(a, v)\n"
+    "            local m = a.m\n"
+    "            return V3(m[0] * v.x + m[4] * v.y + m[8] * v.z + m[12], m[1] * v.x + m[5] * v.y + m[9] * v.z + m[13], m[2] * v.x + m[6] * v.y + m[10] * v.z + m[14])\n"
+    "        end,\n"
+    "        transformVector = function(a, v)\n"
+    "            local m = a.m\n"
+    "            return V3(m[0] * v.x + m[4] * v.y + m[8] * v.z, m[1] * v.x + m[5] * v.y + m[9] * v.z, m[2] * v.x + m[6] * v.y + m[10] * v.z)\n"
+    "        end,\n"
+    "        toObject = function(a) local o = Matrix.new() ffi.copy(pointer(o, \"Matrix\"), a, ffi.sizeof(a)) return o end,\n"
+    "    }\n"
+    "})\n"
+    "FFIMath = {\n"
+    "    Vector2 = V2, Vector3 = V3, Vector4 = V4, Quaternion = Q, Matrix = M,\n"
+    "    view = function(object, type) return ffi.cast(\"gameplay_\" .. type .. \"*\", pointer(object, type)) end,\n"
+    "}\n";
+
+static int lua_ffi_pointer(lua_State* state)
+{
+    luaL_checktype(state, 1, LUA_TUSERDATA);
+    const char* type = luaL_checkstring(state, 2);
+    bool success;
+    ScriptUtil::LuaArray<unsigned char> object = ScriptUtil::getObjectPointer<unsigned char>(1, type, true, &success);
+    if (!success)
+        return luaL_argerror(state, 1, "expected a bound object of the given type");
+    lua_pushlightuserdata(state, (unsigned char*)object);
+    return 1;
+}
+#endif
+
 /**
  * @script{ignore}
  */
@@ -709,14 +852,47 @@ void appendLuaPath(lua_State* state, const char* path)
     lua_pop(state, 1);
 }
 
+// Allocates the memory of the Lua state, counting it in the memory statistics.
+static void* allocateLua(void* userData, void* ptr, size_t oldSize, size_t newSize)
+{
+    // When ptr is NULL, the old size is the type of the object that is allocated.
+    if (ptr == NULL)
+        oldSize = 0;
+
+    if (newSize == 0)
+    {
+        free(ptr);
+        MemoryStats::remove(MemoryStats::SCRIPTS, oldSize);
+        return NULL;
+    }
+
+    void* p = realloc(ptr, newSize);
+    if (p)
+    {
+        MemoryStats::remove(MemoryStats::SCRIPTS, oldSize);
+        MemoryStats::add(MemoryStats::SCRIPTS, newSize);
+    }
+    return p;
+}
+
+// Reports errors that are raised outside of a protected call, like luaL_newstate does.
+static int panicLua(lua_State* state)
+{
+    GP_ERROR("Unprotected error in a call to Lua: %s", lua_tostring(state, -1));
+    return 0;
+}
+
 void ScriptController::initialize()
 {
-    _lua = luaL_newstate();
+    _lua = lua_newstate(allocateLua, NULL);
+    if (_lua)
+        lua_atpanic(_lua, panicLua);
     if (!_lua)
         GP_ERROR("Failed to initialize Lua scripting engine.");
     luaL_openlibs(_lua);
 
 #ifndef NO_LUA_BINDINGS
+    installLazyRegistration();
     lua_RegisterAllBindings();
     ScriptUtil::registerFunction("convert", ScriptController::convert);
 #endif
@@ -734,6 +910,20 @@ void ScriptController::initialize()
     if (luaL_dostring(_lua, lua_dofile_function))
         GP_ERROR("Failed to load custom dofile() function with error: '%s'.", lua_tostring(_lua, -1));
 
+#ifdef GP_USE_LUAJIT
+    // Define the math types that scripts can use through the FFI.
+    if (luaL_loadstring(_lua, lua_ffi_math_types) == LUA_OK)
+    {
+        lua_pushcfunction(_lua, lua_ffi_pointer);
+        if (lua_pcall(_lua, 1, 0, 0) != LUA_OK)
+            GP_ERROR("Failed to define the FFI math types with error: '%s'.", lua_tostring(_lua, -1));
+    }
+    else
+    {
+        GP_ERROR("Failed to load the FFI math types with error: '%s'.", lua_tostring(_lua, -1));
+    }
+#endif
+
     // Write game command-line arguments to a global lua "arg" table
     std::ostringstream args;
     int argc;
@@ -750,6 +940,12 @@ void ScriptController::initialize()
         if (luaL_dostring(_lua, argsStr.c_str()))
             GP_ERROR("Failed to pass command-line arguments with error: '%s'.", lua_tostring(_lua, -1));
     }
+
+    // Apply a garbage budget and profiling that were set before the controller was initialized.
+    if (_garbageBudget > 0.0f)
+        setGarbageBudget(_garbageBudget);
+    if (_profiling)
+        setProfiling(true, _profileInterval);
 }
 
 void ScriptController::finalize()
@@ -761,6 +957,8 @@ void ScriptController::finalize()
     }
     _timeListeners.clear();
 
+    _sampler.end();
+
     if (_lua)
 	{
         // Perform a full garbage collection cycle.
@@ -772,6 +970,151 @@ void ScriptController::finalize()
         lua_close(_lua);
 		_lua = NULL;
 	}
+
+    // Lua has collected every value, so the pool can be released.
+    releaseValuePool();
+    _typeNames.clear();
+    _typeIds.clear();
+    _metatableTypes.clear();
+    _typeNameCache.clear();
+    _typeMasks.clear();
+    _typeMaskWords = 0;
+    _lazyClasses.clear();
+    _lazyTypes.clear();
+    _lazyEnumValues.clear();
+}
+
+void ScriptController::setGarbageBudget(float budget)
+{
+    _garbageBudget = std::max(0.0f, budget);
+    if (_lua)
+    {
+        // The collector is stopped while it only runs at the end of frames.
+        lua_gc(_lua, _garbageBudget > 0.0f ? LUA_GCSTOP : LUA_GCRESTART, 0);
+        _garbageBaseline = getGarbageMemory();
+    }
+}
+
+float ScriptController::getGarbageBudget() const
+{
+    return _garbageBudget;
+}
+
+void ScriptController::getGarbageStatistics(GarbageStatistics* statistics) const
+{
+    GP_ASSERT(statistics);
+
+    statistics->memory = getGarbageMemory();
+    statistics->frameTime = _garbageFrameTime;
+    statistics->maxFrameTime = _garbageMaxFrameTime;
+    statistics->frameSteps = _garbageFrameSteps;
+    statistics->cycles = _garbageCycles;
+}
+
+void ScriptController::setProfiling(bool enabled, unsigned int interval)
+{
+    _profiling = enabled;
+    _profileInterval = std::max(1u, interval);
+    if (_lua)
+    {
+        if (_profiling)
+            lua_sethook(_lua, sampleHook, LUA_MASKCOUNT, (int)_profileInterval);
+        else
+            lua_sethook(_lua, NULL, 0, 0);
+    }
+    if (!_profiling)
+        _sampler.end();
+}
+
+bool ScriptController::isProfiling() const
+{
+    return _profiling;
+}
+
+int ScriptController::protectedCall(int argumentCount, int resultCount)
+{
+    ++_callDepth;
+    int result = lua_pcall(_lua, argumentCount, resultCount, 0);
+    GP_ASSERT(_callDepth > 0);
+
+    // The markers of the sampled stack would otherwise stay open until scripts run again.
+    if (--_callDepth == 0)
+        _sampler.end();
+    return result;
+}
+
+void ScriptController::sampleHook(lua_State* state, lua_Debug* debug)
+{
+    if (!Profiler::isCapturing())
+        return;
+
+    // The outermost frames are kept when the stack is deeper than the markers that are recorded.
+    int depth = 0;
+    lua_Debug frame;
+    while (lua_getstack(state, depth, &frame))
+        ++depth;
+    unsigned int count = (unsigned int)std::min(depth, SCRIPT_PROFILE_MAX_DEPTH);
+
+    char names[SCRIPT_PROFILE_MAX_DEPTH][128];
+    const char* frames[SCRIPT_PROFILE_MAX_DEPTH];
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        frames[i] = names[i];
+        if (!lua_getstack(state, depth - 1 - (int)i, &frame) || !lua_getinfo(state, "Sn", &frame))
+        {
+            strcpy(names[i], "?");
+            continue;
+        }
+
+        // Lines within the functions are left out, so that their samples are merged into one marker.
+        if (frame.what && strcmp(frame.what, "C") == 0)
+            snprintf(names[i], sizeof(names[i]), "%s [C]", frame.name ? frame.name : "?");
+        else if (frame.what && strcmp(frame.what, "main") == 0)
+            snprintf(names[i], sizeof(names[i]), "main (%s)", frame.short_src);
+        else
+            snprintf(names[i], sizeof(names[i]), "%s (%s:%d)", frame.name ? frame.name : "?", frame.short_src, frame.linedefined);
+    }
+
+    Game::getInstance()->getScriptController()->_sampler.sample(frames, count);
+}
+
+size_t ScriptController::getGarbageMemory() const
+{
+    if (!_lua)
+        return 0;
+    return (size_t)lua_gc(_lua, LUA_GCCOUNT, 0) * 1024 + (size_t)lua_gc(_lua, LUA_GCCOUNTB, 0);
+}
+
+void ScriptController::collectGarbage()
+{
+    _garbageFrameTime = 0.0f;
+    _garbageFrameSteps = 0;
+    if (!_lua || _garbageBudget <= 0.0f)
+        return;
+
+    // Rather than letting the memory grow without bound when scripts make garbage faster than
+    // the steps collect it, finish the cycle even if it takes longer than the budget.
+    bool overdue = getGarbageMemory() > std::max(_garbageBaseline * SCRIPT_GC_OVERDUE_FACTOR, (size_t)SCRIPT_GC_OVERDUE_MIN_MEMORY);
+
+    double start = Game::getAbsoluteTime();
+    double elapsed = 0.0;
+    do
+    {
+        ++_garbageFrameSteps;
+        if (lua_gc(_lua, LUA_GCSTEP, SCRIPT_GC_STEP_SIZE))
+        {
+            // The cycle is complete, so there is little left to collect until more garbage is made.
+            ++_garbageCycles;
+            _garbageBaseline = getGarbageMemory();
+            elapsed = Game::getAbsoluteTime() - start;
+            break;
+        }
+        elapsed = Game::getAbsoluteTime() - start;
+    }
+    while (overdue || elapsed < _garbageBudget);
+
+    _garbageFrameTime = (float)elapsed;
+    _garbageMaxFrameTime = std::max(_garbageMaxFrameTime, _garbageFrameTime);
 }
 
 void ScriptController::executeFunctionHelper(int resultCount, const char* func, const char* args, va_list* list, Script* script)
@@ -905,12 +1248,187 @@ void ScriptController::executeFunctionHelper(int resultCount, const char* func,
     pushScript(script);
 
     // Perform the function call.
-    if (lua_pcall(_lua, argumentCount, resultCount, 0) != 0)
+    if (protectedCall(argumentCount, resultCount) != 0)
         GP_WARN("Failed to call function '%s' with error '%s'.", func, lua_tostring(_lua, -1));
 
     popScript();
 }
 
+bool ScriptController::resolveFunction(ScriptFunctionHandle* handle, const char* func, const char* args, Script* script)
+{
+    GP_ASSERT(handle);
+    GP_ASSERT(func);
+
+    handle->reset();
+    if (handle->_function != func)
+        handle->_function = func;
+    handle->_script = script;
+    handle->_env = script ? script->_env : 0;
+
+    // Parse the signature once into the way each argument is pushed.
+    if (!args)
+        args = "";
+    if (handle->_args != args)
+    {
+        handle->_args = args;
+        handle->_arguments.clear();
+        for (const char* sig = args; *sig; )
+        {
+            ScriptFunctionHandle::Argument argument;
+            switch (*sig++)
+            {
+            case 'c':
+            case 'h':
+            case 'i':
+            case 'l':
+            case '[':
+                argument.type = 'i';
+                // Enums are pushed as the integer values they represent.
+                if (*(sig - 1) == '[')
+                {
+                    while (*sig && *sig++ != ']');
+                }
+                break;
+            case 'u':
+                argument.type = 'u';
+                if (*sig)
+                    sig++;
+                break;
+            case 'b':
+                argument.type = 'b';
+                break;
+            case 'f':
+            case 'd':
+                argument.type = 'd';
+                break;
+            case 's':
+                argument.type = 's';
+                break;
+            case 'p':
+                argument.type = 'p';
+                break;
+            case '<':
+            {
+                // Calculate the unique Lua type name (this must match SCOPE_REPLACEMENT from the gameplay-luagen project).
+                argument.type = 'o';
+                const char* end = strchr(sig, '>');
+                argument.className.assign(sig, end ? end - sig : strlen(sig));
+                size_t i = argument.className.find("::");
+                while (i != std::string::npos)
+                {
+                    argument.className.replace(i, 2, "");
+                    i = argument.className.find("::");
+                }
+                sig = end ? end + 1 : sig + strlen(sig);
+                break;
+            }
+            default:
+                GP_ERROR("Invalid argument type '%d'.", *(sig - 1));
+                continue;
+            }
+            handle->_arguments.push_back(argument);
+        }
+    }
+
+    if (!_lua)
+        return false;
+
+    int top = lua_gettop(_lua);
+    if (getNestedVariable(_lua, func, handle->_env) && lua_isfunction(_lua, -1))
+    {
+        lua_pushvalue(_lua, -1);
+        handle->_ref = luaL_ref(_lua, LUA_REGISTRYINDEX);
+    }
+    lua_settop(_lua, top);
+    return handle->_ref != LUA_NOREF;
+}
+
+bool ScriptController::executeFunctionHelper(int resultCount, ScriptFunctionHandle* handle, va_list* list)
+{
+    GP_ASSERT(handle);
+
+    if (!_lua)
+        return false; // handles calling this method after script is finalized
+
+    // Global functions that are called from within another script run in its environment, which
+    // may define a function of the same name, so those are looked up by name as before.
+    if (!handle->_script && !_envStack.empty() && _envStack.back())
+    {
+        int top = lua_gettop(_lua);
+        executeFunctionHelper(resultCount, handle->_function.c_str(), handle->_args.c_str(), list, NULL);
+        return lua_gettop(_lua) - top == resultCount;
+    }
+
+    // Look the function up again if it did not exist before, or if its script has been reloaded since.
+    Script* script = handle->_script;
+    if (handle->_ref == LUA_NOREF || (script && script->_env != handle->_env))
+    {
+        if (!resolveFunction(handle, handle->_function.c_str(), handle->_args.c_str(), script))
+        {
+            GP_WARN("Failed to call function '%s'", handle->_function.c_str());
+            return false;
+        }
+    }
+
+    lua_rawgeti(_lua, LUA_REGISTRYINDEX, handle->_ref);
+    luaL_checkstack(_lua, (int)handle->_arguments.size(), "Too many arguments.");
+    for (size_t i = 0, count = handle->_arguments.size(); i < count; ++i)
+    {
+        const ScriptFunctionHandle::Argument& argument = handle->_arguments[i];
+        switch (argument.type)
+        {
+        case 'i':
+            lua_pushinteger(_lua, va_arg(*list, int));
+            break;
+        case 'u':
+            lua_pushunsigned(_lua, va_arg(*list, int));
+            break;
+        case 'b':
+            lua_pushboolean(_lua, va_arg(*list, int));
+            break;
+        case 'd':
+            lua_pushnumber(_lua, va_arg(*list, double));
+            break;
+        case 's':
+            lua_pushstring(_lua, va_arg(*list, char*));
+            break;
+        case 'p':
+            lua_pushlightuserdata(_lua, va_arg(*list, void*));
+            break;
+        default:
+        {
+            void* ptr = va_arg(*list, void*);
+            if (ptr == NULL)
+            {
+                lua_pushnil(_lua);
+            }
+            else
+            {
+                ScriptUtil::LuaObject* object = (ScriptUtil::LuaObject*)lua_newuserdata(_lua, sizeof(ScriptUtil::LuaObject));
+                object->instance = ptr;
+                object->owns = false;
+                luaL_getmetatable(_lua, argument.className.c_str());
+                lua_setmetatable(_lua, -2);
+            }
+            break;
+        }
+        }
+    }
+
+    pushScript(script);
+
+    // Perform the function call.
+    bool result = true;
+    if (protectedCall((int)handle->_arguments.size(), resultCount) != 0)
+    {
+        GP_WARN("Failed to call function '%s' with error '%s'.", handle->_function.c_str(), lua_tostring(_lua, -1));
+        result = false;
+    }
+
+    popScript();
+    return result;
+}
+
 int ScriptController::convert(lua_State* state)
 {
     // Get the number of parameters.
@@ -958,7 +1476,7 @@ void ScriptController::schedule(float timeOffset, const char* function)
     }
 
     ScriptTimeListener* listener = new ScriptTimeListener(script, function);
-    _timeListeners.push_back(listener);
+    listener->position = _timeListeners.insert(_timeListeners.end(), listener);
 
     Game::getInstance()->schedule(timeOffset, listener, NULL);
 }
@@ -984,6 +1502,174 @@ void ScriptController::popScript()
     SAFE_RELEASE(script);
 }
 
+bool ScriptController::isObjectType(int index, const char* type)
+{
+    GP_ASSERT(type);
+
+    if (!lua_getmetatable(_lua, index))
+        return false;
+    std::unordered_map<const void*, int>::const_iterator itr = _metatableTypes.find(lua_topointer(_lua, -1));
+    lua_pop(_lua, 1);
+    if (itr == _metatableTypes.end())
+        return false;
+
+    int target = getTypeId(type);
+    if (target < 0)
+        return false;
+    if (itr->second == target)
+        return true;
+
+    if (_typeMasksDirty)
+        updateTypeMasks();
+    return (_typeMasks[itr->second * _typeMaskWords + target / 32] & (1u << (target % 32))) != 0;
+}
+
+int ScriptController::getTypeId(const char* type)
+{
+    // The bindings pass the names of the types as literals, so the ids are cached by the address of
+    // the name. The name is compared once more, in case the address is reused for another name.
+    std::unordered_map<const char*, int>::const_iterator cached = _typeNameCache.find(type);
+    if (cached != _typeNameCache.end() && _typeNames[cached->second] == type)
+        return cached->second;
+
+    std::map<std::string, int>::const_iterator itr = _typeIds.find(type);
+    if (itr == _typeIds.end())
+    {
+        // Objects are checked against base classes that may not have been used yet.
+        if (!registerLazyType(type))
+            return -1;
+        itr = _typeIds.find(type);
+        if (itr == _typeIds.end())
+            return -1;
+    }
+    _typeNameCache[type] = itr->second;
+    return itr->second;
+}
+
+void ScriptController::updateTypeMasks()
+{
+    _typeMasksDirty = false;
+    _typeMaskWords = ((unsigned int)_typeNames.size() + 31) / 32;
+    _typeMasks.assign(_typeNames.size() * _typeMaskWords, 0);
+
+    // Every class is of its own type, and of the type of each class that lists it as derived.
+    for (int id = 0, count = (int)_typeNames.size(); id < count; ++id)
+        _typeMasks[id * _typeMaskWords + id / 32] |= 1u << (id % 32);
+    for (std::map<std::string, std::vector<std::string> >::const_iterator itr = _hierarchy.begin(); itr != _hierarchy.end(); ++itr)
+    {
+        std::map<std::string, int>::const_iterator base = _typeIds.find(itr->first);
+        if (base == _typeIds.end())
+            continue;
+        for (size_t i = 0, count = itr->second.size(); i < count; ++i)
+        {
+            std::map<std::string, int>::const_iterator derived = _typeIds.find(itr->second[i]);
+            if (derived != _typeIds.end())
+                _typeMasks[derived->second * _typeMaskWords + base->second / 32] |= 1u << (base->second % 32);
+        }
+    }
+}
+
+void ScriptController::installLazyRegistration()
+{
+    // Both metamethods are only called for the keys that the tables do not have yet.
+    lua_pushglobaltable(_lua);
+    lua_newtable(_lua);
+    lua_pushcfunction(_lua, indexLazyGlobal);
+    lua_setfield(_lua, -2, "__index");
+    lua_setmetatable(_lua, -2);
+    lua_pop(_lua, 1);
+
+    lua_pushvalue(_lua, LUA_REGISTRYINDEX);
+    lua_newtable(_lua);
+    lua_pushcfunction(_lua, indexLazyMetatable);
+    lua_setfield(_lua, -2, "__index");
+    lua_setmetatable(_lua, -2);
+    lua_pop(_lua, 1);
+}
+
+bool ScriptController::registerLazyClasses(const std::string& root)
+{
+    std::map<std::string, std::vector<LazyClass> >::iterator itr = _lazyClasses.find(root);
+    if (itr == _lazyClasses.end())
+        return false;
+
+    // The classes are removed first, so that looking up their tables while they are registered
+    // does not register them again.
+    std::vector<LazyClass> classes;
+    classes.swap(itr->second);
+    _lazyClasses.erase(itr);
+    for (size_t i = 0, count = classes.size(); i < count; ++i)
+    {
+        _lazyTypes.erase(classes[i].name);
+    }
+
+    // The outermost class creates the table that its inner classes are registered into.
+    for (size_t i = 0, count = classes.size(); i < count; ++i)
+    {
+        if (classes[i].name == root)
+            classes[i].registerFunction();
+    }
+    for (size_t i = 0, count = classes.size(); i < count; ++i)
+    {
+        if (classes[i].name != root)
+            classes[i].registerFunction();
+    }
+
+    std::map<std::string, std::vector<LazyEnumValue> >::iterator values = _lazyEnumValues.find(root);
+    if (values != _lazyEnumValues.end())
+    {
+        std::vector<LazyEnumValue> enumValues;
+        enumValues.swap(values->second);
+        _lazyEnumValues.erase(values);
+        for (size_t i = 0, count = enumValues.size(); i < count; ++i)
+        {
+            ScriptUtil::registerEnumValue(enumValues[i].value, enumValues[i].name, enumValues[i].scopePath);
+        }
+    }
+    return true;
+}
+
+bool ScriptController::registerLazyType(const char* type)
+{
+    std::map<std::string, std::string>::const_iterator itr = _lazyTypes.find(type);
+    if (itr == _lazyTypes.end())
+        return false;
+    std::string root = itr->second;
+    return registerLazyClasses(root);
+}
+
+int ScriptController::indexLazyGlobal(lua_State* state)
+{
+    // The stack holds the global table and the key.
+    if (lua_type(state, 2) == LUA_TSTRING)
+    {
+        std::string name = lua_tostring(state, 2);
+        if (Game::getInstance()->getScriptController()->registerLazyClasses(name))
+        {
+            lua_rawget(state, 1);
+            return 1;
+        }
+    }
+    lua_pushnil(state);
+    return 1;
+}
+
+int ScriptController::indexLazyMetatable(lua_State* state)
+{
+    // The stack holds the registry and the key, which is the name of a metatable for luaL_getmetatable.
+    if (lua_type(state, 2) == LUA_TSTRING)
+    {
+        const char* name = lua_tostring(state, 2);
+        if (Game::getInstance()->getScriptController()->registerLazyType(name))
+        {
+            lua_rawget(state, 1);
+            return 1;
+        }
+    }
+    lua_pushnil(state);
+    return 1;
+}
+
 ScriptController::ScriptTimeListener::ScriptTimeListener(Script* script, const char* function) : script(script), function(function)
 {
 }
@@ -997,10 +1683,7 @@ ScriptController::ScriptTimeListener::~ScriptTimeListener()
 void ScriptController::ScriptTimeListener::timeEvent(long timeDiff, void* cookie)
 {
     // Remove ourself from the script controller's list
-    std::list<ScriptTimeListener*>& list = Game::getInstance()->getScriptController()->_timeListeners;
-    std::list<ScriptTimeListener*>::iterator itr = std::find(list.begin(), list.end(), this);
-    if (itr != list.end())
-        list.erase(itr);
+    Game::getInstance()->getScriptController()->_timeListeners.erase(position);
 
     // Call the script function
     Game::getInstance()->getScriptController()->executeFunction<void>(script, function.c_str(), "l", timeDiff);
@@ -1038,6 +1721,31 @@ void ScriptController::ScriptTimeListener::timeEvent(long timeDiff, void* cookie
     lua_settop(_lua, top); \
     return value;
 
+#define SCRIPT_EXECUTE_FUNCTION_HANDLE(type, checkfunc) \
+    typedef type ResultType; \
+    if (!_lua) \
+        return ResultType(); \
+    int top = lua_gettop(_lua); \
+    va_list list; \
+    va_start(list, handle); \
+    ResultType value = ResultType(); \
+    if (executeFunctionHelper(1, handle, &list)) \
+        value = (type)checkfunc(_lua, -1); \
+    va_end(list); \
+    lua_settop(_lua, top); \
+    return value;
+
+#define SCRIPT_EXECUTE_FUNCTION_HANDLE_LIST(type, checkfunc) \
+    typedef type ResultType; \
+    if (!_lua) \
+        return ResultType(); \
+    int top = lua_gettop(_lua); \
+    ResultType value = ResultType(); \
+    if (executeFunctionHelper(1, handle, list)) \
+        value = (type)checkfunc(_lua, -1); \
+    lua_settop(_lua, top); \
+    return value;
+
 template<> void ScriptController::executeFunction<void>(const char* func)
 {
     executeFunction<void>((Script*)NULL, func);
@@ -1492,6 +2200,165 @@ template<> std::string ScriptController::executeFunction<std::string>(Script* sc
     SCRIPT_EXECUTE_FUNCTION_PARAM_LIST(script, std::string, luaL_checkstring);
 }
 
+/** Template specialization. */
+template<> void ScriptController::executeFunction<void>(ScriptFunctionHandle* handle, ...)
+{
+    va_list list;
+    va_start(list, handle);
+    executeFunctionHelper(0, handle, &list);
+    va_end(list);
+}
+
+/** Template specialization. */
+template<> bool ScriptController::executeFunction<bool>(ScriptFunctionHandle* handle, ...)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE(bool, ScriptUtil::luaCheckBool);
+}
+
+/** Template specialization. */
+template<> char ScriptController::executeFunction<char>(ScriptFunctionHandle* handle, ...)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE(char, luaL_checkint);
+}
+
+/** Template specialization. */
+template<> short ScriptController::executeFunction<short>(ScriptFunctionHandle* handle, ...)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE(short, luaL_checkint);
+}
+
+/** Template specialization. */
+template<> int ScriptController::executeFunction<int>(ScriptFunctionHandle* handle, ...)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE(int, luaL_checkint);
+}
+
+/** Template specialization. */
+template<> long ScriptController::executeFunction<long>(ScriptFunctionHandle* handle, ...)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE(long, luaL_checklong);
+}
+
+/** Template specialization. */
+template<> unsigned char ScriptController::executeFunction<unsigned char>(ScriptFunctionHandle* handle, ...)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE(unsigned char, luaL_checkunsigned);
+}
+
+/** Template specialization. */
+template<> unsigned short ScriptController::executeFunction<unsigned short>(ScriptFunctionHandle* handle, ...)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE(unsigned short, luaL_checkunsigned);
+}
+
+/** Template specialization. */
+template<> unsigned int ScriptController::executeFunction<unsigned int>(ScriptFunctionHandle* handle, ...)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE(unsigned int, luaL_checkunsigned);
+}
+
+/** Template specialization. */
+template<> unsigned long ScriptController::executeFunction<unsigned long>(ScriptFunctionHandle* handle, ...)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE(unsigned long, luaL_checkunsigned);
+}
+
+/** Template specialization. */
+template<> float ScriptController::executeFunction<float>(ScriptFunctionHandle* handle, ...)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE(float, luaL_checknumber);
+}
+
+/** Template specialization. */
+template<> double ScriptController::executeFunction<double>(ScriptFunctionHandle* handle, ...)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE(double, luaL_checknumber);
+}
+
+/** Template specialization. */
+template<> std::string ScriptController::executeFunction<std::string>(ScriptFunctionHandle* handle, ...)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE(std::string, luaL_checkstring);
+}
+
+/** Template specialization. */
+template<> void ScriptController::executeFunction<void>(ScriptFunctionHandle* handle, va_list* list)
+{
+    executeFunctionHelper(0, handle, list);
+}
+
+/** Template specialization. */
+template<> bool ScriptController::executeFunction<bool>(ScriptFunctionHandle* handle, va_list* list)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE_LIST(bool, ScriptUtil::luaCheckBool);
+}
+
+/** Template specialization. */
+template<> char ScriptController::executeFunction<char>(ScriptFunctionHandle* handle, va_list* list)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE_LIST(char, luaL_checkint);
+}
+
+/** Template specialization. */
+template<> short ScriptController::executeFunction<short>(ScriptFunctionHandle* handle, va_list* list)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE_LIST(short, luaL_checkint);
+}
+
+/** Template specialization. */
+template<> int ScriptController::executeFunction<int>(ScriptFunctionHandle* handle, va_list* list)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE_LIST(int, luaL_checkint);
+}
+
+/** Template specialization. */
+template<> long ScriptController::executeFunction<long>(ScriptFunctionHandle* handle, va_list* list)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE_LIST(long, luaL_checklong);
+}
+
+/** Template specialization. */
+template<> unsigned char ScriptController::executeFunction<unsigned char>(ScriptFunctionHandle* handle, va_list* list)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE_LIST(unsigned char, luaL_checkunsigned);
+}
+
+/** Template specialization. */
+template<> unsigned short ScriptController::executeFunction<unsigned short>(ScriptFunctionHandle* handle, va_list* list)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE_LIST(unsigned short, luaL_checkunsigned);
+}
+
+/** Template specialization. */
+template<> unsigned int ScriptController::executeFunction<unsigned int>(ScriptFunctionHandle* handle, va_list* list)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE_LIST(unsigned int, luaL_checkunsigned);
+}
+
+/** Template specialization. */
+template<> unsigned long ScriptController::executeFunction<unsigned long>(ScriptFunctionHandle* handle, va_list* list)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE_LIST(unsigned long, luaL_checkunsigned);
+}
+
+/** Template specialization. */
+template<> float ScriptController::executeFunction<float>(ScriptFunctionHandle* handle, va_list* list)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE_LIST(float, luaL_checknumber);
+}
+
+/** Template specialization. */
+template<> double ScriptController::executeFunction<double>(ScriptFunctionHandle* handle, va_list* list)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE_LIST(double, luaL_checknumber);
+}
+
+/** Template specialization. */
+template<> std::string ScriptController::executeFunction<std::string>(ScriptFunctionHandle* handle, va_list* list)
+{
+    SCRIPT_EXECUTE_FUNCTION_HANDLE_LIST(std::string, luaL_checkstring);
+}
+
 void ScriptUtil::registerLibrary(const char* name, const luaL_Reg* functions)
 {
     ScriptController* sc = Game::getInstance()->getScriptController();
@@ -1611,6 +2478,17 @@ void ScriptUtil::registerEnumValue(int enumValue, const std::string& enumValueSt
 {
     ScriptController* sc = Game::getInstance()->getScriptController();
 
+    // The values of a lazy class are set once its table is created.
+    if (!scopePath.empty() && sc->_lazyClasses.find(scopePath[0]) != sc->_lazyClasses.end())
+    {
+        ScriptController::LazyEnumValue value;
+        value.value = enumValue;
+        value.name = enumValueString;
+        value.scopePath = scopePath;
+        sc->_lazyEnumValues[scopePath[0]].push_back(value);
+        return;
+    }
+
     // If the constant is within a scope, get the correct parent 
     // table on the stack before setting its value.
     if (!scopePath.empty())
@@ -1681,6 +2559,13 @@ void ScriptUtil::registerClass(const char* name, const luaL_Reg* members, lua_CF
     // Create the metatable and populate it with the member functions.
     lua_pushliteral(sc->_lua, "__metatable");
     luaL_newmetatable(sc->_lua, name);
+
+    // Give the class an id, which objects are checked by through their metatable.
+    int id = (int)sc->_typeNames.size();
+    sc->_typeNames.push_back(name);
+    sc->_typeIds[name] = id;
+    sc->_metatableTypes[lua_topointer(sc->_lua, -1)] = id;
+    sc->_typeMasksDirty = true;
     if (members)
         luaL_setfuncs(sc->_lua, members, 0);
     lua_pushstring(sc->_lua, "__index");
@@ -1726,6 +2611,20 @@ void ScriptUtil::registerClass(const char* name, const luaL_Reg* members, lua_CF
     }
 }
 
+void ScriptUtil::registerClassLazy(const char* name, void (*registerFunction)(), const char* scope)
+{
+    GP_ASSERT(name);
+    GP_ASSERT(registerFunction);
+
+    ScriptController* sc = Game::getInstance()->getScriptController();
+    ScriptController::LazyClass lazyClass;
+    lazyClass.name = name;
+    lazyClass.registerFunction = registerFunction;
+    std::string root = scope ? scope : name;
+    sc->_lazyClasses[root].push_back(lazyClass);
+    sc->_lazyTypes[name] = root;
+}
+
 void ScriptUtil::registerFunction(const char* luaFunction, lua_CFunction cppFunction)
 {
     lua_pushcfunction(Game::getInstance()->getScriptController()->_lua, cppFunction);
@@ -1734,7 +2633,52 @@ void ScriptUtil::registerFunction(const char* luaFunction, lua_CFunction cppFunc
 
 void ScriptUtil::setGlobalHierarchyPair(const std::string& base, const std::string& derived)
 {
-    Game::getInstance()->getScriptController()->_hierarchy[base].push_back(derived);
+    ScriptController* sc = Game::getInstance()->getScriptController();
+    sc->_hierarchy[base].push_back(derived);
+    sc->_typeMasksDirty = true;
+}
+
+void* ScriptUtil::allocateValue(size_t size)
+{
+    GP_ASSERT(size > 0);
+
+    unsigned int sizeClass = (unsigned int)((size - 1) / SCRIPT_VALUE_POOL_GRANULARITY);
+    if (sizeClass >= SCRIPT_VALUE_POOL_CLASSES)
+        return malloc(size);
+
+    if (__valueFreeLists[sizeClass] == NULL)
+    {
+        // Carve a new chunk into blocks of the size class.
+        size_t blockSize = (sizeClass + 1) * SCRIPT_VALUE_POOL_GRANULARITY;
+        char* chunk = new char[blockSize * SCRIPT_VALUE_POOL_CHUNK_SIZE];
+        __valueChunks.push_back(chunk);
+        for (unsigned int i = 0; i < SCRIPT_VALUE_POOL_CHUNK_SIZE; ++i)
+        {
+            void** block = (void**)(chunk + i * blockSize);
+            *block = __valueFreeLists[sizeClass];
+            __valueFreeLists[sizeClass] = block;
+        }
+    }
+
+    void** block = (void**)__valueFreeLists[sizeClass];
+    __valueFreeLists[sizeClass] = *block;
+    return block;
+}
+
+void ScriptUtil::freeValue(void* memory, size_t size)
+{
+    if (memory == NULL)
+        return;
+
+    unsigned int sizeClass = (unsigned int)((size - 1) / SCRIPT_VALUE_POOL_GRANULARITY);
+    if (sizeClass >= SCRIPT_VALUE_POOL_CLASSES)
+    {
+        free(memory);
+        return;
+    }
+
+    *(void**)memory = __valueFreeLists[sizeClass];
+    __valueFreeLists[sizeClass] = memory;
 }
 
 ScriptUtil::LuaArray<bool> ScriptUtil::getBoolPointer(int index)
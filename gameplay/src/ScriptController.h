@@ -3,12 +3,20 @@
 
 #include "Script.h"
 #include "Game.h"
+#include "Profiler.h"
 
 namespace gameplay
 {
 
 /**
  * Controls and manages all scripts.
+ *
+ * When the runtime is built with GP_USE_LUAJIT, scripts run on LuaJIT rather than Lua 5.2, with
+ * the same bindings. The global FFIMath table then defines Vector2, Vector3, Vector4, Quaternion
+ * and Matrix as FFI structs with the layout of the gameplay types, whose arithmetic is compiled
+ * by the JIT instead of calling the bindings. FFIMath.view(object, "Vector3") returns a pointer
+ * to the value of a bound object, which is valid while the object is, and the toObject method of
+ * a struct creates a bound object from it to pass to the bindings.
  */
 class ScriptController
 {
@@ -17,6 +25,7 @@ class ScriptController
     friend class Script;
     friend class ScriptUtil;
     friend class ScriptTimeListener;
+    friend class ScriptFunctionHandle;
 
 public:
 
@@ -175,6 +184,44 @@ public:
      */
     template<typename T> T executeFunction(Script* script, const char* func, const char* args, va_list* list);
 
+    /**
+     * Looks up a function once, so that it can be called through a handle without looking it up by name.
+     *
+     * @param handle The handle to set.
+     * @param func The name of the function.
+     * @param args The argument signature of the function, in the format of executeFunction, or NULL if it has no arguments.
+     * @param script Optional script to look the function up in, or NULL for the global environment.
+     *
+     * @return true if the function exists, false if the handle is set to look it up again when it is called.
+     *
+     * @script{ignore}
+     */
+    bool resolveFunction(ScriptFunctionHandle* handle, const char* func, const char* args = NULL, Script* script = NULL);
+
+    /**
+     * Calls a function through a handle.
+     *
+     * @param handle The handle that the function was resolved into.
+     * @param ... The arguments of the function, which must match the signature it was resolved with.
+     *
+     * @return The return value of the executed Lua function.
+     *
+     * @script{ignore}
+     */
+    template<typename T> T executeFunction(ScriptFunctionHandle* handle, ...);
+
+    /**
+     * Calls a function through a handle.
+     *
+     * @param handle The handle that the function was resolved into.
+     * @param list The arguments of the function, which must match the signature it was resolved with.
+     *
+     * @return The return value of the executed Lua function.
+     *
+     * @script{ignore}
+     */
+    template<typename T> T executeFunction(ScriptFunctionHandle* handle, va_list* list);
+
     /**
      * Gets the global boolean script variable with the given name.
      * 
@@ -536,6 +583,115 @@ public:
      */
     static void print(const char* str1, const char* str2);
 
+    /**
+     * Statistics about the garbage collection of Lua (see getGarbageStatistics).
+     *
+     * @script{ignore}
+     */
+    struct GarbageStatistics
+    {
+        /**
+         * The memory in use by Lua, in bytes.
+         */
+        size_t memory;
+
+        /**
+         * The time spent collecting garbage at the end of the last frame, in milliseconds.
+         */
+        float frameTime;
+
+        /**
+         * The longest time spent collecting garbage at the end of a frame, in milliseconds.
+         */
+        float maxFrameTime;
+
+        /**
+         * The number of incremental steps run at the end of the last frame.
+         */
+        unsigned int frameSteps;
+
+        /**
+         * The number of collection cycles that have been completed at the end of a frame.
+         */
+        unsigned int cycles;
+    };
+
+    /**
+     * Sets the time that the garbage collector may run for at the end of every frame.
+     *
+     * By default, the collector runs whenever the memory allocated by scripts crosses its threshold,
+     * in the middle of whichever script happens to allocate, which can make single frames much longer
+     * than the others. With a budget, the collector only runs in incremental steps at the end of every
+     * frame, until the budget is used or a collection cycle is complete. If scripts make garbage faster
+     * than the steps collect it, the collector runs past the budget to complete the cycle. The budget
+     * can also be set in the scripting section of the game.config file:
+     *
+     * @code
+     * scripting
+     * {
+     *     garbageBudget = 1.5
+     * }
+     * @endcode
+     *
+     * @param budget The time in milliseconds, or 0 to let the collector run whenever it is triggered.
+     * @script{ignore}
+     */
+    void setGarbageBudget(float budget);
+
+    /**
+     * Returns the time that the garbage collector may run for at the end of every frame.
+     *
+     * @return The time in milliseconds, or 0 if the collector runs whenever it is triggered.
+     * @script{ignore}
+     */
+    float getGarbageBudget() const;
+
+    /**
+     * Gets statistics about the garbage collection of Lua.
+     *
+     * The times, steps and cycles are only counted for the collection at the end of frames, so
+     * they are zero unless a garbage budget is set.
+     *
+     * @param statistics Populated with the statistics of the garbage collection.
+     * @script{ignore}
+     */
+    void getGarbageStatistics(GarbageStatistics* statistics) const;
+
+    /**
+     * Sets whether the call stacks of scripts are sampled into the captures of the Profiler.
+     *
+     * While profiling, a hook samples the stack of the running script every specified number of
+     * Lua instructions, and the functions of the stack are shown as markers on the Lua track of
+     * the capture, named by the function, its source and the line where it is defined. The samples
+     * are only recorded while a capture is running (see Profiler::startCapture) and are aligned to
+     * the markers of the game, so the time that scripts spend in each function is shown in the frame
+     * that it was spent in. Since the stacks are sampled, functions that run for less than the
+     * interval between samples may not be shown. With LuaJIT, compiled code does not run the hook,
+     * so only the interpreted code is sampled. Profiling can be enabled in the scripting section of
+     * the game.config file, or toggled at runtime, for example from a debug key in Game::keyEvent:
+     *
+     * @code
+     * scripting
+     * {
+     *     profile = true
+     *     profileInterval = 1000
+     * }
+     * @endcode
+     *
+     * @param enabled true to sample the scripts, false to stop sampling them.
+     * @param interval The number of Lua instructions between samples.
+     * @script{ignore}
+     */
+    void setProfiling(bool enabled, unsigned int interval = 1000);
+
+    /**
+     * Returns whether the call stacks of scripts are sampled into the captures of the Profiler.
+     *
+     * @return true if the scripts are profiled, false otherwise.
+     * @script{ignore}
+     */
+    bool isProfiling() const;
+
 private:
 
     /**
@@ -562,6 +718,8 @@ private:
         Script* script;
         /** Holds the name of the Lua script function to call back. */
         std::string function;
+        /** Holds the position of the listener in the script controller's list, to remove it in constant time. */
+        std::list<ScriptTimeListener*>::iterator position;
     };
 
     /**
@@ -589,6 +747,32 @@ private:
      */
     void finalize();
 
+    /**
+     * Runs incremental garbage collection steps within the garbage budget, at the end of a frame.
+     */
+    void collectGarbage();
+
+    /**
+     * Calls the function on the stack in protected mode, and ends the markers of the sampled stack
+     * when the outermost call returns.
+     *
+     * @param argumentCount The number of arguments on the stack above the function.
+     * @param resultCount The number of results to leave on the stack.
+     *
+     * @return The status of lua_pcall.
+     */
+    int protectedCall(int argumentCount, int resultCount);
+
+    /**
+     * Samples the call stack of the running script, as the count hook of the Lua state.
+     */
+    static void sampleHook(lua_State* state, lua_Debug* debug);
+
+    /**
+     * Returns the memory in use by Lua, in bytes.
+     */
+    size_t getGarbageMemory() const;
+
     /**
      * Internal loadScript variant that supports loading into an existing Script object
      * for reloading purposes.
@@ -644,6 +828,17 @@ private:
      */
     void executeFunctionHelper(int resultCount, const char* func, const char* args, va_list* list, Script* script = NULL);
 
+    /**
+     * Calls the function of a handle using the given parameters.
+     *
+     * @param resultCount The expected number of returned values.
+     * @param handle The handle of the function.
+     * @param list The variable argument list.
+     *
+     * @return true if the function was called and returned, false if it could not be found or raised an error.
+     */
+    bool executeFunctionHelper(int resultCount, ScriptFunctionHandle* handle, va_list* list);
+
     /**
      * Converts a Gameplay userdata value to the type with the given class name.
      * This function will change the metatable of the userdata value to the metatable that matches the given string.
@@ -684,9 +879,96 @@ private:
 
     void popScript();
 
+    /**
+     * Determines whether the object at the given stack index is of the given class or of a class derived from it.
+     *
+     * Every registered class has an integer id, and the ids of the classes that it derives from
+     * are set in its inheritance bitmask, so checking an object only finds the id of its metatable.
+     */
+    bool isObjectType(int index, const char* type);
+
+    /**
+     * Returns the id of a registered class, or -1 if no class is registered with the name.
+     */
+    int getTypeId(const char* type);
+
+    /**
+     * Builds the inheritance bitmasks of the registered classes from the hierarchy pairs.
+     */
+    void updateTypeMasks();
+
+    /**
+     * A class whose registration is deferred until it is first used.
+     */
+    struct LazyClass
+    {
+        std::string name;
+        void (*registerFunction)();
+    };
+
+    /**
+     * An enumeration value of a class that is not registered yet.
+     */
+    struct LazyEnumValue
+    {
+        int value;
+        std::string name;
+        std::vector<std::string> scopePath;
+    };
+
+    /**
+     * Installs the metatables of the global table and the registry that register the lazy
+     * classes when their tables or metatables are first looked up.
+     */
+    void installLazyRegistration();
+
+    /**
+     * Registers the lazy classes of the global table with the given name, along with their inner classes.
+     *
+     * @return true if the classes were registered, false if there are no lazy classes with the name.
+     */
+    bool registerLazyClasses(const std::string& root);
+
+    /**
+     * Registers the lazy class whose metatable has the given name.
+     *
+     * @return true if the class was registered, false if there is no lazy class with the name.
+     */
+    bool registerLazyType(const char* type);
+
+    /**
+     * The __index metamethod of the global table, which registers the lazy class of a missing global.
+     */
+    static int indexLazyGlobal(lua_State* state);
+
+    /**
+     * The __index metamethod of the registry, which registers the lazy class of a missing metatable.
+     */
+    static int indexLazyMetatable(lua_State* state);
+
     lua_State* _lua;
     unsigned int _returnCount;
     std::map<std::string, std::vector<std::string> > _hierarchy;
+    std::vector<std::string> _typeNames;
+    std::map<std::string, int> _typeIds;
+    std::unordered_map<const void*, int> _metatableTypes;
+    std::unordered_map<const char*, int> _typeNameCache;
+    std::vector<unsigned int> _typeMasks;
+    unsigned int _typeMaskWords;
+    bool _typeMasksDirty;
+    std::map<std::string, std::vector<LazyClass> > _lazyClasses;
+    std::map<std::string, std::string> _lazyTypes;
+    std::map<std::string, std::vector<LazyEnumValue> > _lazyEnumValues;
+    float _garbageBudget;
+    size_t _garbageBaseline;
+    float _garbageFrameTime;
+    float _garbageMaxFrameTime;
+    unsigned int _garbageFrameSteps;
+    unsigned int _garbageCycles;
+    bool _profiling;
+    unsigned int _profileInterval;
+    unsigned int _callDepth;
+    Profiler::Sampler _sampler;
     std::map<std::string, std::vector<Script*> > _scripts;
     std::vector<Script*> _envStack;
     std::list<ScriptTimeListener*> _timeListeners;
@@ -854,6 +1136,60 @@ template<> double ScriptController::executeFunction<double>(Script* script, cons
 /** Template specialization. */
 template<> std::string ScriptController::executeFunction<std::string>(Script* script, const char* func, const char* args, va_list* list);
 
+/** Template specialization. */
+template<> void ScriptController::executeFunction<void>(ScriptFunctionHandle* handle, ...);
+/** Template specialization. */
+template<> bool ScriptController::executeFunction<bool>(ScriptFunctionHandle* handle, ...);
+/** Template specialization. */
+template<> char ScriptController::executeFunction<char>(ScriptFunctionHandle* handle, ...);
+/** Template specialization. */
+template<> short ScriptController::executeFunction<short>(ScriptFunctionHandle* handle, ...);
+/** Template specialization. */
+template<> int ScriptController::executeFunction<int>(ScriptFunctionHandle* handle, ...);
+/** Template specialization. */
+template<> long ScriptController::executeFunction<long>(ScriptFunctionHandle* handle, ...);
+/** Template specialization. */
+template<> unsigned char ScriptController::executeFunction<unsigned char>(ScriptFunctionHandle* handle, ...);
+/** Template specialization. */
+template<> unsigned short ScriptController::executeFunction<unsigned short>(ScriptFunctionHandle* handle, ...);
+/** Template specialization. */
+template<> unsigned int ScriptController::executeFunction<unsigned int>(ScriptFunctionHandle* handle, ...);
+/** Template specialization. */
+template<> unsigned long ScriptController::executeFunction<unsigned long>(ScriptFunctionHandle* handle, ...);
+/** Template specialization. */
+template<> float ScriptController::executeFunction<float>(ScriptFunctionHandle* handle, ...);
+/** Template specialization. */
+template<> double ScriptController::executeFunction<double>(ScriptFunctionHandle* handle, ...);
+/** Template specialization. */
+template<> std::string ScriptController::executeFunction<std::string>(ScriptFunctionHandle* handle, ...);
+
+/** Template specialization. */
+template<> void ScriptController::executeFunction<void>(ScriptFunctionHandle* handle, va_list* list);
+/** Template specialization. */
+template<> bool ScriptController::executeFunction<bool>(ScriptFunctionHandle* handle, va_list* list);
+/** Template specialization. */
+template<> char ScriptController::executeFunction<char>(ScriptFunctionHandle* handle, va_list* list);
+/** Template specialization. */
+template<> short ScriptController::executeFunction<short>(ScriptFunctionHandle* handle, va_list* list);
+/** Template specialization. */
+template<> int ScriptController::executeFunction<int>(ScriptFunctionHandle* handle, va_list* list);
+/** Template specialization. */
+template<> long ScriptController::executeFunction<long>(ScriptFunctionHandle* handle, va_list* list);
+/** Template specialization. */
+template<> unsigned char ScriptController::executeFunction<unsigned char>(ScriptFunctionHandle* handle, va_list* list);
+/** Template specialization. */
+template<> unsigned short ScriptController::executeFunction<unsigned short>(ScriptFunctionHandle* handle, va_list* list);
+/** Template specialization. */
+template<> unsigned int ScriptController::executeFunction<unsigned int>(ScriptFunctionHandle* handle, va_list* list);
+/** Template specialization. */
+template<> unsigned long ScriptController::executeFunction<unsigned long>(ScriptFunctionHandle* handle, va_list* list);
+/** Template specialization. */
+template<> float ScriptController::executeFunction<float>(ScriptFunctionHandle* handle, va_list* list);
+/** Template specialization. */
+template<> double ScriptController::executeFunction<double>(ScriptFunctionHandle* handle, va_list* list);
+/** Template specialization. */
+template<> std::string ScriptController::executeFunction<std::string>(ScriptFunctionHandle* handle, va_list* list);
+
 /**
  * Functions and structures used by the generated Lua script bindings.
  *
@@ -1005,6 +1341,21 @@ public:
     static void registerClass(const char* name, const luaL_Reg* members, lua_CFunction newFunction, lua_CFunction deleteFunction, const luaL_Reg* statics,
                        const std::vector<std::string>& scopePath);
 
+    /**
+     * Registers a class with Lua the first time that it is used, rather than right away.
+     *
+     * The class is registered when a script first looks up the global table of the class, or
+     * the global table that contains it for an inner class, or when a binding first looks up its
+     * metatable, for example to return an object of the class. Inner classes are registered along
+     * with the outermost class that contains them, and the enumeration values of a class are
+     * only set once it is registered.
+     *
+     * @param name The name of the class from within Lua, which is the name of its metatable.
+     * @param registerFunction The function that registers the class with registerClass().
+     * @param scope For an inner class, the name of its outermost containing class, or NULL.
+     */
+    static void registerClassLazy(const char* name, void (*registerFunction)(), const char* scope = NULL);
+
     /**
      * Register a function with Lua.
      * 
@@ -1021,6 +1372,35 @@ public:
      */
     static void setGlobalHierarchyPair(const std::string& base, const std::string& derived);
 
+    /**
+     * Allocates the memory of a small value that is returned to Lua, such as a vector or a matrix.
+     *
+     * The bindings of small value types allocate their instances from a pool of blocks that are
+     * reused once Lua has collected the values, rather than with new, since scripts create so
+     * many of them. The pool is only used from the thread that runs the scripts.
+     * 
+     * @param size The size of the value, in bytes.
+     * 
+     * @return The memory of the value.
+     */
+    static void* allocateValue(size_t size);
+
+    /**
+     * Destroys a value that was allocated with allocateValue and returns its memory to the pool.
+     * 
+     * @param value The value, or NULL.
+     */
+    template <typename T>
+    static void deleteValue(T* value);
+
+    /**
+     * Returns the memory of a value that was allocated with allocateValue to the pool.
+     * 
+     * @param memory The memory of the value, which has been destroyed.
+     * @param size The size of the value, in bytes.
+     */
+    static void freeValue(void* memory, size_t size);
+
     /**
      * Gets a pointer to a bool (as an array-use SAFE_DELETE_ARRAY to clean up) for the given stack index.
      * 
@@ -144,53 +144,12 @@ ScriptUtil::LuaArray<T> ScriptUtil::getObjectPointer(int index, const char* type
             }
             else
             {
-                bool foundMatch = false;
-
-                // Push array element metatable.
-                if (lua_getmetatable(sc->_lua, -1))
+                // Check that the element is of the declared parameter type or of a type derived from it.
+                if (sc->isObjectType(-1, type))
                 {
-                    // Push param type metatable.
-                    luaL_getmetatable(sc->_lua, type);
-                    if (lua_rawequal(sc->_lua, -1, -2))
-                    {
-                        // Pop param type metatable.
-                        lua_pop(sc->_lua, 1);
-
-                        // Matched the declared parameter type.
-                        arr.set(i, (T*)((ScriptUtil::LuaObject*)p)->instance);
-                        foundMatch = true;
-                    }
-                    else
-                    {
-                        // Pop param type metatable.
-                        lua_pop(sc->_lua, 1);
-
-                        // Check if it matches any of the derived types' metatables.
-                        const std::vector<std::string>& types = sc->_hierarchy[type];
-                        for (size_t k = 0, count = types.size(); k < count; k++)
-                        {
-                            // Push dervied type metatable.
-                            luaL_getmetatable(sc->_lua, types[k].c_str());
-                            if (lua_rawequal(sc->_lua, -1, -2))
-                            {
-                                // Pop derived type metatable.
-                                lua_pop(sc->_lua, 1);
-
-                                // Matched a derived type.
-                                arr.set(i, (T*)((ScriptUtil::LuaObject*)p)->instance);
-                                foundMatch = true;
-                                break;
-                            }
-                            // Pop derived type metatable
-                            lua_pop(sc->_lua, 1);
-                        }
-                    }
-
-                    // Pop array element metatable.
-                    lua_pop(sc->_lua, 1);
+                    arr.set(i, (T*)((ScriptUtil::LuaObject*)p)->instance);
                 }
-
-                if (!foundMatch)
+                else
                 {
                     GP_WARN("Invalid type passed for an array element for parameter index %d.", index);
                     arr.set(i, (T*)NULL);
@@ -207,61 +166,18 @@ ScriptUtil::LuaArray<T> ScriptUtil::getObjectPointer(int index, const char* type
 
     // Type is not nil and not a table, so it should be USERDATA.
     void* p = lua_touserdata(sc->_lua, index);
-    if (p != NULL)
+    if (p != NULL && sc->isObjectType(index, type))
     {
-        // Push object metatable.
-        if (lua_getmetatable(sc->_lua, index))
+        T* ptr = (T*)((ScriptUtil::LuaObject*)p)->instance;
+        if (ptr == NULL && nonNull)
         {
-            // Push param type metatable.
-            luaL_getmetatable(sc->_lua, type);
-            if (lua_rawequal(sc->_lua, -1, -2))
-            {
-                // Pop both metatables.
-                lua_pop(sc->_lua, 2);
-
-                T* ptr = (T*)((ScriptUtil::LuaObject*)p)->instance;
-                if (ptr == NULL && nonNull)
-                {
-                    GP_WARN("Attempting to pass NULL for required non-NULL parameter at index %d (likely a reference or by-value parameter).", index);
-                    return LuaArray<T>((T*)NULL);
-                }
-
-                // Type is valid.
-                *success = true;
-                return LuaArray<T>(ptr);
-            }
-            // Pop param type metable.
-            lua_pop(sc->_lua, 1);
-
-            // Check if it matches any of the derived types' metatables.
-            const std::vector<std::string>& types = sc->_hierarchy[type];
-            for (size_t i = 0, count = types.size(); i < count; i++)
-            {
-                // Push derived type metatable.
-                luaL_getmetatable(sc->_lua, types[i].c_str());
-                if (lua_rawequal(sc->_lua, -1, -2))
-                {
-                    // Pop both metatables.
-                    lua_pop(sc->_lua, 2);
-
-                    T* ptr = (T*)((ScriptUtil::LuaObject*)p)->instance;
-                    if (ptr == NULL && nonNull)
-                    {
-                        GP_WARN("Attempting to pass NULL for required non-NULL parameter at index %d (likely a reference or by-value parameter).", index);
-                        return LuaArray<T>((T*)NULL);
-                    }
-
-                    // Type is valid (matches a derived type).
-                    *success = true;
-                    return LuaArray<T>(ptr);
-                }
-                // Pop derived type metatable.
-                lua_pop(sc->_lua, 1);
-            }
-
-            // Pop object metatable.
-            lua_pop(sc->_lua, 1);
+            GP_WARN("Attempting to pass NULL for required non-NULL parameter at index %d (likely a reference or by-value parameter).", index);
+            return LuaArray<T>((T*)NULL);
         }
+
+        // Type is valid (matches the type or a derived type).
+        *success = true;
+        return LuaArray<T>(ptr);
     }
 
     // If we made it here, type was not nil, and it could not be mapped to a valid object pointer.
@@ -270,6 +186,16 @@ ScriptUtil::LuaArray<T> ScriptUtil::getObjectPointer(int index, const char* type
     return LuaArray<T>((T*)NULL);
 }
 
+template <typename T>
+void ScriptUtil::deleteValue(T* value)
+{
+    if (value)
+    {
+        value->~T();
+        freeValue(value, sizeof(T));
+    }
+}
+
 template<typename T> T ScriptController::executeFunction(const char* func)
 {
     return executeFunction<T>((Script*)NULL, func);
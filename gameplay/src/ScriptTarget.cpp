@@ -159,7 +159,9 @@ Script* ScriptTarget::addScript(const char* path)
             {
                 if (!_scriptCallbacks)
                     _scriptCallbacks = new std::map<const Event*, std::vector<CallbackFunction>>();
-                (*_scriptCallbacks)[event].push_back(CallbackFunction(script, event->name.c_str()));
+                std::vector<CallbackFunction>& callbacks = (*_scriptCallbacks)[event];
+                callbacks.push_back(CallbackFunction(script, event->name.c_str()));
+                sc->resolveFunction(&callbacks.back().handle, event->name.c_str(), event->args.c_str(), script);
             }
         }
         re = re->next;
@@ -300,7 +302,9 @@ void ScriptTarget::addScriptCallback(const Event* event, const char* function)
         // Store the callback
         if (!_scriptCallbacks)
             _scriptCallbacks = new std::map<const Event*, std::vector<CallbackFunction>>();
-        (*_scriptCallbacks)[event].push_back(CallbackFunction(script, func.c_str()));
+        std::vector<CallbackFunction>& callbacks = (*_scriptCallbacks)[event];
+        callbacks.push_back(CallbackFunction(script, func.c_str()));
+        Game::getInstance()->getScriptController()->resolveFunction(&callbacks.back().handle, func.c_str(), event->args.c_str(), script);
     }
 }
 
@@ -419,6 +423,7 @@ bool ScriptTarget::hasScriptListener(const Event* event) const
 template<> void ScriptTarget::fireScriptEvent<void>(const Event* event, ...)
 {
     GP_ASSERT(event);
+    GP_PROFILE_SCOPE("ScriptTarget::fireScriptEvent");
 
     if (!_scriptCallbacks)
         return; // no registered callbacks
@@ -434,8 +439,11 @@ template<> void ScriptTarget::fireScriptEvent<void>(const Event* event, ...)
         std::vector<CallbackFunction>& callbacks = itr->second;
         for (size_t i = 0, count = callbacks.size(); i < count; ++i)
         {
-            CallbackFunction& cb = callbacks[i];
-            sc->executeFunction<void>(cb.script, cb.function.c_str(), event->args.c_str(), &list);
+            // Each callback reads the arguments from the start.
+            va_list args;
+            va_copy(args, list);
+            sc->executeFunction<void>(&callbacks[i].handle, &args);
+            va_end(args);
         }
     }
 
@@ -445,6 +453,7 @@ template<> void ScriptTarget::fireScriptEvent<void>(const Event* event, ...)
 template<> bool ScriptTarget::fireScriptEvent<bool>(const Event* event, ...)
 {
     GP_ASSERT(event);
+    GP_PROFILE_SCOPE("ScriptTarget::fireScriptEvent");
 
     if (!_scriptCallbacks)
         return false; // no registered callbacks
@@ -460,8 +469,11 @@ template<> bool ScriptTarget::fireScriptEvent<bool>(const Event* event, ...)
         std::vector<CallbackFunction>& callbacks = itr->second;
         for (size_t i = 0, count = callbacks.size(); i < count; ++i)
         {
-            CallbackFunction& cb = callbacks[i];
-            if (sc->executeFunction<bool>(cb.script, cb.function.c_str(), event->args.c_str(), &list))
+            va_list args;
+            va_copy(args, list);
+            bool handled = sc->executeFunction<bool>(&callbacks[i].handle, &args);
+            va_end(args);
+            if (handled)
             {
                 va_end(list);
                 return true;
@@ -359,6 +359,8 @@ protected:
         Script* script;
         /** The function within the script to call. */
         std::string function;
+        /** The function resolved with the arguments of the event, so that firing it does not look it up. */
+        ScriptFunctionHandle handle;
 
         /**
          * The callback function to registry script function to.
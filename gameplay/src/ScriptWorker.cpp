@@ -0,0 +1,255 @@
+#include "Base.h"
+#include "ScriptWorker.h"
+#include "FileSystem.h"
+#include "Game.h"
+
+// The function of a worker script that handles the messages that are sent to it
+#define SCRIPT_WORKER_MESSAGE_FUNCTION "onMessage"
+
+namespace gameplay
+{
+
+static std::vector<ScriptWorker*> __workers;
+
+ScriptWorker::ScriptWorker(const char* id) : _id(id), _lua(NULL), _running(false)
+{
+}
+
+ScriptWorker::~ScriptWorker()
+{
+    wait();
+
+    std::vector<ScriptWorker*>::iterator itr = std::find(__workers.begin(), __workers.end(), this);
+    if (itr != __workers.end())
+        __workers.erase(itr);
+
+    // The messages that have not been routed yet are dropped.
+    for (size_t i = 0, count = _outbox.size(); i < count; ++i)
+    {
+        AIMessage::destroy(_outbox[i]);
+    }
+    if (_lua)
+        lua_close(_lua);
+}
+
+ScriptWorker* ScriptWorker::create(const char* path, const char* id)
+{
+    GP_ASSERT(path);
+
+    char* source = FileSystem::readAll(path);
+    if (source == NULL)
+    {
+        GP_WARN("Failed to read worker script '%s'.", path);
+        return NULL;
+    }
+
+    ScriptWorker* worker = new ScriptWorker(id ? id : path);
+    worker->_lua = luaL_newstate();
+    if (worker->_lua == NULL)
+    {
+        GP_WARN("Failed to create Lua state for worker script '%s'.", path);
+        SAFE_DELETE_ARRAY(source);
+        SAFE_DELETE(worker);
+        return NULL;
+    }
+    luaL_openlibs(worker->_lua);
+
+    // The post function finds its worker through its upvalue.
+    lua_pushlightuserdata(worker->_lua, worker);
+    lua_pushcclosure(worker->_lua, &ScriptWorker::post, 1);
+    lua_setglobal(worker->_lua, "post");
+
+    if (luaL_loadstring(worker->_lua, source) != LUA_OK || lua_pcall(worker->_lua, 0, 0, 0) != LUA_OK)
+    {
+        GP_WARN("Failed to run worker script '%s' with error: '%s'.", path, lua_tostring(worker->_lua, -1));
+        SAFE_DELETE_ARRAY(source);
+        SAFE_DELETE(worker);
+        return NULL;
+    }
+    SAFE_DELETE_ARRAY(source);
+
+    __workers.push_back(worker);
+    return worker;
+}
+
+const char* ScriptWorker::getId() const
+{
+    return _id.c_str();
+}
+
+void ScriptWorker::send(AIMessage* message)
+{
+    GP_ASSERT(message);
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _inbox.push_back(message);
+
+        // A job is already handling the messages of the worker, and handles this one as well.
+        if (_running)
+            return;
+        _running = true;
+    }
+
+    // Each worker runs one job at a time, since its Lua state is not thread safe.
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    if (jobSystem)
+    {
+        JobSystem::Job* job = jobSystem->create(&handleMessages, this);
+        jobSystem->run(job);
+        jobSystem->release(job);
+    }
+    else
+    {
+        handleMessages(this);
+    }
+}
+
+unsigned int ScriptWorker::getPendingMessageCount() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return (unsigned int)_inbox.size() + (_running ? 1 : 0);
+}
+
+void ScriptWorker::wait()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (_running)
+        _idle.wait(lock);
+}
+
+void ScriptWorker::handleMessages(void* cookie)
+{
+    ScriptWorker* worker = (ScriptWorker*)cookie;
+    std::vector<AIMessage*> messages;
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(worker->_mutex);
+            if (worker->_inbox.empty())
+            {
+                worker->_running = false;
+                worker->_idle.notify_all();
+                return;
+            }
+            messages.swap(worker->_inbox);
+        }
+
+        for (size_t i = 0, count = messages.size(); i < count; ++i)
+        {
+            worker->handleMessage(messages[i]);
+            AIMessage::destroy(messages[i]);
+        }
+        messages.clear();
+    }
+}
+
+void ScriptWorker::handleMessage(AIMessage* message)
+{
+    lua_getglobal(_lua, SCRIPT_WORKER_MESSAGE_FUNCTION);
+    if (!lua_isfunction(_lua, -1))
+    {
+        lua_pop(_lua, 1);
+        GP_WARN("Worker script '%s' has no %s function.", _id.c_str(), SCRIPT_WORKER_MESSAGE_FUNCTION);
+        return;
+    }
+
+    lua_pushnumber(_lua, message->getId());
+    lua_pushstring(_lua, message->getSender());
+    unsigned int parameterCount = message->getParameterCount();
+    for (unsigned int i = 0; i < parameterCount; ++i)
+    {
+        switch (message->getParameterType(i))
+        {
+        case AIMessage::INTEGER:
+            lua_pushinteger(_lua, message->getInt(i));
+            break;
+        case AIMessage::LONG:
+            lua_pushnumber(_lua, (lua_Number)message->getLong(i));
+            break;
+        case AIMessage::FLOAT:
+            lua_pushnumber(_lua, message->getFloat(i));
+            break;
+        case AIMessage::DOUBLE:
+            lua_pushnumber(_lua, message->getDouble(i));
+            break;
+        case AIMessage::BOOLEAN:
+            lua_pushboolean(_lua, message->getBoolean(i));
+            break;
+        case AIMessage::STRING:
+            lua_pushstring(_lua, message->getString(i));
+            break;
+        default:
+            lua_pushnil(_lua);
+            break;
+        }
+    }
+
+    if (lua_pcall(_lua, (int)parameterCount + 2, 0, 0) != LUA_OK)
+    {
+        GP_WARN("Failed to handle message %u in worker script '%s' with error: '%s'.", message->getId(), _id.c_str(), lua_tostring(_lua, -1));
+        lua_pop(_lua, 1);
+    }
+}
+
+int ScriptWorker::post(lua_State* state)
+{
+    // post(id, receiver, ...) with numbers, booleans, strings or nil as the parameters.
+    ScriptWorker* worker = (ScriptWorker*)lua_touserdata(state, lua_upvalueindex(1));
+    unsigned int id = (unsigned int)luaL_checknumber(state, 1);
+    const char* receiver = lua_isnoneornil(state, 2) ? NULL : luaL_checkstring(state, 2);
+    int parameterCount = std::max(0, lua_gettop(state) - 2);
+    for (int i = 0; i < parameterCount; ++i)
+    {
+        int type = lua_type(state, i + 3);
+        if (type != LUA_TNUMBER && type != LUA_TBOOLEAN && type != LUA_TSTRING && type != LUA_TNIL)
+            return luaL_argerror(state, i + 3, "expected a number, boolean, string or nil");
+    }
+
+    AIMessage* message = AIMessage::create(id, worker->_id.c_str(), receiver, (unsigned int)parameterCount);
+    for (int i = 0; i < parameterCount; ++i)
+    {
+        int index = i + 3;
+        switch (lua_type(state, index))
+        {
+        case LUA_TNUMBER:
+            message->setDouble(i, lua_tonumber(state, index));
+            break;
+        case LUA_TBOOLEAN:
+            message->setBoolean(i, lua_toboolean(state, index) != 0);
+            break;
+        case LUA_TSTRING:
+            message->setString(i, lua_tostring(state, index));
+            break;
+        default:
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(worker->_mutex);
+    worker->_outbox.push_back(message);
+    return 0;
+}
+
+void ScriptWorker::update()
+{
+    AIController* aiController = Game::getInstance()->getAIController();
+    std::vector<AIMessage*> messages;
+    for (size_t i = 0, count = __workers.size(); i < count; ++i)
+    {
+        ScriptWorker* worker = __workers[i];
+        {
+            std::lock_guard<std::mutex> lock(worker->_mutex);
+            if (worker->_outbox.empty())
+                continue;
+            messages.swap(worker->_outbox);
+        }
+        for (size_t j = 0, messageCount = messages.size(); j < messageCount; ++j)
+        {
+            aiController->sendMessage(messages[j]);
+        }
+        messages.clear();
+    }
+}
+
+}
@@ -0,0 +1,129 @@
+#ifndef SCRIPTWORKER_H_
+#define SCRIPTWORKER_H_
+
+#include "Ref.h"
+#include "AIMessage.h"
+
+namespace gameplay
+{
+
+/**
+ * Defines a Lua state of its own that runs a script on the worker threads of the job system.
+ *
+ * The scripts of the ScriptController all share one Lua state, which runs on the thread that
+ * runs the game. A script worker loads a script into a separate Lua state, so that script code
+ * that only computes, such as AI decisions or batch processing, can run in parallel with the
+ * game and with the other workers.
+ *
+ * Workers communicate with the game through AIMessage payloads. Messages that are sent to a
+ * worker are queued and passed in order to the onMessage function of its script on a worker
+ * thread. The script can post messages back with the post function, and the posted messages
+ * are routed through the AIController at the start of the next frame, so that they reach the
+ * agents (and their script listeners) on the thread that runs the game:
+ *
+ * @code
+ * -- pathfinder.lua
+ * function onMessage(id, sender, x, y)
+ *     local cost = computeCost(x, y)
+ *     post(id, sender, cost)
+ * end
+ * @endcode
+ *
+ * The engine classes are not thread safe, so the Lua state of a worker only has the standard
+ * Lua libraries and the post function, and not the gameplay bindings. The parameters of the
+ * messages are numbers, booleans and strings.
+ *
+ * @script{ignore}
+ */
+class ScriptWorker : public Ref
+{
+    friend class Game;
+
+public:
+
+    /**
+     * Creates a worker that runs a script.
+     *
+     * The script is run once right away, to define its functions.
+     *
+     * @param path The path of the script file.
+     * @param id The sender id of the messages that the script posts, or NULL to use the path.
+     *
+     * @return The new worker, or NULL if the script failed to load.
+     */
+    static ScriptWorker* create(const char* path, const char* id = NULL);
+
+    /**
+     * Returns the sender id of the messages that the worker posts.
+     *
+     * @return The id of the worker.
+     */
+    const char* getId() const;
+
+    /**
+     * Queues a message for the onMessage function of the script.
+     *
+     * The worker takes ownership of the message and destroys it once it has been handled.
+     * This can be called from any thread.
+     *
+     * @param message The message to send.
+     */
+    void send(AIMessage* message);
+
+    /**
+     * Returns the number of messages that have been sent to the worker and not handled yet.
+     *
+     * @return The number of pending messages.
+     */
+    unsigned int getPendingMessageCount() const;
+
+    /**
+     * Waits for the worker to handle all of the messages that have been sent to it.
+     */
+    void wait();
+
+private:
+
+    /**
+     * Constructor.
+     */
+    ScriptWorker(const char* id);
+
+    /**
+     * Destructor. Waits for the pending messages to be handled.
+     */
+    ~ScriptWorker();
+
+    /**
+     * Hidden copy constructor.
+     */
+    ScriptWorker(const ScriptWorker& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    ScriptWorker& operator=(const ScriptWorker&);
+
+    /**
+     * Routes the messages that the workers have posted through the AIController.
+     */
+    static void update();
+
+    static void handleMessages(void* cookie);
+
+    static int post(lua_State* state);
+
+    void handleMessage(AIMessage* message);
+
+    std::string _id;
+    lua_State* _lua;
+    mutable std::mutex _mutex;
+    std::condition_variable _idle;
+    std::vector<AIMessage*> _inbox;
+    std::vector<AIMessage*> _outbox;
+    bool _running;
+};
+
+}
+
+#endif
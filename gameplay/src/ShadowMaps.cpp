@@ -0,0 +1,663 @@
+#include "Base.h"
+#include "ShadowMaps.h"
+#include "Scene.h"
+#include "Game.h"
+#include "FrameBuffer.h"
+#include "RenderCommandList.h"
+
+// The number of texels that the cascades move by when they follow the camera
+#define SHADOW_MAPS_CASCADE_SNAP_TEXELS     8
+
+// The share of the view depth that is split evenly between the cascades, rather than logarithmically
+#define SHADOW_MAPS_CASCADE_LINEAR_SPLIT    0.25f
+
+// The near plane distance of the shadow maps of point and spot lights, as a share of their range
+#define SHADOW_MAPS_NEAR_PLANE_SCALE        0.02f
+
+// The polygon offset that the casters are rendered with, to keep lit surfaces out of their own shadow
+#define SHADOW_MAPS_OFFSET_FACTOR           2.0f
+#define SHADOW_MAPS_OFFSET_UNITS            4.0f
+
+namespace gameplay
+{
+
+/**
+ * Returns the rotation of a camera that looks along the specified direction.
+ */
+static void getLookRotation(const Vector3& forward, const Vector3& up, Quaternion* rotation)
+{
+    Matrix view;
+    Matrix::createLookAt(Vector3::zero(), forward, up, &view);
+    view.transpose();
+    Quaternion::createFromRotationMatrix(view, rotation);
+}
+
+/**
+ * Returns an up vector for a direction, from the preferred up vector unless it is too close to the direction.
+ */
+static Vector3 getUpVector(const Vector3& forward, const Vector3& preferred)
+{
+    Vector3 cross;
+    Vector3::cross(forward, preferred, &cross);
+    if (cross.lengthSquared() > 1e-6f)
+        return preferred;
+    return fabs(forward.y) < 0.9f ? Vector3::unitY() : Vector3::unitZ();
+}
+
+/**
+ * Mixes the identity and the bounds of a caster into a hash of the casters of a shadow map.
+ */
+static unsigned int hashCaster(unsigned int hash, Node* node)
+{
+    const BoundingSphere& sphere = node->getBoundingSphere();
+    const float values[] = { sphere.center.x, sphere.center.y, sphere.center.z, sphere.radius };
+    size_t address = (size_t)node;
+
+    // FNV-1a over the address of the node and the bits of its bounds.
+    const unsigned char* bytes = (const unsigned char*)&address;
+    for (size_t i = 0; i < sizeof(address); ++i)
+        hash = (hash ^ bytes[i]) * 16777619u;
+    bytes = (const unsigned char*)values;
+    for (size_t i = 0; i < sizeof(values); ++i)
+        hash = (hash ^ bytes[i]) * 16777619u;
+    return hash;
+}
+
+ShadowMaps::ShadowMaps(unsigned int size, unsigned int tileSize, unsigned int cascadeCount)
+    : _size(size), _tileSize(std::min(std::max(tileSize, 1u), size)), _gridSize(0), _cascadeCount(std::min(cascadeCount, MAX_CASCADES)),
+      _shadowDistance(100.0f), _casterDistance(100.0f), _staticUpdates(0), _cascadesEnabled(false),
+      _frameBuffer(NULL), _sampler(NULL), _camera(NULL), _cameraNode(NULL)
+{
+    _gridSize = _size / _tileSize;
+    _tiles.resize(_gridSize * _gridSize, false);
+    _parameters.set(1.0f / _size, 0.0005f, (float)_size, 0.0f);
+
+    // The cascades take the first 2x2 blocks of tiles.
+    const unsigned int cascadesPerRow = _gridSize / 2;
+    if (cascadesPerRow * cascadesPerRow < _cascadeCount)
+    {
+        GP_WARN("Shadow map atlas of %u tiles is too small for %u cascades.", _gridSize * _gridSize, _cascadeCount);
+        _cascadeCount = cascadesPerRow * cascadesPerRow;
+    }
+    for (unsigned int i = 0; i < MAX_CASCADES; ++i)
+    {
+        View& view = _cascades[i];
+        view.staticHash = 0;
+        view.staticValid = false;
+        view.dynamicDrawn = true;
+        view.size = 0;
+        _cascadeSplits[i] = 0.0f;
+    }
+    for (unsigned int i = 0; i < _cascadeCount; ++i)
+    {
+        unsigned int tileX = (i % cascadesPerRow) * 2;
+        unsigned int tileY = (i / cascadesPerRow) * 2;
+        _cascades[i].x = tileX * _tileSize;
+        _cascades[i].y = tileY * _tileSize;
+        _cascades[i].size = _tileSize * 2;
+        for (unsigned int y = tileY; y < tileY + 2; ++y)
+        {
+            for (unsigned int x = tileX; x < tileX + 2; ++x)
+                _tiles[y * _gridSize + x] = true;
+        }
+    }
+}
+
+ShadowMaps::~ShadowMaps()
+{
+    for (size_t i = 0, count = _lights.size(); i < count; ++i)
+    {
+        releaseLight(_lights[i]);
+    }
+    SAFE_RELEASE(_sampler);
+    SAFE_RELEASE(_frameBuffer);
+    SAFE_RELEASE(_camera);
+    SAFE_RELEASE(_cameraNode);
+}
+
+void ShadowMaps::createTargets()
+{
+    if (_frameBuffer)
+        return;
+
+    _frameBuffer = FrameBuffer::create("ShadowMaps", _size, _size);
+    DepthStencilTarget* depthTarget = DepthStencilTarget::create("ShadowMaps", DepthStencilTarget::DEPTH, _size, _size);
+    _frameBuffer->setDepthStencilTarget(depthTarget);
+    SAFE_RELEASE(depthTarget);
+
+    // The depths are encoded in pairs of channels, so they can not be filtered.
+    _sampler = Texture::Sampler::create(_frameBuffer->getRenderTarget()->getTexture());
+    _sampler->setFilterMode(Texture::NEAREST, Texture::NEAREST);
+    _sampler->setWrapMode(Texture::CLAMP, Texture::CLAMP);
+
+    // The shadow maps are rendered from a camera that is moved to each light in turn.
+    _camera = Camera::createPerspective(90.0f, 1.0f, 1.0f, 100.0f);
+    _cameraNode = Node::create("ShadowMaps");
+    _cameraNode->setCamera(_camera);
+}
+
+void ShadowMaps::update(Scene* scene, Camera* camera)
+{
+    GP_ASSERT(scene);
+
+    if (!camera)
+        camera = scene->getActiveCamera();
+    if (!camera)
+    {
+        GP_WARN("Failed to update shadow maps; the scene has no active camera.");
+        return;
+    }
+    if (RenderCommandList::getRecording())
+    {
+        GP_WARN("Failed to update shadow maps; they can not be rendered while a RenderCommandList is recording.");
+        return;
+    }
+    createTargets();
+    updateLights(scene, camera);
+
+    // Render the shadow maps with the internal camera as the active camera of the scene, so that
+    // the casters are transformed into the view of each light.
+    Game* game = Game::getInstance();
+    Rectangle viewport = game->getViewport();
+    FrameBuffer* previousFrameBuffer = _frameBuffer->bind();
+    Camera* activeCamera = scene->_activeCamera;
+    scene->_activeCamera = _camera;
+    GL_ASSERT( glEnable(GL_SCISSOR_TEST) );
+    GL_ASSERT( glEnable(GL_POLYGON_OFFSET_FILL) );
+    GL_ASSERT( glPolygonOffset(SHADOW_MAPS_OFFSET_FACTOR, SHADOW_MAPS_OFFSET_UNITS) );
+
+    _staticUpdates = 0;
+    if (_cascadesEnabled)
+    {
+        for (unsigned int i = 0; i < _cascadeCount; ++i)
+            renderView(scene, _cascades[i]);
+    }
+    for (size_t i = 0, count = _lights.size(); i < count; ++i)
+    {
+        ShadowLight& shadowLight = _lights[i];
+        unsigned int viewCount = shadowLight.light->getLightType() == Light::POINT ? 6 : 1;
+        for (unsigned int j = 0; j < viewCount; ++j)
+            renderView(scene, shadowLight.views[j]);
+    }
+
+    GL_ASSERT( glDisable(GL_POLYGON_OFFSET_FILL) );
+    GL_ASSERT( glDisable(GL_SCISSOR_TEST) );
+    GL_ASSERT( glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE) );
+    scene->_activeCamera = activeCamera;
+    previousFrameBuffer->bind();
+    game->setViewport(viewport);
+}
+
+void ShadowMaps::updateLights(Scene* scene, Camera* camera)
+{
+    // Gather the lights that cast shadows: the first directional light, and the point and spot
+    // lights that reach into the view, nearest first.
+    const Frustum& frustum = camera->getFrustum();
+    const Vector3 cameraPosition = camera->getNode() ? camera->getNode()->getTranslationWorld() : Vector3::zero();
+    Node* directionalNode = NULL;
+    _nodes.clear();
+    _candidates.clear();
+    scene->getNodesWithComponent(Scene::LIGHT, _nodes);
+    for (size_t i = 0, count = _nodes.size(); i < count; ++i)
+    {
+        Node* node = _nodes[i];
+        Light* light = node->getLight();
+        if (!light || !light->isShadowsEnabled() || !node->isEnabledInHierarchy())
+            continue;
+
+        if (light->getLightType() == Light::DIRECTIONAL)
+        {
+            if (!directionalNode)
+                directionalNode = node;
+            continue;
+        }
+        BoundingSphere sphere(node->getTranslationWorld(), light->getRange());
+        if (sphere.intersects(frustum))
+            _candidates.push_back(std::make_pair(std::max(sphere.center.distance(cameraPosition) - sphere.radius, 0.0f), node));
+    }
+    std::sort(_candidates.begin(), _candidates.end());
+
+    // Lights that are still candidates keep their tiles, and the tiles of the others are freed.
+    for (size_t i = 0, count = _lights.size(); i < count; ++i)
+    {
+        _lights[i].used = false;
+    }
+    for (size_t i = 0, count = _candidates.size(); i < count; ++i)
+    {
+        Light* light = _candidates[i].second->getLight();
+        for (size_t j = 0, lightCount = _lights.size(); j < lightCount; ++j)
+        {
+            if (_lights[j].light == light)
+            {
+                _lights[j].used = true;
+                _candidates[i].second = NULL;
+                break;
+            }
+        }
+    }
+    for (size_t i = 0; i < _lights.size();)
+    {
+        if (_lights[i].used)
+        {
+            ++i;
+            continue;
+        }
+        releaseLight(_lights[i]);
+        _lights[i] = _lights.back();
+        _lights.pop_back();
+    }
+    for (size_t i = 0, count = _candidates.size(); i < count; ++i)
+    {
+        Node* node = _candidates[i].second;
+        if (node == NULL)
+            continue;
+
+        ShadowLight shadowLight;
+        shadowLight.light = node->getLight();
+        if (allocate(shadowLight))
+        {
+            shadowLight.light->addRef();
+            shadowLight.used = true;
+            _lights.push_back(shadowLight);
+        }
+    }
+
+    for (size_t i = 0, count = _lights.size(); i < count; ++i)
+    {
+        updateLight(_lights[i]);
+    }
+    _cascadesEnabled = directionalNode && _cascadeCount > 0;
+    if (_cascadesEnabled)
+    {
+        updateCascades(directionalNode, camera);
+    }
+    else
+    {
+        for (unsigned int i = 0; i < MAX_CASCADES; ++i)
+            _cascadeSplits[i] = 0.0f;
+    }
+}
+
+void ShadowMaps::updateCascades(Node* lightNode, Camera* camera)
+{
+    const float nearPlane = camera->getNearPlane();
+    const float farPlane = std::max(std::min(_shadowDistance, camera->getFarPlane()), nearPlane * 2.0f);
+    const float cameraFarPlane = camera->getFarPlane();
+
+    // The corners of the near and far planes, in the order LTN, LBN, RBN, RTN, RTF, RBF, LBF, LTF,
+    // so the far corner of near corner i is corner 7 - i.
+    Vector3 corners[8];
+    camera->getFrustum().getCorners(corners);
+
+    Vector3 forward = lightNode->getForwardVectorWorld();
+    forward.normalize();
+    Vector3 up = getUpVector(forward, lightNode->getUpVectorWorld());
+    Matrix lightView;
+    Matrix::createLookAt(Vector3::zero(), forward, up, &lightView);
+    Matrix lightWorld;
+    lightView.transpose(&lightWorld);
+    Quaternion rotation;
+    Quaternion::createFromRotationMatrix(lightWorld, &rotation);
+
+    float sliceStart = nearPlane;
+    for (unsigned int i = 0; i < _cascadeCount; ++i)
+    {
+        // Split the view depth between a logarithmic and an even distribution.
+        float t = (float)(i + 1) / _cascadeCount;
+        float logSplit = nearPlane * powf(farPlane / nearPlane, t);
+        float linearSplit = nearPlane + (farPlane - nearPlane) * t;
+        float sliceEnd = logSplit + (linearSplit - logSplit) * SHADOW_MAPS_CASCADE_LINEAR_SPLIT;
+        _cascadeSplits[i] = sliceEnd;
+
+        // Bound the slice of the view frustum by a sphere, which does not change as the camera
+        // turns. Its radius is rounded up, so that small errors in the corners do not move it.
+        Vector3 sliceCorners[8];
+        Vector3 center;
+        for (unsigned int j = 0; j < 4; ++j)
+        {
+            const Vector3& nearCorner = corners[j];
+            const Vector3& farCorner = corners[7 - j];
+            float startT = (sliceStart - nearPlane) / (cameraFarPlane - nearPlane);
+            float endT = (sliceEnd - nearPlane) / (cameraFarPlane - nearPlane);
+            sliceCorners[j] = nearCorner + (farCorner - nearCorner) * startT;
+            sliceCorners[j + 4] = nearCorner + (farCorner - nearCorner) * endT;
+        }
+        for (unsigned int j = 0; j < 8; ++j)
+            center += sliceCorners[j];
+        center *= 0.125f;
+        float radius = 0.0f;
+        for (unsigned int j = 0; j < 8; ++j)
+            radius = std::max(radius, center.distance(sliceCorners[j]));
+        radius = ceilf(radius * 16.0f) / 16.0f;
+        sliceStart = sliceEnd;
+
+        // The cascade is snapped to steps of a few texels in light space, so it only moves (and
+        // renders its static casters again) when the camera has moved by a step, and the texels
+        // of its shadow map stay in place while it does not. It is made larger by a step so that
+        // it still covers the sphere wherever the sphere is within a step.
+        View& view = _cascades[i];
+        const float snapShare = 2.0f * SHADOW_MAPS_CASCADE_SNAP_TEXELS / view.size;
+        const float halfSize = radius / (1.0f - snapShare);
+        const float step = halfSize * snapShare;
+        Vector3 lightCenter;
+        lightView.transformPoint(center, &lightCenter);
+        lightCenter.x = floorf(lightCenter.x / step + 0.5f) * step;
+        lightCenter.y = floorf(lightCenter.y / step + 0.5f) * step;
+        lightCenter.z = floorf(lightCenter.z / step + 0.5f) * step;
+
+        // The light looks down the negative z axis of its space, so the casters behind the cascade
+        // are at larger z.
+        lightCenter.z += halfSize + _casterDistance;
+        Vector3 eye;
+        lightWorld.transformPoint(lightCenter, &eye);
+        Matrix projection;
+        Matrix::createOrthographicOffCenter(-halfSize, halfSize, -halfSize, halfSize, 0.0f, halfSize * 2.0f + _casterDistance, &projection);
+        setView(view, eye, rotation, projection, view.x, view.y, view.size);
+
+        getTileMatrix(view, &_cascadeMatrices[i]);
+    }
+}
+
+void ShadowMaps::updateLight(ShadowLight& shadowLight)
+{
+    Light* light = shadowLight.light;
+    Node* node = light->getNode();
+    GP_ASSERT(node);
+
+    const Vector3 position = node->getTranslationWorld();
+    const float farPlane = light->getRange();
+    const float nearPlane = farPlane * SHADOW_MAPS_NEAR_PLANE_SCALE;
+    const unsigned int x = shadowLight.tileX * _tileSize;
+    const unsigned int y = shadowLight.tileY * _tileSize;
+    Matrix projection;
+    Quaternion rotation;
+    if (light->getLightType() == Light::SPOT)
+    {
+        // The shadow map covers the outer cone of the light, with a small margin.
+        Vector3 forward = node->getForwardVectorWorld();
+        forward.normalize();
+        float fieldOfView = std::min(MATH_RAD_TO_DEG(light->getOuterAngle()) * 2.0f + 2.0f, 170.0f);
+        Matrix::createPerspective(fieldOfView, 1.0f, nearPlane, farPlane, &projection);
+        getLookRotation(forward, getUpVector(forward, node->getUpVectorWorld()), &rotation);
+        View& view = shadowLight.views[0];
+        setView(view, position, rotation, projection, x, y, _tileSize);
+        getTileMatrix(view, &light->_shadowMatrix);
+    }
+    else
+    {
+        // The faces look along +X, -X, +Y, -Y, +Z and -Z, in a block of 3x2 tiles. The shaders pick
+        // the face of a point by the axis of its largest coordinate relative to the light, and must
+        // use the same rotations.
+        static const Vector3 forwards[] = { Vector3::unitX(), -Vector3::unitX(), Vector3::unitY(), -Vector3::unitY(), Vector3::unitZ(), -Vector3::unitZ() };
+        static const Vector3 ups[] = { Vector3::unitY(), Vector3::unitY(), Vector3::unitZ(), Vector3::unitZ(), Vector3::unitY(), Vector3::unitY() };
+        Matrix::createPerspective(90.0f, 1.0f, nearPlane, farPlane, &projection);
+        for (unsigned int face = 0; face < 6; ++face)
+        {
+            getLookRotation(forwards[face], ups[face], &rotation);
+            setView(shadowLight.views[face], position, rotation, projection, x + (face % 3) * _tileSize, y + (face / 3) * _tileSize, _tileSize);
+        }
+
+        // The position of the light and the size of a face in the atlas, followed by the position
+        // of the block of faces and the terms that turn the distance along the axis of a face into depth.
+        const float faceSize = (float)_tileSize / _size;
+        light->_shadowCube[0].set(position.x, position.y, position.z, faceSize);
+        light->_shadowCube[1].set((float)x / _size, (float)y / _size,
+            0.5f * (farPlane + nearPlane) / (farPlane - nearPlane) + 0.5f, farPlane * nearPlane / (farPlane - nearPlane));
+    }
+    light->_shadowMapped = true;
+}
+
+bool ShadowMaps::allocate(ShadowLight& shadowLight)
+{
+    shadowLight.tileWidth = shadowLight.light->getLightType() == Light::POINT ? 3 : 1;
+    shadowLight.tileHeight = shadowLight.light->getLightType() == Light::POINT ? 2 : 1;
+    if (shadowLight.tileWidth > _gridSize || shadowLight.tileHeight > _gridSize)
+        return false;
+
+    // Take the first block of free tiles, row by row.
+    for (unsigned int y = 0; y <= _gridSize - shadowLight.tileHeight; ++y)
+    {
+        for (unsigned int x = 0; x <= _gridSize - shadowLight.tileWidth; ++x)
+        {
+            bool free = true;
+            for (unsigned int j = 0; j < shadowLight.tileHeight && free; ++j)
+            {
+                for (unsigned int i = 0; i < shadowLight.tileWidth && free; ++i)
+                    free = !_tiles[(y + j) * _gridSize + x + i];
+            }
+            if (!free)
+                continue;
+
+            shadowLight.tileX = x;
+            shadowLight.tileY = y;
+            setTiles(shadowLight, true);
+            for (unsigned int i = 0; i < 6; ++i)
+            {
+                View& view = shadowLight.views[i];
+                view.staticHash = 0;
+                view.staticValid = false;
+                view.dynamicDrawn = true;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void ShadowMaps::setTiles(const ShadowLight& shadowLight, bool used)
+{
+    for (unsigned int y = shadowLight.tileY; y < shadowLight.tileY + shadowLight.tileHeight; ++y)
+    {
+        for (unsigned int x = shadowLight.tileX; x < shadowLight.tileX + shadowLight.tileWidth; ++x)
+            _tiles[y * _gridSize + x] = used;
+    }
+}
+
+void ShadowMaps::releaseLight(ShadowLight& shadowLight)
+{
+    setTiles(shadowLight, false);
+    shadowLight.light->_shadowMapped = false;
+    SAFE_RELEASE(shadowLight.light);
+}
+
+void ShadowMaps::setView(View& view, const Vector3& eye, const Quaternion& rotation, const Matrix& projection,
+                         unsigned int x, unsigned int y, unsigned int size)
+{
+    // The static depths are kept while the shadow map does not move.
+    if (view.eye != eye || memcmp(&view.rotation, &rotation, sizeof(Quaternion)) != 0 ||
+        memcmp(view.projection.m, projection.m, sizeof(projection.m)) != 0)
+    {
+        view.staticValid = false;
+    }
+    view.eye = eye;
+    view.rotation = rotation;
+    view.projection = projection;
+    view.x = x;
+    view.y = y;
+    view.size = size;
+}
+
+void ShadowMaps::renderView(Scene* scene, View& view)
+{
+    _cameraNode->set(Vector3::one(), view.rotation, view.eye);
+    _camera->setProjectionMatrix(view.projection);
+
+    // Split the casters in the view of the shadow map into static and dynamic casters.
+    _nodes.clear();
+    _staticCasters.clear();
+    _dynamicCasters.clear();
+    scene->queryVisible(_camera->getFrustum(), _nodes);
+    unsigned int staticHash = 2166136261u;
+    for (size_t i = 0, count = _nodes.size(); i < count; ++i)
+    {
+        Node* node = _nodes[i];
+        if (!dynamic_cast<Model*>(node->getDrawable()) || !node->isEnabledInHierarchy())
+            continue;
+
+        const char* tag = node->getTag("shadow");
+        if (tag && strcmp(tag, "none") == 0)
+            continue;
+        if ((tag && strcmp(tag, "static") == 0) || node->isStatic())
+        {
+            _staticCasters.push_back(node);
+            staticHash = hashCaster(staticHash, node);
+        }
+        else
+        {
+            _dynamicCasters.push_back(node);
+        }
+    }
+
+    Game* game = Game::getInstance();
+    game->setViewport(Rectangle((float)view.x, (float)view.y, (float)view.size, (float)view.size));
+    GL_ASSERT( glScissor(view.x, view.y, view.size, view.size) );
+
+    // The static depths are kept in the red and green channels, and the dynamic depths in the
+    // blue and alpha channels. The depth buffer is shared, so it is cleared for each of them.
+    if (!view.staticValid || view.staticHash != staticHash)
+    {
+        GL_ASSERT( glColorMask(GL_TRUE, GL_TRUE, GL_FALSE, GL_FALSE) );
+        game->clear(Game::CLEAR_COLOR_DEPTH, Vector4::one(), 1.0f, 0);
+        drawCasters(_staticCasters);
+        view.staticHash = staticHash;
+        view.staticValid = true;
+        ++_staticUpdates;
+    }
+    if (!_dynamicCasters.empty() || view.dynamicDrawn)
+    {
+        GL_ASSERT( glColorMask(GL_FALSE, GL_FALSE, GL_TRUE, GL_TRUE) );
+        game->clear(Game::CLEAR_COLOR_DEPTH, Vector4::one(), 1.0f, 0);
+        drawCasters(_dynamicCasters);
+        view.dynamicDrawn = !_dynamicCasters.empty();
+    }
+}
+
+void ShadowMaps::drawCasters(const std::vector<Node*>& nodes)
+{
+    for (size_t i = 0, count = nodes.size(); i < count; ++i)
+    {
+        Model* model = static_cast<Model*>(nodes[i]->getDrawable());
+        Mesh* mesh = model->getMesh();
+        GP_ASSERT(mesh);
+
+        unsigned int partCount = mesh->getPartCount();
+        for (unsigned int j = 0, n = (partCount == 0 ? 1 : partCount); j < n; ++j)
+        {
+            int partIndex = partCount == 0 ? -1 : (int)j;
+            Material* material = model->getDrawMaterial(partIndex);
+            if (material == NULL)
+                continue;
+
+            Technique* technique = material->getTechnique();
+            GP_ASSERT(technique);
+            Pass* pass = technique->getPassCount() > 0 ? technique->getPassByIndex(0)->getShadowPass() : NULL;
+            if (pass)
+                model->drawPart(partIndex, pass, false);
+        }
+    }
+}
+
+void ShadowMaps::getTileMatrix(const View& view, Matrix* dst) const
+{
+    GP_ASSERT(dst);
+
+    // Map the clip space of the view to its square of the atlas, and its depth to [0, 1].
+    const float scale = 0.5f * view.size / _size;
+    const float offsetX = (float)view.x / _size + scale;
+    const float offsetY = (float)view.y / _size + scale;
+    Matrix tile(scale, 0.0f, 0.0f, offsetX,
+                0.0f, scale, 0.0f, offsetY,
+                0.0f, 0.0f, 0.5f, 0.5f,
+                0.0f, 0.0f, 0.0f, 1.0f);
+    _cameraNode->set(Vector3::one(), view.rotation, view.eye);
+    _camera->setProjectionMatrix(view.projection);
+    Matrix::multiply(tile, _camera->getViewProjectionMatrix(), dst);
+}
+
+void ShadowMaps::invalidate()
+{
+    for (unsigned int i = 0; i < MAX_CASCADES; ++i)
+    {
+        _cascades[i].staticValid = false;
+    }
+    for (size_t i = 0, count = _lights.size(); i < count; ++i)
+    {
+        for (unsigned int j = 0; j < 6; ++j)
+            _lights[i].views[j].staticValid = false;
+    }
+}
+
+void ShadowMaps::bind(RenderState* renderState)
+{
+    GP_ASSERT(renderState);
+
+    createTargets();
+    renderState->getParameter("u_shadowTexture")->setValue(_sampler);
+    renderState->getParameter("u_shadowParameters")->bindValue(this, &ShadowMaps::getParameters);
+    renderState->getParameter("u_shadowCascadeMatrix")->bindValue(this, &ShadowMaps::getCascadeMatrices, &ShadowMaps::getCascadeCount);
+    renderState->getParameter("u_shadowCascadeSplits")->bindValue(this, &ShadowMaps::getCascadeSplits, &ShadowMaps::getCascadeCount);
+    renderState->setParameterAutoBinding("u_spotLightShadowMatrix", RenderState::SPOT_LIGHT_SHADOW_MATRIX);
+    renderState->setParameterAutoBinding("u_pointLightShadow", RenderState::POINT_LIGHT_SHADOW);
+}
+
+void ShadowMaps::setShadowDistance(float distance)
+{
+    _shadowDistance = distance;
+}
+
+float ShadowMaps::getShadowDistance() const
+{
+    return _shadowDistance;
+}
+
+void ShadowMaps::setCasterDistance(float distance)
+{
+    _casterDistance = distance;
+}
+
+float ShadowMaps::getCasterDistance() const
+{
+    return _casterDistance;
+}
+
+void ShadowMaps::setDepthBias(float bias)
+{
+    _parameters.y = bias;
+}
+
+float ShadowMaps::getDepthBias() const
+{
+    return _parameters.y;
+}
+
+unsigned int ShadowMaps::getShadowedLightCount() const
+{
+    return (unsigned int)_lights.size();
+}
+
+unsigned int ShadowMaps::getStaticUpdateCount() const
+{
+    return _staticUpdates;
+}
+
+unsigned int ShadowMaps::getCascadeCount() const
+{
+    return std::max(_cascadeCount, 1u);
+}
+
+const Matrix* ShadowMaps::getCascadeMatrices() const
+{
+    return _cascadeMatrices;
+}
+
+const float* ShadowMaps::getCascadeSplits() const
+{
+    return _cascadeSplits;
+}
+
+const Vector4& ShadowMaps::getParameters() const
+{
+    return _parameters;
+}
+
+}
@@ -0,0 +1,299 @@
+#ifndef SHADOWMAPS_H_
+#define SHADOWMAPS_H_
+
+#include "Texture.h"
+#include "Matrix.h"
+#include "Vector4.h"
+#include "Quaternion.h"
+
+namespace gameplay
+{
+
+class Scene;
+class Camera;
+class Node;
+class Light;
+class RenderState;
+class FrameBuffer;
+
+/**
+ * Defines the shadow maps of the lights of a scene that cast shadows (see Light::setShadowsEnabled).
+ *
+ * The shadow maps of all the lights are packed into a single atlas texture, which is divided into
+ * square tiles. The first directional light that casts shadows gets cascaded shadow maps, which
+ * split the view of the camera into slices of increasing depth, each covered by a shadow map of
+ * 2x2 tiles. The point and spot lights that are in view get the tiles that are free, one for a
+ * spot light and six for the faces of a point light, in order of their distance to the camera.
+ * Lights keep their tiles while they stay in view, and lights that do not fit have no shadows
+ * until tiles are freed.
+ *
+ * Each texel of the atlas holds two depths: the depth of the static shadow casters, and the depth
+ * of the dynamic casters. The static depths of a shadow map are only rendered again when its light
+ * moves, when a static caster in its view moves, appears or disappears, or, for the cascades, when
+ * the camera has moved far enough for the cascade to follow it. The cascades move in steps of a few
+ * texels, so that the shadows do not shimmer. The dynamic casters are rendered each frame, on
+ * their own. Nodes are static casters if they are tagged "shadow" with a value of "static", or if
+ * their transformation is static (see Node::isStatic), and nodes tagged "shadow" with a value of
+ * "none" do not cast shadows. Only models cast shadows, with the shadow variants of the first pass
+ * of their materials (see Pass::getShadowPass).
+ *
+ * The built-in colored and textured shaders receive shadows with the DIRECTIONAL_LIGHT_SHADOWS
+ * (for the first directional light), SPOT_LIGHT_SHADOWS and POINT_LIGHT_SHADOWS defines. The
+ * uniforms of the shadow maps are set on a material (or a technique or pass) by bind(), which
+ * only needs to be called once:
+ *
+ * @code
+ * Material* material = Material::create("res/shaders/textured.vert", "res/shaders/textured.frag",
+ *     "DIRECTIONAL_LIGHT_COUNT 1;SPOT_LIGHT_COUNT 2;DIRECTIONAL_LIGHT_SHADOWS;SPOT_LIGHT_SHADOWS");
+ * _shadowMaps.bind(material);
+ * ...
+ * // Once per frame, before the scene is drawn.
+ * _shadowMaps.update(_scene);
+ * @endcode
+ *
+ * The shadows of the spot and point lights are bound to the lights that Scene::getNodeLights
+ * selects for each node, with the SPOT_LIGHT_SHADOW_MATRIX and POINT_LIGHT_SHADOW auto bindings,
+ * so the lights of the material should be bound with the matching light auto bindings. Clustered
+ * lighting only receives the shadows of the directional light.
+ *
+ * @script{ignore}
+ */
+class ShadowMaps
+{
+public:
+
+    /**
+     * The maximum number of cascades of the shadow maps of the directional light.
+     */
+    static const unsigned int MAX_CASCADES = 4;
+
+    /**
+     * Constructor.
+     *
+     * @param size The width and height of the atlas texture, in pixels.
+     * @param tileSize The width and height of the tiles of the atlas, in pixels. The shadow maps
+     *      of the spot lights and of the faces of the point lights are a tile each, and the
+     *      cascades are 2x2 tiles each.
+     * @param cascadeCount The number of cascades of the directional light, up to MAX_CASCADES.
+     */
+    ShadowMaps(unsigned int size = 2048, unsigned int tileSize = 256, unsigned int cascadeCount = MAX_CASCADES);
+
+    /**
+     * Destructor.
+     */
+    ~ShadowMaps();
+
+    /**
+     * Renders the shadow maps of the lights of the specified scene, for a camera.
+     *
+     * The shadow maps are rendered immediately, so this should not be called while a
+     * RenderCommandList is recording. The frame buffer and viewport are restored afterwards.
+     *
+     * @param scene The scene to render the shadows of.
+     * @param camera The camera that the scene is drawn from, or NULL to use the active camera
+     *      of the scene.
+     */
+    void update(Scene* scene, Camera* camera = NULL);
+
+    /**
+     * Sets the uniforms of the shadow maps on a render state.
+     *
+     * The uniform values that change each frame are bound to this object, so the render
+     * state does not need to be bound again after each update.
+     *
+     * @param renderState The material, technique or pass to set the uniforms on.
+     */
+    void bind(RenderState* renderState);
+
+    /**
+     * Makes the next update render the static depths of every shadow map again.
+     *
+     * This should be called when static casters change in a way that does not change their
+     * bounds, such as when their material or mesh is replaced.
+     */
+    void invalidate();
+
+    /**
+     * Sets the distance from the camera up to which the cascades of the directional light are drawn.
+     *
+     * @param distance The distance, which is clamped to the far plane of the camera. The default is 100.
+     */
+    void setShadowDistance(float distance);
+
+    /**
+     * Returns the distance from the camera up to which the cascades of the directional light are drawn.
+     *
+     * @return The shadow distance.
+     */
+    float getShadowDistance() const;
+
+    /**
+     * Sets how far behind a cascade, towards the directional light, casters are rendered into it.
+     *
+     * @param distance The distance. The default is 100.
+     */
+    void setCasterDistance(float distance);
+
+    /**
+     * Returns how far behind a cascade, towards the directional light, casters are rendered into it.
+     *
+     * @return The caster distance.
+     */
+    float getCasterDistance() const;
+
+    /**
+     * Sets the bias that is subtracted from the depth of points before they are compared to the
+     * shadow maps, in the [0, 1] range of the depths of the shadow maps.
+     *
+     * The casters are also rendered with a polygon offset that scales with their slope, so the
+     * bias only needs to cover the precision of the shadow maps. The default is 0.0005.
+     *
+     * @param bias The depth bias.
+     */
+    void setDepthBias(float bias);
+
+    /**
+     * Returns the bias that is subtracted from the depth of points before they are compared to the
+     * shadow maps.
+     *
+     * @return The depth bias.
+     */
+    float getDepthBias() const;
+
+    /**
+     * Returns the number of point and spot lights that had shadow maps in the last update.
+     *
+     * @return The number of lights.
+     */
+    unsigned int getShadowedLightCount() const;
+
+    /**
+     * Returns the number of shadow maps whose static depths were rendered by the last update.
+     *
+     * @return The number of static updates.
+     */
+    unsigned int getStaticUpdateCount() const;
+
+    /**
+     * Returns the number of cascades of the directional light.
+     *
+     * @return The number of cascades.
+     */
+    unsigned int getCascadeCount() const;
+
+    /**
+     * Returns the matrices that transform world positions into the cascades of the atlas
+     * (u_shadowCascadeMatrix), one for each cascade.
+     *
+     * @return The cascade matrices.
+     */
+    const Matrix* getCascadeMatrices() const;
+
+    /**
+     * Returns the view depths that each cascade ends at (u_shadowCascadeSplits), one for each
+     * cascade. They are zero when there is no directional light with shadows.
+     *
+     * @return The cascade splits.
+     */
+    const float* getCascadeSplits() const;
+
+    /**
+     * Returns the size of a texel of the atlas, the depth bias and the size of the atlas in
+     * texels (u_shadowParameters).
+     *
+     * @return The shadow parameters.
+     */
+    const Vector4& getParameters() const;
+
+private:
+
+    /**
+     * A shadow map, rendered from a camera position, rotation and projection into a square
+     * of the atlas.
+     */
+    struct View
+    {
+        Vector3 eye;
+        Quaternion rotation;
+        Matrix projection;
+        unsigned int x;
+        unsigned int y;
+        unsigned int size;
+        unsigned int staticHash;
+        bool staticValid;
+        bool dynamicDrawn;
+    };
+
+    /**
+     * The tiles and the shadow maps of a point or spot light.
+     */
+    struct ShadowLight
+    {
+        Light* light;
+        unsigned int tileX;
+        unsigned int tileY;
+        unsigned int tileWidth;
+        unsigned int tileHeight;
+        bool used;
+        View views[6];
+    };
+
+    /**
+     * Hidden copy constructor.
+     */
+    ShadowMaps(const ShadowMaps& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    ShadowMaps& operator=(const ShadowMaps&);
+
+    void createTargets();
+
+    void updateLights(Scene* scene, Camera* camera);
+
+    void updateCascades(Node* lightNode, Camera* camera);
+
+    void updateLight(ShadowLight& shadowLight);
+
+    bool allocate(ShadowLight& shadowLight);
+
+    void setTiles(const ShadowLight& shadowLight, bool used);
+
+    void releaseLight(ShadowLight& shadowLight);
+
+    void setView(View& view, const Vector3& eye, const Quaternion& rotation, const Matrix& projection, unsigned int x, unsigned int y, unsigned int size);
+
+    void renderView(Scene* scene, View& view);
+
+    void drawCasters(const std::vector<Node*>& nodes);
+
+    void getTileMatrix(const View& view, Matrix* dst) const;
+
+    unsigned int _size;
+    unsigned int _tileSize;
+    unsigned int _gridSize;
+    unsigned int _cascadeCount;
+    float _shadowDistance;
+    float _casterDistance;
+    unsigned int _staticUpdates;
+    bool _cascadesEnabled;
+    Vector4 _parameters;
+    View _cascades[MAX_CASCADES];
+    Matrix _cascadeMatrices[MAX_CASCADES];
+    float _cascadeSplits[MAX_CASCADES];
+    std::vector<ShadowLight> _lights;
+    std::vector<bool> _tiles;
+    std::vector<Node*> _nodes;
+    std::vector<Node*> _staticCasters;
+    std::vector<Node*> _dynamicCasters;
+    std::vector<std::pair<float, Node*> > _candidates;
+    FrameBuffer* _frameBuffer;
+    Texture::Sampler* _sampler;
+    Camera* _camera;
+    Node* _cameraNode;
+};
+
+}
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef SIMDMATH_H_
+#define SIMDMATH_H_
+
+// Thin wrappers over the SSE2 and NEON intrinsics used by the batch math code, so that
+// the same four-wide code can be written once for both instruction sets. GP_USE_SIMD is
+// defined when one of them is available; code using these functions must also provide
+// a scalar path for when it is not.
+//
+// This header does not depend on Base.h so that it can be used by Curve.cpp.
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+    #define GP_USE_SIMD_NEON
+    #define GP_USE_SIMD
+    #include <arm_neon.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define GP_USE_SIMD_SSE
+    #define GP_USE_SIMD
+    #include <emmintrin.h>
+#endif
+
+namespace gameplay
+{
+
+#if defined(GP_USE_SIMD_NEON)
+
+typedef float32x4_t Float4;
+typedef uint32x4_t Mask4;
+
+inline Float4 load4(const float* v) { return vld1q_f32(v); }
+inline void store4(float* dst, Float4 v) { vst1q_f32(dst, v); }
+inline Float4 loadAligned4(const float* v) { return vld1q_f32(v); }
+inline void storeAligned4(float* dst, Float4 v) { vst1q_f32(dst, v); }
+inline Float4 splat4(float v) { return vdupq_n_f32(v); }
+inline Float4 add4(Float4 a, Float4 b) { return vaddq_f32(a, b); }
+inline Float4 sub4(Float4 a, Float4 b) { return vsubq_f32(a, b); }
+inline Float4 mul4(Float4 a, Float4 b) { return vmulq_f32(a, b); }
+inline Float4 abs4(Float4 v) { return vabsq_f32(v); }
+
+inline Float4 rsqrt4(Float4 v)
+{
+    // ARMv7 NEON has no square root, so refine the estimate with two Newton-Raphson steps.
+    Float4 r = vrsqrteq_f32(v);
+    r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(v, r), r));
+    return vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(v, r), r));
+}
+inline Mask4 allTrue4() { return vdupq_n_u32(0xFFFFFFFF); }
+inline Mask4 and4(Mask4 a, Mask4 b) { return vandq_u32(a, b); }
+inline Mask4 greaterEqual4(Float4 a, Float4 b) { return vcgeq_f32(a, b); }
+
+// Loads four consecutive three element vectors, with their x, y and z coordinates into separate registers.
+inline void load3x4(const float* v, Float4* x, Float4* y, Float4* z)
+{
+    float32x4x3_t p = vld3q_f32(v);
+    *x = p.val[0];
+    *y = p.val[1];
+    *z = p.val[2];
+}
+
+// Stores four consecutive three element vectors from separate registers of x, y and z coordinates.
+inline void store3x4(float* dst, Float4 x, Float4 y, Float4 z)
+{
+    float32x4x3_t p;
+    p.val[0] = x;
+    p.val[1] = y;
+    p.val[2] = z;
+    vst3q_f32(dst, p);
+}
+
+inline void storeMask4(Mask4 m, unsigned char* dst)
+{
+    uint32_t v[4];
+    vst1q_u32(v, m);
+    for (unsigned int i = 0; i < 4; ++i)
+        dst[i] = v[i] ? 1 : 0;
+}
+
+// Stores four floats as unsigned integers that sort in the same order as the floats (see RadixSort).
+inline void storeSortKey4(unsigned int* dst, Float4 v)
+{
+    uint32x4_t bits = vreinterpretq_u32_f32(v);
+    uint32x4_t mask = vreinterpretq_u32_s32(vshrq_n_s32(vreinterpretq_s32_f32(v), 31));
+    vst1q_u32(dst, veorq_u32(bits, vorrq_u32(mask, vdupq_n_u32(0x80000000))));
+}
+
+#elif defined(GP_USE_SIMD_SSE)
+
+typedef __m128 Float4;
+typedef __m128 Mask4;
+
+inline Float4 load4(const float* v) { return _mm_loadu_ps(v); }
+inline void store4(float* dst, Float4 v) { _mm_storeu_ps(dst, v); }
+inline Float4 loadAligned4(const float* v) { return _mm_load_ps(v); }
+inline void storeAligned4(float* dst, Float4 v) { _mm_store_ps(dst, v); }
+inline Float4 splat4(float v) { return _mm_set1_ps(v); }
+inline Float4 add4(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+inline Float4 sub4(Float4 a, Float4 b) { return _mm_sub_ps(a, b); }
+inline Float4 mul4(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+inline Float4 abs4(Float4 v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+inline Float4 rsqrt4(Float4 v) { return _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(v)); }
+inline Mask4 allTrue4() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+inline Mask4 and4(Mask4 a, Mask4 b) { return _mm_and_ps(a, b); }
+inline Mask4 greaterEqual4(Float4 a, Float4 b) { return _mm_cmpge_ps(a, b); }
+
+// Loads four consecutive three element vectors, with their x, y and z coordinates into separate registers.
+inline void load3x4(const float* v, Float4* x, Float4* y, Float4* z)
+{
+    __m128 a = _mm_loadu_ps(v);     // x0 y0 z0 x1
+    __m128 b = _mm_loadu_ps(v + 4); // y1 z1 x2 y2
+    __m128 c = _mm_loadu_ps(v + 8); // z2 x3 y3 z3
+    *x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+    *y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+    *z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), c, _MM_SHUFFLE(3, 0, 2, 0));
+}
+
+// Stores four consecutive three element vectors from separate registers of x, y and z coordinates.
+inline void store3x4(float* dst, Float4 x, Float4 y, Float4 z)
+{
+    __m128 a = _mm_shuffle_ps(_mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 b = _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 c = _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)), _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+    _mm_storeu_ps(dst, a);
+    _mm_storeu_ps(dst + 4, b);
+    _mm_storeu_ps(dst + 8, c);
+}
+
+inline void storeMask4(Mask4 m, unsigned char* dst)
+{
+    int bits = _mm_movemask_ps(m);
+    for (unsigned int i = 0; i < 4; ++i)
+        dst[i] = (unsigned char)((bits >> i) & 1);
+}
+
+// Stores four floats as unsigned integers that sort in the same order as the floats (see RadixSort).
+inline void storeSortKey4(unsigned int* dst, Float4 v)
+{
+    __m128i bits = _mm_castps_si128(v);
+    __m128i mask = _mm_srai_epi32(bits, 31);
+    _mm_storeu_si128((__m128i*)dst, _mm_xor_si128(bits, _mm_or_si128(mask, _mm_set1_epi32((int)0x80000000))));
+}
+
+#endif
+
+}
+
+#endif
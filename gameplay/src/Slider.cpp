@@ -67,6 +67,7 @@ const char* Slider::getTypeName() const
 void Slider::setMin(float min)
 {
     _min = min;
+    setDirty(DIRTY_REDRAW);
 }
 
 float Slider::getMin() const
@@ -77,6 +78,7 @@ float Slider::getMin() const
 void Slider::setMax(float max)
 {
     _max = max;
+    setDirty(DIRTY_REDRAW);
 }
 
 float Slider::getMax() const
@@ -116,6 +118,7 @@ void Slider::setValue(float value)
         sprintf(s, "%.*f", _valueTextPrecision, _value);
         _valueText = s;
     }
+    setDirty(DIRTY_REDRAW);
 }
 
 void Slider::setValueTextVisible(bool valueTextVisible)
@@ -136,6 +139,7 @@ bool Slider::isValueTextVisible() const
 void Slider::setValueTextAlignment(Font::Justify alignment)
 {
     _valueTextAlignment = alignment;
+    setDirty(DIRTY_REDRAW);
 }
 
 Font::Justify Slider::getValueTextAlignment() const
@@ -146,6 +150,7 @@ Font::Justify Slider::getValueTextAlignment() const
 void Slider::setValueTextPrecision(unsigned int precision)
 {
     _valueTextPrecision = precision;
+    setDirty(DIRTY_REDRAW);
 }
 
 unsigned int Slider::getValueTextPrecision() const
@@ -482,7 +487,7 @@ unsigned int Slider::drawText(Form* form, const Rectangle& clip)
 
         SpriteBatch* batch = _font->getSpriteBatch(fontSize);
         startBatch(form, batch);
-        _font->drawText(_valueText.c_str(), _textBounds, _textColor, fontSize, _valueTextAlignment, true, getTextRightToLeft(state), _viewportClipBounds);
+        _font->drawText(&_valueTextLayout, _valueText.c_str(), _textBounds, _textColor, fontSize, _valueTextAlignment, true, getTextRightToLeft(state), _viewportClipBounds);
         finishBatch(form, batch);
 
         ++drawCalls;
@@ -0,0 +1,867 @@
+#include "Base.h"
+#include "SpatialIndex.h"
+#include "Node.h"
+#include "Model.h"
+#include "Terrain.h"
+
+// Marks the end of a list of entries or a missing parent/child
+#define NULL_ENTRY -1
+
+// Fraction of a node's bounding radius that its box in the tree is enlarged by
+#define BOX_MARGIN 0.1f
+
+// Bits of QueryItem::planeMask with one bit per frustum plane
+#define ALL_PLANES 0x3F
+
+// Marks an entry that is frozen and waits for the next static tree to be built
+#define STATIC_PENDING -2
+
+namespace gameplay
+{
+
+static float surfaceArea(const BoundingBox& box)
+{
+    float x = box.max.x - box.min.x;
+    float y = box.max.y - box.min.y;
+    float z = box.max.z - box.min.z;
+    return 2.0f * (x * y + y * z + z * x);
+}
+
+static void mergeBoxes(const BoundingBox& a, const BoundingBox& b, BoundingBox* dst)
+{
+    dst->min.set(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z));
+    dst->max.set(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z));
+}
+
+static bool containsBox(const BoundingBox& outer, const BoundingBox& inner)
+{
+    return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+           outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+
+static float boxCenter(const BoundingBox& box, int axis)
+{
+    return axis == 0 ? box.min.x + box.max.x : (axis == 1 ? box.min.y + box.max.y : box.min.z + box.max.z);
+}
+
+static bool isOutside(const BoundingBox& box, const Plane* const* planes, unsigned int* planeMask)
+{
+    // Test only against the planes that the parent box was not entirely in front of.
+    for (unsigned int i = 0; i < 6 && *planeMask; ++i)
+    {
+        if (*planeMask & (1 << i))
+        {
+            float result = box.intersects(*planes[i]);
+            if (result == Plane::INTERSECTS_BACK)
+                return true;
+            if (result == Plane::INTERSECTS_FRONT)
+                *planeMask &= ~(1 << i);
+        }
+    }
+    return false;
+}
+
+static bool hasBounds(Node* node)
+{
+    // Matches the drawables that Node::getBoundingSphere computes bounds for.
+    Drawable* drawable = node->getDrawable();
+    return dynamic_cast<Model*>(drawable) || dynamic_cast<Terrain*>(drawable);
+}
+
+SpatialIndex::SpatialIndex()
+    : _root(NULL_ENTRY), _freeList(NULL_ENTRY), _nodeCount(0), _frozenCount(0)
+{
+}
+
+SpatialIndex::~SpatialIndex()
+{
+    clear();
+}
+
+void SpatialIndex::insert(Node* node)
+{
+    GP_ASSERT(node);
+    GP_ASSERT(node->_spatialIndex == NULL);
+
+    int index = allocateEntry();
+    Entry& entry = _entries[index];
+    entry.node = node;
+    entry.bounded = hasBounds(node);
+    node->_spatialIndex = this;
+    node->_spatialProxy = index;
+    ++_nodeCount;
+
+    if (entry.bounded && node->_frozen)
+    {
+        // Frozen nodes join the next static tree, since their bounds are already resolved.
+        entry.frozen = true;
+        entry.staticTree = STATIC_PENDING;
+        _frozen.push_back(index);
+    }
+    else if (entry.bounded)
+    {
+        // The node is added to the tree on the next query, once its transform has been set up.
+        entry.dirty = true;
+        _dirty.push_back(index);
+    }
+    else
+    {
+        _unbounded.push_back(node);
+    }
+}
+
+void SpatialIndex::remove(Node* node)
+{
+    GP_ASSERT(node);
+    if (node->_spatialIndex != this)
+        return;
+
+    int index = node->_spatialProxy;
+    GP_ASSERT(index >= 0 && index < (int)_entries.size() && _entries[index].node == node);
+
+    if (_entries[index].inTree)
+    {
+        removeLeaf(index);
+    }
+    if (_entries[index].frozen)
+    {
+        removeStatic(index);
+    }
+    if (!_entries[index].bounded)
+    {
+        std::vector<Node*>::iterator itr = std::find(_unbounded.begin(), _unbounded.end(), node);
+        GP_ASSERT(itr != _unbounded.end());
+        *itr = _unbounded.back();
+        _unbounded.pop_back();
+    }
+    freeEntry(index);
+
+    node->_spatialIndex = NULL;
+    node->_spatialProxy = NULL_ENTRY;
+    --_nodeCount;
+}
+
+void SpatialIndex::update(Node* node)
+{
+    GP_ASSERT(node && node->_spatialIndex == this);
+
+    Entry& entry = _entries[node->_spatialProxy];
+    if (entry.bounded && !entry.dirty && !entry.frozen)
+    {
+        entry.dirty = true;
+        _dirty.push_back(node->_spatialProxy);
+    }
+}
+
+void SpatialIndex::freeze(Node* node)
+{
+    GP_ASSERT(node && node->_spatialIndex == this);
+
+    int index = node->_spatialProxy;
+    Entry& entry = _entries[index];
+    if (!entry.bounded || entry.frozen)
+        return;
+
+    if (entry.inTree)
+        removeLeaf(index);
+    entry.dirty = false;
+    entry.frozen = true;
+    entry.staticTree = STATIC_PENDING;
+    _frozen.push_back(index);
+}
+
+void SpatialIndex::thaw(Node* node)
+{
+    GP_ASSERT(node && node->_spatialIndex == this);
+
+    int index = node->_spatialProxy;
+    Entry& entry = _entries[index];
+    if (!entry.frozen)
+        return;
+
+    removeStatic(index);
+    entry.frozen = false;
+    entry.dirty = true;
+    _dirty.push_back(index);
+}
+
+void SpatialIndex::removeStatic(int index)
+{
+    Entry& entry = _entries[index];
+    if (entry.staticTree >= 0)
+    {
+        // The static tree is never modified, so the leaf of the node is only emptied.
+        StaticTree& tree = _staticTrees[entry.staticTree];
+        tree.entries[entry.staticLeaf].node = NULL;
+        --_frozenCount;
+        if (--tree.nodeCount == 0)
+            std::vector<StaticEntry>().swap(tree.entries);
+    }
+    entry.staticTree = NULL_ENTRY;
+    entry.staticLeaf = NULL_ENTRY;
+}
+
+void SpatialIndex::clear()
+{
+    for (size_t i = 0, count = _entries.size(); i < count; ++i)
+    {
+        Entry& entry = _entries[i];
+        if (entry.node)
+        {
+            entry.node->_spatialIndex = NULL;
+            entry.node->_spatialProxy = NULL_ENTRY;
+        }
+    }
+    _entries.clear();
+    _dirty.clear();
+    _unbounded.clear();
+    _frozen.clear();
+    _staticTrees.clear();
+    _root = NULL_ENTRY;
+    _freeList = NULL_ENTRY;
+    _nodeCount = 0;
+    _frozenCount = 0;
+}
+
+unsigned int SpatialIndex::query(const Frustum& frustum, std::vector<Node*>& nodes)
+{
+    refit();
+
+    size_t start = nodes.size();
+    if (_root != NULL_ENTRY)
+    {
+        const Plane* planes[6] = { &frustum.getNear(), &frustum.getFar(), &frustum.getLeft(),
+                                   &frustum.getRight(), &frustum.getBottom(), &frustum.getTop() };
+
+        QueryItem item;
+        item.entry = _root;
+        item.planeMask = ALL_PLANES;
+        _stack.push_back(item);
+        while (!_stack.empty())
+        {
+            item = _stack.back();
+            _stack.pop_back();
+            const Entry& entry = _entries[item.entry];
+            if (isOutside(entry.box, planes, &item.planeMask))
+                continue;
+
+            if (entry.child1 == NULL_ENTRY)
+            {
+                if (entry.node->isEnabledInHierarchy())
+                    nodes.push_back(entry.node);
+            }
+            else
+            {
+                QueryItem child;
+                child.planeMask = item.planeMask;
+                child.entry = entry.child1;
+                _stack.push_back(child);
+                child.entry = entry.child2;
+                _stack.push_back(child);
+            }
+        }
+    }
+
+    for (size_t t = 0, treeCount = _staticTrees.size(); t < treeCount; ++t)
+    {
+        const std::vector<StaticEntry>& entries = _staticTrees[t].entries;
+        if (entries.empty())
+            continue;
+
+        const Plane* planes[6] = { &frustum.getNear(), &frustum.getFar(), &frustum.getLeft(),
+                                   &frustum.getRight(), &frustum.getBottom(), &frustum.getTop() };
+
+        QueryItem item;
+        item.entry = 0;
+        item.planeMask = ALL_PLANES;
+        _stack.push_back(item);
+        while (!_stack.empty())
+        {
+            item = _stack.back();
+            _stack.pop_back();
+            const StaticEntry& entry = entries[item.entry];
+            if (isOutside(entry.box, planes, &item.planeMask))
+                continue;
+
+            if (entry.child2 == NULL_ENTRY)
+            {
+                if (entry.node && entry.node->isEnabledInHierarchy())
+                    nodes.push_back(entry.node);
+            }
+            else
+            {
+                QueryItem child;
+                child.planeMask = item.planeMask;
+                child.entry = item.entry + 1;
+                _stack.push_back(child);
+                child.entry = entry.child2;
+                _stack.push_back(child);
+            }
+        }
+    }
+
+    for (size_t i = 0, count = _unbounded.size(); i < count; ++i)
+    {
+        if (_unbounded[i]->isEnabledInHierarchy())
+            nodes.push_back(_unbounded[i]);
+    }
+
+    return (unsigned int)(nodes.size() - start);
+}
+
+unsigned int SpatialIndex::query(const BoundingSphere& sphere, std::vector<Node*>& nodes)
+{
+    refit();
+
+    size_t start = nodes.size();
+    if (_root != NULL_ENTRY)
+    {
+        QueryItem item;
+        item.entry = _root;
+        item.planeMask = 0;
+        _stack.push_back(item);
+        while (!_stack.empty())
+        {
+            item = _stack.back();
+            _stack.pop_back();
+            const Entry& entry = _entries[item.entry];
+            if (!entry.box.intersects(sphere))
+                continue;
+
+            if (entry.child1 == NULL_ENTRY)
+            {
+                nodes.push_back(entry.node);
+            }
+            else
+            {
+                item.entry = entry.child1;
+                _stack.push_back(item);
+                item.entry = entry.child2;
+                _stack.push_back(item);
+            }
+        }
+    }
+
+    for (size_t t = 0, treeCount = _staticTrees.size(); t < treeCount; ++t)
+    {
+        const std::vector<StaticEntry>& entries = _staticTrees[t].entries;
+        if (entries.empty())
+            continue;
+
+        QueryItem item;
+        item.entry = 0;
+        item.planeMask = 0;
+        _stack.push_back(item);
+        while (!_stack.empty())
+        {
+            item = _stack.back();
+            _stack.pop_back();
+            const StaticEntry& entry = entries[item.entry];
+            if (!entry.box.intersects(sphere))
+                continue;
+
+            if (entry.child2 == NULL_ENTRY)
+            {
+                if (entry.node)
+                    nodes.push_back(entry.node);
+            }
+            else
+            {
+                int child2 = entry.child2;
+                item.entry = item.entry + 1;
+                _stack.push_back(item);
+                item.entry = child2;
+                _stack.push_back(item);
+            }
+        }
+    }
+
+    nodes.insert(nodes.end(), _unbounded.begin(), _unbounded.end());
+
+    return (unsigned int)(nodes.size() - start);
+}
+
+unsigned int SpatialIndex::query(const Ray& ray, float maxDistance, std::vector<Node*>& nodes)
+{
+    refit();
+
+    size_t start = nodes.size();
+    if (_root != NULL_ENTRY)
+    {
+        QueryItem item;
+        item.entry = _root;
+        item.planeMask = 0;
+        _stack.push_back(item);
+        while (!_stack.empty())
+        {
+            item = _stack.back();
+            _stack.pop_back();
+            const Entry& entry = _entries[item.entry];
+            float distance = ray.intersects(entry.box);
+            if (distance == Ray::INTERSECTS_NONE || distance > maxDistance)
+                continue;
+
+            if (entry.child1 == NULL_ENTRY)
+            {
+                nodes.push_back(entry.node);
+            }
+            else
+            {
+                item.entry = entry.child1;
+                _stack.push_back(item);
+                item.entry = entry.child2;
+                _stack.push_back(item);
+            }
+        }
+    }
+
+    for (size_t t = 0, treeCount = _staticTrees.size(); t < treeCount; ++t)
+    {
+        const std::vector<StaticEntry>& entries = _staticTrees[t].entries;
+        if (entries.empty())
+            continue;
+
+        QueryItem item;
+        item.entry = 0;
+        item.planeMask = 0;
+        _stack.push_back(item);
+        while (!_stack.empty())
+        {
+            item = _stack.back();
+            _stack.pop_back();
+            const StaticEntry& entry = entries[item.entry];
+            float distance = ray.intersects(entry.box);
+            if (distance == Ray::INTERSECTS_NONE || distance > maxDistance)
+                continue;
+
+            if (entry.child2 == NULL_ENTRY)
+            {
+                if (entry.node)
+                    nodes.push_back(entry.node);
+            }
+            else
+            {
+                int child2 = entry.child2;
+                item.entry = item.entry + 1;
+                _stack.push_back(item);
+                item.entry = child2;
+                _stack.push_back(item);
+            }
+        }
+    }
+
+    return (unsigned int)(nodes.size() - start);
+}
+
+unsigned int SpatialIndex::getNodeCount() const
+{
+    return _nodeCount;
+}
+
+unsigned int SpatialIndex::getFrozenNodeCount() const
+{
+    return _frozenCount;
+}
+
+unsigned int SpatialIndex::getHeight() const
+{
+    return _root == NULL_ENTRY ? 0 : (unsigned int)_entries[_root].height + 1;
+}
+
+int SpatialIndex::allocateEntry()
+{
+    int index;
+    if (_freeList != NULL_ENTRY)
+    {
+        index = _freeList;
+        _freeList = _entries[index].parent;
+    }
+    else
+    {
+        index = (int)_entries.size();
+        _entries.push_back(Entry());
+    }
+
+    Entry& entry = _entries[index];
+    entry.node = NULL;
+    entry.parent = NULL_ENTRY;
+    entry.child1 = NULL_ENTRY;
+    entry.child2 = NULL_ENTRY;
+    entry.height = 0;
+    entry.bounded = false;
+    entry.inTree = false;
+    entry.dirty = false;
+    entry.frozen = false;
+    entry.staticTree = NULL_ENTRY;
+    entry.staticLeaf = NULL_ENTRY;
+    return index;
+}
+
+void SpatialIndex::freeEntry(int index)
+{
+    Entry& entry = _entries[index];
+    entry.node = NULL;
+    entry.height = -1;
+    entry.inTree = false;
+    entry.dirty = false;
+    entry.frozen = false;
+    entry.staticTree = NULL_ENTRY;
+    entry.staticLeaf = NULL_ENTRY;
+    entry.parent = _freeList;
+    _freeList = index;
+}
+
+void SpatialIndex::refit()
+{
+    for (size_t i = 0, count = _dirty.size(); i < count; ++i)
+    {
+        // Entries that were removed (or removed and reused) are skipped by the dirty flag.
+        int index = _dirty[i];
+        Entry& entry = _entries[index];
+        if (!entry.dirty)
+            continue;
+        entry.dirty = false;
+
+        const BoundingSphere& sphere = entry.node->getBoundingSphere();
+        BoundingBox box;
+        box.set(sphere);
+        if (entry.inTree)
+        {
+            // Small movements stay within the enlarged box and do not change the tree.
+            if (containsBox(entry.box, box))
+                continue;
+            removeLeaf(index);
+        }
+
+        float margin = sphere.radius * BOX_MARGIN;
+        box.min.set(box.min.x - margin, box.min.y - margin, box.min.z - margin);
+        box.max.set(box.max.x + margin, box.max.y + margin, box.max.z + margin);
+        _entries[index].box = box;
+        insertLeaf(index);
+    }
+    _dirty.clear();
+
+    if (!_frozen.empty())
+        buildStaticTree();
+}
+
+void SpatialIndex::buildStaticTree()
+{
+    // Reuse the slot of a static tree whose nodes have all been thawed or removed.
+    int treeIndex = NULL_ENTRY;
+    for (size_t i = 0, count = _staticTrees.size(); i < count && treeIndex == NULL_ENTRY; ++i)
+    {
+        if (_staticTrees[i].entries.empty())
+            treeIndex = (int)i;
+    }
+    if (treeIndex == NULL_ENTRY)
+    {
+        treeIndex = (int)_staticTrees.size();
+        _staticTrees.push_back(StaticTree());
+        _staticTrees.back().nodeCount = 0;
+    }
+
+    // Keep the entries that are still frozen, once each, since entries may be frozen again
+    // after being thawed or reused before the tree is built.
+    size_t count = 0;
+    for (size_t i = 0, pending = _frozen.size(); i < pending; ++i)
+    {
+        int index = _frozen[i];
+        Entry& entry = _entries[index];
+        if (entry.staticTree != STATIC_PENDING)
+            continue;
+        entry.staticTree = treeIndex;
+        entry.box.set(entry.node->getBoundingSphere());
+        _frozen[count++] = index;
+    }
+    _frozen.resize(count);
+
+    if (count > 0)
+    {
+        StaticTree& tree = _staticTrees[treeIndex];
+        tree.entries.reserve(count * 2 - 1);
+        tree.nodeCount = (unsigned int)count;
+        buildStaticEntry(tree, 0, count);
+        _frozenCount += (unsigned int)count;
+    }
+    _frozen.clear();
+}
+
+int SpatialIndex::buildStaticEntry(StaticTree& tree, size_t begin, size_t end)
+{
+    int index = (int)tree.entries.size();
+    tree.entries.push_back(StaticEntry());
+
+    BoundingBox box = _entries[_frozen[begin]].box;
+    BoundingBox centers(box.min + box.max, box.min + box.max);
+    for (size_t i = begin + 1; i < end; ++i)
+    {
+        const BoundingBox& entryBox = _entries[_frozen[i]].box;
+        mergeBoxes(box, entryBox, &box);
+        Vector3 center = entryBox.min + entryBox.max;
+        mergeBoxes(centers, BoundingBox(center, center), &centers);
+    }
+    tree.entries[index].box = box;
+
+    if (end - begin == 1)
+    {
+        Entry& entry = _entries[_frozen[begin]];
+        entry.staticLeaf = index;
+        tree.entries[index].node = entry.node;
+        tree.entries[index].child2 = NULL_ENTRY;
+        return index;
+    }
+
+    // Split the nodes in half along the axis over which their centers spread the most.
+    Vector3 extent = centers.max - centers.min;
+    int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+    size_t middle = (begin + end) / 2;
+    const std::vector<Entry>& entries = _entries;
+    std::nth_element(_frozen.begin() + begin, _frozen.begin() + middle, _frozen.begin() + end,
+        [&entries, axis](int a, int b) { return boxCenter(entries[a].box, axis) < boxCenter(entries[b].box, axis); });
+
+    buildStaticEntry(tree, begin, middle);
+    int child2 = buildStaticEntry(tree, middle, end);
+    tree.entries[index].node = NULL;
+    tree.entries[index].child2 = child2;
+    return index;
+}
+
+void SpatialIndex::insertLeaf(int leaf)
+{
+    _entries[leaf].inTree = true;
+    _entries[leaf].child1 = NULL_ENTRY;
+    _entries[leaf].child2 = NULL_ENTRY;
+    _entries[leaf].height = 0;
+
+    if (_root == NULL_ENTRY)
+    {
+        _root = leaf;
+        _entries[leaf].parent = NULL_ENTRY;
+        return;
+    }
+
+    // Find the best sibling for the new leaf by descending the tree using the surface area heuristic.
+    BoundingBox leafBox = _entries[leaf].box;
+    BoundingBox combined;
+    int index = _root;
+    while (_entries[index].child1 != NULL_ENTRY)
+    {
+        const Entry& entry = _entries[index];
+        mergeBoxes(entry.box, leafBox, &combined);
+        float area = surfaceArea(entry.box);
+        float combinedArea = surfaceArea(combined);
+
+        // Cost of creating a new parent for this entry and the new leaf.
+        float cost = 2.0f * combinedArea;
+
+        // Minimum cost of pushing the leaf further down the tree.
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        float childCost[2];
+        int children[2] = { entry.child1, entry.child2 };
+        for (unsigned int i = 0; i < 2; ++i)
+        {
+            const Entry& child = _entries[children[i]];
+            mergeBoxes(child.box, leafBox, &combined);
+            if (child.child1 == NULL_ENTRY)
+                childCost[i] = surfaceArea(combined) + inheritanceCost;
+            else
+                childCost[i] = surfaceArea(combined) - surfaceArea(child.box) + inheritanceCost;
+        }
+
+        if (cost < childCost[0] && cost < childCost[1])
+            break;
+        index = childCost[0] < childCost[1] ? children[0] : children[1];
+    }
+
+    // Create a new parent for the sibling and the leaf.
+    int sibling = index;
+    int newParent = allocateEntry();
+    int oldParent = _entries[sibling].parent;
+    Entry& parent = _entries[newParent];
+    parent.parent = oldParent;
+    parent.child1 = sibling;
+    parent.child2 = leaf;
+    parent.height = _entries[sibling].height + 1;
+    parent.inTree = true;
+    mergeBoxes(_entries[sibling].box, leafBox, &parent.box);
+
+    if (oldParent != NULL_ENTRY)
+    {
+        if (_entries[oldParent].child1 == sibling)
+            _entries[oldParent].child1 = newParent;
+        else
+            _entries[oldParent].child2 = newParent;
+    }
+    else
+    {
+        _root = newParent;
+    }
+    _entries[sibling].parent = newParent;
+    _entries[leaf].parent = newParent;
+
+    fixUpwards(_entries[leaf].parent);
+}
+
+void SpatialIndex::removeLeaf(int leaf)
+{
+    _entries[leaf].inTree = false;
+
+    if (leaf == _root)
+    {
+        _root = NULL_ENTRY;
+        return;
+    }
+
+    int parent = _entries[leaf].parent;
+    int grandParent = _entries[parent].parent;
+    int sibling = _entries[parent].child1 == leaf ? _entries[parent].child2 : _entries[parent].child1;
+
+    // Replace the parent with the sibling of the leaf.
+    if (grandParent != NULL_ENTRY)
+    {
+        if (_entries[grandParent].child1 == parent)
+            _entries[grandParent].child1 = sibling;
+        else
+            _entries[grandParent].child2 = sibling;
+        _entries[sibling].parent = grandParent;
+        freeEntry(parent);
+        fixUpwards(grandParent);
+    }
+    else
+    {
+        _root = sibling;
+        _entries[sibling].parent = NULL_ENTRY;
+        freeEntry(parent);
+    }
+    _entries[leaf].parent = NULL_ENTRY;
+}
+
+void SpatialIndex::fixUpwards(int index)
+{
+    // Rebalance and refit the boxes of all ancestors.
+    while (index != NULL_ENTRY)
+    {
+        index = balance(index);
+
+        Entry& entry = _entries[index];
+        const Entry& child1 = _entries[entry.child1];
+        const Entry& child2 = _entries[entry.child2];
+        entry.height = 1 + std::max(child1.height, child2.height);
+        mergeBoxes(child1.box, child2.box, &entry.box);
+
+        index = entry.parent;
+    }
+}
+
+int SpatialIndex::balance(int iA)
+{
+    // Performs a left or right rotation if the subtree rooted at iA is imbalanced,
+    // and returns the index of the new root of the subtree.
+    Entry& a = _entries[iA];
+    if (a.child1 == NULL_ENTRY || a.height < 2)
+        return iA;
+
+    int iB = a.child1;
+    int iC = a.child2;
+    Entry& b = _entries[iB];
+    Entry& c = _entries[iC];
+    int difference = c.height - b.height;
+
+    if (difference > 1)
+    {
+        // Rotate C up.
+        int iF = c.child1;
+        int iG = c.child2;
+        Entry& f = _entries[iF];
+        Entry& g = _entries[iG];
+
+        c.child1 = iA;
+        c.parent = a.parent;
+        a.parent = iC;
+        if (c.parent != NULL_ENTRY)
+        {
+            if (_entries[c.parent].child1 == iA)
+                _entries[c.parent].child1 = iC;
+            else
+                _entries[c.parent].child2 = iC;
+        }
+        else
+        {
+            _root = iC;
+        }
+
+        if (f.height > g.height)
+        {
+            c.child2 = iF;
+            a.child2 = iG;
+            g.parent = iA;
+            mergeBoxes(b.box, g.box, &a.box);
+            mergeBoxes(a.box, f.box, &c.box);
+            a.height = 1 + std::max(b.height, g.height);
+            c.height = 1 + std::max(a.height, f.height);
+        }
+        else
+        {
+            c.child2 = iG;
+            a.child2 = iF;
+            f.parent = iA;
+            mergeBoxes(b.box, f.box, &a.box);
+            mergeBoxes(a.box, g.box, &c.box);
+            a.height = 1 + std::max(b.height, f.height);
+            c.height = 1 + std::max(a.height, g.height);
+        }
+        return iC;
+    }
+
+    if (difference < -1)
+    {
+        // Rotate B up.
+        int iD = b.child1;
+        int iE = b.child2;
+        Entry& d = _entries[iD];
+        Entry& e = _entries[iE];
+
+        b.child1 = iA;
+        b.parent = a.parent;
+        a.parent = iB;
+        if (b.parent != NULL_ENTRY)
+        {
+            if (_entries[b.parent].child1 == iA)
+                _entries[b.parent].child1 = iB;
+            else
+                _entries[b.parent].child2 = iB;
+        }
+        else
+        {
+            _root = iB;
+        }
+
+        if (d.height > e.height)
+        {
+            b.child2 = iD;
+            a.child1 = iE;
+            e.parent = iA;
+            mergeBoxes(c.box, e.box, &a.box);
+            mergeBoxes(a.box, d.box, &b.box);
+            a.height = 1 + std::max(c.height, e.height);
+            b.height = 1 + std::max(a.height, d.height);
+        }
+        else
+        {
+            b.child2 = iE;
+            a.child1 = iD;
+            d.parent = iA;
+            mergeBoxes(c.box, d.box, &a.box);
+            mergeBoxes(a.box, e.box, &b.box);
+            a.height = 1 + std::max(c.height, d.height);
+            b.height = 1 + std::max(a.height, e.height);
+        }
+        return iB;
+    }
+
+    return iA;
+}
+
+}
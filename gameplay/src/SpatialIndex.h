@@ -0,0 +1,235 @@
+#ifndef SPATIALINDEX_H_
+#define SPATIALINDEX_H_
+
+#include "BoundingBox.h"
+#include "Frustum.h"
+#include "Ray.h"
+
+namespace gameplay
+{
+
+class Node;
+
+/**
+ * Defines a dynamic bounding volume hierarchy over the world bounds of scene nodes.
+ *
+ * The index is a binary tree of axis-aligned boxes that is kept balanced as nodes
+ * are added, moved and removed. Each node is stored with a slightly enlarged box so
+ * that small movements do not require the tree to be modified. Queries visit only
+ * the branches of the tree that intersect the query volume, and branches that are
+ * fully inside a frustum are accepted without testing their individual nodes.
+ *
+ * Nodes whose drawable does not have meaningful bounds (anything other than models
+ * and terrains) are kept in a separate list and are returned by every query.
+ *
+ * A spatial index is normally owned by a Scene (see Scene::setSpatialIndexEnabled),
+ * which keeps it up to date as nodes are added, removed and transformed. Changes are
+ * recorded when they happen and applied to the tree on the next query.
+ *
+ * Frozen nodes (see Node::freeze) are kept out of the dynamic tree. The nodes that are
+ * frozen between two queries are built into a static tree of their own, which is split
+ * top-down and stored contiguously, and is never rebuilt: nodes that are thawed or removed
+ * only leave an empty leaf behind, and the tree is dropped once all of its leaves are empty.
+ *
+ * @script{ignore}
+ */
+class SpatialIndex
+{
+    friend class Scene;
+    friend class Node;
+
+public:
+
+    /**
+     * Constructor.
+     */
+    SpatialIndex();
+
+    /**
+     * Destructor.
+     */
+    ~SpatialIndex();
+
+    /**
+     * Adds a node to the index.
+     *
+     * @param node The node to add. The node must not already be in a spatial index.
+     */
+    void insert(Node* node);
+
+    /**
+     * Removes a node from the index.
+     *
+     * @param node The node to remove.
+     */
+    void remove(Node* node);
+
+    /**
+     * Notifies the index that the world bounds of the specified node have changed.
+     *
+     * @param node The node whose bounds have changed.
+     */
+    void update(Node* node);
+
+    /**
+     * Removes all nodes from the index.
+     */
+    void clear();
+
+    /**
+     * Finds the enabled nodes whose bounds intersect the specified frustum.
+     *
+     * @param frustum The frustum to test against.
+     * @param nodes The vector that the nodes are appended to.
+     *
+     * @return The number of nodes appended to the vector.
+     */
+    unsigned int query(const Frustum& frustum, std::vector<Node*>& nodes);
+
+    /**
+     * Finds the nodes whose bounds intersect the specified sphere.
+     *
+     * Unlike the frustum query, the nodes are returned whether they are enabled or not,
+     * along with the nodes that have no bounds.
+     *
+     * @param sphere The sphere to test against.
+     * @param nodes The vector that the nodes are appended to.
+     *
+     * @return The number of nodes appended to the vector.
+     */
+    unsigned int query(const BoundingSphere& sphere, std::vector<Node*>& nodes);
+
+    /**
+     * Finds the nodes whose bounds a ray hits within a distance.
+     *
+     * The nodes are returned whether they are enabled or not, but the nodes that have no
+     * bounds are not returned, since a ray cannot hit them.
+     *
+     * @param ray The ray to test against.
+     * @param maxDistance The largest distance along the ray to hit the bounds at.
+     * @param nodes The vector that the nodes are appended to.
+     *
+     * @return The number of nodes appended to the vector.
+     */
+    unsigned int query(const Ray& ray, float maxDistance, std::vector<Node*>& nodes);
+
+    /**
+     * Returns the number of nodes in the index.
+     *
+     * @return The number of nodes in the index.
+     */
+    unsigned int getNodeCount() const;
+
+    /**
+     * Returns the number of frozen nodes in the static trees of the index.
+     *
+     * @return The number of frozen nodes.
+     */
+    unsigned int getFrozenNodeCount() const;
+
+    /**
+     * Returns the height of the tree, which is useful for checking how well balanced it is.
+     *
+     * @return The number of levels in the tree.
+     */
+    unsigned int getHeight() const;
+
+private:
+
+    /**
+     * An entry in the tree. Leaves hold a scene node, branches hold two children.
+     */
+    struct Entry
+    {
+        BoundingBox box;
+        Node* node;
+        int parent;
+        int child1;
+        int child2;
+        int height;
+        bool bounded;
+        bool inTree;
+        bool dirty;
+        bool frozen;
+        int staticTree;
+        int staticLeaf;
+    };
+
+    /**
+     * An entry of a static tree. The first child of a branch follows it, and leaves hold a
+     * scene node, or NULL once the node has been thawed or removed.
+     */
+    struct StaticEntry
+    {
+        BoundingBox box;
+        Node* node;
+        int child2;
+    };
+
+    /**
+     * A static tree of frozen nodes.
+     */
+    struct StaticTree
+    {
+        std::vector<StaticEntry> entries;
+        unsigned int nodeCount;
+    };
+
+    /**
+     * An entry that remains to be visited by a query, with the frustum planes it still has to be tested against.
+     */
+    struct QueryItem
+    {
+        int entry;
+        unsigned int planeMask;
+    };
+
+    /**
+     * Hidden copy constructor.
+     */
+    SpatialIndex(const SpatialIndex& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    SpatialIndex& operator=(const SpatialIndex&);
+
+    int allocateEntry();
+
+    void freeEntry(int index);
+
+    void refit();
+
+    void freeze(Node* node);
+
+    void thaw(Node* node);
+
+    void removeStatic(int index);
+
+    void buildStaticTree();
+
+    int buildStaticEntry(StaticTree& tree, size_t begin, size_t end);
+
+    void insertLeaf(int leaf);
+
+    void removeLeaf(int leaf);
+
+    int balance(int index);
+
+    void fixUpwards(int index);
+
+    std::vector<Entry> _entries;
+    std::vector<int> _dirty;
+    std::vector<Node*> _unbounded;
+    std::vector<QueryItem> _stack;
+    std::vector<int> _frozen;
+    std::vector<StaticTree> _staticTrees;
+    int _root;
+    int _freeList;
+    unsigned int _nodeCount;
+    unsigned int _frozenCount;
+};
+
+}
+
+#endif
@@ -1,6 +1,8 @@
 #include "Base.h"
 #include "Sprite.h"
 #include "Scene.h"
+#include "Game.h"
+#include "FileSystem.h"
 
 namespace gameplay
 {
@@ -15,7 +17,7 @@ Sprite::Sprite() : Drawable(),
 Sprite::~Sprite()
 {
     SAFE_DELETE_ARRAY(_frames);
-    SAFE_DELETE(_batch);
+    SpriteRenderer::releaseBatch(_batch);
 }
 
 Sprite& Sprite::operator=(const Sprite& sprite)
@@ -36,11 +38,10 @@ Sprite* Sprite::create(const char* imagePath, float width, float height,
     GP_ASSERT(source.width >= -1 && source.height >= -1);
     GP_ASSERT(frameCount > 0);
     
-    SpriteBatch* batch = SpriteBatch::create(imagePath, effect);
-    batch->getSampler()->setWrapMode(Texture::CLAMP, Texture::CLAMP);
-    batch->getSampler()->setFilterMode(Texture::Filter::LINEAR, Texture::Filter::LINEAR);
-    batch->getStateBlock()->setDepthWrite(false);
-    batch->getStateBlock()->setDepthTest(true);
+    // Sprites that draw the same image share their batch, so that the sprite renderer can merge their draws.
+    SpriteBatch* batch = SpriteRenderer::acquireBatch(imagePath, Texture::LINEAR, BLEND_ALPHA, effect);
+    if (!batch)
+        return NULL;
     
     unsigned int imageWidth = batch->getSampler()->getTexture()->getWidth();
     unsigned int imageHeight = batch->getSampler()->getTexture()->getHeight();
@@ -219,6 +220,45 @@ static bool parseOffset(const char* str, Sprite::Offset* offset)
     return true;
 }
 
+/**
+ * Reads the image and the source rectangle of a region of an atlas written by the gameplay-encoder.
+ */
+static bool loadAtlasRegion(const char* atlasPath, const char* regionName, std::string* imagePath, Rectangle* region)
+{
+    GP_ASSERT(atlasPath);
+    GP_ASSERT(imagePath);
+    GP_ASSERT(region);
+
+    if (regionName == NULL || strlen(regionName) == 0)
+    {
+        GP_ERROR("Sprite uses the atlas '%s' without a region.", atlasPath);
+        return false;
+    }
+
+    Properties* properties = Properties::create(atlasPath);
+    if (properties == NULL)
+    {
+        GP_ERROR("Failed to load sprite atlas '%s'.", atlasPath);
+        return false;
+    }
+    Properties* atlas = (strlen(properties->getNamespace()) > 0) ? properties : properties->getNextNamespace();
+    Properties* regionProperties = atlas && strcmp(atlas->getNamespace(), "atlas") == 0 ? atlas->getNamespace(regionName) : NULL;
+    const char* image = atlas ? atlas->getString("image") : NULL;
+    if (regionProperties == NULL || image == NULL)
+    {
+        GP_ERROR("Sprite atlas '%s' does not have an image and a region named '%s'.", atlasPath, regionName);
+        SAFE_DELETE(properties);
+        return false;
+    }
+
+    // The image of the atlas is stored next to it.
+    *imagePath = FileSystem::getDirectoryName(atlasPath) + image;
+    region->set(regionProperties->getFloat("x"), regionProperties->getFloat("y"),
+                regionProperties->getFloat("width"), regionProperties->getFloat("height"));
+    SAFE_DELETE(properties);
+    return true;
+}
+
 Sprite* Sprite::create(Properties* properties)
 {
     // Check if the Properties is valid and has a valid namespace.
@@ -228,8 +268,18 @@ Sprite* Sprite::create(Properties* properties)
         return NULL;
     }
 
-    // Get image path.
+    // Get image path, or the atlas region to draw.
     const char* imagePath = properties->getString("path");
+    std::string atlasImagePath;
+    Rectangle atlasRegion;
+    bool hasAtlasRegion = false;
+    if ((imagePath == NULL || strlen(imagePath) == 0) && properties->exists("atlas"))
+    {
+        if (!loadAtlasRegion(properties->getString("atlas"), properties->getString("region"), &atlasImagePath, &atlasRegion))
+            return NULL;
+        imagePath = atlasImagePath.c_str();
+        hasAtlasRegion = true;
+    }
     if (imagePath == NULL || strlen(imagePath) == 0)
     {
         GP_ERROR("Sprite is missing required image file path.");
@@ -269,6 +319,15 @@ Sprite* Sprite::create(Properties* properties)
         }
     }
 
+    // Sprites of an atlas region are as large as the region by default.
+    if (hasAtlasRegion)
+    {
+        if (width == -1.0f)
+            width = atlasRegion.width;
+        if (height == -1.0f)
+            height = atlasRegion.height;
+    }
+
     Sprite* sprite;
     if (properties->exists("source"))
     {
@@ -276,6 +335,13 @@ Sprite* Sprite::create(Properties* properties)
         Rectangle source;
         properties->getVector4("source", (Vector4*)&source);
 
+        // The source frame of an atlas sprite is within its region.
+        if (hasAtlasRegion)
+        {
+            source.x += atlasRegion.x;
+            source.y += atlasRegion.y;
+        }
+
         // Get frame count
         int frameCount = properties->getInt("frameCount");
         if (frameCount < 0)
@@ -293,8 +359,13 @@ Sprite* Sprite::create(Properties* properties)
     else
     {
         // Load sprite
-        sprite = Sprite::create(imagePath, width, height, effect);
+        if (hasAtlasRegion)
+            sprite = Sprite::create(imagePath, width, height, atlasRegion, 1, effect);
+        else
+            sprite = Sprite::create(imagePath, width, height, effect);
     }
+    if (!sprite)
+        return NULL;
 
     // Edit scaling of sprites if needed
     if (widthPercentage != 0.0f || heightPercentage != 0.0f)
@@ -523,22 +594,12 @@ void Sprite::setBlendMode(BlendMode mode)
     switch (mode)
     {
         case BLEND_NONE:
-            _batch->getStateBlock()->setBlend(false);
-            break;
         case BLEND_ALPHA:
-            _batch->getStateBlock()->setBlend(true);
-            _batch->getStateBlock()->setBlendSrc(RenderState::BLEND_SRC_ALPHA);
-            _batch->getStateBlock()->setBlendDst(RenderState::BLEND_ONE_MINUS_SRC_ALPHA);
-            break;
         case BLEND_ADDITIVE:
-            _batch->getStateBlock()->setBlend(true);
-            _batch->getStateBlock()->setBlendSrc(RenderState::BLEND_SRC_ALPHA);
-            _batch->getStateBlock()->setBlendDst(RenderState::BLEND_ONE);
-            break;
         case BLEND_MULTIPLIED:
-            _batch->getStateBlock()->setBlend(true);
-            _batch->getStateBlock()->setBlendSrc(RenderState::BLEND_ZERO);
-            _batch->getStateBlock()->setBlendDst(RenderState::BLEND_SRC_COLOR);
+            // Sprites with another blend mode draw with another shared batch.
+            _batch = SpriteRenderer::changeBlendMode(_batch, mode);
+            _blendMode = mode;
             break;
         default:
             GP_ERROR("Unsupported blend mode (%d).", mode);
@@ -565,6 +626,8 @@ unsigned int Sprite::draw(bool wireframe)
 {
     // Apply scene camera projection and translation offsets
     Vector3 position = Vector3::zero();
+    Matrix projectionMatrix;
+    bool hasProjection = false;
     if (_node && _node->getScene())
     {
         Camera* activeCamera = _node->getScene()->getActiveCamera();
@@ -574,9 +637,8 @@ unsigned int Sprite::draw(bool wireframe)
             if (cameraNode)
             {
                 // Scene projection
-                Matrix projectionMatrix;
                 projectionMatrix = _node->getProjectionMatrix();
-                _batch->setProjectionMatrix(projectionMatrix);
+                hasProjection = true;
                 
                 // Camera translation offsets
                 position.x -= cameraNode->getTranslationWorld().x;
@@ -636,11 +698,13 @@ unsigned int Sprite::draw(bool wireframe)
         scale.y = -scale.y;
     }
     
-    // TODO: Proper batching from cache based on batching rules (image, layers, etc)
-    _batch->start();
+    // The sprite renderer merges this draw with the draws of the other sprites that share the batch.
+    SpriteRenderer* renderer = Game::getInstance()->getSpriteRenderer();
+    GP_ASSERT(renderer);
+    renderer->startBatch(_batch, hasProjection ? &projectionMatrix : NULL);
     _batch->draw(position, _frames[_frameIndex], scale, Vector4(_color.x, _color.y, _color.z, _color.w * _opacity),
                  _anchor, rotationAngle);
-    _batch->finish();
+    renderer->finishBatch(_batch);
     
     return 1;
 }
@@ -678,6 +742,7 @@ Drawable* Sprite::clone(NodeCloneContext& context)
     spriteClone->_framePadding = _framePadding;
     spriteClone->_frameIndex = _frameIndex;
     spriteClone->_batch = _batch;
+    SpriteRenderer::addBatchRef(_batch);
 
     return spriteClone;
 }
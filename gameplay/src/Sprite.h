@@ -124,6 +124,10 @@ public:
     /**
      * Creates a sprite from properties.
      *
+     * Instead of the 'path' of an image, the properties can name an 'atlas' file written by
+     * the gameplay-encoder and the 'region' of it to draw. The 'source' frame is then within
+     * the region.
+     *
      * @param properties The properties object to create from.
      * @return The new Sprite.
      */
@@ -309,6 +313,9 @@ public:
      * This can be modified for controlling sampler setting such as
      * filtering modes.
      *
+     * Sprites that draw the same image with the same blend mode and the default effect share
+     * the sampler, the state block and the material, so that their draws can be merged.
+     *
      * @return The texture sampler used when sampling the texture.
      */
     Texture::Sampler* getSampler() const;
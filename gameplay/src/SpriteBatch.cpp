@@ -23,9 +23,10 @@ namespace gameplay
 {
 
 static Effect* __spriteEffect = NULL;
+static Effect* __spriteArrayEffect = NULL;
 
 SpriteBatch::SpriteBatch()
-    : _batch(NULL), _sampler(NULL), _textureWidthRatio(0.0f), _textureHeightRatio(0.0f)
+    : _batch(NULL), _sampler(NULL), _textureWidthRatio(0.0f), _textureHeightRatio(0.0f), _array(false), _layer(0)
 {
 }
 
@@ -35,14 +36,15 @@ SpriteBatch::~SpriteBatch()
     SAFE_RELEASE(_sampler);
     if (!_customEffect)
     {
-        if (__spriteEffect && __spriteEffect->getRefCount() == 1)
+        Effect*& spriteEffect = _array ? __spriteArrayEffect : __spriteEffect;
+        if (spriteEffect && spriteEffect->getRefCount() == 1)
         {
-            __spriteEffect->release();
-            __spriteEffect = NULL;
+            spriteEffect->release();
+            spriteEffect = NULL;
         }
         else
         {
-            __spriteEffect->release();
+            spriteEffect->release();
         }
     }
 }
@@ -58,26 +60,31 @@ SpriteBatch* SpriteBatch::create(const char* texturePath, Effect* effect, unsign
 SpriteBatch* SpriteBatch::create(Texture* texture,  Effect* effect, unsigned int initialCapacity)
 {
     GP_ASSERT(texture != NULL);
-    GP_ASSERT(texture->getType() == Texture::TEXTURE_2D);
+    GP_ASSERT(texture->getType() == Texture::TEXTURE_2D || texture->getType() == Texture::TEXTURE_2D_ARRAY);
+
+    // The sprites of a batch with a texture array sample the layer they were drawn with.
+    bool array = texture->getType() == Texture::TEXTURE_2D_ARRAY;
+    GLenum samplerType = array ? GL_SAMPLER_2D_ARRAY : GL_SAMPLER_2D;
 
     bool customEffect = (effect != NULL);
     if (!customEffect)
     {
         // Create our static sprite effect.
-        if (__spriteEffect == NULL)
+        Effect*& spriteEffect = array ? __spriteArrayEffect : __spriteEffect;
+        if (spriteEffect == NULL)
         {
-            __spriteEffect = Effect::createFromFile(SPRITE_VSH, SPRITE_FSH);
-            if (__spriteEffect == NULL)
+            spriteEffect = Effect::createFromFile(SPRITE_VSH, SPRITE_FSH, array ? "TEXTURE_ARRAY" : NULL);
+            if (spriteEffect == NULL)
             {
                 GP_ERROR("Unable to load sprite effect.");
                 return NULL;
             }
-            effect = __spriteEffect;
+            effect = spriteEffect;
         }
         else
         {
-            effect = __spriteEffect;
-            __spriteEffect->addRef();
+            effect = spriteEffect;
+            spriteEffect->addRef();
         }
     }
 
@@ -86,7 +93,7 @@ SpriteBatch* SpriteBatch::create(Texture* texture,  Effect* effect, unsigned int
     for (unsigned int i = 0, count = effect->getUniformCount(); i < count; ++i)
     {
         Uniform* uniform = effect->getUniform(i);
-        if (uniform && uniform->getType() == GL_SAMPLER_2D)
+        if (uniform && uniform->getType() == samplerType)
         {
             samplerUniform = uniform;
             break;
@@ -94,7 +101,7 @@ SpriteBatch* SpriteBatch::create(Texture* texture,  Effect* effect, unsigned int
     }
     if (!samplerUniform)
     {
-        GP_ERROR("No uniform of type GL_SAMPLER_2D found in sprite effect.");
+        GP_ERROR("No uniform of type %s found in sprite effect.", array ? "GL_SAMPLER_2D_ARRAY" : "GL_SAMPLER_2D");
         SAFE_RELEASE(effect);
         return NULL;
     }
@@ -115,7 +122,7 @@ SpriteBatch* SpriteBatch::create(Texture* texture,  Effect* effect, unsigned int
     VertexFormat::Element vertexElements[] =
     {
         VertexFormat::Element(VertexFormat::POSITION, 3),
-        VertexFormat::Element(VertexFormat::TEXCOORD0, 2),
+        VertexFormat::Element(VertexFormat::TEXCOORD0, array ? 3 : 2),
         VertexFormat::Element(VertexFormat::COLOR, 4)
     };
     VertexFormat vertexFormat(vertexElements, 3);
@@ -131,6 +138,7 @@ SpriteBatch* SpriteBatch::create(Texture* texture,  Effect* effect, unsigned int
     batch->_batch = meshBatch;
     batch->_textureWidthRatio = 1.0f / (float)texture->getWidth();
     batch->_textureHeightRatio = 1.0f / (float)texture->getHeight();
+    batch->_array = array;
 
 	// Bind an ortho projection to the material by default (user can override with setProjectionMatrix)
 	Game* game = Game::getInstance();
@@ -232,7 +240,7 @@ void SpriteBatch::draw(float x, float y, float z, float width, float height, flo
     
     static unsigned short indices[4] = { 0, 1, 2, 3 };
 
-    _batch->add(v, 4, indices, 4);
+    add(v, 4, indices, 4);
 }
 
 void SpriteBatch::draw(const Vector3& position, const Vector3& right, const Vector3& forward, float width, float height,
@@ -297,7 +305,7 @@ void SpriteBatch::draw(const Vector3& position, const Vector3& right, const Vect
     SPRITE_ADD_VERTEX(v[3], p3.x, p3.y, p3.z, u2, v2, color.x, color.y, color.z, color.w);
     
     static const unsigned short indices[4] = { 0, 1, 2, 3 };
-    _batch->add(v, 4, const_cast<unsigned short*>(indices), 4);
+    add(v, 4, indices, 4);
 }
 
 void SpriteBatch::draw(float x, float y, float width, float height, float u1, float v1, float u2, float v2, const Vector4& color)
@@ -352,7 +360,7 @@ void SpriteBatch::draw(SpriteBatch::SpriteVertex* vertices, unsigned int vertexC
     GP_ASSERT(vertices);
     GP_ASSERT(indices);
 
-    _batch->add(vertices, vertexCount, indices, indexCount);
+    add(vertices, vertexCount, indices, indexCount);
 }
 
 void SpriteBatch::draw(float x, float y, float z, float width, float height, float u1, float v1, float u2, float v2, const Vector4& color, bool positionIsCenter)
@@ -375,11 +383,46 @@ void SpriteBatch::draw(float x, float y, float z, float width, float height, flo
 
     static unsigned short indices[4] = { 0, 1, 2, 3 };
 
-    _batch->add(v, 4, indices, 4);
+    add(v, 4, indices, 4);
+}
+
+void SpriteBatch::add(const SpriteVertex* vertices, unsigned int vertexCount, const unsigned short* indices, unsigned int indexCount)
+{
+    if (!_array)
+    {
+        _batch->add(vertices, vertexCount, indices, indexCount);
+        return;
+    }
+
+    // Insert the layer after the texture coordinates of each vertex.
+    _layerVertices.resize(vertexCount);
+    const float layer = (float)_layer;
+    for (unsigned int i = 0; i < vertexCount; ++i)
+    {
+        const SpriteVertex& src = vertices[i];
+        SpriteLayerVertex& dst = _layerVertices[i];
+        dst.x = src.x; dst.y = src.y; dst.z = src.z;
+        dst.u = src.u; dst.v = src.v; dst.layer = layer;
+        dst.r = src.r; dst.g = src.g; dst.b = src.b; dst.a = src.a;
+    }
+    _batch->add(&_layerVertices[0], vertexCount, indices, indexCount);
+}
+
+void SpriteBatch::setLayer(unsigned int layer)
+{
+    GP_ASSERT(_array && layer < _sampler->getTexture()->getLayerCount());
+    _layer = layer;
+}
+
+unsigned int SpriteBatch::getLayer() const
+{
+    return _layer;
 }
 
 void SpriteBatch::finish()
 {
+    GP_PROFILE_GPU_SCOPE("SpriteBatch::finish");
+
     // Finish and draw the batch
     _batch->finish();
     _batch->draw();
@@ -400,6 +443,16 @@ Material* SpriteBatch::getMaterial() const
     return _batch->getMaterial();
 }
 
+bool SpriteBatch::setStreaming(bool streaming)
+{
+    return _batch->setStreaming(streaming);
+}
+
+bool SpriteBatch::isStreaming() const
+{
+    return _batch->isStreaming();
+}
+
 void SpriteBatch::setProjectionMatrix(const Matrix& matrix)
 {
     _projectionMatrix = matrix;
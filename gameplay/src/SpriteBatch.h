@@ -21,12 +21,19 @@ namespace gameplay
  * implicit sorting to minimize state changes. Therefore, it is highly
  * recommended to combine multiple small textures into larger texture atlases
  * where possible when drawing sprites.
+ *
+ * The texture can also be a texture array (see Texture::createArray), in which
+ * case each sprite samples the layer that was set with setLayer() when it was
+ * drawn, so sprites with images of different layers are drawn in the same batch.
+ * A custom effect for a texture array takes a vec3 tex coord whose third component
+ * is the layer, and samples a sampler2DArray.
  */
 class SpriteBatch
 {
     friend class Bundle;
     friend class Font;
     friend class Text;
+    friend class Control;
 
 public:
 
@@ -104,6 +111,26 @@ public:
      */
     bool isStarted() const;
 
+    /**
+     * Sets the layer of the texture array that the sprites drawn from now on sample.
+     *
+     * This can be called between any two draws, since the layer is stored with the vertices of
+     * each sprite and does not split the batch.
+     *
+     * @param layer The index of the layer, which must be less than the number of layers of the
+     *      texture array of the batch.
+     * @script{ignore}
+     */
+    void setLayer(unsigned int layer);
+
+    /**
+     * Gets the layer of the texture array that the sprites sample.
+     *
+     * @return The index of the layer, which is 0 for batches that do not use a texture array.
+     * @script{ignore}
+     */
+    unsigned int getLayer() const;
+
     /**
      * Draws a single sprite.
      * 
@@ -334,6 +361,25 @@ public:
      */
     Material* getMaterial() const;
 
+    /**
+     * Sets whether the sprites are written straight into mapped GPU buffers.
+     *
+     * @param streaming true to stream the sprites, false to keep them in client-side arrays.
+     *
+     * @return true if the batch streams its sprites from now on, false otherwise.
+     * @see MeshBatch::setStreaming
+     * @script{ignore}
+     */
+    bool setStreaming(bool streaming);
+
+    /**
+     * Determines whether the sprites are written straight into mapped GPU buffers.
+     *
+     * @return true if the batch streams its sprites, false otherwise.
+     * @script{ignore}
+     */
+    bool isStreaming() const;
+
     /**
      * Sets a custom projection matrix to use with the sprite batch.
      *
@@ -402,11 +448,36 @@ private:
 
     bool clipSprite(const Rectangle& clip, float& x, float& y, float& width, float& height, float& u1, float& v1, float& u2, float& v2);
 
+    /**
+     * The vertex of a sprite of a batch with a texture array, with the layer that it samples.
+     */
+    struct SpriteLayerVertex
+    {
+        float x;
+        float y;
+        float z;
+        float u;
+        float v;
+        float layer;
+        float r;
+        float g;
+        float b;
+        float a;
+    };
+
+    /**
+     * Adds vertices to the mesh batch, with the current layer if the texture is an array.
+     */
+    void add(const SpriteVertex* vertices, unsigned int vertexCount, const unsigned short* indices, unsigned int indexCount);
+
     MeshBatch* _batch;
     Texture::Sampler* _sampler;
     bool _customEffect;
     float _textureWidthRatio;
     float _textureHeightRatio;
+    bool _array;
+    unsigned int _layer;
+    std::vector<SpriteLayerVertex> _layerVertices;
     mutable Matrix _projectionMatrix;
 };
 
@@ -0,0 +1,262 @@
+#include "Base.h"
+#include "SpriteRenderer.h"
+#include "SpriteBatch.h"
+#include "Sprite.h"
+#include "Font.h"
+#include "Game.h"
+
+namespace gameplay
+{
+
+/**
+ * A batch that is used by one or more 2D drawables.
+ */
+struct SharedBatch
+{
+    SpriteBatch* batch;
+    Texture* texture;
+    Texture::Filter filter;
+    int blendMode;
+    bool shared;
+    unsigned int refCount;
+};
+
+static std::vector<SharedBatch> __batches;
+
+static void applyBlendMode(SpriteBatch* batch, int blendMode)
+{
+    RenderState::StateBlock* stateBlock = batch->getStateBlock();
+    switch (blendMode)
+    {
+        case Sprite::BLEND_NONE:
+            stateBlock->setBlend(false);
+            break;
+        case Sprite::BLEND_ALPHA:
+            stateBlock->setBlend(true);
+            stateBlock->setBlendSrc(RenderState::BLEND_SRC_ALPHA);
+            stateBlock->setBlendDst(RenderState::BLEND_ONE_MINUS_SRC_ALPHA);
+            break;
+        case Sprite::BLEND_ADDITIVE:
+            stateBlock->setBlend(true);
+            stateBlock->setBlendSrc(RenderState::BLEND_SRC_ALPHA);
+            stateBlock->setBlendDst(RenderState::BLEND_ONE);
+            break;
+        case Sprite::BLEND_MULTIPLIED:
+            stateBlock->setBlend(true);
+            stateBlock->setBlendSrc(RenderState::BLEND_ZERO);
+            stateBlock->setBlendDst(RenderState::BLEND_SRC_COLOR);
+            break;
+        default:
+            GP_ERROR("Unsupported blend mode (%d).", blendMode);
+            break;
+    }
+}
+
+static SpriteBatch* acquireSharedBatch(Texture* texture, Texture::Filter filter, int blendMode, Effect* effect)
+{
+    GP_ASSERT(texture);
+
+    if (!effect)
+    {
+        for (size_t i = 0, count = __batches.size(); i < count; ++i)
+        {
+            SharedBatch& entry = __batches[i];
+            if (entry.shared && entry.texture == texture && entry.filter == filter && entry.blendMode == blendMode)
+            {
+                ++entry.refCount;
+                return entry.batch;
+            }
+        }
+    }
+
+    SpriteBatch* batch = SpriteBatch::create(texture, effect);
+    if (!batch)
+        return NULL;
+    batch->getSampler()->setWrapMode(Texture::CLAMP, Texture::CLAMP);
+    batch->getSampler()->setFilterMode(filter, filter);
+    batch->getStateBlock()->setDepthWrite(false);
+    batch->getStateBlock()->setDepthTest(true);
+    applyBlendMode(batch, blendMode);
+
+    SharedBatch entry;
+    entry.batch = batch;
+    entry.texture = texture;
+    entry.filter = filter;
+    entry.blendMode = blendMode;
+    entry.shared = (effect == NULL);
+    entry.refCount = 1;
+    __batches.push_back(entry);
+    return batch;
+}
+
+static SharedBatch* findSharedBatch(SpriteBatch* batch)
+{
+    for (size_t i = 0, count = __batches.size(); i < count; ++i)
+    {
+        if (__batches[i].batch == batch)
+            return &__batches[i];
+    }
+    return NULL;
+}
+
+SpriteRenderer::SpriteRenderer()
+    : _batching(false), _pendingBatch(NULL), _pendingFont(NULL), _batchCount(0)
+{
+}
+
+SpriteRenderer::~SpriteRenderer()
+{
+    _pendingBatch = NULL;
+    _pendingFont = NULL;
+}
+
+void SpriteRenderer::begin()
+{
+    flush();
+    _batching = true;
+    _batchCount = 0;
+}
+
+void SpriteRenderer::end()
+{
+    flush();
+    _batching = false;
+}
+
+bool SpriteRenderer::isBatching() const
+{
+    return _batching;
+}
+
+void SpriteRenderer::flush()
+{
+    if (_pendingBatch)
+    {
+        _pendingBatch->finish();
+        _pendingBatch = NULL;
+        ++_batchCount;
+    }
+    if (_pendingFont)
+    {
+        _pendingFont->finish();
+        _pendingFont = NULL;
+        ++_batchCount;
+    }
+}
+
+unsigned int SpriteRenderer::getBatchCount() const
+{
+    return _batchCount;
+}
+
+void SpriteRenderer::startBatch(SpriteBatch* batch, const Matrix* projection)
+{
+    GP_ASSERT(batch);
+
+    if (_pendingBatch == batch && (!projection || memcmp(projection->m, _pendingProjection.m, sizeof(_pendingProjection.m)) == 0))
+        return;
+
+    flush();
+    if (projection)
+        batch->setProjectionMatrix(*projection);
+    _pendingProjection = batch->getProjectionMatrix();
+    batch->start();
+    _pendingBatch = batch;
+}
+
+void SpriteRenderer::finishBatch(SpriteBatch* batch)
+{
+    GP_ASSERT(batch == _pendingBatch);
+
+    if (!_batching)
+        flush();
+}
+
+void SpriteRenderer::startFont(Font* font)
+{
+    GP_ASSERT(font);
+
+    if (_pendingFont == font)
+        return;
+
+    flush();
+    font->start();
+    _pendingFont = font;
+}
+
+void SpriteRenderer::finishFont(Font* font)
+{
+    GP_ASSERT(font == _pendingFont);
+
+    if (!_batching)
+        flush();
+}
+
+SpriteBatch* SpriteRenderer::acquireBatch(const char* imagePath, Texture::Filter filter, int blendMode, Effect* effect)
+{
+    GP_ASSERT(imagePath);
+
+    Texture* texture = Texture::create(imagePath);
+    if (!texture)
+    {
+        GP_ERROR("Failed to load the image '%s' of a sprite batch.", imagePath);
+        return NULL;
+    }
+    SpriteBatch* batch = acquireSharedBatch(texture, filter, blendMode, effect);
+    SAFE_RELEASE(texture);
+    return batch;
+}
+
+SpriteBatch* SpriteRenderer::changeBlendMode(SpriteBatch* batch, int blendMode)
+{
+    SharedBatch* entry = findSharedBatch(batch);
+    GP_ASSERT(entry);
+    if (entry->blendMode == blendMode)
+        return batch;
+
+    // Batches with a custom effect are not shared, so only their state changes.
+    if (!entry->shared)
+    {
+        entry->blendMode = blendMode;
+        applyBlendMode(batch, blendMode);
+        return batch;
+    }
+
+    SpriteBatch* newBatch = acquireSharedBatch(batch->getSampler()->getTexture(), entry->filter, blendMode, NULL);
+    releaseBatch(batch);
+    return newBatch;
+}
+
+void SpriteRenderer::addBatchRef(SpriteBatch* batch)
+{
+    SharedBatch* entry = findSharedBatch(batch);
+    GP_ASSERT(entry);
+    ++entry->refCount;
+}
+
+void SpriteRenderer::releaseBatch(SpriteBatch* batch)
+{
+    if (!batch)
+        return;
+
+    for (std::vector<SharedBatch>::iterator itr = __batches.begin(); itr != __batches.end(); ++itr)
+    {
+        if (itr->batch == batch)
+        {
+            if (--itr->refCount == 0)
+            {
+                // The batch must not be drawn after it is deleted.
+                Game* game = Game::getInstance();
+                SpriteRenderer* renderer = game ? game->getSpriteRenderer() : NULL;
+                if (renderer && renderer->_pendingBatch == batch)
+                    renderer->flush();
+                __batches.erase(itr);
+                SAFE_DELETE(batch);
+            }
+            return;
+        }
+    }
+    GP_ERROR("Released a sprite batch that was not acquired from the sprite renderer.");
+}
+
+}
@@ -0,0 +1,157 @@
+#ifndef SPRITERENDERER_H_
+#define SPRITERENDERER_H_
+
+#include "Matrix.h"
+#include "Texture.h"
+
+namespace gameplay
+{
+
+class SpriteBatch;
+class Font;
+class Effect;
+
+/**
+ * Defines the merging of the draws of 2D drawables into as few batches as possible.
+ *
+ * The sprite renderer is owned by the Game. Sprites and tile sets that are created with
+ * the default sprite effect share one SpriteBatch for each image, filter and blend mode,
+ * so drawables whose images are packed into the same atlas (see the -atlas option of the
+ * gameplay-encoder) share a batch as well. Between begin() and end(), the draws of Sprite,
+ * TileSet and Text drawables are not drawn right away: consecutive draws that use the same
+ * batch, or the same font, and the same projection are collected and drawn together when a
+ * draw that uses something else is made, or when the renderer is flushed. The draws are
+ * still drawn in the order in which they are made, so the layering of the drawables is kept.
+ *
+ * Other drawables are not drawn through the renderer, so the renderer must be flushed
+ * before drawing them between begin() and end(). Outside of begin() and end() every draw
+ * is drawn right away.
+ *
+ * @script{ignore}
+ */
+class SpriteRenderer
+{
+    friend class Game;
+    friend class Sprite;
+    friend class TileSet;
+    friend class Text;
+
+public:
+
+    /**
+     * Starts merging the draws of 2D drawables.
+     */
+    void begin();
+
+    /**
+     * Draws the collected draws and stops merging the draws of 2D drawables.
+     */
+    void end();
+
+    /**
+     * Determines whether the draws of 2D drawables are currently merged.
+     *
+     * @return true if between begin() and end(), false otherwise.
+     */
+    bool isBatching() const;
+
+    /**
+     * Draws the draws that have been collected so far.
+     */
+    void flush();
+
+    /**
+     * Returns the number of batches drawn since the last call to begin().
+     *
+     * @return The number of batches drawn.
+     */
+    unsigned int getBatchCount() const;
+
+private:
+
+    /**
+     * Constructor.
+     */
+    SpriteRenderer();
+
+    /**
+     * Hidden copy constructor.
+     */
+    SpriteRenderer(const SpriteRenderer& copy);
+
+    /**
+     * Destructor.
+     */
+    ~SpriteRenderer();
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    SpriteRenderer& operator=(const SpriteRenderer&);
+
+    /**
+     * Starts the batch that a drawable draws into, unless it is already collecting draws
+     * with the same projection.
+     *
+     * @param batch The batch of the drawable.
+     * @param projection The projection to draw with, or NULL to use the projection of the batch.
+     */
+    void startBatch(SpriteBatch* batch, const Matrix* projection);
+
+    /**
+     * Finishes a batch that was started with startBatch, which draws it unless draws are merged.
+     */
+    void finishBatch(SpriteBatch* batch);
+
+    /**
+     * Starts the font that a drawable draws text with, unless it is already collecting text.
+     */
+    void startFont(Font* font);
+
+    /**
+     * Finishes a font that was started with startFont, which draws it unless draws are merged.
+     */
+    void finishFont(Font* font);
+
+    /**
+     * Returns a batch for a drawable, which is shared with the other drawables that draw the same
+     * image with the same filter and blend mode when no custom effect is used.
+     *
+     * The batch must be released with releaseBatch.
+     *
+     * @param imagePath The path of the image to draw.
+     * @param filter The filter to sample the image with.
+     * @param blendMode The Sprite::BlendMode to draw with.
+     * @param effect A custom effect to draw with, or NULL to use the default sprite effect.
+     *
+     * @return The batch, or NULL if the image could not be loaded.
+     */
+    static SpriteBatch* acquireBatch(const char* imagePath, Texture::Filter filter, int blendMode, Effect* effect = NULL);
+
+    /**
+     * Returns a shared batch like the one of another drawable, but with another blend mode.
+     *
+     * The batch that is passed in is released.
+     */
+    static SpriteBatch* changeBlendMode(SpriteBatch* batch, int blendMode);
+
+    /**
+     * Adds a reference to a batch returned by acquireBatch, for a drawable that is a clone.
+     */
+    static void addBatchRef(SpriteBatch* batch);
+
+    /**
+     * Releases a batch returned by acquireBatch, and deletes it when no drawable uses it anymore.
+     */
+    static void releaseBatch(SpriteBatch* batch);
+
+    bool _batching;
+    SpriteBatch* _pendingBatch;
+    Font* _pendingFont;
+    Matrix _pendingProjection;
+    unsigned int _batchCount;
+};
+
+}
+
+#endif
@@ -0,0 +1,483 @@
+#include "Base.h"
+#include "StaticBatch.h"
+#include "MeshPart.h"
+#include "Technique.h"
+#include "Pass.h"
+#include "Node.h"
+#include "RenderStats.h"
+#include "Game.h"
+
+// Number of floats stored per draw (one column-major 4x4 matrix)
+#define DRAW_FLOAT_COUNT 16
+
+namespace gameplay
+{
+
+/**
+ * The layout of a command of glMultiDrawElementsIndirect.
+ */
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLuint baseVertex;
+    GLuint baseInstance;
+};
+
+StaticBatch::StaticBatch(Mesh* mesh, MeshPart* part)
+    : _mesh(mesh), _part(part), _vertexCount(0), _indexCount(0), _commandBuffer(0), _instanceBuffer(0),
+    _commandsDirty(true), _transformsDirty(true), _attributeWarningLogged(false)
+{
+    GP_ASSERT(_mesh);
+    GP_ASSERT(_part);
+
+    GL_ASSERT( glGenBuffers(1, &_commandBuffer) );
+    GL_ASSERT( glGenBuffers(1, &_instanceBuffer) );
+}
+
+StaticBatch::~StaticBatch()
+{
+    clear();
+    for (size_t i = 0, count = _buckets.size(); i < count; ++i)
+    {
+        SAFE_RELEASE(_buckets[i].material);
+    }
+    SAFE_RELEASE(_mesh);
+
+    if (_commandBuffer)
+    {
+        RenderState::deleteBuffer(_commandBuffer);
+        _commandBuffer = 0;
+    }
+    if (_instanceBuffer)
+    {
+        RenderState::deleteBuffer(_instanceBuffer);
+        _instanceBuffer = 0;
+    }
+}
+
+StaticBatch* StaticBatch::create(const VertexFormat& vertexFormat, unsigned int vertexCapacity, unsigned int indexCapacity, Mesh::IndexFormat indexFormat)
+{
+    GP_ASSERT(vertexCapacity > 0 && indexCapacity > 0);
+
+    if (!isSupported())
+    {
+        GP_WARN("Failed to create static batch; multi-draw indirect is not supported.");
+        return NULL;
+    }
+
+    Mesh* mesh = Mesh::createMesh(vertexFormat, vertexCapacity, false);
+    if (!mesh)
+    {
+        GP_ERROR("Failed to create mesh for static batch.");
+        return NULL;
+    }
+    MeshPart* part = mesh->addPart(Mesh::TRIANGLES, indexFormat, indexCapacity, false);
+    if (!part)
+    {
+        GP_ERROR("Failed to create mesh part for static batch.");
+        SAFE_RELEASE(mesh);
+        return NULL;
+    }
+    return new StaticBatch(mesh, part);
+}
+
+bool StaticBatch::isSupported()
+{
+#ifdef GP_USE_MULTI_DRAW_INDIRECT
+    return glMultiDrawElementsIndirect && glCopyBufferSubData && glVertexAttribDivisor;
+#else
+    return false;
+#endif
+}
+
+unsigned int StaticBatch::addMaterial(Material* material)
+{
+    GP_ASSERT(material);
+
+    material->addRef();
+    if (_node)
+        material->setNodeBinding(_node);
+
+    Bucket bucket;
+    bucket.material = material;
+    bucket.firstCommand = 0;
+    bucket.commandCount = 0;
+    bucket.indexCount = 0;
+    _buckets.push_back(bucket);
+    return (unsigned int)(_buckets.size() - 1);
+}
+
+Material* StaticBatch::getMaterial(unsigned int index) const
+{
+    GP_ASSERT(index < _buckets.size());
+    return _buckets[index].material;
+}
+
+unsigned int StaticBatch::getMaterialCount() const
+{
+    return (unsigned int)_buckets.size();
+}
+
+int StaticBatch::add(Mesh* mesh, unsigned int partIndex, Node* node, unsigned int material)
+{
+    GP_ASSERT(mesh);
+    GP_ASSERT(node);
+    GP_ASSERT(material < _buckets.size());
+
+    int geometry = addGeometry(mesh, partIndex);
+    if (geometry < 0)
+        return -1;
+
+    node->addRef();
+    Draw draw;
+    draw.geometry = (unsigned int)geometry;
+    draw.material = material;
+    draw.node = node;
+    _draws.push_back(draw);
+
+    _commandsDirty = true;
+    _transformsDirty = true;
+    return (int)(_draws.size() - 1);
+}
+
+unsigned int StaticBatch::getIndexSize() const
+{
+    switch (_part->getIndexFormat())
+    {
+    case Mesh::INDEX8:
+        return 1;
+    case Mesh::INDEX16:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+void StaticBatch::copyBuffer(GLuint source, GLuint destination, unsigned int sourceOffset, unsigned int destinationOffset, unsigned int size)
+{
+    if (size == 0)
+        return;
+
+    GL_ASSERT( glBindBuffer(GL_COPY_READ_BUFFER, source) );
+    GL_ASSERT( glBindBuffer(GL_COPY_WRITE_BUFFER, destination) );
+    GL_ASSERT( glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, sourceOffset, destinationOffset, size) );
+    GL_ASSERT( glBindBuffer(GL_COPY_READ_BUFFER, 0) );
+    GL_ASSERT( glBindBuffer(GL_COPY_WRITE_BUFFER, 0) );
+}
+
+int StaticBatch::addGeometry(Mesh* mesh, unsigned int partIndex)
+{
+    // Parts that are drawn several times share the same geometry.
+    for (size_t i = 0, count = _geometry.size(); i < count; ++i)
+    {
+        if (_geometry[i].mesh == mesh && _geometry[i].partIndex == partIndex)
+            return (int)i;
+    }
+
+    if (partIndex >= mesh->getPartCount())
+    {
+        GP_WARN("Failed to add mesh to static batch; the mesh has no part %u.", partIndex);
+        return -1;
+    }
+    MeshPart* part = mesh->getPart(partIndex);
+    GP_ASSERT(part);
+    if (!Game::getInstance()->getMeshStreamer()->load(mesh))
+    {
+        GP_WARN("Failed to add mesh to static batch; the data of the mesh could not be streamed in.");
+        return -1;
+    }
+    if (mesh->getVertexFormat() != _mesh->getVertexFormat() || part->getIndexFormat() != _part->getIndexFormat() ||
+        part->getPrimitiveType() != Mesh::TRIANGLES)
+    {
+        GP_WARN("Failed to add mesh to static batch; its vertex format, index format or primitive type does not match the batch.");
+        return -1;
+    }
+    if (_vertexCount + mesh->getVertexCount() > _mesh->getVertexCount() ||
+        _indexCount + part->getIndexCount() > _part->getIndexCount())
+    {
+        GP_WARN("Failed to add mesh to static batch; the batch is full.");
+        return -1;
+    }
+
+    // The geometry is copied between the buffers on the GPU. The indices are copied as they are,
+    // and the commands offset them by the first vertex of the mesh.
+    unsigned int vertexSize = _mesh->getVertexSize();
+    copyBuffer(mesh->getVertexBuffer(), _mesh->getVertexBuffer(), mesh->getVertexOffset(),
+        _mesh->getVertexOffset() + _vertexCount * vertexSize, mesh->getVertexCount() * vertexSize);
+    copyBuffer(part->getIndexBuffer(), _part->getIndexBuffer(), part->getIndexOffset(),
+        _part->getIndexOffset() + _indexCount * getIndexSize(), part->getIndexCount() * getIndexSize());
+
+    Geometry geometry;
+    geometry.mesh = mesh;
+    geometry.partIndex = partIndex;
+    geometry.bounds = mesh->getBoundingSphere();
+    geometry.firstIndex = _indexCount;
+    geometry.indexCount = part->getIndexCount();
+    geometry.baseVertex = _vertexCount;
+    _geometry.push_back(geometry);
+
+    _vertexCount += mesh->getVertexCount();
+    _indexCount += part->getIndexCount();
+    return (int)(_geometry.size() - 1);
+}
+
+void StaticBatch::clear()
+{
+    for (size_t i = 0, count = _draws.size(); i < count; ++i)
+    {
+        SAFE_RELEASE(_draws[i].node);
+    }
+    _draws.clear();
+    _geometry.clear();
+    _vertexCount = 0;
+    _indexCount = 0;
+    _commandsDirty = true;
+    _transformsDirty = true;
+}
+
+unsigned int StaticBatch::getDrawCount() const
+{
+    return (unsigned int)_draws.size();
+}
+
+unsigned int StaticBatch::getVertexCount() const
+{
+    return _vertexCount;
+}
+
+unsigned int StaticBatch::getIndexCount() const
+{
+    return _indexCount;
+}
+
+void StaticBatch::updateTransforms()
+{
+    _transformsDirty = true;
+}
+
+void StaticBatch::setNode(Node* node)
+{
+    Drawable::setNode(node);
+
+    // The materials are bound to the node of the batch, which the matrices of the draws are relative to.
+    if (node)
+    {
+        for (size_t i = 0, count = _buckets.size(); i < count; ++i)
+        {
+            _buckets[i].material->setNodeBinding(node);
+        }
+    }
+    _transformsDirty = true;
+}
+
+Drawable* StaticBatch::clone(NodeCloneContext& context)
+{
+    StaticBatch* batch = StaticBatch::create(_mesh->getVertexFormat(), _mesh->getVertexCount(), _part->getIndexCount(), _part->getIndexFormat());
+    if (!batch)
+    {
+        GP_ERROR("Failed to clone static batch.");
+        return NULL;
+    }
+
+    // The source meshes may have been released, so the geometry is copied from the buffers of this batch.
+    copyBuffer(_mesh->getVertexBuffer(), batch->_mesh->getVertexBuffer(), _mesh->getVertexOffset(),
+        batch->_mesh->getVertexOffset(), _vertexCount * _mesh->getVertexSize());
+    copyBuffer(_part->getIndexBuffer(), batch->_part->getIndexBuffer(), _part->getIndexOffset(),
+        batch->_part->getIndexOffset(), _indexCount * getIndexSize());
+    batch->_vertexCount = _vertexCount;
+    batch->_indexCount = _indexCount;
+    batch->_geometry = _geometry;
+
+    for (size_t i = 0, count = _buckets.size(); i < count; ++i)
+    {
+        Material* material = _buckets[i].material->clone(context);
+        batch->addMaterial(material);
+        SAFE_RELEASE(material);
+    }
+    for (size_t i = 0, count = _draws.size(); i < count; ++i)
+    {
+        // Draws whose nodes were cloned along with this node follow their clones.
+        Draw draw = _draws[i];
+        Node* node = context.findClonedNode(draw.node);
+        if (node)
+            draw.node = node;
+        draw.node->addRef();
+        batch->_draws.push_back(draw);
+    }
+    return batch;
+}
+
+void StaticBatch::updateCommands()
+{
+    size_t drawCount = _draws.size();
+    if (_commandsDirty)
+    {
+        // The commands of each bucket are contiguous, and the instance of each command is the
+        // index of its matrix in the instance buffer.
+        std::vector<DrawElementsIndirectCommand> commands;
+        commands.reserve(drawCount);
+        for (size_t b = 0, bucketCount = _buckets.size(); b < bucketCount; ++b)
+        {
+            Bucket& bucket = _buckets[b];
+            bucket.firstCommand = (unsigned int)commands.size();
+            bucket.indexCount = 0;
+            for (size_t i = 0; i < drawCount; ++i)
+            {
+                if (_draws[i].material != b)
+                    continue;
+
+                const Geometry& geometry = _geometry[_draws[i].geometry];
+                DrawElementsIndirectCommand command;
+                command.count = geometry.indexCount;
+                command.instanceCount = 1;
+                command.firstIndex = geometry.firstIndex + _part->getIndexOffset() / getIndexSize();
+                command.baseVertex = geometry.baseVertex;
+                command.baseInstance = (GLuint)i;
+                commands.push_back(command);
+                bucket.indexCount += geometry.indexCount;
+            }
+            bucket.commandCount = (unsigned int)commands.size() - bucket.firstCommand;
+        }
+
+        if (!commands.empty())
+        {
+            GL_ASSERT( glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer) );
+            GL_ASSERT( glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), &commands[0], GL_STATIC_DRAW) );
+            GL_ASSERT( glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0) );
+            RenderStats::countBufferUpload(commands.size() * sizeof(DrawElementsIndirectCommand));
+        }
+        _commandsDirty = false;
+    }
+
+    if (_transformsDirty && _node && drawCount > 0)
+    {
+        // The matrices are relative to the node of the batch, and stored in the order of the draws.
+        Matrix inverseWorld;
+        if (!_node->getWorldMatrix().invert(&inverseWorld))
+            inverseWorld.setIdentity();
+
+        BoundingSphere bounds;
+        std::vector<float> data(drawCount * DRAW_FLOAT_COUNT);
+        for (size_t i = 0; i < drawCount; ++i)
+        {
+            Matrix m;
+            Matrix::multiply(inverseWorld, _draws[i].node->getWorldMatrix(), &m);
+            memcpy(&data[i * DRAW_FLOAT_COUNT], m.m, sizeof(float) * DRAW_FLOAT_COUNT);
+
+            BoundingSphere sphere(_geometry[_draws[i].geometry].bounds);
+            sphere.transform(m);
+            if (i == 0)
+                bounds.set(sphere);
+            else
+                bounds.merge(sphere);
+        }
+        _mesh->setBoundingSphere(bounds);
+
+        RenderState::bindBuffer(GL_ARRAY_BUFFER, _instanceBuffer);
+        GL_ASSERT( glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), &data[0], GL_STATIC_DRAW) );
+        RenderStats::countBufferUpload(data.size() * sizeof(float));
+        _transformsDirty = false;
+    }
+}
+
+bool StaticBatch::prepareMaterial(Material* material)
+{
+    GP_ASSERT(material);
+
+    Technique* technique = material->getTechnique();
+    GP_ASSERT(technique);
+    unsigned int passCount = technique->getPassCount();
+    for (unsigned int i = 0; i < passCount; ++i)
+    {
+        if (!technique->getPassByIndex(i)->getEffect()->isReady())
+            return false;
+    }
+
+    // The passes draw the shared mesh of the batch.
+    for (unsigned int i = 0; i < passCount; ++i)
+    {
+        Pass* pass = technique->getPassByIndex(i);
+        if (pass->getVertexAttributeBinding() == NULL)
+        {
+            VertexAttributeBinding* b = VertexAttributeBinding::create(_mesh, pass->getEffect());
+            pass->setVertexAttributeBinding(b);
+            SAFE_RELEASE(b);
+        }
+    }
+    return true;
+}
+
+unsigned int StaticBatch::draw(bool wireframe)
+{
+    if (!_node || _draws.empty())
+        return 0;
+
+    updateCommands();
+
+    unsigned int drawCalls = 0;
+    for (size_t i = 0, count = _buckets.size(); i < count; ++i)
+    {
+        if (_buckets[i].commandCount > 0 && prepareMaterial(_buckets[i].material))
+            drawCalls += drawBucket(_buckets[i]);
+    }
+    return drawCalls;
+}
+
+unsigned int StaticBatch::drawBucket(const Bucket& bucket)
+{
+    unsigned int drawCalls = 0;
+#ifdef GP_USE_MULTI_DRAW_INDIRECT
+    Technique* technique = bucket.material->getTechnique();
+    GP_ASSERT(technique);
+    for (unsigned int i = 0, passCount = technique->getPassCount(); i < passCount; ++i)
+    {
+        Pass* pass = technique->getPassByIndex(i);
+        GP_ASSERT(pass);
+
+        VertexAttribute attrib = pass->getEffect()->getVertexAttribute(VERTEX_ATTRIBUTE_INSTANCE_MATRIX_NAME);
+        if (attrib == -1)
+        {
+            if (!_attributeWarningLogged)
+            {
+                GP_WARN("Effect '%s' used by a static batch has no '%s' vertex attribute.", pass->getEffect()->getId(), VERTEX_ATTRIBUTE_INSTANCE_MATRIX_NAME);
+                _attributeWarningLogged = true;
+            }
+            continue;
+        }
+
+        pass->bind();
+        RenderState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, _part->getIndexBuffer());
+
+        // Each matrix column is a separate vec4 attribute, which the base instance of each
+        // command points at the matrix of its draw.
+        RenderState::bindBuffer(GL_ARRAY_BUFFER, _instanceBuffer);
+        for (unsigned int c = 0; c < 4; ++c)
+        {
+            GL_ASSERT( glVertexAttribPointer(attrib + c, 4, GL_FLOAT, GL_FALSE, DRAW_FLOAT_COUNT * sizeof(float), (void*)(c * 4 * sizeof(float))) );
+            GL_ASSERT( glEnableVertexAttribArray(attrib + c) );
+            GL_ASSERT( glVertexAttribDivisor(attrib + c, 1) );
+        }
+
+        GL_ASSERT( glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer) );
+        GL_ASSERT( glMultiDrawElementsIndirect(GL_TRIANGLES, _part->getIndexFormat(),
+            (void*)(bucket.firstCommand * sizeof(DrawElementsIndirectCommand)), bucket.commandCount, 0) );
+        GL_ASSERT( glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0) );
+        RenderStats::countDraw(GL_TRIANGLES, bucket.indexCount);
+        ++drawCalls;
+
+        // Restore the attributes so that other draws using this binding are not instanced.
+        for (unsigned int c = 0; c < 4; ++c)
+        {
+            GL_ASSERT( glVertexAttribDivisor(attrib + c, 0) );
+            GL_ASSERT( glDisableVertexAttribArray(attrib + c) );
+        }
+
+        pass->unbind();
+    }
+#endif
+    return drawCalls;
+}
+
+}
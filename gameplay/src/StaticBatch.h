@@ -0,0 +1,242 @@
+#ifndef STATICBATCH_H_
+#define STATICBATCH_H_
+
+#include "Mesh.h"
+#include "Material.h"
+#include "Drawable.h"
+
+namespace gameplay
+{
+
+/**
+ * Defines a drawable that packs the parts of many static meshes into one shared vertex buffer
+ * and index buffer, and draws all the parts that use the same material with a single
+ * multi-draw indirect call.
+ *
+ * The geometry of each mesh part that is added to a static batch is copied into the buffers of
+ * the batch on the GPU, once for each mesh part however many times it is added, so the source
+ * meshes can be released once all their draws have been added. The batch does not keep
+ * references to them, so a mesh that is released and created again is added as new geometry.
+ * The mesh parts must have the vertex format and index format of the batch and be made of
+ * triangles. Each part that is added is a draw of the batch, which is positioned by a node and drawn with one of the materials of the batch. The draws of a material
+ * are kept together into a bucket, and each bucket is drawn with one glMultiDrawElementsIndirect
+ * call, so the cost of a draw on the CPU does not depend on the number of meshes in the batch.
+ *
+ * Each draw reads its matrix, relative to the node that the batch is attached to, from the
+ * "a_instanceMatrix" vertex attribute, so the materials of a batch must use an effect that
+ * is compiled with the INSTANCED define, such as the built-in colored and textured shaders.
+ * The geometry is static, so the matrices of the draws are only read from their nodes when the
+ * batch is first drawn and when updateTransforms() is called:
+ *
+ * @code
+ * StaticBatch* batch = StaticBatch::create(rockMesh->getVertexFormat(), 1 << 20, 1 << 22, Mesh::INDEX32);
+ * unsigned int rock = batch->addMaterial(rockMaterial);  // defines INSTANCED
+ * for (unsigned int i = 0; i < nodeCount; ++i)
+ *     batch->add(rockMesh, 0, rockNodes[i], rock);
+ * scene->addNode("rocks")->setDrawable(batch);
+ * @endcode
+ *
+ * Multi-draw indirect needs OpenGL 4.3, so static batches are only available on desktop
+ * platforms whose drivers support it (see isSupported()).
+ *
+ * @script{ignore}
+ */
+class StaticBatch : public Ref, public Drawable
+{
+    friend class Node;
+
+public:
+
+    /**
+     * Creates a new, empty static batch.
+     *
+     * @param vertexFormat The vertex format of the meshes of the batch.
+     * @param vertexCapacity The number of vertices that the batch can hold.
+     * @param indexCapacity The number of indices that the batch can hold.
+     * @param indexFormat The index format of the mesh parts of the batch.
+     *
+     * @return The new static batch, or NULL if multi-draw indirect is not supported.
+     */
+    static StaticBatch* create(const VertexFormat& vertexFormat, unsigned int vertexCapacity, unsigned int indexCapacity,
+                               Mesh::IndexFormat indexFormat = Mesh::INDEX16);
+
+    /**
+     * Determines if the current platform supports multi-draw indirect.
+     *
+     * @return true if static batches can be created, false otherwise.
+     */
+    static bool isSupported();
+
+    /**
+     * Adds a material that the draws of the batch can use.
+     *
+     * @param material The material.
+     *
+     * @return The index of the material.
+     */
+    unsigned int addMaterial(Material* material);
+
+    /**
+     * Returns the material at the specified index.
+     *
+     * @param index The index of the material.
+     *
+     * @return The material.
+     */
+    Material* getMaterial(unsigned int index) const;
+
+    /**
+     * Returns the number of materials of the batch.
+     *
+     * @return The number of materials.
+     */
+    unsigned int getMaterialCount() const;
+
+    /**
+     * Adds a draw of a mesh part to the batch.
+     *
+     * @param mesh The mesh.
+     * @param partIndex The index of the part of the mesh.
+     * @param node The node that positions the draw. It does not need to be part of the scene.
+     * @param material The index of the material that the part is drawn with.
+     *
+     * @return The index of the draw, or -1 if the part does not match the batch or the batch is full.
+     */
+    int add(Mesh* mesh, unsigned int partIndex, Node* node, unsigned int material);
+
+    /**
+     * Removes every draw and all the geometry of the batch. The materials are kept.
+     */
+    void clear();
+
+    /**
+     * Returns the number of draws of the batch.
+     *
+     * @return The number of draws.
+     */
+    unsigned int getDrawCount() const;
+
+    /**
+     * Returns the number of vertices that are used in the buffers of the batch.
+     *
+     * @return The number of vertices.
+     */
+    unsigned int getVertexCount() const;
+
+    /**
+     * Returns the number of indices that are used in the buffers of the batch.
+     *
+     * @return The number of indices.
+     */
+    unsigned int getIndexCount() const;
+
+    /**
+     * Reads the matrices of the draws from their nodes again, for example after some of
+     * the static geometry has been moved in an editor.
+     */
+    void updateTransforms();
+
+    /**
+     * @see Drawable::draw
+     *
+     * Wireframe drawing is not supported for static batches.
+     */
+    unsigned int draw(bool wireframe = false);
+
+protected:
+
+    /**
+     * @see Drawable::clone
+     */
+    Drawable* clone(NodeCloneContext& context);
+
+    /**
+     * @see Drawable::setNode
+     */
+    void setNode(Node* node);
+
+private:
+
+    /**
+     * A range of the buffers of the batch that holds the geometry of a mesh part.
+     */
+    struct Geometry
+    {
+        Mesh* mesh;
+        unsigned int partIndex;
+        BoundingSphere bounds;
+        unsigned int firstIndex;
+        unsigned int indexCount;
+        unsigned int baseVertex;
+    };
+
+    /**
+     * A mesh part that is drawn with a material of the batch.
+     */
+    struct Draw
+    {
+        unsigned int geometry;
+        unsigned int material;
+        Node* node;
+    };
+
+    /**
+     * The draws of a material, and where their commands start in the command buffer.
+     */
+    struct Bucket
+    {
+        Material* material;
+        unsigned int firstCommand;
+        unsigned int commandCount;
+        unsigned int indexCount;
+    };
+
+    /**
+     * Constructor.
+     */
+    StaticBatch(Mesh* mesh, MeshPart* part);
+
+    /**
+     * Destructor. Hidden use release() instead.
+     */
+    ~StaticBatch();
+
+    /**
+     * Hidden copy constructor.
+     */
+    StaticBatch(const StaticBatch& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    StaticBatch& operator=(const StaticBatch&);
+
+    unsigned int getIndexSize() const;
+
+    static void copyBuffer(GLuint source, GLuint destination, unsigned int sourceOffset, unsigned int destinationOffset, unsigned int size);
+
+    int addGeometry(Mesh* mesh, unsigned int partIndex);
+
+    void updateCommands();
+
+    bool prepareMaterial(Material* material);
+
+    unsigned int drawBucket(const Bucket& bucket);
+
+    Mesh* _mesh;
+    MeshPart* _part;
+    unsigned int _vertexCount;
+    unsigned int _indexCount;
+    std::vector<Geometry> _geometry;
+    std::vector<Draw> _draws;
+    std::vector<Bucket> _buckets;
+    GLuint _commandBuffer;
+    GLuint _instanceBuffer;
+    bool _commandsDirty;
+    bool _transformsDirty;
+    bool _attributeWarningLogged;
+};
+
+}
+
+#endif
@@ -155,6 +155,17 @@ public:
      */
     virtual bool rewind() = 0;
 
+    /**
+     * Returns a pointer to the contents of the stream if the stream is mapped into memory.
+     *
+     * The contents can be read directly through the pointer for as long as the stream is open,
+     * which avoids copying them. Reading through the pointer does not move the file pointer.
+     * Use FileSystem::MAP to open a stream that is mapped into memory.
+     *
+     * @return A pointer to the start of the stream, or NULL if the stream is not mapped into memory.
+     */
+    virtual const void* getMappedData() { return NULL; }
+
 protected:
     Stream() {};
 private:
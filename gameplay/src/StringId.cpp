@@ -0,0 +1,131 @@
+#include "Base.h"
+#include "StringId.h"
+
+// The number of buckets of the table of strings when it is created
+#define STRINGID_INITIAL_BUCKETS 1024
+
+namespace gameplay
+{
+
+const StringId::Entry StringId::_empty = { 2166136261u, 0, NULL, { '\0' } };
+std::vector<StringId::Entry*>* StringId::_buckets = NULL;
+static size_t __stringIdCount = 0;
+static std::mutex __stringIdMutex;
+
+StringId::StringId()
+    : _entry(&_empty)
+{
+}
+
+StringId::StringId(const char* str)
+    : _entry(intern(str, true))
+{
+}
+
+StringId::StringId(const std::string& str)
+    : _entry(intern(str.c_str(), true))
+{
+}
+
+StringId::StringId(const Entry* entry)
+    : _entry(entry)
+{
+}
+
+bool StringId::find(const char* str, StringId* id)
+{
+    GP_ASSERT(id);
+
+    const Entry* entry = intern(str, false);
+    if (entry == NULL)
+        return false;
+    *id = StringId(entry);
+    return true;
+}
+
+bool StringId::startsWith(const StringId& prefix) const
+{
+    return _entry == prefix._entry ||
+        (_entry->length >= prefix._entry->length && memcmp(_entry->chars, prefix._entry->chars, prefix._entry->length) == 0);
+}
+
+bool StringId::operator<(const StringId& id) const
+{
+    return _entry != id._entry && strcmp(_entry->chars, id._entry->chars) < 0;
+}
+
+unsigned int StringId::hash(const char* str, size_t* length)
+{
+    GP_ASSERT(str);
+    GP_ASSERT(length);
+
+    // FNV-1a
+    unsigned int hash = 2166136261u;
+    const char* p = str;
+    for (; *p; ++p)
+    {
+        hash ^= (unsigned char)*p;
+        hash *= 16777619u;
+    }
+    *length = (size_t)(p - str);
+    return hash;
+}
+
+const StringId::Entry* StringId::intern(const char* str, bool insert)
+{
+    if (str == NULL || *str == '\0')
+        return &_empty;
+
+    size_t length;
+    unsigned int h = hash(str, &length);
+
+    std::lock_guard<std::mutex> lock(__stringIdMutex);
+    if (_buckets)
+    {
+        for (Entry* entry = (*_buckets)[h & (_buckets->size() - 1)]; entry != NULL; entry = entry->next)
+        {
+            if (entry->hash == h && entry->length == length && memcmp(entry->chars, str, length) == 0)
+                return entry;
+        }
+    }
+    if (!insert)
+        return NULL;
+
+    if (_buckets == NULL)
+    {
+        _buckets = new std::vector<Entry*>(STRINGID_INITIAL_BUCKETS, (Entry*)NULL);
+    }
+    else if (__stringIdCount >= _buckets->size())
+    {
+        // Keep at most one string per bucket on average, by doubling the buckets.
+        std::vector<Entry*>* buckets = new std::vector<Entry*>(_buckets->size() * 2, (Entry*)NULL);
+        for (size_t i = 0, count = _buckets->size(); i < count; ++i)
+        {
+            Entry* entry = (*_buckets)[i];
+            while (entry)
+            {
+                Entry* next = entry->next;
+                Entry*& bucket = (*buckets)[entry->hash & (buckets->size() - 1)];
+                entry->next = bucket;
+                bucket = entry;
+                entry = next;
+            }
+        }
+        SAFE_DELETE(_buckets);
+        _buckets = buckets;
+    }
+
+    // The entries are allocated with malloc, since they are kept until the process exits and
+    // should not be reported as leaks.
+    Entry* entry = (Entry*)malloc(sizeof(Entry) + length);
+    entry->hash = h;
+    entry->length = length;
+    memcpy(entry->chars, str, length + 1);
+    Entry*& bucket = (*_buckets)[h & (_buckets->size() - 1)];
+    entry->next = bucket;
+    bucket = entry;
+    ++__stringIdCount;
+    return entry;
+}
+
+}
@@ -0,0 +1,175 @@
+#ifndef STRINGID_H_
+#define STRINGID_H_
+
+namespace gameplay
+{
+
+/**
+ * Defines an interned string, used for the IDs of nodes, techniques, passes and animations.
+ *
+ * Each distinct string is stored once, in a table that is shared by the whole process, so that a
+ * string ID is a single pointer to its entry in the table: two string IDs are equal when they point
+ * to the same entry, which is compared without comparing their characters, and the hash of the
+ * string is computed once, when it is interned. Strings are interned when a string ID is created
+ * from them, and they are kept until the process exits, so string IDs should only be created from
+ * strings that name things, and not from arbitrary text.
+ *
+ * Looking up an object by a string that was never interned doesn't need to intern it: find()
+ * returns the string ID of a string only if it is already interned, so that a lookup of an unknown
+ * name fails at once. The table can be used from multiple threads.
+ *
+ * String IDs are ordered by their characters, so that they can be the keys of ordered containers
+ * that are also searched for the IDs that begin with a prefix, which is interned to search for it.
+ *
+ * @script{ignore}
+ */
+class StringId
+{
+public:
+
+    /**
+     * Constructor, for the empty string.
+     */
+    StringId();
+
+    /**
+     * Constructor, which interns the specified string.
+     *
+     * @param str The string, or NULL for the empty string.
+     */
+    StringId(const char* str);
+
+    /**
+     * Constructor, which interns the specified string.
+     *
+     * @param str The string.
+     */
+    StringId(const std::string& str);
+
+    /**
+     * Finds the string ID of a string that is already interned, without interning it.
+     *
+     * @param str The string to find.
+     * @param id The string ID of the string, if it is interned. (out param)
+     *
+     * @return true if the string is interned, false otherwise.
+     */
+    static bool find(const char* str, StringId* id);
+
+    /**
+     * Returns the characters of the string, which remain valid until the process exits.
+     *
+     * @return The null-terminated string.
+     */
+    const char* c_str() const;
+
+    /**
+     * Returns the FNV-1a hash of the string.
+     *
+     * @return The hash of the string.
+     */
+    unsigned int getHash() const;
+
+    /**
+     * Returns the length of the string.
+     *
+     * @return The number of characters of the string.
+     */
+    size_t length() const;
+
+    /**
+     * Determines whether this is the empty string.
+     *
+     * @return true if the string is empty, false otherwise.
+     */
+    bool empty() const;
+
+    /**
+     * Determines whether the string begins with a prefix.
+     *
+     * @param prefix The prefix.
+     *
+     * @return true if the string begins with the prefix, false otherwise.
+     */
+    bool startsWith(const StringId& prefix) const;
+
+    /**
+     * Determines whether two string IDs are the same string.
+     */
+    bool operator==(const StringId& id) const;
+
+    /**
+     * Determines whether two string IDs are different strings.
+     */
+    bool operator!=(const StringId& id) const;
+
+    /**
+     * Determines whether the string of this ID is ordered before the string of another.
+     */
+    bool operator<(const StringId& id) const;
+
+    /**
+     * Returns the FNV-1a hash of a string.
+     *
+     * @param str The null-terminated string.
+     * @param length The length of the string. (out param)
+     *
+     * @return The hash of the string.
+     */
+    static unsigned int hash(const char* str, size_t* length);
+
+private:
+
+    /**
+     * An interned string, followed by its characters.
+     */
+    struct Entry
+    {
+        unsigned int hash;
+        size_t length;
+        Entry* next;
+        char chars[1];
+    };
+
+    explicit StringId(const Entry* entry);
+
+    static const Entry* intern(const char* str, bool insert);
+
+    static const Entry _empty;
+    static std::vector<Entry*>* _buckets;
+    const Entry* _entry;
+};
+
+inline const char* StringId::c_str() const
+{
+    return _entry->chars;
+}
+
+inline unsigned int StringId::getHash() const
+{
+    return _entry->hash;
+}
+
+inline size_t StringId::length() const
+{
+    return _entry->length;
+}
+
+inline bool StringId::empty() const
+{
+    return _entry->length == 0;
+}
+
+inline bool StringId::operator==(const StringId& id) const
+{
+    return _entry == id._entry;
+}
+
+inline bool StringId::operator!=(const StringId& id) const
+{
+    return _entry != id._entry;
+}
+
+}
+
+#endif
@@ -7,7 +7,7 @@ namespace gameplay
 {
 
 Technique::Technique(const char* id, Material* material)
-    : _id(id ? id : ""), _material(material)
+    : _id(id), _material(material)
 {
     RenderState::_parent = material;
 }
@@ -41,11 +41,15 @@ Pass* Technique::getPass(const char* id) const
 {
     GP_ASSERT(id);
 
+    // Pass IDs are interned, so an ID that was never interned matches no pass.
+    StringId stringId;
+    if (!StringId::find(id, &stringId))
+        return NULL;
     for (size_t i = 0, count = _passes.size(); i < count; ++i)
     {
         Pass* pass = _passes[i];
         GP_ASSERT(pass);
-        if (strcmp(pass->getId(), id) == 0)
+        if (pass->_id == stringId)
         {
             return pass;
         }
@@ -84,7 +84,7 @@ private:
 
     Technique* clone(Material* material, NodeCloneContext &context) const;
 
-    std::string _id;
+    StringId _id;
     Material* _material;
     std::vector<Pass*> _passes;
 };
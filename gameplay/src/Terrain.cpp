@@ -2,7 +2,10 @@
 #include "Terrain.h"
 #include "TerrainPatch.h"
 #include "Node.h"
+#include "Scene.h"
 #include "FileSystem.h"
+#include "Game.h"
+#include "RenderCommandList.h"
 
 namespace gameplay
 {
@@ -24,21 +27,82 @@ static const float DEFAULT_TERRAIN_HEIGHT_RATIO = 0.3f;
 
 // Terrain dirty flags
 static const unsigned int DIRTY_FLAG_INVERSE_WORLD = 1;
+static const unsigned int DIRTY_FLAG_BOUNDS = 2;
+
+// The default number of patches of a paged terrain that are resident
+static const unsigned int DEFAULT_TERRAIN_RESIDENT_PATCHES = 64;
+// The number of paged patches whose heights are read at the same time
+static const unsigned int TERRAIN_PAGE_MAX_REQUESTS = 4;
+// The number of paged patches whose geometry is built in one frame
+static const unsigned int TERRAIN_PAGE_MAX_LOADS = 2;
+
+// The default size of the composited textures of the nearest patches
+static const unsigned int DEFAULT_TERRAIN_COMPOSITE_SIZE = 512;
+// The number of patches whose layers are composited in one frame
+static const unsigned int TERRAIN_COMPOSITE_MAX_PATCHES = 2;
+
+struct Terrain::Pages
+{
+    std::string path;
+    unsigned int columns;
+    unsigned int rows;
+    unsigned int bits;
+    unsigned int patchSize;
+    unsigned int patchColumns;
+    unsigned int maxResident;
+    std::vector<PageRequest*> requests;
+    std::vector<TerrainPatch*> queue;
+    std::vector<std::pair<float, unsigned int> > distances;
+    std::vector<bool> wanted;
+    Vector3 cameraPosition;
+    bool dirty;
+};
+
+struct Terrain::PageRequest
+{
+    // The patch that the heights are read for, or NULL if it was paged out in the meantime.
+    TerrainPatch* patch;
+    std::string path;
+    unsigned int columns;
+    unsigned int bits;
+    unsigned int x1;
+    unsigned int z1;
+    unsigned int x2;
+    unsigned int z2;
+    std::vector<float> heights;
+    bool failed;
+    JobSystem::Job* job;
+};
 
 static float getDefaultHeight(unsigned int width, unsigned int height);
 
 Terrain::Terrain() : Drawable(),
-    _heightfield(NULL), _normalMap(NULL), _flags(FRUSTUM_CULLING | LEVEL_OF_DETAIL),
-    _dirtyFlags(DIRTY_FLAG_INVERSE_WORLD)
+    _heightfield(NULL), _quadTree(NULL), _normalMap(NULL), _geomorphing(false), _lodDistance(0.0f), _pages(NULL),
+    _compositeQuad(NULL), _compositeSize(DEFAULT_TERRAIN_COMPOSITE_SIZE), _composites(0), _flags(FRUSTUM_CULLING | LEVEL_OF_DETAIL | TEXTURE_ARRAYS),
+    _dirtyFlags(DIRTY_FLAG_INVERSE_WORLD | DIRTY_FLAG_BOUNDS)
 {
 }
 
 Terrain::~Terrain()
 {
+    if (_pages)
+    {
+        // Wait for the heights that are being read, which the worker threads write to the requests
+        JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+        for (size_t i = 0, count = _pages->requests.size(); i < count; ++i)
+        {
+            if (jobSystem)
+                jobSystem->wait(_pages->requests[i]->job);
+            SAFE_DELETE(_pages->requests[i]);
+        }
+        SAFE_DELETE(_pages);
+    }
+    SAFE_DELETE(_quadTree);
     for (size_t i = 0, count = _patches.size(); i < count; ++i)
     {
         SAFE_DELETE(_patches[i]);
     }
+    SAFE_RELEASE(_compositeQuad);
     SAFE_RELEASE(_normalMap);
     SAFE_RELEASE(_heightfield);
 }
@@ -60,6 +124,7 @@ Terrain* Terrain::create(const char* path, Properties* properties)
     Properties* pTerrain = NULL;
     bool externalProperties = (p != NULL);
     HeightField* heightfield = NULL;
+    Pages* pages = NULL;
     Vector3 terrainSize;
     int patchSize = 0;
     int detailLevels = 1;
@@ -105,6 +170,8 @@ Terrain* Terrain::create(const char* path, Properties* properties)
         if (ext == ".PNG")
         {
             // Read normalized height values from heightmap image
+            if (pTerrain->getBool("paged"))
+                GP_WARN("Only RAW heightmaps can be paged; loading the whole heightmap image: %s", heightmap.c_str());
             heightfield = HeightField::createFromImage(heightmap.c_str(), 0, 1);
         }
         else if (ext == ".RAW" || ext == ".R16")
@@ -119,8 +186,38 @@ Terrain* Terrain::create(const char* path, Properties* properties)
                 return NULL;
             }
 
-            // Read normalized height values from RAW file
-            heightfield = HeightField::createFromRAW(heightmap.c_str(), (unsigned int)imageSize.x, (unsigned int)imageSize.y, 0, 1);
+            unsigned int columns = (unsigned int)imageSize.x;
+            unsigned int rows = (unsigned int)imageSize.y;
+            if (pTerrain->getBool("paged"))
+            {
+                // Paged terrains read the normalized heights of their patches from the RAW file as they are needed
+                std::unique_ptr<Stream> stream(FileSystem::open(heightmap.c_str()));
+                size_t fileSize = stream.get() ? stream->length() : 0;
+                unsigned int bits = columns >= 2 && rows >= 2 ? (unsigned int)(fileSize / ((size_t)columns * rows)) * 8 : 0;
+                if (bits != 8 && bits != 16)
+                {
+                    GP_WARN("Invalid RAW heightfield image for paged terrain - must be 8-bit or 16-bit: %s", heightmap.c_str());
+                    if (!externalProperties)
+                        SAFE_DELETE(p);
+                    return NULL;
+                }
+
+                pages = new Pages();
+                pages->path = heightmap;
+                pages->columns = columns;
+                pages->rows = rows;
+                pages->bits = bits;
+                pages->patchSize = 0;
+                pages->patchColumns = 0;
+                int residentPatches = pTerrain->exists("residentPatches") ? pTerrain->getInt("residentPatches") : 0;
+                pages->maxResident = residentPatches > 0 ? (unsigned int)residentPatches : DEFAULT_TERRAIN_RESIDENT_PATCHES;
+                pages->dirty = true;
+            }
+            else
+            {
+                // Read normalized height values from RAW file
+                heightfield = HeightField::createFromRAW(heightmap.c_str(), columns, rows, 0, 1);
+            }
         }
         else
         {
@@ -198,7 +295,7 @@ Terrain* Terrain::create(const char* path, Properties* properties)
     // Read 'material'
     materialPath = pTerrain->getString("material", "");
 
-    if (heightfield == NULL)
+    if (heightfield == NULL && pages == NULL)
     {
         GP_WARN("Failed to read heightfield heights for terrain definition: %s", path);
         if (!externalProperties)
@@ -206,14 +303,16 @@ Terrain* Terrain::create(const char* path, Properties* properties)
         return NULL;
     }
 
+    unsigned int columns = heightfield ? heightfield->getColumnCount() : pages->columns;
+    unsigned int rows = heightfield ? heightfield->getRowCount() : pages->rows;
     if (terrainSize.isZero())
     {
-        terrainSize.set(heightfield->getColumnCount(), getDefaultHeight(heightfield->getColumnCount(), heightfield->getRowCount()), heightfield->getRowCount());
+        terrainSize.set(columns, getDefaultHeight(columns, rows), rows);
     }
 
-    if (patchSize <= 0 || patchSize > (int)heightfield->getColumnCount() || patchSize > (int)heightfield->getRowCount())
+    if (patchSize <= 0 || patchSize > (int)columns || patchSize > (int)rows)
     {
-        patchSize = std::min(heightfield->getRowCount(), std::min(heightfield->getColumnCount(), DEFAULT_TERRAIN_PATCH_SIZE));
+        patchSize = std::min(rows, std::min(columns, DEFAULT_TERRAIN_PATCH_SIZE));
     }
 
     if (detailLevels <= 0)
@@ -223,10 +322,10 @@ Terrain* Terrain::create(const char* path, Properties* properties)
         skirtScale = 0;
 
     // Compute terrain scale
-    Vector3 scale(terrainSize.x / (heightfield->getColumnCount()-1), terrainSize.y, terrainSize.z / (heightfield->getRowCount()-1));
+    Vector3 scale(terrainSize.x / (columns-1), terrainSize.y, terrainSize.z / (rows-1));
 
     // Create terrain
-    Terrain* terrain = create(heightfield, scale, (unsigned int)patchSize, (unsigned int)detailLevels, skirtScale, normalMap, materialPath.c_str(), pTerrain);
+    Terrain* terrain = create(heightfield, scale, (unsigned int)patchSize, (unsigned int)detailLevels, skirtScale, normalMap, materialPath.c_str(), pTerrain, pages);
 
     if (!externalProperties)
         SAFE_DELETE(p);
@@ -241,16 +340,17 @@ Terrain* Terrain::create(HeightField* heightfield, const Vector3& scale, unsigne
 
 Terrain* Terrain::create(HeightField* heightfield, const Vector3& scale,
     unsigned int patchSize, unsigned int detailLevels, float skirtScale,
-    const char* normalMapPath, const char* materialPath, Properties* properties)
+    const char* normalMapPath, const char* materialPath, Properties* properties, Pages* pages)
 {
-    GP_ASSERT(heightfield);
+    GP_ASSERT(heightfield || pages);
 
-    unsigned int width = heightfield->getColumnCount();
-    unsigned int height = heightfield->getRowCount();
+    unsigned int width = heightfield ? heightfield->getColumnCount() : pages->columns;
+    unsigned int height = heightfield ? heightfield->getRowCount() : pages->rows;
 
     // Create the terrain object
     Terrain* terrain = new Terrain();
     terrain->_heightfield = heightfield;
+    terrain->_pages = pages;
     terrain->_materialPath = (materialPath == NULL || strlen(materialPath) == 0) ? TERRAIN_MATERIAL : materialPath;
 
     // Store terrain local scaling so it can be applied to the heightfield
@@ -273,9 +373,21 @@ Terrain* Terrain::create(HeightField* heightfield, const Vector3& scale,
     // level detail terrain patch.
     unsigned int maxStep = (unsigned int)std::pow(2.0, (double)(detailLevels-1));
 
+    // Geomorphing is read before the patches are created, since it changes their geometry
+    terrain->_geomorphing = properties ? properties->getBool("geomorphing") : false;
+
+    if (properties)
+    {
+        if (properties->getBool("compositing"))
+            terrain->_flags |= COMPOSITING;
+        if (properties->exists("compositeSize"))
+            terrain->_compositeSize = (unsigned int)std::max(properties->getInt("compositeSize"), 1);
+    }
+
     // Create terrain patches
     unsigned int x1, x2, z1, z2;
     unsigned int row = 0, column = 0;
+    unsigned int columns = 0;
     for (unsigned int z = 0; z < height-1; z = z2, ++row)
     {
         z1 = z;
@@ -287,12 +399,26 @@ Terrain* Terrain::create(HeightField* heightfield, const Vector3& scale,
             x2 = std::min(x1 + patchSize, width-1);
 
             // Create this patch
-            TerrainPatch* patch = TerrainPatch::create(terrain, terrain->_patches.size(), row, column, heightfield->getArray(), width, height, x1, z1, x2, z2, -halfWidth, -halfHeight, maxStep, skirtScale);
+            TerrainPatch* patch = TerrainPatch::create(terrain, terrain->_patches.size(), row, column, heightfield ? heightfield->getArray() : NULL,
+                                                       width, height, x1, z1, x2, z2, -halfWidth, -halfHeight, maxStep, skirtScale);
             terrain->_patches.push_back(patch);
 
             // Append the new patch's local bounds to the terrain local bounds
             bounds.merge(patch->getBoundingBox(false));
         }
+        if (row == 0)
+            columns = terrain->_patches.size();
+    }
+
+    // Organize the patches, which are stored row by row, in a quadtree
+    if (columns > 0)
+        terrain->_quadTree = terrain->createQuadNode(0, 0, terrain->_patches.size() / columns, columns, columns);
+
+    if (pages)
+    {
+        pages->patchSize = patchSize;
+        pages->patchColumns = columns;
+        pages->wanted.resize(terrain->_patches.size());
     }
 
     // Read additional layer information from properties (if specified)
@@ -393,13 +519,17 @@ void Terrain::setNode(Node* node)
         {
             _patches[i]->updateNodeBindings();
         }
-        _dirtyFlags |= DIRTY_FLAG_INVERSE_WORLD;
+        _dirtyFlags |= DIRTY_FLAG_INVERSE_WORLD | DIRTY_FLAG_BOUNDS;
+        if (_pages)
+            _pages->dirty = true;
     }
 }
 
 void Terrain::transformChanged(Transform* transform, long cookie)
 {
-    _dirtyFlags |= DIRTY_FLAG_INVERSE_WORLD;
+    _dirtyFlags |= DIRTY_FLAG_INVERSE_WORLD | DIRTY_FLAG_BOUNDS;
+    if (_pages)
+        _pages->dirty = true;
 }
 
 const Matrix& Terrain::getInverseWorldMatrix() const
@@ -470,12 +600,14 @@ void Terrain::setFlag(Flags flag, bool on)
         }
     }
 
-    if (flag == DEBUG_PATCHES && changed)
+    if ((flag == DEBUG_PATCHES || flag == TEXTURE_ARRAYS || flag == COMPOSITING) && changed)
     {
-        // Dirty all materials since they need to be updated to support debug drawing
+        // Dirty all materials since they need to be updated to support debug drawing, texture arrays and compositing
         for (size_t i = 0, count = _patches.size(); i < count; ++i)
         {
             _patches[i]->setMaterialDirty();
+            if (flag == COMPOSITING && !on)
+                _patches[i]->releaseComposite();
         }
     }
 }
@@ -498,8 +630,8 @@ const BoundingBox& Terrain::getBoundingBox() const
 float Terrain::getHeight(float x, float z) const
 {
     // Calculate the correct x, z position relative to the heightfield data.
-    float cols = _heightfield->getColumnCount();
-    float rows = _heightfield->getRowCount();
+    float cols = _heightfield ? _heightfield->getColumnCount() : _pages->columns;
+    float rows = _heightfield ? _heightfield->getRowCount() : _pages->rows;
 
     GP_ASSERT(cols > 0);
     GP_ASSERT(rows > 0);
@@ -511,8 +643,20 @@ float Terrain::getHeight(float x, float z) const
     x = v.x + (cols - 1) * 0.5f;
     z = v.z + (rows - 1) * 0.5f;
 
-    // Get the unscaled height value from the HeightField
-    float height = _heightfield->getHeight(x, z);
+    // Get the unscaled height value from the HeightField, or from the patch of a paged terrain if it is resident
+    float height = 0.0f;
+    if (_heightfield)
+    {
+        height = _heightfield->getHeight(x, z);
+    }
+    else
+    {
+        unsigned int column = std::min((unsigned int)std::max(x, 0.0f) / _pages->patchSize, _pages->patchColumns - 1);
+        unsigned int row = std::min((unsigned int)std::max(z, 0.0f) / _pages->patchSize, (unsigned int)_patches.size() / _pages->patchColumns - 1);
+        TerrainPatch* patch = _patches[row * _pages->patchColumns + column];
+        if (patch->_pageState == TerrainPatch::PAGE_RESIDENT)
+            height = patch->getTileHeight(x, z);
+    }
 
     // Apply world scale to the height value
     if (_node)
@@ -530,12 +674,289 @@ float Terrain::getHeight(float x, float z) const
 
 unsigned int Terrain::draw(bool wireframe)
 {
-    size_t visibleCount = 0;
-    for (size_t i = 0, count = _patches.size(); i < count; ++i)
+    GP_PROFILE_GPU_SCOPE("Terrain::draw");
+    Scene* scene = _node ? _node->getScene() : NULL;
+    Camera* camera = scene ? scene->getActiveCamera() : NULL;
+    if (!camera || !_quadTree)
+        return 0;
+
+    if (_pages)
+        updatePages(camera);
+    _composites = 0;
+
+    // Update the world-space bounds of the patches and the quadtree after the terrain moved
+    if (_dirtyFlags & DIRTY_FLAG_BOUNDS)
+    {
+        _dirtyFlags &= ~DIRTY_FLAG_BOUNDS;
+        _lodDistance = 0.0f;
+        for (size_t i = 0, count = _patches.size(); i < count; ++i)
+        {
+            _patches[i]->setBoundsDirty();
+            if (_geomorphing)
+            {
+                const BoundingBox& patchBounds = _patches[i]->getBoundingBox(true);
+                _lodDistance = std::max(_lodDistance, patchBounds.min.distance(patchBounds.max) * 2.0f);
+            }
+        }
+        updateQuadNodeBounds(_quadTree);
+    }
+
+    return drawQuadNode(_quadTree, camera, wireframe, isFlagSet(FRUSTUM_CULLING), -1);
+}
+
+Terrain::QuadNode* Terrain::createQuadNode(unsigned int row1, unsigned int column1, unsigned int row2, unsigned int column2, unsigned int columns)
+{
+    QuadNode* node = new QuadNode();
+    if (row2 - row1 == 1 && column2 - column1 == 1)
+    {
+        node->patch = _patches[row1 * columns + column1];
+        return node;
+    }
+
+    // Split the range in halves along each side that is longer than one patch
+    unsigned int rowSplit = row2 - row1 > 1 ? (row1 + row2) / 2 : row2;
+    unsigned int columnSplit = column2 - column1 > 1 ? (column1 + column2) / 2 : column2;
+    unsigned int child = 0;
+    node->children[child++] = createQuadNode(row1, column1, rowSplit, columnSplit, columns);
+    if (columnSplit < column2)
+        node->children[child++] = createQuadNode(row1, columnSplit, rowSplit, column2, columns);
+    if (rowSplit < row2)
+    {
+        node->children[child++] = createQuadNode(rowSplit, column1, row2, columnSplit, columns);
+        if (columnSplit < column2)
+            node->children[child++] = createQuadNode(rowSplit, columnSplit, row2, column2, columns);
+    }
+    return node;
+}
+
+void Terrain::updateQuadNodeBounds(QuadNode* node)
+{
+    if (node->patch)
+    {
+        node->bounds.set(node->patch->getBoundingBox(true));
+        return;
+    }
+
+    // Merge the world-space bounds of the children, which are tighter than the transformed local bounds
+    for (unsigned int i = 0; i < 4 && node->children[i]; ++i)
+    {
+        updateQuadNodeBounds(node->children[i]);
+        if (i == 0)
+            node->bounds.set(node->children[i]->bounds);
+        else
+            node->bounds.merge(node->children[i]->bounds);
+    }
+}
+
+unsigned int Terrain::drawQuadNode(QuadNode* node, Camera* camera, bool wireframe, bool cull, int level)
+{
+    if (cull)
+    {
+        // Cull the node if it is outside of any plane of the view frustum, and stop testing
+        // the nodes below it if it is inside of all of them.
+        const Frustum& frustum = camera->getFrustum();
+        const Plane* planes[6] = { &frustum.getNear(), &frustum.getFar(), &frustum.getLeft(),
+                                   &frustum.getRight(), &frustum.getBottom(), &frustum.getTop() };
+        cull = false;
+        for (unsigned int i = 0; i < 6; ++i)
+        {
+            float result = node->bounds.intersects(*planes[i]);
+            if (result == Plane::INTERSECTS_BACK)
+                return 0;
+            if (result == Plane::INTERSECTS_INTERSECTING)
+                cull = true;
+        }
+    }
+
+    if (node->patch)
+        return node->patch->draw(wireframe, camera, level);
+
+    // The patches of a node cover at most as much of the screen as the node, so if it
+    // is drawn at the lowest level of detail, so are all of them.
+    if (level < 0 && isFlagSet(LEVEL_OF_DETAIL))
+    {
+        unsigned int maxLevel = _patches[0]->getLevelCount() - 1;
+        if (maxLevel > 0 && TerrainPatch::computeLevel(this, camera, node->bounds, maxLevel) == maxLevel)
+            level = (int)maxLevel;
+    }
+
+    unsigned int drawCalls = 0;
+    for (unsigned int i = 0; i < 4 && node->children[i]; ++i)
+        drawCalls += drawQuadNode(node->children[i], camera, wireframe, cull, level);
+    return drawCalls;
+}
+
+void Terrain::updatePages(Camera* camera)
+{
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    GP_ASSERT(jobSystem);
+
+    // Build the patches whose heights have been read, a few per frame.
+    unsigned int loads = 0;
+    for (size_t i = 0; i < _pages->requests.size() && loads < TERRAIN_PAGE_MAX_LOADS;)
+    {
+        PageRequest* request = _pages->requests[i];
+        if (!jobSystem->isFinished(request->job))
+        {
+            ++i;
+            continue;
+        }
+
+        jobSystem->release(request->job);
+        TerrainPatch* patch = request->patch;
+        if (patch && request->failed)
+        {
+            // Leave the patch out rather than reading it again every frame
+            GP_WARN("Failed to read the heights of terrain patch %u from: %s", patch->_index, request->path.c_str());
+            patch->_pageState = TerrainPatch::PAGE_FAILED;
+        }
+        else if (patch)
+        {
+            patch->load(request->heights, request->x1, request->z1, request->x2 - request->x1 + 1, _pages->columns, _pages->rows);
+            _dirtyFlags |= DIRTY_FLAG_BOUNDS;
+            ++loads;
+        }
+        SAFE_DELETE(request);
+        _pages->requests.erase(_pages->requests.begin() + i);
+    }
+
+    // Select the patches nearest to the camera once it has moved by a quarter of a patch.
+    Vector3 position = camera->getNode() ? camera->getNode()->getTranslationWorld() : Vector3::zero();
+    const BoundingBox& firstBounds = _patches[0]->getBoundingBox(true);
+    float threshold = (firstBounds.max.x - firstBounds.min.x) * 0.25f;
+    if (_pages->dirty || position.distanceSquared(_pages->cameraPosition) > threshold * threshold)
+    {
+        _pages->dirty = false;
+        _pages->cameraPosition = position;
+
+        std::vector<std::pair<float, unsigned int> >& distances = _pages->distances;
+        distances.resize(_patches.size());
+        for (size_t i = 0, count = _patches.size(); i < count; ++i)
+            distances[i] = std::make_pair(TerrainPatch::computeDistance(position, _patches[i]->getBoundingBox(true)), (unsigned int)i);
+        size_t residentCount = std::min((size_t)_pages->maxResident, distances.size());
+        std::partial_sort(distances.begin(), distances.begin() + residentCount, distances.end());
+
+        std::fill(_pages->wanted.begin(), _pages->wanted.end(), false);
+        _pages->queue.clear();
+        for (size_t i = 0; i < residentCount; ++i)
+        {
+            TerrainPatch* patch = _patches[distances[i].second];
+            _pages->wanted[patch->_index] = true;
+            if (patch->_pageState == TerrainPatch::PAGE_UNLOADED)
+                _pages->queue.push_back(patch);
+        }
+
+        // Page out the patches that are no longer wanted, and drop the heights that are being read for them.
+        for (size_t i = 0, count = _patches.size(); i < count; ++i)
+        {
+            TerrainPatch* patch = _patches[i];
+            if (_pages->wanted[i])
+                continue;
+            if (patch->_pageState == TerrainPatch::PAGE_RESIDENT)
+            {
+                patch->unload();
+            }
+            else if (patch->_pageState == TerrainPatch::PAGE_LOADING)
+            {
+                for (size_t j = 0, requestCount = _pages->requests.size(); j < requestCount; ++j)
+                {
+                    if (_pages->requests[j]->patch == patch)
+                        _pages->requests[j]->patch = NULL;
+                }
+                patch->_pageState = TerrainPatch::PAGE_UNLOADED;
+            }
+        }
+    }
+
+    // Start reading the heights of the nearest patches first.
+    while (!_pages->queue.empty() && _pages->requests.size() < TERRAIN_PAGE_MAX_REQUESTS)
     {
-        visibleCount += _patches[i]->draw(wireframe);
+        TerrainPatch* patch = _pages->queue.front();
+        _pages->queue.erase(_pages->queue.begin());
+        if (patch->_pageState != TerrainPatch::PAGE_UNLOADED)
+            continue;
+
+        // The tile extends past the patch by the largest step, for the normals of every level of detail.
+        PageRequest* request = new PageRequest();
+        request->patch = patch;
+        request->path = _pages->path;
+        request->columns = _pages->columns;
+        request->bits = _pages->bits;
+        request->x1 = patch->_x1 > patch->_maxStep ? patch->_x1 - patch->_maxStep : 0;
+        request->z1 = patch->_z1 > patch->_maxStep ? patch->_z1 - patch->_maxStep : 0;
+        request->x2 = std::min(patch->_x2 + patch->_maxStep, _pages->columns - 1);
+        request->z2 = std::min(patch->_z2 + patch->_maxStep, _pages->rows - 1);
+        request->failed = false;
+        request->job = jobSystem->create(&Terrain::pageProc, request);
+        patch->_pageState = TerrainPatch::PAGE_LOADING;
+        _pages->requests.push_back(request);
+        jobSystem->run(request->job);
     }
-    return visibleCount;
+}
+
+void Terrain::pageProc(void* cookie)
+{
+    PageRequest* request = (PageRequest*)cookie;
+
+    std::unique_ptr<Stream> stream(FileSystem::open(request->path.c_str()));
+    if (stream.get() == NULL)
+    {
+        request->failed = true;
+        return;
+    }
+
+    // Read the part of each row of the RAW file that the tile covers, and normalize its heights.
+    unsigned int bytes = request->bits / 8;
+    unsigned int pitch = request->x2 - request->x1 + 1;
+    std::vector<unsigned char> row(pitch * bytes);
+    request->heights.resize(pitch * (request->z2 - request->z1 + 1));
+    float* heights = &request->heights[0];
+    for (unsigned int z = request->z1; z <= request->z2; ++z)
+    {
+        long int offset = (long int)(((size_t)z * request->columns + request->x1) * bytes);
+        if (!stream->seek(offset, SEEK_SET) || stream->read(&row[0], 1, row.size()) != row.size())
+        {
+            request->failed = true;
+            request->heights.clear();
+            return;
+        }
+
+        for (unsigned int x = 0; x < pitch; ++x)
+        {
+            if (bytes == 2)
+                *heights++ = (row[x * 2] | (int)row[x * 2 + 1] << 8) / 65535.0f;
+            else
+                *heights++ = row[x] / 255.0f;
+        }
+    }
+}
+
+Mesh* Terrain::beginComposite()
+{
+    // Compositing binds a frame buffer of its own, which cannot be done while draws are recorded
+    if (_composites >= TERRAIN_COMPOSITE_MAX_PATCHES || RenderCommandList::getRecording())
+        return NULL;
+
+    if (!_compositeQuad)
+    {
+        // The quad covers the whole frame buffer, as a triangle strip
+        VertexFormat::Element vertexElements[] =
+        {
+            VertexFormat::Element(VertexFormat::POSITION, 2)
+        };
+        _compositeQuad = Mesh::createMesh(VertexFormat(vertexElements, 1), 4, false);
+        if (!_compositeQuad)
+        {
+            GP_WARN("Failed to create the quad that the layers of terrain patches are composited with.");
+            return NULL;
+        }
+        float vertices[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+        _compositeQuad->setVertexData(vertices, 0, 4);
+        _compositeQuad->setPrimitiveType(Mesh::TRIANGLE_STRIP);
+    }
+
+    ++_composites;
+    return _compositeQuad;
 }
 
 Drawable* Terrain::clone(NodeCloneContext& context)
@@ -544,6 +965,17 @@ Drawable* Terrain::clone(NodeCloneContext& context)
     return NULL;
 }
 
+Terrain::QuadNode::QuadNode() : patch(NULL)
+{
+    children[0] = children[1] = children[2] = children[3] = NULL;
+}
+
+Terrain::QuadNode::~QuadNode()
+{
+    for (unsigned int i = 0; i < 4; ++i)
+        SAFE_DELETE(children[i]);
+}
+
 static float getDefaultHeight(unsigned int width, unsigned int height)
 {
     // When terrain height is not specified, we'll use a default height of ~ 0.3 of the image dimensions
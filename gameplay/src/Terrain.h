@@ -55,18 +55,44 @@ class TerrainAutoBindingResolver;
  * the generated terrain geometry data.
  *
  * Internally, Terrain is broken into smaller, more manageable patches, which can be culled
- * separately for more efficient rendering. The size of the terrain patches can be controlled
- * via the patchSize property. Patches can be previewed by enabling the DEBUG_PATCHES flag
+ * separately for more efficient rendering. The patches are organized in a quadtree whose nodes
+ * bound the patches below them, so that the patches of a node that is outside of the view are
+ * culled at once, and those of a node inside of it are not tested. The size of the terrain
+ * patches can be controlled via the patchSize property. Patches can be previewed by enabling the DEBUG_PATCHES flag
  * via the setFlag method. Other terrain behavior can also be enabled and disabled using terrain
  * flags.
  *
  * Level of detail (LOD) is supported using a technique that is similar to texture mipmapping.
  * A distance-to-camera based test, using a simple screen-space error metric is used to decide
- * the appropriate LOD for a terrain patch. The number of LOD levels is 1 by default (which
+ * the appropriate LOD for a terrain patch. When the error metric picks the lowest level for a
+ * quadtree node, all of the patches below it are drawn at that level without testing them. The number of LOD levels is 1 by default (which
  * means only the base level is used), but can be specified via the detailLevels property.
  * Using too large a number for detailLevels can result in excessive popping in the distance
  * for very hilly terrains, so a smaller number (2-3) often works best in these cases.
  *
+ * Popping can be removed by setting the geomorphing property to true in the terrain file. The levels
+ * of detail of a patch then share the vertices of one full resolution mesh and only differ in their
+ * indices, and the vertex shader moves the vertices that the next level drops onto its surface as
+ * they approach the distance at which the next level starts. These distances double with every
+ * level, starting at twice the size of a patch, instead of following the screen-space error metric.
+ *
+ * Terrains that are too large to keep in memory can be paged from a RAW heightmap by setting the
+ * paged property to true. Only the nearest patches to the camera (64 by default, which can be set with
+ * the residentPatches property) are then resident: their heights are read from the RAW file on the
+ * worker threads of the job system as the camera moves, their geometry and materials are built once
+ * the heights have been read, and they release their geometry and layer textures when they are paged
+ * out again. Patches that are not resident are not drawn, and getHeight returns zero over them. Paged
+ * terrains cannot be used for heightfield collision shapes, since their heights are not all in memory.
+ *
+ * The cost of shading the terrain grows with the number of layers, since each pixel samples the textures
+ * and the blend maps of all of them. With the COMPOSITING flag, which can be set with the compositing
+ * property, the layers of each patch are instead composited into a texture of its own once, and the
+ * patch samples only that texture. The textures of the nearest patches have the size that is set with
+ * the compositeSize property (512 by default), and the size halves with each level of detail, so the
+ * detail of the composited textures follows the camera. A few patches are composited each frame as they
+ * come into view or change their level, and again after their layers change; the patches that are not
+ * composited yet sample their layers.
+ *
  * Finally, when LOD is enabled, cracks can begin to appear between terrain patches of
  * different LOD levels. If the cracks are only minor (depends on your terrain topology
  * and textures used), an acceptable approach might be to simply use a background clear
@@ -116,7 +142,28 @@ public:
           * "detailLevels" was not set to a value greater than 1 in the terrain
           * properties file at creation time.
           */
-         LEVEL_OF_DETAIL = 8
+         LEVEL_OF_DETAIL = 8,
+
+         /**
+          * Samples the layers of each patch from a single texture array (on by default).
+          *
+          * This does nothing on devices that do not support texture arrays (see
+          * Texture::isArraySupported), or for patches whose layer textures are not PNG
+          * images of the same size, which are sampled from a texture each. Custom terrain
+          * shaders must handle the TEXTURE_ARRAY define, like res/shaders/terrain.frag,
+          * or turn this flag off.
+          */
+         TEXTURE_ARRAYS = 16,
+
+         /**
+          * Composites the layers of each patch into a texture that the patch samples (off by default).
+          *
+          * The layers are composited with res/shaders/terrain.vert and res/shaders/terrain.frag and
+          * the COMPOSITE define, and the composited textures replace the layers of the patches with
+          * the COMPOSITED define. Custom terrain shaders must handle the COMPOSITED define, like
+          * res/shaders/terrain.frag, or turn this flag off.
+          */
+         COMPOSITING = 32
     };
 
     /**
@@ -301,12 +348,24 @@ private:
      */
     ~Terrain();
 
+    /**
+     * The RAW heightmap file and the resident set of a paged terrain.
+     */
+    struct Pages;
+
+    /**
+     * The heights of a patch that are read from the heightmap file on a worker thread.
+     */
+    struct PageRequest;
+
     /**
      * Internal method for creating terrain.
+     *
+     * @param pages The heightmap file to page the patches from, instead of the heightfield, which the terrain takes.
      */
     static Terrain* create(HeightField* heightfield, const Vector3& scale, 
         unsigned int patchSize, unsigned int detailLevels, float skirtScale, 
-        const char* normalMapPath, const char* materialPath, Properties* properties);
+        const char* normalMapPath, const char* materialPath, Properties* properties, Pages* pages = NULL);
 
     /**
      * Internal method for creating terrain.
@@ -325,15 +384,65 @@ private:
     const Matrix& getInverseWorldMatrix() const;
 
     /**
-     * Returns the local bounding box for this patch, at the base LOD level.
+     * A node of the quadtree of patches, with the world-space bounds of the patches below it.
+     */
+    struct QuadNode
+    {
+        QuadNode();
+
+        ~QuadNode();
+
+        QuadNode* children[4];
+        TerrainPatch* patch;
+        BoundingBox bounds;
+    };
+
+    /**
+     * Builds the quadtree nodes for a range of rows and columns of the patch grid.
+     */
+    QuadNode* createQuadNode(unsigned int row1, unsigned int column1, unsigned int row2, unsigned int column2, unsigned int columns);
+
+    /**
+     * Updates the world-space bounds of a quadtree node and the nodes below it.
+     */
+    void updateQuadNodeBounds(QuadNode* node);
+
+    /**
+     * Draws the visible patches below a quadtree node.
+     *
+     * @param cull Whether the node may be outside of the view, or is known to be inside of it.
+     * @param level The level of detail of the patches, or -1 if each patch computes its own.
+     */
+    unsigned int drawQuadNode(QuadNode* node, Camera* camera, bool wireframe, bool cull, int level);
+
+    /**
+     * Builds the paged patches whose heights have been read, and pages in the patches nearest to the camera.
+     */
+    void updatePages(Camera* camera);
+
+    /**
+     * Reads the heights of a paged patch on a worker thread.
+     */
+    static void pageProc(void* cookie);
+
+    /**
+     * Returns the quad that the layers of the patches are composited with, and counts one more patch
+     * composited in this frame, or returns NULL if no more patches can be composited in this frame.
      */
-    BoundingBox getBoundingBox(bool worldSpace) const;
+    Mesh* beginComposite();
 
     std::string _materialPath;
     HeightField* _heightfield;
     Vector3 _localScale;
     std::vector<TerrainPatch*> _patches;
+    QuadNode* _quadTree;
     Texture::Sampler* _normalMap;
+    bool _geomorphing;
+    float _lodDistance;
+    Pages* _pages;
+    Mesh* _compositeQuad;
+    unsigned int _compositeSize;
+    unsigned int _composites;
     unsigned int _flags;
     mutable Matrix _inverseWorldMatrix;
     mutable unsigned int _dirtyFlags;
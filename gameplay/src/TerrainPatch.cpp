@@ -4,10 +4,15 @@
 #include "MeshPart.h"
 #include "Scene.h"
 #include "Game.h"
+#include "FrameBuffer.h"
+#include "GraphicsDevice.h"
 
 namespace gameplay
 {
 
+// Utility function (shared with Scene).
+extern bool endsWith(const char* str, const char* suffix, bool ignoreCase);
+
 /**
  * @script{ignore}
  */
@@ -17,6 +22,17 @@ template <class T> T clamp(T value, T min, T max) { return value < min ? min : (
 #define TERRAINPATCH_DIRTY_BOUNDS 2
 #define TERRAINPATCH_DIRTY_LEVEL 4
 #define TERRAINPATCH_DIRTY_ALL (TERRAINPATCH_DIRTY_MATERIAL | TERRAINPATCH_DIRTY_BOUNDS | TERRAINPATCH_DIRTY_LEVEL)
+#define TERRAINPATCH_DIRTY_COMPOSITE 8
+#define TERRAINPATCH_COMPOSITE_FAILED 16
+
+// The shaders that the layers of patches are composited with
+#define TERRAINPATCH_COMPOSITE_VSH "res/shaders/terrain.vert"
+#define TERRAINPATCH_COMPOSITE_FSH "res/shaders/terrain.frag"
+// The smallest size of the composited texture of a patch, at its lowest levels of detail
+#define TERRAINPATCH_COMPOSITE_MIN_SIZE 32
+
+// The part of the distance of a level of detail over which a geomorphing terrain morphs to the next level
+#define TERRAINPATCH_MORPH_RANGE 0.3f
 
 /**
  * Custom material auto-binding resolver for terrain.
@@ -30,7 +46,9 @@ static TerrainAutoBindingResolver __autoBindingResolver;
 static int __currentPatchIndex = -1;
 
 TerrainPatch::TerrainPatch() :
-    _terrain(NULL), _row(0), _column(0), _camera(NULL), _level(0), _bits(TERRAINPATCH_DIRTY_ALL)
+    _terrain(NULL), _row(0), _column(0), _layerArray(NULL), _composite(NULL), _compositeMaterial(NULL), _compositeSize(0), _x1(0), _z1(0), _x2(0), _z2(0), _xOffset(0.0f), _zOffset(0.0f), _maxStep(1),
+    _verticalSkirtSize(0.0f), _heightsX(0), _heightsZ(0), _heightsPitch(0), _pageState(PAGE_RESIDENT),
+    _camera(NULL), _level(0), _bits(TERRAINPATCH_DIRTY_ALL)
 {
 }
 
@@ -48,6 +66,9 @@ TerrainPatch::~TerrainPatch()
     {
         deleteLayer(*_layers.begin());
     }
+    SAFE_RELEASE(_layerArray);
+    SAFE_RELEASE(_composite);
+    SAFE_RELEASE(_compositeMaterial);
     SAFE_RELEASE(_camera);
 }
 
@@ -64,18 +85,120 @@ TerrainPatch* TerrainPatch::create(Terrain* terrain, unsigned int index,
     patch->_index = index;
     patch->_row = row;
     patch->_column = column;
+    patch->_x1 = x1;
+    patch->_z1 = z1;
+    patch->_x2 = x2;
+    patch->_z2 = z2;
+    patch->_xOffset = xOffset;
+    patch->_zOffset = zOffset;
+    patch->_maxStep = maxStep;
+    patch->_verticalSkirtSize = verticalSkirtSize;
+    patch->_compositeRect.set((float)x1 / width, 1.0f - (float)z2 / height, (float)(x2 - x1) / width, (float)(z2 - z1) / height);
+
+    if (heights)
+    {
+        patch->_heightsPitch = width;
+        patch->build(heights, width, height);
+    }
+    else
+    {
+        // Until a paged patch is loaded, it is bounded by the whole range of heights
+        const Vector3& scale = terrain->_localScale;
+        patch->_boundingBox.set(Vector3((x1 + xOffset) * scale.x, 0.0f, (z1 + zOffset) * scale.z),
+                                Vector3((x2 + xOffset) * scale.x, scale.y, (z2 + zOffset) * scale.z));
+        patch->_pageState = PAGE_UNLOADED;
+    }
 
+    return patch;
+}
+
+void TerrainPatch::build(float* heights, unsigned int width, unsigned int height)
+{
     // Add patch lods
-    for (unsigned int step = 1; step <= maxStep; step *= 2)
+    if (_terrain->_geomorphing)
     {
-        patch->addLOD(heights, width, height, x1, z1, x2, z2, xOffset, zOffset, step, verticalSkirtSize);
+        addMorphLevels(heights, width, height, _x1, _z1, _x2, _z2, _xOffset, _zOffset, _maxStep, _verticalSkirtSize);
+    }
+    else
+    {
+        for (unsigned int step = 1; step <= _maxStep; step *= 2)
+        {
+            addLOD(heights, width, height, _x1, _z1, _x2, _z2, _xOffset, _zOffset, step, _verticalSkirtSize);
+        }
     }
 
     // Set our bounding box using the base LOD mesh
-    BoundingBox& bounds = patch->_boundingBox;
-    bounds.set(patch->_levels[0]->model->getMesh()->getBoundingBox());
+    _boundingBox.set(_levels[0]->model->getMesh()->getBoundingBox());
+    _bits |= TERRAINPATCH_DIRTY_ALL;
+}
 
-    return patch;
+void TerrainPatch::load(std::vector<float>& heights, unsigned int x, unsigned int z, unsigned int pitch, unsigned int width, unsigned int height)
+{
+    GP_ASSERT(_pageState != PAGE_RESIDENT);
+    GP_ASSERT(!heights.empty() && heights.size() % pitch == 0);
+
+    _heights.swap(heights);
+    _heightsX = x;
+    _heightsZ = z;
+    _heightsPitch = pitch;
+    build(&_heights[0], width, height);
+
+    _pageState = PAGE_RESIDENT;
+    for (size_t i = 0, count = _layerSources.size(); i < count; ++i)
+    {
+        const LayerSource& source = _layerSources[i];
+        if (!loadLayer(source.index, source.texturePath.c_str(), source.textureRepeat,
+                       source.blendPath.empty() ? NULL : source.blendPath.c_str(), source.blendChannel))
+        {
+            GP_WARN("Failed to load terrain layer: %s", source.texturePath.c_str());
+        }
+    }
+}
+
+void TerrainPatch::unload()
+{
+    for (size_t i = 0, count = _levels.size(); i < count; ++i)
+    {
+        Level* level = _levels[i];
+
+        SAFE_RELEASE(level->model);
+        SAFE_DELETE(level);
+    }
+    _levels.clear();
+
+    while (_layers.size() > 0)
+    {
+        deleteLayer(*_layers.begin());
+    }
+    _samplers.clear();
+    SAFE_RELEASE(_layerArray);
+    SAFE_RELEASE(_composite);
+    SAFE_RELEASE(_compositeMaterial);
+    _compositeSize = 0;
+
+    std::vector<float>().swap(_heights);
+    _level = 0;
+    _bits |= TERRAINPATCH_DIRTY_MATERIAL;
+    _pageState = PAGE_UNLOADED;
+}
+
+float TerrainPatch::getTileHeight(float column, float row) const
+{
+    GP_ASSERT(!_heights.empty());
+
+    // Interpolate between the heights around the position, clamped to the tile
+    unsigned int rows = (unsigned int)_heights.size() / _heightsPitch;
+    float x = clamp(column - _heightsX, 0.0f, (float)(_heightsPitch - 1));
+    float z = clamp(row - _heightsZ, 0.0f, (float)(rows - 1));
+    unsigned int x1 = (unsigned int)x;
+    unsigned int z1 = (unsigned int)z;
+    unsigned int x2 = std::min(x1 + 1, _heightsPitch - 1);
+    unsigned int z2 = std::min(z1 + 1, rows - 1);
+    float xFactor = x - x1;
+    float zFactor = z - z1;
+    float h1 = _heights[z1 * _heightsPitch + x1] * (1.0f - xFactor) + _heights[z1 * _heightsPitch + x2] * xFactor;
+    float h2 = _heights[z2 * _heightsPitch + x1] * (1.0f - xFactor) + _heights[z2 * _heightsPitch + x2] * xFactor;
+    return h1 * (1.0f - zFactor) + h2 * zFactor;
 }
 
 unsigned int TerrainPatch::getMaterialCount() const
@@ -85,6 +208,9 @@ unsigned int TerrainPatch::getMaterialCount() const
 
 Material* TerrainPatch::getMaterial(int index) const
 {
+    if (_levels.empty())
+        return NULL;
+
     if (index == -1)
     {
         Scene* scene = _terrain->_node ? _terrain->_node->getScene() : NULL;
@@ -97,9 +223,9 @@ Material* TerrainPatch::getMaterial(int index) const
         {
             _level = 0;
         }
-        return _levels[_level]->model->getMaterial();
+        return _levels[_level]->model->getMaterial(_levels[_level]->part);
     }
-    return _levels[index]->model->getMaterial();
+    return _levels[index]->model->getMaterial(_levels[index]->part);
 }
 
 void TerrainPatch::addLOD(float* heights, unsigned int width, unsigned int height,
@@ -136,8 +262,6 @@ void TerrainPatch::addLOD(float* heights, unsigned int width, unsigned int heigh
     unsigned int index = 0;
     Vector3 min(FLT_MAX, FLT_MAX, FLT_MAX);
     Vector3 max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
-    float stepXScaled = step * _terrain->_localScale.x;
-    float stepZScaled = step * _terrain->_localScale.z;
     bool zskirt = verticalSkirtSize > 0 ? true : false;
     for (unsigned int z = z1; ; )
     {
@@ -151,7 +275,7 @@ void TerrainPatch::addLOD(float* heights, unsigned int width, unsigned int heigh
 
             // Compute position - apply the local scale of the terrain into the vertex data
             v[0] = (x + xOffset) * _terrain->_localScale.x;
-            v[1] = computeHeight(heights, width, x, z);
+            v[1] = computeHeight(heights, x, z);
             if (xskirt || zskirt)
                 v[1] -= verticalSkirtSize * _terrain->_localScale.y;
             v[2] = (z + zOffset) * _terrain->_localScale.z;
@@ -176,18 +300,7 @@ void TerrainPatch::addLOD(float* heights, unsigned int width, unsigned int heigh
             // Compute normal
             if (!_terrain->_normalMap)
             {
-                Vector3 p(v[0], computeHeight(heights, width, x, z), v[2]);
-                Vector3 w(Vector3(x>=step ? v[0]-stepXScaled : v[0], computeHeight(heights, width, x>=step ? x-step : x, z), v[2]), p);
-                Vector3 e(Vector3(x<width-step ? v[0]+stepXScaled : v[0], computeHeight(heights, width, x<width-step ? x+step : x, z), v[2]), p);
-                Vector3 s(Vector3(v[0], computeHeight(heights, width, x, z>=step ? z-step : z), z>=step ? v[2]-stepZScaled : v[2]), p);
-                Vector3 n(Vector3(v[0], computeHeight(heights, width, x, z<height-step ? z+step : z), z<height-step ? v[2]+stepZScaled : v[2]), p);
-                Vector3 normals[4];
-                Vector3::cross(n, w, &normals[0]);
-                Vector3::cross(w, s, &normals[1]);
-                Vector3::cross(e, n, &normals[2]);
-                Vector3::cross(s, e, &normals[3]);
-                Vector3 normal = -(normals[0] + normals[1] + normals[2] + normals[3]);
-                normal.normalize();
+                Vector3 normal = computeNormal(heights, width, height, x, z, step);
                 v[3] = normal.x;
                 v[4] = normal.y;
                 v[5] = normal.z;
@@ -342,37 +455,260 @@ void TerrainPatch::addLOD(float* heights, unsigned int width, unsigned int heigh
     _levels.push_back(level);
 }
 
-void TerrainPatch::deleteLayer(Layer* layer)
+/**
+ * Returns the highest level of detail whose grid has a line at a coordinate of a patch.
+ *
+ * @script{ignore}
+ */
+static unsigned int getLineLevel(unsigned int c, unsigned int c1, unsigned int c2, unsigned int maxLevel)
 {
-    // Release layer samplers
-    if (layer->textureIndex != -1)
+    // The first and the last lines are in every level, the others in the levels whose step divides their offset.
+    if (c == c1 || c == c2)
+        return maxLevel;
+    unsigned int level = 0;
+    while (level < maxLevel && (c - c1) % (2u << level) == 0)
+        ++level;
+    return level;
+}
+
+void TerrainPatch::addMorphLevels(float* heights, unsigned int width, unsigned int height,
+                                  unsigned int x1, unsigned int z1, unsigned int x2, unsigned int z2,
+                                  float xOffset, float zOffset,
+                                  unsigned int maxStep, float verticalSkirtSize)
+{
+    unsigned int maxLevel = 0;
+    while ((2u << maxLevel) <= maxStep)
+        ++maxLevel;
+
+    // Every line of the heightfield within the patch, and a skirt line on each side
+    bool skirts = verticalSkirtSize > 0.0f;
+    unsigned int border = skirts ? 1 : 0;
+    unsigned int patchWidth = (x2 - x1) + 1 + border * 2;
+    unsigned int patchHeight = (z2 - z1) + 1 + border * 2;
+    unsigned int vertexCount = patchHeight * patchWidth;
+    if (vertexCount > USHRT_MAX + 1)
     {
-        if (_samplers[layer->textureIndex]->getRefCount() == 1)
-        {
-            SAFE_RELEASE(_samplers[layer->textureIndex]);
-        }
-        else
+        GP_WARN("Vertex count of %d for geomorphing terrain patch exceeds the limit of 65536. Please specifiy a smaller patch size.", vertexCount);
+        GP_ASSERT(vertexCount <= USHRT_MAX + 1);
+    }
+
+    unsigned int vertexElements = _terrain->_normalMap ? 7 : 10; //<x,y,z>[i,j,k]<u,v><morph offset,morph level>
+    float* vertices = new float[vertexCount * vertexElements];
+    Vector3 min(FLT_MAX, FLT_MAX, FLT_MAX);
+    Vector3 max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (unsigned int j = 0; j < patchHeight; ++j)
+    {
+        bool zskirt = skirts && (j == 0 || j == patchHeight - 1);
+        unsigned int z = j < border ? z1 : std::min(z1 + j - border, z2);
+
+        for (unsigned int i = 0; i < patchWidth; ++i)
         {
-            _samplers[layer->textureIndex]->release();
+            bool xskirt = skirts && (i == 0 || i == patchWidth - 1);
+            unsigned int x = i < border ? x1 : std::min(x1 + i - border, x2);
+
+            float* v = vertices + ((j * patchWidth + i) * vertexElements);
+
+            // Compute position - apply the local scale of the terrain into the vertex data
+            float y = computeHeight(heights, x, z);
+            v[0] = (x + xOffset) * _terrain->_localScale.x;
+            v[1] = y;
+            if (xskirt || zskirt)
+                v[1] -= verticalSkirtSize * _terrain->_localScale.y;
+            v[2] = (z + zOffset) * _terrain->_localScale.z;
+
+            // Update bounding box min/max (don't include vertical skirt vertices in bounding box)
+            if (!(xskirt || zskirt))
+            {
+                min.set(std::min(min.x, v[0]), std::min(min.y, v[1]), std::min(min.z, v[2]));
+                max.set(std::max(max.x, v[0]), std::max(max.y, v[1]), std::max(max.z, v[2]));
+            }
+
+            // Compute normal
+            if (!_terrain->_normalMap)
+            {
+                Vector3 normal = computeNormal(heights, width, height, x, z, 1);
+                v[3] = normal.x;
+                v[4] = normal.y;
+                v[5] = normal.z;
+                v += 3;
+            }
+
+            v += 3;
+
+            // Compute texture coord
+            v[0] = (float)x / width;
+            v[1] = 1.0f - (float)z / height;
+            if (xskirt)
+            {
+                float offset = verticalSkirtSize / width;
+                v[0] = x == x1 ? v[0]-offset : v[0]+offset;
+            }
+            else if (zskirt)
+            {
+                float offset = verticalSkirtSize / height;
+                v[1] = z == z1 ? v[1]-offset : v[1]+offset;
+            }
+
+            // Compute the morph target, which is the height of the surface of the next level below the vertex.
+            // Skirt vertices move with the border vertex above them.
+            v[2] = 0.0f;
+            v[3] = -1.0f;
+            unsigned int levelX = getLineLevel(x, x1, x2, maxLevel);
+            unsigned int levelZ = getLineLevel(z, z1, z2, maxLevel);
+            unsigned int level = std::min(levelX, levelZ);
+            if (level < maxLevel)
+            {
+                // Find the cell of the next level around the vertex, along the lines that are not in it.
+                unsigned int step = 1u << level;
+                unsigned int ax = x, bx = x, az = z, bz = z;
+                float tx = 0.0f, tz = 0.0f;
+                if (levelX == level)
+                {
+                    ax = x - step;
+                    bx = std::min(x + step, x2);
+                    tx = (float)(x - ax) / (bx - ax);
+                }
+                if (levelZ == level)
+                {
+                    az = z - step;
+                    bz = std::min(z + step, z2);
+                    tz = (float)(z - az) / (bz - az);
+                }
+
+                // Interpolate within the triangle of the cell that holds the vertex; the strips split cells
+                // along the diagonal from (bx, az) to (ax, bz).
+                float h00 = computeHeight(heights, ax, az);
+                float h10 = computeHeight(heights, bx, az);
+                float h01 = computeHeight(heights, ax, bz);
+                float h11 = computeHeight(heights, bx, bz);
+                float target;
+                if (tx + tz <= 1.0f)
+                    target = h00 + tx * (h10 - h00) + tz * (h01 - h00);
+                else
+                    target = h11 + (1.0f - tx) * (h01 - h11) + (1.0f - tz) * (h10 - h11);
+                v[2] = target - y;
+                v[3] = (float)level;
+            }
         }
     }
 
-    if (layer->blendIndex != -1)
+    Vector3 center(min + ((max - min) * 0.5f));
+
+    // Create mesh
+    VertexFormat::Element elements[4];
+    unsigned int elementCount = 0;
+    elements[elementCount++] = VertexFormat::Element(VertexFormat::POSITION, 3);
+    if (!_terrain->_normalMap)
+        elements[elementCount++] = VertexFormat::Element(VertexFormat::NORMAL, 3);
+    elements[elementCount++] = VertexFormat::Element(VertexFormat::TEXCOORD0, 2);
+    elements[elementCount++] = VertexFormat::Element(VertexFormat::TEXCOORD1, 2);
+    VertexFormat format(elements, elementCount);
+    Mesh* mesh = Mesh::createMesh(format, vertexCount);
+    mesh->setVertexData(vertices);
+    mesh->setBoundingBox(BoundingBox(min, max));
+    mesh->setBoundingSphere(BoundingSphere(center, center.distance(max)));
+    SAFE_DELETE_ARRAY(vertices);
+
+    Model* model = Model::create(mesh);
+    mesh->release();
+
+    // Add a mesh part for the grid lines of each level, which are all lines whose level is at least as high
+    std::vector<unsigned int> columns, rows;
+    std::vector<unsigned short> indices;
+    for (unsigned int levelIndex = 0; levelIndex <= maxLevel; ++levelIndex)
     {
-        if (_samplers[layer->blendIndex]->getRefCount() == 1)
+        columns.clear();
+        for (unsigned int i = 0; i < patchWidth; ++i)
         {
-            SAFE_RELEASE(_samplers[layer->blendIndex]);
+            if (i < border || i >= patchWidth - border || getLineLevel(x1 + i - border, x1, x2, maxLevel) >= levelIndex)
+                columns.push_back(i);
         }
-        else
+        rows.clear();
+        for (unsigned int j = 0; j < patchHeight; ++j)
         {
-            _samplers[layer->blendIndex]->release();
+            if (j < border || j >= patchHeight - border || getLineLevel(z1 + j - border, z1, z2, maxLevel) >= levelIndex)
+                rows.push_back(j);
         }
+
+        unsigned int columnCount = columns.size();
+        unsigned int rowCount = rows.size();
+        unsigned int indexCount = (columnCount * 2) * (rowCount - 1) + (rowCount - 2) * 2;
+        if (indexCount > USHRT_MAX)
+        {
+            GP_WARN("Index count of %d for terrain patch exceeds the limit of 65535. Please specifiy a smaller patch size.", indexCount);
+            GP_ASSERT(indexCount <= USHRT_MAX);
+        }
+
+        // Join the rows into one strip, moving left to right for even rows and right to left for odd rows
+        indices.clear();
+        indices.reserve(indexCount);
+        for (unsigned int z = 0; z < rowCount - 1; ++z)
+        {
+            unsigned int i1 = rows[z] * patchWidth;
+            unsigned int i2 = rows[z + 1] * patchWidth;
+            if (z % 2 == 0)
+            {
+                if (z > 0)
+                {
+                    indices.push_back(indices.back());
+                    indices.push_back((unsigned short)(i1 + columns[0]));
+                }
+                for (unsigned int x = 0; x < columnCount; ++x)
+                {
+                    indices.push_back((unsigned short)(i1 + columns[x]));
+                    indices.push_back((unsigned short)(i2 + columns[x]));
+                }
+            }
+            else
+            {
+                indices.push_back(indices.back());
+                indices.push_back((unsigned short)(i2 + columns[columnCount - 1]));
+                for (int x = (int)columnCount - 1; x >= 0; --x)
+                {
+                    indices.push_back((unsigned short)(i2 + columns[x]));
+                    indices.push_back((unsigned short)(i1 + columns[x]));
+                }
+            }
+        }
+        GP_ASSERT(indices.size() == indexCount);
+        MeshPart* part = mesh->addPart(Mesh::TRIANGLE_STRIP, Mesh::INDEX16, indexCount);
+        part->setIndexData(&indices[0], 0, indexCount);
+
+        // Add this level, which draws its part of the shared model
+        Level* level = new Level();
+        level->model = model;
+        level->part = (int)levelIndex;
+        if (levelIndex > 0)
+            model->addRef();
+        _levels.push_back(level);
     }
+}
+
+void TerrainPatch::deleteLayer(Layer* layer)
+{
+    // Release layer samplers
+    if (layer->textureIndex != -1)
+        releaseSampler(layer->textureIndex);
+
+    if (layer->blendIndex != -1)
+        releaseSampler(layer->blendIndex);
 
     _layers.erase(layer);
     SAFE_DELETE(layer);
 }
 
+void TerrainPatch::releaseSampler(int index)
+{
+    if (_samplers[index]->getRefCount() == 1)
+    {
+        SAFE_RELEASE(_samplers[index]);
+    }
+    else
+    {
+        _samplers[index]->release();
+    }
+}
+
 int TerrainPatch::addSampler(const char* path)
 {
     // TODO: Support shared samplers stored in Terrain class for layers that span all patches
@@ -427,6 +763,32 @@ int TerrainPatch::addSampler(const char* path)
 }
 
 bool TerrainPatch::setLayer(int index, const char* texturePath, const Vector2& textureRepeat, const char* blendPath, int blendChannel)
+{
+    if (_terrain->_pages)
+    {
+        // Paged patches keep the files of their layers, to load them whenever they are paged in
+        LayerSource source;
+        source.index = index;
+        source.texturePath = texturePath;
+        source.textureRepeat = textureRepeat;
+        source.blendPath = blendPath ? blendPath : "";
+        source.blendChannel = blendChannel;
+        size_t i = 0;
+        while (i < _layerSources.size() && _layerSources[i].index != index)
+            ++i;
+        if (i < _layerSources.size())
+            _layerSources[i] = source;
+        else
+            _layerSources.push_back(source);
+
+        if (_pageState != PAGE_RESIDENT)
+            return true;
+    }
+
+    return loadLayer(index, texturePath, textureRepeat, blendPath, blendChannel);
+}
+
+bool TerrainPatch::loadLayer(int index, const char* texturePath, const Vector2& textureRepeat, const char* blendPath, int blendChannel)
 {
     // If there is an existing layer at this index, delete it
     for (std::set<Layer*, LayerCompare>::iterator itr = _layers.begin(); itr != _layers.end(); ++itr)
@@ -439,10 +801,15 @@ bool TerrainPatch::setLayer(int index, const char* texturePath, const Vector2& t
         }
     }
 
-    // Load texture sampler
-    int textureIndex = addSampler(texturePath);
-    if (textureIndex == -1)
-        return false;
+    // Load texture sampler, unless the layer is sampled from the texture array of the patch,
+    // which is created with the material once all the layers are known
+    int textureIndex = -1;
+    if (!useLayerArray() || !endsWith(texturePath, ".png", true))
+    {
+        textureIndex = addSampler(texturePath);
+        if (textureIndex == -1)
+            return false;
+    }
 
     // Load blend sampler
     int blendIndex = -1;
@@ -455,17 +822,69 @@ bool TerrainPatch::setLayer(int index, const char* texturePath, const Vector2& t
     Layer* layer = new Layer();
     layer->index = index;
     layer->textureIndex = textureIndex;
+    layer->texturePath = texturePath;
     layer->textureRepeat = textureRepeat;
     layer->blendIndex = blendIndex;
     layer->blendChannel = blendChannel;
 
     _layers.insert(layer);
 
-    _bits |= TERRAINPATCH_DIRTY_MATERIAL;
+    _bits |= TERRAINPATCH_DIRTY_MATERIAL | TERRAINPATCH_DIRTY_COMPOSITE;
+    _bits &= ~TERRAINPATCH_COMPOSITE_FAILED;
 
     return true;
 }
 
+bool TerrainPatch::useLayerArray() const
+{
+    return _terrain->isFlagSet(Terrain::TEXTURE_ARRAYS) && Texture::isArraySupported();
+}
+
+void TerrainPatch::updateLayerTextures()
+{
+    SAFE_RELEASE(_layerArray);
+
+    // The layers share an array when they are all PNG images, with a layer for each different image
+    bool array = useLayerArray() && !_layers.empty();
+    std::vector<std::string> paths;
+    for (std::set<Layer*, LayerCompare>::iterator itr = _layers.begin(); itr != _layers.end() && array; ++itr)
+    {
+        Layer* layer = *itr;
+        if (!endsWith(layer->texturePath.c_str(), ".png", true))
+        {
+            array = false;
+            break;
+        }
+        layer->arrayIndex = (int)(std::find(paths.begin(), paths.end(), layer->texturePath) - paths.begin());
+        if (layer->arrayIndex == (int)paths.size())
+            paths.push_back(layer->texturePath);
+    }
+
+    if (array)
+    {
+        // Patches with the same layers share the same array from the texture cache
+        Texture* texture = Texture::createArray(paths, true);
+        if (texture)
+        {
+            _layerArray = Texture::Sampler::create(texture);
+            texture->release();
+            _layerArray->setWrapMode(Texture::REPEAT, Texture::REPEAT);
+            _layerArray->setFilterMode(Texture::LINEAR_MIPMAP_LINEAR, Texture::LINEAR);
+            return;
+        }
+        GP_WARN("Failed to create the layer texture array of terrain patch (%d, %d); its layers are sampled from a texture each.", _row, _column);
+    }
+
+    // Load the textures of the layers that were left for the array
+    for (std::set<Layer*, LayerCompare>::iterator itr = _layers.begin(); itr != _layers.end(); ++itr)
+    {
+        Layer* layer = *itr;
+        layer->arrayIndex = -1;
+        if (layer->textureIndex == -1)
+            layer->textureIndex = addSampler(layer->texturePath.c_str());
+    }
+}
+
 std::string TerrainPatch::passCallback(Pass* pass, void* cookie)
 {
     TerrainPatch* patch = reinterpret_cast<TerrainPatch*>(cookie);
@@ -477,12 +896,21 @@ std::string TerrainPatch::passCallback(Pass* pass, void* cookie)
 std::string TerrainPatch::passCreated(Pass* pass)
 {
     // Build preprocessor string to be passed to the terrain shader.
-    // NOTE: I make heavy use of preprocessor definitions, rather than passing in arrays and doing
-    // non-constant array access in the shader. This is due to the fact that non-constant array access
-    // in GLES is very slow on some hardware.
     std::ostringstream defines;
-    defines << "LAYER_COUNT " << _layers.size();
-    defines << ";SAMPLER_COUNT " << _samplers.size();
+    if (isComposited())
+    {
+        // Only the texture that the layers were composited into is sampled
+        defines << "LAYER_COUNT 0;SAMPLER_COUNT 0;COMPOSITED";
+    }
+    else
+    {
+        defines << getLayerDefines();
+        if (_layerArray)
+        {
+            // The array is bound directly, so that custom terrain materials do not need a binding for it
+            pass->getParameter("u_surfaceLayerArray")->setValue(_layerArray);
+        }
+    }
 
     if (_terrain->isFlagSet(Terrain::DEBUG_PATCHES))
     {
@@ -494,19 +922,38 @@ std::string TerrainPatch::passCreated(Pass* pass)
     if (_terrain->_normalMap)
         defines << ";NORMAL_MAP";
 
+    if (_terrain->_geomorphing)
+    {
+        defines << ";GEOMORPHING";
+        pass->setParameterAutoBinding("u_worldMatrix", RenderState::WORLD_MATRIX);
+        pass->setParameterAutoBinding("u_cameraPosition", RenderState::CAMERA_WORLD_POSITION);
+    }
+
+    return defines.str();
+}
+
+std::string TerrainPatch::getLayerDefines() const
+{
+    // NOTE: I make heavy use of preprocessor definitions, rather than passing in arrays and doing
+    // non-constant array access in the shader. This is due to the fact that non-constant array access
+    // in GLES is very slow on some hardware.
+    std::ostringstream defines;
+    defines << "LAYER_COUNT " << _layers.size();
+    defines << ";SAMPLER_COUNT " << _samplers.size();
+
+    if (_layerArray)
+        defines << ";TEXTURE_ARRAY";
+
     // Append texture and blend index constants to preprocessor definition.
     // We need to do this since older versions of GLSL only allow sampler arrays
     // to be indexed using constant expressions (otherwise we could simply pass an
     // array of indices to use for sampler lookup).
-    //
-    // Rebuild layer lists while we're at it.
-    //
     int layerIndex = 0;
-    for (std::set<Layer*, LayerCompare>::iterator itr = _layers.begin(); itr != _layers.end(); ++itr, ++layerIndex)
+    for (std::set<Layer*, LayerCompare>::const_iterator itr = _layers.begin(); itr != _layers.end(); ++itr, ++layerIndex)
     {
         Layer* layer = *itr;
 
-        defines << ";TEXTURE_INDEX_" << layerIndex << " " << layer->textureIndex;
+        defines << ";TEXTURE_INDEX_" << layerIndex << " " << (_layerArray ? layer->arrayIndex : layer->textureIndex);
         defines << ";TEXTURE_REPEAT_" << layerIndex << " vec2(" << layer->textureRepeat.x << "," << layer->textureRepeat.y << ")";
 
         if (layerIndex > 0)
@@ -526,6 +973,10 @@ bool TerrainPatch::updateMaterial()
 
     _bits &= ~TERRAINPATCH_DIRTY_MATERIAL;
 
+    // The layers are composited with the same textures as the materials sample
+    updateLayerTextures();
+    SAFE_RELEASE(_compositeMaterial);
+
     __currentPatchIndex = _index;
 
     for (size_t i = 0, count = _levels.size(); i < count; ++i)
@@ -540,50 +991,203 @@ bool TerrainPatch::updateMaterial()
         }
 
         material->setNodeBinding(_terrain->_node);
+        if (isComposited())
+            material->removeParameter("u_surfaceLayerMaps");
 
-        // Set material on this lod level
-        _levels[i]->model->setMaterial(material);
+        // Set material on this lod level, or on its part of the shared model
+        Level* level = _levels[i];
+        if (level->part >= 0)
+        {
+            material->getParameter("u_level")->setValue((float)level->part);
+            level->model->setMaterial(material, level->part);
+        }
+        else
+        {
+            level->model->setMaterial(material);
+        }
 
         material->release();
     }
 
     __currentPatchIndex = -1;
 
+    if (isComposited())
+        bindComposite();
+
     return true;
 }
 
+bool TerrainPatch::isComposited() const
+{
+    return _composite && _terrain->isFlagSet(Terrain::COMPOSITING);
+}
+
+void TerrainPatch::updateComposite()
+{
+    // The layer textures are updated with the materials, before the layers can be composited
+    if (_layers.empty() || (_bits & (TERRAINPATCH_DIRTY_MATERIAL | TERRAINPATCH_COMPOSITE_FAILED)))
+        return;
+
+    // The size of the composited texture halves with each level of detail
+    unsigned int size = std::max(_terrain->_compositeSize >> _level, (unsigned int)TERRAINPATCH_COMPOSITE_MIN_SIZE);
+    if (_composite && _compositeSize == size && !(_bits & TERRAINPATCH_DIRTY_COMPOSITE))
+        return;
+
+    Mesh* quad = _terrain->beginComposite();
+    if (!quad)
+        return;
+
+    if (!_compositeMaterial)
+    {
+        std::string defines = "COMPOSITE;" + getLayerDefines();
+        _compositeMaterial = Material::create(TERRAINPATCH_COMPOSITE_VSH, TERRAINPATCH_COMPOSITE_FSH, defines.c_str());
+        if (!_compositeMaterial)
+        {
+            GP_WARN("Failed to create the material that composites the layers of terrain patch (%d, %d).", _row, _column);
+            _bits |= TERRAINPATCH_COMPOSITE_FAILED;
+            return;
+        }
+        RenderState::StateBlock* stateBlock = _compositeMaterial->getStateBlock();
+        stateBlock->setDepthTest(false);
+        stateBlock->setDepthWrite(false);
+        stateBlock->setCullFace(false);
+        stateBlock->setBlend(false);
+
+        Pass* pass = _compositeMaterial->getTechnique()->getPassByIndex(0);
+        VertexAttributeBinding* binding = VertexAttributeBinding::create(quad, pass->getEffect());
+        pass->setVertexAttributeBinding(binding);
+        SAFE_RELEASE(binding);
+        _compositeMaterial->getParameter("u_compositeRect")->setValue(_compositeRect);
+        if (_layerArray)
+            _compositeMaterial->getParameter("u_surfaceLayerArray")->setValue(_layerArray);
+    }
+    if (!_samplers.empty())
+        _compositeMaterial->getParameter("u_surfaceLayerMaps")->setValue((const Texture::Sampler**)&_samplers[0], (unsigned int)_samplers.size());
+
+    FrameBuffer* frameBuffer = FrameBuffer::create("TerrainComposite", size, size);
+    if (!frameBuffer)
+    {
+        GP_WARN("Failed to create the frame buffer that composites the layers of terrain patch (%d, %d).", _row, _column);
+        _bits |= TERRAINPATCH_COMPOSITE_FAILED;
+        return;
+    }
+
+    Game* game = Game::getInstance();
+    Rectangle viewport = game->getViewport();
+    FrameBuffer* previousFrameBuffer = frameBuffer->bind();
+    game->setViewport(Rectangle(0, 0, (float)size, (float)size));
+    Pass* pass = _compositeMaterial->getTechnique()->getPassByIndex(0);
+    pass->bind();
+    GraphicsDevice::drawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    pass->unbind();
+    previousFrameBuffer->bind();
+    game->setViewport(viewport);
+
+    // The composited texture is mipmapped, since it is stretched over the whole patch
+    Texture* texture = frameBuffer->getRenderTarget()->getTexture();
+    texture->generateMipmaps();
+    bool first = (_composite == NULL);
+    SAFE_RELEASE(_composite);
+    _composite = Texture::Sampler::create(texture);
+    _composite->setWrapMode(Texture::CLAMP, Texture::CLAMP);
+    _composite->setFilterMode(Texture::LINEAR_MIPMAP_LINEAR, Texture::LINEAR);
+    SAFE_RELEASE(frameBuffer);
+    _compositeSize = size;
+    _bits &= ~TERRAINPATCH_DIRTY_COMPOSITE;
+
+    // The materials sample the layers until the patch is first composited
+    if (first)
+        setMaterialDirty();
+    else
+        bindComposite();
+}
+
+void TerrainPatch::bindComposite()
+{
+    for (size_t i = 0, count = _levels.size(); i < count; ++i)
+    {
+        Material* material = _levels[i]->model->getMaterial(_levels[i]->part);
+        if (material)
+        {
+            material->getParameter("u_compositeMap")->setValue(_composite);
+            material->getParameter("u_compositeRect")->setValue(_compositeRect);
+        }
+    }
+}
+
+void TerrainPatch::releaseComposite()
+{
+    if (!_composite)
+        return;
+
+    SAFE_RELEASE(_composite);
+    _compositeSize = 0;
+    setMaterialDirty();
+}
+
 void TerrainPatch::updateNodeBindings()
 {
     __currentPatchIndex = _index;
     for (size_t i = 0, count = _levels.size(); i < count; ++i)
     {
-        _levels[i]->model->getMaterial()->setNodeBinding(_terrain->_node);
+        // The materials of a patch that was just paged in are created when it is drawn
+        Material* material = _levels[i]->model->getMaterial(_levels[i]->part);
+        if (material)
+            material->setNodeBinding(_terrain->_node);
     }
     __currentPatchIndex = -1;
 }
 
-unsigned int TerrainPatch::draw(bool wireframe)
+unsigned int TerrainPatch::draw(bool wireframe, Camera* camera, int level)
 {
-    Scene* scene = _terrain->_node ? _terrain->_node->getScene() : NULL;
-    Camera* camera = scene ? scene->getActiveCamera() : NULL;
-    if (!camera)
+    GP_ASSERT(camera);
+
+    if (_levels.empty())
         return 0;
 
-    // Get our world-space bounding box
-    BoundingBox bounds = getBoundingBox(true);
+    if (level >= 0)
+    {
+        // Use the level chosen for the quadtree node, and compute our own when we are drawn again
+        _level = std::min((unsigned int)level, (unsigned int)_levels.size() - 1);
+        _bits |= TERRAINPATCH_DIRTY_LEVEL;
+    }
+    else
+    {
+        // Compute the LOD level from the camera's perspective
+        _level = computeLOD(camera, getBoundingBox(true));
+    }
 
-    // If the box does not intersect the view frustum, cull it
-    if (_terrain->isFlagSet(Terrain::FRUSTUM_CULLING) && !camera->getFrustum().intersects(bounds))
-        return 0;
+    // The layers are composited at the size of the level of detail that is drawn
+    if (_terrain->isFlagSet(Terrain::COMPOSITING))
+        updateComposite();
 
     if (!updateMaterial())
         return 0;
 
-    // Compute the LOD level from the camera's perspective
-    _level = computeLOD(camera, bounds);
-
     // Draw the model for the current LOD
-    return _levels[_level]->model->draw(wireframe);
+    Level* current = _levels[_level];
+    if (current->part < 0)
+        return current->model->draw(wireframe);
+
+    // Morph the vertices that the next level drops over the last part of the distance of this level
+    Vector2 morphRange;
+    if (_terrain->isFlagSet(Terrain::LEVEL_OF_DETAIL) && _level + 1 < _levels.size())
+    {
+        float start = getLevelDistance(_terrain, _level);
+        float end = getLevelDistance(_terrain, _level + 1);
+        start = end - (end - start) * TERRAINPATCH_MORPH_RANGE;
+        morphRange.set(start, 1.0f / (end - start));
+    }
+    current->model->getMaterial(current->part)->getParameter("u_morphRange")->setValue(morphRange);
+    return current->model->drawMeshPart(current->part, wireframe);
+}
+
+unsigned int TerrainPatch::getLevelCount() const
+{
+    unsigned int count = 1;
+    while ((1u << count) <= _maxStep)
+        ++count;
+    return count;
 }
 
 const BoundingBox& TerrainPatch::getBoundingBox(bool worldSpace) const
@@ -635,6 +1239,23 @@ unsigned int TerrainPatch::computeLOD(Camera* camera, const BoundingBox& worldBo
 
     _bits &= ~TERRAINPATCH_DIRTY_LEVEL;
 
+    _level = computeLevel(_terrain, camera, worldBounds, _levels.size() - 1);
+    return _level;
+}
+
+unsigned int TerrainPatch::computeLevel(const Terrain* terrain, Camera* camera, const BoundingBox& worldBounds, unsigned int maxLevel)
+{
+    if (terrain->_geomorphing)
+    {
+        // Geomorphing levels start at fixed distances from the camera, measured to the nearest point of the bounds
+        Vector3 position = camera->getNode() ? camera->getNode()->getTranslationWorld() : Vector3::zero();
+        float distance = computeDistance(position, worldBounds);
+        unsigned int level = 0;
+        while (level < maxLevel && distance >= getLevelDistance(terrain, level + 1))
+            ++level;
+        return level;
+    }
+
     // Compute LOD to use based on very simple distance metric. TODO: Optimize me.
     Game* game = Game::getInstance();
     Rectangle vp(0, 0, game->getWidth(), game->getHeight());
@@ -661,13 +1282,24 @@ unsigned int TerrainPatch::computeLOD(Camera* camera, const BoundingBox& worldBo
     float error = screenArea / area;
 
     // Level LOD based on distance from camera
-    size_t maxLod = _levels.size()-1;
     size_t lod = (size_t)error;
-    lod = std::max(lod, (size_t)0);
-    lod = std::min(lod, maxLod);
-    _level = lod;
+    lod = std::min(lod, (size_t)maxLevel);
+    return (unsigned int)lod;
+}
 
-    return _level;
+float TerrainPatch::computeDistance(const Vector3& point, const BoundingBox& bounds)
+{
+    Vector3 nearest(clamp(point.x, bounds.min.x, bounds.max.x),
+                    clamp(point.y, bounds.min.y, bounds.max.y),
+                    clamp(point.z, bounds.min.z, bounds.max.z));
+    return point.distance(nearest);
+}
+
+float TerrainPatch::getLevelDistance(const Terrain* terrain, unsigned int level)
+{
+    // The distances double with every level, starting at twice the size of a patch, so that
+    // neighbouring patches are never more than one level apart and their borders match.
+    return terrain->_lodDistance * (float)((1u << level) - 1);
 }
 
 const Vector3& TerrainPatch::getAmbientColor() const
@@ -681,13 +1313,39 @@ void TerrainPatch::setMaterialDirty()
     _bits |= TERRAINPATCH_DIRTY_MATERIAL;
 }
 
-float TerrainPatch::computeHeight(float* heights, unsigned int width, unsigned int x, unsigned int z)
+void TerrainPatch::setBoundsDirty()
 {
-    return heights[z * width + x] * _terrain->_localScale.y;
+    _bits |= TERRAINPATCH_DIRTY_BOUNDS | TERRAINPATCH_DIRTY_LEVEL;
+}
+
+float TerrainPatch::computeHeight(float* heights, unsigned int x, unsigned int z)
+{
+    return heights[(z - _heightsZ) * _heightsPitch + (x - _heightsX)] * _terrain->_localScale.y;
+}
+
+Vector3 TerrainPatch::computeNormal(float* heights, unsigned int width, unsigned int height, unsigned int x, unsigned int z, unsigned int step)
+{
+    float px = x * _terrain->_localScale.x;
+    float pz = z * _terrain->_localScale.z;
+    float stepXScaled = step * _terrain->_localScale.x;
+    float stepZScaled = step * _terrain->_localScale.z;
+    Vector3 p(px, computeHeight(heights, x, z), pz);
+    Vector3 w(Vector3(x>=step ? px-stepXScaled : px, computeHeight(heights, x>=step ? x-step : x, z), pz), p);
+    Vector3 e(Vector3(x<width-step ? px+stepXScaled : px, computeHeight(heights, x<width-step ? x+step : x, z), pz), p);
+    Vector3 s(Vector3(px, computeHeight(heights, x, z>=step ? z-step : z), z>=step ? pz-stepZScaled : pz), p);
+    Vector3 n(Vector3(px, computeHeight(heights, x, z<height-step ? z+step : z), z<height-step ? pz+stepZScaled : pz), p);
+    Vector3 normals[4];
+    Vector3::cross(n, w, &normals[0]);
+    Vector3::cross(w, s, &normals[1]);
+    Vector3::cross(e, n, &normals[2]);
+    Vector3::cross(s, e, &normals[3]);
+    Vector3 normal = -(normals[0] + normals[1] + normals[2] + normals[3]);
+    normal.normalize();
+    return normal;
 }
 
 TerrainPatch::Layer::Layer() :
-    index(0), row(-1), column(-1), textureIndex(-1), blendIndex(-1)
+    index(0), row(-1), column(-1), textureIndex(-1), arrayIndex(-1), blendIndex(-1)
 {
 }
 
@@ -695,7 +1353,7 @@ TerrainPatch::Layer::~Layer()
 {
 }
 
-TerrainPatch::Level::Level() : model(NULL)
+TerrainPatch::Level::Level() : model(NULL), part(-1)
 {
 }
 
@@ -726,7 +1384,7 @@ bool TerrainAutoBindingResolver::resolveAutoBinding(const char* autoBinding, Nod
     if (strcmp(autoBinding, "TERRAIN_LAYER_MAPS") == 0)
     {
         TerrainPatch* patch = HelperFunctions::getPatch(node);
-        if (patch && patch->_layers.size() > 0)
+        if (patch && patch->_samplers.size() > 0)
             parameter->setValue((const Texture::Sampler**)&patch->_samplers[0], (unsigned int)patch->_samplers.size());
         return true;
     }
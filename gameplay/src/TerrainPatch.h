@@ -88,6 +88,8 @@ private:
         int row;
         int column;
         int textureIndex;
+        int arrayIndex;
+        std::string texturePath;
         Vector2 textureRepeat;
         int blendIndex;
         int blendChannel;
@@ -96,6 +98,7 @@ private:
     struct Level
     {
         Model* model;
+        int part;
 
         Level();
     };
@@ -105,34 +108,169 @@ private:
         bool operator() (const Layer* lhs, const Layer* rhs) const;
     };
 
+    /**
+     * The files of a layer of a paged patch, which are loaded while the patch is resident.
+     */
+    struct LayerSource
+    {
+        int index;
+        std::string texturePath;
+        Vector2 textureRepeat;
+        std::string blendPath;
+        int blendChannel;
+    };
+
+    /**
+     * The paging states of a patch; the patches of terrains that are not paged are always resident.
+     */
+    enum PageState
+    {
+        PAGE_UNLOADED,
+        PAGE_LOADING,
+        PAGE_RESIDENT,
+        PAGE_FAILED
+    };
+
+    /**
+     * Creates a patch, whose geometry is built from the heights of the whole heightfield, or is
+     * built when the patch is paged in if heights is NULL.
+     */
     static TerrainPatch* create(Terrain* terrain, unsigned int index,
                                 unsigned int row, unsigned int column,
                                 float* heights, unsigned int width, unsigned int height,
                                 unsigned int x1, unsigned int z1, unsigned int x2, unsigned int z2,
                                 float xOffset, float zOffset, unsigned int maxStep, float verticalSkirtSize);
 
+    /**
+     * Builds the levels of detail of the patch from heights that are laid out as set by the height tile members.
+     *
+     * @param width The number of columns of the heightfield.
+     * @param height The number of rows of the heightfield.
+     */
+    void build(float* heights, unsigned int width, unsigned int height);
+
+    /**
+     * Makes a paged patch resident, taking the heights of a tile of the heightfield that covers it
+     * and the neighbours its normals are computed from, and loading its layers.
+     *
+     * @param heights The normalized heights of the tile, which are swapped out of the vector.
+     * @param x The heightfield column of the first height of the tile.
+     * @param z The heightfield row of the first height of the tile.
+     * @param pitch The number of heights in each row of the tile.
+     * @param width The number of columns of the heightfield.
+     * @param height The number of rows of the heightfield.
+     */
+    void load(std::vector<float>& heights, unsigned int x, unsigned int z, unsigned int pitch, unsigned int width, unsigned int height);
+
+    /**
+     * Releases the geometry, materials and layer textures of a paged patch, keeping its layer sources.
+     */
+    void unload();
+
+    /**
+     * Returns the normalized height of a resident paged patch at heightfield coordinates within it.
+     */
+    float getTileHeight(float column, float row) const;
+
     void addLOD(float* heights, unsigned int width, unsigned int height,
                 unsigned int x1, unsigned int z1, unsigned int x2, unsigned int z2,
                 float xOffset, float zOffset, unsigned int step, float verticalSkirtSize);
 
+    /**
+     * Adds the levels of detail of a geomorphing terrain, as mesh parts that select grid lines
+     * of one full resolution mesh, whose vertices hold the offsets that morph them to the next level.
+     */
+    void addMorphLevels(float* heights, unsigned int width, unsigned int height,
+                        unsigned int x1, unsigned int z1, unsigned int x2, unsigned int z2,
+                        float xOffset, float zOffset, unsigned int maxStep, float verticalSkirtSize);
 
     bool setLayer(int index, const char* texturePath, const Vector2& textureRepeat, const char* blendPath, int blendChannel);
 
+    bool loadLayer(int index, const char* texturePath, const Vector2& textureRepeat, const char* blendPath, int blendChannel);
+
     void deleteLayer(Layer* layer);
 
     int addSampler(const char* path);
 
-    unsigned int draw(bool wireframe);
+    void releaseSampler(int index);
+
+    /**
+     * Determines whether the layers can be sampled from a texture array.
+     */
+    bool useLayerArray() const;
+
+    /**
+     * Creates the texture array of the layers, or the samplers of the layers that can not use one.
+     */
+    void updateLayerTextures();
+
+    /**
+     * Determines whether the patch is drawn with the texture that its layers are composited into.
+     */
+    bool isComposited() const;
+
+    /**
+     * Composites the layers of the patch into a texture of the size of its current level of detail,
+     * if it has not been composited at that size since its layers last changed.
+     */
+    void updateComposite();
+
+    /**
+     * Points the materials of the patch at its composited texture.
+     */
+    void bindComposite();
+
+    /**
+     * Releases the composited texture of the patch, which then samples its layers again.
+     */
+    void releaseComposite();
+
+    /**
+     * Returns the defines of the layers of the patch for the terrain shaders.
+     */
+    std::string getLayerDefines() const;
+
+    /**
+     * Draws the patch, which the quadtree of the terrain has found to be visible.
+     *
+     * @param level The level of detail to draw, or -1 to compute it from the camera.
+     */
+    unsigned int draw(bool wireframe, Camera* camera, int level);
+
+    /**
+     * Returns the number of levels of detail of the patch, including those of a paged patch that is not resident.
+     */
+    unsigned int getLevelCount() const;
 
     bool updateMaterial();
 
     unsigned int computeLOD(Camera* camera, const BoundingBox& worldBounds);
 
+    /**
+     * Computes the level of detail for world-space bounds, from the screen-space error metric or,
+     * if the terrain geomorphs, from the distance to the camera.
+     */
+    static unsigned int computeLevel(const Terrain* terrain, Camera* camera, const BoundingBox& worldBounds, unsigned int maxLevel);
+
+    /**
+     * Returns the distance from a point to the nearest point of a bounding box.
+     */
+    static float computeDistance(const Vector3& point, const BoundingBox& bounds);
+
+    /**
+     * Returns the distance from the camera at which a level of detail of a geomorphing terrain starts.
+     */
+    static float getLevelDistance(const Terrain* terrain, unsigned int level);
+
     const Vector3& getAmbientColor() const;
 
     void setMaterialDirty();
 
-    float computeHeight(float* heights, unsigned int width, unsigned int x, unsigned int z);
+    void setBoundsDirty();
+
+    float computeHeight(float* heights, unsigned int x, unsigned int z);
+
+    Vector3 computeNormal(float* heights, unsigned int width, unsigned int height, unsigned int x, unsigned int z, unsigned int step);
 
     void updateNodeBindings();
 
@@ -145,6 +283,26 @@ private:
     std::vector<Level*> _levels;
     std::set<Layer*, LayerCompare> _layers;
     std::vector<Texture::Sampler*> _samplers;
+    Texture::Sampler* _layerArray;
+    std::vector<LayerSource> _layerSources;
+    Texture::Sampler* _composite;
+    Material* _compositeMaterial;
+    unsigned int _compositeSize;
+    // The texture coordinates of the corner of the patch in x and y, and of its size in z and w
+    Vector4 _compositeRect;
+    unsigned int _x1;
+    unsigned int _z1;
+    unsigned int _x2;
+    unsigned int _z2;
+    float _xOffset;
+    float _zOffset;
+    unsigned int _maxStep;
+    float _verticalSkirtSize;
+    std::vector<float> _heights;
+    unsigned int _heightsX;
+    unsigned int _heightsZ;
+    unsigned int _heightsPitch;
+    PageState _pageState;
     mutable BoundingBox _boundingBox;
     mutable BoundingBox _boundingBoxWorld;
     mutable Camera* _camera;
@@ -2,6 +2,7 @@
 #include "Text.h"
 #include "Matrix.h"
 #include "Scene.h"
+#include "Game.h"
 
 namespace gameplay
 {
@@ -40,9 +41,10 @@ Text* Text::create(const char* fontPath, const char* str, const Vector4& color,
     }
     else
     {
-        // Delegate to closest sized font
+        // Delegate to closest sized font, which distance field fonts scale to the size.
         drawFont = font->findClosestSize(size);
-        size = drawFont->_size;
+        if (drawFont->getFormat() != Font::DISTANCE_FIELD)
+            size = drawFont->_size;
     }
     unsigned int widthOut, heightOut;
     font->measureText(str, size, &widthOut, &heightOut);
@@ -231,6 +233,8 @@ Drawable* Text::clone(NodeCloneContext& context)
 
 unsigned int Text::draw(bool wireframe)
 {
+    GP_PROFILE_GPU_SCOPE("Text::draw");
+
     // Apply scene camera projection and translation offsets
     Rectangle viewport = Game::getInstance()->getViewport();
     Vector3 position = Vector3::zero();
@@ -264,11 +268,14 @@ unsigned int Text::draw(bool wireframe)
             clipViewport.y += position.y;
         }
     }
-    _drawFont->start();
-    _drawFont->drawText(_text.c_str(), Rectangle(position.x, position.y, _width, _height),
+    // The sprite renderer merges this draw with the draws of the other texts of the font.
+    SpriteRenderer* renderer = Game::getInstance()->getSpriteRenderer();
+    GP_ASSERT(renderer);
+    renderer->startFont(_drawFont);
+    _drawFont->drawText(&_layout, _text.c_str(), Rectangle(position.x, position.y, _width, _height),
                     Vector4(_color.x, _color.y, _color.z, _color.w * _opacity), _size,
                     _align, _wrap, _rightToLeft, clipViewport);
-    _drawFont->finish();
+    renderer->finishFont(_drawFont);
     return 1;
 }
     
@@ -5,6 +5,7 @@
 #include "AnimationTarget.h"
 #include "Properties.h"
 #include "Font.h"
+#include "TextLayout.h"
 #include "Vector2.h"
 #include "Vector4.h"
 #include "Effect.h"
@@ -256,6 +257,7 @@ private:
     Font* _font;
     Font* _drawFont;
     std::string _text;
+    TextLayout _layout;
     unsigned int _size;
     float _width;
     float _height;
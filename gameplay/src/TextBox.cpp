@@ -4,7 +4,9 @@
 namespace gameplay
 {
 
-TextBox::TextBox() : _caretLocation(0), _lastKeypress(0), _fontSize(0), _caretImage(NULL), _passwordChar('*'), _inputMode(TEXT), _ctrlPressed(false), _shiftPressed(false)
+TextBox::TextBox() : _caretLocation(0), _lastKeypress(0), _fontSize(0), _caretImage(NULL), _passwordChar('*'), _inputMode(TEXT), _ctrlPressed(false), _shiftPressed(false),
+    _caretTextIndex(0), _caretTextInputMode(TEXT), _caretTextPasswordChar(0), _caretTextFont(NULL), _caretTextSize(0), _caretTextJustify(Font::ALIGN_TOP_LEFT),
+    _caretTextRightToLeft(false), _caretMeasured(false)
 {
     _canFocus = true;
 }
@@ -68,6 +70,7 @@ void TextBox::setCaretLocation(unsigned int index)
     _caretLocation = index;
     if (_caretLocation > _text.length())
         _caretLocation = (unsigned int)_text.length();
+    setDirty(DIRTY_REDRAW);
 }
 
 bool TextBox::touchEvent(Touch::TouchEvent evt, int x, int y, unsigned int contactIndex)
@@ -179,6 +182,7 @@ bool TextBox::keyEvent(Keyboard::KeyEvent evt, int key)
                             newCaretLocation = _caretLocation + 1;
                         }
                         _text.erase(_caretLocation, newCaretLocation - _caretLocation);
+                        _measuredFont = NULL;
                         notifyListeners(Control::Listener::TEXT_CHANGED);
                     }
                     break;
@@ -242,6 +246,7 @@ bool TextBox::keyEvent(Keyboard::KeyEvent evt, int key)
                             newCaretLocation = _caretLocation - 1;
                         }
                         _text.erase(newCaretLocation, _caretLocation - newCaretLocation);
+                        _measuredFont = NULL;
                         _caretLocation = newCaretLocation;
                         notifyListeners(Control::Listener::TEXT_CHANGED);
                     }
@@ -278,6 +283,7 @@ bool TextBox::keyEvent(Keyboard::KeyEvent evt, int key)
                         if (_caretLocation <= _text.length())
                         {
                             _text.insert(_caretLocation, 1, (char)key);
+                            _measuredFont = NULL;
                             ++_caretLocation;
                         }
 
@@ -353,11 +359,8 @@ unsigned int TextBox::drawImages(Form* form, const Rectangle& clip)
 
             float caretWidth = region.width * _fontSize / region.height;
 
-            Font* font = getFont(state);
             unsigned int fontSize = getFontSize(state);
-            Vector2 point;
-            font->getLocationAtIndex(getDisplayedText().c_str(), _textBounds, fontSize, &point, _caretLocation, 
-                 getTextAlignment(state), true, getTextRightToLeft(state));
+            const Vector2& point = measureCaret(state);
 
             SpriteBatch* batch = _style->getTheme()->getSpriteBatch();
             startBatch(form, batch);
@@ -385,7 +388,7 @@ unsigned int TextBox::drawText(Form* form, const Rectangle& clip)
 
         SpriteBatch* batch = _font->getSpriteBatch(fontSize);
         startBatch(form, batch);
-        _font->drawText(displayedText.c_str(), _textBounds, _textColor, fontSize, getTextAlignment(state), true, getTextRightToLeft(state), _viewportClipBounds);
+        _font->drawText(&_textLayout, displayedText.c_str(), _textBounds, _textColor, fontSize, getTextAlignment(state), true, getTextRightToLeft(state), _viewportClipBounds);
         finishBatch(form, batch);
 
         return 1;
@@ -457,13 +460,44 @@ void TextBox::getCaretLocation(Vector2* p)
 {
     GP_ASSERT(p);
 
-    State state = getState();
-    getFont(state)->getLocationAtIndex(getDisplayedText().c_str(), _textBounds, getFontSize(state), p, _caretLocation, getTextAlignment(state), true, getTextRightToLeft(state));
+    *p = measureCaret(getState());
+}
+
+const Vector2& TextBox::measureCaret(State state)
+{
+    // The caret is drawn every frame while the text box has focus, but the text is laid out
+    // again only after it is edited, the caret moved or the layout of the text box changed.
+    Font* font = getFont(state);
+    unsigned int fontSize = getFontSize(state);
+    Font::Justify justify = getTextAlignment(state);
+    bool rightToLeft = getTextRightToLeft(state);
+    if (_caretMeasured && _caretTextIndex == _caretLocation && _caretTextInputMode == _inputMode && _caretTextPasswordChar == _passwordChar &&
+        _caretTextBounds == _textBounds && _caretTextFont == font && _caretTextSize == fontSize && _caretTextJustify == justify &&
+        _caretTextRightToLeft == rightToLeft && _caretText == _text)
+    {
+        return _caretPoint;
+    }
+
+    _caretText = _text;
+    _caretTextIndex = _caretLocation;
+    _caretTextInputMode = _inputMode;
+    _caretTextPasswordChar = _passwordChar;
+    _caretTextBounds = _textBounds;
+    _caretTextFont = font;
+    _caretTextSize = fontSize;
+    _caretTextJustify = justify;
+    _caretTextRightToLeft = rightToLeft;
+    _caretMeasured = true;
+
+    _caretPoint.set(0, 0);
+    font->getLocationAtIndex(getDisplayedText().c_str(), _textBounds, fontSize, &_caretPoint, _caretLocation, justify, true, rightToLeft);
+    return _caretPoint;
 }
 
 void TextBox::setPasswordChar(char character)
 {
     _passwordChar = character;
+    setDirty(DIRTY_REDRAW);
 }
 
 char TextBox::getPasswordChar() const
@@ -474,6 +508,7 @@ char TextBox::getPasswordChar() const
 void TextBox::setInputMode(InputMode inputMode)
 {
     _inputMode = inputMode;
+    setDirty(DIRTY_REDRAW);
 }
 
 TextBox::InputMode TextBox::getInputMode() const
@@ -256,6 +256,30 @@ private:
     void setCaretLocation(int x, int y);
 
     void getCaretLocation(Vector2* p);
+
+    /**
+     * Returns the point of the caret, measuring it again only if the text, caret or layout changed.
+     */
+    const Vector2& measureCaret(State state);
+
+    /**
+     * The inputs that the caret point was last measured for.
+     */
+    std::string _caretText;
+    unsigned int _caretTextIndex;
+    InputMode _caretTextInputMode;
+    char _caretTextPasswordChar;
+    Rectangle _caretTextBounds;
+    Font* _caretTextFont;
+    unsigned int _caretTextSize;
+    Font::Justify _caretTextJustify;
+    bool _caretTextRightToLeft;
+    bool _caretMeasured;
+
+    /**
+     * The last measured point of the caret.
+     */
+    Vector2 _caretPoint;
 };
 
 }
@@ -0,0 +1,128 @@
+#include "Base.h"
+#include "TextLayout.h"
+
+// The largest number of glyph quads that are appended to a batch at once, which keeps the indices within an unsigned short
+#define TEXT_LAYOUT_MAX_QUADS 16383
+
+namespace gameplay
+{
+
+TextLayout::TextLayout()
+    : _font(NULL), _valid(false), _size(0), _justify(Font::ALIGN_TOP_LEFT), _wrap(true), _rightToLeft(false), _generation(0)
+{
+}
+
+TextLayout::~TextLayout()
+{
+    SAFE_RELEASE(_font);
+}
+
+void TextLayout::invalidate()
+{
+    _valid = false;
+    _vertices.clear();
+    _indices.clear();
+}
+
+unsigned int TextLayout::getGlyphCount() const
+{
+    return (unsigned int)(_vertices.size() / 4);
+}
+
+bool TextLayout::matches(const char* text, const Rectangle& area, unsigned int size, Font::Justify justify, bool wrap,
+                         bool rightToLeft, const Rectangle& clip) const
+{
+    if (!_valid || _size != size || _justify != justify || _wrap != wrap || _rightToLeft != rightToLeft ||
+        area.width != _area.width || area.height != _area.height || _text != text)
+    {
+        return false;
+    }
+
+    // The clip region must be the same, relative to the area.
+    const Rectangle none(0, 0, 0, 0);
+    if (clip == none || _clip == none)
+        return clip == _clip;
+    return clip.width == _clip.width && clip.height == _clip.height &&
+           clip.x - area.x == _clip.x - _area.x && clip.y - area.y == _clip.y - _area.y;
+}
+
+bool TextLayout::update(const Rectangle& area, const Rectangle& clip, const Vector4& color)
+{
+    // Glyphs are placed on whole pixels, so moving the area by a fraction of a pixel can move them differently.
+    float dx = area.x - _area.x;
+    float dy = area.y - _area.y;
+    if (dx != floorf(dx) || dy != floorf(dy))
+        return false;
+
+    const bool move = (dx != 0.0f || dy != 0.0f);
+    const bool recolor = (color != _color);
+    if (move || recolor)
+    {
+        for (size_t i = 0, count = _vertices.size(); i < count; ++i)
+        {
+            SpriteBatch::SpriteVertex& v = _vertices[i];
+            v.x += dx;
+            v.y += dy;
+            v.r = color.x;
+            v.g = color.y;
+            v.b = color.z;
+            v.a = color.w;
+        }
+        _area = area;
+        _clip = clip;
+        _color = color;
+    }
+    return true;
+}
+
+void TextLayout::reset(const char* text, const Rectangle& area, const Vector4& color, unsigned int size, Font::Justify justify,
+                       bool wrap, bool rightToLeft, const Rectangle& clip)
+{
+    _valid = true;
+    _text = text;
+    _area = area;
+    _clip = clip;
+    _color = color;
+    _size = size;
+    _justify = justify;
+    _wrap = wrap;
+    _rightToLeft = rightToLeft;
+    _vertices.clear();
+    _indices.clear();
+}
+
+void TextLayout::buildIndices()
+{
+    // The quads are joined into one triangle strip with degenerate triangles. The indices of the
+    // first quads are the same for every chunk that is appended to a batch, so only those are kept.
+    unsigned int quadCount = std::min(getGlyphCount(), (unsigned int)TEXT_LAYOUT_MAX_QUADS);
+    _indices.clear();
+    _indices.reserve(quadCount > 0 ? quadCount * 6 - 2 : 0);
+    for (unsigned int i = 0; i < quadCount; ++i)
+    {
+        unsigned short first = (unsigned short)(i * 4);
+        if (i > 0)
+        {
+            _indices.push_back(first - 1);
+            _indices.push_back(first);
+        }
+        _indices.push_back(first);
+        _indices.push_back(first + 1);
+        _indices.push_back(first + 2);
+        _indices.push_back(first + 3);
+    }
+}
+
+void TextLayout::draw(SpriteBatch* batch)
+{
+    GP_ASSERT(batch);
+
+    unsigned int quadCount = getGlyphCount();
+    for (unsigned int first = 0; first < quadCount; first += TEXT_LAYOUT_MAX_QUADS)
+    {
+        unsigned int count = std::min(quadCount - first, (unsigned int)TEXT_LAYOUT_MAX_QUADS);
+        batch->draw(&_vertices[first * 4], count * 4, &_indices[0], count * 6 - 2);
+    }
+}
+
+}
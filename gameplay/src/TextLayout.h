@@ -0,0 +1,109 @@
+#ifndef TEXTLAYOUT_H_
+#define TEXTLAYOUT_H_
+
+#include "Font.h"
+
+namespace gameplay
+{
+
+/**
+ * Defines the glyph quads of a string of text that is laid out within an area.
+ *
+ * Wrapping and justifying text and looking up its glyphs is done once, when the text is
+ * drawn with Font::drawText for the first time with a layout. The quads are then reused
+ * for as long as the text, size, justification and the size of the area do not change, and
+ * appended to the sprite batch of the font at once. Moving the area by whole pixels or
+ * changing the color only updates the quads.
+ *
+ * Fonts keep a few layouts for the text that is drawn without one, so drawing a layout is
+ * only needed for text that is drawn every frame.
+ *
+ * @script{ignore}
+ */
+class TextLayout
+{
+    friend class Font;
+
+public:
+
+    /**
+     * Constructor.
+     */
+    TextLayout();
+
+    /**
+     * Destructor.
+     */
+    ~TextLayout();
+
+    /**
+     * Discards the glyph quads, so that the text is laid out again when it is next drawn.
+     */
+    void invalidate();
+
+    /**
+     * Returns the number of glyph quads that the text was laid out to.
+     *
+     * @return The number of glyph quads.
+     */
+    unsigned int getGlyphCount() const;
+
+private:
+
+    /**
+     * Hidden copy constructor.
+     */
+    TextLayout(const TextLayout& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    TextLayout& operator=(const TextLayout&);
+
+    /**
+     * Determines whether the glyph quads can be reused for the specified text, maybe after moving them.
+     */
+    bool matches(const char* text, const Rectangle& area, unsigned int size, Font::Justify justify, bool wrap,
+                 bool rightToLeft, const Rectangle& clip) const;
+
+    /**
+     * Moves the glyph quads to a new area and changes their color.
+     *
+     * @return false if the area did not move by whole pixels, which requires laying out the text again.
+     */
+    bool update(const Rectangle& area, const Rectangle& clip, const Vector4& color);
+
+    /**
+     * Clears the glyph quads and records the inputs that they are laid out for.
+     */
+    void reset(const char* text, const Rectangle& area, const Vector4& color, unsigned int size, Font::Justify justify,
+               bool wrap, bool rightToLeft, const Rectangle& clip);
+
+    /**
+     * Appends the strip indices of the glyph quads, after the text has been laid out.
+     */
+    void buildIndices();
+
+    /**
+     * Appends the glyph quads to a started batch.
+     */
+    void draw(SpriteBatch* batch);
+
+    Font* _font;
+    bool _valid;
+    std::string _text;
+    Rectangle _area;
+    Rectangle _clip;
+    Vector4 _color;
+    unsigned int _size;
+    Font::Justify _justify;
+    bool _wrap;
+    bool _rightToLeft;
+    unsigned int _generation;
+    std::vector<SpriteBatch::SpriteVertex> _vertices;
+    std::vector<unsigned short> _indices;
+};
+
+}
+
+#endif
@@ -2,6 +2,10 @@
 #include "Image.h"
 #include "Texture.h"
 #include "FileSystem.h"
+#include "RenderState.h"
+#include "ResourceCache.h"
+#include "Game.h"
+#include "TextureUploader.h"
 
 // PVRTC (GL_IMG_texture_compression_pvrtc) : Imagination based gpus
 #ifndef GL_COMPRESSED_RGB_PVRTC_2BPPV1_IMG
@@ -44,15 +48,166 @@
 #define ETC1_RGB8 0x8D64
 #endif
 
+// ETC2/EAC : OpenGL ES 3.0 and OpenGL 4.3
+// The formats from R11_EAC to SRGB8_ALPHA8_ETC2_EAC are consecutive.
+#ifndef GL_COMPRESSED_R11_EAC
+#define GL_COMPRESSED_R11_EAC 0x9270
+#endif
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#endif
+
+// ASTC (GL_KHR_texture_compression_astc_ldr) : Most OpenGL ES 3 gpus
+// The formats of each block size from 4x4 to 12x12 are consecutive.
+#ifndef GL_COMPRESSED_RGBA_ASTC_4x4_KHR
+#define GL_COMPRESSED_RGBA_ASTC_4x4_KHR 0x93B0
+#endif
+#ifndef GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR
+#define GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR 0x93D0
+#endif
+
+// BPTC/BC7 (GL_ARB_texture_compression_bptc) : Desktop gpus
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#endif
+
+// S3TC/DXT formats without alpha or with sRGB color (GL_EXT_texture_sRGB)
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT 0x8C4E
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+// KTX file identifiers
+#define KTX1_IDENTIFIER "\xABKTX 11\xBB\r\n\x1A\n"
+#define KTX2_IDENTIFIER "\xABKTX 20\xBB\r\n\x1A\n"
+#define KTX_IDENTIFIER_LENGTH 12
+#define KTX_ENDIANNESS 0x04030201
+
 namespace gameplay
 {
 
-static std::vector<Texture*> __textureCache;
-static TextureHandle __currentTextureId = 0;
-static Texture::Type __currentTextureType = Texture::TEXTURE_2D;
+// Utility function (shared with Scene).
+extern bool endsWith(const char* str, const char* suffix, bool ignoreCase);
+
+static ResourceCache __textureCache;
+
+// The asynchronous loads whose images are being decoded.
+static std::vector<Texture::AsyncLoad*> __asyncLoads;
+
+// The number of the most detailed levels that mipmapped textures skip when they are loaded (see setMipmapSkip).
+static unsigned int __mipmapSkip = 0;
+
+// The textures that were loaded from files, which are loaded again when the number of skipped levels changes.
+static std::vector<Texture*> __fileTextures;
+
+// Returns the number of levels that a texture with the given number of mipmap levels skips, which
+// leaves it at least one level. A negative mipmapSkip skips the global number of levels.
+static unsigned int computeSkippedLevels(int mipmapSkip, unsigned int levelCount)
+{
+    unsigned int skip = mipmapSkip < 0 ? __mipmapSkip : (unsigned int)mipmapSkip;
+    return levelCount > 1 ? std::min(skip, levelCount - 1) : 0;
+}
+
+// Returns the number of levels of the full mipmap chain of an image.
+static unsigned int getImageLevelCount(unsigned int width, unsigned int height)
+{
+    unsigned int count = 1;
+    for (unsigned int size = std::max(width, height); size > 1; size >>= 1)
+        ++count;
+    return count;
+}
+
+// Halves an image with a box filter once for each level that it skips. The returned image has a
+// reference that the caller releases.
+static Image* downsampleImage(Image* image, unsigned int levels)
+{
+    GP_ASSERT( image );
+
+    image->addRef();
+    const unsigned int pixelSize = image->getFormat() == Image::RGBA ? 4 : 3;
+    for (unsigned int level = 0; level < levels; ++level)
+    {
+        unsigned int srcWidth = image->getWidth();
+        unsigned int srcHeight = image->getHeight();
+        Image* half = Image::create(std::max(1u, srcWidth / 2), std::max(1u, srcHeight / 2), image->getFormat());
+        const unsigned char* src = image->getData();
+        unsigned char* dst = half->getData();
+        for (unsigned int y = 0; y < half->getHeight(); ++y)
+        {
+            // Odd sizes repeat their last row or column.
+            const unsigned char* row0 = src + std::min(y * 2, srcHeight - 1) * srcWidth * pixelSize;
+            const unsigned char* row1 = src + std::min(y * 2 + 1, srcHeight - 1) * srcWidth * pixelSize;
+            for (unsigned int x = 0; x < half->getWidth(); ++x)
+            {
+                unsigned int x0 = std::min(x * 2, srcWidth - 1) * pixelSize;
+                unsigned int x1 = std::min(x * 2 + 1, srcWidth - 1) * pixelSize;
+                for (unsigned int c = 0; c < pixelSize; ++c)
+                {
+                    *dst++ = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+                }
+            }
+        }
+        SAFE_RELEASE(image);
+        image = half;
+    }
+    return image;
+}
+
+// Returns the number of bytes of a pixel of an uncompressed format.
+static unsigned int getFormatSize(Texture::Format format)
+{
+    switch (format)
+    {
+    case Texture::RGBA:
+        return 4;
+    case Texture::RGB:
+        return 3;
+    default:
+        return 1;
+    }
+}
+
+// Estimates the video memory used by a texture, including its mipmap chain, cube faces and array layers.
+static size_t getTextureMemorySize(const Texture* texture)
+{
+    size_t size = (size_t)texture->getWidth() * texture->getHeight();
+    switch (texture->getFormat())
+    {
+    case Texture::RGBA:
+        size *= 4;
+        break;
+    case Texture::RGB:
+        size *= 3;
+        break;
+    default:
+        // Alpha and compressed textures use about a byte per pixel.
+        break;
+    }
+    if (texture->isMipmapped())
+        size += size / 3;
+    if (texture->getType() == Texture::TEXTURE_CUBE)
+        size *= 6;
+    size *= texture->getLayerCount();
+    return size;
+}
 
-Texture::Texture() : _handle(0), _format(UNKNOWN), _type((Texture::Type)0), _width(0), _height(0), _mipmapped(false), _cached(false), _compressed(false),
-    _wrapS(Texture::REPEAT), _wrapT(Texture::REPEAT), _wrapR(Texture::REPEAT), _minFilter(Texture::NEAREST_MIPMAP_LINEAR), _magFilter(Texture::LINEAR)
+Texture::Texture() : _handle(0), _format(UNKNOWN), _type((Texture::Type)0), _width(0), _height(0), _layerCount(1), _mipmapped(false), _cached(false), _compressed(false),
+    _wrapS(Texture::REPEAT), _wrapT(Texture::REPEAT), _wrapR(Texture::REPEAT), _minFilter(Texture::NEAREST_MIPMAP_LINEAR), _magFilter(Texture::LINEAR), _streamEntry(NULL),
+    _memorySize(0), _mipmapSkip(-1), _skippedLevels(0)
 {
 }
 
@@ -60,46 +215,83 @@ Texture::~Texture()
 {
     if (_handle)
     {
-        GL_ASSERT( glDeleteTextures(1, &_handle) );
+        RenderState::deleteTexture(_handle);
         _handle = 0;
     }
 
+    if (_streamEntry)
+    {
+        TextureStreamer* streamer = Game::getInstance()->getTextureStreamer();
+        GP_ASSERT(streamer);
+        streamer->remove(_streamEntry);
+    }
+
     // Remove ourself from the texture cache.
     if (_cached)
     {
-        std::vector<Texture*>::iterator itr = std::find(__textureCache.begin(), __textureCache.end(), this);
-        if (itr != __textureCache.end())
-        {
-            __textureCache.erase(itr);
-        }
+        __textureCache.remove(_path.c_str(), this);
+        std::vector<Texture*>::iterator itr = std::find(__fileTextures.begin(), __fileTextures.end(), this);
+        if (itr != __fileTextures.end())
+            __fileTextures.erase(itr);
     }
+
+    setMemorySize(0);
 }
 
 Texture* Texture::create(const char* path, bool generateMipmaps)
+{
+    return create(path, generateMipmaps, -1);
+}
+
+Texture* Texture::create(const char* path, bool generateMipmaps, int mipmapSkip)
 {
     GP_ASSERT( path );
 
     // Search texture cache first.
-    for (size_t i = 0, count = __textureCache.size(); i < count; ++i)
+    Texture* t = static_cast<Texture*>(__textureCache.find(path));
+    if (t)
     {
-        Texture* t = __textureCache[i];
-        GP_ASSERT( t );
-        if (t->_path == path)
+        if (mipmapSkip != t->_mipmapSkip && mipmapSkip >= 0)
+            t->setMipmapSkipOverride(mipmapSkip);
+
+        // If 'generateMipmaps' is true, call Texture::generateMipamps() to force the
+        // texture to generate its mipmap chain if it hasn't already done so. Images that
+        // were loaded without mipmaps are loaded again if their top levels are skipped.
+        if (generateMipmaps && !t->_mipmapped)
         {
-            // If 'generateMipmaps' is true, call Texture::generateMipamps() to force the
-            // texture to generate its mipmap chain if it hasn't already done so.
-            if (generateMipmaps)
-            {
+            bool skip = t->_type == TEXTURE_2D && endsWith(FileSystem::resolvePath(path), ".png", true) &&
+                        computeSkippedLevels(t->_mipmapSkip, getImageLevelCount(t->_width, t->_height)) > 0;
+            if (!skip || !t->reload(true))
                 t->generateMipmaps();
-            }
+        }
 
-            // Found a match.
-            t->addRef();
+        // Found a match.
+        t->addRef();
 
-            return t;
-        }
+        return t;
+    }
+
+    Texture* texture = load(path, generateMipmaps, mipmapSkip);
+    if (texture)
+    {
+        texture->_path = path;
+        texture->_cached = true;
+        __fileTextures.push_back(texture);
+
+        // Add to texture cache.
+        __textureCache.add(path, texture, getTextureMemorySize(texture));
+
+        return texture;
     }
 
+    GP_ERROR("Failed to load texture from file '%s'.", path);
+    return NULL;
+}
+
+Texture* Texture::load(const char* path, bool generateMipmaps, int mipmapSkip)
+{
+    GP_ASSERT( path );
+
     Texture* texture = NULL;
 
     // Filter loading based on file extension.
@@ -113,36 +305,260 @@ Texture* Texture::create(const char* path, bool generateMipmaps)
             {
                 Image* image = Image::create(path);
                 if (image)
-                    texture = create(image, generateMipmaps);
+                {
+                    // Only the images that get mipmaps skip their most detailed levels.
+                    unsigned int skip = generateMipmaps ? computeSkippedLevels(mipmapSkip, getImageLevelCount(image->getWidth(), image->getHeight())) : 0;
+                    Image* skipped = downsampleImage(image, skip);
+                    texture = create(skipped, generateMipmaps);
+                    if (texture)
+                        texture->_skippedLevels = skip;
+                    SAFE_RELEASE(skipped);
+                }
                 SAFE_RELEASE(image);
             }
             else if (tolower(ext[1]) == 'p' && tolower(ext[2]) == 'v' && tolower(ext[3]) == 'r')
             {
                 // PowerVR Compressed Texture RGBA.
-                texture = createCompressedPVRTC(path);
+                texture = createCompressedPVRTC(path, mipmapSkip);
             }
             else if (tolower(ext[1]) == 'd' && tolower(ext[2]) == 'd' && tolower(ext[3]) == 's')
             {
                 // DDS file format (DXT/S3TC) compressed textures
-                texture = createCompressedDDS(path);
+                texture = createCompressedDDS(path, mipmapSkip);
+            }
+            else if (tolower(ext[1]) == 'k' && tolower(ext[2]) == 't' && tolower(ext[3]) == 'x')
+            {
+                // KTX file format (ETC2/ASTC/BC7 and others) textures
+                texture = createCompressedKTX(path, mipmapSkip);
+            }
+            break;
+        case 5:
+            if (tolower(ext[1]) == 'k' && tolower(ext[2]) == 't' && tolower(ext[3]) == 'x' && ext[4] == '2')
+            {
+                // KTX2 file format textures
+                texture = createCompressedKTX(path, mipmapSkip);
             }
             break;
         }
     }
 
+    if (texture)
+        texture->_mipmapSkip = mipmapSkip;
+    return texture;
+}
+
+bool Texture::reload(bool generateMipmaps)
+{
+    GP_ASSERT( !_path.empty() );
+
+    Texture* texture = load(_path.c_str(), generateMipmaps, _mipmapSkip);
+    if (texture == NULL)
+    {
+        GP_WARN("Failed to reload texture from file '%s'.", _path.c_str());
+        return false;
+    }
+
+    // Take over the new texture object along with the state that it was created with, so that
+    // the samplers that refer to this texture set their own state on it again.
+    std::swap(_handle, texture->_handle);
+    _format = texture->_format;
+    _type = texture->_type;
+    _width = texture->_width;
+    _height = texture->_height;
+    _mipmapped = texture->_mipmapped;
+    _compressed = texture->_compressed;
+    _wrapS = texture->_wrapS;
+    _wrapT = texture->_wrapT;
+    _wrapR = texture->_wrapR;
+    _minFilter = texture->_minFilter;
+    _magFilter = texture->_magFilter;
+    _skippedLevels = texture->_skippedLevels;
+
+    TextureStreamer* streamer = Game::getInstance()->getTextureStreamer();
+    if (_streamEntry)
+    {
+        GP_ASSERT( streamer );
+        streamer->remove(_streamEntry);
+    }
+    if (texture->_streamEntry)
+    {
+        _streamEntry = texture->_streamEntry;
+        _streamEntry->texture = this;
+        texture->_streamEntry = NULL;
+    }
+    setMemorySize(texture->_memorySize);
+    texture->setMemorySize(0);
+    SAFE_RELEASE(texture);
+
+    if (_cached)
+        __textureCache.resize(_path.c_str(), this, getTextureMemorySize(this));
+    return true;
+}
+
+void Texture::setMipmapSkip(unsigned int levels)
+{
+    if (levels == __mipmapSkip)
+        return;
+    __mipmapSkip = levels;
+
+    // Load the mipmapped textures that follow the global number again. Textures that are reloaded
+    // get a new handle, which the samplers pick up the next time that they are bound.
+    std::vector<Texture*> textures(__fileTextures);
+    for (size_t i = 0, count = textures.size(); i < count; ++i)
+    {
+        Texture* texture = textures[i];
+        if (texture->_mipmapSkip < 0 && (texture->_mipmapped || texture->_skippedLevels > 0))
+            texture->reload(true);
+    }
+}
+
+unsigned int Texture::getMipmapSkip()
+{
+    return __mipmapSkip;
+}
+
+void Texture::setMipmapSkipOverride(int levels)
+{
+    levels = std::max(-1, levels);
+    if (levels == _mipmapSkip)
+        return;
+
+    unsigned int previous = _mipmapSkip < 0 ? __mipmapSkip : (unsigned int)_mipmapSkip;
+    _mipmapSkip = levels;
+    unsigned int current = _mipmapSkip < 0 ? __mipmapSkip : (unsigned int)_mipmapSkip;
+    if (current != previous && (_mipmapped || _skippedLevels > 0) && std::find(__fileTextures.begin(), __fileTextures.end(), this) != __fileTextures.end())
+        reload(true);
+}
+
+int Texture::getMipmapSkipOverride() const
+{
+    return _mipmapSkip;
+}
+
+unsigned int Texture::getSkippedLevels() const
+{
+    return _skippedLevels;
+}
+
+Texture* Texture::createCached(const char* path, Image* image)
+{
+    GP_ASSERT( path );
+    GP_ASSERT( image );
+
+    Texture* t = static_cast<Texture*>(__textureCache.find(path));
+    if (t)
+    {
+        t->addRef();
+        return t;
+    }
+
+    // Mipmaps are generated when the texture is requested with them (see create).
+    Texture* texture = create(image, false);
     if (texture)
     {
         texture->_path = path;
         texture->_cached = true;
+        __fileTextures.push_back(texture);
+        __textureCache.add(path, texture, getTextureMemorySize(texture));
+    }
+    return texture;
+}
 
-        // Add to texture cache.
-        __textureCache.push_back(texture);
+Texture::AsyncLoad* Texture::createAsync(const char* path, bool generateMipmaps)
+{
+    GP_ASSERT( path );
 
-        return texture;
+    AsyncLoad* load = new AsyncLoad();
+    load->_path = path;
+    load->_generateMipmaps = generateMipmaps;
+    load->_mipmapSkip = __mipmapSkip;
+
+    // Only PNG images need decoding; other textures are loaded the regular way.
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    if (jobSystem == NULL || __textureCache.find(path) || !endsWith(FileSystem::resolvePath(path), ".png", true))
+    {
+        load->_texture = create(path, generateMipmaps);
+        load->_finished = true;
+        return load;
     }
 
-    GP_ERROR("Failed to load texture from file '%s'.", path);
-    return NULL;
+    // The pending loads hold a reference so that the handle can be released while its image is decoded.
+    load->addRef();
+    __asyncLoads.push_back(load);
+    load->_job = jobSystem->create(&Texture::decodeAsync, load);
+    jobSystem->run(load->_job);
+    return load;
+}
+
+void Texture::decodeAsync(void* cookie)
+{
+    AsyncLoad* load = (AsyncLoad*)cookie;
+    load->_image = Image::create(load->_path.c_str());
+
+    // The most detailed levels of images that get mipmaps are skipped on the worker as well.
+    if (load->_image && load->_generateMipmaps)
+    {
+        load->_skippedLevels = computeSkippedLevels((int)load->_mipmapSkip, getImageLevelCount(load->_image->getWidth(), load->_image->getHeight()));
+        Image* image = downsampleImage(load->_image, load->_skippedLevels);
+        SAFE_RELEASE(load->_image);
+        load->_image = image;
+    }
+}
+
+void Texture::updateAsync()
+{
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    for (size_t i = 0; i < __asyncLoads.size();)
+    {
+        AsyncLoad* load = __asyncLoads[i];
+        GP_ASSERT( jobSystem );
+        if (!jobSystem->isFinished(load->_job))
+        {
+            ++i;
+            continue;
+        }
+        jobSystem->release(load->_job);
+        load->_job = NULL;
+
+        // Nothing is uploaded for the loads whose handles have already been released.
+        if (load->_image && load->getRefCount() > 1)
+        {
+            bool cached = __textureCache.find(load->_path.c_str()) != NULL;
+            load->_texture = createCached(load->_path.c_str(), load->_image);
+            if (load->_texture && !cached)
+                load->_texture->_skippedLevels = load->_skippedLevels;
+            if (load->_texture && load->_generateMipmaps)
+                load->_texture->generateMipmaps();
+        }
+        if (load->_texture == NULL && load->getRefCount() > 1)
+            GP_ERROR("Failed to load texture from file '%s'.", load->_path.c_str());
+        SAFE_RELEASE(load->_image);
+        load->_finished = true;
+
+        __asyncLoads.erase(__asyncLoads.begin() + i);
+        SAFE_RELEASE(load);
+    }
+}
+
+void Texture::finalizeAsync()
+{
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    for (size_t i = 0, count = __asyncLoads.size(); i < count; ++i)
+    {
+        AsyncLoad* load = __asyncLoads[i];
+        GP_ASSERT( jobSystem );
+        jobSystem->wait(load->_job);
+        load->_job = NULL;
+        SAFE_RELEASE(load->_image);
+        load->_finished = true;
+        SAFE_RELEASE(load);
+    }
+    __asyncLoads.clear();
+}
+
+ResourceCache* Texture::getCache()
+{
+    return &__textureCache;
 }
 
 Texture* Texture::create(Image* image, bool generateMipmaps)
@@ -170,7 +586,7 @@ Texture* Texture::create(Format format, unsigned int width, unsigned int height,
     // Create the texture.
     GLuint textureId;
     GL_ASSERT( glGenTextures(1, &textureId) );
-    GL_ASSERT( glBindTexture(target, textureId) );
+    RenderState::bindTexture(target, textureId);
     GL_ASSERT( glPixelStorei(GL_UNPACK_ALIGNMENT, 1) );
 #ifndef OPENGL_ES
     // glGenerateMipmap is new in OpenGL 3.0. For OpenGL 2.0 we must fallback to use glTexParameteri
@@ -182,8 +598,13 @@ Texture* Texture::create(Format format, unsigned int width, unsigned int height,
     // Load the texture
     if (type == Texture::TEXTURE_2D)
     {
-        // Texture 2D
-        GL_ASSERT( glTexImage2D(GL_TEXTURE_2D, 0, (GLenum)format, width, height, 0, (GLenum)format, GL_UNSIGNED_BYTE, data) );
+        // Texture 2D. With asynchronous uploads the storage is allocated first and the data follows through the upload ring.
+        bool uploaded = data && TextureUploader::isEnabled();
+        GL_ASSERT( glTexImage2D(GL_TEXTURE_2D, 0, (GLenum)format, width, height, 0, (GLenum)format, GL_UNSIGNED_BYTE, uploaded ? NULL : data) );
+        if (uploaded && !TextureUploader::upload(GL_TEXTURE_2D, 0, 0, 0, width, height, (GLenum)format, data, getFormatSize(format) * width * height))
+        {
+            GL_ASSERT( glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, (GLenum)format, GL_UNSIGNED_BYTE, data) );
+        }
     }
     else
     {
@@ -202,7 +623,7 @@ Texture* Texture::create(Format format, unsigned int width, unsigned int height,
             case Texture::UNKNOWN:
                 if (data)
                 {
-                    glDeleteTextures(1, &textureId);
+                    RenderState::deleteTexture(textureId);
                     GP_ERROR("Failed to determine texture size because format is UNKNOWN.");
                     return NULL;
                 }
@@ -231,9 +652,7 @@ Texture* Texture::create(Format format, unsigned int width, unsigned int height,
     {
         texture->generateMipmaps();
     }
-
-    // Restore the texture id
-    GL_ASSERT( glBindTexture((GLenum)__currentTextureType, __currentTextureId) );
+    texture->setMemorySize(getTextureMemorySize(texture));
 
     return texture;
 }
@@ -247,7 +666,12 @@ Texture* Texture::create(TextureHandle handle, int width, int height, Format for
     {
         // There is no real way to query for texture type, but an error will be returned if a cube texture is bound to a 2D texture... so check for that
         glBindTexture(GL_TEXTURE_CUBE_MAP, handle);
-        if (glGetError() == GL_NO_ERROR)
+        GLenum error = glGetError();
+
+        // The probe bypasses the cached texture bindings, so they must be discarded.
+        RenderState::resetStateCache();
+
+        if (error == GL_NO_ERROR)
         {
             texture->_type = TEXTURE_CUBE;
         }
@@ -256,18 +680,146 @@ Texture* Texture::create(TextureHandle handle, int width, int height, Format for
             // For now, it's either or. But if 3D textures and others are added, it might be useful to simply test a bunch of bindings and seeing which one doesn't error out
             texture->_type = TEXTURE_2D;
         }
-
-        // Restore the texture id
-        GL_ASSERT( glBindTexture((GLenum)__currentTextureType, __currentTextureId) );
     }
     texture->_handle = handle;
     texture->_format = format;
     texture->_width = width;
     texture->_height = height;
+    texture->setMemorySize(getTextureMemorySize(texture));
+
+    return texture;
+}
+
+Texture* Texture::createArray(Format format, unsigned int width, unsigned int height, unsigned int layerCount,
+                              const unsigned char* data, bool generateMipmaps)
+{
+    GP_ASSERT( layerCount > 0 );
+
+    if (!isArraySupported())
+    {
+        GP_ERROR("Failed to create texture array; texture arrays are not supported by the device.");
+        return NULL;
+    }
+
+#ifdef GP_USE_TEXTURE_ARRAY
+    GLuint textureId;
+    GL_ASSERT( glGenTextures(1, &textureId) );
+    RenderState::bindTexture(GL_TEXTURE_2D_ARRAY, textureId);
+    GL_ASSERT( glPixelStorei(GL_UNPACK_ALIGNMENT, 1) );
+    GL_ASSERT( glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, (GLenum)format, width, height, layerCount, 0, (GLenum)format, GL_UNSIGNED_BYTE, data) );
+
+    // Set initial minification filter based on whether or not mipmaping was enabled.
+    Filter minFilter = generateMipmaps ? NEAREST_MIPMAP_LINEAR : LINEAR;
+    GL_ASSERT( glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, minFilter) );
+
+    Texture* texture = new Texture();
+    texture->_handle = textureId;
+    texture->_format = format;
+    texture->_type = TEXTURE_2D_ARRAY;
+    texture->_width = width;
+    texture->_height = height;
+    texture->_layerCount = layerCount;
+    texture->_minFilter = minFilter;
+    if (generateMipmaps)
+    {
+        texture->generateMipmaps();
+    }
+    texture->setMemorySize(getTextureMemorySize(texture));
+
+    return texture;
+#else
+    return NULL;
+#endif
+}
+
+Texture* Texture::createArray(const std::vector<std::string>& paths, bool generateMipmaps)
+{
+    GP_ASSERT( !paths.empty() );
+
+    // Arrays are cached under the list of their paths.
+    std::string key;
+    for (size_t i = 0, count = paths.size(); i < count; ++i)
+    {
+        if (i > 0)
+            key += ';';
+        key += paths[i];
+    }
+    Texture* t = static_cast<Texture*>(__textureCache.find(key.c_str()));
+    if (t)
+    {
+        if (generateMipmaps)
+        {
+            t->generateMipmaps();
+        }
+        t->addRef();
+        return t;
+    }
+
+    if (!isArraySupported())
+    {
+        GP_ERROR("Failed to create texture array '%s'; texture arrays are not supported by the device.", key.c_str());
+        return NULL;
+    }
+
+    std::vector<Image*> images;
+    Image::createBatch(paths, &images);
+
+    // Every layer of an array has the same size and format.
+    Texture* texture = NULL;
+    bool valid = true;
+    for (size_t i = 0, count = images.size(); i < count && valid; ++i)
+    {
+        if (images[i] == NULL)
+        {
+            GP_WARN("Failed to load image '%s' for texture array.", paths[i].c_str());
+            valid = false;
+        }
+        else if (images[i]->getWidth() != images[0]->getWidth() || images[i]->getHeight() != images[0]->getHeight() ||
+                 images[i]->getFormat() != images[0]->getFormat())
+        {
+            GP_WARN("Failed to create texture array; image '%s' does not have the size and format of image '%s'.", paths[i].c_str(), paths[0].c_str());
+            valid = false;
+        }
+    }
+    if (valid)
+    {
+        Format format = images[0]->getFormat() == Image::RGBA ? RGBA : RGB;
+        texture = createArray(format, images[0]->getWidth(), images[0]->getHeight(), (unsigned int)images.size(), NULL, false);
+    }
+    if (texture)
+    {
+        for (size_t i = 0, count = images.size(); i < count; ++i)
+        {
+            texture->setLayerData((unsigned int)i, images[i]->getData());
+        }
+        if (generateMipmaps)
+        {
+            texture->_minFilter = NEAREST_MIPMAP_LINEAR;
+            GL_ASSERT( glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, NEAREST_MIPMAP_LINEAR) );
+            texture->generateMipmaps();
+        }
 
+        texture->_path = key;
+        texture->_cached = true;
+        __textureCache.add(key.c_str(), texture, getTextureMemorySize(texture));
+    }
+
+    for (size_t i = 0, count = images.size(); i < count; ++i)
+    {
+        SAFE_RELEASE(images[i]);
+    }
     return texture;
 }
 
+bool Texture::isArraySupported()
+{
+#ifdef GP_USE_TEXTURE_ARRAY
+    return GLEW_VERSION_3_0 || GLEW_EXT_texture_array;
+#else
+    return false;
+#endif
+}
+
 void Texture::setData(const unsigned char* data)
 {
     // Don't work with any compressed or cached textures
@@ -275,12 +827,22 @@ void Texture::setData(const unsigned char* data)
     GP_ASSERT( (!_compressed) );
     GP_ASSERT( (!_cached) );
 
-    GL_ASSERT( glBindTexture((GLenum)_type, _handle) );
+    RenderState::bindTexture((GLenum)_type, _handle);
 
     if (_type == Texture::TEXTURE_2D)
     {
-        GL_ASSERT( glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _width, _height, (GLenum)_format, GL_UNSIGNED_BYTE, data) );
+        if (!TextureUploader::upload(GL_TEXTURE_2D, 0, 0, 0, _width, _height, (GLenum)_format, data, getFormatSize(_format) * _width * _height))
+        {
+            GL_ASSERT( glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _width, _height, (GLenum)_format, GL_UNSIGNED_BYTE, data) );
+        }
+    }
+#ifdef GP_USE_TEXTURE_ARRAY
+    else if (_type == Texture::TEXTURE_2D_ARRAY)
+    {
+        GL_ASSERT( glPixelStorei(GL_UNPACK_ALIGNMENT, 1) );
+        GL_ASSERT( glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, _width, _height, _layerCount, (GLenum)_format, GL_UNSIGNED_BYTE, data) );
     }
+#endif
     else
     {
         // Get texture size
@@ -307,9 +869,37 @@ void Texture::setData(const unsigned char* data)
     {
         generateMipmaps();
     }
+}
+
+void Texture::setData(const unsigned char* data, unsigned int x, unsigned int y, unsigned int width, unsigned int height)
+{
+    GP_ASSERT( data );
+    GP_ASSERT( (!_compressed) );
+    GP_ASSERT( (!_cached) );
+    GP_ASSERT( _type == Texture::TEXTURE_2D );
+    GP_ASSERT( x + width <= _width && y + height <= _height );
+
+    RenderState::bindTexture((GLenum)_type, _handle);
+
+    if (TextureUploader::upload(GL_TEXTURE_2D, 0, x, y, width, height, (GLenum)_format, data, getFormatSize(_format) * width * height))
+        return;
+
+    GL_ASSERT( glPixelStorei(GL_UNPACK_ALIGNMENT, 1) );
+    GL_ASSERT( glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, (GLenum)_format, GL_UNSIGNED_BYTE, data) );
+}
+
+void Texture::setLayerData(unsigned int layer, const unsigned char* data)
+{
+    GP_ASSERT( data );
+    GP_ASSERT( _type == Texture::TEXTURE_2D_ARRAY );
+    GP_ASSERT( layer < _layerCount );
 
-    // Restore the texture id
-    GL_ASSERT( glBindTexture((GLenum)__currentTextureType, __currentTextureId) );
+#ifdef GP_USE_TEXTURE_ARRAY
+    RenderState::bindTexture(GL_TEXTURE_2D_ARRAY, _handle);
+
+    GL_ASSERT( glPixelStorei(GL_UNPACK_ALIGNMENT, 1) );
+    GL_ASSERT( glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, _width, _height, 1, (GLenum)_format, GL_UNSIGNED_BYTE, data) );
+#endif
 }
 
 // Computes the size of a PVRTC data chunk for a mipmap level of the given size.
@@ -335,7 +925,7 @@ static unsigned int computePVRTCDataSize(int width, int height, int bpp)
     return widthBlocks * heightBlocks * ((blockSize  * bpp) >> 3);
 }
 
-Texture* Texture::createCompressedPVRTC(const char* path)
+Texture* Texture::createCompressedPVRTC(const char* path, int mipmapSkip)
 {
     std::unique_ptr<Stream> stream(FileSystem::open(path));
     if (stream.get() == NULL || !stream->canRead())
@@ -388,11 +978,22 @@ Texture* Texture::createCompressedPVRTC(const char* path)
 
     int bpp = (format == GL_COMPRESSED_RGB_PVRTC_2BPPV1_IMG || format == GL_COMPRESSED_RGBA_PVRTC_2BPPV1_IMG) ? 2 : 4;
 
+    // The most detailed levels that are skipped are not uploaded.
+    unsigned int skip = computeSkippedLevels(mipmapSkip, mipMapCount);
+    GLubyte* ptr = data;
+    for (unsigned int level = 0; level < skip; ++level)
+    {
+        ptr += computePVRTCDataSize(width, height, bpp) * faceCount;
+        width = std::max(width >> 1, 1);
+        height = std::max(height >> 1, 1);
+    }
+    mipMapCount -= skip;
+
     // Generate our texture.
     GLenum target = faceCount > 1 ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
     GLuint textureId;
     GL_ASSERT( glGenTextures(1, &textureId) );
-    GL_ASSERT( glBindTexture(target, textureId) );
+    RenderState::bindTexture(target, textureId);
 
     Filter minFilter = mipMapCount > 1 ? NEAREST_MIPMAP_LINEAR : LINEAR;
     GL_ASSERT( glTexParameteri(target, GL_TEXTURE_MIN_FILTER, minFilter) );
@@ -405,9 +1006,9 @@ Texture* Texture::createCompressedPVRTC(const char* path)
     texture->_mipmapped = mipMapCount > 1;
     texture->_compressed = true;
     texture->_minFilter = minFilter;
+    texture->_skippedLevels = skip;
 
     // Load the data for each level.
-    GLubyte* ptr = data;
     for (unsigned int level = 0; level < mipMapCount; ++level)
     {
         unsigned int dataSize = computePVRTCDataSize(width, height, bpp);
@@ -426,9 +1027,7 @@ Texture* Texture::createCompressedPVRTC(const char* path)
     // Free data.
     SAFE_DELETE_ARRAY(data);
 
-    // Restore the texture id
-    GL_ASSERT( glBindTexture((GLenum)__currentTextureType, __currentTextureId) );
-
+    texture->setMemorySize(getTextureMemorySize(texture));
     return texture;
 }
 
@@ -718,7 +1317,7 @@ int Texture::getMaskByteIndex(unsigned int mask)
     }
 }
 
-Texture* Texture::createCompressedDDS(const char* path)
+Texture* Texture::createCompressedDDS(const char* path, int mipmapSkip)
 {
     GP_ASSERT( path );
 
@@ -816,6 +1415,21 @@ Texture* Texture::createCompressedDDS(const char* path)
         return NULL;
     }
 
+    // The most detailed levels that the texture skips are never read.
+    unsigned int skip = computeSkippedLevels(mipmapSkip, header.dwMipMapCount);
+    unsigned int skippedWidth = std::max(1u, header.dwWidth >> skip);
+    unsigned int skippedHeight = std::max(1u, header.dwHeight >> skip);
+
+    // Mipmapped 2D textures can be streamed, in which case the most detailed levels are skipped
+    // and their location in the file is recorded so that they can be read later.
+    TextureStreamer* streamer = Game::getInstance()->getTextureStreamer();
+    bool streaming = streamer && streamer->isEnabled() && target == GL_TEXTURE_2D && header.dwMipMapCount - skip > 1;
+    unsigned int baseLevel = skip;
+    unsigned int offset = 4 + sizeof(dds_header);
+    std::vector<TextureStreamer::Level> streamLevels;
+    if (streaming)
+        baseLevel += TextureStreamer::getTailLevel(skippedWidth, skippedHeight, header.dwMipMapCount - skip);
+
     // Allocate mip level structures.
     dds_mip_level* mipLevels = new dds_mip_level[header.dwMipMapCount * facecount];
     memset(mipLevels, 0, sizeof(dds_mip_level) * header.dwMipMapCount * facecount);
@@ -878,9 +1492,27 @@ Texture* Texture::createCompressedDDS(const char* path)
                 level.width = width;
                 level.height = height;
                 level.size = std::max(1, (width + 3) >> 2) * std::max(1, (height + 3) >> 2) * bytesPerBlock;
-                level.data = new GLubyte[level.size];
+                if (streaming)
+                {
+                    TextureStreamer::Level streamLevel = { offset, (unsigned int)level.size, (unsigned int)width, (unsigned int)height };
+                    if (i >= skip)
+                        streamLevels.push_back(streamLevel);
+                    offset += level.size;
+                }
 
-                if (stream->read(level.data, 1, level.size) != (unsigned int)level.size)
+                // The most detailed levels of streamed textures are read when they are needed.
+                bool loaded;
+                if (i < baseLevel)
+                {
+                    level.data = NULL;
+                    loaded = stream->seek(level.size, SEEK_CUR);
+                }
+                else
+                {
+                    level.data = new GLubyte[level.size];
+                    loaded = stream->read(level.data, 1, level.size) == (unsigned int)level.size;
+                }
+                if (!loaded)
                 {
                     GP_ERROR("Failed to load dds compressed texture bytes for texture: %s", path);
 
@@ -938,6 +1570,13 @@ Texture* Texture::createCompressedDDS(const char* path)
             }
         }
 
+        // Levels that need color conversion are not streamed.
+        if (colorConvert)
+        {
+            streaming = false;
+            baseLevel = skip;
+        }
+
         if (format == 0)
         {
             GP_ERROR("Failed to create texture from uncompressed DDS file '%s': Unsupported color format (must be one of R8G8B8, A8R8G8B8, A8B8G8R8, X8R8G8B8, X8B8G8R8.", path);
@@ -955,9 +1594,27 @@ Texture* Texture::createCompressedDDS(const char* path)
                 level.width = width;
                 level.height = height;
                 level.size = width * height * (header.ddspf.dwRGBBitCount >> 3);
-                level.data = new GLubyte[level.size];
+                if (streaming)
+                {
+                    TextureStreamer::Level streamLevel = { offset, (unsigned int)level.size, (unsigned int)width, (unsigned int)height };
+                    if (i >= skip)
+                        streamLevels.push_back(streamLevel);
+                    offset += level.size;
+                }
 
-                if (stream->read(level.data, 1, level.size) != (unsigned int)level.size)
+                // The most detailed levels of streamed textures are read when they are needed.
+                bool loaded;
+                if (i < baseLevel)
+                {
+                    level.data = NULL;
+                    loaded = stream->seek(level.size, SEEK_CUR);
+                }
+                else
+                {
+                    level.data = new GLubyte[level.size];
+                    loaded = stream->read(level.data, 1, level.size) == (unsigned int)level.size;
+                }
+                if (!loaded)
                 {
                     GP_ERROR("Failed to load bytes for RGB dds texture: %s", path);
 
@@ -990,7 +1647,7 @@ Texture* Texture::createCompressedDDS(const char* path)
             {
                 for (unsigned int face = 0; face < facecount; ++face)
                 {
-                    for (unsigned int i = 0; i < header.dwMipMapCount; ++i)
+                    for (unsigned int i = skip; i < header.dwMipMapCount; ++i)
                     {
                         dds_mip_level& level = mipLevels[i + face * header.dwMipMapCount];
                         for (int j = 0; j < level.size; j += 3)
@@ -1006,7 +1663,7 @@ Texture* Texture::createCompressedDDS(const char* path)
             {
                 for (unsigned int face = 0; face < facecount; ++face)
                 {
-                    for (unsigned int i = 0; i < header.dwMipMapCount; ++i)
+                    for (unsigned int i = skip; i < header.dwMipMapCount; ++i)
                     {
                         dds_mip_level& level = mipLevels[i + face * header.dwMipMapCount];
                         for (int j = 0; j < level.size; j += 4)
@@ -1034,35 +1691,36 @@ Texture* Texture::createCompressedDDS(const char* path)
     // Generate GL texture.
     GLuint textureId;
     GL_ASSERT( glGenTextures(1, &textureId) );
-    GL_ASSERT( glBindTexture(target, textureId) );
+    RenderState::bindTexture(target, textureId);
 
-    Filter minFilter = header.dwMipMapCount > 1 ? NEAREST_MIPMAP_LINEAR : LINEAR;
+    Filter minFilter = header.dwMipMapCount - skip > 1 ? NEAREST_MIPMAP_LINEAR : LINEAR;
     GL_ASSERT( glTexParameteri(target, GL_TEXTURE_MIN_FILTER, minFilter ) );
 
     // Create gameplay texture.
     texture = new Texture();
     texture->_handle = textureId;
     texture->_type = (Type)target;
-    texture->_width = header.dwWidth;
-    texture->_height = header.dwHeight;
+    texture->_width = skippedWidth;
+    texture->_height = skippedHeight;
     texture->_compressed = compressed;
-    texture->_mipmapped = header.dwMipMapCount > 1;
+    texture->_mipmapped = header.dwMipMapCount - skip > 1;
     texture->_minFilter = minFilter;
+    texture->_skippedLevels = skip;
 
     // Load texture data.
     for (unsigned int face = 0; face < facecount; ++face)
     {
         GLenum texImageTarget = faces[face];
-        for (unsigned int i = 0; i < header.dwMipMapCount; ++i)
+        for (unsigned int i = baseLevel; i < header.dwMipMapCount; ++i)
         {
             dds_mip_level& level = mipLevels[i + face * header.dwMipMapCount];
             if (compressed)
             {
-                GL_ASSERT(glCompressedTexImage2D(texImageTarget, i, format, level.width, level.height, 0, level.size, level.data));
+                GL_ASSERT(glCompressedTexImage2D(texImageTarget, i - baseLevel, format, level.width, level.height, 0, level.size, level.data));
             }
             else
             {
-                GL_ASSERT(glTexImage2D(texImageTarget, i, internalFormat, level.width, level.height, 0, format, GL_UNSIGNED_BYTE, level.data));
+                GL_ASSERT(glTexImage2D(texImageTarget, i - baseLevel, internalFormat, level.width, level.height, 0, format, GL_UNSIGNED_BYTE, level.data));
             }
 
             // Clean up the texture data.
@@ -1073,9 +1731,349 @@ Texture* Texture::createCompressedDDS(const char* path)
     // Clean up mip levels structure.
     SAFE_DELETE_ARRAY(mipLevels);
 
-    // Restore the texture id
-    GL_ASSERT( glBindTexture((GLenum)__currentTextureType, __currentTextureId) );
+    // Streamed textures count the memory of their resident levels instead.
+    if (streaming)
+    {
+        texture->_streamEntry = streamer->add(texture, path, format, internalFormat, compressed, streamLevels, baseLevel - skip);
+    }
+    else
+    {
+        texture->setMemorySize(getTextureMemorySize(texture));
+    }
+
+    return texture;
+}
+
+// Returns the GL internal format of the Vulkan format of a KTX2 file, or 0 if it is not supported.
+// The format of the data is returned in 'format' for uncompressed formats, and 0 for compressed ones.
+static GLenum getKTX2Format(unsigned int vkFormat, GLenum* format)
+{
+    *format = 0;
+
+    // ASTC 4x4 to 12x12, alternating between UNORM and SRGB.
+    if (vkFormat >= 157 && vkFormat <= 184)
+    {
+        unsigned int index = vkFormat - 157;
+        return ((index & 1) ? GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR : GL_COMPRESSED_RGBA_ASTC_4x4_KHR) + (index >> 1);
+    }
+
+    // ETC2 RGB8, RGB8A1 and RGBA8 (UNORM and SRGB), followed by EAC R11 and RG11 (UNORM and SNORM).
+    if (vkFormat >= 147 && vkFormat <= 152)
+        return GL_COMPRESSED_RGB8_ETC2 + (vkFormat - 147);
+    if (vkFormat >= 153 && vkFormat <= 156)
+        return GL_COMPRESSED_R11_EAC + (vkFormat - 153);
+
+    switch (vkFormat)
+    {
+    case 131: // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case 132: // VK_FORMAT_BC1_RGB_SRGB_BLOCK
+        return GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;
+    case 133: // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+        return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    case 134: // VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+        return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+    case 135: // VK_FORMAT_BC2_UNORM_BLOCK
+        return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+    case 136: // VK_FORMAT_BC2_SRGB_BLOCK
+        return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT;
+    case 137: // VK_FORMAT_BC3_UNORM_BLOCK
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case 138: // VK_FORMAT_BC3_SRGB_BLOCK
+        return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+    case 145: // VK_FORMAT_BC7_UNORM_BLOCK
+        return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    case 146: // VK_FORMAT_BC7_SRGB_BLOCK
+        return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+    case 23: // VK_FORMAT_R8G8B8_UNORM
+        *format = GL_RGB;
+        return GL_RGB;
+    case 37: // VK_FORMAT_R8G8B8A8_UNORM
+        *format = GL_RGBA;
+        return GL_RGBA;
+    default:
+        return 0;
+    }
+}
+
+Texture* Texture::createCompressedKTX(const char* path, int mipmapSkip)
+{
+    GP_ASSERT( path );
+
+    std::unique_ptr<Stream> stream(FileSystem::open(path));
+    if (stream.get() == NULL || !stream->canRead())
+    {
+        GP_ERROR("Failed to open file '%s'.", path);
+        return NULL;
+    }
+
+    // The identifier tells the version of the file.
+    char identifier[KTX_IDENTIFIER_LENGTH];
+    if (stream->read(identifier, 1, KTX_IDENTIFIER_LENGTH) != KTX_IDENTIFIER_LENGTH)
+    {
+        GP_ERROR("Failed to read KTX file '%s': invalid KTX identifier.", path);
+        return NULL;
+    }
+    if (memcmp(identifier, KTX1_IDENTIFIER, KTX_IDENTIFIER_LENGTH) == 0)
+        return readCompressedKTX1(path, stream.get(), mipmapSkip);
+    if (memcmp(identifier, KTX2_IDENTIFIER, KTX_IDENTIFIER_LENGTH) == 0)
+        return readCompressedKTX2(path, stream.get(), mipmapSkip);
+
+    GP_ERROR("Failed to read KTX file '%s': invalid KTX identifier.", path);
+    return NULL;
+}
+
+Texture* Texture::readCompressedKTX1(const char* path, Stream* stream, int mipmapSkip)
+{
+    struct ktx1_header
+    {
+        unsigned int endianness;
+        unsigned int glType;
+        unsigned int glTypeSize;
+        unsigned int glFormat;
+        unsigned int glInternalFormat;
+        unsigned int glBaseInternalFormat;
+        unsigned int pixelWidth;
+        unsigned int pixelHeight;
+        unsigned int pixelDepth;
+        unsigned int numberOfArrayElements;
+        unsigned int numberOfFaces;
+        unsigned int numberOfMipmapLevels;
+        unsigned int bytesOfKeyValueData;
+    };
+
+    ktx1_header header;
+    if (stream->read(&header, sizeof(ktx1_header), 1) != 1)
+    {
+        GP_ERROR("Failed to read header for KTX file '%s'.", path);
+        return NULL;
+    }
+    if (header.endianness != KTX_ENDIANNESS)
+    {
+        GP_ERROR("Failed to create texture from KTX file '%s': big endian files are unsupported.", path);
+        return NULL;
+    }
+    if (header.pixelDepth > 1 || header.numberOfArrayElements > 0 || (header.numberOfFaces != 1 && header.numberOfFaces != 6))
+    {
+        GP_ERROR("Failed to create texture from KTX file '%s': array and volume textures are unsupported.", path);
+        return NULL;
+    }
+
+    // Compressed textures do not have a type.
+    bool compressed = header.glType == 0;
+    if (!compressed && (header.glType != GL_UNSIGNED_BYTE || (header.glFormat != GL_RGB && header.glFormat != GL_RGBA)))
+    {
+        GP_ERROR("Failed to create texture from KTX file '%s': unsupported format (must be compressed, RGB8 or RGBA8).", path);
+        return NULL;
+    }
+
+    // Skip the key/value data.
+    if (header.bytesOfKeyValueData > 0 && !stream->seek(header.bytesOfKeyValueData, SEEK_CUR))
+    {
+        GP_ERROR("Failed to read KTX file '%s'.", path);
+        return NULL;
+    }
+
+    // Uncompressed textures use the unsized base format, which is what OpenGL ES 2 expects.
+    unsigned int levelCount = std::max(1u, header.numberOfMipmapLevels);
+    unsigned int skip = computeSkippedLevels(mipmapSkip, levelCount);
+    GLenum target = header.numberOfFaces == 6 ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+    GLenum internalFormat = compressed ? header.glInternalFormat : header.glBaseInternalFormat;
+    GLenum format = compressed ? 0 : header.glFormat;
+    Texture* texture = createKTX(target, std::max(1u, header.pixelWidth >> skip), std::max(1u, header.pixelHeight >> skip), levelCount - skip, format);
+    texture->_skippedLevels = skip;
+
+    // Rows of uncompressed images are aligned to four bytes.
+    if (!compressed)
+        GL_ASSERT( glPixelStorei(GL_UNPACK_ALIGNMENT, 4) );
+
+    std::vector<GLubyte> data;
+    bool failed = false;
+    for (unsigned int level = 0; level < levelCount && !failed; ++level)
+    {
+        GLsizei width = std::max(1u, header.pixelWidth >> level);
+        GLsizei height = std::max(1u, header.pixelHeight >> level);
+
+        // The size of each face of the level, which are padded to four bytes.
+        unsigned int imageSize;
+        if (stream->read(&imageSize, 4, 1) != 1)
+        {
+            failed = true;
+            break;
+        }
+        unsigned int padding = 3 - ((imageSize + 3) % 4);
+
+        // The levels that are skipped are stepped over without being read.
+        if (level < skip)
+        {
+            if (!stream->seek((imageSize + padding) * header.numberOfFaces, SEEK_CUR))
+                failed = true;
+            continue;
+        }
+        data.resize(std::max(1u, imageSize));
+
+        for (unsigned int face = 0; face < header.numberOfFaces; ++face)
+        {
+            if (stream->read(&data[0], 1, imageSize) != imageSize || (padding > 0 && !stream->seek(padding, SEEK_CUR)))
+            {
+                failed = true;
+                break;
+            }
+
+            GLenum faceTarget = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+            if (compressed)
+            {
+                GL_ASSERT( glCompressedTexImage2D(faceTarget, level - skip, internalFormat, width, height, 0, imageSize, &data[0]) );
+            }
+            else
+            {
+                GL_ASSERT( glTexImage2D(faceTarget, level - skip, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, &data[0]) );
+            }
+        }
+    }
 
+    if (!compressed)
+        GL_ASSERT( glPixelStorei(GL_UNPACK_ALIGNMENT, 1) );
+
+    if (failed)
+    {
+        GP_ERROR("Failed to read texture data from KTX file '%s'.", path);
+        SAFE_RELEASE(texture);
+    }
+    return texture;
+}
+
+Texture* Texture::readCompressedKTX2(const char* path, Stream* stream, int mipmapSkip)
+{
+    struct ktx2_header
+    {
+        unsigned int vkFormat;
+        unsigned int typeSize;
+        unsigned int pixelWidth;
+        unsigned int pixelHeight;
+        unsigned int pixelDepth;
+        unsigned int layerCount;
+        unsigned int faceCount;
+        unsigned int levelCount;
+        unsigned int supercompressionScheme;
+        unsigned int dfdByteOffset;
+        unsigned int dfdByteLength;
+        unsigned int kvdByteOffset;
+        unsigned int kvdByteLength;
+        unsigned long long sgdByteOffset;
+        unsigned long long sgdByteLength;
+    };
+
+    struct ktx2_level
+    {
+        unsigned long long byteOffset;
+        unsigned long long byteLength;
+        unsigned long long uncompressedByteLength;
+    };
+
+    ktx2_header header;
+    if (stream->read(&header, sizeof(ktx2_header), 1) != 1)
+    {
+        GP_ERROR("Failed to read header for KTX2 file '%s'.", path);
+        return NULL;
+    }
+    if (header.pixelDepth > 1 || header.layerCount > 1 || (header.faceCount != 1 && header.faceCount != 6))
+    {
+        GP_ERROR("Failed to create texture from KTX2 file '%s': array and volume textures are unsupported.", path);
+        return NULL;
+    }
+    if (header.supercompressionScheme != 0)
+    {
+        GP_ERROR("Failed to create texture from KTX2 file '%s': supercompressed files are unsupported.", path);
+        return NULL;
+    }
+
+    GLenum format;
+    GLenum internalFormat = getKTX2Format(header.vkFormat, &format);
+    if (internalFormat == 0)
+    {
+        GP_ERROR("Failed to create texture from KTX2 file '%s': unsupported format (%u).", path, header.vkFormat);
+        return NULL;
+    }
+    bool compressed = format == 0;
+
+    // The level index follows the header.
+    unsigned int levelCount = std::max(1u, header.levelCount);
+    std::vector<ktx2_level> levels(levelCount);
+    if (stream->read(&levels[0], sizeof(ktx2_level), levelCount) != levelCount)
+    {
+        GP_ERROR("Failed to read level index for KTX2 file '%s'.", path);
+        return NULL;
+    }
+
+    // The level index gives the offset of each level, so the skipped levels are never read.
+    unsigned int skip = computeSkippedLevels(mipmapSkip, levelCount);
+    GLenum target = header.faceCount == 6 ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+    Texture* texture = createKTX(target, std::max(1u, header.pixelWidth >> skip), std::max(1u, header.pixelHeight >> skip), levelCount - skip, format);
+    texture->_skippedLevels = skip;
+
+    // The faces of a level are stored after each other.
+    std::vector<GLubyte> data;
+    bool failed = false;
+    for (unsigned int level = skip; level < levelCount && !failed; ++level)
+    {
+        GLsizei width = std::max(1u, header.pixelWidth >> level);
+        GLsizei height = std::max(1u, header.pixelHeight >> level);
+        unsigned int imageSize = (unsigned int)(levels[level].byteLength / header.faceCount);
+        data.resize(std::max(1u, imageSize));
+        if (!stream->seek((long int)levels[level].byteOffset, SEEK_SET))
+        {
+            failed = true;
+            break;
+        }
+
+        for (unsigned int face = 0; face < header.faceCount; ++face)
+        {
+            if (stream->read(&data[0], 1, imageSize) != imageSize)
+            {
+                failed = true;
+                break;
+            }
+
+            GLenum faceTarget = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+            if (compressed)
+            {
+                GL_ASSERT( glCompressedTexImage2D(faceTarget, level - skip, internalFormat, width, height, 0, imageSize, &data[0]) );
+            }
+            else
+            {
+                GL_ASSERT( glTexImage2D(faceTarget, level - skip, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, &data[0]) );
+            }
+        }
+    }
+
+    if (failed)
+    {
+        GP_ERROR("Failed to read texture data from KTX2 file '%s'.", path);
+        SAFE_RELEASE(texture);
+    }
+    return texture;
+}
+
+Texture* Texture::createKTX(GLenum target, unsigned int width, unsigned int height, unsigned int levelCount, GLenum format)
+{
+    GLuint textureId;
+    GL_ASSERT( glGenTextures(1, &textureId) );
+    RenderState::bindTexture(target, textureId);
+
+    Filter minFilter = levelCount > 1 ? NEAREST_MIPMAP_LINEAR : LINEAR;
+    GL_ASSERT( glTexParameteri(target, GL_TEXTURE_MIN_FILTER, minFilter) );
+
+    Texture* texture = new Texture();
+    texture->_handle = textureId;
+    texture->_type = (Type)target;
+    texture->_width = width;
+    texture->_height = height;
+    texture->_format = format == GL_RGBA ? RGBA : (format == GL_RGB ? RGB : UNKNOWN);
+    texture->_compressed = format == 0;
+    texture->_mipmapped = levelCount > 1;
+    texture->_minFilter = minFilter;
+    texture->setMemorySize(getTextureMemorySize(texture));
     return texture;
 }
 
@@ -1104,6 +2102,11 @@ unsigned int Texture::getHeight() const
     return _height;
 }
 
+unsigned int Texture::getLayerCount() const
+{
+    return _layerCount;
+}
+
 TextureHandle Texture::getHandle() const
 {
     return _handle;
@@ -1114,15 +2117,13 @@ void Texture::generateMipmaps()
     if (!_mipmapped)
     {
         GLenum target = (GLenum)_type;
-        GL_ASSERT( glBindTexture(target, _handle) );
+        RenderState::bindTexture(target, _handle);
         GL_ASSERT( glHint(GL_GENERATE_MIPMAP_HINT, GL_NICEST) );
         if( std::addressof(glGenerateMipmap) )
             GL_ASSERT( glGenerateMipmap(target) );
 
         _mipmapped = true;
-
-        // Restore the texture id
-        GL_ASSERT( glBindTexture((GLenum)__currentTextureType, __currentTextureId) );
+        setMemorySize(getTextureMemorySize(this));
     }
 }
 
@@ -1136,8 +2137,36 @@ bool Texture::isCompressed() const
     return _compressed;
 }
 
+void Texture::setMemorySize(size_t size)
+{
+    MemoryStats::remove(MemoryStats::TEXTURES, _memorySize);
+    _memorySize = size;
+    MemoryStats::add(MemoryStats::TEXTURES, _memorySize);
+}
+
+Texture::AsyncLoad::AsyncLoad()
+    : _generateMipmaps(false), _mipmapSkip(0), _skippedLevels(0), _image(NULL), _job(NULL), _texture(NULL), _finished(false)
+{
+}
+
+Texture::AsyncLoad::~AsyncLoad()
+{
+    SAFE_RELEASE(_image);
+    SAFE_RELEASE(_texture);
+}
+
+bool Texture::AsyncLoad::isFinished() const
+{
+    return _finished;
+}
+
+Texture* Texture::AsyncLoad::getTexture() const
+{
+    return _texture;
+}
+
 Texture::Sampler::Sampler(Texture* texture)
-    : _texture(texture), _wrapS(Texture::REPEAT), _wrapT(Texture::REPEAT), _wrapR(Texture::REPEAT)
+    : _texture(texture), _wrapS(Texture::REPEAT), _wrapT(Texture::REPEAT), _wrapR(Texture::REPEAT), _samplerObject(0)
 {
     GP_ASSERT( texture );
     _minFilter = texture->_minFilter;
@@ -1152,7 +2181,7 @@ Texture::Sampler::~Sampler()
 Texture::Sampler* Texture::Sampler::create(Texture* texture)
 {
     GP_ASSERT( texture );
-    GP_ASSERT( texture->_type == Texture::TEXTURE_2D || texture->_type == Texture::TEXTURE_CUBE );
+    GP_ASSERT( texture->_type == Texture::TEXTURE_2D || texture->_type == Texture::TEXTURE_CUBE || texture->_type == Texture::TEXTURE_2D_ARRAY );
     texture->addRef();
     return new Sampler(texture);
 }
@@ -1168,12 +2197,14 @@ void Texture::Sampler::setWrapMode(Wrap wrapS, Wrap wrapT, Wrap wrapR)
     _wrapS = wrapS;
     _wrapT = wrapT;
     _wrapR = wrapR;
+    _samplerObject = 0;
 }
 
 void Texture::Sampler::setFilterMode(Filter minificationFilter, Filter magnificationFilter)
 {
     _minFilter = minificationFilter;
     _magFilter = magnificationFilter;
+    _samplerObject = 0;
 }
 
 Texture* Texture::Sampler::getTexture() const
@@ -1185,13 +2216,21 @@ void Texture::Sampler::bind()
 {
     GP_ASSERT( _texture );
 
+    if (_texture->_streamEntry)
+        Game::getInstance()->getTextureStreamer()->use(_texture->_streamEntry);
+
     GLenum target = (GLenum)_texture->_type;
-    if (__currentTextureId != _texture->_handle)
-    {
-        GL_ASSERT( glBindTexture(target, _texture->_handle) );
-        __currentTextureId = _texture->_handle;
-        __currentTextureType = _texture->_type;
-    }
+    RenderState::bindTexture(target, _texture->_handle);
+
+    // With sampler objects the filtering and wrapping are bound with the texture unit, so textures
+    // that are shared by samplers with different modes are not changed each time they are bound.
+    if (_samplerObject == 0)
+        _samplerObject = RenderState::getSamplerObject((GLenum)_minFilter, (GLenum)_magFilter, (GLenum)_wrapS, (GLenum)_wrapT, (GLenum)_wrapR);
+    if (_samplerObject && RenderState::bindSampler(_samplerObject))
+        return;
+
+    // Otherwise the texture's own parameters are used, so no sampler object may be left on the unit.
+    RenderState::bindSampler(0);
 
     if (_texture->_minFilter != _minFilter)
     {
@@ -3,18 +3,24 @@
 
 #include "Ref.h"
 #include "Stream.h"
+#include "TextureStreamer.h"
 
 namespace gameplay
 {
 
 class Image;
+class ResourceCache;
 
 /**
  * Defines a standard texture.
  */
 class Texture : public Ref
 {
+    friend class Game;
+    friend class Form;
     friend class Sampler;
+    friend class SceneLoader;
+    friend class TextureStreamer;
 
 public:
 
@@ -57,7 +63,8 @@ public:
     enum Type
     {
         TEXTURE_2D = GL_TEXTURE_2D,
-        TEXTURE_CUBE = GL_TEXTURE_CUBE_MAP
+        TEXTURE_CUBE = GL_TEXTURE_CUBE_MAP,
+        TEXTURE_2D_ARRAY = GL_TEXTURE_2D_ARRAY
     };
 
     /**
@@ -160,14 +167,85 @@ public:
         Wrap _wrapR;
         Filter _minFilter;
         Filter _magFilter;
+        unsigned int _samplerObject;
+    };
+
+    /**
+     * Defines a handle to a texture that is being loaded asynchronously (see Texture::createAsync).
+     *
+     * @script{ignore}
+     */
+    class AsyncLoad : public Ref
+    {
+        friend class Texture;
+
+    public:
+
+        /**
+         * Determines if the load has finished, either with a loaded texture or with an error.
+         *
+         * @return true if the load has finished, false if it is still in progress.
+         */
+        bool isFinished() const;
+
+        /**
+         * Returns the loaded texture.
+         *
+         * The handle keeps a reference to the texture until it is released, so the texture
+         * must be given a reference of its own to outlive the handle.
+         *
+         * @return The loaded texture, or NULL if the load has not finished or has failed.
+         */
+        Texture* getTexture() const;
+
+    private:
+
+        /**
+         * Constructor.
+         */
+        AsyncLoad();
+
+        /**
+         * Destructor.
+         */
+        ~AsyncLoad();
+
+        /**
+         * Hidden copy constructor.
+         */
+        AsyncLoad(const AsyncLoad& copy);
+
+        /**
+         * Hidden copy assignment operator.
+         */
+        AsyncLoad& operator=(const AsyncLoad&);
+
+        std::string _path;
+        bool _generateMipmaps;
+        unsigned int _mipmapSkip;
+        unsigned int _skippedLevels;
+        Image* _image;
+        JobSystem::Job* _job;
+        Texture* _texture;
+        bool _finished;
     };
 
     /**
      * Creates a texture from the given image resource.
      *
+     * The supported file formats are PNG, PVR (PVRTC), DDS (DXT, ATC and ETC1) and KTX or KTX2.
+     * KTX files can hold 2D textures and cube maps in the ETC2/EAC, ASTC, BC1-BC3 and BC7 compressed
+     * formats as well as uncompressed RGB8 and RGBA8, along with their mipmap chains. The device
+     * must support the compressed format of the file.
+     *
      * Note that for textures that include mipmap data in the source data (such as most compressed textures),
      * the generateMipmaps flags should NOT be set to true.
      *
+     * When texture streaming is enabled (see TextureStreamer), mipmapped 2D textures in DDS files are
+     * created with their smallest mipmap levels only, and the other levels are loaded as they are needed.
+     *
+     * Mipmapped textures skip their most detailed levels as set by setMipmapSkip.
+     *
      * @param path The image resource path.
      * @param generateMipmaps true to auto-generate a full mipmap chain, false otherwise.
      * 
@@ -176,6 +254,22 @@ public:
      */
     static Texture* create(const char* path, bool generateMipmaps = false);
 
+    /**
+     * Creates a texture from the given image resource, skipping the specified number of its
+     * most detailed mipmap levels instead of the number set by setMipmapSkip.
+     *
+     * If the texture is already loaded with a different number of skipped levels, it is loaded
+     * again with the specified number (see setMipmapSkipOverride).
+     *
+     * @param path The image resource path.
+     * @param generateMipmaps true to auto-generate a full mipmap chain, false otherwise.
+     * @param mipmapSkip The number of levels to skip, or -1 to skip the number set by setMipmapSkip.
+     *
+     * @return The new texture, or NULL if the texture could not be loaded/created.
+     * @script{ignore}
+     */
+    static Texture* create(const char* path, bool generateMipmaps, int mipmapSkip);
+
     /**
      * Creates a texture from the given image.
      *
@@ -187,6 +281,22 @@ public:
      */
     static Texture* create(Image* image, bool generateMipmaps = false);
 
+    /**
+     * Starts loading a texture from the given image resource without blocking the game.
+     *
+     * PNG images are decoded on a worker thread of the job system, and the texture is
+     * uploaded on the main thread at the start of the first frame after the image has been
+     * decoded. Textures that are already in the texture cache and compressed textures, which
+     * need no decoding, are loaded right away and the returned load has already finished.
+     *
+     * @param path The image resource path.
+     * @param generateMipmaps true to auto-generate a full mipmap chain, false otherwise.
+     *
+     * @return A handle to the load, which must be released when it is no longer needed.
+     * @script{ignore}
+     */
+    static AsyncLoad* createAsync(const char* path, bool generateMipmaps = false);
+
     /**
      * Creates a texture from the given texture data.
      *
@@ -226,6 +336,139 @@ public:
      */
     static Texture* create(TextureHandle handle, int width, int height, Format format = UNKNOWN);
 
+    /**
+     * Creates a 2D texture array from the given texture data.
+     *
+     * The layers of an array are sampled from a single texture unit with a sampler2DArray, so
+     * the sprites or terrain layers that use different images of one array can be drawn in the
+     * same batch. They all have the same size and format.
+     *
+     * @param format Format of the texture data.
+     * @param width Width of each layer.
+     * @param height Height of each layer.
+     * @param layerCount The number of layers of the array.
+     * @param data Raw texture data of the layers, stored back contiguously (expected to be
+     *      tightly packed), or NULL to leave the layers undefined until setLayerData() is called.
+     * @param generateMipmaps True to generate a full mipmap chain, false otherwise.
+     *
+     * @return The new texture, or NULL if texture arrays are not supported.
+     * @see isArraySupported
+     * @script{ignore}
+     */
+    static Texture* createArray(Format format, unsigned int width, unsigned int height, unsigned int layerCount,
+                                const unsigned char* data, bool generateMipmaps = false);
+
+    /**
+     * Creates a 2D texture array with a layer for each of the given PNG images.
+     *
+     * The images are decoded in parallel with Image::createBatch(), and must all have the same
+     * size and format. Arrays are added to the texture cache under the list of their paths, so
+     * creating an array of the same images again returns the same texture.
+     *
+     * @param paths The paths of the images of the layers, in the order of the layers.
+     * @param generateMipmaps True to generate a full mipmap chain, false otherwise.
+     *
+     * @return The new texture, or NULL if texture arrays are not supported, or if the images could
+     *      not be loaded or do not all have the same size and format.
+     * @script{ignore}
+     */
+    static Texture* createArray(const std::vector<std::string>& paths, bool generateMipmaps = false);
+
+    /**
+     * Determines whether 2D texture arrays are supported by the device.
+     *
+     * Texture arrays need OpenGL 3.0 or EXT_texture_array, so they are not available on
+     * OpenGL ES 2.0 devices.
+     *
+     * @return true if texture arrays are supported, false otherwise.
+     * @script{ignore}
+     */
+    static bool isArraySupported();
+
+    /**
+     * Returns the cache of the textures that were created from files.
+     *
+     * The memory budget of the cache can also be set in the game.config file (in megabytes):
+     *
+     * @code
+     * resources
+     * {
+     *     textureBudget = 64
+     * }
+     * @endcode
+     *
+     * @return The texture cache.
+     * @script{ignore}
+     */
+    static ResourceCache* getCache();
+
+    /**
+     * Sets the number of the most detailed mipmap levels that mipmapped textures skip when they
+     * are loaded from files, which lowers the quality of textures to fit them in the memory of
+     * low-end devices.
+     *
+     * Each skipped level halves the width and height of a texture and quarters its memory. The
+     * levels of DDS, KTX and PVR files are skipped without being uploaded, and those of DDS and
+     * KTX files without being read. PNG images that are loaded with generateMipmaps are halved
+     * after they are decoded. Textures without mipmaps keep their size, and every texture keeps
+     * at least its smallest level.
+     *
+     * Changing the number loads the textures that were loaded from files again, so that the
+     * game can switch to another quality at runtime; textures that override the number (see
+     * setMipmapSkipOverride) keep their levels. The number can also be set in the game.config file:
+     *
+     * @code
+     * resources
+     * {
+     *     textureMipmapSkip = 1
+     * }
+     * @endcode
+     *
+     * Materials can override the number for the texture of a sampler with its mipmapSkip property.
+     *
+     * @param levels The number of levels to skip, or 0 to load textures at full size.
+     * @script{ignore}
+     */
+    static void setMipmapSkip(unsigned int levels);
+
+    /**
+     * Returns the number of the most detailed mipmap levels that mipmapped textures skip when
+     * they are loaded from files.
+     *
+     * @return The number of levels to skip.
+     * @script{ignore}
+     */
+    static unsigned int getMipmapSkip();
+
+    /**
+     * Sets the number of the most detailed mipmap levels that this texture skips in place of the
+     * number set by setMipmapSkip, such as 0 for textures that must stay sharp.
+     *
+     * Textures that were loaded from files are loaded again if the number of levels that they
+     * skip changes.
+     *
+     * @param levels The number of levels to skip, or -1 to skip the number set by setMipmapSkip.
+     * @script{ignore}
+     */
+    void setMipmapSkipOverride(int levels);
+
+    /**
+     * Returns the number of levels that this texture skips in place of the number set by setMipmapSkip.
+     *
+     * @return The number of levels to skip, or -1 if the texture skips the number set by setMipmapSkip.
+     * @script{ignore}
+     */
+    int getMipmapSkipOverride() const;
+
+    /**
+     * Returns the number of the most detailed mipmap levels that were skipped when this texture
+     * was loaded, which the width and height of the texture are already halved by.
+     *
+     * @return The number of skipped levels.
+     * @script{ignore}
+     */
+    unsigned int getSkippedLevels() const;
+
     /**
      * Set texture data to replace current texture image.
      * 
@@ -235,6 +478,34 @@ public:
      */
     void setData(const unsigned char* data);
 
+    /**
+     * Set texture data to replace a region of the current texture image.
+     *
+     * Only 2D textures are supported. The mipmaps of the texture are not regenerated, so this is
+     * meant for textures that are sampled without mipmaps, such as glyph atlases that are updated
+     * as new glyphs are needed.
+     *
+     * @param data Raw texture data of the region (expected to be tightly packed).
+     * @param x The x-coordinate of the region, in pixels.
+     * @param y The y-coordinate of the region, in pixels.
+     * @param width The width of the region, in pixels.
+     * @param height The height of the region, in pixels.
+     * @script{ignore}
+     */
+    void setData(const unsigned char* data, unsigned int x, unsigned int y, unsigned int width, unsigned int height);
+
+    /**
+     * Set texture data to replace a layer of a texture array.
+     *
+     * The mipmaps of the texture are not regenerated, so generateMipmaps() should be called once
+     * all the layers are set.
+     *
+     * @param layer The index of the layer.
+     * @param data Raw texture data of the layer (expected to be tightly packed).
+     * @script{ignore}
+     */
+    void setLayerData(unsigned int layer, const unsigned char* data);
+
     /**
      * Returns the path that the texture was originally loaded from (if applicable).
      *
@@ -270,6 +541,14 @@ public:
      */
     unsigned int getHeight() const;
 
+    /**
+     * Gets the number of layers of the texture.
+     *
+     * @return The number of layers of a texture array, or 1 for other textures.
+     * @script{ignore}
+     */
+    unsigned int getLayerCount() const;
+
     /**
      * Generates a full mipmap chain for this texture if it isn't already mipmapped.
      */
@@ -316,9 +595,67 @@ private:
      */
     Texture& operator=(const Texture&);
 
-    static Texture* createCompressedPVRTC(const char* path);
+    /**
+     * Sets the video memory that the texture is estimated to use, and counts it in the memory statistics.
+     *
+     * @param size The size of the texture, in bytes.
+     */
+    void setMemorySize(size_t size);
+
+    /**
+     * Creates a texture from an image that was loaded from the specified path ahead of time, and
+     * adds it to the texture cache as if it had been created from the path.
+     *
+     * @param path The path that the image was loaded from.
+     * @param image The image that was loaded from the path.
+     *
+     * @return The texture for the path, which is taken from the cache if it is already there.
+     */
+    static Texture* createCached(const char* path, Image* image);
+
+    /**
+     * Loads a texture from a file without adding it to the texture cache.
+     *
+     * @param path The image resource path.
+     * @param generateMipmaps true to auto-generate a full mipmap chain, false otherwise.
+     * @param mipmapSkip The number of levels to skip, or -1 to skip the number set by setMipmapSkip.
+     *
+     * @return The new texture, or NULL if the texture could not be loaded.
+     */
+    static Texture* load(const char* path, bool generateMipmaps, int mipmapSkip);
+
+    /**
+     * Loads the texture again from its file, keeping the texture object that samplers refer to.
+     *
+     * @param generateMipmaps true to auto-generate a full mipmap chain, false otherwise.
+     *
+     * @return true if the texture was loaded, false otherwise.
+     */
+    bool reload(bool generateMipmaps);
+
+    /**
+     * Uploads the textures of the asynchronous loads whose images have been decoded.
+     */
+    static void updateAsync();
+
+    /**
+     * Waits for the images of the asynchronous loads to be decoded and cancels the loads.
+     */
+    static void finalizeAsync();
+
+    static void decodeAsync(void* cookie);
+
+    static Texture* createCompressedPVRTC(const char* path, int mipmapSkip);
+
+    static Texture* createCompressedDDS(const char* path, int mipmapSkip);
+
+    static Texture* createCompressedKTX(const char* path, int mipmapSkip);
+
+    static Texture* readCompressedKTX1(const char* path, Stream* stream, int mipmapSkip);
+
+    static Texture* readCompressedKTX2(const char* path, Stream* stream, int mipmapSkip);
 
-    static Texture* createCompressedDDS(const char* path);
+    static Texture* createKTX(GLenum target, unsigned int width, unsigned int height, unsigned int levelCount, GLenum format);
 
     static GLubyte* readCompressedPVRTC(const char* path, Stream* stream, GLsizei* width, GLsizei* height, GLenum* format, unsigned int* mipMapCount, unsigned int* faceCount, GLenum faces[6]);
 
@@ -332,6 +669,7 @@ private:
     Type _type;
     unsigned int _width;
     unsigned int _height;
+    unsigned int _layerCount;
     bool _mipmapped;
     bool _cached;
     bool _compressed;
@@ -340,6 +678,10 @@ private:
     Wrap _wrapR;
     Filter _minFilter;
     Filter _magFilter;
+    TextureStreamer::Entry* _streamEntry;
+    size_t _memorySize;
+    int _mipmapSkip;
+    unsigned int _skippedLevels;
 };
 
 }
@@ -0,0 +1,366 @@
+#include "Base.h"
+#include "TextureStreamer.h"
+#include "Texture.h"
+#include "Game.h"
+#include "FileSystem.h"
+#include "RenderState.h"
+
+// The largest size of the levels that are always loaded
+#define TEXTURE_STREAMING_TAIL_SIZE 64
+// Frames after which a texture that has not been drawn drops its detailed levels
+#define TEXTURE_STREAMING_UNUSED_FRAMES 120
+// Maximum number of textures whose levels are read at the same time
+#define TEXTURE_STREAMING_MAX_REQUESTS 4
+
+namespace gameplay
+{
+
+// The size on screen of what is being drawn, or 0 if it is not known.
+static float __screenSize = 0.0f;
+
+struct TextureStreamer::Request
+{
+    // The entry that the levels are read for, or NULL if the texture was destroyed in the meantime.
+    Entry* entry;
+    std::string path;
+    unsigned int level;
+    unsigned int offset;
+    unsigned int size;
+    unsigned char* data;
+    bool failed;
+    JobSystem::Job* job;
+};
+
+TextureStreamer::TextureStreamer()
+    : _enabled(false), _budget(0), _memoryUsage(0), _frame(0)
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    finalize();
+}
+
+void TextureStreamer::setEnabled(bool enabled)
+{
+    _enabled = enabled;
+}
+
+bool TextureStreamer::isEnabled() const
+{
+    return _enabled;
+}
+
+void TextureStreamer::setBudget(size_t bytes)
+{
+    _budget = bytes;
+}
+
+size_t TextureStreamer::getBudget() const
+{
+    return _budget;
+}
+
+size_t TextureStreamer::getMemoryUsage() const
+{
+    return _memoryUsage;
+}
+
+unsigned int TextureStreamer::getTextureCount() const
+{
+    return (unsigned int)_entries.size();
+}
+
+void TextureStreamer::setScreenSize(float pixels)
+{
+    __screenSize = pixels;
+}
+
+void TextureStreamer::finalize()
+{
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    for (size_t i = 0, count = _requests.size(); i < count; ++i)
+    {
+        Request* request = _requests[i];
+        GP_ASSERT(jobSystem);
+        jobSystem->wait(request->job);
+        SAFE_DELETE_ARRAY(request->data);
+        SAFE_DELETE(request);
+    }
+    _requests.clear();
+
+    // The remaining textures keep the levels that they have loaded.
+    for (size_t i = 0, count = _entries.size(); i < count; ++i)
+    {
+        _entries[i]->texture->_streamEntry = NULL;
+        SAFE_DELETE(_entries[i]);
+    }
+    _entries.clear();
+    _sorted.clear();
+    _memoryUsage = 0;
+    _enabled = false;
+}
+
+unsigned int TextureStreamer::getTailLevel(unsigned int width, unsigned int height, unsigned int levelCount)
+{
+    unsigned int level = 0;
+    while (level + 1 < levelCount && std::max(width >> level, height >> level) > TEXTURE_STREAMING_TAIL_SIZE)
+    {
+        ++level;
+    }
+    return level;
+}
+
+TextureStreamer::Entry* TextureStreamer::add(Texture* texture, const char* path, unsigned int format, unsigned int internalFormat, bool compressed,
+                                             const std::vector<Level>& levels, unsigned int residentLevel)
+{
+    GP_ASSERT(texture);
+    GP_ASSERT(path);
+    GP_ASSERT(residentLevel < levels.size());
+    GP_ASSERT(!levels.empty());
+
+    Entry* entry = new Entry();
+    entry->texture = texture;
+    entry->path = path;
+    entry->format = format;
+    entry->internalFormat = internalFormat;
+    entry->compressed = compressed;
+    entry->levels = levels;
+    entry->residentLevel = residentLevel;
+    entry->tailLevel = getTailLevel(levels[0].width, levels[0].height, (unsigned int)levels.size());
+    entry->targetLevel = residentLevel;
+    entry->lastUsedFrame = _frame;
+    entry->screenSize = 0.0f;
+    entry->request = NULL;
+    _entries.push_back(entry);
+
+    _memoryUsage += getLevelsSize(entry, residentLevel);
+    texture->setMemorySize(getLevelsSize(entry, residentLevel));
+    return entry;
+}
+
+void TextureStreamer::remove(Entry* entry)
+{
+    GP_ASSERT(entry);
+
+    // The levels that are being read for the texture are thrown away once they are read.
+    if (entry->request)
+        entry->request->entry = NULL;
+
+    std::vector<Entry*>::iterator itr = std::find(_entries.begin(), _entries.end(), entry);
+    if (itr != _entries.end())
+        _entries.erase(itr);
+
+    _memoryUsage -= getLevelsSize(entry, entry->residentLevel);
+    entry->texture->_streamEntry = NULL;
+    SAFE_DELETE(entry);
+}
+
+void TextureStreamer::use(Entry* entry)
+{
+    GP_ASSERT(entry);
+
+    // Without a size on screen the texture is drawn at full detail.
+    float size = __screenSize > 0.0f ? __screenSize : FLT_MAX;
+    if (entry->lastUsedFrame != _frame)
+    {
+        entry->lastUsedFrame = _frame;
+        entry->screenSize = size;
+    }
+    else if (size > entry->screenSize)
+    {
+        entry->screenSize = size;
+    }
+}
+
+size_t TextureStreamer::getLevelsSize(const Entry* entry, unsigned int level) const
+{
+    size_t size = 0;
+    for (size_t i = level, count = entry->levels.size(); i < count; ++i)
+    {
+        size += entry->levels[i].size;
+    }
+    return size;
+}
+
+void TextureStreamer::update()
+{
+    // Upload the levels that have been read.
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    GP_ASSERT(jobSystem);
+    for (size_t i = 0; i < _requests.size();)
+    {
+        Request* request = _requests[i];
+        if (!jobSystem->isFinished(request->job))
+        {
+            ++i;
+            continue;
+        }
+
+        jobSystem->release(request->job);
+        if (request->entry)
+            finishRequest(request->entry);
+        SAFE_DELETE_ARRAY(request->data);
+        SAFE_DELETE(request);
+        _requests.erase(_requests.begin() + i);
+    }
+
+    if (!_entries.empty())
+    {
+        selectLevels();
+
+        // Start reading the levels of the textures that are the largest on screen first.
+        for (size_t i = 0, count = _sorted.size(); i < count && _requests.size() < TEXTURE_STREAMING_MAX_REQUESTS; ++i)
+        {
+            Entry* entry = _sorted[i];
+            if (entry->request == NULL && entry->targetLevel != entry->residentLevel)
+                startRequest(entry);
+        }
+    }
+
+    // Draws from now on count towards the next frame.
+    ++_frame;
+}
+
+bool TextureStreamer::compareScreenSize(const Entry* a, const Entry* b)
+{
+    return a->screenSize > b->screenSize;
+}
+
+void TextureStreamer::selectLevels()
+{
+    // Select the smallest level that still covers the size of the texture on screen.
+    for (size_t i = 0, count = _entries.size(); i < count; ++i)
+    {
+        Entry* entry = _entries[i];
+        if (_frame - entry->lastUsedFrame > TEXTURE_STREAMING_UNUSED_FRAMES)
+            entry->screenSize = 0.0f;
+
+        unsigned int level = 0;
+        while (level < entry->tailLevel && (float)std::max(entry->levels[level + 1].width, entry->levels[level + 1].height) >= entry->screenSize)
+        {
+            ++level;
+        }
+        entry->targetLevel = level;
+    }
+
+    _sorted = _entries;
+    std::sort(_sorted.begin(), _sorted.end(), compareScreenSize);
+    if (_budget == 0)
+        return;
+
+    // The small levels are always loaded, and the textures that are the largest on screen get the budget that remains.
+    size_t used = 0;
+    for (size_t i = 0, count = _sorted.size(); i < count; ++i)
+    {
+        used += getLevelsSize(_sorted[i], _sorted[i]->tailLevel);
+    }
+    size_t remaining = _budget > used ? _budget - used : 0;
+    for (size_t i = 0, count = _sorted.size(); i < count; ++i)
+    {
+        Entry* entry = _sorted[i];
+        size_t tailSize = getLevelsSize(entry, entry->tailLevel);
+        size_t size = getLevelsSize(entry, entry->targetLevel) - tailSize;
+        while (entry->targetLevel < entry->tailLevel && size > remaining)
+        {
+            ++entry->targetLevel;
+            size = getLevelsSize(entry, entry->targetLevel) - tailSize;
+        }
+        remaining -= size;
+    }
+}
+
+void TextureStreamer::startRequest(Entry* entry)
+{
+    GP_ASSERT(entry);
+    GP_ASSERT(entry->request == NULL);
+
+    // The levels of a texture are stored after each other, from the most detailed one.
+    const Level& level = entry->levels[entry->targetLevel];
+    Request* request = new Request();
+    request->entry = entry;
+    request->path = entry->path;
+    request->level = entry->targetLevel;
+    request->offset = level.offset;
+    request->size = (unsigned int)getLevelsSize(entry, entry->targetLevel);
+    request->data = NULL;
+    request->failed = false;
+
+    JobSystem* jobSystem = Game::getInstance()->getJobSystem();
+    GP_ASSERT(jobSystem);
+    request->job = jobSystem->create(&TextureStreamer::readProc, request);
+    entry->request = request;
+    _requests.push_back(request);
+    jobSystem->run(request->job);
+}
+
+void TextureStreamer::readProc(void* cookie)
+{
+    Request* request = (Request*)cookie;
+
+    std::unique_ptr<Stream> stream(FileSystem::open(request->path.c_str()));
+    if (stream.get() == NULL || !stream->seek(request->offset, SEEK_SET))
+    {
+        request->failed = true;
+        return;
+    }
+
+    request->data = new unsigned char[request->size];
+    if (stream->read(request->data, 1, request->size) != request->size)
+    {
+        request->failed = true;
+        SAFE_DELETE_ARRAY(request->data);
+    }
+}
+
+void TextureStreamer::finishRequest(Entry* entry)
+{
+    GP_ASSERT(entry);
+    GP_ASSERT(entry->request);
+
+    Request* request = entry->request;
+    entry->request = NULL;
+    if (request->failed)
+    {
+        // Keep the levels that are loaded and stop streaming the texture.
+        GP_WARN("Failed to stream the mipmap levels of texture '%s'.", entry->path.c_str());
+        remove(entry);
+        return;
+    }
+
+    // Create a texture with the levels that were read, so that only those levels use memory,
+    // and apply the state of the texture to it before replacing the previous one.
+    Texture* texture = entry->texture;
+    GLuint handle;
+    GL_ASSERT( glGenTextures(1, &handle) );
+    RenderState::bindTexture(GL_TEXTURE_2D, handle);
+
+    const unsigned char* data = request->data;
+    for (unsigned int i = request->level, count = (unsigned int)entry->levels.size(); i < count; ++i)
+    {
+        const Level& level = entry->levels[i];
+        if (entry->compressed)
+        {
+            GL_ASSERT( glCompressedTexImage2D(GL_TEXTURE_2D, i - request->level, entry->format, level.width, level.height, 0, level.size, data) );
+        }
+        else
+        {
+            GL_ASSERT( glTexImage2D(GL_TEXTURE_2D, i - request->level, entry->internalFormat, level.width, level.height, 0, entry->format, GL_UNSIGNED_BYTE, data) );
+        }
+        data += level.size;
+    }
+    GL_ASSERT( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (GLenum)texture->_minFilter) );
+    GL_ASSERT( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, (GLenum)texture->_magFilter) );
+    GL_ASSERT( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, (GLenum)texture->_wrapS) );
+    GL_ASSERT( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, (GLenum)texture->_wrapT) );
+
+    RenderState::deleteTexture(texture->_handle);
+    texture->_handle = handle;
+
+    _memoryUsage -= getLevelsSize(entry, entry->residentLevel);
+    entry->residentLevel = request->level;
+    _memoryUsage += getLevelsSize(entry, entry->residentLevel);
+    texture->setMemorySize(getLevelsSize(entry, entry->residentLevel));
+}
+
+}
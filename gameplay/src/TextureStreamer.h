@@ -0,0 +1,204 @@
+#ifndef TEXTURESTREAMER_H_
+#define TEXTURESTREAMER_H_
+
+#include "JobSystem.h"
+
+namespace gameplay
+{
+
+class Texture;
+
+/**
+ * Defines the streaming of texture mipmap levels from disk.
+ *
+ * When texture streaming is enabled, mipmapped 2D textures that are loaded from DDS files
+ * only load their smallest mipmap levels up front. The more detailed levels are then read
+ * from disk on the worker threads of the job system as they are needed, and uploaded on the
+ * thread that runs the game.
+ *
+ * The level of detail that a texture needs is based on the size on screen of the objects
+ * that it is drawn on, which the renderer reports while drawing them (see setScreenSize).
+ * Textures that have not been drawn for a while drop their detailed levels again. When the
+ * memory of the streamed levels would exceed the memory budget, the textures that are the
+ * smallest on screen get fewer detailed levels first. The smallest levels of every texture
+ * are always kept, so that every texture can be drawn.
+ *
+ * The texture streamer is owned by the Game. Streaming is disabled by default and can be
+ * enabled in the game.config file, along with the budget (in megabytes):
+ *
+ * @code
+ * resources
+ * {
+ *     textureStreaming = true
+ *     textureStreamingBudget = 256
+ * }
+ * @endcode
+ *
+ * @script{ignore}
+ */
+class TextureStreamer
+{
+    friend class Game;
+    friend class Texture;
+
+public:
+
+    /**
+     * Enables or disables streaming for the textures that are loaded afterwards.
+     *
+     * @param enabled true to stream textures, false to load all of their levels up front.
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     * Determines if textures are streamed when they are loaded.
+     *
+     * @return true if texture streaming is enabled, false otherwise.
+     */
+    bool isEnabled() const;
+
+    /**
+     * Sets the memory budget of the streamed textures.
+     *
+     * @param bytes The number of bytes that the mipmap levels of streamed textures may use, or 0 for no limit.
+     */
+    void setBudget(size_t bytes);
+
+    /**
+     * Returns the memory budget of the streamed textures.
+     *
+     * @return The memory budget in bytes, or 0 if there is no limit.
+     */
+    size_t getBudget() const;
+
+    /**
+     * Returns the memory that the loaded mipmap levels of streamed textures use.
+     *
+     * @return The number of bytes used by streamed textures.
+     */
+    size_t getMemoryUsage() const;
+
+    /**
+     * Returns the number of textures that are streamed.
+     *
+     * @return The number of streamed textures.
+     */
+    unsigned int getTextureCount() const;
+
+    /**
+     * Sets the size on screen of what is drawn next, which is used to select the level of
+     * detail of the streamed textures that are bound while drawing it.
+     *
+     * Renderers set this before drawing an object and reset it afterwards. Textures that are
+     * bound while no size is set are loaded with all of their levels.
+     *
+     * @param pixels The size in pixels of the object on screen, or 0 to reset it.
+     */
+    static void setScreenSize(float pixels);
+
+private:
+
+    /**
+     * The location of a mipmap level in the file of a streamed texture.
+     */
+    struct Level
+    {
+        unsigned int offset;
+        unsigned int size;
+        unsigned int width;
+        unsigned int height;
+    };
+
+    /**
+     * The mipmap levels of a streamed texture that are loaded on a worker thread.
+     */
+    struct Request;
+
+    /**
+     * The streaming state of a texture.
+     */
+    struct Entry
+    {
+        Texture* texture;
+        std::string path;
+        unsigned int format;
+        unsigned int internalFormat;
+        bool compressed;
+        std::vector<Level> levels;
+        unsigned int residentLevel;
+        unsigned int tailLevel;
+        unsigned int targetLevel;
+        unsigned int lastUsedFrame;
+        float screenSize;
+        Request* request;
+    };
+
+    /**
+     * Constructor.
+     */
+    TextureStreamer();
+
+    /**
+     * Destructor.
+     */
+    ~TextureStreamer();
+
+    /**
+     * Hidden copy constructor.
+     */
+    TextureStreamer(const TextureStreamer& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    TextureStreamer& operator=(const TextureStreamer&);
+
+    /**
+     * Waits for the levels that are being read and stops streaming.
+     */
+    void finalize();
+
+    /**
+     * Uploads the levels that have been read and starts reading the levels that are needed next.
+     */
+    void update();
+
+    /**
+     * Returns the first of the small levels of a texture that are always loaded.
+     */
+    static unsigned int getTailLevel(unsigned int width, unsigned int height, unsigned int levelCount);
+
+    /**
+     * Starts streaming a texture whose levels from the specified level onwards are loaded.
+     */
+    Entry* add(Texture* texture, const char* path, unsigned int format, unsigned int internalFormat, bool compressed,
+               const std::vector<Level>& levels, unsigned int residentLevel);
+
+    void remove(Entry* entry);
+
+    void use(Entry* entry);
+
+    void selectLevels();
+
+    void startRequest(Entry* entry);
+
+    void finishRequest(Entry* entry);
+
+    size_t getLevelsSize(const Entry* entry, unsigned int level) const;
+
+    static bool compareScreenSize(const Entry* a, const Entry* b);
+
+    static void readProc(void* cookie);
+
+    std::vector<Entry*> _entries;
+    std::vector<Entry*> _sorted;
+    std::vector<Request*> _requests;
+    bool _enabled;
+    size_t _budget;
+    size_t _memoryUsage;
+    unsigned int _frame;
+};
+
+}
+
+#endif
@@ -0,0 +1,176 @@
+#include "Base.h"
+#include "TextureUploader.h"
+
+// The number of segments of the ring, which is the number of frames that uploads can be in flight
+#define TEXTURE_UPLOAD_SEGMENTS 3
+// How long to wait at a time for the GPU to finish reading from a segment, in nanoseconds
+#define TEXTURE_UPLOAD_WAIT_TIMEOUT 1000000000
+
+namespace gameplay
+{
+
+#ifdef GP_USE_BUFFER_STREAMING
+/**
+ * A pixel unpack buffer whose segments are filled in turn.
+ */
+struct UploadRing
+{
+    GLuint buffer;
+    unsigned int segmentSize;
+    // The segment being filled, and the offset of its next upload.
+    unsigned int segment;
+    unsigned int offset;
+    GLsync fences[TEXTURE_UPLOAD_SEGMENTS];
+};
+
+static UploadRing* __ring = NULL;
+#endif
+static unsigned int __bufferSize = 16 * 1024 * 1024;
+static bool __enabled = false;
+
+#ifdef GP_USE_BUFFER_STREAMING
+static void releaseRing()
+{
+    if (__ring == NULL)
+        return;
+
+    // The driver keeps the buffer until the GPU has read the uploads that are in flight.
+    for (unsigned int i = 0; i < TEXTURE_UPLOAD_SEGMENTS; ++i)
+    {
+        if (__ring->fences[i])
+        {
+            GL_ASSERT( glDeleteSync(__ring->fences[i]) );
+        }
+    }
+    GL_ASSERT( glDeleteBuffers(1, &__ring->buffer) );
+    SAFE_DELETE(__ring);
+}
+
+static bool createRing()
+{
+    UploadRing* ring = new UploadRing();
+    memset(ring, 0, sizeof(UploadRing));
+    ring->segmentSize = __bufferSize / TEXTURE_UPLOAD_SEGMENTS / 4 * 4;
+    GL_ASSERT( glGenBuffers(1, &ring->buffer) );
+    if (ring->buffer == 0 || ring->segmentSize == 0)
+    {
+        GP_WARN("Failed to create pixel unpack buffer for texture uploads.");
+        if (ring->buffer)
+        {
+            GL_ASSERT( glDeleteBuffers(1, &ring->buffer) );
+        }
+        SAFE_DELETE(ring);
+        return false;
+    }
+    GL_ASSERT( glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring->buffer) );
+    GL_ASSERT( glBufferData(GL_PIXEL_UNPACK_BUFFER, ring->segmentSize * TEXTURE_UPLOAD_SEGMENTS, NULL, GL_STREAM_DRAW) );
+    GL_ASSERT( glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0) );
+    __ring = ring;
+    return true;
+}
+
+static void nextSegment()
+{
+    // Fence the uploads of the current segment, and wait for the GPU to have read the next one.
+    GL_ASSERT( __ring->fences[__ring->segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) );
+    __ring->segment = (__ring->segment + 1) % TEXTURE_UPLOAD_SEGMENTS;
+    __ring->offset = 0;
+    GLsync fence = __ring->fences[__ring->segment];
+    if (fence)
+    {
+        GLenum result;
+        do
+        {
+            GL_ASSERT( result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, TEXTURE_UPLOAD_WAIT_TIMEOUT) );
+        } while (result == GL_TIMEOUT_EXPIRED);
+        GL_ASSERT( glDeleteSync(fence) );
+        __ring->fences[__ring->segment] = 0;
+    }
+}
+#endif
+
+bool TextureUploader::isSupported()
+{
+#ifdef GP_USE_BUFFER_STREAMING
+    return glMapBufferRange && glUnmapBuffer && glFenceSync && glClientWaitSync && glDeleteSync;
+#else
+    return false;
+#endif
+}
+
+void TextureUploader::setEnabled(bool enabled)
+{
+    __enabled = enabled && isSupported();
+#ifdef GP_USE_BUFFER_STREAMING
+    if (!__enabled)
+        releaseRing();
+#endif
+}
+
+bool TextureUploader::isEnabled()
+{
+    return __enabled;
+}
+
+void TextureUploader::setBufferSize(unsigned int size)
+{
+    GP_ASSERT(size > 0);
+    __bufferSize = size;
+#ifdef GP_USE_BUFFER_STREAMING
+    releaseRing();
+#endif
+}
+
+unsigned int TextureUploader::getBufferSize()
+{
+    return __bufferSize;
+}
+
+bool TextureUploader::upload(GLenum target, GLint level, unsigned int x, unsigned int y, unsigned int width, unsigned int height,
+                             GLenum format, const void* data, unsigned int size)
+{
+    GP_ASSERT(data);
+
+#ifdef GP_USE_BUFFER_STREAMING
+    if (!__enabled || (__ring == NULL && !createRing()))
+        return false;
+    if (size == 0 || size > __ring->segmentSize)
+        return false;
+    if (__ring->offset + size > __ring->segmentSize)
+        nextSegment();
+
+    // The range has not been read since its fence signalled, so it is written without synchronizing.
+    unsigned int offset = __ring->segment * __ring->segmentSize + __ring->offset;
+    const GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+    GL_ASSERT( glBindBuffer(GL_PIXEL_UNPACK_BUFFER, __ring->buffer) );
+    void* map;
+    GL_ASSERT( map = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, offset, size, access) );
+    if (map == NULL)
+    {
+        GL_ASSERT( glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0) );
+        return false;
+    }
+    memcpy(map, data, size);
+    GL_ASSERT( glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) );
+
+    GL_ASSERT( glPixelStorei(GL_UNPACK_ALIGNMENT, 1) );
+    GL_ASSERT( glTexSubImage2D(target, level, x, y, width, height, format, GL_UNSIGNED_BYTE, (const GLvoid*)(size_t)offset) );
+    GL_ASSERT( glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0) );
+
+    // The uploads start at multiples of 4 bytes, which every pixel transfer can read from.
+    __ring->offset += (size + 3) / 4 * 4;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void TextureUploader::finalize()
+{
+#ifdef GP_USE_BUFFER_STREAMING
+    releaseRing();
+#endif
+    __enabled = false;
+}
+
+}
@@ -0,0 +1,105 @@
+#ifndef TEXTUREUPLOADER_H_
+#define TEXTUREUPLOADER_H_
+
+namespace gameplay
+{
+
+/**
+ * Defines the upload of texture data through a ring of pixel unpack buffers.
+ *
+ * When asynchronous uploads are enabled, the data that is passed to Texture::create and
+ * Texture::setData for 2D textures is copied into a mapped range of a pixel unpack buffer, and
+ * the texture is updated from that range. The calling thread then only copies the data once,
+ * and the driver transfers it to the texture while the GPU runs, instead of copying it out of
+ * client memory before the call returns.
+ *
+ * The buffer is split into segments that are filled in turn. A fence follows the uploads of a
+ * segment, so a segment is only written again once the GPU has read its previous uploads.
+ * Uploads that are larger than a segment are made from client memory as before.
+ *
+ * Asynchronous uploads can be enabled in the game.config file, along with the size of the
+ * buffer (in megabytes):
+ *
+ * @code
+ * resources
+ * {
+ *     asyncTextureUploads = true
+ *     textureUploadBufferSize = 32
+ * }
+ * @endcode
+ *
+ * @script{ignore}
+ */
+class TextureUploader
+{
+    friend class Game;
+
+public:
+
+    /**
+     * Determines if the current platform supports pixel unpack buffers that can be mapped.
+     *
+     * @return true if asynchronous uploads are supported, false otherwise.
+     */
+    static bool isSupported();
+
+    /**
+     * Sets whether texture data is uploaded through the pixel unpack buffers.
+     *
+     * @param enabled true to upload through the buffers. Ignored when they are not supported.
+     */
+    static void setEnabled(bool enabled);
+
+    /**
+     * Determines if texture data is uploaded through the pixel unpack buffers.
+     *
+     * @return true if asynchronous uploads are enabled and supported, false otherwise.
+     */
+    static bool isEnabled();
+
+    /**
+     * Sets the size of the ring of pixel unpack buffers. The ring is created again on the next upload.
+     *
+     * @param size The size, in bytes. The default is 16 MB.
+     */
+    static void setBufferSize(unsigned int size);
+
+    /**
+     * Returns the size of the ring of pixel unpack buffers.
+     *
+     * @return The size, in bytes.
+     */
+    static unsigned int getBufferSize();
+
+    /**
+     * Uploads a region of a level of the texture that is bound to a target through the ring.
+     *
+     * @param target The target of the texture, such as GL_TEXTURE_2D or a face of a cube map.
+     * @param level The mipmap level of the region.
+     * @param x The x-coordinate of the region, in pixels.
+     * @param y The y-coordinate of the region, in pixels.
+     * @param width The width of the region, in pixels.
+     * @param height The height of the region, in pixels.
+     * @param format The format of the data, such as GL_RGBA.
+     * @param data The data of the region, which is tightly packed.
+     * @param size The size of the data, in bytes.
+     *
+     * @return true if the region was uploaded, false if the caller has to upload it from client
+     *      memory because asynchronous uploads are disabled or the region does not fit a segment.
+     */
+    static bool upload(GLenum target, GLint level, unsigned int x, unsigned int y, unsigned int width, unsigned int height,
+                       GLenum format, const void* data, unsigned int size);
+
+private:
+
+    /**
+     * Constructor. Hidden since the uploader only has static methods.
+     */
+    TextureUploader();
+
+    static void finalize();
+};
+
+}
+
+#endif
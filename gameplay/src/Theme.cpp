@@ -739,7 +739,7 @@ Theme::Skin* Theme::Skin::create(const char* id, float tw, float th, const Recta
 }
 
 Theme::Skin::Skin(float tw, float th, const Rectangle& region, const Theme::Border& border, const Vector4& color)
-    : _border(border), _color(color), _region(region)
+    : _border(border), _patchCount(0), _color(color), _region(region)
 {
     setRegion(region, tw, th);
 }
@@ -821,6 +821,53 @@ void Theme::Skin::setRegion(const Rectangle& region, float tw, float th)
     _uvs[BOTTOM_RIGHT].v1 = bottomBorder;
     _uvs[BOTTOM_RIGHT].u2 = rightEdge;
     _uvs[BOTTOM_RIGHT].v2 = bottomEdge;
+
+    updatePatches();
+}
+
+void Theme::Skin::updatePatches()
+{
+    // No border, just the image over the whole control.
+    _patchCount = 0;
+    if (!_border.left && !_border.right && !_border.top && !_border.bottom)
+    {
+        Patch& patch = _patches[_patchCount++];
+        patch.x1 = patch.y1 = patch.x2 = patch.y2 = 0.0f;
+        patch.fx1 = patch.fy1 = 0.0f;
+        patch.fx2 = patch.fy2 = 1.0f;
+        patch.uvs = _uvs[CENTER];
+        return;
+    }
+
+    // The edges of the columns and rows of the nine slices, as offsets and fractions of the size of the control.
+    const float x[4] = { 0.0f, _border.left, -_border.right, 0.0f };
+    const float fx[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+    const float y[4] = { 0.0f, _border.top, -_border.bottom, 0.0f };
+    const float fy[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+    const float columns[3] = { _border.left, 1.0f, _border.right };
+    const float rows[3] = { _border.top, 1.0f, _border.bottom };
+
+    // The slices are added in the order that they were drawn in, a side only if it has a border,
+    // and a corner only if both of its sides do. The center is always added.
+    for (unsigned int row = 0; row < 3; ++row)
+    {
+        for (unsigned int column = 0; column < 3; ++column)
+        {
+            if (!columns[column] || !rows[row])
+                continue;
+
+            Patch& patch = _patches[_patchCount++];
+            patch.x1 = x[column];
+            patch.fx1 = fx[column];
+            patch.x2 = x[column + 1];
+            patch.fx2 = fx[column + 1];
+            patch.y1 = y[row];
+            patch.fy1 = fy[row];
+            patch.y2 = y[row + 1];
+            patch.fy2 = fy[row + 1];
+            patch.uvs = _uvs[row * 3 + column];
+        }
+    }
 }
 
 const Theme::UVs& Theme::Skin::getUVs(SkinArea area) const
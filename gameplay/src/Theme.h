@@ -278,6 +278,7 @@ private:
     class Skin : public Ref
     {
         friend class Theme;
+        friend class Control;
 
     public:
 
@@ -337,10 +338,28 @@ private:
         static Skin* create(const char* id, float tw, float th, const Rectangle& region, const Theme::Border& border, const Vector4& color);
 
         void setRegion(const Rectangle& region, float tw, float th);
+
+        /**
+         * A quad of the nine-slice geometry of the skin. Each edge of the quad is placed at an offset,
+         * in pixels, from the left or top of the control, plus a fraction of the width or height of the control.
+         */
+        struct Patch
+        {
+            float x1, y1, x2, y2;       // The offsets of the edges.
+            float fx1, fy1, fx2, fy2;   // The fractions of the size of the control added to the edges.
+            UVs uvs;
+        };
+
+        /**
+         * Computes the patches drawn for the current border and UVs.
+         */
+        void updatePatches();
     
         std::string _id;
         Theme::Border _border;
         UVs _uvs[9];
+        Patch _patches[9];
+        unsigned int _patchCount;
         Vector4 _color;
         Rectangle _region;
         float _tw, _th;
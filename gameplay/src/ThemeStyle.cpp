@@ -156,6 +156,7 @@ void Theme::Style::Overlay::setBorder(float top, float bottom, float left, float
         _skin->_border.bottom = bottom;
         _skin->_border.left = left;
         _skin->_border.right = right;
+        _skin->updatePatches();
     }
 }
 
@@ -1,7 +1,15 @@
 #include "Base.h"
 #include "TileSet.h"
+#include "GraphicsDevice.h"
 #include "Matrix.h"
 #include "Scene.h"
+#include "Game.h"
+#include "Sprite.h"
+#include "MeshPart.h"
+#include "RenderStats.h"
+
+// The number of tiles on each side of a chunk
+#define TILESET_CHUNK_SIZE 32
 
 namespace gameplay
 {
@@ -9,14 +17,17 @@ namespace gameplay
 TileSet::TileSet() : Drawable(),
     _tiles(NULL), _tileWidth(0), _tileHeight(0),
     _rowCount(0), _columnCount(0), _width(0), _height(0),
-    _opacity(1.0f), _color(Vector4::one()), _batch(NULL)
+    _opacity(1.0f), _color(Vector4::one()), _batch(NULL),
+    _mesh(NULL), _material(NULL), _chunkColumnCount(0)
 {
 }
 
 TileSet::~TileSet()
 {
     SAFE_DELETE_ARRAY(_tiles);
-    SAFE_DELETE(_batch);
+    SAFE_RELEASE(_material);
+    SAFE_RELEASE(_mesh);
+    SpriteRenderer::releaseBatch(_batch);
 }
     
 TileSet& TileSet::operator=(const TileSet& set)
@@ -32,11 +43,10 @@ TileSet* TileSet::create(const char* imagePath,
     GP_ASSERT(tileWidth > 0 && tileHeight > 0);
     GP_ASSERT(rowCount > 0 && columnCount > 0);
     
-    SpriteBatch* batch = SpriteBatch::create(imagePath);
-    batch->getSampler()->setWrapMode(Texture::CLAMP, Texture::CLAMP);
-    batch->getSampler()->setFilterMode(Texture::Filter::NEAREST, Texture::Filter::NEAREST);
-    batch->getStateBlock()->setDepthWrite(false);
-    batch->getStateBlock()->setDepthTest(true);
+    // Tile sets that draw the same image share their batch, so that the sprite renderer can merge their draws.
+    SpriteBatch* batch = SpriteRenderer::acquireBatch(imagePath, Texture::NEAREST, Sprite::BLEND_ALPHA);
+    if (!batch)
+        return NULL;
     
     TileSet* tileset = new TileSet();
     tileset->_batch = batch;
@@ -98,6 +108,8 @@ TileSet* TileSet::create(Properties* properties)
 
     // Create tile set
     TileSet* set = TileSet::create(imagePath, tileWidth, tileHeight, rows, columns);
+    if (!set)
+        return NULL;
 
     // Get color
     if (properties->exists("color"))
@@ -152,6 +164,8 @@ void TileSet::setTileSource(unsigned int column, unsigned int row, const Vector2
     GP_ASSERT(row < _rowCount);
     
     _tiles[row * _columnCount + column] = source;
+    if (!_chunks.empty())
+        _chunks[(row / TILESET_CHUNK_SIZE) * _chunkColumnCount + column / TILESET_CHUNK_SIZE].dirty = true;
 }
 
 void TileSet::getTileSource(unsigned int column, unsigned int row, Vector2* source)
@@ -196,7 +210,11 @@ float TileSet::getHeight() const
     
 void TileSet::setOpacity(float opacity)
 {
-    _opacity = opacity;
+    if (_opacity != opacity)
+    {
+        _opacity = opacity;
+        setChunksDirty();
+    }
 }
 
 float TileSet::getOpacity() const
@@ -206,7 +224,11 @@ float TileSet::getOpacity() const
 
 void TileSet::setColor(const Vector4& color)
 {
-    _color = color;
+    if (_color != color)
+    {
+        _color = color;
+        setChunksDirty();
+    }
 }
 
 const Vector4& TileSet::getColor() const
@@ -218,6 +240,8 @@ unsigned int TileSet::draw(bool wireframe)
 {
     // Apply scene camera projection and translation offsets
     Vector3 position = Vector3::zero();
+    Matrix projectionMatrix;
+    bool hasProjection = false;
     if (_node && _node->getScene())
     {
         Camera* activeCamera = _node->getScene()->getActiveCamera();
@@ -227,9 +251,8 @@ unsigned int TileSet::draw(bool wireframe)
             if (cameraNode)
             {
                 // Scene projection
-                Matrix projectionMatrix;
                 projectionMatrix = _node->getProjectionMatrix();
-                _batch->setProjectionMatrix(projectionMatrix);
+                hasProjection = true;
 
                 position.x -= cameraNode->getTranslationWorld().x;
                 position.y -= cameraNode->getTranslationWorld().y;
@@ -243,10 +266,260 @@ unsigned int TileSet::draw(bool wireframe)
         position.z += translation.z;
     }
     
+    // Tile sets whose image is not a 2D texture, such as a layer of a texture array, are drawn tile by tile.
+    if (!_mesh && !createChunks())
+        return drawTiles(position, hasProjection ? &projectionMatrix : NULL);
+
+    // The draws of sprites that were made before the tile set must be drawn first.
+    SpriteRenderer* renderer = Game::getInstance()->getSpriteRenderer();
+    GP_ASSERT(renderer);
+    renderer->flush();
+
+    // The chunks are positioned in the tile set, so the offset of the tile set is applied with the projection.
+    Matrix translation;
+    Matrix::createTranslation(position, &translation);
+    Matrix viewProjection;
+    Matrix::multiply(hasProjection ? projectionMatrix : _batch->getProjectionMatrix(), translation, &viewProjection);
+    return drawChunks(viewProjection);
+}
+
+bool TileSet::createChunks()
+{
+    GP_ASSERT(_batch);
+
+    Texture* texture = _batch->getSampler()->getTexture();
+    GP_ASSERT(texture);
+    if (texture->getType() != Texture::TEXTURE_2D)
+        return false;
+    Effect* effect = _batch->getMaterial()->getTechnique()->getPassByIndex(0)->getEffect();
+    GP_ASSERT(effect);
+    if (!effect->isReady())
+        return false;
+
+    // The chunks are stored one after the other in the vertex buffer, row by row, so the
+    // chunks that are visible next to each other can be drawn together.
+    _chunkColumnCount = (_columnCount + TILESET_CHUNK_SIZE - 1) / TILESET_CHUNK_SIZE;
+    unsigned int chunkRowCount = (_rowCount + TILESET_CHUNK_SIZE - 1) / TILESET_CHUNK_SIZE;
+    unsigned int tileCount = 0;
+    _chunks.resize(_chunkColumnCount * chunkRowCount);
+    for (unsigned int i = 0, count = (unsigned int)_chunks.size(); i < count; ++i)
+    {
+        Chunk& chunk = _chunks[i];
+        chunk.column = (i % _chunkColumnCount) * TILESET_CHUNK_SIZE;
+        chunk.row = (i / _chunkColumnCount) * TILESET_CHUNK_SIZE;
+        chunk.columnCount = std::min((unsigned int)TILESET_CHUNK_SIZE, _columnCount - chunk.column);
+        chunk.rowCount = std::min((unsigned int)TILESET_CHUNK_SIZE, _rowCount - chunk.row);
+        chunk.firstTile = tileCount;
+        chunk.tileCount = chunk.columnCount * chunk.rowCount;
+        chunk.empty = true;
+        chunk.dirty = true;
+        tileCount += chunk.tileCount;
+    }
+
+    // Each tile is a quad of the vertex format of sprite batches.
+    VertexFormat::Element vertexElements[] =
+    {
+        VertexFormat::Element(VertexFormat::POSITION, 3),
+        VertexFormat::Element(VertexFormat::TEXCOORD0, 2),
+        VertexFormat::Element(VertexFormat::COLOR, 4)
+    };
+    unsigned int vertexCount = tileCount * 4;
+    _mesh = Mesh::createMesh(VertexFormat(vertexElements, 3), vertexCount, true);
+    if (!_mesh)
+    {
+        _chunks.clear();
+        return false;
+    }
+
+    // The indices never change, since empty tiles are written as degenerate quads.
+    unsigned int indexCount = tileCount * 6;
+    Mesh::IndexFormat indexFormat = vertexCount > 65536 ? Mesh::INDEX32 : Mesh::INDEX16;
+    MeshPart* part = _mesh->addPart(Mesh::TRIANGLES, indexFormat, indexCount);
+    GP_ASSERT(part);
+    if (indexFormat == Mesh::INDEX32)
+    {
+        std::vector<unsigned int> indices(indexCount);
+        for (unsigned int i = 0; i < tileCount; ++i)
+        {
+            unsigned int* index = &indices[i * 6];
+            unsigned int vertex = i * 4;
+            index[0] = vertex; index[1] = vertex + 1; index[2] = vertex + 2;
+            index[3] = vertex + 2; index[4] = vertex + 1; index[5] = vertex + 3;
+        }
+        part->setIndexData(&indices[0], 0, indexCount);
+    }
+    else
+    {
+        std::vector<unsigned short> indices(indexCount);
+        for (unsigned int i = 0; i < tileCount; ++i)
+        {
+            unsigned short* index = &indices[i * 6];
+            unsigned short vertex = (unsigned short)(i * 4);
+            index[0] = vertex; index[1] = vertex + 1; index[2] = vertex + 2;
+            index[3] = vertex + 2; index[4] = vertex + 1; index[5] = vertex + 3;
+        }
+        part->setIndexData(&indices[0], 0, indexCount);
+    }
+
+    // The material draws the image of the batch with the same blending, but from the vertex buffer of the tile set.
+    _material = Material::create(effect);
+    _material->getStateBlock()->setBlend(true);
+    _material->getStateBlock()->setBlendSrc(RenderState::BLEND_SRC_ALPHA);
+    _material->getStateBlock()->setBlendDst(RenderState::BLEND_ONE_MINUS_SRC_ALPHA);
+    _material->getParameter("u_texture")->setValue(_batch->getSampler());
+    Pass* pass = _material->getTechnique()->getPassByIndex(0);
+    VertexAttributeBinding* b = VertexAttributeBinding::create(_mesh, effect);
+    pass->setVertexAttributeBinding(b);
+    SAFE_RELEASE(b);
+
+    return true;
+}
+
+void TileSet::updateChunk(Chunk& chunk)
+{
+    GP_ASSERT(_mesh);
+
+    Texture* texture = _batch->getSampler()->getTexture();
+    float widthRatio = 1.0f / (float)texture->getWidth();
+    float heightRatio = 1.0f / (float)texture->getHeight();
+    Vector4 color(_color.x, _color.y, _color.z, _color.w * _opacity);
+
+    // The tiles are laid out as they are drawn by a sprite batch, with the first row at the top.
+    std::vector<SpriteBatch::SpriteVertex> vertices(chunk.tileCount * 4);
+    chunk.empty = true;
+    for (unsigned int r = 0; r < chunk.rowCount; ++r)
+    {
+        for (unsigned int c = 0; c < chunk.columnCount; ++c)
+        {
+            // Negative values are skipped to allow blank tiles
+            const Vector2& source = _tiles[(chunk.row + r) * _columnCount + chunk.column + c];
+            if (source.x < 0 || source.y < 0)
+                continue;
+
+            float x1 = (chunk.column + c) * _tileWidth;
+            float y1 = (_rowCount - 1 - chunk.row - r) * _tileHeight;
+            float x2 = x1 + _tileWidth;
+            float y2 = y1 + _tileHeight;
+            float u1 = widthRatio * source.x;
+            float v1 = 1.0f - heightRatio * source.y;
+            float u2 = u1 + widthRatio * _tileWidth;
+            float v2 = v1 - heightRatio * _tileHeight;
+
+            SpriteBatch::SpriteVertex* v = &vertices[(r * chunk.columnCount + c) * 4];
+            const float positions[4][4] = { { x1, y2, u1, v1 }, { x1, y1, u1, v2 }, { x2, y2, u2, v1 }, { x2, y1, u2, v2 } };
+            for (unsigned int i = 0; i < 4; ++i)
+            {
+                v[i].x = positions[i][0];
+                v[i].y = positions[i][1];
+                v[i].z = 0.0f;
+                v[i].u = positions[i][2];
+                v[i].v = positions[i][3];
+                v[i].r = color.x;
+                v[i].g = color.y;
+                v[i].b = color.z;
+                v[i].a = color.w;
+            }
+            chunk.empty = false;
+        }
+    }
+    _mesh->setVertexData((const float*)&vertices[0], chunk.firstTile * 4, chunk.tileCount * 4);
+    chunk.dirty = false;
+}
+
+void TileSet::setChunksDirty()
+{
+    for (size_t i = 0, count = _chunks.size(); i < count; ++i)
+        _chunks[i].dirty = true;
+}
+
+bool TileSet::isChunkVisible(const Chunk& chunk, const Matrix& viewProjection) const
+{
+    if (chunk.empty)
+        return false;
+
+    // The corners of the chunk are projected, and the chunk is visible if their bounds overlap the view.
+    float x1 = chunk.column * _tileWidth;
+    float x2 = (chunk.column + chunk.columnCount) * _tileWidth;
+    float y1 = (_rowCount - chunk.row - chunk.rowCount) * _tileHeight;
+    float y2 = (_rowCount - chunk.row) * _tileHeight;
+    const float corners[4][2] = { { x1, y1 }, { x2, y1 }, { x1, y2 }, { x2, y2 } };
+    Vector2 minBounds(FLT_MAX, FLT_MAX);
+    Vector2 maxBounds(-FLT_MAX, -FLT_MAX);
+    for (unsigned int i = 0; i < 4; ++i)
+    {
+        Vector4 corner(corners[i][0], corners[i][1], 0.0f, 1.0f);
+        viewProjection.transformVector(&corner);
+        if (corner.w <= 0.0f)
+            return true;
+        float x = corner.x / corner.w;
+        float y = corner.y / corner.w;
+        minBounds.x = std::min(minBounds.x, x);
+        minBounds.y = std::min(minBounds.y, y);
+        maxBounds.x = std::max(maxBounds.x, x);
+        maxBounds.y = std::max(maxBounds.y, y);
+    }
+    return maxBounds.x >= -1.0f && minBounds.x <= 1.0f && maxBounds.y >= -1.0f && minBounds.y <= 1.0f;
+}
+
+unsigned int TileSet::drawChunks(const Matrix& viewProjection)
+{
+    GP_ASSERT(_mesh);
+    GP_ASSERT(_material);
+
+    for (size_t i = 0, count = _chunks.size(); i < count; ++i)
+    {
+        if (_chunks[i].dirty)
+            updateChunk(_chunks[i]);
+    }
+
+    _material->getParameter("u_projectionMatrix")->setValue(viewProjection);
+    MeshPart* part = _mesh->getPart(0);
+    GP_ASSERT(part);
+    unsigned int indexSize = part->getIndexFormat() == Mesh::INDEX32 ? sizeof(unsigned int) : sizeof(unsigned short);
+
+    Pass* pass = _material->getTechnique()->getPassByIndex(0);
+    GP_ASSERT(pass);
+    bool bound = false;
+    unsigned int drawCalls = 0;
+    size_t i = 0;
+    size_t count = _chunks.size();
+    while (i < count)
+    {
+        // The visible chunks that follow each other are next to each other in the buffers, so they are drawn together.
+        unsigned int firstTile = _chunks[i].firstTile;
+        unsigned int tileCount = 0;
+        for (; i < count && isChunkVisible(_chunks[i], viewProjection); ++i)
+            tileCount += _chunks[i].tileCount;
+        if (tileCount == 0)
+        {
+            ++i;
+            continue;
+        }
+
+        if (!bound)
+        {
+            pass->bind();
+            RenderState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, part->getIndexBuffer());
+            bound = true;
+        }
+        GraphicsDevice::drawElements(GL_TRIANGLES, tileCount * 6, part->getIndexFormat(),
+                                     (GLvoid*)(size_t)(part->getIndexOffset() + firstTile * 6 * indexSize));
+        ++drawCalls;
+    }
+    if (bound)
+        pass->unbind();
+    return drawCalls;
+}
+
+unsigned int TileSet::drawTiles(const Vector3& offset, const Matrix* projection)
+{
     // Draw each cell in the tile set
+    Vector3 position = offset;
     position.y += _tileHeight * (_rowCount - 1);
     float xStart = position.x;
-    _batch->start();
+    SpriteRenderer* renderer = Game::getInstance()->getSpriteRenderer();
+    GP_ASSERT(renderer);
+    renderer->startBatch(_batch, projection);
     for (unsigned int row = 0; row < _rowCount; row++)
     {
         for (unsigned int col = 0; col < _columnCount; col++)
@@ -268,7 +541,7 @@ unsigned int TileSet::draw(bool wireframe)
         position.x = xStart;
         position.y -= _tileHeight;
     }
-    _batch->finish();
+    renderer->finishBatch(_batch);
     return 1;
 }
 
@@ -276,19 +549,19 @@ Drawable* TileSet::clone(NodeCloneContext& context)
 {
     TileSet* tilesetClone = new TileSet();
 
-    // Clone properties
+    // Clone properties, the chunks of the clone are created when it is first drawn
+    tilesetClone->_rowCount = _rowCount;
+    tilesetClone->_columnCount = _columnCount;
     tilesetClone->_tiles = new Vector2[tilesetClone->_rowCount * tilesetClone->_columnCount];
-    memset(tilesetClone->_tiles, -1, sizeof(float) * tilesetClone->_rowCount * tilesetClone->_columnCount * 2);
     memcpy(tilesetClone->_tiles, _tiles, sizeof(Vector2) * tilesetClone->_rowCount * tilesetClone->_columnCount);
     tilesetClone->_tileWidth = _tileWidth;
     tilesetClone->_tileHeight = _tileHeight;
-    tilesetClone->_rowCount = _rowCount;
-    tilesetClone->_columnCount = _columnCount;
     tilesetClone->_width = _tileWidth * _columnCount;
     tilesetClone->_height = _tileHeight * _rowCount;
     tilesetClone->_opacity = _opacity;
     tilesetClone->_color = _color;
     tilesetClone->_batch = _batch;
+    SpriteRenderer::addBatchRef(_batch);
 
     return tilesetClone;
 }
@@ -8,6 +8,8 @@
 #include "Vector4.h"
 #include "SpriteBatch.h"
 #include "Effect.h"
+#include "Mesh.h"
+#include "Material.h"
 
 namespace gameplay
 {
@@ -26,6 +28,12 @@ namespace gameplay
  * a gutter of duplicate pixels on each side of the region.
  *
  * The tile set does not support rotation or scaling.
+ *
+ * The tiles are split into chunks of 32x32 tiles, whose vertices are kept in a
+ * vertex buffer on the GPU. A chunk is only written again when one of its tiles,
+ * or the color or opacity of the tile set, is changed, and only the chunks that
+ * are in the view of the camera are drawn. Animating tiles by changing their
+ * sources with setTileSource() therefore only updates the chunks they are in.
  */
 class TileSet : public Ref, public Drawable
 {
@@ -176,6 +184,33 @@ protected:
 
 private:
 
+    /**
+     * A block of tiles whose vertices are stored together in the vertex buffer.
+     */
+    struct Chunk
+    {
+        unsigned int column;
+        unsigned int row;
+        unsigned int columnCount;
+        unsigned int rowCount;
+        unsigned int firstTile;
+        unsigned int tileCount;
+        bool empty;
+        bool dirty;
+    };
+
+    bool createChunks();
+
+    void updateChunk(Chunk& chunk);
+
+    void setChunksDirty();
+
+    bool isChunkVisible(const Chunk& chunk, const Matrix& viewProjection) const;
+
+    unsigned int drawChunks(const Matrix& viewProjection);
+
+    unsigned int drawTiles(const Vector3& offset, const Matrix* projection);
+
     Vector2* _tiles;
     float _tileWidth;
     float _tileHeight;
@@ -186,6 +221,10 @@ private:
     SpriteBatch* _batch;
     float _opacity;
     Vector4 _color;
+    Mesh* _mesh;
+    Material* _material;
+    unsigned int _chunkColumnCount;
+    std::vector<Chunk> _chunks;
 };
     
 }
@@ -0,0 +1,267 @@
+#include "Base.h"
+#include "TimerWheel.h"
+
+// The end of a list of events
+#define TIMERWHEEL_NONE 0xFFFFFFFF
+
+// The list that the events of a slot are moved to while they are fired
+#define TIMERWHEEL_FIRING (TIMERWHEEL_LEVELS * TIMERWHEEL_SLOTS)
+
+// The handles of events keep the index of the event in their low bits, and a generation that
+// changes each time the event is reused in their high bits, so that stale handles are ignored.
+#define TIMERWHEEL_INDEX_BITS 20
+#define TIMERWHEEL_INDEX_MASK ((1u << TIMERWHEEL_INDEX_BITS) - 1)
+#define TIMERWHEEL_GENERATION_MASK ((1u << (32 - TIMERWHEEL_INDEX_BITS)) - 1)
+
+namespace gameplay
+{
+
+// Events are fired in the first tick that is not earlier than their time, so that they are never fired early.
+static unsigned long long getTick(double time)
+{
+    return time > 0.0 ? (unsigned long long)ceil(time) : 0;
+}
+
+TimerWheel::TimerWheel()
+    : _freeEvents(TIMERWHEEL_NONE), _currentTick(0), _count(0)
+{
+    clear();
+}
+
+TimerWheel::~TimerWheel()
+{
+}
+
+unsigned int TimerWheel::schedule(double time, TimeListener* listener, void* cookie)
+{
+    unsigned int index = _freeEvents;
+    if (index != TIMERWHEEL_NONE)
+    {
+        _freeEvents = _events[index].next;
+    }
+    else
+    {
+        if (_events.size() >= TIMERWHEEL_INDEX_MASK)
+        {
+            GP_WARN("Failed to schedule a time event; too many events are scheduled.");
+            return 0;
+        }
+        index = (unsigned int)_events.size();
+        Event event;
+        event.generation = 0;
+        _events.push_back(event);
+    }
+
+    Event& event = _events[index];
+    event.time = time;
+    event.listener = listener;
+    event.cookie = cookie;
+    insert(index);
+    ++_count;
+
+    return (event.generation << TIMERWHEEL_INDEX_BITS) | (index + 1);
+}
+
+bool TimerWheel::cancel(unsigned int handle)
+{
+    unsigned int index = (handle & TIMERWHEEL_INDEX_MASK) - 1;
+    if (handle == 0 || index >= _events.size())
+        return false;
+
+    Event& event = _events[index];
+    if (event.list == TIMERWHEEL_NONE || event.generation != (handle >> TIMERWHEEL_INDEX_BITS))
+        return false;
+
+    unlink(index);
+    free(index);
+    --_count;
+    return true;
+}
+
+unsigned int TimerWheel::fire(double time)
+{
+    unsigned long long tick = time > 0.0 ? (unsigned long long)time : 0;
+    unsigned int fired = 0;
+
+    while (_currentTick < tick)
+    {
+        if (_count == 0)
+        {
+            // Nothing is scheduled, so the wheel can move straight to the current tick.
+            _currentTick = tick;
+            break;
+        }
+
+        unsigned long long nextTick = _currentTick + 1;
+        if (_levelCounts[0] == 0)
+        {
+            // The ticks until the next slot of the second level have no events, and nothing
+            // cascades before then, so they are skipped.
+            unsigned long long boundary = (_currentTick | (TIMERWHEEL_SLOTS - 1)) + 1;
+            nextTick = boundary <= tick ? boundary : tick;
+        }
+        _currentTick = nextTick;
+
+        // Move the events of the coarser levels down when the finer level wraps around.
+        unsigned int slot = (unsigned int)(_currentTick % TIMERWHEEL_SLOTS);
+        for (unsigned int level = 1; slot == 0 && level < TIMERWHEEL_LEVELS; ++level)
+        {
+            slot = (unsigned int)((_currentTick >> (8 * level)) % TIMERWHEEL_SLOTS);
+            cascade(level, slot);
+        }
+
+        // Move the events of the tick to the firing list, so that listeners can schedule and
+        // cancel events (including the ones that are about to fire) while it is fired.
+        unsigned int list = (unsigned int)(_currentTick % TIMERWHEEL_SLOTS);
+        if (_heads[list] == TIMERWHEEL_NONE)
+            continue;
+        for (unsigned int index = _heads[list]; index != TIMERWHEEL_NONE; index = _events[index].next)
+        {
+            _events[index].list = TIMERWHEEL_FIRING;
+            --_levelCounts[0];
+        }
+        _heads[TIMERWHEEL_FIRING] = _heads[list];
+        _tails[TIMERWHEEL_FIRING] = _tails[list];
+        _heads[list] = _tails[list] = TIMERWHEEL_NONE;
+
+        while (_heads[TIMERWHEEL_FIRING] != TIMERWHEEL_NONE)
+        {
+            unsigned int index = _heads[TIMERWHEEL_FIRING];
+            Event event = _events[index];
+            unlink(index);
+            free(index);
+            --_count;
+            ++fired;
+            if (event.listener)
+                event.listener->timeEvent((long)(time - event.time), event.cookie);
+        }
+    }
+    return fired;
+}
+
+void TimerWheel::clear()
+{
+    _events.clear();
+    _freeEvents = TIMERWHEEL_NONE;
+    for (unsigned int i = 0; i < TIMERWHEEL_LEVELS * TIMERWHEEL_SLOTS + 1; ++i)
+        _heads[i] = _tails[i] = TIMERWHEEL_NONE;
+    for (unsigned int i = 0; i < TIMERWHEEL_LEVELS; ++i)
+        _levelCounts[i] = 0;
+    _count = 0;
+}
+
+unsigned int TimerWheel::getCount() const
+{
+    return _count;
+}
+
+double TimerWheel::getNextTime() const
+{
+    if (_count == 0)
+        return -1.0;
+
+    // The first slot with events of each level is visited, since an event that is kept in a
+    // coarse level until its slot cascades can be due before the events of the finer levels.
+    double nextTime = -1.0;
+    for (unsigned int level = 0; level < TIMERWHEEL_LEVELS; ++level)
+    {
+        if (_levelCounts[level] == 0)
+            continue;
+
+        unsigned long long current = _currentTick >> (8 * level);
+        for (unsigned int i = 1; i <= TIMERWHEEL_SLOTS; ++i)
+        {
+            unsigned int list = level * TIMERWHEEL_SLOTS + (unsigned int)((current + i) % TIMERWHEEL_SLOTS);
+            if (_heads[list] == TIMERWHEEL_NONE)
+                continue;
+            for (unsigned int index = _heads[list]; index != TIMERWHEEL_NONE; index = _events[index].next)
+            {
+                if (nextTime < 0.0 || _events[index].time < nextTime)
+                    nextTime = _events[index].time;
+            }
+            break;
+        }
+    }
+    return nextTime;
+}
+
+void TimerWheel::insert(unsigned int index)
+{
+    unsigned long long tick = getTick(_events[index].time);
+    if (tick <= _currentTick)
+        tick = _currentTick + 1;
+
+    // Find the finest level that reaches the tick. Events beyond the last level are kept in
+    // its farthest slot, and are moved back there until they are due.
+    unsigned long long delta = tick - _currentTick;
+    unsigned int level = 0;
+    while (level < TIMERWHEEL_LEVELS - 1 && delta >= (1ull << (8 * (level + 1))))
+        ++level;
+    if (delta >= (1ull << (8 * TIMERWHEEL_LEVELS)))
+        tick = _currentTick + (1ull << (8 * TIMERWHEEL_LEVELS)) - 1;
+
+    unsigned int slot = (unsigned int)((tick >> (8 * level)) % TIMERWHEEL_SLOTS);
+    link(index, level * TIMERWHEEL_SLOTS + slot);
+}
+
+void TimerWheel::link(unsigned int index, unsigned int list)
+{
+    Event& event = _events[index];
+    event.list = list;
+    event.next = TIMERWHEEL_NONE;
+    event.prev = _tails[list];
+    if (_tails[list] != TIMERWHEEL_NONE)
+        _events[_tails[list]].next = index;
+    else
+        _heads[list] = index;
+    _tails[list] = index;
+    if (list < TIMERWHEEL_FIRING)
+        ++_levelCounts[list / TIMERWHEEL_SLOTS];
+}
+
+void TimerWheel::unlink(unsigned int index)
+{
+    Event& event = _events[index];
+    unsigned int list = event.list;
+    GP_ASSERT(list != TIMERWHEEL_NONE);
+    if (event.prev != TIMERWHEEL_NONE)
+        _events[event.prev].next = event.next;
+    else
+        _heads[list] = event.next;
+    if (event.next != TIMERWHEEL_NONE)
+        _events[event.next].prev = event.prev;
+    else
+        _tails[list] = event.prev;
+    event.list = TIMERWHEEL_NONE;
+    if (list < TIMERWHEEL_FIRING)
+        --_levelCounts[list / TIMERWHEEL_SLOTS];
+}
+
+void TimerWheel::free(unsigned int index)
+{
+    Event& event = _events[index];
+    event.listener = NULL;
+    event.cookie = NULL;
+    event.list = TIMERWHEEL_NONE;
+    event.generation = (event.generation + 1) & TIMERWHEEL_GENERATION_MASK;
+    event.next = _freeEvents;
+    _freeEvents = index;
+}
+
+void TimerWheel::cascade(unsigned int level, unsigned int slot)
+{
+    // Detach the events of the slot before putting them back, since an event beyond the last
+    // level can go back to the slot that it came from.
+    unsigned int list = level * TIMERWHEEL_SLOTS + slot;
+    unsigned int index = _heads[list];
+    _heads[list] = _tails[list] = TIMERWHEEL_NONE;
+    while (index != TIMERWHEEL_NONE)
+    {
+        unsigned int next = _events[index].next;
+        --_levelCounts[level];
+        insert(index);
+        index = next;
+    }
+}
+
+}
@@ -0,0 +1,145 @@
+#ifndef TIMERWHEEL_H_
+#define TIMERWHEEL_H_
+
+#include "TimeListener.h"
+
+// The number of levels of a timer wheel, and the number of slots of each level
+#define TIMERWHEEL_LEVELS 4
+#define TIMERWHEEL_SLOTS 256
+
+namespace gameplay
+{
+
+/**
+ * Defines a hierarchical timer wheel, which keeps the time events of Game::schedule.
+ *
+ * Time is divided into ticks of one millisecond. The first level of the wheel has a slot for
+ * each of the next 256 ticks, and each following level has slots that are 256 times as long,
+ * so that events far in the future are kept in a coarse slot and moved down to the finer levels
+ * as their time approaches. Scheduling and cancelling an event take constant time, and firing
+ * the events of a frame only visits the slots of the ticks that passed.
+ *
+ * Events that are due in the same tick are fired in the order they were scheduled.
+ *
+ * @script{ignore}
+ */
+class TimerWheel
+{
+public:
+
+    /**
+     * Constructor.
+     */
+    TimerWheel();
+
+    /**
+     * Destructor.
+     */
+    ~TimerWheel();
+
+    /**
+     * Schedules a time event.
+     *
+     * @param time The time to fire the event at, in milliseconds. Events that are due already
+     *      are fired the next time that events are fired.
+     * @param listener The listener to send the event to.
+     * @param cookie The cookie of the event.
+     *
+     * @return The handle of the event, which can be used to cancel it (never 0).
+     */
+    unsigned int schedule(double time, TimeListener* listener, void* cookie);
+
+    /**
+     * Cancels a scheduled time event.
+     *
+     * @param handle The handle returned when the event was scheduled.
+     *
+     * @return true if the event was cancelled, false if it was already fired or cancelled.
+     */
+    bool cancel(unsigned int handle);
+
+    /**
+     * Fires the events that are due up to the specified time.
+     *
+     * @param time The current time, in milliseconds.
+     *
+     * @return The number of events that were fired.
+     */
+    unsigned int fire(double time);
+
+    /**
+     * Cancels all of the scheduled events.
+     */
+    void clear();
+
+    /**
+     * Returns the number of scheduled events.
+     *
+     * @return The number of events that have not been fired or cancelled.
+     */
+    unsigned int getCount() const;
+
+    /**
+     * Returns the time of the first scheduled event.
+     *
+     * This visits the slots of each level up to the first one with events, so it takes a
+     * constant time, however many events are scheduled.
+     *
+     * @return The time of the first event, in milliseconds, or -1 if no event is scheduled.
+     */
+    double getNextTime() const;
+
+private:
+
+    struct Event
+    {
+        double time;
+        TimeListener* listener;
+        void* cookie;
+        unsigned int prev;
+        unsigned int next;
+        unsigned int list;
+        unsigned int generation;
+    };
+
+    TimerWheel(const TimerWheel& copy);
+
+    TimerWheel& operator=(const TimerWheel&);
+
+    /**
+     * Puts an event in the slot of the wheel for its time.
+     */
+    void insert(unsigned int index);
+
+    /**
+     * Adds an event to the end of a list.
+     */
+    void link(unsigned int index, unsigned int list);
+
+    /**
+     * Removes an event from its list.
+     */
+    void unlink(unsigned int index);
+
+    /**
+     * Returns an event to the free events.
+     */
+    void free(unsigned int index);
+
+    /**
+     * Moves the events of a slot of a level down to the finer levels.
+     */
+    void cascade(unsigned int level, unsigned int slot);
+
+    std::vector<Event> _events;
+    unsigned int _freeEvents;
+    unsigned int _heads[TIMERWHEEL_LEVELS * TIMERWHEEL_SLOTS + 1];
+    unsigned int _tails[TIMERWHEEL_LEVELS * TIMERWHEEL_SLOTS + 1];
+    unsigned int _levelCounts[TIMERWHEEL_LEVELS];
+    unsigned long long _currentTick;
+    unsigned int _count;
+};
+
+}
+
+#endif
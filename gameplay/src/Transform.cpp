@@ -9,8 +9,11 @@ namespace gameplay
 int Transform::_suspendTransformChanged(0);
 std::vector<Transform*> Transform::_transformsChanged;
 
+// The depths and transforms sorted when the transform changed events are resumed, kept to reuse their memory
+static std::vector<std::pair<unsigned int, Transform*> > __sortedTransformsChanged;
+
 Transform::Transform()
-    : _matrixDirtyBits(0), _listeners(NULL)
+    : _matrixDirtyBits(0), _listeners(NULL), _listenerCount(0), _listenerCapacity(0)
 {
     GP_REGISTER_SCRIPT_EVENTS();
 
@@ -19,7 +22,7 @@ Transform::Transform()
 }
 
 Transform::Transform(const Vector3& scale, const Quaternion& rotation, const Vector3& translation)
-    : _matrixDirtyBits(0), _listeners(NULL)
+    : _matrixDirtyBits(0), _listeners(NULL), _listenerCount(0), _listenerCapacity(0)
 {
     GP_REGISTER_SCRIPT_EVENTS();
 
@@ -28,7 +31,7 @@ Transform::Transform(const Vector3& scale, const Quaternion& rotation, const Vec
 }
 
 Transform::Transform(const Vector3& scale, const Matrix& rotation, const Vector3& translation)
-    : _matrixDirtyBits(0), _listeners(NULL)
+    : _matrixDirtyBits(0), _listeners(NULL), _listenerCount(0), _listenerCapacity(0)
 {
     GP_REGISTER_SCRIPT_EVENTS();
 
@@ -37,7 +40,7 @@ Transform::Transform(const Vector3& scale, const Matrix& rotation, const Vector3
 }
 
 Transform::Transform(const Transform& copy)
-    : _matrixDirtyBits(0), _listeners(NULL)
+    : _matrixDirtyBits(0), _listeners(NULL), _listenerCount(0), _listenerCapacity(0)
 {
     GP_REGISTER_SCRIPT_EVENTS();
 
@@ -47,7 +50,7 @@ Transform::Transform(const Transform& copy)
 
 Transform::~Transform()
 {
-    SAFE_DELETE(_listeners);
+    SAFE_DELETE_ARRAY(_listeners);
 }
 
 void Transform::suspendTransformChanged()
@@ -62,11 +65,17 @@ void Transform::resumeTransformChanged()
     
     if (_suspendTransformChanged == 1)
     {
-        // Call transformChanged() on all transforms in the list
+        GP_PROFILE_SCOPE("Transform::resumeTransformChanged");
+
+        // Notify the transforms in hierarchy order, so that a node is notified before the nodes
+        // below it. The descendants that a node notifies are marked with DIRTY_NOTIFY, so each
+        // transform is notified once in the pass.
         size_t transformCount = _transformsChanged.size();
+        if (transformCount > 1)
+            sortTransformsChanged();
         for (size_t i = 0; i < transformCount; i++)
         {
-            Transform* t = _transformsChanged.at(i);
+            Transform* t = _transformsChanged[i];
             GP_ASSERT(t);
             t->transformChanged();
         }
@@ -76,7 +85,7 @@ void Transform::resumeTransformChanged()
         transformCount = _transformsChanged.size();
         for (size_t i = 0; i < transformCount; i++)
         {
-            Transform* t = _transformsChanged.at(i);
+            Transform* t = _transformsChanged[i];
             GP_ASSERT(t);
             t->_matrixDirtyBits &= ~DIRTY_NOTIFY;
         }
@@ -101,38 +110,12 @@ const Matrix& Transform::getMatrix() const
 {
     if (_matrixDirtyBits)
     {
-        if (!isStatic())
+        if (!isStatic() && (_matrixDirtyBits & (DIRTY_TRANSLATION | DIRTY_ROTATION | DIRTY_SCALE)))
         {
-            bool hasTranslation = !_translation.isZero();
-            bool hasScale = !_scale.isOne();
-            bool hasRotation = !_rotation.isIdentity();
-
             // Compose the matrix in TRS order since we use column-major matrices with column vectors and
             // multiply M*v (as opposed to XNA and DirectX that use row-major matrices with row vectors and multiply v*M).
-            if (hasTranslation || (_matrixDirtyBits & DIRTY_TRANSLATION) == DIRTY_TRANSLATION)
-            {
-                Matrix::createTranslation(_translation, &_matrix);
-                if (hasRotation || (_matrixDirtyBits & DIRTY_ROTATION) == DIRTY_ROTATION)
-                {
-                    _matrix.rotate(_rotation);
-                }
-                if (hasScale || (_matrixDirtyBits & DIRTY_SCALE) == DIRTY_SCALE)
-                {
-                    _matrix.scale(_scale);
-                }
-            }
-            else if (hasRotation || (_matrixDirtyBits & DIRTY_ROTATION) == DIRTY_ROTATION)
-            {
-                Matrix::createRotation(_rotation, &_matrix);
-                if (hasScale || (_matrixDirtyBits & DIRTY_SCALE) == DIRTY_SCALE)
-                {
-                    _matrix.scale(_scale);
-                }
-            }
-            else if (hasScale || (_matrixDirtyBits & DIRTY_SCALE) == DIRTY_SCALE)
-            {
-                Matrix::createScale(_scale, &_matrix);
-            }
+            // The elements are written directly rather than by multiplying the three matrices.
+            Matrix::createTransform(_translation, _rotation, _scale, &_matrix);
         }
 
         _matrixDirtyBits &= ~DIRTY_TRANSLATION & ~DIRTY_ROTATION & ~DIRTY_SCALE;
@@ -959,48 +942,87 @@ void Transform::suspendTransformChange(Transform* transform)
     _transformsChanged.push_back(transform);
 }
 
+void Transform::sortTransformsChanged()
+{
+    // Sort by the depth of the nodes in their hierarchy, keeping the order that the transforms
+    // changed in for the same depth. Transforms that are not nodes are notified first.
+    std::vector<std::pair<unsigned int, Transform*> >& sorted = __sortedTransformsChanged;
+    size_t transformCount = _transformsChanged.size();
+    sorted.resize(transformCount);
+    for (size_t i = 0; i < transformCount; i++)
+    {
+        unsigned int depth = 0;
+        Node* node = dynamic_cast<Node*>(_transformsChanged[i]);
+        if (node)
+        {
+            for (Node* parent = node->getParent(); parent != NULL; parent = parent->getParent())
+                ++depth;
+        }
+        sorted[i].first = depth;
+        sorted[i].second = _transformsChanged[i];
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), compareDepth);
+    for (size_t i = 0; i < transformCount; i++)
+        _transformsChanged[i] = sorted[i].second;
+}
+
+bool Transform::compareDepth(const std::pair<unsigned int, Transform*>& a, const std::pair<unsigned int, Transform*>& b)
+{
+    return a.first < b.first;
+}
+
 void Transform::addListener(Transform::Listener* listener, long cookie)
 {
     GP_ASSERT(listener);
 
-    if (_listeners == NULL)
-        _listeners = new std::list<TransformListener>();
+    if (_listenerCount == _listenerCapacity)
+    {
+        // Most transforms have one or two listeners, so the array starts small and doubles.
+        unsigned int capacity = _listenerCapacity > 0 ? _listenerCapacity * 2 : 2;
+        TransformListener* listeners = new TransformListener[capacity];
+        for (unsigned int i = 0; i < _listenerCount; ++i)
+            listeners[i] = _listeners[i];
+        SAFE_DELETE_ARRAY(_listeners);
+        _listeners = listeners;
+        _listenerCapacity = capacity;
+    }
 
-    TransformListener l;
+    TransformListener& l = _listeners[_listenerCount++];
     l.listener = listener;
     l.cookie = cookie;
-    _listeners->push_back(l);
 }
 
 void Transform::removeListener(Transform::Listener* listener)
 {
     GP_ASSERT(listener);
 
-    if (_listeners)
+    for (unsigned int i = 0; i < _listenerCount; ++i)
     {
-        for (std::list<TransformListener>::iterator itr = _listeners->begin(); itr != _listeners->end(); ++itr)
+        if (_listeners[i].listener == listener)
         {
-            if ((*itr).listener == listener)
-            {
-                _listeners->erase(itr);
-                break;
-            }
+            // Keep the order that the listeners are notified in.
+            --_listenerCount;
+            for (; i < _listenerCount; ++i)
+                _listeners[i] = _listeners[i + 1];
+            break;
         }
     }
 }
 
 void Transform::transformChanged()
 {
-    if (_listeners)
+    // The listeners are indexed rather than iterated, since a listener may add another
+    // listener, which can reallocate the array.
+    for (unsigned int i = 0; i < _listenerCount; ++i)
     {
-        for (std::list<TransformListener>::iterator itr = _listeners->begin(); itr != _listeners->end(); ++itr)
-        {
-            TransformListener& l = *itr;
-            GP_ASSERT(l.listener);
-            l.listener->transformChanged(this, l.cookie);
-        }
+        const TransformListener& l = _listeners[i];
+        GP_ASSERT(l.listener);
+        l.listener->transformChanged(this, l.cookie);
     }
-    fireScriptEvent<void>(GP_GET_SCRIPT_EVENT(Transform, transformChanged), dynamic_cast<void*>(this));
+
+    // Most transforms have no script callbacks, so skip the event lookup for them.
+    if (_scriptCallbacks)
+        fireScriptEvent<void>(GP_GET_SCRIPT_EVENT(Transform, transformChanged), dynamic_cast<void*>(this));
 }
 
 void Transform::cloneInto(Transform* transform, NodeCloneContext &context) const
@@ -6,6 +6,7 @@
 #include "Quaternion.h"
 #include "Matrix.h"
 #include "AnimationTarget.h"
+#include "MemoryPool.h"
 
 namespace gameplay
 {
@@ -108,11 +109,18 @@ public:
 
     /**
      * Globally suspends all transform changed events.
+     *
+     * While the events are suspended, changed transforms are only marked, and when the events are
+     * resumed they are propagated in a single pass, so that each transform and its listeners are
+     * notified once however many times the transform, or the nodes above it, changed.
      */
     static void suspendTransformChanged();
 
     /**
      * Globally resumes all transform changed events.
+     *
+     * The transforms that changed while the events were suspended are notified in hierarchy order,
+     * from the nodes nearest to the root down to their descendants.
      */
     static void resumeTransformChanged();
 
@@ -847,6 +855,16 @@ protected:
      */
     static void suspendTransformChange(Transform* transform);
 
+    /**
+     * Sorts the transforms waiting to be notified of a change by their depth in the node hierarchy.
+     */
+    static void sortTransformsChanged();
+
+    /**
+     * Compares the depths of transforms for sortTransformsChanged.
+     */
+    static bool compareDepth(const std::pair<unsigned int, Transform*>& a, const std::pair<unsigned int, Transform*>& b);
+
     /**
      * Called when the transform changes.
      */
@@ -886,9 +904,19 @@ protected:
     mutable char _matrixDirtyBits;
     
     /** 
-     * List of TransformListener's on the Transform.
+     * Array of TransformListener's on the Transform, in the order that they were added.
+     */
+    TransformListener* _listeners;
+
+    /**
+     * The number of listeners in the array.
+     */
+    unsigned int _listenerCount;
+
+    /**
+     * The number of listeners that the array can hold.
      */
-    std::list<TransformListener>* _listeners;
+    unsigned int _listenerCapacity;
 
 private:
    
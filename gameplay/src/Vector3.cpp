@@ -234,27 +234,7 @@ void Vector3::normalize(Vector3* dst) const
 {
     GP_ASSERT(dst);
 
-    if (dst != this)
-    {
-        dst->x = x;
-        dst->y = y;
-        dst->z = z;
-    }
-
-    float n = x * x + y * y + z * z;
-    // Already normalized.
-    if (n == 1.0f)
-        return;
-
-    n = sqrt(n);
-    // Too close to zero.
-    if (n < MATH_TOLERANCE)
-        return;
-
-    n = 1.0f / n;
-    dst->x *= n;
-    dst->y *= n;
-    dst->z *= n;
+    MathUtil::normalizeVector3(&x, MATH_TOLERANCE, &dst->x);
 }
 
 void Vector3::scale(float scalar)
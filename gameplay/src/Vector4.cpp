@@ -1,5 +1,6 @@
 #include "Base.h"
 #include "Vector4.h"
+#include "MathUtil.h"
 
 namespace gameplay
 {
@@ -243,29 +244,7 @@ void Vector4::normalize(Vector4* dst) const
 {
     GP_ASSERT(dst);
 
-    if (dst != this)
-    {
-        dst->x = x;
-        dst->y = y;
-        dst->z = z;
-        dst->w = w;
-    }
-
-    float n = x * x + y * y + z * z + w * w;
-    // Already normalized.
-    if (n == 1.0f)
-        return;
-
-    n = sqrt(n);
-    // Too close to zero.
-    if (n < MATH_TOLERANCE)
-        return;
-
-    n = 1.0f / n;
-    dst->x *= n;
-    dst->y *= n;
-    dst->z *= n;
-    dst->w *= n;
+    MathUtil::normalizeVector4(&x, MATH_TOLERANCE, &dst->x);
 }
 
 void Vector4::scale(float scalar)
@@ -2,6 +2,7 @@
 #include "VertexAttributeBinding.h"
 #include "Mesh.h"
 #include "Effect.h"
+#include "RenderState.h"
 
 namespace gameplay
 {
@@ -9,8 +10,40 @@ namespace gameplay
 static GLuint __maxVertexAttribs = 0;
 static std::vector<VertexAttributeBinding*> __vertexAttributeBindingCache;
 
+// OpenGL ES 2.0 only has half floats through the OES_vertex_half_float extension.
+#if !defined(GL_HALF_FLOAT) && defined(GL_HALF_FLOAT_OES)
+#define GL_HALF_FLOAT GL_HALF_FLOAT_OES
+#endif
+#ifndef GL_HALF_FLOAT
+#define GL_HALF_FLOAT 0x140B
+#endif
+#ifndef GL_INT_2_10_10_10_REV
+#define GL_INT_2_10_10_10_REV 0x8D9F
+#endif
+
+static GLenum getVertexAttribType(VertexFormat::Type type)
+{
+    switch (type)
+    {
+    case VertexFormat::HALF_FLOAT:
+        return GL_HALF_FLOAT;
+    case VertexFormat::BYTE:
+        return GL_BYTE;
+    case VertexFormat::UNSIGNED_BYTE:
+        return GL_UNSIGNED_BYTE;
+    case VertexFormat::SHORT:
+        return GL_SHORT;
+    case VertexFormat::UNSIGNED_SHORT:
+        return GL_UNSIGNED_SHORT;
+    case VertexFormat::INT_2_10_10_10_REV:
+        return GL_INT_2_10_10_10_REV;
+    default:
+        return GL_FLOAT;
+    }
+}
+
 VertexAttributeBinding::VertexAttributeBinding() :
-    _handle(0), _attributes(NULL), _mesh(NULL), _effect(NULL)
+    _handle(0), _attributes(NULL), _mesh(NULL), _vertexBuffer(0), _effect(NULL)
 {
 }
 
@@ -29,7 +62,7 @@ VertexAttributeBinding::~VertexAttributeBinding()
 
     if (_handle)
     {
-        GL_ASSERT( glDeleteVertexArrays(1, &_handle) );
+        RenderState::deleteVertexArray(_handle);
         _handle = 0;
     }
 }
@@ -52,7 +85,9 @@ VertexAttributeBinding* VertexAttributeBinding::create(Mesh* mesh, Effect* effec
         }
     }
 
-    b = create(mesh, mesh->getVertexFormat(), 0, effect);
+    // The attribute pointers start at the first vertex of the mesh, which is not at the start of
+    // its vertex buffer when it shares the buffer with other meshes.
+    b = create(mesh, mesh->getVertexBuffer(), mesh->getVertexFormat(), (void*)(size_t)mesh->getVertexOffset(), effect);
 
     // Add the new vertex attribute binding to the cache.
     if (b)
@@ -65,10 +100,16 @@ VertexAttributeBinding* VertexAttributeBinding::create(Mesh* mesh, Effect* effec
 
 VertexAttributeBinding* VertexAttributeBinding::create(const VertexFormat& vertexFormat, void* vertexPointer, Effect* effect)
 {
-    return create(NULL, vertexFormat, vertexPointer, effect);
+    return create(NULL, 0, vertexFormat, vertexPointer, effect);
 }
 
-VertexAttributeBinding* VertexAttributeBinding::create(Mesh* mesh, const VertexFormat& vertexFormat, void* vertexPointer, Effect* effect)
+VertexAttributeBinding* VertexAttributeBinding::createFromBuffer(const VertexFormat& vertexFormat, GLuint vertexBuffer, Effect* effect)
+{
+    GP_ASSERT(vertexBuffer);
+    return create(NULL, vertexBuffer, vertexFormat, 0, effect);
+}
+
+VertexAttributeBinding* VertexAttributeBinding::create(Mesh* mesh, GLuint vertexBuffer, const VertexFormat& vertexFormat, void* vertexPointer, Effect* effect)
 {
     GP_ASSERT(effect);
 
@@ -90,10 +131,10 @@ VertexAttributeBinding* VertexAttributeBinding::create(Mesh* mesh, const VertexF
     VertexAttributeBinding* b = new VertexAttributeBinding();
 
 #ifdef GP_USE_VAO
-    if (mesh && glGenVertexArrays)
+    if (vertexBuffer && glGenVertexArrays)
     {
-        GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, 0) );
-        GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0) );
+        RenderState::bindBuffer(GL_ARRAY_BUFFER, 0);
+        RenderState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
         // Use hardware VAOs.
         GL_ASSERT( glGenVertexArrays(1, &b->_handle) );
@@ -106,10 +147,10 @@ VertexAttributeBinding* VertexAttributeBinding::create(Mesh* mesh, const VertexF
         }
 
         // Bind the new VAO.
-        GL_ASSERT( glBindVertexArray(b->_handle) );
+        RenderState::bindVertexArray(b->_handle);
 
-        // Bind the Mesh VBO so our glVertexAttribPointer calls use it.
-        GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, mesh->getVertexBuffer()) );
+        // Bind the VBO so our glVertexAttribPointer calls use it.
+        RenderState::bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
     }
     else
 #endif
@@ -134,6 +175,7 @@ VertexAttributeBinding* VertexAttributeBinding::create(Mesh* mesh, const VertexF
         b->_mesh = mesh;
         mesh->addRef();
     }
+    b->_vertexBuffer = vertexBuffer;
     
     b->_effect = effect;
     effect->addRef();
@@ -198,15 +240,15 @@ VertexAttributeBinding* VertexAttributeBinding::create(Mesh* mesh, const VertexF
         else
         {
             void* pointer = vertexPointer ? (void*)(((unsigned char*)vertexPointer) + offset) : (void*)offset;
-            b->setVertexAttribPointer(attrib, (GLint)e.size, GL_FLOAT, GL_FALSE, (GLsizei)vertexFormat.getVertexSize(), pointer);
+            b->setVertexAttribPointer(attrib, (GLint)e.size, getVertexAttribType(e.type), e.normalized ? GL_TRUE : GL_FALSE, (GLsizei)vertexFormat.getVertexSize(), pointer);
         }
 
-        offset += e.size * sizeof(float);
+        offset += e.getByteSize();
     }
 
     if (b->_handle)
     {
-        GL_ASSERT( glBindVertexArray(0) );
+        RenderState::bindVertexArray(0);
     }
 
     return b;
@@ -240,19 +282,19 @@ void VertexAttributeBinding::bind()
     if (_handle)
     {
         // Hardware mode
-        GL_ASSERT( glBindVertexArray(_handle) );
+        RenderState::bindVertexArray(_handle);
     }
     else
     {
         // Software mode
-        if (_mesh)
-        {
-            GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, _mesh->getVertexBuffer()) );
-        }
-        else
+#ifdef GP_USE_VAO
+        // Hardware VAOs are left bound after drawing, so make sure the default one is used.
+        if (glGenVertexArrays)
         {
-            GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, 0) );
+            RenderState::bindVertexArray(0);
         }
+#endif
+        RenderState::bindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
 
         GP_ASSERT(_attributes);
         for (unsigned int i = 0; i < __maxVertexAttribs; ++i)
@@ -271,15 +313,15 @@ void VertexAttributeBinding::unbind()
 {
     if (_handle)
     {
-        // Hardware mode
-        GL_ASSERT( glBindVertexArray(0) );
+        // Hardware mode: the VAO is left bound, since the next binding will replace it
+        // and rebinding the same VAO is skipped by the render state cache.
     }
     else
     {
         // Software mode
-        if (_mesh)
+        if (_vertexBuffer)
         {
-            GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, 0) );
+            RenderState::bindBuffer(GL_ARRAY_BUFFER, 0);
         }
 
         GP_ASSERT(_attributes);
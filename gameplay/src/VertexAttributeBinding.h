@@ -68,6 +68,22 @@ public:
      */
     static VertexAttributeBinding* create(const VertexFormat& vertexFormat, void* vertexPointer, Effect* effect);
 
+    /**
+     * Creates a new VertexAttributeBinding between vertices in a vertex buffer and an Effect.
+     *
+     * The vertices are read from the start of the vertex buffer, formatted as indicated in the
+     * specified vertexFormat parameter. The binding does not own the vertex buffer, which must
+     * stay alive for as long as the binding is used.
+     *
+     * @param vertexFormat The vertex format.
+     * @param vertexBuffer The handle of the vertex buffer.
+     * @param effect The effect.
+     *
+     * @return A VertexAttributeBinding for the requested parameters.
+     * @script{ignore}
+     */
+    static VertexAttributeBinding* createFromBuffer(const VertexFormat& vertexFormat, GLuint vertexBuffer, Effect* effect);
+
     /**
      * Binds this vertex array object.
      */
@@ -106,13 +122,14 @@ private:
      */
     VertexAttributeBinding& operator=(const VertexAttributeBinding&);
 
-    static VertexAttributeBinding* create(Mesh* mesh, const VertexFormat& vertexFormat, void* vertexPointer, Effect* effect);
+    static VertexAttributeBinding* create(Mesh* mesh, GLuint vertexBuffer, const VertexFormat& vertexFormat, void* vertexPointer, Effect* effect);
 
     void setVertexAttribPointer(GLuint indx, GLint size, GLenum type, GLboolean normalize, GLsizei stride, void* pointer);
 
     GLuint _handle;
     VertexAttribute* _attributes;
     Mesh* _mesh;
+    GLuint _vertexBuffer;
     Effect* _effect;
 };
 
@@ -17,7 +17,7 @@ VertexFormat::VertexFormat(const Element* elements, unsigned int elementCount)
         memcpy(&element, &elements[i], sizeof(Element));
         _elements.push_back(element);
 
-        _vertexSize += element.size * sizeof(float);
+        _vertexSize += element.getByteSize();
     }
 }
 
@@ -62,18 +62,118 @@ bool VertexFormat::operator != (const VertexFormat& f) const
 }
 
 VertexFormat::Element::Element() :
-    usage(POSITION), size(0)
+    usage(POSITION), size(0), type(FLOAT), normalized(false)
 {
 }
 
-VertexFormat::Element::Element(Usage usage, unsigned int size) :
-    usage(usage), size(size)
+VertexFormat::Element::Element(Usage usage, unsigned int size, Type type, bool normalized) :
+    usage(usage), size(size), type(type), normalized(normalized)
 {
 }
 
+unsigned int VertexFormat::Element::getByteSize() const
+{
+    switch (type)
+    {
+    case HALF_FLOAT:
+    case SHORT:
+    case UNSIGNED_SHORT:
+        return size * 2;
+    case BYTE:
+    case UNSIGNED_BYTE:
+        return size;
+    case INT_2_10_10_10_REV:
+        return 4;
+    default:
+        return size * sizeof(float);
+    }
+}
+
+// Converts a 16-bit half float to a float.
+static float halfToFloat(unsigned short half)
+{
+    unsigned int sign = (unsigned int)(half & 0x8000) << 16;
+    unsigned int exponent = (half >> 10) & 0x1F;
+    unsigned int mantissa = half & 0x3FF;
+    float value;
+    if (exponent == 0)
+    {
+        // Zero or denormalized.
+        value = ldexp((float)mantissa, -24);
+    }
+    else if (exponent == 31)
+    {
+        value = mantissa ? std::numeric_limits<float>::quiet_NaN() : std::numeric_limits<float>::infinity();
+    }
+    else
+    {
+        value = ldexp((float)(mantissa | 0x400), (int)exponent - 25);
+    }
+    return sign ? -value : value;
+}
+
+void VertexFormat::Element::decode(const void* data, float* values) const
+{
+    GP_ASSERT(data);
+    GP_ASSERT(values);
+
+    switch (type)
+    {
+    case HALF_FLOAT:
+        for (unsigned int i = 0; i < size; ++i)
+            values[i] = halfToFloat(((const unsigned short*)data)[i]);
+        break;
+    case BYTE:
+        for (unsigned int i = 0; i < size; ++i)
+        {
+            float value = ((const signed char*)data)[i];
+            values[i] = normalized ? std::max(value / 127.0f, -1.0f) : value;
+        }
+        break;
+    case UNSIGNED_BYTE:
+        for (unsigned int i = 0; i < size; ++i)
+        {
+            float value = ((const unsigned char*)data)[i];
+            values[i] = normalized ? value / 255.0f : value;
+        }
+        break;
+    case SHORT:
+        for (unsigned int i = 0; i < size; ++i)
+        {
+            float value = ((const short*)data)[i];
+            values[i] = normalized ? std::max(value / 32767.0f, -1.0f) : value;
+        }
+        break;
+    case UNSIGNED_SHORT:
+        for (unsigned int i = 0; i < size; ++i)
+        {
+            float value = ((const unsigned short*)data)[i];
+            values[i] = normalized ? value / 65535.0f : value;
+        }
+        break;
+    case INT_2_10_10_10_REV:
+        {
+            // Sign extend the three 10-bit values and the 2-bit value, from the lowest bits.
+            unsigned int packed;
+            memcpy(&packed, data, sizeof(unsigned int));
+            for (unsigned int i = 0; i < size && i < 4; ++i)
+            {
+                int bits = i < 3 ? 10 : 2;
+                int value = (int)(packed << (32 - bits - 10 * i)) >> (32 - bits);
+                float scale = (float)((1 << (bits - 1)) - 1);
+                values[i] = normalized ? std::max(value / scale, -1.0f) : (float)value;
+            }
+        }
+        break;
+    default:
+        memcpy(values, data, size * sizeof(float));
+        break;
+    }
+}
+
 bool VertexFormat::Element::operator == (const VertexFormat::Element& e) const
 {
-    return (size == e.size && usage == e.usage);
+    return (size == e.size && usage == e.usage && type == e.type && normalized == e.normalized);
 }
 
 bool VertexFormat::Element::operator != (const VertexFormat::Element& e) const
@@ -120,4 +220,27 @@ const char* VertexFormat::toString(Usage usage)
     }
 }
 
+const char* VertexFormat::toString(Type type)
+{
+    switch (type)
+    {
+    case FLOAT:
+        return "FLOAT";
+    case HALF_FLOAT:
+        return "HALF_FLOAT";
+    case BYTE:
+        return "BYTE";
+    case UNSIGNED_BYTE:
+        return "UNSIGNED_BYTE";
+    case SHORT:
+        return "SHORT";
+    case UNSIGNED_SHORT:
+        return "UNSIGNED_SHORT";
+    case INT_2_10_10_10_REV:
+        return "INT_2_10_10_10_REV";
+    default:
+        return "UNKNOWN";
+    }
+}
+
 }
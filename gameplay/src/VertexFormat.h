@@ -35,13 +35,35 @@ public:
         TEXCOORD7 = 15
     };
 
+    /**
+     * Defines the types of the values of vertex elements.
+     *
+     * Integer values that are normalized are mapped to [0, 1] (unsigned) or [-1, 1] (signed)
+     * when they are read by shaders, and other integer values are converted to floats as they are.
+     */
+    enum Type
+    {
+        FLOAT = 0,
+        HALF_FLOAT = 1,
+        BYTE = 2,
+        UNSIGNED_BYTE = 3,
+        SHORT = 4,
+        UNSIGNED_SHORT = 5,
+
+        /**
+         * Three signed 10-bit values and a signed 2-bit value packed into 32 bits, for elements
+         * of size 4.
+         */
+        INT_2_10_10_10_REV = 6
+    };
+
     /**
      * Defines a single element within a vertex format.
      *
-     * All vertex elements are assumed to be of type float, but can
-     * have a varying number of float values (1-4), which is represented
-     * by the size attribute. Additionally, vertex elements are assumed
-     * to be tightly packed.
+     * Vertex elements have a varying number of values (1-4), which is
+     * represented by the size attribute, and are floats unless they have
+     * a smaller type. Additionally, vertex elements are assumed to be
+     * tightly packed.
      */
     class Element
     {
@@ -56,6 +78,16 @@ public:
          */
         unsigned int size;
 
+        /**
+         * The type of the values in the vertex element.
+         */
+        Type type;
+
+        /**
+         * Whether the integer values in the vertex element are normalized.
+         */
+        bool normalized;
+
         /**
          * Constructor.
          */
@@ -65,9 +97,28 @@ public:
          * Constructor.
          *
          * @param usage The vertex element usage semantic.
-         * @param size The number of float values in the vertex element.
+         * @param size The number of values in the vertex element.
+         * @param type The type of the values in the vertex element.
+         * @param normalized Whether the integer values in the vertex element are normalized.
          */
-        Element(Usage usage, unsigned int size);
+        Element(Usage usage, unsigned int size, Type type = FLOAT, bool normalized = false);
+
+        /**
+         * Gets the size (in bytes) of the vertex element.
+         *
+         * @script{ignore}
+         */
+        unsigned int getByteSize() const;
+
+        /**
+         * Decodes the values of the vertex element to floats, the same way that they are read
+         * by shaders.
+         *
+         * @param data The data of the vertex element for a vertex.
+         * @param values Returns the values of the vertex element, as many as its size.
+         * @script{ignore}
+         */
+        void decode(const void* data, float* values) const;
 
         /**
          * Compares two vertex elements for equality.
@@ -145,6 +196,13 @@ public:
      */
     static const char* toString(Usage usage);
 
+    /**
+     * Returns a string representation of a Type enumeration value.
+     *
+     * @script{ignore}
+     */
+    static const char* toString(Type type);
+
 private:
 
     std::vector<Element> _elements;
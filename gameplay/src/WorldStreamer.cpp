@@ -0,0 +1,349 @@
+#include "Base.h"
+#include "WorldStreamer.h"
+#include "Properties.h"
+
+// The default distances from the camera at which cells are loaded and unloaded
+#define WORLD_DEFAULT_LOAD_DISTANCE 200.0f
+#define WORLD_DEFAULT_UNLOAD_DISTANCE 250.0f
+
+namespace gameplay
+{
+
+WorldStreamer::WorldStreamer(Scene* scene)
+    : _scene(scene), _loadDistance(WORLD_DEFAULT_LOAD_DISTANCE), _unloadDistance(WORLD_DEFAULT_UNLOAD_DISTANCE),
+      _memoryBudget(0), _memoryUsage(0), _concurrentLoads(1), _loadCount(0)
+{
+    GP_ASSERT(_scene);
+    _scene->addRef();
+}
+
+WorldStreamer::~WorldStreamer()
+{
+    unloadAll();
+    SAFE_RELEASE(_scene);
+}
+
+WorldStreamer* WorldStreamer::create(Scene* scene, const char* url)
+{
+    GP_ASSERT(scene);
+
+    WorldStreamer* streamer = new WorldStreamer(scene);
+    if (url && !streamer->loadCells(url))
+    {
+        SAFE_RELEASE(streamer);
+        return NULL;
+    }
+    return streamer;
+}
+
+bool WorldStreamer::loadCells(const char* url)
+{
+    std::unique_ptr<Properties> properties(Properties::create(url));
+    if (properties.get() == NULL)
+    {
+        GP_WARN("Failed to load world file '%s'.", url);
+        return false;
+    }
+
+    Properties* world = (strlen(properties->getNamespace()) > 0) ? properties.get() : properties->getNextNamespace();
+    if (world == NULL || strcmp(world->getNamespace(), "world") != 0)
+    {
+        GP_WARN("Failed to load world file '%s': missing the world namespace.", url);
+        return false;
+    }
+
+    float loadDistance = world->exists("loadDistance") ? world->getFloat("loadDistance") : _loadDistance;
+    float unloadDistance = world->exists("unloadDistance") ? world->getFloat("unloadDistance") : std::max(loadDistance, _unloadDistance);
+    setDistances(loadDistance, unloadDistance);
+    if (world->exists("memoryBudget"))
+        setMemoryBudget((size_t)std::max(0, world->getInt("memoryBudget")) * 1024 * 1024);
+    if (world->exists("concurrentLoads"))
+        setConcurrentLoads((unsigned int)std::max(1, world->getInt("concurrentLoads")));
+
+    Properties* ns;
+    while ((ns = world->getNextNamespace()) != NULL)
+    {
+        if (strcmp(ns->getNamespace(), "cell") != 0)
+        {
+            GP_WARN("Unsupported namespace '%s' in world file '%s'.", ns->getNamespace(), url);
+            continue;
+        }
+
+        Vector3 min, max;
+        const char* cellUrl = ns->getString("url");
+        if (cellUrl == NULL || !ns->getVector3("min", &min) || !ns->getVector3("max", &max))
+        {
+            GP_WARN("Cell '%s' of world file '%s' needs a url, a min and a max.", ns->getId(), url);
+            continue;
+        }
+        addCell(ns->getId(), cellUrl, BoundingBox(min, max), (size_t)std::max(0, ns->getInt("memory")) * 1024);
+    }
+    return true;
+}
+
+Scene* WorldStreamer::getScene() const
+{
+    return _scene;
+}
+
+unsigned int WorldStreamer::addCell(const char* id, const char* url, const BoundingBox& bounds, size_t memory)
+{
+    GP_ASSERT(url);
+
+    Cell cell;
+    cell.id = id ? id : "";
+    cell.url = url;
+    cell.bounds = bounds;
+    cell.memory = memory;
+    cell.state = UNLOADED;
+    cell.load = NULL;
+    cell.distance = 0.0f;
+    _cells.push_back(cell);
+    return (unsigned int)_cells.size() - 1;
+}
+
+unsigned int WorldStreamer::getCellCount() const
+{
+    return (unsigned int)_cells.size();
+}
+
+const char* WorldStreamer::getCellId(unsigned int cell) const
+{
+    GP_ASSERT(cell < _cells.size());
+    return _cells[cell].id.c_str();
+}
+
+const BoundingBox& WorldStreamer::getCellBounds(unsigned int cell) const
+{
+    GP_ASSERT(cell < _cells.size());
+    return _cells[cell].bounds;
+}
+
+WorldStreamer::CellState WorldStreamer::getCellState(unsigned int cell) const
+{
+    GP_ASSERT(cell < _cells.size());
+    return _cells[cell].state;
+}
+
+void WorldStreamer::setDistances(float loadDistance, float unloadDistance)
+{
+    _loadDistance = std::max(0.0f, loadDistance);
+    _unloadDistance = std::max(_loadDistance, unloadDistance);
+}
+
+float WorldStreamer::getLoadDistance() const
+{
+    return _loadDistance;
+}
+
+float WorldStreamer::getUnloadDistance() const
+{
+    return _unloadDistance;
+}
+
+void WorldStreamer::setMemoryBudget(size_t bytes)
+{
+    _memoryBudget = bytes;
+}
+
+size_t WorldStreamer::getMemoryBudget() const
+{
+    return _memoryBudget;
+}
+
+size_t WorldStreamer::getMemoryUsage() const
+{
+    return _memoryUsage;
+}
+
+void WorldStreamer::setConcurrentLoads(unsigned int count)
+{
+    _concurrentLoads = std::max(1u, count);
+}
+
+unsigned int WorldStreamer::getConcurrentLoads() const
+{
+    return _concurrentLoads;
+}
+
+void WorldStreamer::addListener(Listener* listener)
+{
+    GP_ASSERT(listener);
+    _listeners.push_back(listener);
+}
+
+void WorldStreamer::removeListener(Listener* listener)
+{
+    std::vector<Listener*>::iterator itr = std::find(_listeners.begin(), _listeners.end(), listener);
+    if (itr != _listeners.end())
+        _listeners.erase(itr);
+}
+
+Node* WorldStreamer::findNode(const char* id) const
+{
+    return _scene->findNode(id);
+}
+
+void WorldStreamer::update()
+{
+    Camera* camera = _scene->getActiveCamera();
+    if (camera && camera->getNode())
+        update(camera->getNode()->getTranslationWorld());
+}
+
+void WorldStreamer::update(const Vector3& position)
+{
+    // Unload the cells that the position has moved away from, including the ones still loading.
+    for (unsigned int i = 0, count = (unsigned int)_cells.size(); i < count; ++i)
+    {
+        Cell& cell = _cells[i];
+        cell.distance = getDistance(cell.bounds, position);
+        if ((cell.state == LOADING || cell.state == ACTIVE) && cell.distance > _unloadDistance)
+            unload(i);
+    }
+
+    // Activate one loaded cell per frame, so that adding the nodes of several cells to the scene
+    // does not fall on the same frame.
+    for (unsigned int i = 0, count = (unsigned int)_cells.size(); i < count; ++i)
+    {
+        if (_cells[i].state == LOADING && _cells[i].load->isFinished())
+        {
+            activate(i);
+            break;
+        }
+    }
+
+    // Start loading the nearest cells within the load distance.
+    _candidates.clear();
+    for (unsigned int i = 0, count = (unsigned int)_cells.size(); i < count; ++i)
+    {
+        if (_cells[i].state == UNLOADED && _cells[i].distance <= _loadDistance)
+            _candidates.push_back(i);
+    }
+    for (size_t i = 0; i < _candidates.size() && _loadCount < _concurrentLoads; ++i)
+    {
+        // Select the nearest of the remaining candidates.
+        for (size_t j = i + 1; j < _candidates.size(); ++j)
+        {
+            if (_cells[_candidates[j]].distance < _cells[_candidates[i]].distance)
+                std::swap(_candidates[i], _candidates[j]);
+        }
+        Cell& cell = _cells[_candidates[i]];
+
+        // Make room for the cell by unloading the cells that are farther away, the farthest first.
+        while (_memoryBudget > 0 && _memoryUsage + cell.memory > _memoryBudget)
+        {
+            int farthest = -1;
+            for (unsigned int j = 0, count = (unsigned int)_cells.size(); j < count; ++j)
+            {
+                const Cell& other = _cells[j];
+                if ((other.state == LOADING || other.state == ACTIVE) && other.distance > cell.distance &&
+                    (farthest < 0 || other.distance > _cells[farthest].distance))
+                {
+                    farthest = (int)j;
+                }
+            }
+            if (farthest < 0)
+                break;
+            unload((unsigned int)farthest);
+        }
+        if (_memoryBudget > 0 && _memoryUsage + cell.memory > _memoryBudget)
+            break;
+
+        cell.load = Scene::loadAsync(cell.url.c_str());
+        cell.state = LOADING;
+        _memoryUsage += cell.memory;
+        ++_loadCount;
+    }
+}
+
+void WorldStreamer::unloadAll()
+{
+    for (unsigned int i = 0, count = (unsigned int)_cells.size(); i < count; ++i)
+    {
+        if (_cells[i].state == LOADING || _cells[i].state == ACTIVE)
+            unload(i);
+    }
+}
+
+void WorldStreamer::activate(unsigned int index)
+{
+    Cell& cell = _cells[index];
+    GP_ASSERT(cell.state == LOADING && cell.load);
+
+    Scene* cellScene = cell.load->getScene();
+    --_loadCount;
+    if (cellScene == NULL)
+    {
+        GP_WARN("Failed to load cell '%s' from '%s'.", cell.id.c_str(), cell.url.c_str());
+        SAFE_RELEASE(cell.load);
+        cell.state = FAILED;
+        _memoryUsage -= cell.memory;
+        return;
+    }
+
+    // Move the top level nodes of the cell into the world scene, which removes them from the cell scene.
+    Node* node = cellScene->getFirstNode();
+    while (node)
+    {
+        Node* next = node->getNextSibling();
+        node->addRef();
+        cell.nodes.push_back(node);
+        _scene->addNode(node);
+        node = next;
+    }
+    SAFE_RELEASE(cell.load);
+    cell.state = ACTIVE;
+
+    fireEvent(Listener::CELL_ACTIVATED, index);
+}
+
+void WorldStreamer::unload(unsigned int index)
+{
+    Cell& cell = _cells[index];
+    if (cell.state == LOADING)
+    {
+        // Releasing the handle cancels the load, whose scene is released once it has finished.
+        SAFE_RELEASE(cell.load);
+        --_loadCount;
+    }
+    else if (cell.state == ACTIVE)
+    {
+        fireEvent(Listener::CELL_DEACTIVATED, index);
+
+        for (size_t i = 0, count = cell.nodes.size(); i < count; ++i)
+        {
+            Node* node = cell.nodes[i];
+            if (node->getParent())
+                node->getParent()->removeChild(node);
+            else if (node->getScene())
+                node->getScene()->removeNode(node);
+            SAFE_RELEASE(node);
+        }
+        cell.nodes.clear();
+    }
+    else
+    {
+        return;
+    }
+
+    cell.state = UNLOADED;
+    _memoryUsage -= cell.memory;
+}
+
+void WorldStreamer::fireEvent(Listener::EventType type, unsigned int cell)
+{
+    for (size_t i = 0; i < _listeners.size(); ++i)
+        _listeners[i]->cellEvent(type, this, cell);
+}
+
+float WorldStreamer::getDistance(const BoundingBox& bounds, const Vector3& position)
+{
+    // The distance to the nearest point of the bounds, which is 0 inside of them.
+    float dx = std::max(0.0f, std::max(bounds.min.x - position.x, position.x - bounds.max.x));
+    float dy = std::max(0.0f, std::max(bounds.min.y - position.y, position.y - bounds.max.y));
+    float dz = std::max(0.0f, std::max(bounds.min.z - position.z, position.z - bounds.max.z));
+    return sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+}
@@ -0,0 +1,333 @@
+#ifndef WORLDSTREAMER_H_
+#define WORLDSTREAMER_H_
+
+#include "Scene.h"
+#include "BoundingBox.h"
+
+namespace gameplay
+{
+
+/**
+ * Defines the streaming of a world that is split into spatial cells.
+ *
+ * Each cell of the world is stored in a '.scene' or '.gpb' file of its own, with the bounds of its
+ * nodes. The streamer loads the cells around the active camera of the world scene asynchronously
+ * (see Scene::loadAsync), so that the main thread work of the loads stays within the per-frame
+ * budget of asynchronous scene loads. Once a cell is loaded, its top level nodes are moved into the
+ * world scene, which activates them, and they are removed from it again when the cell is unloaded.
+ *
+ * Cells start loading when the camera comes within the load distance of their bounds, the nearest
+ * first, and are unloaded once it moves beyond the unload distance, which is larger so that cells
+ * on the edge of the load distance are not loaded and unloaded repeatedly. When loading a cell would
+ * exceed the memory budget, the loaded cells that are farther from the camera are unloaded first.
+ *
+ * The cells are described in a '.world' properties file, where the memory of each cell is the
+ * estimate, in kilobytes, that is counted against the budget (in megabytes):
+ *
+ * @code
+ * world
+ * {
+ *     loadDistance = 200
+ *     unloadDistance = 250
+ *     memoryBudget = 256
+ *     concurrentLoads = 2
+ *
+ *     cell cell_0_0
+ *     {
+ *         url = res/world/cell_0_0.scene
+ *         min = 0, -10, 0
+ *         max = 100, 50, 100
+ *         memory = 8192
+ *     }
+ * }
+ * @endcode
+ *
+ * Nodes that refer to nodes of other cells should resolve them lazily with findNode, which only
+ * finds the nodes of cells that are active, and drop the pointers that they keep when the cells
+ * of those nodes are deactivated (see Listener).
+ *
+ * @script{ignore}
+ */
+class WorldStreamer : public Ref
+{
+public:
+
+    /**
+     * Defines the streaming states of a cell.
+     */
+    enum CellState
+    {
+        /** The cell is not loaded. */
+        UNLOADED,
+        /** The cell is being loaded. */
+        LOADING,
+        /** The nodes of the cell are in the world scene. */
+        ACTIVE,
+        /** The cell could not be loaded, and is not loaded again. */
+        FAILED
+    };
+
+    /**
+     * Defines an interface to be notified when cells are activated and deactivated.
+     */
+    class Listener
+    {
+    public:
+
+        /**
+         * The type of cell event.
+         */
+        enum EventType
+        {
+            /**
+             * Event fired after the nodes of a cell have been added to the world scene.
+             */
+            CELL_ACTIVATED,
+
+            /**
+             * Event fired before the nodes of a cell are removed from the world scene.
+             */
+            CELL_DEACTIVATED
+        };
+
+        /**
+         * Destructor.
+         */
+        virtual ~Listener() { }
+
+        /**
+         * Called when a cell is activated or deactivated.
+         *
+         * @param type The type of event.
+         * @param streamer The streamer of the cell.
+         * @param cell The index of the cell.
+         */
+        virtual void cellEvent(EventType type, WorldStreamer* streamer, unsigned int cell) = 0;
+    };
+
+    /**
+     * Creates a streamer that streams the cells into a world scene.
+     *
+     * @param scene The world scene, which the streamer keeps a reference to.
+     * @param url The URL of the '.world' file that describes the cells, or NULL to add the cells with addCell.
+     *
+     * @return The new streamer, or NULL if the file could not be loaded.
+     */
+    static WorldStreamer* create(Scene* scene, const char* url = NULL);
+
+    /**
+     * Returns the world scene that the cells are streamed into.
+     *
+     * @return The world scene.
+     */
+    Scene* getScene() const;
+
+    /**
+     * Adds a cell to the world.
+     *
+     * @param id The identifier of the cell.
+     * @param url The URL of the '.scene' or '.gpb' file of the cell.
+     * @param bounds The bounds of the nodes of the cell.
+     * @param memory The estimated memory of the cell, in bytes.
+     *
+     * @return The index of the cell.
+     */
+    unsigned int addCell(const char* id, const char* url, const BoundingBox& bounds, size_t memory = 0);
+
+    /**
+     * Returns the number of cells of the world.
+     *
+     * @return The number of cells.
+     */
+    unsigned int getCellCount() const;
+
+    /**
+     * Returns the identifier of a cell.
+     *
+     * @param cell The index of the cell.
+     *
+     * @return The identifier of the cell.
+     */
+    const char* getCellId(unsigned int cell) const;
+
+    /**
+     * Returns the bounds of a cell.
+     *
+     * @param cell The index of the cell.
+     *
+     * @return The bounds of the cell.
+     */
+    const BoundingBox& getCellBounds(unsigned int cell) const;
+
+    /**
+     * Returns the streaming state of a cell.
+     *
+     * @param cell The index of the cell.
+     *
+     * @return The state of the cell.
+     */
+    CellState getCellState(unsigned int cell) const;
+
+    /**
+     * Sets the distances from the camera at which cells are loaded and unloaded.
+     *
+     * @param loadDistance The distance within which cells are loaded.
+     * @param unloadDistance The distance beyond which cells are unloaded, which is at least the load distance.
+     */
+    void setDistances(float loadDistance, float unloadDistance);
+
+    /**
+     * Returns the distance from the camera within which cells are loaded.
+     *
+     * @return The load distance.
+     */
+    float getLoadDistance() const;
+
+    /**
+     * Returns the distance from the camera beyond which cells are unloaded.
+     *
+     * @return The unload distance.
+     */
+    float getUnloadDistance() const;
+
+    /**
+     * Sets the memory budget of the cells that are loaded or being loaded.
+     *
+     * @param bytes The estimated memory that the cells may use, or 0 for no limit.
+     */
+    void setMemoryBudget(size_t bytes);
+
+    /**
+     * Returns the memory budget of the cells that are loaded or being loaded.
+     *
+     * @return The memory budget in bytes, or 0 if there is no limit.
+     */
+    size_t getMemoryBudget() const;
+
+    /**
+     * Returns the estimated memory of the cells that are loaded or being loaded.
+     *
+     * @return The memory in bytes.
+     */
+    size_t getMemoryUsage() const;
+
+    /**
+     * Sets the number of cells that may be loading at the same time.
+     *
+     * @param count The number of concurrent loads, which is at least 1.
+     */
+    void setConcurrentLoads(unsigned int count);
+
+    /**
+     * Returns the number of cells that may be loading at the same time.
+     *
+     * @return The number of concurrent loads.
+     */
+    unsigned int getConcurrentLoads() const;
+
+    /**
+     * Adds a listener to be notified when cells are activated and deactivated.
+     *
+     * @param listener The listener.
+     */
+    void addListener(Listener* listener);
+
+    /**
+     * Removes a listener.
+     *
+     * @param listener The listener.
+     */
+    void removeListener(Listener* listener);
+
+    /**
+     * Returns the first node of the world scene with the given ID, which includes the nodes of the active cells.
+     *
+     * @param id The ID of the node.
+     *
+     * @return The node, or NULL if the world scene has no node with the ID.
+     */
+    Node* findNode(const char* id) const;
+
+    /**
+     * Streams the cells around the active camera of the world scene.
+     *
+     * This should be called once per frame, from the update of the game.
+     */
+    void update();
+
+    /**
+     * Streams the cells around a position.
+     *
+     * This should be called once per frame, from the update of the game.
+     *
+     * @param position The position, in world space, to stream the cells around.
+     */
+    void update(const Vector3& position);
+
+    /**
+     * Unloads all of the cells.
+     */
+    void unloadAll();
+
+private:
+
+    /**
+     * A cell of the world.
+     */
+    struct Cell
+    {
+        std::string id;
+        std::string url;
+        BoundingBox bounds;
+        size_t memory;
+        CellState state;
+        Scene::AsyncLoad* load;
+        std::vector<Node*> nodes;
+        float distance;
+    };
+
+    /**
+     * Constructor.
+     */
+    WorldStreamer(Scene* scene);
+
+    /**
+     * Destructor.
+     */
+    ~WorldStreamer();
+
+    /**
+     * Hidden copy constructor.
+     */
+    WorldStreamer(const WorldStreamer& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    WorldStreamer& operator=(const WorldStreamer&);
+
+    bool loadCells(const char* url);
+
+    void activate(unsigned int cell);
+
+    void unload(unsigned int cell);
+
+    void fireEvent(Listener::EventType type, unsigned int cell);
+
+    static float getDistance(const BoundingBox& bounds, const Vector3& position);
+
+    Scene* _scene;
+    std::vector<Cell> _cells;
+    std::vector<unsigned int> _candidates;
+    std::vector<Listener*> _listeners;
+    float _loadDistance;
+    float _unloadDistance;
+    size_t _memoryBudget;
+    size_t _memoryUsage;
+    unsigned int _concurrentLoads;
+    unsigned int _loadCount;
+};
+
+}
+
+#endif
@@ -0,0 +1,25 @@
+#ifdef GP_HEADLESS
+
+#include "gameplay.h"
+
+using namespace gameplay;
+
+extern int __headlessArgc;
+extern char** __headlessArgv;
+
+/**
+ * Main entry point.
+ */
+int main(int argc, char** argv)
+{
+    __headlessArgc = argc;
+    __headlessArgv = argv;
+    Game* game = Game::getInstance();
+    Platform* platform = Platform::create(game);
+    GP_ASSERT(platform);
+    int result = platform->enterMessagePump();
+    delete platform;
+    return result;
+}
+
+#endif
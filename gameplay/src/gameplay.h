@@ -11,6 +11,12 @@
 #include "Bundle.h"
 #include "MathUtil.h"
 #include "Logger.h"
+#include "JobSystem.h"
+#include "MemoryPool.h"
+#include "StringId.h"
+#include "FrameArena.h"
+#include "TimerWheel.h"
+#include "Profiler.h"
 
 // Math
 #include "Rectangle.h"
@@ -19,6 +25,7 @@
 #include "Vector4.h"
 #include "Quaternion.h"
 #include "Matrix.h"
+#include "Matrix34.h"
 #include "Transform.h"
 #include "Ray.h"
 #include "Plane.h"
@@ -26,30 +33,63 @@
 #include "BoundingSphere.h"
 #include "BoundingBox.h"
 #include "Curve.h"
+#include "RadixSort.h"
 
 // Graphics
 #include "Image.h"
 #include "Texture.h"
+#include "ResourceCache.h"
+#include "TextureStreamer.h"
+#include "MeshStreamer.h"
 #include "Mesh.h"
+#include "MeshGeometry.h"
 #include "MeshPart.h"
 #include "Effect.h"
 #include "Material.h"
 #include "RenderState.h"
+#include "GraphicsDevice.h"
 #include "VertexFormat.h"
 #include "VertexAttributeBinding.h"
 #include "Drawable.h"
 #include "Model.h"
+#include "InstancedModel.h"
+#include "Impostor.h"
+#include "InstancedSprite.h"
 #include "Camera.h"
 #include "Light.h"
+#include "LightClusters.h"
 #include "Node.h"
 #include "Joint.h"
 #include "Scene.h"
+#include "RenderQueue.h"
+#include "OcclusionBuffer.h"
+#include "PortalGraph.h"
+#include "ShadowMaps.h"
+#include "PlanarReflection.h"
+#include "DynamicResolution.h"
+#include "RenderTargetPool.h"
+#include "PostProcessChain.h"
+#include "RenderCommandList.h"
+#include "StaticBatch.h"
+#include "BufferAllocator.h"
+#include "TextureUploader.h"
+#include "ScriptWorker.h"
+#include "SceneReplicator.h"
+#include "SceneSnapshot.h"
+#include "WorldStreamer.h"
+#include "RenderStats.h"
+#include "MemoryStats.h"
+#include "SpatialIndex.h"
 #include "Font.h"
+#include "TextLayout.h"
+#include "GlyphCache.h"
 #include "SpriteBatch.h"
+#include "SpriteRenderer.h"
 #include "Sprite.h"
 #include "Text.h"
 #include "TileSet.h"
 #include "ParticleEmitter.h"
+#include "ParticleSystem.h"
 #include "FrameBuffer.h"
 #include "RenderTarget.h"
 #include "DepthStencilTarget.h"
@@ -89,6 +129,7 @@
 
 // AI
 #include "AIController.h"
+#include "AINavMesh.h"
 #include "AIAgent.h"
 #include "AIState.h"
 #include "AIStateMachine.h"
@@ -98,6 +139,7 @@
 #include "Control.h"
 #include "ControlFactory.h"
 #include "Container.h"
+#include "ListView.h"
 #include "Form.h"
 #include "Label.h"
 #include "Button.h"
@@ -258,7 +258,7 @@ int lua_BoundingBox_getCenter(lua_State* state)
                 if ((lua_type(state, 1) == LUA_TUSERDATA))
                 {
                     BoundingBox* instance = getInstance(state);
-                    void* returnPtr = (void*)new Vector3(instance->getCenter());
+                    void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getCenter());
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -546,7 +546,7 @@ int lua_BoundingBox_max(lua_State* state)
     }
     else
     {
-        void* returnPtr = (void*)new Vector3(instance->max);
+        void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->max);
         if (returnPtr)
         {
             gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -650,7 +650,7 @@ int lua_BoundingBox_min(lua_State* state)
     }
     else
     {
-        void* returnPtr = (void*)new Vector3(instance->min);
+        void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->min);
         if (returnPtr)
         {
             gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -212,7 +212,7 @@ int lua_BoundingSphere_center(lua_State* state)
     }
     else
     {
-        void* returnPtr = (void*)new Vector3(instance->center);
+        void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->center);
         if (returnPtr)
         {
             gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
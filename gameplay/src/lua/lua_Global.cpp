@@ -803,7 +803,23 @@ void luaRegister_lua_Global()
         gameplay::ScriptUtil::registerEnumValue(RenderState::CAMERA_WORLD_POSITION, "CAMERA_WORLD_POSITION", scopePath);
         gameplay::ScriptUtil::registerEnumValue(RenderState::CAMERA_VIEW_POSITION, "CAMERA_VIEW_POSITION", scopePath);
         gameplay::ScriptUtil::registerEnumValue(RenderState::MATRIX_PALETTE, "MATRIX_PALETTE", scopePath);
+        gameplay::ScriptUtil::registerEnumValue(RenderState::DUAL_QUATERNION_PALETTE, "DUAL_QUATERNION_PALETTE", scopePath);
         gameplay::ScriptUtil::registerEnumValue(RenderState::SCENE_AMBIENT_COLOR, "SCENE_AMBIENT_COLOR", scopePath);
+        gameplay::ScriptUtil::registerEnumValue(RenderState::POSITION_DECODE_SCALE, "POSITION_DECODE_SCALE", scopePath);
+        gameplay::ScriptUtil::registerEnumValue(RenderState::POSITION_DECODE_OFFSET, "POSITION_DECODE_OFFSET", scopePath);
+        gameplay::ScriptUtil::registerEnumValue(RenderState::POINT_LIGHT_COLOR, "POINT_LIGHT_COLOR", scopePath);
+        gameplay::ScriptUtil::registerEnumValue(RenderState::POINT_LIGHT_POSITION, "POINT_LIGHT_POSITION", scopePath);
+        gameplay::ScriptUtil::registerEnumValue(RenderState::POINT_LIGHT_RANGE_INVERSE, "POINT_LIGHT_RANGE_INVERSE", scopePath);
+        gameplay::ScriptUtil::registerEnumValue(RenderState::SPOT_LIGHT_COLOR, "SPOT_LIGHT_COLOR", scopePath);
+        gameplay::ScriptUtil::registerEnumValue(RenderState::SPOT_LIGHT_POSITION, "SPOT_LIGHT_POSITION", scopePath);
+        gameplay::ScriptUtil::registerEnumValue(RenderState::SPOT_LIGHT_DIRECTION, "SPOT_LIGHT_DIRECTION", scopePath);
+        gameplay::ScriptUtil::registerEnumValue(RenderState::SPOT_LIGHT_RANGE_INVERSE, "SPOT_LIGHT_RANGE_INVERSE", scopePath);
+        gameplay::ScriptUtil::registerEnumValue(RenderState::SPOT_LIGHT_INNER_ANGLE_COS, "SPOT_LIGHT_INNER_ANGLE_COS", scopePath);
+        gameplay::ScriptUtil::registerEnumValue(RenderState::SPOT_LIGHT_OUTER_ANGLE_COS, "SPOT_LIGHT_OUTER_ANGLE_COS", scopePath);
+        gameplay::ScriptUtil::registerEnumValue(RenderState::DIRECTIONAL_LIGHT_COLOR, "DIRECTIONAL_LIGHT_COLOR", scopePath);
+        gameplay::ScriptUtil::registerEnumValue(RenderState::DIRECTIONAL_LIGHT_DIRECTION, "DIRECTIONAL_LIGHT_DIRECTION", scopePath);
+        gameplay::ScriptUtil::registerEnumValue(RenderState::SPOT_LIGHT_SHADOW_MATRIX, "SPOT_LIGHT_SHADOW_MATRIX", scopePath);
+        gameplay::ScriptUtil::registerEnumValue(RenderState::POINT_LIGHT_SHADOW, "POINT_LIGHT_SHADOW", scopePath);
     }
 
     // Register enumeration RenderState::Blend.
@@ -990,6 +1006,7 @@ void luaRegister_lua_Global()
         scopePath.push_back("Texture");
         gameplay::ScriptUtil::registerEnumValue(Texture::TEXTURE_2D, "TEXTURE_2D", scopePath);
         gameplay::ScriptUtil::registerEnumValue(Texture::TEXTURE_CUBE, "TEXTURE_CUBE", scopePath);
+        gameplay::ScriptUtil::registerEnumValue(Texture::TEXTURE_2D_ARRAY, "TEXTURE_2D_ARRAY", scopePath);
     }
 
     // Register enumeration Texture::Wrap.
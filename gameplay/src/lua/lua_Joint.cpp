@@ -1065,7 +1065,7 @@ int lua_Joint_getActiveCameraTranslationView(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 Joint* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getActiveCameraTranslationView());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getActiveCameraTranslationView());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -1109,7 +1109,7 @@ int lua_Joint_getActiveCameraTranslationWorld(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 Joint* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getActiveCameraTranslationWorld());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getActiveCameraTranslationWorld());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -1402,7 +1402,7 @@ int lua_Joint_getBackVector(lua_State* state)
                 if ((lua_type(state, 1) == LUA_TUSERDATA))
                 {
                     Joint* instance = getInstance(state);
-                    void* returnPtr = (void*)new Vector3(instance->getBackVector());
+                    void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getBackVector());
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -1640,7 +1640,7 @@ int lua_Joint_getDownVector(lua_State* state)
                 if ((lua_type(state, 1) == LUA_TUSERDATA))
                 {
                     Joint* instance = getInstance(state);
-                    void* returnPtr = (void*)new Vector3(instance->getDownVector());
+                    void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getDownVector());
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -1799,7 +1799,7 @@ int lua_Joint_getForwardVector(lua_State* state)
                 if ((lua_type(state, 1) == LUA_TUSERDATA))
                 {
                     Joint* instance = getInstance(state);
-                    void* returnPtr = (void*)new Vector3(instance->getForwardVector());
+                    void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getForwardVector());
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -1868,7 +1868,7 @@ int lua_Joint_getForwardVectorView(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 Joint* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getForwardVectorView());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getForwardVectorView());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -1912,7 +1912,7 @@ int lua_Joint_getForwardVectorWorld(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 Joint* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getForwardVectorWorld());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getForwardVectorWorld());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -2213,7 +2213,7 @@ int lua_Joint_getLeftVector(lua_State* state)
                 if ((lua_type(state, 1) == LUA_TUSERDATA))
                 {
                     Joint* instance = getInstance(state);
-                    void* returnPtr = (void*)new Vector3(instance->getLeftVector());
+                    void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getLeftVector());
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -2583,7 +2583,7 @@ int lua_Joint_getRightVector(lua_State* state)
                 if ((lua_type(state, 1) == LUA_TUSERDATA))
                 {
                     Joint* instance = getInstance(state);
-                    void* returnPtr = (void*)new Vector3(instance->getRightVector());
+                    void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getRightVector());
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -2652,7 +2652,7 @@ int lua_Joint_getRightVectorWorld(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 Joint* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getRightVectorWorld());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getRightVectorWorld());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -3228,7 +3228,7 @@ int lua_Joint_getTranslationView(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 Joint* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getTranslationView());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getTranslationView());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -3272,7 +3272,7 @@ int lua_Joint_getTranslationWorld(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 Joint* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getTranslationWorld());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getTranslationWorld());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -3493,7 +3493,7 @@ int lua_Joint_getUpVector(lua_State* state)
                 if ((lua_type(state, 1) == LUA_TUSERDATA))
                 {
                     Joint* instance = getInstance(state);
-                    void* returnPtr = (void*)new Vector3(instance->getUpVector());
+                    void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getUpVector());
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -3562,7 +3562,7 @@ int lua_Joint_getUpVectorWorld(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 Joint* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getUpVectorWorld());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getUpVectorWorld());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -98,7 +98,7 @@ int lua_Matrix__gc(lua_State* state)
                 if (object->owns)
                 {
                     Matrix* instance = (Matrix*)object->instance;
-                    SAFE_DELETE(instance);
+                    gameplay::ScriptUtil::deleteValue(instance);
                 }
                 
                 return 0;
@@ -128,7 +128,7 @@ int lua_Matrix__init(lua_State* state)
     {
         case 0:
         {
-            void* returnPtr = ((void*)new Matrix());
+            void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Matrix))) Matrix());
             if (returnPtr)
             {
                 gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -154,7 +154,7 @@ int lua_Matrix__init(lua_State* state)
                     // Get parameter 1 off the stack.
                     gameplay::ScriptUtil::LuaArray<float> param1 = gameplay::ScriptUtil::getFloatPointer(1);
 
-                    void* returnPtr = ((void*)new Matrix(param1));
+                    void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Matrix))) Matrix(param1));
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -182,7 +182,7 @@ int lua_Matrix__init(lua_State* state)
                     if (!param1Valid)
                         break;
 
-                    void* returnPtr = ((void*)new Matrix(*param1));
+                    void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Matrix))) Matrix(*param1));
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -273,7 +273,7 @@ int lua_Matrix__init(lua_State* state)
                     // Get parameter 16 off the stack.
                     float param16 = (float)luaL_checknumber(state, 16);
 
-                    void* returnPtr = ((void*)new Matrix(param1, param2, param3, param4, param5, param6, param7, param8, param9, param10, param11, param12, param13, param14, param15, param16));
+                    void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Matrix))) Matrix(param1, param2, param3, param4, param5, param6, param7, param8, param9, param10, param11, param12, param13, param14, param15, param16));
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -1063,7 +1063,7 @@ int lua_Node_getActiveCameraTranslationView(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 Node* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getActiveCameraTranslationView());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getActiveCameraTranslationView());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -1107,7 +1107,7 @@ int lua_Node_getActiveCameraTranslationWorld(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 Node* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getActiveCameraTranslationWorld());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getActiveCameraTranslationWorld());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -1400,7 +1400,7 @@ int lua_Node_getBackVector(lua_State* state)
                 if ((lua_type(state, 1) == LUA_TUSERDATA))
                 {
                     Node* instance = getInstance(state);
-                    void* returnPtr = (void*)new Vector3(instance->getBackVector());
+                    void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getBackVector());
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -1638,7 +1638,7 @@ int lua_Node_getDownVector(lua_State* state)
                 if ((lua_type(state, 1) == LUA_TUSERDATA))
                 {
                     Node* instance = getInstance(state);
-                    void* returnPtr = (void*)new Vector3(instance->getDownVector());
+                    void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getDownVector());
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -1797,7 +1797,7 @@ int lua_Node_getForwardVector(lua_State* state)
                 if ((lua_type(state, 1) == LUA_TUSERDATA))
                 {
                     Node* instance = getInstance(state);
-                    void* returnPtr = (void*)new Vector3(instance->getForwardVector());
+                    void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getForwardVector());
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -1866,7 +1866,7 @@ int lua_Node_getForwardVectorView(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 Node* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getForwardVectorView());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getForwardVectorView());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -1910,7 +1910,7 @@ int lua_Node_getForwardVectorWorld(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 Node* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getForwardVectorWorld());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getForwardVectorWorld());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -2167,7 +2167,7 @@ int lua_Node_getLeftVector(lua_State* state)
                 if ((lua_type(state, 1) == LUA_TUSERDATA))
                 {
                     Node* instance = getInstance(state);
-                    void* returnPtr = (void*)new Vector3(instance->getLeftVector());
+                    void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getLeftVector());
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -2537,7 +2537,7 @@ int lua_Node_getRightVector(lua_State* state)
                 if ((lua_type(state, 1) == LUA_TUSERDATA))
                 {
                     Node* instance = getInstance(state);
-                    void* returnPtr = (void*)new Vector3(instance->getRightVector());
+                    void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getRightVector());
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -2606,7 +2606,7 @@ int lua_Node_getRightVectorWorld(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 Node* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getRightVectorWorld());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getRightVectorWorld());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -3182,7 +3182,7 @@ int lua_Node_getTranslationView(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 Node* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getTranslationView());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getTranslationView());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -3226,7 +3226,7 @@ int lua_Node_getTranslationWorld(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 Node* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getTranslationWorld());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getTranslationWorld());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -3447,7 +3447,7 @@ int lua_Node_getUpVector(lua_State* state)
                 if ((lua_type(state, 1) == LUA_TUSERDATA))
                 {
                     Node* instance = getInstance(state);
-                    void* returnPtr = (void*)new Vector3(instance->getUpVector());
+                    void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getUpVector());
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -3516,7 +3516,7 @@ int lua_Node_getUpVectorWorld(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 Node* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getUpVectorWorld());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getUpVectorWorld());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
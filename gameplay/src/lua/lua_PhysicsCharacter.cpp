@@ -281,7 +281,7 @@ int lua_PhysicsCharacter_getCurrentVelocity(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 PhysicsCharacter* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getCurrentVelocity());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getCurrentVelocity());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -213,7 +213,7 @@ int lua_PhysicsConstraint_static_centerOfMassMidpoint(lua_State* state)
                     lua_error(state);
                 }
 
-                void* returnPtr = (void*)new Vector3(PhysicsConstraint::centerOfMassMidpoint(param1, param2));
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(PhysicsConstraint::centerOfMassMidpoint(param1, param2));
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -275,7 +275,7 @@ int lua_PhysicsConstraint_static_getRotationOffset(lua_State* state)
                     lua_error(state);
                 }
 
-                void* returnPtr = (void*)new Quaternion(PhysicsConstraint::getRotationOffset(param1, *param2));
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Quaternion))) Quaternion(PhysicsConstraint::getRotationOffset(param1, *param2));
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -337,7 +337,7 @@ int lua_PhysicsConstraint_static_getTranslationOffset(lua_State* state)
                     lua_error(state);
                 }
 
-                void* returnPtr = (void*)new Vector3(PhysicsConstraint::getTranslationOffset(param1, *param2));
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(PhysicsConstraint::getTranslationOffset(param1, *param2));
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
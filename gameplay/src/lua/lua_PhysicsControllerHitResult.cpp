@@ -170,7 +170,7 @@ int lua_PhysicsControllerHitResult_normal(lua_State* state)
     }
     else
     {
-        void* returnPtr = (void*)new Vector3(instance->normal);
+        void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->normal);
         if (returnPtr)
         {
             gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -258,7 +258,7 @@ int lua_PhysicsControllerHitResult_point(lua_State* state)
     }
     else
     {
-        void* returnPtr = (void*)new Vector3(instance->point);
+        void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->point);
         if (returnPtr)
         {
             gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -521,7 +521,7 @@ int lua_PhysicsRigidBody_getAngularFactor(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 PhysicsRigidBody* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getAngularFactor());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getAngularFactor());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -565,7 +565,7 @@ int lua_PhysicsRigidBody_getAngularVelocity(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 PhysicsRigidBody* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getAngularVelocity());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getAngularVelocity());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -609,7 +609,7 @@ int lua_PhysicsRigidBody_getAnisotropicFriction(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 PhysicsRigidBody* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getAnisotropicFriction());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getAnisotropicFriction());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -732,7 +732,7 @@ int lua_PhysicsRigidBody_getGravity(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 PhysicsRigidBody* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getGravity());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getGravity());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -854,7 +854,7 @@ int lua_PhysicsRigidBody_getLinearFactor(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 PhysicsRigidBody* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getLinearFactor());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getLinearFactor());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -898,7 +898,7 @@ int lua_PhysicsRigidBody_getLinearVelocity(lua_State* state)
             if ((lua_type(state, 1) == LUA_TUSERDATA))
             {
                 PhysicsRigidBody* instance = getInstance(state);
-                void* returnPtr = (void*)new Vector3(instance->getLinearVelocity());
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->getLinearVelocity());
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -625,7 +625,7 @@ int lua_PhysicsRigidBodyParameters_angularFactor(lua_State* state)
     }
     else
     {
-        void* returnPtr = (void*)new Vector3(instance->angularFactor);
+        void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->angularFactor);
         if (returnPtr)
         {
             gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -669,7 +669,7 @@ int lua_PhysicsRigidBodyParameters_anisotropicFriction(lua_State* state)
     }
     else
     {
-        void* returnPtr = (void*)new Vector3(instance->anisotropicFriction);
+        void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->anisotropicFriction);
         if (returnPtr)
         {
             gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -800,7 +800,7 @@ int lua_PhysicsRigidBodyParameters_linearFactor(lua_State* state)
     }
     else
     {
-        void* returnPtr = (void*)new Vector3(instance->linearFactor);
+        void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(instance->linearFactor);
         if (returnPtr)
         {
             gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
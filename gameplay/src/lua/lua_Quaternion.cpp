@@ -69,7 +69,7 @@ int lua_Quaternion__gc(lua_State* state)
                 if (object->owns)
                 {
                     Quaternion* instance = (Quaternion*)object->instance;
-                    SAFE_DELETE(instance);
+                    gameplay::ScriptUtil::deleteValue(instance);
                 }
                 
                 return 0;
@@ -99,7 +99,7 @@ int lua_Quaternion__init(lua_State* state)
     {
         case 0:
         {
-            void* returnPtr = ((void*)new Quaternion());
+            void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Quaternion))) Quaternion());
             if (returnPtr)
             {
                 gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -125,7 +125,7 @@ int lua_Quaternion__init(lua_State* state)
                     // Get parameter 1 off the stack.
                     gameplay::ScriptUtil::LuaArray<float> param1 = gameplay::ScriptUtil::getFloatPointer(1);
 
-                    void* returnPtr = ((void*)new Quaternion(param1));
+                    void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Quaternion))) Quaternion(param1));
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -153,7 +153,7 @@ int lua_Quaternion__init(lua_State* state)
                     if (!param1Valid)
                         break;
 
-                    void* returnPtr = ((void*)new Quaternion(*param1));
+                    void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Quaternion))) Quaternion(*param1));
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -181,7 +181,7 @@ int lua_Quaternion__init(lua_State* state)
                     if (!param1Valid)
                         break;
 
-                    void* returnPtr = ((void*)new Quaternion(*param1));
+                    void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Quaternion))) Quaternion(*param1));
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -219,7 +219,7 @@ int lua_Quaternion__init(lua_State* state)
                     // Get parameter 2 off the stack.
                     float param2 = (float)luaL_checknumber(state, 2);
 
-                    void* returnPtr = ((void*)new Quaternion(*param1, param2));
+                    void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Quaternion))) Quaternion(*param1, param2));
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -262,7 +262,7 @@ int lua_Quaternion__init(lua_State* state)
                     // Get parameter 4 off the stack.
                     float param4 = (float)luaL_checknumber(state, 4);
 
-                    void* returnPtr = ((void*)new Quaternion(param1, param2, param3, param4));
+                    void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Quaternion))) Quaternion(param1, param2, param3, param4));
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
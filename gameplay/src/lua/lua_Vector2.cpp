@@ -75,7 +75,7 @@ int lua_Vector2__gc(lua_State* state)
                 if (object->owns)
                 {
                     Vector2* instance = (Vector2*)object->instance;
-                    SAFE_DELETE(instance);
+                    gameplay::ScriptUtil::deleteValue(instance);
                 }
                 
                 return 0;
@@ -105,7 +105,7 @@ int lua_Vector2__init(lua_State* state)
     {
         case 0:
         {
-            void* returnPtr = ((void*)new Vector2());
+            void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector2))) Vector2());
             if (returnPtr)
             {
                 gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -131,7 +131,7 @@ int lua_Vector2__init(lua_State* state)
                     // Get parameter 1 off the stack.
                     gameplay::ScriptUtil::LuaArray<float> param1 = gameplay::ScriptUtil::getFloatPointer(1);
 
-                    void* returnPtr = ((void*)new Vector2(param1));
+                    void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector2))) Vector2(param1));
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -159,7 +159,7 @@ int lua_Vector2__init(lua_State* state)
                     if (!param1Valid)
                         break;
 
-                    void* returnPtr = ((void*)new Vector2(*param1));
+                    void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector2))) Vector2(*param1));
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -194,7 +194,7 @@ int lua_Vector2__init(lua_State* state)
                     // Get parameter 2 off the stack.
                     float param2 = (float)luaL_checknumber(state, 2);
 
-                    void* returnPtr = ((void*)new Vector2(param1, param2));
+                    void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector2))) Vector2(param1, param2));
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -229,7 +229,7 @@ int lua_Vector2__init(lua_State* state)
                     if (!param2Valid)
                         break;
 
-                    void* returnPtr = ((void*)new Vector2(*param1, *param2));
+                    void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector2))) Vector2(*param1, *param2));
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -80,7 +80,7 @@ int lua_Vector3__gc(lua_State* state)
                 if (object->owns)
                 {
                     Vector3* instance = (Vector3*)object->instance;
-                    SAFE_DELETE(instance);
+                    gameplay::ScriptUtil::deleteValue(instance);
                 }
                 
                 return 0;
@@ -110,7 +110,7 @@ int lua_Vector3__init(lua_State* state)
     {
         case 0:
         {
-            void* returnPtr = ((void*)new Vector3());
+            void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3());
             if (returnPtr)
             {
                 gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -136,7 +136,7 @@ int lua_Vector3__init(lua_State* state)
                     // Get parameter 1 off the stack.
                     gameplay::ScriptUtil::LuaArray<float> param1 = gameplay::ScriptUtil::getFloatPointer(1);
 
-                    void* returnPtr = ((void*)new Vector3(param1));
+                    void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(param1));
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -164,7 +164,7 @@ int lua_Vector3__init(lua_State* state)
                     if (!param1Valid)
                         break;
 
-                    void* returnPtr = ((void*)new Vector3(*param1));
+                    void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(*param1));
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -205,7 +205,7 @@ int lua_Vector3__init(lua_State* state)
                     if (!param2Valid)
                         break;
 
-                    void* returnPtr = ((void*)new Vector3(*param1, *param2));
+                    void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(*param1, *param2));
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -244,7 +244,7 @@ int lua_Vector3__init(lua_State* state)
                     // Get parameter 3 off the stack.
                     float param3 = (float)luaL_checknumber(state, 3);
 
-                    void* returnPtr = ((void*)new Vector3(param1, param2, param3));
+                    void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(param1, param2, param3));
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -1304,7 +1304,7 @@ int lua_Vector3_static_fromColor(lua_State* state)
                 // Get parameter 1 off the stack.
                 unsigned int param1 = (unsigned int)luaL_checkunsigned(state, 1);
 
-                void* returnPtr = (void*)new Vector3(Vector3::fromColor(param1));
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector3))) Vector3(Vector3::fromColor(param1));
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -78,7 +78,7 @@ int lua_Vector4__gc(lua_State* state)
                 if (object->owns)
                 {
                     Vector4* instance = (Vector4*)object->instance;
-                    SAFE_DELETE(instance);
+                    gameplay::ScriptUtil::deleteValue(instance);
                 }
                 
                 return 0;
@@ -108,7 +108,7 @@ int lua_Vector4__init(lua_State* state)
     {
         case 0:
         {
-            void* returnPtr = ((void*)new Vector4());
+            void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector4))) Vector4());
             if (returnPtr)
             {
                 gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -134,7 +134,7 @@ int lua_Vector4__init(lua_State* state)
                     // Get parameter 1 off the stack.
                     gameplay::ScriptUtil::LuaArray<float> param1 = gameplay::ScriptUtil::getFloatPointer(1);
 
-                    void* returnPtr = ((void*)new Vector4(param1));
+                    void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector4))) Vector4(param1));
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -162,7 +162,7 @@ int lua_Vector4__init(lua_State* state)
                     if (!param1Valid)
                         break;
 
-                    void* returnPtr = ((void*)new Vector4(*param1));
+                    void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector4))) Vector4(*param1));
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -203,7 +203,7 @@ int lua_Vector4__init(lua_State* state)
                     if (!param2Valid)
                         break;
 
-                    void* returnPtr = ((void*)new Vector4(*param1, *param2));
+                    void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector4))) Vector4(*param1, *param2));
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -246,7 +246,7 @@ int lua_Vector4__init(lua_State* state)
                     // Get parameter 4 off the stack.
                     float param4 = (float)luaL_checknumber(state, 4);
 
-                    void* returnPtr = ((void*)new Vector4(param1, param2, param3, param4));
+                    void* returnPtr = ((void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector4))) Vector4(param1, param2, param3, param4));
                     if (returnPtr)
                     {
                         gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
@@ -1158,7 +1158,7 @@ int lua_Vector4_static_fromColor(lua_State* state)
                 // Get parameter 1 off the stack.
                 unsigned int param1 = (unsigned int)luaL_checkunsigned(state, 1);
 
-                void* returnPtr = (void*)new Vector4(Vector4::fromColor(param1));
+                void* returnPtr = (void*)new (gameplay::ScriptUtil::allocateValue(sizeof(Vector4))) Vector4(Vector4::fromColor(param1));
                 if (returnPtr)
                 {
                     gameplay::ScriptUtil::LuaObject* object = (gameplay::ScriptUtil::LuaObject*)lua_newuserdata(state, sizeof(gameplay::ScriptUtil::LuaObject));
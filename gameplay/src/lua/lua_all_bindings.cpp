@@ -1,5 +1,6 @@
 // Autogenerated by gameplay-luagen
 #include "Base.h"
+#include "ScriptController.h"
 #include "lua_all_bindings.h"
 
 namespace gameplay
@@ -7,138 +8,138 @@ namespace gameplay
 
 void lua_RegisterAllBindings()
 {
-    luaRegister_AIAgent();
-    luaRegister_AIAgentListener();
-    luaRegister_AIController();
-    luaRegister_AIMessage();
-    luaRegister_AIState();
-    luaRegister_AIStateListener();
-    luaRegister_AIStateMachine();
-    luaRegister_AbsoluteLayout();
-    luaRegister_Animation();
-    luaRegister_AnimationClip();
-    luaRegister_AnimationClipListener();
-    luaRegister_AnimationController();
-    luaRegister_AnimationTarget();
-    luaRegister_AnimationValue();
-    luaRegister_AudioBuffer();
-    luaRegister_AudioController();
-    luaRegister_AudioListener();
-    luaRegister_AudioSource();
-    luaRegister_BoundingBox();
-    luaRegister_BoundingSphere();
-    luaRegister_Bundle();
-    luaRegister_Button();
-    luaRegister_Camera();
-    luaRegister_CameraListener();
-    luaRegister_CheckBox();
-    luaRegister_Container();
-    luaRegister_Control();
-    luaRegister_ControlListener();
-    luaRegister_Curve();
-    luaRegister_DepthStencilTarget();
-    luaRegister_Drawable();
-    luaRegister_Effect();
-    luaRegister_FileSystem();
-    luaRegister_FlowLayout();
-    luaRegister_Font();
-    luaRegister_Form();
-    luaRegister_FrameBuffer();
-    luaRegister_Frustum();
-    luaRegister_Game();
-    luaRegister_Gamepad();
-    luaRegister_Gesture();
-    luaRegister_HeightField();
-    luaRegister_Image();
-    luaRegister_ImageControl();
-    luaRegister_Joint();
-    luaRegister_JoystickControl();
-    luaRegister_Keyboard();
-    luaRegister_Label();
-    luaRegister_Layout();
-    luaRegister_Light();
-    luaRegister_Logger();
-    luaRegister_Material();
-    luaRegister_MaterialParameter();
-    luaRegister_MathUtil();
-    luaRegister_Matrix();
-    luaRegister_Mesh();
-    luaRegister_MeshBatch();
-    luaRegister_MeshPart();
-    luaRegister_MeshSkin();
-    luaRegister_Model();
-    luaRegister_Mouse();
-    luaRegister_Node();
-    luaRegister_NodeCloneContext();
-    luaRegister_ParticleEmitter();
-    luaRegister_Pass();
-    luaRegister_PhysicsCharacter();
-    luaRegister_PhysicsCollisionObject();
-    luaRegister_PhysicsCollisionObjectCollisionListener();
-    luaRegister_PhysicsCollisionObjectCollisionPair();
-    luaRegister_PhysicsCollisionShape();
-    luaRegister_PhysicsCollisionShapeDefinition();
-    luaRegister_PhysicsConstraint();
-    luaRegister_PhysicsController();
-    luaRegister_PhysicsControllerHitFilter();
-    luaRegister_PhysicsControllerHitResult();
-    luaRegister_PhysicsControllerListener();
-    luaRegister_PhysicsFixedConstraint();
-    luaRegister_PhysicsGenericConstraint();
-    luaRegister_PhysicsGhostObject();
-    luaRegister_PhysicsHingeConstraint();
-    luaRegister_PhysicsRigidBody();
-    luaRegister_PhysicsRigidBodyParameters();
-    luaRegister_PhysicsSocketConstraint();
-    luaRegister_PhysicsSpringConstraint();
-    luaRegister_PhysicsVehicle();
-    luaRegister_PhysicsVehicleWheel();
-    luaRegister_Plane();
-    luaRegister_Platform();
-    luaRegister_Properties();
-    luaRegister_Quaternion();
-    luaRegister_RadioButton();
-    luaRegister_Ray();
-    luaRegister_Rectangle();
-    luaRegister_Ref();
-    luaRegister_RenderState();
-    luaRegister_RenderStateStateBlock();
-    luaRegister_RenderTarget();
-    luaRegister_Scene();
-    luaRegister_ScreenDisplayer();
-    luaRegister_Script();
-    luaRegister_ScriptController();
-    luaRegister_ScriptTarget();
-    luaRegister_ScriptTargetEvent();
-    luaRegister_ScriptTargetEventRegistry();
-    luaRegister_Slider();
-    luaRegister_Sprite();
-    luaRegister_SpriteBatch();
-    luaRegister_SpriteBatchSpriteVertex();
-    luaRegister_Technique();
-    luaRegister_Terrain();
-    luaRegister_TerrainPatch();
-    luaRegister_Text();
-    luaRegister_TextBox();
-    luaRegister_Texture();
-    luaRegister_TextureSampler();
-    luaRegister_Theme();
-    luaRegister_ThemeSideRegions();
-    luaRegister_ThemeStyle();
-    luaRegister_ThemeThemeImage();
-    luaRegister_ThemeUVs();
-    luaRegister_TileSet();
-    luaRegister_Touch();
-    luaRegister_Transform();
-    luaRegister_TransformListener();
-    luaRegister_Uniform();
-    luaRegister_Vector2();
-    luaRegister_Vector3();
-    luaRegister_Vector4();
-    luaRegister_VertexAttributeBinding();
-    luaRegister_VertexFormat();
-    luaRegister_VertexFormatElement();
-    luaRegister_VerticalLayout();
+    gameplay::ScriptUtil::registerClassLazy("AIAgent", luaRegister_AIAgent);
+    gameplay::ScriptUtil::registerClassLazy("AIAgentListener", luaRegister_AIAgentListener, "AIAgent");
+    gameplay::ScriptUtil::registerClassLazy("AIController", luaRegister_AIController);
+    gameplay::ScriptUtil::registerClassLazy("AIMessage", luaRegister_AIMessage);
+    gameplay::ScriptUtil::registerClassLazy("AIState", luaRegister_AIState);
+    gameplay::ScriptUtil::registerClassLazy("AIStateListener", luaRegister_AIStateListener, "AIState");
+    gameplay::ScriptUtil::registerClassLazy("AIStateMachine", luaRegister_AIStateMachine);
+    gameplay::ScriptUtil::registerClassLazy("AbsoluteLayout", luaRegister_AbsoluteLayout);
+    gameplay::ScriptUtil::registerClassLazy("Animation", luaRegister_Animation);
+    gameplay::ScriptUtil::registerClassLazy("AnimationClip", luaRegister_AnimationClip);
+    gameplay::ScriptUtil::registerClassLazy("AnimationClipListener", luaRegister_AnimationClipListener, "AnimationClip");
+    gameplay::ScriptUtil::registerClassLazy("AnimationController", luaRegister_AnimationController);
+    gameplay::ScriptUtil::registerClassLazy("AnimationTarget", luaRegister_AnimationTarget);
+    gameplay::ScriptUtil::registerClassLazy("AnimationValue", luaRegister_AnimationValue);
+    gameplay::ScriptUtil::registerClassLazy("AudioBuffer", luaRegister_AudioBuffer);
+    gameplay::ScriptUtil::registerClassLazy("AudioController", luaRegister_AudioController);
+    gameplay::ScriptUtil::registerClassLazy("AudioListener", luaRegister_AudioListener);
+    gameplay::ScriptUtil::registerClassLazy("AudioSource", luaRegister_AudioSource);
+    gameplay::ScriptUtil::registerClassLazy("BoundingBox", luaRegister_BoundingBox);
+    gameplay::ScriptUtil::registerClassLazy("BoundingSphere", luaRegister_BoundingSphere);
+    gameplay::ScriptUtil::registerClassLazy("Bundle", luaRegister_Bundle);
+    gameplay::ScriptUtil::registerClassLazy("Button", luaRegister_Button);
+    gameplay::ScriptUtil::registerClassLazy("Camera", luaRegister_Camera);
+    gameplay::ScriptUtil::registerClassLazy("CameraListener", luaRegister_CameraListener, "Camera");
+    gameplay::ScriptUtil::registerClassLazy("CheckBox", luaRegister_CheckBox);
+    gameplay::ScriptUtil::registerClassLazy("Container", luaRegister_Container);
+    gameplay::ScriptUtil::registerClassLazy("Control", luaRegister_Control);
+    gameplay::ScriptUtil::registerClassLazy("ControlListener", luaRegister_ControlListener, "Control");
+    gameplay::ScriptUtil::registerClassLazy("Curve", luaRegister_Curve);
+    gameplay::ScriptUtil::registerClassLazy("DepthStencilTarget", luaRegister_DepthStencilTarget);
+    gameplay::ScriptUtil::registerClassLazy("Drawable", luaRegister_Drawable);
+    gameplay::ScriptUtil::registerClassLazy("Effect", luaRegister_Effect);
+    gameplay::ScriptUtil::registerClassLazy("FileSystem", luaRegister_FileSystem);
+    gameplay::ScriptUtil::registerClassLazy("FlowLayout", luaRegister_FlowLayout);
+    gameplay::ScriptUtil::registerClassLazy("Font", luaRegister_Font);
+    gameplay::ScriptUtil::registerClassLazy("Form", luaRegister_Form);
+    gameplay::ScriptUtil::registerClassLazy("FrameBuffer", luaRegister_FrameBuffer);
+    gameplay::ScriptUtil::registerClassLazy("Frustum", luaRegister_Frustum);
+    gameplay::ScriptUtil::registerClassLazy("Game", luaRegister_Game);
+    gameplay::ScriptUtil::registerClassLazy("Gamepad", luaRegister_Gamepad);
+    gameplay::ScriptUtil::registerClassLazy("Gesture", luaRegister_Gesture);
+    gameplay::ScriptUtil::registerClassLazy("HeightField", luaRegister_HeightField);
+    gameplay::ScriptUtil::registerClassLazy("Image", luaRegister_Image);
+    gameplay::ScriptUtil::registerClassLazy("ImageControl", luaRegister_ImageControl);
+    gameplay::ScriptUtil::registerClassLazy("Joint", luaRegister_Joint);
+    gameplay::ScriptUtil::registerClassLazy("JoystickControl", luaRegister_JoystickControl);
+    gameplay::ScriptUtil::registerClassLazy("Keyboard", luaRegister_Keyboard);
+    gameplay::ScriptUtil::registerClassLazy("Label", luaRegister_Label);
+    gameplay::ScriptUtil::registerClassLazy("Layout", luaRegister_Layout);
+    gameplay::ScriptUtil::registerClassLazy("Light", luaRegister_Light);
+    gameplay::ScriptUtil::registerClassLazy("Logger", luaRegister_Logger);
+    gameplay::ScriptUtil::registerClassLazy("Material", luaRegister_Material);
+    gameplay::ScriptUtil::registerClassLazy("MaterialParameter", luaRegister_MaterialParameter);
+    gameplay::ScriptUtil::registerClassLazy("MathUtil", luaRegister_MathUtil);
+    gameplay::ScriptUtil::registerClassLazy("Matrix", luaRegister_Matrix);
+    gameplay::ScriptUtil::registerClassLazy("Mesh", luaRegister_Mesh);
+    gameplay::ScriptUtil::registerClassLazy("MeshBatch", luaRegister_MeshBatch);
+    gameplay::ScriptUtil::registerClassLazy("MeshPart", luaRegister_MeshPart);
+    gameplay::ScriptUtil::registerClassLazy("MeshSkin", luaRegister_MeshSkin);
+    gameplay::ScriptUtil::registerClassLazy("Model", luaRegister_Model);
+    gameplay::ScriptUtil::registerClassLazy("Mouse", luaRegister_Mouse);
+    gameplay::ScriptUtil::registerClassLazy("Node", luaRegister_Node);
+    gameplay::ScriptUtil::registerClassLazy("NodeCloneContext", luaRegister_NodeCloneContext);
+    gameplay::ScriptUtil::registerClassLazy("ParticleEmitter", luaRegister_ParticleEmitter);
+    gameplay::ScriptUtil::registerClassLazy("Pass", luaRegister_Pass);
+    gameplay::ScriptUtil::registerClassLazy("PhysicsCharacter", luaRegister_PhysicsCharacter);
+    gameplay::ScriptUtil::registerClassLazy("PhysicsCollisionObject", luaRegister_PhysicsCollisionObject);
+    gameplay::ScriptUtil::registerClassLazy("PhysicsCollisionObjectCollisionListener", luaRegister_PhysicsCollisionObjectCollisionListener, "PhysicsCollisionObject");
+    gameplay::ScriptUtil::registerClassLazy("PhysicsCollisionObjectCollisionPair", luaRegister_PhysicsCollisionObjectCollisionPair, "PhysicsCollisionObject");
+    gameplay::ScriptUtil::registerClassLazy("PhysicsCollisionShape", luaRegister_PhysicsCollisionShape);
+    gameplay::ScriptUtil::registerClassLazy("PhysicsCollisionShapeDefinition", luaRegister_PhysicsCollisionShapeDefinition, "PhysicsCollisionShape");
+    gameplay::ScriptUtil::registerClassLazy("PhysicsConstraint", luaRegister_PhysicsConstraint);
+    gameplay::ScriptUtil::registerClassLazy("PhysicsController", luaRegister_PhysicsController);
+    gameplay::ScriptUtil::registerClassLazy("PhysicsControllerHitFilter", luaRegister_PhysicsControllerHitFilter, "PhysicsController");
+    gameplay::ScriptUtil::registerClassLazy("PhysicsControllerHitResult", luaRegister_PhysicsControllerHitResult, "PhysicsController");
+    gameplay::ScriptUtil::registerClassLazy("PhysicsControllerListener", luaRegister_PhysicsControllerListener, "PhysicsController");
+    gameplay::ScriptUtil::registerClassLazy("PhysicsFixedConstraint", luaRegister_PhysicsFixedConstraint);
+    gameplay::ScriptUtil::registerClassLazy("PhysicsGenericConstraint", luaRegister_PhysicsGenericConstraint);
+    gameplay::ScriptUtil::registerClassLazy("PhysicsGhostObject", luaRegister_PhysicsGhostObject);
+    gameplay::ScriptUtil::registerClassLazy("PhysicsHingeConstraint", luaRegister_PhysicsHingeConstraint);
+    gameplay::ScriptUtil::registerClassLazy("PhysicsRigidBody", luaRegister_PhysicsRigidBody);
+    gameplay::ScriptUtil::registerClassLazy("PhysicsRigidBodyParameters", luaRegister_PhysicsRigidBodyParameters, "PhysicsRigidBody");
+    gameplay::ScriptUtil::registerClassLazy("PhysicsSocketConstraint", luaRegister_PhysicsSocketConstraint);
+    gameplay::ScriptUtil::registerClassLazy("PhysicsSpringConstraint", luaRegister_PhysicsSpringConstraint);
+    gameplay::ScriptUtil::registerClassLazy("PhysicsVehicle", luaRegister_PhysicsVehicle);
+    gameplay::ScriptUtil::registerClassLazy("PhysicsVehicleWheel", luaRegister_PhysicsVehicleWheel);
+    gameplay::ScriptUtil::registerClassLazy("Plane", luaRegister_Plane);
+    gameplay::ScriptUtil::registerClassLazy("Platform", luaRegister_Platform);
+    gameplay::ScriptUtil::registerClassLazy("Properties", luaRegister_Properties);
+    gameplay::ScriptUtil::registerClassLazy("Quaternion", luaRegister_Quaternion);
+    gameplay::ScriptUtil::registerClassLazy("RadioButton", luaRegister_RadioButton);
+    gameplay::ScriptUtil::registerClassLazy("Ray", luaRegister_Ray);
+    gameplay::ScriptUtil::registerClassLazy("Rectangle", luaRegister_Rectangle);
+    gameplay::ScriptUtil::registerClassLazy("Ref", luaRegister_Ref);
+    gameplay::ScriptUtil::registerClassLazy("RenderState", luaRegister_RenderState);
+    gameplay::ScriptUtil::registerClassLazy("RenderStateStateBlock", luaRegister_RenderStateStateBlock, "RenderState");
+    gameplay::ScriptUtil::registerClassLazy("RenderTarget", luaRegister_RenderTarget);
+    gameplay::ScriptUtil::registerClassLazy("Scene", luaRegister_Scene);
+    gameplay::ScriptUtil::registerClassLazy("ScreenDisplayer", luaRegister_ScreenDisplayer);
+    gameplay::ScriptUtil::registerClassLazy("Script", luaRegister_Script);
+    gameplay::ScriptUtil::registerClassLazy("ScriptController", luaRegister_ScriptController);
+    gameplay::ScriptUtil::registerClassLazy("ScriptTarget", luaRegister_ScriptTarget);
+    gameplay::ScriptUtil::registerClassLazy("ScriptTargetEvent", luaRegister_ScriptTargetEvent, "ScriptTarget");
+    gameplay::ScriptUtil::registerClassLazy("ScriptTargetEventRegistry", luaRegister_ScriptTargetEventRegistry, "ScriptTarget");
+    gameplay::ScriptUtil::registerClassLazy("Slider", luaRegister_Slider);
+    gameplay::ScriptUtil::registerClassLazy("Sprite", luaRegister_Sprite);
+    gameplay::ScriptUtil::registerClassLazy("SpriteBatch", luaRegister_SpriteBatch);
+    gameplay::ScriptUtil::registerClassLazy("SpriteBatchSpriteVertex", luaRegister_SpriteBatchSpriteVertex, "SpriteBatch");
+    gameplay::ScriptUtil::registerClassLazy("Technique", luaRegister_Technique);
+    gameplay::ScriptUtil::registerClassLazy("Terrain", luaRegister_Terrain);
+    gameplay::ScriptUtil::registerClassLazy("TerrainPatch", luaRegister_TerrainPatch);
+    gameplay::ScriptUtil::registerClassLazy("Text", luaRegister_Text);
+    gameplay::ScriptUtil::registerClassLazy("TextBox", luaRegister_TextBox);
+    gameplay::ScriptUtil::registerClassLazy("Texture", luaRegister_Texture);
+    gameplay::ScriptUtil::registerClassLazy("TextureSampler", luaRegister_TextureSampler, "Texture");
+    gameplay::ScriptUtil::registerClassLazy("Theme", luaRegister_Theme);
+    gameplay::ScriptUtil::registerClassLazy("ThemeSideRegions", luaRegister_ThemeSideRegions, "Theme");
+    gameplay::ScriptUtil::registerClassLazy("ThemeStyle", luaRegister_ThemeStyle, "Theme");
+    gameplay::ScriptUtil::registerClassLazy("ThemeThemeImage", luaRegister_ThemeThemeImage, "Theme");
+    gameplay::ScriptUtil::registerClassLazy("ThemeUVs", luaRegister_ThemeUVs, "Theme");
+    gameplay::ScriptUtil::registerClassLazy("TileSet", luaRegister_TileSet);
+    gameplay::ScriptUtil::registerClassLazy("Touch", luaRegister_Touch);
+    gameplay::ScriptUtil::registerClassLazy("Transform", luaRegister_Transform);
+    gameplay::ScriptUtil::registerClassLazy("TransformListener", luaRegister_TransformListener, "Transform");
+    gameplay::ScriptUtil::registerClassLazy("Uniform", luaRegister_Uniform);
+    gameplay::ScriptUtil::registerClassLazy("Vector2", luaRegister_Vector2);
+    gameplay::ScriptUtil::registerClassLazy("Vector3", luaRegister_Vector3);
+    gameplay::ScriptUtil::registerClassLazy("Vector4", luaRegister_Vector4);
+    gameplay::ScriptUtil::registerClassLazy("VertexAttributeBinding", luaRegister_VertexAttributeBinding);
+    gameplay::ScriptUtil::registerClassLazy("VertexFormat", luaRegister_VertexFormat);
+    gameplay::ScriptUtil::registerClassLazy("VertexFormatElement", luaRegister_VertexFormatElement, "VertexFormat");
+    gameplay::ScriptUtil::registerClassLazy("VerticalLayout", luaRegister_VerticalLayout);
     luaRegister_lua_Global();
 }
 
@@ -0,0 +1,6 @@
+NDK_TOOLCHAIN_VERSION := 4.8
+APP_CPPFLAGS += -std=c++11
+APP_STL      := gnustl_static
+APP_ABI      := armeabi-v7a x86
+APP_PLATFORM := android-16
+
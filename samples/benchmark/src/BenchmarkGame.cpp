@@ -0,0 +1,662 @@
+#include "BenchmarkGame.h"
+
+// Declare our game instance
+BenchmarkGame game;
+
+// The number of sprites drawn between the starts and finishes of the sprite batch,
+// which keeps the vertices of a batch addressable with 16-bit indices.
+#define SPRITES_PER_BATCH 4096
+
+// The number of particles of each emitter in the particles scenario.
+#define PARTICLES_PER_EMITTER 1000
+
+static const char* __scenarioNames[] = { "animation", "particles", "sprites", "physics", "form", "scene" };
+
+// The markers whose time each frame is written to the results.
+static const char* __cpuMarkers[] =
+{
+    "Game::frame",
+    "Game::update",
+    "Game::render",
+    "AnimationController::update",
+    "PhysicsController::update",
+    "AIController::update",
+    "Form::updateInternal",
+    "ParticleSystem::update"
+};
+static const char* __gpuMarkers[] = { "Game::render" };
+
+static const Vector4 __colors[] =
+{
+    Vector4(0.8f, 0.2f, 0.2f, 1.0f),
+    Vector4(0.2f, 0.8f, 0.2f, 1.0f),
+    Vector4(0.2f, 0.2f, 0.8f, 1.0f),
+    Vector4(0.8f, 0.8f, 0.2f, 1.0f),
+    Vector4(0.2f, 0.8f, 0.8f, 1.0f),
+    Vector4(0.8f, 0.2f, 0.8f, 1.0f),
+    Vector4(0.8f, 0.8f, 0.8f, 1.0f),
+    Vector4(0.8f, 0.5f, 0.2f, 1.0f)
+};
+
+static Mesh* createBoxMesh()
+{
+    float vertices[] =
+    {
+        -0.5f, -0.5f,  0.5f,    0.0f,  0.0f,  1.0f,
+         0.5f, -0.5f,  0.5f,    0.0f,  0.0f,  1.0f,
+        -0.5f,  0.5f,  0.5f,    0.0f,  0.0f,  1.0f,
+         0.5f,  0.5f,  0.5f,    0.0f,  0.0f,  1.0f,
+        -0.5f,  0.5f,  0.5f,    0.0f,  1.0f,  0.0f,
+         0.5f,  0.5f,  0.5f,    0.0f,  1.0f,  0.0f,
+        -0.5f,  0.5f, -0.5f,    0.0f,  1.0f,  0.0f,
+         0.5f,  0.5f, -0.5f,    0.0f,  1.0f,  0.0f,
+        -0.5f,  0.5f, -0.5f,    0.0f,  0.0f, -1.0f,
+         0.5f,  0.5f, -0.5f,    0.0f,  0.0f, -1.0f,
+        -0.5f, -0.5f, -0.5f,    0.0f,  0.0f, -1.0f,
+         0.5f, -0.5f, -0.5f,    0.0f,  0.0f, -1.0f,
+        -0.5f, -0.5f, -0.5f,    0.0f, -1.0f,  0.0f,
+         0.5f, -0.5f, -0.5f,    0.0f, -1.0f,  0.0f,
+        -0.5f, -0.5f,  0.5f,    0.0f, -1.0f,  0.0f,
+         0.5f, -0.5f,  0.5f,    0.0f, -1.0f,  0.0f,
+         0.5f, -0.5f,  0.5f,    1.0f,  0.0f,  0.0f,
+         0.5f, -0.5f, -0.5f,    1.0f,  0.0f,  0.0f,
+         0.5f,  0.5f,  0.5f,    1.0f,  0.0f,  0.0f,
+         0.5f,  0.5f, -0.5f,    1.0f,  0.0f,  0.0f,
+        -0.5f, -0.5f, -0.5f,   -1.0f,  0.0f,  0.0f,
+        -0.5f, -0.5f,  0.5f,   -1.0f,  0.0f,  0.0f,
+        -0.5f,  0.5f, -0.5f,   -1.0f,  0.0f,  0.0f,
+        -0.5f,  0.5f,  0.5f,   -1.0f,  0.0f,  0.0f
+    };
+    short indices[] =
+    {
+        0, 1, 2, 2, 1, 3, 4, 5, 6, 6, 5, 7, 8, 9, 10, 10, 9, 11, 12, 13, 14, 14, 13, 15, 16, 17, 18, 18, 17, 19, 20, 21, 22, 22, 21, 23
+    };
+    VertexFormat::Element elements[] =
+    {
+        VertexFormat::Element(VertexFormat::POSITION, 3),
+        VertexFormat::Element(VertexFormat::NORMAL, 3)
+    };
+    Mesh* mesh = Mesh::createMesh(VertexFormat(elements, 2), 24, false);
+    if (mesh == NULL)
+    {
+        GP_ERROR("Failed to create mesh.");
+        return NULL;
+    }
+    mesh->setVertexData(vertices, 0, 24);
+    MeshPart* meshPart = mesh->addPart(Mesh::TRIANGLES, Mesh::INDEX16, 36, false);
+    meshPart->setIndexData(indices, 0, 36);
+    mesh->setBoundingBox(BoundingBox(Vector3(-0.5f, -0.5f, -0.5f), Vector3(0.5f, 0.5f, 0.5f)));
+    return mesh;
+}
+
+static unsigned int getGridSize(unsigned int count)
+{
+    unsigned int size = (unsigned int)ceil(sqrt((double)count));
+    return size > 0 ? size : 1;
+}
+
+static float getPercentile(const std::vector<float>& sorted, float percentile)
+{
+    if (sorted.empty())
+        return 0.0f;
+    size_t index = (size_t)(percentile * (float)sorted.size());
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static void appendFormat(std::string& str, const char* format, ...)
+{
+    char buffer[256];
+    va_list arguments;
+    va_start(arguments, format);
+    vsnprintf(buffer, sizeof(buffer), format, arguments);
+    va_end(arguments);
+    buffer[sizeof(buffer) - 1] = '\0';
+    str += buffer;
+}
+
+BenchmarkGame::BenchmarkGame()
+    : _font(NULL), _scene(NULL), _lightNode(NULL), _rootNode(NULL), _boxMesh(NULL), _spriteBatch(NULL), _form(NULL),
+      _scenarioIndex(0), _frame(0), _warmupFrames(60), _measuredFrames(600), _frameTime(1000.0f / 60.0f), _seed(1), _random(1),
+      _count(0), _lastFrameTime(0.0)
+{
+}
+
+void BenchmarkGame::initialize()
+{
+    _font = Font::create("res/ui/arial.gpb");
+    _boxMesh = createBoxMesh();
+
+    Properties* config = getConfig()->getNamespace("benchmark", true);
+    if (config)
+    {
+        if (config->exists("warmupFrames"))
+            _warmupFrames = (unsigned int)config->getInt("warmupFrames");
+        if (config->exists("frames"))
+            _measuredFrames = (unsigned int)config->getInt("frames");
+        if (config->exists("frameTime"))
+            _frameTime = config->getFloat("frameTime");
+        if (config->exists("seed"))
+            _seed = (unsigned int)config->getInt("seed");
+        _sceneFile = config->getString("sceneFile", "");
+        _output = config->getString("output", "benchmark.json");
+
+        // Parse the comma separated list of the scenarios to run.
+        std::string scenarios = config->getString("scenarios", "");
+        size_t start = 0;
+        while (start < scenarios.size())
+        {
+            size_t end = scenarios.find(',', start);
+            if (end == std::string::npos)
+                end = scenarios.size();
+            std::string name = scenarios.substr(start, end - start);
+            name.erase(0, name.find_first_not_of(" \t"));
+            name.erase(name.find_last_not_of(" \t") + 1);
+            ScenarioType type;
+            if (parseScenario(name.c_str(), &type))
+                _scenarios.push_back(type);
+            else if (!name.empty())
+                GP_WARN("Unknown benchmark scenario '%s'.", name.c_str());
+            start = end + 1;
+        }
+    }
+    if (_scenarios.empty())
+    {
+        for (unsigned int i = 0; i < sizeof(__scenarioNames) / sizeof(__scenarioNames[0]); ++i)
+            _scenarios.push_back((ScenarioType)i);
+    }
+    if (_measuredFrames == 0)
+        _measuredFrames = 1;
+
+    // Update every frame by the same time, and don't wait for the display, so that each run does the
+    // same work as fast as the device can do it.
+    setVsync(false);
+    setFixedFrameTime(_frameTime);
+
+#ifndef GP_USE_PROFILER
+    GP_WARN("The profiler is not compiled in, so the time of the subsystems will not be measured.");
+#endif
+
+    _scenarioIndex = 0;
+    startScenario();
+}
+
+void BenchmarkGame::finalize()
+{
+    if (_scenarioIndex < _scenarios.size())
+        endScenario();
+    SAFE_RELEASE(_boxMesh);
+    SAFE_RELEASE(_font);
+}
+
+bool BenchmarkGame::parseScenario(const char* name, ScenarioType* type) const
+{
+    for (unsigned int i = 0; i < sizeof(__scenarioNames) / sizeof(__scenarioNames[0]); ++i)
+    {
+        if (strcmp(name, __scenarioNames[i]) == 0)
+        {
+            *type = (ScenarioType)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void BenchmarkGame::startScenario()
+{
+    GP_ASSERT(_scenarioIndex < _scenarios.size());
+
+    ScenarioType type = _scenarios[_scenarioIndex];
+    const char* name = __scenarioNames[type];
+    Properties* config = getConfig()->getNamespace("benchmark", true);
+    _count = config ? (unsigned int)config->getInt(name) : 0;
+
+    // Start each scenario from the same random numbers.
+    _random = _seed;
+    srand(_seed);
+
+    double setupStart = getAbsoluteTime();
+    switch (type)
+    {
+    case SCENARIO_ANIMATION:
+        setupAnimation(_count);
+        break;
+    case SCENARIO_PARTICLES:
+        setupParticles(_count);
+        break;
+    case SCENARIO_SPRITES:
+        setupSprites(_count);
+        break;
+    case SCENARIO_PHYSICS:
+        setupPhysics(_count);
+        break;
+    case SCENARIO_FORM:
+        setupForm(_count);
+        break;
+    case SCENARIO_SCENE:
+        setupScene(_count);
+        break;
+    }
+
+    Result result;
+    result.name = name;
+    result.count = _count;
+    result.setupTime = getAbsoluteTime() - setupStart;
+    result.frameTimes.reserve(_measuredFrames);
+    _results.push_back(result);
+
+    print("Benchmark: %s (%u), setup %.2f ms\n", name, _count, result.setupTime);
+
+    _frame = 0;
+    _lastFrameTime = getAbsoluteTime();
+}
+
+void BenchmarkGame::endScenario()
+{
+    Profiler::stopCapture();
+
+    Result& result = _results.back();
+    unsigned int frames = Profiler::getCapturedFrameCount();
+    if (frames > 0)
+    {
+        for (unsigned int i = 0; i < sizeof(__cpuMarkers) / sizeof(__cpuMarkers[0]); ++i)
+            result.cpuTimes.push_back(std::make_pair(std::string(__cpuMarkers[i]), Profiler::getCapturedTime(__cpuMarkers[i]) / frames));
+        if (Profiler::isGpuTimerSupported())
+        {
+            for (unsigned int i = 0; i < sizeof(__gpuMarkers) / sizeof(__gpuMarkers[0]); ++i)
+                result.gpuTimes.push_back(std::make_pair(std::string(__gpuMarkers[i]), Profiler::getCapturedTime(__gpuMarkers[i], true) / frames));
+        }
+    }
+    Profiler::clearCapture();
+    result.renderStats = getRenderStats();
+
+    getParticleSystem()->removeAllEmitters();
+    SAFE_RELEASE(_scene);
+    SAFE_DELETE(_spriteBatch);
+    SAFE_RELEASE(_form);
+    _lightNode = NULL;
+    _rootNode = NULL;
+}
+
+void BenchmarkGame::createScene(float distance)
+{
+    _scene = Scene::create();
+
+    Camera* camera = Camera::createPerspective(45.0f, getAspectRatio(), 1.0f, distance * 4.0f);
+    Node* cameraNode = _scene->addNode("camera");
+    cameraNode->setCamera(camera);
+    cameraNode->setTranslation(0.0f, distance * 0.5f, distance);
+    cameraNode->rotateX(-atan2(0.5f, 1.0f));
+    _scene->setActiveCamera(camera);
+    SAFE_RELEASE(camera);
+
+    Light* light = Light::createDirectional(0.75f, 0.75f, 0.75f);
+    _lightNode = _scene->addNode("light");
+    _lightNode->setLight(light);
+    _lightNode->rotateX(-MATH_PIOVER4);
+    _lightNode->rotateY(MATH_PIOVER4 * 0.5f);
+    SAFE_RELEASE(light);
+
+    _rootNode = _scene->addNode("root");
+}
+
+Model* BenchmarkGame::createBoxModel(const Vector4& color)
+{
+    GP_ASSERT(_boxMesh && _lightNode);
+
+    Model* model = Model::create(_boxMesh);
+    Material* material = model->setMaterial("res/shaders/colored.vert", "res/shaders/colored.frag", "DIRECTIONAL_LIGHT_COUNT 1");
+    material->setParameterAutoBinding("u_worldViewProjectionMatrix", "WORLD_VIEW_PROJECTION_MATRIX");
+    material->setParameterAutoBinding("u_inverseTransposeWorldViewMatrix", "INVERSE_TRANSPOSE_WORLD_VIEW_MATRIX");
+    material->getParameter("u_ambientColor")->setValue(Vector3(0.2f, 0.2f, 0.2f));
+    material->getParameter("u_diffuseColor")->setValue(color);
+    material->getParameter("u_directionalLightColor[0]")->setValue(_lightNode->getLight()->getColor());
+    material->getParameter("u_directionalLightDirection[0]")->bindValue(_lightNode, &Node::getForwardVectorWorld);
+    material->getStateBlock()->setCullFace(true);
+    material->getStateBlock()->setDepthTest(true);
+    material->getStateBlock()->setDepthWrite(true);
+    return model;
+}
+
+float BenchmarkGame::random()
+{
+    // A linear congruential generator, so that the numbers don't depend on the C library.
+    _random = _random * 1664525u + 1013904223u;
+    return (float)(_random >> 8) / 16777216.0f;
+}
+
+void BenchmarkGame::setupAnimation(unsigned int count)
+{
+    // Each character is a body with four limbs that swing back and forth at their own speed.
+    static const float limbs[4][3] = { { -0.7f, 0.4f, 0.0f }, { 0.7f, 0.4f, 0.0f }, { -0.3f, -0.9f, 0.0f }, { 0.3f, -0.9f, 0.0f } };
+
+    unsigned int size = getGridSize(count);
+    createScene(size * 3.0f);
+
+    Model* bodyModel = createBoxModel(__colors[0]);
+    Model* limbModel = createBoxModel(__colors[1]);
+
+    unsigned int keyTimes[] = { 0, 500, 1000 };
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        Node* character = _scene->addNode("character");
+        character->setTranslation(((i % size) - size * 0.5f) * 3.0f, 0.0f, ((i / size) - size * 0.5f) * 3.0f);
+
+        Node* body = Node::create("body");
+        body->setScale(1.0f, 1.5f, 0.5f);
+        body->setDrawable(bodyModel);
+        character->addChild(body);
+        SAFE_RELEASE(body);
+
+        for (unsigned int j = 0; j < 4; ++j)
+        {
+            Node* joint = Node::create("joint");
+            joint->setTranslation(limbs[j][0], limbs[j][1], limbs[j][2]);
+            character->addChild(joint);
+
+            Node* limb = Node::create("limb");
+            limb->setTranslation(0.0f, -0.5f, 0.0f);
+            limb->setScale(0.3f, 1.0f, 0.3f);
+            limb->setDrawable(limbModel);
+            joint->addChild(limb);
+            SAFE_RELEASE(limb);
+
+            Quaternion forward, backward;
+            Quaternion::createFromAxisAngle(Vector3::unitX(), (j % 2 ? 0.6f : -0.6f), &forward);
+            Quaternion::createFromAxisAngle(Vector3::unitX(), (j % 2 ? -0.6f : 0.6f), &backward);
+            float keyValues[] =
+            {
+                forward.x, forward.y, forward.z, forward.w,
+                backward.x, backward.y, backward.z, backward.w,
+                forward.x, forward.y, forward.z, forward.w
+            };
+            Animation* animation = joint->createAnimation("swing", Transform::ANIMATE_ROTATE, 3, keyTimes, keyValues, Curve::LINEAR);
+            AnimationClip* clip = animation->getClip();
+            clip->setRepeatCount(AnimationClip::REPEAT_INDEFINITE);
+            clip->setSpeed(0.5f + random());
+            clip->play();
+            SAFE_RELEASE(joint);
+        }
+    }
+
+    SAFE_RELEASE(bodyModel);
+    SAFE_RELEASE(limbModel);
+}
+
+void BenchmarkGame::setupParticles(unsigned int count)
+{
+    unsigned int emitterCount = (count + PARTICLES_PER_EMITTER - 1) / PARTICLES_PER_EMITTER;
+    unsigned int size = getGridSize(emitterCount);
+    createScene(size * 4.0f);
+
+    for (unsigned int i = 0; i < emitterCount; ++i)
+    {
+        ParticleEmitter* emitter = ParticleEmitter::create("res/logo_powered_white.png", ParticleEmitter::BLEND_ADDITIVE, PARTICLES_PER_EMITTER);
+        if (emitter == NULL)
+            break;
+
+        // Emit as many particles each second as each particle lives, to keep the emitter full.
+        emitter->setEmissionRate(PARTICLES_PER_EMITTER);
+        emitter->setEnergy(1000, 1000);
+        emitter->setSize(0.2f, 0.3f, 0.05f, 0.1f);
+        emitter->setVelocity(Vector3(0.0f, 2.0f, 0.0f), Vector3(1.0f + random(), 1.0f, 1.0f + random()));
+        emitter->start();
+
+        Node* node = _scene->addNode("emitter");
+        node->setTranslation(((i % size) - size * 0.5f) * 4.0f, 0.0f, ((i / size) - size * 0.5f) * 4.0f);
+        node->setDrawable(emitter);
+        getParticleSystem()->addEmitter(emitter);
+        SAFE_RELEASE(emitter);
+    }
+}
+
+void BenchmarkGame::setupSprites(unsigned int count)
+{
+    _spriteBatch = SpriteBatch::create("res/logo_powered_white.png", NULL, std::min(count, (unsigned int)SPRITES_PER_BATCH));
+}
+
+void BenchmarkGame::setupPhysics(unsigned int count)
+{
+    unsigned int size = getGridSize(count / 4 + 1);
+    createScene(size * 3.0f);
+
+    Model* groundModel = createBoxModel(__colors[6]);
+    Node* ground = _scene->addNode("ground");
+    ground->setScale(size * 2.0f + 4.0f, 1.0f, size * 2.0f + 4.0f);
+    ground->setTranslation(0.0f, -0.5f, 0.0f);
+    ground->setDrawable(groundModel);
+    PhysicsRigidBody::Parameters groundParameters(0.0f);
+    ground->setCollisionObject(PhysicsCollisionObject::RIGID_BODY, PhysicsCollisionShape::box(), &groundParameters);
+    SAFE_RELEASE(groundModel);
+
+    // Drop the boxes in layers of a grid, so that they fall onto each other.
+    Model* boxModel = createBoxModel(__colors[3]);
+    PhysicsRigidBody::Parameters boxParameters(1.0f);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        unsigned int layer = i / (size * size);
+        unsigned int cell = i % (size * size);
+        Node* box = _scene->addNode("box");
+        box->setTranslation(((cell % size) - size * 0.5f) * 2.0f + random() * 0.5f, 2.0f + layer * 1.5f, ((cell / size) - size * 0.5f) * 2.0f + random() * 0.5f);
+        box->rotateY(random() * MATH_PI);
+        box->setDrawable(boxModel);
+        box->setCollisionObject(PhysicsCollisionObject::RIGID_BODY, PhysicsCollisionShape::box(), &boxParameters);
+    }
+    SAFE_RELEASE(boxModel);
+}
+
+void BenchmarkGame::setupForm(unsigned int count)
+{
+    _form = Form::create("benchmarkForm", NULL, Layout::LAYOUT_ABSOLUTE);
+    _form->setSize(getWidth(), getHeight());
+
+    unsigned int columns = getGridSize(count);
+    float width = (float)getWidth() / columns;
+    float height = (float)getHeight() / columns;
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        Button* button = Button::create("button");
+        button->setPosition((i % columns) * width, (i / columns) * height);
+        button->setSize(width, height);
+        button->setText("0");
+        _form->addControl(button);
+        button->release();
+    }
+}
+
+void BenchmarkGame::setupScene(unsigned int count)
+{
+    if (!_sceneFile.empty())
+    {
+        _scene = Scene::load(_sceneFile.c_str());
+        if (_scene)
+        {
+            _count = _scene->getNodeCount();
+            return;
+        }
+        GP_WARN("Failed to load the benchmark scene '%s'; creating the nodes instead.", _sceneFile.c_str());
+    }
+
+    // Create the nodes as children of a node that turns, so that all of their transforms change every frame.
+    unsigned int size = (unsigned int)ceil(pow((double)std::max(count, 1u), 1.0 / 3.0));
+    createScene(size * 3.0f);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        Model* model = createBoxModel(__colors[i % (sizeof(__colors) / sizeof(__colors[0]))]);
+        Node* node = Node::create("node");
+        node->setTranslation(((i % size) - size * 0.5f) * 2.0f, (((i / size) % size) - size * 0.5f) * 2.0f, ((i / (size * size)) - size * 0.5f) * 2.0f);
+        node->rotate(Vector3(random(), random(), random()), random() * MATH_PIX2);
+        node->setDrawable(model);
+        _rootNode->addChild(node);
+        SAFE_RELEASE(node);
+        SAFE_RELEASE(model);
+    }
+}
+
+void BenchmarkGame::update(float elapsedTime)
+{
+    if (_scenarioIndex >= _scenarios.size())
+        return;
+
+    // Measure the time of the whole frame that ended with this update.
+    double now = getAbsoluteTime();
+    Result& result = _results.back();
+    if (_frame > _warmupFrames)
+        result.frameTimes.push_back((float)(now - _lastFrameTime));
+    _lastFrameTime = now;
+
+    if (_frame == _warmupFrames)
+    {
+        Profiler::clearCapture();
+        Profiler::startCapture();
+    }
+
+    switch (_scenarios[_scenarioIndex])
+    {
+    case SCENARIO_FORM:
+        if (_form)
+        {
+            // Change the text of the buttons so that the form is laid out and drawn again.
+            char text[16];
+            for (unsigned int i = 0, count = _form->getControlCount(); i < count; ++i)
+            {
+                sprintf(text, "%u", (_frame + i) % 1000);
+                static_cast<Button*>(_form->getControl(i))->setText(text);
+            }
+        }
+        break;
+    case SCENARIO_SCENE:
+        if (_rootNode)
+            _rootNode->rotateY(elapsedTime * 0.0005f);
+        break;
+    default:
+        break;
+    }
+
+    ++_frame;
+    if (result.frameTimes.size() >= _measuredFrames)
+    {
+        endScenario();
+        if (++_scenarioIndex < _scenarios.size())
+        {
+            startScenario();
+        }
+        else
+        {
+            writeResults();
+            exit();
+        }
+    }
+}
+
+void BenchmarkGame::render(float elapsedTime)
+{
+    clear(CLEAR_COLOR_DEPTH, Vector4::zero(), 1.0f, 0);
+
+    if (_scene)
+        _scene->visit(this, &BenchmarkGame::drawScene);
+
+    if (_spriteBatch)
+    {
+        // Move the sprites across the screen, from positions that only depend on their index.
+        const unsigned int width = getWidth();
+        const unsigned int height = getHeight();
+        for (unsigned int i = 0; i < _count; i += SPRITES_PER_BATCH)
+        {
+            _spriteBatch->start();
+            for (unsigned int j = i, end = std::min(_count, i + SPRITES_PER_BATCH); j < end; ++j)
+            {
+                float x = (float)((j * 7919 + _frame * (1 + j % 7)) % width);
+                float y = (float)((j * 104729) % height);
+                _spriteBatch->draw(x, y, 32.0f, 32.0f, 0.0f, 1.0f, 1.0f, 0.0f, __colors[j % (sizeof(__colors) / sizeof(__colors[0]))]);
+            }
+            _spriteBatch->finish();
+        }
+    }
+
+    if (_form)
+        _form->draw();
+
+    if (_font && _scenarioIndex < _scenarios.size())
+    {
+        char text[128];
+        if (_frame <= _warmupFrames)
+            sprintf(text, "%s (%u): warming up", __scenarioNames[_scenarios[_scenarioIndex]], _count);
+        else
+            sprintf(text, "%s (%u): frame %u of %u", __scenarioNames[_scenarios[_scenarioIndex]], _count, _frame - _warmupFrames, _measuredFrames);
+        _font->start();
+        _font->drawText(text, 5, 5, Vector4(0, 0.5f, 1, 1), _font->getSize());
+        _font->finish();
+    }
+}
+
+bool BenchmarkGame::drawScene(Node* node)
+{
+    Drawable* drawable = node->getDrawable();
+    if (drawable)
+        drawable->draw();
+    return true;
+}
+
+void BenchmarkGame::writeResults()
+{
+    std::string json;
+    appendFormat(json, "{\n  \"frameTime\": %.4f,\n  \"seed\": %u,\n  \"warmupFrames\": %u,\n  \"frames\": %u,\n", _frameTime, _seed, _warmupFrames, _measuredFrames);
+#ifdef GP_USE_PROFILER
+    json += "  \"profiler\": true,\n";
+#else
+    json += "  \"profiler\": false,\n";
+#endif
+    json += "  \"scenarios\": [\n";
+    for (size_t i = 0, count = _results.size(); i < count; ++i)
+    {
+        const Result& result = _results[i];
+
+        std::vector<float> sorted = result.frameTimes;
+        std::sort(sorted.begin(), sorted.end());
+        double total = 0.0;
+        for (size_t j = 0; j < sorted.size(); ++j)
+            total += sorted[j];
+        float mean = sorted.empty() ? 0.0f : (float)(total / sorted.size());
+
+        appendFormat(json, "    {\n      \"name\": \"%s\",\n      \"count\": %u,\n      \"setupTime\": %.3f,\n", result.name.c_str(), result.count, result.setupTime);
+        appendFormat(json, "      \"frameTime\": { \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f },\n",
+            mean, getPercentile(sorted, 0.5f), getPercentile(sorted, 0.9f), getPercentile(sorted, 0.95f), getPercentile(sorted, 0.99f),
+            sorted.empty() ? 0.0f : sorted.back());
+
+        json += "      \"cpu\": {";
+        for (size_t j = 0; j < result.cpuTimes.size(); ++j)
+            appendFormat(json, "%s \"%s\": %.3f", j ? "," : "", result.cpuTimes[j].first.c_str(), result.cpuTimes[j].second);
+        json += " },\n      \"gpu\": {";
+        for (size_t j = 0; j < result.gpuTimes.size(); ++j)
+            appendFormat(json, "%s \"%s\": %.3f", j ? "," : "", result.gpuTimes[j].first.c_str(), result.gpuTimes[j].second);
+        json += " },\n";
+
+        const RenderStats& stats = result.renderStats;
+        appendFormat(json, "      \"renderStats\": { \"drawCalls\": %u, \"primitives\": %u, \"programBinds\": %u, \"textureBinds\": %u, ",
+            stats.drawCalls, stats.primitives, stats.programBinds, stats.textureBinds);
+        appendFormat(json, "\"uniformUploads\": %u, \"bufferUploads\": %u, \"bufferUploadBytes\": %u, \"frameBufferBinds\": %u }\n",
+            stats.uniformUploads, stats.bufferUploads, stats.bufferUploadBytes, stats.frameBufferBinds);
+        appendFormat(json, "    }%s\n", i + 1 < count ? "," : "");
+
+        print("Benchmark: %s (%u): mean %.3f ms, p50 %.3f ms, p99 %.3f ms, %u draw calls\n", result.name.c_str(), result.count,
+            mean, getPercentile(sorted, 0.5f), getPercentile(sorted, 0.99f), stats.drawCalls);
+    }
+    json += "  ]\n}\n";
+
+    std::unique_ptr<Stream> stream(FileSystem::open(_output.c_str(), FileSystem::WRITE));
+    if (stream.get() == NULL)
+    {
+        GP_ERROR("Failed to open benchmark results file '%s'.", _output.c_str());
+        return;
+    }
+    stream->write(json.c_str(), 1, json.size());
+    print("Benchmark: results written to %s\n", _output.c_str());
+}
+
+void BenchmarkGame::keyEvent(Keyboard::KeyEvent evt, int key)
+{
+    if (evt == Keyboard::KEY_PRESS && key == Keyboard::KEY_ESCAPE)
+    {
+        exit();
+    }
+}
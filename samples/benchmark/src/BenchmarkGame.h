@@ -0,0 +1,133 @@
+#ifndef BENCHMARKGAME_H_
+#define BENCHMARKGAME_H_
+
+#include "gameplay.h"
+
+using namespace gameplay;
+
+/**
+ * Benchmark game.
+ *
+ * Runs a sequence of reproducible workloads of the engine, one scenario after the other,
+ * and writes the frame times, the time spent in each subsystem and the render statistics
+ * of each scenario to a JSON file. The scenarios and their sizes are set in game.config.
+ *
+ * Each frame is updated by the same fixed time and the random numbers are seeded, so that
+ * two runs of the benchmark do the same work and their results can be compared.
+ */
+class BenchmarkGame : public Game
+{
+public:
+
+    /**
+     * Constructor.
+     */
+    BenchmarkGame();
+
+    /**
+     * @see Game::keyEvent
+     */
+    void keyEvent(Keyboard::KeyEvent evt, int key);
+
+protected:
+
+    /**
+     * @see Game::initialize
+     */
+    void initialize();
+
+    /**
+     * @see Game::finalize
+     */
+    void finalize();
+
+    /**
+     * @see Game::update
+     */
+    void update(float elapsedTime);
+
+    /**
+     * @see Game::render
+     */
+    void render(float elapsedTime);
+
+private:
+
+    /**
+     * The workloads that can be benchmarked.
+     */
+    enum ScenarioType
+    {
+        SCENARIO_ANIMATION,
+        SCENARIO_PARTICLES,
+        SCENARIO_SPRITES,
+        SCENARIO_PHYSICS,
+        SCENARIO_FORM,
+        SCENARIO_SCENE
+    };
+
+    /**
+     * The measurements of a scenario.
+     */
+    struct Result
+    {
+        std::string name;
+        unsigned int count;
+        double setupTime;
+        std::vector<float> frameTimes;
+        std::vector<std::pair<std::string, double> > cpuTimes;
+        std::vector<std::pair<std::string, double> > gpuTimes;
+        RenderStats renderStats;
+    };
+
+    bool parseScenario(const char* name, ScenarioType* type) const;
+
+    void startScenario();
+
+    void endScenario();
+
+    void setupAnimation(unsigned int count);
+
+    void setupParticles(unsigned int count);
+
+    void setupSprites(unsigned int count);
+
+    void setupPhysics(unsigned int count);
+
+    void setupForm(unsigned int count);
+
+    void setupScene(unsigned int count);
+
+    void createScene(float distance);
+
+    Model* createBoxModel(const Vector4& color);
+
+    float random();
+
+    bool drawScene(Node* node);
+
+    void writeResults();
+
+    Font* _font;
+    Scene* _scene;
+    Node* _lightNode;
+    Node* _rootNode;
+    Mesh* _boxMesh;
+    SpriteBatch* _spriteBatch;
+    Form* _form;
+    std::vector<ScenarioType> _scenarios;
+    std::vector<Result> _results;
+    unsigned int _scenarioIndex;
+    unsigned int _frame;
+    unsigned int _warmupFrames;
+    unsigned int _measuredFrames;
+    float _frameTime;
+    unsigned int _seed;
+    unsigned int _random;
+    unsigned int _count;
+    double _lastFrameTime;
+    std::string _sceneFile;
+    std::string _output;
+};
+
+#endif
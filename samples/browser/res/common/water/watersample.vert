@@ -7,7 +7,7 @@ attribute vec2 a_texCoord;
 // Uniforms
 uniform mat4 u_worldMatrix;
 uniform mat4 u_worldViewProjectionMatrix;
-uniform mat4 u_worldViewProjectionReflectionMatrix;
+uniform mat4 u_reflectionViewProjectionMatrix;
 uniform vec3 u_cameraPosition;
 
 /////////////////////////////
@@ -21,7 +21,7 @@ varying vec3 v_eyePosition;
 void main()
 {
     v_vertexRefractionPosition = u_worldViewProjectionMatrix * a_position;
-    v_vertexReflectionPosition = u_worldViewProjectionReflectionMatrix * a_position;
+    v_vertexReflectionPosition = u_reflectionViewProjectionMatrix * (u_worldMatrix * a_position);
 
     gl_Position = v_vertexRefractionPosition;
 
@@ -145,8 +145,11 @@ void SceneCreateSample::render(float elapsedTime)
     // Clear the color and depth buffers
     clear(CLEAR_COLOR_DEPTH, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0);
 
-    // Visit all the nodes in the scene, drawing the models.
-    _scene->visit(this, &SceneCreateSample::drawScene);
+    // Gather the visible drawables in the scene and draw them in sorted order.
+    _renderQueue.clear();
+    _renderQueue.gather(_scene);
+    _renderQueue.sort();
+    _renderQueue.draw();
 
     drawFrameRate(_font, Vector4(0, 0.5f, 1, 1), 5, 1, getFrameRate());
 }
@@ -168,11 +171,3 @@ void SceneCreateSample::touchEvent(Touch::TouchEvent evt, int x, int y, unsigned
         break;
     };
 }
-
-bool SceneCreateSample::drawScene(Node* node)
-{
-    Drawable* drawable = node->getDrawable();
-    if (drawable)
-        drawable->draw();
-    return true;
-}
\ No newline at end of file
@@ -29,11 +29,10 @@ protected:
 
 private:
 
-    bool drawScene(Node* node);
-
     Font* _font;
     Scene* _scene;
     Node* _cubeNode;
+    RenderQueue _renderQueue;
 };
 
 #endif
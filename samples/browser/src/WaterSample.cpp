@@ -15,9 +15,9 @@ static const float WATER_OFFSET = 0.55f;
 
 WaterSample::WaterSample()
     : _font(NULL), _scene(NULL), _cameraNode(NULL),
-    _reflectCameraNode(NULL), _inputMask(0u), _prevX(0),
+    _inputMask(0u), _prevX(0),
      _prevY(0), _waterHeight(0.f), 
-     _refractBuffer(NULL), _refractBatch(NULL), _reflectBuffer(NULL), _reflectBatch(NULL), 
+     _refractBuffer(NULL), _refractBatch(NULL), _reflection(NULL), _reflectBatch(NULL), 
      _showBuffers(false), _gamepad(NULL)
 {
 }
@@ -48,18 +48,6 @@ void WaterSample::initialize()
     SAFE_RELEASE(camera);
     SAFE_RELEASE(camPitchNode);
 
-    // Add a second camera do draw the reflections
-    _reflectCameraNode = Node::create("reflectCamNode");
-    _reflectCameraNode->setTranslation(camStartPosition.x, -camStartPosition.y, camStartPosition.z);
-    camPitchNode = Node::create();
-    Matrix::createLookAt(_reflectCameraNode->getTranslation(), Vector3::zero(), Vector3::unitY(), &m);
-    camPitchNode->rotate(m);
-    _reflectCameraNode->addChild(camPitchNode);
-    camera = Camera::createPerspective(45.f, Game::getInstance()->getAspectRatio(), 0.1f, 150.f);
-    camPitchNode->setCamera(camera);
-    SAFE_RELEASE(camera);
-    SAFE_RELEASE(camPitchNode);
-
     // Render buffer and preview for refraction
     _refractBuffer = FrameBuffer::create("refractBuffer", BUFFER_SIZE, BUFFER_SIZE);
     DepthStencilTarget* refractDepthTarget = DepthStencilTarget::create("refractDepth", DepthStencilTarget::DEPTH, BUFFER_SIZE, BUFFER_SIZE);
@@ -67,12 +55,13 @@ void WaterSample::initialize()
     SAFE_RELEASE(refractDepthTarget);
     _refractBatch = SpriteBatch::create(_refractBuffer->getRenderTarget()->getTexture());
 
-    // Render buffer and preview for reflection
-    _reflectBuffer = FrameBuffer::create("reflectBuffer", BUFFER_SIZE, BUFFER_SIZE);
-    DepthStencilTarget* reflectDepthTarget = DepthStencilTarget::create("reflectDepth", DepthStencilTarget::DEPTH, BUFFER_SIZE, BUFFER_SIZE);
-    _reflectBuffer->setDepthStencilTarget(reflectDepthTarget);
-    SAFE_RELEASE(reflectDepthTarget);
-    _reflectBatch = SpriteBatch::create(_reflectBuffer->getRenderTarget()->getTexture());
+    // Planar reflection of the scene in the water, rendered every other frame, and its preview
+    Node* waterNode = _scene->findNode("Water");
+    waterNode->setTag("reflection", "none");
+    _reflection = new PlanarReflection(BUFFER_SIZE, BUFFER_SIZE);
+    _reflection->setPlane(Plane(Vector3::unitY(), -_waterHeight));
+    _reflection->setUpdateInterval(2);
+    _reflection->setClearColor(Vector4(0.84f, 0.89f, 1.f, 1.f));
 
     // Add a node to provide light direction
     Node* lightNode = Node::create("lightNode");
@@ -83,14 +72,12 @@ void WaterSample::initialize()
     Material* groundMaterial = dynamic_cast<Model*>(_scene->findNode("Ground")->getDrawable())->getMaterial();
     groundMaterial->getParameter("u_clipPlane")->bindValue(this, &WaterSample::getClipPlane);
     groundMaterial->getParameter("u_directionalLightDirection[0]")->bindValue(lightNode, &Node::getForwardVectorView);
-    auto waterMaterial = dynamic_cast<Model*>(_scene->findNode("Water")->getDrawable())->getMaterial();
+    auto waterMaterial = dynamic_cast<Model*>(waterNode->getDrawable())->getMaterial();
     auto refractSampler = Texture::Sampler::create(_refractBuffer->getRenderTarget()->getTexture());
     waterMaterial->getParameter("u_refractionTexture")->setSampler(refractSampler);
     SAFE_RELEASE(refractSampler);
-    auto reflectSampler = Texture::Sampler::create(_reflectBuffer->getRenderTarget()->getTexture());
-    waterMaterial->getParameter("u_reflectionTexture")->setSampler(reflectSampler);
-    SAFE_RELEASE(reflectSampler);
-    waterMaterial->getParameter("u_worldViewProjectionReflectionMatrix")->bindValue(this, &WaterSample::getReflectionMatrix);
+    _reflection->bind(waterMaterial);
+    _reflectBatch = SpriteBatch::create(_reflection->getSampler()->getTexture());
     waterMaterial->getParameter("u_time")->bindValue(this, &WaterSample::getTime);
     SAFE_RELEASE(lightNode);
 
@@ -107,10 +94,9 @@ void WaterSample::finalize()
 {
     setMouseCaptured(false);
     SAFE_DELETE(_reflectBatch);
-    SAFE_RELEASE(_reflectBuffer);
+    SAFE_DELETE(_reflection);
     SAFE_DELETE(_refractBatch);
     SAFE_RELEASE(_refractBuffer);
-    SAFE_RELEASE(_reflectCameraNode);
     SAFE_RELEASE(_cameraNode);
     SAFE_RELEASE(_scene);
     SAFE_RELEASE(_font);
@@ -140,11 +126,6 @@ void WaterSample::update(float elapsedTime)
     if (_cameraAcceleration.lengthSquared() < 0.01f)
         _cameraAcceleration = Vector3::zero();
     _cameraNode->translate(_cameraAcceleration * SPEED * (elapsedTime / 1000.f));
-    
-    // Make sure the reflection camera follows
-    Vector3 position = _cameraNode->getTranslation();
-    position.y = -position.y + _waterHeight * 2.f;
-    _reflectCameraNode->setTranslation(position);
 }
 
 void WaterSample::render(float elapsedTime)
@@ -160,23 +141,13 @@ void WaterSample::render(float elapsedTime)
     clear(CLEAR_COLOR_DEPTH, clearColour, 1.0f, 0);
     _scene->visit(this, &WaterSample::drawScene, false);
 
-    // Switch plane direction and camera, and update reflection buffer
-    _reflectBuffer->bind();
-    _clipPlane.y = 1.f;
-    _clipPlane.w = -_waterHeight + WATER_OFFSET;
-    Camera* defaultCamera = _scene->getActiveCamera();
-    _scene->setActiveCamera(_reflectCameraNode->getFirstChild()->getCamera());
-
-    // Store the mvp matrix here as it is only valid when reflect camera is active
-    m_worldViewProjectionReflection = _scene->findNode("Water")->getWorldViewProjectionMatrix();
-    clear(CLEAR_COLOR_DEPTH, clearColour, 1.0f, 0);
-    _scene->visit(this, &WaterSample::drawScene, false);
-
-    // Draw the final scene
+    // Update the reflection, which clips the scene at the water itself
     defaultBuffer->bind();
     setViewport(defaultViewport);
     _clipPlane = Vector4::zero();
-    _scene->setActiveCamera(defaultCamera);
+    _reflection->update(_scene);
+
+    // Draw the final scene
     clear(CLEAR_COLOR_DEPTH, clearColour, 1.0f, 0);
     _scene->visit(this, &WaterSample::drawScene, true);
 
@@ -225,8 +196,6 @@ void WaterSample::touchEvent(Touch::TouchEvent evt, int x, int y, unsigned int c
         float yMovement = MATH_DEG_TO_RAD(-deltaY * 0.25f);
         _cameraNode->rotateY(-xMovement);
         _cameraNode->getFirstChild()->rotateX(yMovement);
-        _reflectCameraNode->rotateY(-xMovement);
-        _reflectCameraNode->getFirstChild()->rotateX(-yMovement);
     }
         break;
     };
@@ -293,8 +262,6 @@ bool WaterSample::mouseEvent(Mouse::MouseEvent evt, int x, int y, int wheelDelta
         float yMovement = MATH_DEG_TO_RAD(-y * MOUSE_SPEED);
         _cameraNode->rotateY(xMovement);
         _cameraNode->getFirstChild()->rotateX(yMovement);
-        _reflectCameraNode->rotateY(xMovement);
-        _reflectCameraNode->getFirstChild()->rotateX(-yMovement);
     }
         return true;
     case Mouse::MOUSE_PRESS_LEFT_BUTTON:
@@ -45,7 +45,6 @@ private:
     Font* _font;
     Scene* _scene;
     Node* _cameraNode;
-    Node* _reflectCameraNode;
 
     Vector3 _cameraAcceleration;
     float _waterHeight;
@@ -55,7 +54,7 @@ private:
 
     FrameBuffer* _refractBuffer;
     SpriteBatch* _refractBatch;
-    FrameBuffer* _reflectBuffer;
+    PlanarReflection* _reflection;
     SpriteBatch* _reflectBatch;
 
     bool _showBuffers;
@@ -64,12 +63,6 @@ private:
     {
         return _clipPlane;
     }
-    Matrix m_worldViewProjectionReflection;
-    const Matrix& getReflectionMatrix() const
-    {
-        return m_worldViewProjectionReflection;
-    }
-
     float getTime() const
     {
         return Game::getGameTime() * 0.0001;
@@ -0,0 +1,656 @@
+#include "MicrobenchGame.h"
+
+// Declare our game instance
+MicrobenchGame game;
+
+// The synthetic files that the properties and bundle benchmarks load.
+#define PROPERTIES_FILE "microbench.properties"
+#define PROPERTIES_BINARY_FILE "microbench.properties.bin"
+#define BUNDLE_FILE "microbench.gpb"
+
+// The number of nodes of each hierarchy in the synthetic bundle: a root and its children.
+#define BUNDLE_NODES_PER_ROOT 8
+
+// The number of points of the curves that are evaluated.
+#define CURVE_POINT_COUNT 16
+
+// The most iterations that a sample runs, which bounds the time of functions that are optimized away.
+#define MAX_ITERATIONS (1u << 30)
+
+// The names of the interpolation types, in the order of Curve::InterpolationType.
+static const char* __interpolationTypes[] =
+{
+    "BEZIER", "BSPLINE", "FLAT", "HERMITE", "LINEAR", "SMOOTH", "STEP",
+    "QUADRATIC_IN", "QUADRATIC_OUT", "QUADRATIC_IN_OUT", "QUADRATIC_OUT_IN",
+    "CUBIC_IN", "CUBIC_OUT", "CUBIC_IN_OUT", "CUBIC_OUT_IN",
+    "QUARTIC_IN", "QUARTIC_OUT", "QUARTIC_IN_OUT", "QUARTIC_OUT_IN",
+    "QUINTIC_IN", "QUINTIC_OUT", "QUINTIC_IN_OUT", "QUINTIC_OUT_IN",
+    "SINE_IN", "SINE_OUT", "SINE_IN_OUT", "SINE_OUT_IN",
+    "EXPONENTIAL_IN", "EXPONENTIAL_OUT", "EXPONENTIAL_IN_OUT", "EXPONENTIAL_OUT_IN",
+    "CIRCULAR_IN", "CIRCULAR_OUT", "CIRCULAR_IN_OUT", "CIRCULAR_OUT_IN",
+    "ELASTIC_IN", "ELASTIC_OUT", "ELASTIC_IN_OUT", "ELASTIC_OUT_IN",
+    "OVERSHOOT_IN", "OVERSHOOT_OUT", "OVERSHOOT_IN_OUT", "OVERSHOOT_OUT_IN",
+    "BOUNCE_IN", "BOUNCE_OUT", "BOUNCE_IN_OUT", "BOUNCE_OUT_IN"
+};
+
+static const char* __text =
+    "The quick brown fox jumps over the lazy dog. Pack my box with five dozen liquor jugs.\n"
+    "How vexingly quick daft zebras jump! Sphinx of black quartz, judge my vow. 0123456789";
+
+// The results of the benchmarked functions are added to this, so that they are not optimized away.
+static volatile float __sink = 0.0f;
+
+static void appendFormat(std::string& str, const char* format, ...)
+{
+    char buffer[512];
+    va_list arguments;
+    va_start(arguments, format);
+    vsnprintf(buffer, sizeof(buffer), format, arguments);
+    va_end(arguments);
+    buffer[sizeof(buffer) - 1] = '\0';
+    str += buffer;
+}
+
+static void appendUint(std::string& str, unsigned int value)
+{
+    str.append((const char*)&value, sizeof(value));
+}
+
+static void appendFloat(std::string& str, float value)
+{
+    str.append((const char*)&value, sizeof(value));
+}
+
+static void appendString(std::string& str, const std::string& value)
+{
+    appendUint(str, (unsigned int)value.size());
+    str += value;
+}
+
+static bool writeFile(const char* path, const std::string& data)
+{
+    std::unique_ptr<Stream> stream(FileSystem::open(path, FileSystem::WRITE));
+    if (stream.get() == NULL || stream->write(data.c_str(), 1, data.size()) != data.size())
+    {
+        GP_ERROR("Failed to write file '%s'.", path);
+        return false;
+    }
+    return true;
+}
+
+static double getMedian(std::vector<double> values)
+{
+    if (values.empty())
+        return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t middle = values.size() / 2;
+    return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) * 0.5;
+}
+
+MicrobenchGame::MicrobenchGame()
+    : _param(0), _sampleTime(50.0f), _sampleCount(10), _hierarchyDepth(64), _propertiesCount(100), _sceneNodes(1000),
+      _particles(2000), _batchQuads(1024), _rootNode(NULL), _leafNode(NULL), _bundle(NULL), _font(NULL), _emitterNode(NULL),
+      _emitter(NULL), _meshBatch(NULL), _finished(false), _tolerance(10.0f)
+{
+}
+
+void MicrobenchGame::initialize()
+{
+    Properties* config = getConfig()->getNamespace("microbench", true);
+    if (config)
+    {
+        if (config->exists("sampleTime"))
+            _sampleTime = config->getFloat("sampleTime");
+        if (config->exists("samples"))
+            _sampleCount = (unsigned int)config->getInt("samples");
+        if (config->exists("hierarchyDepth"))
+            _hierarchyDepth = (unsigned int)config->getInt("hierarchyDepth");
+        if (config->exists("properties"))
+            _propertiesCount = (unsigned int)config->getInt("properties");
+        if (config->exists("sceneNodes"))
+            _sceneNodes = (unsigned int)config->getInt("sceneNodes");
+        if (config->exists("particles"))
+            _particles = (unsigned int)config->getInt("particles");
+        if (config->exists("batchQuads"))
+            _batchQuads = (unsigned int)config->getInt("batchQuads");
+        _output = config->getString("output", "microbench.json");
+        _baseline = config->getString("baseline", "");
+        if (config->exists("tolerance"))
+            _tolerance = config->getFloat("tolerance");
+
+        // Parse the comma separated list of the benchmarks to run, which match the benchmarks whose names start with them.
+        std::string filters = config->getString("benchmarks", "");
+        size_t start = 0;
+        while (start < filters.size())
+        {
+            size_t end = filters.find(',', start);
+            if (end == std::string::npos)
+                end = filters.size();
+            std::string name = filters.substr(start, end - start);
+            name.erase(0, name.find_first_not_of(" \t"));
+            name.erase(name.find_last_not_of(" \t") + 1);
+            if (!name.empty())
+                _filters.push_back(name);
+            start = end + 1;
+        }
+    }
+    else
+    {
+        _output = "microbench.json";
+    }
+    _sampleCount = std::max(1u, _sampleCount);
+    _hierarchyDepth = std::max(1u, _hierarchyDepth);
+    _sceneNodes = std::max(1u, _sceneNodes);
+    _particles = std::max(1u, _particles);
+    _batchQuads = std::max(1u, _batchQuads);
+
+    setVsync(false);
+    setup();
+
+    addBenchmark("Matrix::multiply", &MicrobenchGame::runMatrixMultiply, 0, 1);
+    addBenchmark("Matrix::invert", &MicrobenchGame::runMatrixInvert, 0, 1);
+    addBenchmark("Quaternion::slerp", &MicrobenchGame::runQuaternionSlerp, 0, 1);
+    for (unsigned int i = 0; i < _curves.size(); ++i)
+    {
+        std::string name("Curve::evaluate/");
+        name += __interpolationTypes[i];
+        addBenchmark(name.c_str(), &MicrobenchGame::runCurveEvaluate, i, CURVE_POINT_COUNT);
+    }
+    addBenchmark("Transform::getMatrix", &MicrobenchGame::runTransformGetMatrix, 0, 1);
+    if (_leafNode)
+        addBenchmark("Node::getWorldMatrix", &MicrobenchGame::runNodeGetWorldMatrix, 0, _hierarchyDepth);
+    if (_propertiesCount > 0)
+    {
+        addBenchmark("Properties::create/text", &MicrobenchGame::runPropertiesCreate, 0, _propertiesCount);
+        addBenchmark("Properties::create/binary", &MicrobenchGame::runPropertiesCreate, 1, _propertiesCount);
+    }
+    if (_bundle)
+        addBenchmark("Bundle::loadScene", &MicrobenchGame::runBundleLoadScene, 0, _sceneNodes);
+    if (_font)
+        addBenchmark("Font::measureText", &MicrobenchGame::runFontMeasureText, 0, (unsigned int)strlen(__text));
+    if (_emitter)
+        addBenchmark("ParticleEmitter::update", &MicrobenchGame::runParticleEmitterUpdate, 0, _particles);
+    if (_meshBatch)
+        addBenchmark("MeshBatch::add", &MicrobenchGame::runMeshBatchAdd, 0, _batchQuads);
+}
+
+void MicrobenchGame::finalize()
+{
+    for (size_t i = 0, count = _curves.size(); i < count; ++i)
+        SAFE_RELEASE(_curves[i]);
+    _curves.clear();
+    SAFE_RELEASE(_rootNode);
+    _leafNode = NULL;
+    SAFE_RELEASE(_bundle);
+    SAFE_RELEASE(_font);
+    SAFE_RELEASE(_emitterNode);
+    _emitter = NULL;
+    SAFE_DELETE(_meshBatch);
+}
+
+void MicrobenchGame::addBenchmark(const char* name, RunFunction run, unsigned int param, unsigned int size)
+{
+    if (!isSelected(name))
+        return;
+
+    Benchmark benchmark;
+    benchmark.name = name;
+    benchmark.run = run;
+    benchmark.param = param;
+    benchmark.size = size;
+    benchmark.iterations = 0;
+    benchmark.baseline = 0.0;
+    _benchmarks.push_back(benchmark);
+}
+
+bool MicrobenchGame::isSelected(const char* name) const
+{
+    if (_filters.empty())
+        return true;
+    for (size_t i = 0, count = _filters.size(); i < count; ++i)
+    {
+        if (strncmp(name, _filters[i].c_str(), _filters[i].size()) == 0)
+            return true;
+    }
+    return false;
+}
+
+void MicrobenchGame::setup()
+{
+    // One curve for each of the interpolation types, with tangents for the types that use them.
+    for (unsigned int i = 0; i < sizeof(__interpolationTypes) / sizeof(__interpolationTypes[0]); ++i)
+    {
+        Curve* curve = Curve::create(CURVE_POINT_COUNT, 4);
+        for (unsigned int j = 0; j < CURVE_POINT_COUNT; ++j)
+        {
+            float value[4] = { sinf(j * 0.5f), cosf(j * 0.5f), j * 0.25f, 1.0f };
+            float inValue[4] = { 0.5f, -0.5f, 0.25f, 0.0f };
+            float outValue[4] = { 0.5f, -0.5f, 0.25f, 0.0f };
+            curve->setPoint(j, (float)j / (CURVE_POINT_COUNT - 1), value, (Curve::InterpolationType)i, inValue, outValue);
+        }
+        _curves.push_back(curve);
+    }
+
+    // A chain of nodes, each of which is the child of the previous one.
+    _rootNode = Node::create("root");
+    Node* parent = _rootNode;
+    for (unsigned int i = 1; i < _hierarchyDepth; ++i)
+    {
+        Node* node = Node::create();
+        node->setTranslation(0.0f, 1.0f, 0.0f);
+        node->rotateY(0.1f);
+        parent->addChild(node);
+        node->release(); // The parent now owns the node.
+        parent = node;
+    }
+    _leafNode = parent;
+
+    if (_propertiesCount > 0)
+        writeProperties();
+
+    writeBundle();
+    _bundle = Bundle::create(BUNDLE_FILE);
+
+    _font = Font::create("res/ui/arial.gpb");
+
+    // An emitter that is filled with particles before it is measured.
+    _emitter = ParticleEmitter::create("res/logo_powered_white.png", ParticleEmitter::BLEND_ADDITIVE, _particles);
+    if (_emitter)
+    {
+        _emitter->setEmissionRate(_particles);
+        _emitter->setEnergy(1000, 1000);
+        _emitter->setSize(0.2f, 0.3f, 0.05f, 0.1f);
+        _emitter->setVelocity(Vector3(0.0f, 2.0f, 0.0f), Vector3(1.0f, 1.0f, 1.0f));
+        _emitter->start();
+        _emitterNode = Node::create("emitter");
+        _emitterNode->setDrawable(_emitter);
+        _emitter->release(); // The node now owns the emitter.
+        for (unsigned int i = 0; i < 120; ++i)
+            _emitter->update(1000.0f / 60.0f);
+    }
+
+    VertexFormat::Element elements[] =
+    {
+        VertexFormat::Element(VertexFormat::POSITION, 3),
+        VertexFormat::Element(VertexFormat::COLOR, 4)
+    };
+    Material* material = Material::create("res/shaders/colored.vert", "res/shaders/colored.frag", "VERTEX_COLOR");
+    if (material)
+    {
+        _meshBatch = MeshBatch::create(VertexFormat(elements, 2), Mesh::TRIANGLES, material, true, _batchQuads * 4, _batchQuads * 4);
+        SAFE_RELEASE(material);
+    }
+}
+
+void MicrobenchGame::writeProperties()
+{
+    // Materials, which are the properties files that are parsed the most.
+    std::string text;
+    for (unsigned int i = 0; i < _propertiesCount; ++i)
+    {
+        appendFormat(text, "material material%u\n{\n    technique\n    {\n        pass\n        {\n", i);
+        text += "            vertexShader = res/shaders/colored.vert\n";
+        text += "            fragmentShader = res/shaders/colored.frag\n";
+        text += "            defines = VERTEX_COLOR\n";
+        text += "            u_worldViewProjectionMatrix = WORLD_VIEW_PROJECTION_MATRIX\n";
+        appendFormat(text, "            u_diffuseColor = %.2f, 0.5, 0.5, 1.0\n", (i % 100) * 0.01f);
+        text += "            renderState\n            {\n                cullFace = true\n                depthTest = true\n            }\n";
+        text += "        }\n    }\n}\n\n";
+    }
+    if (writeFile(PROPERTIES_FILE, text))
+        Properties::compile(PROPERTIES_FILE, PROPERTIES_BINARY_FILE);
+}
+
+void MicrobenchGame::writeBundle()
+{
+    // The bundle holds a scene of hierarchies of nodes without any drawables, in the 1.2 format whose
+    // nodes are read one at a time, and whose objects are all found through the reference table.
+    std::vector<std::string> ids;
+    std::vector<unsigned int> types;
+    std::vector<unsigned int> offsets;
+    std::string data;
+
+    ids.push_back("scene");
+    types.push_back(1);
+    offsets.push_back(0);
+    unsigned int rootCount = (_sceneNodes + BUNDLE_NODES_PER_ROOT - 1) / BUNDLE_NODES_PER_ROOT;
+    appendUint(data, rootCount);
+    unsigned int nodeIndex = 0;
+    for (unsigned int i = 0; i < rootCount; ++i)
+    {
+        unsigned int childCount = std::min(_sceneNodes - nodeIndex, (unsigned int)BUNDLE_NODES_PER_ROOT) - 1;
+        std::string rootId;
+        for (unsigned int j = 0; j <= childCount; ++j)
+        {
+            char id[32];
+            sprintf(id, "node%u", nodeIndex++);
+            ids.push_back(id);
+            types.push_back(2);
+            offsets.push_back((unsigned int)data.size());
+
+            Matrix transform;
+            transform.translate((float)(i % 32), (float)j, (float)(i / 32));
+            appendUint(data, Node::NODE);
+            for (unsigned int k = 0; k < 16; ++k)
+                appendFloat(data, transform.m[k]);
+            appendString(data, rootId);
+            appendUint(data, j == 0 ? childCount : 0);
+            data += '\0'; // No camera.
+            data += '\0'; // No light.
+            appendString(data, ""); // No model.
+            if (j == 0)
+                rootId = id;
+        }
+    }
+    appendString(data, ""); // No active camera.
+    appendFloat(data, 0.25f);
+    appendFloat(data, 0.25f);
+    appendFloat(data, 0.25f);
+
+    // The reference table comes before the objects, so their offsets start after it.
+    unsigned int headerSize = 9 + 2 + 4;
+    for (size_t i = 0, count = ids.size(); i < count; ++i)
+        headerSize += 4 + (unsigned int)ids[i].size() + 4 + 4;
+
+    std::string file("\xABGPB\xBB\r\n\x1A\n", 9);
+    file += (char)1;
+    file += (char)2;
+    appendUint(file, (unsigned int)ids.size());
+    for (size_t i = 0, count = ids.size(); i < count; ++i)
+    {
+        appendString(file, ids[i]);
+        appendUint(file, types[i]);
+        appendUint(file, headerSize + offsets[i]);
+    }
+    file += data;
+    writeFile(BUNDLE_FILE, file);
+}
+
+void MicrobenchGame::measure(Benchmark& benchmark)
+{
+    _param = benchmark.param;
+
+    // Find the number of iterations that take at least the sample time.
+    unsigned int iterations = 1;
+    for (;;)
+    {
+        double start = getAbsoluteTime();
+        (this->*benchmark.run)(iterations);
+        double elapsed = getAbsoluteTime() - start;
+        if (elapsed >= _sampleTime || iterations >= MAX_ITERATIONS)
+            break;
+
+        // Grow towards the sample time, by at most ten times at once.
+        double scale = elapsed > 0.0 ? _sampleTime * 1.2 / elapsed : 10.0;
+        iterations = (unsigned int)std::min((double)MAX_ITERATIONS, iterations * std::max(2.0, std::min(10.0, scale)));
+    }
+    benchmark.iterations = iterations;
+
+    benchmark.samples.reserve(_sampleCount);
+    for (unsigned int i = 0; i < _sampleCount; ++i)
+    {
+        double start = getAbsoluteTime();
+        (this->*benchmark.run)(iterations);
+        double elapsed = getAbsoluteTime() - start;
+        benchmark.samples.push_back(elapsed * 1000000.0 / iterations);
+    }
+
+    print("Microbench: %s: %.1f ns (%u iterations)\n", benchmark.name.c_str(),
+        *std::min_element(benchmark.samples.begin(), benchmark.samples.end()), iterations);
+}
+
+void MicrobenchGame::runMatrixMultiply(unsigned int iterations)
+{
+    Matrix a, b, dst;
+    Matrix::createRotation(Vector3(1.0f, 1.0f, 0.0f), 0.5f, &a);
+    Matrix::createTranslation(1.0f, 2.0f, 3.0f, &b);
+    float sum = 0.0f;
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        Matrix::multiply(a, b, &dst);
+        sum += dst.m[i & 15];
+    }
+    __sink += sum;
+}
+
+void MicrobenchGame::runMatrixInvert(unsigned int iterations)
+{
+    Matrix m, dst;
+    Matrix::createRotation(Vector3(1.0f, 1.0f, 0.0f), 0.5f, &m);
+    m.translate(1.0f, 2.0f, 3.0f);
+    m.scale(2.0f);
+    float sum = 0.0f;
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        m.invert(&dst);
+        sum += dst.m[i & 15];
+    }
+    __sink += sum;
+}
+
+void MicrobenchGame::runQuaternionSlerp(unsigned int iterations)
+{
+    Quaternion q1, q2, dst;
+    Quaternion::createFromAxisAngle(Vector3(0.0f, 1.0f, 0.0f), 0.5f, &q1);
+    Quaternion::createFromAxisAngle(Vector3(1.0f, 0.0f, 0.0f), 2.0f, &q2);
+    float sum = 0.0f;
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        Quaternion::slerp(q1, q2, (i & 255) * (1.0f / 255.0f), &dst);
+        sum += dst.w;
+    }
+    __sink += sum;
+}
+
+void MicrobenchGame::runCurveEvaluate(unsigned int iterations)
+{
+    Curve* curve = _curves[_param];
+    float dst[4];
+    float sum = 0.0f;
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        curve->evaluate((i & 1023) * (1.0f / 1023.0f), dst);
+        sum += dst[0];
+    }
+    __sink += sum;
+}
+
+void MicrobenchGame::runTransformGetMatrix(unsigned int iterations)
+{
+    // Changing the transform each time makes each call compute the matrix.
+    Transform transform;
+    transform.setScale(2.0f);
+    Quaternion rotation;
+    Quaternion::createFromAxisAngle(Vector3(0.0f, 1.0f, 0.0f), 0.01f, &rotation);
+    float sum = 0.0f;
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        transform.rotate(rotation);
+        transform.translateX(0.001f);
+        sum += transform.getMatrix().m[12];
+    }
+    __sink += sum;
+}
+
+void MicrobenchGame::runNodeGetWorldMatrix(unsigned int iterations)
+{
+    // Moving the root makes the world matrices of the whole chain dirty.
+    float sum = 0.0f;
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        _rootNode->translateX((i & 1) ? -0.001f : 0.001f);
+        sum += _leafNode->getWorldMatrix().m[12];
+    }
+    __sink += sum;
+}
+
+void MicrobenchGame::runPropertiesCreate(unsigned int iterations)
+{
+    const char* path = _param == 0 ? PROPERTIES_FILE : PROPERTIES_BINARY_FILE;
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        Properties* properties = Properties::create(path);
+        if (properties == NULL)
+            return;
+        __sink += properties->getNextNamespace() ? 1.0f : 0.0f;
+        SAFE_DELETE(properties);
+    }
+}
+
+void MicrobenchGame::runBundleLoadScene(unsigned int iterations)
+{
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        Scene* scene = _bundle->loadScene();
+        if (scene == NULL)
+            return;
+        __sink += (float)scene->getNodeCount();
+        SAFE_RELEASE(scene);
+    }
+}
+
+void MicrobenchGame::runFontMeasureText(unsigned int iterations)
+{
+    unsigned int size = _font->getSize();
+    unsigned int width = 0, height = 0;
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        _font->measureText(__text, size, &width, &height);
+        __sink += (float)width;
+    }
+}
+
+void MicrobenchGame::runParticleEmitterUpdate(unsigned int iterations)
+{
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        _emitter->update(1000.0f / 60.0f);
+    }
+    __sink += (float)_emitter->getParticlesCount();
+}
+
+void MicrobenchGame::runMeshBatchAdd(unsigned int iterations)
+{
+    // Each iteration adds a quad, and the batch starts again once it holds the configured number of quads.
+    float vertices[] =
+    {
+        0.0f, 0.0f, 0.0f,   1.0f, 0.0f, 0.0f, 1.0f,
+        1.0f, 0.0f, 0.0f,   0.0f, 1.0f, 0.0f, 1.0f,
+        0.0f, 1.0f, 0.0f,   0.0f, 0.0f, 1.0f, 1.0f,
+        1.0f, 1.0f, 0.0f,   1.0f, 1.0f, 1.0f, 1.0f
+    };
+    unsigned short indices[] = { 0, 1, 2, 2, 1, 3 };
+    _meshBatch->start();
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+        if (i > 0 && i % _batchQuads == 0)
+        {
+            _meshBatch->finish();
+            _meshBatch->start();
+        }
+        _meshBatch->add(vertices, 4, indices, 6);
+    }
+    _meshBatch->finish();
+}
+
+void MicrobenchGame::update(float elapsedTime)
+{
+    if (_finished)
+        return;
+
+    // Run every benchmark in the first frame, once the game is fully initialized.
+    for (size_t i = 0, count = _benchmarks.size(); i < count; ++i)
+        measure(_benchmarks[i]);
+    if (!_baseline.empty())
+        readBaseline();
+    writeResults();
+    _finished = true;
+    exit();
+}
+
+void MicrobenchGame::render(float elapsedTime)
+{
+    clear(CLEAR_COLOR_DEPTH, Vector4::zero(), 1.0f, 0);
+}
+
+void MicrobenchGame::readBaseline()
+{
+    // The results files have one benchmark on each line.
+    int length = 0;
+    char* text = FileSystem::readAll(_baseline.c_str(), &length);
+    if (text == NULL)
+    {
+        GP_WARN("Failed to read the microbenchmark baseline '%s'.", _baseline.c_str());
+        return;
+    }
+
+    std::string baseline(text, length);
+    SAFE_DELETE_ARRAY(text);
+    for (size_t i = 0, count = _benchmarks.size(); i < count; ++i)
+    {
+        std::string key("\"name\": \"" + _benchmarks[i].name + "\"");
+        size_t position = baseline.find(key);
+        if (position == std::string::npos)
+            continue;
+        size_t end = baseline.find('\n', position);
+        size_t minimum = baseline.find("\"min\": ", position);
+        if (minimum != std::string::npos && minimum < end)
+            _benchmarks[i].baseline = atof(baseline.c_str() + minimum + 7);
+    }
+}
+
+void MicrobenchGame::writeResults()
+{
+    std::string json;
+    appendFormat(json, "{\n  \"sampleTime\": %.3f,\n  \"samples\": %u,\n", _sampleTime, _sampleCount);
+#ifdef _DEBUG
+    json += "  \"debug\": true,\n";
+#else
+    json += "  \"debug\": false,\n";
+#endif
+    if (!_baseline.empty())
+        appendFormat(json, "  \"baseline\": \"%s\",\n  \"tolerance\": %.1f,\n", _baseline.c_str(), _tolerance);
+    json += "  \"unit\": \"ns\",\n  \"benchmarks\": [\n";
+    unsigned int regressions = 0;
+    for (size_t i = 0, count = _benchmarks.size(); i < count; ++i)
+    {
+        const Benchmark& benchmark = _benchmarks[i];
+        const std::vector<double>& samples = benchmark.samples;
+        double total = 0.0;
+        for (size_t j = 0; j < samples.size(); ++j)
+            total += samples[j];
+        double mean = samples.empty() ? 0.0 : total / samples.size();
+        double minimum = samples.empty() ? 0.0 : *std::min_element(samples.begin(), samples.end());
+        double maximum = samples.empty() ? 0.0 : *std::max_element(samples.begin(), samples.end());
+
+        appendFormat(json, "    { \"name\": \"%s\", \"size\": %u, \"iterations\": %u, ", benchmark.name.c_str(), benchmark.size, benchmark.iterations);
+        appendFormat(json, "\"min\": %.3f, \"median\": %.3f, \"mean\": %.3f, \"max\": %.3f", minimum, getMedian(samples), mean, maximum);
+        if (benchmark.baseline > 0.0)
+        {
+            double change = (minimum / benchmark.baseline - 1.0) * 100.0;
+            bool regression = change > _tolerance;
+            appendFormat(json, ", \"baseline\": %.3f, \"change\": %.1f, \"regression\": %s", benchmark.baseline, change, regression ? "true" : "false");
+            if (regression)
+            {
+                print("Microbench: %s regressed by %.1f%% (%.1f ns, was %.1f ns)\n", benchmark.name.c_str(), change, minimum, benchmark.baseline);
+                ++regressions;
+            }
+        }
+        appendFormat(json, " }%s\n", i + 1 < count ? "," : "");
+    }
+    json += "  ]";
+    if (!_baseline.empty())
+        appendFormat(json, ",\n  \"regressions\": %u", regressions);
+    json += "\n}\n";
+
+    if (writeFile(_output.c_str(), json))
+        print("Microbench: results written to %s\n", _output.c_str());
+}
+
+void MicrobenchGame::keyEvent(Keyboard::KeyEvent evt, int key)
+{
+    if (evt == Keyboard::KEY_PRESS && key == Keyboard::KEY_ESCAPE)
+    {
+        exit();
+    }
+}
@@ -0,0 +1,143 @@
+#ifndef MICROBENCHGAME_H_
+#define MICROBENCHGAME_H_
+
+#include "gameplay.h"
+
+using namespace gameplay;
+
+/**
+ * Microbenchmark game.
+ *
+ * Times the hot paths of the engine one function at a time, such as matrix math, curve
+ * evaluation, world matrices of deep hierarchies, parsing properties and loading bundles,
+ * and writes the time per call of each benchmark to a JSON file. Where the benchmark sample
+ * measures whole frames, these measure the functions that optimizations of the engine
+ * change, so that the results of two builds can be compared function by function.
+ *
+ * Each benchmark repeats its function until a sample takes at least the sample time, and
+ * takes several samples, whose minimum and median are the most stable to compare. The
+ * benchmarks to run and their sizes are set in game.config.
+ *
+ * The results can be compared with the results of an earlier run, which marks the benchmarks
+ * whose minimum time grew by more than a tolerance as regressions.
+ */
+class MicrobenchGame : public Game
+{
+public:
+
+    /**
+     * Constructor.
+     */
+    MicrobenchGame();
+
+    /**
+     * @see Game::keyEvent
+     */
+    void keyEvent(Keyboard::KeyEvent evt, int key);
+
+protected:
+
+    /**
+     * @see Game::initialize
+     */
+    void initialize();
+
+    /**
+     * @see Game::finalize
+     */
+    void finalize();
+
+    /**
+     * @see Game::update
+     */
+    void update(float elapsedTime);
+
+    /**
+     * @see Game::render
+     */
+    void render(float elapsedTime);
+
+private:
+
+    /**
+     * A function that runs a number of iterations of a benchmark.
+     */
+    typedef void (MicrobenchGame::*RunFunction)(unsigned int iterations);
+
+    /**
+     * A benchmark and its measurements, in nanoseconds per iteration.
+     */
+    struct Benchmark
+    {
+        std::string name;
+        RunFunction run;
+        unsigned int param;
+        unsigned int size;
+        unsigned int iterations;
+        std::vector<double> samples;
+        double baseline;
+    };
+
+    void addBenchmark(const char* name, RunFunction run, unsigned int param, unsigned int size);
+
+    bool isSelected(const char* name) const;
+
+    void measure(Benchmark& benchmark);
+
+    void setup();
+
+    void writeProperties();
+
+    void writeBundle();
+
+    void runMatrixMultiply(unsigned int iterations);
+
+    void runMatrixInvert(unsigned int iterations);
+
+    void runQuaternionSlerp(unsigned int iterations);
+
+    void runCurveEvaluate(unsigned int iterations);
+
+    void runTransformGetMatrix(unsigned int iterations);
+
+    void runNodeGetWorldMatrix(unsigned int iterations);
+
+    void runPropertiesCreate(unsigned int iterations);
+
+    void runBundleLoadScene(unsigned int iterations);
+
+    void runFontMeasureText(unsigned int iterations);
+
+    void runParticleEmitterUpdate(unsigned int iterations);
+
+    void runMeshBatchAdd(unsigned int iterations);
+
+    void readBaseline();
+
+    void writeResults();
+
+    std::vector<std::string> _filters;
+    std::vector<Benchmark> _benchmarks;
+    std::vector<Curve*> _curves;
+    unsigned int _param;
+    float _sampleTime;
+    unsigned int _sampleCount;
+    unsigned int _hierarchyDepth;
+    unsigned int _propertiesCount;
+    unsigned int _sceneNodes;
+    unsigned int _particles;
+    unsigned int _batchQuads;
+    Node* _rootNode;
+    Node* _leafNode;
+    Bundle* _bundle;
+    Font* _font;
+    Node* _emitterNode;
+    ParticleEmitter* _emitter;
+    MeshBatch* _meshBatch;
+    bool _finished;
+    std::string _baseline;
+    float _tolerance;
+    std::string _output;
+};
+
+#endif
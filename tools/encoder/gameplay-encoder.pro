@@ -16,6 +16,8 @@ SOURCES += src/Mesh.cpp \
     src/AnimationChannel.cpp \
     src/Animation.cpp \
     src/Animations.cpp \
+    src/AtlasEncoder.cpp \
+    src/BatchEncoder.cpp \
     src/Base.cpp \
     src/BoundingVolume.cpp \
     src/Camera.cpp \
@@ -33,24 +35,31 @@ SOURCES += src/Mesh.cpp \
     src/GPBFile.cpp \
     src/Heightmap.cpp \
     src/Image.cpp \
+    src/KTXEncoder.cpp \
     src/Light.cpp \
+    src/Lightmap.cpp \
     src/main.cpp \
     src/Material.cpp \
     src/MaterialParameter.cpp \
     src/Matrix.cpp \
+    src/MeshClusterizer.cpp \
+    src/MeshOptimizer.cpp \
     src/MeshPart.cpp \
+    src/MeshSimplifier.cpp \
     src/MeshSkin.cpp \
     src/MeshSubSet.cpp \
     src/Model.cpp \
     src/Node.cpp \
     src/NormalMapGenerator.cpp \
     src/Object.cpp \
+    src/PackEncoder.cpp \
     src/Quaternion.cpp \
     src/Reference.cpp \
     src/ReferenceTable.cpp \
     src/Sampler.cpp \
     src/Scene.cpp \
     src/StringUtil.cpp \
+    src/Thread.cpp \
     src/Transform.cpp \
     src/TTFFontEncoder.cpp \
     src/Vector2.cpp \
@@ -63,6 +72,8 @@ HEADERS += src/AnimationChannel.h \
     src/AnimationChannel.h \
     src/Animation.h \
     src/Animations.h \
+    src/AtlasEncoder.h \
+    src/BatchEncoder.h \
     src/Base.h \
     src/BoundingVolume.h \
     src/Camera.h \
@@ -81,18 +92,24 @@ HEADERS += src/AnimationChannel.h \
     src/GPBFile.h \
     src/Heightmap.h \
     src/Image.h \
+    src/KTXEncoder.h \
     src/Light.h \
+    src/Lightmap.h \
     src/Material.h \
     src/MaterialParameter.h \
     src/Matrix.h \
     src/Mesh.h \
+    src/MeshClusterizer.h \
+    src/MeshOptimizer.h \
     src/MeshPart.h \
+    src/MeshSimplifier.h \
     src/MeshSkin.h \
     src/MeshSubSet.h \
     src/Model.h \
     src/Node.h \
     src/NormalMapGenerator.h \
     src/Object.h \
+    src/PackEncoder.h \
     src/Quaternion.h \
     src/Quaternion.inl \
     src/Reference.h \
@@ -1,6 +1,21 @@
 #include "Base.h"
 #include "AnimationChannel.h"
 #include "Transform.h"
+#include "Quaternion.h"
+#include "EncoderArguments.h"
+
+// Animation channel formats
+#define ANIMATION_CHANNEL_KEYS              0
+#define ANIMATION_CHANNEL_COMPRESSED_KEYS   1
+
+// Quaternion offset of compressed channels without a rotation
+#define ANIMATION_NO_QUATERNION  0xFFFFFFFF
+
+// The largest quantized values of range components (16 bits) and quaternion components (15 bits)
+#define QUANTIZED_RANGE_MAX       65535.0f
+#define QUANTIZED_QUATERNION_MAX  32767.0f
+
+#define MATH_1_OVER_SQRT2 0.70710678118654752440f
 
 namespace gameplay
 {
@@ -28,6 +43,12 @@ void AnimationChannel::writeBinary(FILE* file)
     Object::writeBinary(file);
     write(_targetId, file);
     write(_targetAttrib, file);
+    if (EncoderArguments::getInstance()->compressAnimationsEnabled() && isCompressible())
+    {
+        writeCompressedBinary(file);
+        return;
+    }
+    write((unsigned int)ANIMATION_CHANNEL_KEYS, file);
     write((unsigned int)_keytimes.size(), file);
     for (std::vector<float>::const_iterator i = _keytimes.begin(); i != _keytimes.end(); ++i)
     {
@@ -39,6 +60,100 @@ void AnimationChannel::writeBinary(FILE* file)
     write(_interpolations, file);
 }
 
+void AnimationChannel::writeCompressedBinary(FILE* file)
+{
+    const size_t propSize = Transform::getPropertySize(_targetAttrib);
+    const size_t keyCount = _keytimes.size();
+    const int quaternionOffset = getQuaternionOffset();
+
+    LOG(3, "      Compressing %lu keyframes for channel with target attribute: %u.\n", keyCount, _targetAttrib);
+
+    // Find the range of each component that is not part of the rotation.
+    std::vector<float> ranges;
+    for (size_t c = 0; c < propSize; ++c)
+    {
+        if ((int)c == quaternionOffset)
+        {
+            c += 3;
+            continue;
+        }
+        float minValue = _keyValues[c];
+        float maxValue = _keyValues[c];
+        for (size_t i = 1; i < keyCount; ++i)
+        {
+            float value = _keyValues[i * propSize + c];
+            minValue = std::min(minValue, value);
+            maxValue = std::max(maxValue, value);
+        }
+        ranges.push_back(minValue);
+        ranges.push_back((maxValue - minValue) / QUANTIZED_RANGE_MAX);
+    }
+
+    std::vector<unsigned short> keyData;
+    keyData.reserve(keyCount * (quaternionOffset < 0 ? propSize : propSize - 1));
+    for (size_t i = 0; i < keyCount; ++i)
+    {
+        const float* value = &_keyValues[i * propSize];
+        size_t range = 0;
+        for (size_t c = 0; c < propSize; ++c)
+        {
+            if ((int)c == quaternionOffset)
+            {
+                // Store the three smallest components of the normalized rotation, with the index of
+                // the largest one in the low bits of the first two. The largest component is made
+                // positive, which does not change the rotation, so that it can be recovered.
+                float q[4] = { value[c], value[c + 1], value[c + 2], value[c + 3] };
+                float length = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+                unsigned int largest = 0;
+                for (unsigned int j = 0; j < 4; ++j)
+                {
+                    q[j] = length > 0.0f ? q[j] / length : (j == 3 ? 1.0f : 0.0f);
+                    if (fabs(q[j]) > fabs(q[largest]))
+                        largest = j;
+                }
+                float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+                unsigned short packed[3];
+                for (unsigned int j = 0, k = 0; j < 4; ++j)
+                {
+                    if (j == largest)
+                        continue;
+                    float u = (sign * q[j] / MATH_1_OVER_SQRT2 + 1.0f) * 0.5f;
+                    u = std::max(0.0f, std::min(1.0f, u));
+                    packed[k++] = (unsigned short)((unsigned int)(u * QUANTIZED_QUATERNION_MAX + 0.5f) << 1);
+                }
+                packed[0] |= (unsigned short)(largest & 1);
+                packed[1] |= (unsigned short)((largest >> 1) & 1);
+                keyData.push_back(packed[0]);
+                keyData.push_back(packed[1]);
+                keyData.push_back(packed[2]);
+                c += 3;
+            }
+            else
+            {
+                float step = ranges[range * 2 + 1];
+                float u = step > 0.0f ? (value[c] - ranges[range * 2]) / step : 0.0f;
+                keyData.push_back((unsigned short)std::max(0.0f, std::min(QUANTIZED_RANGE_MAX, u + 0.5f)));
+                ++range;
+            }
+        }
+    }
+
+    write((unsigned int)ANIMATION_CHANNEL_COMPRESSED_KEYS, file);
+    write((unsigned int)keyCount, file);
+    for (std::vector<float>::const_iterator i = _keytimes.begin(); i != _keytimes.end(); ++i)
+    {
+        write((unsigned int)*i, file);
+    }
+    write((unsigned int)propSize, file);
+    write(quaternionOffset < 0 ? (unsigned int)ANIMATION_NO_QUATERNION : (unsigned int)quaternionOffset, file);
+    write(ranges, file);
+    write((unsigned int)keyData.size(), file);
+    for (std::vector<unsigned short>::const_iterator i = keyData.begin(); i != keyData.end(); ++i)
+    {
+        write(*i, file);
+    }
+}
+
 void AnimationChannel::writeText(FILE* file)
 {
     fprintElementStart(file);
@@ -175,6 +290,189 @@ void AnimationChannel::removeDuplicates()
     LOG(3, "      Removed %d duplicate keyframes from channel.\n", startCount- _keytimes.size());
 }
 
+void AnimationChannel::reduceKeys(float translationTolerance, float rotationTolerance, float scaleTolerance)
+{
+    size_t propSize = Transform::getPropertySize(_targetAttrib);
+    if (propSize == 0 || _interpolations.size() != 1 || _interpolations[0] != LINEAR || _keytimes.size() < 3)
+        return;
+
+    LOG(3, "      Reducing keyframes for channel with target attribute: %u.\n", _targetAttrib);
+
+    std::vector<float> tolerances;
+    getComponentTolerances(translationTolerance, scaleTolerance, &tolerances);
+    const int quaternionOffset = getQuaternionOffset();
+
+    // Two unit quaternions are within the tolerance of each other when the cosine of half the
+    // angle between them, which is the absolute value of their dot product, is large enough.
+    const float minQuaternionDot = cos(MATH_DEG_TO_RAD(rotationTolerance) * 0.5f);
+
+    size_t startCount = _keytimes.size();
+    std::vector<float> value(propSize);
+    std::vector<float> keyTimes;
+    std::vector<float> keyValues;
+    keyTimes.push_back(_keytimes[0]);
+    keyValues.insert(keyValues.end(), _keyValues.begin(), _keyValues.begin() + propSize);
+
+    // Extend each segment from the last kept key for as long as interpolating across it
+    // reproduces every key that it skips.
+    size_t last = 0;
+    for (size_t i = 1; i + 1 < _keytimes.size(); ++i)
+    {
+        size_t next = i + 1;
+        bool reproduced = _keytimes[next] > _keytimes[last];
+        for (size_t k = last + 1; k < next && reproduced; ++k)
+        {
+            interpolate(last, next, _keytimes[k], &value[0]);
+            const float* original = &_keyValues[k * propSize];
+            for (size_t c = 0; c < propSize; ++c)
+            {
+                if (quaternionOffset >= 0 && c == (size_t)quaternionOffset)
+                {
+                    Quaternion q(value[c], value[c + 1], value[c + 2], value[c + 3]);
+                    Quaternion p(original[c], original[c + 1], original[c + 2], original[c + 3]);
+                    q.normalize();
+                    p.normalize();
+                    if (fabs(q.x * p.x + q.y * p.y + q.z * p.z + q.w * p.w) < minQuaternionDot)
+                    {
+                        reproduced = false;
+                        break;
+                    }
+                    c += 3;
+                }
+                else if (fabs(value[c] - original[c]) > tolerances[c])
+                {
+                    reproduced = false;
+                    break;
+                }
+            }
+        }
+        if (!reproduced)
+        {
+            last = i;
+            keyTimes.push_back(_keytimes[i]);
+            keyValues.insert(keyValues.end(), _keyValues.begin() + i * propSize, _keyValues.begin() + (i + 1) * propSize);
+        }
+    }
+    keyTimes.push_back(_keytimes.back());
+    keyValues.insert(keyValues.end(), _keyValues.end() - propSize, _keyValues.end());
+
+    _keytimes.swap(keyTimes);
+    _keyValues.swap(keyValues);
+
+    LOG(3, "      Removed %lu keyframes from channel.\n", startCount - _keytimes.size());
+}
+
+void AnimationChannel::resample(float rate)
+{
+    size_t propSize = Transform::getPropertySize(_targetAttrib);
+    if (rate <= 0.0f || propSize == 0 || _interpolations.size() != 1 || _interpolations[0] != LINEAR || _keytimes.size() < 3)
+        return;
+
+    // Key times are in milliseconds. The intervals are evened out so that the last key time is kept.
+    const float start = _keytimes.front();
+    const float duration = _keytimes.back() - start;
+    size_t intervalCount = (size_t)ceil(duration * rate / 1000.0f - 0.001f);
+    if (intervalCount < 1)
+        intervalCount = 1;
+    if (intervalCount + 1 >= _keytimes.size())
+        return;
+
+    LOG(3, "      Resampling %lu keyframes to %lu.\n", _keytimes.size(), intervalCount + 1);
+
+    std::vector<float> keyTimes(intervalCount + 1);
+    std::vector<float> keyValues((intervalCount + 1) * propSize);
+    size_t segment = 0;
+    for (size_t i = 0; i <= intervalCount; ++i)
+    {
+        float time = i == intervalCount ? _keytimes.back() : start + duration * (float)i / (float)intervalCount;
+        while (segment + 2 < _keytimes.size() && _keytimes[segment + 1] < time)
+            ++segment;
+        keyTimes[i] = time;
+        interpolate(segment, segment + 1, time, &keyValues[i * propSize]);
+    }
+
+    _keytimes.swap(keyTimes);
+    _keyValues.swap(keyValues);
+}
+
+void AnimationChannel::getComponentTolerances(float translationTolerance, float scaleTolerance, std::vector<float>* tolerances) const
+{
+    size_t propSize = Transform::getPropertySize(_targetAttrib);
+    tolerances->assign(propSize, translationTolerance);
+    switch (_targetAttrib)
+    {
+    case Transform::ANIMATE_SCALE:
+    case Transform::ANIMATE_SCALE_X:
+    case Transform::ANIMATE_SCALE_Y:
+    case Transform::ANIMATE_SCALE_Z:
+        tolerances->assign(propSize, scaleTolerance);
+        break;
+    case Transform::ANIMATE_SCALE_ROTATE_TRANSLATE:
+    case Transform::ANIMATE_SCALE_ROTATE:
+    case Transform::ANIMATE_SCALE_TRANSLATE:
+        std::fill(tolerances->begin(), tolerances->begin() + 3, scaleTolerance);
+        break;
+    default:
+        break;
+    }
+}
+
+void AnimationChannel::interpolate(size_t from, size_t to, float time, float* dst) const
+{
+    size_t propSize = Transform::getPropertySize(_targetAttrib);
+    const float* a = &_keyValues[from * propSize];
+    const float* b = &_keyValues[to * propSize];
+    float duration = _keytimes[to] - _keytimes[from];
+    float t = duration > 0.0f ? (time - _keytimes[from]) / duration : 0.0f;
+    int quaternionOffset = getQuaternionOffset();
+    for (size_t c = 0; c < propSize; ++c)
+    {
+        if (quaternionOffset >= 0 && c == (size_t)quaternionOffset)
+        {
+            Quaternion q;
+            Quaternion::slerp(Quaternion(a[c], a[c + 1], a[c + 2], a[c + 3]), Quaternion(b[c], b[c + 1], b[c + 2], b[c + 3]), t, &q);
+            dst[c] = q.x;
+            dst[c + 1] = q.y;
+            dst[c + 2] = q.z;
+            dst[c + 3] = q.w;
+            c += 3;
+        }
+        else
+        {
+            dst[c] = a[c] + (b[c] - a[c]) * t;
+        }
+    }
+}
+
+int AnimationChannel::getQuaternionOffset() const
+{
+    switch (_targetAttrib)
+    {
+    case Transform::ANIMATE_ROTATE:
+    case Transform::ANIMATE_ROTATE_TRANSLATE:
+        return 0;
+    case Transform::ANIMATE_SCALE_ROTATE:
+    case Transform::ANIMATE_SCALE_ROTATE_TRANSLATE:
+        return 3;
+    default:
+        return -1;
+    }
+}
+
+bool AnimationChannel::isCompressible() const
+{
+    // Tangents are not stored for compressed channels, so only linear channels can be compressed.
+    size_t propSize = Transform::getPropertySize(_targetAttrib);
+    if (propSize == 0 || _keytimes.empty() || _keyValues.size() != _keytimes.size() * propSize)
+        return false;
+    for (size_t i = 0, count = _interpolations.size(); i < count; ++i)
+    {
+        if (_interpolations[i] != LINEAR)
+            return false;
+    }
+    return true;
+}
+
 unsigned int AnimationChannel::getInterpolationType(const char* str)
 {
     unsigned int value = 0;
@@ -65,6 +65,26 @@ public:
      */
     void removeDuplicates();
 
+    /**
+     * Removes key frames that interpolating between the remaining key frames reproduces within
+     * the given tolerances. Rotations are interpolated spherically, so they are compared by the
+     * angle between the interpolated and the original rotation.
+     *
+     * @param translationTolerance The largest error allowed in a translation, in world units.
+     * @param rotationTolerance The largest error allowed in a rotation, in degrees.
+     * @param scaleTolerance The largest error allowed in any component of a scale.
+     */
+    void reduceKeys(float translationTolerance, float rotationTolerance, float scaleTolerance);
+
+    /**
+     * Resamples the key frames of a linear channel at a fixed rate, keeping the first and the
+     * last key frame. Channels that already have fewer key frames than the rate gives are left
+     * unchanged.
+     *
+     * @param rate The number of key frames per second.
+     */
+    void resample(float rate);
+
     /**
      * Returns the interpolation type value for the given string or zero if not valid.
      * Example: "LINEAR" returns AnimationChannel::LINEAR
@@ -86,6 +106,38 @@ private:
      */
     void deleteRange(size_t begin, size_t end, size_t propSize);
 
+    /**
+     * Returns the offset of the rotation within the key values of the channel, or -1 if there is none.
+     */
+    int getQuaternionOffset() const;
+
+    /**
+     * Returns the tolerance of each key value component of the channel. The tolerance of the
+     * rotation components is not used, since rotations are compared by angle.
+     */
+    void getComponentTolerances(float translationTolerance, float scaleTolerance, std::vector<float>* tolerances) const;
+
+    /**
+     * Interpolates between two key frames of the channel at the given time, in the same way that
+     * the runtime evaluates linear channels.
+     *
+     * @param from The index of the key frame to interpolate from.
+     * @param to The index of the key frame to interpolate to.
+     * @param time The key time to interpolate at.
+     * @param dst The key values to store the result in.
+     */
+    void interpolate(size_t from, size_t to, float time, float* dst) const;
+
+    /**
+     * Determines if the key values of the channel can be written quantized.
+     */
+    bool isCompressible() const;
+
+    /**
+     * Writes the key frames of the channel with quantized key values.
+     */
+    void writeCompressedBinary(FILE* file);
+
 private:
 
     std::string _targetId;
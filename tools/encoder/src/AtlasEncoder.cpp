@@ -0,0 +1,256 @@
+#include "Base.h"
+#include "AtlasEncoder.h"
+#include "Image.h"
+
+#ifdef WIN32
+    #include <windows.h>
+#else
+    #include <dirent.h>
+#endif
+
+// The number of transparent pixels between the images of an atlas
+#define ATLAS_PADDING   2
+// The smallest and the largest width of an atlas
+#define ATLAS_MIN_SIZE  32
+#define ATLAS_MAX_SIZE  8192
+
+namespace gameplay
+{
+
+struct AtlasImage
+{
+    std::string name;
+    Image* image;
+    unsigned int x;
+    unsigned int y;
+};
+
+static bool compareAtlasImage(const AtlasImage& a, const AtlasImage& b)
+{
+    if (a.image->getHeight() != b.image->getHeight())
+        return a.image->getHeight() > b.image->getHeight();
+    return a.name < b.name;
+}
+
+static bool isPNG(const std::string& name)
+{
+    if (name.length() < 4)
+        return false;
+    std::string ext = name.substr(name.length() - 4);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == ".png";
+}
+
+/**
+ * Appends the names of the PNG images in a directory, without its subdirectories.
+ */
+static bool listImages(const std::string& dir, std::vector<std::string>& files)
+{
+#ifdef WIN32
+    WIN32_FIND_DATAA data;
+    HANDLE handle = FindFirstFileA((dir + "/*").c_str(), &data);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+    do
+    {
+        std::string name(data.cFileName);
+        if (name[0] != '.' && !(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && isPNG(name))
+            files.push_back(name);
+    }
+    while (FindNextFileA(handle, &data));
+    FindClose(handle);
+#else
+    DIR* d = opendir(dir.c_str());
+    if (d == NULL)
+        return false;
+    struct dirent* entry;
+    while ((entry = readdir(d)) != NULL)
+    {
+        std::string name(entry->d_name);
+        if (name[0] == '.' || !isPNG(name))
+            continue;
+        struct stat s;
+        if (stat((dir + "/" + name).c_str(), &s) == 0 && S_ISREG(s.st_mode))
+            files.push_back(name);
+    }
+    closedir(d);
+#endif
+    return true;
+}
+
+/**
+ * Returns the name of the region of an image, which is used as a namespace id in the atlas description.
+ */
+static std::string getRegionName(const std::string& file)
+{
+    std::string name = file.substr(0, file.length() - 4);
+    for (size_t i = 0, length = name.length(); i < length; ++i)
+    {
+        if (!isalnum((unsigned char)name[i]) && name[i] != '_' && name[i] != '-')
+            name[i] = '_';
+    }
+    return name;
+}
+
+/**
+ * Places the images into rows of an atlas of the given size.
+ *
+ * @return true if all of the images fit, false otherwise.
+ */
+static bool packImages(std::vector<AtlasImage>& images, unsigned int width, unsigned int height)
+{
+    unsigned int x = 0;
+    unsigned int y = 0;
+    unsigned int rowHeight = 0;
+    for (size_t i = 0, count = images.size(); i < count; ++i)
+    {
+        AtlasImage& image = images[i];
+        unsigned int imageWidth = image.image->getWidth();
+        unsigned int imageHeight = image.image->getHeight();
+        if (x > 0 && x + imageWidth > width)
+        {
+            x = 0;
+            y += rowHeight + ATLAS_PADDING;
+            rowHeight = 0;
+        }
+        if (imageWidth > width || y + imageHeight > height)
+            return false;
+        image.x = x;
+        image.y = y;
+        x += imageWidth + ATLAS_PADDING;
+        rowHeight = std::max(rowHeight, imageHeight);
+    }
+    return true;
+}
+
+/**
+ * Copies an image into the RGBA pixels of the atlas.
+ */
+static void copyImage(const AtlasImage& image, unsigned char* atlas, unsigned int atlasWidth)
+{
+    const unsigned char* src = (const unsigned char*)image.image->getData();
+    unsigned int width = image.image->getWidth();
+    unsigned int height = image.image->getHeight();
+    unsigned int bpp = image.image->getBpp();
+    for (unsigned int y = 0; y < height; ++y)
+    {
+        unsigned char* dst = atlas + ((image.y + y) * atlasWidth + image.x) * 4;
+        for (unsigned int x = 0; x < width; ++x, src += bpp, dst += 4)
+        {
+            switch (image.image->getFormat())
+            {
+            case Image::LUMINANCE:
+                dst[0] = dst[1] = dst[2] = src[0];
+                dst[3] = 255;
+                break;
+            case Image::RGB:
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[2];
+                dst[3] = 255;
+                break;
+            case Image::RGBA:
+                memcpy(dst, src, 4);
+                break;
+            }
+        }
+    }
+}
+
+int writeAtlas(const char* dirPath, const char* outFilePath)
+{
+    std::string dir(dirPath);
+    while (dir.length() > 1 && (dir[dir.length() - 1] == '/' || dir[dir.length() - 1] == '\\'))
+        dir.erase(dir.length() - 1);
+
+    std::vector<std::string> files;
+    if (!listImages(dir, files) || files.empty())
+    {
+        LOG(1, "Error: No PNG images found in directory: %s\n", dirPath);
+        return -1;
+    }
+
+    std::vector<AtlasImage> images;
+    for (size_t i = 0, count = files.size(); i < count; ++i)
+    {
+        AtlasImage image;
+        image.name = getRegionName(files[i]);
+        image.image = Image::create((dir + "/" + files[i]).c_str());
+        image.x = 0;
+        image.y = 0;
+        if (image.image == NULL)
+        {
+            LOG(1, "Error: Failed to load image: %s\n", files[i].c_str());
+            for (size_t j = 0; j < images.size(); ++j)
+                delete images[j].image;
+            return -1;
+        }
+        images.push_back(image);
+    }
+    std::sort(images.begin(), images.end(), compareAtlasImage);
+
+    // Use the smallest atlas that the images fit into, trying a 2:1 rectangle before each square.
+    unsigned int width = 0;
+    unsigned int height = 0;
+    for (unsigned int size = ATLAS_MIN_SIZE; size <= ATLAS_MAX_SIZE && width == 0; size *= 2)
+    {
+        if (packImages(images, size, size / 2))
+        {
+            width = size;
+            height = size / 2;
+        }
+        else if (packImages(images, size, size))
+        {
+            width = size;
+            height = size;
+        }
+    }
+
+    int result = -1;
+    if (width == 0)
+    {
+        LOG(1, "Error: The images do not fit into a %dx%d atlas.\n", ATLAS_MAX_SIZE, ATLAS_MAX_SIZE);
+    }
+    else
+    {
+        Image* atlas = Image::create(Image::RGBA, width, height);
+        for (size_t i = 0, count = images.size(); i < count; ++i)
+            copyImage(images[i], (unsigned char*)atlas->getData(), width);
+
+        // The atlas image has the name of the description, so that the runtime finds it next to it.
+        std::string outPath(outFilePath);
+        size_t dot = outPath.find_last_of('.');
+        size_t slash = outPath.find_last_of("/\\");
+        std::string imagePath = (dot != std::string::npos && (slash == std::string::npos || dot > slash) ? outPath.substr(0, dot) : outPath) + ".png";
+        std::string imageName = slash == std::string::npos ? imagePath : imagePath.substr(slash + 1);
+        atlas->save(imagePath.c_str());
+        delete atlas;
+
+        FILE* file = fopen(outFilePath, "w");
+        if (file == NULL)
+        {
+            LOG(1, "Error: Failed to open file for writing: %s\n", outFilePath);
+        }
+        else
+        {
+            fprintf(file, "atlas\n{\n    image = %s\n    width = %u\n    height = %u\n", imageName.c_str(), width, height);
+            for (size_t i = 0, count = images.size(); i < count; ++i)
+            {
+                const AtlasImage& image = images[i];
+                fprintf(file, "\n    region %s\n    {\n        x = %u\n        y = %u\n        width = %u\n        height = %u\n    }\n",
+                        image.name.c_str(), image.x, image.y, image.image->getWidth(), image.image->getHeight());
+                LOG(2, "  %s (%ux%u at %u,%u)\n", image.name.c_str(), image.image->getWidth(), image.image->getHeight(), image.x, image.y);
+            }
+            fprintf(file, "}\n");
+            fclose(file);
+            LOG(1, "Wrote %ux%u atlas with %u images: %s\n", width, height, (unsigned int)images.size(), imagePath.c_str());
+            result = 0;
+        }
+    }
+
+    for (size_t i = 0, count = images.size(); i < count; ++i)
+        delete images[i].image;
+    return result;
+}
+
+}
@@ -0,0 +1,42 @@
+#ifndef ATLASENCODER_H_
+#define ATLASENCODER_H_
+
+namespace gameplay
+{
+
+/**
+ * Packs the PNG images of a directory into one atlas image and writes the atlas description.
+ *
+ * The images are packed into rows from the tallest to the shortest, with two pixels of
+ * padding between them, into the smallest power of two square or 2:1 rectangle that fits
+ * them. The atlas image is written as a PNG next to the description, with the same name.
+ *
+ * The description is a properties file that a sprite refers to with 'atlas' and 'region':
+ *
+ * atlas
+ * {
+ *     image = sprites.png
+ *     width = 512
+ *     height = 256
+ *     region hero
+ *     {
+ *         x = 0
+ *         y = 0
+ *         width = 64
+ *         height = 64
+ *     }
+ * }
+ *
+ * where each region is named after the image file without its extension, with the characters
+ * that cannot be used in a namespace id replaced by '_'.
+ *
+ * @param dirPath The directory of the images to pack.
+ * @param outFilePath The path of the atlas description to write.
+ *
+ * @return 0 if successful, -1 if error.
+ */
+int writeAtlas(const char* dirPath, const char* outFilePath);
+
+}
+
+#endif
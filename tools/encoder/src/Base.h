@@ -89,6 +89,17 @@ enum VertexUsage
     TEXCOORD7 = 15
 };
 
+enum VertexType
+{
+    VERTEX_TYPE_FLOAT = 0,
+    VERTEX_TYPE_HALF_FLOAT = 1,
+    VERTEX_TYPE_BYTE = 2,
+    VERTEX_TYPE_UNSIGNED_BYTE = 3,
+    VERTEX_TYPE_SHORT = 4,
+    VERTEX_TYPE_UNSIGNED_SHORT = 5,
+    VERTEX_TYPE_INT_2_10_10_10_REV = 6
+};
+
 void fillArray(float values[], float value, size_t length);
 
 /**
@@ -0,0 +1,408 @@
+#include "Base.h"
+#include "BatchEncoder.h"
+#include "EncoderArguments.h"
+#include "GPBFile.h"
+
+#ifdef WIN32
+    #include <windows.h>
+#else
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <sys/wait.h>
+#endif
+
+// The largest number of jobs that run at once, which is as many processes as Windows can wait for
+#define BATCH_MAX_JOBS 64
+
+#define FNV_OFFSET_BASIS 14695981039346656037ull
+#define FNV_PRIME 1099511628211ull
+
+namespace gameplay
+{
+
+#ifdef WIN32
+typedef HANDLE BatchProcess;
+#else
+typedef pid_t BatchProcess;
+#endif
+
+struct BatchJob
+{
+    std::vector<std::string> arguments;
+    std::string outputPath;
+    // The hash of the job, or empty if the job always runs.
+    std::string hash;
+    unsigned int line;
+};
+
+static void hashBytes(unsigned long long* hash, const void* data, size_t size)
+{
+    // 64-bit FNV-1a
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; ++i)
+    {
+        *hash ^= bytes[i];
+        *hash *= FNV_PRIME;
+    }
+}
+
+static bool hashFile(unsigned long long* hash, const std::string& path)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL)
+        return false;
+    unsigned char buffer[65536];
+    size_t size;
+    while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        hashBytes(hash, buffer, size);
+    }
+    fclose(file);
+    return true;
+}
+
+static std::string toHex(unsigned long long hash)
+{
+    char buffer[17];
+    sprintf(buffer, "%08x%08x", (unsigned int)(hash >> 32), (unsigned int)hash);
+    return buffer;
+}
+
+/**
+ * Splits a line of the manifest into arguments, separated by spaces unless they are in double quotes.
+ */
+static void splitArguments(const std::string& line, std::vector<std::string>& arguments)
+{
+    size_t i = 0;
+    while (i < line.size())
+    {
+        while (i < line.size() && isspace((unsigned char)line[i]))
+            ++i;
+        if (i == line.size())
+            break;
+        std::string argument;
+        bool quoted = false;
+        for (; i < line.size() && (quoted || !isspace((unsigned char)line[i])); ++i)
+        {
+            if (line[i] == '"')
+                quoted = !quoted;
+            else
+                argument += line[i];
+        }
+        arguments.push_back(argument);
+    }
+}
+
+/**
+ * Reads the hashes of the jobs that succeeded in the last batch, by their output path.
+ */
+static void readCache(const std::string& path, std::map<std::string, std::string>& cache)
+{
+    std::ifstream file(path.c_str());
+    std::string line;
+    while (std::getline(file, line))
+    {
+        size_t separator = line.find(' ');
+        if (separator != std::string::npos)
+            cache[line.substr(separator + 1)] = line.substr(0, separator);
+    }
+}
+
+static void writeCache(const std::string& path, const std::map<std::string, std::string>& cache)
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == NULL)
+    {
+        LOG(1, "Warning: Failed to write batch cache: %s\n", path.c_str());
+        return;
+    }
+    for (std::map<std::string, std::string>::const_iterator i = cache.begin(); i != cache.end(); ++i)
+    {
+        fprintf(file, "%s %s\n", i->second.c_str(), i->first.c_str());
+    }
+    fclose(file);
+}
+
+static std::string getExecutablePath(const char* argv0)
+{
+#ifdef WIN32
+    char path[MAX_PATH];
+    DWORD length = GetModuleFileNameA(NULL, path, MAX_PATH);
+    if (length > 0 && length < MAX_PATH)
+        return std::string(path, length);
+#elif defined(__linux__)
+    char path[4096];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path));
+    if (length > 0 && length < (ssize_t)sizeof(path))
+        return std::string(path, length);
+#endif
+    return argv0;
+}
+
+static unsigned int getCpuCount()
+{
+#ifdef WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (unsigned int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (unsigned int)count : 1;
+#endif
+}
+
+#ifdef WIN32
+/**
+ * Quotes an argument for a command line, as the C runtime splits it.
+ */
+static std::string quoteArgument(const std::string& argument)
+{
+    std::string quoted("\"");
+    size_t backslashes = 0;
+    for (size_t i = 0; i < argument.size(); ++i)
+    {
+        if (argument[i] == '\\')
+        {
+            ++backslashes;
+            continue;
+        }
+        // Backslashes are only escaped in front of a quote.
+        quoted.append(argument[i] == '"' ? backslashes * 2 + 1 : backslashes, '\\');
+        quoted += argument[i];
+        backslashes = 0;
+    }
+    quoted.append(backslashes * 2, '\\');
+    quoted += '"';
+    return quoted;
+}
+#endif
+
+/**
+ * Starts a process of the encoder for a job, which reads nothing from the console.
+ */
+static bool startProcess(const std::string& executable, const std::vector<std::string>& arguments, BatchProcess* process)
+{
+#ifdef WIN32
+    std::string commandLine = quoteArgument(executable);
+    for (size_t i = 0; i < arguments.size(); ++i)
+    {
+        commandLine += " " + quoteArgument(arguments[i]);
+    }
+    std::vector<char> buffer(commandLine.begin(), commandLine.end());
+    buffer.push_back('\0');
+
+    SECURITY_ATTRIBUTES security = { sizeof(SECURITY_ATTRIBUTES), NULL, TRUE };
+    HANDLE input = CreateFileA("NUL", GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, &security, OPEN_EXISTING, 0, NULL);
+    STARTUPINFOA startup;
+    ZeroMemory(&startup, sizeof(startup));
+    startup.cb = sizeof(startup);
+    startup.dwFlags = STARTF_USESTDHANDLES;
+    startup.hStdInput = input;
+    startup.hStdOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+    startup.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+    PROCESS_INFORMATION info;
+    BOOL result = CreateProcessA(executable.c_str(), &buffer[0], NULL, NULL, TRUE, 0, NULL, NULL, &startup, &info);
+    if (input != INVALID_HANDLE_VALUE)
+        CloseHandle(input);
+    if (!result)
+        return false;
+    CloseHandle(info.hThread);
+    *process = info.hProcess;
+    return true;
+#else
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(executable.c_str()));
+    for (size_t i = 0; i < arguments.size(); ++i)
+    {
+        argv.push_back(const_cast<char*>(arguments[i].c_str()));
+    }
+    argv.push_back(NULL);
+
+    pid_t pid = fork();
+    if (pid < 0)
+        return false;
+    if (pid == 0)
+    {
+        int input = open("/dev/null", O_RDONLY);
+        if (input >= 0)
+        {
+            dup2(input, STDIN_FILENO);
+            close(input);
+        }
+        execvp(argv[0], &argv[0]);
+        _exit(127);
+    }
+    *process = pid;
+    return true;
+#endif
+}
+
+/**
+ * Waits for one of the processes to finish, and returns its index in the list and whether it succeeded.
+ */
+static bool waitProcess(const std::vector<BatchProcess>& processes, size_t* index, bool* succeeded)
+{
+#ifdef WIN32
+    DWORD result = WaitForMultipleObjects((DWORD)processes.size(), &processes[0], FALSE, INFINITE);
+    if (result < WAIT_OBJECT_0 || result >= WAIT_OBJECT_0 + processes.size())
+        return false;
+    *index = result - WAIT_OBJECT_0;
+    DWORD exitCode = 1;
+    GetExitCodeProcess(processes[*index], &exitCode);
+    CloseHandle(processes[*index]);
+    *succeeded = exitCode == 0;
+    return true;
+#else
+    for (;;)
+    {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0)
+            return false;
+        std::vector<BatchProcess>::const_iterator i = std::find(processes.begin(), processes.end(), pid);
+        if (i != processes.end())
+        {
+            *index = i - processes.begin();
+            *succeeded = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+            return true;
+        }
+    }
+#endif
+}
+
+int writeBatch(const char* manifestPath, const char* executablePath, unsigned int jobCount, const char* profile)
+{
+    std::ifstream manifest(manifestPath);
+    if (!manifest)
+    {
+        LOG(1, "Error: Failed to open manifest: %s\n", manifestPath);
+        return -1;
+    }
+
+    // A new encoder or bundle version invalidates all of the jobs.
+    const std::string executable = getExecutablePath(executablePath);
+    unsigned long long encoderHash = FNV_OFFSET_BASIS;
+    hashBytes(&encoderHash, GPB_VERSION, sizeof(GPB_VERSION));
+    hashFile(&encoderHash, executable);
+
+    const std::string cachePath = std::string(manifestPath) + ".cache";
+    std::map<std::string, std::string> cache;
+    std::map<std::string, std::string> newCache;
+    readCache(cachePath, cache);
+
+    std::vector<BatchJob> jobs;
+    unsigned int upToDate = 0;
+    unsigned int failed = 0;
+    std::string line;
+    for (unsigned int lineNumber = 1; std::getline(manifest, line); ++lineNumber)
+    {
+        BatchJob job;
+        job.line = lineNumber;
+        splitArguments(line, job.arguments);
+        if (job.arguments.empty() || job.arguments[0][0] == '#')
+            continue;
+        if (profile && *profile)
+        {
+            job.arguments.insert(job.arguments.begin(), profile);
+            job.arguments.insert(job.arguments.begin(), "-profile");
+        }
+
+        // Parse the job as its process will, to find its input and output files. Parsing
+        // changes the verbosity if the job sets it, which is only meant for the job.
+        std::vector<const char*> argv(1, executablePath);
+        for (size_t i = 0; i < job.arguments.size(); ++i)
+        {
+            argv.push_back(job.arguments[i].c_str());
+        }
+        int verbosity = __logVerbosity;
+        EncoderArguments arguments(argv.size(), &argv[0]);
+        __logVerbosity = verbosity;
+        if (arguments.parseErrorOccured() || arguments.batchEnabled() || !arguments.fileExists())
+        {
+            LOG(1, "Error: Invalid job on line %u of %s\n", lineNumber, manifestPath);
+            ++failed;
+            continue;
+        }
+        job.outputPath = arguments.getOutputFilePath();
+
+        if (!arguments.packEnabled() && !arguments.atlasEnabled())
+        {
+            unsigned long long hash = encoderHash;
+            for (size_t i = 0; i < job.arguments.size(); ++i)
+            {
+                hashBytes(&hash, job.arguments[i].c_str(), job.arguments[i].size() + 1);
+            }
+            if (hashFile(&hash, arguments.getFilePath()))
+                job.hash = toHex(hash);
+        }
+
+        struct stat s;
+        if (!job.hash.empty() && cache[job.outputPath] == job.hash && stat(job.outputPath.c_str(), &s) == 0)
+        {
+            LOG(2, "Up to date: %s\n", job.outputPath.c_str());
+            newCache[job.outputPath] = job.hash;
+            ++upToDate;
+            continue;
+        }
+        jobs.push_back(job);
+    }
+
+    if (jobCount == 0)
+        jobCount = getCpuCount();
+    jobCount = std::min(jobCount, (unsigned int)BATCH_MAX_JOBS);
+
+    // Start jobs while fewer than jobCount run, and record the jobs that succeed as they finish.
+    std::vector<BatchProcess> processes;
+    std::vector<size_t> running;
+    unsigned int encoded = 0;
+    size_t next = 0;
+    while (next < jobs.size() || !processes.empty())
+    {
+        while (next < jobs.size() && processes.size() < jobCount)
+        {
+            BatchProcess process;
+            if (startProcess(executable, jobs[next].arguments, &process))
+            {
+                processes.push_back(process);
+                running.push_back(next);
+            }
+            else
+            {
+                LOG(1, "Error: Failed to start the job on line %u of %s\n", jobs[next].line, manifestPath);
+                ++failed;
+            }
+            ++next;
+        }
+        if (processes.empty())
+            continue;
+
+        size_t index;
+        bool succeeded;
+        if (!waitProcess(processes, &index, &succeeded))
+        {
+            LOG(1, "Error: Failed to wait for batch jobs.\n");
+            failed += processes.size() + (jobs.size() - next);
+            break;
+        }
+        const BatchJob& job = jobs[running[index]];
+        if (succeeded)
+        {
+            if (!job.hash.empty())
+                newCache[job.outputPath] = job.hash;
+            ++encoded;
+        }
+        else
+        {
+            LOG(1, "Error: The job on line %u of %s failed.\n", job.line, manifestPath);
+            ++failed;
+        }
+        processes.erase(processes.begin() + index);
+        running.erase(running.begin() + index);
+    }
+
+    writeCache(cachePath, newCache);
+    LOG(1, "Batch finished: %u encoded, %u up to date, %u failed.\n", encoded, upToDate, failed);
+    return failed > 0 ? -1 : 0;
+}
+
+}
@@ -0,0 +1,41 @@
+#ifndef BATCHENCODER_H_
+#define BATCHENCODER_H_
+
+namespace gameplay
+{
+
+/**
+ * Encodes the jobs listed in a manifest, in parallel processes of the encoder.
+ *
+ * Each line of the manifest is a job with the options and file paths of a single invocation of
+ * the encoder, such as "-m -om models/duck.fbx res/duck.gpb". Arguments are separated by spaces,
+ * arguments with spaces can be enclosed in double quotes, and empty lines and lines that start
+ * with '#' are ignored. Paths are relative to the current directory.
+ *
+ * Each job runs in its own process, since the encoder keeps the file that it writes and its
+ * options in singletons, and up to jobCount jobs run at once. Jobs read nothing from the console,
+ * so jobs that would prompt for animation grouping take the default answer; use -g:auto or
+ * -g:off to choose it.
+ *
+ * A job is skipped if its output exists and the hash of its arguments, of its input file and
+ * of the encoder itself matches the hash recorded in "<manifest>.cache" when it last succeeded.
+ * Files that the input refers to (such as textures) are not part of the hash, and jobs whose
+ * input is a directory (-pack and -atlas) always run.
+ *
+ * A profile encodes every job for a class of target devices, as if each job started with
+ * "-profile <name>", so a job can still set its own. The profile is part of the hash of the
+ * jobs, so encoding a manifest for another profile encodes all of its jobs again; manifests
+ * that write the assets of each platform to their own directories keep their outputs apart.
+ *
+ * @param manifestPath The path of the manifest.
+ * @param executablePath The path that the encoder was started with.
+ * @param jobCount The number of jobs to run at once, or zero to run one for each CPU.
+ * @param profile The profile to encode the jobs for, or an empty string for none.
+ *
+ * @return 0 if all jobs succeeded or were up to date, -1 otherwise.
+ */
+int writeBatch(const char* manifestPath, const char* executablePath, unsigned int jobCount, const char* profile);
+
+}
+
+#endif
@@ -13,9 +13,68 @@
 #define ENCODER_VERSION "3.0.0"
 #define HEIGHTMAP_SIZE_MAX 2049
 
+#define VERTEX_ATTRIBUTE_BIT(usage) (1u << (usage))
+#define EXTRA_TEXCOORD_BITS (VERTEX_ATTRIBUTE_BIT(TEXCOORD2) | VERTEX_ATTRIBUTE_BIT(TEXCOORD3) | VERTEX_ATTRIBUTE_BIT(TEXCOORD4) | \
+    VERTEX_ATTRIBUTE_BIT(TEXCOORD5) | VERTEX_ATTRIBUTE_BIT(TEXCOORD6) | VERTEX_ATTRIBUTE_BIT(TEXCOORD7))
+
 namespace gameplay
 {
 
+/**
+ * The assets that a class of target devices uses, which -profile selects.
+ */
+struct EncoderProfile
+{
+    const char* name;
+    unsigned int maxTextureSize;
+    bool ktx;
+    bool quantizeVertices;
+    unsigned int strippedAttributes;
+};
+
+static const EncoderProfile PROFILES[] =
+{
+    { "desktop", 4096, false, false, 0 },
+    { "high", 2048, true, true, 0 },
+    { "mid", 1024, true, true, EXTRA_TEXCOORD_BITS },
+    { "mobile", 1024, true, true, EXTRA_TEXCOORD_BITS },
+    { "low", 512, true, true, EXTRA_TEXCOORD_BITS | VERTEX_ATTRIBUTE_BIT(TANGENT) | VERTEX_ATTRIBUTE_BIT(BINORMAL) }
+};
+
+/**
+ * The names of the vertex attributes that -strip accepts.
+ */
+static const struct
+{
+    const char* name;
+    VertexUsage usage;
+}
+STRIPPABLE_ATTRIBUTES[] =
+{
+    { "normal", NORMAL },
+    { "tangent", TANGENT },
+    { "binormal", BINORMAL },
+    { "color", COLOR },
+    { "texcoord0", TEXCOORD0 },
+    { "texcoord1", TEXCOORD1 },
+    { "texcoord2", TEXCOORD2 },
+    { "texcoord3", TEXCOORD3 },
+    { "texcoord4", TEXCOORD4 },
+    { "texcoord5", TEXCOORD5 },
+    { "texcoord6", TEXCOORD6 },
+    { "texcoord7", TEXCOORD7 }
+};
+
+static const EncoderProfile* findProfile(const std::string& name)
+{
+    for (size_t i = 0; i < sizeof(PROFILES) / sizeof(PROFILES[0]); ++i)
+    {
+        if (name == PROFILES[i].name)
+            return &PROFILES[i];
+    }
+    return NULL;
+}
+
 static EncoderArguments* __instance;
 
 extern int __logVerbosity = 1;
@@ -27,8 +86,29 @@ EncoderArguments::EncoderArguments(size_t argc, const char** argv) :
     _fontFormat(Font::BITMAP),
     _textOutput(false),
     _optimizeAnimations(false),
+    _translationTolerance(0.0001f),
+    _rotationTolerance(0.01f),
+    _scaleTolerance(0.0001f),
+    _animationSampleRate(0.0f),
+    _optimizeMeshes(false),
+    _lodCount(0),
+    _compressAnimations(false),
+    _mergeStatic(false),
+    _mergeCellSize(0.0f),
+    _lightmapSize(0),
+    _clusterMeshes(false),
+    _quantizeVertices(false),
     _animationGrouping(ANIMATIONGROUP_PROMPT),
-    _outputMaterial(false)
+    _outputMaterial(false),
+    _weldEpsilon(0.0f),
+    _pack(false),
+    _manifest(false),
+    _ktx(false),
+    _atlas(false),
+    _batch(false),
+    _jobCount(0),
+    _maxTextureSize(0),
+    _strippedAttributes(0)
 {
     __instance = this;
 
@@ -51,6 +131,18 @@ EncoderArguments::EncoderArguments(size_t argc, const char** argv) :
                 index = i + 1;
             }
         }
+
+        // The profile fills in what the options leave unset, before the output extension is known.
+        if (!_profile.empty())
+        {
+            const EncoderProfile* profile = findProfile(_profile);
+            if (_maxTextureSize == 0)
+                _maxTextureSize = profile->maxTextureSize;
+            _ktx = _ktx || profile->ktx;
+            _quantizeVertices = _quantizeVertices || profile->quantizeVertices;
+            _strippedAttributes |= profile->strippedAttributes;
+        }
+
         if (arguments.size() - index == 2)
         {
             setInputfilePath(arguments[index]);
@@ -102,12 +194,23 @@ std::string EncoderArguments::getOutputDirPath() const
 
 std::string EncoderArguments::getOutputFileExtension() const
 {
+    if (_pack)
+        return ".gpk";
+    if (_manifest)
+        return ".manifest";
+    if (_atlas)
+        return ".atlas";
+
     switch (getFileFormat())
     {
     case FILEFORMAT_PNG:
     case FILEFORMAT_RAW:
         if (_normalMap)
             return ".png";
+        if (_ktx)
+            return ".ktx2";
+        if (_maxTextureSize > 0)
+            return ".png";
 
     default:
         return ".gpb";
@@ -124,6 +227,9 @@ std::string EncoderArguments::getOutputFilePath() const
     else
     {
         // Generate an output file path
+        if (_pack || _manifest || _atlas)
+            return _filePath + getOutputFileExtension();
+
         int pos = _filePath.find_last_of('.');
         std::string outputFilePath(pos > 0 ? _filePath.substr(0, pos) : _filePath);
 
@@ -132,6 +238,14 @@ std::string EncoderArguments::getOutputFilePath() const
         {
             outputFilePath.append("_normalmap");
         }
+        else if (!_ktx && _maxTextureSize > 0 && getFileFormat() == FILEFORMAT_PNG)
+        {
+            // Resized images are suffixed with their profile, or their largest size.
+            char size[16];
+            sprintf(size, "%u", _maxTextureSize);
+            outputFilePath.append("_");
+            outputFilePath.append(_profile.empty() ? size : _profile.c_str());
+        }
 
         outputFilePath.append(getOutputFileExtension());
         return outputFilePath;
@@ -244,6 +358,15 @@ void EncoderArguments::printUsage() const
     "\n" \
     "General options:\n" \
     "  -v <verbosity>\tVerbosity level (0-4).\n" \
+    "  -profile <name>\n" \
+        "\t\tEncodes assets for a class of target devices. Each profile sets\n" \
+        "\t\tthe options below that are not given explicitly:\n" \
+        "\t\t  desktop  -maxTextureSize 4096\n" \
+        "\t\t  high     -maxTextureSize 2048 -ktx -qv\n" \
+        "\t\t  mid      -maxTextureSize 1024 -ktx -qv\n" \
+        "\t\t           -strip texcoord2,...,texcoord7 (also 'mobile')\n" \
+        "\t\t  low      -maxTextureSize 512 -ktx -qv\n" \
+        "\t\t           -strip tangent,binormal,texcoord2,...,texcoord7\n" \
     "\n" \
     "FBX file options:\n" \
     "  -i <id>\tFilter by node ID.\n" \
@@ -254,6 +377,10 @@ void EncoderArguments::printUsage() const
         "\t\tGroup all animation channels targeting the nodes into a \n" \
         "\t\tnew animation.\n" \
     "  -m\t\tOutput material file for scene.\n" \
+    "  -weld <epsilon>\n" \
+        "\t\tWelds the vertices of meshes whose components are equal when they\n" \
+        "\t\tare rounded to a multiple of epsilon. By default only vertices that\n" \
+        "\t\tare exactly equal are welded.\n" \
     "  -tb <node id>\n" \
         "\t\tGenerates tangents and binormals for the given node.\n" \
     "  -oa\n" \
@@ -261,6 +388,61 @@ void EncoderArguments::printUsage() const
         "\t\tremoving any channels that contain default/identity values\n" \
         "\t\tand removing any duplicate contiguous keyframes, which are \n" \
         "\t\tcommon when exporting baked animation data.\n" \
+        "\t\tAlso removes keyframes that can be reproduced by interpolating\n" \
+        "\t\tbetween their neighbours within the tolerances below.\n" \
+    "  -oa:t <units>\n" \
+        "\t\tThe largest error in world units that removing keyframes may add\n" \
+        "\t\tto a translation. Defaults to 0.0001. Implies -oa.\n" \
+    "  -oa:r <degrees>\n" \
+        "\t\tThe largest error in degrees that removing keyframes may add to\n" \
+        "\t\ta rotation. Defaults to 0.01. Implies -oa.\n" \
+    "  -oa:s <tolerance>\n" \
+        "\t\tThe largest error that removing keyframes may add to a scale.\n" \
+        "\t\tDefaults to 0.0001. Implies -oa.\n" \
+    "  -oa:rate <keyframes per second>\n" \
+        "\t\tResamples linear animation channels that have more keyframes\n" \
+        "\t\tthan the rate gives before keyframes are removed. Implies -oa.\n" \
+    "  -lod <count>\n" \
+        "\t\tGenerates levels of detail for meshes, each with half of the\n" \
+        "\t\ttriangles of the previous level, which are drawn in place of\n" \
+        "\t\tthe mesh when it is small on screen.\n" \
+    "  -om\n" \
+        "\t\tOptimizes meshes by reordering their triangles for the post-transform\n" \
+        "\t\tvertex cache and for less overdraw, and reordering their vertices\n" \
+        "\t\tin the order that they are first used.\n" \
+    "  -ca\n" \
+        "\t\tCompresses linear animation channels by quantizing their key\n" \
+        "\t\tvalues to 16 bits. Rotations are stored as three components.\n" \
+    "  -mergeStatic <cell size>\n" \
+        "\t\tMerges the meshes of nodes that are not animated or skinned into\n" \
+        "\t\tone mesh for each material and each cell of a grid with the given\n" \
+        "\t\tcell size, on new nodes at the root of the scene. A size of 0\n" \
+        "\t\tmerges each material into one mesh. Meshes of up to 65536 vertices\n" \
+        "\t\tare merged, and the nodes are kept without their models.\n" \
+    "  -lightmap <size>\n" \
+        "\t\tBakes the light of the directional, point, spot and ambient\n" \
+        "\t\tlights into a lightmap of <size>x<size> texels for the meshes of\n" \
+        "\t\tnodes that are not animated or skinned, saved beside the output\n" \
+        "\t\tfile as <name>.lightmap.png. The meshes get lightmap coordinates\n" \
+        "\t\t(TEXCOORD1), and their materials the LIGHTMAP define and the\n" \
+        "\t\tu_lightmapTexture sampler, which -m writes. With -qv, sizes\n" \
+        "\t\tabove 1024 lose precision in the half float coordinates.\n" \
+    "  -cl\n" \
+        "\t\tSplits the triangles of meshes into clusters of up to 64 vertices\n" \
+        "\t\tand 124 triangles, with bounding spheres and normal cones that the\n" \
+        "\t\truntime culls clusters with. Triangles keep their order, so use\n" \
+        "\t\tit with -om for clusters that are both compact and cache friendly.\n" \
+    "  -qv\n" \
+        "\t\tQuantizes the vertices of meshes: positions to 16 bits relative to\n" \
+        "\t\tthe bounds of each mesh, normals, tangents and binormals to two\n" \
+        "\t\toctahedral 16-bit components, texture coordinates to half floats,\n" \
+        "\t\tand blend weights and indices to 8 bits. Materials that draw the\n" \
+        "\t\tmeshes need the QUANTIZED_POSITION and OCTAHEDRAL_NORMAL defines,\n" \
+        "\t\twhich are added to the materials output with -m.\n" \
+    "  -strip <attributes>\n" \
+        "\t\tLeaves the comma-separated vertex attributes out of meshes, which\n" \
+        "\t\tthen weld into fewer vertices: normal, tangent, binormal, color\n" \
+        "\t\tand texcoord0 to texcoord7.\n" \
     "  -h <size> \"<node ids>\" <filename>\n" \
         "\t\tGenerates a single heightmap image using meshes from the \n" \
         "\t\tspecified nodes. \n" \
@@ -290,6 +472,38 @@ void EncoderArguments::printUsage() const
     "  -s <sizes>\tComma-separated list of font sizes (in pixels).\n" \
     "  -p\t\tOutput font preview.\n" \
     "  -f\t\tFormat of font. -f:b (BITMAP), -f:d (DISTANCE_FIELD).\n" \
+    "\n" \
+    "Texture options:\n" \
+    "  -ktx\t\tConvert a PNG image into a KTX2 texture (.ktx2) compressed\n" \
+        "\t\twith ETC2, along with a full mipmap chain. Images with\n" \
+        "\t\ttransparent pixels use ETC2 RGBA8 (EAC alpha), others ETC2 RGB8.\n" \
+    "  -maxTextureSize <size>\n" \
+        "\t\tHalves PNG images with a box filter until their width and height\n" \
+        "\t\tare at most <size>. Without -ktx the image is written as a PNG\n" \
+        "\t\tsuffixed with the profile, or with the size.\n" \
+    "\n" \
+    "Pack options:\n" \
+    "  -pack\t\tPack all files of the input directory into an archive (.gpk)\n" \
+        "\t\tthat can be mounted with FileSystem::mountArchive. Files are\n" \
+        "\t\tcompressed when that makes them noticeably smaller.\n" \
+    "  -manifest\tList the files of the input directory, with their sizes and\n" \
+        "\t\tcontent hashes, in an asset manifest (.manifest) that can be\n" \
+        "\t\tloaded with FileSystem::loadManifest.\n" \
+    "\n" \
+    "Atlas options:\n" \
+    "  -atlas\tPack the PNG images of the input directory into an atlas\n" \
+        "\t\timage (.png) and its description (.atlas), which sprites\n" \
+        "\t\tdraw from with their 'atlas' and 'region' properties.\n" \
+    "\n" \
+    "Batch options:\n" \
+    "  -batch\tEncode the jobs listed in the input manifest, one per line,\n" \
+        "\t\teach with the options and file paths of a single invocation.\n" \
+        "\t\tJobs run in parallel processes, and a job is skipped if its\n" \
+        "\t\toutput exists and its input, options and encoder are unchanged\n" \
+        "\t\tsince the last batch, as recorded in <manifest>.cache.\n" \
+    "  -j <count>\tNumber of jobs to run at once (default: number of CPUs).\n" \
+    "  -profile <name>\n" \
+        "\t\tEncodes every job for the profile, unless the job sets its own.\n" \
     "\n");
     exit(8);
 }
@@ -314,11 +528,121 @@ bool EncoderArguments::optimizeAnimationsEnabled() const
     return _optimizeAnimations;
 }
 
+float EncoderArguments::getTranslationTolerance() const
+{
+    return _translationTolerance;
+}
+
+float EncoderArguments::getRotationTolerance() const
+{
+    return _rotationTolerance;
+}
+
+float EncoderArguments::getScaleTolerance() const
+{
+    return _scaleTolerance;
+}
+
+float EncoderArguments::getAnimationSampleRate() const
+{
+    return _animationSampleRate;
+}
+
+bool EncoderArguments::optimizeMeshesEnabled() const
+{
+    return _optimizeMeshes;
+}
+
+unsigned int EncoderArguments::getLodCount() const
+{
+    return _lodCount;
+}
+
+bool EncoderArguments::compressAnimationsEnabled() const
+{
+    return _compressAnimations;
+}
+
+bool EncoderArguments::mergeStaticEnabled() const
+{
+    return _mergeStatic;
+}
+
+float EncoderArguments::getMergeCellSize() const
+{
+    return _mergeCellSize;
+}
+
+unsigned int EncoderArguments::getLightmapSize() const
+{
+    return _lightmapSize;
+}
+
+bool EncoderArguments::clusterMeshesEnabled() const
+{
+    return _clusterMeshes;
+}
+
+bool EncoderArguments::quantizeVerticesEnabled() const
+{
+    return _quantizeVertices;
+}
+
 bool EncoderArguments::outputMaterialEnabled() const
 {
     return _outputMaterial;
 }
 
+float EncoderArguments::getWeldEpsilon() const
+{
+    return _weldEpsilon;
+}
+
+bool EncoderArguments::packEnabled() const
+{
+    return _pack;
+}
+
+bool EncoderArguments::manifestEnabled() const
+{
+    return _manifest;
+}
+
+bool EncoderArguments::ktxEnabled() const
+{
+    return _ktx;
+}
+
+bool EncoderArguments::atlasEnabled() const
+{
+    return _atlas;
+}
+
+bool EncoderArguments::batchEnabled() const
+{
+    return _batch;
+}
+
+unsigned int EncoderArguments::getJobCount() const
+{
+    return _jobCount;
+}
+
+const std::string& EncoderArguments::getProfile() const
+{
+    return _profile;
+}
+
+unsigned int EncoderArguments::getMaxTextureSize() const
+{
+    return _maxTextureSize;
+}
+
+bool EncoderArguments::isVertexAttributeStripped(unsigned int usage) const
+{
+    return usage < 32 && (_strippedAttributes & VERTEX_ATTRIBUTE_BIT(usage)) != 0;
+}
+
 const char* EncoderArguments::getNodeId() const
 {
     if (_nodeId.length() == 0)
@@ -387,6 +711,20 @@ void EncoderArguments::readOption(const std::vector<std::string>& options, size_
     }
     switch (str[1])
     {
+    case 'a':
+        if (str.compare("-atlas") == 0)
+        {
+            // Pack the images of a directory into an atlas
+            _atlas = true;
+        }
+        break;
+    case 'b':
+        if (str.compare("-batch") == 0)
+        {
+            // Encode the files listed in a manifest
+            _batch = true;
+        }
+        break;
     case 'f':
         if (str.compare("-f:b") == 0)
         {
@@ -435,6 +773,18 @@ void EncoderArguments::readOption(const std::vector<std::string>& options, size_
             return;
         }
         break;
+    case 'c':
+        if (str == "-ca")
+        {
+            // Compress animations
+            _compressAnimations = true;
+        }
+        else if (str == "-cl")
+        {
+            // Split meshes into clusters
+            _clusterMeshes = true;
+        }
+        break;
     case 'o':
         // Optimization flag
         if (str == "-oa")
@@ -442,6 +792,45 @@ void EncoderArguments::readOption(const std::vector<std::string>& options, size_
             // Optimize animations
             _optimizeAnimations = true;
         }
+        else if (str == "-oa:t" || str == "-oa:r" || str == "-oa:s" || str == "-oa:rate")
+        {
+            // Read a keyframe reduction tolerance or the resampling rate, which imply -oa
+            (*index)++;
+            if (*index >= options.size())
+            {
+                LOG(1, "Error: missing argument for %s.\n", str.c_str());
+                _parseError = true;
+                return;
+            }
+            float value = (float)atof(options[*index].c_str());
+            if (value < 0.0f)
+            {
+                LOG(1, "Error: invalid argument for %s.\n", str.c_str());
+                _parseError = true;
+                return;
+            }
+            if (str == "-oa:t")
+                _translationTolerance = value;
+            else if (str == "-oa:r")
+                _rotationTolerance = value;
+            else if (str == "-oa:s")
+                _scaleTolerance = value;
+            else
+                _animationSampleRate = value;
+            _optimizeAnimations = true;
+        }
+        else if (str == "-om")
+        {
+            // Optimize meshes
+            _optimizeMeshes = true;
+        }
+        break;
+    case 'q':
+        if (str == "-qv")
+        {
+            // Quantize vertices
+            _quantizeVertices = true;
+        }
         break;
     case 'h':
         {
@@ -509,17 +898,147 @@ void EncoderArguments::readOption(const std::vector<std::string>& options, size_
             }
         }
         break;
+    case 'j':
+        if (str.compare("-j") == 0)
+        {
+            // Read the number of parallel jobs
+            (*index)++;
+            if (*index >= options.size())
+            {
+                LOG(1, "Error: missing count argument for -j.\n");
+                _parseError = true;
+                return;
+            }
+            int count = atoi(options[*index].c_str());
+            if (count <= 0)
+            {
+                LOG(1, "Error: invalid count argument for -j.\n");
+                _parseError = true;
+                return;
+            }
+            _jobCount = (unsigned int)count;
+        }
+        break;
+    case 'k':
+        if (str.compare("-ktx") == 0)
+        {
+            // Convert an image into a compressed texture
+            _ktx = true;
+        }
+        break;
+    case 'l':
+        if (str.compare("-lod") == 0)
+        {
+            // Read the number of levels of detail
+            (*index)++;
+            if (*index >= options.size())
+            {
+                LOG(1, "Error: missing count argument for -lod.\n");
+                _parseError = true;
+                return;
+            }
+            int count = atoi(options[*index].c_str());
+            if (count <= 0)
+            {
+                LOG(1, "Error: invalid count argument for -lod.\n");
+                _parseError = true;
+                return;
+            }
+            _lodCount = (unsigned int)count;
+        }
+        else if (str.compare("-lightmap") == 0)
+        {
+            // Read the size of the lightmaps
+            (*index)++;
+            if (*index >= options.size())
+            {
+                LOG(1, "Error: missing size argument for -lightmap.\n");
+                _parseError = true;
+                return;
+            }
+            int size = atoi(options[*index].c_str());
+            if (size < 16)
+            {
+                LOG(1, "Error: invalid size argument for -lightmap.\n");
+                _parseError = true;
+                return;
+            }
+            _lightmapSize = (unsigned int)size;
+        }
+        break;
     case 'm':
         if (str.compare("-m") == 0)
         {
             // generate a material file
             _outputMaterial = true;
         }
+        else if (str.compare("-manifest") == 0)
+        {
+            // Write an asset manifest of a directory
+            _manifest = true;
+        }
+        else if (str.compare("-maxTextureSize") == 0)
+        {
+            // Read the largest width and height of textures
+            (*index)++;
+            if (*index >= options.size())
+            {
+                LOG(1, "Error: missing size argument for -maxTextureSize.\n");
+                _parseError = true;
+                return;
+            }
+            int size = atoi(options[*index].c_str());
+            if (size <= 0)
+            {
+                LOG(1, "Error: invalid size argument for -maxTextureSize.\n");
+                _parseError = true;
+                return;
+            }
+            _maxTextureSize = (unsigned int)size;
+        }
+        else if (str.compare("-mergeStatic") == 0)
+        {
+            // Read the size of the cells that static meshes are merged within
+            (*index)++;
+            if (*index >= options.size())
+            {
+                LOG(1, "Error: missing cell size argument for -mergeStatic.\n");
+                _parseError = true;
+                return;
+            }
+            _mergeCellSize = (float)atof(options[*index].c_str());
+            if (_mergeCellSize < 0.0f)
+            {
+                LOG(1, "Error: invalid cell size argument for -mergeStatic.\n");
+                _parseError = true;
+                return;
+            }
+            _mergeStatic = true;
+        }
         break;
     case 'n':
         _normalMap = true;
         break;
     case 'w':
+        if (str.compare("-weld") == 0)
+        {
+            // Read the weld epsilon
+            (*index)++;
+            if (*index >= options.size())
+            {
+                LOG(1, "Error: missing epsilon argument for -weld.\n");
+                _parseError = true;
+                return;
+            }
+            _weldEpsilon = (float)atof(options[*index].c_str());
+            if (_weldEpsilon < 0.0f)
+            {
+                LOG(1, "Error: invalid epsilon argument for -weld.\n");
+                _parseError = true;
+                return;
+            }
+        }
+        else
         {
             // Read world size
             (*index)++;
@@ -549,10 +1068,63 @@ void EncoderArguments::readOption(const std::vector<std::string>& options, size_
         }
         break;
     case 'p':
-        _fontPreview = true;
+        if (str.compare("-pack") == 0)
+        {
+            // Pack a directory into an archive
+            _pack = true;
+        }
+        else if (str.compare("-profile") == 0)
+        {
+            // Read the profile of the target devices
+            (*index)++;
+            if (*index >= options.size())
+            {
+                LOG(1, "Error: missing name argument for -profile.\n");
+                _parseError = true;
+                return;
+            }
+            if (findProfile(options[*index]) == NULL)
+            {
+                LOG(1, "Error: unknown profile for -profile: %s\n", options[*index].c_str());
+                _parseError = true;
+                return;
+            }
+            _profile = options[*index];
+        }
+        else
+        {
+            _fontPreview = true;
+        }
         break;
     case 's':
-        if (_normalMap)
+        if (str.compare("-strip") == 0)
+        {
+            // Read the vertex attributes to leave out of meshes
+            (*index)++;
+            if (*index >= options.size())
+            {
+                LOG(1, "Error: missing attributes argument for -strip.\n");
+                _parseError = true;
+                return;
+            }
+            std::vector<std::string> names;
+            splitString(options[*index].c_str(), &names);
+            for (size_t i = 0; i < names.size(); ++i)
+            {
+                size_t j = 0;
+                const size_t count = sizeof(STRIPPABLE_ATTRIBUTES) / sizeof(STRIPPABLE_ATTRIBUTES[0]);
+                while (j < count && names[i] != STRIPPABLE_ATTRIBUTES[j].name)
+                    ++j;
+                if (j == count)
+                {
+                    LOG(1, "Error: unknown vertex attribute for -strip: %s\n", names[i].c_str());
+                    _parseError = true;
+                    return;
+                }
+                _strippedAttributes |= VERTEX_ATTRIBUTE_BIT(STRIPPABLE_ATTRIBUTES[j].usage);
+            }
+        }
+        else if (_normalMap)
         {
             (*index)++;
             if (*index >= options.size())
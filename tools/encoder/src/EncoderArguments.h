@@ -162,8 +162,122 @@ public:
 
     bool optimizeAnimationsEnabled() const;
 
+    /**
+     * Returns the largest error in world units that removing keyframes may add to a translation.
+     */
+    float getTranslationTolerance() const;
+
+    /**
+     * Returns the largest error in degrees that removing keyframes may add to a rotation.
+     */
+    float getRotationTolerance() const;
+
+    /**
+     * Returns the largest error that removing keyframes may add to a scale.
+     */
+    float getScaleTolerance() const;
+
+    /**
+     * Returns the number of keyframes per second that animations are resampled to before
+     * keyframes are removed, or zero if they are not resampled.
+     */
+    float getAnimationSampleRate() const;
+
+    /**
+     * Returns true if the meshes should be reordered for the vertex cache, overdraw and vertex fetch.
+     */
+    bool optimizeMeshesEnabled() const;
+
+    /**
+     * Returns the number of levels of detail to generate for each mesh, beyond the mesh itself.
+     */
+    unsigned int getLodCount() const;
+
+    bool compressAnimationsEnabled() const;
+
+    /**
+     * Returns true if the meshes of static nodes should be merged by material and cell.
+     */
+    bool mergeStaticEnabled() const;
+
+    /**
+     * Returns the size of the cells that static meshes are merged within, or zero to merge
+     * each material regardless of where its meshes are.
+     */
+    float getMergeCellSize() const;
+
+    /**
+     * Returns the width and height of the lightmaps to bake the static meshes into, or zero if
+     * no lightmaps are baked.
+     */
+    unsigned int getLightmapSize() const;
+
+    /**
+     * Returns true if the triangles of meshes should be split into clusters.
+     */
+    bool clusterMeshesEnabled() const;
+
+    /**
+     * Returns true if the vertices of meshes should be quantized to smaller types.
+     */
+    bool quantizeVerticesEnabled() const;
+
     bool outputMaterialEnabled() const;
 
+    /**
+     * Returns the tolerance that the vertices of meshes are welded with, or zero if only
+     * vertices that are exactly equal are welded.
+     */
+    float getWeldEpsilon() const;
+
+    /**
+     * Returns true if the input directory should be packed into an archive.
+     */
+    bool packEnabled() const;
+
+    /**
+     * Returns true if an asset manifest of the input directory should be written.
+     */
+    bool manifestEnabled() const;
+
+    /**
+     * Returns true if the input image should be converted into a compressed KTX2 texture.
+     */
+    bool ktxEnabled() const;
+
+    /**
+     * Returns true if the images of the input directory should be packed into an atlas.
+     */
+    bool atlasEnabled() const;
+
+    /**
+     * Returns true if the input file is a manifest of jobs to encode.
+     */
+    bool batchEnabled() const;
+
+    /**
+     * Returns the number of batch jobs to run at once, or zero to run one for each CPU.
+     */
+    unsigned int getJobCount() const;
+
+    /**
+     * Returns the name of the profile of the target devices, or an empty string if none is set.
+     */
+    const std::string& getProfile() const;
+
+    /**
+     * Returns the largest width and height of the textures that are written, or zero if images
+     * keep their size.
+     */
+    unsigned int getMaxTextureSize() const;
+
+    /**
+     * Returns true if the vertex attribute with the given usage should be left out of meshes.
+     *
+     * @param usage The VertexUsage of the attribute.
+     */
+    bool isVertexAttributeStripped(unsigned int usage) const;
+
     const char* getNodeId() const;
 
     static std::string getRealPath(const std::string& filepath);
@@ -208,8 +322,30 @@ private:
     Font::FontFormat _fontFormat;
     bool _textOutput;
     bool _optimizeAnimations;
+    float _translationTolerance;
+    float _rotationTolerance;
+    float _scaleTolerance;
+    float _animationSampleRate;
+    bool _optimizeMeshes;
+    unsigned int _lodCount;
+    bool _compressAnimations;
+    bool _mergeStatic;
+    float _mergeCellSize;
+    unsigned int _lightmapSize;
+    bool _clusterMeshes;
+    bool _quantizeVertices;
     AnimationGroupOption _animationGrouping;
     bool _outputMaterial;
+    float _weldEpsilon;
+    bool _pack;
+    bool _manifest;
+    bool _ktx;
+    bool _atlas;
+    bool _batch;
+    unsigned int _jobCount;
+    std::string _profile;
+    unsigned int _maxTextureSize;
+    unsigned int _strippedAttributes;
 
     std::vector<std::string> _groupAnimationNodeId;
     std::vector<std::string> _groupAnimationAnimationId;
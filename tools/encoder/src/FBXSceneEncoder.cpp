@@ -16,7 +16,7 @@ using std::ostringstream;
 static void fixMaterialName(string& name);
 
 FBXSceneEncoder::FBXSceneEncoder()
-    : _groupAnimation(NULL), _autoGroupAnimations(false)
+    : _groupAnimation(NULL), _autoGroupAnimations(false), _loadedVertexCount(0), _weldedVertexCount(0), _meshLoadTime(0)
 {
 }
 
@@ -61,6 +61,8 @@ void FBXSceneEncoder::write(const string& filepath, const EncoderArguments& argu
 
     print("Loading Scene.");
     loadScene(fbxScene);
+    LOG(1, "Loaded %u vertices into %u unique vertices in %.2f seconds.\n", _loadedVertexCount,
+        _loadedVertexCount - _weldedVertexCount, (double)_meshLoadTime / CLOCKS_PER_SEC);
     print("Load materials");
     loadMaterials(fbxScene);
     print("Loading animations.");
@@ -1080,6 +1082,17 @@ Material* FBXSceneEncoder::createMaterial(const string& name, FbxSurfaceMaterial
         {
             material->addDefine(VERTEX_COLOR);
         }
+        // The vertices of the mesh are quantized when it is written, and decoded by the shaders.
+        if (EncoderArguments::getInstance()->quantizeVerticesEnabled())
+        {
+            material->setUniform("u_positionDecodeScale", "POSITION_DECODE_SCALE");
+            material->setUniform("u_positionDecodeOffset", "POSITION_DECODE_OFFSET");
+            material->addDefine("QUANTIZED_POSITION");
+            if (mesh->hasNormals())
+            {
+                material->addDefine("OCTAHEDRAL_NORMAL");
+            }
+        }
     }
     MeshSkin* skin = (model) ? model->getSkin() : NULL;
     if (skin && skin->getJointCount() > 0)
@@ -1152,7 +1165,9 @@ Mesh* FBXSceneEncoder::loadMesh(FbxMesh* fbxMesh)
     {
         return mesh;
     }
+    clock_t startTime = clock();
     mesh = new Mesh();
+    mesh->setWeldEpsilon(EncoderArguments::getInstance()->getWeldEpsilon());
     // GamePlay requires that a mesh have a unique ID but FbxMesh doesn't have a string ID.
     const char* name = fbxMesh->GetNode()->GetName();
     if (name)
@@ -1211,6 +1226,9 @@ Mesh* FBXSceneEncoder::loadMesh(FbxMesh* fbxMesh)
             loadBinormal(fbxMesh, vertexIndex, controlPointIndex, &vertex);
             loadVertexColor(fbxMesh, vertexIndex, controlPointIndex, &vertex);
 
+            // Leave out the attributes that the target does not use before the vertex is welded.
+            stripVertexAttributes(&vertex);
+
             if (hasSkin)
             {
                 loadBlendData(weights[controlPointIndex], &vertex);
@@ -1226,20 +1244,19 @@ Mesh* FBXSceneEncoder::loadMesh(FbxMesh* fbxMesh)
             }
 
             // Add the vertex to the mesh if it hasn't already been added and find the vertex index.
-            unsigned int index;
-            if (mesh->contains(vertex))
-            {
-                index = mesh->getVertexIndex(vertex);
-            }
-            else
-            {
-                index = mesh->addVertex(vertex);
-            }
+            unsigned int index = mesh->findOrAddVertex(vertex);
             meshParts[meshPartIndex]->addIndex(index);
             vertexIndex++;
         }
     }
 
+    clock_t loadTime = clock() - startTime;
+    LOG(2, "Loaded mesh '%s': %d vertices, %u unique, in %.3f seconds.\n", mesh->getId().c_str(), vertexIndex,
+        (unsigned int)mesh->getVertexCount(), (double)loadTime / CLOCKS_PER_SEC);
+    _loadedVertexCount += vertexIndex;
+    _weldedVertexCount += mesh->getWeldedVertexCount();
+    _meshLoadTime += loadTime;
+
     const size_t meshpartsSize = meshParts.size();
     for (size_t i = 0; i < meshpartsSize; ++i)
     {
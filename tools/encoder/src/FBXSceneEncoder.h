@@ -290,6 +290,17 @@ private:
      * Indicates if the animations for mesh skins should be grouped before writing out the GPB file.
      */
     bool _autoGroupAnimations;
+
+    /**
+     * The number of vertices that were loaded for all meshes, and how many of them were welded.
+     */
+    unsigned int _loadedVertexCount;
+    unsigned int _weldedVertexCount;
+
+    /**
+     * The processor time spent loading meshes.
+     */
+    clock_t _meshLoadTime;
 };
 
 #endif
@@ -392,6 +392,39 @@ void loadVertexColor(FbxMesh* fbxMesh, int vertexIndex, int controlPointIndex, V
     }
 }
 
+void stripVertexAttributes(Vertex* vertex)
+{
+    const EncoderArguments* arguments = EncoderArguments::getInstance();
+    if (vertex->hasNormal && arguments->isVertexAttributeStripped(NORMAL))
+    {
+        vertex->hasNormal = false;
+        vertex->normal = Vector3();
+    }
+    if (vertex->hasTangent && arguments->isVertexAttributeStripped(TANGENT))
+    {
+        vertex->hasTangent = false;
+        vertex->tangent = Vector3();
+    }
+    if (vertex->hasBinormal && arguments->isVertexAttributeStripped(BINORMAL))
+    {
+        vertex->hasBinormal = false;
+        vertex->binormal = Vector3();
+    }
+    if (vertex->hasDiffuse && arguments->isVertexAttributeStripped(COLOR))
+    {
+        vertex->hasDiffuse = false;
+        vertex->diffuse = Vector4();
+    }
+    for (unsigned int i = 0; i < MAX_UV_SETS; ++i)
+    {
+        if (vertex->hasTexCoord[i] && arguments->isVertexAttributeStripped(TEXCOORD0 + i))
+        {
+            vertex->hasTexCoord[i] = false;
+            vertex->texCoord[i] = Vector2();
+        }
+    }
+}
+
 void loadBlendData(const vector<Vector2>& vertexWeights, Vertex* vertex)
 {
     size_t size = vertexWeights.size();
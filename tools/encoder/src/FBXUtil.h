@@ -100,6 +100,14 @@ void loadVertexColor(FbxMesh* fbxMesh, int vertexIndex, int controlPointIndex, V
  */
 void loadBlendData(const std::vector<Vector2>& vertexWeights, Vertex* vertex);
 
+/**
+ * Removes the attributes that the encoder arguments strip from a vertex (see -strip), and
+ * resets their values so that vertices which only differed in them are welded.
+ * 
+ * @param vertex The vertex to strip.
+ */
+void stripVertexAttributes(Vertex* vertex);
+
 /**
  * Loads the blend weights and blend indices from the given mesh.
  * 
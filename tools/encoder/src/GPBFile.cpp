@@ -4,14 +4,195 @@
 #include "StringUtil.h"
 #include "EncoderArguments.h"
 #include "Heightmap.h"
+#include "Lightmap.h"
+#include "MeshClusterizer.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Thread.h"
 
 #define EPSILON 1.2e-7f;
 
+// Largest number of vertices in a merged static mesh, so that its indices fit in 16 bits
+#define STATIC_MESH_VERTEX_MAX 65536
+
+// Marks the vertices of a source mesh that are not used by the part being merged
+#define STATIC_MESH_NO_VERTEX 0xFFFFFFFF
+
 namespace gameplay
 {
 
 static GPBFile* __instance = NULL;
 
+// A stage that processes each mesh of the file on its own
+struct MeshStage
+{
+    const std::vector<Mesh*>* meshes;
+    void (*function)(Mesh* mesh, void* arg);
+    void* arg;
+};
+
+static void processMeshRange(unsigned int begin, unsigned int end, unsigned int thread, void* arg)
+{
+    MeshStage* stage = (MeshStage*)arg;
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        stage->function((*stage->meshes)[i], stage->arg);
+    }
+}
+
+/**
+ * Calls a function for each mesh, in parallel since meshes don't share any of their data.
+ */
+static void processMeshes(const std::list<Mesh*>& geometry, void (*function)(Mesh* mesh, void* arg), void* arg)
+{
+    std::vector<Mesh*> meshes(geometry.begin(), geometry.end());
+    MeshStage stage = { &meshes, function, arg };
+    parallelFor(meshes.size(), 1, &processMeshRange, &stage);
+}
+
+static void optimizeMesh(Mesh* mesh, void* arg)
+{
+    MeshOptimizer::optimize(mesh);
+}
+
+static void quantizeMesh(Mesh* mesh, void* arg)
+{
+    mesh->quantize();
+}
+
+static void clusterMesh(Mesh* mesh, void* arg)
+{
+    MeshClusterizer::build(mesh);
+}
+
+static void generateMeshLods(Mesh* mesh, void* arg)
+{
+    MeshSimplifier::generateLods(mesh, *(unsigned int*)arg, 0.5f);
+}
+
+/**
+ * Adds the nodes in the hierarchy of the given node that have a light to a list.
+ */
+static void findLightNodes(Node* node, std::vector<Node*>& lights)
+{
+    if (node->hasLight())
+        lights.push_back(node);
+    for (Node* child = node->getFirstChild(); child != NULL; child = child->getNextSibling())
+    {
+        findLightNodes(child, lights);
+    }
+}
+
+static void reduceChannelKeys(unsigned int begin, unsigned int end, unsigned int thread, void* arg)
+{
+    std::vector<AnimationChannel*>& channels = *(std::vector<AnimationChannel*>*)arg;
+    const EncoderArguments* arguments = EncoderArguments::getInstance();
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        channels[i]->resample(arguments->getAnimationSampleRate());
+        channels[i]->reduceKeys(arguments->getTranslationTolerance(), arguments->getRotationTolerance(), arguments->getScaleTolerance());
+    }
+}
+
+/**
+ * Identifies the merged mesh that a mesh part of a static node is merged into.
+ */
+struct StaticMeshKey
+{
+    Material* material;
+    unsigned int format;
+    int cell[3];
+
+    bool operator<(const StaticMeshKey& key) const
+    {
+        if (material != key.material)
+            return material < key.material;
+        if (format != key.format)
+            return format < key.format;
+        for (unsigned int i = 0; i < 3; ++i)
+        {
+            if (cell[i] != key.cell[i])
+                return cell[i] < key.cell[i];
+        }
+        return false;
+    }
+};
+
+/**
+ * A mesh part of a static node that is merged.
+ */
+struct StaticMeshSource
+{
+    Node* node;
+    Mesh* mesh;
+    MeshPart* part;
+};
+
+/**
+ * Returns true if two meshes have the same vertex elements.
+ */
+static bool equalVertexFormats(const Mesh* mesh1, const Mesh* mesh2)
+{
+    if (mesh1->getVertexElementCount() != mesh2->getVertexElementCount())
+        return false;
+    for (unsigned int i = 0, count = mesh1->getVertexElementCount(); i < count; ++i)
+    {
+        const VertexElement& e1 = mesh1->getVertexElement(i);
+        const VertexElement& e2 = mesh2->getVertexElement(i);
+        if (e1.usage != e2.usage || e1.size != e2.size)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Transforms a direction by the upper 3x3 of a matrix. Normals are transformed by its cofactor
+ * matrix instead, which keeps them perpendicular to the surface under non-uniform scales.
+ */
+static void transformDirection(const Matrix& matrix, bool isNormal, Vector3* v)
+{
+    const float* m = matrix.m;
+    Vector3 c0(m[0], m[1], m[2]);
+    Vector3 c1(m[4], m[5], m[6]);
+    Vector3 c2(m[8], m[9], m[10]);
+    if (isNormal)
+    {
+        Vector3 n0, n1, n2;
+        Vector3::cross(c1, c2, &n0);
+        Vector3::cross(c2, c0, &n1);
+        Vector3::cross(c0, c1, &n2);
+        if (Vector3::dot(c0, n0) < 0.0f)
+        {
+            // Mirroring transforms flip the cofactors, which the normals must not follow.
+            n0.negate();
+            n1.negate();
+            n2.negate();
+        }
+        c0 = n0;
+        c1 = n1;
+        c2 = n2;
+    }
+    v->set(c0.x * v->x + c1.x * v->y + c2.x * v->z,
+           c0.y * v->x + c1.y * v->y + c2.y * v->z,
+           c0.z * v->x + c1.z * v->y + c2.z * v->z);
+    v->normalize();
+}
+
+/**
+ * Creates a mesh to merge static meshes with the vertex format of the given mesh into.
+ */
+static Mesh* createStaticMesh(const Mesh* format)
+{
+    Mesh* mesh = new Mesh();
+    for (unsigned int i = 0, count = format->getVertexElementCount(); i < count; ++i)
+    {
+        const VertexElement& e = format->getVertexElement(i);
+        mesh->addVetexAttribute(e.usage, e.size);
+    }
+    mesh->addMeshPart(new MeshPart());
+    return mesh;
+}
+
 /**
  * Returns true if the given value is close to one.
  */
@@ -320,12 +501,62 @@ void GPBFile::adjust()
         computeBounds(*i);
     }
 
+    if (EncoderArguments::getInstance()->mergeStaticEnabled())
+    {
+        LOG(1, "Merging static meshes.\n");
+        mergeStaticMeshes(EncoderArguments::getInstance()->getMergeCellSize());
+    }
+
+    // Lightmaps are baked before the levels of detail are generated, so that the levels keep
+    // the lightmap coordinates of the vertices.
+    if (EncoderArguments::getInstance()->getLightmapSize() > 0)
+    {
+        LOG(1, "Baking lightmaps.\n");
+        bakeLightmaps(EncoderArguments::getInstance()->getLightmapSize());
+    }
+
     if (EncoderArguments::getInstance()->optimizeAnimationsEnabled())
     {
         LOG(1, "Optimizing animations.\n");
         optimizeAnimations();
     }
 
+    if (EncoderArguments::getInstance()->getLodCount() > 0)
+    {
+        LOG(1, "Generating levels of detail.\n");
+        generateLods(EncoderArguments::getInstance()->getLodCount());
+    }
+
+    if (EncoderArguments::getInstance()->optimizeMeshesEnabled())
+    {
+        LOG(1, "Optimizing meshes.\n");
+        optimizeMeshes();
+    }
+
+    // Clusters are built from the float positions, before they are quantized.
+    if (EncoderArguments::getInstance()->clusterMeshesEnabled())
+    {
+        LOG(1, "Clustering meshes.\n");
+        clusterMeshes();
+    }
+
+    if (EncoderArguments::getInstance()->quantizeVerticesEnabled())
+    {
+        LOG(1, "Quantizing vertices.\n");
+        quantizeMeshes();
+    }
+
+    // The scenes store the world matrices and bounds of the nodes that are not animated.
+    std::set<std::string> animatedIds;
+    findAnimatedNodeIds(animatedIds);
+    for (std::list<Object*>::iterator i = _objects.begin(); i != _objects.end(); ++i)
+    {
+        if ((*i)->getTypeId() == Object::SCENE_ID)
+        {
+            dynamic_cast<Scene*>(*i)->setAnimatedNodeIds(animatedIds);
+        }
+    }
+
     // TODO:
     // remove ambient _lights
     // for each node
@@ -398,8 +629,314 @@ void GPBFile::computeBounds(Node* node)
     }
 }
 
+void GPBFile::findAnimatedNodeIds(std::set<std::string>& ids)
+{
+    for (unsigned int i = 0, count = _animations.getAnimationCount(); i < count; ++i)
+    {
+        Animation* animation = _animations.getAnimation(i);
+        for (unsigned int j = 0, channelCount = animation->getAnimationChannelCount(); j < channelCount; ++j)
+        {
+            ids.insert(animation->getAnimationChannel(j)->getTargetId());
+        }
+    }
+}
+
+void GPBFile::mergeStaticMeshes(float cellSize)
+{
+    // Nodes below an animated node move with it, and heightmaps are generated from the meshes
+    // of their nodes once they would be merged, so neither are merged.
+    std::set<std::string> pinnedIds;
+    findAnimatedNodeIds(pinnedIds);
+    const std::vector<EncoderArguments::HeightmapOption>& heightmaps = EncoderArguments::getInstance()->getHeightmapOptions();
+    for (unsigned int i = 0, count = heightmaps.size(); i < count; ++i)
+    {
+        pinnedIds.insert(heightmaps[i].nodeIds.begin(), heightmaps[i].nodeIds.end());
+    }
+
+    unsigned int mergedCount = 0;
+    unsigned int meshCount = 0;
+    unsigned int batchIndex = 0;
+    std::set<Mesh*> mergedMeshes;
+    for (std::list<Object*>::iterator i = _objects.begin(); i != _objects.end(); ++i)
+    {
+        if ((*i)->getTypeId() != Object::SCENE_ID)
+            continue;
+        Scene* scene = dynamic_cast<Scene*>(*i);
+
+        std::vector<Node*> nodes;
+        const std::list<Node*>& roots = scene->getNodes();
+        for (std::list<Node*>::const_iterator j = roots.begin(); j != roots.end(); ++j)
+        {
+            findStaticNodes(*j, pinnedIds, nodes);
+        }
+
+        // Group the parts of the static meshes.
+        std::vector<Mesh*> formats;
+        std::map<StaticMeshKey, std::vector<StaticMeshSource> > groups;
+        for (size_t j = 0, count = nodes.size(); j < count; ++j)
+        {
+            Node* node = nodes[j];
+            Model* model = node->getModel();
+            Mesh* mesh = model->getMesh();
+
+            StaticMeshKey key;
+            key.format = 0;
+            while (key.format < formats.size() && !equalVertexFormats(formats[key.format], mesh))
+                ++key.format;
+            if (key.format == formats.size())
+                formats.push_back(mesh);
+            Vector3 center;
+            node->getWorldMatrix().transformPoint(mesh->bounds.center, &center);
+            key.cell[0] = cellSize > 0.0f ? (int)floor(center.x / cellSize) : 0;
+            key.cell[1] = cellSize > 0.0f ? (int)floor(center.y / cellSize) : 0;
+            key.cell[2] = cellSize > 0.0f ? (int)floor(center.z / cellSize) : 0;
+
+            for (size_t k = 0; k < mesh->parts.size(); ++k)
+            {
+                key.material = model->getMaterial((int)k);
+                StaticMeshSource source = { node, mesh, mesh->parts[k] };
+                groups[key].push_back(source);
+            }
+            mergedMeshes.insert(mesh);
+        }
+
+        // Merge each group into as few meshes as fit its vertices.
+        std::vector<unsigned int> remap;
+        for (std::map<StaticMeshKey, std::vector<StaticMeshSource> >::const_iterator j = groups.begin(); j != groups.end(); ++j)
+        {
+            std::vector<Mesh*> meshes;
+            Mesh* merged = NULL;
+            for (size_t k = 0, count = j->second.size(); k < count; ++k)
+            {
+                const StaticMeshSource& source = j->second[k];
+                const size_t indexCount = source.part->getIndicesCount() - source.part->getIndicesCount() % 3;
+
+                // Number the vertices that the part uses in the order that it first uses them.
+                remap.assign(source.mesh->getVertexCount(), STATIC_MESH_NO_VERTEX);
+                unsigned int vertexCount = 0;
+                for (size_t n = 0; n < indexCount; ++n)
+                {
+                    unsigned int index = source.part->getIndex(n);
+                    if (remap[index] == STATIC_MESH_NO_VERTEX)
+                        remap[index] = vertexCount++;
+                }
+                if (vertexCount == 0)
+                    continue;
+                if (!merged || merged->getVertexCount() + vertexCount > STATIC_MESH_VERTEX_MAX)
+                {
+                    merged = createStaticMesh(formats[j->first.format]);
+                    meshes.push_back(merged);
+                }
+
+                const Matrix& world = source.node->getWorldMatrix();
+                const unsigned int base = merged->getVertexCount();
+                merged->vertices.resize(base + vertexCount);
+                for (unsigned int v = 0, meshVertexCount = source.mesh->getVertexCount(); v < meshVertexCount; ++v)
+                {
+                    if (remap[v] == STATIC_MESH_NO_VERTEX)
+                        continue;
+                    Vertex vertex = source.mesh->getVertex(v);
+                    world.transformPoint(vertex.position, &vertex.position);
+                    if (vertex.hasNormal)
+                        transformDirection(world, true, &vertex.normal);
+                    if (vertex.hasTangent)
+                        transformDirection(world, false, &vertex.tangent);
+                    if (vertex.hasBinormal)
+                        transformDirection(world, false, &vertex.binormal);
+                    merged->vertices[base + remap[v]] = vertex;
+                }
+
+                // Mirroring transforms reverse the winding of the triangles, which is restored.
+                MeshPart* part = merged->parts[0];
+                const bool mirrored = world.determinant() < 0.0f;
+                for (size_t n = 0; n < indexCount; n += 3)
+                {
+                    part->addIndex(base + remap[source.part->getIndex(n)]);
+                    part->addIndex(base + remap[source.part->getIndex(mirrored ? n + 2 : n + 1)]);
+                    part->addIndex(base + remap[source.part->getIndex(mirrored ? n + 1 : n + 2)]);
+                }
+            }
+
+            for (size_t k = 0; k < meshes.size(); ++k)
+            {
+                Mesh* mesh = meshes[k];
+                mesh->updateVertexLookupTable();
+                mesh->computeBounds();
+
+                char id[32];
+                do
+                {
+                    sprintf(id, "staticBatch%u", batchIndex++);
+                } while (idExists(id) || idExists(std::string(id) + "_Mesh"));
+                mesh->setId(std::string(id) + "_Mesh");
+
+                Model* model = new Model();
+                model->setMesh(mesh);
+                model->setMaterial(j->first.material);
+                Node* node = new Node();
+                node->setId(id);
+                node->setModel(model);
+                scene->add(node);
+                addNode(node);
+                addMesh(mesh);
+            }
+            meshCount += meshes.size();
+        }
+
+        for (size_t j = 0, count = nodes.size(); j < count; ++j)
+        {
+            nodes[j]->setModel(NULL);
+        }
+        mergedCount += nodes.size();
+    }
+
+    // Remove the meshes that no model uses any more.
+    for (std::list<Node*>::const_iterator i = _nodes.begin(); i != _nodes.end(); ++i)
+    {
+        if ((*i)->getModel())
+            mergedMeshes.erase((*i)->getModel()->getMesh());
+    }
+    for (std::list<Mesh*>::iterator i = _geometry.begin(); i != _geometry.end(); )
+    {
+        if (mergedMeshes.find(*i) != mergedMeshes.end())
+        {
+            _refTable.remove((*i)->getId());
+            i = _geometry.erase(i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    LOG(2, "  Merged the meshes of %u static node(s) into %u mesh(es).\n", mergedCount, meshCount);
+}
+
+void GPBFile::findStaticNodes(Node* node, const std::set<std::string>& pinnedIds, std::vector<Node*>& nodes)
+{
+    if (node->isJoint() || pinnedIds.find(node->getId()) != pinnedIds.end())
+        return;
+
+    // Only models whose mesh parts are all lists of triangles with a material are merged,
+    // since the model is removed from the node.
+    Model* model = node->getModel();
+    Mesh* mesh = model ? model->getMesh() : NULL;
+    if (mesh && !model->getSkin() && !mesh->parts.empty() && mesh->getVertexCount() <= STATIC_MESH_VERTEX_MAX)
+    {
+        bool mergeable = true;
+        for (size_t i = 0; i < mesh->parts.size() && mergeable; ++i)
+        {
+            mergeable = mesh->parts[i]->getPrimitiveType() == MeshPart::TRIANGLES && model->getMaterial((int)i) != NULL;
+        }
+        if (mergeable)
+            nodes.push_back(node);
+    }
+
+    for (Node* child = node->getFirstChild(); child != NULL; child = child->getNextSibling())
+    {
+        findStaticNodes(child, pinnedIds, nodes);
+    }
+}
+
+void GPBFile::bakeLightmaps(unsigned int size)
+{
+    // Only the meshes of a single node can be baked, since the lightmap is lit where the node is.
+    std::map<Mesh*, unsigned int> meshNodes;
+    for (std::list<Node*>::const_iterator i = _nodes.begin(); i != _nodes.end(); ++i)
+    {
+        if ((*i)->getModel() && (*i)->getModel()->getMesh())
+            ++meshNodes[(*i)->getModel()->getMesh()];
+    }
+    std::set<std::string> pinnedIds;
+    findAnimatedNodeIds(pinnedIds);
+
+    std::string path = EncoderArguments::getInstance()->getOutputFilePath();
+    int pos = path.find_last_of('.');
+    if (pos > 2)
+        path = path.substr(0, pos);
+    unsigned int sceneIndex = 0;
+    for (std::list<Object*>::iterator i = _objects.begin(); i != _objects.end(); ++i)
+    {
+        if ((*i)->getTypeId() != Object::SCENE_ID)
+            continue;
+        Scene* scene = dynamic_cast<Scene*>(*i);
+
+        std::vector<Node*> staticNodes;
+        std::vector<Node*> lights;
+        const std::list<Node*>& roots = scene->getNodes();
+        for (std::list<Node*>::const_iterator j = roots.begin(); j != roots.end(); ++j)
+        {
+            findStaticNodes(*j, pinnedIds, staticNodes);
+            findLightNodes(*j, lights);
+        }
+        std::vector<Node*> nodes;
+        for (size_t j = 0; j < staticNodes.size(); ++j)
+        {
+            Mesh* mesh = staticNodes[j]->getModel()->getMesh();
+            if (meshNodes[mesh] == 1 && mesh->lodParts.empty())
+                nodes.push_back(staticNodes[j]);
+        }
+        if (nodes.empty())
+            continue;
+
+        std::ostringstream filename;
+        filename << path;
+        if (sceneIndex > 0)
+            filename << "_" << sceneIndex;
+        filename << ".lightmap.png";
+        ++sceneIndex;
+        if (!Lightmap::bake(nodes, lights, scene->getAmbientColor(), size, filename.str().c_str()))
+            continue;
+
+        // The lightmap is beside the output file, as the other textures of the materials are.
+        std::string relativePath = filename.str();
+        size_t slash = relativePath.find_last_of("/\\");
+        if (slash != std::string::npos)
+            relativePath = relativePath.substr(slash + 1);
+        for (size_t j = 0; j < nodes.size(); ++j)
+        {
+            Model* model = nodes[j]->getModel();
+            for (size_t k = 0; k < model->getMesh()->parts.size(); ++k)
+            {
+                Material* material = model->getMaterial((int)k);
+                if (!material || material->getSampler("u_lightmapTexture"))
+                    continue;
+                material->addDefine("LIGHTMAP");
+                Sampler* sampler = material->createSampler("u_lightmapTexture");
+                sampler->set("relativePath", relativePath);
+                sampler->set("mipmap", "true");
+                sampler->set("wrapS", CLAMP);
+                sampler->set("wrapT", CLAMP);
+                sampler->set(MIN_FILTER, LINEAR_MIPMAP_LINEAR);
+                sampler->set(MAG_FILTER, LINEAR);
+            }
+        }
+    }
+}
+
+void GPBFile::optimizeMeshes()
+{
+    processMeshes(_geometry, &optimizeMesh, NULL);
+}
+
+void GPBFile::quantizeMeshes()
+{
+    processMeshes(_geometry, &quantizeMesh, NULL);
+}
+
+void GPBFile::clusterMeshes()
+{
+    processMeshes(_geometry, &clusterMesh, NULL);
+}
+
+void GPBFile::generateLods(unsigned int count)
+{
+    processMeshes(_geometry, &generateMeshLods, &count);
+}
+
 void GPBFile::optimizeAnimations()
 {
+    std::vector<AnimationChannel*> channels;
     const unsigned int animationCount = _animations.getAnimationCount();
     for (unsigned int animationIndex = 0; animationIndex < animationCount; ++animationIndex)
     {
@@ -429,7 +966,15 @@ void GPBFile::optimizeAnimations()
                 }
             }
         }
+
+        for (unsigned int channelIndex = 0, count = animation->getAnimationChannelCount(); channelIndex < count; ++channelIndex)
+        {
+            channels.push_back(animation->getAnimationChannel(channelIndex));
+        }
     }
+
+    // Resample each channel and remove the keyframes that the remaining keyframes reproduce.
+    parallelFor(channels.size(), 1, &reduceChannelKeys, &channels);
 }
 
 void GPBFile::decomposeTransformAnimationChannel(Animation* animation, AnimationChannel* channel, int channelIndex)
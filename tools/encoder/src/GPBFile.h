@@ -1,6 +1,7 @@
 #ifndef GPBFILE_H_
 #define GPBFILE_H_
 
+#include <set>
 #include "FileIO.h"
 #include "Object.h"
 #include "Scene.h"
@@ -21,7 +22,7 @@ namespace gameplay
  * Increment the version number when making a change that break binary compatibility.
  * [0] is major, [1] is minor.
  */
-const unsigned char GPB_VERSION[2] = {1, 5};
+const unsigned char GPB_VERSION[2] = {1, 11};
 
 /**
  * The GamePlay Binary file class handles writing the GamePlay Binary file.
@@ -132,6 +133,53 @@ private:
      */
     void optimizeAnimations();
 
+    /**
+     * Merges the meshes of the static nodes of each scene by their material and by the cell of
+     * a grid that they are in, into meshes on new nodes at the root of the scene.
+     *
+     * @param cellSize The size of the cells, or zero to merge each material into one mesh.
+     */
+    void mergeStaticMeshes(float cellSize);
+
+    /**
+     * Adds the nodes in the hierarchy of the given node whose meshes can be merged to a list,
+     * skipping the nodes with the given ids and the nodes below them.
+     */
+    void findStaticNodes(Node* node, const std::set<std::string>& pinnedIds, std::vector<Node*>& nodes);
+
+    /**
+     * Adds the ids of the nodes that are targeted by animation channels to a set.
+     */
+    void findAnimatedNodeIds(std::set<std::string>& ids);
+
+    /**
+     * Bakes the lighting of the static meshes of each scene into a lightmap image beside the
+     * output file, and sets the materials of the meshes to sample it.
+     *
+     * @param size The width and height of the lightmaps, in texels.
+     */
+    void bakeLightmaps(unsigned int size);
+
+    /**
+     * Reorders the triangles and vertices of all meshes for faster rendering.
+     */
+    void optimizeMeshes();
+
+    /**
+     * Quantizes the vertices of all meshes.
+     */
+    void quantizeMeshes();
+
+    /**
+     * Splits the triangles of meshes into clusters.
+     */
+    void clusterMeshes();
+
+    /**
+     * Generates levels of detail for all meshes.
+     */
+    void generateLods(unsigned int count);
+
     /**
      * Decomposes an ANIMATE_SCALE_ROTATE_TRANSLATE channel into 3 new channels. (Scale, Rotate and Translate)
      * 
@@ -6,37 +6,32 @@
 namespace gameplay
 {
 
-// Number of threads to spawn for the heightmap generator
-#define THREAD_COUNT 8
+// Number of scan lines that a thread generates at a time
+#define HEIGHTMAP_GRAIN_SIZE 4
 
-// Thread data structure
+// Data shared by the threads that generate a heightmap
 struct HeightmapThreadData
 {
     float rayHeight;                    // [in]
     const Vector3* rayDirection;        // [in]
     const std::vector<Mesh*>* meshes;   // [in]
-    const BoundingVolume* bounds;       // [in]
     float minX;                         // [in]
-    float maxX;                         // [in]
     float minZ;                         // [in]
-    float maxZ;                         // [in]
     float stepX;                        // [in]
     float stepZ;                        // [in]
-    float minHeight;                    // [out]
-    float maxHeight;                    // [out]
     float* heights;                     // [in][out]
     int width;                          // [in]
-    int height;                         // [in]
-    int heightIndex;                    // [in]
+    float* minHeights;                  // [out] for each thread
+    float* maxHeights;                  // [out] for each thread
+    int* failedRayCasts;                // [out] for each thread
 };
 
 // Globals used by thread
 int __processedHeightmapScanLines = 0;
 int __totalHeightmapScanlines = 0;
-int __failedRayCasts = 0;
 
 // Forward declarations
-int generateHeightmapChunk(void* threadData);
+void generateHeightmapChunk(unsigned int begin, unsigned int end, unsigned int thread, void* threadData);
 bool intersect(const Vector3& rayOrigin, const Vector3& rayDirection, const Vector3& boxMin, const Vector3& boxMax, float* distance = NULL);
 int intersect_triangle(const float orig[3], const float dir[3], const float vert0[3], const float vert1[3], const float vert2[3], float *t, float *u, float *v);
 bool intersect(const Vector3& rayOrigin, const Vector3& rayDirection, const std::vector<Vertex>& vertices, const std::vector<MeshPart*>& parts, Vector3* point);
@@ -48,7 +43,6 @@ void Heightmap::generate(const std::vector<std::string>& nodeIds, int width, int
     // Initialize state variables
     __processedHeightmapScanLines = 0;
     __totalHeightmapScanlines = 0;
-    __failedRayCasts = 0;
 
     GPBFile* gpbFile = GPBFile::getInstance();
 
@@ -108,62 +102,42 @@ void Heightmap::generate(const std::vector<std::string>& nodeIds, int width, int
 
     __totalHeightmapScanlines = height;
 
-    // Determine # of threads to spawn
-    int threadCount = min(THREAD_COUNT, height);
-
-    // Split the work into separate threads to make max use of available cpu cores and speed up computation.
-    HeightmapThreadData* threadData = new HeightmapThreadData[threadCount];
-    THREAD_HANDLE* threads = new THREAD_HANDLE[threadCount];
-    int stepSize = height / threadCount;
-    for (int i = 0, remaining = height; i < threadCount; ++i, remaining -= stepSize)
+    // Split the scan lines between threads to make max use of available cpu cores and speed up computation.
+    const unsigned int threadCount = getThreadCount();
+    std::vector<float> minHeights(threadCount, FLT_MAX);
+    std::vector<float> maxHeights(threadCount, -FLT_MAX);
+    std::vector<int> failedRayCasts(threadCount, 0);
+    HeightmapThreadData data;
+    data.rayHeight = rayOrigin.y;
+    data.rayDirection = &rayDirection;
+    data.meshes = &meshes;
+    data.minX = minX;
+    data.minZ = minZ;
+    data.stepX = (maxX - minX) / width;
+    data.stepZ = (maxZ - minZ) / height;
+    data.heights = heights;
+    data.width = width;
+    data.minHeights = &minHeights[0];
+    data.maxHeights = &maxHeights[0];
+    data.failedRayCasts = &failedRayCasts[0];
+    parallelFor(height, HEIGHTMAP_GRAIN_SIZE, &generateHeightmapChunk, &data);
+
+    // Update min/max height from all threads
+    int failedRayCastCount = 0;
+    for (unsigned int i = 0; i < threadCount; ++i)
     {
-        HeightmapThreadData& data = threadData[i];
-        data.rayHeight = rayOrigin.y;
-        data.rayDirection = &rayDirection;
-        data.bounds = &bounds;
-        data.meshes = &meshes;
-        data.minX = minX;
-        data.maxX = maxX;
-        data.minZ = minZ + (stepSize * i);
-        data.maxZ = data.minZ + stepSize - 1;
-        if (i == threadCount - 1)
-            data.maxZ = maxZ;
-        data.stepX = (maxX - minX) / width;
-        data.stepZ = (maxZ - minZ) / height;
-        data.heights = heights;
-        data.width = width;
-        data.height = remaining > stepSize ? stepSize : remaining;
-        data.heightIndex = width * (stepSize * i);
-
-        // Start the processing thread
-        if (!createThread(&threads[i], &generateHeightmapChunk, &data))
-        {
-            LOG(1, "ERROR: Failed to spawn worker thread for generation of heightmap: %s\n", filename);
-            return;
-        }
-    }
-
-    // Wait for all threads to terminate
-    waitForThreads(threadCount, threads);
-
-    // Close all thread handles and free memory allocations.
-    for (int i = 0; i < threadCount; ++i)
-        closeThread(threads[i]);
-
-    // Update min/max height from all completed threads
-    for (int i = 0; i < threadCount; ++i)
-    {
-        if (threadData[i].minHeight < minHeight)
-            minHeight = threadData[i].minHeight;
-        if (threadData[i].maxHeight > maxHeight)
-            maxHeight = threadData[i].maxHeight;
+        if (minHeights[i] < minHeight)
+            minHeight = minHeights[i];
+        if (maxHeights[i] > maxHeight)
+            maxHeight = maxHeights[i];
+        failedRayCastCount += failedRayCasts[i];
     }
 
     LOG(1, "\r\tDone.\n");
 
-    if (__failedRayCasts)
+    if (failedRayCastCount)
     {
-        LOG(2, "Warning: %d triangle intersections failed for heightmap: %s\n", __failedRayCasts, filename);
+        LOG(2, "Warning: %d triangle intersections failed for heightmap: %s\n", failedRayCastCount, filename);
 
         // Go through and clamp any height values that are set to -FLT_MAX to the min recorded height value
         // (otherwise the range of height values will be far too large).
@@ -244,10 +218,6 @@ void Heightmap::generate(const std::vector<std::string>& nodeIds, int width, int
     LOG(1, "Saved heightmap: %s\n", filename);
 
 error:
-    if (threadData)
-        delete[] threadData;
-    if (threads)
-        delete[] threads;
     if (heights)
         delete[] heights;
     if (fp)
@@ -260,7 +230,7 @@ error:
         png_destroy_write_struct(&png_ptr, (png_infopp)NULL);
 }
 
-int generateHeightmapChunk(void* threadData)
+void generateHeightmapChunk(unsigned int begin, unsigned int end, unsigned int thread, void* threadData)
 {
     HeightmapThreadData* data = (HeightmapThreadData*)threadData;
 
@@ -270,16 +240,16 @@ int generateHeightmapChunk(void* threadData)
     float* heights = data->heights;
 
     Vector3 intersectionPoint;
-    float minHeight = FLT_MAX;
-    float maxHeight = -FLT_MAX;
-    int index = data->heightIndex;
+    float minHeight = data->minHeights[thread];
+    float maxHeight = data->maxHeights[thread];
+    int failedRayCasts = 0;
+    int index = data->width * begin;
 
-    int zi = 0;
-    for (float z = data->minZ; zi < data->height; z += data->stepZ, ++zi)
+    for (unsigned int zi = begin; zi < end; ++zi)
     {
         LOG(1, "\r\t%d%%", (int)(((float)__processedHeightmapScanLines / __totalHeightmapScanlines) * 100.0f));
 
-        rayOrigin.z = z;
+        rayOrigin.z = data->minZ + data->stepZ * zi;
 
         int xi = 0;
         for (float x = data->minX; xi < data->width; x += data->stepX, ++xi)
@@ -316,17 +286,17 @@ int generateHeightmapChunk(void* threadData)
             heights[index++] = h;
 
             if (h == -FLT_MAX)
-                ++__failedRayCasts;
+                ++failedRayCasts;
         }
 
+        // The progress is only displayed, so it doesn't need to be exact.
         ++__processedHeightmapScanLines;
     }
 
-    // Update min/max height for this thread data
-    data->minHeight = minHeight;
-    data->maxHeight = maxHeight;
-
-    return 0;
+    // Update min/max height for this thread
+    data->minHeights[thread] = minHeight;
+    data->maxHeights[thread] = maxHeight;
+    data->failedRayCasts[thread] += failedRayCasts;
 }
 
 /////////////////////////////////////////////////////////////
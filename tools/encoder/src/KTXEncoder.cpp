@@ -0,0 +1,536 @@
+#include "Base.h"
+#include "KTXEncoder.h"
+#include "Image.h"
+#include <climits>
+
+#define KTX2_IDENTIFIER             "\xABKTX 20\xBB\r\n\x1A\n"
+#define KTX2_IDENTIFIER_LENGTH      12
+#define VK_FORMAT_ETC2_RGB8         147
+#define VK_FORMAT_ETC2_RGBA8        151
+#define KHR_DF_MODEL_ETC2           161
+#define KHR_DF_PRIMARIES_BT709      1
+#define KHR_DF_TRANSFER_LINEAR      1
+#define KHR_DF_CHANNEL_ETC2_COLOR   2
+#define KHR_DF_CHANNEL_ETC2_ALPHA   15
+
+namespace gameplay
+{
+
+// The intensity modifiers of ETC1/ETC2 color blocks.
+static const int ETC_MODIFIERS[8][2] =
+{
+    { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+// The alpha modifiers of EAC blocks.
+static const int EAC_MODIFIERS[16][8] =
+{
+    { -3, -6, -9, -15, 2, 5, 8, 14 },
+    { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5, -8, -13, 1, 4, 7, 12 },
+    { -2, -4, -6, -13, 1, 3, 5, 12 },
+    { -3, -6, -8, -12, 2, 5, 7, 11 },
+    { -3, -7, -9, -11, 2, 6, 8, 10 },
+    { -4, -7, -8, -11, 3, 6, 7, 10 },
+    { -3, -5, -8, -11, 2, 4, 7, 10 },
+    { -2, -6, -8, -10, 1, 5, 7, 9 },
+    { -2, -5, -8, -10, 1, 4, 7, 9 },
+    { -2, -4, -8, -10, 1, 3, 7, 9 },
+    { -2, -5, -7, -10, 1, 4, 6, 9 },
+    { -3, -4, -7, -10, 2, 3, 6, 9 },
+    { -1, -2, -3, -10, 0, 1, 2, 9 },
+    { -4, -6, -8, -9, 3, 5, 7, 8 },
+    { -3, -5, -7, -9, 2, 4, 6, 8 }
+};
+
+// The table of the EAC modifiers that can encode a constant alpha exactly (modifier 0 at index 4).
+#define EAC_CONSTANT_TABLE 13
+#define EAC_CONSTANT_INDEX 4
+
+/**
+ * An RGBA8 image level of the mipmap chain.
+ */
+struct KTXLevel
+{
+    unsigned int width;
+    unsigned int height;
+    std::vector<unsigned char> pixels;
+    std::vector<unsigned char> blocks;
+};
+
+static inline int clampByte(int value)
+{
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+/**
+ * The best modifier table of an ETC subblock, with the modifier index of each of its pixels.
+ */
+struct ETCSubblock
+{
+    int table;
+    int indices[8];
+    int error;
+};
+
+static void encodeETCSubblock(const unsigned char* pixels[8], int r, int g, int b, ETCSubblock* result)
+{
+    result->error = INT_MAX;
+    for (int t = 0; t < 8; ++t)
+    {
+        // Modifier indices: 0 = +small, 1 = +large, 2 = -small, 3 = -large.
+        int modifiers[4] = { ETC_MODIFIERS[t][0], ETC_MODIFIERS[t][1], -ETC_MODIFIERS[t][0], -ETC_MODIFIERS[t][1] };
+        int error = 0;
+        int indices[8];
+        for (int i = 0; i < 8 && error < result->error; ++i)
+        {
+            int best = INT_MAX;
+            for (int m = 0; m < 4; ++m)
+            {
+                int dr = clampByte(r + modifiers[m]) - pixels[i][0];
+                int dg = clampByte(g + modifiers[m]) - pixels[i][1];
+                int db = clampByte(b + modifiers[m]) - pixels[i][2];
+                int e = dr * dr + dg * dg + db * db;
+                if (e < best)
+                {
+                    best = e;
+                    indices[i] = m;
+                }
+            }
+            error += best;
+        }
+        if (error < result->error)
+        {
+            result->error = error;
+            result->table = t;
+            memcpy(result->indices, indices, sizeof(indices));
+        }
+    }
+}
+
+static unsigned long long encodeETCBlock(const unsigned char* block[16])
+{
+    unsigned long long bestBits = 0;
+    int bestError = INT_MAX;
+
+    // Flip 0 splits the block into left and right 2x4 halves, flip 1 into top and bottom 4x2 halves.
+    for (int flip = 0; flip < 2; ++flip)
+    {
+        const unsigned char* sub[2][8];
+        int subPixel[2][8];
+        int counts[2] = { 0, 0 };
+        float sums[2][3] = { { 0, 0, 0 }, { 0, 0, 0 } };
+        for (int x = 0; x < 4; ++x)
+        {
+            for (int y = 0; y < 4; ++y)
+            {
+                // Pixels are numbered down the columns.
+                int index = x * 4 + y;
+                int s = flip ? (y >= 2) : (x >= 2);
+                const unsigned char* p = block[y * 4 + x];
+                sub[s][counts[s]] = p;
+                subPixel[s][counts[s]] = index;
+                ++counts[s];
+                sums[s][0] += p[0];
+                sums[s][1] += p[1];
+                sums[s][2] += p[2];
+            }
+        }
+
+        // Try the differential mode (5 bit colors) when the colors are close enough, and the individual mode (4 bit colors).
+        for (int differential = 1; differential >= 0; --differential)
+        {
+            int colors[2][3];
+            int bases[2][3];
+            bool valid = true;
+            for (int s = 0; s < 2; ++s)
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    float average = sums[s][c] / 8.0f;
+                    if (differential)
+                    {
+                        colors[s][c] = (int)(average * 31.0f / 255.0f + 0.5f);
+                        bases[s][c] = (colors[s][c] << 3) | (colors[s][c] >> 2);
+                    }
+                    else
+                    {
+                        colors[s][c] = (int)(average * 15.0f / 255.0f + 0.5f);
+                        bases[s][c] = (colors[s][c] << 4) | colors[s][c];
+                    }
+                }
+            }
+            if (differential)
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    int delta = colors[1][c] - colors[0][c];
+                    if (delta < -4 || delta > 3)
+                        valid = false;
+                }
+                if (!valid)
+                    continue;
+            }
+
+            ETCSubblock results[2];
+            encodeETCSubblock(sub[0], bases[0][0], bases[0][1], bases[0][2], &results[0]);
+            encodeETCSubblock(sub[1], bases[1][0], bases[1][1], bases[1][2], &results[1]);
+            int error = results[0].error + results[1].error;
+            if (error >= bestError)
+                continue;
+
+            unsigned int high;
+            if (differential)
+            {
+                high = (colors[0][0] << 27) | (((colors[1][0] - colors[0][0]) & 7) << 24) |
+                       (colors[0][1] << 19) | (((colors[1][1] - colors[0][1]) & 7) << 16) |
+                       (colors[0][2] << 11) | (((colors[1][2] - colors[0][2]) & 7) << 8);
+            }
+            else
+            {
+                high = (colors[0][0] << 28) | (colors[1][0] << 24) |
+                       (colors[0][1] << 20) | (colors[1][1] << 16) |
+                       (colors[0][2] << 12) | (colors[1][2] << 8);
+            }
+            high |= (results[0].table << 5) | (results[1].table << 2) | (differential << 1) | flip;
+
+            // The most significant bit of each pixel index is in the upper half of the low word.
+            unsigned int low = 0;
+            for (int s = 0; s < 2; ++s)
+            {
+                for (int i = 0; i < 8; ++i)
+                {
+                    int m = results[s].indices[i];
+                    int bit = subPixel[s][i];
+                    low |= ((m >> 1) & 1) << (bit + 16);
+                    low |= (m & 1) << bit;
+                }
+            }
+
+            bestError = error;
+            bestBits = ((unsigned long long)high << 32) | low;
+        }
+    }
+    return bestBits;
+}
+
+static unsigned long long encodeEACBlock(const unsigned char* block[16])
+{
+    int alpha[16];
+    int minAlpha = 255, maxAlpha = 0;
+    for (int x = 0; x < 4; ++x)
+    {
+        for (int y = 0; y < 4; ++y)
+        {
+            // Pixels are numbered down the columns.
+            int a = block[y * 4 + x][3];
+            alpha[x * 4 + y] = a;
+            minAlpha = std::min(minAlpha, a);
+            maxAlpha = std::max(maxAlpha, a);
+        }
+    }
+
+    int bestBase = minAlpha, bestMultiplier = 1, bestTable = EAC_CONSTANT_TABLE;
+    int bestIndices[16];
+    for (int i = 0; i < 16; ++i)
+        bestIndices[i] = EAC_CONSTANT_INDEX;
+
+    if (minAlpha != maxAlpha)
+    {
+        int bestError = INT_MAX;
+        for (int t = 0; t < 16 && bestError > 0; ++t)
+        {
+            // Fit the range of the table to the range of the block, and try the neighbouring values as well.
+            const int* modifiers = EAC_MODIFIERS[t];
+            int range = modifiers[7] - modifiers[3];
+            int multiplier = (maxAlpha - minAlpha + range / 2) / range;
+            for (int m = std::max(1, multiplier - 1); m <= std::min(15, multiplier + 1); ++m)
+            {
+                int center = minAlpha - modifiers[3] * m;
+                for (int base = std::max(0, center - 1); base <= std::min(255, center + 1); ++base)
+                {
+                    int error = 0;
+                    int indices[16];
+                    for (int i = 0; i < 16 && error < bestError; ++i)
+                    {
+                        int best = INT_MAX;
+                        for (int j = 0; j < 8; ++j)
+                        {
+                            int d = clampByte(base + modifiers[j] * m) - alpha[i];
+                            if (d * d < best)
+                            {
+                                best = d * d;
+                                indices[i] = j;
+                            }
+                        }
+                        error += best;
+                    }
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        bestBase = base;
+                        bestMultiplier = m;
+                        bestTable = t;
+                        memcpy(bestIndices, indices, sizeof(indices));
+                    }
+                }
+            }
+        }
+    }
+
+    unsigned long long bits = ((unsigned long long)bestBase << 56) | ((unsigned long long)bestMultiplier << 52) | ((unsigned long long)bestTable << 48);
+    for (int i = 0; i < 16; ++i)
+    {
+        bits |= (unsigned long long)bestIndices[i] << (45 - 3 * i);
+    }
+    return bits;
+}
+
+static void writeBigEndian(unsigned long long bits, std::vector<unsigned char>& out)
+{
+    for (int i = 7; i >= 0; --i)
+    {
+        out.push_back((unsigned char)(bits >> (i * 8)));
+    }
+}
+
+static void compressLevel(KTXLevel& level, bool alpha)
+{
+    unsigned int blocksX = (level.width + 3) / 4;
+    unsigned int blocksY = (level.height + 3) / 4;
+    level.blocks.reserve(blocksX * blocksY * (alpha ? 16 : 8));
+    for (unsigned int by = 0; by < blocksY; ++by)
+    {
+        for (unsigned int bx = 0; bx < blocksX; ++bx)
+        {
+            // Blocks on the edges of the image repeat its last row and column.
+            const unsigned char* block[16];
+            for (unsigned int y = 0; y < 4; ++y)
+            {
+                for (unsigned int x = 0; x < 4; ++x)
+                {
+                    unsigned int px = std::min(bx * 4 + x, level.width - 1);
+                    unsigned int py = std::min(by * 4 + y, level.height - 1);
+                    block[y * 4 + x] = &level.pixels[(py * level.width + px) * 4];
+                }
+            }
+
+            // RGBA8 blocks store the alpha block before the color block.
+            if (alpha)
+                writeBigEndian(encodeEACBlock(block), level.blocks);
+            writeBigEndian(encodeETCBlock(block), level.blocks);
+        }
+    }
+}
+
+static void downsample(const KTXLevel& src, KTXLevel& dst)
+{
+    dst.width = std::max(1u, src.width / 2);
+    dst.height = std::max(1u, src.height / 2);
+    dst.pixels.resize(dst.width * dst.height * 4);
+    for (unsigned int y = 0; y < dst.height; ++y)
+    {
+        for (unsigned int x = 0; x < dst.width; ++x)
+        {
+            // Average the 2x2 source pixels, repeating the last row or column of odd sizes.
+            unsigned int x0 = std::min(x * 2, src.width - 1), x1 = std::min(x * 2 + 1, src.width - 1);
+            unsigned int y0 = std::min(y * 2, src.height - 1), y1 = std::min(y * 2 + 1, src.height - 1);
+            for (unsigned int c = 0; c < 4; ++c)
+            {
+                unsigned int sum = src.pixels[(y0 * src.width + x0) * 4 + c] + src.pixels[(y0 * src.width + x1) * 4 + c] +
+                                   src.pixels[(y1 * src.width + x0) * 4 + c] + src.pixels[(y1 * src.width + x1) * 4 + c];
+                dst.pixels[(y * dst.width + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+static void writeUint(unsigned int value, std::vector<unsigned char>& out)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        out.push_back((unsigned char)(value >> (i * 8)));
+    }
+}
+
+static void writeUint64(unsigned long long value, std::vector<unsigned char>& out)
+{
+    writeUint((unsigned int)value, out);
+    writeUint((unsigned int)(value >> 32), out);
+}
+
+/**
+ * Reads a PNG image expanded to RGBA, halved until it fits in maxSize.
+ */
+static bool loadLevel(const char* imagePath, unsigned int maxSize, KTXLevel* level, bool* alpha)
+{
+    Image* image = Image::create(imagePath);
+    if (image == NULL)
+        return false;
+
+    // Expand the image to RGBA.
+    level->width = image->getWidth();
+    level->height = image->getHeight();
+    level->pixels.resize(level->width * level->height * 4);
+    const unsigned char* data = (const unsigned char*)image->getData();
+    unsigned int bpp = image->getBpp();
+    *alpha = false;
+    for (unsigned int i = 0, count = level->width * level->height; i < count; ++i)
+    {
+        const unsigned char* src = data + i * bpp;
+        unsigned char* dst = &level->pixels[i * 4];
+        if (bpp < 3)
+        {
+            dst[0] = dst[1] = dst[2] = src[0];
+        }
+        else
+        {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+        }
+        dst[3] = bpp == 4 ? src[3] : 255;
+        *alpha = *alpha || dst[3] != 255;
+    }
+    delete image;
+
+    if (maxSize > 0 && (level->width > maxSize || level->height > maxSize))
+    {
+        unsigned int width = level->width, height = level->height;
+        while (level->width > maxSize || level->height > maxSize)
+        {
+            KTXLevel half;
+            downsample(*level, half);
+            level->width = half.width;
+            level->height = half.height;
+            level->pixels.swap(half.pixels);
+        }
+        LOG(1, "Resized image from %ux%u to %ux%u.\n", width, height, level->width, level->height);
+    }
+    return true;
+}
+
+int writeKTX(const char* imagePath, const char* outFilePath, unsigned int maxSize)
+{
+    std::vector<KTXLevel> levels(1);
+    bool alpha;
+    if (!loadLevel(imagePath, maxSize, &levels[0], &alpha))
+        return -1;
+
+    // Generate the mipmap chain and compress each level.
+    while (levels.back().width > 1 || levels.back().height > 1)
+    {
+        KTXLevel level;
+        downsample(levels.back(), level);
+        levels.push_back(level);
+    }
+    for (size_t i = 0, count = levels.size(); i < count; ++i)
+    {
+        compressLevel(levels[i], alpha);
+    }
+    LOG(1, "Compressed %u mipmap levels to ETC2 %s.\n", (unsigned int)levels.size(), alpha ? "RGBA8" : "RGB8");
+
+    // The data format descriptor of the ETC2 blocks.
+    unsigned int blockSize = alpha ? 16 : 8;
+    unsigned int sampleCount = alpha ? 2 : 1;
+    std::vector<unsigned char> dfd;
+    writeUint(4 + 24 + 16 * sampleCount, dfd);
+    writeUint(0, dfd);                                                   // vendorId, descriptorType
+    writeUint(2 | ((24 + 16 * sampleCount) << 16), dfd);                 // versionNumber, descriptorBlockSize
+    writeUint(KHR_DF_MODEL_ETC2 | (KHR_DF_PRIMARIES_BT709 << 8) | (KHR_DF_TRANSFER_LINEAR << 16), dfd);
+    writeUint(3 | (3 << 8), dfd);                                        // texelBlockDimension (4x4)
+    writeUint(blockSize, dfd);                                           // bytesPlane0
+    writeUint(0, dfd);
+    for (unsigned int i = 0; i < sampleCount; ++i)
+    {
+        unsigned int channel = (alpha && i == 0) ? KHR_DF_CHANNEL_ETC2_ALPHA : KHR_DF_CHANNEL_ETC2_COLOR;
+        writeUint((i * 64) | (63 << 16) | (channel << 24), dfd);         // bitOffset, bitLength, channelType
+        writeUint(0, dfd);                                               // samplePosition
+        writeUint(0, dfd);                                               // sampleLower
+        writeUint(0xFFFFFFFF, dfd);                                      // sampleUpper
+    }
+
+    // The header, index and level index are followed by the data format descriptor and the levels,
+    // which are stored from the smallest to the largest and aligned to the block size.
+    unsigned int levelCount = (unsigned int)levels.size();
+    unsigned int dfdOffset = KTX2_IDENTIFIER_LENGTH + 17 * 4 + levelCount * 24;
+    std::vector<unsigned long long> offsets(levelCount);
+    unsigned long long offset = dfdOffset + dfd.size();
+    for (int i = (int)levelCount - 1; i >= 0; --i)
+    {
+        offset = (offset + blockSize - 1) / blockSize * blockSize;
+        offsets[i] = offset;
+        offset += levels[i].blocks.size();
+    }
+
+    std::vector<unsigned char> header(KTX2_IDENTIFIER, KTX2_IDENTIFIER + KTX2_IDENTIFIER_LENGTH);
+    writeUint(alpha ? VK_FORMAT_ETC2_RGBA8 : VK_FORMAT_ETC2_RGB8, header);
+    writeUint(1, header);                                                // typeSize
+    writeUint(levels[0].width, header);
+    writeUint(levels[0].height, header);
+    writeUint(0, header);                                                // pixelDepth
+    writeUint(0, header);                                                // layerCount
+    writeUint(1, header);                                                // faceCount
+    writeUint(levelCount, header);
+    writeUint(0, header);                                                // supercompressionScheme
+    writeUint(dfdOffset, header);
+    writeUint((unsigned int)dfd.size(), header);
+    writeUint(0, header);                                                // kvdByteOffset
+    writeUint(0, header);                                                // kvdByteLength
+    writeUint64(0, header);                                              // sgdByteOffset
+    writeUint64(0, header);                                              // sgdByteLength
+    for (unsigned int i = 0; i < levelCount; ++i)
+    {
+        writeUint64(offsets[i], header);
+        writeUint64(levels[i].blocks.size(), header);
+        writeUint64(levels[i].blocks.size(), header);
+    }
+    header.insert(header.end(), dfd.begin(), dfd.end());
+    for (int i = (int)levelCount - 1; i >= 0; --i)
+    {
+        header.resize((size_t)offsets[i], 0);
+        header.insert(header.end(), levels[i].blocks.begin(), levels[i].blocks.end());
+    }
+
+    FILE* file = fopen(outFilePath, "wb");
+    if (file == NULL)
+    {
+        LOG(1, "Error: Failed to open file for writing: %s\n", outFilePath);
+        return -1;
+    }
+    bool written = fwrite(&header[0], 1, header.size(), file) == header.size();
+    if (fclose(file) != 0 || !written)
+    {
+        LOG(1, "Error: Failed to write file: %s\n", outFilePath);
+        return -1;
+    }
+    LOG(1, "Wrote texture: %s\n", outFilePath);
+    return 0;
+}
+
+int writeResizedImage(const char* imagePath, const char* outFilePath, unsigned int maxSize)
+{
+    KTXLevel level;
+    bool alpha;
+    if (!loadLevel(imagePath, maxSize, &level, &alpha))
+        return -1;
+
+    // Opaque images drop their alpha channel.
+    Image* image = Image::create(alpha ? Image::RGBA : Image::RGB, level.width, level.height);
+    if (image == NULL)
+        return -1;
+    if (!alpha)
+    {
+        for (unsigned int i = 0, count = level.width * level.height; i < count; ++i)
+        {
+            memmove(&level.pixels[i * 3], &level.pixels[i * 4], 3);
+        }
+    }
+    image->setData(&level.pixels[0]);
+    image->save(outFilePath);
+    delete image;
+    LOG(1, "Wrote image: %s\n", outFilePath);
+    return 0;
+}
+
+}
@@ -0,0 +1,42 @@
+#ifndef KTXENCODER_H_
+#define KTXENCODER_H_
+
+namespace gameplay
+{
+
+/**
+ * Converts a PNG image into a KTX2 texture that is compressed with ETC2.
+ *
+ * A full mipmap chain is generated with a box filter and each level is compressed to ETC2
+ * blocks: images that have transparent pixels are written in the ETC2 RGBA8 format (EAC
+ * alpha), and other images in the ETC2 RGB8 format. The color of each block is encoded in
+ * the individual or differential mode that ETC2 shares with ETC1, which keeps the encoder
+ * simple and fast at the cost of some quality compared to the other ETC2 modes.
+ *
+ * The runtime loads the file with Texture::create on devices that support ETC2, which
+ * includes every OpenGL ES 3 device.
+ *
+ * @param imagePath The path of the PNG image to convert.
+ * @param outFilePath The path of the KTX2 file to write.
+ * @param maxSize The largest width and height of the texture, which the image is halved to
+ *      fit in before its mipmaps are generated, or zero to keep the size of the image.
+ *
+ * @return 0 if successful, -1 if error.
+ */
+int writeKTX(const char* imagePath, const char* outFilePath, unsigned int maxSize = 0);
+
+/**
+ * Writes a PNG image halved with a box filter until its width and height fit in maxSize, for
+ * the targets that load uncompressed textures.
+ *
+ * @param imagePath The path of the PNG image to resize.
+ * @param outFilePath The path of the PNG image to write.
+ * @param maxSize The largest width and height of the written image.
+ *
+ * @return 0 if successful, -1 if error.
+ */
+int writeResizedImage(const char* imagePath, const char* outFilePath, unsigned int maxSize);
+
+}
+
+#endif
@@ -82,6 +82,36 @@ bool Light::isAmbient() const
     return _lightType == AmbientLight;
 }
 
+bool Light::isDirectional() const
+{
+    return _lightType == DirectionalLight;
+}
+
+bool Light::isPoint() const
+{
+    return _lightType == PointLight;
+}
+
+bool Light::isSpot() const
+{
+    return _lightType == SpotLight;
+}
+
+float Light::getRange() const
+{
+    return _range;
+}
+
+float Light::getInnerAngle() const
+{
+    return _innerAngle;
+}
+
+float Light::getOuterAngle() const
+{
+    return _outerAngle;
+}
+
 void Light::setAmbientLight()
 {
     _lightType = AmbientLight;
@@ -33,6 +33,36 @@ public:
 
     bool isAmbient() const;
 
+    /**
+     * Returns true if this is a directional light.
+     */
+    bool isDirectional() const;
+
+    /**
+     * Returns true if this is a point light.
+     */
+    bool isPoint() const;
+
+    /**
+     * Returns true if this is a spot light.
+     */
+    bool isSpot() const;
+
+    /**
+     * Returns the range of this light.
+     */
+    float getRange() const;
+
+    /**
+     * Returns the inner angle of this spot light, in radians.
+     */
+    float getInnerAngle() const;
+
+    /**
+     * Returns the outer angle of this spot light, in radians.
+     */
+    float getOuterAngle() const;
+
     /**
      * Sets the light type to ambient.
      */
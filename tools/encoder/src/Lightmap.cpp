@@ -0,0 +1,882 @@
+#include "Base.h"
+#include "Lightmap.h"
+#include "Image.h"
+#include "Thread.h"
+
+// The number of texels around each chart, which keeps filtering and mipmaps from blending charts together
+#define LIGHTMAP_GUTTER 2
+
+// The number of rays that the ambient occlusion of a texel is sampled with
+#define LIGHTMAP_AMBIENT_RAYS 32
+
+// The largest number of triangles in a leaf of the bounding volume hierarchy
+#define LIGHTMAP_LEAF_TRIANGLES 4
+
+// The largest depth of the bounding volume hierarchy that rays are traced through
+#define LIGHTMAP_STACK_SIZE 64
+
+// The distance from the center of a texel, in texels, up to which a triangle covers the texel, so that
+// the texels that triangles only partly cover are lit from the nearest point of a triangle
+#define LIGHTMAP_COVERAGE 0.7072f
+
+// Marks the texels that no chart covers
+#define LIGHTMAP_NO_COVERAGE FLT_MAX
+
+namespace gameplay
+{
+
+/**
+ * A triangle in world space that rays are traced against.
+ */
+struct LightmapTriangle
+{
+    Vector3 v0;
+    Vector3 edge1;
+    Vector3 edge2;
+};
+
+/**
+ * A node of the bounding volume hierarchy. The children of an inner node, which has no triangles,
+ * are at first and first + 1.
+ */
+struct LightmapBvhNode
+{
+    Vector3 min;
+    Vector3 max;
+    unsigned int first;
+    unsigned int count;
+};
+
+/**
+ * A group of connected triangles of a mesh that face the same axis, projected onto the plane of
+ * that axis and placed in the atlas.
+ */
+struct LightmapChart
+{
+    unsigned int axis;
+    float min[2];
+    float max[2];
+    unsigned int x;
+    unsigned int y;
+    unsigned int width;
+    unsigned int height;
+};
+
+/**
+ * A mesh that is baked, with its vertices in world space.
+ */
+struct LightmapMesh
+{
+    Node* node;
+    std::vector<Vector3> positions;
+    std::vector<Vector3> normals;
+    std::vector<unsigned int> triangleCharts;
+};
+
+/**
+ * A light that is baked, in world space.
+ */
+struct LightmapLight
+{
+    bool isDirectional;
+    bool isSpot;
+    Vector3 color;
+    Vector3 position;
+    Vector3 direction;
+    float range;
+    float innerAngleCos;
+    float outerAngleCos;
+};
+
+/**
+ * The texels to light and what they are lit by.
+ */
+struct LightmapBake
+{
+    const std::vector<LightmapBvhNode>* nodes;
+    const std::vector<LightmapTriangle>* triangles;
+    const std::vector<LightmapLight>* lights;
+    Vector3 ambientColor;
+    float ambientDistance;
+    float sceneDistance;
+    const std::vector<unsigned int>* texels;
+    const std::vector<Vector3>* origins;
+    const std::vector<Vector3>* normals;
+    std::vector<Vector3>* colors;
+};
+
+static float component(const Vector3& v, unsigned int axis)
+{
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+/**
+ * Orders triangles by the coordinate of their centers on an axis.
+ */
+struct LightmapCenterLess
+{
+    const std::vector<Vector3>* centers;
+    unsigned int axis;
+
+    bool operator()(unsigned int a, unsigned int b) const
+    {
+        return component((*centers)[a], axis) < component((*centers)[b], axis);
+    }
+};
+
+/**
+ * Orders charts from the tallest to the shortest.
+ */
+struct LightmapChartTaller
+{
+    const std::vector<LightmapChart>* charts;
+
+    bool operator()(unsigned int a, unsigned int b) const
+    {
+        const LightmapChart& ca = (*charts)[a];
+        const LightmapChart& cb = (*charts)[b];
+        return ca.max[1] - ca.min[1] > cb.max[1] - cb.min[1];
+    }
+};
+
+static Vector3 subtract(const Vector3& a, const Vector3& b)
+{
+    return Vector3(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+static Vector3 multiplyAdd(const Vector3& a, const Vector3& b, float s)
+{
+    return Vector3(a.x + b.x * s, a.y + b.y * s, a.z + b.z * s);
+}
+
+static Vector3 cross(const Vector3& a, const Vector3& b)
+{
+    Vector3 dst;
+    Vector3::cross(a, b, &dst);
+    return dst;
+}
+
+/**
+ * Transforms a normal by the cofactors of the upper 3x3 of a matrix, which keeps it perpendicular
+ * to the surface under non-uniform and mirroring scales.
+ */
+static Vector3 transformNormal(const Matrix& matrix, const Vector3& n)
+{
+    const float* m = matrix.m;
+    Vector3 c0 = cross(Vector3(m[4], m[5], m[6]), Vector3(m[8], m[9], m[10]));
+    Vector3 c1 = cross(Vector3(m[8], m[9], m[10]), Vector3(m[0], m[1], m[2]));
+    Vector3 c2 = cross(Vector3(m[0], m[1], m[2]), Vector3(m[4], m[5], m[6]));
+    Vector3 v(c0.x * n.x + c1.x * n.y + c2.x * n.z,
+              c0.y * n.x + c1.y * n.y + c2.y * n.z,
+              c0.z * n.x + c1.z * n.y + c2.z * n.z);
+    if (matrix.determinant() < 0.0f)
+        v.negate();
+    v.normalize();
+    return v;
+}
+
+static unsigned int findRoot(std::vector<unsigned int>& parents, unsigned int i)
+{
+    while (parents[i] != i)
+    {
+        parents[i] = parents[parents[i]];
+        i = parents[i];
+    }
+    return i;
+}
+
+static void buildBvhNode(std::vector<LightmapBvhNode>& nodes, const std::vector<LightmapTriangle>& triangles,
+                         const std::vector<Vector3>& centers, std::vector<unsigned int>& order,
+                         unsigned int nodeIndex, unsigned int first, unsigned int count)
+{
+    Vector3 min(FLT_MAX, FLT_MAX, FLT_MAX);
+    Vector3 max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    Vector3 centerMin = min;
+    Vector3 centerMax = max;
+    for (unsigned int i = first; i < first + count; ++i)
+    {
+        const LightmapTriangle& triangle = triangles[order[i]];
+        Vector3 corners[3] = { triangle.v0, multiplyAdd(triangle.v0, triangle.edge1, 1.0f), multiplyAdd(triangle.v0, triangle.edge2, 1.0f) };
+        for (unsigned int j = 0; j < 3; ++j)
+        {
+            min.set(std::min(min.x, corners[j].x), std::min(min.y, corners[j].y), std::min(min.z, corners[j].z));
+            max.set(std::max(max.x, corners[j].x), std::max(max.y, corners[j].y), std::max(max.z, corners[j].z));
+        }
+        const Vector3& center = centers[order[i]];
+        centerMin.set(std::min(centerMin.x, center.x), std::min(centerMin.y, center.y), std::min(centerMin.z, center.z));
+        centerMax.set(std::max(centerMax.x, center.x), std::max(centerMax.y, center.y), std::max(centerMax.z, center.z));
+    }
+    nodes[nodeIndex].min = min;
+    nodes[nodeIndex].max = max;
+    if (count <= LIGHTMAP_LEAF_TRIANGLES)
+    {
+        nodes[nodeIndex].first = first;
+        nodes[nodeIndex].count = count;
+        return;
+    }
+
+    // Split the triangles in half along the axis that their centers spread the most on.
+    Vector3 extent = subtract(centerMax, centerMin);
+    LightmapCenterLess less;
+    less.centers = &centers;
+    less.axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+    const unsigned int middle = first + count / 2;
+    std::nth_element(order.begin() + first, order.begin() + middle, order.begin() + first + count, less);
+
+    const unsigned int left = nodes.size();
+    nodes.resize(left + 2);
+    nodes[nodeIndex].first = left;
+    nodes[nodeIndex].count = 0;
+    buildBvhNode(nodes, triangles, centers, order, left, first, middle - first);
+    buildBvhNode(nodes, triangles, centers, order, left + 1, middle, first + count - middle);
+}
+
+/**
+ * Builds the bounding volume hierarchy of the triangles, and reorders the triangles so that each
+ * leaf has a range of them.
+ */
+static void buildBvh(std::vector<LightmapBvhNode>& nodes, std::vector<LightmapTriangle>& triangles)
+{
+    std::vector<Vector3> centers(triangles.size());
+    std::vector<unsigned int> order(triangles.size());
+    for (unsigned int i = 0; i < triangles.size(); ++i)
+    {
+        const LightmapTriangle& triangle = triangles[i];
+        centers[i] = multiplyAdd(triangle.v0, multiplyAdd(triangle.edge1, triangle.edge2, 1.0f), 1.0f / 3.0f);
+        order[i] = i;
+    }
+    nodes.resize(1);
+    buildBvhNode(nodes, triangles, centers, order, 0, 0, triangles.size());
+
+    std::vector<LightmapTriangle> ordered(triangles.size());
+    for (unsigned int i = 0; i < order.size(); ++i)
+    {
+        ordered[i] = triangles[order[i]];
+    }
+    triangles.swap(ordered);
+}
+
+static bool intersectSlab(float origin, float inverseDirection, float min, float max, float* tmin, float* tmax)
+{
+    float t1 = (min - origin) * inverseDirection;
+    float t2 = (max - origin) * inverseDirection;
+    if (t1 > t2)
+        std::swap(t1, t2);
+    *tmin = std::max(*tmin, t1);
+    *tmax = std::min(*tmax, t2);
+    return *tmin <= *tmax;
+}
+
+/**
+ * Returns true if a ray hits a triangle closer than a distance.
+ */
+static bool isOccluded(const LightmapBake& bake, const Vector3& origin, const Vector3& direction, float distance)
+{
+    const std::vector<LightmapBvhNode>& nodes = *bake.nodes;
+    const std::vector<LightmapTriangle>& triangles = *bake.triangles;
+    const Vector3 inverse(1.0f / (fabs(direction.x) > 1e-12f ? direction.x : 1e-12f),
+                          1.0f / (fabs(direction.y) > 1e-12f ? direction.y : 1e-12f),
+                          1.0f / (fabs(direction.z) > 1e-12f ? direction.z : 1e-12f));
+
+    unsigned int stack[LIGHTMAP_STACK_SIZE];
+    unsigned int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0)
+    {
+        const LightmapBvhNode& node = nodes[stack[--stackSize]];
+        float tmin = 0.0f;
+        float tmax = distance;
+        if (!intersectSlab(origin.x, inverse.x, node.min.x, node.max.x, &tmin, &tmax) ||
+            !intersectSlab(origin.y, inverse.y, node.min.y, node.max.y, &tmin, &tmax) ||
+            !intersectSlab(origin.z, inverse.z, node.min.z, node.max.z, &tmin, &tmax))
+            continue;
+
+        if (node.count == 0)
+        {
+            if (stackSize + 2 <= LIGHTMAP_STACK_SIZE)
+            {
+                stack[stackSize++] = node.first;
+                stack[stackSize++] = node.first + 1;
+            }
+            continue;
+        }
+
+        // Moller-Trumbore, for both sides of the triangles.
+        for (unsigned int i = node.first; i < node.first + node.count; ++i)
+        {
+            const LightmapTriangle& triangle = triangles[i];
+            Vector3 p = cross(direction, triangle.edge2);
+            float determinant = Vector3::dot(triangle.edge1, p);
+            if (fabs(determinant) < 1e-12f)
+                continue;
+            float inverseDeterminant = 1.0f / determinant;
+            Vector3 s = subtract(origin, triangle.v0);
+            float u = Vector3::dot(s, p) * inverseDeterminant;
+            if (u < 0.0f || u > 1.0f)
+                continue;
+            Vector3 q = cross(s, triangle.edge1);
+            float v = Vector3::dot(direction, q) * inverseDeterminant;
+            if (v < 0.0f || u + v > 1.0f)
+                continue;
+            float t = Vector3::dot(triangle.edge2, q) * inverseDeterminant;
+            if (t > 0.0f && t < distance)
+                return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Computes the barycentric coordinates of the point of a triangle in the atlas that is the nearest
+ * to a point, and returns the distance to it.
+ */
+static float findNearestPoint(const Vector2& p, const Vector2* corners, float* weights)
+{
+    const float e1x = corners[1].x - corners[0].x, e1y = corners[1].y - corners[0].y;
+    const float e2x = corners[2].x - corners[0].x, e2y = corners[2].y - corners[0].y;
+    const float px = p.x - corners[0].x, py = p.y - corners[0].y;
+    const float denominator = e1x * e2y - e2x * e1y;
+    if (fabs(denominator) > 1e-12f)
+    {
+        float s = (px * e2y - e2x * py) / denominator;
+        float t = (e1x * py - px * e1y) / denominator;
+        if (s >= 0.0f && t >= 0.0f && s + t <= 1.0f)
+        {
+            weights[0] = 1.0f - s - t;
+            weights[1] = s;
+            weights[2] = t;
+            return 0.0f;
+        }
+    }
+
+    // The point is outside of the triangle, so the nearest point is on one of its edges.
+    float nearest = FLT_MAX;
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        const Vector2& a = corners[i];
+        const Vector2& b = corners[(i + 1) % 3];
+        const float ex = b.x - a.x, ey = b.y - a.y;
+        const float length = ex * ex + ey * ey;
+        float t = length > 0.0f ? ((p.x - a.x) * ex + (p.y - a.y) * ey) / length : 0.0f;
+        t = std::min(std::max(t, 0.0f), 1.0f);
+        const float dx = a.x + ex * t - p.x, dy = a.y + ey * t - p.y;
+        const float distance = dx * dx + dy * dy;
+        if (distance < nearest)
+        {
+            nearest = distance;
+            weights[i] = 1.0f - t;
+            weights[(i + 1) % 3] = t;
+            weights[(i + 2) % 3] = 0.0f;
+        }
+    }
+    return sqrt(nearest);
+}
+
+/**
+ * Places the charts in the atlas in rows, from the tallest to the shortest, at a number of texels
+ * per world unit, and returns false if they don't fit.
+ */
+static bool packCharts(std::vector<LightmapChart>& charts, const std::vector<unsigned int>& order, float scale, unsigned int size)
+{
+    unsigned int x = 0;
+    unsigned int y = 0;
+    unsigned int rowHeight = 0;
+    for (unsigned int i = 0; i < order.size(); ++i)
+    {
+        LightmapChart& chart = charts[order[i]];
+        chart.width = (unsigned int)ceil((chart.max[0] - chart.min[0]) * scale) + 1 + LIGHTMAP_GUTTER * 2;
+        chart.height = (unsigned int)ceil((chart.max[1] - chart.min[1]) * scale) + 1 + LIGHTMAP_GUTTER * 2;
+        if (chart.width > size || chart.height > size)
+            return false;
+        if (x + chart.width > size)
+        {
+            x = 0;
+            y += rowHeight;
+            rowHeight = 0;
+        }
+        if (y + chart.height > size)
+            return false;
+        chart.x = x;
+        chart.y = y;
+        x += chart.width;
+        rowHeight = std::max(rowHeight, chart.height);
+    }
+    return true;
+}
+
+/**
+ * Returns the position of a point of a chart in the atlas, in texels.
+ */
+static Vector2 getAtlasPosition(const LightmapChart& chart, const Vector3& position, float scale)
+{
+    const unsigned int axis = chart.axis / 2;
+    return Vector2(chart.x + LIGHTMAP_GUTTER + 0.5f + (component(position, (axis + 1) % 3) - chart.min[0]) * scale,
+                   chart.y + LIGHTMAP_GUTTER + 0.5f + (component(position, (axis + 2) % 3) - chart.min[1]) * scale);
+}
+
+/**
+ * Returns a pseudo-random number between 0 and 1.
+ */
+static float nextRandom(unsigned int* state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return (*state >> 8) * (1.0f / 16777216.0f);
+}
+
+static void lightTexels(unsigned int begin, unsigned int end, unsigned int thread, void* arg)
+{
+    const LightmapBake& bake = *(const LightmapBake*)arg;
+    const std::vector<LightmapLight>& lights = *bake.lights;
+    const bool hasAmbient = bake.ambientColor.x > 0.0f || bake.ambientColor.y > 0.0f || bake.ambientColor.z > 0.0f;
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        const unsigned int texel = (*bake.texels)[i];
+        const Vector3& origin = (*bake.origins)[texel];
+        const Vector3& normal = (*bake.normals)[texel];
+        Vector3 color(0.0f, 0.0f, 0.0f);
+
+        for (unsigned int j = 0; j < lights.size(); ++j)
+        {
+            const LightmapLight& light = lights[j];
+            Vector3 direction;
+            float distance;
+            float attenuation = 1.0f;
+            if (light.isDirectional)
+            {
+                direction.set(-light.direction.x, -light.direction.y, -light.direction.z);
+                distance = bake.sceneDistance;
+            }
+            else
+            {
+                // The same attenuation as the point and spot lights of lighting.frag.
+                direction = subtract(light.position, origin);
+                distance = direction.length();
+                if (distance >= light.range || distance <= 0.0f)
+                    continue;
+                attenuation = 1.0f - (distance * distance) / (light.range * light.range);
+                direction.scale(1.0f / distance);
+                if (light.isSpot)
+                {
+                    float angleCos = -Vector3::dot(light.direction, direction);
+                    float t = (angleCos - light.outerAngleCos) / std::max(light.innerAngleCos - light.outerAngleCos, 1e-6f);
+                    t = std::min(std::max(t, 0.0f), 1.0f);
+                    attenuation *= t * t * (3.0f - 2.0f * t);
+                }
+            }
+            float diffuse = Vector3::dot(normal, direction) * attenuation;
+            if (diffuse <= 0.0f || isOccluded(bake, origin, direction, distance))
+                continue;
+            color = multiplyAdd(color, light.color, diffuse);
+        }
+
+        if (hasAmbient)
+        {
+            // Cosine weighted rays over the hemisphere above the texel.
+            Vector3 tangent = fabs(normal.x) < 0.9f ? cross(normal, Vector3::unitX()) : cross(normal, Vector3::unitY());
+            tangent.normalize();
+            Vector3 binormal = cross(normal, tangent);
+            unsigned int state = texel * 2654435761u + 1u;
+            unsigned int visible = 0;
+            for (unsigned int j = 0; j < LIGHTMAP_AMBIENT_RAYS; ++j)
+            {
+                float angle = nextRandom(&state) * MATH_PIX2;
+                float radius2 = nextRandom(&state);
+                float radius = sqrt(radius2);
+                Vector3 direction = multiplyAdd(multiplyAdd(Vector3(normal.x * sqrt(1.0f - radius2), normal.y * sqrt(1.0f - radius2), normal.z * sqrt(1.0f - radius2)),
+                                                            tangent, cos(angle) * radius), binormal, sin(angle) * radius);
+                if (!isOccluded(bake, origin, direction, bake.ambientDistance))
+                    ++visible;
+            }
+            color = multiplyAdd(color, bake.ambientColor, (float)visible / LIGHTMAP_AMBIENT_RAYS);
+        }
+
+        (*bake.colors)[texel] = color;
+    }
+}
+
+bool Lightmap::bake(const std::vector<Node*>& nodes, const std::vector<Node*>& lights, const float* ambientColor,
+                    unsigned int size, const char* filename)
+{
+    assert(filename);
+
+    // Group the triangles of each mesh into charts of connected triangles that face the same axis,
+    // out of the six axes, and find the bounds of each chart on the plane of its axis.
+    std::vector<LightmapMesh> meshes(nodes.size());
+    std::vector<LightmapChart> charts;
+    std::vector<LightmapTriangle> triangles;
+    Vector3 sceneMin(FLT_MAX, FLT_MAX, FLT_MAX);
+    Vector3 sceneMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    float chartArea = 0.0f;
+    float chartExtent = 0.0f;
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        LightmapMesh& lightmapMesh = meshes[i];
+        lightmapMesh.node = nodes[i];
+        const Mesh* mesh = nodes[i]->getModel()->getMesh();
+        const Matrix& world = nodes[i]->getWorldMatrix();
+        const unsigned int vertexCount = mesh->getVertexCount();
+        lightmapMesh.positions.resize(vertexCount);
+        lightmapMesh.normals.resize(vertexCount);
+        for (unsigned int v = 0; v < vertexCount; ++v)
+        {
+            const Vertex& vertex = mesh->getVertex(v);
+            world.transformPoint(vertex.position, &lightmapMesh.positions[v]);
+            lightmapMesh.normals[v] = vertex.hasNormal ? transformNormal(world, vertex.normal) : Vector3::zero();
+            const Vector3& p = lightmapMesh.positions[v];
+            sceneMin.set(std::min(sceneMin.x, p.x), std::min(sceneMin.y, p.y), std::min(sceneMin.z, p.z));
+            sceneMax.set(std::max(sceneMax.x, p.x), std::max(sceneMax.y, p.y), std::max(sceneMax.z, p.z));
+        }
+
+        std::vector<unsigned int> axes;
+        std::vector<unsigned int> parents;
+        std::vector<int> owners(vertexCount * 6, -1);
+        for (size_t k = 0; k < mesh->parts.size(); ++k)
+        {
+            const MeshPart* part = mesh->parts[k];
+            for (unsigned int n = 0, count = part->getIndicesCount() - part->getIndicesCount() % 3; n < count; n += 3)
+            {
+                const unsigned int a = part->getIndex(n), b = part->getIndex(n + 1), c = part->getIndex(n + 2);
+                if (a >= vertexCount || b >= vertexCount || c >= vertexCount)
+                {
+                    LOG(1, "WARNING: Mesh part has an index out of range; no lightmap is baked: %s\n", filename);
+                    return false;
+                }
+                LightmapTriangle triangle;
+                triangle.v0 = lightmapMesh.positions[a];
+                triangle.edge1 = subtract(lightmapMesh.positions[b], triangle.v0);
+                triangle.edge2 = subtract(lightmapMesh.positions[c], triangle.v0);
+                triangles.push_back(triangle);
+
+                Vector3 normal = cross(triangle.edge1, triangle.edge2);
+                const float nx = fabs(normal.x), ny = fabs(normal.y), nz = fabs(normal.z);
+                const unsigned int axis = nx >= ny && nx >= nz ? 0 : (ny >= nz ? 1 : 2);
+                const unsigned int index = axes.size();
+                axes.push_back(axis * 2 + (component(normal, axis) < 0.0f ? 1 : 0));
+                parents.push_back(index);
+                const unsigned int corners[3] = { a, b, c };
+                for (unsigned int j = 0; j < 3; ++j)
+                {
+                    int& owner = owners[corners[j] * 6 + axes[index]];
+                    if (owner < 0)
+                        owner = (int)index;
+                    else
+                        parents[findRoot(parents, index)] = findRoot(parents, (unsigned int)owner);
+                }
+            }
+        }
+
+        std::map<unsigned int, unsigned int> rootCharts;
+        lightmapMesh.triangleCharts.resize(axes.size());
+        unsigned int t = 0;
+        for (size_t k = 0; k < mesh->parts.size(); ++k)
+        {
+            const MeshPart* part = mesh->parts[k];
+            for (unsigned int n = 0, count = part->getIndicesCount() - part->getIndicesCount() % 3; n < count; n += 3, ++t)
+            {
+                const unsigned int root = findRoot(parents, t);
+                std::map<unsigned int, unsigned int>::const_iterator itr = rootCharts.find(root);
+                unsigned int chartIndex;
+                if (itr == rootCharts.end())
+                {
+                    chartIndex = charts.size();
+                    rootCharts[root] = chartIndex;
+                    LightmapChart chart;
+                    chart.axis = axes[root];
+                    chart.min[0] = chart.min[1] = FLT_MAX;
+                    chart.max[0] = chart.max[1] = -FLT_MAX;
+                    charts.push_back(chart);
+                }
+                else
+                {
+                    chartIndex = itr->second;
+                }
+                lightmapMesh.triangleCharts[t] = chartIndex;
+
+                LightmapChart& chart = charts[chartIndex];
+                const unsigned int axis = chart.axis / 2;
+                for (unsigned int j = 0; j < 3; ++j)
+                {
+                    const Vector3& p = lightmapMesh.positions[part->getIndex(n + j)];
+                    const float u = component(p, (axis + 1) % 3);
+                    const float v = component(p, (axis + 2) % 3);
+                    chart.min[0] = std::min(chart.min[0], u);
+                    chart.min[1] = std::min(chart.min[1], v);
+                    chart.max[0] = std::max(chart.max[0], u);
+                    chart.max[1] = std::max(chart.max[1], v);
+                }
+            }
+        }
+    }
+    if (charts.empty())
+        return false;
+    for (size_t i = 0; i < charts.size(); ++i)
+    {
+        const LightmapChart& chart = charts[i];
+        chartArea += (chart.max[0] - chart.min[0]) * (chart.max[1] - chart.min[1]);
+        chartExtent = std::max(chartExtent, std::max(chart.max[0] - chart.min[0], chart.max[1] - chart.min[1]));
+    }
+
+    // Find the largest number of texels per world unit that the charts fit in the atlas at.
+    std::vector<unsigned int> order(charts.size());
+    for (unsigned int i = 0; i < order.size(); ++i)
+    {
+        order[i] = i;
+    }
+    LightmapChartTaller taller;
+    taller.charts = &charts;
+    std::sort(order.begin(), order.end(), taller);
+    float high = chartArea > 0.0f ? sqrt((float)size * size / chartArea) : 1.0f;
+    if (chartExtent > 0.0f)
+        high = std::min(high, (size - 1 - LIGHTMAP_GUTTER * 2) / chartExtent);
+    float low = 0.0f;
+    if (packCharts(charts, order, high, size))
+    {
+        low = high;
+    }
+    else
+    {
+        for (unsigned int i = 0; i < 24; ++i)
+        {
+            const float scale = (low + high) * 0.5f;
+            if (packCharts(charts, order, scale, size))
+                low = scale;
+            else
+                high = scale;
+        }
+    }
+    const float scale = low;
+    if (scale <= 0.0f || !packCharts(charts, order, scale, size))
+    {
+        LOG(1, "WARNING: The %u charts of the baked meshes don't fit in a %ux%u lightmap: %s\n", (unsigned int)charts.size(), size, size, filename);
+        return false;
+    }
+
+    // Duplicate the vertices that several charts share, set the position of each vertex in the
+    // atlas, and find the texels that the triangles cover.
+    const Vector3 sceneExtent = subtract(sceneMax, sceneMin);
+    const float sceneDistance = std::max(sceneExtent.length(), 1e-6f);
+    const float bias = sceneDistance * 1e-4f;
+    std::vector<float> coverage(size * size, LIGHTMAP_NO_COVERAGE);
+    std::vector<Vector3> origins(size * size);
+    std::vector<Vector3> normals(size * size);
+    std::map<unsigned long long, unsigned int> remap;
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        const LightmapMesh& lightmapMesh = meshes[i];
+        Mesh* mesh = lightmapMesh.node->getModel()->getMesh();
+        addTexCoordElement(mesh);
+
+        remap.clear();
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> sources;
+        std::vector<unsigned int> indices;
+        unsigned int t = 0;
+        for (size_t k = 0; k < mesh->parts.size(); ++k)
+        {
+            MeshPart* part = mesh->parts[k];
+            indices.clear();
+            for (unsigned int n = 0, count = part->getIndicesCount() - part->getIndicesCount() % 3; n < count; n += 3, ++t)
+            {
+                const unsigned int chartIndex = lightmapMesh.triangleCharts[t];
+                const LightmapChart& chart = charts[chartIndex];
+                unsigned int corners[3];
+                for (unsigned int j = 0; j < 3; ++j)
+                {
+                    const unsigned int source = part->getIndex(n + j);
+                    const unsigned long long key = ((unsigned long long)chartIndex << 32) | source;
+                    std::map<unsigned long long, unsigned int>::const_iterator itr = remap.find(key);
+                    if (itr == remap.end())
+                    {
+                        Vertex vertex = mesh->getVertex(source);
+                        Vector2 position = getAtlasPosition(chart, lightmapMesh.positions[source], scale);
+                        vertex.hasTexCoord[1] = true;
+                        vertex.texCoord[1] = Vector2(position.x / size, position.y / size);
+                        corners[j] = vertices.size();
+                        remap[key] = corners[j];
+                        vertices.push_back(vertex);
+                        sources.push_back(source);
+                    }
+                    else
+                    {
+                        corners[j] = itr->second;
+                    }
+                    indices.push_back(corners[j]);
+                }
+
+                const Vector3* positions[3];
+                const Vector3* vertexNormals[3];
+                Vector2 texels[3];
+                for (unsigned int j = 0; j < 3; ++j)
+                {
+                    positions[j] = &lightmapMesh.positions[sources[corners[j]]];
+                    vertexNormals[j] = &lightmapMesh.normals[sources[corners[j]]];
+                    texels[j] = Vector2(vertices[corners[j]].texCoord[1].x * size, vertices[corners[j]].texCoord[1].y * size);
+                }
+                Vector3 faceNormal = cross(subtract(*positions[1], *positions[0]), subtract(*positions[2], *positions[0]));
+                if (faceNormal.lengthSquared() <= 0.0f)
+                    continue;
+                faceNormal.normalize();
+
+                const int x0 = std::max((int)floor(std::min(texels[0].x, std::min(texels[1].x, texels[2].x)) - LIGHTMAP_COVERAGE), 0);
+                const int y0 = std::max((int)floor(std::min(texels[0].y, std::min(texels[1].y, texels[2].y)) - LIGHTMAP_COVERAGE), 0);
+                const int x1 = std::min((int)ceil(std::max(texels[0].x, std::max(texels[1].x, texels[2].x)) + LIGHTMAP_COVERAGE), (int)size - 1);
+                const int y1 = std::min((int)ceil(std::max(texels[0].y, std::max(texels[1].y, texels[2].y)) + LIGHTMAP_COVERAGE), (int)size - 1);
+                for (int y = y0; y <= y1; ++y)
+                {
+                    for (int x = x0; x <= x1; ++x)
+                    {
+                        float weights[3];
+                        const float distance = findNearestPoint(Vector2(x + 0.5f, y + 0.5f), texels, weights);
+                        const unsigned int texel = y * size + x;
+                        if (distance > LIGHTMAP_COVERAGE || distance >= coverage[texel])
+                            continue;
+                        coverage[texel] = distance;
+                        Vector3 position = multiplyAdd(multiplyAdd(Vector3(positions[0]->x * weights[0], positions[0]->y * weights[0], positions[0]->z * weights[0]),
+                                                                   *positions[1], weights[1]), *positions[2], weights[2]);
+                        Vector3 normal = multiplyAdd(multiplyAdd(Vector3(vertexNormals[0]->x * weights[0], vertexNormals[0]->y * weights[0], vertexNormals[0]->z * weights[0]),
+                                                                 *vertexNormals[1], weights[1]), *vertexNormals[2], weights[2]);
+                        if (normal.lengthSquared() > 0.0f)
+                            normal.normalize();
+                        else
+                            normal = faceNormal;
+
+                        // Rays start just above the surface, so that they don't hit the triangle that they start from.
+                        origins[texel] = multiplyAdd(position, Vector3::dot(faceNormal, normal) < 0.0f ? Vector3(-faceNormal.x, -faceNormal.y, -faceNormal.z) : faceNormal, bias);
+                        normals[texel] = normal;
+                    }
+                }
+            }
+            part->setIndices(indices);
+        }
+        mesh->vertices.swap(vertices);
+        mesh->updateVertexLookupTable();
+    }
+
+    // Light the covered texels on all of the threads.
+    std::vector<LightmapLight> lightmapLights;
+    for (size_t i = 0; i < lights.size(); ++i)
+    {
+        const Light* light = lights[i]->getLight();
+        if (!light || light->isAmbient())
+            continue;
+        const Matrix& world = lights[i]->getWorldMatrix();
+        LightmapLight lightmapLight;
+        lightmapLight.isDirectional = light->isDirectional();
+        lightmapLight.isSpot = light->isSpot();
+        lightmapLight.color.set(light->getRed(), light->getGreen(), light->getBlue());
+        world.transformPoint(Vector3::zero(), &lightmapLight.position);
+        lightmapLight.direction.set(-world.m[8], -world.m[9], -world.m[10]);
+        lightmapLight.direction.normalize();
+        lightmapLight.range = light->getRange();
+        lightmapLight.innerAngleCos = cos(light->getInnerAngle());
+        lightmapLight.outerAngleCos = cos(light->getOuterAngle());
+        lightmapLights.push_back(lightmapLight);
+    }
+
+    std::vector<unsigned int> texels;
+    for (unsigned int i = 0; i < coverage.size(); ++i)
+    {
+        if (coverage[i] != LIGHTMAP_NO_COVERAGE)
+            texels.push_back(i);
+    }
+
+    std::vector<LightmapBvhNode> bvh;
+    buildBvh(bvh, triangles);
+    std::vector<Vector3> colors(size * size, Vector3::zero());
+    LightmapBake bake;
+    bake.nodes = &bvh;
+    bake.triangles = &triangles;
+    bake.lights = &lightmapLights;
+    bake.ambientColor.set(ambientColor[0], ambientColor[1], ambientColor[2]);
+    // Ambient light is occluded by the geometry that is near, as it is in a room or under a roof,
+    // rather than by the whole scene, which would leave the inside of the scene without ambient light.
+    bake.ambientDistance = sceneDistance * 0.1f;
+    bake.sceneDistance = sceneDistance * 2.0f;
+    bake.texels = &texels;
+    bake.origins = &origins;
+    bake.normals = &normals;
+    bake.colors = &colors;
+    parallelFor(texels.size(), 256, &lightTexels, &bake);
+
+    // Fill the gutters from the texels next to them, and the rest of the atlas with the average
+    // color, so that the mipmaps of the charts don't blend with black.
+    std::vector<float> filled(coverage);
+    for (unsigned int pass = 0; pass <= LIGHTMAP_GUTTER; ++pass)
+    {
+        for (unsigned int y = 0; y < size; ++y)
+        {
+            for (unsigned int x = 0; x < size; ++x)
+            {
+                const unsigned int texel = y * size + x;
+                if (coverage[texel] != LIGHTMAP_NO_COVERAGE)
+                    continue;
+                Vector3 sum(0.0f, 0.0f, 0.0f);
+                unsigned int count = 0;
+                for (unsigned int ny = y > 0 ? y - 1 : 0; ny <= std::min(y + 1, size - 1); ++ny)
+                {
+                    for (unsigned int nx = x > 0 ? x - 1 : 0; nx <= std::min(x + 1, size - 1); ++nx)
+                    {
+                        if (coverage[ny * size + nx] != LIGHTMAP_NO_COVERAGE)
+                        {
+                            sum = multiplyAdd(sum, colors[ny * size + nx], 1.0f);
+                            ++count;
+                        }
+                    }
+                }
+                if (count > 0)
+                {
+                    sum.scale(1.0f / count);
+                    colors[texel] = sum;
+                    filled[texel] = 0.0f;
+                }
+            }
+        }
+        coverage = filled;
+    }
+    Vector3 average(0.0f, 0.0f, 0.0f);
+    for (unsigned int i = 0; i < texels.size(); ++i)
+    {
+        average = multiplyAdd(average, colors[texels[i]], 1.0f / texels.size());
+    }
+
+    // The rows of the image go down, and the texture coordinates go up.
+    Image* image = Image::create(Image::RGB, size, size);
+    unsigned char* data = (unsigned char*)image->getData();
+    for (unsigned int y = 0; y < size; ++y)
+    {
+        for (unsigned int x = 0; x < size; ++x)
+        {
+            const unsigned int texel = y * size + x;
+            const Vector3& color = coverage[texel] != LIGHTMAP_NO_COVERAGE ? colors[texel] : average;
+            unsigned char* pixel = data + ((size - 1 - y) * size + x) * 3;
+            pixel[0] = (unsigned char)(std::min(std::max(color.x, 0.0f), 1.0f) * 255.0f + 0.5f);
+            pixel[1] = (unsigned char)(std::min(std::max(color.y, 0.0f), 1.0f) * 255.0f + 0.5f);
+            pixel[2] = (unsigned char)(std::min(std::max(color.z, 0.0f), 1.0f) * 255.0f + 0.5f);
+        }
+    }
+    image->save(filename);
+    delete image;
+
+    LOG(2, "  Baked %u mesh(es) into %u chart(s) of %u texel(s) in a %ux%u lightmap, at %f texels per unit: %s\n",
+        (unsigned int)meshes.size(), (unsigned int)charts.size(), (unsigned int)texels.size(), size, size, scale, filename);
+    return true;
+}
+
+void Lightmap::addTexCoordElement(Mesh* mesh)
+{
+    // The elements are in the order that Vertex::writeBinary writes the components of the vertices in.
+    std::vector<VertexElement>& elements = mesh->_vertexFormat;
+    std::vector<VertexElement>::iterator itr = elements.begin();
+    for (; itr != elements.end(); ++itr)
+    {
+        if (itr->usage == TEXCOORD1)
+            return;
+        if (itr->usage == COLOR || itr->usage == BLENDWEIGHTS || itr->usage == BLENDINDICES || itr->usage > TEXCOORD1)
+            break;
+    }
+    elements.insert(itr, VertexElement(TEXCOORD1, Vertex::TEXCOORD_COUNT));
+}
+
+}
@@ -0,0 +1,59 @@
+#ifndef LIGHTMAP_H_
+#define LIGHTMAP_H_
+
+#include "Node.h"
+
+namespace gameplay
+{
+
+/**
+ * Bakes the lighting of static meshes into a lightmap image, which the meshes sample with their
+ * second set of texture coordinates.
+ *
+ * The triangles of each mesh are grouped into charts of connected triangles that face the same
+ * axis, and each chart is projected onto the plane of that axis, so that the charts keep the world
+ * size of their triangles. The charts of all of the meshes are packed into one square atlas, with a
+ * gutter around each chart, at the largest texel density that fits. The vertices on the border of
+ * two charts are duplicated, and the position of each vertex in the atlas is stored as TEXCOORD1.
+ *
+ * Each texel of a chart is lit at the position and normal of the surface under it by the directional,
+ * point and spot lights, with a shadow ray towards each light, and by the ambient color, occluded by
+ * the geometry that rays over the hemisphere above the texel hit nearby. Rays are traced against the
+ * baked meshes in a bounding volume hierarchy, and the texels are lit on all of the threads. The
+ * texels around the charts are filled from the charts, so that filtering does not blend the charts
+ * with the background.
+ *
+ * Materials sample the lightmap with the LIGHTMAP define and the u_lightmapTexture sampler.
+ */
+class Lightmap
+{
+public:
+
+    /**
+     * Bakes the lighting of the meshes of the given nodes into a lightmap image.
+     *
+     * The mesh of each node must not be skinned nor used by another node, and its parts must be
+     * lists of triangles. The vertices of the meshes are changed to add their lightmap coordinates.
+     *
+     * @param nodes The nodes whose meshes are baked.
+     * @param lights The nodes of the directional, point and spot lights to bake.
+     * @param ambientColor The ambient color of the scene, as three floats.
+     * @param size The width and height of the lightmap, in texels.
+     * @param filename The PNG file to save the lightmap to.
+     *
+     * @return true if the lightmap was baked and saved, false if the meshes don't fit in it.
+     */
+    static bool bake(const std::vector<Node*>& nodes, const std::vector<Node*>& lights, const float* ambientColor,
+                     unsigned int size, const char* filename);
+
+private:
+
+    /**
+     * Adds the TEXCOORD1 element to the vertex format of a mesh, if it doesn't have it.
+     */
+    static void addTexCoordElement(Mesh* mesh);
+};
+
+}
+
+#endif
@@ -2,10 +2,132 @@
 #include "Mesh.h"
 #include "Model.h"
 
+// The number of float components of a vertex that are compared when vertices are welded
+#define VERTEX_COMPONENT_COUNT (3 * 4 + 2 * MAX_UV_SETS + 4 * 3)
+
+// The smallest number of slots of the vertex lookup table
+#define VERTEX_LOOKUP_MIN_SIZE 64
+
 namespace gameplay
 {
 
-Mesh::Mesh(void) : model(NULL)
+/**
+ * Converts a float to a 16-bit half float, rounding to the nearest half float.
+ */
+static unsigned short floatToHalf(float value)
+{
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(unsigned int));
+    unsigned int sign = (bits >> 16) & 0x8000;
+    unsigned int mantissa = bits & 0x7FFFFF;
+    unsigned int floatExponent = (bits >> 23) & 0xFF;
+    int exponent = (int)floatExponent - 127 + 15;
+    if (floatExponent == 0xFF)
+    {
+        // Infinity or NaN.
+        return (unsigned short)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    }
+    if (exponent >= 31)
+    {
+        // Too large, so it becomes infinity.
+        return (unsigned short)(sign | 0x7C00);
+    }
+    if (exponent <= 0)
+    {
+        // Too small for a normalized half float, so it is denormalized or becomes zero.
+        if (exponent < -10)
+            return (unsigned short)sign;
+        mantissa |= 0x800000;
+        unsigned int shift = (unsigned int)(14 - exponent);
+        unsigned int half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1)
+            ++half;
+        return (unsigned short)(sign | half);
+    }
+    // Rounding may carry into the exponent, which is still the nearest half float.
+    unsigned int half = sign | ((unsigned int)exponent << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000)
+        ++half;
+    return (unsigned short)half;
+}
+
+/**
+ * Converts a float in [-1, 1] to a normalized signed 16-bit integer.
+ */
+static unsigned short floatToSnorm16(float value)
+{
+    value = std::max(-1.0f, std::min(1.0f, value));
+    return (unsigned short)(short)floor(value * 32767.0f + 0.5f);
+}
+
+/**
+ * Maps a direction onto the unit octahedron, and unfolds the lower half of the octahedron
+ * over the corners of the square, so that the direction is kept in two components.
+ */
+static Vector2 encodeOctahedral(const Vector3& direction)
+{
+    float sum = fabs(direction.x) + fabs(direction.y) + fabs(direction.z);
+    if (sum == 0.0f)
+        return Vector2(0.0f, 0.0f);
+    float x = direction.x / sum;
+    float y = direction.y / sum;
+    if (direction.z < 0.0f)
+    {
+        float foldedX = (1.0f - fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float foldedY = (1.0f - fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+    return Vector2(x, y);
+}
+
+/**
+ * Copies the components of a vertex that are compared when vertices are welded.
+ */
+static void getVertexComponents(const Vertex& vertex, float* components)
+{
+    const Vector3* vectors[4] = { &vertex.position, &vertex.normal, &vertex.tangent, &vertex.binormal };
+    for (unsigned int i = 0; i < 4; ++i)
+    {
+        *components++ = vectors[i]->x;
+        *components++ = vectors[i]->y;
+        *components++ = vectors[i]->z;
+    }
+    for (unsigned int i = 0; i < MAX_UV_SETS; ++i)
+    {
+        *components++ = vertex.texCoord[i].x;
+        *components++ = vertex.texCoord[i].y;
+    }
+    const Vector4* colors[3] = { &vertex.diffuse, &vertex.blendWeights, &vertex.blendIndices };
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        *components++ = colors[i]->x;
+        *components++ = colors[i]->y;
+        *components++ = colors[i]->z;
+        *components++ = colors[i]->w;
+    }
+}
+
+/**
+ * Quantizes a component of a vertex to an integer, so that the components that are welded
+ * together have the same value. Blend indices are never quantized.
+ */
+static int quantizeComponent(float value, float epsilon, bool exact)
+{
+    if (exact || epsilon <= 0.0f)
+    {
+        // Treat -0 as 0, since they compare equal.
+        if (value == 0.0f)
+            return 0;
+        int bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+    return (int)floor(value / epsilon + 0.5f);
+}
+
+Mesh::Mesh(void) : model(NULL), _weldEpsilon(0.0f), _vertexLookupCount(0), _weldedVertexCount(0),
+    _quantized(false), _positionDecodeScale(1.0f, 1.0f, 1.0f)
 {
 }
 
@@ -36,6 +158,13 @@ void Mesh::writeBinary(FILE* file)
     writeBinaryVertices(file);
     // parts
     writeBinaryObjects(parts, file);
+    // levels of detail
+    write((unsigned int)lodParts.size(), file);
+    for (size_t i = 0; i < lodParts.size(); ++i)
+    {
+        write(lodErrors[i], file);
+        writeBinaryObjects(lodParts[i], file);
+    }
 }
 
 void Mesh::writeBinaryVertices(FILE* file)
@@ -45,13 +174,29 @@ void Mesh::writeBinaryVertices(FILE* file)
         // Assumes that all vertices are the same size.
         // Write the number of bytes for the vertex data
         const Vertex& vertex = vertices.front();
-        write((unsigned int)(vertices.size() * vertex.byteSize()), file); // (vertex count) * (vertex size)
-
-        // for each vertex
-        for (std::vector<Vertex>::const_iterator i = vertices.begin(); i != vertices.end(); ++i)
+        if (_quantized)
+        {
+            unsigned int vertexSize = 0;
+            for (std::vector<VertexElement>::const_iterator i = _vertexFormat.begin(); i != _vertexFormat.end(); ++i)
+            {
+                vertexSize += i->byteSize();
+            }
+            write((unsigned int)(vertices.size() * vertexSize), file);
+            for (std::vector<Vertex>::const_iterator i = vertices.begin(); i != vertices.end(); ++i)
+            {
+                writeQuantizedVertex(*i, file);
+            }
+        }
+        else
         {
-            // Write this vertex
-            i->writeBinary(file);
+            write((unsigned int)(vertices.size() * vertex.byteSize()), file); // (vertex count) * (vertex size)
+
+            // for each vertex
+            for (std::vector<Vertex>::const_iterator i = vertices.begin(); i != vertices.end(); ++i)
+            {
+                // Write this vertex
+                i->writeBinary(file);
+            }
         }
     }
     else
@@ -65,6 +210,10 @@ void Mesh::writeBinaryVertices(FILE* file)
     write(&bounds.max.x, 3, file);
     write(&bounds.center.x, 3, file);
     write(bounds.radius, file);
+
+    // Write the scale and offset that decode quantized positions
+    write(&_positionDecodeScale.x, 3, file);
+    write(&_positionDecodeOffset.x, 3, file);
 }
 
 void Mesh::writeText(FILE* file)
@@ -101,6 +250,15 @@ void Mesh::writeText(FILE* file)
     fprintf(file, "</center>\n");
     fprintf(file, "<radius>%f</radius>\n", bounds.radius);
     fprintf(file, "</bounds>\n");
+    if (_quantized)
+    {
+        fprintf(file, "<positionDecodeScale>\n");
+        writeVectorText(_positionDecodeScale, file);
+        fprintf(file, "</positionDecodeScale>\n");
+        fprintf(file, "<positionDecodeOffset>\n");
+        writeVectorText(_positionDecodeOffset, file);
+        fprintf(file, "</positionDecodeOffset>\n");
+    }
 
     // for each MeshPart
     for (std::vector<MeshPart*>::iterator i = parts.begin(); i != parts.end(); ++i)
@@ -108,6 +266,17 @@ void Mesh::writeText(FILE* file)
         (*i)->writeText(file);
     }
 
+    // for each level of detail
+    for (size_t i = 0; i < lodParts.size(); ++i)
+    {
+        fprintf(file, "<lod error=\"%f\">\n", lodErrors[i]);
+        for (std::vector<MeshPart*>::iterator j = lodParts[i].begin(); j != lodParts[i].end(); ++j)
+        {
+            (*j)->writeText(file);
+        }
+        fprintf(file, "</lod>\n");
+    }
+
     fprintElementEnd(file);
 }
 
@@ -146,24 +315,160 @@ const VertexElement& Mesh::getVertexElement(unsigned int index) const
     return _vertexFormat[index];
 }
 
+void Mesh::setWeldEpsilon(float epsilon)
+{
+    _weldEpsilon = epsilon > 0.0f ? epsilon : 0.0f;
+    updateVertexLookupTable();
+}
+
+float Mesh::getWeldEpsilon() const
+{
+    return _weldEpsilon;
+}
+
 bool Mesh::contains(const Vertex& vertex) const
 {
-    return vertexLookupTable.count(vertex) > 0;
+    if (_vertexLookupTable.empty())
+        return false;
+    return _vertexLookupTable[findSlot(vertex, hashVertex(vertex))] != 0;
 }
 
 unsigned int Mesh::addVertex(const Vertex& vertex)
 {
     unsigned int index = getVertexCount();
     vertices.push_back(vertex);
-    vertexLookupTable[vertex] = index;
+    insertVertexIndex(index, hashVertex(vertex));
+    return index;
+}
+
+unsigned int Mesh::findOrAddVertex(const Vertex& vertex)
+{
+    unsigned int hash = hashVertex(vertex);
+    if (!_vertexLookupTable.empty())
+    {
+        unsigned int entry = _vertexLookupTable[findSlot(vertex, hash)];
+        if (entry != 0)
+        {
+            ++_weldedVertexCount;
+            return entry - 1;
+        }
+    }
+    unsigned int index = getVertexCount();
+    vertices.push_back(vertex);
+    insertVertexIndex(index, hash);
     return index;
 }
 
 unsigned int Mesh::getVertexIndex(const Vertex& vertex)
 {
-    std::map<Vertex,unsigned int>::iterator it;
-    it = vertexLookupTable.find(vertex);
-    return it->second;
+    assert(!_vertexLookupTable.empty());
+    unsigned int entry = _vertexLookupTable[findSlot(vertex, hashVertex(vertex))];
+    assert(entry != 0);
+    return entry - 1;
+}
+
+unsigned int Mesh::getWeldedVertexCount() const
+{
+    return _weldedVertexCount;
+}
+
+void Mesh::updateVertexLookupTable()
+{
+    _vertexLookupTable.clear();
+    _vertexHashes.clear();
+    _vertexLookupCount = 0;
+    for (unsigned int i = 0, count = getVertexCount(); i < count; ++i)
+    {
+        insertVertexIndex(i, hashVertex(vertices[i]));
+    }
+}
+
+unsigned int Mesh::hashVertex(const Vertex& vertex) const
+{
+    float components[VERTEX_COMPONENT_COUNT];
+    getVertexComponents(vertex, components);
+
+    // FNV-1a over the quantized components.
+    unsigned int hash = 2166136261u;
+    for (unsigned int i = 0; i < VERTEX_COMPONENT_COUNT; ++i)
+    {
+        unsigned int value = (unsigned int)quantizeComponent(components[i], _weldEpsilon, i >= VERTEX_COMPONENT_COUNT - 4);
+        for (unsigned int j = 0; j < 4; ++j)
+        {
+            hash ^= (value >> (8 * j)) & 0xFF;
+            hash *= 16777619u;
+        }
+    }
+    return hash;
+}
+
+bool Mesh::equalVertices(const Vertex& v1, const Vertex& v2) const
+{
+    if (_weldEpsilon <= 0.0f)
+        return v1 == v2;
+
+    float components1[VERTEX_COMPONENT_COUNT];
+    float components2[VERTEX_COMPONENT_COUNT];
+    getVertexComponents(v1, components1);
+    getVertexComponents(v2, components2);
+    for (unsigned int i = 0; i < VERTEX_COMPONENT_COUNT; ++i)
+    {
+        bool exact = i >= VERTEX_COMPONENT_COUNT - 4;
+        if (quantizeComponent(components1[i], _weldEpsilon, exact) != quantizeComponent(components2[i], _weldEpsilon, exact))
+            return false;
+    }
+    return true;
+}
+
+unsigned int Mesh::findSlot(const Vertex& vertex, unsigned int hash) const
+{
+    // The table is open addressed with linear probing, and holds the index of each vertex plus one.
+    const unsigned int mask = (unsigned int)_vertexLookupTable.size() - 1;
+    unsigned int slot = hash & mask;
+    while (_vertexLookupTable[slot] != 0)
+    {
+        unsigned int index = _vertexLookupTable[slot] - 1;
+        if (_vertexHashes[index] == hash && equalVertices(vertices[index], vertex))
+            break;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void Mesh::insertVertexIndex(unsigned int index, unsigned int hash)
+{
+    if (_vertexHashes.size() <= index)
+        _vertexHashes.resize(index + 1);
+    _vertexHashes[index] = hash;
+
+    // Keep the table at most half full, so that probes stay short.
+    if ((_vertexLookupCount + 1) * 2 > _vertexLookupTable.size())
+    {
+        size_t size = std::max((size_t)VERTEX_LOOKUP_MIN_SIZE, _vertexLookupTable.size() * 2);
+        std::vector<unsigned int> table(size, 0);
+        const unsigned int mask = (unsigned int)size - 1;
+        for (size_t i = 0; i < _vertexLookupTable.size(); ++i)
+        {
+            unsigned int entry = _vertexLookupTable[i];
+            if (entry != 0)
+            {
+                unsigned int slot = _vertexHashes[entry - 1] & mask;
+                while (table[slot] != 0)
+                    slot = (slot + 1) & mask;
+                table[slot] = entry;
+            }
+        }
+        _vertexLookupTable.swap(table);
+    }
+
+    // A vertex that is welded to one that was added before is not indexed, so that lookups
+    // find the first one.
+    unsigned int slot = findSlot(vertices[index], hash);
+    if (_vertexLookupTable[slot] == 0)
+    {
+        _vertexLookupTable[slot] = index + 1;
+        ++_vertexLookupCount;
+    }
 }
 
 bool Mesh::hasNormals() const
@@ -230,4 +535,159 @@ void Mesh::computeBounds()
     bounds.radius = sqrt(bounds.radius);
 }
 
+void Mesh::quantize()
+{
+    if (_quantized || vertices.empty())
+        return;
+
+    // Positions are decoded from [-1, 1] to the box around the vertices.
+    Vector3 min = vertices[0].position;
+    Vector3 max = vertices[0].position;
+    float maxBlendIndex = 0.0f;
+    for (std::vector<Vertex>::const_iterator i = vertices.begin(); i != vertices.end(); ++i)
+    {
+        min.x = std::min(min.x, i->position.x);
+        min.y = std::min(min.y, i->position.y);
+        min.z = std::min(min.z, i->position.z);
+        max.x = std::max(max.x, i->position.x);
+        max.y = std::max(max.y, i->position.y);
+        max.z = std::max(max.z, i->position.z);
+        if (i->hasWeights)
+        {
+            maxBlendIndex = std::max(maxBlendIndex, std::max(std::max(i->blendIndices.x, i->blendIndices.y), std::max(i->blendIndices.z, i->blendIndices.w)));
+        }
+    }
+    _positionDecodeScale.set((max.x - min.x) * 0.5f, (max.y - min.y) * 0.5f, (max.z - min.z) * 0.5f);
+    _positionDecodeOffset.set((max.x + min.x) * 0.5f, (max.y + min.y) * 0.5f, (max.z + min.z) * 0.5f);
+
+    for (std::vector<VertexElement>::iterator i = _vertexFormat.begin(); i != _vertexFormat.end(); ++i)
+    {
+        switch (i->usage)
+        {
+        case POSITION:
+            // The fourth component keeps the positions aligned to four bytes, and is decoded as one.
+            *i = VertexElement(POSITION, 4, VERTEX_TYPE_SHORT, true);
+            break;
+        case NORMAL:
+        case TANGENT:
+        case BINORMAL:
+            *i = VertexElement(i->usage, 2, VERTEX_TYPE_SHORT, true);
+            break;
+        case BLENDWEIGHTS:
+            *i = VertexElement(BLENDWEIGHTS, 4, VERTEX_TYPE_UNSIGNED_BYTE, true);
+            break;
+        case BLENDINDICES:
+            if (maxBlendIndex < 256.0f)
+            {
+                *i = VertexElement(BLENDINDICES, 4, VERTEX_TYPE_UNSIGNED_BYTE, false);
+            }
+            else
+            {
+                LOG(1, "Warning: Blend indices of mesh '%s' are kept as floats, since there are more than 256 joints.\n", getId().c_str());
+            }
+            break;
+        case COLOR:
+            break;
+        default:
+            if (i->usage >= TEXCOORD0 && i->usage <= TEXCOORD7)
+            {
+                *i = VertexElement(i->usage, 2, VERTEX_TYPE_HALF_FLOAT, false);
+            }
+            break;
+        }
+    }
+
+    _quantized = true;
+}
+
+bool Mesh::isQuantized() const
+{
+    return _quantized;
+}
+
+void Mesh::writeQuantizedVertex(const Vertex& vertex, FILE* file)
+{
+    // The elements of the vertex format are in the same order as the vertex writes them.
+    for (std::vector<VertexElement>::const_iterator i = _vertexFormat.begin(); i != _vertexFormat.end(); ++i)
+    {
+        const VertexElement& e = *i;
+        if (e.type == VERTEX_TYPE_FLOAT)
+        {
+            switch (e.usage)
+            {
+            case COLOR:
+                writeVectorBinary(vertex.diffuse, file);
+                break;
+            case BLENDINDICES:
+                writeVectorBinary(vertex.blendIndices, file);
+                break;
+            default:
+                assert(false);
+                break;
+            }
+            continue;
+        }
+
+        switch (e.usage)
+        {
+        case POSITION:
+            {
+                const Vector3& p = vertex.position;
+                const Vector3& s = _positionDecodeScale;
+                const Vector3& o = _positionDecodeOffset;
+                write(floatToSnorm16(s.x > 0.0f ? (p.x - o.x) / s.x : 0.0f), file);
+                write(floatToSnorm16(s.y > 0.0f ? (p.y - o.y) / s.y : 0.0f), file);
+                write(floatToSnorm16(s.z > 0.0f ? (p.z - o.z) / s.z : 0.0f), file);
+                write(floatToSnorm16(1.0f), file);
+            }
+            break;
+        case NORMAL:
+        case TANGENT:
+        case BINORMAL:
+            {
+                const Vector3& direction = e.usage == NORMAL ? vertex.normal : (e.usage == TANGENT ? vertex.tangent : vertex.binormal);
+                Vector2 v = encodeOctahedral(direction);
+                write(floatToSnorm16(v.x), file);
+                write(floatToSnorm16(v.y), file);
+            }
+            break;
+        case BLENDWEIGHTS:
+            {
+                // Round the weights so that they still add up to one, by giving what is left
+                // over to the largest weight.
+                const float weights[4] = { vertex.blendWeights.x, vertex.blendWeights.y, vertex.blendWeights.z, vertex.blendWeights.w };
+                int values[4];
+                int sum = 0;
+                unsigned int largest = 0;
+                for (unsigned int j = 0; j < 4; ++j)
+                {
+                    values[j] = (int)floor(std::max(0.0f, std::min(1.0f, weights[j])) * 255.0f + 0.5f);
+                    sum += values[j];
+                    if (weights[j] > weights[largest])
+                        largest = j;
+                }
+                if (sum > 0)
+                    values[largest] = std::max(0, std::min(255, values[largest] + 255 - sum));
+                for (unsigned int j = 0; j < 4; ++j)
+                    write((unsigned char)values[j], file);
+            }
+            break;
+        case BLENDINDICES:
+            write((unsigned char)vertex.blendIndices.x, file);
+            write((unsigned char)vertex.blendIndices.y, file);
+            write((unsigned char)vertex.blendIndices.z, file);
+            write((unsigned char)vertex.blendIndices.w, file);
+            break;
+        default:
+            {
+                assert(e.usage >= TEXCOORD0 && e.usage <= TEXCOORD7);
+                const Vector2& uv = vertex.texCoord[e.usage - TEXCOORD0];
+                write(floatToHalf(uv.x), file);
+                write(floatToHalf(uv.y), file);
+            }
+            break;
+        }
+    }
+}
+
 }
@@ -15,6 +15,7 @@ class Model;
 class Mesh : public Object
 {
     friend class Model;
+    friend class Lightmap;
 
 public:
 
@@ -48,6 +49,20 @@ public:
     size_t getVertexElementCount() const;
     const VertexElement& getVertexElement(unsigned int index) const;
 
+    /**
+     * Sets the tolerance that vertices are welded with.
+     *
+     * Each component of a vertex is quantized to a multiple of the epsilon, and vertices are
+     * welded together if their quantized components are equal. An epsilon of zero only welds
+     * vertices that are exactly equal. This should be set before vertices are added.
+     */
+    void setWeldEpsilon(float epsilon);
+
+    /**
+     * Returns the tolerance that vertices are welded with.
+     */
+    float getWeldEpsilon() const;
+
     /**
      * Returns true if this MeshPart contains the given Vertex.
      */
@@ -58,21 +73,94 @@ public:
      */
     unsigned int addVertex(const Vertex& vertex);
 
+    /**
+     * Returns the index of the vertex that the given vertex is welded to,
+     * adding the vertex if there is none.
+     */
+    unsigned int findOrAddVertex(const Vertex& vertex);
+
     unsigned int getVertexIndex(const Vertex& vertex);
 
+    /**
+     * Returns the number of vertices that were welded to a vertex that was already added.
+     */
+    unsigned int getWeldedVertexCount() const;
+
+    /**
+     * Rebuilds the lookup table of the vertices, after the vertices were changed or reordered.
+     */
+    void updateVertexLookupTable();
+
     bool hasNormals() const;
     bool hasVertexColors() const;
 
     void computeBounds();
 
+    /**
+     * Quantizes the vertices of the mesh as they are written.
+     *
+     * Positions are stored as normalized 16-bit integers relative to the bounds of the vertices,
+     * with a scale and an offset that decode them. Normals, tangents and binormals are stored as
+     * two normalized 16-bit integers, by mapping them onto an octahedron. Texture coordinates are
+     * stored as half floats, and blend weights and blend indices are stored as 8-bit integers.
+     * Colors are kept as floats. This should be called once the vertices no longer change.
+     */
+    void quantize();
+
+    /**
+     * Returns true if the vertices of the mesh are quantized.
+     */
+    bool isQuantized() const;
+
     Model* model;
     std::vector<Vertex> vertices;
     std::vector<MeshPart*> parts;
     BoundingVolume bounds;
-    std::map<Vertex, unsigned int> vertexLookupTable;
+
+    /**
+     * The errors of the levels of detail of the mesh beyond the mesh itself, relative to the
+     * radius of the mesh, and the parts of each level, one for each part of the mesh.
+     */
+    std::vector<float> lodErrors;
+    std::vector<std::vector<MeshPart*> > lodParts;
 
 private:
+
+    /**
+     * Returns the hash of the quantized components of a vertex.
+     */
+    unsigned int hashVertex(const Vertex& vertex) const;
+
+    /**
+     * Returns true if two vertices are welded together.
+     */
+    bool equalVertices(const Vertex& v1, const Vertex& v2) const;
+
+    /**
+     * Returns the slot of the lookup table that has the given vertex, or the empty slot
+     * where it would be added.
+     */
+    unsigned int findSlot(const Vertex& vertex, unsigned int hash) const;
+
+    /**
+     * Adds the index of a vertex to the lookup table, growing the table if needed.
+     */
+    void insertVertexIndex(unsigned int index, unsigned int hash);
+
+    /**
+     * Writes a vertex with the quantized types of the vertex format.
+     */
+    void writeQuantizedVertex(const Vertex& vertex, FILE* file);
+
     std::vector<VertexElement> _vertexFormat;
+    float _weldEpsilon;
+    std::vector<unsigned int> _vertexLookupTable;
+    std::vector<unsigned int> _vertexHashes;
+    unsigned int _vertexLookupCount;
+    unsigned int _weldedVertexCount;
+    bool _quantized;
+    Vector3 _positionDecodeScale;
+    Vector3 _positionDecodeOffset;
 
 };
 
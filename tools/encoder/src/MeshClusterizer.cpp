@@ -0,0 +1,154 @@
+#include "Base.h"
+#include "MeshClusterizer.h"
+
+// The largest number of vertices and triangles in a cluster
+#define CLUSTER_MAX_VERTICES 64
+#define CLUSTER_MAX_TRIANGLES 124
+
+namespace gameplay
+{
+
+void MeshClusterizer::build(Mesh* mesh)
+{
+    assert(mesh);
+
+    std::vector<MeshPart*> parts(mesh->parts);
+    for (size_t i = 0; i < mesh->lodParts.size(); ++i)
+    {
+        parts.insert(parts.end(), mesh->lodParts[i].begin(), mesh->lodParts[i].end());
+    }
+
+    for (size_t i = 0; i < parts.size(); ++i)
+    {
+        build(parts[i], mesh->vertices);
+    }
+}
+
+void MeshClusterizer::build(MeshPart* part, const std::vector<Vertex>& vertices)
+{
+    assert(part);
+
+    const unsigned int indexCount = part->getIndicesCount();
+    if (part->getPrimitiveType() != MeshPart::TRIANGLES || indexCount < 3)
+        return;
+    for (unsigned int i = 0; i < indexCount; ++i)
+    {
+        if (part->getIndex(i) >= vertices.size())
+        {
+            LOG(1, "WARNING: Mesh part has an index out of range; it is not clustered.\n");
+            return;
+        }
+    }
+
+    // The vertices of the current cluster are marked with the number of the cluster, so that
+    // the marks don't need to be cleared between clusters.
+    std::vector<unsigned int> marks(vertices.size(), 0);
+    std::vector<MeshPart::Cluster> clusters;
+    MeshPart::Cluster cluster;
+    cluster.indexStart = 0;
+    cluster.indexCount = 0;
+    unsigned int clusterVertices = 0;
+    for (unsigned int i = 0; i + 2 < indexCount; i += 3)
+    {
+        unsigned int mark = clusters.size() + 1;
+        unsigned int newVertices = 0;
+        for (unsigned int j = 0; j < 3; ++j)
+        {
+            unsigned int index = part->getIndex(i + j);
+            if (marks[index] != mark && (j < 1 || index != part->getIndex(i)) && (j < 2 || index != part->getIndex(i + 1)))
+                ++newVertices;
+        }
+        if (cluster.indexCount > 0 &&
+            (clusterVertices + newVertices > CLUSTER_MAX_VERTICES || cluster.indexCount / 3 >= CLUSTER_MAX_TRIANGLES))
+        {
+            computeBounds(cluster, part, vertices);
+            clusters.push_back(cluster);
+            cluster.indexStart = i;
+            cluster.indexCount = 0;
+            clusterVertices = 0;
+            mark = clusters.size() + 1;
+            newVertices = 0;
+            for (unsigned int j = 0; j < 3; ++j)
+            {
+                unsigned int index = part->getIndex(i + j);
+                if ((j < 1 || index != part->getIndex(i)) && (j < 2 || index != part->getIndex(i + 1)))
+                    ++newVertices;
+            }
+        }
+        for (unsigned int j = 0; j < 3; ++j)
+        {
+            marks[part->getIndex(i + j)] = mark;
+        }
+        clusterVertices += newVertices;
+        cluster.indexCount += 3;
+    }
+    if (cluster.indexCount > 0)
+    {
+        computeBounds(cluster, part, vertices);
+        clusters.push_back(cluster);
+    }
+
+    part->setClusters(clusters);
+}
+
+void MeshClusterizer::computeBounds(MeshPart::Cluster& cluster, const MeshPart* part, const std::vector<Vertex>& vertices)
+{
+    const unsigned int start = cluster.indexStart;
+    const unsigned int end = cluster.indexStart + cluster.indexCount;
+
+    // The sphere is centered on the box around the vertices.
+    Vector3 min = vertices[part->getIndex(start)].position;
+    Vector3 max = min;
+    for (unsigned int i = start; i < end; ++i)
+    {
+        const Vector3& p = vertices[part->getIndex(i)].position;
+        min.set(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+        max.set(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+    }
+    cluster.center.set((min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f);
+    float radiusSquared = 0.0f;
+    for (unsigned int i = start; i < end; ++i)
+    {
+        radiusSquared = std::max(radiusSquared, cluster.center.distanceSquared(vertices[part->getIndex(i)].position));
+    }
+    cluster.radius = sqrt(radiusSquared);
+
+    // The axis of the cone is the average of the normals of the triangles, weighted by their
+    // areas, and the cone reaches the normal that is the farthest from the axis.
+    std::vector<Vector3> normals;
+    Vector3 axis;
+    for (unsigned int i = start; i + 2 < end; i += 3)
+    {
+        Vector3 p0 = vertices[part->getIndex(i)].position;
+        Vector3 p1 = vertices[part->getIndex(i + 1)].position;
+        Vector3 p2 = vertices[part->getIndex(i + 2)].position;
+        Vector3 normal;
+        Vector3::cross(p1 - p0, p2 - p0, &normal);
+        axis += normal;
+        float length = normal.length();
+        if (length > 0.0f)
+            normals.push_back(normal * (1.0f / length));
+    }
+
+    // A cone with a cutoff of one never culls the cluster.
+    cluster.coneAxis.set(0.0f, 0.0f, 0.0f);
+    cluster.coneCutoff = 1.0f;
+    float axisLength = axis.length();
+    if (axisLength <= 0.0f || normals.empty())
+        return;
+    axis *= 1.0f / axisLength;
+    float minDot = 1.0f;
+    for (size_t i = 0; i < normals.size(); ++i)
+    {
+        minDot = std::min(minDot, Vector3::dot(axis, normals[i]));
+    }
+    if (minDot <= 0.0f)
+        return;
+
+    // The cluster is back-facing where the direction to the viewer is more than 90 degrees
+    // from all of the normals, which is the sine of the angle of the cone to the axis.
+    cluster.coneAxis = axis;
+    cluster.coneCutoff = sqrt(1.0f - minDot * minDot);
+}
+
+}
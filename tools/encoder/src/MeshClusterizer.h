@@ -0,0 +1,50 @@
+#ifndef MESHCLUSTERIZER_H_
+#define MESHCLUSTERIZER_H_
+
+#include "Mesh.h"
+
+namespace gameplay
+{
+
+/**
+ * Splits the triangles of meshes into clusters that the runtime can cull on their own.
+ *
+ * The triangles of each part are split in the order that they are drawn, so that a cluster is
+ * a range of the indices of the part and the order set for the vertex cache is kept. A cluster
+ * ends when the next triangle would take it beyond 64 vertices or 124 triangles, which keeps
+ * clusters small enough to cull well and to fit in the on-chip memory of meshlet pipelines.
+ *
+ * Each cluster has a bounding sphere and a cone around the normals of its triangles. A cluster
+ * is back-facing, and can be skipped, if the viewer is outside of the cone. Clusters whose
+ * triangles face too many directions get a cone that never culls them.
+ *
+ * Only parts that are lists of triangles are clustered, including the parts of the levels of
+ * detail of the mesh.
+ */
+class MeshClusterizer
+{
+public:
+
+    /**
+     * Builds the clusters of the parts of a mesh.
+     *
+     * @param mesh The mesh to build the clusters of.
+     */
+    static void build(Mesh* mesh);
+
+private:
+
+    /**
+     * Builds the clusters of a part.
+     */
+    static void build(MeshPart* part, const std::vector<Vertex>& vertices);
+
+    /**
+     * Computes the bounding sphere and normal cone of the triangles of a cluster.
+     */
+    static void computeBounds(MeshPart::Cluster& cluster, const MeshPart* part, const std::vector<Vertex>& vertices);
+};
+
+}
+
+#endif
@@ -0,0 +1,428 @@
+#include "Base.h"
+#include "MeshOptimizer.h"
+
+// The size of the cache that triangles are scored with, and the weights of the scores
+#define FORSYTH_CACHE_SIZE 32
+#define FORSYTH_CACHE_DECAY_POWER 1.5f
+#define FORSYTH_LAST_TRIANGLE_SCORE 0.75f
+#define FORSYTH_VALENCE_BOOST_SCALE 2.0f
+#define FORSYTH_VALENCE_BOOST_POWER 0.5f
+
+// The size of the FIFO cache that the cache miss ratio is measured with, which is close to the
+// post-transform cache of most GPUs
+#define ACMR_CACHE_SIZE 16
+
+// How much worse the cache miss ratio may get for the triangles to be reordered for overdraw
+#define OVERDRAW_ACMR_THRESHOLD 1.05f
+
+#define NONE 0xFFFFFFFF
+
+namespace gameplay
+{
+
+/**
+ * A run of triangles that is drawn before or after the others to reduce overdraw.
+ */
+struct OverdrawCluster
+{
+    unsigned int start;
+    unsigned int count;
+    float sortKey;
+
+    bool operator<(const OverdrawCluster& c) const
+    {
+        return sortKey > c.sortKey;
+    }
+};
+
+/**
+ * Returns the score of a vertex, from its position in the cache and the number of triangles
+ * that still use it.
+ */
+static float getVertexScore(int cachePosition, unsigned int remainingTriangles)
+{
+    if (remainingTriangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+        {
+            // The vertices of the last triangle get a fixed score, so that the next triangle
+            // doesn't simply reuse the same edge.
+            score = FORSYTH_LAST_TRIANGLE_SCORE;
+        }
+        else
+        {
+            float scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = powf(1.0f - (cachePosition - 3) * scale, FORSYTH_CACHE_DECAY_POWER);
+        }
+    }
+
+    // Boost the vertices that few triangles still use, so that they are finished first.
+    score += FORSYTH_VALENCE_BOOST_SCALE * powf((float)remainingTriangles, -FORSYTH_VALENCE_BOOST_POWER);
+    return score;
+}
+
+void MeshOptimizer::optimize(Mesh* mesh)
+{
+    assert(mesh);
+
+    // The parts of the levels of detail are optimized with the parts of the mesh, since they
+    // share its vertices. The cache miss ratio is reported for the parts of the mesh.
+    std::vector<MeshPart*> parts(mesh->parts);
+    for (size_t i = 0; i < mesh->lodParts.size(); ++i)
+    {
+        parts.insert(parts.end(), mesh->lodParts[i].begin(), mesh->lodParts[i].end());
+    }
+
+    const unsigned int vertexCount = mesh->getVertexCount();
+    std::vector<std::vector<unsigned int> > indices(parts.size());
+    float missesBefore = 0.0f;
+    float missesAfter = 0.0f;
+    unsigned int triangleCount = 0;
+    for (size_t i = 0; i < parts.size(); ++i)
+    {
+        MeshPart* part = parts[i];
+        for (unsigned int j = 0, count = part->getIndicesCount(); j < count; ++j)
+        {
+            indices[i].push_back(part->getIndex(j));
+        }
+        if (part->getPrimitiveType() != MeshPart::TRIANGLES || indices[i].size() < 3)
+            continue;
+
+        std::vector<unsigned int>& partIndices = indices[i];
+        if (*std::max_element(partIndices.begin(), partIndices.end()) >= vertexCount)
+        {
+            LOG(1, "WARNING: Mesh part has an index out of range; it is not optimized: %s\n", mesh->getId().c_str());
+            continue;
+        }
+        unsigned int partTriangles = i < mesh->parts.size() ? partIndices.size() / 3 : 0;
+        triangleCount += partTriangles;
+        missesBefore += computeACMR(partIndices, vertexCount, ACMR_CACHE_SIZE) * partTriangles;
+
+        optimizeVertexCache(partIndices, vertexCount);
+
+        // Only keep the order for overdraw if it costs little in the vertex cache.
+        float acmr = computeACMR(partIndices, vertexCount, ACMR_CACHE_SIZE);
+        std::vector<unsigned int> overdrawIndices(partIndices);
+        optimizeOverdraw(overdrawIndices, mesh->vertices);
+        float overdrawACMR = computeACMR(overdrawIndices, vertexCount, ACMR_CACHE_SIZE);
+        if (overdrawACMR <= acmr * OVERDRAW_ACMR_THRESHOLD)
+        {
+            partIndices.swap(overdrawIndices);
+            acmr = overdrawACMR;
+        }
+        missesAfter += acmr * partTriangles;
+    }
+
+    optimizeVertexFetch(mesh, indices);
+    for (size_t i = 0; i < parts.size(); ++i)
+    {
+        parts[i]->setIndices(indices[i]);
+    }
+
+    if (triangleCount > 0)
+    {
+        LOG(1, "Optimized mesh '%s': ACMR %.3f before, %.3f after.\n", mesh->getId().c_str(),
+            missesBefore / triangleCount, missesAfter / triangleCount);
+    }
+}
+
+float MeshOptimizer::computeACMR(const std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize)
+{
+    const unsigned int triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || cacheSize == 0)
+        return 0.0f;
+
+    // The cache is a ring of the last vertices that missed, and each vertex keeps the time at
+    // which it entered the cache, so that a vertex is in the cache if it entered it less than
+    // cacheSize misses ago.
+    std::vector<unsigned int> entered(vertexCount, NONE);
+    unsigned int misses = 0;
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+    {
+        unsigned int index = indices[i];
+        if (index >= vertexCount)
+            continue;
+        if (entered[index] == NONE || misses - entered[index] >= cacheSize)
+        {
+            entered[index] = misses;
+            ++misses;
+        }
+    }
+    return (float)misses / triangleCount;
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<unsigned int>& indices, unsigned int vertexCount)
+{
+    const unsigned int triangleCount = indices.size() / 3;
+
+    // Find the triangles that use each vertex.
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+    {
+        ++remaining[indices[i]];
+    }
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (unsigned int v = 0; v < vertexCount; ++v)
+    {
+        offsets[v + 1] = offsets[v] + remaining[v];
+    }
+    std::vector<unsigned int> vertexTriangles(triangleCount * 3);
+    std::vector<unsigned int> filled(vertexCount, 0);
+    for (unsigned int t = 0; t < triangleCount; ++t)
+    {
+        for (unsigned int k = 0; k < 3; ++k)
+        {
+            unsigned int v = indices[t * 3 + k];
+            vertexTriangles[offsets[v] + filled[v]++] = t;
+        }
+    }
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (unsigned int v = 0; v < vertexCount; ++v)
+    {
+        vertexScores[v] = getVertexScore(-1, remaining[v]);
+    }
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    unsigned int best = 0;
+    for (unsigned int t = 0; t < triangleCount; ++t)
+    {
+        const unsigned int* tri = &indices[t * 3];
+        triangleScores[t] = vertexScores[tri[0]] + vertexScores[tri[1]] + vertexScores[tri[2]];
+        if (triangleScores[t] > triangleScores[best])
+            best = t;
+    }
+
+    std::vector<unsigned int> output;
+    output.reserve(triangleCount * 3);
+    unsigned int cache[FORSYTH_CACHE_SIZE + 3];
+    unsigned int cacheCount = 0;
+    unsigned int cursor = 0;
+    while (best != NONE)
+    {
+        // Emit the best triangle, and remove it from the triangles of its vertices.
+        emitted[best] = true;
+        const unsigned int tri[3] = { indices[best * 3], indices[best * 3 + 1], indices[best * 3 + 2] };
+        for (unsigned int k = 0; k < 3; ++k)
+        {
+            unsigned int v = tri[k];
+            output.push_back(v);
+            unsigned int* triangles = &vertexTriangles[offsets[v]];
+            for (unsigned int j = 0; j < remaining[v]; ++j)
+            {
+                if (triangles[j] == best)
+                {
+                    triangles[j] = triangles[remaining[v] - 1];
+                    --remaining[v];
+                    break;
+                }
+            }
+        }
+
+        // Move the vertices of the triangle to the front of the cache.
+        unsigned int newCache[FORSYTH_CACHE_SIZE + 3];
+        unsigned int newCount = 0;
+        for (unsigned int k = 0; k < 3; ++k)
+        {
+            if (std::find(newCache, newCache + newCount, tri[k]) == newCache + newCount)
+                newCache[newCount++] = tri[k];
+        }
+        for (unsigned int j = 0; j < cacheCount; ++j)
+        {
+            unsigned int v = cache[j];
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                newCache[newCount++] = v;
+        }
+
+        // Update the scores of the vertices in the cache, and of the vertices that fell out of it.
+        for (unsigned int j = 0; j < newCount; ++j)
+        {
+            unsigned int v = newCache[j];
+            cachePositions[v] = j < FORSYTH_CACHE_SIZE ? (int)j : -1;
+            vertexScores[v] = getVertexScore(cachePositions[v], remaining[v]);
+        }
+
+        // Update the scores of the triangles that use those vertices, and pick the best of them.
+        best = NONE;
+        float bestScore = -1.0f;
+        for (unsigned int j = 0; j < newCount; ++j)
+        {
+            unsigned int v = newCache[j];
+            const unsigned int* triangles = &vertexTriangles[offsets[v]];
+            for (unsigned int n = 0; n < remaining[v]; ++n)
+            {
+                unsigned int t = triangles[n];
+                const unsigned int* other = &indices[t * 3];
+                triangleScores[t] = vertexScores[other[0]] + vertexScores[other[1]] + vertexScores[other[2]];
+                if (triangleScores[t] > bestScore)
+                {
+                    bestScore = triangleScores[t];
+                    best = t;
+                }
+            }
+        }
+
+        cacheCount = std::min(newCount, (unsigned int)FORSYTH_CACHE_SIZE);
+        memcpy(cache, newCache, cacheCount * sizeof(unsigned int));
+
+        // When no triangle uses the cache, continue with the next triangle that isn't emitted.
+        if (best == NONE)
+        {
+            while (cursor < triangleCount && emitted[cursor])
+                ++cursor;
+            if (cursor < triangleCount)
+                best = cursor;
+        }
+    }
+
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices)
+{
+    const unsigned int triangleCount = indices.size() / 3;
+    const unsigned int vertexCount = vertices.size();
+
+    // Split the triangles into clusters where all of the vertices of a triangle miss the cache,
+    // since the cache starts over there, and the clusters can be reordered at little cost.
+    std::vector<OverdrawCluster> clusters;
+    std::vector<unsigned int> entered(vertexCount, NONE);
+    unsigned int misses = 0;
+    for (unsigned int t = 0; t < triangleCount; ++t)
+    {
+        unsigned int triangleMisses = 0;
+        for (unsigned int k = 0; k < 3; ++k)
+        {
+            unsigned int v = indices[t * 3 + k];
+            if (entered[v] == NONE || misses - entered[v] >= ACMR_CACHE_SIZE)
+            {
+                entered[v] = misses;
+                ++misses;
+                ++triangleMisses;
+            }
+        }
+        if (t == 0 || triangleMisses == 3)
+        {
+            OverdrawCluster cluster;
+            cluster.start = t;
+            cluster.count = 0;
+            cluster.sortKey = 0.0f;
+            clusters.push_back(cluster);
+        }
+        ++clusters.back().count;
+    }
+    if (clusters.size() < 2)
+        return;
+
+    // Find the area weighted center and normal of each cluster, and the center of the mesh.
+    std::vector<Vector3> centers(clusters.size());
+    std::vector<Vector3> normals(clusters.size());
+    std::vector<float> areas(clusters.size(), 0.0f);
+    Vector3 meshCenter;
+    float meshArea = 0.0f;
+    for (size_t i = 0; i < clusters.size(); ++i)
+    {
+        for (unsigned int t = clusters[i].start; t < clusters[i].start + clusters[i].count; ++t)
+        {
+            const Vector3& p0 = vertices[indices[t * 3]].position;
+            const Vector3& p1 = vertices[indices[t * 3 + 1]].position;
+            const Vector3& p2 = vertices[indices[t * 3 + 2]].position;
+            Vector3 e1(p1.x - p0.x, p1.y - p0.y, p1.z - p0.z);
+            Vector3 e2(p2.x - p0.x, p2.y - p0.y, p2.z - p0.z);
+            Vector3 n(e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x);
+            float area = sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+            Vector3 center((p0.x + p1.x + p2.x) / 3.0f, (p0.y + p1.y + p2.y) / 3.0f, (p0.z + p1.z + p2.z) / 3.0f);
+
+            normals[i].x += n.x;
+            normals[i].y += n.y;
+            normals[i].z += n.z;
+            centers[i].x += center.x * area;
+            centers[i].y += center.y * area;
+            centers[i].z += center.z * area;
+            areas[i] += area;
+        }
+        meshCenter.x += centers[i].x;
+        meshCenter.y += centers[i].y;
+        meshCenter.z += centers[i].z;
+        meshArea += areas[i];
+    }
+    if (meshArea > 0.0f)
+    {
+        meshCenter.x /= meshArea;
+        meshCenter.y /= meshArea;
+        meshCenter.z /= meshArea;
+    }
+
+    // Draw the clusters that face away from the center of the mesh first, since they are the
+    // most likely to occlude the other clusters.
+    for (size_t i = 0; i < clusters.size(); ++i)
+    {
+        if (areas[i] <= 0.0f)
+            continue;
+        float length = sqrt(normals[i].x * normals[i].x + normals[i].y * normals[i].y + normals[i].z * normals[i].z);
+        if (length <= 0.0f)
+            continue;
+        float dx = centers[i].x / areas[i] - meshCenter.x;
+        float dy = centers[i].y / areas[i] - meshCenter.y;
+        float dz = centers[i].z / areas[i] - meshCenter.z;
+        clusters[i].sortKey = (dx * normals[i].x + dy * normals[i].y + dz * normals[i].z) / length;
+    }
+    std::stable_sort(clusters.begin(), clusters.end());
+
+    std::vector<unsigned int> output;
+    output.reserve(triangleCount * 3);
+    for (size_t i = 0; i < clusters.size(); ++i)
+    {
+        output.insert(output.end(), indices.begin() + clusters[i].start * 3, indices.begin() + (clusters[i].start + clusters[i].count) * 3);
+    }
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void MeshOptimizer::optimizeVertexFetch(Mesh* mesh, std::vector<std::vector<unsigned int> >& indices)
+{
+    const unsigned int vertexCount = mesh->getVertexCount();
+
+    // Number the vertices in the order that the parts use them. Vertices that no part uses are
+    // kept at the end.
+    std::vector<unsigned int> remap(vertexCount, NONE);
+    unsigned int next = 0;
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        for (size_t j = 0; j < indices[i].size(); ++j)
+        {
+            unsigned int index = indices[i][j];
+            if (index < vertexCount && remap[index] == NONE)
+                remap[index] = next++;
+        }
+    }
+    for (unsigned int v = 0; v < vertexCount; ++v)
+    {
+        if (remap[v] == NONE)
+            remap[v] = next++;
+    }
+
+    std::vector<Vertex> vertices(vertexCount);
+    for (unsigned int v = 0; v < vertexCount; ++v)
+    {
+        vertices[remap[v]] = mesh->vertices[v];
+    }
+    mesh->vertices.swap(vertices);
+
+    mesh->updateVertexLookupTable();
+
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        for (size_t j = 0; j < indices[i].size(); ++j)
+        {
+            if (indices[i][j] < vertexCount)
+                indices[i][j] = remap[indices[i][j]];
+        }
+    }
+}
+
+}
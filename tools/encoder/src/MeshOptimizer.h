@@ -0,0 +1,63 @@
+#ifndef MESHOPTIMIZER_H_
+#define MESHOPTIMIZER_H_
+
+#include "Mesh.h"
+
+namespace gameplay
+{
+
+/**
+ * Reorders the triangles and vertices of meshes so that they render faster.
+ *
+ * The triangles of each part are first reordered for the post-transform vertex cache, using
+ * Tom Forsyth's linear-speed vertex cache optimization. The reordered triangles are then split
+ * into clusters where the cache restarts, and the clusters are sorted so that the ones that face
+ * outwards are drawn first, which reduces overdraw. The cluster order is only kept if it does not
+ * make the cache noticeably worse. Finally, the vertices of the mesh are reordered in the order
+ * that the triangles first use them, which improves the locality of vertex fetches.
+ *
+ * Only parts that are lists of triangles are reordered, including the parts of the levels of
+ * detail of the mesh.
+ */
+class MeshOptimizer
+{
+public:
+
+    /**
+     * Optimizes a mesh, and logs the average cache miss ratio (ACMR) of its triangles before
+     * and after it is optimized.
+     *
+     * @param mesh The mesh to optimize.
+     */
+    static void optimize(Mesh* mesh);
+
+    /**
+     * Returns the average number of vertices that miss a FIFO vertex cache for each triangle.
+     *
+     * @param indices The indices of a list of triangles.
+     * @param vertexCount The number of vertices that the indices refer to.
+     * @param cacheSize The number of vertices that fit in the cache.
+     */
+    static float computeACMR(const std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize);
+
+private:
+
+    /**
+     * Reorders triangles for the vertex cache.
+     */
+    static void optimizeVertexCache(std::vector<unsigned int>& indices, unsigned int vertexCount);
+
+    /**
+     * Reorders clusters of triangles to reduce overdraw.
+     */
+    static void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices);
+
+    /**
+     * Reorders the vertices of a mesh in the order that its parts first use them.
+     */
+    static void optimizeVertexFetch(Mesh* mesh, std::vector<std::vector<unsigned int> >& indices);
+};
+
+}
+
+#endif
@@ -38,6 +38,18 @@ void MeshPart::writeBinary(FILE* file)
     {
         writeBinaryIndex(*i, file);
     }
+
+    // write the clusters
+    write((unsigned int)_clusters.size(), file);
+    for (std::vector<Cluster>::const_iterator i = _clusters.begin(); i != _clusters.end(); ++i)
+    {
+        write(i->indexStart, file);
+        write(i->indexCount, file);
+        write(&i->center.x, 3, file);
+        write(i->radius, file);
+        write(&i->coneAxis.x, 3, file);
+        write(i->coneCutoff, file);
+    }
 }
 
 void MeshPart::writeText(FILE* file)
@@ -46,6 +58,17 @@ void MeshPart::writeText(FILE* file)
     fprintfElement(file, "primitiveType", _primitiveType);
     fprintfElement(file, "indexFormat", (unsigned int)_indexFormat);
     fprintfElement(file, "%d ", "indices", _indices);
+    for (std::vector<Cluster>::const_iterator i = _clusters.begin(); i != _clusters.end(); ++i)
+    {
+        fprintf(file, "<cluster>\n");
+        fprintfElement(file, "indexStart", i->indexStart);
+        fprintfElement(file, "indexCount", i->indexCount);
+        fprintfElement(file, "center", &i->center.x, 3);
+        fprintfElement(file, "radius", i->radius);
+        fprintfElement(file, "coneAxis", &i->coneAxis.x, 3);
+        fprintfElement(file, "coneCutoff", i->coneCutoff);
+        fprintf(file, "</cluster>\n");
+    }
     fprintElementEnd(file);
 }
 
@@ -86,6 +109,32 @@ unsigned int MeshPart::getIndex(unsigned int i) const
     return _indices[i];
 }
 
+unsigned int MeshPart::getPrimitiveType() const
+{
+    return _primitiveType;
+}
+
+void MeshPart::setIndices(const std::vector<unsigned int>& indices)
+{
+    _indexFormat = INDEX16;
+    for (std::vector<unsigned int>::const_iterator i = indices.begin(); i != indices.end(); ++i)
+    {
+        updateIndexFormat(*i);
+    }
+    _indices = indices;
+    _clusters.clear();
+}
+
+void MeshPart::setClusters(const std::vector<Cluster>& clusters)
+{
+    _clusters = clusters;
+}
+
+size_t MeshPart::getClusterCount() const
+{
+    return _clusters.size();
+}
+
 void MeshPart::writeBinaryIndex(unsigned int index, FILE* file)
 {
     switch (_indexFormat)
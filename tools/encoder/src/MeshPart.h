@@ -27,6 +27,19 @@ public:
         INDEX32 = 0x1405  // GL_UNSIGNED_INT
     };
 
+    /**
+     * A range of the triangles of a part, with the bounds that it is culled with.
+     */
+    struct Cluster
+    {
+        unsigned int indexStart;
+        unsigned int indexCount;
+        Vector3 center;
+        float radius;
+        Vector3 coneAxis;
+        float coneCutoff;
+    };
+
     /**
      * Constructor.
      */
@@ -62,6 +75,26 @@ public:
      */
     unsigned int getIndex(unsigned int i) const;
 
+    /**
+     * Returns the primitive type.
+     */
+    unsigned int getPrimitiveType() const;
+
+    /**
+     * Replaces the indices of this part.
+     */
+    void setIndices(const std::vector<unsigned int>& indices);
+
+    /**
+     * Replaces the clusters of this part.
+     */
+    void setClusters(const std::vector<Cluster>& clusters);
+
+    /**
+     * Returns the number of clusters.
+     */
+    size_t getClusterCount() const;
+
 private:
 
     /**
@@ -90,6 +123,7 @@ private:
     unsigned int _primitiveType;
     IndexFormat _indexFormat;
     std::vector<unsigned int> _indices;
+    std::vector<Cluster> _clusters;
 };
 
 }
@@ -0,0 +1,378 @@
+#include "Base.h"
+#include "MeshSimplifier.h"
+
+// How much more the planes along the open borders of a mesh weigh than the planes of its triangles
+#define BORDER_WEIGHT 10.0
+
+// The cosine of the largest angle that collapses may turn the normal of a triangle by, from the
+// normal that it had in the mesh
+#define FLIP_THRESHOLD 0.25
+
+#define NONE 0xFFFFFFFF
+
+namespace gameplay
+{
+
+/**
+ * The quadric of a set of planes, whose value at a point is the sum of the squared distances
+ * of the point to the planes.
+ */
+struct Quadric
+{
+    double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+    Quadric() : a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0)
+    {
+    }
+
+    void addPlane(double a, double b, double c, double d, double weight)
+    {
+        a2 += a * a * weight; ab += a * b * weight; ac += a * c * weight; ad += a * d * weight;
+        b2 += b * b * weight; bc += b * c * weight; bd += b * d * weight;
+        c2 += c * c * weight; cd += c * d * weight;
+        d2 += d * d * weight;
+    }
+
+    void add(const Quadric& q)
+    {
+        a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+        b2 += q.b2; bc += q.bc; bd += q.bd;
+        c2 += q.c2; cd += q.cd;
+        d2 += q.d2;
+    }
+
+    double evaluate(const Vector3& p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double value = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                     + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                     + c2 * z * z + 2 * cd * z
+                     + d2;
+        return value > 0.0 ? value : 0.0;
+    }
+};
+
+/**
+ * A triangle that is being simplified.
+ */
+struct SimplifierTriangle
+{
+    unsigned int vertices[3];
+    unsigned int part;
+    double normal[3];
+    bool alive;
+};
+
+/**
+ * An edge collapse that moves one vertex onto another.
+ */
+struct SimplifierCollapse
+{
+    unsigned int from;
+    unsigned int to;
+    double cost;
+
+    bool operator<(const SimplifierCollapse& c) const
+    {
+        return cost < c.cost;
+    }
+};
+
+static void computeNormal(const Vector3& p0, const Vector3& p1, const Vector3& p2, double* normal)
+{
+    double e1[3] = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+    double e2[3] = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+    normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+static unsigned long long getEdgeKey(unsigned int v1, unsigned int v2)
+{
+    if (v1 > v2)
+        std::swap(v1, v2);
+    return ((unsigned long long)v1 << 32) | v2;
+}
+
+void MeshSimplifier::generateLods(Mesh* mesh, unsigned int levels, float ratio)
+{
+    assert(mesh);
+
+    const unsigned int vertexCount = mesh->getVertexCount();
+    if (vertexCount == 0 || levels == 0)
+        return;
+    const std::vector<Vertex>& vertices = mesh->vertices;
+
+    // Vertices at the same position are simplified as one vertex, which is the first of them.
+    std::vector<unsigned int> positions(vertexCount);
+    std::vector<unsigned int> wedgeCounts(vertexCount, 0);
+    std::map<Vector3, unsigned int> positionLookup;
+    for (unsigned int v = 0; v < vertexCount; ++v)
+    {
+        std::map<Vector3, unsigned int>::iterator it = positionLookup.find(vertices[v].position);
+        positions[v] = it != positionLookup.end() ? it->second : (positionLookup[vertices[v].position] = v);
+        ++wedgeCounts[positions[v]];
+    }
+
+    // Gather the triangles of the parts, and find the radius of the mesh.
+    std::vector<SimplifierTriangle> triangles;
+    for (size_t i = 0; i < mesh->parts.size(); ++i)
+    {
+        const MeshPart* part = mesh->parts[i];
+        for (unsigned int j = 0, count = part->getIndicesCount() / 3; j < count; ++j)
+        {
+            SimplifierTriangle triangle;
+            triangle.part = i;
+            triangle.alive = true;
+            for (unsigned int k = 0; k < 3; ++k)
+            {
+                triangle.vertices[k] = part->getIndex(j * 3 + k);
+                if (triangle.vertices[k] >= vertexCount)
+                {
+                    LOG(1, "WARNING: Mesh part has an index out of range; no levels of detail are generated: %s\n", mesh->getId().c_str());
+                    return;
+                }
+            }
+            unsigned int p0 = positions[triangle.vertices[0]], p1 = positions[triangle.vertices[1]], p2 = positions[triangle.vertices[2]];
+            triangle.alive = p0 != p1 && p1 != p2 && p0 != p2;
+            triangles.push_back(triangle);
+        }
+    }
+    Vector3 center;
+    for (unsigned int v = 0; v < vertexCount; ++v)
+    {
+        center.x += vertices[v].position.x / vertexCount;
+        center.y += vertices[v].position.y / vertexCount;
+        center.z += vertices[v].position.z / vertexCount;
+    }
+    float radius = 0.0f;
+    for (unsigned int v = 0; v < vertexCount; ++v)
+    {
+        radius = std::max(radius, center.distance(vertices[v].position));
+    }
+    if (radius <= 0.0f)
+        return;
+
+    // Find the edges that only one triangle uses, which are on the open borders of the mesh.
+    std::map<unsigned long long, unsigned int> edgeCounts;
+    for (size_t t = 0; t < triangles.size(); ++t)
+    {
+        if (!triangles[t].alive)
+            continue;
+        for (unsigned int k = 0; k < 3; ++k)
+        {
+            ++edgeCounts[getEdgeKey(positions[triangles[t].vertices[k]], positions[triangles[t].vertices[(k + 1) % 3]])];
+        }
+    }
+
+    // Build the quadric of each vertex from the planes of its triangles, weighted by their area,
+    // and from planes through the borders that are perpendicular to the triangles.
+    std::vector<Quadric> quadrics(vertexCount);
+    std::vector<double> weights(vertexCount, 0.0);
+    std::vector<bool> borders(vertexCount, false);
+    std::vector<std::vector<unsigned int> > vertexTriangles(vertexCount);
+    unsigned int liveCount = 0;
+    for (size_t t = 0; t < triangles.size(); ++t)
+    {
+        if (!triangles[t].alive)
+            continue;
+        ++liveCount;
+
+        unsigned int p[3] = { positions[triangles[t].vertices[0]], positions[triangles[t].vertices[1]], positions[triangles[t].vertices[2]] };
+        double normal[3];
+        computeNormal(vertices[p[0]].position, vertices[p[1]].position, vertices[p[2]].position, normal);
+        double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        double area = length * 0.5;
+        if (length > 0.0)
+        {
+            normal[0] /= length;
+            normal[1] /= length;
+            normal[2] /= length;
+        }
+        memcpy(triangles[t].normal, normal, sizeof(normal));
+        const Vector3& p0 = vertices[p[0]].position;
+        double d = -(normal[0] * p0.x + normal[1] * p0.y + normal[2] * p0.z);
+
+        for (unsigned int k = 0; k < 3; ++k)
+        {
+            quadrics[p[k]].addPlane(normal[0], normal[1], normal[2], d, area);
+            weights[p[k]] += area;
+            vertexTriangles[p[k]].push_back(t);
+
+            unsigned int a = p[k], b = p[(k + 1) % 3];
+            if (edgeCounts[getEdgeKey(a, b)] == 1)
+            {
+                borders[a] = borders[b] = true;
+                const Vector3& pa = vertices[a].position;
+                const Vector3& pb = vertices[b].position;
+                double edge[3] = { pb.x - pa.x, pb.y - pa.y, pb.z - pa.z };
+                double plane[3] = { edge[1] * normal[2] - edge[2] * normal[1], edge[2] * normal[0] - edge[0] * normal[2], edge[0] * normal[1] - edge[1] * normal[0] };
+                double planeLength = sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+                if (planeLength > 0.0)
+                {
+                    plane[0] /= planeLength;
+                    plane[1] /= planeLength;
+                    plane[2] /= planeLength;
+                    double planeD = -(plane[0] * pa.x + plane[1] * pa.y + plane[2] * pa.z);
+                    double edgeLengthSquared = edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2];
+                    quadrics[a].addPlane(plane[0], plane[1], plane[2], planeD, edgeLengthSquared * BORDER_WEIGHT);
+                    quadrics[b].addPlane(plane[0], plane[1], plane[2], planeD, edgeLengthSquared * BORDER_WEIGHT);
+                }
+            }
+        }
+    }
+
+    std::vector<bool> collapsed(vertexCount, false);
+    std::vector<bool> touched(vertexCount, false);
+    std::vector<SimplifierCollapse> collapses;
+    double maxCost = 0.0;
+    for (unsigned int level = 0; level < levels; ++level)
+    {
+        const unsigned int previousCount = liveCount;
+        const unsigned int targetCount = std::max(1u, (unsigned int)(liveCount * ratio));
+        while (liveCount > targetCount)
+        {
+            // Find the cost of each collapse along the edges of the triangles. Vertices where the
+            // attributes are split are never moved, and vertices on the borders only move along them.
+            collapses.clear();
+            for (size_t t = 0; t < triangles.size(); ++t)
+            {
+                if (!triangles[t].alive)
+                    continue;
+                for (unsigned int k = 0; k < 6; ++k)
+                {
+                    // Each edge is collapsed in both directions.
+                    unsigned int from = positions[triangles[t].vertices[k % 3]];
+                    unsigned int to = positions[triangles[t].vertices[(k + 1) % 3]];
+                    if (k >= 3)
+                        std::swap(from, to);
+                    if (wedgeCounts[from] != 1)
+                        continue;
+                    if (borders[from])
+                    {
+                        std::map<unsigned long long, unsigned int>::const_iterator edge = edgeCounts.find(getEdgeKey(from, to));
+                        if (!borders[to] || edge == edgeCounts.end() || edge->second != 1)
+                            continue;
+                    }
+                    Quadric quadric = quadrics[from];
+                    quadric.add(quadrics[to]);
+                    double weight = weights[from] + weights[to];
+
+                    SimplifierCollapse collapse;
+                    collapse.from = from;
+                    collapse.to = to;
+                    collapse.cost = weight > 0.0 ? quadric.evaluate(vertices[to].position) / weight : 0.0;
+                    collapses.push_back(collapse);
+                }
+            }
+            std::sort(collapses.begin(), collapses.end());
+
+            // Collapse the cheapest edges, with at most one collapse for each vertex in a pass.
+            std::fill(touched.begin(), touched.end(), false);
+            unsigned int collapseCount = 0;
+            for (size_t i = 0; i < collapses.size() && liveCount > targetCount; ++i)
+            {
+                const SimplifierCollapse& collapse = collapses[i];
+                unsigned int from = collapse.from;
+                unsigned int to = collapse.to;
+                if (collapsed[from] || collapsed[to] || touched[from] || touched[to])
+                    continue;
+
+                // Skip the collapse if it flips or folds a triangle that stays, compared to the
+                // triangle in the mesh so that successive collapses can't fold it either, and
+                // find the vertex that the triangles of the collapsed vertex use instead of it.
+                bool flips = false;
+                unsigned int toVertex = NONE;
+                const std::vector<unsigned int>& fromTriangles = vertexTriangles[from];
+                for (size_t j = 0; j < fromTriangles.size() && !flips; ++j)
+                {
+                    const SimplifierTriangle& triangle = triangles[fromTriangles[j]];
+                    if (!triangle.alive)
+                        continue;
+                    unsigned int p[3] = { positions[triangle.vertices[0]], positions[triangle.vertices[1]], positions[triangle.vertices[2]] };
+                    if (p[0] == to || p[1] == to || p[2] == to)
+                    {
+                        for (unsigned int k = 0; k < 3; ++k)
+                        {
+                            if (p[k] == to && toVertex == NONE)
+                                toVertex = triangle.vertices[k];
+                        }
+                        continue;
+                    }
+                    const double* before = triangle.normal;
+                    double after[3];
+                    computeNormal(vertices[p[0] == from ? to : p[0]].position, vertices[p[1] == from ? to : p[1]].position,
+                        vertices[p[2] == from ? to : p[2]].position, after);
+                    double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+                    double length = sqrt(after[0] * after[0] + after[1] * after[1] + after[2] * after[2]);
+                    if (dot <= FLIP_THRESHOLD * length)
+                        flips = true;
+                }
+                if (flips || toVertex == NONE)
+                    continue;
+
+                // Move the triangles of the collapsed vertex to the other vertex, removing the
+                // ones that had both vertices.
+                for (size_t j = 0; j < fromTriangles.size(); ++j)
+                {
+                    SimplifierTriangle& triangle = triangles[fromTriangles[j]];
+                    if (!triangle.alive)
+                        continue;
+                    bool degenerate = false;
+                    for (unsigned int k = 0; k < 3; ++k)
+                    {
+                        if (positions[triangle.vertices[k]] == to)
+                            degenerate = true;
+                    }
+                    if (degenerate)
+                    {
+                        triangle.alive = false;
+                        --liveCount;
+                        continue;
+                    }
+                    for (unsigned int k = 0; k < 3; ++k)
+                    {
+                        if (positions[triangle.vertices[k]] == from)
+                            triangle.vertices[k] = toVertex;
+                    }
+                    vertexTriangles[to].push_back(fromTriangles[j]);
+                }
+                vertexTriangles[from].clear();
+                quadrics[to].add(quadrics[from]);
+                weights[to] += weights[from];
+                collapsed[from] = true;
+                touched[from] = touched[to] = true;
+                maxCost = std::max(maxCost, collapse.cost);
+                ++collapseCount;
+            }
+            if (collapseCount == 0)
+                break;
+        }
+
+        if (liveCount >= previousCount)
+            break;
+
+        // Add the level, with the triangles that are left from the triangles of each part.
+        std::vector<std::vector<unsigned int> > indices(mesh->parts.size());
+        for (size_t t = 0; t < triangles.size(); ++t)
+        {
+            if (triangles[t].alive)
+                indices[triangles[t].part].insert(indices[triangles[t].part].end(), triangles[t].vertices, triangles[t].vertices + 3);
+        }
+        std::vector<MeshPart*> parts;
+        for (size_t i = 0; i < mesh->parts.size(); ++i)
+        {
+            MeshPart* part = new MeshPart();
+            part->setIndices(indices[i]);
+            parts.push_back(part);
+        }
+        float error = (float)sqrt(maxCost) / radius;
+        mesh->lodParts.push_back(parts);
+        mesh->lodErrors.push_back(error);
+
+        LOG(2, "Generated level of detail %u for mesh '%s': %u triangles, error %f.\n",
+            (unsigned int)mesh->lodParts.size(), mesh->getId().c_str(), liveCount, error);
+    }
+}
+
+}
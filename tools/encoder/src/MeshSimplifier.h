@@ -0,0 +1,40 @@
+#ifndef MESHSIMPLIFIER_H_
+#define MESHSIMPLIFIER_H_
+
+#include "Mesh.h"
+
+namespace gameplay
+{
+
+/**
+ * Generates levels of detail for meshes with quadric error metrics.
+ *
+ * The triangles of a mesh are simplified by collapsing edges, choosing each time the collapse
+ * that moves the surface the least, as measured by the quadric of the planes of the triangles
+ * around each vertex. A vertex is always collapsed onto another vertex of the mesh, so that the
+ * levels of detail share the vertices of the mesh and only have their own indices.
+ *
+ * Vertices on the open borders of the mesh only collapse along the borders, and vertices where
+ * the attributes of the mesh are split (such as texture seams) are kept, so that the outline
+ * and the seams of the mesh are preserved.
+ */
+class MeshSimplifier
+{
+public:
+
+    /**
+     * Generates levels of detail for a mesh, and adds them to the mesh.
+     *
+     * Each level is simplified from the previous one. Fewer levels are generated if a level
+     * can't be simplified any further.
+     *
+     * @param mesh The mesh to generate the levels of detail of.
+     * @param levels The number of levels to generate, beyond the mesh itself.
+     * @param ratio The number of triangles of each level, relative to the previous level.
+     */
+    static void generateLods(Mesh* mesh, unsigned int levels, float ratio);
+};
+
+}
+
+#endif
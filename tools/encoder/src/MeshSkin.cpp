@@ -47,8 +47,7 @@ void MeshSkin::writeBinary(FILE* file)
         write(i->m, 16, file);
     }
 
-    /*
-    // Write joint bounding spheres
+    // Write joint bounding spheres, in the space of the mesh, so that the runtime can pose them.
     write((unsigned int)_jointBounds.size(), file);
     for (unsigned int i = 0; i < _jointBounds.size(); ++i)
     {
@@ -58,7 +57,6 @@ void MeshSkin::writeBinary(FILE* file)
         write(v.center.z, file);
         write(v.radius, file);
     }
-    */
 }
 
 void MeshSkin::writeText(FILE* file)
@@ -82,6 +80,12 @@ void MeshSkin::writeText(FILE* file)
         }
     }
     fprintf(file, "</bindPoses>\n");
+    fprintf(file, "<jointBounds count=\"%lu\">", _jointBounds.size());
+    for (std::vector<BoundingVolume>::const_iterator i = _jointBounds.begin(); i != _jointBounds.end(); ++i)
+    {
+        fprintf(file, "%f %f %f %f ", i->center.x, i->center.y, i->center.z, i->radius);
+    }
+    fprintf(file, "</jointBounds>\n");
 
     fprintElementEnd(file);
 }
@@ -152,4 +152,13 @@ void Model::setMaterial(Material* material, int partIndex)
     }
 }
 
+Material* Model::getMaterial(int partIndex) const
+{
+    if (partIndex >= 0 && partIndex < (int)_materials.size() && _materials[partIndex])
+    {
+        return _materials[partIndex];
+    }
+    return _material;
+}
+
 }
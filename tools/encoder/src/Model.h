@@ -34,6 +34,12 @@ public:
     void setSkin(MeshSkin* skin);
     void setMaterial(Material* material, int partIndex = -1);
 
+    /**
+     * Returns the material of a mesh part, which is the material of the whole model when the
+     * part has none of its own, or the material of the whole model if the part index is -1.
+     */
+    Material* getMaterial(int partIndex = -1) const;
+
 private:
 
     Mesh* _mesh;
@@ -1,6 +1,7 @@
 #include "NormalMapGenerator.h"
 #include "Image.h"
 #include "Base.h"
+#include "Thread.h"
 
 namespace gameplay
 {
@@ -70,6 +71,136 @@ float normalizedHeightPacked(float r, float g, float b)
     return (256.0f*r + g + 0.00390625f*b) / 65536.0f;
 }
 
+// Number of rows of the normal map that a thread calculates at a time
+#define NORMALMAP_GRAIN_SIZE 16
+
+struct NormalPixel
+{
+    unsigned char r, g, b;
+};
+
+struct NormalMapFace
+{
+    Vector3 normal1;
+    Vector3 normal2;
+};
+
+// Data shared by the threads that generate a normal map
+struct NormalMapThreadData
+{
+    float* heights;
+    NormalMapFace* faceNormals;
+    NormalPixel* normalPixels;
+    int resolutionX;
+    int resolutionY;
+    Vector2 scale;
+    // The progress is only displayed, so it doesn't need to be exact.
+    int processedRows;
+    int totalRows;
+};
+
+static void calculateFaceNormals(unsigned int begin, unsigned int end, unsigned int thread, void* threadData)
+{
+    NormalMapThreadData* data = (NormalMapThreadData*)threadData;
+    const int resolutionX = data->resolutionX;
+    const int resolutionY = data->resolutionY;
+    const Vector2& scale = data->scale;
+    float* heights = data->heights;
+    NormalMapFace* faceNormals = data->faceNormals;
+
+    for (int z = (int)begin; z < (int)end; z++)
+    {
+        for (int x = 0; x < resolutionX-1; x++)
+        {
+            float topLeftHeight = getHeight(heights, resolutionX, resolutionY, x, z);
+            float bottomLeftHeight = getHeight(heights, resolutionX, resolutionY, x, z + 1);
+            float bottomRightHeight = getHeight(heights, resolutionX, resolutionY, x + 1, z + 1);
+            float topRightHeight = getHeight(heights, resolutionX, resolutionY, x + 1, z);
+
+            // Triangle 1
+            calculateNormal(
+                (float)x*scale.x, bottomLeftHeight, (float)(z + 1)*scale.y,
+                (float)x*scale.x, topLeftHeight, (float)z*scale.y,
+                (float)(x + 1)*scale.x, topRightHeight, (float)z*scale.y,
+                &faceNormals[z*(resolutionX-1)+x].normal1);
+
+            // Triangle 2
+            calculateNormal(
+                (float)x*scale.x, bottomLeftHeight, (float)(z + 1)*scale.y,
+                (float)(x + 1)*scale.x, topRightHeight, (float)z*scale.y,
+                (float)(x + 1)*scale.x, bottomRightHeight, (float)(z + 1)*scale.y,
+                &faceNormals[z*(resolutionX-1)+x].normal2);
+        }
+
+        ++data->processedRows;
+        LOG(1, "\rCalculating normals... %d%%", (int)(((float)data->processedRows / data->totalRows) * 100));
+    }
+}
+
+static void calculateVertexNormals(unsigned int begin, unsigned int end, unsigned int thread, void* threadData)
+{
+    NormalMapThreadData* data = (NormalMapThreadData*)threadData;
+    const int resolutionX = data->resolutionX;
+    const int resolutionY = data->resolutionY;
+    const NormalMapFace* faceNormals = data->faceNormals;
+
+    Vector3 normal;
+    for (int z = (int)begin; z < (int)end; z++)
+    {
+        for (int x = 0; x < resolutionX; x++)
+        {
+            // Reset normal sum
+            normal.set(0, 0, 0);
+
+            if (x > 0)
+            {
+                if (z > 0)
+                {
+                    // Top left
+                    normal.add(faceNormals[(z-1)*(resolutionX-1) + (x-1)].normal2);
+                }
+
+                if (z < (resolutionY - 1))
+                {
+                    // Bottom left
+                    normal.add(faceNormals[z*(resolutionX-1) + (x - 1)].normal1);
+                    normal.add(faceNormals[z*(resolutionX-1) + (x - 1)].normal2);
+                }
+            }
+
+            if (x < (resolutionX - 1))
+            {
+                if (z > 0)
+                {
+                    // Top right
+                    normal.add(faceNormals[(z-1)*(resolutionX-1) + x].normal1);
+                    normal.add(faceNormals[(z-1)*(resolutionX-1) + x].normal2);
+                }
+
+                if (z < (resolutionY - 1))
+                {
+                    // Bottom right
+                    normal.add(faceNormals[z*(resolutionX-1) + x].normal1);
+                }
+            }
+
+            // We don't have to worry about weighting the normals by
+            // the surface area of the triangles since a heightmap 
+            // guarantees that all triangles have the same surface area.
+            normal.normalize();
+
+            // Store this vertex normal
+            NormalPixel& pixel = data->normalPixels[z*resolutionX + x];
+            pixel.r = (unsigned char)((normal.x + 1.0f) * 0.5f * 255.0f);
+            pixel.g = (unsigned char)((normal.y + 1.0f) * 0.5f * 255.0f);
+            pixel.b = (unsigned char)((normal.z + 1.0f) * 0.5f * 255.0f);
+        }
+
+        ++data->processedRows;
+        LOG(1, "\rCalculating normals... %d%%", (int)(((float)data->processedRows / data->totalRows) * 100));
+    }
+}
+
 void NormalMapGenerator::generate()
 {
     // Load the input heightmap
@@ -202,115 +333,28 @@ void NormalMapGenerator::generate()
     //
     ///////////////////////////////////////////////////////////////////////////////////////////////
 
-    struct NormalPixel
-    {
-        unsigned char r, g, b;
-    };
     NormalPixel* normalPixels = new NormalPixel[_resolutionX * _resolutionY];
 
-    struct Face
-    {
-        Vector3 normal1;
-        Vector3 normal2;
-    };
-
-    int progressMax = (_resolutionX-1) * (_resolutionY-1) + _resolutionX * _resolutionY;
-    int progress = 0;
-
-    Vector2 scale(_worldSize.x / (_resolutionX-1), _worldSize.z / (_resolutionY-1));
-
     // First calculate all face normals for the heightmap
     LOG(1, "Calculating normals... 0%%");
-    Face* faceNormals = new Face[(_resolutionX - 1) * (_resolutionY - 1)];
-    Vector3 v1, v2;
-    for (int z = 0; z < _resolutionY-1; z++)
-    {
-        for (int x = 0; x < _resolutionX-1; x++)
-        {
-            float topLeftHeight = getHeight(heights, _resolutionX, _resolutionY, x, z);
-            float bottomLeftHeight = getHeight(heights, _resolutionX, _resolutionY, x, z + 1);
-            float bottomRightHeight = getHeight(heights, _resolutionX, _resolutionY, x + 1, z + 1);
-            float topRightHeight = getHeight(heights, _resolutionX, _resolutionY, x + 1, z);
-
-            // Triangle 1
-            calculateNormal(
-                (float)x*scale.x, bottomLeftHeight, (float)(z + 1)*scale.y,
-                (float)x*scale.x, topLeftHeight, (float)z*scale.y,
-                (float)(x + 1)*scale.x, topRightHeight, (float)z*scale.y,
-                &faceNormals[z*(_resolutionX-1)+x].normal1);
-
-            // Triangle 2
-            calculateNormal(
-                (float)x*scale.x, bottomLeftHeight, (float)(z + 1)*scale.y,
-                (float)(x + 1)*scale.x, topRightHeight, (float)z*scale.y,
-                (float)(x + 1)*scale.x, bottomRightHeight, (float)(z + 1)*scale.y,
-                &faceNormals[z*(_resolutionX-1)+x].normal2);
-
-            ++progress;
-            LOG(1, "\rCalculating normals... %d%%", (int)(((float)progress / progressMax) * 100));
-        }
-    }
+    NormalMapThreadData data;
+    data.heights = heights;
+    data.faceNormals = new NormalMapFace[(_resolutionX - 1) * (_resolutionY - 1)];
+    data.normalPixels = normalPixels;
+    data.resolutionX = _resolutionX;
+    data.resolutionY = _resolutionY;
+    data.scale.set(_worldSize.x / (_resolutionX-1), _worldSize.z / (_resolutionY-1));
+    data.processedRows = 0;
+    data.totalRows = (_resolutionY - 1) + _resolutionY;
+    parallelFor(_resolutionY - 1, NORMALMAP_GRAIN_SIZE, &calculateFaceNormals, &data);
 
     // Free height array
     delete[] heights;
     heights = NULL;
 
     // Smooth normals by taking an average for each vertex
-    Vector3 normal;
-    for (int z = 0; z < _resolutionY; z++)
-    {
-        for (int x = 0; x < _resolutionX; x++)
-        {
-            // Reset normal sum
-            normal.set(0, 0, 0);
-
-            if (x > 0)
-            {
-                if (z > 0)
-                {
-                    // Top left
-                    normal.add(faceNormals[(z-1)*(_resolutionX-1) + (x-1)].normal2);
-                }
-
-                if (z < (_resolutionY - 1))
-                {
-                    // Bottom left
-                    normal.add(faceNormals[z*(_resolutionX-1) + (x - 1)].normal1);
-                    normal.add(faceNormals[z*(_resolutionX-1) + (x - 1)].normal2);
-                }
-            }
-
-            if (x < (_resolutionX - 1))
-            {
-                if (z > 0)
-                {
-                    // Top right
-                    normal.add(faceNormals[(z-1)*(_resolutionX-1) + x].normal1);
-                    normal.add(faceNormals[(z-1)*(_resolutionX-1) + x].normal2);
-                }
-
-                if (z < (_resolutionY - 1))
-                {
-                    // Bottom right
-                    normal.add(faceNormals[z*(_resolutionX-1) + x].normal1);
-                }
-            }
-
-            // We don't have to worry about weighting the normals by
-            // the surface area of the triangles since a heightmap 
-            // guarantees that all triangles have the same surface area.
-            normal.normalize();
-
-            // Store this vertex normal
-            NormalPixel& pixel = normalPixels[z*_resolutionX + x];
-            pixel.r = (unsigned char)((normal.x + 1.0f) * 0.5f * 255.0f);
-            pixel.g = (unsigned char)((normal.y + 1.0f) * 0.5f * 255.0f);
-            pixel.b = (unsigned char)((normal.z + 1.0f) * 0.5f * 255.0f);
-
-            ++progress;
-            LOG(1, "\rCalculating normals... %d%%", (int)(((float)progress / progressMax) * 100));
-        }
-    }
+    parallelFor(_resolutionY, NORMALMAP_GRAIN_SIZE, &calculateVertexNormals, &data);
+    delete[] data.faceNormals;
 
     LOG(1, "\rCalculating normals... Done.\n");
 
@@ -0,0 +1,312 @@
+#include "Base.h"
+#include "PackEncoder.h"
+
+#include <zlib.h>
+
+#ifdef WIN32
+    #include <windows.h>
+#else
+    #include <dirent.h>
+#endif
+
+#define PACK_MAGIC              "GPAK"
+#define PACK_VERSION            1
+#define PACK_COMPRESSION_NONE   0
+#define PACK_COMPRESSION_ZLIB   1
+#define PACK_ALIGNMENT          16
+#define MANIFEST_MAGIC          "GPMF"
+#define MANIFEST_VERSION        1
+
+namespace gameplay
+{
+
+struct PackEntry
+{
+    std::string name;
+    unsigned int hash;
+    unsigned int nameOffset;
+    unsigned int compression;
+    unsigned int offset;
+    unsigned int size;
+    unsigned int originalSize;
+    std::vector<unsigned char> data;
+};
+
+static bool comparePackEntry(const PackEntry* a, const PackEntry* b)
+{
+    return a->hash != b->hash ? a->hash < b->hash : a->name < b->name;
+}
+
+static unsigned int hashData(const unsigned char* data, size_t length)
+{
+    // FNV-1a, as used by the runtime to look up files.
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static unsigned int hashPath(const std::string& path)
+{
+    return hashData((const unsigned char*)path.c_str(), path.length());
+}
+
+/**
+ * Appends the paths of the files in a directory and its subdirectories, relative to the packed directory.
+ */
+static bool listFiles(const std::string& root, const std::string& dir, std::vector<std::string>& files)
+{
+    std::string path = dir.empty() ? root : root + "/" + dir;
+#ifdef WIN32
+    WIN32_FIND_DATAA data;
+    HANDLE handle = FindFirstFileA((path + "/*").c_str(), &data);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+    do
+    {
+        std::string name(data.cFileName);
+        if (name[0] == '.')
+            continue;
+        std::string file = dir.empty() ? name : dir + "/" + name;
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            listFiles(root, file, files);
+        else
+            files.push_back(file);
+    }
+    while (FindNextFileA(handle, &data));
+    FindClose(handle);
+#else
+    DIR* d = opendir(path.c_str());
+    if (d == NULL)
+        return false;
+    struct dirent* entry;
+    while ((entry = readdir(d)) != NULL)
+    {
+        std::string name(entry->d_name);
+        if (name[0] == '.')
+            continue;
+        std::string file = dir.empty() ? name : dir + "/" + name;
+        struct stat s;
+        if (stat((root + "/" + file).c_str(), &s) != 0)
+            continue;
+        if (S_ISDIR(s.st_mode))
+            listFiles(root, file, files);
+        else if (S_ISREG(s.st_mode))
+            files.push_back(file);
+    }
+    closedir(d);
+#endif
+    return true;
+}
+
+static bool readFile(const std::string& path, std::vector<unsigned char>& data)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL)
+        return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data.resize(size > 0 ? (size_t)size : 0);
+    bool result = data.empty() || fread(&data[0], 1, data.size(), file) == data.size();
+    fclose(file);
+    return result;
+}
+
+static void writeUint(FILE* file, unsigned int value)
+{
+    unsigned char bytes[4] = { (unsigned char)value, (unsigned char)(value >> 8), (unsigned char)(value >> 16), (unsigned char)(value >> 24) };
+    fwrite(bytes, 1, 4, file);
+}
+
+int writePack(const char* dirPath, const char* outFilePath)
+{
+    std::string root(dirPath);
+    while (root.length() > 1 && (root[root.length() - 1] == '/' || root[root.length() - 1] == '\\'))
+        root.erase(root.length() - 1);
+
+    std::vector<std::string> files;
+    if (!listFiles(root, "", files))
+    {
+        LOG(1, "Error: Failed to list directory: %s\n", dirPath);
+        return -1;
+    }
+
+    // Keep the data in path order, so that files of the same directory are next to each other.
+    std::sort(files.begin(), files.end());
+
+    std::vector<PackEntry> entries(files.size());
+    unsigned int namesLength = 0;
+    for (size_t i = 0, count = files.size(); i < count; ++i)
+    {
+        PackEntry& entry = entries[i];
+        entry.name = files[i];
+        entry.hash = hashPath(entry.name);
+        entry.nameOffset = namesLength;
+        namesLength += (unsigned int)entry.name.length();
+        if (!readFile(root + "/" + entry.name, entry.data))
+        {
+            LOG(1, "Error: Failed to read file: %s\n", entry.name.c_str());
+            return -1;
+        }
+        entry.originalSize = (unsigned int)entry.data.size();
+
+        // Only keep the compressed data if it saves at least an eighth of the size;
+        // already compressed files (such as images and audio) are stored as they are.
+        entry.compression = PACK_COMPRESSION_NONE;
+        if (!entry.data.empty())
+        {
+            uLongf compressedSize = compressBound((uLong)entry.data.size());
+            std::vector<unsigned char> compressed(compressedSize);
+            if (compress2(&compressed[0], &compressedSize, &entry.data[0], (uLong)entry.data.size(), Z_BEST_COMPRESSION) == Z_OK &&
+                compressedSize < entry.data.size() - entry.data.size() / 8)
+            {
+                compressed.resize(compressedSize);
+                entry.data.swap(compressed);
+                entry.compression = PACK_COMPRESSION_ZLIB;
+            }
+        }
+        entry.size = (unsigned int)entry.data.size();
+        LOG(2, "  %s (%u -> %u bytes)\n", entry.name.c_str(), entry.originalSize, entry.size);
+    }
+
+    // Lay out the data after the header, the entry table and the names.
+    unsigned int offset = 16 + (unsigned int)entries.size() * 28 + namesLength;
+    for (size_t i = 0, count = entries.size(); i < count; ++i)
+    {
+        PackEntry& entry = entries[i];
+        if (entry.compression == PACK_COMPRESSION_NONE)
+            offset = (offset + PACK_ALIGNMENT - 1) & ~(PACK_ALIGNMENT - 1);
+        entry.offset = offset;
+        offset += entry.size;
+    }
+
+    std::vector<const PackEntry*> table(entries.size());
+    for (size_t i = 0, count = entries.size(); i < count; ++i)
+        table[i] = &entries[i];
+    std::sort(table.begin(), table.end(), comparePackEntry);
+
+    FILE* file = fopen(outFilePath, "wb");
+    if (file == NULL)
+    {
+        LOG(1, "Error: Failed to open file for writing: %s\n", outFilePath);
+        return -1;
+    }
+
+    fwrite(PACK_MAGIC, 1, 4, file);
+    writeUint(file, PACK_VERSION);
+    writeUint(file, (unsigned int)entries.size());
+    writeUint(file, namesLength);
+    for (size_t i = 0, count = table.size(); i < count; ++i)
+    {
+        const PackEntry* entry = table[i];
+        writeUint(file, entry->hash);
+        writeUint(file, entry->nameOffset);
+        writeUint(file, (unsigned int)entry->name.length());
+        writeUint(file, entry->compression);
+        writeUint(file, entry->offset);
+        writeUint(file, entry->size);
+        writeUint(file, entry->originalSize);
+    }
+    for (size_t i = 0, count = entries.size(); i < count; ++i)
+    {
+        fwrite(entries[i].name.c_str(), 1, entries[i].name.length(), file);
+    }
+    for (size_t i = 0, count = entries.size(); i < count; ++i)
+    {
+        const PackEntry& entry = entries[i];
+        static const unsigned char padding[PACK_ALIGNMENT] = { 0 };
+        long position = ftell(file);
+        fwrite(padding, 1, entry.offset - (unsigned int)position, file);
+        if (!entry.data.empty())
+            fwrite(&entry.data[0], 1, entry.data.size(), file);
+    }
+
+    bool failed = ferror(file) != 0;
+    fclose(file);
+    if (failed)
+    {
+        LOG(1, "Error: Failed to write file: %s\n", outFilePath);
+        return -1;
+    }
+
+    LOG(1, "Wrote %u files to %s.\n", (unsigned int)entries.size(), outFilePath);
+    return 0;
+}
+
+int writeManifest(const char* dirPath, const char* outFilePath)
+{
+    std::string root(dirPath);
+    while (root.length() > 1 && (root[root.length() - 1] == '/' || root[root.length() - 1] == '\\'))
+        root.erase(root.length() - 1);
+
+    std::vector<std::string> files;
+    if (!listFiles(root, "", files))
+    {
+        LOG(1, "Error: Failed to list directory: %s\n", dirPath);
+        return -1;
+    }
+    std::sort(files.begin(), files.end());
+
+    // The manifest does not list itself when it is written into the listed directory.
+    std::string output(outFilePath);
+    std::replace(output.begin(), output.end(), '\\', '/');
+    for (size_t i = files.size(); i-- > 0;)
+    {
+        if (root + "/" + files[i] == output || (root == "." && files[i] == output))
+            files.erase(files.begin() + i);
+    }
+
+    FILE* file = fopen(outFilePath, "wb");
+    if (file == NULL)
+    {
+        LOG(1, "Error: Failed to open file for writing: %s\n", outFilePath);
+        return -1;
+    }
+
+    unsigned int namesLength = 0;
+    for (size_t i = 0, count = files.size(); i < count; ++i)
+        namesLength += (unsigned int)files[i].length();
+
+    fwrite(MANIFEST_MAGIC, 1, 4, file);
+    writeUint(file, MANIFEST_VERSION);
+    writeUint(file, (unsigned int)files.size());
+    writeUint(file, namesLength);
+    unsigned int nameOffset = 0;
+    for (size_t i = 0, count = files.size(); i < count; ++i)
+    {
+        std::vector<unsigned char> data;
+        if (!readFile(root + "/" + files[i], data))
+        {
+            LOG(1, "Error: Failed to read file: %s\n", files[i].c_str());
+            fclose(file);
+            return -1;
+        }
+        writeUint(file, nameOffset);
+        writeUint(file, (unsigned int)files[i].length());
+        writeUint(file, (unsigned int)data.size());
+        writeUint(file, data.empty() ? hashData(NULL, 0) : hashData(&data[0], data.size()));
+        nameOffset += (unsigned int)files[i].length();
+        LOG(2, "  %s (%u bytes)\n", files[i].c_str(), (unsigned int)data.size());
+    }
+    for (size_t i = 0, count = files.size(); i < count; ++i)
+    {
+        fwrite(files[i].c_str(), 1, files[i].length(), file);
+    }
+
+    bool failed = ferror(file) != 0;
+    fclose(file);
+    if (failed)
+    {
+        LOG(1, "Error: Failed to write file: %s\n", outFilePath);
+        return -1;
+    }
+
+    LOG(1, "Wrote %u files to %s.\n", (unsigned int)files.size(), outFilePath);
+    return 0;
+}
+
+}
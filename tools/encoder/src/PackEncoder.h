@@ -0,0 +1,43 @@
+#ifndef PACKENCODER_H_
+#define PACKENCODER_H_
+
+namespace gameplay
+{
+
+/**
+ * Writes a pack archive with all of the files in a directory and its subdirectories.
+ *
+ * The archive starts with a header ("GPAK", version, entry count, names length), followed by
+ * a table of entries sorted by the FNV-1a hash of their path and then by path, the paths, and
+ * the file data. Each file is compressed with zlib if that makes it noticeably smaller, and
+ * stored uncompressed at a 16 byte aligned offset otherwise, so that the runtime can read it
+ * in place from a memory mapped archive. All values are 32 bit little endian.
+ *
+ * Paths are relative to the packed directory and use forward slashes, so packing the
+ * directory of a game makes "res/box.gpb" available under the same path as on disk.
+ *
+ * @param dirPath The directory to pack.
+ * @param outFilePath The path of the archive to write.
+ *
+ * @return 0 if successful, -1 if error.
+ */
+int writePack(const char* dirPath, const char* outFilePath);
+
+/**
+ * Writes an asset manifest of all of the files in a directory and its subdirectories.
+ *
+ * The manifest starts with a header ("GPMF", version, entry count, names length), followed by
+ * a table of entries sorted by path, and the paths. Each entry holds the offset and length of
+ * its path, the size of the file and the FNV-1a hash of its contents. All values are 32 bit
+ * little endian. Paths are relative to the directory, as in pack archives.
+ *
+ * @param dirPath The directory to list.
+ * @param outFilePath The path of the manifest to write.
+ *
+ * @return 0 if successful, -1 if error.
+ */
+int writeManifest(const char* dirPath, const char* outFilePath);
+
+}
+
+#endif
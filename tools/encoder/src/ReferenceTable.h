@@ -35,6 +35,11 @@ public:
 
     Object* get(const std::string& xref);
 
+    /**
+     * Removes the object with the given xref from the reference table.
+     */
+    void remove(const std::string& xref);
+
     void writeBinary(FILE* file);
     void writeText(FILE* file);
 
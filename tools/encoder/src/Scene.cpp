@@ -4,6 +4,48 @@
 namespace gameplay
 {
 
+/**
+ * Transforms a bounding sphere by a matrix, scaling its radius by the largest scale of the matrix.
+ */
+static void transformSphere(const Matrix& m, BoundingVolume& bounds)
+{
+    m.transformPoint(bounds.center, &bounds.center);
+    float scale = 0.0f;
+    for (int i = 0; i < 3; ++i)
+    {
+        const float* axis = &m.m[i * 4];
+        scale = std::max(scale, sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]));
+    }
+    bounds.radius *= scale;
+}
+
+/**
+ * Merges a bounding sphere into another one, the same way that the runtime merges the bounds of nodes.
+ */
+static void mergeSphere(BoundingVolume& bounds, const BoundingVolume& sphere)
+{
+    if (sphere.radius == 0.0f)
+    {
+        return;
+    }
+    Vector3 v(bounds.center.x - sphere.center.x, bounds.center.y - sphere.center.y, bounds.center.z - sphere.center.z);
+    float d = v.length();
+    if (d <= sphere.radius - bounds.radius)
+    {
+        bounds.center = sphere.center;
+        bounds.radius = sphere.radius;
+        return;
+    }
+    if (d <= bounds.radius - sphere.radius)
+    {
+        return;
+    }
+    float r = (bounds.radius + sphere.radius + d) * 0.5f;
+    float scale = (r - sphere.radius) / d;
+    bounds.center.set(v.x * scale + sphere.center.x, v.y * scale + sphere.center.y, v.z * scale + sphere.center.z);
+    bounds.radius = r;
+}
+
 Scene::Scene(void) : _cameraNode(NULL)
 {
     _ambientColor[0] = 0.0f;
@@ -29,6 +71,28 @@ const char* Scene::getElementName(void) const
 void Scene::writeBinary(FILE* file)
 {
     Object::writeBinary(file);
+
+    // The flattened hierarchy lets the runtime build the scene without searching for nodes,
+    // and gives it the world matrices and bounds of the nodes that never move.
+    std::vector<HierarchyNode> hierarchy;
+    for (std::list<Node*>::const_iterator i = _nodes.begin(); i != _nodes.end(); ++i)
+    {
+        flattenHierarchy(*i, -1, false, hierarchy);
+    }
+    write((unsigned int)hierarchy.size(), file);
+    for (size_t i = 0, count = hierarchy.size(); i < count; ++i)
+    {
+        const HierarchyNode& node = hierarchy[i];
+        write((unsigned int)node.parentIndex, file);
+        write(node.isStatic, file);
+        if (node.isStatic)
+        {
+            write(node.world.m, 16, file);
+            writeVectorBinary(node.bounds.center, file);
+            write(node.bounds.radius, file);
+        }
+    }
+
     writeBinaryObjects(_nodes, file);
     if (_cameraNode)
     {
@@ -44,6 +108,25 @@ void Scene::writeBinary(FILE* file)
 void Scene::writeText(FILE* file)
 {
     fprintElementStart(file);
+    std::vector<HierarchyNode> hierarchy;
+    for (std::list<Node*>::const_iterator i = _nodes.begin(); i != _nodes.end(); ++i)
+    {
+        flattenHierarchy(*i, -1, false, hierarchy);
+    }
+    fprintf(file, "<hierarchy count=\"%lu\">\n", hierarchy.size());
+    for (size_t i = 0, count = hierarchy.size(); i < count; ++i)
+    {
+        const HierarchyNode& node = hierarchy[i];
+        fprintf(file, "%d", node.parentIndex);
+        if (node.isStatic)
+        {
+            fprintf(file, " static ");
+            fprintfMatrix4f(file, node.world.m);
+            fprintf(file, "%f %f %f %f", node.bounds.center.x, node.bounds.center.y, node.bounds.center.z, node.bounds.radius);
+        }
+        fprintf(file, "\n");
+    }
+    fprintf(file, "</hierarchy>\n");
     for (std::list<Node*>::const_iterator i = _nodes.begin(); i != _nodes.end(); ++i)
     {
         (*i)->writeText(file);
@@ -61,6 +144,16 @@ void Scene::add(Node* node)
     _nodes.push_back(node);
 }
 
+const std::list<Node*>& Scene::getNodes() const
+{
+    return _nodes;
+}
+
+void Scene::setAnimatedNodeIds(const std::set<std::string>& ids)
+{
+    _animatedNodeIds = ids;
+}
+
 void Scene::setActiveCameraNode(Node* node)
 {
     _cameraNode = node;
@@ -99,6 +192,82 @@ void Scene::setAmbientColor(float red, float green, float blue)
     _ambientColor[2] = blue;
 }
 
+const float* Scene::getAmbientColor() const
+{
+    return _ambientColor;
+}
+
+bool Scene::flattenHierarchy(Node* node, int parentIndex, bool movable, std::vector<HierarchyNode>& hierarchy) const
+{
+    Model* model = node->getModel();
+    movable = movable || node->isJoint() || (model && model->getSkin()) || _animatedNodeIds.count(node->getId()) > 0;
+
+    const int index = (int)hierarchy.size();
+    hierarchy.push_back(HierarchyNode());
+    hierarchy[index].parentIndex = parentIndex;
+
+    // Compute the world-space bounds of the node the same way that the runtime does.
+    const Matrix& world = node->getWorldMatrix();
+    BoundingVolume bounds;
+    bounds.radius = 0.0f;
+    bool empty = true;
+    if (model && model->getMesh())
+    {
+        bounds = model->getMesh()->bounds;
+        empty = false;
+    }
+    if (node->hasLight() && node->getLight()->isPoint())
+    {
+        BoundingVolume range;
+        range.center.set(0.0f, 0.0f, 0.0f);
+        range.radius = node->getLight()->getRange();
+        if (empty)
+        {
+            bounds = range;
+            empty = false;
+        }
+        else
+        {
+            mergeSphere(bounds, range);
+        }
+    }
+    if (empty)
+    {
+        bounds.center.set(world.m[12], world.m[13], world.m[14]);
+        bounds.radius = 0.0f;
+    }
+    else
+    {
+        transformSphere(world, bounds);
+    }
+
+    bool isStatic = !movable;
+    for (Node* child = node->getFirstChild(); child != NULL; child = child->getNextSibling())
+    {
+        const int childIndex = (int)hierarchy.size();
+        isStatic = flattenHierarchy(child, index, movable, hierarchy) && isStatic;
+        const BoundingVolume& childBounds = hierarchy[childIndex].bounds;
+        if (childBounds.radius != 0.0f)
+        {
+            if (empty)
+            {
+                bounds = childBounds;
+                empty = false;
+            }
+            else
+            {
+                mergeSphere(bounds, childBounds);
+            }
+        }
+    }
+
+    HierarchyNode& entry = hierarchy[index];
+    entry.isStatic = isStatic;
+    memcpy(entry.world.m, world.m, 16 * sizeof(float));
+    entry.bounds = bounds;
+    return isStatic;
+}
+
 void Scene::calcAmbientColor(const Node* node, float* values) const
 {
     if (!node)
@@ -1,6 +1,7 @@
 #ifndef SCENE_H_
 #define SCENE_H_
 
+#include <set>
 #include "Object.h"
 #include "Node.h"
 #include "FileIO.h"
@@ -55,8 +56,47 @@ public:
      */
     void setAmbientColor(float red, float green, float blue);
 
+    /**
+     * Returns the scene's ambient color, as three floats.
+     */
+    const float* getAmbientColor() const;
+
+    /**
+     * Returns the nodes at the root of this scene.
+     */
+    const std::list<Node*>& getNodes() const;
+
+    /**
+     * Sets the ids of the nodes that are targeted by animations. These nodes, the nodes above
+     * them and the nodes below them are not stored as static in the hierarchy of this scene.
+     */
+    void setAnimatedNodeIds(const std::set<std::string>& ids);
+
 private:
 
+    /**
+     * A node in the flattened hierarchy of the scene.
+     */
+    struct HierarchyNode
+    {
+        int parentIndex;
+        bool isStatic;
+        Matrix world;
+        BoundingVolume bounds;
+    };
+
+    /**
+     * Appends the given node and the nodes below it to the flattened hierarchy, in the order
+     * that the nodes are written, and returns true if none of them can move.
+     *
+     * @param node The node to flatten.
+     * @param parentIndex The index of the parent of the node, or -1 for the nodes at the root.
+     * @param movable True if an ancestor of the node can move.
+     * @param hierarchy The flattened hierarchy to append to.
+     */
+    bool flattenHierarchy(Node* node, int parentIndex, bool movable, std::vector<HierarchyNode>& hierarchy) const;
+
+
     /**
      * Recursively calculates the ambient color of the scene starting at the given node.
      * The ambient light color is added to the given float array.
@@ -71,6 +111,7 @@ private:
     Node* _cameraNode;
     float _ambientColor[Light::COLOR_SIZE];
     Node* _lightNode;
+    std::set<std::string> _animatedNodeIds;
 };
 
 }
@@ -2,6 +2,7 @@
 #include "TTFFontEncoder.h"
 #include "GPBFile.h"
 #include "StringUtil.h"
+#include "Thread.h"
 
 namespace gameplay
 {
@@ -34,13 +35,45 @@ static void writeString(FILE* fp, const char* str)
     }
 }
 
+// The distance transform of the background or the foreground of an image
+struct DistanceFieldPass
+{
+    double* data;       // [in] Levels of the pixels, between 0 and 1
+    double* distances;  // [out]
+    unsigned int width;
+    unsigned int height;
+};
+
+static void computeDistanceFieldPasses(unsigned int begin, unsigned int end, unsigned int thread, void* arg)
+{
+    DistanceFieldPass* passes = (DistanceFieldPass*)arg;
+    for (unsigned int pass = begin; pass < end; ++pass)
+    {
+        const unsigned int width = passes[pass].width;
+        const unsigned int height = passes[pass].height;
+        short* xDistance = (short*)malloc(width * height * sizeof(short));
+        short* yDistance = (short*)malloc(width * height * sizeof(short));
+        double* gx = (double*)calloc(width * height, sizeof(double));
+        double* gy = (double*)calloc(width * height, sizeof(double));
+        double* distances = passes[pass].distances;
+        computegradient(passes[pass].data, width, height, gx, gy);
+        edtaa3(passes[pass].data, gx, gy, height, width, xDistance, yDistance, distances);
+        for (unsigned int i = 0; i < width * height; ++i)
+        {
+            if (distances[i] < 0)
+                distances[i] = 0.0;
+        }
+        free(xDistance);
+        free(yDistance);
+        free(gx);
+        free(gy);
+    }
+}
+
 unsigned char* createDistanceFields(unsigned char* img, unsigned int width, unsigned int height)
 {
-    short* xDistance = (short*)malloc(width * height * sizeof(short));
-    short* yDistance = (short*)malloc(width * height * sizeof(short));
-    double* gx = (double*)calloc(width * height, sizeof(double));
-    double* gy = (double*)calloc(width * height, sizeof(double));
     double* data = (double*)calloc(width * height, sizeof(double));
+    double* inverseData = (double*)calloc(width * height, sizeof(double));
     double* outside = (double*)calloc(width * height, sizeof(double));
     double* inside = (double*)calloc(width * height, sizeof(double));
     unsigned int i;
@@ -62,28 +95,18 @@ unsigned char* createDistanceFields(unsigned char* img, unsigned int width, unsi
     {
         data[i] = (img[i] - imgMin) / imgMax;
     }
-    // Compute outside = edtaa3(bitmap); % Transform background (0's)
-    computegradient(data, width, height, gx, gy);
-    edtaa3(data, gx, gy, height, width, xDistance, yDistance, outside);
     for (i = 0; i < width * height; ++i)
     {
-        if (outside[i] < 0 )
-            outside[i] = 0.0;
+        inverseData[i] = 1 - data[i];
     }
-    // Compute inside = edtaa3(1-bitmap); % Transform foreground (1's)
-    memset(gx, 0, sizeof(double) * width * height);
-    memset(gy, 0, sizeof(double) * width * height);
-    for (i = 0; i < width * height; ++i)
-    {
-        data[i] = 1 - data[i];
-    }
-    computegradient(data, width, height, gx, gy);
-    edtaa3(data, gx, gy, height, width, xDistance, yDistance, inside);
-    for (i = 0; i < width * height; ++i)
+    // Compute outside = edtaa3(bitmap); % Transform background (0's)
+    // and inside = edtaa3(1-bitmap); % Transform foreground (1's), at the same time.
+    DistanceFieldPass passes[2] =
     {
-        if( inside[i] < 0 )
-            inside[i] = 0.0;
-    }
+        { data, outside, width, height },
+        { inverseData, inside, width, height }
+    };
+    parallelFor(2, 1, &computeDistanceFieldPasses, passes);
     // distmap = outside - inside; % Bipolar distance field
     unsigned char* out = (unsigned char*)malloc(sizeof(unsigned char) * width * height);
     for (i = 0; i < width * height; ++i)
@@ -96,11 +119,8 @@ unsigned char* createDistanceFields(unsigned char* img, unsigned int width, unsi
             outside[i] = 255;
         out[i] = 255 - (unsigned char) outside[i];
     }
-    free(xDistance);
-    free(yDistance);
-    free(gx);
-    free(gy);
     free(data);
+    free(inverseData);
     free(outside);
     free(inside);
 
@@ -124,7 +144,10 @@ struct FontData
     unsigned int imageWidth;
     unsigned int imageHeight;
 
-    FontData() : fontSize(0), glyphSize(0), imageBuffer(NULL), imageWidth(0), imageHeight(0)
+    // Distance field of the font texture, for distance field fonts
+    unsigned char* distanceFieldBuffer;
+
+    FontData() : fontSize(0), glyphSize(0), imageBuffer(NULL), imageWidth(0), imageHeight(0), distanceFieldBuffer(NULL)
     {
     }
 
@@ -132,8 +155,21 @@ struct FontData
     {
         if (imageBuffer)
             free(imageBuffer);
+        if (distanceFieldBuffer)
+            free(distanceFieldBuffer);
     }
 };
+
+static void createFontDistanceFields(unsigned int begin, unsigned int end, unsigned int thread, void* arg)
+{
+    std::vector<FontData*>& fonts = *(std::vector<FontData*>*)arg;
+    for (unsigned int i = begin; i < end; ++i)
+    {
+        // Flip height and width since the distance field map generator is column-wise.
+        FontData* font = fonts[i];
+        font->distanceFieldBuffer = createDistanceFields(font->imageBuffer, font->imageHeight, font->imageWidth);
+    }
+}
  
 int writeFont(const char* inFilePath, const char* outFilePath, std::vector<unsigned int>& fontSizes, const char* id, bool fontpreview = false, Font::FontFormat fontFormat = Font::BITMAP)
 {
@@ -382,6 +418,12 @@ int writeFont(const char* inFilePath, const char* outFilePath, std::vector<unsig
         fonts.push_back(font);
     }
 
+    // Generate the distance fields of all of the font sizes at once, since they take most of the time.
+    if (fontFormat == Font::DISTANCE_FIELD)
+    {
+        parallelFor(fonts.size(), 1, &createFontDistanceFields, &fonts);
+    }
+
     // File header and version.
     FILE *gpbFp = fopen(outFilePath, "wb");    
     char fileHeader[9]     = {'\xAB', 'G', 'P', 'B', '\xBB', '\r', '\n', '\x1A', '\n'};
@@ -446,8 +488,7 @@ int writeFont(const char* inFilePath, const char* outFilePath, std::vector<unsig
 
         if (fontFormat == Font::DISTANCE_FIELD)
         {
-            // Flip height and width since the distance field map generator is column-wise.
-            unsigned char* distanceFieldBuffer = createDistanceFields(font->imageBuffer, font->imageHeight, font->imageWidth);
+            unsigned char* distanceFieldBuffer = font->distanceFieldBuffer;
 
             fwrite(distanceFieldBuffer, sizeof(unsigned char), imageSize, gpbFp);
             writeUint(gpbFp, Font::DISTANCE_FIELD);
@@ -457,8 +498,6 @@ int writeFont(const char* inFilePath, const char* outFilePath, std::vector<unsig
                 fwrite((const char*)distanceFieldBuffer, sizeof(unsigned char), imageSize, previewFp);
                 fclose(previewFp);
             }
-
-            free(distanceFieldBuffer);
         }
         else
         {
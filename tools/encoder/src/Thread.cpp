@@ -0,0 +1,204 @@
+#include "Base.h"
+#include "Thread.h"
+
+#ifdef WIN32
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif
+
+namespace gameplay
+{
+
+struct ThreadData
+{
+    int(*threadFunction)(void*);
+    void* arg;
+};
+
+struct ParallelForData
+{
+    unsigned int count;
+    unsigned int grainSize;
+    ParallelForFunction function;
+    void* arg;
+    // The first index of the next range to process.
+    volatile long next;
+};
+
+struct ParallelForWorker
+{
+    ParallelForData* data;
+    unsigned int thread;
+};
+
+#ifdef WIN32
+
+static DWORD WINAPI threadProc(LPVOID lpParam)
+{
+    ThreadData* data = (ThreadData*)lpParam;
+    int(*threadFunction)(void*) = data->threadFunction;
+    void* arg = data->arg;
+    delete data;
+    return threadFunction(arg);
+}
+
+bool createThread(THREAD_HANDLE* handle, int(*threadFunction)(void*), void* arg)
+{
+    ThreadData* data = new ThreadData();
+    data->threadFunction = threadFunction;
+    data->arg = arg;
+    *handle = CreateThread(NULL, 0, &threadProc, data, 0, NULL);
+    if (*handle == NULL)
+    {
+        delete data;
+        return false;
+    }
+    return true;
+}
+
+void waitForThreads(int count, THREAD_HANDLE* threads)
+{
+    // Windows can only wait for MAXIMUM_WAIT_OBJECTS handles at a time.
+    for (int i = 0; i < count; i += MAXIMUM_WAIT_OBJECTS)
+    {
+        WaitForMultipleObjects(min(count - i, (int)MAXIMUM_WAIT_OBJECTS), threads + i, TRUE, INFINITE);
+    }
+}
+
+void closeThread(THREAD_HANDLE thread)
+{
+    CloseHandle(thread);
+}
+
+static unsigned int fetchAndAdd(volatile long* value, long add)
+{
+    return (unsigned int)InterlockedExchangeAdd(value, add);
+}
+
+#else
+
+static void* threadProc(void* threadData)
+{
+    ThreadData* data = (ThreadData*)threadData;
+    int(*threadFunction)(void*) = data->threadFunction;
+    void* arg = data->arg;
+    delete data;
+    return (void*)(size_t)threadFunction(arg);
+}
+
+bool createThread(THREAD_HANDLE* handle, int(*threadFunction)(void*), void* arg)
+{
+    ThreadData* data = new ThreadData();
+    data->threadFunction = threadFunction;
+    data->arg = arg;
+    if (pthread_create(handle, NULL, &threadProc, data) != 0)
+    {
+        delete data;
+        return false;
+    }
+    return true;
+}
+
+void waitForThreads(int count, THREAD_HANDLE* threads)
+{
+    // Call join on all threads to wait for them to terminate.
+    // This also frees any resources allocated by the threads,
+    // essentially cleaning them up.
+    for (int i = 0; i < count; ++i)
+    {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+void closeThread(THREAD_HANDLE thread)
+{
+    // nothing to do... waitForThreads (which calls join) cleans up
+}
+
+static unsigned int fetchAndAdd(volatile long* value, long add)
+{
+    return (unsigned int)__sync_fetch_and_add(value, add);
+}
+
+#endif
+
+unsigned int getThreadCount()
+{
+    static unsigned int threadCount = 0;
+    if (threadCount == 0)
+    {
+#ifdef WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        threadCount = info.dwNumberOfProcessors > 0 ? (unsigned int)info.dwNumberOfProcessors : 1;
+#else
+        long count = sysconf(_SC_NPROCESSORS_ONLN);
+        threadCount = count > 0 ? (unsigned int)count : 1;
+#endif
+    }
+    return threadCount;
+}
+
+static int parallelForThread(void* arg)
+{
+    ParallelForWorker* worker = (ParallelForWorker*)arg;
+    ParallelForData* data = worker->data;
+    for (;;)
+    {
+        unsigned int begin = fetchAndAdd(&data->next, (long)data->grainSize);
+        if (begin >= data->count)
+            break;
+        unsigned int end = min(begin + data->grainSize, data->count);
+        data->function(begin, end, worker->thread, data->arg);
+    }
+    return 0;
+}
+
+void parallelFor(unsigned int count, unsigned int grainSize, ParallelForFunction function, void* arg)
+{
+    assert(function);
+    if (count == 0)
+        return;
+    if (grainSize == 0)
+        grainSize = 1;
+
+    unsigned int rangeCount = (count - 1) / grainSize + 1;
+    unsigned int threadCount = min(getThreadCount(), rangeCount);
+    if (threadCount <= 1)
+    {
+        function(0, count, 0, arg);
+        return;
+    }
+
+    ParallelForData data;
+    data.count = count;
+    data.grainSize = grainSize;
+    data.function = function;
+    data.arg = arg;
+    data.next = 0;
+
+    // The calling thread is the first worker. The others take no work if they fail to start.
+    std::vector<ParallelForWorker> workers(threadCount);
+    std::vector<THREAD_HANDLE> threads;
+    for (unsigned int i = 0; i < threadCount; ++i)
+    {
+        workers[i].data = &data;
+        workers[i].thread = i;
+        THREAD_HANDLE thread;
+        if (i > 0 && createThread(&thread, &parallelForThread, &workers[i]))
+            threads.push_back(thread);
+    }
+    parallelForThread(&workers[0]);
+
+    if (!threads.empty())
+    {
+        waitForThreads((int)threads.size(), &threads[0]);
+        for (size_t i = 0; i < threads.size(); ++i)
+        {
+            closeThread(threads[i]);
+        }
+    }
+}
+
+}
@@ -1,99 +1,63 @@
 #ifndef THREAD_H_
 #define THREAD_H_
 
+#ifndef WIN32
+    #include <pthread.h>
+#endif
+
 namespace gameplay
 {
 
 #ifdef WIN32
-
-    #include <Windows.h>
-
-    typedef HANDLE THREAD_HANDLE;
-
-    struct WindowsThreadData
-    {
-        int(*threadFunction)(void*);
-        void* arg;
-    };
-
-    DWORD WINAPI WindowsThreadProc(LPVOID lpParam)
-    {
-        WindowsThreadData* data = (WindowsThreadData*)lpParam;
-        int(*threadFunction)(void*) = data->threadFunction;
-        void* arg = data->arg;
-        delete data;
-        data = NULL;
-        return threadFunction(arg);
-    }
-
-    static bool createThread(THREAD_HANDLE* handle, int(*threadFunction)(void*), void* arg)
-    {
-        WindowsThreadData* data = new WindowsThreadData();
-        data->threadFunction = threadFunction;
-        data->arg = arg;
-        *handle = CreateThread(NULL, 0, &WindowsThreadProc, data, 0, NULL);
-        return (*handle != NULL);
-    }
-
-    static void waitForThreads(int count, THREAD_HANDLE* threads)
-    {
-        WaitForMultipleObjects(count, threads, TRUE, INFINITE);
-    }
-
-    static void closeThread(THREAD_HANDLE thread)
-    {
-        CloseHandle(thread);
-    }
-
+    typedef void* THREAD_HANDLE;
 #else
-
-    #include <pthread.h>
-
     typedef pthread_t THREAD_HANDLE;
-
-    struct PThreadData
-    {
-        int(*threadFunction)(void*);
-        void* arg;
-    };
-
-    void* PThreadProc(void* threadData)
-    {
-        PThreadData* data = (PThreadData*)threadData;
-        int(*threadFunction)(void*) = data->threadFunction;
-        void* arg = data->arg;
-        delete data;
-        data = NULL;
-        int retVal = threadFunction(arg);
-        pthread_exit((void*)retVal);
-    }
-
-    static bool createThread(THREAD_HANDLE* handle, int(*threadFunction)(void*), void* arg)
-    {
-        PThreadData* data = new PThreadData();
-        data->threadFunction = threadFunction;
-        data->arg = arg;
-        return pthread_create(handle, NULL, &PThreadProc, data) == 0;
-    }
-
-    static void waitForThreads(int count, THREAD_HANDLE* threads)
-    {
-        // Call join on all threads to wait for them to terminate.
-        // This also frees any resources allocated by the threads,
-        // essentially cleaning them up.
-        for (int i = 0; i < count; ++i)
-        {
-            pthread_join(threads[i], NULL);
-        }
-    }
-
-    static void closeThread(THREAD_HANDLE thread)
-    {
-        // nothing to do... waitForThreads (which calls join) cleans up
-    }
-
 #endif
 
+/**
+ * Starts a thread that calls a function with an argument.
+ *
+ * @return true if the thread was started.
+ */
+bool createThread(THREAD_HANDLE* handle, int(*threadFunction)(void*), void* arg);
+
+/**
+ * Waits until all of the threads have finished.
+ */
+void waitForThreads(int count, THREAD_HANDLE* threads);
+
+/**
+ * Releases a thread that has finished.
+ */
+void closeThread(THREAD_HANDLE thread);
+
+/**
+ * Returns the number of threads that parallelFor runs on, which is the number of CPUs.
+ */
+unsigned int getThreadCount();
+
+/**
+ * A function that processes the indices from begin to end of a parallel loop.
+ *
+ * The thread is the index of the thread that calls the function, which is less than
+ * getThreadCount(), so that the function can keep results for each thread without locking.
+ */
+typedef void (*ParallelForFunction)(unsigned int begin, unsigned int end, unsigned int thread, void* arg);
+
+/**
+ * Calls a function for all of the indices from 0 to count, on as many threads as there are CPUs.
+ *
+ * The indices are split into ranges of grainSize indices, which the threads take in order until
+ * none are left, so that threads that finish early take more of the work. The calling thread
+ * takes ranges too, and the function returns once all of the indices have been processed.
+ *
+ * @param count The number of indices.
+ * @param grainSize The number of indices that a thread takes at a time.
+ * @param function The function to call for each range.
+ * @param arg The argument to pass to the function.
+ */
+void parallelFor(unsigned int count, unsigned int grainSize, ParallelForFunction function, void* arg);
+
 }
 
 #endif
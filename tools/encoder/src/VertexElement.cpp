@@ -4,9 +4,11 @@
 namespace gameplay
 {
 
-VertexElement::VertexElement(unsigned int t, unsigned int c) :
+VertexElement::VertexElement(unsigned int t, unsigned int c, unsigned int type, bool normalized) :
     usage(t),
-    size(c)
+    size(c),
+    type(type),
+    normalized(normalized)
 {
 }
 
@@ -23,15 +25,37 @@ void VertexElement::writeBinary(FILE* file)
     Object::writeBinary(file);
     write(usage, file);
     write(size, file);
+    write(type, file);
+    write((unsigned int)(normalized ? 1 : 0), file);
 }
 void VertexElement::writeText(FILE* file)
 {
     fprintElementStart(file);
     fprintfElement(file, "usage", usageStr(usage));
     fprintfElement(file, "size", size);
+    fprintfElement(file, "type", typeStr(type));
+    fprintfElement(file, "normalized", normalized ? "true" : "false");
     fprintElementEnd(file);
 }
 
+unsigned int VertexElement::byteSize() const
+{
+    switch (type)
+    {
+        case VERTEX_TYPE_HALF_FLOAT:
+        case VERTEX_TYPE_SHORT:
+        case VERTEX_TYPE_UNSIGNED_SHORT:
+            return size * 2;
+        case VERTEX_TYPE_BYTE:
+        case VERTEX_TYPE_UNSIGNED_BYTE:
+            return size;
+        case VERTEX_TYPE_INT_2_10_10_10_REV:
+            return 4;
+        default:
+            return size * sizeof(float);
+    }
+}
+
 const char* VertexElement::usageStr(unsigned int usage)
 {
     switch (usage)
@@ -73,4 +97,27 @@ const char* VertexElement::usageStr(unsigned int usage)
     }
 }
 
+const char* VertexElement::typeStr(unsigned int type)
+{
+    switch (type)
+    {
+        case VERTEX_TYPE_FLOAT:
+            return "FLOAT";
+        case VERTEX_TYPE_HALF_FLOAT:
+            return "HALF_FLOAT";
+        case VERTEX_TYPE_BYTE:
+            return "BYTE";
+        case VERTEX_TYPE_UNSIGNED_BYTE:
+            return "UNSIGNED_BYTE";
+        case VERTEX_TYPE_SHORT:
+            return "SHORT";
+        case VERTEX_TYPE_UNSIGNED_SHORT:
+            return "UNSIGNED_SHORT";
+        case VERTEX_TYPE_INT_2_10_10_10_REV:
+            return "INT_2_10_10_10_REV";
+        default:
+            return "";
+    }
+}
+
 }
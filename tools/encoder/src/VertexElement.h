@@ -13,7 +13,7 @@ public:
     /**
      * Constructor.
      */
-    VertexElement(unsigned int t, unsigned int c);
+    VertexElement(unsigned int t, unsigned int c, unsigned int type = VERTEX_TYPE_FLOAT, bool normalized = false);
 
     /**
      * Destructor.
@@ -24,10 +24,18 @@ public:
     virtual void writeBinary(FILE* file);
     virtual void writeText(FILE* file);
 
+    /**
+     * Returns the number of bytes of the element in a vertex.
+     */
+    unsigned int byteSize() const;
+
     static const char* usageStr(unsigned int usage);
+    static const char* typeStr(unsigned int type);
 
     unsigned int usage;
     unsigned int size;
+    unsigned int type;
+    bool normalized;
 };
 
 }
@@ -4,6 +4,10 @@
 #include "GPBDecoder.h"
 #include "EncoderArguments.h"
 #include "NormalMapGenerator.h"
+#include "PackEncoder.h"
+#include "KTXEncoder.h"
+#include "AtlasEncoder.h"
+#include "BatchEncoder.h"
 #include "Font.h"
 
 using namespace gameplay;
@@ -94,6 +98,34 @@ int main(int argc, const char** argv)
         return -1;
     }
 
+    // Pack a directory
+    if (arguments.packEnabled())
+    {
+        LOG(1, "Packing directory: %s\n", arguments.getFilePathPointer());
+        return writePack(arguments.getFilePathPointer(), arguments.getOutputFilePath().c_str());
+    }
+
+    // List the files of a directory in a manifest
+    if (arguments.manifestEnabled())
+    {
+        LOG(1, "Writing asset manifest: %s\n", arguments.getFilePathPointer());
+        return writeManifest(arguments.getFilePathPointer(), arguments.getOutputFilePath().c_str());
+    }
+
+    // Encode the jobs of a manifest
+    if (arguments.batchEnabled())
+    {
+        LOG(1, "Encoding batch: %s\n", arguments.getFilePathPointer());
+        return writeBatch(arguments.getFilePathPointer(), argv[0], arguments.getJobCount(), arguments.getProfile().c_str());
+    }
+
+    // Pack the images of a directory into an atlas
+    if (arguments.atlasEnabled())
+    {
+        LOG(1, "Packing images into an atlas: %s\n", arguments.getFilePathPointer());
+        return writeAtlas(arguments.getFilePathPointer(), arguments.getOutputFilePath().c_str());
+    }
+
     // File exists
     LOG(1, "Encoding file: %s\n", arguments.getFilePathPointer());
 
@@ -152,6 +184,14 @@ int main(int argc, const char** argv)
                 NormalMapGenerator generator(arguments.getFilePath().c_str(), arguments.getOutputFilePath().c_str(), x, y, arguments.getHeightmapWorldSize());
                 generator.generate();
             }
+            else if (arguments.ktxEnabled() && arguments.getFileFormat() == EncoderArguments::FILEFORMAT_PNG)
+            {
+                return writeKTX(arguments.getFilePath().c_str(), arguments.getOutputFilePath().c_str(), arguments.getMaxTextureSize());
+            }
+            else if (arguments.getMaxTextureSize() > 0 && arguments.getFileFormat() == EncoderArguments::FILEFORMAT_PNG)
+            {
+                return writeResizedImage(arguments.getFilePath().c_str(), arguments.getOutputFilePath().c_str(), arguments.getMaxTextureSize());
+            }
             else
             {
                 LOG(1, "Error: Nothing to do for specified file format. Did you forget an option?\n");
@@ -12,6 +12,7 @@ static inline void outputGetParam(ostream& o, const FunctionBinding::Param& p, i
 static inline void outputMatchedBinding(ostream& o, const FunctionBinding& b, unsigned int paramCount, unsigned int indentLevel, int numBindings);
 static inline void outputReturnValue(ostream& o, const FunctionBinding& b, int indentLevel);
 static inline std::string getTypeName(const FunctionBinding::Param& param);
+static inline void outputNewValue(ostream& o, const std::string& type);
 
 FunctionBinding::Param::Param(FunctionBinding::Param::Type type, Kind kind, const string& info) : 
     type(type), kind(kind), info(info), hasDefaultValue(false), levelsOfIndirection(0)
@@ -136,7 +137,9 @@ void FunctionBinding::write(ostream& o, const vector<FunctionBinding>& bindings)
                     o << "        void* returnPtr = (void*)instance->" << bindings[0].name << ";\n";
                 break;
             case FunctionBinding::Param::KIND_VALUE:
-                o << "        void* returnPtr = (void*)new " << bindings[0].returnParam << "(instance->" << bindings[0].name << ");\n";
+                o << "        void* returnPtr = (void*)";
+                outputNewValue(o, getTypeName(bindings[0].returnParam));
+                o << "instance->" << bindings[0].name << ");\n";
                 break;
             case FunctionBinding::Param::KIND_REFERENCE:
                 o << "        void* returnPtr = (void*)&(instance->" << bindings[0].name << ");\n";
@@ -214,7 +217,8 @@ void FunctionBinding::write(ostream& o, const vector<FunctionBinding>& bindings)
                 o << bindings[0].name << ");\n";
                 break;
             case FunctionBinding::Param::KIND_VALUE:
-                o << "        void* returnPtr = (void*)new " << bindings[0].returnParam << "(";
+                o << "        void* returnPtr = (void*)";
+                outputNewValue(o, getTypeName(bindings[0].returnParam));
                 if (bindings[0].classname.size() > 0)
                     o << bindings[0].classname << "::";
                 o << bindings[0].name << ");\n";
@@ -264,7 +268,9 @@ void FunctionBinding::write(ostream& o, const vector<FunctionBinding>& bindings)
                     o << "    void* returnPtr = (void*)instance->" << bindings[0].name << ";\n";
                 break;
             case FunctionBinding::Param::KIND_VALUE:
-                o << "    void* returnPtr = (void*)new " << bindings[0].returnParam << "(instance->" << bindings[0].name << ");\n";
+                o << "    void* returnPtr = (void*)";
+                outputNewValue(o, getTypeName(bindings[0].returnParam));
+                o << "instance->" << bindings[0].name << ");\n";
                 break;
             case FunctionBinding::Param::KIND_REFERENCE:
                 o << "    void* returnPtr = (void*)&(instance->" << bindings[0].name << ");\n";
@@ -308,7 +314,8 @@ void FunctionBinding::write(ostream& o, const vector<FunctionBinding>& bindings)
                 o << bindings[0].name << ");\n";
                 break;
             case FunctionBinding::Param::KIND_VALUE:
-                o << "    void* returnPtr = (void*)new " << bindings[0].returnParam << "(";
+                o << "    void* returnPtr = (void*)";
+                outputNewValue(o, getTypeName(bindings[0].returnParam));
                 if (bindings[0].classname.size() > 0)
                     o << bindings[0].classname << "::";
                 o << bindings[0].name << ");\n";
@@ -503,6 +510,15 @@ static inline std::string getTypeName(const FunctionBinding::Param& param)
     }
 }
 
+static inline void outputNewValue(ostream& o, const std::string& type)
+{
+    // Small value types are allocated from the pool of the script controller, since so many of them are returned.
+    if (Generator::getInstance()->isPooledValue(type))
+        o << "new (gameplay::ScriptUtil::allocateValue(sizeof(" << type << "))) " << type << "(";
+    else
+        o << "new " << type << "(";
+}
+
 ostream& operator<<(ostream& o, const FunctionBinding::Param& param)
 {
     o << getTypeName(param);
@@ -625,6 +641,11 @@ static inline void outputBindingInvocation(ostream& o, const FunctionBinding& b,
             indent(o, indentLevel + 1);
             o << "SAFE_RELEASE(instance);\n";
         }
+        else if (Generator::getInstance()->isPooledValue(b.classname))
+        {
+            indent(o, indentLevel + 1);
+            o << "gameplay::ScriptUtil::deleteValue(instance);\n";
+        }
         else
         {
             indent(o, indentLevel + 1);
@@ -659,7 +680,8 @@ static inline void outputBindingInvocation(ostream& o, const FunctionBinding& b,
                     o << "void* returnPtr = ((void*)";
                 break;
             case FunctionBinding::Param::KIND_VALUE:
-                o << "void* returnPtr = (void*)new " << b.returnParam << "(";
+                o << "void* returnPtr = (void*)";
+                outputNewValue(o, getTypeName(b.returnParam));
                 break;
             case FunctionBinding::Param::KIND_REFERENCE:
                 o << "void* returnPtr = (void*)&(";
@@ -686,7 +708,7 @@ static inline void outputBindingInvocation(ostream& o, const FunctionBinding& b,
         {
             if (b.returnParam.type == FunctionBinding::Param::TYPE_CONSTRUCTOR)
             {
-                o << "new " << Generator::getInstance()->getIdentifier(b.returnParam.info) << "(";
+                outputNewValue(o, Generator::getInstance()->getIdentifier(b.returnParam.info));
             }
             else
             {
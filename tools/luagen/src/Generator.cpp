@@ -142,6 +142,14 @@ bool Generator::isRef(string classname)
     return classname == REF_CLASS_NAME;
 }
 
+bool Generator::isPooledValue(string classname)
+{
+    if (classname.find("gameplay::") == 0)
+        classname = classname.substr(10);
+    return classname == "Vector2" || classname == "Vector3" || classname == "Vector4" ||
+        classname == "Quaternion" || classname == "Matrix";
+}
+
 string Generator::getCompoundName(XMLElement* node)
 {
     // Get the name of the namespace, class, struct, or file that we are processing.
@@ -1372,6 +1380,7 @@ void Generator::generateBindings(string* bindingNS)
     string luaAllCppStr = _outDir + string(LUA_ALL_BINDINGS_FILENAME) + string(".cpp");
     ostringstream luaAllCpp;
     luaAllCpp << "#include \"Base.h\"\n";
+    luaAllCpp << "#include \"ScriptController.h\"\n";
     luaAllCpp << "#include \"" << string(LUA_ALL_BINDINGS_FILENAME) << ".h\"\n\n";
     if (bindingNS)
     {
@@ -1393,7 +1402,14 @@ void Generator::generateBindings(string* bindingNS)
                 iter->second.write(_outDir, _includes[iter->second.include], bindingNS);
 
                 luaAllH << "#include \"lua_" << iter->second.uniquename << ".h\"\n";
-                luaAllCpp << "    luaRegister_" << iter->second.uniquename << "();\n";
+
+                // The classes are registered lazily, when a script or a binding first uses them. Inner classes
+                // are registered along with the outermost class that contains them.
+                vector<string> scopePath = getScopePath(iter->second.classname, iter->second.ns);
+                luaAllCpp << "    gameplay::ScriptUtil::registerClassLazy(\"" << iter->second.uniquename << "\", luaRegister_" << iter->second.uniquename;
+                if (!scopePath.empty())
+                    luaAllCpp << ", \"" << scopePath[0] << "\"";
+                luaAllCpp << ");\n";
             }
         }
     }
@@ -100,6 +100,15 @@ public:
      */
     bool isRef(string classname);
 
+    /**
+     * Retrieves whether the given class is a small value type whose instances
+     * are allocated from the value pool of the script controller.
+     * 
+     * @param classname The name of the class.
+     * @return True if the class is a pooled value type; false otherwise.
+     */
+    bool isPooledValue(string classname);
+
     /**
      * Checks whether the given class has any public derived classes.
      */